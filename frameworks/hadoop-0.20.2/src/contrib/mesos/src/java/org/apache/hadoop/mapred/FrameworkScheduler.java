@@ -67,9 +67,16 @@ public class FrameworkScheduler implements Scheduler {
     SlaveID mesosSlaveId;
     List<MesosTask> maps = new LinkedList<MesosTask>();
     List<MesosTask> reduces = new LinkedList<MesosTask>();
+    boolean launched = false; // Whether the executor has been launched
+    long idleSince;           // When the last task on the node went away
     
     public TaskTrackerInfo(SlaveID mesosSlaveId) {
       this.mesosSlaveId = mesosSlaveId;
+      this.idleSince = System.currentTimeMillis();
+    }
+
+    boolean isIdle() {
+      return maps.isEmpty() && reduces.isEmpty();
     }
     
     void add(MesosTask nt) {
@@ -87,11 +94,30 @@ public class FrameworkScheduler implements Scheduler {
     }
   }
   
+  // The demand for new tasks on a node, as seen by resourceOffers.
+  private static class NodeDemand {
+    int maps;         // Mesos tasks on the node, including new ones
+    int reduces;
+    boolean haveMaps; // Whether any job has a map to run on the node
+    boolean warm;     // Whether the node already runs a TaskTracker
+  }
+
+  // The demand for new tasks on the offered nodes, snapshotted by
+  // resourceOffers so that the offers can be matched against it without
+  // holding the JobTracker lock.
+  private static class Demand {
+    int maps;          // Maps that still need a Mesos task
+    int reduces;       // Reduces that still need a Mesos task
+    boolean setupTask; // Whether to launch a map for setup / cleanup
+    Map<String, NodeDemand> nodes = new HashMap<String, NodeDemand>();
+  }
+  
   private class KillTimedOutTasksThread extends Thread {
     @Override
     public void run() {
       while (running) {
         killTimedOutTasks();
+        shutDownIdleTaskTrackers();
         try { Thread.sleep(KILL_UNLAUNCHED_TASKS_SLEEP_TIME); }
         catch (Exception e) {}
       }
@@ -110,6 +136,7 @@ public class FrameworkScheduler implements Scheduler {
   private int cpusPerTask;
   private int memPerTask;
   private long localityWait;
+  private long executorLinger;
   
   private Map<String, TaskTrackerInfo> ttInfos =
     new HashMap<String, TaskTrackerInfo>();
@@ -145,6 +172,7 @@ public class FrameworkScheduler implements Scheduler {
     cpusPerTask = conf.getInt("mapred.mesos.task.cpus", 1);
     memPerTask = conf.getInt("mapred.mesos.task.mem", 1024);
     localityWait = conf.getLong("mapred.mesos.localitywait", 5000);
+    executorLinger = conf.getLong("mapred.mesos.executor.linger", 300000);
     maxMapsPerNode = conf.getInt("mapred.tasktracker.map.tasks.maximum", 2);
     maxReducesPerNode = conf.getInt("mapred.tasktracker.reduce.tasks.maximum", 2);
   }
@@ -181,64 +209,97 @@ public class FrameworkScheduler implements Scheduler {
     return getResource(offer.getResourcesList(), name);
   }
 
-  private static double getResource(TaskDescription task, String name) {
-    return getResource(task.getResourcesList(), name);
-  }
-  
   @Override
   public void resourceOffers(SchedulerDriver d, List<Offer> offers) {
     try {
-      synchronized(jobTracker) {
-        
-        int numOffers = (int) offers.size();
-        double[] cpus = new double[numOffers];
-        double[] mem = new double[numOffers];
+      int numOffers = (int) offers.size();
+      double[] cpus = new double[numOffers];
+      double[] mem = new double[numOffers];
 
-        // Count up the amount of free CPUs and memory on each node 
-        for (int i = 0; i < numOffers; i++) {
-          Offer offer = offers.get(i);
-          LOG.info("Got resource offer " + offer.getId());
-          cpus[i] = getResource(offer, "cpus");
-          mem[i] = getResource(offer, "mem");
+      // Count up the amount of free CPUs and memory on each node 
+      for (int i = 0; i < numOffers; i++) {
+        Offer offer = offers.get(i);
+        LOG.info("Got resource offer " + offer.getId());
+        cpus[i] = getResource(offer, "cpus");
+        mem[i] = getResource(offer, "mem");
+      }
+
+      // Take a snapshot of the demand for tasks on each of the offered
+      // nodes while holding the JobTracker lock, but match the offers
+      // against it without the lock, so that TaskTracker heartbeats
+      // (see assignTasks) don't have to wait for all of the offers.
+      Demand demand;
+      synchronized (jobTracker) {
+        demand = getDemand(offers);
+      }
+
+      // Assign tasks to the nodes in a round-robin manner, and stop when we
+      // are unable to assign a task to any node.
+      // We do this by keeping a linked list of indices of nodes for which
+      // we are still considering assigning tasks. Whenever we can't find a
+      // new task for a node, we remove it from the list. When the list is
+      // empty, no further assignments can be made. This algorithm was chosen
+      // because it minimizing the amount of scanning we need to do if we
+      // get a large set of offered nodes.
+      // Nodes that already run a TaskTracker go first, so that new tasks
+      // go to TaskTrackers that are still warm (see executorLinger) rather
+      // than waiting for new ones to start.
+      List<Integer> indices = new LinkedList<Integer>();
+      List<List<MesosTask>> replies =
+          new ArrayList<List<MesosTask>>(numOffers);
+      for (int i = 0; i < numOffers; i++) {
+        if (demand.nodes.get(offers.get(i).getHostname()).warm) {
+          indices.add(i);
         }
-        
-        // Assign tasks to the nodes in a round-robin manner, and stop when we
-        // are unable to assign a task to any node.
-        // We do this by keeping a linked list of indices of nodes for which
-        // we are still considering assigning tasks. Whenever we can't find a
-        // new task for a node, we remove it from the list. When the list is
-        // empty, no further assignments can be made. This algorithm was chosen
-        // because it minimizing the amount of scanning we need to do if we
-        // get a large set of offered nodes.
-        List<Integer> indices = new LinkedList<Integer>();
-        List<List<TaskDescription>> replies =
-            new ArrayList<List<TaskDescription>>(numOffers);
-        for (int i = 0; i < numOffers; i++) {
+        replies.add(new ArrayList<MesosTask>());
+      }
+      for (int i = 0; i < numOffers; i++) {
+        if (!demand.nodes.get(offers.get(i).getHostname()).warm) {
           indices.add(i);
-          replies.add(new ArrayList<TaskDescription>());
         }
-        while (indices.size() > 0) {
-          for (Iterator<Integer> it = indices.iterator(); it.hasNext();) {
-            int i = it.next();
-            Offer offer = offers.get(i);
-            TaskDescription task = findTask(
-                offer.getSlaveId(), offer.getHostname(), cpus[i], mem[i]);
-            if (task != null) {
-              cpus[i] -= getResource(task, "cpus");
-              mem[i] -= getResource(task, "mem");
-              replies.get(i).add(task);
-            } else {
-              it.remove();
-            }
+      }
+      while (indices.size() > 0) {
+        for (Iterator<Integer> it = indices.iterator(); it.hasNext();) {
+          int i = it.next();
+          MesosTask nt = findTask(
+              demand, offers.get(i).getHostname(), cpus[i], mem[i]);
+          if (nt != null) {
+            cpus[i] -= cpusPerTask;
+            mem[i] -= memPerTask;
+            replies.get(i).add(nt);
+          } else {
+            it.remove();
           }
         }
+      }
 
+      // Remember the tasks we're launching, all at once.
+      synchronized (jobTracker) {
         for (int i = 0; i < numOffers; i++) {
-          OfferID offerId = offers.get(i).getId();
-          Status status = d.launchTasks(offerId, replies.get(i));
-          if (status != Status.OK) {
-            LOG.warn("SchedulerDriver returned irregular status: " + status);
-          }
+          addTasks(offers.get(i).getSlaveId(), replies.get(i));
+        }
+      }
+
+      List<OfferID> declined = new ArrayList<OfferID>();
+      for (int i = 0; i < numOffers; i++) {
+        Offer offer = offers.get(i);
+        if (replies.get(i).isEmpty()) {
+          declined.add(offer.getId());
+          continue;
+        }
+        List<TaskDescription> tasks = new ArrayList<TaskDescription>();
+        for (MesosTask nt : replies.get(i)) {
+          tasks.add(makeTaskDescription(nt, offer.getSlaveId()));
+        }
+        Status status = d.launchTasks(offer.getId(), tasks);
+        if (status != Status.OK) {
+          LOG.warn("SchedulerDriver returned irregular status: " + status);
+        }
+      }
+      if (!declined.isEmpty()) {
+        Status status = d.declineOffers(declined);
+        if (status != Status.OK) {
+          LOG.warn("SchedulerDriver returned irregular status: " + status);
         }
       }
     } catch(Exception e) {
@@ -255,20 +316,109 @@ public class FrameworkScheduler implements Scheduler {
       return info;
     }
   }
+
+  // Computes the demand for tasks on the offered nodes. Assumes
+  // JobTracker is locked.
+  private Demand getDemand(List<Offer> offers) {
+    Demand demand = new Demand();
+    Collection<JobInProgress> jobs = jobTracker.jobs.values();
+
+    // Compute the total demand for maps to make sure we don't exceed it
+    int neededMaps = 0;
+    int neededReduces = 0;
+    for (JobInProgress job : jobs) {
+      if (job.getStatus().getRunState() == JobStatus.RUNNING) {
+        neededMaps += job.pendingMaps();
+        neededReduces += job.pendingReduces();
+      }
+    }
+    // TODO (!!!): Count speculatable tasks and add them to neededMaps
+    // and neededReduces
+    demand.maps = Math.max(neededMaps - unassignedMaps, 0);
+
+    if (neededReduces > unassignedReduces) {
+      // Check that there's a reduce to launch
+      for (JobInProgress job : jobs) {
+        int state = job.getStatus().getRunState();
+        if (state == JobStatus.RUNNING && hasReduceToLaunch(job)) {
+          demand.reduces = neededReduces - unassignedReduces;
+          break;
+        }
+      }
+    }
+
+    // If there are pending jobs in the queue but no TaskTrackers, ensure
+    // that at least one TaskTracker gets launched to execute setup tasks
+    int numTrackers = jobTracker.getClusterStatus().getTaskTrackers();
+    demand.setupTask =
+      jobs.size() > 0 && numTrackers == 0 && totalMesosTasks() == 0;
+
+    int maxLevel = demand.maps > 0 ? getMaxMapCacheLevel() : 0;
+
+    for (Offer offer : offers) {
+      String host = offer.getHostname();
+      if (demand.nodes.containsKey(host)) {
+        continue;
+      }
+      TaskTrackerInfo ttInfo = getTaskTrackerInfo(host, offer.getSlaveId());
+      NodeDemand node = new NodeDemand();
+      node.maps = ttInfo.maps.size();
+      node.reduces = ttInfo.reduces.size();
+      node.warm = ttInfo.launched;
+      // Look for a map with the required level
+      if (demand.maps > 0) {
+        for (JobInProgress job : jobs) {
+          int state = job.getStatus().getRunState();
+          if (state == JobStatus.RUNNING &&
+              hasMapToLaunch(job, host, maxLevel)) {
+            node.haveMaps = true;
+            break;
+          }
+        }
+      }
+      demand.nodes.put(host, node);
+    }
+
+    return demand;
+  }
+
+  // Figures out what locality level to allow maps at (maximum cache
+  // level) using delay scheduling. Assumes JobTracker is locked.
+  private int getMaxMapCacheLevel() {
+    long now = System.currentTimeMillis();
+    if (lastCanLaunchMapTime == -1)
+      lastCanLaunchMapTime = now;
+    int maxLevel; // Cache level to search for maps in
+    if (lastMapWasLocal) {
+      timeWaitedForLocalMap += now - lastCanLaunchMapTime;
+      if (timeWaitedForLocalMap >= localityWait) {
+        maxLevel = Integer.MAX_VALUE;
+      } else {
+        maxLevel = 1;
+      }
+    } else {
+      maxLevel = Integer.MAX_VALUE;
+    }
+    lastCanLaunchMapTime = now;
+    return maxLevel;
+  }
   
-  // Find a single task for a given node. Assumes JobTracker is locked.
-  private TaskDescription findTask(
-      SlaveID slaveId, String host, double cpus, double mem) {
+  // Find a single task for a given node, taking it out of the demand.
+  // Doesn't need the JobTracker lock (see addTasks).
+  private MesosTask findTask(
+      Demand demand, String host, double cpus, double mem) {
     if (cpus < cpusPerTask || mem < memPerTask) {
       return null; // Too few resources are left on the node
     }
     
-    TaskTrackerInfo ttInfo = getTaskTrackerInfo(host, slaveId);
+    NodeDemand node = demand.nodes.get(host);
 
     // Pick whether to launch a map or a reduce based on available tasks
     String taskType = null;
-    boolean haveMaps = canLaunchMap(host);
-    boolean haveReduces = canLaunchReduce(host);
+    boolean haveMaps = node.maps < maxMapsPerNode &&
+      ((demand.maps > 0 && node.haveMaps) || demand.setupTask);
+    boolean haveReduces = node.reduces < maxReducesPerNode &&
+      demand.reduces > 0;
     LOG.info("Looking at " + host + ": haveMaps=" + haveMaps + 
         ", haveReduces=" + haveReduces);
     if (!haveMaps && !haveReduces) {
@@ -279,31 +429,59 @@ public class FrameworkScheduler implements Scheduler {
       taskType = "reduce";
     } else {
       float mapToReduceRatio = 1;
-      if (ttInfo.reduces.size() < ttInfo.maps.size() / mapToReduceRatio)
+      if (node.reduces < node.maps / mapToReduceRatio)
         taskType = "reduce";
       else
         taskType = "map";
     }
     LOG.info("Task type chosen: " + taskType);
-    
-    // Get a Mesos task ID for the new task
-    TaskID mesosId = newMesosTaskId();
-    
-    // Remember that it is launched
+
     boolean isMap = taskType.equals("map");
     if (isMap) {
-      unassignedMaps++;
+      node.maps++;
+      if (demand.maps > 0 && node.haveMaps) {
+        demand.maps--;
+      } else {
+        LOG.info("Going to launch map task for setup / cleanup");
+        demand.setupTask = false;
+      }
     } else {
-      unassignedReduces++;
+      node.reduces++;
+      demand.reduces--;
     }
-    MesosTask nt = new MesosTask(isMap, mesosId, host);
-    mesosIdToMesosTask.put(mesosId.getValue(), nt);
-    ttInfo.add(nt);
-    
-    // Create a task description to pass back to Mesos
-    String name = "task " + mesosId + " (" + taskType + ")";
+
+    // Get a Mesos task ID for the new task
+    return new MesosTask(isMap, newMesosTaskId(), host);
+  }
+
+  // Remember that the tasks found for a node are launched, dropping any
+  // that the node no longer has room for. Assumes JobTracker is locked.
+  private void addTasks(SlaveID slaveId, List<MesosTask> tasks) {
+    for (Iterator<MesosTask> it = tasks.iterator(); it.hasNext();) {
+      MesosTask nt = it.next();
+      TaskTrackerInfo ttInfo = getTaskTrackerInfo(nt.host, slaveId);
+      if (nt.isMap ? ttInfo.maps.size() >= maxMapsPerNode
+                   : ttInfo.reduces.size() >= maxReducesPerNode) {
+        it.remove();
+        continue;
+      }
+      if (nt.isMap) {
+        unassignedMaps++;
+      } else {
+        unassignedReduces++;
+      }
+      mesosIdToMesosTask.put(nt.mesosId.getValue(), nt);
+      ttInfo.add(nt);
+      ttInfo.launched = true;
+    }
+  }
+
+  // Create a task description to pass back to Mesos
+  private TaskDescription makeTaskDescription(MesosTask nt, SlaveID slaveId) {
+    String taskType = nt.isMap ? "map" : "reduce";
+    String name = "task " + nt.mesosId + " (" + taskType + ")";
     return TaskDescription.newBuilder()
-      .setTaskId(mesosId)
+      .setTaskId(nt.mesosId)
       .setSlaveId(slaveId)
       .setName(name)
       .addResources(makeResource("cpus", cpusPerTask))
@@ -340,108 +518,10 @@ public class FrameworkScheduler implements Scheduler {
     }
   }
   
-  // TODO: Make this return a count instead of a boolean?
-  // TODO: Cache result for some time so we don't iterate through all jobs
-  // and tasks every time we get a resource offer?
-  private boolean canLaunchMap(String host) {
-    // Check whether the TT is saturated on maps
-    TaskTrackerInfo ttInfo = ttInfos.get(host);
-    if (ttInfo == null) {
-      LOG.error("No TaskTrackerInfo for " + host + "! This shouldn't happen.");
-      return false;
-    }
-    if (ttInfo.maps.size() >= maxMapsPerNode) {
-      return false;
-    }
-    
-    // Compute the total demand for maps to make sure we don't exceed it
-    Collection<JobInProgress> jobs = jobTracker.jobs.values();
-    int neededMaps = 0;
-    for (JobInProgress job : jobs) {
-      if (job.getStatus().getRunState() == JobStatus.RUNNING) {
-        neededMaps += job.pendingMaps();
-      }
-    }
-    // TODO (!!!): Count speculatable tasks and add them to neededMaps
-    
-    if (unassignedMaps < neededMaps) {
-      // Figure out what locality level to allow using delay scheduling
-      long now = System.currentTimeMillis();
-      if (lastCanLaunchMapTime == -1)
-        lastCanLaunchMapTime = now;
-      int maxLevel; // Cache level to search for maps in
-      if (lastMapWasLocal) {
-        timeWaitedForLocalMap += now - lastCanLaunchMapTime;
-        if (timeWaitedForLocalMap >= localityWait) {
-          maxLevel = Integer.MAX_VALUE;
-        } else {
-          maxLevel = 1;
-        }
-      } else {
-        maxLevel = Integer.MAX_VALUE;
-      }
-      lastCanLaunchMapTime = now;
-      // Look for a map with the required level
-      for (JobInProgress job: jobs) {
-        int state = job.getStatus().getRunState();
-        if (state == JobStatus.RUNNING && hasMapToLaunch(job, host, maxLevel)) {
-          return true;
-        }
-      }
-    }
-    
-    // If we didn't launch any tasks, but there are pending jobs in the queue,
-    // ensure that at least one TaskTracker is running to execute setup tasks
-    int numTrackers = jobTracker.getClusterStatus().getTaskTrackers();
-    if (jobs.size() > 0 && numTrackers == 0 && totalMesosTasks() == 0) {
-      LOG.info("Going to launch map task for setup / cleanup");
-      return true;
-    }
-    
-    return false;
-  }
-  
   private int totalMesosTasks() {
     return unassignedMaps + unassignedReduces + assignedMaps + assignedReduces;
   }
 
-  // TODO: Make this return a count instead of a boolean?
-  // TODO: Cache result for some time so we don't iterate through all jobs
-  // and tasks every time we get a resource offer?
-  private boolean canLaunchReduce(String host) {
-    // Check whether the TT is saturated on reduces
-    TaskTrackerInfo ttInfo = ttInfos.get(host);
-    if (ttInfo == null) {
-      LOG.error("No TaskTrackerInfo for " + host + "! This shouldn't happen.");
-      return false;
-    }
-    if (ttInfo.reduces.size() >= maxReducesPerNode) {
-      return false;
-    }
-    
-    // Compute total demand for reduces, to make sure we don't exceed it
-    Collection<JobInProgress> jobs = jobTracker.jobs.values();
-    int neededReduces = 0;
-    for (JobInProgress job : jobs) {
-      if (job.getStatus().getRunState() == JobStatus.RUNNING) {
-        neededReduces += job.pendingReduces();
-      }
-    }
-    // TODO (!!!): Count speculatable tasks and add them to neededReduces
-    
-    if (neededReduces > unassignedReduces) {
-      // Find a reduce to launch
-      for (JobInProgress job: jobs) {
-        int state = job.getStatus().getRunState();
-        if (state == JobStatus.RUNNING && hasReduceToLaunch(job)) {
-          return true;
-        }
-      }
-    }
-    
-    return false;
-  }
-
   public void killedTask(TaskAttemptID hadoopId) {
     MesosTask nt = hadoopIdToMesosTask.remove(hadoopId);
     if (nt != null) {
@@ -562,6 +642,9 @@ public class FrameworkScheduler implements Scheduler {
       TaskTrackerInfo ttInfo = ttInfos.get(nt.host);
       if (ttInfo != null) {
         ttInfo.remove(nt);
+        if (ttInfo.isIdle()) {
+          ttInfo.idleSince = System.currentTimeMillis();
+        }
       }
       if (nt.isMap) {
         if (nt.isAssigned())
@@ -621,6 +704,39 @@ public class FrameworkScheduler implements Scheduler {
     }
   }
   
+  // Shut down the TaskTrackers that have been idle for longer than
+  // executorLinger. Until then, they stay up so that new jobs can use them
+  // without waiting for a new executor (and TaskTracker) to start.
+  public void shutDownIdleTaskTrackers() {
+    if (executorLinger < 0) {
+      return; // Keep idle TaskTrackers forever
+    }
+    synchronized (jobTracker) {
+      long curTime = System.currentTimeMillis();
+      for (Iterator<Map.Entry<String, TaskTrackerInfo>> it =
+             ttInfos.entrySet().iterator(); it.hasNext();) {
+        Map.Entry<String, TaskTrackerInfo> entry = it.next();
+        TaskTrackerInfo tt = entry.getValue();
+        if (tt.launched && tt.isIdle() &&
+            curTime - tt.idleSince >= executorLinger) {
+          LOG.info("Shutting down idle TaskTracker on " + entry.getKey());
+          HadoopFrameworkMessage message = new HadoopFrameworkMessage(
+              HadoopFrameworkMessage.Type.S2E_SHUTDOWN_EXECUTOR, "");
+          try {
+            driver.sendFrameworkMessage(
+                tt.mesosSlaveId, EXECUTOR_ID, message.serialize());
+          } catch (IOException e) {
+            // See askExecutorToUpdateStatus
+            LOG.fatal("Failed to serialize HadoopFrameworkMessage", e);
+            throw new RuntimeException(
+                "Failed to serialize HadoopFrameworkMessage", e);
+          }
+          it.remove();
+        }
+      }
+    }
+  }
+  
   @Override
   public void frameworkMessage(SchedulerDriver d, SlaveID sId, ExecutorID eId, byte[] message) {
     // TODO: Respond to E2S_KILL_REQUEST message by killing a task
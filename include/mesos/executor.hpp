@@ -20,6 +20,7 @@
 #define __MESOS_EXECUTOR_HPP__
 
 #include <string>
+#include <vector>
 
 #include <mesos/mesos.hpp>
 
@@ -97,6 +98,21 @@ public:
   virtual void launchTask(ExecutorDriver* driver,
                           const TaskDescription& task) = 0;
 
+  /**
+   * Invoked when a batch of tasks has been launched on this executor
+   * at once (e.g., when the tasks were queued while the executor was
+   * starting up). The default implementation invokes launchTask for
+   * each task, in order; executors that can start many tasks more
+   * cheaply together should override it.
+   */
+  virtual void launchTasks(ExecutorDriver* driver,
+                           const std::vector<TaskDescription>& tasks)
+  {
+    for (size_t i = 0; i < tasks.size(); i++) {
+      launchTask(driver, tasks[i]);
+    }
+  }
+
   /**
    * Invoked when a task running within this executor has been killed
    * (via SchedulerDriver::killTask). Note that no status update will
@@ -191,7 +207,8 @@ public:
    * necessary until an acknowledgement has been received or the
    * executor is terminated (in which case, a TASK_LOST status update
    * will be sent). See Scheduler::statusUpdate for more information
-   * about status update acknowledgements.
+   * about status update acknowledgements. Returns once the update has
+   * been queued, without waiting for it to be sent.
    */
   virtual Status sendStatusUpdate(const TaskStatus& status) = 0;
 
@@ -215,6 +232,16 @@ public:
  * MesosExecutorDriver::join) doesn't affect the executor callbacks in
  * anyway because they are handled by a different thread.
  *
+ * If MESOS_DIRECT_MESSAGES=1 is in the executor's environment (e.g.,
+ * set via the "env.MESOS_DIRECT_MESSAGES" ExecutorInfo param)
+ * framework messages get exchanged with the scheduler directly rather
+ * than through the slave, which requires that the executor and the
+ * scheduler can reach each other.
+ *
+ * Likewise, MESOS_BATCH_STATUS_UPDATES=1 makes the driver hold on to
+ * status updates for a few milliseconds so that the ones sent close
+ * together reach the slave in one message.
+ *
  * See src/examples/test_executor.cpp for an example of using the
  * MesosExecutorDriver.
  */
@@ -0,0 +1,148 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __MESOS_OFFER_INDEX_HPP__
+#define __MESOS_OFFER_INDEX_HPP__
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility> // For std::pair.
+#include <vector>
+
+#include <mesos/mesos.hpp>
+
+/**
+ * Helper for schedulers that keeps their outstanding offers indexed
+ * so that tasks can be matched to offers without scanning all of the
+ * offers for every task (e.g., in Scheduler::resourceOffers).
+ */
+
+namespace mesos {
+
+/**
+ * Keeps the outstanding offers of a scheduler indexed by their slave
+ * and by their free cpus and memory (i.e., the resources of an offer
+ * that haven't been taken for tasks yet, see OfferIndex::take).
+ *
+ * Offers should be added as they arrive (Scheduler::resourceOffers)
+ * and removed once they're used (SchedulerDriver::launchTasks),
+ * rescinded (Scheduler::offerRescinded) or their slave is lost
+ * (Scheduler::slaveLost). An OfferIndex is not thread-safe, but it's
+ * meant to be used from within the scheduler's callbacks (of which
+ * only one is invoked at a time anyway).
+ */
+class OfferIndex
+{
+public:
+  OfferIndex();
+
+  ~OfferIndex();
+
+  /**
+   * Adds an offer (or replaces an offer with the same id). All of its
+   * resources start out free.
+   */
+  void add(const Offer& offer);
+
+  /**
+   * Adds all of the offers (e.g., as passed to resourceOffers).
+   */
+  void add(const std::vector<Offer>& offers);
+
+  /**
+   * Removes an offer, returning false if it isn't in the index.
+   */
+  bool remove(const OfferID& offerId);
+
+  /**
+   * Removes all the offers of a slave (e.g., once it's lost).
+   */
+  void remove(const SlaveID& slaveId);
+
+  /**
+   * Removes all the offers.
+   */
+  void clear();
+
+  /**
+   * Returns true if the offer is in the index.
+   */
+  bool contains(const OfferID& offerId) const;
+
+  /**
+   * Returns the number of offers in the index.
+   */
+  size_t size() const;
+
+  /**
+   * Returns the offer (as added), which must be in the index.
+   */
+  const Offer& get(const OfferID& offerId) const;
+
+  /**
+   * Returns the resources of the offer that haven't been taken yet.
+   */
+  std::vector<Resource> remaining(const OfferID& offerId) const;
+
+  /**
+   * Finds the best fitting offer that still has all of the resources
+   * free and has all of the attributes (e.g., a rack), i.e., of the
+   * offers that fit, the one with the least cpus and then the least
+   * memory free, returning false if no offer fits.
+   */
+  bool find(const google::protobuf::RepeatedPtrField<Resource>& resources,
+            OfferID* offerId,
+            const std::vector<Attribute>& attributes =
+              std::vector<Attribute>()) const;
+
+  /**
+   * Like find, but also takes the resources out of the free resources
+   * of the offer, so that many tasks can be matched to the offers
+   * before launching them (see remaining for what's left of an offer
+   * once the tasks are matched).
+   */
+  bool take(const google::protobuf::RepeatedPtrField<Resource>& resources,
+            OfferID* offerId,
+            const std::vector<Attribute>& attributes =
+              std::vector<Attribute>());
+
+private:
+  struct Entry;
+
+  // Re-indexes an offer by its (changed) free cpus and memory.
+  void index(Entry* entry);
+
+  // Offers by their ids.
+  std::map<std::string, Entry*> offers;
+
+  // Ids of the offers of each slave (by slave id).
+  std::map<std::string, std::set<std::string> > slaves;
+
+  // Offers by their free cpus and memory.
+  std::multimap<std::pair<double, double>, Entry*> free;
+
+  // Not copyable.
+  OfferIndex(const OfferIndex&);
+  OfferIndex& operator = (const OfferIndex&);
+};
+
+} // namespace mesos {
+
+#endif // __MESOS_OFFER_INDEX_HPP__
@@ -21,6 +21,7 @@
 
 #include <string>
 #include <map>
+#include <utility> // For std::pair.
 #include <vector>
 
 #include <mesos/mesos.hpp>
@@ -118,6 +119,22 @@ public:
   virtual void statusUpdate(SchedulerDriver* driver,
                             const TaskStatus& status) = 0;
 
+  /**
+   * Invoked with several status updates at once when they arrive
+   * together (e.g., a slave reporting many finished tasks). Returning
+   * from this callback acknowledges all of them. The default
+   * implementation invokes statusUpdate for each, in order;
+   * schedulers that handle lots of updates can override it to handle
+   * them in one go.
+   */
+  virtual void statusUpdates(SchedulerDriver* driver,
+                             const std::vector<TaskStatus>& statuses)
+  {
+    for (size_t i = 0; i < statuses.size(); i++) {
+      statusUpdate(driver, statuses[i]);
+    }
+  }
+
   /**
    * Invoked when an executor sends a message. These messages are best
    * effort; do not expect a framework message to be retransmitted in
@@ -128,6 +145,19 @@ public:
                                 const ExecutorID& executorId,
                                 const std::string& data) = 0;
 
+  /**
+   * Invoked when an executor is using most of its memory limit (i.e.,
+   * 'mem' of its 'limit' MB, see the slave's memory_pressure_threshold
+   * option), so that the framework can act before the executor runs
+   * out of memory (at which point it gets killed and its tasks fail).
+   * The default implementation does nothing.
+   */
+  virtual void executorMemoryPressure(SchedulerDriver* driver,
+                                      const SlaveID& slaveId,
+                                      const ExecutorID& executorId,
+                                      double mem,
+                                      double limit) {}
+
   /**
    * Invoked when a slave has been determined unreachable (e.g.,
    * machine failure, network partition). Most frameworks will need to
@@ -213,18 +243,56 @@ public:
       const std::vector<ResourceRequest>& requests) = 0;
 
   /**
-   * Launches the given set of tasks. Note that the current mechanism
-   * of rejecting resources is to invoke this with an empty collection
-   * of tasks. A framework can also specify filters on all resources
-   * unused (see mesos.proto for a description of Filters). Note that
-   * currently tasks can only be launched per offer. In the future,
-   * frameworks will be allowed to aggregate offers (resources) to
-   * launch their tasks.
+   * Launches the given set of tasks. Invoking this with an empty
+   * collection of tasks rejects the resources (but see declineOffers
+   * for rejecting many offers at once). A framework can also specify
+   * filters on all resources unused (see mesos.proto for a
+   * description of Filters). Note that currently tasks can only be
+   * launched per offer. In the future, frameworks will be allowed to
+   * aggregate offers (resources) to launch their tasks.
    */
   virtual Status launchTasks(const OfferID& offerId,
                              const std::vector<TaskDescription>& tasks,
                              const Filters& filters = Filters()) = 0;
 
+  /**
+   * Launches tasks using several offers at once, as if launchTasks
+   * had been invoked for each offer (with the same filters), but
+   * with a single message to Mesos. Useful for replying to all of the
+   * offers from a Scheduler::resourceOffers callback at once.
+   */
+  virtual Status launchTasks(
+      const std::vector<std::pair<OfferID,
+                                  std::vector<TaskDescription> > >& launches,
+      const Filters& filters = Filters()) = 0;
+
+  /**
+   * Declines offers (i.e., launches no tasks with them) so that Mesos
+   * can offer the resources again right away, with a single message
+   * for all of the offers. The filters apply to each offer.
+   */
+  virtual Status declineOffers(const std::vector<OfferID>& offerIds,
+                               const Filters& filters = Filters()) = 0;
+
+  /**
+   * Queues tasks with Mesos rather than launching them with an offer.
+   * The allocator (if it supports it) launches the queued tasks as
+   * resources become free, on whichever slaves they fit, without
+   * offering those resources to the framework. The slave IDs of the
+   * tasks are ignored (they get filled in once a task is placed).
+   * Queued tasks can be killed (via killTask) before they launch.
+   */
+  virtual Status queueTasks(const std::vector<TaskDescription>& tasks) = 0;
+
+  /**
+   * Asks Mesos for the current state of the specified tasks (or of
+   * all of the framework's tasks, if none are specified), e.g., after
+   * the scheduler failed over. The states arrive as status updates:
+   * the tasks Mesos doesn't know about are reported as lost, and the
+   * tasks that are still queued (see queueTasks) as starting.
+   */
+  virtual Status reconcileTasks(const std::vector<TaskID>& taskIds) = 0;
+
   /**
    * Kills the specified task. Note that attempting to kill a task is
    * currently not reliable. If, for example, a scheduler fails over
@@ -269,6 +337,14 @@ public:
  * MesosSchedulerDriver::join) doesn't affect the scheduler callbacks
  * in anyway because they are handled by a different thread.
  *
+ * By default the callbacks are invoked by the same thread that
+ * handles the driver's communication with Mesos, so a slow callback
+ * holds up the driver. Setting the "async_callbacks" option (e.g.,
+ * via MESOS_ASYNC_CALLBACKS=1) has the callbacks invoked (still one
+ * at a time, in order) by a thread of their own instead. Status
+ * updates that arrive while the scheduler is busy then get delivered
+ * together via Scheduler::statusUpdates.
+ *
  * See src/examples/test_framework.cpp for an example of using the
  * MesosSchedulerDriver.
  */
@@ -340,6 +416,15 @@ public:
       const OfferID& offerId,
       const std::vector<TaskDescription>& tasks,
       const Filters& filters = Filters());
+  virtual Status launchTasks(
+      const std::vector<std::pair<OfferID,
+                                  std::vector<TaskDescription> > >& launches,
+      const Filters& filters = Filters());
+  virtual Status declineOffers(
+      const std::vector<OfferID>& offerIds,
+      const Filters& filters = Filters());
+  virtual Status queueTasks(const std::vector<TaskDescription>& tasks);
+  virtual Status reconcileTasks(const std::vector<TaskID>& taskIds);
   virtual Status killTask(const TaskID& taskId);
   virtual Status reviveOffers();
   virtual Status sendFrameworkMessage(
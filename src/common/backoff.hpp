@@ -0,0 +1,82 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BACKOFF_HPP__
+#define __BACKOFF_HPP__
+
+#include <stdlib.h> // For rand_r.
+#include <string.h> // For memcpy.
+
+#include <algorithm>
+#include <string>
+
+#include "common/uuid.hpp"
+
+
+namespace mesos {
+namespace internal {
+
+// Exponential backoff with jitter for retrying a request (e.g., a
+// registration) that lots of processes might be making at the same
+// time. Each interval is picked at random from the upper half of the
+// current bound, which doubles (up to 'max') every time an interval
+// is returned, so processes that started retrying in lockstep spread
+// out rather than keep hitting the receiver all at once. The random
+// number generator is seeded from a random UUID so that processes on
+// different machines don't all pick the same intervals.
+class Backoff
+{
+public:
+  Backoff(double _initial, double _max)
+    : initial(_initial), max(_max), bound(_initial)
+  {
+    const std::string bytes = UUID::random().toBytes();
+    memcpy(&seed, bytes.data(), std::min(sizeof(seed), bytes.size()));
+  }
+
+  // Returns the next interval to wait (in seconds).
+  double next()
+  {
+    double interval = bound / 2 + jitter(bound / 2);
+    bound = std::min(bound * 2, max);
+    return interval;
+  }
+
+  // Returns a random interval in [0, 'limit') seconds.
+  double jitter(double limit)
+  {
+    return limit * (rand_r(&seed) / (RAND_MAX + 1.0));
+  }
+
+  // Starts over with the initial bound (e.g., after a success).
+  void reset()
+  {
+    bound = initial;
+  }
+
+private:
+  const double initial;
+  const double max;
+  double bound;
+  unsigned int seed;
+};
+
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __BACKOFF_HPP__
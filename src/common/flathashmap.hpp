@@ -0,0 +1,406 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FLATHASHMAP_HPP__
+#define __FLATHASHMAP_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+
+#include "common/option.hpp"
+
+
+// Provides a hash map (and, see flathashset.hpp, a hash set) that
+// keeps its entries in one array rather than in a node per entry
+// like 'hashmap' (i.e., boost::unordered_map) does, so looking up or
+// iterating over lots of entries doesn't chase pointers all over the
+// heap. Collisions get resolved by linear probing, and next to the
+// entries there's a byte per slot (with 7 bits of the key's hash for
+// the full slots) so that probing mostly compares bytes rather than
+// keys.
+//
+// N.B. Unlike with 'hashmap', inserting can move the entries, which
+// invalidates any iterators, pointers and references to them (hence
+// the values of the tables using it are mostly pointers). Erasing
+// doesn't move anything, so erasing while iterating (i.e.,
+// 'map.erase(it++)') is fine.
+
+// Forward declarations (necessary to befriend them).
+template <typename Key, typename Value>
+class flathashmap;
+
+template <typename Elem>
+class flathashset;
+
+
+namespace flat {
+
+// Control bytes of the slots (a full slot has 7 bits of its hash).
+const uint8_t EMPTY = 0x80;
+const uint8_t DELETED = 0xfe;
+
+
+template <typename Table, typename Entry>
+class Iterator
+{
+public:
+  typedef std::forward_iterator_tag iterator_category;
+  typedef Entry value_type;
+  typedef ptrdiff_t difference_type;
+  typedef Entry* pointer;
+  typedef Entry& reference;
+
+  Iterator() : table(NULL), index(0) {}
+
+  Iterator(Table* _table, size_t _index) : table(_table), index(_index)
+  {
+    skip();
+  }
+
+  // Allows converting an iterator into a const iterator.
+  template <typename T, typename E>
+  Iterator(const Iterator<T, E>& that) : table(that.table), index(that.index) {}
+
+  reference operator * () const { return table->entries[index]; }
+
+  pointer operator -> () const { return &table->entries[index]; }
+
+  Iterator& operator ++ ()
+  {
+    index++;
+    skip();
+    return *this;
+  }
+
+  Iterator operator ++ (int)
+  {
+    Iterator it = *this;
+    ++(*this);
+    return it;
+  }
+
+  template <typename T, typename E>
+  bool operator == (const Iterator<T, E>& that) const
+  {
+    return index == that.index;
+  }
+
+  template <typename T, typename E>
+  bool operator != (const Iterator<T, E>& that) const
+  {
+    return index != that.index;
+  }
+
+private:
+  template <typename T, typename E>
+  friend class Iterator;
+
+  template <typename K, typename V>
+  friend class ::flathashmap;
+
+  template <typename E>
+  friend class ::flathashset;
+
+  // Moves on to the next full slot (if not at one already).
+  void skip()
+  {
+    while (index < table->controls.size() &&
+           (table->controls[index] & EMPTY) != 0) {
+      index++;
+    }
+  }
+
+  Table* table;
+  size_t index;
+};
+
+
+// The array of slots, indexed by the hash of the keys of the entries
+// (as returned by 'KeyOf').
+template <typename Key, typename Entry, typename KeyOf>
+class Table
+{
+public:
+  Table() : count(0), used(0) {}
+
+  // Returns the slot of the key or the number of slots if the key
+  // isn't there.
+  size_t find(const Key& key) const
+  {
+    if (count == 0) {
+      return controls.size();
+    }
+
+    const uint64_t hash = mix(boost::hash<Key>()(key));
+    const uint8_t control = hash & 0x7f;
+    const size_t mask = controls.size() - 1;
+
+    // There's always an empty slot, which ends the probing.
+    for (size_t i = (hash >> 7) & mask; ; i = (i + 1) & mask) {
+      if (controls[i] == control && KeyOf::key(entries[i]) == key) {
+        return i;
+      } else if (controls[i] == EMPTY) {
+        return controls.size();
+      }
+    }
+  }
+
+  // Returns the slot of the key, inserting the key (with a default
+  // value) if it isn't there yet, and whether it got inserted.
+  std::pair<size_t, bool> insert(const Key& key)
+  {
+    size_t i = find(key);
+    if (i != controls.size()) {
+      return std::make_pair(i, false);
+    }
+
+    // Deleted slots count towards the load since they don't end the
+    // probing like empty ones do.
+    if ((used + 1) * 8 > controls.size() * 7) {
+      rehash(count + 1);
+    }
+
+    const uint64_t hash = mix(boost::hash<Key>()(key));
+    i = probe(hash);
+
+    if (controls[i] == EMPTY) {
+      used++;
+    }
+
+    controls[i] = hash & 0x7f;
+    KeyOf::key(entries[i]) = key;
+    count++;
+
+    return std::make_pair(i, true);
+  }
+
+  void erase(size_t i)
+  {
+    // No probing continues past an empty slot, so if the next slot is
+    // empty this one can be too (rather than deleted).
+    const size_t next = (i + 1) & (controls.size() - 1);
+    if (controls[next] == EMPTY) {
+      controls[i] = EMPTY;
+      used--;
+    } else {
+      controls[i] = DELETED;
+    }
+
+    // Give back whatever the entry held on to.
+    entries[i] = Entry();
+    count--;
+  }
+
+  void clear()
+  {
+    std::vector<uint8_t>().swap(controls);
+    std::vector<Entry>().swap(entries);
+    count = 0;
+    used = 0;
+  }
+
+  // Makes room for 'n' entries without having to grow.
+  void reserve(size_t n)
+  {
+    if (n * 8 > controls.size() * 7) {
+      rehash(n);
+    }
+  }
+
+  void swap(Table& that)
+  {
+    controls.swap(that.controls);
+    entries.swap(that.entries);
+    std::swap(count, that.count);
+    std::swap(used, that.used);
+  }
+
+  std::vector<uint8_t> controls;
+  std::vector<Entry> entries;
+
+  size_t count; // Full slots.
+  size_t used; // Full and deleted slots.
+
+private:
+  // Spreads the bits of the hash around since Boost's hashes of
+  // integers and pointers are the integers and pointers themselves
+  // (whose low bits are often all the same).
+  static uint64_t mix(uint64_t hash)
+  {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+  }
+
+  // Returns the first empty or deleted slot for the hash.
+  size_t probe(uint64_t hash) const
+  {
+    const size_t mask = controls.size() - 1;
+    size_t i = (hash >> 7) & mask;
+    while ((controls[i] & EMPTY) == 0) {
+      i = (i + 1) & mask;
+    }
+    return i;
+  }
+
+  // Moves the entries into as many slots (a power of two, at least
+  // 16) as 'n' entries need, dropping the deleted slots.
+  void rehash(size_t n)
+  {
+    size_t size = 16;
+    while (n * 8 > size * 7) {
+      size *= 2;
+    }
+
+    std::vector<uint8_t> oldControls(size, EMPTY);
+    std::vector<Entry> oldEntries(size);
+    oldControls.swap(controls);
+    oldEntries.swap(entries);
+
+    used = count;
+
+    for (size_t i = 0; i < oldControls.size(); i++) {
+      if ((oldControls[i] & EMPTY) == 0) {
+        const size_t j = probe(mix(boost::hash<Key>()(
+            KeyOf::key(oldEntries[i]))));
+        controls[j] = oldControls[i];
+        entries[j] = oldEntries[i];
+      }
+    }
+  }
+};
+
+
+template <typename Key, typename Value>
+struct KeyOfPair
+{
+  static Key& key(std::pair<Key, Value>& entry) { return entry.first; }
+
+  static const Key& key(const std::pair<Key, Value>& entry)
+  {
+    return entry.first;
+  }
+};
+
+} // namespace flat {
+
+
+// N.B. The entries are 'std::pair<Key, Value>' (rather than having a
+// const key) so that they can be moved around, but their keys must
+// not be changed.
+template <typename Key, typename Value>
+class flathashmap
+{
+  typedef flat::Table<Key, std::pair<Key, Value>, flat::KeyOfPair<Key, Value> >
+  Table;
+
+public:
+  typedef Key key_type;
+  typedef Value mapped_type;
+  typedef std::pair<Key, Value> value_type;
+  typedef size_t size_type;
+
+  typedef flat::Iterator<Table, value_type> iterator;
+  typedef flat::Iterator<const Table, const value_type> const_iterator;
+
+  size_type size() const { return table.count; }
+
+  bool empty() const { return table.count == 0; }
+
+  iterator begin() { return iterator(&table, 0); }
+  iterator end() { return iterator(&table, table.controls.size()); }
+
+  const_iterator begin() const { return const_iterator(&table, 0); }
+
+  const_iterator end() const
+  {
+    return const_iterator(&table, table.controls.size());
+  }
+
+  iterator find(const Key& key) { return iterator(&table, table.find(key)); }
+
+  const_iterator find(const Key& key) const
+  {
+    return const_iterator(&table, table.find(key));
+  }
+
+  size_type count(const Key& key) const
+  {
+    return table.find(key) != table.controls.size() ? 1 : 0;
+  }
+
+  // Checks whether this map contains a binding for a key.
+  bool contains(const Key& key) const { return count(key) > 0; }
+
+  Value& operator [] (const Key& key)
+  {
+    return table.entries[table.insert(key).first].second;
+  }
+
+  std::pair<iterator, bool> insert(const value_type& entry)
+  {
+    std::pair<size_t, bool> inserted = table.insert(entry.first);
+    if (inserted.second) {
+      table.entries[inserted.first].second = entry.second;
+    }
+    return std::make_pair(iterator(&table, inserted.first), inserted.second);
+  }
+
+  // Binds the key to the value (replacing any value bound already).
+  void put(const Key& key, const Value& value) { (*this)[key] = value; }
+
+  // Returns the value bound to the key, if any.
+  Option<Value> get(const Key& key) const
+  {
+    const size_t i = table.find(key);
+    if (i == table.controls.size()) {
+      return Option<Value>::none();
+    }
+    return Option<Value>::some(table.entries[i].second);
+  }
+
+  size_type erase(const Key& key)
+  {
+    const size_t i = table.find(key);
+    if (i == table.controls.size()) {
+      return 0;
+    }
+    table.erase(i);
+    return 1;
+  }
+
+  void erase(iterator it) { table.erase(it.index); }
+
+  void clear() { table.clear(); }
+
+  void reserve(size_type n) { table.reserve(n); }
+
+  void swap(flathashmap& that) { table.swap(that.table); }
+
+private:
+  Table table;
+};
+
+#endif // __FLATHASHMAP_HPP__
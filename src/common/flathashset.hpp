@@ -0,0 +1,108 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FLATHASHSET_HPP__
+#define __FLATHASHSET_HPP__
+
+#include <utility>
+
+#include "common/flathashmap.hpp"
+
+
+namespace flat {
+
+template <typename Elem>
+struct KeyOfElem
+{
+  static Elem& key(Elem& elem) { return elem; }
+  static const Elem& key(const Elem& elem) { return elem; }
+};
+
+} // namespace flat {
+
+
+// Provides a hash set like 'hashset' but keeping its elements in one
+// array (see flathashmap.hpp, including for when inserting and
+// erasing invalidate iterators).
+template <typename Elem>
+class flathashset
+{
+  typedef flat::Table<Elem, Elem, flat::KeyOfElem<Elem> > Table;
+
+public:
+  typedef Elem key_type;
+  typedef Elem value_type;
+  typedef size_t size_type;
+
+  // The elements can't be changed (it would change their hash).
+  typedef flat::Iterator<const Table, const Elem> iterator;
+  typedef flat::Iterator<const Table, const Elem> const_iterator;
+
+  size_type size() const { return table.count; }
+
+  bool empty() const { return table.count == 0; }
+
+  const_iterator begin() const { return const_iterator(&table, 0); }
+
+  const_iterator end() const
+  {
+    return const_iterator(&table, table.controls.size());
+  }
+
+  const_iterator find(const Elem& elem) const
+  {
+    return const_iterator(&table, table.find(elem));
+  }
+
+  size_type count(const Elem& elem) const
+  {
+    return table.find(elem) != table.controls.size() ? 1 : 0;
+  }
+
+  // Checks whether this set contains an element.
+  bool contains(const Elem& elem) const { return count(elem) > 0; }
+
+  std::pair<iterator, bool> insert(const Elem& elem)
+  {
+    std::pair<size_t, bool> inserted = table.insert(elem);
+    return std::make_pair(iterator(&table, inserted.first), inserted.second);
+  }
+
+  size_type erase(const Elem& elem)
+  {
+    const size_t i = table.find(elem);
+    if (i == table.controls.size()) {
+      return 0;
+    }
+    table.erase(i);
+    return 1;
+  }
+
+  void erase(const_iterator it) { table.erase(it.index); }
+
+  void clear() { table.clear(); }
+
+  void reserve(size_type n) { table.reserve(n); }
+
+  void swap(flathashset& that) { table.swap(that.table); }
+
+private:
+  Table table;
+};
+
+#endif // __FLATHASHSET_HPP__
@@ -0,0 +1,200 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FLATMULTIHASHMAP_HPP__
+#define __FLATMULTIHASHMAP_HPP__
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "common/flathashmap.hpp"
+
+
+// Provides a hash multimap like 'multihashmap', but keeping the values
+// of each key together (in place for up to 'N' of them, on the heap
+// beyond that) in a 'flathashmap' rather than a node per value. Hence
+// counting the values of a key, checking whether a key has a value
+// and getting the values of a key (by reference) don't need to walk a
+// chain of nodes or build a set of the values. It's meant for keys
+// with few values each (e.g., the ports of the slaves of a host).
+template <typename K, typename V, size_t N = 4>
+class flatmultihashmap
+{
+public:
+  // The values of a key (in the order they were put, except that
+  // removing a value moves the last value into its place).
+  class Values
+  {
+  public:
+    typedef V value_type;
+    typedef const V* iterator;
+    typedef const V* const_iterator;
+
+    Values() : count(0) {}
+
+    size_t size() const { return count; }
+
+    bool empty() const { return count == 0; }
+
+    const V* begin() const { return data(); }
+
+    const V* end() const { return data() + count; }
+
+    bool contains(const V& value) const
+    {
+      for (const V* v = begin(); v != end(); ++v) {
+        if (*v == value) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+  private:
+    friend class flatmultihashmap;
+
+    // Once the values don't all fit in place they all go on the heap
+    // (so they're always contiguous).
+    const V* data() const { return heap.empty() ? values : &heap[0]; }
+
+    V* data() { return heap.empty() ? values : &heap[0]; }
+
+    void add(const V& value)
+    {
+      if (!heap.empty()) {
+        heap.push_back(value);
+      } else if (count < N) {
+        values[count] = value;
+      } else {
+        heap.reserve(2 * N);
+        heap.assign(values, values + N);
+        heap.push_back(value);
+      }
+      count++;
+    }
+
+    bool remove(const V& value)
+    {
+      V* v = data();
+      for (size_t i = 0; i < count; i++) {
+        if (v[i] == value) {
+          v[i] = v[count - 1];
+          count--;
+          if (!heap.empty()) {
+            heap.pop_back();
+          }
+          return true;
+        }
+      }
+      return false;
+    }
+
+    V values[N];
+    std::vector<V> heap;
+    size_t count;
+  };
+
+  typedef typename flathashmap<K, Values>::const_iterator const_iterator;
+  typedef const_iterator iterator;
+
+  flatmultihashmap() : total(0) {}
+
+  // Adds a value for the key (even if the key already has it).
+  void put(const K& key, const V& value)
+  {
+    values[key].add(value);
+    total++;
+  }
+
+  // Returns the values of the key (or none). N.B. The reference is
+  // only good until the map gets changed.
+  const Values& get(const K& key) const
+  {
+    typename flathashmap<K, Values>::const_iterator it = values.find(key);
+    if (it == values.end()) {
+      return none;
+    }
+    return it->second;
+  }
+
+  // Removes all the values of the key.
+  bool remove(const K& key)
+  {
+    typename flathashmap<K, Values>::iterator it = values.find(key);
+    if (it == values.end()) {
+      return false;
+    }
+    total -= it->second.size();
+    values.erase(it);
+    return true;
+  }
+
+  // Removes a value of the key (if the key has it more than once, the
+  // others stay).
+  bool remove(const K& key, const V& value)
+  {
+    typename flathashmap<K, Values>::iterator it = values.find(key);
+    if (it == values.end() || !it->second.remove(value)) {
+      return false;
+    }
+    if (it->second.empty()) {
+      values.erase(it);
+    }
+    total--;
+    return true;
+  }
+
+  bool contains(const K& key) const { return values.contains(key); }
+
+  bool contains(const K& key, const V& value) const
+  {
+    return get(key).contains(value);
+  }
+
+  // Number of values of the key.
+  size_t count(const K& key) const { return get(key).size(); }
+
+  // Number of values (of all keys).
+  size_t size() const { return total; }
+
+  bool empty() const { return total == 0; }
+
+  // Iterates over the keys and their values.
+  const_iterator begin() const { return values.begin(); }
+  const_iterator end() const { return values.end(); }
+
+  void clear()
+  {
+    values.clear();
+    total = 0;
+  }
+
+private:
+  flathashmap<K, Values> values;
+  size_t total;
+
+  static const Values none;
+};
+
+
+template <typename K, typename V, size_t N>
+const typename flatmultihashmap<K, V, N>::Values
+flatmultihashmap<K, V, N>::none;
+
+#endif // __FLATMULTIHASHMAP_HPP__
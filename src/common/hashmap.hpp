@@ -39,6 +39,20 @@ public:
   // Checks whether this map contains a binding for a key.
   bool contains(const Key& key) const { return count(key) > 0; }
 
+  // Binds the key to the value (replacing any value bound already).
+  void put(const Key& key, const Value& value) { (*this)[key] = value; }
+
+  // Returns the value bound to the key, if any.
+  Option<Value> get(const Key& key) const
+  {
+    typename boost::unordered_map<Key, Value>::const_iterator it =
+      this->find(key);
+    if (it == this->end()) {
+      return Option<Value>::none();
+    }
+    return Option<Value>::some(it->second);
+  }
+
   // Checks whether there exists a bound value in this map.
   bool containsValue(const Value& v) const
   {
@@ -0,0 +1,186 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __INTERVALSET_HPP__
+#define __INTERVALSET_HPP__
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+
+
+// Provides a set of (integral) elements that stores runs of
+// consecutive elements as intervals, so that adding or removing a
+// range of elements, or storing a set like {0, 1, ..., 1000000},
+// takes a handful of map nodes rather than one per element. The
+// intervals are half-open (i.e., [begin, end)) and never overlap or
+// abut, and iterating a set yields them in order as pairs.
+template <typename T>
+class intervalset
+{
+public:
+  // The intervals can only be changed via the set.
+  typedef typename std::map<T, T>::const_iterator const_iterator;
+  typedef const_iterator iterator;
+
+  intervalset() : count(0) {}
+
+  // Adds (removes) the elements in [from, to).
+  void add(T from, T to);
+  void remove(const T& from, const T& to);
+
+  void add(const T& t) { add(t, t + 1); }
+  void remove(const T& t) { remove(t, t + 1); }
+
+  bool contains(const T& t) const;
+
+  void clear() { intervals.clear(); count = 0; }
+
+  bool empty() const { return intervals.empty(); }
+
+  // Returns the number of elements (not intervals) in the set.
+  size_t size() const { return count; }
+
+  const_iterator begin() const { return intervals.begin(); }
+  const_iterator end() const { return intervals.end(); }
+
+  bool operator == (const intervalset<T>& that) const
+  {
+    return intervals == that.intervals;
+  }
+
+  bool operator != (const intervalset<T>& that) const
+  {
+    return !(*this == that);
+  }
+
+private:
+  typedef typename std::map<T, T>::iterator map_iterator;
+
+  std::map<T, T> intervals; // Interval ends, by interval begin.
+  size_t count;
+};
+
+
+template <typename T>
+void intervalset<T>::add(T from, T to)
+{
+  if (!(from < to)) {
+    return;
+  }
+
+  // Merge in the interval before 'from' if it overlaps or abuts.
+  map_iterator i = intervals.upper_bound(from);
+
+  if (i != intervals.begin()) {
+    map_iterator previous = i;
+    --previous;
+    if (!(previous->second < from)) {
+      from = previous->first;
+      to = std::max(to, previous->second);
+      count -= previous->second - previous->first;
+      intervals.erase(previous);
+    }
+  }
+
+  // And any intervals after 'from' that overlap or abut.
+  while (i != intervals.end() && !(to < i->first)) {
+    to = std::max(to, i->second);
+    count -= i->second - i->first;
+    intervals.erase(i++);
+  }
+
+  intervals[from] = to;
+  count += to - from;
+}
+
+
+template <typename T>
+void intervalset<T>::remove(const T& from, const T& to)
+{
+  if (!(from < to)) {
+    return;
+  }
+
+  // Start with the interval containing 'from' (if there is one).
+  map_iterator i = intervals.upper_bound(from);
+
+  if (i != intervals.begin()) {
+    --i;
+    if (!(from < i->second)) {
+      ++i;
+    }
+  }
+
+  // Cut each overlapping interval, keeping whatever sticks out on
+  // either side of [from, to).
+  while (i != intervals.end() && i->first < to) {
+    const T begin = i->first;
+    const T end = i->second;
+
+    count -= end - begin;
+    intervals.erase(i++);
+
+    if (begin < from) {
+      intervals[begin] = from;
+      count += from - begin;
+    }
+
+    if (to < end) {
+      intervals[to] = end;
+      count += end - to;
+    }
+  }
+}
+
+
+template <typename T>
+bool intervalset<T>::contains(const T& t) const
+{
+  const_iterator i = intervals.upper_bound(t);
+
+  if (i == intervals.begin()) {
+    return false;
+  }
+
+  --i;
+
+  return t < i->second;
+}
+
+
+template <typename T>
+std::ostream& operator << (std::ostream& stream, const intervalset<T>& set)
+{
+  stream << "{";
+
+  for (typename intervalset<T>::const_iterator i = set.begin();
+       i != set.end();
+       ++i) {
+    if (i != set.begin()) {
+      stream << ", ";
+    }
+    stream << "[" << i->first << ", " << i->second << ")";
+  }
+
+  return stream << "}";
+}
+
+#endif // __INTERVALSET_HPP__
@@ -16,14 +16,21 @@
  * limitations under the License.
  */
 
+#ifndef __JSON_HPP__
+#define __JSON_HPP__
+
+#include <stdio.h>
+#include <stdlib.h>
+
 #include <iostream>
 #include <list>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <boost/variant.hpp>
 
-// TODO(jsirois): Implement parsing that constructs JSON objects.
+#include "common/try.hpp"
 
 
 namespace JSON {
@@ -179,4 +186,537 @@ inline void render(std::ostream& out, const Array& array)
   boost::apply_visitor(Renderer(out), value);
 }
 
+
+// Streaming alternative to building (and then rendering) a JSON
+// object, for when the object would be big: values get appended to
+// 'out' as they are written, so nothing gets copied. Unlike the
+// renderer above, strings get escaped. Callers are responsible for
+// the calls being balanced (and for writing a key before each value
+// of an object), e.g.:
+//
+//   std::string out;
+//   JSON::Writer writer(&out);
+//   writer.beginObject();
+//   writer.field("name", "foo");
+//   writer.key("tasks");
+//   writer.beginArray();
+//   writer.value(42);
+//   writer.endArray();
+//   writer.endObject();
+class Writer
+{
+public:
+  explicit Writer(std::string* _out) : out(_out), keyed(false) {}
+
+  void beginObject()
+  {
+    separate();
+    out->push_back('{');
+    first.push_back(true);
+  }
+
+  void endObject()
+  {
+    first.pop_back();
+    out->push_back('}');
+  }
+
+  void beginArray()
+  {
+    separate();
+    out->push_back('[');
+    first.push_back(true);
+  }
+
+  void endArray()
+  {
+    first.pop_back();
+    out->push_back(']');
+  }
+
+  void key(const std::string& name)
+  {
+    separate();
+    quote(name);
+    out->push_back(':');
+    keyed = true;
+  }
+
+  void value(const std::string& value)
+  {
+    separate();
+    quote(value);
+  }
+
+  void value(const char* value)
+  {
+    separate();
+    quote(value);
+  }
+
+  // Floating point numbers are rendered like the renderer above does
+  // (with 10 significant digits), integers in full (e.g., versions or
+  // byte counts). N.B. There's no overload for bool, which (like with
+  // JSON::Number) gets rendered as 0 or 1.
+  void value(double value)
+  {
+    separate();
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.10g", value);
+    out->append(buffer);
+  }
+
+  void value(int value) { integer(value); }
+  void value(long value) { integer(value); }
+  void value(long long value) { integer(value); }
+  void value(unsigned int value) { unsignedInteger(value); }
+  void value(unsigned long value) { unsignedInteger(value); }
+  void value(unsigned long long value) { unsignedInteger(value); }
+
+  void null()
+  {
+    separate();
+    out->append("null");
+  }
+
+  template <typename T>
+  void field(const std::string& name, const T& value)
+  {
+    key(name);
+    this->value(value);
+  }
+
+private:
+  // Writes a comma unless this is the first value in an object or
+  // array (or the value of a key).
+  void separate()
+  {
+    if (keyed) {
+      keyed = false;
+    } else if (!first.empty()) {
+      if (first.back()) {
+        first.back() = false;
+      } else {
+        out->push_back(',');
+      }
+    }
+  }
+
+  void integer(long long value)
+  {
+    separate();
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%lld", value);
+    out->append(buffer);
+  }
+
+  void unsignedInteger(unsigned long long value)
+  {
+    separate();
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%llu", value);
+    out->append(buffer);
+  }
+
+  // Writes a string (quoted and escaped).
+  void quote(const std::string& value)
+  {
+    out->push_back('"');
+    for (size_t i = 0; i < value.size(); i++) {
+      const char c = value[i];
+      switch (c) {
+        case '"': out->append("\\\""); break;
+        case '\\': out->append("\\\\"); break;
+        case '\n': out->append("\\n"); break;
+        case '\r': out->append("\\r"); break;
+        case '\t': out->append("\\t"); break;
+        default:
+          if ((unsigned char) c < 0x20) {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            out->append(buffer);
+          } else {
+            out->push_back(c);
+          }
+      }
+    }
+    out->push_back('"');
+  }
+
+  std::string* out;
+  std::vector<bool> first; // Per open object or array.
+  bool keyed; // Whether a key was just written.
+};
+
+
+// Implementation of parsing JSON text into the objects built above.
+// The text gets parsed in a single pass (by recursive descent) with
+// each value constructed in place in its object or array, so parsing
+// costs about as much as building the objects by hand.
+
+class Parser
+{
+public:
+  // Nesting (of objects and arrays) deeper than this is an error,
+  // rather than a stack overflow.
+  static const int MAX_DEPTH = 128;
+
+  explicit Parser(const std::string& text)
+    : begin(text.c_str()), p(begin), end(begin + text.size()), depth(0) {}
+
+  // Parses the text into the value, returning false (and setting the
+  // error) if it isn't a single valid JSON value.
+  bool parse(Value* value)
+  {
+    if (!parseValue(value)) {
+      return false;
+    }
+
+    skip();
+    if (p != end) {
+      return fail("Unexpected characters after the value");
+    }
+    return true;
+  }
+
+  const std::string& error() const { return message; }
+
+private:
+  bool fail(const std::string& error)
+  {
+    char offset[32];
+    snprintf(offset, sizeof(offset), " at offset %lu",
+             (unsigned long) (p - begin));
+    message = error + offset;
+    return false;
+  }
+
+  // Skips whitespace.
+  void skip()
+  {
+    while (p != end &&
+           (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+      ++p;
+    }
+  }
+
+  // Consumes the literal (e.g., "true") if it's next.
+  bool literal(const char* word)
+  {
+    const char* q = p;
+    for (; *word != '\0'; ++word, ++q) {
+      if (q == end || *q != *word) {
+        return false;
+      }
+    }
+    p = q;
+    return true;
+  }
+
+  bool parseValue(Value* value)
+  {
+    skip();
+
+    if (p == end) {
+      return fail("Unexpected end of text");
+    }
+
+    switch (*p) {
+      case '{': {
+        *value = Object();
+        return parseObject(boost::get<Object>(value));
+      }
+      case '[': {
+        *value = Array();
+        return parseArray(boost::get<Array>(value));
+      }
+      case '"': {
+        *value = String();
+        return parseString(&boost::get<String>(value)->value);
+      }
+      case 't': {
+        *value = True();
+        return literal("true") || fail("Expecting 'true'");
+      }
+      case 'f': {
+        *value = False();
+        return literal("false") || fail("Expecting 'false'");
+      }
+      case 'n': {
+        *value = Null();
+        return literal("null") || fail("Expecting 'null'");
+      }
+      default: {
+        *value = Number();
+        return parseNumber(&boost::get<Number>(value)->value);
+      }
+    }
+  }
+
+  bool parseObject(Object* object)
+  {
+    if (++depth > MAX_DEPTH) {
+      return fail("Nested too deeply");
+    }
+
+    ++p; // Skip '{'.
+
+    skip();
+    if (p != end && *p == '}') {
+      ++p;
+      --depth;
+      return true;
+    }
+
+    while (true) {
+      skip();
+      if (p == end || *p != '"') {
+        return fail("Expecting a key");
+      }
+
+      std::string key;
+      if (!parseString(&key)) {
+        return false;
+      }
+
+      skip();
+      if (p == end || *p != ':') {
+        return fail("Expecting ':'");
+      }
+      ++p;
+
+      // Later values of a key replace earlier ones.
+      if (!parseValue(&object->values[key])) {
+        return false;
+      }
+
+      skip();
+      if (p != end && *p == ',') {
+        ++p;
+      } else if (p != end && *p == '}') {
+        ++p;
+        --depth;
+        return true;
+      } else {
+        return fail("Expecting ',' or '}'");
+      }
+    }
+  }
+
+  bool parseArray(Array* array)
+  {
+    if (++depth > MAX_DEPTH) {
+      return fail("Nested too deeply");
+    }
+
+    ++p; // Skip '['.
+
+    skip();
+    if (p != end && *p == ']') {
+      ++p;
+      --depth;
+      return true;
+    }
+
+    while (true) {
+      array->values.push_back(Value());
+      if (!parseValue(&array->values.back())) {
+        return false;
+      }
+
+      skip();
+      if (p != end && *p == ',') {
+        ++p;
+      } else if (p != end && *p == ']') {
+        ++p;
+        --depth;
+        return true;
+      } else {
+        return fail("Expecting ',' or ']'");
+      }
+    }
+  }
+
+  // Parses a string, decoding escapes (including \u escapes, which
+  // get encoded as UTF-8).
+  bool parseString(std::string* value)
+  {
+    ++p; // Skip '"'.
+
+    while (true) {
+      // Copy everything up to the next quote or escape at once.
+      const char* q = p;
+      while (q != end && *q != '"' && *q != '\\') {
+        if ((unsigned char) *q < 0x20) {
+          p = q;
+          return fail("Unescaped control character in string");
+        }
+        ++q;
+      }
+      value->append(p, q - p);
+      p = q;
+
+      if (p == end) {
+        return fail("Unterminated string");
+      } else if (*p == '"') {
+        ++p;
+        return true;
+      }
+
+      // An escape.
+      if (++p == end) {
+        return fail("Unterminated string");
+      }
+
+      switch (*p++) {
+        case '"': value->push_back('"'); break;
+        case '\\': value->push_back('\\'); break;
+        case '/': value->push_back('/'); break;
+        case 'b': value->push_back('\b'); break;
+        case 'f': value->push_back('\f'); break;
+        case 'n': value->push_back('\n'); break;
+        case 'r': value->push_back('\r'); break;
+        case 't': value->push_back('\t'); break;
+        case 'u': {
+          unsigned long code;
+          if (!parseHex(&code)) {
+            return false;
+          }
+
+          // A surrogate pair encodes a code point past 0xFFFF.
+          if (code >= 0xD800 && code <= 0xDBFF) {
+            unsigned long low;
+            if (!literal("\\u") || !parseHex(&low) ||
+                low < 0xDC00 || low > 0xDFFF) {
+              return fail("Invalid surrogate pair");
+            }
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+          }
+
+          utf8(code, value);
+          break;
+        }
+        default:
+          --p;
+          return fail("Invalid escape");
+      }
+    }
+  }
+
+  // Parses the 4 hex digits of a \u escape.
+  bool parseHex(unsigned long* code)
+  {
+    *code = 0;
+    for (int i = 0; i < 4; i++, ++p) {
+      if (p == end) {
+        return fail("Unterminated string");
+      }
+
+      const char c = *p;
+      *code <<= 4;
+      if (c >= '0' && c <= '9') {
+        *code |= c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        *code |= c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+        *code |= c - 'A' + 10;
+      } else {
+        return fail("Invalid \\u escape");
+      }
+    }
+    return true;
+  }
+
+  static void utf8(unsigned long code, std::string* value)
+  {
+    if (code < 0x80) {
+      value->push_back((char) code);
+    } else if (code < 0x800) {
+      value->push_back((char) (0xC0 | (code >> 6)));
+      value->push_back((char) (0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+      value->push_back((char) (0xE0 | (code >> 12)));
+      value->push_back((char) (0x80 | ((code >> 6) & 0x3F)));
+      value->push_back((char) (0x80 | (code & 0x3F)));
+    } else {
+      value->push_back((char) (0xF0 | (code >> 18)));
+      value->push_back((char) (0x80 | ((code >> 12) & 0x3F)));
+      value->push_back((char) (0x80 | ((code >> 6) & 0x3F)));
+      value->push_back((char) (0x80 | (code & 0x3F)));
+    }
+  }
+
+  // Checks the number against the JSON grammar (which is stricter
+  // than strtod, e.g., no hex, leading '+' or "inf") before
+  // converting it.
+  bool parseNumber(double* value)
+  {
+    const char* q = p;
+
+    if (q != end && *q == '-') {
+      ++q;
+    }
+
+    if (q != end && *q == '0') {
+      ++q;
+    } else if (q != end && *q >= '1' && *q <= '9') {
+      while (q != end && *q >= '0' && *q <= '9') {
+        ++q;
+      }
+    } else {
+      return fail("Unexpected character");
+    }
+
+    if (q != end && *q == '.') {
+      ++q;
+      if (q == end || *q < '0' || *q > '9') {
+        return fail("Expecting digits after '.'");
+      }
+      while (q != end && *q >= '0' && *q <= '9') {
+        ++q;
+      }
+    }
+
+    if (q != end && (*q == 'e' || *q == 'E')) {
+      ++q;
+      if (q != end && (*q == '+' || *q == '-')) {
+        ++q;
+      }
+      if (q == end || *q < '0' || *q > '9') {
+        return fail("Expecting digits in exponent");
+      }
+      while (q != end && *q >= '0' && *q <= '9') {
+        ++q;
+      }
+    }
+
+    // N.B. The text is NUL terminated (it's a std::string), and the
+    // characters after the number end it for strtod too.
+    *value = strtod(p, NULL);
+    p = q;
+    return true;
+  }
+
+  const char* begin;
+  const char* p; // Next character to parse.
+  const char* end;
+  int depth; // Of the objects and arrays being parsed.
+  std::string message;
+};
+
+
+// Returns the value parsed from the JSON text, or an error if the
+// text isn't (exactly) one valid JSON value.
+inline Try<Value> parse(const std::string& text)
+{
+  Value value;
+  Parser parser(text);
+  if (!parser.parse(&value)) {
+    return Try<Value>::error(parser.error());
+  }
+  return Try<Value>::some(value);
+}
+
 } // namespace JSON {
+
+#endif // __JSON_HPP__
@@ -16,14 +16,25 @@
  * limitations under the License.
  */
 
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
 #include <sys/stat.h>
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include <glog/logging.h>
 
 #include "fatal.hpp"
 #include "logging.hpp"
+#include "thread.hpp"
+#include "utils.hpp"
 
 using std::string;
+using std::vector;
 
 // TODO(benh): Provide a mechanism to initialize the logging only
 // once, possibly using something like pthread_once. In particular, we
@@ -37,6 +48,163 @@ using std::string;
 namespace mesos {
 namespace internal {
 
+// Writes the messages for a log file (i.e., a severity) from a
+// background thread so that logging, which glog does while holding
+// a global mutex, doesn't wait on the disk. The messages get handed
+// over via a ring that needs no locks since glog only writes to a
+// logger from one thread at a time (holding its mutex) and only our
+// thread reads from it. Messages that need flushing (by default
+// warnings and worse) are waited on until written, so they're never
+// lost (e.g., a fatal message right before aborting), while the rest
+// get dropped (and counted) if the ring fills up.
+class AsyncLogger : public google::base::Logger
+{
+public:
+  explicit AsyncLogger(google::base::Logger* _logger)
+    : logger(_logger), entries(CAPACITY), head(0), tail(0), dropped(0)
+  {
+    thread::start(std::tr1::bind(&AsyncLogger::run, this), true);
+  }
+
+  // Loggers are never deleted (by glog), hence neither is our thread.
+  virtual ~AsyncLogger() {}
+
+  virtual void Write(bool flush,
+                     time_t timestamp,
+                     const char* message,
+                     int length)
+  {
+    while (head - tail >= CAPACITY) {
+      if (!flush) {
+        dropped++;
+        return;
+      }
+      usleep(100);
+    }
+
+    Entry& entry = entries[head % CAPACITY];
+    entry.flush = flush;
+    entry.timestamp = timestamp;
+    entry.message.assign(message, length);
+    entry.dropped = dropped;
+    dropped = 0;
+
+    __sync_synchronize(); // Publish the entry before moving the head.
+
+    const uint64_t written = ++head;
+
+    if (flush) {
+      while (tail < written) {
+        usleep(100);
+      }
+    }
+  }
+
+  virtual void Flush()
+  {
+    const uint64_t written = head;
+
+    while (tail < written) {
+      usleep(100);
+    }
+
+    logger->Flush();
+  }
+
+  virtual google::uint32 LogSize()
+  {
+    return logger->LogSize();
+  }
+
+private:
+  // Maximum number of messages waiting to be written.
+  static const uint64_t CAPACITY = 8192;
+
+  struct Entry
+  {
+    bool flush;
+    time_t timestamp;
+    string message;
+    uint64_t dropped; // Messages dropped right before this one.
+  };
+
+  void run()
+  {
+    useconds_t idle = 1000;
+
+    while (true) {
+      if (tail == head) {
+        // Back off (up to 50ms) while there's nothing to write.
+        usleep(idle);
+        idle = std::min<useconds_t>(idle * 2, 50000);
+        continue;
+      }
+
+      idle = 1000;
+
+      __sync_synchronize(); // See the entry published with the head.
+
+      const Entry& entry = entries[tail % CAPACITY];
+
+      if (entry.dropped > 0) {
+        const string& message = "Log buffer full, dropped " +
+          utils::stringify(entry.dropped) + " messages\n";
+        logger->Write(false, entry.timestamp, message.data(), message.size());
+      }
+
+      logger->Write(entry.flush,
+                    entry.timestamp,
+                    entry.message.data(),
+                    entry.message.size());
+
+      __sync_synchronize(); // Done with the entry before freeing it.
+
+      tail++;
+    }
+  }
+
+  google::base::Logger* logger;
+
+  vector<Entry> entries;
+  volatile uint64_t head; // Entries added (only moved by Write).
+  volatile uint64_t tail; // Entries written (only moved by run).
+  uint64_t dropped; // Since the last entry added.
+};
+
+
+int64_t LogRate::admit()
+{
+  const int64_t now = time(NULL);
+
+  // Racing threads logging from the same call site only make the
+  // counts approximate.
+  if (now != second) {
+    second = now;
+    count = 0;
+  }
+
+  if (count >= limit) {
+    __sync_fetch_and_add(&suppressed, 1);
+    return -1;
+  }
+
+  count++;
+
+  return __sync_lock_test_and_set(&suppressed, 0);
+}
+
+
+std::ostream& operator << (std::ostream& stream,
+                           const LogRate::Summary& summary)
+{
+  if (summary.suppressed > 0) {
+    stream << "(" << summary.suppressed << " similar messages suppressed) ";
+  }
+
+  return stream;
+}
+
+
 void Logging::registerOptions(Configurator* conf)
 {
   conf->addOption<bool>("quiet", 'q', "Disable logging to stderr", false);
@@ -45,6 +213,11 @@ void Logging::registerOptions(Configurator* conf)
   conf->addOption<int>("log_buf_secs",
                        "How many seconds to buffer log messages for\n",
                        0);
+  conf->addOption<bool>("log_async",
+                        "Write log files from a background thread, dropping\n"
+                        "messages (other than warnings and errors) if it\n"
+                        "falls too far behind",
+                        false);
 }
 
 
@@ -63,6 +236,14 @@ void Logging::init(const char* programName, const Configuration& conf)
 
   google::InitGoogleLogging(programName);
 
+  if (conf.get<bool>("log_async", false)) {
+    for (int severity = 0; severity < google::NUM_SEVERITIES; severity++) {
+      google::base::SetLogger(
+          severity,
+          new AsyncLogger(google::base::GetLogger(severity)));
+    }
+  }
+
   if (!isQuiet(conf)) {
     google::SetStderrLogging(google::INFO);
   }
@@ -19,8 +19,13 @@
 #ifndef __LOGGING_HPP__
 #define __LOGGING_HPP__
 
+#include <stdint.h>
+
+#include <iostream>
 #include <string>
 
+#include <glog/logging.h>
+
 #include "configurator/configurator.hpp"
 
 
@@ -38,7 +43,59 @@ public:
   static bool isQuiet(const Configuration& conf);
 };
 
+
+/**
+ * Limits the rate of the messages logged from a call site (see
+ * LOG_RATE_LIMITED), counting the ones it suppresses.
+ */
+class LogRate {
+public:
+  explicit LogRate(int _limit) : limit(_limit), second(0), count(0),
+                                 suppressed(0) {}
+
+  // Returns the number of messages suppressed since the last one that
+  // got logged if this one should be logged, or -1 otherwise.
+  int64_t admit();
+
+  // Prefixes a message with the number of messages suppressed before
+  // it, if any.
+  struct Summary
+  {
+    explicit Summary(int64_t _suppressed) : suppressed(_suppressed) {}
+    int64_t suppressed;
+  };
+
+private:
+  const int limit; // Messages per second.
+  volatile int64_t second; // Current second (since the epoch).
+  volatile int count; // Messages logged during the current second.
+  volatile int64_t suppressed; // Messages suppressed since the last one.
+};
+
+
+std::ostream& operator << (std::ostream& stream,
+                           const LogRate::Summary& summary);
+
 } // namespace internal {
 } // namespace mesos {
 
+
+// Logs at most 'n' messages per second from this call site, e.g., for
+// messages about each task or offer, which turn into a summary (the
+// next message logged says how many were suppressed) under load
+// rather than slowing down the process writing them. Like glog's
+// LOG_EVERY_N this expands into more than one statement.
+#define LOG_RATE_LIMITED(severity, n)                                   \
+  __LOG_RATE_LIMITED(severity, n, __LOG_RATE_NAME(LOG_RATE_, __LINE__))
+
+#define __LOG_RATE_LIMITED(severity, n, rate)                           \
+  static mesos::internal::LogRate rate(n);                              \
+  for (int64_t LOG_SUPPRESSED = rate.admit();                           \
+       LOG_SUPPRESSED >= 0;                                             \
+       LOG_SUPPRESSED = -1)                                             \
+    LOG(severity) << mesos::internal::LogRate::Summary(LOG_SUPPRESSED)
+
+#define __LOG_RATE_NAME(prefix, line) __LOG_RATE_CONCAT(prefix, line)
+#define __LOG_RATE_CONCAT(prefix, line) prefix ## line
+
 #endif
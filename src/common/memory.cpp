@@ -0,0 +1,211 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <malloc.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#if defined(HAS_TCMALLOC)
+#include <gperftools/malloc_extension.h>
+#elif defined(HAS_JEMALLOC)
+#include <jemalloc/jemalloc.h>
+#endif
+
+#include <process/metrics.hpp>
+
+#include "common/memory.hpp"
+
+using std::string;
+
+namespace mesos {
+namespace internal {
+namespace memory {
+
+enum Statistic
+{
+  ALLOCATED,
+  HEAP,
+  FREE,
+  FRAGMENTATION,
+  THREAD_CACHES
+};
+
+
+#if defined(HAS_TCMALLOC)
+
+const char* allocator()
+{
+  return "tcmalloc";
+}
+
+
+static double property(const char* name)
+{
+  size_t value = 0;
+  MallocExtension::instance()->GetNumericProperty(name, &value);
+  return value;
+}
+
+
+static double read(Statistic statistic)
+{
+  // The heap includes the pages released back to the OS.
+  const double heap = property("generic.heap_size") -
+    property("tcmalloc.pageheap_unmapped_bytes");
+  const double allocated = property("generic.current_allocated_bytes");
+
+  switch (statistic) {
+    case ALLOCATED: return allocated;
+    case HEAP: return heap;
+    case FREE: return heap - allocated;
+    case FRAGMENTATION: return heap > 0 ? (heap - allocated) / heap : 0;
+    case THREAD_CACHES:
+      return property("tcmalloc.current_total_thread_cache_bytes");
+  }
+  return 0;
+}
+
+#elif defined(HAS_JEMALLOC)
+
+const char* allocator()
+{
+  return "jemalloc";
+}
+
+
+static double property(const char* name)
+{
+  size_t value = 0;
+  size_t size = sizeof(value);
+  mallctl(name, &value, &size, NULL, 0);
+  return value;
+}
+
+
+static double read(Statistic statistic)
+{
+  // The statistics are only updated when the epoch gets advanced.
+  uint64_t epoch = 1;
+  size_t size = sizeof(epoch);
+  mallctl("epoch", &epoch, &size, &epoch, size);
+
+  const double heap = property("stats.resident");
+  const double allocated = property("stats.allocated");
+
+  switch (statistic) {
+    case ALLOCATED: return allocated;
+    case HEAP: return heap;
+    case FREE: return heap - allocated;
+    case FRAGMENTATION: return heap > 0 ? (heap - allocated) / heap : 0;
+    case THREAD_CACHES: return 0; // Not kept.
+  }
+  return 0;
+}
+
+#else
+
+const char* allocator()
+{
+  return "system";
+}
+
+
+static double read(Statistic statistic)
+{
+  // Memory mapped chunks count as both allocated and heap.
+  const struct mallinfo info = mallinfo();
+  const double heap = (unsigned) info.arena + (unsigned) info.hblkhd;
+  const double allocated = (unsigned) info.uordblks + (unsigned) info.hblkhd;
+
+  switch (statistic) {
+    case ALLOCATED: return allocated;
+    case HEAP: return heap;
+    case FREE: return (unsigned) info.fordblks;
+    case FRAGMENTATION: return heap > 0 ? info.fordblks / heap : 0;
+    case THREAD_CACHES: return 0; // Not kept.
+  }
+  return 0;
+}
+
+#endif
+
+
+// A statistic exported as a gauge.
+class MallocGauge : public process::metrics::Metric
+{
+public:
+  MallocGauge(const string& name, const string& help, Statistic _statistic)
+    : Metric(name, help, process::metrics::label("allocator", allocator())),
+      statistic(_statistic)
+  {
+    add();
+  }
+
+  virtual ~MallocGauge() { remove(); }
+
+protected:
+  virtual void collect(double* values) const
+  {
+    values[0] += read(statistic);
+  }
+
+  virtual string type() const { return "gauge"; }
+
+private:
+  const Statistic statistic;
+};
+
+
+void initialize()
+{
+  static volatile bool initialized = false;
+
+  if (!__sync_bool_compare_and_swap(&initialized, false, true)) {
+    return;
+  }
+
+  // Never deleted, the metrics are exported for as long as the OS
+  // process runs.
+  new MallocGauge("mesos_malloc_allocated_bytes",
+                  "Memory allocated by the application.",
+                  ALLOCATED);
+
+  new MallocGauge("mesos_malloc_heap_bytes",
+                  "Memory held by malloc, allocated or free.",
+                  HEAP);
+
+  new MallocGauge("mesos_malloc_free_bytes",
+                  "Memory held by malloc that is free (fragmentation).",
+                  FREE);
+
+  new MallocGauge("mesos_malloc_fragmentation_ratio",
+                  "Fraction of the memory held by malloc that is free.",
+                  FRAGMENTATION);
+
+#ifdef HAS_TCMALLOC
+  new MallocGauge("mesos_malloc_thread_cache_bytes",
+                  "Memory free in the per-thread caches.",
+                  THREAD_CACHES);
+#endif
+}
+
+} // namespace memory {
+} // namespace internal {
+} // namespace mesos {
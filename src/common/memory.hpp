@@ -0,0 +1,54 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __COMMON_MEMORY_HPP__
+#define __COMMON_MEMORY_HPP__
+
+namespace mesos {
+namespace internal {
+namespace memory {
+
+// Statistics of the malloc the OS process runs with: the system's
+// malloc, or tcmalloc or jemalloc when built --with-malloc (tcmalloc
+// also --with-gperftools). They get exported at /metrics as gauges
+// (read each time the metrics get exported), labeled with the
+// allocator:
+//
+//   mesos_malloc_allocated_bytes     in use by the application
+//   mesos_malloc_heap_bytes          held by malloc (used or free)
+//   mesos_malloc_free_bytes          held by malloc but free, i.e.,
+//                                    fragmentation and caches
+//   mesos_malloc_fragmentation_ratio free / heap
+//   mesos_malloc_thread_cache_bytes  free in per-thread caches
+//                                    (tcmalloc only)
+//
+// N.B. The system's (glibc) statistics are 32 bit and wrap around
+// past 4 GB.
+
+// Returns the name of the malloc ("system", "tcmalloc" or "jemalloc").
+const char* allocator();
+
+
+// Exports the statistics (only the first call does anything).
+void initialize();
+
+} // namespace memory {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __COMMON_MEMORY_HPP__
@@ -0,0 +1,81 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __POOL_HPP__
+#define __POOL_HPP__
+
+#include <vector>
+
+#include "common/foreach.hpp"
+
+
+// Keeps (up to 'max') objects that are no longer used so that they
+// can be reused rather than deleted and allocated again, which keeps
+// objects that come and go at a high rate (e.g., offers) from
+// fragmenting the heap. Objects get reset via 'Clear' (i.e., this is
+// meant for protocol buffers), which keeps the memory they allocated
+// for strings and repeated fields around for reuse too.
+template <typename T>
+class Pool
+{
+public:
+  Pool(size_t _max) : max(_max) {}
+
+  ~Pool()
+  {
+    foreach (T* t, objects) {
+      delete t;
+    }
+  }
+
+  // Returns an unused (cleared) object.
+  T* get()
+  {
+    if (objects.empty()) {
+      return new T();
+    }
+
+    T* t = objects.back();
+    objects.pop_back();
+    return t;
+  }
+
+  // Returns an object (that was allocated via 'get' or 'new') to the
+  // pool once it's no longer used.
+  void put(T* t)
+  {
+    if (objects.size() < max) {
+      t->Clear();
+      objects.push_back(t);
+    } else {
+      delete t;
+    }
+  }
+
+  size_t size() const { return objects.size(); }
+
+private:
+  // Not copyable (the pool owns its objects).
+  Pool(const Pool<T>&);
+  Pool<T>& operator = (const Pool<T>&);
+
+  const size_t max;
+  std::vector<T*> objects;
+};
+
+#endif // __POOL_HPP__
@@ -19,10 +19,22 @@
 #ifndef __PROCESS_UTILS_HPP__
 #define __PROCESS_UTILS_HPP__
 
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <sys/types.h>
+
+#include <fstream>
 #include <iostream>
+#include <set>
 #include <sstream>
+#include <string>
+#include <vector>
 
+#include "common/foreach.hpp"
 #include "common/strings.hpp"
+#include "common/try.hpp"
 #include "common/utils.hpp"
 
 namespace mesos {
@@ -30,12 +42,127 @@ namespace internal {
 namespace utils {
 namespace process {
 
-inline Try<int> killtree(
-    pid_t pid,
+#ifdef __linux__
+// A process as listed in /proc.
+struct ProcessEntry
+{
+  pid_t pid;
+  pid_t parent;
+  pid_t group;
+  pid_t session;
+};
+
+
+// Returns all the processes currently running (any of which might be
+// gone by the time the caller looks at them).
+inline std::vector<ProcessEntry> processes()
+{
+  std::vector<ProcessEntry> result;
+
+  foreach (const std::string& entry, utils::os::listdir("/proc")) {
+    pid_t pid = atoi(entry.c_str());
+    if (pid <= 0) {
+      continue; // Not a process.
+    }
+
+    std::ifstream file(("/proc/" + entry + "/stat").c_str());
+    std::string line;
+    if (!std::getline(file, line)) {
+      continue; // Exited in the meantime.
+    }
+
+    // The command name (in parentheses) might contain spaces (or
+    // parentheses), so the fields after it are found from the end.
+    size_t end = line.rfind(')');
+    if (end == std::string::npos) {
+      continue;
+    }
+
+    std::istringstream in(line.substr(end + 1));
+
+    ProcessEntry process;
+    process.pid = pid;
+
+    char state;
+    if (in >> state >> process.parent >> process.group >> process.session) {
+      result.push_back(process);
+    }
+  }
+
+  return result;
+}
+#endif // __linux__
+
+
+// Sends a signal to the process trees rooted at the specified pids,
+// and (optionally) to all the processes in the process groups or
+// sessions of any process in the trees. Every process gets stopped as
+// soon as it's found, so that nothing can fork (or get its children
+// re-parented to init) while the trees get walked, and continued once
+// the signal has been sent. Returns the number of processes signaled.
+inline Try<int> killtrees(
+    const std::vector<pid_t>& pids,
     int signal,
     bool killgroups,
     bool killsess)
 {
+#ifdef __linux__
+  std::set<pid_t> tree;
+
+  foreach (pid_t pid, pids) {
+    if (::kill(pid, SIGSTOP) == 0) {
+      tree.insert(pid);
+    }
+  }
+
+  // Never signal our own process group or session.
+  const pid_t group = getpgrp();
+  const pid_t session = getsid(0);
+
+  // Walk the processes until no new ones turn up, since the processes
+  // that got found might have forked before they got stopped.
+  bool found = !tree.empty();
+  while (found) {
+    found = false;
+
+    const std::vector<ProcessEntry>& entries = processes();
+
+    std::set<pid_t> groups;
+    std::set<pid_t> sessions;
+    foreach (const ProcessEntry& entry, entries) {
+      if (tree.count(entry.pid) > 0) {
+        if (killgroups && entry.group != group) {
+          groups.insert(entry.group);
+        }
+        if (killsess && entry.session != session) {
+          sessions.insert(entry.session);
+        }
+      }
+    }
+
+    foreach (const ProcessEntry& entry, entries) {
+      if (tree.count(entry.pid) == 0 &&
+          (tree.count(entry.parent) > 0 ||
+           groups.count(entry.group) > 0 ||
+           sessions.count(entry.session) > 0)) {
+        if (::kill(entry.pid, SIGSTOP) == 0) {
+          tree.insert(entry.pid);
+          found = true;
+        }
+      }
+    }
+  }
+
+  foreach (pid_t pid, tree) {
+    ::kill(pid, signal);
+  }
+
+  foreach (pid_t pid, tree) {
+    ::kill(pid, SIGCONT);
+  }
+
+  return (int) tree.size();
+#else
   std::string cmdline;
 
   // TODO(Charles Reiss): Use a configuration option.
@@ -50,16 +177,37 @@ inline Try<int> killtree(
     cmdline = MESOS_LIBEXECDIR "/killtree.sh";
   }
 
-  // Add the arguments.
-  Try<std::string> args = strings::format(" -p %d -s %d", pid, signal);
-  CHECK(!args.isError()) << args.error();
-  cmdline += args.get();
-
   // Also add flags to kill all encountered groups and sessions.
-  if (killgroups) cmdline += " -g";
-  if (killsess) cmdline += " -x";
+  std::string flags;
+  if (killgroups) flags += " -g";
+  if (killsess) flags += " -x";
+
+  int status = 0;
+  foreach (pid_t pid, pids) {
+    // Add the arguments.
+    Try<std::string> args = strings::format(" -p %d -s %d", pid, signal);
+    CHECK(!args.isError()) << args.error();
 
-  return utils::os::shell(NULL, cmdline);
+    Try<int> result = utils::os::shell(NULL, cmdline + args.get() + flags);
+    if (result.isError()) {
+      return result;
+    } else if (result.get() != 0) {
+      status = result.get();
+    }
+  }
+
+  return status;
+#endif // __linux__
+}
+
+
+inline Try<int> killtree(
+    pid_t pid,
+    int signal,
+    bool killgroups,
+    bool killsess)
+{
+  return killtrees(std::vector<pid_t>(1, pid), signal, killgroups, killsess);
 }
 
 } // namespace mesos {
@@ -0,0 +1,140 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <string>
+
+#ifdef HAS_GPERFTOOLS
+#include <gperftools/malloc_extension.h>
+#include <gperftools/profiler.h>
+#endif
+
+#include <glog/logging.h>
+
+#include "common/profiler.hpp"
+#include "common/utils.hpp"
+
+using process::Future;
+using process::HttpBadRequestResponse;
+using process::HttpInternalServerErrorResponse;
+using process::HttpOKResponse;
+using process::HttpRequest;
+using process::HttpResponse;
+using process::HttpServiceUnavailableResponse;
+
+using std::string;
+
+namespace mesos {
+namespace internal {
+namespace profiler {
+
+// Returns a plain text response.
+template <typename Response>
+static HttpResponse text(const string& body)
+{
+  Response response;
+  response.headers["Content-Type"] = "text/plain";
+  response.headers["Content-Length"] = utils::stringify(body.size());
+  response.body = body;
+  return response;
+}
+
+
+#ifdef HAS_GPERFTOOLS
+
+// Whether or not the CPU is being sampled (only changed atomically,
+// since both a master and a slave might share the OS process).
+static volatile bool running = false;
+
+
+// The file the CPU profile gets written to.
+static string path()
+{
+  return "/tmp/mesos-profile." + utils::stringify(getpid());
+}
+
+
+Future<HttpResponse> start(const HttpRequest& request)
+{
+  if (!__sync_bool_compare_and_swap(&running, false, true)) {
+    return text<HttpBadRequestResponse>("Already profiling\n");
+  }
+
+  if (ProfilerStart(path().c_str()) == 0) {
+    running = false;
+    return text<HttpInternalServerErrorResponse>(
+        "Failed to start profiling into " + path() + "\n");
+  }
+
+  LOG(INFO) << "Started CPU profiling into " << path();
+
+  return text<HttpOKResponse>("Profiling\n");
+}
+
+
+Future<HttpResponse> stop(const HttpRequest& request)
+{
+  if (!__sync_bool_compare_and_swap(&running, true, false)) {
+    return text<HttpBadRequestResponse>("Not profiling\n");
+  }
+
+  ProfilerStop();
+
+  LOG(INFO) << "Stopped CPU profiling into " << path();
+
+  // Send the profile straight from the file.
+  HttpOKResponse response;
+  response.headers["Content-Type"] = "application/octet-stream";
+  response.path = path();
+  return response;
+}
+
+
+Future<HttpResponse> heap(const HttpRequest& request)
+{
+  string profile;
+  MallocExtension::instance()->GetHeapSample(&profile);
+  return text<HttpOKResponse>(profile);
+}
+
+#else // HAS_GPERFTOOLS
+
+Future<HttpResponse> start(const HttpRequest& request)
+{
+  return text<HttpServiceUnavailableResponse>(
+      "Not built with gperftools (see --with-gperftools)\n");
+}
+
+
+Future<HttpResponse> stop(const HttpRequest& request)
+{
+  return start(request);
+}
+
+
+Future<HttpResponse> heap(const HttpRequest& request)
+{
+  return start(request);
+}
+
+#endif // HAS_GPERFTOOLS
+
+} // namespace profiler {
+} // namespace internal {
+} // namespace mesos {
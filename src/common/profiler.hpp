@@ -0,0 +1,56 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __COMMON_PROFILER_HPP__
+#define __COMMON_PROFILER_HPP__
+
+#include <process/future.hpp>
+#include <process/http.hpp>
+
+namespace mesos {
+namespace internal {
+namespace profiler {
+
+// HTTP endpoints for profiling a running master or slave in place
+// (routed as /profiler/start, /profiler/stop and /heap/snapshot),
+// backed by gperftools when built --with-gperftools (otherwise they
+// return "503 Service Unavailable"). Both return pprof's formats,
+// e.g., 'pprof mesos-master profile'. Note that there is only one
+// CPU profiler per OS process (e.g., in mesos-local).
+
+// Starts sampling the CPU (unless already sampling).
+process::Future<process::HttpResponse> start(
+    const process::HttpRequest& request);
+
+
+// Stops sampling the CPU and returns the CPU profile.
+process::Future<process::HttpResponse> stop(
+    const process::HttpRequest& request);
+
+
+// Returns a (sampled) heap profile, i.e., where the memory still in
+// use got allocated. Note that tcmalloc only samples allocations when
+// TCMALLOC_SAMPLE_PARAMETER is set (e.g., to 524288) at startup.
+process::Future<process::HttpResponse> heap(
+    const process::HttpRequest& request);
+
+} // namespace profiler {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __COMMON_PROFILER_HPP__
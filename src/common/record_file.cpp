@@ -0,0 +1,313 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <glog/logging.h>
+
+#include "common/record_file.hpp"
+#include "common/utils.hpp"
+
+using std::string;
+
+
+namespace mesos {
+namespace internal {
+
+// Each record starts with the length and the CRC of the message.
+static const size_t HEADER_SIZE = 2 * sizeof(uint32_t);
+
+// Records get buffered until there's this many bytes of them (bigger
+// records get written out on their own).
+static const size_t BUFFER_SIZE = 1024 * 1024;
+
+
+// Table for computing the CRC32C (Castagnoli) a byte at a time.
+struct CRC32CTable
+{
+  CRC32CTable()
+  {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i;
+      for (int j = 0; j < 8; j++) {
+        crc = (crc >> 1) ^ (0x82f63b78 & (0 - (crc & 1)));
+      }
+      entries[i] = crc;
+    }
+  }
+
+  uint32_t entries[256];
+};
+
+static const CRC32CTable table;
+
+
+uint32_t crc32c(const char* data, size_t size)
+{
+  uint32_t crc = 0xffffffff;
+
+  const uint8_t* bytes = (const uint8_t*) data;
+  for (size_t i = 0; i < size; i++) {
+    crc = table.entries[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+  }
+
+  return crc ^ 0xffffffff;
+}
+
+
+// Serializes the record for the message into 'record', which needs
+// room for HEADER_SIZE + 'length' (the message's ByteSize) bytes.
+static void encode(const google::protobuf::Message& message,
+                   uint32_t length,
+                   char* record)
+{
+  uint8_t* begin = (uint8_t*) record + HEADER_SIZE;
+  uint8_t* end = message.SerializeWithCachedSizesToArray(begin);
+  CHECK(end == begin + length);
+
+  const uint32_t crc = crc32c((const char*) begin, length);
+
+  memcpy(record, &length, sizeof(length));
+  memcpy(record + sizeof(length), &crc, sizeof(crc));
+}
+
+
+Try<RecordWriter*> RecordWriter::open(const string& path,
+                                      bool append,
+                                      bool sync)
+{
+  Result<int> fd = utils::os::open(
+      path,
+      O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC),
+      S_IRUSR | S_IWUSR | S_IRGRP | S_IRWXO);
+
+  if (fd.isError()) {
+    return Try<RecordWriter*>::error(
+        "Failed to open " + path + ": " + fd.error());
+  }
+
+  return new RecordWriter(fd.get(), sync);
+}
+
+
+RecordWriter::RecordWriter(int _fd, bool _sync)
+  : fd(_fd),
+    sync(_sync),
+    buffer(new char[BUFFER_SIZE]),
+    used(0),
+    records(0) {}
+
+
+RecordWriter::~RecordWriter()
+{
+  Try<void> flushed = flush();
+  if (flushed.isError()) {
+    LOG(ERROR) << "Failed to write out records: " << flushed.error();
+  }
+
+  utils::os::close(fd);
+
+  delete[] buffer;
+}
+
+
+Try<void> RecordWriter::write(const google::protobuf::Message& message)
+{
+  if (!message.IsInitialized()) {
+    return Try<void>::error("Message is not initialized");
+  }
+
+  // NOTE: This also caches the sizes that encode serializes with.
+  const uint32_t length = message.ByteSize();
+  const size_t size = HEADER_SIZE + length;
+
+  if (size > BUFFER_SIZE - used) {
+    Try<void> flushed = flush();
+    if (flushed.isError()) {
+      return flushed;
+    }
+  }
+
+  records++;
+
+  if (size > BUFFER_SIZE) {
+    // Too big to buffer, write it out on its own.
+    char* record = new char[size];
+    encode(message, length, record);
+    Try<void> written = write(record, size);
+    delete[] record;
+
+    if (written.isError() || !sync) {
+      return written;
+    }
+
+    return flush();
+  }
+
+  encode(message, length, buffer + used);
+  used += size;
+
+  return Try<void>::some();
+}
+
+
+Try<void> RecordWriter::flush()
+{
+  if (used > 0) {
+    Try<void> written = write(buffer, used);
+    used = 0;
+
+    if (written.isError()) {
+      return written;
+    }
+  }
+
+  if (sync && ::fsync(fd) != 0) {
+    return Try<void>::error(string("Failed to sync: ") + strerror(errno));
+  }
+
+  return Try<void>::some();
+}
+
+
+Try<void> RecordWriter::write(const char* data, size_t size)
+{
+  while (size > 0) {
+    ssize_t length = ::write(fd, data, size);
+
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return Try<void>::error(string("Failed to write: ") + strerror(errno));
+    }
+
+    data += length;
+    size -= length;
+  }
+
+  return Try<void>::some();
+}
+
+
+Try<RecordReader*> RecordReader::open(const string& path)
+{
+  Result<int> fd = utils::os::open(path, O_RDONLY);
+
+  if (fd.isError()) {
+    return Try<RecordReader*>::error(
+        "Failed to open " + path + ": " + fd.error());
+  }
+
+  struct stat s;
+  if (::fstat(fd.get(), &s) != 0) {
+    const string error = strerror(errno);
+    utils::os::close(fd.get());
+    return Try<RecordReader*>::error("Failed to stat " + path + ": " + error);
+  }
+
+  // Nothing to map for an empty file (mmap fails on a zero length).
+  if (s.st_size == 0) {
+    return new RecordReader(fd.get(), NULL, 0);
+  }
+
+  void* data = ::mmap(NULL, s.st_size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+
+  if (data == MAP_FAILED) {
+    const string error = strerror(errno);
+    utils::os::close(fd.get());
+    return Try<RecordReader*>::error("Failed to map " + path + ": " + error);
+  }
+
+  // The records get read in order, so let the kernel read ahead.
+  ::madvise(data, s.st_size, MADV_SEQUENTIAL);
+
+  return new RecordReader(fd.get(), (const char*) data, s.st_size);
+}
+
+
+RecordReader::RecordReader(int _fd, const char* _data, size_t _size)
+  : fd(_fd),
+    data(_data),
+    size(_size),
+    offset(0) {}
+
+
+RecordReader::~RecordReader()
+{
+  if (data != NULL) {
+    ::munmap((void*) data, size);
+  }
+
+  utils::os::close(fd);
+}
+
+
+Result<bool> RecordReader::read(google::protobuf::Message* message)
+{
+  CHECK(message != NULL);
+
+  if (offset == size) {
+    return Result<bool>::none();
+  }
+
+  uint32_t length;
+  uint32_t crc;
+
+  if (size - offset < HEADER_SIZE) {
+    LOG(WARNING) << "Ignoring the partially written record at offset "
+                 << offset;
+    offset = size;
+    return Result<bool>::none();
+  }
+
+  memcpy(&length, data + offset, sizeof(length));
+  memcpy(&crc, data + offset + sizeof(length), sizeof(crc));
+
+  if (length > size - offset - HEADER_SIZE) {
+    LOG(WARNING) << "Ignoring the partially written record at offset "
+                 << offset;
+    offset = size;
+    return Result<bool>::none();
+  }
+
+  const char* record = data + offset + HEADER_SIZE;
+
+  if (crc32c(record, length) != crc) {
+    return Result<bool>::error(
+        "Corrupted record at offset " + utils::stringify(offset));
+  }
+
+  if (!message->ParseFromArray(record, length)) {
+    return Result<bool>::error(
+        "Failed to parse the record at offset " + utils::stringify(offset));
+  }
+
+  offset += HEADER_SIZE + length;
+
+  return true;
+}
+
+} // namespace internal {
+} // namespace mesos {
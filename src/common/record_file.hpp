@@ -0,0 +1,115 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RECORD_FILE_HPP__
+#define __RECORD_FILE_HPP__
+
+#include <stdint.h>
+
+#include <string>
+
+#include <google/protobuf/message.h>
+
+#include "common/result.hpp"
+#include "common/try.hpp"
+
+
+namespace mesos {
+namespace internal {
+
+// Files of protobuf records, for checkpointing (and replaying) lots
+// of state. Like utils::protobuf::write, each record is the length of
+// the message followed by the message, but with a CRC of the message
+// in between (both 32 bits, in host byte order) so that corruption
+// gets detected. Unlike utils::protobuf::read/write, records get
+// written out in batches and read straight out of memory rather than
+// with a few system calls per record.
+
+// Appends records to a file, buffering them until the buffer is full
+// or they get flushed.
+class RecordWriter
+{
+public:
+  // Opens the file (creating it if need be and truncating it unless
+  // 'append'). If 'sync' each batch of records is synced to disk when
+  // it gets written out, so callers can group their syncs by
+  // flushing after a group of records.
+  static Try<RecordWriter*> open(const std::string& path,
+                                 bool append = false,
+                                 bool sync = false);
+
+  // Flushes the records still buffered and closes the file.
+  ~RecordWriter();
+
+  Try<void> write(const google::protobuf::Message& message);
+
+  // Writes out (and syncs if asked to) the records buffered so far.
+  Try<void> flush();
+
+  // Number of records written (or buffered) so far.
+  uint64_t count() const { return records; }
+
+private:
+  RecordWriter(int fd, bool sync);
+
+  // Writes out the data in as few calls to ::write as possible.
+  Try<void> write(const char* data, size_t size);
+
+  const int fd;
+  const bool sync;
+
+  char* buffer;
+  size_t used;
+
+  uint64_t records;
+};
+
+
+// Reads the records of a file in order, by mapping the file into
+// memory and parsing each message straight out of it.
+class RecordReader
+{
+public:
+  static Try<RecordReader*> open(const std::string& path);
+
+  ~RecordReader();
+
+  // Parses the next record into 'message', returning none at the end
+  // of the file (including when the last record was only partially
+  // written, e.g., because the writer crashed) and an error if the
+  // record is corrupted or doesn't parse.
+  Result<bool> read(google::protobuf::Message* message);
+
+private:
+  RecordReader(int fd, const char* data, size_t size);
+
+  const int fd;
+  const char* data;
+  const size_t size;
+
+  size_t offset; // Of the next record.
+};
+
+
+// Returns the CRC32C of the data (as used by RecordWriter).
+uint32_t crc32c(const char* data, size_t size);
+
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __RECORD_FILE_HPP__
@@ -16,7 +16,9 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <iostream>
+#include <utility>
 #include <vector>
 
 #include <glog/logging.h>
@@ -28,7 +30,10 @@
 #include "common/values.hpp"
 
 
+using std::max;
 using std::ostream;
+using std::pair;
+using std::sort;
 using std::string;
 using std::vector;
 
@@ -77,208 +82,208 @@ Value::Scalar& operator -= (Value::Scalar& left, const Value::Scalar& right)
 }
 
 
-static void coalesce(Value::Ranges* ranges, const Value::Range& range)
-{
-  // Note that we assume that ranges has already been coalesced.
-
-  bool coalesced = false;
-
-  for (int i = 0; i < ranges->range_size(); i++) {
-    int64_t begin = ranges->range(i).begin();
-    int64_t end = ranges->range(i).end();
-
-    if (begin <= range.begin() && range.end() <= end) {
-      // Ignore range since it is subsumed by a range in ranges.
-      coalesced = true;
-      break;
-    } else if (begin <= range.begin() && end < range.end()) {
-      // Grow the end of the range in ranges.
-      ranges->mutable_range(i)->set_end(range.end());
-      coalesced = true;
-      break;
-    } else if (range.begin() < begin && range.end() <= end) {
-      // Grow the beginning of the range in ranges.
-      ranges->mutable_range(i)->set_begin(range.begin());
-      coalesced = true;
-      break;
-    } else if (range.begin() < begin && end < range.end()) {
-      // Replace (grow both the beginning and the end) of the range in ranges.
-      ranges->mutable_range(i)->set_begin(range.begin());
-      ranges->mutable_range(i)->set_end(range.end());
-      coalesced = true;
-      break;
-    }
-  }
+// A range [first, second] of a Value::Ranges. The operators below
+// work on ranges that have been sorted and coalesced (i.e., merged
+// when they overlap or are adjacent), so that unions, differences and
+// containment only need a single (linear) pass over both operands.
+typedef pair<uint64_t, uint64_t> Interval;
+
+
+// Returns true if the (later beginning) interval 'that' overlaps or
+// is adjacent to 'interval', i.e., they can be coalesced.
+static bool touches(const Interval& interval, const Interval& that)
+{
+  return that.first == 0 || that.first - 1 <= interval.second;
+}
 
-  if (!coalesced) {
-    ranges->add_range()->MergeFrom(range);
+
+// Appends an interval to sorted and coalesced intervals, coalescing
+// it with the last one if possible. The interval must not begin
+// before the last one.
+static void append(vector<Interval>* intervals, const Interval& interval)
+{
+  if (!intervals->empty() && touches(intervals->back(), interval)) {
+    intervals->back().second = max(intervals->back().second, interval.second);
+  } else {
+    intervals->push_back(interval);
   }
 }
 
 
-static void remove(Value::Ranges* ranges, const Value::Range& range)
+// Returns the ranges as sorted and coalesced intervals. Ranges that
+// were produced by the operators below already are, in which case
+// this is linear; otherwise they get sorted first.
+static vector<Interval> intervals(const Value::Ranges& ranges)
 {
-  // Note that we assume that ranges has already been coalesced.
+  vector<Interval> unsorted;
+  unsorted.reserve(ranges.range_size());
 
-  Value::Ranges result;
+  bool sorted = true;
 
-  for (int i = 0; i < ranges->range_size(); i++) {
-    int64_t begin = ranges->range(i).begin();
-    int64_t end = ranges->range(i).end();
+  for (int i = 0; i < ranges.range_size(); i++) {
+    const Value::Range& range = ranges.range(i);
 
-    if (begin == range.begin() && range.end() == end) {
-      // Remove range from ranges, but keep everything else.
-      for (int j = i + 1; j < ranges->range_size(); j++) {
-        result.add_range()->MergeFrom(ranges->range(j));
+    // Ignore inverted (i.e., empty) ranges.
+    if (range.begin() <= range.end()) {
+      Interval interval(range.begin(), range.end());
+      if (!unsorted.empty() && interval < unsorted.back()) {
+        sorted = false;
       }
-      break;
-    } else if (begin <= range.begin() && range.end() < end) {
-      // Shrink range in ranges.
-      Value::Range* temp = result.add_range();
-      temp->set_begin(range.end() + 1);
-      temp->set_end(end);
-      break;
-    } else if (begin < range.begin() && range.end() >= end) {
-      // Shrink end of range in ranges.
-      Value::Range* temp = result.add_range();
-      temp->set_begin(begin);
-      temp->set_end(range.begin() - 1);
-      break;
-    } else if (begin < range.begin() && range.end() < end) {
-      // Split range in ranges.
-      Value::Range* temp = result.add_range();
-      temp->set_begin(begin);
-      temp->set_end(range.begin() - 1);
-      temp = result.add_range();
-      temp->set_begin(range.end() + 1);
-      temp->set_end(end);
-      break;
+      unsorted.push_back(interval);
     }
   }
 
-  *ranges = result;
-}
-
-
-bool operator == (const Value::Ranges& left, const Value::Ranges& right)
-{
-  if (left.range_size() == right.range_size()) {
-    for (int i = 0; i < left.range_size(); i++) {
-      // Make sure this range is equal to a range in the right.
-      bool found = false;
-      for (int j = 0; j < right.range_size(); j++) {
-        if (left.range(i).begin() == right.range(j).begin() &&
-            left.range(i).end() == right.range(j).end()) {
-          found = true;
-          break;
-        }
-      }
+  if (!sorted) {
+    sort(unsorted.begin(), unsorted.end());
+  }
 
-      if (!found) {
-        return false;
-      }
-    }
+  vector<Interval> result;
+  result.reserve(unsorted.size());
 
-    return true;
+  foreach (const Interval& interval, unsorted) {
+    append(&result, interval);
   }
 
-  return false;
+  return result;
 }
 
 
-bool operator <= (const Value::Ranges& left, const Value::Ranges& right)
+static void assign(Value::Ranges* ranges, const vector<Interval>& intervals)
 {
-   for (int i = 0; i < left.range_size(); i++) {
-      // Make sure this range is a subset of a range in right.
-      bool matched = false;
-      for (int j = 0; j < right.range_size(); j++) {
-        if ((left.range(i).begin() >= right.range(j).begin() &&
-             left.range(i).end() <= right.range(j).end())) {
-          matched = true;
-          break;
-        }
-      }
-      if (!matched) {
-        return false;
-      }
-    }
+  ranges->Clear();
+  ranges->mutable_range()->Reserve(intervals.size());
 
-    return true;
+  foreach (const Interval& interval, intervals) {
+    Value::Range* range = ranges->add_range();
+    range->set_begin(interval.first);
+    range->set_end(interval.second);
+  }
 }
 
 
-Value::Ranges operator + (const Value::Ranges& left, const Value::Ranges& right)
+// Returns the union of sorted and coalesced intervals.
+static vector<Interval> unite(const vector<Interval>& left,
+                              const vector<Interval>& right)
 {
-  Value::Ranges result;
+  vector<Interval> result;
+  result.reserve(left.size() + right.size());
 
-  for (int i = 0; i < left.range_size(); i++) {
-    coalesce(&result, left.range(i));
-  }
+  size_t i = 0;
+  size_t j = 0;
 
-  for (int i = 0; i < right.range_size(); i++) {
-    coalesce(&result, right.range(i));
+  while (i < left.size() || j < right.size()) {
+    if (j == right.size() || (i < left.size() && left[i] < right[j])) {
+      append(&result, left[i++]);
+    } else {
+      append(&result, right[j++]);
+    }
   }
 
   return result;
 }
 
 
-Value::Ranges operator - (const Value::Ranges& left, const Value::Ranges& right)
+// Returns the difference of sorted and coalesced intervals.
+static vector<Interval> subtract(const vector<Interval>& left,
+                                 const vector<Interval>& right)
 {
-  Value::Ranges result;
+  vector<Interval> result;
+  result.reserve(left.size());
 
-  for (int i = 0; i < left.range_size(); i++) {
-    coalesce(&result, left.range(i));
-  }
+  size_t j = 0;
 
-  for (int i = 0; i < right.range_size(); i++) {
-    coalesce(&result, right.range(i));
-  }
+  foreach (Interval interval, left) {
+    // Skip the intervals that end before this one begins (they also
+    // end before any of the following ones begin).
+    while (j < right.size() && right[j].second < interval.first) {
+      j++;
+    }
+
+    bool remaining = true;
 
-  for (int i = 0; i < right.range_size(); i++) {
-    remove(&result, right.range(i));
+    for (size_t k = j; k < right.size(); k++) {
+      if (right[k].first > interval.second) {
+        break;
+      }
+
+      if (right[k].first > interval.first) {
+        result.push_back(Interval(interval.first, right[k].first - 1));
+      }
+
+      if (right[k].second >= interval.second) {
+        remaining = false;
+        break;
+      }
+
+      interval.first = right[k].second + 1;
+    }
+
+    if (remaining) {
+      result.push_back(interval);
+    }
   }
 
   return result;
 }
 
 
-Value::Ranges& operator += (Value::Ranges& left, const Value::Ranges& right)
+bool operator == (const Value::Ranges& left, const Value::Ranges& right)
 {
-  Value::Ranges temp;
+  return intervals(left) == intervals(right);
+}
 
-  for (int i = 0; i < left.range_size(); i++) {
-    coalesce(&temp, left.range(i));
-  }
 
-  left = temp;
+bool operator <= (const Value::Ranges& left, const Value::Ranges& right)
+{
+  vector<Interval> subset = intervals(left);
+  vector<Interval> superset = intervals(right);
+
+  size_t j = 0;
+
+  foreach (const Interval& interval, subset) {
+    // Since the superset is coalesced the interval has to be
+    // contained in a single one of its intervals.
+    while (j < superset.size() && superset[j].second < interval.first) {
+      j++;
+    }
 
-  for (int i = 0; i < right.range_size(); i++) {
-    coalesce(&left, right.range(i));
+    if (j == superset.size() ||
+        superset[j].first > interval.first ||
+        superset[j].second < interval.second) {
+      return false;
+    }
   }
 
-  return left;
+  return true;
 }
 
 
-Value::Ranges& operator -= (Value::Ranges& left, const Value::Ranges& right)
+Value::Ranges operator + (const Value::Ranges& left, const Value::Ranges& right)
 {
-  Value::Ranges temp;
+  Value::Ranges result;
+  assign(&result, unite(intervals(left), intervals(right)));
+  return result;
+}
 
-  for (int i = 0; i < left.range_size(); i++) {
-    coalesce(&temp, left.range(i));
-  }
 
-  for (int i = 0; i < right.range_size(); i++) {
-    coalesce(&temp, right.range(i));
-  }
+Value::Ranges operator - (const Value::Ranges& left, const Value::Ranges& right)
+{
+  Value::Ranges result;
+  assign(&result, subtract(intervals(left), intervals(right)));
+  return result;
+}
 
-  left = temp;
 
-  for (int i = 0; i < right.range_size(); i++) {
-    remove(&left, right.range(i));
-  }
+Value::Ranges& operator += (Value::Ranges& left, const Value::Ranges& right)
+{
+  assign(&left, unite(intervals(left), intervals(right)));
+  return left;
+}
+
 
+Value::Ranges& operator -= (Value::Ranges& left, const Value::Ranges& right)
+{
+  assign(&left, subtract(intervals(left), intervals(right)));
   return left;
 }
 
@@ -406,19 +411,15 @@ Value::Set& operator += (Value::Set& left, const Value::Set& right)
 
 Value::Set& operator -= (Value::Set& left, const Value::Set& right)
 {
-  // For each item in right check if it's in left and add it if not.
+  // For each item in right check if it's in left and remove it if so.
   for (int i = 0; i < right.item_size(); i++) {
-    bool found = false;
     for (int j = 0; j < left.item_size(); j++) {
       if (right.item(i) == left.item(j)) {
-        found = true;
+        left.mutable_item()->SwapElements(j, left.item_size() - 1);
+        left.mutable_item()->RemoveLast();
         break;
       }
     }
-
-    if (!found) {
-      left.add_item(right.item(i));
-    }
   }
 
   return left;
@@ -501,13 +502,11 @@ Resource& operator += (Resource& left, const Resource& right)
 {
   if (left.name() == right.name() && left.type() == right.type()) {
     if (left.type() == Value::SCALAR) {
-      left.mutable_scalar()->MergeFrom(left.scalar() + right.scalar());
+      *left.mutable_scalar() += right.scalar();
     } else if (left.type() == Value::RANGES) {
-      left.mutable_ranges()->Clear();
-      left.mutable_ranges()->MergeFrom(left.ranges() + right.ranges());
+      *left.mutable_ranges() += right.ranges();
     } else if (left.type() == Value::SET) {
-      left.mutable_set()->Clear();
-      left.mutable_set()->MergeFrom(left.set() + right.set());
+      *left.mutable_set() += right.set();
     }
   }
 
@@ -519,13 +518,11 @@ Resource& operator -= (Resource& left, const Resource& right)
 {
   if (left.name() == right.name() && left.type() == right.type()) {
     if (left.type() == Value::SCALAR) {
-      left.mutable_scalar()->MergeFrom(left.scalar() - right.scalar());
+      *left.mutable_scalar() -= right.scalar();
     } else if (left.type() == Value::RANGES) {
-      left.mutable_ranges()->Clear();
-      left.mutable_ranges()->MergeFrom(left.ranges() - right.ranges());
+      *left.mutable_ranges() -= right.ranges();
     } else if (left.type() == Value::SET) {
-      left.mutable_set()->Clear();
-      left.mutable_set()->MergeFrom(left.set() - right.set());
+      *left.mutable_set() -= right.set();
     }
   }
 
@@ -19,8 +19,11 @@
 #ifndef __RESOURCES_HPP__
 #define __RESOURCES_HPP__
 
+#include <algorithm>
 #include <iterator>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <mesos/mesos.hpp>
 
@@ -153,13 +156,9 @@ public:
   bool operator == (const Resources& that) const
   {
     foreach (const Resource& resource, resources) {
-      Option<Resource> option = that.get(resource);
-      if (option.isNone()) {
+      const Resource* other = that.find(resource.name(), resource.type());
+      if (other == NULL || !(resource == *other)) {
         return false;
-      } else {
-        if (!(resource == option.get())) {
-          return false;
-        }
       }
     }
 
@@ -169,13 +168,9 @@ public:
   bool operator <= (const Resources& that) const
   {
     foreach (const Resource& resource, resources) {
-      Option<Resource> option = that.get(resource);
-      if (option.isNone()) {
+      const Resource* other = that.find(resource.name(), resource.type());
+      if (other == NULL || !(resource <= *other)) {
         return false;
-      } else {
-        if (!(resource <= option.get())) {
-          return false;
-        }
       }
     }
 
@@ -222,64 +217,71 @@ public:
     return *this;
   }
 
-  Resources operator + (const Resource& that) const
+  // Overloads for protocol buffer fields (e.g., the resources of a
+  // task) that avoid copying the field into a Resources object first.
+  Resources& operator += (
+      const google::protobuf::RepeatedPtrField<Resource>& that)
   {
-    Resources result;
+    foreach (const Resource& resource, that) {
+      *this += resource;
+    }
 
-    bool added = false;
+    return *this;
+  }
 
-    foreach (const Resource& resource, resources) {
-      if (resource.name() == that.name() &&
-	resource.type() == that.type()) {
-        result.resources.Add()->MergeFrom(resource + that);
-        added = true;
-      } else {
-        result.resources.Add()->MergeFrom(resource);
-      }
+  Resources& operator -= (
+      const google::protobuf::RepeatedPtrField<Resource>& that)
+  {
+    foreach (const Resource& resource, that) {
+      *this -= resource;
     }
 
-    if (!added) {
-      result.resources.Add()->MergeFrom(that);
-    }
+    return *this;
+  }
 
+  Resources operator + (const Resource& that) const
+  {
+    Resources result(*this);
+    result += that;
     return result;
   }
 
   Resources operator - (const Resource& that) const
   {
-    Resources result;
-
-    foreach (const Resource& resource, resources) {
-      if (resource.name() == that.name() &&
-	resource.type() == that.type()) {
-        result.resources.Add()->MergeFrom(resource - that);
-      } else {
-        result.resources.Add()->MergeFrom(resource);
-      }
-    }
-
+    Resources result(*this);
+    result -= that;
     return result;
   }
 
+  // Adds (or subtracts) a resource in place, i.e., without copying
+  // any of the other resources.
   Resources& operator += (const Resource& that)
   {
-    *this = *this + that;
+    Resource* resource = find(that.name(), that.type());
+    if (resource != NULL) {
+      *resource += that;
+    } else {
+      resources.Add()->MergeFrom(that);
+    }
+
     return *this;
   }
 
   Resources& operator -= (const Resource& that)
   {
-    *this = *this - that;
+    Resource* resource = find(that.name(), that.type());
+    if (resource != NULL) {
+      *resource -= that;
+    }
+
     return *this;
   }
 
   Option<Resource> get(const Resource& r) const
   {
-    foreach (const Resource& resource, resources) {
-      if (resource.name() == r.name() &&
-          resource.type() == r.type()) {
-        return resource;
-      }
+    const Resource* resource = find(r.name(), r.type());
+    if (resource != NULL) {
+      return *resource;
     }
 
     return Option<Resource>::none();
@@ -337,6 +339,9 @@ public:
         if (resource.ranges().range_size() == 0) {
           return false;
         } else {
+          std::vector<std::pair<uint64_t, uint64_t> > ranges;
+          ranges.reserve(resource.ranges().range_size());
+
           for (int i = 0; i < resource.ranges().range_size(); i++) {
             const Value::Range& range = resource.ranges().range(i);
 
@@ -345,12 +350,15 @@ public:
               return false;
             }
 
-            // Ensure ranges don't overlap (but not necessarily coalesced).
-            for (int j = i + 1; j < resource.ranges().range_size(); j++) {
-              if (range.begin() <= resource.ranges().range(j).begin() &&
-                  resource.ranges().range(j).begin() <= range.end()) {
-                return false;
-              }
+            ranges.push_back(std::make_pair(range.begin(), range.end()));
+          }
+
+          // Ensure ranges don't overlap (but not necessarily coalesced).
+          std::sort(ranges.begin(), ranges.end());
+
+          for (size_t i = 1; i < ranges.size(); i++) {
+            if (ranges[i].first <= ranges[i - 1].second) {
+              return false;
             }
           }
         }
@@ -378,6 +386,31 @@ public:
   }
 
 private:
+  // Returns the resource with the specified name and type (or NULL).
+  const Resource* find(const std::string& name, Value::Type type) const
+  {
+    for (int i = 0; i < resources.size(); i++) {
+      const Resource& resource = resources.Get(i);
+      if (resource.type() == type && resource.name() == name) {
+        return &resource;
+      }
+    }
+
+    return NULL;
+  }
+
+  Resource* find(const std::string& name, Value::Type type)
+  {
+    for (int i = 0; i < resources.size(); i++) {
+      Resource* resource = resources.Mutable(i);
+      if (resource->type() == type && resource->name() == name) {
+        return resource;
+      }
+    }
+
+    return NULL;
+  }
+
   google::protobuf::RepeatedPtrField<Resource> resources;
 };
 
@@ -387,11 +420,9 @@ inline Value::Scalar Resources::get(
     const std::string& name,
     const Value::Scalar& scalar) const
 {
-  foreach (const Resource& resource, resources) {
-    if (resource.name() == name &&
-        resource.type() == Value::SCALAR) {
-      return resource.scalar();
-    }
+  const Resource* resource = find(name, Value::SCALAR);
+  if (resource != NULL) {
+    return resource->scalar();
   }
 
   return scalar;
@@ -403,11 +434,9 @@ inline Value::Ranges Resources::get(
     const std::string& name,
     const Value::Ranges& ranges) const
 {
-  foreach (const Resource& resource, resources) {
-    if (resource.name() == name &&
-        resource.type() == Value::RANGES) {
-      return resource.ranges();
-    }
+  const Resource* resource = find(name, Value::RANGES);
+  if (resource != NULL) {
+    return resource->ranges();
   }
 
   return ranges;
@@ -419,11 +448,9 @@ inline Value::Set Resources::get(
     const std::string& name,
     const Value::Set& set) const
 {
-  foreach (const Resource& resource, resources) {
-    if (resource.name() == name &&
-        resource.type() == Value::SET) {
-      return resource.set();
-    }
+  const Resource* resource = find(name, Value::SET);
+  if (resource != NULL) {
+    return resource->set();
   }
 
   return set;
@@ -0,0 +1,135 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __STATISTICS_HPP__
+#define __STATISTICS_HPP__
+
+#include <string>
+
+#include <tr1/unordered_map>
+
+#include <mesos/mesos.hpp>
+
+#include <process/metrics.hpp>
+#include <process/statistics.hpp>
+
+#include "common/foreach.hpp"
+#include "common/json.hpp"
+
+
+namespace mesos {
+namespace internal {
+
+// Statistics kept by the master and the slave (e.g., for /stats.json)
+// that are also exported at /metrics, with the names prefixed by
+// "mesos_<component>_". Safe to update (and read) from any thread.
+struct Statistics
+{
+  explicit Statistics(const std::string& component)
+    : validStatusUpdates(
+          "mesos_" + component + "_status_updates_total",
+          "Status updates received, by whether they were valid.",
+          process::metrics::label("valid", "true")),
+      invalidStatusUpdates(
+          "mesos_" + component + "_status_updates_total",
+          "Status updates received, by whether they were valid.",
+          process::metrics::label("valid", "false")),
+      validFrameworkMessages(
+          "mesos_" + component + "_framework_messages_total",
+          "Framework messages received, by whether they were valid.",
+          process::metrics::label("valid", "true")),
+      invalidFrameworkMessages(
+          "mesos_" + component + "_framework_messages_total",
+          "Framework messages received, by whether they were valid.",
+          process::metrics::label("valid", "false"))
+  {
+    for (int i = 0; i < TaskState_ARRAYSIZE; i++) {
+      tasks[i] = NULL;
+      if (TaskState_IsValid(i)) {
+        tasks[i] = new process::metrics::Counter(
+            "mesos_" + component + "_tasks_total",
+            "Tasks that reached each state.",
+            process::metrics::label("state", TaskState_Name(TaskState(i))));
+      }
+    }
+  }
+
+  ~Statistics()
+  {
+    for (int i = 0; i < TaskState_ARRAYSIZE; i++) {
+      delete tasks[i];
+    }
+  }
+
+  process::metrics::Counter* tasks[TaskState_ARRAYSIZE];
+  process::metrics::Counter validStatusUpdates;
+  process::metrics::Counter invalidStatusUpdates;
+  process::metrics::Counter validFrameworkMessages;
+  process::metrics::Counter invalidFrameworkMessages;
+
+private:
+  // Not copyable, not assignable.
+  Statistics(const Statistics&);
+  Statistics& operator = (const Statistics&);
+};
+
+
+// Returns a JSON object modeled on a histogram of durations (in
+// seconds, with the counts per power of two microseconds).
+inline JSON::Object model(const process::Histogram& histogram)
+{
+  JSON::Object object;
+  object.values["total"] = histogram.total;
+  object.values["max"] = histogram.max;
+
+  JSON::Array counts;
+  for (int i = 0; i < process::Histogram::BUCKETS; i++) {
+    counts.values.push_back(histogram.counts[i]);
+  }
+
+  object.values["counts"] = counts;
+
+  return object;
+}
+
+
+// Returns a JSON object modeled on the statistics a process keeps
+// about the events it handled (see ProtobufProcess::statistics).
+inline JSON::Object model(
+    const std::tr1::unordered_map<std::string,
+                                  process::HandlerStatistics>& statistics)
+{
+  JSON::Object object;
+
+  foreachpair (const std::string& name,
+               const process::HandlerStatistics& handler,
+               statistics) {
+    JSON::Object values;
+    values.values["count"] = handler.count;
+    values.values["queue_wait"] = model(handler.waiting);
+    values.values["handler_time"] = model(handler.running);
+    object.values[name] = values;
+  }
+
+  return object;
+}
+
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __STATISTICS_HPP__
@@ -12,16 +12,17 @@
 
 namespace thread {
 
-void* __run(void* arg)
+inline void* __run(void* arg)
 {
   std::tr1::function<void(void)>* function =
     reinterpret_cast<std::tr1::function<void(void)>*>(arg);
   (*function)();
   delete function;
+  return NULL;
 }
 
 
-bool start(const std::tr1::function<void(void)>& f, bool detach = false)
+inline bool start(const std::tr1::function<void(void)>& f, bool detach = false)
 {
   std::tr1::function<void(void)>* __f = new std::tr1::function<void(void)>(f);
 
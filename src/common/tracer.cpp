@@ -0,0 +1,184 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <process/clock.hpp>
+
+#include "common/foreach.hpp"
+#include "common/json.hpp"
+#include "common/lock.hpp"
+#include "common/strings.hpp"
+#include "common/tracer.hpp"
+#include "common/utils.hpp"
+#include "common/uuid.hpp"
+
+using process::Future;
+using process::HttpBadRequestResponse;
+using process::HttpOKResponse;
+using process::HttpRequest;
+using process::HttpResponse;
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace tracer {
+
+// Number of spans kept, a few per task (a few MB at most).
+static const size_t CAPACITY = 16384;
+
+// Ring buffer of the most recent spans: 'next' is where the next span
+// goes, overwriting the oldest one once the buffer is full.
+static vector<Span>* buffer = new vector<Span>();
+static size_t next = 0;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+uint64_t id()
+{
+  uint64_t id = 0;
+  while (id == 0) {
+    const string& bytes = UUID::random().toBytes();
+    memcpy(&id, bytes.data(), sizeof(id));
+  }
+  return id;
+}
+
+
+void record(uint64_t trace,
+            const TaskID& taskId,
+            const string& name,
+            double start,
+            double end)
+{
+  if (trace == 0) {
+    return;
+  }
+
+  Span span;
+  span.trace = trace;
+  span.task = taskId.value();
+  span.name = name;
+  span.start = start;
+  span.end = end;
+
+  Lock lock(&mutex);
+
+  if (buffer->size() < CAPACITY) {
+    buffer->push_back(span);
+  } else {
+    (*buffer)[next] = span;
+  }
+
+  next = (next + 1) % CAPACITY;
+}
+
+
+void record(const string& component, const StatusUpdate& update)
+{
+  if (update.has_trace_id()) {
+    const double now = process::Clock::now();
+    record(update.trace_id(),
+           update.status().task_id(),
+           component + "/" + TaskState_Name(update.status().state()),
+           now,
+           now);
+  }
+}
+
+
+vector<Span> spans(uint64_t trace)
+{
+  vector<Span> spans;
+
+  Lock lock(&mutex);
+
+  // Until the buffer is full, the oldest span is the first one.
+  const size_t oldest = buffer->size() < CAPACITY ? 0 : next;
+
+  for (size_t i = 0; i < buffer->size(); i++) {
+    const Span& span = (*buffer)[(oldest + i) % buffer->size()];
+    if (trace == 0 || span.trace == trace) {
+      spans.push_back(span);
+    }
+  }
+
+  return spans;
+}
+
+
+// Returns the trace id in hex.
+static string hex(uint64_t trace)
+{
+  char buffer[17];
+  snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long) trace);
+  return buffer;
+}
+
+
+Future<HttpResponse> serve(const HttpRequest& request)
+{
+  uint64_t trace = 0;
+
+  map<string, vector<string> > pairs = strings::pairs(request.query, '&', '=');
+
+  if (pairs.count("trace") > 0) {
+    const string& value = pairs["trace"].back();
+    char* end = NULL;
+    trace = strtoull(value.c_str(), &end, 16);
+    if (value.empty() || *end != '\0') {
+      return HttpBadRequestResponse();
+    }
+  }
+
+  HttpOKResponse response;
+  response.headers["Content-Type"] = "application/json";
+
+  JSON::Writer writer(&response.body);
+
+  writer.beginArray();
+
+  foreach (const Span& span, spans(trace)) {
+    writer.beginObject();
+    writer.field("trace", hex(span.trace));
+    writer.field("task", span.task);
+    writer.field("name", span.name);
+    writer.field("start", span.start);
+    writer.field("end", span.end);
+    writer.endObject();
+  }
+
+  writer.endArray();
+  response.headers["Content-Length"] = utils::stringify(response.body.size());
+
+  return response;
+}
+
+} // namespace tracer {
+} // namespace internal {
+} // namespace mesos {
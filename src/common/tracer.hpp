@@ -0,0 +1,90 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __COMMON_TRACER_HPP__
+#define __COMMON_TRACER_HPP__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <mesos/mesos.hpp>
+
+#include <process/future.hpp>
+#include <process/http.hpp>
+
+#include "messages/messages.hpp"
+
+namespace mesos {
+namespace internal {
+namespace tracer {
+
+// Tracing of task launches end to end: the scheduler driver gives
+// each task it launches a trace id (TaskDescription.trace_id) which
+// the master and the slave pass along with the task and the executor
+// driver puts in the task's status updates, and each of them records
+// the spans of time it spent on the task. The spans get kept in a
+// buffer per OS process (only the most recent ones are kept) that is
+// served as JSON at /<process>/trace (e.g., /master/trace), or just
+// the spans of one trace with '?trace=<id>'. Joining the spans of a
+// trace from each component breaks down the latency of a launch.
+
+struct Span
+{
+  uint64_t trace;
+  std::string task;
+  std::string name; // "<component>/<what>", e.g., "master/launch".
+  double start;
+  double end; // Same as the start for an instant (e.g., an update).
+};
+
+
+// Returns a new (random, non-zero) trace id.
+uint64_t id();
+
+
+// Records a span of a trace (nothing gets recorded for trace 0, i.e.,
+// a task that isn't traced).
+void record(uint64_t trace,
+            const TaskID& taskId,
+            const std::string& name,
+            double start,
+            double end);
+
+
+// Records the arrival of the status update of a traced task at the
+// component (named "<component>/<state>", e.g., "slave/TASK_RUNNING").
+void record(const std::string& component, const StatusUpdate& update);
+
+
+// Returns the spans recorded (and still kept), oldest first, or only
+// the spans of the trace unless it's 0.
+std::vector<Span> spans(uint64_t trace = 0);
+
+
+// Serves the spans as a JSON array of objects, with the trace ids in
+// hex (see above).
+process::Future<process::HttpResponse> serve(
+    const process::HttpRequest& request);
+
+} // namespace tracer {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __COMMON_TRACER_HPP__
@@ -20,6 +20,7 @@
 #define __UUID_HPP__
 
 #include <assert.h>
+#include <unistd.h>
 
 #include <sstream>
 #include <string>
@@ -37,7 +38,21 @@ struct UUID : boost::uuids::uuid
 public:
   static UUID random()
   {
-    return UUID(boost::uuids::random_generator()());
+    // Constructing a generator seeds it (from /dev/urandom and then
+    // some), which costs far more than generating a UUID, so each
+    // thread keeps its own (they can't be shared between threads)
+    // once seeded. A forked child reseeds rather than generating the
+    // same UUIDs as its parent.
+    static __thread boost::uuids::random_generator* generator = NULL;
+    static __thread pid_t seeded = 0;
+
+    if (generator == NULL || seeded != getpid()) {
+      delete generator;
+      generator = new boost::uuids::random_generator();
+      seeded = getpid();
+    }
+
+    return UUID((*generator)());
   }
 
   static UUID fromBytes(const std::string& s)
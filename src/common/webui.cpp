@@ -0,0 +1,285 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "common/foreach.hpp"
+#include "common/option.hpp"
+#include "common/strings.hpp"
+#include "common/try.hpp"
+#include "common/utils.hpp"
+#include "common/webui.hpp"
+
+using process::Future;
+using process::HttpBadRequestResponse;
+using process::HttpNotFoundResponse;
+using process::HttpOKResponse;
+using process::HttpResponse;
+using process::HttpRequest;
+
+using std::string;
+
+
+namespace mesos {
+namespace internal {
+namespace webui {
+
+// Most lines of a file that get returned at once.
+static const int MAX_TAIL_LINES = 10000;
+
+
+// Returns the content type of a webui file by its extension.
+static string type(const string& path)
+{
+  const string& extension = path.substr(path.find_last_of('.') + 1);
+
+  if (extension == "html") {
+    return "text/html";
+  } else if (extension == "css") {
+    return "text/css";
+  } else if (extension == "js") {
+    return "application/javascript";
+  }
+
+  return "text/plain";
+}
+
+
+// Returns a response with the content of a file (or none if it
+// can't be read).
+static Option<HttpResponse> read(const string& path)
+{
+  std::ifstream file(path.c_str());
+  if (!file.is_open()) {
+    return Option<HttpResponse>::none();
+  }
+
+  std::ostringstream out;
+  out << file.rdbuf();
+
+  HttpOKResponse response;
+  response.headers["Content-Type"] = type(path);
+  response.headers["Content-Length"] = utils::stringify(out.str().size());
+  response.body = out.str();
+  return Option<HttpResponse>::some(response);
+}
+
+
+hashmap<string, HttpResponse> load(
+    const Configuration& conf,
+    const string& name)
+{
+  // Remove any trailing '/' in directory.
+  const string& directory = strings::remove(
+      conf.get("webui_dir", MESOS_WEBUI_DIR), "/", strings::SUFFIX);
+
+  hashmap<string, HttpResponse> webui;
+
+  const string& page = directory + "/" + name + "/index.html";
+
+  Option<HttpResponse> response = read(page);
+  if (response.isNone()) {
+    LOG(WARNING) << "Not serving the webui, failed to read " << page;
+    return webui;
+  }
+
+  webui["webui"] = response.get();
+
+  foreach (const string& entry, utils::os::listdir(directory + "/static")) {
+    if (entry[0] == '.') {
+      continue;
+    }
+
+    response = read(directory + "/static/" + entry);
+    if (response.isSome()) {
+      webui["static/" + entry] = response.get();
+    }
+  }
+
+  return webui;
+}
+
+
+Future<HttpResponse> serve(
+    const HttpResponse& response,
+    const HttpRequest& request)
+{
+  return response;
+}
+
+
+Future<HttpResponse> tail(const string& path, const HttpRequest& request)
+{
+  int lines = 100;
+
+  std::map<string, std::vector<string> > pairs =
+    strings::pairs(request.query, '&', '=');
+
+  if (pairs.count("lines") > 0) {
+    Try<int> number = utils::numify<int>(pairs["lines"].back());
+    if (number.isError() || number.get() <= 0) {
+      return HttpBadRequestResponse();
+    }
+    lines = std::min(number.get(), MAX_TAIL_LINES);
+  }
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return HttpNotFoundResponse();
+  }
+
+  struct stat s;
+  if (fstat(fd, &s) < 0) {
+    close(fd);
+    return HttpNotFoundResponse();
+  }
+
+  // Read backwards from the end (ignoring a trailing newline) until
+  // enough lines have been found, so only the tail gets read (and
+  // then only to find where it starts, the tail itself gets sent
+  // straight from the file).
+  off_t offset = s.st_size;
+  off_t start = 0;
+  int newlines = 0;
+
+  char buffer[4096];
+
+  while (offset > 0) {
+    const size_t size = std::min((off_t) sizeof(buffer), offset);
+    offset -= size;
+
+    ssize_t length = pread(fd, buffer, size, offset);
+    if (length != (ssize_t) size) {
+      close(fd);
+      return HttpNotFoundResponse();
+    }
+
+    // Look for the newline before the first line to return.
+    bool found = false;
+    for (size_t i = size; i > 0; i--) {
+      if (buffer[i - 1] == '\n' && (offset + i < (off_t) s.st_size)) {
+        if (++newlines == lines) {
+          start = offset + i;
+          found = true;
+          break;
+        }
+      }
+    }
+
+    if (found) {
+      break;
+    }
+  }
+
+  close(fd);
+
+  // NOTE: The length is fixed here so that lines getting appended in
+  // the meantime don't get sent.
+  HttpOKResponse response;
+  response.headers["Content-Type"] = "text/plain";
+  response.path = path;
+  response.offset = start;
+  response.length = s.st_size - start;
+  return response;
+}
+
+
+Future<HttpResponse> file(const string& path, const HttpRequest& request)
+{
+  std::map<string, std::vector<string> > pairs =
+    strings::pairs(request.query, '&', '=');
+
+  Try<long long> offset = 0;
+  if (pairs.count("offset") > 0) {
+    offset = utils::numify<long long>(pairs["offset"].back());
+    if (offset.isError()) {
+      return HttpBadRequestResponse();
+    }
+  }
+
+  Try<long long> length = 0;
+  if (pairs.count("length") > 0) {
+    length = utils::numify<long long>(pairs["length"].back());
+    if (length.isError() || length.get() < 0) {
+      return HttpBadRequestResponse();
+    }
+  }
+
+  struct stat s;
+  if (stat(path.c_str(), &s) < 0 || !S_ISREG(s.st_mode)) {
+    return HttpNotFoundResponse();
+  }
+
+  // A negative offset counts back from the end of the file.
+  off_t start = offset.get() >= 0
+    ? std::min((off_t) offset.get(), s.st_size)
+    : std::max(s.st_size + (off_t) offset.get(), (off_t) 0);
+
+  HttpOKResponse response;
+  response.headers["Content-Type"] = "text/plain";
+  response.headers["X-File-Size"] = utils::stringify(s.st_size);
+  response.headers["X-File-Offset"] = utils::stringify(start);
+  response.path = path;
+  response.offset = start;
+  response.length = s.st_size - start;
+  if (length.get() > 0) {
+    response.length = std::min((off_t) length.get(), s.st_size - start);
+  }
+  return response;
+}
+
+
+Future<HttpResponse> log(
+    const string& directory,
+    const string& program,
+    const HttpRequest& request)
+{
+  if (directory.empty()) {
+    return HttpNotFoundResponse();
+  }
+
+  string level = "INFO";
+
+  std::map<string, std::vector<string> > pairs =
+    strings::pairs(request.query, '&', '=');
+
+  if (pairs.count("level") > 0) {
+    level = pairs["level"].back();
+    if (level != "INFO" && level != "WARNING" && level != "ERROR") {
+      return HttpBadRequestResponse();
+    }
+  }
+
+  // The log file is a link (named after the program and the level)
+  // to the latest log file, see glog.
+  return tail(directory + "/" + program + "." + level, request);
+}
+
+} // namespace webui {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,87 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __COMMON_WEBUI_HPP__
+#define __COMMON_WEBUI_HPP__
+
+#include <string>
+
+#include <process/future.hpp>
+#include <process/http.hpp>
+
+#include "common/hashmap.hpp"
+
+#include "configurator/configuration.hpp"
+
+namespace mesos {
+namespace internal {
+namespace webui {
+
+// The webui gets served by the master's (and the slave's) own HTTP
+// endpoints: a page (e.g., /master/webui) whose scripts fetch and
+// render the JSON endpoints in the browser, plus the scripts and
+// stylesheets it needs (e.g., /master/static/master.js).
+
+// Returns the webui of a process ("master" or "slave"), i.e., the
+// page and the static files, by the name to route each of them
+// under. The files get read (once) from the webui directory, which
+// is either specified via the 'webui_dir' option (necessary for
+// running out of the build directory) or MESOS_WEBUI_DIR.
+hashmap<std::string, process::HttpResponse> load(
+    const Configuration& conf,
+    const std::string& name);
+
+
+// Returns the response (for routing a loaded file).
+process::Future<process::HttpResponse> serve(
+    const process::HttpResponse& response,
+    const process::HttpRequest& request);
+
+
+// Returns the last lines of a file as plain text, as many as the
+// request asks for with '?lines=<number>' (100 by default).
+process::Future<process::HttpResponse> tail(
+    const std::string& path,
+    const process::HttpRequest& request);
+
+
+// Returns a page of a file as plain text, starting at the byte the
+// request asks for with '?offset=<bytes>' (0 by default, a negative
+// offset counts back from the end) and with up to '?length=<bytes>'
+// (the rest of the file by default). The size of the file and where
+// the page starts get returned in the X-File-Size and X-File-Offset
+// headers so that clients can page through (or follow) the file.
+// The file gets sent straight from disk, see HttpResponse::path.
+process::Future<process::HttpResponse> file(
+    const std::string& path,
+    const process::HttpRequest& request);
+
+
+// Returns the last lines of a program's (e.g., "mesos-master") log
+// in a directory, at the level the request asks for with
+// '?level=<INFO|WARNING|ERROR>' (INFO by default), see tail.
+process::Future<process::HttpResponse> log(
+    const std::string& directory,
+    const std::string& program,
+    const process::HttpRequest& request);
+
+} // namespace webui {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __COMMON_WEBUI_HPP__
@@ -16,6 +16,7 @@
  * limitations under the License.
  */
 
+#include <set>
 #include <vector>
 
 #include <glog/logging.h>
@@ -23,13 +24,22 @@
 #include <boost/lexical_cast.hpp>
 
 #include <process/protobuf.hpp>
+#include <process/timeout.hpp>
+#include <process/timer.hpp>
 
 #include "common/fatal.hpp"
 #include "common/foreach.hpp"
+#include "common/lambda.hpp"
+#include "common/option.hpp"
+#include "common/result.hpp"
+#include "common/seconds.hpp"
+#include "common/strings.hpp"
 
 #include "detector/detector.hpp"
 #include "detector/url_processor.hpp"
 
+#include "log/log.hpp"
+
 #include "messages/messages.hpp"
 
 #include "zookeeper/authentication.hpp"
@@ -41,9 +51,12 @@ using namespace mesos::internal;
 using boost::lexical_cast;
 
 using process::Process;
+using process::Timeout;
 using process::UPID;
 
+using std::list;
 using std::pair;
+using std::set;
 using std::string;
 using std::vector;
 
@@ -133,6 +146,370 @@ private:
 };
 
 
+namespace mesos { namespace internal {
+
+// Forward declaration.
+class LogElectionProcess;
+
+}} // namespace mesos { namespace internal {
+
+
+class LogMasterDetector : public MasterDetector
+{
+public:
+  /**
+   * Uses a replicated log kept by the masters themselves for both
+   * detecting masters and contending to be a master, rather than
+   * ZooKeeper. Anyone else can detect the master via the master
+   * detector proxy (see MasterDetectorProxy) of any of the masters,
+   * which this detector runs too.
+   *
+   * @param masters host:port pairs of all the masters (including
+   * this one)
+   * @param path directory for this master's replica of the log
+   * @param pid libprocess pid of the master to send messages/updates
+   * to (and to use for contending to be a master)
+   */
+  LogMasterDetector(const vector<string>& masters,
+                    const string& path,
+                    const UPID& pid);
+
+  virtual ~LogMasterDetector();
+
+private:
+  MasterDetectorProxyProcess* proxy;
+  LogElectionProcess* process;
+};
+
+
+namespace mesos { namespace internal {
+
+// Seconds to wait before subscribing to a master detector proxy again
+// after losing it.
+const double PROXY_RESUBSCRIBE_SECONDS = 1.0;
+
+// Seconds for which a master elected using the replicated log (see
+// LogMasterDetector) holds a lease on the replicas of the masters,
+// i.e., roughly how long it takes the others to replace it after it
+// fails (rather than a ZooKeeper session timeout).
+const double LOG_ELECTION_LEASE_SECONDS = 0.8;
+
+// Entries the elected master appends to the log between snapshots,
+// which truncate the log (each entry renews its lease).
+const size_t LOG_ELECTION_SNAPSHOT_INTERVAL = 100;
+
+// Id of the process of each master's replica of the log.
+const string LOG_ELECTION_REPLICA_ID = "election";
+
+
+// Sends the master detector messages it gets (from the detector it
+// proxies) on to each of its subscribers, and the last of them to new
+// subscribers.
+class MasterDetectorProxyProcess
+  : public ProtobufProcess<MasterDetectorProxyProcess>
+{
+public:
+  MasterDetectorProxyProcess() : ProcessBase("detector") {}
+
+  virtual ~MasterDetectorProxyProcess() {}
+
+protected:
+  virtual void initialize()
+  {
+    install<NewMasterDetectedMessage>(
+        &MasterDetectorProxyProcess::newMasterDetected,
+        &NewMasterDetectedMessage::pid);
+
+    install<NoMasterDetectedMessage>(
+        &MasterDetectorProxyProcess::noMasterDetected);
+
+    install<SubscribeMasterDetectorMessage>(
+        &MasterDetectorProxyProcess::subscribe,
+        &SubscribeMasterDetectorMessage::pid);
+  }
+
+  virtual void exited(const UPID& pid)
+  {
+    if (subscribers.erase(pid) > 0) {
+      LOG(INFO) << "Master detector proxy lost subscriber " << pid;
+    }
+  }
+
+private:
+  void newMasterDetected(const string& pid)
+  {
+    master = UPID(pid);
+
+    NewMasterDetectedMessage message;
+    message.set_pid(pid);
+    foreach (const UPID& subscriber, subscribers) {
+      send(subscriber, message);
+    }
+  }
+
+  void noMasterDetected()
+  {
+    master = UPID();
+
+    foreach (const UPID& subscriber, subscribers) {
+      send(subscriber, NoMasterDetectedMessage());
+    }
+  }
+
+  void subscribe(const string& pid)
+  {
+    UPID subscriber(pid);
+
+    if (!subscriber) {
+      LOG(WARNING) << "Master detector proxy ignoring subscription of '"
+                   << pid << "'";
+      return;
+    }
+
+    LOG(INFO) << "Master detector proxy got subscriber " << subscriber;
+
+    link(subscriber);
+    subscribers.insert(subscriber);
+
+    if (master) {
+      NewMasterDetectedMessage message;
+      message.set_pid(master);
+      send(subscriber, message);
+    }
+  }
+
+  UPID master; // Last master detected, if any.
+  set<UPID> subscribers;
+};
+
+
+// Subscribes a pid to a master detector proxy, again whenever the
+// proxy is lost (in which case the pid gets told there's no master),
+// trying the next of the proxies each time if there are many.
+class ProxySubscriberProcess : public ProtobufProcess<ProxySubscriberProcess>
+{
+public:
+  ProxySubscriberProcess(const vector<UPID>& _proxies, const UPID& _pid)
+    : proxies(_proxies), pid(_pid), index(0)
+  {
+    CHECK(!proxies.empty());
+  }
+
+  virtual ~ProxySubscriberProcess() {}
+
+  void subscribe()
+  {
+    const UPID& proxy = proxies[index];
+
+    link(proxy);
+
+    SubscribeMasterDetectorMessage message;
+    message.set_pid(pid);
+    send(proxy, message);
+  }
+
+protected:
+  virtual void initialize()
+  {
+    subscribe();
+  }
+
+  virtual void exited(const UPID& _pid)
+  {
+    if (_pid == proxies[index]) {
+      LOG(WARNING) << "Lost master detector proxy " << _pid;
+      process::post(pid, NoMasterDetectedMessage());
+      index = (index + 1) % proxies.size();
+      process::delay(PROXY_RESUBSCRIBE_SECONDS, self(),
+                     &ProxySubscriberProcess::subscribe);
+    }
+  }
+
+private:
+  const vector<UPID> proxies;
+  const UPID pid;
+  size_t index; // Of the proxy we're subscribed to.
+};
+
+
+// Elects a master using a replicated log with a replica on each of
+// the masters, and tells the master (and the master detector proxy
+// of this master) which master is elected. The elected master
+// appends its pid to the log every quarter of a lease, which keeps
+// extending its lease (during which the replicas won't elect anyone
+// else) and lets every master learn which master is elected from its
+// own replica. The other masters only try to get elected once their
+// replica hasn't seen an append for a lease.
+class LogElectionProcess : public Process<LogElectionProcess>
+{
+public:
+  LogElectionProcess(const set<UPID>& replicas,
+                     const string& path,
+                     const UPID& _pid,
+                     const UPID& _proxy)
+    : pid(_pid),
+      proxy(_proxy),
+      writer(NULL),
+      quiet(LOG_ELECTION_LEASE_SECONDS)
+  {
+    // The replicas of a majority of the masters make a quorum.
+    log = new log::Log(replicas.size() / 2 + 1,
+                       path,
+                       replicas,
+                       log::Replica::LEVELDB,
+                       LOG_ELECTION_REPLICA_ID);
+
+    reader = new log::Log::Reader(log);
+  }
+
+  virtual ~LogElectionProcess()
+  {
+    delete writer;
+    delete reader;
+    delete log;
+  }
+
+protected:
+  virtual void initialize()
+  {
+    tick();
+  }
+
+private:
+  void tick()
+  {
+    if (writer != NULL) {
+      renew();
+    } else {
+      watch();
+      if (quiet.remaining() <= 0) {
+        contend();
+      }
+    }
+
+    process::delay(LOG_ELECTION_LEASE_SECONDS / 4, self(),
+                   &LogElectionProcess::tick);
+  }
+
+  // Appends our pid to the log, which extends our lease. We give up
+  // being the master unless the append completes within a quarter of
+  // a lease, so that (since appends are at most a quarter of a lease
+  // apart and a lease starts when its append gets sent) we always
+  // give up before our lease could have expired, i.e., before any
+  // other master could have been elected.
+  void renew()
+  {
+    Result<log::Log::Position> position =
+      writer->append(pid, seconds(LOG_ELECTION_LEASE_SECONDS / 4));
+
+    if (!position.isSome()) {
+      LOG(WARNING) << "Failed to renew the master's lease: "
+                   << (position.isError() ? position.error() : "timed out");
+      delete writer;
+      writer = NULL;
+      detected(UPID());
+    }
+  }
+
+  // Learns which master is elected from the last entry in our
+  // replica, if it changed since the last time.
+  void watch()
+  {
+    const log::Log::Position ending = reader->ending();
+
+    if (last.isSome() && ending <= last.get()) {
+      return;
+    }
+
+    last = ending;
+    quiet = Timeout(LOG_ELECTION_LEASE_SECONDS);
+
+    Result<list<log::Log::Entry> > entries =
+      reader->read(ending, ending, seconds(LOG_ELECTION_LEASE_SECONDS / 4));
+
+    // The entry might not have been learned yet (or might be a
+    // truncate), in which case there will be another one soon.
+    if (entries.isSome() && !entries.get().empty()) {
+      const UPID master(entries.get().back().data);
+
+      // Only our own writer says we're elected (our pid might still
+      // be in the log from before we restarted).
+      if (master && master != pid) {
+        detected(master);
+      }
+    }
+  }
+
+  // Tries to get elected, which only succeeds once the lease of the
+  // last elected master (if any) has expired.
+  void contend()
+  {
+    const seconds timeout(LOG_ELECTION_LEASE_SECONDS / 4);
+
+    writer = new log::Log::Writer(
+        log, timeout, 1, seconds(LOG_ELECTION_LEASE_SECONDS));
+
+    Result<log::Log::Position> position = writer->append(pid, timeout);
+
+    if (!position.isSome()) {
+      VLOG(1) << "Failed to get elected using the replicated log: "
+              << (position.isError() ? position.error() : "timed out");
+      delete writer;
+      writer = NULL;
+      quiet = Timeout(LOG_ELECTION_LEASE_SECONDS);
+      return;
+    }
+
+    LOG(INFO) << "Elected using the replicated log";
+
+    // Snapshotting the log (i.e., our pid) truncates it.
+    writer->snapshots(lambda::bind(&LogElectionProcess::snapshot, this),
+                      LOG_ELECTION_SNAPSHOT_INTERVAL);
+
+    detected(pid);
+  }
+
+  string snapshot()
+  {
+    return pid;
+  }
+
+  void detected(const UPID& master)
+  {
+    if (master == elected) {
+      return;
+    }
+
+    elected = master;
+
+    if (elected) {
+      LOG(INFO) << "Master detected using the replicated log: " << elected;
+      NewMasterDetectedMessage message;
+      message.set_pid(elected);
+      process::post(pid, message);
+      process::post(proxy, message);
+    } else {
+      process::post(pid, NoMasterDetectedMessage());
+      process::post(proxy, NoMasterDetectedMessage());
+    }
+  }
+
+  const UPID pid;
+  const UPID proxy;
+
+  log::Log* log;
+  log::Log::Reader* reader;
+  log::Log::Writer* writer; // Only while we're elected.
+
+  UPID elected; // Last master detected, if any.
+
+  Option<log::Log::Position> last; // Last ending of our replica seen.
+  Timeout quiet; // Expires a lease after our replica last changed.
+};
+
+}} // namespace mesos { namespace internal {
+
+
 MasterDetector::~MasterDetector() {}
 
 
@@ -189,6 +566,51 @@ MasterDetector* MasterDetector::create(const string &url,
       break;
     }
 
+    // Master detector proxy (see MasterDetectorProxy).
+    case UrlProcessor::PROXY: {
+      if (contend) {
+        fatal("cannot contend to be a master with a master detector proxy");
+      }
+      UPID proxy(urlPair.second);
+      if (!proxy) {
+        fatal("cannot use specified url to detect master");
+      }
+      detector = new ProxyMasterDetector(proxy, pid);
+      break;
+    }
+
+    // Replicated log kept by the masters (see LogMasterDetector).
+    case UrlProcessor::LOG: {
+      const size_t index = urlPair.second.find("/");
+
+      const vector<string>& masters =
+        strings::split(urlPair.second.substr(0, index), ",");
+
+      if (masters.empty()) {
+        fatal("expecting the masters for the replicated log");
+      }
+
+      if (contend) {
+        if (index == string::npos || urlPair.second.substr(index) == "/") {
+          fatal("expecting a path for the master's replica of the log");
+        }
+        detector = new LogMasterDetector(masters, urlPair.second.substr(index),
+                                         pid);
+      } else {
+        // Any master can tell us which master is elected.
+        vector<UPID> proxies;
+        foreach (const string& master, masters) {
+          UPID proxy("detector@" + master);
+          if (!proxy) {
+            fatal("cannot use specified url to detect master");
+          }
+          proxies.push_back(proxy);
+        }
+        detector = new ProxyMasterDetector(proxies, pid);
+      }
+      break;
+    }
+
     // Mesos URL or libprocess pid.
     case UrlProcessor::MESOS:
     case UrlProcessor::UNKNOWN: {
@@ -374,7 +796,10 @@ void ZooKeeperMasterDetector::connected()
   // Assume the znode that was created does not end with a "/".
   CHECK(znode.at(znode.length() - 1) != '/');
 
-  // Create directory path znodes as necessary.
+  // Create directory path znodes as necessary (even if they already
+  // exist), all in one batch with the check below.
+  vector<ZooKeeper::Operation> operations;
+
   size_t index = znode.find(delimiter, 0);
 
   while (index < string::npos) {
@@ -384,16 +809,22 @@ void ZooKeeperMasterDetector::connected()
 
     LOG(INFO) << "Trying to create znode '" << prefix << "' in ZooKeeper";
 
-    // Create the node (even if it already exists).
-    ret = zk->create(prefix, "", acl, 0, &result);
+    operations.push_back(ZooKeeper::Operation::create(prefix, "", acl, 0));
+  }
 
+  // Wierdness in ZooKeeper timing, let's check that everything is created.
+  operations.push_back(ZooKeeper::Operation::get(znode));
+
+  zk->batch(&operations);
+
+  for (size_t i = 0; i < operations.size() - 1; i++) {
+    ret = operations[i].code;
     if (ret != ZOK && ret != ZNODEEXISTS) {
       fatal("failed to create ZooKeeper znode! (%s)", zk->message(ret));
     }
   }
 
-  // Wierdness in ZooKeeper timing, let's check that everything is created.
-  ret = zk->get(znode, false, &result, NULL);
+  ret = operations.back().code;
 
   if (ret != ZOK) {
     fatal("ZooKeeper not responding correctly (%s). "
@@ -591,3 +1022,84 @@ void ZooKeeperMasterDetector::detectMaster()
     }
   }
 }
+
+
+LogMasterDetector::LogMasterDetector(const vector<string>& masters,
+                                     const string& path,
+                                     const UPID& pid)
+{
+  set<UPID> replicas;
+  foreach (const string& master, masters) {
+    UPID replica(LOG_ELECTION_REPLICA_ID + "@" + master);
+    if (!replica) {
+      fatal("cannot use specified url to elect master");
+    }
+    replicas.insert(replica);
+  }
+
+  proxy = new MasterDetectorProxyProcess();
+  process::spawn(proxy);
+
+  process = new LogElectionProcess(replicas, path, pid, proxy->self());
+  process::spawn(process);
+}
+
+
+LogMasterDetector::~LogMasterDetector()
+{
+  process::terminate(process);
+  process::wait(process);
+  delete process;
+
+  process::terminate(proxy);
+  process::wait(proxy);
+  delete proxy;
+}
+
+
+MasterDetectorProxy::MasterDetectorProxy(const string& url, bool quiet)
+{
+  process = new MasterDetectorProxyProcess();
+  process::spawn(process);
+
+  detector = MasterDetector::create(url, process->self(), false, quiet);
+}
+
+
+MasterDetectorProxy::~MasterDetectorProxy()
+{
+  MasterDetector::destroy(detector);
+
+  process::terminate(process);
+  process::wait(process);
+  delete process;
+}
+
+
+UPID MasterDetectorProxy::self() const
+{
+  return process->self();
+}
+
+
+ProxyMasterDetector::ProxyMasterDetector(const UPID& proxy, const UPID& pid)
+{
+  process = new ProxySubscriberProcess(vector<UPID>(1, proxy), pid);
+  process::spawn(process);
+}
+
+
+ProxyMasterDetector::ProxyMasterDetector(const vector<UPID>& proxies,
+                                         const UPID& pid)
+{
+  process = new ProxySubscriberProcess(proxies, pid);
+  process::spawn(process);
+}
+
+
+ProxyMasterDetector::~ProxyMasterDetector()
+{
+  process::terminate(process);
+  process::wait(process);
+  delete process;
+}
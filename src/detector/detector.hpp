@@ -21,6 +21,7 @@
 
 #include <string>
 #include <iostream>
+#include <vector>
 #include <unistd.h>
 #include <climits>
 #include <cstdlib>
@@ -30,6 +31,10 @@
 
 namespace mesos { namespace internal {
 
+// Forward declarations.
+class MasterDetectorProxyProcess;
+class ProxySubscriberProcess;
+
 /**
  * Implements functionality for:
  *   a) detecting masters
@@ -46,7 +51,8 @@ public:
    * master detector sends messages to the specified pid when a new
    * master is elected, a master is lost, etc.
    *
-   * @param url string possibly containing zoo://, zoofile://, mesos://
+   * @param url string possibly containing zoo://, zoofile://, mesos://,
+   *   proxy://, log://
    * @param pid libprocess pid to both receive our messages and be
    *   used if we should contend
    * @param contend true if should contend to be master
@@ -101,6 +107,68 @@ private:
   const process::UPID master;
 };
 
+
+/**
+ * Shares one master detector (and thus one ZooKeeper session) among
+ * all the processes on a host, so that the load on ZooKeeper scales
+ * with the number of hosts rather than the number of processes. The
+ * proxy detects the master using the specified url and sends the
+ * master detector messages on to every process that subscribed to it
+ * (see ProxyMasterDetector), i.e., that detects the master using the
+ * url proxy://<pid of the proxy>.
+ */
+class MasterDetectorProxy
+{
+public:
+  /**
+   * @param url string containing zoo://, zoofile://, mesos:// or log://
+   * @param quiet true if should limit log output
+   */
+  MasterDetectorProxy(const std::string& url, bool quiet = true);
+
+  ~MasterDetectorProxy();
+
+  /**
+   * @return the pid to subscribe to (see ProxyMasterDetector)
+   */
+  process::UPID self() const;
+
+private:
+  MasterDetectorProxyProcess* process;
+  MasterDetector* detector;
+};
+
+
+class ProxyMasterDetector : public MasterDetector
+{
+public:
+  /**
+   * Subscribes the specified pid to a master detector proxy (and
+   * subscribes it again whenever the proxy has to be reconnected).
+   *
+   * @param proxy libprocess pid of the proxy (see MasterDetectorProxy)
+   * @param pid libprocess pid to send messages/updates to
+   */
+  ProxyMasterDetector(const process::UPID& proxy, const process::UPID& pid);
+
+  /**
+   * Subscribes the specified pid to one of the specified master
+   * detector proxies, moving on to the next of them whenever the
+   * current one is lost (e.g., the proxies of all the masters when
+   * they elect a master using the replicated log).
+   *
+   * @param proxies libprocess pids of the proxies
+   * @param pid libprocess pid to send messages/updates to
+   */
+  ProxyMasterDetector(const std::vector<process::UPID>& proxies,
+                      const process::UPID& pid);
+
+  virtual ~ProxyMasterDetector();
+
+private:
+  ProxySubscriberProcess* process;
+};
+
 }} // namespace mesos { namespace internal {
 
 #endif // __MASTER_DETECTOR_HPP__
@@ -111,6 +111,12 @@ pair<UrlProcessor::URLType, string> UrlProcessor::process(const string &url)
   } else if (urlCap.find("MESOS://") == 0) {
     return pair<UrlProcessor::URLType, string>(UrlProcessor::MESOS,
                                                url.substr(8, 1024));
+  } else if (urlCap.find("PROXY://") == 0) {
+    return pair<UrlProcessor::URLType, string>(UrlProcessor::PROXY,
+                                               url.substr(8, 1024));
+  } else if (urlCap.find("LOG://") == 0) {
+    return pair<UrlProcessor::URLType, string>(UrlProcessor::LOG,
+                                               url.substr(6, 1024));
   } else {
     return pair<UrlProcessor::URLType, string>(UrlProcessor::UNKNOWN, url);
   }
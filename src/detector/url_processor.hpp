@@ -28,7 +28,7 @@ namespace internal {
 class UrlProcessor {
       
 public:
-  enum URLType { ZOO, MESOS, UNKNOWN };
+  enum URLType { ZOO, MESOS, PROXY, LOG, UNKNOWN };
   
   static std::string parseZooFile(const std::string &zooFilename);
   
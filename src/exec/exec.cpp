@@ -23,16 +23,21 @@
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <vector>
 
 #include <mesos/executor.hpp>
 
 #include <process/dispatch.hpp>
 #include <process/process.hpp>
 #include <process/protobuf.hpp>
+#include <process/timer.hpp>
 
 #include "common/fatal.hpp"
+#include "common/foreach.hpp"
+#include "common/hashmap.hpp"
 #include "common/lock.hpp"
 #include "common/logging.hpp"
+#include "common/tracer.hpp"
 #include "common/type_utils.hpp"
 #include "common/utils.hpp"
 #include "common/uuid.hpp"
@@ -45,10 +50,25 @@ using namespace mesos::internal;
 using namespace process;
 
 using std::string;
+using std::vector;
 
 using process::wait; // Necessary on some OS's to disambiguate.
 
 
+// When status updates get batched, the most seconds an update waits
+// for others to be sent along with it, and the most updates sent in
+// one message.
+static const double STATUS_UPDATE_BATCH_INTERVAL_SECONDS = 0.005;
+static const int STATUS_UPDATE_BATCH_SIZE = 100;
+
+// While a slave that checkpoints its state is restarting, the seconds
+// between attempts to re-register with it and the most seconds to
+// wait for it to come back (a bit longer than the master waits for a
+// slave that stopped responding).
+static const double SLAVE_REREGISTER_INTERVAL_SECONDS = 1.0;
+static const double SLAVE_RECONNECT_TIMEOUT_SECONDS = 90.0;
+
+
 namespace mesos {
 namespace internal {
 
@@ -61,6 +81,8 @@ public:
                   const FrameworkID& _frameworkId,
                   const ExecutorID& _executorId,
                   bool _local,
+                  bool _direct,
+                  bool _batch,
                   const std::string& _directory)
     : slave(_slave),
       driver(_driver),
@@ -68,17 +90,36 @@ public:
       frameworkId(_frameworkId),
       executorId(_executorId),
       local(_local),
+      direct(_direct),
+      batch(_batch),
       aborted(false),
+      checkpoint(false),
+      connected(true),
       directory(_directory)
   {
     install<ExecutorRegisteredMessage>(
         &ExecutorProcess::registered,
-        &ExecutorRegisteredMessage::args);
+        &ExecutorRegisteredMessage::args,
+        &ExecutorRegisteredMessage::framework_pid,
+        &ExecutorRegisteredMessage::checkpoint);
+
+    install<ExecutorReregisteredMessage>(
+        &ExecutorProcess::reregistered,
+        &ExecutorReregisteredMessage::slave_id);
+
+    install<UpdateFrameworkMessage>(
+        &ExecutorProcess::updateFramework,
+        &UpdateFrameworkMessage::framework_id,
+        &UpdateFrameworkMessage::pid);
 
     install<RunTaskMessage>(
         &ExecutorProcess::runTask,
         &RunTaskMessage::task);
 
+    install<RunTasksMessage>(
+        &ExecutorProcess::runTasks,
+        &RunTasksMessage::tasks);
+
     install<KillTaskMessage>(
         &ExecutorProcess::killTask,
         &KillTaskMessage::task_id);
@@ -92,6 +133,8 @@ public:
 
     install<ShutdownExecutorMessage>(
         &ExecutorProcess::shutdown);
+
+    route("trace", &tracer::serve);
   }
 
   virtual ~ExecutorProcess() {}
@@ -107,10 +150,19 @@ protected:
     RegisterExecutorMessage message;
     message.mutable_framework_id()->MergeFrom(frameworkId);
     message.mutable_executor_id()->MergeFrom(executorId);
+    message.set_direct(direct);
+    message.set_batches(true);
     send(slave, message);
   }
 
-  void registered(const ExecutorArgs& args)
+  virtual void finalize()
+  {
+    flushStatusUpdates();
+  }
+
+  void registered(const ExecutorArgs& args,
+                  const string& pid,
+                  bool _checkpoint)
   {
     if (aborted) {
       VLOG(1) << "Ignoring registered message because the driver is aborted!";
@@ -120,9 +172,72 @@ protected:
     VLOG(1) << "Executor registered on slave " << args.slave_id();
 
     slaveId = args.slave_id();
+    checkpoint = _checkpoint;
+
+    if (direct && pid != "") {
+      connect(pid);
+    }
+
     executor->init(driver, args);
   }
 
+  void reregistered(const SlaveID& slaveId)
+  {
+    if (aborted) {
+      VLOG(1) << "Ignoring re-registered message because "
+              << "the driver is aborted!";
+      return;
+    }
+
+    VLOG(1) << "Executor re-registered on slave " << slaveId;
+
+    connected = true;
+
+    // Send the status updates held while the slave was gone.
+    flushStatusUpdates();
+  }
+
+  // Tries to re-register with the slave until it's back.
+  void reregister()
+  {
+    if (connected || aborted) {
+      return;
+    }
+
+    link(slave);
+
+    ReregisterExecutorMessage message;
+    message.mutable_framework_id()->MergeFrom(frameworkId);
+    message.mutable_executor_id()->MergeFrom(executorId);
+    message.set_direct(direct);
+    message.set_batches(true);
+    send(slave, message);
+
+    delay(SLAVE_REREGISTER_INTERVAL_SECONDS,
+          self(), &ExecutorProcess::reregister);
+  }
+
+  void reconnectTimeout(double time)
+  {
+    if (!connected && !aborted && disconnected == time) {
+      VLOG(1) << "Slave did not come back, trying to shutdown";
+      slaveLost();
+    }
+  }
+
+  void updateFramework(const FrameworkID& frameworkId, const string& pid)
+  {
+    if (aborted) {
+      VLOG(1) << "Ignoring update framework message because "
+              << "the driver is aborted!";
+      return;
+    }
+
+    if (direct) {
+      connect(pid);
+    }
+  }
+
   void runTask(const TaskDescription& task)
   {
     if (aborted) {
@@ -132,7 +247,42 @@ protected:
 
     VLOG(1) << "Executor asked to run task '" << task.task_id() << "'";
 
+    const double started = Clock::now();
+
+    if (task.has_trace_id()) {
+      traces[task.task_id()] = task.trace_id();
+    }
+
     executor->launchTask(driver, task);
+
+    tracer::record(task.trace_id(), task.task_id(), "executor/launch",
+                   started, Clock::now());
+  }
+
+  void runTasks(const vector<TaskDescription>& tasks)
+  {
+    if (aborted) {
+      VLOG(1) << "Ignore run tasks message because the driver is aborted!";
+      return;
+    }
+
+    VLOG(1) << "Executor asked to run " << tasks.size() << " tasks";
+
+    const double started = Clock::now();
+
+    foreach (const TaskDescription& task, tasks) {
+      if (task.has_trace_id()) {
+        traces[task.task_id()] = task.trace_id();
+      }
+    }
+
+    executor->launchTasks(driver, tasks);
+
+    const double now = Clock::now();
+    foreach (const TaskDescription& task, tasks) {
+      tracer::record(task.trace_id(), task.task_id(), "executor/launch",
+                     started, now);
+    }
   }
 
   void killTask(const TaskID& taskId)
@@ -173,6 +323,9 @@ protected:
 
     // TODO(benh): Any need to invoke driver.stop?
     executor->shutdown(driver);
+
+    // Don't lose the updates sent while shutting down.
+    flushStatusUpdates();
     if (!local) {
       exit(0);
     } else {
@@ -193,8 +346,35 @@ protected:
       return;
     }
 
+    if (pid == framework && pid != slave) {
+      // Go back to sending framework messages through the slave
+      // until the scheduler fails over.
+      VLOG(1) << "Lost the connection to the scheduler at " << pid;
+      framework = UPID();
+      return;
+    }
+
+    // A slave that checkpoints its state keeps track of us while it
+    // restarts, so wait for it to come back (any exits seen while
+    // trying to reach it again are expected).
+    if (checkpoint) {
+      if (connected) {
+        VLOG(1) << "Slave exited, waiting for it to restart";
+        connected = false;
+        disconnected = Clock::now();
+        reregister();
+        delay(SLAVE_RECONNECT_TIMEOUT_SECONDS,
+              self(), &ExecutorProcess::reconnectTimeout, disconnected);
+      }
+      return;
+    }
+
     VLOG(1) << "Slave exited, trying to shutdown";
+    slaveLost();
+  }
 
+  void slaveLost()
+  {
     // TODO: Pass an argument to shutdown to tell it this is abnormal?
     executor->shutdown(driver);
 
@@ -212,15 +392,60 @@ protected:
 
   void sendStatusUpdate(const TaskStatus& status)
   {
-    StatusUpdateMessage message;
-    StatusUpdate* update = message.mutable_update();
-    update->mutable_framework_id()->MergeFrom(frameworkId);
-    update->mutable_executor_id()->MergeFrom(executorId);
-    update->mutable_slave_id()->MergeFrom(slaveId);
-    update->mutable_status()->MergeFrom(status);
-    update->set_timestamp(Clock::now());
-    update->set_uuid(UUID::random().toBytes());
-    send(slave, message);
+    StatusUpdate update;
+    update.mutable_framework_id()->MergeFrom(frameworkId);
+    update.mutable_executor_id()->MergeFrom(executorId);
+    update.mutable_slave_id()->MergeFrom(slaveId);
+    update.mutable_status()->MergeFrom(status);
+    update.set_timestamp(Clock::coarse());
+    update.set_uuid(UUID::random().toBytes());
+
+    // Let the slave, master and scheduler trace the update too.
+    if (traces.contains(status.task_id())) {
+      update.set_trace_id(traces[status.task_id()]);
+      if (status.state() == TASK_FINISHED ||
+          status.state() == TASK_FAILED ||
+          status.state() == TASK_KILLED ||
+          status.state() == TASK_LOST) {
+        traces.erase(status.task_id());
+      }
+    }
+
+    if (!batch && connected) {
+      StatusUpdateMessage message;
+      message.mutable_update()->MergeFrom(update);
+      send(slave, message);
+      return;
+    }
+
+    // Hold on to the update for a bit in case more follow, unless
+    // the batch is full.
+    if (pendingUpdates.updates_size() == 0) {
+      delay(STATUS_UPDATE_BATCH_INTERVAL_SECONDS,
+            self(), &ExecutorProcess::flushStatusUpdates);
+    }
+
+    pendingUpdates.add_updates()->MergeFrom(update);
+
+    if (pendingUpdates.updates_size() >= STATUS_UPDATE_BATCH_SIZE) {
+      flushStatusUpdates();
+    }
+  }
+
+  void flushStatusUpdates()
+  {
+    // Hold on to the updates while the slave is restarting.
+    if (pendingUpdates.updates_size() == 0 || !connected) {
+      return;
+    } else if (pendingUpdates.updates_size() == 1) {
+      StatusUpdateMessage message;
+      message.mutable_update()->MergeFrom(pendingUpdates.updates(0));
+      send(slave, message);
+    } else {
+      send(slave, pendingUpdates);
+    }
+
+    pendingUpdates.Clear();
   }
 
   void sendFrameworkMessage(const string& data)
@@ -230,21 +455,49 @@ protected:
     message.mutable_framework_id()->MergeFrom(frameworkId);
     message.mutable_executor_id()->MergeFrom(executorId);
     message.set_data(data);
-    send(slave, message);
+    send(framework ? framework : slave, message);
   }
 
 private:
   friend class mesos::MesosExecutorDriver;
 
+  // Starts sending framework messages straight to the scheduler, and
+  // tells it where to send its framework messages for this executor.
+  void connect(const UPID& pid)
+  {
+    VLOG(1) << "Talking to the scheduler at " << pid << " directly";
+
+    framework = pid;
+    link(framework);
+
+    ExecutorChannelMessage message;
+    message.mutable_slave_id()->MergeFrom(slaveId);
+    message.mutable_framework_id()->MergeFrom(frameworkId);
+    message.mutable_executor_id()->MergeFrom(executorId);
+    send(framework, message);
+  }
+
   UPID slave;
+  UPID framework; // Set while talking to the scheduler directly.
   MesosExecutorDriver* driver;
   Executor* executor;
   FrameworkID frameworkId;
   ExecutorID executorId;
   SlaveID slaveId;
   bool local;
+  bool direct;
+  bool batch;
   bool aborted;
+  bool checkpoint; // Whether the slave checkpoints its state.
+  bool connected; // Unset while waiting for the slave to restart.
+  double disconnected; // When the slave exited.
   const std::string directory;
+
+  // Status updates waiting to be sent (when batched).
+  StatusUpdatesMessage pendingUpdates;
+
+  // Trace ids of the (traced) tasks that are running.
+  hashmap<TaskID, uint64_t> traces;
 };
 
 } // namespace internal {
@@ -304,6 +557,8 @@ Status MesosExecutorDriver::start()
   setvbuf(stderr, 0, _IOLBF, 0);
 
   bool local;
+  bool direct;
+  bool batch;
 
   UPID slave;
   FrameworkID frameworkId;
@@ -322,6 +577,26 @@ Status MesosExecutorDriver::start()
     local = false;
   }
 
+  /* Check if framework messages should skip the slave, which a
+     framework can ask for with the "env.MESOS_DIRECT_MESSAGES"
+     executor param. */
+  value = getenv("MESOS_DIRECT_MESSAGES");
+
+  if (value != NULL && string(value) != "0") {
+    direct = true;
+  } else {
+    direct = false;
+  }
+
+  /* Check if status updates should get batched. */
+  value = getenv("MESOS_BATCH_STATUS_UPDATES");
+
+  if (value != NULL && string(value) != "0") {
+    batch = true;
+  } else {
+    batch = false;
+  }
+
   /* Get slave PID from environment. */
   value = getenv("MESOS_SLAVE_PID");
 
@@ -366,7 +641,8 @@ Status MesosExecutorDriver::start()
 
   process =
     new ExecutorProcess(slave, this, executor, frameworkId,
-                        executorId, local, workDirectory);
+                        executorId, local, direct, batch,
+                        workDirectory);
 
   spawn(process);
 
@@ -17,17 +17,27 @@
  */
 
 #include <jni.h>
+#include <stdarg.h>
 
 #include <string>
+#include <vector>
 #include <assert.h>
 
+#include <google/protobuf/io/coded_stream.h>
+
 #include <mesos/mesos.hpp>
 
 #include "convert.hpp"
 
+#include "common/foreach.hpp"
+
 using namespace mesos;
 
+using google::protobuf::uint8;
+using google::protobuf::io::CodedOutputStream;
+
 using std::string;
+using std::vector;
 
 // Facilities for loading Mesos-related classes with the correct
 // ClassLoader. Unfortunately, JNI's FindClass uses the system
@@ -98,6 +108,147 @@ jclass FindMesosClass(JNIEnv* env, const char* className)
   return cls;
 }
 
+
+// A static method of a Mesos class, looked up once (the class gets
+// held on to with a global reference) rather than on every call.
+// Everything gets looked up in JNI_OnLoad if possible, or else the
+// first time the method gets called.
+class StaticMethod
+{
+public:
+  StaticMethod(const char* _className,
+               const char* _name,
+               const char* _signature)
+    : className(_className),
+      name(_name),
+      signature(_signature),
+      clazz(NULL),
+      method(NULL) {}
+
+  bool resolve(JNIEnv* env)
+  {
+    if (clazz != NULL) {
+      return true;
+    }
+
+    jclass local = FindMesosClass(env, className);
+    if (local == NULL) {
+      return false;
+    }
+
+    method = env->GetStaticMethodID(local, name, signature);
+    if (method == NULL) {
+      env->DeleteLocalRef(local);
+      return false;
+    }
+
+    // N.B. The method must be set before the class, which is what
+    // other threads check.
+    clazz = (jclass) env->NewGlobalRef(local);
+    env->DeleteLocalRef(local);
+    return true;
+  }
+
+  void release(JNIEnv* env)
+  {
+    if (clazz != NULL) {
+      env->DeleteGlobalRef(clazz);
+      clazz = NULL;
+      method = NULL;
+    }
+  }
+
+  jobject call(JNIEnv* env, ...)
+  {
+    if (!resolve(env)) {
+      return NULL;
+    }
+
+    va_list args;
+    va_start(args, env);
+    jobject result = env->CallStaticObjectMethodV(clazz, method, args);
+    va_end(args);
+    return result;
+  }
+
+private:
+  const char* className;
+  const char* name;
+  const char* signature;
+  jclass volatile clazz;
+  jmethodID method;
+};
+
+
+#define PROTOBUF_PARSE_FROM(T)                                  \
+  StaticMethod T##ParseFrom("org/apache/mesos/Protos$" #T,      \
+                            "parseFrom",                        \
+                            "([B)Lorg/apache/mesos/Protos$" #T ";")
+
+PROTOBUF_PARSE_FROM(FrameworkID);
+PROTOBUF_PARSE_FROM(ExecutorID);
+PROTOBUF_PARSE_FROM(TaskID);
+PROTOBUF_PARSE_FROM(SlaveID);
+PROTOBUF_PARSE_FROM(OfferID);
+PROTOBUF_PARSE_FROM(TaskDescription);
+PROTOBUF_PARSE_FROM(TaskStatus);
+PROTOBUF_PARSE_FROM(Offer);
+PROTOBUF_PARSE_FROM(ExecutorInfo);
+PROTOBUF_PARSE_FROM(ExecutorArgs);
+
+#undef PROTOBUF_PARSE_FROM
+
+StaticMethod TaskStateValueOf("org/apache/mesos/Protos$TaskState",
+                              "valueOf",
+                              "(I)Lorg/apache/mesos/Protos$TaskState;");
+
+StaticMethod StatusValueOf("org/apache/mesos/Protos$Status",
+                           "valueOf",
+                           "(I)Lorg/apache/mesos/Protos$Status;");
+
+StaticMethod MesosSchedulerDriverParseOffers(
+    "org/apache/mesos/MesosSchedulerDriver",
+    "parseOffers",
+    "([B)Ljava/util/List;");
+
+StaticMethod* methods[] = {
+  &FrameworkIDParseFrom,
+  &ExecutorIDParseFrom,
+  &TaskIDParseFrom,
+  &SlaveIDParseFrom,
+  &OfferIDParseFrom,
+  &TaskDescriptionParseFrom,
+  &TaskStatusParseFrom,
+  &OfferParseFrom,
+  &ExecutorInfoParseFrom,
+  &ExecutorArgsParseFrom,
+  &TaskStateValueOf,
+  &StatusValueOf,
+  &MesosSchedulerDriverParseOffers
+};
+
+
+// Converts a C++ protobuf into a Java protobuf, serializing it
+// straight into the byte[] that gets parsed by the Java side.
+jobject parse(JNIEnv* env,
+              StaticMethod& parseFrom,
+              const google::protobuf::Message& message)
+{
+  // byte[] data = ..;
+  const int size = message.ByteSize();
+  jbyteArray jdata = env->NewByteArray(size);
+
+  uint8* data = (uint8*) env->GetPrimitiveArrayCritical(jdata, NULL);
+  message.SerializeWithCachedSizesToArray(data);
+  env->ReleasePrimitiveArrayCritical(jdata, data, 0);
+
+  jobject jmessage = parseFrom.call(env, jdata);
+
+  env->DeleteLocalRef(jdata);
+
+  return jmessage;
+}
+
 } // namespace {
 
 
@@ -134,6 +285,15 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* jvm, void* reserved)
     mesosClassLoader = env->NewWeakGlobalRef(classLoader);
   }
 
+  // Look up the methods used for converting now, rather than on
+  // every conversion. Any that can't be found yet get looked up when
+  // they're first used.
+  for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+    if (!methods[i]->resolve(env)) {
+      env->ExceptionClear();
+    }
+  }
+
   return JNI_VERSION_1_2;
 }
 
@@ -146,6 +306,10 @@ JNIEXPORT void JNICALL JNI_OnUnLoad(JavaVM* jvm, void* reserved)
     return;
   }
 
+  for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+    methods[i]->release(env);
+  }
+
   if (mesosClassLoader != NULL) {
     env->DeleteWeakGlobalRef(mesosClassLoader);
     mesosClassLoader = NULL;
@@ -163,262 +327,131 @@ jobject convert(JNIEnv* env, const string& s)
 template <>
 jobject convert(JNIEnv* env, const FrameworkID& frameworkId)
 {
-  string data;
-  frameworkId.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // FrameworkID frameworkId = FrameworkID.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$FrameworkID");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$FrameworkID;");
-
-  jobject jframeworkId = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jframeworkId;
+  return parse(env, FrameworkIDParseFrom, frameworkId);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const ExecutorID& executorId)
 {
-  string data;
-  executorId.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // ExecutorID executorId = ExecutorID.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$ExecutorID");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$ExecutorID;");
-
-  jobject jexecutorId = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jexecutorId;
+  return parse(env, ExecutorIDParseFrom, executorId);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const TaskID& taskId)
 {
-  string data;
-  taskId.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // TaskID taskId = TaskID.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$TaskID");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$TaskID;");
-
-  jobject jtaskId = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jtaskId;
+  return parse(env, TaskIDParseFrom, taskId);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const SlaveID& slaveId)
 {
-  string data;
-  slaveId.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // SlaveID slaveId = SlaveID.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$SlaveID");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$SlaveID;");
-
-  jobject jslaveId = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jslaveId;
+  return parse(env, SlaveIDParseFrom, slaveId);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const OfferID& offerId)
 {
-  string data;
-  offerId.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // OfferID offerId = OfferID.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$OfferID");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$OfferID;");
-
-  jobject jofferId = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jofferId;
-}
-
-
-template <>
-jobject convert(JNIEnv* env, const TaskState& state)
-{
-  jint jvalue = state;
-
-  // TaskState state = TaskState.valueOf(value);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$TaskState");
-
-  jmethodID valueOf =
-    env->GetStaticMethodID(clazz, "valueOf",
-                           "(I)Lorg/apache/mesos/Protos$TaskState;");
-
-  jobject jstate = env->CallStaticObjectMethod(clazz, valueOf, jvalue);
-
-  return jstate;
+  return parse(env, OfferIDParseFrom, offerId);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const TaskDescription& task)
 {
-  string data;
-  task.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // TaskDescription task = TaskDescription.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$TaskDescription");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$TaskDescription;");
-
-  jobject jtask = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jtask;
+  return parse(env, TaskDescriptionParseFrom, task);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const TaskStatus& status)
 {
-  string data;
-  status.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // TaskStatus status = TaskStatus.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$TaskStatus");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$TaskStatus;");
-
-  jobject jstatus = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jstatus;
+  return parse(env, TaskStatusParseFrom, status);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const Offer& offer)
 {
-  string data;
-  offer.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
   // Offer offer = Offer.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$Offer");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$Offer;");
-
-  jobject joffer = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return joffer;
+  return parse(env, OfferParseFrom, offer);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const ExecutorInfo& executor)
 {
-  string data;
-  executor.SerializeToString(&data);
+  // ExecutorInfo executor = ExecutorInfo.parseFrom(data);
+  return parse(env, ExecutorInfoParseFrom, executor);
+}
 
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
 
-  // ExecutorInfo executor = ExecutorInfo.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$ExecutorInfo");
+template <>
+jobject convert(JNIEnv* env, const ExecutorArgs& args)
+{
+  // ExecutorArgs args = ExecutorArgs.parseFrom(data);
+  return parse(env, ExecutorArgsParseFrom, args);
+}
 
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$ExecutorInfo;");
 
-  jobject jexecutor = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
+template <>
+jobject convert(JNIEnv* env, const TaskState& state)
+{
+  jint jvalue = state;
 
-  return jexecutor;
+  // TaskState state = TaskState.valueOf(value);
+  return TaskStateValueOf.call(env, jvalue);
 }
 
 
 template <>
-jobject convert(JNIEnv* env, const ExecutorArgs& args)
+jobject convert(JNIEnv* env, const vector<Offer>& offers)
 {
-  string data;
-  args.SerializeToString(&data);
+  // Serialize all of the offers (each prefixed by its size) into a
+  // single byte[] so that they get copied and parsed in one go.
+  int size = 0;
+  foreach (const Offer& offer, offers) {
+    size += CodedOutputStream::VarintSize32(offer.ByteSize()) +
+      offer.GetCachedSize();
+  }
 
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
+  jbyteArray jdata = env->NewByteArray(size);
 
-  // ExecutorArgs args = ExecutorArgs.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$ExecutorArgs");
+  uint8* start = (uint8*) env->GetPrimitiveArrayCritical(jdata, NULL);
+  uint8* data = start;
+
+  foreach (const Offer& offer, offers) {
+    data = CodedOutputStream::WriteVarint32ToArray(
+        offer.GetCachedSize(), data);
+    data = offer.SerializeWithCachedSizesToArray(data);
+  }
+
+  env->ReleasePrimitiveArrayCritical(jdata, start, 0);
 
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$ExecutorArgs;");
+  // List offers = MesosSchedulerDriver.parseOffers(data);
+  jobject joffers = MesosSchedulerDriverParseOffers.call(env, jdata);
 
-  jobject jargs = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
+  env->DeleteLocalRef(jdata);
 
-  return jargs;
+  return joffers;
 }
 
+
 template <>
 jobject convert(JNIEnv* env, const Status& status)
 {
   jint jvalue = status;
 
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$Status");
-
-  jmethodID valueOf =
-    env->GetStaticMethodID(clazz, "valueOf",
-                           "(I)Lorg/apache/mesos/Protos$Status;");
-
-  jobject jstate = env->CallStaticObjectMethod(clazz, valueOf, jvalue);
-
-  return jstate;
+  // Status status = Status.valueOf(value);
+  return StatusValueOf.call(env, jvalue);
 }
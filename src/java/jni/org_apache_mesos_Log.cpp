@@ -17,6 +17,15 @@
  */
 
 #include <jni.h>
+#include <string.h>
+
+#include <list>
+#include <string>
+
+#include <process/future.hpp>
+#include <process/timeout.hpp>
+
+#include "common/lambda.hpp"
 
 #include "log/log.hpp"
 
@@ -25,17 +34,89 @@
 #include "org_apache_mesos_Log.h"
 #include "org_apache_mesos_Log_Reader.h"
 #include "org_apache_mesos_Log_Writer.h"
-#include "org_apache_mesos_Log_Writer.h"
 
 using namespace mesos;
 using namespace mesos::internal::log;
 
+using process::Future;
+
+
+namespace {
+
+// An exception class and its constructor taking a message.
+struct Exception
+{
+  jclass clazz;
+  jmethodID _init_;
+};
+
+
+// The classes, methods and fields used below, looked up once (see
+// Log.initializeClass) rather than on every call. This also lets the
+// asynchronous operations get completed from libprocess threads, on
+// which FindClass can't find the Mesos classes.
+struct Cache
+{
+  JavaVM* jvm;
+
+  jclass Log;
+  jfieldID Log__log;
+  jmethodID LogParseEntries;
+
+  jclass Position;
+  jmethodID Position_init_;
+  jfieldID PositionValue;
+
+  jfieldID Reader__log;
+  jfieldID Reader__reader;
+
+  jfieldID Writer__log;
+  jfieldID Writer__writer;
+
+  jmethodID OperationSet;
+  jmethodID OperationFail;
+
+  jmethodID TimeUnitToSeconds;
+
+  Exception OperationFailedException;
+  Exception WriterFailedException;
+  Exception TimeoutException;
+} cache;
+
+
+jclass global(JNIEnv* env, const char* name)
+{
+  jclass local = env->FindClass(name);
+  CHECK(local != NULL) << "Failed to find class " << name;
+  jclass clazz = (jclass) env->NewGlobalRef(local);
+  env->DeleteLocalRef(local);
+  return clazz;
+}
+
+
+Exception exception(JNIEnv* env, const char* name)
+{
+  Exception exception;
+  exception.clazz = global(env, name);
+  exception._init_ =
+    env->GetMethodID(exception.clazz, "<init>", "(Ljava/lang/String;)V");
+  return exception;
+}
+
+
+// Returns the timeout in seconds, i.e., unit.toSeconds(timeout).
+seconds toSeconds(JNIEnv* env, jlong jtimeout, jobject junit)
+{
+  jlong jseconds =
+    env->CallLongMethod(junit, cache.TimeUnitToSeconds, jtimeout);
+
+  return seconds(jseconds);
+}
+
 
 std::string identity(JNIEnv* env, jobject jposition)
 {
-  jclass clazz = env->GetObjectClass(jposition);
-  jfieldID value = env->GetFieldID(clazz, "value", "J");
-  jlong jvalue = env->GetLongField(jposition, value);
+  jlong jvalue = env->GetLongField(jposition, cache.PositionValue);
 
   uint64_t temp = jvalue; // C++ is expecting an unsigned 64-bit int.
 
@@ -52,6 +133,8 @@ std::string identity(JNIEnv* env, jobject jposition)
   return std::string(bytes, sizeof(bytes));
 }
 
+} // namespace {
+
 
 template <>
 jobject convert(JNIEnv* env, const Log::Position& position)
@@ -74,42 +157,158 @@ jobject convert(JNIEnv* env, const Log::Position& position)
 
   // We can create a Java Log.Position directly because JNI does not
   // enforce access modifiers (thus breaking encapsulation).
-  jclass clazz = env->FindClass("org/apache/mesos/Log$Position");
-
-  jmethodID _init_ = env->GetMethodID(clazz, "<init>", "(J)V");
-
-  jobject jposition = env->NewObject(clazz, _init_, jvalue);
+  jobject jposition =
+    env->NewObject(cache.Position, cache.Position_init_, jvalue);
 
   return jposition;
 }
 
 
 template <>
-jobject convert(JNIEnv* env, const Log::Entry& entry)
+jobject convert(JNIEnv* env, const std::list<Log::Entry>& entries)
 {
-  jobject jposition = convert<Log::Position>(env, entry.position);
+  // Serialize the entries (see Log.parseEntries) into one byte[] so
+  // they get copied to Java at once, rather than creating the list
+  // and each entry (and its byte[]) with calls from here.
+  size_t size = 0;
+  foreach (const Log::Entry& entry, entries) {
+    size += 8 + 4 + entry.data.size();
+  }
 
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(entry.data.size());
-  env->SetByteArrayRegion(jdata, 0, entry.data.size(),
-                          (jbyte*) entry.data.data());
+  jbyteArray jdata = env->NewByteArray(size);
 
-  // We can create a Java Log.Entry directly because JNI does not
-  // enforce access modifiers (thus breaking encapsulation).
-  jclass clazz = env->FindClass("org/apache/mesos/Log$Entry");
+  char* data = (char*) env->GetPrimitiveArrayCritical(jdata, NULL);
 
-  jmethodID _init_ = env->GetMethodID(clazz, "<init>",
-                                      "(Lorg/apache/mesos/Log$Position;"
-                                      "[B)V");
+  foreach (const Log::Entry& entry, entries) {
+    const std::string& identity = entry.position.identity();
+    memcpy(data, identity.data(), 8); // Already big-endian.
+    data += 8;
 
-  jobject jentry = env->NewObject(clazz, _init_, jposition, jdata);
+    const uint32_t length = entry.data.size();
+    data[0] = (0xff & (length >> 24));
+    data[1] = (0xff & (length >> 16));
+    data[2] = (0xff & (length >> 8));
+    data[3] = (0xff & length);
+    data += 4;
+
+    memcpy(data, entry.data.data(), entry.data.size());
+    data += entry.data.size();
+  }
 
-  return jentry;
+  env->ReleasePrimitiveArrayCritical(jdata, data - size, 0);
+
+  jobject jentries =
+    env->CallStaticObjectMethod(cache.Log, cache.LogParseEntries, jdata);
+
+  env->DeleteLocalRef(jdata);
+
+  return jentries;
+}
+
+
+namespace {
+
+// Completes a Java Log.Operation with the result of the future, on
+// whichever thread the future completed on (attaching it to the JVM
+// if necessary). The operation fails with the specified exception if
+// the future failed, or with a TimeoutException if it was discarded.
+template <typename T>
+void complete(jobject joperation,
+              const Exception& exception,
+              const Future<T>& future)
+{
+  JNIEnv* env;
+  bool attached = false;
+
+  if (cache.jvm->GetEnv((void**) &env, JNI_VERSION_1_2) == JNI_EDETACHED) {
+    cache.jvm->AttachCurrentThread((void**) &env, NULL);
+    attached = true;
+  }
+
+  if (future.isReady()) {
+    jobject jvalue = convert<T>(env, future.get());
+    env->CallVoidMethod(joperation, cache.OperationSet, jvalue);
+  } else {
+    const Exception& e =
+      future.isFailed() ? exception : cache.TimeoutException;
+
+    jstring jmessage = env->NewStringUTF(
+        future.isFailed()
+        ? future.failure().c_str()
+        : "Timed out while attempting the operation");
+
+    jobject jexception = env->NewObject(e.clazz, e._init_, jmessage);
+    env->CallVoidMethod(joperation, cache.OperationFail, jexception);
+  }
+
+  if (env->ExceptionCheck()) {
+    env->ExceptionDescribe();
+    env->ExceptionClear();
+  }
+
+  env->DeleteGlobalRef(joperation);
+
+  if (attached) {
+    cache.jvm->DetachCurrentThread();
+  }
 }
 
+} // namespace {
+
 
 extern "C" {
 
+/*
+ * Class:     org_apache_mesos_Log
+ * Method:    initializeClass
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_org_apache_mesos_Log_initializeClass
+  (JNIEnv* env, jclass clazz)
+{
+  env->GetJavaVM(&cache.jvm);
+
+  // N.B. FindClass uses the class loader of the Log class here since
+  // we're in one of its native methods.
+  cache.Log = (jclass) env->NewGlobalRef(clazz);
+  cache.Log__log = env->GetFieldID(clazz, "__log", "J");
+  cache.LogParseEntries = env->GetStaticMethodID(
+      clazz, "parseEntries", "([B)Ljava/util/List;");
+
+  cache.Position = global(env, "org/apache/mesos/Log$Position");
+  cache.Position_init_ = env->GetMethodID(cache.Position, "<init>", "(J)V");
+  cache.PositionValue = env->GetFieldID(cache.Position, "value", "J");
+
+  jclass local = env->FindClass("org/apache/mesos/Log$Reader");
+  cache.Reader__log = env->GetFieldID(local, "__log", "J");
+  cache.Reader__reader = env->GetFieldID(local, "__reader", "J");
+  env->DeleteLocalRef(local);
+
+  local = env->FindClass("org/apache/mesos/Log$Writer");
+  cache.Writer__log = env->GetFieldID(local, "__log", "J");
+  cache.Writer__writer = env->GetFieldID(local, "__writer", "J");
+  env->DeleteLocalRef(local);
+
+  local = env->FindClass("org/apache/mesos/Log$Operation");
+  cache.OperationSet =
+    env->GetMethodID(local, "set", "(Ljava/lang/Object;)V");
+  cache.OperationFail =
+    env->GetMethodID(local, "fail", "(Ljava/lang/Exception;)V");
+  env->DeleteLocalRef(local);
+
+  local = env->FindClass("java/util/concurrent/TimeUnit");
+  cache.TimeUnitToSeconds = env->GetMethodID(local, "toSeconds", "(J)J");
+  env->DeleteLocalRef(local);
+
+  cache.OperationFailedException =
+    exception(env, "org/apache/mesos/Log$OperationFailedException");
+  cache.WriterFailedException =
+    exception(env, "org/apache/mesos/Log$WriterFailedException");
+  cache.TimeoutException =
+    exception(env, "java/util/concurrent/TimeoutException");
+}
+
+
 /*
  * Class:     org_apache_mesos_Log_Reader
  * Method:    read
@@ -124,58 +323,67 @@ JNIEXPORT jobject JNICALL Java_org_apache_mesos_Log_00024Reader_read
    jobject junit)
 {
   // Read out __reader.
-  jclass clazz = env->GetObjectClass(thiz);
-
-  jfieldID __reader = env->GetFieldID(clazz, "__reader", "J");
-
-  Log::Reader* reader = (Log::Reader*) env->GetLongField(thiz, __reader);
+  Log::Reader* reader =
+    (Log::Reader*) env->GetLongField(thiz, cache.Reader__reader);
 
   // Also need __log.
-  jfieldID __log = env->GetFieldID(clazz, "__log", "J");
-
-  Log* log = (Log*) env->GetLongField(thiz, __log);
+  Log* log = (Log*) env->GetLongField(thiz, cache.Reader__log);
 
   Log::Position from = log->position(identity(env, jfrom));
   Log::Position to = log->position(identity(env, jto));
 
-  clazz = env->GetObjectClass(junit);
-
-  // long seconds = unit.toSeconds(time);
-  jmethodID toSeconds = env->GetMethodID(clazz, "toSeconds", "(J)J");
-
-  jlong jseconds = env->CallLongMethod(junit, toSeconds, jtimeout);
-
-  seconds timeout(jseconds);
-
-  Result<std::list<Log::Entry> > entries = reader->read(from, to, timeout);
+  Result<std::list<Log::Entry> > entries =
+    reader->read(from, to, toSeconds(env, jtimeout, junit));
 
   if (entries.isError()) {
-    clazz = env->FindClass("org/apache/mesos/Log$OperationFailedException");
-    env->ThrowNew(clazz, entries.error().c_str());
+    env->ThrowNew(cache.OperationFailedException.clazz,
+                  entries.error().c_str());
     return NULL;
   } else if (entries.isNone()) {
-    clazz = env->FindClass("java/util/concurrent/TimeoutException");
-    env->ThrowNew(clazz, "Timed out while attempting to read");
+    env->ThrowNew(cache.TimeoutException.clazz,
+                  "Timed out while attempting to read");
     return NULL;
   }
 
   CHECK(entries.isSome());
 
-  // List entries = new ArrayList();
-  clazz = env->FindClass("java/util/ArrayList");
+  return convert<std::list<Log::Entry> >(env, entries.get());
+}
+
 
-  jmethodID _init_ = env->GetMethodID(clazz, "<init>", "()V");
-  jobject jentries = env->NewObject(clazz, _init_);
+/*
+ * Class:     org_apache_mesos_Log_Reader
+ * Method:    startRead
+ * Signature: (Lorg/apache/mesos/Log/Position;Lorg/apache/mesos/Log/Position;Lorg/apache/mesos/Log/Operation;)V
+ */
+JNIEXPORT void JNICALL Java_org_apache_mesos_Log_00024Reader_startRead
+  (JNIEnv* env,
+   jobject thiz,
+   jobject jfrom,
+   jobject jto,
+   jobject joperation)
+{
+  Log::Reader* reader =
+    (Log::Reader*) env->GetLongField(thiz, cache.Reader__reader);
 
-  jmethodID add = env->GetMethodID(clazz, "add", "(Ljava/lang/Object;)Z");
+  Log* log = (Log*) env->GetLongField(thiz, cache.Reader__log);
 
-  // Loop through C++ list and add each entry to the Java list.
-  foreach (const Log::Entry& entry, entries.get()) {
-    jobject jentry = convert<Log::Entry>(env, entry);
-    env->CallBooleanMethod(jentries, add, jentry);
-  }
+  Log::Position from = log->position(identity(env, jfrom));
+  Log::Position to = log->position(identity(env, jto));
 
-  return jentries;
+  // The operation gets released once it's completed.
+  joperation = env->NewGlobalRef(joperation);
+
+  void (*completed)(jobject,
+                    const Exception&,
+                    const Future<std::list<Log::Entry> >&) =
+    &complete<std::list<Log::Entry> >;
+
+  reader->read(from, to)
+    .onAny(lambda::bind(completed,
+                        joperation,
+                        cache.OperationFailedException,
+                        lambda::_1));
 }
 
 
@@ -188,11 +396,8 @@ JNIEXPORT jobject JNICALL Java_org_apache_mesos_Log_00024Reader_beginning
   (JNIEnv* env, jobject thiz)
 {
   // Read out __reader.
-  jclass clazz = env->GetObjectClass(thiz);
-
-  jfieldID __reader = env->GetFieldID(clazz, "__reader", "J");
-
-  Log::Reader* reader = (Log::Reader*) env->GetLongField(thiz, __reader);
+  Log::Reader* reader =
+    (Log::Reader*) env->GetLongField(thiz, cache.Reader__reader);
 
   Log::Position position = reader->beginning();
 
@@ -209,11 +414,8 @@ JNIEXPORT jobject JNICALL Java_org_apache_mesos_Log_00024Reader_ending
   (JNIEnv* env, jobject thiz)
 {
   // Read out __reader.
-  jclass clazz = env->GetObjectClass(thiz);
-
-  jfieldID __reader = env->GetFieldID(clazz, "__reader", "J");
-
-  Log::Reader* reader = (Log::Reader*) env->GetLongField(thiz, __reader);
+  Log::Reader* reader =
+    (Log::Reader*) env->GetLongField(thiz, cache.Reader__reader);
 
   Log::Position position = reader->ending();
 
@@ -230,22 +432,14 @@ JNIEXPORT void JNICALL Java_org_apache_mesos_Log_00024Reader_initialize
   (JNIEnv* env, jobject thiz, jobject jlog)
 {
   // Get log.__log out and store it.
-  jclass clazz = env->GetObjectClass(jlog);
-
-  jfieldID __log = env->GetFieldID(clazz, "__log", "J");
+  Log* log = (Log*) env->GetLongField(jlog, cache.Log__log);
 
-  Log* log = (Log*) env->GetLongField(jlog, __log);
-
-  clazz = env->GetObjectClass(thiz);
-
-  __log = env->GetFieldID(clazz, "__log", "J");
-  env->SetLongField(thiz, __log, (jlong) log);
+  env->SetLongField(thiz, cache.Reader__log, (jlong) log);
 
   // Create the C++ Log::Reader and initialize the __reader variable.
   Log::Reader* reader = new Log::Reader(log);
 
-  jfieldID __reader = env->GetFieldID(clazz, "__reader", "J");
-  env->SetLongField(thiz, __reader, (jlong) reader);
+  env->SetLongField(thiz, cache.Reader__reader, (jlong) reader);
 }
 
 
@@ -258,11 +452,8 @@ JNIEXPORT void JNICALL Java_org_apache_mesos_Log_00024Reader_finalize
   (JNIEnv* env, jobject thiz)
 {
   // Read out __reader.
-  jclass clazz = env->GetObjectClass(thiz);
-
-  jfieldID __reader = env->GetFieldID(clazz, "__reader", "J");
-
-  Log::Reader* reader = (Log::Reader*) env->GetLongField(thiz, __reader);
+  Log::Reader* reader =
+    (Log::Reader*) env->GetLongField(thiz, cache.Reader__reader);
 
   delete reader;
 }
@@ -277,37 +468,22 @@ JNIEXPORT jobject JNICALL Java_org_apache_mesos_Log_00024Writer_append
   (JNIEnv* env, jobject thiz, jbyteArray jdata, jlong jtimeout, jobject junit)
 {
   // Read out __writer.
-  jclass clazz = env->GetObjectClass(thiz);
-
-  jfieldID __writer = env->GetFieldID(clazz, "__writer", "J");
-
-  Log::Writer* writer = (Log::Writer*) env->GetLongField(thiz, __writer);
-
-  jbyte* temp = env->GetByteArrayElements(jdata, NULL);
-  jsize length = env->GetArrayLength(jdata);
-
-  std::string data((char*) temp, (size_t) length);
-
-  clazz = env->GetObjectClass(junit);
-
-  // long seconds = unit.toSeconds(time);
-  jmethodID toSeconds = env->GetMethodID(clazz, "toSeconds", "(J)J");
+  Log::Writer* writer =
+    (Log::Writer*) env->GetLongField(thiz, cache.Writer__writer);
 
-  jlong jseconds = env->CallLongMethod(junit, toSeconds, jtimeout);
+  std::string data(env->GetArrayLength(jdata), '\0');
+  env->GetByteArrayRegion(jdata, 0, data.size(), (jbyte*) &data[0]);
 
-  seconds timeout(jseconds);
-
-  Result<Log::Position> position = writer->append(data, timeout);
-
-  env->ReleaseByteArrayElements(jdata, temp, 0);
+  Result<Log::Position> position =
+    writer->append(data, toSeconds(env, jtimeout, junit));
 
   if (position.isError()) {
-    clazz = env->FindClass("org/apache/mesos/Log$WriterFailedException");
-    env->ThrowNew(clazz, position.error().c_str());
+    env->ThrowNew(cache.WriterFailedException.clazz,
+                  position.error().c_str());
     return NULL;
   } else if (position.isNone()) {
-    clazz = env->FindClass("java/util/concurrent/TimeoutException");
-    env->ThrowNew(clazz, "Timed out while attempting to append");
+    env->ThrowNew(cache.TimeoutException.clazz,
+                  "Timed out while attempting to append");
     return NULL;
   }
 
@@ -321,44 +497,68 @@ JNIEXPORT jobject JNICALL Java_org_apache_mesos_Log_00024Writer_append
 
 /*
  * Class:     org_apache_mesos_Log_Writer
- * Method:    truncate
- * Signature: (Lorg/apache/mesos/Log/Position;JLjava/util/concurrent/TimeUnit;)Lorg/apache/mesos/Log/Position;
+ * Method:    startAppend
+ * Signature: ([BJLjava/util/concurrent/TimeUnit;Lorg/apache/mesos/Log/Operation;)V
  */
-JNIEXPORT jobject JNICALL Java_org_apache_mesos_Log_00024Writer_truncate
-  (JNIEnv* env, jobject thiz, jobject jto, jlong jtimeout, jobject junit)
+JNIEXPORT void JNICALL Java_org_apache_mesos_Log_00024Writer_startAppend
+  (JNIEnv* env,
+   jobject thiz,
+   jbyteArray jdata,
+   jlong jtimeout,
+   jobject junit,
+   jobject joperation)
 {
-  // Read out __writer.
-  jclass clazz = env->GetObjectClass(thiz);
+  Log::Writer* writer =
+    (Log::Writer*) env->GetLongField(thiz, cache.Writer__writer);
 
-  jfieldID __writer = env->GetFieldID(clazz, "__writer", "J");
+  std::string data(env->GetArrayLength(jdata), '\0');
+  env->GetByteArrayRegion(jdata, 0, data.size(), (jbyte*) &data[0]);
 
-  Log::Writer* writer = (Log::Writer*) env->GetLongField(thiz, __writer);
+  // The operation gets released once it's completed.
+  joperation = env->NewGlobalRef(joperation);
 
-  // Also need __log.
-  jfieldID __log = env->GetFieldID(clazz, "__log", "J");
+  void (*completed)(jobject,
+                    const Exception&,
+                    const Future<Log::Position>&) =
+    &complete<Log::Position>;
 
-  Log* log = (Log*) env->GetLongField(thiz, __log);
+  const seconds timeout = toSeconds(env, jtimeout, junit);
 
-  Log::Position to = log->position(identity(env, jto));
+  writer->append(data, process::Timeout(timeout.value))
+    .onAny(lambda::bind(completed,
+                        joperation,
+                        cache.WriterFailedException,
+                        lambda::_1));
+}
 
-  clazz = env->GetObjectClass(junit);
 
-  // long seconds = unit.toSeconds(time);
-  jmethodID toSeconds = env->GetMethodID(clazz, "toSeconds", "(J)J");
+/*
+ * Class:     org_apache_mesos_Log_Writer
+ * Method:    truncate
+ * Signature: (Lorg/apache/mesos/Log/Position;JLjava/util/concurrent/TimeUnit;)Lorg/apache/mesos/Log/Position;
+ */
+JNIEXPORT jobject JNICALL Java_org_apache_mesos_Log_00024Writer_truncate
+  (JNIEnv* env, jobject thiz, jobject jto, jlong jtimeout, jobject junit)
+{
+  // Read out __writer.
+  Log::Writer* writer =
+    (Log::Writer*) env->GetLongField(thiz, cache.Writer__writer);
 
-  jlong jseconds = env->CallLongMethod(junit, toSeconds, jtimeout);
+  // Also need __log.
+  Log* log = (Log*) env->GetLongField(thiz, cache.Writer__log);
 
-  seconds timeout(jseconds);
+  Log::Position to = log->position(identity(env, jto));
 
-  Result<Log::Position> position = writer->truncate(to, timeout);
+  Result<Log::Position> position =
+    writer->truncate(to, toSeconds(env, jtimeout, junit));
 
   if (position.isError()) {
-    clazz = env->FindClass("org/apache/mesos/Log$WriterFailedException");
-    env->ThrowNew(clazz, position.error().c_str());
+    env->ThrowNew(cache.WriterFailedException.clazz,
+                  position.error().c_str());
     return NULL;
   } else if (position.isNone()) {
-    clazz = env->FindClass("java/util/concurrent/TimeoutException");
-    env->ThrowNew(clazz, "Timed out while attempting to truncate");
+    env->ThrowNew(cache.TimeoutException.clazz,
+                  "Timed out while attempting to truncate");
     return NULL;
   }
 
@@ -384,35 +584,17 @@ JNIEXPORT void JNICALL Java_org_apache_mesos_Log_00024Writer_initialize
    jint jretries)
 {
   // Get log.__log out and store it.
-  jclass clazz = env->GetObjectClass(jlog);
-
-  jfieldID __log = env->GetFieldID(clazz, "__log", "J");
-
-  Log* log = (Log*) env->GetLongField(jlog, __log);
-
-  clazz = env->GetObjectClass(thiz);
+  Log* log = (Log*) env->GetLongField(jlog, cache.Log__log);
 
-  __log = env->GetFieldID(clazz, "__log", "J");
-  env->SetLongField(thiz, __log, (jlong) log);
-
-  clazz = env->GetObjectClass(junit);
-
-  // long seconds = unit.toSeconds(time);
-  jmethodID toSeconds = env->GetMethodID(clazz, "toSeconds", "(J)J");
-
-  jlong jseconds = env->CallLongMethod(junit, toSeconds, jtimeout);
-
-  seconds timeout(jseconds);
+  env->SetLongField(thiz, cache.Writer__log, (jlong) log);
 
   int retries = jretries;
 
   // Create the C++ Log::Writer and initialize the __writer variable.
-  Log::Writer* writer = new Log::Writer(log, timeout, retries);
-
-  clazz = env->GetObjectClass(thiz);
+  Log::Writer* writer =
+    new Log::Writer(log, toSeconds(env, jtimeout, junit), retries);
 
-  jfieldID __writer = env->GetFieldID(clazz, "__writer", "J");
-  env->SetLongField(thiz, __writer, (jlong) writer);
+  env->SetLongField(thiz, cache.Writer__writer, (jlong) writer);
 }
 
 
@@ -425,11 +607,8 @@ JNIEXPORT void JNICALL Java_org_apache_mesos_Log_00024Writer_finalize
   (JNIEnv* env, jobject thiz)
 {
   // Read out __writer.
-  jclass clazz = env->GetObjectClass(thiz);
-
-  jfieldID __writer = env->GetFieldID(clazz, "__writer", "J");
-
-  Log::Writer* writer = (Log::Writer*) env->GetLongField(thiz, __writer);
+  Log::Writer* writer =
+    (Log::Writer*) env->GetLongField(thiz, cache.Writer__writer);
 
   delete writer;
 }
@@ -480,10 +659,7 @@ JNIEXPORT void JNICALL Java_org_apache_mesos_Log_initialize__ILjava_lang_String_
   // Create the C++ Log and initialize the __log variable.
   Log* log = new Log(quorum, path, pids);
 
-  clazz = env->GetObjectClass(thiz);
-
-  jfieldID __log = env->GetFieldID(clazz, "__log", "J");
-  env->SetLongField(thiz, __log, (jlong) log);
+  env->SetLongField(thiz, cache.Log__log, (jlong) log);
 }
 
 
@@ -508,24 +684,14 @@ JNIEXPORT void JNICALL Java_org_apache_mesos_Log_initialize__ILjava_lang_String_
 
   std::string servers = construct<std::string>(env, jservers);
 
-  jclass clazz = env->GetObjectClass(junit);
-
-  // long seconds = unit.toSeconds(time);
-  jmethodID toSeconds = env->GetMethodID(clazz, "toSeconds", "(J)J");
-
-  jlong jseconds = env->CallLongMethod(junit, toSeconds, jtimeout);
-
-  seconds timeout(jseconds);
+  seconds timeout = toSeconds(env, jtimeout, junit);
 
   std::string znode = construct<std::string>(env, jznode);
 
    // Create the C++ Log and initialize the __log variable.
   Log* log = new Log(quorum, path, servers, timeout, znode);
 
-  clazz = env->GetObjectClass(thiz);
-
-  jfieldID __log = env->GetFieldID(clazz, "__log", "J");
-  env->SetLongField(thiz, __log, (jlong) log);
+  env->SetLongField(thiz, cache.Log__log, (jlong) log);
 }
 
 
@@ -552,14 +718,7 @@ JNIEXPORT void JNICALL Java_org_apache_mesos_Log_initialize__ILjava_lang_String_
 
   std::string servers = construct<std::string>(env, jservers);
 
-  jclass clazz = env->GetObjectClass(junit);
-
-  // long seconds = unit.toSeconds(time);
-  jmethodID toSeconds = env->GetMethodID(clazz, "toSeconds", "(J)J");
-
-  jlong jseconds = env->CallLongMethod(junit, toSeconds, jtimeout);
-
-  seconds timeout(jseconds);
+  seconds timeout = toSeconds(env, jtimeout, junit);
 
   std::string znode = construct<std::string>(env, jznode);
 
@@ -584,11 +743,8 @@ JNIEXPORT void JNICALL Java_org_apache_mesos_Log_initialize__ILjava_lang_String_
     log = new Log(quorum, path, servers, timeout, znode);
   }
 
-  // Create the C++ Log and initialize the __log variable.
-  clazz = env->GetObjectClass(thiz);
-
-  jfieldID __log = env->GetFieldID(clazz, "__log", "J");
-  env->SetLongField(thiz, __log, (jlong) log);
+  // Initialize the __log variable.
+  env->SetLongField(thiz, cache.Log__log, (jlong) log);
 }
 
 
@@ -600,11 +756,7 @@ JNIEXPORT void JNICALL Java_org_apache_mesos_Log_initialize__ILjava_lang_String_
 JNIEXPORT void JNICALL Java_org_apache_mesos_Log_finalize
   (JNIEnv* env, jobject thiz)
 {
-  jclass clazz = env->GetObjectClass(thiz);
-
-  jfieldID __log = env->GetFieldID(clazz, "__log", "J");
-
-  Log* log = (Log*) env->GetLongField(thiz, __log);
+  Log* log = (Log*) env->GetLongField(thiz, cache.Log__log);
 
   delete log;
 }
@@ -21,9 +21,14 @@ package org.apache.mesos;
 import java.io.Closeable;
 import java.io.IOException;
 
+import java.nio.ByteBuffer;
+
+import java.util.ArrayList;
 import java.util.List;
 import java.util.Set;
 
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.Future;
 import java.util.concurrent.TimeoutException;
 import java.util.concurrent.TimeUnit;
 
@@ -35,6 +40,7 @@ import java.util.concurrent.TimeUnit;
 public class Log {
   static {
     System.loadLibrary("mesos");
+    initializeClass();
   }
 
   /**
@@ -127,6 +133,74 @@ public class Log {
     }
   }
 
+  /**
+   * The result of an asynchronous read or write operation, which gets
+   * completed by the underlying JNI (from one of its own threads) so
+   * that no thread has to wait for the operation. Operations can't be
+   * cancelled. If an operation fails then {@link #get} throws an
+   * ExecutionException caused by the exception that the synchronous
+   * version of the operation would have thrown.
+   */
+  private static class Operation<T> implements Future<T> {
+    public boolean cancel(boolean mayInterruptIfRunning) {
+      return false;
+    }
+
+    public boolean isCancelled() {
+      return false;
+    }
+
+    public synchronized boolean isDone() {
+      return done;
+    }
+
+    public synchronized T get()
+      throws InterruptedException, ExecutionException {
+      while (!done) {
+        wait();
+      }
+      return result();
+    }
+
+    public synchronized T get(long timeout, TimeUnit unit)
+      throws InterruptedException, ExecutionException, TimeoutException {
+      long deadline = System.nanoTime() + unit.toNanos(timeout);
+      while (!done) {
+        long remaining = deadline - System.nanoTime();
+        if (remaining <= 0) {
+          throw new TimeoutException();
+        }
+        TimeUnit.NANOSECONDS.timedWait(this, remaining);
+      }
+      return result();
+    }
+
+    private T result() throws ExecutionException {
+      if (exception != null) {
+        throw new ExecutionException(exception);
+      }
+      return value;
+    }
+
+    /* Only gets invoked by the underlying JNI. */
+    private synchronized void set(T value) {
+      this.value = value;
+      done = true;
+      notifyAll();
+    }
+
+    /* Only gets invoked by the underlying JNI. */
+    private synchronized void fail(Exception exception) {
+      this.exception = exception;
+      done = true;
+      notifyAll();
+    }
+
+    private boolean done;
+    private T value;
+    private Exception exception;
+  }
+
   /**
    * Provides read access to the {@link Log}. This class is safe for
    * use from multiple threads and for the life of the log regardless
@@ -152,6 +226,15 @@ public class Log {
                                    TimeUnit unit)
       throws TimeoutException, OperationFailedException;
 
+    /**
+     * Like {@link #read} but returns without waiting for the entries.
+     */
+    public Future<List<Entry>> readAsync(Position from, Position to) {
+      Operation<List<Entry>> operation = new Operation<List<Entry>>();
+      startRead(from, to, operation);
+      return operation;
+    }
+
     /**
      * Returns the beginning position of the log (might be out of date
      * with respect to another replica).
@@ -164,6 +247,10 @@ public class Log {
      */
     public native Position ending();
 
+    private native void startRead(Position from,
+                                  Position to,
+                                  Operation<List<Entry>> operation);
+
     protected native void initialize(Log log);
 
     protected native void finalize();
@@ -199,6 +286,20 @@ public class Log {
     public native Position append(byte[] data, long timeout, TimeUnit unit)
       throws TimeoutException, WriterFailedException;
 
+    /**
+     * Like {@link #append} but returns without waiting for the append
+     * (appends get pipelined), so it can be invoked again before the
+     * previous append completes. The appends get positions in the
+     * order they were invoked.
+     */
+    public Future<Position> appendAsync(byte[] data,
+                                        long timeout,
+                                        TimeUnit unit) {
+      Operation<Position> operation = new Operation<Position>();
+      startAppend(data, timeout, unit, operation);
+      return operation;
+    }
+
     /**
      * Attepts to truncate the log (from the beginning to the
      * specified position exclusive) If the position is invalid, an
@@ -214,6 +315,11 @@ public class Log {
     public native Position truncate(Position to, long timeout, TimeUnit unit)
       throws TimeoutException, WriterFailedException;
 
+    private native void startAppend(byte[] data,
+                                    long timeout,
+                                    TimeUnit unit,
+                                    Operation<Position> operation);
+
     protected native void initialize(Log log,
                                      long timeout,
                                      TimeUnit unit,
@@ -269,6 +375,26 @@ public class Log {
     return new Position(value);
   }
 
+  /**
+   * Parses the entries of a read, which the native code serializes
+   * (each as its position, the size of its data and its data) into
+   * one array so that they get copied in one go.
+   */
+  private static List<Entry> parseEntries(byte[] data) {
+    List<Entry> entries = new ArrayList<Entry>();
+    ByteBuffer buffer = ByteBuffer.wrap(data);
+    while (buffer.hasRemaining()) {
+      Position position = new Position(buffer.getLong());
+      byte[] bytes = new byte[buffer.getInt()];
+      buffer.get(bytes);
+      entries.add(new Entry(position, bytes));
+    }
+    return entries;
+  }
+
+  /* Looks up (once) the classes and methods the natives use. */
+  private static native void initializeClass();
+
   protected native void initialize(int quorum,
                                    String path,
                                    Set<String> pids);
@@ -20,8 +20,14 @@ package org.apache.mesos;
 
 import org.apache.mesos.Protos.*;
 
+import java.io.ByteArrayInputStream;
+import java.io.IOException;
+import java.io.InputStream;
+
+import java.util.ArrayList;
 import java.util.Collection;
 import java.util.Collections;
+import java.util.List;
 import java.util.Map;
 
 
@@ -122,6 +128,15 @@ public class MesosSchedulerDriver implements SchedulerDriver {
                                    Collection<TaskDescription> tasks,
                                    Filters filters);
 
+  public Status declineOffers(Collection<OfferID> offerIds) {
+    return declineOffers(offerIds, Filters.newBuilder().build());
+  }
+
+  public native Status declineOffers(Collection<OfferID> offerIds,
+                                     Filters filters);
+
+  public native Status reconcileTasks(Collection<TaskID> taskIds);
+
   public native Status killTask(TaskID taskId);
 
   public native Status reviveOffers();
@@ -130,6 +145,21 @@ public class MesosSchedulerDriver implements SchedulerDriver {
                                             ExecutorID executorId,
                                             byte[] data);
 
+  /**
+   * Parses the offers for a single Scheduler#resourceOffers callback,
+   * which the native code serializes (each prefixed by its size) into
+   * one array so that they get copied and parsed in one go.
+   */
+  private static List<Offer> parseOffers(byte[] data) throws IOException {
+    List<Offer> offers = new ArrayList<Offer>();
+    InputStream input = new ByteArrayInputStream(data);
+    Offer offer;
+    while ((offer = Offer.parseDelimitedFrom(input)) != null) {
+      offers.add(offer);
+    }
+    return offers;
+  }
+
   protected native void initialize();
   protected native void finalize();
 
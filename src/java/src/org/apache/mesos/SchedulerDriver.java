@@ -104,6 +104,26 @@ public interface SchedulerDriver {
   Status launchTasks(OfferID offerId,
                      Collection<TaskDescription> tasks);
 
+  /**
+   * Declines offers (i.e., launches no tasks with them) so that Mesos
+   * can offer the resources again right away, with a single message
+   * for all of the offers. The filters apply to each offer.
+   */
+  Status declineOffers(Collection<OfferID> offerIds, Filters filters);
+
+  /**
+   * Declines offers. See above for details.
+   */
+  Status declineOffers(Collection<OfferID> offerIds);
+
+  /**
+   * Asks Mesos for the current state of the specified tasks (or of
+   * all of the framework's tasks, if the collection is empty), which
+   * arrive as status updates. Tasks Mesos doesn't know about are
+   * reported as lost.
+   */
+  Status reconcileTasks(Collection<TaskID> taskIds);
+
   /**
    * Kills the specified task. Note that attempting to kill a task is
    * currently not reliable. If, for example, a scheduler fails over
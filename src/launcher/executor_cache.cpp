@@ -0,0 +1,212 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <string.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "common/foreach.hpp"
+#include "common/utils.hpp"
+
+#include "launcher/executor_cache.hpp"
+
+using std::pair;
+using std::string;
+using std::vector;
+
+
+namespace mesos { namespace internal { namespace launcher {
+
+// Total size of the files visited by 'nftw' (see 'size').
+static uint64_t visited = 0;
+
+
+static int visit(const char* path, const struct stat* s, int type, FTW* ftw)
+{
+  if (type == FTW_F) {
+    visited += s->st_size;
+  }
+  return 0;
+}
+
+
+// Returns the total size of the files in a directory.
+static uint64_t size(const string& directory)
+{
+  visited = 0;
+  nftw(directory.c_str(), visit, 16, FTW_PHYS);
+  return visited;
+}
+
+
+// Returns a file descriptor of the (created if necessary) lock file
+// locked using the specified operation (see flock) or -1.
+static int lock(const string& path, int operation)
+{
+  int fd = ::open(path.c_str(), O_CREAT | O_RDWR, 0644);
+  if (fd < 0) {
+    return -1;
+  }
+
+  while (flock(fd, operation) < 0) {
+    if (errno != EINTR) {
+      ::close(fd);
+      return -1;
+    }
+  }
+
+  return fd;
+}
+
+
+ExecutorCache::ExecutorCache(const string& _directory, uint64_t _capacity)
+  : directory(_directory), capacity(_capacity), fd(-1) {}
+
+
+ExecutorCache::~ExecutorCache()
+{
+  release();
+}
+
+
+Try<string> ExecutorCache::acquire(
+    const string& uri,
+    const string& version,
+    const std::tr1::function<bool(const string&)>& fetch)
+{
+  release();
+
+  if (!utils::os::mkdir(directory)) {
+    return Try<string>::error("Failed to create " + directory);
+  }
+
+  std::ostringstream name;
+  name << std::hex << std::tr1::hash<string>()(uri + '\n' + version);
+
+  const string& path = directory + "/" + name.str();
+
+  // Wait for any other launcher fetching the executor.
+  fd = lock(path + ".lock", LOCK_EX);
+  if (fd < 0) {
+    return Try<string>::error(
+        "Failed to lock " + path + ".lock: " + strerror(errno));
+  }
+
+  // An entry is only complete (i.e., fetched) once it's marked ready.
+  const string& ready = path + "/.ready";
+
+  if (utils::os::exists(ready)) {
+    // Mark the entry as recently used.
+    utime(ready.c_str(), NULL);
+    return path;
+  }
+
+  // Start over in case an earlier fetch failed part way.
+  if (utils::os::exists(path)) {
+    utils::os::rmdir(path);
+  }
+
+  if (!utils::os::mkdir(path) || !fetch(path)) {
+    utils::os::rmdir(path);
+    release();
+    return Try<string>::error("Failed to fetch " + uri);
+  }
+
+  int ready_fd = ::open(ready.c_str(), O_CREAT | O_WRONLY, 0644);
+  if (ready_fd < 0) {
+    release();
+    return Try<string>::error(
+        "Failed to create " + ready + ": " + strerror(errno));
+  }
+
+  ::close(ready_fd);
+
+  return path;
+}
+
+
+void ExecutorCache::release()
+{
+  if (fd >= 0) {
+    ::close(fd); // Also unlocks.
+    fd = -1;
+  }
+}
+
+
+void ExecutorCache::evict()
+{
+  // Only have one launcher at a time evict entries.
+  int global = lock(directory + "/.lock", LOCK_EX);
+  if (global < 0) {
+    PLOG(ERROR) << "Failed to lock " << directory << "/.lock";
+    return;
+  }
+
+  // Collect the complete entries (by last use) and their sizes.
+  vector<pair<time_t, string> > entries;
+  uint64_t total = 0;
+
+  foreach (const string& name, utils::os::listdir(directory)) {
+    const string& path = directory + "/" + name;
+    struct stat s;
+    if (name[0] != '.' &&
+        utils::os::exists(path, true) &&
+        ::stat((path + "/.ready").c_str(), &s) == 0) {
+      entries.push_back(std::make_pair(s.st_mtime, name));
+      total += size(path);
+    }
+  }
+
+  std::sort(entries.begin(), entries.end());
+
+  for (size_t i = 0; i < entries.size() && total > capacity; i++) {
+    const string& path = directory + "/" + entries[i].second;
+
+    // Skip entries that are in use (or being fetched).
+    int entry = lock(path + ".lock", LOCK_EX | LOCK_NB);
+    if (entry < 0) {
+      continue;
+    }
+
+    uint64_t bytes = size(path);
+    if (utils::os::rmdir(path)) {
+      total -= std::min(bytes, total);
+    }
+
+    ::close(entry);
+  }
+
+  ::close(global);
+}
+
+}}}
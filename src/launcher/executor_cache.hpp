@@ -0,0 +1,75 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXECUTOR_CACHE_HPP__
+#define __EXECUTOR_CACHE_HPP__
+
+#include <stdint.h>
+
+#include <string>
+
+#include <tr1/functional>
+
+#include "common/try.hpp"
+
+
+namespace mesos { namespace internal { namespace launcher {
+
+// A cache of fetched (and, for .tgz executors, extracted) executors
+// in a directory on the slave, so that launching another executor
+// with the same URI doesn't fetch it again. Entries are keyed by URI
+// and version (e.g., the modification time) and, once the cache takes
+// up more than 'capacity' bytes, evicted least recently used first.
+// The launchers (each of which runs in its own process) synchronize
+// with each other using file locks, so that concurrent launches of
+// the same executor share a single fetch.
+class ExecutorCache
+{
+public:
+  ExecutorCache(const std::string& directory, uint64_t capacity);
+
+  ~ExecutorCache();
+
+  // Returns the directory of the entry for the specified URI and
+  // version, first invoking 'fetch' with the directory to fill it in
+  // if it isn't cached yet (or waiting for another launcher that is
+  // fetching it). The entry is locked (i.e., it won't get evicted)
+  // until it gets released.
+  Try<std::string> acquire(
+      const std::string& uri,
+      const std::string& version,
+      const std::tr1::function<bool(const std::string&)>& fetch);
+
+  // Unlocks the acquired entry (if any).
+  void release();
+
+  // Removes the least recently used (unlocked) entries until the
+  // cache takes up no more than its capacity.
+  void evict();
+
+private:
+  const std::string directory;
+  const uint64_t capacity;
+
+  // Lock file of the acquired entry (or -1).
+  int fd;
+};
+
+}}}
+
+#endif // __EXECUTOR_CACHE_HPP__
@@ -0,0 +1,427 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <signal.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <sstream>
+
+#include "common/utils.hpp"
+
+#include "launcher/fetcher.hpp"
+
+using std::istringstream;
+using std::string;
+
+
+namespace mesos { namespace internal { namespace launcher {
+
+// Most bytes of HTTP response headers we're willing to read.
+static const size_t MAX_HEADER_SIZE = 64 * 1024;
+
+// Most HTTP redirects to follow for one URI.
+static const int MAX_REDIRECTS = 5;
+
+// Seconds that connecting to, sending to, or reading from an HTTP
+// server can block before the fetch fails (rather than hanging the
+// launch forever on an unresponsive server).
+static const int SOCKET_TIMEOUT_SECONDS = 60;
+
+
+// Splits an http:// URI into host, port and path.
+static bool parse(const string& uri, string* host, string* port, string* path)
+{
+  if (uri.find("http://") != 0) {
+    return false;
+  }
+
+  size_t start = strlen("http://");
+  size_t slash = uri.find('/', start);
+
+  string authority = uri.substr(start, slash - start);
+  *path = slash == string::npos ? "/" : uri.substr(slash);
+
+  size_t colon = authority.find(':');
+  *host = authority.substr(0, colon);
+  *port = colon == string::npos ? "80" : authority.substr(colon + 1);
+
+  return !host->empty();
+}
+
+
+// Waits for a process started by the fetcher (if any) to exit.
+static Try<bool> reap(pid_t pid, const string& name)
+{
+  if (pid == -1) {
+    return true;
+  }
+
+  int status;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      return Try<bool>::error(name + ": " + strerror(errno));
+    }
+  }
+
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    return Try<bool>::error(name + " failed");
+  }
+
+  return true;
+}
+
+
+Fetcher::Fetcher(const string& _hadoop) : hadoop(_hadoop) {}
+
+
+bool Fetcher::remote(const string& uri)
+{
+  return uri.find("hdfs://") == 0 ||
+    uri.find("http://") == 0 ||
+    uri.find("s3://") == 0;
+}
+
+
+// Copies everything from 'in' to 'out', returning the number of
+// bytes copied (or an error naming the source or destination).
+static Try<uint64_t> copy(int in, int out,
+                          const string& source,
+                          const string& destination)
+{
+  char buffer[64 * 1024];
+  ssize_t length;
+  uint64_t copied = 0;
+
+  while ((length = read(in, buffer, sizeof(buffer))) != 0) {
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return Try<uint64_t>::error("Timed out reading " + source);
+      }
+      return Try<uint64_t>::error(
+          "Failed to read " + source + ": " + strerror(errno));
+    }
+
+    for (ssize_t written = 0; written < length; ) {
+      ssize_t result = write(out, buffer + written, length - written);
+      if (result < 0 && errno != EINTR) {
+        return Try<uint64_t>::error(
+            "Failed to write " + destination + ": " + strerror(errno));
+      }
+      written += result < 0 ? 0 : result;
+    }
+
+    copied += length;
+  }
+
+  return copied;
+}
+
+
+// Returns an error if fewer bytes were copied than were expected
+// (e.g., the server closed the connection early).
+static Try<bool> check(const Try<uint64_t>& copied,
+                       const Option<uint64_t>& length,
+                       const string& uri)
+{
+  if (copied.isError()) {
+    return Try<bool>::error(copied.error());
+  } else if (length.isSome() && copied.get() != length.get()) {
+    return Try<bool>::error(
+        "Short read of " + uri + ": got " + utils::stringify(copied.get()) +
+        " of " + utils::stringify(length.get()) + " bytes");
+  }
+
+  return true;
+}
+
+
+Try<bool> Fetcher::download(const string& uri, const string& path)
+{
+  pid_t pid;
+  Option<uint64_t> length;
+  Try<int> in = open(uri, &pid, &length);
+  if (in.isError()) {
+    return Try<bool>::error(in.error());
+  }
+
+  int out = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0755);
+  if (out < 0) {
+    close(in.get());
+    reap(pid, "hadoop");
+    return Try<bool>::error("Failed to open " + path + ": " + strerror(errno));
+  }
+
+  Try<bool> copied = check(copy(in.get(), out, uri, path), length, uri);
+
+  close(in.get());
+  close(out);
+
+  Try<bool> result = reap(pid, "hadoop");
+
+  return copied.isError() ? copied : result;
+}
+
+
+Try<bool> Fetcher::extract(const string& uri, const string& directory)
+{
+  pid_t pid;
+  Option<uint64_t> length;
+  Try<int> in = open(uri, &pid, &length);
+  if (in.isError()) {
+    return Try<bool>::error(in.error());
+  }
+
+  // Feed the archive to tar as it arrives (through a pipe, so that we
+  // can tell whether all of it did).
+  int fds[2];
+  if (pipe(fds) < 0) {
+    close(in.get());
+    reap(pid, "hadoop");
+    return Try<bool>::error(string("Failed to pipe: ") + strerror(errno));
+  }
+
+  pid_t tar = fork();
+  if (tar == -1) {
+    close(fds[0]);
+    close(fds[1]);
+    close(in.get());
+    reap(pid, "hadoop");
+    return Try<bool>::error(string("Failed to fork: ") + strerror(errno));
+  } else if (tar == 0) {
+    close(fds[1]);
+    close(in.get());
+    dup2(fds[0], STDIN_FILENO);
+    close(fds[0]);
+    execlp("tar", "tar", "xzf", "-", "-C", directory.c_str(), (char*) NULL);
+    _exit(1);
+  }
+
+  close(fds[0]);
+
+  // Don't get killed if tar exits before reading everything.
+  void (*handler)(int) = signal(SIGPIPE, SIG_IGN);
+
+  Try<bool> copied = check(copy(in.get(), fds[1], uri, "tar"), length, uri);
+
+  signal(SIGPIPE, handler);
+
+  close(fds[1]);
+  close(in.get());
+
+  Try<bool> extracted = reap(tar, "tar");
+  Try<bool> fetched = reap(pid, "hadoop");
+
+  if (copied.isError()) {
+    return copied;
+  }
+
+  return extracted.isError() ? extracted : fetched;
+}
+
+
+Try<int> Fetcher::open(const string& uri,
+                       pid_t* pid,
+                       Option<uint64_t>* length)
+{
+  *pid = -1;
+  *length = Option<uint64_t>::none();
+
+  if (uri.find("hdfs://") == 0) {
+    int fds[2];
+    if (pipe(fds) < 0) {
+      return Try<int>::error(string("Failed to pipe: ") + strerror(errno));
+    }
+
+    const string& command = hadoop + " fs -cat '" + uri + "'";
+
+    if ((*pid = fork()) == -1) {
+      close(fds[0]);
+      close(fds[1]);
+      return Try<int>::error(string("Failed to fork: ") + strerror(errno));
+    } else if (*pid == 0) {
+      close(fds[0]);
+      dup2(fds[1], STDOUT_FILENO);
+      close(fds[1]);
+      execl("/bin/sh", "sh", "-c", command.c_str(), (char*) NULL);
+      _exit(1);
+    }
+
+    close(fds[1]);
+    return fds[0];
+  } else if (uri.find("s3://") == 0) {
+    // Objects are fetched from the bucket's (virtual host) HTTP
+    // endpoint, hence they must be readable anonymously.
+    size_t start = strlen("s3://");
+    size_t slash = uri.find('/', start);
+    if (slash == string::npos) {
+      return Try<int>::error("Malformed S3 URI " + uri);
+    }
+
+    const string& bucket = uri.substr(start, slash - start);
+    return get(bucket + ".s3.amazonaws.com", "80", uri.substr(slash),
+               MAX_REDIRECTS, length);
+  }
+
+  string host, port, path;
+  if (!parse(uri, &host, &port, &path)) {
+    return Try<int>::error("Unsupported URI " + uri);
+  }
+
+  return get(host, port, path, MAX_REDIRECTS, length);
+}
+
+
+Try<int> Fetcher::get(const string& host,
+                      const string& port,
+                      const string& path,
+                      int redirects,
+                      Option<uint64_t>* length)
+{
+  struct addrinfo hints, *addresses;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  int error = getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses);
+  if (error != 0) {
+    return Try<int>::error("Failed to resolve " + host + ": " +
+                           gai_strerror(error));
+  }
+
+  // The send timeout also bounds how long connecting can take.
+  struct timeval timeout;
+  timeout.tv_sec = SOCKET_TIMEOUT_SECONDS;
+  timeout.tv_usec = 0;
+
+  int s = -1;
+  for (struct addrinfo* a = addresses; a != NULL; a = a->ai_next) {
+    if ((s = socket(a->ai_family, a->ai_socktype, a->ai_protocol)) < 0) {
+      continue;
+    }
+    if (setsockopt(s, SOL_SOCKET, SO_RCVTIMEO,
+                   &timeout, sizeof(timeout)) == 0 &&
+        setsockopt(s, SOL_SOCKET, SO_SNDTIMEO,
+                   &timeout, sizeof(timeout)) == 0 &&
+        connect(s, a->ai_addr, a->ai_addrlen) == 0) {
+      break;
+    }
+    close(s);
+    s = -1;
+  }
+
+  freeaddrinfo(addresses);
+
+  if (s < 0) {
+    return Try<int>::error("Failed to connect to " + host + ":" + port);
+  }
+
+  // Using HTTP/1.0 keeps the server from chunking the body (it just
+  // closes the connection once it's done).
+  const string& request =
+    "GET " + path + " HTTP/1.0\r\n"
+    "Host: " + host + "\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+
+  for (size_t sent = 0; sent < request.size(); ) {
+    ssize_t length = write(s, request.data() + sent, request.size() - sent);
+    if (length < 0 && errno != EINTR) {
+      close(s);
+      return Try<int>::error("Failed to send request to " + host);
+    }
+    sent += length < 0 ? 0 : length;
+  }
+
+  // Read the headers a byte at a time so that the socket is left at
+  // the start of the body for whoever reads it next.
+  string headers;
+  while (headers.size() < MAX_HEADER_SIZE &&
+         (headers.size() < 4 ||
+          headers.compare(headers.size() - 4, 4, "\r\n\r\n") != 0)) {
+    char c;
+    ssize_t length = read(s, &c, 1);
+    if (length < 0 && errno == EINTR) {
+      continue;
+    } else if (length <= 0) {
+      close(s);
+      return Try<int>::error("Failed to read response from " + host);
+    }
+    headers += c;
+  }
+
+  istringstream in(headers);
+  string version;
+  int code = 0;
+  in >> version >> code;
+
+  if (code == 200) {
+    string line;
+    while (std::getline(in, line)) {
+      if (strncasecmp(line.c_str(), "Content-Length:",
+                      strlen("Content-Length:")) == 0) {
+        Try<uint64_t> size = utils::numify<uint64_t>(
+            strings::trim(line.substr(strlen("Content-Length:"))));
+        if (size.isError()) {
+          close(s);
+          return Try<int>::error("Bad Content-Length from " + host);
+        }
+        *length = size.get();
+      }
+    }
+    return s;
+  }
+
+  close(s);
+
+  if ((code == 301 || code == 302 || code == 303 || code == 307) &&
+      redirects > 0) {
+    string line;
+    while (std::getline(in, line)) {
+      if (strncasecmp(line.c_str(), "Location:", strlen("Location:")) == 0) {
+        string location = line.substr(strlen("Location:"));
+        location.erase(0, location.find_first_not_of(" \t"));
+        location.erase(location.find_last_not_of(" \t\r") + 1);
+
+        string host, port, path;
+        if (parse(location, &host, &port, &path)) {
+          return get(host, port, path, redirects - 1, length);
+        }
+        break;
+      }
+    }
+  }
+
+  std::ostringstream out;
+  out << "Failed to fetch http://" << host << ":" << port << path
+      << ": HTTP status " << code;
+  return Try<int>::error(out.str());
+}
+
+}}}
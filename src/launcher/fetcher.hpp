@@ -0,0 +1,75 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FETCHER_HPP__
+#define __FETCHER_HPP__
+
+#include <stdint.h>
+
+#include <sys/types.h>
+
+#include <string>
+
+#include "common/option.hpp"
+#include "common/try.hpp"
+
+
+namespace mesos { namespace internal { namespace launcher {
+
+// Fetches executors from remote URIs without staging them: http://
+// URIs (and s3:// URIs, through the bucket's HTTP endpoint) are
+// downloaded directly over a socket and hdfs:// URIs are streamed
+// out of 'hadoop fs -cat'. A .tgz gets extracted while it downloads
+// by handing the stream straight to tar.
+class Fetcher
+{
+public:
+  // The Hadoop script is only used for hdfs:// URIs.
+  explicit Fetcher(const std::string& hadoop);
+
+  // Returns true if the URI refers to a remote file that needs to be
+  // fetched (i.e., it has an hdfs://, http:// or s3:// scheme).
+  static bool remote(const std::string& uri);
+
+  // Downloads the file at the URI to the specified path.
+  Try<bool> download(const std::string& uri, const std::string& path);
+
+  // Extracts the .tgz at the URI into the specified directory.
+  Try<bool> extract(const std::string& uri, const std::string& directory);
+
+private:
+  // Returns a file descriptor to read the file at the URI from,
+  // setting 'pid' to the process writing it (or -1 if none) and
+  // 'length' to the size of the file if it's known up front.
+  Try<int> open(const std::string& uri, pid_t* pid, Option<uint64_t>* length);
+
+  // Sends an HTTP GET request and returns the connected socket,
+  // positioned at the start of the body (whose Content-Length, if
+  // any, gets stored in 'length').
+  Try<int> get(const std::string& host,
+               const std::string& port,
+               const std::string& path,
+               int redirects,
+               Option<uint64_t>* length);
+
+  const std::string hadoop;
+};
+
+}}}
+
+#endif // __FETCHER_HPP__
@@ -18,13 +18,17 @@
 
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <libgen.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <pwd.h>
 
 #include <iostream>
 #include <sstream>
 
+#include <tr1/functional>
+
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -32,8 +36,12 @@
 #include <boost/lexical_cast.hpp>
 
 #include "launcher.hpp"
+#include "executor_cache.hpp"
+#include "fetcher.hpp"
 
 #include "common/foreach.hpp"
+#include "common/timer.hpp"
+#include "common/utils.hpp"
 
 using namespace mesos;
 using namespace mesos::internal;
@@ -57,6 +65,8 @@ ExecutorLauncher::ExecutorLauncher(const FrameworkID& _frameworkId,
                                    const string& _frameworksHome,
                                    const string& _mesosHome,
                                    const string& _hadoopHome,
+                                   const string& _cacheDirectory,
+                                   int _cacheSize,
                                    bool _redirectIO,
                                    bool _shouldSwitchUser,
                                    const string& _container,
@@ -65,8 +75,10 @@ ExecutorLauncher::ExecutorLauncher(const FrameworkID& _frameworkId,
     executorUri(_executorUri), user(_user),
     workDirectory(_workDirectory), slavePid(_slavePid),
     frameworksHome(_frameworksHome), mesosHome(_mesosHome),
-    hadoopHome(_hadoopHome), redirectIO(_redirectIO),
-    shouldSwitchUser(_shouldSwitchUser), container(_container), params(_params)
+    hadoopHome(_hadoopHome), cacheDirectory(_cacheDirectory),
+    cacheSize(_cacheSize), redirectIO(_redirectIO),
+    shouldSwitchUser(_shouldSwitchUser), container(_container), params(_params),
+    progressFd(-1)
 {}
 
 
@@ -77,6 +89,12 @@ ExecutorLauncher::~ExecutorLauncher()
 
 int ExecutorLauncher::run()
 {
+  Timer total;
+  total.start();
+
+  Timer timer;
+  timer.start();
+
   initializeWorkingDirectory();
 
   // Enter working directory
@@ -91,12 +109,30 @@ int ExecutorLauncher::run()
       fatalerror("freopen failed");
   }
 
+  reportProgress("working_directory", timer.elapsed().secs());
+
+  timer.start();
   string executor = fetchExecutor();
+  reportProgress("fetch", timer.elapsed().secs());
 
+  timer.start();
   setupEnvironment();
+  reportProgress("environment", timer.elapsed().secs());
 
-  if (shouldSwitchUser)
+  if (shouldSwitchUser) {
+    timer.start();
     switchUser();
+    reportProgress("switch_user", timer.elapsed().secs());
+  }
+
+  reportProgress("total", total.elapsed().secs());
+
+  // Done reporting (the slave sees the end of the pipe once the
+  // executor gets exec'ed, or here if there is a container).
+  if (progressFd != -1) {
+    close(progressFd);
+    progressFd = -1;
+  }
 
   // TODO(benh): Clean up this gross special cased LXC garbage!!!!
 
@@ -160,38 +196,11 @@ string ExecutorLauncher::fetchExecutor()
       executor.find_first_of('\0') != string::npos) {
     fatal("Illegal characters in executor path");
   }
-  // Grab the executor from HDFS if its path begins with hdfs://
-  // TODO: Enforce some size limits on files we get from HDFS
-  if (executor.find("hdfs://") == 0) {
-    // Locate Hadoop's bin/hadoop script. If a Hadoop home was given to us by
-    // the slave (from the Mesos config file), use that. Otherwise check for
-    // a HADOOP_HOME environment variable. Finally, if that doesn't exist,
-    // try looking for hadoop on the PATH.
-    string hadoopScript;
-    if (hadoopHome != "") {
-      hadoopScript = hadoopHome + "/bin/hadoop";
-    } else if (getenv("HADOOP_HOME") != 0) {
-      hadoopScript = string(getenv("HADOOP_HOME")) + "/bin/hadoop";
-    } else {
-      hadoopScript = "hadoop"; // Look for hadoop on the PATH.
-    }
 
-    string localFile = string("./") + basename((char *) executor.c_str());
-    ostringstream command;
-    command << hadoopScript << " fs -copyToLocal '" << executor
-            << "' '" << localFile << "'";
-    cout << "Downloading executor from " << executor << endl;
-    cout << "HDFS command: " << command.str() << endl;
+  bool remote = Fetcher::remote(executor);
 
-    int ret = system(command.str().c_str());
-    if (ret != 0)
-      fatal("HDFS copyToLocal failed: return code %d", ret);
-    executor = localFile;
-    if (chmod(executor.c_str(), S_IRWXU | S_IRGRP | S_IXGRP |
-              S_IROTH | S_IXOTH) != 0)
-      fatalerror("chmod failed");
-  } else if (executor.find_first_of("/") != 0) {
-    // We got a non-Hadoop and non-absolute path.
+  if (!remote && executor.find_first_of("/") != 0) {
+    // We got a non-remote and non-absolute path.
     // Try prepending MESOS_HOME to it.
     if (frameworksHome != "") {
       executor = frameworksHome + "/" + executor;
@@ -211,46 +220,251 @@ string ExecutorLauncher::fetchExecutor()
     }
   }
 
+  bool tgz = executor.rfind(".tgz") == executor.size() - strlen(".tgz");
+
+  // Executors that are expensive to fetch (from HDFS) or extract
+  // (.tgz) go through the executor cache, if the slave has one. There
+  // is no cheap way to tell whether an HTTP (or S3) executor changed,
+  // so those are always fetched.
+  bool cacheable = executor.find("hdfs://") == 0 || (!remote && tgz);
+
+  if (cacheDirectory != "" && cacheable) {
+    Option<string> cached = fetchCachedExecutor(executor);
+    if (cached.isSome()) {
+      return cached.get();
+    }
+    cout << "Failed to use the executor cache, fetching "
+         << executor << " directly" << endl;
+  }
+
+  // Fetch the executor if it's remote (e.g., its path begins with
+  // hdfs://), extracting a .tgz while it downloads.
+  // TODO: Enforce some size limits on files we fetch
+  if (remote) {
+    Fetcher fetcher(hadoopScript());
+
+    if (tgz) {
+      cout << "Downloading and untarring executor from " << executor << endl;
+      Try<bool> result = fetcher.extract(executor, ".");
+      if (result.isError())
+        fatal("Failed to fetch executor: %s", result.error().c_str());
+      return enterExecutorDirectory();
+    }
+
+    string localFile = string("./") + basename((char *) executor.c_str());
+    cout << "Downloading executor from " << executor << endl;
+    Try<bool> result = fetcher.download(executor, localFile);
+    if (result.isError())
+      fatal("Failed to fetch executor: %s", result.error().c_str());
+    executor = localFile;
+    if (chmod(executor.c_str(), S_IRWXU | S_IRGRP | S_IXGRP |
+              S_IROTH | S_IXOTH) != 0)
+      fatalerror("chmod failed");
+  }
+
   // If the executor was a .tgz, untar it in the work directory. The .tgz
   // expected to contain a single directory. This directory should contain
   // a program or script called "executor" to run the executor. We chdir
   // into this directory and run the script from in there.
-  if (executor.rfind(".tgz") == executor.size() - strlen(".tgz")) {
+  if (tgz) {
     string command = "tar xzf '" + executor + "'";
     cout << "Untarring executor: " + command << endl;
     int ret = system(command.c_str());
     if (ret != 0)
       fatal("Untar failed: return code %d", ret);
-    // The .tgz should have contained a single directory; find it
-    if (DIR *dir = opendir(".")) {
-      bool found = false;
-      string dirname = "";
-      while (struct dirent *ent = readdir(dir)) {
-        if (string(".") != ent->d_name && string("..") != ent->d_name) {
-          struct stat info;
-          if (stat(ent->d_name, &info) == 0) {
-            if (S_ISDIR(info.st_mode)) {
-              if (found) // Already found a directory earlier
-                fatal("Executor .tgz must contain a single directory");
-              dirname = ent->d_name;
-              found = true;
-            }
-          } else {
-            fatalerror("Stat failed on %s", ent->d_name);
-          }
+    executor = enterExecutorDirectory();
+  }
+
+  return executor;
+}
+
+
+Option<string> ExecutorLauncher::fetchCachedExecutor(const string& executor)
+{
+  bool hdfs = executor.find("hdfs://") == 0;
+  bool tgz = executor.rfind(".tgz") == executor.size() - strlen(".tgz");
+
+  // The version of the executor distinguishes it from a (cached)
+  // executor that has since been replaced at the same URI.
+  string version;
+  if (hdfs) {
+    std::stringstream out;
+    Try<int> status = utils::os::shell(
+        &out, "%s fs -stat '%s'", hadoopScript().c_str(), executor.c_str());
+    if (status.isError() || status.get() != 0) {
+      return Option<string>::none();
+    }
+    version = out.str();
+  } else {
+    struct stat info;
+    if (stat(executor.c_str(), &info) < 0) {
+      return Option<string>::none();
+    }
+    version = lexical_cast<string>(info.st_mtime) + " " +
+      lexical_cast<string>(info.st_size);
+  }
+
+  ExecutorCache cache(cacheDirectory, (uint64_t) cacheSize * 1024 * 1024);
+
+  Try<string> entry = cache.acquire(
+      executor,
+      version,
+      std::tr1::bind(&ExecutorLauncher::fillCacheEntry,
+                     this,
+                     executor,
+                     std::tr1::placeholders::_1));
+
+  if (entry.isError()) {
+    cout << "Executor cache error: " << entry.error() << endl;
+    return Option<string>::none();
+  }
+
+  // Link the cached files into the work directory (hard links are
+  // cheap and leave the work directory valid even if the entry gets
+  // evicted), copying them if the cache is on another file system.
+  string source = tgz
+    ? entry.get() + "/contents/."
+    : entry.get() + "/" + basename((char *) executor.c_str());
+
+  string command =
+    "cp -al '" + source + "' . 2>/dev/null || cp -a '" + source + "' .";
+
+  cout << "Using cached executor from " << entry.get() << endl;
+
+  int ret = system(command.c_str());
+
+  cache.release();
+  cache.evict();
+
+  if (ret != 0) {
+    return Option<string>::none();
+  }
+
+  if (tgz) {
+    return enterExecutorDirectory();
+  }
+
+  return string("./") + basename((char *) executor.c_str());
+}
+
+
+bool ExecutorLauncher::fillCacheEntry(const string& executor,
+                                      const string& directory)
+{
+  bool tgz = executor.rfind(".tgz") == executor.size() - strlen(".tgz");
+
+  string contents = directory + "/contents";
+  if (tgz && mkdir(contents.c_str(), 0755) < 0) {
+    return false;
+  }
+
+  if (Fetcher::remote(executor)) {
+    Fetcher fetcher(hadoopScript());
+    cout << "Downloading executor into cache from " << executor << endl;
+
+    Try<bool> result = tgz
+      ? fetcher.extract(executor, contents)
+      : fetcher.download(executor,
+                         directory + "/" + basename((char *) executor.c_str()));
+
+    if (result.isError()) {
+      cout << "Failed to fetch executor: " << result.error() << endl;
+      return false;
+    }
+
+    return true;
+  }
+
+  string command = "tar xzf '" + executor + "' -C '" + contents + "'";
+  cout << "Untarring executor into cache: " << command << endl;
+
+  return system(command.c_str()) == 0;
+}
+
+
+void ExecutorLauncher::setProgressFd(int fd)
+{
+  // Don't leak it into the executor.
+  if (fcntl(fd, F_SETFD, FD_CLOEXEC) < 0)
+    fatalerror("Failed to set FD_CLOEXEC on the progress file descriptor");
+
+  progressFd = fd;
+}
+
+
+void ExecutorLauncher::reportProgress(const string& stage, double secs)
+{
+  if (progressFd == -1)
+    return;
+
+  ostringstream out;
+  out << stage << " " << secs << "\n";
+  const string& line = out.str();
+
+  // The slave might be gone, in which case we keep launching (without
+  // reporting) rather than getting killed by a SIGPIPE. The handler
+  // gets restored since the executor would inherit ignoring it.
+  void (*handler)(int) = signal(SIGPIPE, SIG_IGN);
+
+  // Lines are short enough (< PIPE_BUF) to get written all at once.
+  if (write(progressFd, line.data(), line.size()) != (ssize_t) line.size()) {
+    cout << "Failed to report the progress of launching the executor" << endl;
+    close(progressFd);
+    progressFd = -1;
+  }
+
+  signal(SIGPIPE, handler);
+}
+
+
+string ExecutorLauncher::hadoopScript()
+{
+  // Locate Hadoop's bin/hadoop script. If a Hadoop home was given to us by
+  // the slave (from the Mesos config file), use that. Otherwise check for
+  // a HADOOP_HOME environment variable. Finally, if that doesn't exist,
+  // try looking for hadoop on the PATH.
+  if (hadoopHome != "") {
+    return hadoopHome + "/bin/hadoop";
+  } else if (getenv("HADOOP_HOME") != 0) {
+    return string(getenv("HADOOP_HOME")) + "/bin/hadoop";
+  } else {
+    return "hadoop"; // Look for hadoop on the PATH.
+  }
+}
+
+
+string ExecutorLauncher::enterExecutorDirectory()
+{
+  DIR *dir = opendir(".");
+  if (dir == NULL)
+    fatalerror("Failed to list work directory");
+
+  // The .tgz should have contained a single directory; find it
+  bool found = false;
+  string dirname = "";
+  while (struct dirent *ent = readdir(dir)) {
+    if (string(".") != ent->d_name && string("..") != ent->d_name) {
+      struct stat info;
+      if (stat(ent->d_name, &info) == 0) {
+        if (S_ISDIR(info.st_mode)) {
+          if (found) // Already found a directory earlier
+            fatal("Executor .tgz must contain a single directory");
+          dirname = ent->d_name;
+          found = true;
         }
+      } else {
+        fatalerror("Stat failed on %s", ent->d_name);
       }
-      if (!found) // No directory found
-        fatal("Executor .tgz must contain a single directory");
-      if (chdir(dirname.c_str()) < 0)
-        fatalerror("Chdir failed");
-      executor = "./executor";
-    } else {
-      fatalerror("Failed to list work directory");
     }
   }
+  closedir(dir);
 
-  return executor;
+  if (!found) // No directory found
+    fatal("Executor .tgz must contain a single directory");
+  if (chdir(dirname.c_str()) < 0)
+    fatalerror("Chdir failed");
+
+  return "./executor";
 }
 
 
@@ -310,14 +524,52 @@ void ExecutorLauncher::setupEnvironmentForLauncherMain()
 
   // Set up Mesos environment variables that launcher_main.cpp will
   // pass as arguments to an ExecutorLauncher there
-  setenv("MESOS_FRAMEWORK_ID", frameworkId.value().c_str(), 1);
-  setenv("MESOS_EXECUTOR_URI", executorUri.c_str(), 1);
-  setenv("MESOS_USER", user.c_str(), 1);
-  setenv("MESOS_WORK_DIRECTORY", workDirectory.c_str(), 1);
-  setenv("MESOS_SLAVE_PID", slavePid.c_str(), 1);
-  setenv("MESOS_HOME", mesosHome.c_str(), 1);
-  setenv("MESOS_HADOOP_HOME", hadoopHome.c_str(), 1);
-  setenv("MESOS_REDIRECT_IO", redirectIO ? "1" : "0", 1);
-  setenv("MESOS_SWITCH_USER", shouldSwitchUser ? "1" : "0", 1);
-  setenv("MESOS_CONTAINER", container.c_str(), 1);
+  foreachpair (const string& key, const string& value,
+               getLauncherEnvironment()) {
+    setenv(key.c_str(), value.c_str(), 1);
+  }
+}
+
+
+map<string, string> ExecutorLauncher::getLauncherEnvironment()
+{
+  map<string, string> environment;
+
+  // The env.* params (launcher_main.cpp doesn't get the params).
+  foreachpair (const string& key, const string& value, params) {
+    if (key.find("env.") == 0) {
+      environment[key.substr(strlen("env."))] = value;
+    }
+  }
+
+  environment["MESOS_FRAMEWORK_ID"] = frameworkId.value();
+  environment["MESOS_EXECUTOR_ID"] = executorId.value();
+  environment["MESOS_EXECUTOR_URI"] = executorUri;
+  environment["MESOS_USER"] = user;
+  environment["MESOS_WORK_DIRECTORY"] = workDirectory;
+  environment["MESOS_SLAVE_PID"] = slavePid;
+  environment["MESOS_FRAMEWORKS_HOME"] = frameworksHome;
+  environment["MESOS_HOME"] = mesosHome;
+  environment["MESOS_HADOOP_HOME"] = hadoopHome;
+  environment["MESOS_EXECUTOR_CACHE_DIR"] = cacheDirectory;
+  environment["MESOS_EXECUTOR_CACHE_SIZE"] = lexical_cast<string>(cacheSize);
+  environment["MESOS_REDIRECT_IO"] = redirectIO ? "1" : "0";
+  environment["MESOS_SWITCH_USER"] = shouldSwitchUser ? "1" : "0";
+  environment["MESOS_CONTAINER"] = container;
+
+  if (progressFd != -1) {
+    environment["MESOS_LAUNCHER_PROGRESS_FD"] =
+      lexical_cast<string>(progressFd);
+  }
+
+  // Let the executor reach the slave over the slave's Unix domain
+  // socket rather than TCP loopback (see libprocess). Executors that
+  // get forked off directly inherit this, but ones launched in a
+  // container only get the environment given here.
+  const char* sockets = getenv("LIBPROCESS_SOCKET_DIR");
+  if (sockets != NULL) {
+    environment["LIBPROCESS_SOCKET_DIR"] = sockets;
+  }
+
+  return environment;
 }
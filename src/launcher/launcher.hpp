@@ -26,6 +26,7 @@
 #include <mesos/mesos.hpp>
 
 #include "common/fatal.hpp"
+#include "common/option.hpp"
 
 
 namespace mesos { namespace internal { namespace launcher {
@@ -40,10 +41,16 @@ using std::vector;
 //
 // The environment is initialized through for steps:
 // 1) A work directory for the framework is created by createWorkingDirectory().
-// 2) The executor is fetched off HDFS if necessary by fetchExecutor().
+// 2) The executor is fetched off HDFS if necessary by fetchExecutor()
+//    (through the executor cache, if the slave has one).
 // 3) Environment variables are set by setupEnvironment().
 // 4) We switch to the framework's user in switchUser().
 //
+// If given a progress file descriptor (see setProgressFd), the launcher
+// writes a "<stage> <seconds>" line to it as it finishes each step (and
+// "total" right before the exec), so that the slave can tell where the
+// time launching executors goes.
+//
 // Isolation modules that wish to override the default behaviour can subclass
 // Launcher and override some of the methods to perform extra actions.
 class ExecutorLauncher {
@@ -57,10 +64,13 @@ protected:
   string frameworksHome;
   string mesosHome;
   string hadoopHome;
+  string cacheDirectory; // Executor cache (or "" if none)
+  int cacheSize; // Capacity of the executor cache in MB
   bool redirectIO;   // Whether to redirect stdout and stderr to files
   bool shouldSwitchUser; // Whether to setuid to framework's user
   string container;
   map<string, string> params; // Key-value params in framework's ExecutorInfo
+  int progressFd; // Where to report the stages' timings (or -1 if nowhere)
 
 public:
   ExecutorLauncher(const FrameworkID& _frameworkId,
@@ -68,6 +78,7 @@ public:
                    const string& _user, const string& _workDirectory,
                    const string& _slavePid, const string& _frameworksHome,
                    const string& _mesosHome, const string& _hadoopHome,
+                   const string& _cacheDirectory, int _cacheSize,
                    bool _redirectIO, bool _shouldSwitchUser,
 		   const string& container,
                    const map<string, string>& _params);
@@ -85,6 +96,15 @@ public:
   // module, which must run lxc-execute and have it run the launcher.
   virtual void setupEnvironmentForLauncherMain();
 
+  // Returns the environment variables (on top of the slave's) that a
+  // launcher_main.cpp process needs to launch this executor. This is
+  // used to exec mesos-launcher without modifying our own environment.
+  map<string, string> getLauncherEnvironment();
+
+  // Report the time each step takes to the (write end of a pipe) file
+  // descriptor, which gets closed on the exec of the executor.
+  void setProgressFd(int fd);
+
 protected:
   // Initialize executor's working director.
   virtual void initializeWorkingDirectory();
@@ -103,6 +123,24 @@ protected:
 private:
   // Set any environment variables given as env.* params in the ExecutorInfo
   void setupEnvVariablesFromParams();
+
+  // Fetch the executor through the executor cache, linking it into
+  // the work directory, and return its path (or none if the executor
+  // couldn't be cached, in which case it should be fetched directly).
+  Option<string> fetchCachedExecutor(const string& executor);
+
+  // Fill in a new executor cache entry (see ExecutorCache::acquire).
+  bool fillCacheEntry(const string& executor, const string& directory);
+
+  // Write "<stage> <seconds>" to the progress file descriptor (if any).
+  void reportProgress(const string& stage, double secs);
+
+  // Path of Hadoop's bin/hadoop script.
+  string hadoopScript();
+
+  // Chdir into the single directory an executor .tgz was extracted to
+  // (in the current directory) and return the path of the executor.
+  string enterExecutorDirectory();
 };
 
 }}}
@@ -57,17 +57,31 @@ int main(int argc, char **argv)
   ExecutorID executorId;
   executorId.set_value(getenvOrFail("MESOS_EXECUTOR_ID"));
 
-  return ExecutorLauncher(frameworkId,
-			  executorId,
-			  getenvOrFail("MESOS_EXECUTOR_URI"),
-			  getenvOrFail("MESOS_USER"),
-			  getenvOrFail("MESOS_WORK_DIRECTORY"),
-			  getenvOrFail("MESOS_SLAVE_PID"),
-			  getenvOrEmpty("MESOS_FRAMEWORKS_HOME"),
-			  getenvOrFail("MESOS_HOME"),
-			  getenvOrFail("MESOS_HADOOP_HOME"),
-			  lexical_cast<bool>(getenvOrFail("MESOS_REDIRECT_IO")),
-			  lexical_cast<bool>(getenvOrFail("MESOS_SWITCH_USER")),
-			  getenvOrEmpty("MESOS_CONTAINER"),
-			  map<string, string>()).run();
+  // Only used if MESOS_EXECUTOR_CACHE_DIR is set.
+  const char *cacheSize = getenvOrEmpty("MESOS_EXECUTOR_CACHE_SIZE");
+
+  ExecutorLauncher launcher(frameworkId,
+			    executorId,
+			    getenvOrFail("MESOS_EXECUTOR_URI"),
+			    getenvOrFail("MESOS_USER"),
+			    getenvOrFail("MESOS_WORK_DIRECTORY"),
+			    getenvOrFail("MESOS_SLAVE_PID"),
+			    getenvOrEmpty("MESOS_FRAMEWORKS_HOME"),
+			    getenvOrFail("MESOS_HOME"),
+			    getenvOrFail("MESOS_HADOOP_HOME"),
+			    getenvOrEmpty("MESOS_EXECUTOR_CACHE_DIR"),
+			    *cacheSize != '\0' ? lexical_cast<int>(cacheSize) : 0,
+			    lexical_cast<bool>(getenvOrFail("MESOS_REDIRECT_IO")),
+			    lexical_cast<bool>(getenvOrFail("MESOS_SWITCH_USER")),
+			    getenvOrEmpty("MESOS_CONTAINER"),
+			    map<string, string>());
+
+  // Set by the slave if it wants to know how long each step takes.
+  const char *progressFd = getenvOrEmpty("MESOS_LAUNCHER_PROGRESS_FD");
+  if (*progressFd != '\0') {
+    launcher.setProgressFd(lexical_cast<int>(progressFd));
+    unsetenv("MESOS_LAUNCHER_PROGRESS_FD"); // Keep it from the executor.
+  }
+
+  return launcher.run();
 }
@@ -17,15 +17,20 @@
  */
 
 #include <pthread.h>
+#include <unistd.h>
 
 #include <map>
 #include <sstream>
 #include <vector>
 
+#include <process/dispatch.hpp>
+
 #include "local.hpp"
 
 #include "common/foreach.hpp"
 #include "common/logging.hpp"
+#include "common/resources.hpp"
+#include "common/utils.hpp"
 
 #include "configurator/configurator.hpp"
 
@@ -34,6 +39,7 @@
 #include "master/master.hpp"
 #include "master/simple_allocator.hpp"
 
+#include "slave/fake_slave.hpp"
 #include "slave/process_based_isolation_module.hpp"
 #include "slave/slave.hpp"
 
@@ -43,6 +49,7 @@ using mesos::internal::master::Allocator;
 using mesos::internal::master::Master;
 using mesos::internal::master::SimpleAllocator;
 
+using mesos::internal::slave::FakeSlave;
 using mesos::internal::slave::Slave;
 using mesos::internal::slave::IsolationModule;
 using mesos::internal::slave::ProcessBasedIsolationModule;
@@ -61,8 +68,12 @@ namespace mesos { namespace internal { namespace local {
 static Allocator* allocator = NULL;
 static Master* master = NULL;
 static map<IsolationModule*, Slave*> slaves;
+static vector<FakeSlave*> fakes;
 static MasterDetector* detector = NULL;
 
+// Most seconds to wait for the slaves to register.
+static const double REGISTRATION_TIMEOUT_SECONDS = 10.0;
+
 
 void registerOptions(Configurator* configurator)
 {
@@ -72,6 +83,18 @@ void registerOptions(Configurator* configurator)
   configurator->addOption<int>("num_slaves",
                                "Number of slaves to create for local cluster",
                                1);
+  configurator->addOption<bool>("fake_slaves",
+                                "Whether the local cluster's slaves should be\n"
+                                "fake ones, which run no executors (tasks\n"
+                                "finish after task_duration seconds)",
+                                false);
+  configurator->addOption<double>("task_duration",
+                                  "Seconds each task runs for on a fake slave",
+                                  0.0);
+  configurator->addOption<bool>("wait_for_slaves",
+                                "Whether launching the local cluster waits\n"
+                                "for all of its slaves to register",
+                                true);
 }
 
 
@@ -118,19 +141,66 @@ PID<Master> launch(const Configuration& conf, Allocator* _allocator)
 
   vector<UPID> pids;
 
-  // TODO(benh): Launching more than one slave is actually not kosher
-  // since each slave tries to take the "slave" id.
-  for (int i = 0; i < numSlaves; i++) {
-    // TODO(benh): Create a local isolation module?
-    ProcessBasedIsolationModule *isolationModule =
-      new ProcessBasedIsolationModule();
-    Slave* slave = new Slave(conf, true, isolationModule);
-    slaves[isolationModule] = slave;
-    pids.push_back(process::spawn(slave));
+  if (conf.get<bool>("fake_slaves", false)) {
+    // Fake slaves (see fake_slave.hpp) don't need an isolation module
+    // (nor a reaper thread each), so hundreds of them start in no time.
+    Result<string> hostname = utils::os::hostname();
+    if (!hostname.isSome()) {
+      fatal("failed to get hostname");
+    }
+
+    const Resources& resources =
+      Resources::parse(conf.get<string>("resources", "cpus:1;mem:1024"));
+    const double duration = conf.get<double>("task_duration", 0.0);
+
+    // Each fake slave gets a hostname of its own (like with
+    // mesos-fake-slaves) since the master tells slaves apart by it.
+    for (int i = 0; i < numSlaves; i++) {
+      SlaveInfo info;
+      info.set_hostname(hostname.get() + "-" + utils::stringify(i));
+      info.set_webui_hostname(hostname.get());
+      info.mutable_resources()->MergeFrom(resources);
+
+      FakeSlave* fake = new FakeSlave(info, duration);
+      fakes.push_back(fake);
+      pids.push_back(process::spawn(fake));
+    }
+  } else {
+    // TODO(benh): Launching more than one slave is actually not kosher
+    // since each slave tries to take the "slave" id.
+    for (int i = 0; i < numSlaves; i++) {
+      // TODO(benh): Create a local isolation module?
+      ProcessBasedIsolationModule *isolationModule =
+        new ProcessBasedIsolationModule();
+      Slave* slave = new Slave(conf, true, isolationModule);
+      slaves[isolationModule] = slave;
+      pids.push_back(process::spawn(slave));
+    }
   }
 
+  // The slaves initialize (and then register) concurrently, each in
+  // its own process, once the detector tells them about the master.
   detector = new BasicMasterDetector(pid, pids, true);
 
+  if (conf.get<bool>("wait_for_slaves", true)) {
+    const int attempts = (int) (REGISTRATION_TIMEOUT_SECONDS * 1000);
+
+    size_t registered = 0;
+    for (int i = 0; i < attempts; i++) {
+      registered = process::dispatch(pid, &Master::countActiveSlaves).get();
+      if (registered >= (size_t) numSlaves) {
+        break;
+      }
+      usleep(1000);
+    }
+
+    if (registered < (size_t) numSlaves) {
+      LOG(WARNING) << "Only " << registered << " of the " << numSlaves
+                   << " slaves of the local cluster registered within "
+                   << REGISTRATION_TIMEOUT_SECONDS << " seconds";
+    }
+  }
+
   return pid;
 }
 
@@ -150,14 +220,29 @@ void shutdown()
     // the isolation module, we can't delete the isolation module until
     // we have stopped the slave.
 
-    foreachpair (IsolationModule* isolationModule, Slave* slave, slaves) {
+    // Terminate all of the slaves before waiting for any of them, so
+    // that they all shut down at once.
+    foreachvalue (Slave* slave, slaves) {
       process::terminate(slave->self());
+    }
+
+    foreach (FakeSlave* fake, fakes) {
+      process::terminate(fake->self());
+    }
+
+    foreachpair (IsolationModule* isolationModule, Slave* slave, slaves) {
       process::wait(slave->self());
       delete isolationModule;
       delete slave;
     }
 
+    foreach (FakeSlave* fake, fakes) {
+      process::wait(fake->self());
+      delete fake;
+    }
+
     slaves.clear();
+    fakes.clear();
 
     delete detector;
     detector = NULL;
@@ -44,7 +44,9 @@ process::PID<master::Master> launch(int numSlaves,
                                     master::Allocator* _allocator = NULL);
 
 
-// Launch a local cluster with a given configuration.
+// Launch a local cluster with a given configuration. Unless the
+// "wait_for_slaves" option is false, this returns once all of the
+// slaves (fake ones with the "fake_slaves" option) have registered.
 process::PID<master::Master> launch(const Configuration& conf,
                                     master::Allocator* _allocator = NULL);
 
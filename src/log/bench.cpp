@@ -0,0 +1,385 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <process/process.hpp>
+
+#include "common/fatal.hpp"
+#include "common/foreach.hpp"
+#include "common/logging.hpp"
+#include "common/option.hpp"
+#include "common/result.hpp"
+#include "common/seconds.hpp"
+#include "common/strings.hpp"
+#include "common/timer.hpp"
+#include "common/utils.hpp"
+
+#include "configurator/configurator.hpp"
+
+#include "log/log.hpp"
+#include "log/replica.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+using namespace mesos::internal::log;
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::list;
+using std::pair;
+using std::set;
+using std::string;
+using std::vector;
+
+
+// Collects the latencies of some operation and reports them (along
+// with the throughput) once the operation is done.
+class Statistics
+{
+public:
+  Statistics(const string& _name) : name(_name) {}
+
+  void add(const nanoseconds& latency)
+  {
+    latencies.push_back(latency.millis());
+  }
+
+  // Prints the statistics given the total number of entries (and
+  // bytes) processed during the specified elapsed time.
+  void report(const nanoseconds& elapsed, size_t entries, size_t bytes)
+  {
+    std::sort(latencies.begin(), latencies.end());
+
+    const double secs = elapsed.secs();
+
+    cout << std::fixed << std::setprecision(3)
+         << name << ": " << entries << " entries (" << bytes << " bytes) in "
+         << secs << " seconds, "
+         << (secs > 0 ? entries / secs : 0) << " entries/second, "
+         << (secs > 0 ? bytes / secs / (1024 * 1024) : 0) << " MB/second"
+         << endl
+         << "  latency (ms):"
+         << " p50 " << percentile(0.5)
+         << " p99 " << percentile(0.99)
+         << " p999 " << percentile(0.999)
+         << " max " << (latencies.empty() ? 0 : latencies.back())
+         << " (" << latencies.size() << " samples)"
+         << endl;
+  }
+
+private:
+  // Returns the specified percentile (nearest rank), expects the
+  // latencies to be sorted.
+  double percentile(double p) const
+  {
+    if (latencies.empty()) {
+      return 0;
+    }
+
+    size_t rank = (size_t) (p * latencies.size());
+    return latencies[std::min(rank, latencies.size() - 1)];
+  }
+
+  const string name;
+  vector<double> latencies; // In milliseconds.
+};
+
+
+void usage(const char* programName, const Configurator& configurator)
+{
+  cerr << "Usage: " << programName << " [--path=PATH] [--replicas=N] [...]"
+       << endl
+       << endl
+       << "Benchmarks appending to, reading from, and catching up a "
+       << "replicated log" << endl
+       << "with N in-process replicas (plus any remote replicas started "
+       << "with --serve)." << endl
+       << endl
+       << "Supported options:" << endl
+       << configurator.getUsage();
+}
+
+
+// Runs a replica until killed (for benchmarking across hosts).
+int serve(const string& path, Replica::Engine engine)
+{
+  Replica replica(path + "/replica", engine);
+
+  cout << "Replica serving at " << replica.pid() << endl;
+
+  process::wait(replica.pid());
+
+  return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+  GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+  Configurator configurator;
+  Logging::registerOptions(&configurator);
+  configurator.addOption<string>("path", "Directory for the replicas' logs",
+                                 "/tmp/mesos-log-bench");
+  configurator.addOption<bool>("serve", "Only run a replica (for use with "
+                               "--remotes on another host)", false);
+  configurator.addOption<string>("engine", "How the replicas store the log "
+                                 "(leveldb or segments)", "leveldb");
+  configurator.addOption<int>("replicas", "Number of in-process replicas", 3);
+  configurator.addOption<string>("remotes", "Comma separated PIDs of replicas "
+                                 "started with --serve");
+  configurator.addOption<int>("quorum", "Quorum size (defaults to a "
+                              "majority of all replicas)");
+  configurator.addOption<int>("entries", "Number of entries to append", 10000);
+  configurator.addOption<int>("size", "Size of each entry in bytes", 1024);
+  configurator.addOption<int>("batch", "Number of entries per append "
+                              "(which get written concurrently)", 1);
+  configurator.addOption<double>("rate", "Maximum appends per second "
+                                 "(0 is unlimited)", 0.0);
+  configurator.addOption<int>("chunk", "Number of positions per read", 1024);
+  configurator.addOption<double>("timeout", "Seconds before an operation "
+                                 "times out", 5.0);
+  configurator.addOption<double>("lease", "Seconds of the writer's lease "
+                                 "(0 is none)", 0.0);
+
+  if (argc == 2 && string("--help") == argv[1]) {
+    usage(argv[0], configurator);
+    exit(1);
+  }
+
+  Configuration conf;
+  try {
+    conf = configurator.load(argc, argv, true);
+  } catch (ConfigurationException& e) {
+    cerr << "Configuration error: " << e.what() << endl;
+    exit(1);
+  }
+
+  Logging::init(argv[0], conf);
+
+  process::initialize(false);
+
+  const string path = conf.get<string>("path", "/tmp/mesos-log-bench");
+
+  const string name = conf.get<string>("engine", "leveldb");
+
+  if (name != "leveldb" && name != "segments") {
+    fatal("Unknown engine %s", name.c_str());
+  }
+
+  const Replica::Engine engine =
+    name == "segments" ? Replica::SEGMENTS : Replica::LEVELDB;
+
+  if (conf.get<bool>("serve", false)) {
+    return serve(path, engine);
+  }
+
+  const int replicas = conf.get<int>("replicas", 3);
+  const int entries = conf.get<int>("entries", 10000);
+  const int size = conf.get<int>("size", 1024);
+  const int batch = conf.get<int>("batch", 1);
+  const double rate = conf.get<double>("rate", 0.0);
+  const int chunk = conf.get<int>("chunk", 1024);
+  const seconds timeout(conf.get<double>("timeout", 5.0));
+  const seconds lease(conf.get<double>("lease", 0.0));
+
+  if (replicas < 1 || entries < 1 || size < 0 || batch < 1 || chunk < 1) {
+    fatal("Expecting at least one replica, entry, and entry per batch/chunk");
+  }
+
+  utils::os::rmdir(path);
+
+  set<process::UPID> pids;
+
+  foreach (const string& pid, strings::split(conf.get("remotes", ""), ",")) {
+    pids.insert(process::UPID(pid));
+  }
+
+  const int total = replicas + (int) pids.size();
+
+  const int quorum = conf.get<int>("quorum", total / 2 + 1);
+
+  // The log has its own replica, so we only need to start the rest.
+  list<Replica*> locals;
+  for (int i = 1; i < replicas; i++) {
+    Replica* replica =
+      new Replica(path + "/replica" + utils::stringify(i), engine);
+    locals.push_back(replica);
+    pids.insert(replica->pid());
+  }
+
+  cout << "Benchmarking a log with " << total << " replicas and a quorum of "
+       << quorum << endl;
+
+  const string data(size, 'x');
+
+  {
+    Log log(quorum, path + "/replica0", pids, engine);
+
+    Timer timer;
+    timer.start();
+
+    Log::Writer writer(&log, timeout, 3, lease);
+
+    timer.stop();
+
+    cout << "Elected a writer in " << timer.elapsed().millis()
+         << " milliseconds" << endl;
+
+    // First and last appended positions.
+    Option<Log::Position> first = Option<Log::Position>::none();
+    Option<Log::Position> last = Option<Log::Position>::none();
+
+    Statistics appends("append");
+
+    Timer elapsed;
+    elapsed.start();
+
+    int appended = 0;
+    int calls = 0; // Number of appends, used to limit the rate.
+
+    while (appended < entries) {
+      const int count = std::min(batch, entries - appended);
+
+      Timer timer;
+      timer.start();
+
+      Result<pair<Log::Position, Log::Position> > range =
+        Result<pair<Log::Position, Log::Position> >::none();
+
+      if (count == 1) {
+        Result<Log::Position> position = writer.append(data, timeout);
+        if (position.isError()) {
+          fatal("Failed to append: %s", position.error().c_str());
+        } else if (position.isSome()) {
+          range = std::make_pair(position.get(), position.get());
+        }
+      } else {
+        range = writer.append(vector<string>(count, data), timeout);
+        if (range.isError()) {
+          fatal("Failed to append: %s", range.error().c_str());
+        }
+      }
+
+      timer.stop();
+
+      if (range.isNone()) {
+        LOG(WARNING) << "Timed out appending, retrying";
+        continue;
+      }
+
+      appends.add(timer.elapsed());
+
+      if (first.isNone()) {
+        first = range.get().first;
+      }
+
+      last = range.get().second;
+      appended += count;
+      calls++;
+
+      // Pace ourselves if we're appending faster than the rate.
+      if (rate > 0) {
+        const double ahead = calls / rate - elapsed.elapsed().secs();
+        if (ahead > 0) {
+          usleep((useconds_t) (ahead * 1000000));
+        }
+      }
+    }
+
+    elapsed.stop();
+
+    appends.report(elapsed.elapsed(), entries, (size_t) entries * size);
+
+    Statistics reads("read");
+
+    Log::Cursor cursor(&log, first.get(), last.get(), chunk);
+
+    size_t read = 0;
+
+    elapsed.start();
+
+    while (!cursor.done()) {
+      Timer timer;
+      timer.start();
+
+      Result<list<Log::Entry> > result = cursor.next(timeout);
+
+      timer.stop();
+
+      if (result.isError()) {
+        fatal("Failed to read: %s", result.error().c_str());
+      } else if (result.isNone()) {
+        LOG(WARNING) << "Timed out reading, retrying";
+        continue;
+      }
+
+      reads.add(timer.elapsed());
+
+      read += result.get().size();
+    }
+
+    elapsed.stop();
+
+    reads.report(elapsed.elapsed(), read, read * size);
+  }
+
+  // Now see how long it takes a new (empty) replica to catch up,
+  // i.e., for a writer on it to get elected. The new replica takes
+  // the place of the log's replica above (the other replicas have
+  // learned every entry by now), so the quorum stays the same.
+  if (lease.value > 0) {
+    // The other replicas won't elect a new writer until the lease of
+    // the previous one expires.
+    usleep((useconds_t) (lease.value * 1000000));
+  }
+
+  {
+    Log log(quorum, path + "/catchup", pids);
+
+    Timer timer;
+    timer.start();
+
+    Log::Writer writer(&log, timeout);
+
+    timer.stop();
+
+    Statistics catchups("catchup");
+    catchups.add(timer.elapsed());
+    catchups.report(timer.elapsed(), entries, (size_t) entries * size);
+  }
+
+  foreach (Replica* replica, locals) {
+    delete replica;
+  }
+
+  utils::os::rmdir(path);
+
+  return 0;
+}
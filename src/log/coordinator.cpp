@@ -17,203 +17,1144 @@
  */
 
 #include <algorithm>
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
 
+#include <tr1/memory>
+
+#include <process/clock.hpp>
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
+#include <process/metrics.hpp>
+#include <process/timer.hpp>
 
 #include "common/foreach.hpp"
+#include "common/intervalset.hpp"
+#include "common/lambda.hpp"
 
 #include "log/coordinator.hpp"
 #include "log/replica.hpp"
 
 using std::list;
-using std::pair;
+using std::map;
 using std::set;
 using std::string;
+using std::vector;
 
 
 namespace mesos {
 namespace internal {
 namespace log {
 
-Coordinator::Coordinator(int _quorum,
-                         Replica* _replica,
-                         Network* _network)
+// Time from an append being performed until it got committed.
+static process::metrics::Timer appends(
+    "mesos_log_append_seconds",
+    "Time taken by log appends to get committed.");
+
+
+// Maximum number of positions a coordinator asks the other replicas
+// for with a single (ranged) learn request while catching up.
+static const uint64_t MAX_LEARN_POSITIONS = 4096;
+
+
+// Helpers for creating failed and discarded (i.e., retryable) futures.
+template <typename T>
+Future<T> failure(const string& message)
+{
+  process::Promise<T> promise;
+  promise.fail(message);
+  return promise.future();
+}
+
+
+template <typename T>
+Future<T> none()
+{
+  Future<T> future;
+  future.discard();
+  return future;
+}
+
+
+// Addresses a request (or message) to the specified log (see
+// Replica). It's left unset for the default log, so that requests
+// for the default log are the same as they've always been.
+template <typename M>
+void address(M* m, const string& log)
+{
+  if (!log.empty()) {
+    m->set_log(log);
+  }
+}
+
+
+// Helpers that dispatch a method with the (completed) future passed
+// to a callback or the value passed to a continuation (see
+// Future::then). All of the state of a process is only ever touched
+// from within the process, so anything that happens after an
+// asynchronous step must be dispatched back to it. Note that we can't
+// use 'defer' since it doesn't let us bind the future (or value).
+template <typename T, typename F>
+void deliver(const PID<T>& pid, void (T::*method)(const F&), const F& f)
+{
+  dispatch(pid, method, f);
+}
+
+
+template <typename T, typename A, typename F>
+void deliver(const PID<T>& pid,
+             void (T::*method)(const A&, const F&),
+             const A& a,
+             const F& f)
+{
+  dispatch(pid, method, a, f);
+}
+
+
+template <typename R, typename T, typename A, typename V>
+Future<R> resume(const PID<T>& pid,
+                 Future<R> (T::*method)(const A&, const V&),
+                 const A& a,
+                 const V& v)
+{
+  return dispatch(pid, method, a, v);
+}
+
+
+template <typename R, typename T, typename A, typename B, typename V>
+Future<R> resume(const PID<T>& pid,
+                 Future<R> (T::*method)(const A&, const B&, const V&),
+                 const A& a,
+                 const B& b,
+                 const V& v)
+{
+  return dispatch(pid, method, a, b, v);
+}
+
+
+// Broadcasts a request to the network (excluding the filtered
+// replicas) and collects the responses until 'quorum' of them are
+// okay. If a response is not okay (i.e., a replica has promised a
+// coordinator with a higher id) the responses received so far,
+// including that one, are returned right away. The future gets
+// discarded if a quorum can't be achieved before the timeout. A
+// QuorumProcess is spawned per round and terminates itself once the
+// round is over.
+template <typename Req, typename Res>
+class QuorumProcess : public Process<QuorumProcess<Req, Res> >
+{
+public:
+  QuorumProcess(Network* _network,
+                const Protocol<Req, Res>& _protocol,
+                const Req& _request,
+                const set<UPID>& _filter,
+                int _quorum,
+                const Timeout& _timeout)
+    : network(_network),
+      protocol(_protocol),
+      request(_request),
+      filter(_filter),
+      quorum(_quorum),
+      timeout(_timeout),
+      okays(0) {}
+
+  virtual ~QuorumProcess() {}
+
+  Future<list<Res> > future() const
+  {
+    return promise.future();
+  }
+
+protected:
+  virtual void initialize()
+  {
+    void (*broadcasted)(const PID<QuorumProcess>&,
+                        void (QuorumProcess::*)(
+                            const Future<set<Future<Res> > >&),
+                        const Future<set<Future<Res> > >&) =
+      &deliver<QuorumProcess, Future<set<Future<Res> > > >;
+
+    network->broadcast(protocol, request, filter)
+      .onAny(lambda::bind(broadcasted,
+                          this->self(),
+                          &QuorumProcess::broadcasted,
+                          lambda::_1));
+
+    timer = delay(timeout.remaining(), this->self(), &QuorumProcess::expired);
+  }
+
+  virtual void finalize()
+  {
+    timers::cancel(timer);
+
+    // Discard the outstanding requests (and the round, if it's still
+    // pending, since we're being terminated).
+    discard(futures);
+    Future<list<Res> > future = promise.future();
+    future.discard();
+  }
+
+private:
+  void broadcasted(const Future<set<Future<Res> > >& _futures)
+  {
+    CHECK(_futures.isReady()) << "Not expecting a failed or discarded future!";
+
+    futures = _futures.get();
+
+    // Fail fast if there aren't enough replicas in the network.
+    if (futures.size() < quorum) {
+      terminate(this);
+      return;
+    }
+
+    void (*received)(const PID<QuorumProcess>&,
+                     void (QuorumProcess::*)(const Future<Res>&),
+                     const Future<Res>&) =
+      &deliver<QuorumProcess, Future<Res> >;
+
+    foreach (const Future<Res>& future, futures) {
+      future.onAny(lambda::bind(received,
+                                this->self(),
+                                &QuorumProcess::received,
+                                lambda::_1));
+    }
+  }
+
+  void received(const Future<Res>& future)
+  {
+    futures.erase(future);
+
+    if (future.isReady()) {
+      responses.push_back(future.get());
+      if (!future.get().okay() || ++okays >= quorum) {
+        promise.set(responses);
+        terminate(this);
+      }
+    } else if (okays + futures.size() < quorum) {
+      // Too many of the requests failed to achieve a quorum.
+      terminate(this);
+    }
+  }
+
+  void expired()
+  {
+    terminate(this);
+  }
+
+  Network* network;
+  const Protocol<Req, Res> protocol;
+  const Req request;
+  const set<UPID> filter;
+  const size_t quorum;
+  const Timeout timeout;
+
+  set<Future<Res> > futures; // Outstanding requests.
+  list<Res> responses;
+  size_t okays;
+
+  process::Promise<list<Res> > promise;
+
+  process::timer timer;
+};
+
+
+class CoordinatorProcess : public Process<CoordinatorProcess>
+{
+public:
+  CoordinatorProcess(int quorum,
+                     Replica* replica,
+                     Network* network,
+                     size_t window,
+                     double term,
+                     const string& log);
+
+  virtual ~CoordinatorProcess() {}
+
+  Future<uint64_t> elect(const Timeout& timeout);
+  Future<uint64_t> demote();
+  Future<uint64_t> append(const string& bytes, const Timeout& timeout);
+  Future<list<uint64_t> > append(
+      const vector<string>& entries,
+      const Timeout& timeout);
+  Future<uint64_t> snapshot(const string& bytes, const Timeout& timeout);
+  Future<uint64_t> truncate(uint64_t to, const Timeout& timeout);
+  Future<uint64_t> ending(const Timeout& timeout);
+
+protected:
+  virtual void finalize();
+
+private:
+  // Continuations of an election: after getting the highest known
+  // promise from our local replica and after getting promises from a
+  // quorum of replicas.
+  Future<list<PromiseResponse> > _elect(
+      const Timeout& timeout,
+      const uint64_t& promised);
+
+  Future<intervalset<uint64_t> > __elect(
+      const Timeout& timeout,
+      const list<PromiseResponse>& responses);
+
+  // Continuation of an election after getting the missing positions
+  // from our local replica which drops those that some replica has
+  // already truncated (we'll learn the truncate when catching up).
+  Future<intervalset<uint64_t> > ___elect(
+      const uint64_t& begin,
+      const intervalset<uint64_t>& positions);
+
+  // Helper that asks the other replicas for the missing positions
+  // (from 'from' on) that they have already learned, a range at a
+  // time (see MAX_LEARN_POSITIONS), and commits those on our local
+  // replica. Returns the positions that are still missing.
+  Future<intervalset<uint64_t> > learn(
+      const Timeout& timeout,
+      const uint64_t& from,
+      const intervalset<uint64_t>& positions);
+
+  Future<intervalset<uint64_t> > _learn(
+      const intervalset<uint64_t>& positions,
+      const list<LearnResponse>& responses);
+
+  Future<intervalset<uint64_t> > __learn(
+      const intervalset<uint64_t>& positions,
+      const list<uint64_t>& committed);
+
+  // Helper that fills the specified positions, up to a pipelining
+  // window's worth of them concurrently, and then returns the last
+  // position of the log.
+  Future<uint64_t> catchup(
+      const Timeout& timeout,
+      const intervalset<uint64_t>& positions);
+
+  Future<uint64_t> _catchup(
+      const Timeout& timeout,
+      const Action& action);
+
+  Future<uint64_t> __catchup(
+      const Timeout& timeout,
+      const intervalset<uint64_t>& positions,
+      const list<uint64_t>& filled);
+
+  // Invoked once an election is over (whether or not it succeeded).
+  void concluded(const Future<uint64_t>& future);
+
+  // Helper that assigns an action the next position in the log and
+  // writes it once there is room in the pipelining window.
+  Future<uint64_t> perform(Action action, const Timeout& timeout);
+
+  // Helper that starts writing queued actions while there is room in
+  // the pipelining window.
+  void pipeline();
+
+  // Invoked once a quorum has accepted (or failed to accept) the
+  // specified action in the pipelining window.
+  void accepted(const Action& action, const Future<uint64_t>& future);
+
+  // Invoked once a position in the pipelining window (whose write
+  // failed to achieve a quorum) has been filled.
+  void filled(const uint64_t& position, const Future<Action>& future);
+
+  // Helper that commits the accepted actions at the front of the
+  // pipelining window, in order.
+  void advance();
+
+  // Invoked once the specified action has been committed.
+  void committed(const Action& action, const Future<uint64_t>& future);
+
+  // Helper that fails all of the writes in (or waiting for) the
+  // pipelining window.
+  void abandon(const string& message);
+
+  // Helper that tries to achieve consensus of the specified action.
+  // Returns the position of the action once it has been committed.
+  Future<uint64_t> write(const Action& action, const Timeout& timeout);
+
+  Future<uint64_t> _write(const Action& action, const uint64_t& position);
+
+  // Helper that tries to get a quorum of replicas to accept the
+  // specified action (without committing it).
+  Future<uint64_t> accept(const Action& action, const Timeout& timeout);
+
+  Future<uint64_t> _accept(
+      const Timeout& granted,
+      const Action& action,
+      const list<WriteResponse>& responses);
+
+  // Helper that handles commiting an action (i.e., writing to the
+  // local replica and then sending out learned messages).
+  Future<uint64_t> commit(const Action& action);
+
+  Future<uint64_t> _commit(
+      const Action& action,
+      const WriteResponse& response);
+
+  // Helper that determines the action to write in order to fill a
+  // position in the log (which might already have been learned, in
+  // which case it only needs to be committed).
+  Future<Action> fill(uint64_t position, const Timeout& timeout);
+
+  Future<Action> _fill(
+      const uint64_t& position,
+      const list<PromiseResponse>& responses);
+
+  // Helper that uses the specified protocol to broadcast a request to
+  // our group (excluding the filtered replicas) and returns the
+  // responses once 'quorum' of them are okay (see QuorumProcess).
+  template <typename Req, typename Res>
+  Future<list<Res> > broadcast(
+      const Protocol<Req, Res>& protocol,
+      const Req& req,
+      int quorum,
+      const Timeout& timeout,
+      const set<UPID>& filter = set<UPID>());
+
+  // Helper that sends a message to our group excluding our local
+  // replica (and ignores any responses).
+  template <typename M>
+  void remotecast(const M& m);
+
+  // Helpers that return a continuation (see Future::then) which
+  // dispatches the specified method of this process.
+  template <typename R, typename A, typename V>
+  lambda::function<Future<R>(const V&)> continuation(
+      Future<R> (CoordinatorProcess::*method)(const A&, const V&),
+      const A& a);
+
+  template <typename R, typename A, typename B, typename V>
+  lambda::function<Future<R>(const V&)> continuation(
+      Future<R> (CoordinatorProcess::*method)(const A&, const B&, const V&),
+      const A& a,
+      const B& b);
+
+  // An append or truncate in (or waiting for) the pipelining window.
+  struct Write
+  {
+    enum State {
+      WRITING,
+      FILLING,
+      ACCEPTED,
+      COMMITTING,
+    };
+
+    Action action;
+    Timeout timeout;
+    double seconds; // Used when filling the position after a failure.
+    double started; // When it was performed (see 'appends').
+    State state;
+
+    // The promise is set once the action gets committed. We discard
+    // it if the action isn't accepted, in which case we fill its
+    // position (likely with a no-op) and the promise becomes NULL.
+    std::tr1::shared_ptr<process::Promise<uint64_t> > promise;
+  };
+
+  bool elected; // True if this coordinator has been elected.
+
+  process::Promise<uint64_t>* election; // Outstanding election, if any.
+
+  int quorum; // Quorum size.
+
+  Replica* replica; // Local log replica.
+
+  Network* network; // Used to broadcast requests and messages to replicas.
+
+  const string log; // Name of the log we coordinate (see Replica).
+
+  uint64_t id; // Coordinator ID.
+
+  uint64_t index; // Next position to write in the log.
+
+  const size_t window; // Maximum number of positions being written.
+
+  // Writes in the pipelining window, by position. Writes get removed
+  // once they've been committed (in order), hence the window always
+  // covers the contiguous positions from the first uncommitted one.
+  map<uint64_t, Write> writes;
+
+  // Writes waiting for room in the pipelining window.
+  std::deque<Write> queued;
+
+  // Duration (in seconds) of the leases we ask replicas for, if any.
+  // N.B. We only get a lease after a quorum extends it, so with a
+  // quorum of 1 leases are only granted when getting elected.
+  const double term;
+
+  Timeout lease; // Expires when our lease does (see 'ending').
+
+  Timeout granting; // Lease granted if the current election succeeds.
+};
+
+
+CoordinatorProcess::CoordinatorProcess(int _quorum,
+                                       Replica* _replica,
+                                       Network* _network,
+                                       size_t _window,
+                                       double _term,
+                                       const string& _log)
   : elected(false),
+    election(NULL),
     quorum(_quorum),
     replica(_replica),
     network(_network),
+    log(_log),
     id(0),
-    index(0) {}
+    index(0),
+    window(_window),
+    term(_term)
+{
+  CHECK(window > 0);
+}
+
 
+void CoordinatorProcess::finalize()
+{
+  // Discard any outstanding operations, they'll never complete now.
+  if (election != NULL) {
+    Future<uint64_t> future = election->future();
+    future.discard();
+    delete election;
+    election = NULL;
+  }
 
-Coordinator::~Coordinator() {}
+  abandon("Coordinator terminated");
+}
 
 
-Result<uint64_t> Coordinator::elect(const Timeout& timeout)
+Future<uint64_t> CoordinatorProcess::elect(const Timeout& timeout)
 {
   LOG(INFO) << "Coordinator attempting to get elected within "
             << timeout.remaining() << " seconds";
 
   if (elected) {
     // TODO(benh): No-op instead of error?
-    return Result<uint64_t>::error("Coordinator already elected");
+    return failure<uint64_t>("Coordinator already elected");
+  } else if (election != NULL) {
+    return failure<uint64_t>("Coordinator already getting elected");
   }
 
-  // Get the highest known promise from our local replica.
-  Future<uint64_t> promise = replica->promised();
+  // Fail any writes we haven't found out have failed yet.
+  abandon("Coordinator demoted");
 
-  if (!promise.await(timeout.remaining())) {
-    return Result<uint64_t>::none();
-  } else if (promise.isFailed()) {
-    return Result<uint64_t>::error(promise.failure());
-  }
+  election = new process::Promise<uint64_t>();
+
+  void (*concluded)(const PID<CoordinatorProcess>&,
+                    void (CoordinatorProcess::*)(const Future<uint64_t>&),
+                    const Future<uint64_t>&) =
+    &deliver<CoordinatorProcess, Future<uint64_t> >;
+
+  // Get the highest known promise from our local replica.
+  replica->promised(log)
+    .then(continuation(&CoordinatorProcess::_elect, timeout))
+    .then(continuation(&CoordinatorProcess::__elect, timeout))
+    .then(continuation(&CoordinatorProcess::learn, timeout, (uint64_t) 0))
+    .then(continuation(&CoordinatorProcess::catchup, timeout))
+    .onAny(lambda::bind(concluded,
+                        self(),
+                        &CoordinatorProcess::concluded,
+                        lambda::_1));
+
+  return election->future();
+}
 
-  CHECK(promise.isReady()) << "Not expecting a discarded future!";
 
-  id = std::max(id, promise.get()) + 1; // Try the next highest!
+Future<list<PromiseResponse> > CoordinatorProcess::_elect(
+    const Timeout& timeout,
+    const uint64_t& promised)
+{
+  id = std::max(id, promised) + 1; // Try the next highest!
 
   PromiseRequest request;
+  address(&request, log);
   request.set_id(id);
 
+  // Ask for a lease, which starts (conservatively) from now.
+  if (term > 0) {
+    request.set_lease(term);
+  }
+
+  granting = Timeout(term);
+
   // Broadcast the request to the network.
-  set<Future<PromiseResponse> > futures =
-    broadcast(protocol::promise, request);
-
-  int okays = 0;
-
-  do {
-    Future<Future<PromiseResponse> > future = select(futures);
-    if (future.await(timeout.remaining())) {
-      CHECK(future.get().isReady());
-      const PromiseResponse& response = future.get().get();
-      if (!response.okay()) {
-        return Result<uint64_t>::none(); // Lost an election, but can retry.
-      } else if (response.okay()) {
-        CHECK(response.has_position());
-        index = std::max(index, response.position());
-        okays++;
-        if (okays >= quorum) {
-          break;
-        }
-      }
-      futures.erase(future.get());
+  return broadcast(protocol::promise, request, quorum, timeout);
+}
+
+
+Future<intervalset<uint64_t> > CoordinatorProcess::__elect(
+    const Timeout& timeout,
+    const list<PromiseResponse>& responses)
+{
+  uint64_t begin = 0;
+
+  foreach (const PromiseResponse& response, responses) {
+    if (!response.okay()) {
+      return none<intervalset<uint64_t> >(); // Lost an election, can retry.
     }
-  } while (timeout.remaining() > 0);
+    CHECK(response.has_position());
+    index = std::max(index, response.position());
+    if (response.has_begin()) {
+      begin = std::max(begin, response.begin());
+    }
+  }
 
-  // Discard the remaining futures.
-  discard(futures);
+  LOG(INFO) << "Coordinator elected, attempting to fill missing positions";
+  elected = true;
+  lease = granting;
+
+  // Need to "catchup" local replica (i.e., fill in any unlearned
+  // and/or missing positions) so that we can do local reads.
+  // Usually we could do this lazily, however, a local learned
+  // position might have been truncated, so we actually need to
+  // catchup the local replica all the way to the end of the log
+  // before we can perform any up-to-date local reads.
+  return replica->missing(index, log)
+    .then(continuation(&CoordinatorProcess::___elect, begin));
+}
 
-  // Either we have a quorum or we timed out.
-  if (okays >= quorum) {
-    LOG(INFO) << "Coordinator elected, attempting to fill missing positions";
-    elected = true;
 
-    // Need to "catchup" local replica (i.e., fill in any unlearned
-    // and/or missing positions) so that we can do local reads.
-    // Usually we could do this lazily, however, a local learned
-    // position might have been truncated, so we actually need to
-    // catchup the local replica all the way to the end of the log
-    // before we can perform any up-to-date local reads.
+Future<intervalset<uint64_t> > CoordinatorProcess::___elect(
+    const uint64_t& begin,
+    const intervalset<uint64_t>& positions)
+{
+  // A replica only truncates once it has learned a truncate, so the
+  // positions before 'begin' never need to be filled, and doing so
+  // would likely fail anyway since some replicas have removed them.
+  intervalset<uint64_t> missing = positions;
+  missing.remove(0, begin);
+
+  if (missing.size() < positions.size()) {
+    LOG(INFO) << "Coordinator skipping " << positions.size() - missing.size()
+              << " missing positions truncated before " << begin;
+  }
 
-    Future<set<uint64_t> > positions = replica->missing(index);
+  return missing;
+}
 
-    if (!positions.await(timeout.remaining())) {
-      elected = false;
-      return Result<uint64_t>::none();
-    } else if (positions.isFailed()) {
-      elected = false;
-      return Result<uint64_t>::error(positions.failure());
+
+Future<intervalset<uint64_t> > CoordinatorProcess::learn(
+    const Timeout& timeout,
+    const uint64_t& from,
+    const intervalset<uint64_t>& positions)
+{
+  // With a quorum of one there's nobody else to learn from.
+  if (quorum == 1) {
+    return positions;
+  }
+
+  foreachpair (uint64_t begin, uint64_t end, positions) {
+    if (end > from) {
+      // Ask for the next range of missing positions. Unlike a fill
+      // this doesn't need a quorum since a learned action is final,
+      // whatever the replicas haven't learned just gets filled later.
+      const uint64_t first = std::max(begin, from);
+      const uint64_t last = std::min(end, first + MAX_LEARN_POSITIONS) - 1;
+
+      LearnRequest request;
+      address(&request, log);
+      request.set_position(first);
+      request.set_end(last);
+
+      set<UPID> filter;
+      filter.insert(replica->pid());
+
+      return broadcast(protocol::learn, request, quorum - 1, timeout, filter)
+        .then(continuation(&CoordinatorProcess::_learn, positions))
+        .then(continuation(&CoordinatorProcess::learn, timeout, last + 1));
     }
+  }
+
+  return positions;
+}
+
 
-    CHECK(positions.isReady()) << "Not expecting a discarded future!";
-
-    foreach (uint64_t position, positions.get()) {
-      Result<Action> result = fill(position, timeout);
-      if (result.isError()) {
-        elected = false;
-        return Result<uint64_t>::error(result.error());
-      } else if (result.isNone()) {
-        elected = false;
-        return Result<uint64_t>::none();
-      } else {
-        CHECK(result.isSome());
-        CHECK(result.get().position() == position);
+Future<intervalset<uint64_t> > CoordinatorProcess::_learn(
+    const intervalset<uint64_t>& positions,
+    const list<LearnResponse>& responses)
+{
+  intervalset<uint64_t> missing = positions;
+
+  list<Future<uint64_t> > futures;
+
+  foreach (const LearnResponse& response, responses) {
+    foreach (const Action& action, response.actions()) {
+      // More than one replica might have learned the same position.
+      if (missing.contains(action.position())) {
+        missing.remove(action.position());
+        futures.push_back(commit(action));
       }
     }
+  }
+
+  if (!futures.empty()) {
+    LOG(INFO) << "Coordinator learned " << futures.size()
+              << " missing positions from other replicas";
+  }
+
+  return collect(futures)
+    .then(continuation(&CoordinatorProcess::__learn, missing));
+}
+
+
+Future<intervalset<uint64_t> > CoordinatorProcess::__learn(
+    const intervalset<uint64_t>& positions,
+    const list<uint64_t>& committed)
+{
+  return positions;
+}
+
+
+Future<uint64_t> CoordinatorProcess::catchup(
+    const Timeout& timeout,
+    const intervalset<uint64_t>& positions)
+{
+  if (positions.empty()) {
+    return index;
+  }
+
+  // Fill the first 'window' positions at once (each position is an
+  // independent round, and the replicas persist the requests that
+  // arrive together in a single batch) and then continue with the
+  // rest once they're all written.
+  intervalset<uint64_t> remaining = positions;
+
+  list<Future<uint64_t> > futures;
+
+  for (size_t filling = 0; filling < window && !remaining.empty(); filling++) {
+    uint64_t position = remaining.begin()->first;
+    remaining.remove(position);
+
+    futures.push_back(fill(position, timeout)
+      .then(continuation(&CoordinatorProcess::_catchup, timeout)));
+  }
+
+  return collect(futures)
+    .then(continuation(&CoordinatorProcess::__catchup, timeout, remaining));
+}
+
+
+Future<uint64_t> CoordinatorProcess::_catchup(
+    const Timeout& timeout,
+    const Action& action)
+{
+  return write(action, timeout);
+}
+
+
+Future<uint64_t> CoordinatorProcess::__catchup(
+    const Timeout& timeout,
+    const intervalset<uint64_t>& positions,
+    const list<uint64_t>& filled)
+{
+  return catchup(timeout, positions);
+}
+
 
+void CoordinatorProcess::concluded(const Future<uint64_t>& future)
+{
+  CHECK(election != NULL);
+
+  if (future.isReady()) {
     index += 1;
-    return index - 1;
+    election->set(index - 1);
+  } else {
+    elected = false;
+    if (future.isFailed()) {
+      election->fail(future.failure());
+    } else {
+      LOG(INFO) << "Coordinator failed to get elected";
+      Future<uint64_t> result = election->future();
+      result.discard();
+    }
   }
 
-  // Timed out ...
-  LOG(INFO) << "Coordinator timed out while trying to get elected";
-  return Result<uint64_t>::none();
+  delete election;
+  election = NULL;
 }
 
 
-Result<uint64_t> Coordinator::demote()
+Future<uint64_t> CoordinatorProcess::demote()
 {
   elected = false;
+  abandon("Coordinator demoted");
   return index - 1;
 }
 
 
-Result<uint64_t> Coordinator::append(
+Future<uint64_t> CoordinatorProcess::append(
     const string& bytes,
     const Timeout& timeout)
 {
-  if (!elected) {
-    return Result<uint64_t>::error("Coordinator not elected");
+  Action action;
+  action.set_type(Action::APPEND);
+  Action::Append* append = action.mutable_append();
+  append->set_bytes(bytes);
+
+  return perform(action, timeout);
+}
+
+
+Future<list<uint64_t> > CoordinatorProcess::append(
+    const vector<string>& entries,
+    const Timeout& timeout)
+{
+  // Check up front so that we don't perform only some of the entries.
+  if (!elected || election != NULL) {
+    return failure<list<uint64_t> >("Coordinator not elected");
+  }
+
+  // N.B. Each entry gets the next position in the log (and no other
+  // action can be performed in between since we're in the process).
+  list<Future<uint64_t> > futures;
+
+  foreach (const string& bytes, entries) {
+    futures.push_back(append(bytes, timeout));
+  }
+
+  return collect(futures);
+}
+
+
+Future<uint64_t> CoordinatorProcess::snapshot(
+    const string& bytes,
+    const Timeout& timeout)
+{
+  if (!elected || election != NULL) {
+    return failure<uint64_t>("Coordinator not elected");
   }
 
   Action action;
-  action.set_position(index);
-  action.set_promised(id);
-  action.set_performed(id);
   action.set_type(Action::APPEND);
   Action::Append* append = action.mutable_append();
   append->set_bytes(bytes);
+  append->set_snapshot(true);
 
-  Result<uint64_t> result = write(action, timeout);
+  // The snapshot gets the next position, so that's where we truncate.
+  const uint64_t position = index;
 
-  if (result.isSome()) {
-    CHECK(result.get() == index);
-    index++;
-  }
+  Future<uint64_t> future = perform(action, timeout);
 
-  return result;
+  // N.B. The truncate gets committed after the snapshot (since writes
+  // are committed in order), and if it fails the next snapshot will
+  // truncate the log anyway.
+  truncate(position, timeout);
+
+  return future;
 }
 
 
-Result<uint64_t> Coordinator::truncate(
+Future<uint64_t> CoordinatorProcess::truncate(
     uint64_t to,
     const Timeout& timeout)
 {
-  if (!elected) {
-    return Result<uint64_t>::error("Coordinator not elected");
+  Action action;
+  action.set_type(Action::TRUNCATE);
+  Action::Truncate* truncate = action.mutable_truncate();
+  truncate->set_to(to);
+
+  return perform(action, timeout);
+}
+
+
+Future<uint64_t> CoordinatorProcess::ending(const Timeout& timeout)
+{
+  if (!elected || election != NULL) {
+    return failure<uint64_t>("Coordinator not elected");
   }
 
+  // While we hold a lease no other coordinator can get elected, so
+  // our last committed position is the end of the log.
+  if (lease.remaining() > 0) {
+    return writes.empty() ? index - 1 : writes.begin()->first - 1;
+  }
+
+  // Otherwise a write round ensures we're still elected (and extends
+  // our lease, if we have one) and its position is the end of the log.
   Action action;
-  action.set_position(index);
+  action.set_type(Action::NOP);
+  action.mutable_nop();
+
+  return perform(action, timeout);
+}
+
+
+Future<uint64_t> CoordinatorProcess::perform(
+    Action action,
+    const Timeout& timeout)
+{
+  if (!elected || election != NULL) {
+    return failure<uint64_t>("Coordinator not elected");
+  }
+
+  action.set_position(index++);
   action.set_promised(id);
   action.set_performed(id);
-  action.set_type(Action::TRUNCATE);
-  Action::Truncate* truncate = action.mutable_truncate();
-  truncate->set_to(to);
 
-  Result<uint64_t> result = write(action, timeout);
+  Write write;
+  write.action = action;
+  write.timeout = timeout;
+  write.seconds = timeout.remaining();
+  write.started = process::Clock::now();
+  write.state = Write::WRITING;
+  write.promise.reset(new process::Promise<uint64_t>());
+
+  queued.push_back(write);
+
+  pipeline();
+
+  return write.promise->future();
+}
+
+
+void CoordinatorProcess::pipeline()
+{
+  void (*accepted)(const PID<CoordinatorProcess>&,
+                   void (CoordinatorProcess::*)(
+                       const Action&, const Future<uint64_t>&),
+                   const Action&,
+                   const Future<uint64_t>&) =
+    &deliver<CoordinatorProcess, Action, Future<uint64_t> >;
+
+  while (!queued.empty() && writes.size() < window) {
+    Write write = queued.front();
+    queued.pop_front();
+
+    const Action& action = write.action;
+
+    CHECK(writes.count(action.position()) == 0);
+    writes[action.position()] = write;
+
+    accept(action, write.timeout)
+      .onAny(lambda::bind(accepted,
+                          self(),
+                          &CoordinatorProcess::accepted,
+                          action,
+                          lambda::_1));
+  }
+}
+
+
+void CoordinatorProcess::accepted(
+    const Action& action,
+    const Future<uint64_t>& future)
+{
+  // Ignore writes that have been abandoned (see 'abandon').
+  if (action.performed() != id || writes.count(action.position()) == 0) {
+    return;
+  }
+
+  Write& write = writes[action.position()];
+
+  CHECK(write.state == Write::WRITING);
+
+  if (future.isReady()) {
+    CHECK(future.get() == action.position());
+    write.state = Write::ACCEPTED;
+    advance();
+  } else if (future.isFailed()) {
+    abandon(future.failure());
+  } else {
+    // The write failed to achieve a quorum, but the positions after
+    // it can't be committed until this one is, so fill it (likely
+    // with a no-op). The append (or truncate) itself can be retried.
+    LOG(INFO) << "Coordinator filling position " << action.position()
+              << " after failing to write it";
+
+    if (write.promise) {
+      Future<uint64_t> result = write.promise->future();
+      result.discard();
+      write.promise.reset();
+    }
+
+    write.state = Write::FILLING;
+
+    void (*filled)(const PID<CoordinatorProcess>&,
+                   void (CoordinatorProcess::*)(
+                       const uint64_t&, const Future<Action>&),
+                   const uint64_t&,
+                   const Future<Action>&) =
+      &deliver<CoordinatorProcess, uint64_t, Future<Action> >;
+
+    fill(action.position(), Timeout(write.seconds))
+      .onAny(lambda::bind(filled,
+                          self(),
+                          &CoordinatorProcess::filled,
+                          action.position(),
+                          lambda::_1));
+  }
+}
+
+
+void CoordinatorProcess::filled(
+    const uint64_t& position,
+    const Future<Action>& future)
+{
+  if (!elected || writes.count(position) == 0) {
+    return;
+  }
+
+  Write& write = writes[position];
+
+  CHECK(write.state == Write::FILLING);
+
+  if (future.isFailed()) {
+    abandon(future.failure());
+    return;
+  } else if (future.isDiscarded()) {
+    // Keep trying, none of the later positions can be committed
+    // until this one is.
+    void (*filled)(const PID<CoordinatorProcess>&,
+                   void (CoordinatorProcess::*)(
+                       const uint64_t&, const Future<Action>&),
+                   const uint64_t&,
+                   const Future<Action>&) =
+      &deliver<CoordinatorProcess, uint64_t, Future<Action> >;
+
+    fill(position, Timeout(write.seconds))
+      .onAny(lambda::bind(filled,
+                          self(),
+                          &CoordinatorProcess::filled,
+                          position,
+                          lambda::_1));
+    return;
+  }
+
+  write.action = future.get();
+  write.action.set_promised(id);
+  write.action.set_performed(id);
+  write.timeout = Timeout(write.seconds);
+  write.state = Write::WRITING;
+
+  void (*accepted)(const PID<CoordinatorProcess>&,
+                   void (CoordinatorProcess::*)(
+                       const Action&, const Future<uint64_t>&),
+                   const Action&,
+                   const Future<uint64_t>&) =
+    &deliver<CoordinatorProcess, Action, Future<uint64_t> >;
+
+  accept(write.action, write.timeout)
+    .onAny(lambda::bind(accepted,
+                        self(),
+                        &CoordinatorProcess::accepted,
+                        write.action,
+                        lambda::_1));
+}
+
+
+void CoordinatorProcess::advance()
+{
+  void (*committed)(const PID<CoordinatorProcess>&,
+                    void (CoordinatorProcess::*)(
+                        const Action&, const Future<uint64_t>&),
+                    const Action&,
+                    const Future<uint64_t>&) =
+    &deliver<CoordinatorProcess, Action, Future<uint64_t> >;
+
+  // N.B. The learned writes (and messages) for successive commits
+  // arrive at each replica in order since they're all sent from
+  // this process.
+  map<uint64_t, Write>::iterator iterator;
+  for (iterator = writes.begin(); iterator != writes.end(); ++iterator) {
+    Write& write = iterator->second;
+    if (write.state == Write::COMMITTING) {
+      continue;
+    } else if (write.state != Write::ACCEPTED) {
+      break;
+    }
+
+    write.state = Write::COMMITTING;
+
+    commit(write.action)
+      .onAny(lambda::bind(committed,
+                          self(),
+                          &CoordinatorProcess::committed,
+                          write.action,
+                          lambda::_1));
+  }
+}
+
+
+void CoordinatorProcess::committed(
+    const Action& action,
+    const Future<uint64_t>& future)
+{
+  if (action.performed() != id || writes.count(action.position()) == 0) {
+    return;
+  }
 
-  if (result.isSome()) {
-    CHECK(result.get() == index);
-    index++;
+  if (!future.isReady()) {
+    abandon(future.isFailed() ? future.failure() : "Failed to commit");
+    return;
   }
 
-  return result;
+  Write write = writes[action.position()];
+  writes.erase(action.position());
+
+  CHECK(write.state == Write::COMMITTING);
+
+  if (write.promise) {
+    if (action.type() == Action::APPEND) {
+      appends.record(process::Clock::now() - write.started);
+    }
+    write.promise->set(action.position());
+  }
+
+  pipeline(); // Start writing any queued actions.
+}
+
+
+void CoordinatorProcess::abandon(const string& message)
+{
+  if (!writes.empty() || !queued.empty()) {
+    LOG(INFO) << "Coordinator abandoning " << writes.size() + queued.size()
+              << " outstanding writes: " << message;
+  }
+
+  foreachvalue (const Write& write, writes) {
+    if (write.promise) {
+      write.promise->fail(message);
+    }
+  }
+
+  foreach (const Write& write, queued) {
+    write.promise->fail(message);
+  }
+
+  writes.clear();
+  queued.clear();
+
+  // The positions we've handed out can't be trusted anymore (some
+  // might not have been written at all).
+  elected = false;
+  lease = Timeout();
 }
 
 
-Result<uint64_t> Coordinator::write(
+Future<uint64_t> CoordinatorProcess::write(
+    const Action& action,
+    const Timeout& timeout)
+{
+  // A learned action only needs to be committed.
+  if (action.has_learned() && action.learned()) {
+    return commit(action);
+  }
+
+  return accept(action, timeout)
+    .then(continuation(&CoordinatorProcess::_write, action));
+}
+
+
+Future<uint64_t> CoordinatorProcess::_write(
+    const Action& action,
+    const uint64_t& position)
+{
+  return commit(action);
+}
+
+
+Future<uint64_t> CoordinatorProcess::accept(
     const Action& action,
     const Timeout& timeout)
 {
@@ -222,25 +1163,25 @@ Result<uint64_t> Coordinator::write(
             << " action at position " << action.position()
             << " within " << timeout.remaining() << " seconds";
 
-  CHECK(elected);
+  if (!elected) {
+    return failure<uint64_t>("Coordinator demoted");
+  }
 
   CHECK(action.has_performed());
   CHECK(action.has_type());
 
+  // A learned action has already been accepted by a quorum.
+  if (action.has_learned() && action.learned()) {
+    return action.position();
+  }
+
   // TODO(benh): Eliminate this special case hack?
   if (quorum == 1) {
-    Result<uint64_t> result = commit(action);
-    if (result.isError()) {
-      return Result<uint64_t>::error(result.error());
-    } else if (result.isNone()) {
-      return Result<uint64_t>::none();
-    } else {
-      CHECK(result.isSome());
-      return action.position();
-    }
+    return action.position();
   }
 
   WriteRequest request;
+  address(&request, log);
   request.set_id(id);
   request.set_position(action.position());
   request.set_type(action.type());
@@ -261,61 +1202,65 @@ Result<uint64_t> Coordinator::write(
       LOG(FATAL) << "Unknown Action::Type!";
   }
 
-  // Broadcast the request to the network *excluding* the local replica.
-  set<Future<WriteResponse> > futures =
-    remotecast(protocol::write, request);
-
-  int okays = 0;
-
-  do {
-    Future<Future<WriteResponse> > future = select(futures);
-    if (future.await(timeout.remaining())) {
-      CHECK(future.get().isReady());
-      const WriteResponse& response = future.get().get();
-      CHECK(response.id() == request.id());
-      CHECK(response.position() == request.position());
-      if (!response.okay()) {
-        elected = false;
-        return Result<uint64_t>::error("Coordinator demoted");
-      } else if (response.okay()) {
-        if (++okays >= (quorum - 1)) { // N.B. Using (quorum - 1) here!
-          // Got enough remote okays, discard the remaining futures
-          // and try and commit the action locally.
-          discard(futures);
-          Result<uint64_t> result = commit(action);
-          if (result.isError()) {
-            return Result<uint64_t>::error(result.error());
-          } else if (result.isNone()) {
-            return Result<uint64_t>::none();
-          } else {
-            CHECK(result.isSome());
-            return action.position();
-          }
-        }
-      }
-      futures.erase(future.get());
+  // Ask to extend our lease, which starts (conservatively) from now.
+  if (term > 0) {
+    request.set_lease(term);
+  }
+
+  Timeout granted(term);
+
+  // Broadcast the request to the network *excluding* the local
+  // replica, hence only waiting for (quorum - 1) okays.
+  set<UPID> filter;
+  filter.insert(replica->pid());
+
+  return broadcast(protocol::write, request, quorum - 1, timeout, filter)
+    .then(continuation(&CoordinatorProcess::_accept, granted, action));
+}
+
+
+Future<uint64_t> CoordinatorProcess::_accept(
+    const Timeout& granted,
+    const Action& action,
+    const list<WriteResponse>& responses)
+{
+  foreach (const WriteResponse& response, responses) {
+    CHECK(response.id() == id);
+    CHECK(response.position() == action.position());
+    if (!response.okay()) {
+      elected = false;
+      return failure<uint64_t>("Coordinator demoted");
     }
-  } while (timeout.remaining() > 0);
+  }
+
+  // A quorum has extended our lease (from when we sent the request).
+  if (granted.remaining() > lease.remaining()) {
+    lease = granted;
+  }
 
-  // Timed out ... discard remaining futures.
-  discard(futures);
-  return Result<uint64_t>::none();
+  return action.position();
 }
 
 
-Result<uint64_t> Coordinator::commit(const Action& action)
+Future<uint64_t> CoordinatorProcess::commit(const Action& action)
 {
   LOG(INFO) << "Coordinator attempting to commit "
             << Action::Type_Name(action.type())
             << " action at position " << action.position();
 
-  CHECK(elected);
+  if (!elected) {
+    return failure<uint64_t>("Coordinator demoted");
+  }
 
   WriteRequest request;
+  address(&request, log);
   request.set_id(id);
   request.set_position(action.position());
   request.set_learned(true); // A commit is just a learned write.
   request.set_type(action.type());
+  if (term > 0) {
+    request.set_lease(term); // Extend the lease on our local replica too.
+  }
   switch (action.type()) {
     case Action::NOP:
       CHECK(action.has_nop());
@@ -333,40 +1278,40 @@ Result<uint64_t> Coordinator::commit(const Action& action)
       LOG(FATAL) << "Unknown Action::Type!";
   }
 
-  //  TODO(benh): Add a non-message based way to do this write.
-  Future<WriteResponse> future = protocol::write(replica->pid(), request);
-
   // We send a write request to the *local* replica just as the
   // others: asynchronously via messages. However, rather than add the
   // complications of dealing with timeouts for local operations
   // (especially since we are trying to commit something), we make
-  // things simpler and block on the response from the local replica.
-  // Maybe we can let it timeout, but consider it a failure? This
-  // might be sound because we don't send the learned messages ... so
-  // this should be the same as if we just failed before we even do
-  // the write ... a client should just retry this write later.
-
-  future.await(); // TODO(benh): Don't wait forever, see comment above.
+  // things simpler and wait for the response from the local replica
+  // regardless of the timeout. Maybe we can let it timeout, but
+  // consider it a failure? This might be sound because we don't send
+  // the learned messages ... so this should be the same as if we just
+  // failed before we even do the write ... a client should just retry
+  // this write later.
 
-  if (future.isFailed()) {
-    return Result<uint64_t>::error(future.failure());
-  }
+  //  TODO(benh): Add a non-message based way to do this write.
+  return protocol::write(replica->pid(), request)
+    .then(continuation(&CoordinatorProcess::_commit, action));
+}
 
-  CHECK(future.isReady()) << "Not expecting a discarded future!";
 
-  const WriteResponse& response = future.get();
-  CHECK(response.id() == request.id());
-  CHECK(response.position() == request.position());
+Future<uint64_t> CoordinatorProcess::_commit(
+    const Action& action,
+    const WriteResponse& response)
+{
+  CHECK(response.id() == id);
+  CHECK(response.position() == action.position());
 
   if (!response.okay()) {
     elected = false;
-    return Result<uint64_t>::error("Coordinator demoted");
+    return failure<uint64_t>("Coordinator demoted");
   }
 
   // Commit successful, send a learned message to the network
   // *excluding* the local replica and return the position.
 
   LearnedMessage message;
+  address(&message, log);
   message.mutable_action()->MergeFrom(action);
 
   if (!action.has_learned() || !action.learned()) {
@@ -379,138 +1324,204 @@ Result<uint64_t> Coordinator::commit(const Action& action)
 }
 
 
-Result<Action> Coordinator::fill(uint64_t position, const Timeout& timeout)
+Future<Action> CoordinatorProcess::fill(
+    uint64_t position,
+    const Timeout& timeout)
 {
   LOG(INFO) << "Coordinator attempting to fill position "
             << position << " in the log";
 
-  CHECK(elected);
+  if (!elected) {
+    return failure<Action>("Coordinator demoted");
+  }
 
   PromiseRequest request;
+  address(&request, log);
   request.set_id(id);
   request.set_position(position);
 
   // Broadcast the request to the network.
-  set<Future<PromiseResponse> > futures =
-    broadcast(protocol::promise, request);
-
-  list<PromiseResponse> responses;
-
-  do {
-    Future<Future<PromiseResponse> > future = select(futures);
-    if (future.await(timeout.remaining())) {
-      CHECK(future.get().isReady());
-      const PromiseResponse& response = future.get().get();
-      CHECK(response.id() == request.id());
-      if (!response.okay()) {
-        elected = false;
-        return Result<Action>::error("Coordinator demoted");
-      } else if (response.okay()) {
-        responses.push_back(response);
-        if (responses.size() >= quorum) {
-          break;
-        }
-      }
-      futures.erase(future.get());
-    }
-  } while (timeout.remaining() > 0);
+  return broadcast(protocol::promise, request, quorum, timeout)
+    .then(continuation(&CoordinatorProcess::_fill, position));
+}
 
-  // Discard the remaining futures.
-  discard(futures);
 
-  // Either have a quorum or we timed out.
-  if (responses.size() >= quorum) {
-    // Check the responses for a learned action, otherwise, pick the
-    // action with the higest performed id or a no-op if no responses
-    // include performed actions.
-    Action action;
-    foreach (const PromiseResponse& response, responses) {
-      if (response.has_action()) {
-        CHECK(response.action().position() == position);
-        if (response.action().has_learned() && response.action().learned()) {
-          // Received a learned action, try and commit locally.
-          Result<uint64_t> result = commit(response.action());
-          if (result.isError()) {
-            return Result<Action>::error(result.error());
-          } else if (result.isNone()) {
-            return Result<Action>::none();
-          } else {
-            CHECK(result.isSome());
-            return response.action();
-          }
-        } else if (response.action().has_performed() &&
-                   (!action.has_performed() ||
-                    response.action().performed() > action.performed())) {
-          action = response.action();
-        }
-      } else {
-        CHECK(response.has_position());
-        CHECK(response.position() == position);
+Future<Action> CoordinatorProcess::_fill(
+    const uint64_t& position,
+    const list<PromiseResponse>& responses)
+{
+  // Check the responses for a learned action, otherwise, pick the
+  // action with the higest performed id or a no-op if no responses
+  // include performed actions.
+  Action action;
+  foreach (const PromiseResponse& response, responses) {
+    CHECK(response.id() == id);
+    if (!response.okay()) {
+      elected = false;
+      return failure<Action>("Coordinator demoted");
+    } else if (response.has_action()) {
+      CHECK(response.action().position() == position);
+      if (response.action().has_learned() && response.action().learned()) {
+        // Received a learned action, it only needs to be committed.
+        return response.action();
+      } else if (response.action().has_performed() &&
+                 (!action.has_performed() ||
+                  response.action().performed() > action.performed())) {
+        action = response.action();
       }
-    }
-
-    // Use a no-op if no known action has been performed.
-    if (!action.has_performed()) {
-      action.set_position(position);
-      action.set_promised(id);
-      action.set_performed(id);
-      action.set_type(Action::NOP);
-      action.mutable_nop();
     } else {
-      action.set_performed(id);
+      CHECK(response.has_position());
+      CHECK(response.position() == position);
     }
+  }
 
-    Result<uint64_t> result = write(action, timeout);
-
-    if (result.isError()) {
-      return Result<Action>::error(result.error());
-    } else if (result.isNone()) {
-      return Result<Action>::none();
-    } else {
-      CHECK(result.isSome());
-      return action;
-    }
+  // Use a no-op if no known action has been performed.
+  if (!action.has_performed()) {
+    action.set_position(position);
+    action.set_promised(id);
+    action.set_performed(id);
+    action.set_type(Action::NOP);
+    action.mutable_nop();
+  } else {
+    action.set_performed(id);
   }
 
-  // Timed out ...
-  return Result<Action>::none();
+  return action;
 }
 
 
 template <typename Req, typename Res>
-set<Future<Res> > Coordinator::broadcast(
+Future<list<Res> > CoordinatorProcess::broadcast(
     const Protocol<Req, Res>& protocol,
-    const Req& req)
+    const Req& req,
+    int quorum,
+    const Timeout& timeout,
+    const set<UPID>& filter)
 {
-  Future<set<Future<Res> > > futures =
-    network->broadcast(protocol, req);
-  futures.await();
-  CHECK(futures.isReady());
-  return futures.get();
+  QuorumProcess<Req, Res>* process = new QuorumProcess<Req, Res>(
+      network, protocol, req, filter, quorum, timeout);
+  Future<list<Res> > future = process->future();
+  spawn(process, true);
+  return future;
 }
 
 
-template <typename Req, typename Res>
-set<Future<Res> > Coordinator::remotecast(
-    const Protocol<Req, Res>& protocol,
-    const Req& req)
+template <typename M>
+void CoordinatorProcess::remotecast(const M& m)
 {
   set<UPID> filter;
   filter.insert(replica->pid());
-  Future<set<Future<Res> > > futures =
-    network->broadcast(protocol, req, filter);
-  futures.await();
-  CHECK(futures.isReady());
-  return futures.get();
+  network->broadcast(m, filter);
 }
 
 
-template <typename M>
-void Coordinator::remotecast(const M& m)
+template <typename R, typename A, typename V>
+lambda::function<Future<R>(const V&)> CoordinatorProcess::continuation(
+    Future<R> (CoordinatorProcess::*method)(const A&, const V&),
+    const A& a)
 {
-  set<UPID> filter;
-  filter.insert(replica->pid());
-  network->broadcast(m, filter);
+  Future<R> (*resume)(const PID<CoordinatorProcess>&,
+                      Future<R> (CoordinatorProcess::*)(const A&, const V&),
+                      const A&,
+                      const V&) =
+    &log::resume<R, CoordinatorProcess, A, V>;
+
+  return lambda::bind(resume, self(), method, a, lambda::_1);
+}
+
+
+template <typename R, typename A, typename B, typename V>
+lambda::function<Future<R>(const V&)> CoordinatorProcess::continuation(
+    Future<R> (CoordinatorProcess::*method)(const A&, const B&, const V&),
+    const A& a,
+    const B& b)
+{
+  Future<R> (*resume)(const PID<CoordinatorProcess>&,
+                      Future<R> (CoordinatorProcess::*)(
+                          const A&, const B&, const V&),
+                      const A&,
+                      const B&,
+                      const V&) =
+    &log::resume<R, CoordinatorProcess, A, B, V>;
+
+  return lambda::bind(resume, self(), method, a, b, lambda::_1);
+}
+
+
+Coordinator::Coordinator(int quorum,
+                         Replica* replica,
+                         Network* network,
+                         size_t window,
+                         double lease,
+                         const string& log)
+{
+  process =
+    new CoordinatorProcess(quorum, replica, network, window, lease, log);
+  spawn(process);
+}
+
+
+Coordinator::~Coordinator()
+{
+  terminate(process);
+  process::wait(process);
+  delete process;
+}
+
+
+Future<uint64_t> Coordinator::elect(const Timeout& timeout)
+{
+  return dispatch(process, &CoordinatorProcess::elect, timeout);
+}
+
+
+Future<uint64_t> Coordinator::demote()
+{
+  return dispatch(process, &CoordinatorProcess::demote);
+}
+
+
+Future<uint64_t> Coordinator::append(
+    const string& bytes,
+    const Timeout& timeout)
+{
+  Future<uint64_t> (CoordinatorProcess::*append)(
+      const string&, const Timeout&) = &CoordinatorProcess::append;
+
+  return dispatch(process, append, bytes, timeout);
+}
+
+
+Future<list<uint64_t> > Coordinator::append(
+    const vector<string>& entries,
+    const Timeout& timeout)
+{
+  Future<list<uint64_t> > (CoordinatorProcess::*append)(
+      const vector<string>&, const Timeout&) = &CoordinatorProcess::append;
+
+  return dispatch(process, append, entries, timeout);
+}
+
+
+Future<uint64_t> Coordinator::snapshot(
+    const string& bytes,
+    const Timeout& timeout)
+{
+  return dispatch(process, &CoordinatorProcess::snapshot, bytes, timeout);
+}
+
+
+Future<uint64_t> Coordinator::truncate(
+    uint64_t to,
+    const Timeout& timeout)
+{
+  return dispatch(process, &CoordinatorProcess::truncate, to, timeout);
+}
+
+
+Future<uint64_t> Coordinator::ending(const Timeout& timeout)
+{
+  return dispatch(process, &CoordinatorProcess::ending, timeout);
 }
 
 } // namespace log {
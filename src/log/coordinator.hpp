@@ -19,15 +19,14 @@
 #ifndef __LOG_COORDINATOR_HPP__
 #define __LOG_COORDINATOR_HPP__
 
+#include <list>
 #include <string>
 #include <vector>
 
+#include <process/future.hpp>
 #include <process/process.hpp>
 #include <process/timeout.hpp>
 
-#include "common/result.hpp"
-#include "common/seconds.hpp"
-
 #include "log/network.hpp"
 #include "log/replica.hpp"
 
@@ -40,74 +39,80 @@ namespace log {
 
 using namespace process;
 
+// Forward declaration.
+class CoordinatorProcess;
+
+
+// All of the coordinator operations are asynchronous. A failed
+// future means the operation failed and should not be retried (e.g.,
+// the coordinator got demoted), while a discarded future means the
+// operation failed to achieve a quorum (e.g., due to timeout) but can
+// be retried.
 class Coordinator
 {
 public:
+  // The window is the maximum number of positions (following the
+  // first uncommitted one) that the coordinator writes concurrently,
+  // and likewise fills concurrently when catching up after an
+  // election.
+  // If a lease (in seconds) is specified then replicas won't elect
+  // another coordinator for that long after this one last wrote to
+  // them, which lets 'ending' avoid a round.
+  // The coordinator is for the specified log of the replicas (see
+  // Replica), each log gets elected and written independently.
   Coordinator(int quorum,
               Replica* replica,
-              Network* group);
+              Network* network,
+              size_t window = 32,
+              double lease = 0,
+              const std::string& log = "");
 
   ~Coordinator();
 
-  // Handles coordinator election/demotion. A result of none means the
-  // coordinator failed to achieve a quorum (e.g., due to timeout) but
-  // can be retried. A some result returns the last committed log
-  // position.
-  Result<uint64_t> elect(const Timeout& timeout);
-  Result<uint64_t> demote();
-
-  // Returns the result of trying to append the specified bytes. A
-  // result of none means the append failed (e.g., due to timeout),
-  // but can be retried.
-  Result<uint64_t> append(const std::string& bytes, const Timeout& timeout);
-
-  // Returns the result of trying to truncate the log (from the
-  // beginning to the specified position exclusive). A result of
-  // none means the truncate failed (e.g., due to timeout), but can be
-  // retried.
-  Result<uint64_t> truncate(uint64_t to, const Timeout& timeout);
+  // Handles coordinator election/demotion. A successful election (or
+  // demotion) returns the last committed log position.
+  Future<uint64_t> elect(const Timeout& timeout);
+  Future<uint64_t> demote();
+
+  // Returns the position the specified bytes were appended at. Each
+  // append (or truncate) gets assigned the next position in the log
+  // when it's issued, so many of them can be outstanding at once.
+  // They are written concurrently (within the window) but committed
+  // in order. If an append fails to achieve a quorum its position
+  // gets filled (likely with a no-op) so the positions after it can
+  // still be committed.
+  Future<uint64_t> append(const std::string& bytes, const Timeout& timeout);
+
+  // Returns the positions the specified entries were appended at,
+  // which are contiguous and in the same order as the entries. This
+  // is just an append per entry (written concurrently within the
+  // window), so it's not atomic: the returned future fails (or gets
+  // discarded) as soon as any of the entries does, in which case
+  // some of the other entries may still have been appended.
+  Future<std::list<uint64_t> > append(
+      const std::vector<std::string>& entries,
+      const Timeout& timeout);
+
+  // Returns the position the specified snapshot (of all state up to
+  // this point in the log) was appended at. A truncate of the log up
+  // to the snapshot is issued right behind it.
+  Future<uint64_t> snapshot(const std::string& bytes, const Timeout& timeout);
+
+  // Returns the position of the truncate action which truncates the
+  // log from the beginning to the specified position exclusive.
+  Future<uint64_t> truncate(uint64_t to, const Timeout& timeout);
+
+  // Returns the end of the log (i.e., the last committed position) as
+  // of when it's invoked. While this coordinator holds a lease this
+  // doesn't require a round, otherwise it writes a no-op.
+  Future<uint64_t> ending(const Timeout& timeout);
 
 private:
-  // Helper that tries to achieve consensus of the specified action. A
-  // result of none means the write failed (e.g., due to timeout), but
-  // can be retried.
-  Result<uint64_t> write(const Action& action, const Timeout& timeout);
-
-  // Helper that handles commiting an action (i.e., writing to the
-  // local replica and then sending out learned messages).
-  Result<uint64_t> commit(const Action& action);
-
-  // Helper that tries to fill a position in the log.
-  Result<Action> fill(uint64_t position, const Timeout& timeout);
-
-  // Helper that uses the specified protocol to broadcast a request to
-  // our group and return a set of futures.
-  template <typename Req, typename Res>
-  std::set<Future<Res> > broadcast(
-      const Protocol<Req, Res>& protocol,
-      const Req& req);
-
-  // Helper like broadcast, but excludes our local replica.
-  template <typename Req, typename Res>
-  std::set<Future<Res> > remotecast(
-      const Protocol<Req, Res>& protocol,
-      const Req& req);
-
-  // Helper like remotecast but ignores any responses.
-  template <typename M>
-  void remotecast(const M& m);
-
-  bool elected; // True if this coordinator has been elected.
-
-  int quorum; // Quorum size.
-
-  Replica* replica; // Local log replica.
-
-  Network* network; // Used to broadcast requests and messages to replicas.
-
-  uint64_t id; // Coordinator ID.
+  // Not copyable, not assignable.
+  Coordinator(const Coordinator&);
+  Coordinator& operator = (const Coordinator&);
 
-  uint64_t index; // Last position written in the log.
+  CoordinatorProcess* process;
 };
 
 } // namespace log {
@@ -22,11 +22,14 @@
 #include <list>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <process/process.hpp>
 #include <process/timeout.hpp>
 
 #include "common/foreach.hpp"
+#include "common/lambda.hpp"
 #include "common/result.hpp"
 #include "common/seconds.hpp"
 #include "common/try.hpp"
@@ -44,6 +47,7 @@ class Log
 {
 public:
   // Forward declarations.
+  class Cursor;
   class Reader;
   class Writer;
 
@@ -94,6 +98,7 @@ public:
 
   private:
     friend class Log;
+    friend class Cursor;
     friend class Reader;
     friend class Writer;
     Position(uint64_t _value) : value(_value) {}
@@ -105,12 +110,16 @@ public:
   public:
     Position position;
     std::string data;
+    bool snapshot; // Data is a snapshot (see Writer::snapshot).
 
   private:
+    friend class Log;
     friend class Reader;
     friend class Writer;
-    Entry(const Position& _position, const std::string& _data)
-      : position(_position), data(_data) {}
+    Entry(const Position& _position,
+          const std::string& _data,
+          bool _snapshot = false)
+      : position(_position), data(_data), snapshot(_snapshot) {}
   };
 
   class Reader
@@ -125,6 +134,11 @@ public:
                                    const Position& to,
                                    const seconds& timeout);
 
+    // Like above but without waiting for the entries, so that callers
+    // don't need to block a thread per read.
+    process::Future<std::list<Entry> > read(const Position& from,
+                                            const Position& to);
+
     // Returns the beginning position of the log from the perspective
     // of the local replica (which may be out of date if the log has
     // been opened and truncated while this replica was partitioned).
@@ -138,6 +152,47 @@ public:
 
   private:
     Replica* replica;
+    const std::string name;
+  };
+
+  // Streams the entries between two positions in chunks so that
+  // reading (e.g., replaying) a long log never requires having all
+  // of it in memory at once. The next chunk gets read from the local
+  // replica while the current one is being processed.
+  class Cursor
+  {
+  public:
+    // Creates a cursor for all entries between the specified
+    // positions inclusive, read at most 'chunk' positions at a time.
+    Cursor(Log* log,
+           const Position& from,
+           const Position& to,
+           size_t chunk = 1024);
+    ~Cursor();
+
+    // Returns true once all of the entries have been returned.
+    bool done() const;
+
+    // Returns the entries in the next chunk (which might not include
+    // any if those positions only have no-ops or truncates). A none
+    // result means the read timed out (and can be attempted again),
+    // otherwise returns an error if the positions are invalid.
+    Result<std::list<Entry> > next(const seconds& timeout);
+
+  private:
+    // Starts reading the next chunk.
+    void prefetch();
+
+    Replica* replica;
+    const std::string name;
+    const uint64_t to;
+    const size_t chunk;
+
+    // First and last positions of the chunk being read (and the
+    // future for it), 'from' is past 'to' once we're done.
+    uint64_t from;
+    uint64_t until;
+    process::Future<std::list<Action> > actions;
   };
 
   class Writer
@@ -147,7 +202,13 @@ public:
     // one writer (local and remote) is valid at a time. A writer
     // becomes invalid if any operation returns an error, and a new
     // writer must be created in order perform subsequent operations.
-    Writer(Log* log, const seconds& timeout, int retries = 3);
+    // If a lease is specified then no other writer can be created for
+    // that long after this writer last wrote to the log, which lets
+    // this writer serve up-to-date reads locally (see below).
+    Writer(Log* log,
+           const seconds& timeout,
+           int retries = 3,
+           const seconds& lease = seconds(0.0));
     ~Writer();
 
     // Attempts to append the specified data to the log. A none result
@@ -156,30 +217,94 @@ public:
     // Writer must be created.
     Result<Position> append(const std::string& data, const seconds& timeout);
 
+    // Like above but without waiting for the append (appends get
+    // pipelined), so that callers don't need to block a thread per
+    // append. The future gets discarded if the operation times out,
+    // or fails upon error (after which a new Writer must be created).
+    // N.B. These appends don't count towards snapshots.
+    process::Future<Position> append(const std::string& data,
+                                     const process::Timeout& timeout);
+
+    // Attempts to append each of the specified entries to the log (at
+    // contiguous positions, in order) writing them all concurrently.
+    // This is not atomic: callers that need all or none of the
+    // entries should append them as a single entry instead.
+    // Returns the first and last positions of the entries, otherwise
+    // none if the operation timed out (in which case some of the
+    // entries may still have been appended) or an error. Upon error a
+    // new Writer must be created.
+    Result<std::pair<Position, Position> > append(
+        const std::vector<std::string>& entries,
+        const seconds& timeout);
+
     // Attempts to truncate the log up to but not including the
     // specificed position. A none result means the operation timed
     // out, otherwise the new ending position of the log is returned
     // or an error. Upon error a new Writer must be created.
     Result<Position> truncate(const Position& to, const seconds& timeout);
 
+    // Attempts to append the specified snapshot of the application's
+    // state (i.e., of everything appended to the log so far) and then
+    // truncates the log up to it, so that reading the log (or catching
+    // up a replica) only requires the snapshot and the entries after
+    // it. Returns the position of the snapshot, otherwise none if the
+    // operation timed out or an error. Upon error a new Writer must
+    // be created.
+    Result<Position> snapshot(const std::string& state,
+                              const seconds& timeout);
+
+    // Registers a producer of snapshots which gets invoked (and its
+    // result passed to 'snapshot') after every 'interval' entries
+    // appended with this writer.
+    void snapshots(const lambda::function<std::string(void)>& producer,
+                   size_t interval);
+
+    // Returns the ending (i.e., last) position of the log as of when
+    // this is invoked (unlike Reader::ending), without any round trips
+    // if this writer holds a lease. A none result means the operation
+    // timed out, otherwise an error. Upon error a new Writer must be
+    // created.
+    Result<Position> ending(const seconds& timeout);
+
+    // Returns all entries between the specified positions as of when
+    // this is invoked (unlike Reader::read), see 'ending' above.
+    Result<std::list<Entry> > read(const Position& from,
+                                   const Position& to,
+                                   const seconds& timeout);
+
   private:
+    // Accounts for the specified number of appended entries and takes
+    // a snapshot (using the registered producer) if enough entries
+    // have been appended since the last one.
+    void produce(size_t entries, const seconds& timeout);
+
     Option<std::string> error;
     Coordinator coordinator;
+    Replica* replica;
+    const std::string name;
+
+    lambda::function<std::string(void)> producer;
+    size_t interval;
+    size_t appended; // Entries appended since the last snapshot.
   };
 
   // Creates a new replicated log that assumes the specified quorum
   // size, is backed by a file at the specified path, and coordiantes
-  // with other replicas via the set of process PIDs.
+  // with other replicas via the set of process PIDs. The local
+  // replica gets the specified id, if any (see Replica).
   Log(int _quorum,
       const std::string& path,
-      const std::set<process::UPID>& pids)
-    : group(NULL)
+      const std::set<process::UPID>& pids,
+      Replica::Engine engine = Replica::LEVELDB,
+      const std::string& id = "")
+    : group(NULL),
+      shared(false)
   {
     GOOGLE_PROTOBUF_VERIFY_VERSION;
 
     quorum = _quorum;
 
-    replica = new Replica(path);
+    replica = new Replica(path, engine, id);
 
     network = new Network(pids);
 
@@ -197,13 +322,15 @@ public:
       const seconds& timeout,
       const std::string& znode,
       const Option<zookeeper::Authentication>& auth
-        = Option<zookeeper::Authentication>::none())
+        = Option<zookeeper::Authentication>::none(),
+      Replica::Engine engine = Replica::LEVELDB)
+    : shared(false)
   {
     GOOGLE_PROTOBUF_VERIFY_VERSION;
 
     quorum = _quorum;
 
-    replica = new Replica(path);
+    replica = new Replica(path, engine);
 
     group = new zookeeper::Group(servers, timeout, znode, auth);
     network = new ZooKeeperNetwork(group);
@@ -221,11 +348,33 @@ public:
       .onDiscarded(executor.defer(lambda::bind(&Log::discarded, this)));
   }
 
+  // Creates a new replicated log with the specified name that shares
+  // the replica and network of the specified log, i.e., many logs can
+  // be kept using the same replicas (and the same storage, where the
+  // writes to each of them get persisted together) rather than a set
+  // of replicas per log. Otherwise the logs are independent, e.g.,
+  // each of them has its own writer. The specified log must outlive
+  // this one. Note that a name can't include '/'.
+  Log(Log* log, const std::string& _name)
+    : group(NULL),
+      quorum(log->quorum),
+      replica(log->replica),
+      network(log->network),
+      name(_name),
+      shared(true)
+  {
+    CHECK(!name.empty()) << "A named log needs a name";
+    CHECK(name.find('/') == std::string::npos)
+      << "Bad log name '" << name << "'";
+  }
+
   ~Log()
   {
-    delete network;
-    delete group;
-    delete replica;
+    if (!shared) {
+      delete network;
+      delete group;
+      delete replica;
+    }
   }
 
   // Returns a position based off of the bytes recovered from
@@ -246,9 +395,24 @@ public:
     return Position(value);
   }
 private:
+  friend class Cursor;
   friend class Reader;
   friend class Writer;
 
+  // Returns the entries for the specified actions, unless they don't
+  // include (learned) actions for each position starting at 'from'.
+  static Result<std::list<Entry> > entries(
+      uint64_t from,
+      const std::list<Action>& actions);
+
+  // Continuations for Reader::read and Writer::append (the ones that
+  // return futures).
+  static process::Future<std::list<Entry> > _read(
+      uint64_t from,
+      const std::list<Action>& actions);
+
+  static Position _append(const uint64_t& position);
+
   // TODO(benh): Factor this out into some sort of "membership renewer".
   void watch(const std::set<zookeeper::Group::Membership>& memberships);
   void failed(const std::string& message) const;
@@ -262,23 +426,28 @@ private:
 
   Replica* replica;
   Network* network;
+
+  std::string name; // Empty for the default log (see Replica).
+
+  bool shared; // Whether this log uses the replica of another log.
 };
 
 
-Log::Reader::Reader(Log* log)
-  : replica(log->replica) {}
+inline Log::Reader::Reader(Log* log)
+  : replica(log->replica),
+    name(log->name) {}
 
 
-Log::Reader::~Reader() {}
+inline Log::Reader::~Reader() {}
 
 
-Result<std::list<Log::Entry> > Log::Reader::read(
+inline Result<std::list<Log::Entry> > Log::Reader::read(
     const Log::Position& from,
     const Log::Position& to,
     const seconds& timeout)
 {
   process::Future<std::list<Action> > actions =
-    replica->read(from.value, to.value);
+    replica->read(from.value, to.value, name);
 
   if (!actions.await(timeout.value)) {
     return Result<std::list<Log::Entry> >::none();
@@ -288,11 +457,54 @@ Result<std::list<Log::Entry> > Log::Reader::read(
 
   CHECK(actions.isReady()) << "Not expecting discarded future!";
 
+  return Log::entries(from.value, actions.get());
+}
+
+
+inline process::Future<std::list<Log::Entry> > Log::Reader::read(
+    const Log::Position& from,
+    const Log::Position& to)
+{
+  return replica->read(from.value, to.value, name)
+    .then(lambda::function<process::Future<std::list<Log::Entry> >(
+              const std::list<Action>&)>(
+                  lambda::bind(&Log::_read, from.value, lambda::_1)));
+}
+
+
+inline process::Future<std::list<Log::Entry> > Log::_read(
+    uint64_t from,
+    const std::list<Action>& actions)
+{
+  Result<std::list<Log::Entry> > entries = Log::entries(from, actions);
+
+  if (entries.isError()) {
+    process::Promise<std::list<Log::Entry> > promise;
+    promise.fail(entries.error());
+    return promise.future();
+  }
+
+  CHECK(entries.isSome());
+
+  return entries.get();
+}
+
+
+inline Log::Position Log::_append(const uint64_t& position)
+{
+  return Log::Position(position);
+}
+
+
+inline Result<std::list<Log::Entry> > Log::entries(
+    uint64_t from,
+    const std::list<Action>& actions)
+{
   std::list<Log::Entry> entries;
 
-  uint64_t position = from.value;
+  uint64_t position = from;
 
-  foreach (const Action& action, actions.get()) {
+  foreach (const Action& action, actions) {
     // Ensure read range is valid.
     if (!action.has_performed() ||
         !action.has_learned() ||
@@ -307,7 +519,9 @@ Result<std::list<Log::Entry> > Log::Reader::read(
     // And only return appends.
     CHECK(action.has_type());
     if (action.type() == Action::APPEND) {
-      entries.push_back(Entry(action.position(), action.append().bytes()));
+      entries.push_back(Entry(action.position(),
+                              action.append().bytes(),
+                              action.append().snapshot()));
     }
   }
 
@@ -315,53 +529,139 @@ Result<std::list<Log::Entry> > Log::Reader::read(
 }
 
 
-Log::Position Log::Reader::beginning()
+inline Log::Position Log::Reader::beginning()
 {
   // TODO(benh): Take a timeout and return an Option.
-  process::Future<uint64_t> value = replica->beginning();
+  process::Future<uint64_t> value = replica->beginning(name);
   value.await();
   CHECK(value.isReady()) << "Not expecting a failed or discarded future!";
   return Log::Position(value.get());
 }
 
 
-Log::Position Log::Reader::ending()
+inline Log::Position Log::Reader::ending()
 {
   // TODO(benh): Take a timeout and return an Option.
-  process::Future<uint64_t> value = replica->ending();
+  process::Future<uint64_t> value = replica->ending(name);
   value.await();
   CHECK(value.isReady()) << "Not expecting a failed or discarded future!";
   return Log::Position(value.get());
 }
 
 
-Log::Writer::Writer(Log* log, const seconds& timeout, int retries)
-  : coordinator(log->quorum, log->replica, log->network),
-    error(Option<std::string>::none())
+inline Log::Cursor::Cursor(
+    Log* log,
+    const Log::Position& _from,
+    const Log::Position& _to,
+    size_t _chunk)
+  : replica(log->replica),
+    name(log->name),
+    to(_to.value),
+    chunk(_chunk),
+    from(_from.value),
+    until(_from.value)
+{
+  CHECK(chunk > 0);
+
+  if (from <= to) {
+    prefetch();
+  }
+}
+
+
+inline Log::Cursor::~Cursor() {}
+
+
+inline bool Log::Cursor::done() const
+{
+  return from > to;
+}
+
+
+inline Result<std::list<Log::Entry> > Log::Cursor::next(
+    const seconds& timeout)
+{
+  if (done()) {
+    return Result<std::list<Log::Entry> >::error("No more entries");
+  }
+
+  if (!actions.await(timeout.value)) {
+    return Result<std::list<Log::Entry> >::none();
+  } else if (actions.isFailed()) {
+    return Result<std::list<Log::Entry> >::error(actions.failure());
+  }
+
+  CHECK(actions.isReady()) << "Not expecting discarded future!";
+
+  // Hold on to the actions (and the position they start at) so that
+  // we can start reading the next chunk before converting them.
+  const uint64_t position = from;
+  const std::list<Action> current = actions.get();
+
+  from = until + 1;
+
+  if (from <= to) {
+    prefetch();
+  }
+
+  return Log::entries(position, current);
+}
+
+
+inline void Log::Cursor::prefetch()
+{
+  CHECK(from <= to);
+
+  // Careful not to overflow when computing the end of the chunk.
+  until = to - from < chunk ? to : from + chunk - 1;
+
+  actions = replica->read(from, until, name);
+}
+
+
+inline Log::Writer::Writer(
+    Log* log,
+    const seconds& timeout,
+    int retries,
+    const seconds& lease)
+  : coordinator(log->quorum,
+                log->replica,
+                log->network,
+                32,
+                lease.value,
+                log->name),
+    error(Option<std::string>::none()),
+    replica(log->replica),
+    name(log->name),
+    interval(0),
+    appended(0)
 {
   LOG(INFO) << "Number of retries: " << retries;
 
   do {
-    Result<uint64_t> result = coordinator.elect(Timeout(timeout.value));
-    if (result.isNone()) {
+    process::Future<uint64_t> result =
+      coordinator.elect(Timeout(timeout.value));
+    result.await();
+    if (result.isDiscarded()) {
       retries--;
-    } else if (result.isSome()) {
+    } else if (result.isReady()) {
       break;
     } else {
-      error = result.error();
+      CHECK(result.isFailed());
+      error = result.failure();
       break;
     }
   } while (retries > 0);
 }
 
 
-Log::Writer::~Writer()
+inline Log::Writer::~Writer()
 {
   coordinator.demote();
 }
 
 
-Result<Log::Position> Log::Writer::append(
+inline Result<Log::Position> Log::Writer::append(
     const std::string& data,
     const seconds& timeout)
 {
@@ -371,22 +671,86 @@ Result<Log::Position> Log::Writer::append(
 
   LOG(INFO) << "Attempting to append " << data.size() << " bytes to the log";
 
-  Result<uint64_t> result = coordinator.append(data, Timeout(timeout.value));
+  process::Future<uint64_t> position =
+    coordinator.append(data, Timeout(timeout.value));
+
+  // N.B. The coordinator times out the append itself (discarding the
+  // future) so we don't need to wait with a timeout here.
+  position.await();
 
-  if (result.isError()) {
-    error = result.error();
+  if (position.isFailed()) {
+    error = position.failure();
     return Result<Log::Position>::error(error.get());
-  } else if (result.isNone()) {
+  } else if (position.isDiscarded()) {
     return Result<Log::Position>::none();
   }
 
-  CHECK(result.isSome());
+  CHECK(position.isReady());
+
+  produce(1, timeout);
 
-  return Log::Position(result.get());
+  return Log::Position(position.get());
 }
 
 
-Result<Log::Position> Log::Writer::truncate(
+inline process::Future<Log::Position> Log::Writer::append(
+    const std::string& data,
+    const process::Timeout& timeout)
+{
+  if (error.isSome()) {
+    process::Promise<Log::Position> promise;
+    promise.fail(error.get());
+    return promise.future();
+  }
+
+  // N.B. Unlike the other operations a failure doesn't get saved in
+  // 'error' since the writer might be gone by then, but the
+  // coordinator itself rejects any subsequent operations (it's no
+  // longer elected) which has the same effect.
+  return coordinator.append(data, timeout)
+    .then(lambda::function<Log::Position(const uint64_t&)>(&Log::_append));
+}
+
+
+inline Result<std::pair<Log::Position, Log::Position> > Log::Writer::append(
+    const std::vector<std::string>& entries,
+    const seconds& timeout)
+{
+  typedef std::pair<Log::Position, Log::Position> Range;
+
+  if (error.isSome()) {
+    return Result<Range>::error(error.get());
+  } else if (entries.empty()) {
+    return Result<Range>::error("No entries to append");
+  }
+
+  LOG(INFO) << "Attempting to append " << entries.size()
+            << " entries to the log";
+
+  process::Future<std::list<uint64_t> > positions =
+    coordinator.append(entries, Timeout(timeout.value));
+
+  // N.B. Like above, the coordinator times out the append itself.
+  positions.await();
+
+  if (positions.isFailed()) {
+    error = positions.failure();
+    return Result<Range>::error(error.get());
+  } else if (positions.isDiscarded()) {
+    return Result<Range>::none();
+  }
+
+  CHECK(positions.isReady());
+  CHECK(positions.get().size() == entries.size());
+
+  produce(entries.size(), timeout);
+
+  return std::make_pair(Log::Position(positions.get().front()),
+                        Log::Position(positions.get().back()));
+}
+
+
+inline Result<Log::Position> Log::Writer::truncate(
     const Log::Position& to,
     const seconds& timeout)
 {
@@ -396,23 +760,145 @@ Result<Log::Position> Log::Writer::truncate(
 
   LOG(INFO) << "Attempting to truncate the log to " << to.value;
 
-  Result<uint64_t> result =
+  process::Future<uint64_t> position =
     coordinator.truncate(to.value, Timeout(timeout.value));
 
-  if (result.isError()) {
-    error = result.error();
+  position.await(); // See comment in Log::Writer::append.
+
+  if (position.isFailed()) {
+    error = position.failure();
+    return Result<Log::Position>::error(error.get());
+  } else if (position.isDiscarded()) {
+    return Result<Log::Position>::none();
+  }
+
+  CHECK(position.isReady());
+
+  return Log::Position(position.get());
+}
+
+
+inline Result<Log::Position> Log::Writer::snapshot(
+    const std::string& state,
+    const seconds& timeout)
+{
+  if (error.isSome()) {
+    return Result<Log::Position>::error(error.get());
+  }
+
+  LOG(INFO) << "Attempting to append a " << state.size()
+            << " byte snapshot to the log";
+
+  process::Future<uint64_t> position =
+    coordinator.snapshot(state, Timeout(timeout.value));
+
+  position.await(); // See comment in Log::Writer::append.
+
+  if (position.isFailed()) {
+    error = position.failure();
+    return Result<Log::Position>::error(error.get());
+  } else if (position.isDiscarded()) {
+    return Result<Log::Position>::none();
+  }
+
+  CHECK(position.isReady());
+
+  appended = 0;
+
+  return Log::Position(position.get());
+}
+
+
+inline Result<Log::Position> Log::Writer::ending(const seconds& timeout)
+{
+  if (error.isSome()) {
+    return Result<Log::Position>::error(error.get());
+  }
+
+  process::Future<uint64_t> position =
+    coordinator.ending(Timeout(timeout.value));
+
+  position.await(); // See comment in Log::Writer::append.
+
+  if (position.isFailed()) {
+    error = position.failure();
     return Result<Log::Position>::error(error.get());
-  } else if (result.isNone()) {
+  } else if (position.isDiscarded()) {
     return Result<Log::Position>::none();
   }
 
-  CHECK(result.isSome());
+  CHECK(position.isReady());
+
+  return Log::Position(position.get());
+}
+
+
+inline Result<std::list<Log::Entry> > Log::Writer::read(
+    const Log::Position& from,
+    const Log::Position& to,
+    const seconds& timeout)
+{
+  Timeout deadline(timeout.value);
+
+  Result<Log::Position> ending = Log::Writer::ending(timeout);
+
+  if (ending.isError()) {
+    return Result<std::list<Log::Entry> >::error(ending.error());
+  } else if (ending.isNone()) {
+    return Result<std::list<Log::Entry> >::none();
+  } else if (to > ending.get()) {
+    return Result<std::list<Log::Entry> >::error(
+        "Bad read range (past end of log)");
+  }
+
+  // Our local replica has every committed position (we commit to it
+  // first), so it's up to date as of 'ending'.
+  process::Future<std::list<Action> > actions =
+    replica->read(from.value, to.value, name);
+
+  if (!actions.await(deadline.remaining())) {
+    return Result<std::list<Log::Entry> >::none();
+  } else if (actions.isFailed()) {
+    return Result<std::list<Log::Entry> >::error(actions.failure());
+  }
+
+  CHECK(actions.isReady()) << "Not expecting discarded future!";
+
+  return Log::entries(from.value, actions.get());
+}
+
+
+inline void Log::Writer::snapshots(
+    const lambda::function<std::string(void)>& _producer,
+    size_t _interval)
+{
+  producer = _producer;
+  interval = _interval;
+  appended = 0;
+}
 
-  return Log::Position(result.get());
+
+inline void Log::Writer::produce(
+    size_t entries,
+    const seconds& timeout)
+{
+  appended += entries;
+
+  if (producer && interval > 0 && appended >= interval) {
+    // N.B. A failed snapshot isn't returned to the append that
+    // triggered it (although it still invalidates this writer), and
+    // after a timeout we'll just try again with the next append.
+    Result<Log::Position> position = snapshot(producer(), timeout);
+    if (!position.isSome()) {
+      LOG(WARNING) << "Failed to snapshot the log: "
+                   << (position.isError() ? position.error() : "timed out");
+    }
+  }
 }
 
 
-void Log::watch(const std::set<zookeeper::Group::Membership>& memberships)
+inline void Log::watch(
+    const std::set<zookeeper::Group::Membership>& memberships)
 {
   if (membership.isReady() && memberships.count(membership.get()) == 0) {
     // Our replica's membership must have expired, join back up.
@@ -429,13 +915,13 @@ void Log::watch(const std::set<zookeeper::Group::Membership>& memberships)
 }
 
 
-void Log::failed(const std::string& message) const
+inline void Log::failed(const std::string& message) const
 {
   LOG(FATAL) << "Failed to participate in ZooKeeper group: " << message;
 }
 
 
-void Log::discarded() const
+inline void Log::discarded() const
 {
   LOG(FATAL) << "Not expecting future to get discarded!";
 }
@@ -22,8 +22,10 @@
 // TODO(benh): Eventually move and associate this code with the
 // libprocess protobuf code rather than keep it here.
 
+#include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include <process/deferred.hpp>
 #include <process/executor.hpp>
@@ -146,15 +148,10 @@ public:
       const Req& req,
       const std::set<process::UPID>& filter)
   {
-    std::set<process::Future<Res> > futures;
-    typename std::set<process::UPID>::const_iterator iterator;
-    for (iterator = pids.begin(); iterator != pids.end(); ++iterator) {
-      const process::UPID& pid = *iterator;
-      if (filter.count(pid) == 0) {
-        futures.insert(protocol(pid, req));
-      }
-    }
-    return futures;
+    // The request gets serialized once for all of the members.
+    const std::vector<process::Future<Res> > responses =
+      protocol(members(filter), req);
+    return std::set<process::Future<Res> >(responses.begin(), responses.end());
   }
 
   template <typename M>
@@ -162,16 +159,24 @@ public:
       const M& m,
       const std::set<process::UPID>& filter)
   {
+    // The message gets serialized once for all of the members.
+    process::post(members(filter), m);
+  }
+
+private:
+  // Returns the members of the group that aren't filtered out.
+  std::vector<process::UPID> members(const std::set<process::UPID>& filter)
+  {
+    std::vector<process::UPID> result;
     std::set<process::UPID>::const_iterator iterator;
     for (iterator = pids.begin(); iterator != pids.end(); ++iterator) {
-      const process::UPID& pid = *iterator;
-      if (filter.count(pid) == 0) {
-        process::post(pid, m);
+      if (filter.count(*iterator) == 0) {
+        result.push_back(*iterator);
       }
     }
+    return result;
   }
 
-private:
   // Not copyable, not assignable.
   NetworkProcess(const NetworkProcess&);
   NetworkProcess& operator = (const NetworkProcess&);
@@ -274,29 +279,26 @@ inline void ZooKeeperNetwork::ready(
 {
   LOG(INFO) << "ZooKeeper group memberships changed";
 
-  // Get infos for each membership in order to convert them to PIDs.
-  std::set<process::Future<std::string> > futures;
+  // Get infos for the memberships (in one go) in order to convert
+  // them to PIDs.
+  process::Future<std::map<zookeeper::Group::Membership, std::string> > infos =
+    group->infos(memberships);
 
-  foreach (const zookeeper::Group::Membership& membership, memberships) {
-    futures.insert(group->info(membership));
+  if (!infos.await(5.0)) {
+    watch(); // Try again later assuming empty group.
+    return;
   }
 
+  CHECK(infos.isReady())
+    << "Failed to get ZooKeeper group infos: "
+    << (infos.isFailed() ? infos.failure() : "discarded");
+
   std::set<process::UPID> pids;
 
-  process::Timeout timeout = 5.0;
-
-  while (!futures.empty()) {
-    process::Future<process::Future<std::string> > future = select(futures);
-    if (future.await(timeout.remaining())) {
-      CHECK(future.get().isReady());
-      process::UPID pid(future.get().get());
-      CHECK(pid) << "Failed to parse '" << future.get().get() << "'";
-      pids.insert(pid);
-      futures.erase(future.get());
-    } else {
-      watch(); // Try again later assuming empty group.
-      return;
-    }
+  foreachvalue (const std::string& info, infos.get()) {
+    process::UPID pid(info);
+    CHECK(pid) << "Failed to parse '" << info << "'";
+    pids.insert(pid);
   }
 
   LOG(INFO) << "ZooKeeper group PIDs: "
@@ -16,15 +16,36 @@
  * limitations under the License.
  */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <google/protobuf/io/coded_stream.h>
+
+#include <leveldb/cache.h>
 #include <leveldb/comparator.h>
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
 #include <algorithm>
+#include <deque>
+#include <fstream>
+#include <utility>
+#include <vector>
 
 #include <process/dispatch.hpp>
+#include <process/metrics.hpp>
 #include <process/protobuf.hpp>
+#include <process/timeout.hpp>
+#include <process/timer.hpp>
 
+#include "common/option.hpp"
 #include "common/timer.hpp"
 #include "common/utils.hpp"
 
@@ -37,7 +58,8 @@ using namespace process;
 using process::wait; // Necessary on some OS's to disambiguate.
 
 using std::list;
-using std::set;
+using std::map;
+using std::pair;
 using std::string;
 
 
@@ -55,28 +77,174 @@ Protocol<LearnRequest, LearnResponse> learn;
 } // namespace protocol {
 
 
+// Tuning of the leveldb options the replica uses. A log gets
+// appended to sequentially and mostly read in ranges, so it can use
+// bigger write buffers (fewer, larger level-0 tables to compact) and
+// blocks (fewer index entries and reads per range) than leveldb's
+// defaults, along with its own block cache.
+static const size_t LEVELDB_WRITE_BUFFER_SIZE = 16 * 1024 * 1024;
+static const size_t LEVELDB_BLOCK_SIZE = 32 * 1024;
+static const size_t LEVELDB_CACHE_SIZE = 32 * 1024 * 1024;
+
+// Rate at which truncated positions get deleted from leveldb, and how
+// long to wait after the last deletes before compacting them (see
+// TruncateProcess).
+static const uint64_t TRUNCATE_CHUNK_SIZE = 1024;
+static const double TRUNCATE_CHUNK_INTERVAL = 0.01;
+static const double TRUNCATE_COMPACT_DELAY = 10.0;
+
+// Size of the segments of a SegmentStorage (a batch of records that
+// doesn't fit in a segment of this size gets one of its own).
+static const size_t SEGMENT_SIZE = 64 * 1024 * 1024;
+
+// Maximum size (in bytes) of the actions a replica keeps in memory
+// so that reading recent positions doesn't need to go to storage.
+static const size_t CACHE_SIZE = 16 * 1024 * 1024;
+
+// Reads of a range of positions by whether the replica served them
+// from memory (see ReplicaProcess::cached), and the size of the
+// actions in memory (of all the replicas in this process).
+static process::metrics::Counter hits(
+    "mesos_log_replica_reads_total",
+    "Reads of a range of positions, by whether they were cached.",
+    process::metrics::label("cached", "true"));
+
+static process::metrics::Counter misses(
+    "mesos_log_replica_reads_total",
+    "Reads of a range of positions, by whether they were cached.",
+    process::metrics::label("cached", "false"));
+
+static process::metrics::Gauge cachedBytes(
+    "mesos_log_replica_cached_bytes",
+    "Size of the actions replicas keep in memory for reads.");
+
+
 struct State
 {
+  State() : coordinator(0), begin(0), end(0)
+  {
+    // Position 0 is a hole in a brand new log (a coordinator will
+    // simply fill it with a no-op when it first gets elected).
+    holes.add(0);
+  }
+
   uint64_t coordinator; // Last promise made to a coordinator.
   uint64_t begin; // Beginning position of the log.
   uint64_t end; // Ending position of the log.
-  std::set<uint64_t> learned; // Positions present and learned
-  std::set<uint64_t> unlearned; // Positions present but unlearned.
+  intervalset<uint64_t> holes; // Positions missing before the end.
+  intervalset<uint64_t> unlearned; // Positions present but unlearned.
 };
 
 
-// Abstract interface for reading and writing records.
+// Updates the state to include a written record. Records must be
+// applied in the order they were written (or in position order).
+static void apply(State* state, const Record& record)
+{
+  if (record.type() == Record::PROMISE) {
+    CHECK(record.has_promise());
+    state->coordinator = record.promise().id();
+  } else if (record.type() == Record::ACTION) {
+    CHECK(record.has_action());
+    const Action& action = record.action();
+
+    state->holes.remove(action.position());
+
+    if (action.has_learned() && action.learned()) {
+      state->unlearned.remove(action.position());
+      if (action.has_type() && action.type() == Action::TRUNCATE) {
+        state->begin = std::max(state->begin, action.truncate().to());
+      }
+    } else {
+      state->unlearned.add(action.position());
+    }
+
+    state->holes.add(state->end + 1, action.position());
+
+    state->end = std::max(state->end, action.position());
+
+    // Truncated positions are neither holes nor unlearned.
+    state->holes.remove(0, state->begin);
+    state->unlearned.remove(0, state->begin);
+  }
+}
+
+
+// Helpers for converting between sets of positions and the ranges
+// they get stored as in the metadata.
+static void ranges(
+    const intervalset<uint64_t>& positions,
+    google::protobuf::RepeatedPtrField<Metadata::Range>* ranges)
+{
+  foreachpair (uint64_t begin, uint64_t end, positions) {
+    Metadata::Range* range = ranges->Add();
+    range->set_begin(begin);
+    range->set_end(end);
+  }
+}
+
+
+static void positions(
+    const google::protobuf::RepeatedPtrField<Metadata::Range>& ranges,
+    intervalset<uint64_t>* positions)
+{
+  foreach (const Metadata::Range& range, ranges) {
+    positions->add(range.begin(), range.end());
+  }
+}
+
+
+// Returns the state of a log from its (serialized) metadata record.
+static Try<State> restore(const leveldb::Slice& value)
+{
+  google::protobuf::io::ArrayInputStream stream(value.data(), value.size());
+
+  Record record;
+
+  if (!record.ParseFromZeroCopyStream(&stream) ||
+      record.type() != Record::METADATA) {
+    return Try<State>::error("Failed to deserialize metadata");
+  }
+
+  const Metadata& metadata = record.metadata();
+
+  State state;
+  state.coordinator = metadata.promised();
+  state.begin = metadata.begin();
+  state.end = metadata.end();
+  state.holes.clear();
+  positions(metadata.holes(), &state.holes);
+  positions(metadata.unlearned(), &state.unlearned);
+
+  return state;
+}
+
+
+// Abstract interface for reading and writing records (of any of the
+// logs, see Record::log). Records get persisted in batches, all of
+// the records in a batch are written atomically (and durably) or not
+// at all. Recovering returns the state of each log (by name) as of
+// the last batch persisted.
 class Storage
 {
 public:
   virtual ~Storage() {}
-  virtual Try<State> recover(const string& path) = 0;
-  virtual Try<void> persist(const Promise& promise) = 0;
-  virtual Try<void> persist(const Action& action) = 0;
-  virtual Try<Action> read(uint64_t position) = 0;
+  virtual Try<map<string, State> > recover(const string& path) = 0;
+  virtual Try<void> persist(const list<Record>& records) = 0;
+  virtual Try<Action> read(const string& log, uint64_t position) = 0;
+
+  // Returns all of the actions present between the specified
+  // positions inclusive (in order).
+  virtual Try<list<Action> > read(
+      const string& log,
+      uint64_t from,
+      uint64_t to) = 0;
 };
 
 
+// Forward declaration.
+class TruncateProcess;
+
+
 // Concrete implementation of the storage interface using leveldb.
 class LevelDBStorage : public Storage
 {
@@ -84,12 +252,36 @@ public:
   LevelDBStorage();
   virtual ~LevelDBStorage();
 
-  virtual Try<State> recover(const string& path);
-  virtual Try<void> persist(const Promise& promise);
-  virtual Try<void> persist(const Action& action);
-  virtual Try<Action> read(uint64_t position);
+  virtual Try<map<string, State> > recover(const string& path);
+  virtual Try<void> persist(const list<Record>& records);
+  virtual Try<Action> read(const string& log, uint64_t position);
+  virtual Try<list<Action> > read(
+      const string& log,
+      uint64_t from,
+      uint64_t to);
 
 private:
+  friend class TruncateProcess;
+
+  // Recovers the state of the default log (see 'recover').
+  Try<State> recover();
+
+  // Adds the metadata record for the specified state of a log to a
+  // batch.
+  Try<void> metadata(
+      const string& log,
+      const State& state,
+      leveldb::WriteBatch* batch);
+
+  // Starts deleting the truncated positions of a log (in the
+  // background), the first of which is still in leveldb.
+  void truncate(const string& log, uint64_t first);
+
+  // Orders keys by the (varint encoded) positions they represent.
+  // Any other key (i.e., the metadata key) sorts after every position
+  // and bytewise amongst themselves. Note that leveldb might compare
+  // keys we didn't write ourselves (e.g., when building its indexes)
+  // so this must never assume a key is a valid varint.
   class Varint64Comparator : public leveldb::Comparator
   {
   public:
@@ -97,13 +289,20 @@ private:
         const leveldb::Slice& a,
         const leveldb::Slice& b) const
     {
-      // TODO(benh): Use varint comparator.
-      LOG(FATAL) << "Unimplemented";
-      // uint64_t left = position(a);
-      // uint64_t right = position(b);
-      // if (left < right) return -1;
-      // if (left == right) return 0;
-      // if (left > right) return 1;
+      const Option<uint64_t>& left = varint(a);
+      const Option<uint64_t>& right = varint(b);
+
+      if (left.isSome() && right.isSome()) {
+        if (left.get() < right.get()) return -1;
+        if (left.get() > right.get()) return 1;
+        return 0;
+      } else if (left.isSome()) {
+        return -1;
+      } else if (right.isSome()) {
+        return 1;
+      }
+
+      return a.compare(b);
     }
 
     virtual const char* Name() const
@@ -127,21 +326,54 @@ private:
     }
   };
 
-  // Returns a string representing the specified position. Note that
-  // we adjust the actual position by incrementing it by 1 because we
-  // reserve 0 for storing the promise record (Record::Promise).
-  static string encode(uint64_t position, bool adjust = true)
+  // Returns the value of the varint that makes up all of the slice,
+  // if it is one.
+  static Option<uint64_t> varint(const leveldb::Slice& s)
+  {
+    uint64_t value = 0;
+
+    for (size_t i = 0; i < s.size() && i < 10; i++) {
+      const uint64_t byte = static_cast<unsigned char>(s[i]);
+      value |= (byte & 0x7f) << (7 * i);
+      if ((byte & 0x80) == 0) {
+        if (i + 1 < s.size()) {
+          break; // Trailing bytes, not a varint.
+        }
+        return value;
+      }
+    }
+
+    return Option<uint64_t>::none();
+  }
+
+  // Returns a string representing the specified position of a log.
+  // Note that we adjust the actual position by incrementing it by 1
+  // because we reserve 0 for storing the promise record
+  // (Record::Promise). The positions of the default log are varints
+  // (or decimal strings, see 'legacy') while the positions of a named
+  // log follow its prefix (see 'prefix') as 8 bytes in big endian
+  // order, so that they sort by position with either comparator (and
+  // after all of the positions of the default log).
+  string encode(const string& log, uint64_t position, bool adjust = true) const
   {
     // Adjusted stringified represenation is plus 1 of actual position.
     position = adjust ? position + 1 : position;
 
-    // TODO(benh): Use varint encoding for VarInt64Comparator!
-    // string s;
-    // google::protobuf::io::StringOutputStream _stream(&s);
-    // google::protobuf::io::CodedOutputStream stream(&_stream);
-    // position = adjust ? position + 1 : position;
-    // stream.WriteVarint64(position);
-    // return s;
+    if (!log.empty()) {
+      string key = prefix(log) + "p";
+      for (int shift = 56; shift >= 0; shift -= 8) {
+        key += static_cast<char>(0xff & (position >> shift));
+      }
+      return key;
+    }
+
+    if (!legacy) {
+      google::protobuf::uint8 bytes[10];
+      google::protobuf::uint8* end =
+        google::protobuf::io::CodedOutputStream::WriteVarint64ToArray(
+            position, bytes);
+      return string(reinterpret_cast<char*>(bytes), end - bytes);
+    }
 
     Try<string> s = strings::format("%.*d", 10, position);
     CHECK(s.isSome());
@@ -151,31 +383,225 @@ private:
   // Returns the position as represented in the specified slice
   // (performing a decrement as necessary to determine the actual
   // position represented).
-  static uint64_t decode(const leveldb::Slice& s)
+  uint64_t decode(const string& log, const leveldb::Slice& s) const
   {
-    // TODO(benh): Use varint decoding for VarInt64Comparator!
-    // uint64_t position;
-    // google::protobuf::io::ArrayInputStream _stream(s.data(), s.size());
-    // google::protobuf::io::CodedInputStream stream(&_stream);
-    // bool success = stream.ReadVarint64(&position);
-    // CHECK(success);
-    // return position - 1; // Actual position is less 1 of stringified.
+    if (!log.empty()) {
+      CHECK(s.size() == prefix(log).size() + 1 + 8);
+      uint64_t position = 0;
+      for (size_t i = s.size() - 8; i < s.size(); i++) {
+        position = (position << 8) | static_cast<unsigned char>(s[i]);
+      }
+      return position - 1; // Actual position is less 1 of encoded.
+    }
+
+    if (!legacy) {
+      const Option<uint64_t>& position = varint(s);
+      CHECK(position.isSome());
+      return position.get() - 1; // Actual position is less 1 of encoded.
+    }
+
     Try<uint64_t> position =
       utils::numify<uint64_t>(string(s.data(), s.size()));
     CHECK(position.isSome());
     return position.get() - 1; // Actual position is less 1 of stringified.
   }
 
-  // Varint64Comparator comparator; // TODO(benh): Use varint comparator.
+  // Returns the prefix of the keys of a named log (i.e., of its
+  // positions and its metadata). Note that a log name can't include
+  // '/' so that no prefix is a prefix of another one.
+  static string prefix(const string& log)
+  {
+    CHECK(!log.empty());
+    CHECK(log.find('/') == string::npos) << "Bad log name '" << log << "'";
+    return NAMED + log + "/";
+  }
+
+  // Returns whether the key is one of the positions of a log.
+  bool positional(const string& log, const leveldb::Slice& key) const
+  {
+    if (!log.empty()) {
+      const string& p = prefix(log) + "p";
+      return key.size() == p.size() + 8 && key.starts_with(p);
+    } else if (!legacy) {
+      return varint(key).isSome();
+    }
+
+    // Decimal keys have 10 digits, see 'encode'.
+    if (key.size() != 10) {
+      return false;
+    }
+
+    for (size_t i = 0; i < key.size(); i++) {
+      if (key[i] < '0' || key[i] > '9') {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // Returns the key of the metadata record of a log.
+  static string metakey(const string& log)
+  {
+    return log.empty() ? METADATA : prefix(log) + "m";
+  }
+
+  Varint64Comparator comparator;
+
+  // Whether the log was created before we used the varint comparator,
+  // in which case its keys are (zero padded) decimal strings in
+  // bytewise order.
+  bool legacy;
+
+  // Block cache, shared by all of the log's tables.
+  leveldb::Cache* cache;
+
+  // Key of the metadata record (Record::Metadata) of the default
+  // log, which sorts after the keys of all the positions.
+  static const char* const METADATA;
+
+  // File (in the log's directory) naming the comparator of the log.
+  static const char* const COMPARATOR;
+
+  // Prefix of the keys of all the named logs.
+  static const char* const NAMED;
 
   leveldb::DB* db;
 
-  uint64_t first; // First position still in leveldb, used during truncation.
+  // Deletes the truncated positions of each log in the background.
+  map<string, TruncateProcess*> truncators;
+
+  // State of each log as of the last batch persisted, which gets
+  // persisted (as a metadata record) along with every batch that
+  // includes records of that log, so that recovering only needs to
+  // read that record.
+  map<string, State> states;
+};
+
+
+const char* const LevelDBStorage::METADATA = "metadata";
+const char* const LevelDBStorage::COMPARATOR = "COMPARATOR";
+const char* const LevelDBStorage::NAMED = "log/";
+
+
+// Deletes the positions of a log that have been (learned to be)
+// truncated from leveldb in the background, TRUNCATE_CHUNK_SIZE keys at a time
+// every TRUNCATE_CHUNK_INTERVAL seconds, so that a big truncate
+// neither stalls the replica nor floods leveldb with deletes. Once
+// nothing has been deleted for TRUNCATE_COMPACT_DELAY seconds the
+// deleted range gets compacted, which reclaims the space (and saves
+// reads from skipping over the deletes). Note that leveldb allows
+// writing from more than one thread, so the replica keeps writing
+// while we delete. The positions being deleted are never read since
+// the replica treats anything before the beginning of the log as
+// truncated (and recovering just retries whatever deletes were left).
+class TruncateProcess : public Process<TruncateProcess>
+{
+public:
+  TruncateProcess(LevelDBStorage* _storage,
+                  const string& _log,
+                  uint64_t _first)
+    : storage(_storage),
+      log(_log),
+      first(_first),
+      to(_first),
+      compacted(_first),
+      deleting(false) {}
+
+  virtual ~TruncateProcess() {}
+
+  // Deletes all positions before the specified (learned) truncate
+  // position.
+  void truncate(uint64_t _to)
+  {
+    to = std::max(to, _to);
+
+    if (!deleting && first < to) {
+      deleting = true;
+      chunk();
+    }
+  }
+
+private:
+  // Deletes the next chunk of positions. Note that deleting a key
+  // that doesn't exist (because this replica had a hole there) is
+  // fine, and *much* cheaper than iterating to find the keys.
+  void chunk()
+  {
+    Timer timer;
+    timer.start();
+
+    const uint64_t end = std::min(to, first + TRUNCATE_CHUNK_SIZE);
+
+    leveldb::WriteBatch batch;
+
+    for (uint64_t position = first; position < end; position++) {
+      batch.Delete(storage->encode(log, position));
+    }
+
+    // We do this write asynchronously (e.g., using default options)
+    // since we can always delete the positions again.
+    leveldb::Status status =
+      storage->db->Write(leveldb::WriteOptions(), &batch);
+
+    if (!status.ok()) {
+      LOG(WARNING) << "Retrying failed leveldb batch delete: "
+                   << status.ToString();
+    } else {
+      LOG(INFO) << "Deleting ~" << end - first << " keys from leveldb took "
+                << timer.elapsed().millis() << " milliseconds";
+
+      first = end; // Save the new first position!
+    }
+
+    if (first < to) {
+      delay(TRUNCATE_CHUNK_INTERVAL, self(), &TruncateProcess::chunk);
+    } else {
+      deleting = false;
+      delay(TRUNCATE_COMPACT_DELAY, self(), &TruncateProcess::compact, first);
+    }
+  }
+
+  // Compacts the deleted positions, unless more have been deleted
+  // since (the specified position) was the first one left.
+  void compact(uint64_t position)
+  {
+    if (deleting || position != first || compacted >= first) {
+      return;
+    }
+
+    Timer timer;
+    timer.start();
+
+    const string& begin = storage->encode(log, compacted);
+    const string& end = storage->encode(log, first);
+
+    leveldb::Slice slices[] = { begin, end };
+
+    storage->db->CompactRange(&slices[0], &slices[1]);
+
+    LOG(INFO) << "Compacting positions " << compacted << " -> " << first
+              << " in leveldb took " << timer.elapsed().millis()
+              << " milliseconds";
+
+    compacted = first;
+  }
+
+  LevelDBStorage* storage;
+
+  const string log;
+
+  uint64_t first; // First position still in leveldb.
+  uint64_t to; // Position to delete up to (excluding).
+  uint64_t compacted; // Positions before this have been compacted.
+  bool deleting;
 };
 
 
 LevelDBStorage::LevelDBStorage()
-  : db(NULL), first(0)
+  : legacy(false),
+    cache(leveldb::NewLRUCache(LEVELDB_CACHE_SIZE)),
+    db(NULL)
 {
   // Nothing to see here.
 }
@@ -183,54 +609,177 @@ LevelDBStorage::LevelDBStorage()
 
 LevelDBStorage::~LevelDBStorage()
 {
+  foreachvalue (TruncateProcess* truncator, truncators) {
+    terminate(truncator);
+    wait(truncator);
+    delete truncator;
+  }
+
   delete db; // Might be null if open failed in LevelDBStorage::recover.
+  delete cache; // Only after the DB (which might still be using it).
 }
 
 
-Try<State> LevelDBStorage::recover(const string& path)
+Try<map<string, State> > LevelDBStorage::recover(const string& path)
 {
+  // The log is mostly appended to (sequentially) and read in ranges
+  // (when catching up or tailing it), see the LEVELDB_* constants.
   leveldb::Options options;
   options.create_if_missing = true;
+  options.comparator = &comparator;
+  options.block_cache = cache;
+  options.write_buffer_size = LEVELDB_WRITE_BUFFER_SIZE;
+  options.block_size = LEVELDB_BLOCK_SIZE;
+  options.compression = leveldb::kSnappyCompression;
+
+  // The name of the comparator a log was created with is kept next
+  // to it (leveldb refuses to open a DB with another comparator). A
+  // log that exists without one was created before we used the
+  // varint comparator, so it has to keep using the bytewise
+  // comparator along with its decimal keys.
+  const string& marker = path + "/" + COMPARATOR;
+
+  legacy = false;
+
+  if (utils::os::exists(marker)) {
+    std::ifstream in(marker.c_str());
+    string name;
+    if (!std::getline(in, name)) {
+      return Try<map<string, State> >::error(
+          "Failed to read " + marker);
+    } else if (name == leveldb::BytewiseComparator()->Name()) {
+      legacy = true;
+    } else if (name != comparator.Name()) {
+      return Try<map<string, State> >::error(
+          "Unknown comparator '" + name + "' in " + marker);
+    }
+  } else if (utils::os::exists(path + "/CURRENT")) {
+    legacy = true;
+  }
 
-  // TODO(benh): Can't use varint comparator until bug discussed at
-  // groups.google.com/group/leveldb/browse_thread/thread/17eac39168909ba7
-  // gets fixed. For now, we are using the default byte-wise
-  // comparator and *assuming* that the encoding from unsigned long to
-  // string produces a stable ordering. Checks below.
-  // options.comparator = &comparator;
-
-  const string& one = encode(1);
-  const string& two = encode(2);
-  const string& ten = encode(10);
-
-  CHECK(leveldb::BytewiseComparator()->Compare(one, two) < 0);
-  CHECK(leveldb::BytewiseComparator()->Compare(two, one) > 0);
-  CHECK(leveldb::BytewiseComparator()->Compare(one, ten) < 0);
-  CHECK(leveldb::BytewiseComparator()->Compare(ten, two) > 0);
-  CHECK(leveldb::BytewiseComparator()->Compare(ten, ten) == 0);
+  if (legacy) {
+    LOG(INFO) << "Opening log at " << path << " with legacy (decimal) keys";
+    options.comparator = leveldb::BytewiseComparator();
+  }
 
   leveldb::Status status = leveldb::DB::Open(options, path, &db);
 
   if (!status.ok()) {
     // TODO(benh): Consider trying to repair the DB.
-    return Try<State>::error(status.ToString());
+    return Try<map<string, State> >::error(status.ToString());
+  }
+
+  if (!utils::os::exists(marker)) {
+    std::ofstream out(marker.c_str());
+    out << options.comparator->Name() << std::endl;
+    if (!out) {
+      return Try<map<string, State> >::error(
+          "Failed to write " + marker);
+    }
+  }
+
+  states.clear();
+
+  Try<State> state = recover();
+
+  if (state.isError()) {
+    return Try<map<string, State> >::error(state.error());
+  }
+
+  states[""] = state.get();
+
+  // A named log always has a metadata record that covers all of its
+  // records (it gets written along with each of them), so recovering
+  // it only requires reading that record. The metadata record of a
+  // named log sorts right before its positions.
+  leveldb::Iterator* iterator = db->NewIterator(leveldb::ReadOptions());
+
+  iterator->Seek(NAMED);
+
+  while (iterator->Valid() && iterator->key().starts_with(NAMED)) {
+    const string& key = iterator->key().ToString();
+    const size_t slash = key.find('/', strlen(NAMED));
+
+    if (slash == string::npos || key.substr(slash) != "/m") {
+      delete iterator;
+      return Try<map<string, State> >::error(
+          "Missing metadata for log at key '" + key + "'");
+    }
+
+    const string& log = key.substr(strlen(NAMED), slash - strlen(NAMED));
+
+    Try<State> state = restore(iterator->value());
+
+    if (state.isError()) {
+      delete iterator;
+      return Try<map<string, State> >::error(state.error());
+    }
+
+    states[log] = state.get();
+
+    LOG(INFO) << "Recovered log '" << log << "' from its metadata";
+
+    // Determine the first position of the log still in leveldb, see
+    // the default log below.
+    iterator->Next();
+
+    uint64_t first = 0;
+
+    if (iterator->Valid() && positional(log, iterator->key())) {
+      first = decode(log, iterator->key());
+    }
+
+    truncate(log, first);
+
+    // Skip the rest of the positions of the log.
+    iterator->Seek(prefix(log) + "q");
   }
 
+  delete iterator;
+
+  return states;
+}
+
+
+Try<State> LevelDBStorage::recover()
+{
   State state;
-  state.coordinator = 0;
-  state.begin = 0;
-  state.end = 0;
 
-  // TODO(benh): Consider just reading the "promise" record (e.g.,
-  // 'encode(0, false)') and then iterating over the rest of the
-  // records and confirming that they are all indeed of type
-  // Record::Action.
+  // Start from the metadata (if this replica has written any) and
+  // only scan the positions written past its end, which the metadata
+  // normally covers (but not if they were written by a version that
+  // didn't keep the metadata). Without metadata we need to scan every
+  // record, in position order (which is the order of the keys).
+  string value;
+
+  leveldb::Status status = db->Get(leveldb::ReadOptions(), METADATA, &value);
+
+  bool found = status.ok();
+
+  if (!found && !status.IsNotFound()) {
+    return Try<State>::error(status.ToString());
+  } else if (found) {
+    Try<State> restored = restore(value);
+
+    if (restored.isError()) {
+      return restored;
+    }
+
+    state = restored.get();
+  }
 
   leveldb::Iterator* iterator = db->NewIterator(leveldb::ReadOptions());
 
-  iterator->SeekToFirst();
+  if (found) {
+    iterator->Seek(encode("", state.end + 1));
+  } else {
+    iterator->SeekToFirst();
+  }
+
+  uint64_t scanned = 0;
 
-  while (iterator->Valid()) {
+  for (; iterator->Valid() && positional("", iterator->key());
+       iterator->Next()) {
     const leveldb::Slice& slice = iterator->value();
 
     google::protobuf::io::ArrayInputStream stream(slice.data(), slice.size());
@@ -238,40 +787,43 @@ Try<State> LevelDBStorage::recover(const string& path)
     Record record;
 
     if (!record.ParseFromZeroCopyStream(&stream)) {
+      delete iterator;
       return Try<State>::error("Failed to deserialize record");
     }
 
-    switch (record.type()) {
-      case Record::PROMISE: {
-        CHECK(record.has_promise());
-        const Promise& promise = record.promise();
-        state.coordinator = promise.id();
-        break;
-      }
+    if (record.type() != Record::PROMISE && record.type() != Record::ACTION) {
+      delete iterator;
+      return Try<State>::error("Bad record");
+    }
 
-      case Record::ACTION: {
-        CHECK(record.has_action());
-        const Action& action = record.action();
-        if (action.has_learned() && action.learned()) {
-          state.learned.insert(action.position());
-          state.unlearned.erase(action.position());
-          if (action.has_type() && action.type() == Action::TRUNCATE) {
-            state.begin = std::max(state.begin, action.truncate().to());
-          }
-        } else {
-          state.learned.erase(action.position());
-          state.unlearned.insert(action.position());
-        }
-        state.end = std::max(state.end, action.position());
-        break;
-      }
+    apply(&state, record);
+    scanned++;
+  }
 
-      default: {
-        return Try<State>::error("Bad record");
-      }
+  LOG(INFO) << "Recovered the log from "
+            << (found ? "its metadata and " : "")
+            << scanned << " records";
+
+  // Persist the metadata now if it didn't cover every record, so
+  // that it does the next time.
+  if (!found || scanned > 0) {
+    leveldb::WriteBatch batch;
+
+    Try<void> added = metadata("", state, &batch);
+    if (added.isError()) {
+      delete iterator;
+      return Try<State>::error(added.error());
     }
 
-    iterator->Next();
+    leveldb::WriteOptions options;
+    options.sync = true;
+
+    status = db->Write(options, &batch);
+
+    if (!status.ok()) {
+      delete iterator;
+      return Try<State>::error(status.ToString());
+    }
   }
 
   // Determine the first position still in leveldb so during a
@@ -279,149 +831,910 @@ Try<State> LevelDBStorage::recover(const string& path)
   // position up to the truncate position. Note that this is not the
   // beginning position of the log, but rather the first position that
   // remains (i.e., hasn't been deleted) in leveldb.
-  iterator->Seek(encode(0));
+  iterator->Seek(encode("", 0));
 
-  if (iterator->Valid()) {
-    first = decode(iterator->key());
+  uint64_t first = 0;
+
+  if (iterator->Valid() && positional("", iterator->key())) {
+    first = decode("", iterator->key());
   }
 
   delete iterator;
 
+  // Finish deleting any positions that were truncated (e.g., before
+  // we failed) but not deleted yet.
+  truncate("", first);
+
   return state;
 }
 
 
-Try<void> LevelDBStorage::persist(const Promise& promise)
+void LevelDBStorage::truncate(const string& log, uint64_t first)
+{
+  CHECK(truncators.count(log) == 0);
+
+  TruncateProcess* truncator = new TruncateProcess(this, log, first);
+  spawn(truncator);
+
+  truncators[log] = truncator;
+
+  dispatch(truncator, &TruncateProcess::truncate, states[log].begin);
+}
+
+
+Try<void> LevelDBStorage::persist(const list<Record>& records)
 {
   Timer timer;
   timer.start();
 
+  leveldb::WriteBatch batch;
+
+  size_t size = 0; // Total bytes of the serialized records.
+
+  // The state of each log in this batch as of the batch, which only
+  // becomes the log's state once the batch has been written. A log
+  // we haven't seen before starts out empty.
+  map<string, State> updated;
+
+  foreach (const Record& record, records) {
+    const string& log = record.log();
+
+    if (updated.count(log) == 0) {
+      updated[log] = states.count(log) > 0 ? states[log] : State();
+    }
+
+    string value;
+
+    if (!record.SerializeToString(&value)) {
+      return Try<void>::error("Failed to serialize record");
+    }
+
+    size += value.size();
+
+    // N.B. If a batch includes more than one record for the same key
+    // the last one wins, so records must be in the order they were
+    // made.
+    switch (record.type()) {
+      case Record::PROMISE:
+        CHECK(record.has_promise());
+        batch.Put(encode(log, 0, false), value);
+        break;
+      case Record::ACTION:
+        CHECK(record.has_action());
+        batch.Put(encode(log, record.action().position()), value);
+        break;
+      default:
+        LOG(FATAL) << "Unknown Record::Type!";
+    }
+
+    apply(&updated[log], record);
+  }
+
+  foreachpair (const string& log, const State& state, updated) {
+    Try<void> added = metadata(log, state, &batch);
+    if (added.isError()) {
+      return added;
+    }
+  }
+
   leveldb::WriteOptions options;
   options.sync = true;
 
+  leveldb::Status status = db->Write(options, &batch);
+
+  if (!status.ok()) {
+    return Try<void>::error(status.ToString());
+  }
+
+  LOG(INFO) << "Persisting " << records.size() << " records ("
+            << size << " bytes) of " << updated.size()
+            << " logs to leveldb took "
+            << timer.elapsed().millis() << " milliseconds";
+
+  foreachpair (const string& log, const State& state, updated) {
+    const uint64_t begin = states.count(log) > 0 ? states[log].begin : 0;
+
+    states[log] = state;
+
+    // Delete positions (in the background) if a truncate action has
+    // been *learned*, i.e., the beginning of the log moved.
+    if (truncators.count(log) == 0) {
+      truncate(log, 0); // A new log.
+    } else if (state.begin > begin) {
+      dispatch(truncators[log], &TruncateProcess::truncate, state.begin);
+    }
+  }
+
+  return Try<void>::some();
+}
+
+
+Try<void> LevelDBStorage::metadata(const string& log,
+                                   const State& state,
+                                   leveldb::WriteBatch* batch)
+{
   Record record;
-  record.set_type(Record::PROMISE);
-  record.mutable_promise()->MergeFrom(promise);
+  record.set_type(Record::METADATA);
+
+  Metadata* metadata = record.mutable_metadata();
+  metadata->set_promised(state.coordinator);
+  metadata->set_begin(state.begin);
+  metadata->set_end(state.end);
+  ranges(state.holes, metadata->mutable_holes());
+  ranges(state.unlearned, metadata->mutable_unlearned());
 
   string value;
 
-  if (!record.SerializeToString(&value)) {
-    return Try<void>::error("Failed to serialize record");
+  if (!record.SerializeToString(&value)) {
+    return Try<void>::error("Failed to serialize metadata");
+  }
+
+  batch->Put(metakey(log), value);
+
+  return Try<void>::some();
+}
+
+
+Try<Action> LevelDBStorage::read(const string& log, uint64_t position)
+{
+  Timer timer;
+  timer.start();
+
+  string value;
+
+  leveldb::ReadOptions options;
+
+  leveldb::Status status = db->Get(options, encode(log, position), &value);
+
+  if (!status.ok()) {
+    return Try<Action>::error(status.ToString());
+  }
+
+  google::protobuf::io::ArrayInputStream stream(value.data(), value.size());
+
+  Record record;
+
+  if (!record.ParseFromZeroCopyStream(&stream)) {
+    return Try<Action>::error("Failed to deserialize record");
+  }
+
+  if (record.type() != Record::ACTION) {
+    return Try<Action>::error("Bad record");
+  }
+
+  LOG(INFO) << "Reading position from leveldb took "
+            << timer.elapsed().millis() << " milliseconds";
+
+  return record.action();
+}
+
+
+Try<list<Action> > LevelDBStorage::read(
+    const string& log,
+    uint64_t from,
+    uint64_t to)
+{
+  Timer timer;
+  timer.start();
+
+  // Use a single iterator (rather than a 'Get' per position) since
+  // the positions are stored in order.
+  leveldb::ReadOptions options;
+  options.fill_cache = false; // Avoid evicting the cache for big reads.
+
+  leveldb::Iterator* iterator = db->NewIterator(options);
+
+  const string& limit = encode(log, to);
+
+  // Keys need to be compared the way leveldb orders them (varints
+  // aren't in bytewise order).
+  const leveldb::Comparator* order =
+    legacy ? leveldb::BytewiseComparator() : &comparator;
+
+  list<Action> actions;
+
+  for (iterator->Seek(encode(log, from));
+       iterator->Valid() && order->Compare(iterator->key(), limit) <= 0;
+       iterator->Next()) {
+    const leveldb::Slice& value = iterator->value();
+
+    google::protobuf::io::ArrayInputStream stream(value.data(), value.size());
+
+    Record record;
+
+    if (!record.ParseFromZeroCopyStream(&stream)) {
+      delete iterator;
+      return Try<list<Action> >::error("Failed to deserialize record");
+    }
+
+    if (record.type() != Record::ACTION) {
+      delete iterator;
+      return Try<list<Action> >::error("Bad record");
+    }
+
+    actions.push_back(record.action());
+  }
+
+  if (!iterator->status().ok()) {
+    const string& message = iterator->status().ToString();
+    delete iterator;
+    return Try<list<Action> >::error(message);
+  }
+
+  delete iterator;
+
+  LOG(INFO) << "Reading " << actions.size() << " positions from leveldb took "
+            << timer.elapsed().millis() << " milliseconds";
+
+  return actions;
+}
+
+
+// Implementation of the storage interface that appends the records
+// (of all of the logs) to a sequence of segment files. A log only
+// gets appended to and truncated from its beginning, so unlike with
+// leveldb there's nothing to compact (nor the write amplification
+// that comes with it). Each batch gets appended with a single write
+// and synced with a single fdatasync. We keep an index (in memory)
+// of where the latest record of each position is and read records
+// straight out of the segments, which are mapped into memory. A
+// segment gets deleted as a whole once none of the indexed records
+// are in it (i.e., all of its positions have since been truncated
+// or written again), which is all a truncate amounts to. Every
+// segment starts with the metadata of each log as of when the
+// segment was started, so deleting older segments never loses a
+// promise (or the holes and unlearned positions of a log).
+//
+// Each record in a segment follows a header with its length and a
+// checksum (32 bits each, in host byte order). Segments get created
+// zero filled, so a zero length marks the end of the records, and
+// recovering stops at the first record that isn't intact (e.g.,
+// because we failed while appending it).
+class SegmentStorage : public Storage
+{
+public:
+  SegmentStorage();
+  virtual ~SegmentStorage();
+
+  virtual Try<map<string, State> > recover(const string& path);
+  virtual Try<void> persist(const list<Record>& records);
+  virtual Try<Action> read(const string& log, uint64_t position);
+  virtual Try<list<Action> > read(
+      const string& log,
+      uint64_t from,
+      uint64_t to);
+
+private:
+  struct Segment
+  {
+    uint64_t id; // Segments get appended to in order of their ids.
+    string path;
+    int fd;
+    const char* data; // Contents of the file, mapped read only.
+    size_t size; // Size of the file.
+    size_t used; // Bytes taken by records (and their headers).
+    size_t live; // Number of indexed records in the segment.
+  };
+
+  // Where a record is (N.B. not where its header is).
+  struct Location
+  {
+    Segment* segment;
+    size_t offset;
+    size_t length;
+  };
+
+  // Size of the header of each record.
+  static const size_t HEADER_SIZE = 8;
+
+  // Returns the path of the segment with the specified id.
+  string filename(uint64_t id) const;
+
+  // Creates and maps a new segment of (at least) the specified size.
+  Try<Segment*> create(size_t size);
+
+  // Maps an existing segment and recovers its records (see
+  // 'recover').
+  Try<Segment*> open(uint64_t id);
+
+  // Appends (and syncs) the buffer to the segment.
+  Try<void> write(Segment* segment, const string& buffer);
+
+  // Zeroes whatever follows the records of the segment (e.g., part of
+  // a batch we failed to append) so that appending to it again can't
+  // leave an intact old record after the new ones.
+  Try<void> discard(Segment* segment);
+
+  // Unmaps and closes a segment, deleting its file if requested.
+  void close(Segment* segment, bool remove);
+
+  // Appends the header and the specified record to a buffer.
+  static void append(const string& value, string* buffer);
+
+  // Indexes the record of an action at the specified location.
+  void index(const string& log, uint64_t position, const Location& location);
+
+  // Forgets the locations of truncated positions and deletes the
+  // segments (other than the last one) that have no indexed records.
+  void collect();
+
+  // Returns the (action) record at the specified location.
+  Try<Action> parse(const Location& location) const;
+
+  string directory;
+
+  // Segments in order of their ids, the last one gets appended to.
+  list<Segment*> segments;
+
+  // Location of the latest record of each position of each log.
+  map<string, map<uint64_t, Location> > locations;
+
+  // State of each log as of the last batch persisted.
+  map<string, State> states;
+};
+
+
+SegmentStorage::SegmentStorage() {}
+
+
+SegmentStorage::~SegmentStorage()
+{
+  foreach (Segment* segment, segments) {
+    close(segment, false);
+  }
+}
+
+
+Try<map<string, State> > SegmentStorage::recover(const string& path)
+{
+  directory = path;
+
+  if (!utils::os::mkdir(directory)) {
+    return Try<map<string, State> >::error(
+        "Failed to create directory " + directory);
+  }
+
+  // Find the existing segments (in order).
+  std::vector<uint64_t> ids;
+
+  foreach (const string& file, utils::os::listdir(directory)) {
+    if (file.find("segment-") == 0) {
+      Try<uint64_t> id = utils::numify<uint64_t>(file.substr(8));
+      if (id.isError()) {
+        return Try<map<string, State> >::error("Bad segment file " + file);
+      }
+      ids.push_back(id.get());
+    }
+  }
+
+  std::sort(ids.begin(), ids.end());
+
+  states.clear();
+
+  foreach (uint64_t id, ids) {
+    Try<Segment*> segment = open(id);
+
+    if (segment.isError()) {
+      return Try<map<string, State> >::error(segment.error());
+    }
+
+    segments.push_back(segment.get());
+  }
+
+  if (states.count("") == 0) {
+    states[""] = State();
+  }
+
+  if (segments.empty()) {
+    Try<Segment*> segment = create(SEGMENT_SIZE);
+
+    if (segment.isError()) {
+      return Try<map<string, State> >::error(segment.error());
+    }
+
+    segments.push_back(segment.get());
+  } else if (segments.back()->used == 0 && segments.size() > 1) {
+    // We must have failed before appending the first batch (and its
+    // checkpoint) to the last segment, so start it over.
+    segments.back()->live = 0;
+    close(segments.back(), true);
+    segments.pop_back();
+
+    Try<Segment*> segment = create(SEGMENT_SIZE);
+
+    if (segment.isError()) {
+      return Try<map<string, State> >::error(segment.error());
+    }
+
+    segments.push_back(segment.get());
+  } else {
+    Try<void> discarded = discard(segments.back());
+
+    if (discarded.isError()) {
+      return Try<map<string, State> >::error(discarded.error());
+    }
+  }
+
+  collect();
+
+  LOG(INFO) << "Recovered " << states.size() << " logs from "
+            << segments.size() << " segments";
+
+  return states;
+}
+
+
+Try<void> SegmentStorage::persist(const list<Record>& records)
+{
+  Timer timer;
+  timer.start();
+
+  // The records (with their headers) to append and the positions
+  // (and offsets within the buffer) of the actions amongst them.
+  string buffer;
+
+  struct Indexed
+  {
+    string log;
+    uint64_t position;
+    size_t offset;
+    size_t length;
+  };
+
+  std::vector<Indexed> indexed;
+
+  // See LevelDBStorage::persist.
+  map<string, State> updated;
+
+  foreach (const Record& record, records) {
+    const string& log = record.log();
+
+    if (updated.count(log) == 0) {
+      updated[log] = states.count(log) > 0 ? states[log] : State();
+    }
+
+    string value;
+
+    if (!record.SerializeToString(&value)) {
+      return Try<void>::error("Failed to serialize record");
+    }
+
+    if (record.type() == Record::ACTION) {
+      CHECK(record.has_action());
+      Indexed action;
+      action.log = log;
+      action.position = record.action().position();
+      action.offset = buffer.size() + HEADER_SIZE;
+      action.length = value.size();
+      indexed.push_back(action);
+    } else {
+      CHECK(record.type() == Record::PROMISE);
+      CHECK(record.has_promise());
+    }
+
+    append(value, &buffer);
+
+    apply(&updated[log], record);
+  }
+
+  Segment* segment = segments.back();
+
+  // Whether we started a new segment for this batch.
+  bool started = false;
+
+  // Start a new segment if the batch doesn't fit in the last one.
+  if (segment->used + buffer.size() > segment->size) {
+    string checkpoint;
+
+    foreachpair (const string& log, const State& state, states) {
+      Record record;
+      record.set_type(Record::METADATA);
+      if (!log.empty()) {
+        record.set_log(log);
+      }
+
+      Metadata* metadata = record.mutable_metadata();
+      metadata->set_promised(state.coordinator);
+      metadata->set_begin(state.begin);
+      metadata->set_end(state.end);
+      ranges(state.holes, metadata->mutable_holes());
+      ranges(state.unlearned, metadata->mutable_unlearned());
+
+      string value;
+
+      if (!record.SerializeToString(&value)) {
+        return Try<void>::error("Failed to serialize metadata");
+      }
+
+      append(value, &checkpoint);
+    }
+
+    Try<Segment*> created = create(checkpoint.size() + buffer.size());
+
+    if (created.isError()) {
+      return Try<void>::error(created.error());
+    }
+
+    segments.push_back(created.get());
+
+    segment = created.get();
+    started = true;
+
+    // The checkpoint gets synced along with the batch.
+    buffer = checkpoint + buffer;
+
+    foreach (Indexed& action, indexed) {
+      action.offset += checkpoint.size();
+    }
+  }
+
+  Try<void> written = write(segment, buffer);
+
+  if (written.isError()) {
+    // Don't leave any of the batch behind (see 'discard'), nor a new
+    // segment without its checkpoint.
+    if (started) {
+      segments.pop_back();
+      close(segment, true);
+    } else {
+      discard(segment);
+    }
+    return written;
+  }
+
+  foreach (const Indexed& action, indexed) {
+    Location location;
+    location.segment = segment;
+    location.offset = segment->used + action.offset;
+    location.length = action.length;
+    index(action.log, action.position, location);
+  }
+
+  segment->used += buffer.size();
+
+  foreachpair (const string& log, const State& state, updated) {
+    states[log] = state;
+  }
+
+  // Deletes segments if a truncate action has been *learned* (or
+  // all the positions in a segment have been written again).
+  collect();
+
+  LOG(INFO) << "Persisting " << records.size() << " records ("
+            << buffer.size() << " bytes) of " << updated.size()
+            << " logs to segment " << segment->id << " took "
+            << timer.elapsed().millis() << " milliseconds";
+
+  return Try<void>::some();
+}
+
+
+Try<Action> SegmentStorage::read(const string& log, uint64_t position)
+{
+  if (locations[log].count(position) == 0) {
+    return Try<Action>::error("Not found");
+  }
+
+  return parse(locations[log][position]);
+}
+
+
+Try<list<Action> > SegmentStorage::read(
+    const string& log,
+    uint64_t from,
+    uint64_t to)
+{
+  const map<uint64_t, Location>& index = locations[log];
+
+  list<Action> actions;
+
+  map<uint64_t, Location>::const_iterator iterator;
+  for (iterator = index.lower_bound(from);
+       iterator != index.end() && iterator->first <= to;
+       ++iterator) {
+    Try<Action> action = parse(iterator->second);
+
+    if (action.isError()) {
+      return Try<list<Action> >::error(action.error());
+    }
+
+    actions.push_back(action.get());
+  }
+
+  return actions;
+}
+
+
+string SegmentStorage::filename(uint64_t id) const
+{
+  char name[32];
+  snprintf(name, sizeof(name), "segment-%020llu", (unsigned long long) id);
+  return directory + "/" + name;
+}
+
+
+Try<SegmentStorage::Segment*> SegmentStorage::create(size_t size)
+{
+  Segment* segment = new Segment();
+  segment->id = segments.empty() ? 0 : segments.back()->id + 1;
+  segment->path = filename(segment->id);
+  segment->size = std::max(size, SEGMENT_SIZE);
+  segment->used = 0;
+  segment->live = 0;
+  segment->data = NULL;
+
+  segment->fd = ::open(segment->path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+
+  if (segment->fd < 0) {
+    const string& message =
+      "Failed to create " + segment->path + ": " + strerror(errno);
+    delete segment;
+    return Try<Segment*>::error(message);
+  }
+
+  if (ftruncate(segment->fd, segment->size) != 0) {
+    const string& message =
+      "Failed to size " + segment->path + ": " + strerror(errno);
+    close(segment, true);
+    return Try<Segment*>::error(message);
+  }
+
+  void* data =
+    mmap(NULL, segment->size, PROT_READ, MAP_SHARED, segment->fd, 0);
+
+  if (data == MAP_FAILED) {
+    const string& message =
+      "Failed to map " + segment->path + ": " + strerror(errno);
+    close(segment, true);
+    return Try<Segment*>::error(message);
+  }
+
+  segment->data = static_cast<const char*>(data);
+
+  // Make sure the new file itself survives a failure.
+  int fd = ::open(directory.c_str(), O_RDONLY);
+  if (fd < 0 || fsync(fd) != 0) {
+    const string& message =
+      "Failed to sync " + directory + ": " + strerror(errno);
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    close(segment, true);
+    return Try<Segment*>::error(message);
+  }
+  ::close(fd);
+
+  LOG(INFO) << "Created log segment " << segment->path;
+
+  return segment;
+}
+
+
+Try<SegmentStorage::Segment*> SegmentStorage::open(uint64_t id)
+{
+  Segment* segment = new Segment();
+  segment->id = id;
+  segment->path = filename(id);
+  segment->used = 0;
+  segment->live = 0;
+  segment->data = NULL;
+
+  segment->fd = ::open(segment->path.c_str(), O_RDWR);
+
+  struct stat s;
+
+  if (segment->fd < 0 || fstat(segment->fd, &s) != 0) {
+    const string& message =
+      "Failed to open " + segment->path + ": " + strerror(errno);
+    close(segment, false);
+    return Try<Segment*>::error(message);
+  }
+
+  segment->size = s.st_size;
+
+  if (segment->size < HEADER_SIZE) {
+    // We must have failed while creating it, start it over.
+    if (ftruncate(segment->fd, SEGMENT_SIZE) != 0) {
+      const string& message =
+        "Failed to size " + segment->path + ": " + strerror(errno);
+      close(segment, false);
+      return Try<Segment*>::error(message);
+    }
+    segment->size = SEGMENT_SIZE;
+  }
+
+  void* data =
+    mmap(NULL, segment->size, PROT_READ, MAP_SHARED, segment->fd, 0);
+
+  if (data == MAP_FAILED) {
+    const string& message =
+      "Failed to map " + segment->path + ": " + strerror(errno);
+    close(segment, false);
+    return Try<Segment*>::error(message);
+  }
+
+  segment->data = static_cast<const char*>(data);
+
+  // Recover the records, in the order they were appended.
+  size_t offset = 0;
+  size_t count = 0;
+
+  while (offset + HEADER_SIZE <= segment->size) {
+    uint32_t length;
+    uint32_t checksum;
+    memcpy(&length, segment->data + offset, sizeof(length));
+    memcpy(&checksum, segment->data + offset + 4, sizeof(checksum));
+
+    if (length == 0 ||
+        offset + HEADER_SIZE + length > segment->size ||
+        crc32(0, (const Bytef*) segment->data + offset + HEADER_SIZE,
+              length) != checksum) {
+      break;
+    }
+
+    Location location;
+    location.segment = segment;
+    location.offset = offset + HEADER_SIZE;
+    location.length = length;
+
+    google::protobuf::io::ArrayInputStream stream(
+        segment->data + location.offset, location.length);
+
+    Record record;
+
+    if (!record.ParseFromZeroCopyStream(&stream)) {
+      break;
+    }
+
+    const string& log = record.log();
+
+    if (record.type() == Record::METADATA) {
+      Try<State> state = restore(
+          leveldb::Slice(segment->data + location.offset, location.length));
+      if (state.isError()) {
+        close(segment, false);
+        return Try<Segment*>::error(state.error());
+      }
+      states[log] = state.get();
+    } else {
+      if (states.count(log) == 0) {
+        states[log] = State();
+      }
+
+      apply(&states[log], record);
+
+      if (record.type() == Record::ACTION) {
+        index(log, record.action().position(), location);
+      }
+    }
+
+    offset = location.offset + location.length;
+    count++;
   }
 
-  leveldb::Status status = db->Put(options, encode(0, false), value);
+  segment->used = offset;
 
-  if (!status.ok()) {
-    return Try<void>::error(status.ToString());
+  LOG(INFO) << "Recovered " << count << " records from log segment "
+            << segment->path;
+
+  return segment;
+}
+
+
+Try<void> SegmentStorage::write(Segment* segment, const string& buffer)
+{
+  size_t written = 0;
+
+  while (written < buffer.size()) {
+    ssize_t length = pwrite(segment->fd,
+                            buffer.data() + written,
+                            buffer.size() - written,
+                            segment->used + written);
+    if (length < 0 && errno != EINTR) {
+      return Try<void>::error(
+          "Failed to write to " + segment->path + ": " + strerror(errno));
+    } else if (length > 0) {
+      written += length;
+    }
   }
 
-  LOG(INFO) << "Persisting promise (" << value.size()
-            << " bytes) to leveldb took "
-            << timer.elapsed().millis() << " milliseconds";
+  if (fdatasync(segment->fd) != 0) {
+    return Try<void>::error(
+        "Failed to sync " + segment->path + ": " + strerror(errno));
+  }
 
   return Try<void>::some();
 }
 
 
-Try<void> LevelDBStorage::persist(const Action& action)
+Try<void> SegmentStorage::discard(Segment* segment)
 {
-  Timer timer;
-  timer.start();
+  if (ftruncate(segment->fd, segment->used) != 0 ||
+      ftruncate(segment->fd, segment->size) != 0) {
+    return Try<void>::error(
+        "Failed to truncate " + segment->path + ": " + strerror(errno));
+  }
 
-  Record record;
-  record.set_type(Record::ACTION);
-  record.mutable_action()->MergeFrom(action);
+  return Try<void>::some();
+}
 
-  string value;
 
-  if (!record.SerializeToString(&value)) {
-    return Try<void>::error("Failed to serialize record");
+void SegmentStorage::close(Segment* segment, bool remove)
+{
+  if (segment->data != NULL) {
+    munmap(const_cast<char*>(segment->data), segment->size);
   }
 
-  leveldb::WriteOptions options;
-  options.sync = true;
-
-  leveldb::Status status = db->Put(options, encode(action.position()), value);
+  if (segment->fd >= 0) {
+    ::close(segment->fd);
+  }
 
-  if (!status.ok()) {
-    return Try<void>::error(status.ToString());
+  if (remove) {
+    LOG(INFO) << "Deleting log segment " << segment->path;
+    unlink(segment->path.c_str());
   }
 
-  LOG(INFO) << "Persisting action (" << value.size()
-            << " bytes) to leveldb took "
-            << timer.elapsed().millis() << " milliseconds";
+  delete segment;
+}
 
-  // Delete positions if a truncate action has been *learned*. Note
-  // that we do this in a best-effort fashion (i.e., we ignore any
-  // failures to the database since we can always try again).
-  if (action.has_type() && action.type() == Action::TRUNCATE &&
-      action.has_learned() && action.learned()) {
-    CHECK(action.has_truncate());
-
-    timer.start(); // Restart the timer.
-
-    // To actually perform the truncation in leveldb we need to remove
-    // all the keys that represent positions no longer in the log. We
-    // do this by attempting to delete all keys that represent the
-    // first position we know is still in leveldb up to (but
-    // excluding) the truncate position. Note that this works because
-    // the semantics of WriteBatch are such that even if the position
-    // doesn't exist (which is possible because this replica has some
-    // holes), we can attempt to delete the key that represents it and
-    // it will just ignore that key. This is *much* cheaper than
-    // actually iterating through the entire database instead (which
-    // was, for posterity, the original implementation). In addition,
-    // caching the "first" position we know is in the database is
-    // cheaper than using an iterator to determine the first position
-    // (which was, for posterity, the second implementation).
 
-    leveldb::WriteBatch batch;
+void SegmentStorage::append(const string& value, string* buffer)
+{
+  const uint32_t length = value.size();
+  const uint32_t checksum =
+    crc32(0, (const Bytef*) value.data(), value.size());
 
-    // Add positions up to (but excluding) the truncate position to
-    // the batch starting at the first position still in leveldb.
-    uint64_t index = 0;
-    while ((first + index) < action.truncate().to()) {
-      batch.Delete(encode(first + index));
-      index++;
-    }
+  buffer->append((const char*) &length, sizeof(length));
+  buffer->append((const char*) &checksum, sizeof(checksum));
+  buffer->append(value);
+}
 
-    // If we added any positions, attempt to delete them!
-    if (index > 0) {
-      // We do this write asynchronously (e.g., using default options).
-      leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
 
-      if (!status.ok()) {
-        LOG(WARNING) << "Ignoring leveldb batch delete failure: "
-                     << status.ToString();
-      } else {
-        first = action.truncate().to(); // Save the new first position!
+void SegmentStorage::index(
+    const string& log,
+    uint64_t position,
+    const Location& location)
+{
+  map<uint64_t, Location>& index = locations[log];
 
-        LOG(INFO) << "Deleting ~" << index << " keys from leveldb took "
-                  << timer.elapsed().millis() << " milliseconds";
-      }
-    }
+  if (index.count(position) > 0) {
+    index[position].segment->live--; // Superseded.
   }
 
-  return Try<void>::some();
+  index[position] = location;
+  location.segment->live++;
 }
 
 
-Try<Action> LevelDBStorage::read(uint64_t position)
+void SegmentStorage::collect()
 {
-  Timer timer;
-  timer.start();
-
-  string value;
+  foreachpair (const string& log, const State& state, states) {
+    map<uint64_t, Location>& index = locations[log];
 
-  leveldb::ReadOptions options;
+    while (!index.empty() && index.begin()->first < state.begin) {
+      index.begin()->second.segment->live--;
+      index.erase(index.begin());
+    }
+  }
 
-  leveldb::Status status = db->Get(options, encode(position), &value);
+  list<Segment*>::iterator iterator = segments.begin();
 
-  if (!status.ok()) {
-    return Try<Action>::error(status.ToString());
+  while (iterator != segments.end()) {
+    Segment* segment = *iterator;
+    if (segment != segments.back() && segment->live == 0) {
+      close(segment, true);
+      iterator = segments.erase(iterator);
+    } else {
+      ++iterator;
+    }
   }
+}
 
-  google::protobuf::io::ArrayInputStream stream(value.data(), value.size());
+
+Try<Action> SegmentStorage::parse(const Location& location) const
+{
+  google::protobuf::io::ArrayInputStream stream(
+      location.segment->data + location.offset, location.length);
 
   Record record;
 
@@ -433,9 +1746,6 @@ Try<Action> LevelDBStorage::read(uint64_t position)
     return Try<Action>::error("Bad record");
   }
 
-  LOG(INFO) << "Reading position from leveldb took "
-            << timer.elapsed().millis() << " milliseconds";
-
   return record.action();
 }
 
@@ -445,36 +1755,83 @@ class ReplicaProcess : public ProtobufProcess<ReplicaProcess>
 public:
   // Constructs a new replica process using specified path to a
   // directory for storing the underlying log.
-  ReplicaProcess(const std::string& path);
+  ReplicaProcess(const std::string& path,
+                 Replica::Engine engine,
+                 const std::string& id);
 
   virtual ~ReplicaProcess();
 
-  // Returns the action associated with this position. A none result
-  // means that no action is known for this position. An error result
-  // means that there was an error while trying to get this action
-  // (for example, going to disk to read the log may have
+  // Returns the action associated with this position of the log. A
+  // none result means that no action is known for this position. An
+  // error result means that there was an error while trying to get
+  // this action (for example, going to disk to read the log may have
   // failed). Note that reading a position that has been learned to
   // be truncated will also return an error.
-  Result<Action> read(uint64_t position);
+  Result<Action> read(const std::string& log, uint64_t position);
 
   // Returns all the actions between the specified positions, unless
   // those positions are invalid, in which case returns an error.
-  process::Future<std::list<Action> > read(uint64_t from, uint64_t to);
+  process::Future<std::list<Action> > read(
+      const std::string& log,
+      uint64_t from,
+      uint64_t to);
 
   // Returns missing positions in the log (i.e., unlearned or holes)
   // up to the specified position.
-  std::set<uint64_t> missing(uint64_t position);
+  intervalset<uint64_t> missing(const std::string& log, uint64_t position);
 
   // Returns the beginning position of the log.
-  uint64_t beginning();
+  uint64_t beginning(const std::string& log);
 
   // Returns the last written position in the log.
-  uint64_t ending();
+  uint64_t ending(const std::string& log);
 
-  // Returns the highest implicit promise this replica has given.
-  uint64_t promised();
+  // Returns the highest implicit promise this replica has given for
+  // the log.
+  uint64_t promised(const std::string& log);
 
 private:
+  // Everything about a log this replica hosts (see Replica), except
+  // for its records which all go in the same batch.
+  struct Namespace
+  {
+    Namespace() : coordinator(0), begin(0), end(0) {}
+
+    // Last promise made to a coordinator.
+    uint64_t coordinator;
+
+    // Lease held by the coordinator we last promised (if it asked for
+    // one), during which we won't promise any other coordinator. Note
+    // that leases aren't persisted, so a replica that restarts should
+    // wait out any lease before it rejoins.
+    process::Timeout lease;
+
+    // Beginning position of log (after *learned* truncations).
+    uint64_t begin;
+
+    // Ending position of log (last written position).
+    uint64_t end;
+
+    // Holes in the log.
+    intervalset<uint64_t> holes;
+
+    // Unlearned positions in the log.
+    intervalset<uint64_t> unlearned;
+
+    // Actions in the current batch (by position) so that we can read
+    // them before they've been persisted.
+    std::map<uint64_t, Action> staged;
+
+    // Recently persisted actions (by position) so that reading the
+    // most recent positions (e.g., by readers tailing the log)
+    // doesn't need to go to storage.
+    std::map<uint64_t, Action> cache;
+  };
+
+  // Returns the specified log, creating it if this replica hasn't
+  // hosted it before.
+  Namespace& lookup(const std::string& log);
+
   // Handles a request from a coordinator to promise not to accept
   // writes from any other coordinator.
   void promise(const PromiseRequest& request);
@@ -483,46 +1840,86 @@ private:
   void write(const WriteRequest& request);
 
   // Handles a request from a coordinator (or replica) to learn the
-  // specified position in the log.
-  void learn(uint64_t position);
+  // specified position (or range of positions) in the log.
+  void learn(const LearnRequest& request);
 
   // Handles a message notifying of a learned action.
-  void learned(const Action& action);
-
-  // Helper routines that write a record corresponding to the
-  // specified argument. Returns true on success and false otherwise.
-  bool persist(const Promise& promise);
-  bool persist(const Action& action);
+  void learned(const Action& action, const std::string& log);
+
+  // Helper routines that add a record corresponding to the specified
+  // argument to the current batch (see 'flush').
+  void persist(const std::string& log, const Promise& promise);
+  void persist(const std::string& log, const Action& action);
+
+  // Helper that extends the lease of the coordinator we last
+  // promised if it asked to with the specified write.
+  void extend(Namespace* ns, const WriteRequest& request);
+
+  // Helper that keeps a persisted action in memory, evicting the
+  // actions cached longest ago (of any log) if the cache is full.
+  void cache(const std::string& log, const Action& action);
+
+  // Helper that evicts cached actions of the log before the
+  // specified position (e.g., once they've been truncated).
+  void evict(Namespace* ns, uint64_t to);
+
+  // Helper that gets the actions between the specified positions
+  // from the current batch and the cache, returning false if any of
+  // them (other than holes) aren't there.
+  bool cached(
+      const Namespace& ns,
+      uint64_t from,
+      uint64_t to,
+      std::list<Action>* actions);
+
+  // Helper that sends the specified response to the sender of the
+  // current message once the current batch has been persisted.
+  void respond(const google::protobuf::Message& response);
+
+  // Persists the current batch of records (with a single sync) and
+  // then sends the responses that were waiting on it. A flush gets
+  // dispatched when the first record is added to a batch, so every
+  // request that has already arrived by then gets handled (and
+  // becomes part of the batch) before the flush happens.
+  void flush();
 
   // Helper routine to recover log (e.g., on restart).
   void recover(const std::string& path);
 
-  // Underlying storage for the log.
+  // Underlying storage for the logs.
   Storage* storage;
 
-  // Last promise made to a coordinator.
-  uint64_t coordinator;
+  // The logs this replica hosts, by name (the default log is "").
+  std::map<std::string, Namespace> namespaces;
 
-  // Beginning position of log (after *learned* truncations).
-  uint64_t begin;
+  // Records in the current batch (of all the logs), in the order
+  // they were made.
+  std::list<Record> batch;
 
-  // Ending position of log (last written position).
-  uint64_t end;
+  // Responses waiting for the current batch to be persisted.
+  std::list<std::pair<process::UPID, google::protobuf::Message*> > replies;
 
-  // Holes in the log.
-  std::set<uint64_t> holes;
+  // Cached actions (of all the logs) in the order they were cached.
+  // N.B. A position that got cached again shows up more than once.
+  std::deque<std::pair<std::string, uint64_t> > evictions;
 
-  // Unlearned positions in the log.
-  std::set<uint64_t> unlearned;
+  // Total size (in bytes) of the cached actions.
+  size_t cacheSize;
 };
 
 
-ReplicaProcess::ReplicaProcess(const string& path)
-  : coordinator(0),
-    begin(0),
-    end(0)
+ReplicaProcess::ReplicaProcess(
+    const string& path,
+    Replica::Engine engine,
+    const string& id)
+  : ProcessBase(id),
+    cacheSize(0)
 {
-  storage = new LevelDBStorage(); // TODO(benh): Factor out and expose storage.
+  if (engine == Replica::SEGMENTS) {
+    storage = new SegmentStorage();
+  } else {
+    storage = new LevelDBStorage();
+  }
 
   recover(path);
 
@@ -535,32 +1932,47 @@ ReplicaProcess::ReplicaProcess(const string& path)
 
   install<LearnedMessage>(
       &ReplicaProcess::learned,
-      &LearnedMessage::action);
+      &LearnedMessage::action,
+      &LearnedMessage::log);
 
   install<LearnRequest>(
-      &ReplicaProcess::learn,
-      &LearnRequest::position);
+      &ReplicaProcess::learn);
 }
 
 
 ReplicaProcess::~ReplicaProcess()
 {
+  // Any responses still waiting on a batch never get sent (just as if
+  // we had failed before receiving the requests).
+  typedef pair<UPID, google::protobuf::Message*> Reply;
+  foreach (const Reply& reply, replies) {
+    delete reply.second;
+  }
+
+  cachedBytes.decrement(cacheSize);
+
   delete storage;
 }
 
 
-Result<Action> ReplicaProcess::read(uint64_t position)
+Result<Action> ReplicaProcess::read(const string& log, uint64_t position)
 {
-  if (position < begin) {
+  Namespace& ns = lookup(log);
+
+  if (position < ns.begin) {
     return Result<Action>::error("Attempted to read truncated position");
-  } else if (end < position) {
+  } else if (ns.staged.count(position) > 0) {
+    return ns.staged[position];
+  } else if (ns.cache.count(position) > 0) {
+    return ns.cache[position];
+  } else if (ns.end < position) {
     return Result<Action>::none(); // These semantics are assumed above!
-  } else if (holes.count(position) > 0) {
+  } else if (ns.holes.contains(position)) {
     return Result<Action>::none();
   }
 
   // Must exist in storage ...
-  Try<Action> action = storage->read(position);
+  Try<Action> action = storage->read(log, position);
 
   if (action.isError()) {
     return Result<Action>::error(action.error());
@@ -575,18 +1987,21 @@ Result<Action> ReplicaProcess::read(uint64_t position)
 // TODO(benh): Make this function actually return a Try once we change
 // the future semantics to not include failures.
 process::Future<list<Action> > ReplicaProcess::read(
+    const string& log,
     uint64_t from,
     uint64_t to)
 {
+  const Namespace& ns = lookup(log);
+
   if (to < from) {
     process::Promise<list<Action> > promise;
     promise.fail("Bad read range (to < from)");
     return promise.future();
-  } else if (from < begin) {
+  } else if (from < ns.begin) {
     process::Promise<list<Action> > promise;
     promise.fail("Bad read range (truncated position)");
     return promise.future();
-  } else if (end < to) {
+  } else if (ns.end < to) {
     process::Promise<list<Action> > promise;
     promise.fail("Bad read range (past end of log)");
     return promise.future();
@@ -594,61 +2009,106 @@ process::Future<list<Action> > ReplicaProcess::read(
 
   list<Action> actions;
 
-  for (uint64_t position = from; position <= to; position++) {
-    Result<Action> result = read(position);
+  if (cached(ns, from, to, &actions)) {
+    hits.increment();
+    return actions;
+  }
 
-    if (result.isError()) {
-      process::Promise<list<Action> > promise;
-      promise.fail(result.error());
-      return promise.future();
-    } else if (result.isSome()) {
-      actions.push_back(result.get());
+  misses.increment();
+
+  Try<list<Action> > stored = storage->read(log, from, to);
+
+  if (stored.isError()) {
+    process::Promise<list<Action> > promise;
+    promise.fail(stored.error());
+    return promise.future();
+  }
+
+  // Merge in any actions from the current batch (which supersede
+  // whatever is in storage).
+  actions.clear();
+
+  map<uint64_t, Action>::const_iterator iterator =
+    ns.staged.lower_bound(from);
+
+  foreach (const Action& action, stored.get()) {
+    while (iterator != ns.staged.end() &&
+           iterator->first < action.position()) {
+      actions.push_back(iterator->second);
+      ++iterator;
     }
+
+    if (iterator != ns.staged.end() && iterator->first == action.position()) {
+      actions.push_back(iterator->second);
+      ++iterator;
+    } else {
+      actions.push_back(action);
+    }
+  }
+
+  while (iterator != ns.staged.end() && iterator->first <= to) {
+    actions.push_back(iterator->second);
+    ++iterator;
   }
 
   return actions;
 }
 
 
-set<uint64_t> ReplicaProcess::missing(uint64_t index)
+intervalset<uint64_t> ReplicaProcess::missing(
+    const string& log,
+    uint64_t index)
 {
+  const Namespace& ns = lookup(log);
+
   // Start off with all the unlearned positions.
-  set<uint64_t> positions = unlearned;
+  intervalset<uint64_t> positions = ns.unlearned;
 
   // Add in a spoonful of holes.
-  foreach (uint64_t hole, holes) {
-    positions.insert(hole);
+  foreachpair (uint64_t from, uint64_t to, ns.holes) {
+    positions.add(from, to);
   }
 
   // And finally add all the unknown positions beyond our end.
-  for (; index >= end; index--) {
-    positions.insert(index);
-
-    // Don't wrap around 0!
-    if (index == 0) {
-      break;
-    }
+  if (index >= ns.end) {
+    positions.add(ns.end, index + 1);
   }
 
+  // Truncated positions are never missing.
+  positions.remove(0, ns.begin);
+
   return positions;
 }
 
 
-uint64_t ReplicaProcess::beginning()
+uint64_t ReplicaProcess::beginning(const string& log)
+{
+  return lookup(log).begin;
+}
+
+
+uint64_t ReplicaProcess::ending(const string& log)
 {
-  return begin;
+  return lookup(log).end;
 }
 
 
-uint64_t ReplicaProcess::ending()
+uint64_t ReplicaProcess::promised(const string& log)
 {
-  return end;
+  return lookup(log).coordinator;
 }
 
 
-uint64_t ReplicaProcess::promised()
+ReplicaProcess::Namespace& ReplicaProcess::lookup(const string& log)
 {
-  return coordinator;
+  if (namespaces.count(log) == 0) {
+    LOG(INFO) << "Replica creating log '" << log << "'";
+
+    // Position 0 is a hole in a brand new log (see State).
+    namespaces[log].holes.add(0);
+  }
+
+  return namespaces[log];
 }
 
 
@@ -668,12 +2128,14 @@ uint64_t ReplicaProcess::promised()
 
 void ReplicaProcess::promise(const PromiseRequest& request)
 {
+  Namespace& ns = lookup(request.log());
+
   if (request.has_position()) {
     LOG(INFO) << "Replica received explicit promise request for "
               << request.id() << " for position " << request.position();
 
     // Need to get the action for the specified position.
-    Result<Action> result = read(request.position());
+    Result<Action> result = read(request.log(), request.position());
 
     if (result.isError()) {
       LOG(ERROR) << "Error getting log record at " << request.position()
@@ -683,13 +2145,13 @@ void ReplicaProcess::promise(const PromiseRequest& request)
       action.set_position(request.position());
       action.set_promised(request.id());
 
-      if (persist(action)) {
-        PromiseResponse response;
-        response.set_okay(true);
-        response.set_id(request.id());
-        response.set_position(request.position());
-        reply(response);
-      }
+      persist(request.log(), action);
+
+      PromiseResponse response;
+      response.set_okay(true);
+      response.set_id(request.id());
+      response.set_position(request.position());
+      respond(response);
     } else {
       CHECK(result.isSome());
       Action action = result.get();
@@ -705,20 +2167,31 @@ void ReplicaProcess::promise(const PromiseRequest& request)
         Action original = action;
         action.set_promised(request.id());
 
-        if (persist(action)) {
-          PromiseResponse response;
-          response.set_okay(true);
-          response.set_id(request.id());
-          response.mutable_action()->MergeFrom(original);
-          reply(response);
-        }
+        persist(request.log(), action);
+
+        PromiseResponse response;
+        response.set_okay(true);
+        response.set_id(request.id());
+        response.mutable_action()->MergeFrom(original);
+        respond(response);
       }
     }
   } else {
     LOG(INFO) << "Replica received implicit promise request for "
               << request.id();
 
-    if (request.id() <= coordinator) { // Only make an implicit promise once!
+    // Only make an implicit promise once!
+    if (request.id() <= ns.coordinator) {
+      PromiseResponse response;
+      response.set_okay(false);
+      response.set_id(request.id());
+      reply(response);
+    } else if (ns.lease.remaining() > 0) {
+      LOG(INFO) << "Replica rejecting promise request for " << request.id()
+                << " while coordinator " << ns.coordinator
+                << " holds a lease for another "
+                << ns.lease.remaining() << " seconds";
+
       PromiseResponse response;
       response.set_okay(false);
       response.set_id(request.id());
@@ -727,16 +2200,27 @@ void ReplicaProcess::promise(const PromiseRequest& request)
       Promise promise;
       promise.set_id(request.id());
 
-      if (persist(promise)) {
-        coordinator = request.id();
+      ns.lease = request.has_lease() ? Timeout(request.lease()) : Timeout();
 
-        // Return the last position written.
-        PromiseResponse response;
-        response.set_okay(true);
-        response.set_id(request.id());
-        response.set_position(end);
-        reply(response);
+      persist(request.log(), promise);
+
+      // N.B. We honor the promise right away (i.e., before it's been
+      // persisted) which is safe since it only means rejecting more.
+      ns.coordinator = request.id();
+
+      // Return the last position written (including those written
+      // in the current batch).
+      uint64_t position = ns.end;
+      if (!ns.staged.empty()) {
+        position = std::max(position, ns.staged.rbegin()->first);
       }
+
+      PromiseResponse response;
+      response.set_okay(true);
+      response.set_id(request.id());
+      response.set_position(position);
+      response.set_begin(ns.begin);
+      respond(response);
     }
   }
 }
@@ -744,15 +2228,17 @@ void ReplicaProcess::promise(const PromiseRequest& request)
 
 void ReplicaProcess::write(const WriteRequest& request)
 {
+  Namespace& ns = lookup(request.log());
+
   LOG(INFO) << "Replica received write request for position " << request.position();
 
-  Result<Action> result = read(request.position());
+  Result<Action> result = read(request.log(), request.position());
 
   if (result.isError()) {
     LOG(ERROR) << "Error getting log record at " << request.position()
                << ": " << result.error();
   } else if (result.isNone()) {
-    if (request.id() < coordinator) {
+    if (request.id() < ns.coordinator) {
       WriteResponse response;
       response.set_okay(false);
       response.set_id(request.id());
@@ -761,7 +2247,7 @@ void ReplicaProcess::write(const WriteRequest& request)
     } else {
       Action action;
       action.set_position(request.position());
-      action.set_promised(coordinator);
+      action.set_promised(ns.coordinator);
       action.set_performed(request.id());
       if (request.has_learned()) action.set_learned(request.learned());
       action.set_type(request.type());
@@ -783,13 +2269,15 @@ void ReplicaProcess::write(const WriteRequest& request)
           LOG(FATAL) << "Unknown Action::Type!";
       }
 
-      if (persist(action)) {
-        WriteResponse response;
-        response.set_okay(true);
-        response.set_id(request.id());
-        response.set_position(request.position());
-        reply(response);
-      }
+      persist(request.log(), action);
+
+      extend(&ns, request);
+
+      WriteResponse response;
+      response.set_okay(true);
+      response.set_id(request.id());
+      response.set_position(request.position());
+      respond(response);
     }
   } else if (result.isSome()) {
     Action action = result.get();
@@ -830,37 +2318,75 @@ void ReplicaProcess::write(const WriteRequest& request)
           LOG(FATAL) << "Unknown Action::Type!";
       }
 
-      if (persist(action)) {
-        WriteResponse response;
-        response.set_okay(true);
-        response.set_id(request.id());
-        response.set_position(request.position());
-        reply(response);
-      }
+      persist(request.log(), action);
+
+      extend(&ns, request);
+
+      WriteResponse response;
+      response.set_okay(true);
+      response.set_id(request.id());
+      response.set_position(request.position());
+      respond(response);
     }
   }
 }
 
 
-void ReplicaProcess::learned(const Action& action)
+void ReplicaProcess::learned(const Action& action, const string& log)
 {
   LOG(INFO) << "Replica received learned notice for position " << action.position();
 
   CHECK(action.learned());
 
-  if (persist(action)) {
-    LOG(INFO) << "Replica learned "
-              << Action::Type_Name(action.type())
-              << " action at position " << action.position();
-  }
+  persist(log, action);
+
+  LOG(INFO) << "Replica learned "
+            << Action::Type_Name(action.type())
+            << " action at position " << action.position();
 }
 
 
-void ReplicaProcess::learn(uint64_t position)
+void ReplicaProcess::learn(const LearnRequest& request)
 {
+  if (request.has_end()) {
+    LOG(INFO) << "Replica received learn request for positions "
+              << request.position() << " -> " << request.end();
+
+    // Respond with whichever of the positions we have learned (which
+    // might be none of them), skipping any that were truncated.
+    LearnResponse response;
+    response.set_okay(true);
+
+    const Namespace& ns = lookup(request.log());
+
+    const uint64_t from = std::max(request.position(), ns.begin);
+    const uint64_t to = std::min(request.end(), ns.end);
+
+    if (from <= to) {
+      Future<list<Action> > actions = read(request.log(), from, to);
+
+      if (!actions.isReady()) {
+        LOG(ERROR) << "Error getting log records from " << from
+                   << " to " << to << ": " << actions.failure();
+        response.set_okay(false);
+      } else {
+        foreach (const Action& action, actions.get()) {
+          if (action.has_learned() && action.learned()) {
+            response.add_actions()->MergeFrom(action);
+          }
+        }
+      }
+    }
+
+    reply(response);
+    return;
+  }
+
+  const uint64_t position = request.position();
+
   LOG(INFO) << "Replica received learn request for position " << position;
 
-  Result<Action> result = read(position);
+  Result<Action> result = read(request.log(), position);
 
   if (result.isError()) {
     LOG(ERROR) << "Error getting log record at " << position
@@ -880,95 +2406,240 @@ void ReplicaProcess::learn(uint64_t position)
 }
 
 
-bool ReplicaProcess::persist(const Promise& promise)
+void ReplicaProcess::persist(const string& log, const Promise& promise)
 {
-  Try<void> persisted = storage->persist(promise);
+  if (batch.empty()) {
+    dispatch(self(), &ReplicaProcess::flush);
+  }
 
-  if (persisted.isError()) {
-    LOG(ERROR) << "Error writing to log: " << persisted.error();
-    return false;
+  Record record;
+  record.set_type(Record::PROMISE);
+  record.mutable_promise()->MergeFrom(promise);
+  if (!log.empty()) {
+    record.set_log(log);
   }
+  batch.push_back(record);
+}
 
-  LOG(INFO) << "Persisted promise to " << promise.id();
 
-  return true;
+void ReplicaProcess::persist(const string& log, const Action& action)
+{
+  if (batch.empty()) {
+    dispatch(self(), &ReplicaProcess::flush);
+  }
+
+  Record record;
+  record.set_type(Record::ACTION);
+  record.mutable_action()->MergeFrom(action);
+  if (!log.empty()) {
+    record.set_log(log);
+  }
+  batch.push_back(record);
+
+  lookup(log).staged[action.position()] = action;
 }
 
 
-bool ReplicaProcess::persist(const Action& action)
+void ReplicaProcess::extend(Namespace* ns, const WriteRequest& request)
 {
-  Try<void> persisted = storage->persist(action);
+  if (request.id() == ns->coordinator && request.has_lease() &&
+      request.lease() > ns->lease.remaining()) {
+    ns->lease = request.lease();
+  }
+}
 
-  if (persisted.isError()) {
-    LOG(ERROR) << "Error writing to log: " << persisted.error();
-    return false;
+
+void ReplicaProcess::cache(const string& log, const Action& action)
+{
+  Namespace& ns = lookup(log);
+
+  if (ns.cache.count(action.position()) > 0) {
+    cacheSize -= ns.cache[action.position()].ByteSize();
+    cachedBytes.decrement(ns.cache[action.position()].ByteSize());
   }
 
-  LOG(INFO) << "Persisted action at " << action.position();
+  ns.cache[action.position()] = action;
+  cacheSize += action.ByteSize();
+  cachedBytes.increment(action.ByteSize());
+
+  evictions.push_back(std::make_pair(log, action.position()));
 
-  // No longer a hole here (if there even was one).
-  holes.erase(action.position());
+  // Evict until the cache fits, along with any actions at the front
+  // that have already been evicted (e.g., because they got truncated)
+  // so that 'evictions' doesn't keep growing. N.B. An action that got
+  // cached again gets evicted as of when it was first cached.
+  while (!evictions.empty()) {
+    map<uint64_t, Action>& cache = lookup(evictions.front().first).cache;
+    const uint64_t position = evictions.front().second;
 
-  // Update unlearned positions and deal with truncation actions.
-  if (action.has_learned() && action.learned()) {
-    unlearned.erase(action.position());
-    if (action.has_type() && action.type() == Action::TRUNCATE) {
-      begin = std::max(begin, action.truncate().to());
+    if (cache.count(position) > 0) {
+      if (cacheSize <= CACHE_SIZE) {
+        break;
+      }
+      cacheSize -= cache[position].ByteSize();
+      cachedBytes.decrement(cache[position].ByteSize());
+      cache.erase(position);
     }
+
+    evictions.pop_front();
+  }
+}
+
+
+void ReplicaProcess::evict(Namespace* ns, uint64_t to)
+{
+  while (!ns->cache.empty() && ns->cache.begin()->first < to) {
+    cacheSize -= ns->cache.begin()->second.ByteSize();
+    cachedBytes.decrement(ns->cache.begin()->second.ByteSize());
+    ns->cache.erase(ns->cache.begin());
   }
+}
+
 
-  // Update holes if we just wrote many positions past the last end.
-  for (uint64_t position = end + 1; position < action.position(); position++) {
-    holes.insert(position);
+bool ReplicaProcess::cached(
+    const Namespace& ns,
+    uint64_t from,
+    uint64_t to,
+    list<Action>* actions)
+{
+  // Check the cheap case of an uncached beginning first (e.g., for
+  // readers catching up from well behind the end of the log).
+  if (ns.staged.count(from) == 0 &&
+      ns.cache.count(from) == 0 &&
+      !ns.holes.contains(from)) {
+    return false;
   }
 
-  // And update the end position.
-  end = std::max(end, action.position());
+  for (uint64_t position = from; position <= to; position++) {
+    map<uint64_t, Action>::const_iterator iterator;
+    if ((iterator = ns.staged.find(position)) != ns.staged.end()) {
+      actions->push_back(iterator->second);
+    } else if ((iterator = ns.cache.find(position)) != ns.cache.end()) {
+      actions->push_back(iterator->second);
+    } else if (!ns.holes.contains(position)) {
+      actions->clear();
+      return false;
+    }
+  }
 
   return true;
 }
 
 
-void ReplicaProcess::recover(const string& path)
+void ReplicaProcess::respond(const google::protobuf::Message& response)
 {
-  Try<State> state = storage->recover(path);
-
-  CHECK(state.isSome()) << "Failed to recover the log: " << state.error();
+  CHECK(from) << "Attempting to respond without a sender";
+  CHECK(!batch.empty()) << "Attempting to respond without a batch";
 
-  // Pull out and save some of the state.
-  coordinator = state.get().coordinator;
-  begin = state.get().begin;
-  end = state.get().end;
-  unlearned = state.get().unlearned;
+  google::protobuf::Message* message = response.New();
+  message->CopyFrom(response);
+  replies.push_back(std::make_pair(from, message));
+}
 
-  // Only use the learned positions to help determine the holes.
-  const std::set<uint64_t>& learned = state.get().learned;
 
-  // We need to assume that position 0 is a hole for a brand new log
-  // (a coordinator will simply fill it with a no-op when it first
-  // gets elected), unless the position was found during recovery or
-  // it has been truncated.
-  if (learned.count(0) == 0 && unlearned.count(0) == 0 && begin == 0) {
-    holes.insert(0);
+void ReplicaProcess::flush()
+{
+  if (batch.empty()) {
+    return;
   }
 
-  // Now determine the rest of the holes.
-  for (uint64_t position = begin; position < end; position++) {
-    if (learned.count(position) == 0 && unlearned.count(position) == 0) {
-      holes.insert(position);
+  // The records of all of the logs get persisted together.
+  Try<void> persisted = storage->persist(batch);
+
+  typedef pair<UPID, google::protobuf::Message*> Reply;
+
+  if (persisted.isError()) {
+    // Drop the responses, the coordinator(s) will eventually time
+    // out and retry (just as if we had never received the requests).
+    LOG(ERROR) << "Error writing to log: " << persisted.error();
+  } else {
+    foreach (const Record& record, batch) {
+      Namespace& ns = lookup(record.log());
+
+      if (record.type() == Record::PROMISE) {
+        LOG(INFO) << "Persisted promise to " << record.promise().id();
+      } else {
+        const Action& action = record.action();
+
+        LOG(INFO) << "Persisted action at " << action.position();
+
+        // No longer a hole here (if there even was one).
+        ns.holes.remove(action.position());
+
+        // Update unlearned positions and deal with truncation actions.
+        if (action.has_learned() && action.learned()) {
+          ns.unlearned.remove(action.position());
+          if (action.has_type() && action.type() == Action::TRUNCATE) {
+            ns.begin = std::max(ns.begin, action.truncate().to());
+          }
+        }
+
+        // Update holes if we just wrote many positions past the last end.
+        ns.holes.add(ns.end + 1, action.position());
+
+        // And update the end position.
+        ns.end = std::max(ns.end, action.position());
+
+        cache(record.log(), action);
+      }
+    }
+
+    // Forget about any holes, unlearned positions or cached actions
+    // that have since been truncated (e.g., we learned a truncate
+    // while catching up).
+    foreachvalue (Namespace& ns, namespaces) {
+      ns.holes.remove(0, ns.begin);
+      ns.unlearned.remove(0, ns.begin);
+      evict(&ns, ns.begin);
+    }
+
+    foreach (const Reply& reply, replies) {
+      send(reply.first, *reply.second);
     }
   }
 
-  LOG(INFO) << "Replica recovered with log positions "
-            << begin << " -> " << end
-            << " and holes " << utils::stringify(holes)
-            << " and unlearned " << utils::stringify(unlearned);
+  foreach (const Reply& reply, replies) {
+    delete reply.second;
+  }
+
+  batch.clear();
+  replies.clear();
+
+  foreachvalue (Namespace& ns, namespaces) {
+    ns.staged.clear();
+  }
+}
+
+
+void ReplicaProcess::recover(const string& path)
+{
+  Try<map<string, State> > states = storage->recover(path);
+
+  CHECK(states.isSome()) << "Failed to recover the log: " << states.error();
+
+  // Pull out and save the state of each log.
+  foreachpair (const string& log, const State& state, states.get()) {
+    Namespace& ns = namespaces[log];
+    ns.coordinator = state.coordinator;
+    ns.begin = state.begin;
+    ns.end = state.end;
+    ns.holes = state.holes;
+    ns.unlearned = state.unlearned;
+
+    LOG(INFO) << "Replica recovered "
+              << (log.empty() ? "the default log" : "log '" + log + "'")
+              << " with log positions " << ns.begin << " -> " << ns.end
+              << " and holes " << utils::stringify(ns.holes)
+              << " and unlearned " << utils::stringify(ns.unlearned);
+  }
 }
 
 
-Replica::Replica(const std::string& path)
+Replica::Replica(const std::string& path,
+                 Engine engine,
+                 const std::string& id)
 {
-  process = new ReplicaProcess(path);
+  process = new ReplicaProcess(path, engine, id);
   process::spawn(process);
 }
 
@@ -983,33 +2654,36 @@ Replica::~Replica()
 
 process::Future<std::list<Action> > Replica::read(
     uint64_t from,
-    uint64_t to)
+    uint64_t to,
+    const std::string& log)
 {
-  return process::dispatch(process, &ReplicaProcess::read, from, to);
+  return process::dispatch(process, &ReplicaProcess::read, log, from, to);
 }
 
 
-process::Future<std::set<uint64_t> > Replica::missing(uint64_t position)
+process::Future<intervalset<uint64_t> > Replica::missing(
+    uint64_t position,
+    const std::string& log)
 {
-  return process::dispatch(process, &ReplicaProcess::missing, position);
+  return process::dispatch(process, &ReplicaProcess::missing, log, position);
 }
 
 
-process::Future<uint64_t> Replica::beginning()
+process::Future<uint64_t> Replica::beginning(const std::string& log)
 {
-  return process::dispatch(process, &ReplicaProcess::beginning);
+  return process::dispatch(process, &ReplicaProcess::beginning, log);
 }
 
 
-process::Future<uint64_t> Replica::ending()
+process::Future<uint64_t> Replica::ending(const std::string& log)
 {
-  return process::dispatch(process, &ReplicaProcess::ending);
+  return process::dispatch(process, &ReplicaProcess::ending, log);
 }
 
 
-process::Future<uint64_t> Replica::promised()
+process::Future<uint64_t> Replica::promised(const std::string& log)
 {
-  return process::dispatch(process, &ReplicaProcess::promised);
+  return process::dispatch(process, &ReplicaProcess::promised, log);
 }
 
 
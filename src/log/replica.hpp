@@ -20,12 +20,12 @@
 #define __LOG_REPLICA_HPP__
 
 #include <list>
-#include <set>
 #include <string>
 
 #include <process/process.hpp>
 #include <process/protobuf.hpp>
 
+#include "common/intervalset.hpp"
 #include "common/result.hpp"
 #include "common/try.hpp"
 
@@ -49,30 +49,55 @@ extern Protocol<LearnRequest, LearnResponse> learn;
 class ReplicaProcess;
 
 
+// A replica hosts any number of logs: the default (unnamed) log and
+// any named logs, each of them independent of the others (e.g., with
+// its own coordinator and positions) except that they're all kept in
+// the same underlying storage and get persisted together, i.e., the
+// records written for all of them at about the same time are synced
+// at once. A named log gets created the first time it's used. Each
+// of the operations below is for the specified log.
 class Replica
 {
 public:
+  // How a replica stores its logs: in leveldb, or appended to a
+  // sequence of fixed size segment files (which avoids compactions
+  // and keeps appends sequential, at the cost of keeping an index of
+  // every position in memory).
+  enum Engine {
+    LEVELDB,
+    SEGMENTS
+  };
+
   // Constructs a new replica process using specified path to a
-  // directory for storing the underlying log.
-  Replica(const std::string& path);
+  // directory for storing the underlying log. The replica process
+  // gets the specified id, if any, so that replicas on other hosts
+  // can address it without first exchanging pids.
+  Replica(const std::string& path,
+          Engine engine = LEVELDB,
+          const std::string& id = "");
   ~Replica();
 
   // Returns all the actions between the specified positions, unless
   // those positions are invalid, in which case returns an error.
-  process::Future<std::list<Action> > read(uint64_t from, uint64_t to);
+  process::Future<std::list<Action> > read(
+      uint64_t from,
+      uint64_t to,
+      const std::string& log = "");
 
   // Returns missing positions in the log (i.e., unlearned or holes)
   // up to the specified position.
-  process::Future<std::set<uint64_t> > missing(uint64_t position);
+  process::Future<intervalset<uint64_t> > missing(
+      uint64_t position,
+      const std::string& log = "");
 
   // Returns the beginning position of the log.
-  process::Future<uint64_t> beginning();
+  process::Future<uint64_t> beginning(const std::string& log = "");
 
   // Returns the last written position in the log.
-  process::Future<uint64_t> ending();
+  process::Future<uint64_t> ending(const std::string& log = "");
 
   // Returns the highest implicit promise this replica has given.
-  process::Future<uint64_t> promised();
+  process::Future<uint64_t> promised(const std::string& log = "");
 
   // Returns the PID associated with this replica.
   process::PID<ReplicaProcess> pid();
@@ -20,6 +20,7 @@
 #define __ALLOCATOR_HPP__
 
 #include "common/hashmap.hpp"
+#include "common/option.hpp"
 #include "common/resources.hpp"
 
 #include "master/master.hpp"
@@ -45,6 +46,13 @@ public:
 
   virtual void frameworkRemoved(Framework* framework) {}
 
+  // Whenever a framework stops (e.g., it disconnected) or starts
+  // (e.g., it failed over) accepting offers again the master invokes
+  // these callbacks.
+  virtual void frameworkDeactivated(Framework* framework) {}
+
+  virtual void frameworkActivated(Framework* framework) {}
+
   virtual void slaveAdded(Slave* slave) {}
 
   virtual void slaveRemoved(Slave* slave) {}
@@ -54,11 +62,13 @@ public:
       const std::vector<ResourceRequest>& requests) {}
 
   // Whenever resources offered to a framework go unused (e.g.,
-  // refused) the master invokes this callback.
+  // refused) the master invokes this callback (along with the filters
+  // that should be applied to the unused resources, if any).
   virtual void resourcesUnused(
       const FrameworkID& frameworkId,
       const SlaveID& slaveId,
-      const Resources& resources) {}
+      const Resources& resources,
+      const Option<Filters>& filters) {}
 
   // Whenever resources are "recovered" in the cluster (e.g., a task
   // finishes, an offer is removed because a framework has failed or
@@ -68,10 +78,23 @@ public:
       const SlaveID& slaveId,
       const Resources& resources) {}
 
+  // Whenever a framework queues tasks (see Framework::queued) the
+  // master invokes this callback. An allocator that supports it
+  // places the queued tasks on slaves (see Master::placeTasks) rather
+  // than offering those resources to the framework.
+  virtual void tasksQueued(Framework* framework) {}
+
   // Whenever a framework that has filtered resources want's to revive
   // offers for those resources the master invokes this callback.
   virtual void offersRevived(Framework* framework) {}
 
+  // Whenever a slave reports its slack (i.e., the resources its
+  // executors have been allocated but aren't using) the master
+  // invokes this callback. An allocator can offer the slack that
+  // isn't already offered or in use (see Slave::slackFree) as
+  // revocable resources, or just ignore it.
+  virtual void slackChanged(Slave* slave) {}
+
   virtual void timerTick() {}
 };
 
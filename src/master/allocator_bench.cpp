@@ -0,0 +1,760 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <process/clock.hpp>
+#include <process/process.hpp>
+
+#include "common/fatal.hpp"
+#include "common/foreach.hpp"
+#include "common/logging.hpp"
+#include "common/option.hpp"
+#include "common/resources.hpp"
+#include "common/timer.hpp"
+#include "common/utils.hpp"
+
+#include "configurator/configurator.hpp"
+
+#include "master/allocator.hpp"
+#include "master/allocator_factory.hpp"
+#include "master/master.hpp"
+#include "master/slaves_manager.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+using namespace mesos::internal::master;
+
+using process::Clock;
+
+using std::cerr;
+using std::cout;
+using std::deque;
+using std::endl;
+using std::max;
+using std::min;
+using std::multimap;
+using std::pair;
+using std::string;
+using std::vector;
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// A job of a trace being replayed: tasks of a framework that arrive
+// together, all needing the same resources and running for the same
+// (simulated) time.
+struct Job
+{
+  double arrival;
+  int tasks;
+  Resources resources;
+  double duration;
+};
+
+
+// A master that never gets spawned: rather than registering slaves
+// and frameworks and sending offers to schedulers it adds synthetic
+// slaves and frameworks and has each framework launch as many (fixed
+// size) tasks as fit in its offers, declining the rest. The tasks
+// finish after a random amount of (simulated) time. When replaying a
+// trace, the frameworks instead only launch the tasks of the jobs
+// they've been submitted (in order), which run for as long as the
+// trace says.
+class SimulatedMaster : public Master
+{
+public:
+  SimulatedMaster(Allocator* allocator,
+                  const Resources& _task,
+                  double _duration)
+    : Master(allocator),
+      offered(0),
+      launched(0),
+      replaying(false),
+      task(_task),
+      duration(_duration),
+      nextTaskId(0)
+  {
+    nextFrameworkId = 0;
+    nextOfferId = 0;
+    nextSlaveId = 0;
+
+    // The master's destructor expects a slaves manager.
+    slavesManager = new SlavesManager(conf, self());
+    process::spawn(slavesManager);
+  }
+
+  virtual ~SimulatedMaster()
+  {
+    // Clean up here (rather than in Master::~Master) since there are
+    // no slaves or schedulers to tell about it.
+    foreachvalue (Offer* offer, utils::copy(offers)) {
+      removeOffer(offer);
+    }
+
+    foreachvalue (Framework* framework, frameworks) {
+      foreachvalue (Task* task, framework->tasks) {
+        delete task;
+      }
+      delete framework;
+    }
+
+    foreachvalue (Slave* slave, slaves) {
+      delete slave;
+    }
+
+    frameworks.clear();
+    slaves.clear();
+  }
+
+  Slave* createSlave(const Resources& resources)
+  {
+    SlaveInfo info;
+    info.set_hostname("slave" + utils::stringify(nextSlaveId));
+    info.mutable_resources()->MergeFrom(resources);
+
+    Slave* slave = new Slave(info, newSlaveId(), process::UPID(), 0);
+    slaves[slave->id] = slave;
+    return slave;
+  }
+
+  Framework* createFramework()
+  {
+    FrameworkInfo info;
+    info.set_user("user");
+    info.set_name("framework" + utils::stringify(nextFrameworkId));
+
+    Framework* framework =
+      new Framework(info, newFrameworkId(), process::UPID(), 0);
+    frameworks[framework->id] = framework;
+    return framework;
+  }
+
+  virtual void makeOffers(Framework* framework,
+                          const hashmap<Slave*, Resources>& offered,
+                          bool revocable)
+  {
+    foreachpair (Slave* slave, const Resources& resources, offered) {
+      Offer* offer = offerPool.get();
+      offer->mutable_id()->MergeFrom(newOfferId());
+      offer->mutable_framework_id()->MergeFrom(framework->id);
+      offer->mutable_slave_id()->MergeFrom(slave->id);
+      offer->set_hostname(slave->info.hostname());
+      offer->mutable_resources()->MergeFrom(resources);
+      offer->set_revocable(revocable);
+
+      offers[offer->id()] = offer;
+
+      framework->addOffer(offer);
+      slave->addOffer(offer);
+
+      pending.push_back(offer);
+    }
+
+    this->offered += offered.size();
+  }
+
+  // Returns (and forgets) the offers made since the last call.
+  vector<Offer*> outstanding()
+  {
+    vector<Offer*> result;
+    std::swap(result, pending);
+    return result;
+  }
+
+  // Queues a job for the framework to launch the tasks of (only
+  // when replaying a trace).
+  void submit(Framework* framework, const Job& job)
+  {
+    CHECK(replaying);
+    jobs[framework->id].push_back(job);
+  }
+
+  // Launches as many tasks as fit in an offer at time 'now' and
+  // returns the resources that are left over.
+  Resources launch(Offer* offer, double now)
+  {
+    Framework* framework = getFramework(offer->framework_id());
+    Slave* slave = getSlave(offer->slave_id());
+
+    Resources remaining = offer->resources();
+
+    removeOffer(offer);
+
+    if (replaying) {
+      // The tasks of the jobs get launched in order, so a task that
+      // doesn't fit holds up the ones after it.
+      deque<Job>& queue = jobs[framework->id];
+      while (!queue.empty() && queue.front().resources <= remaining) {
+        Job& job = queue.front();
+        start(framework, slave, job.resources, now + job.duration);
+        delays.push_back(now - job.arrival);
+        remaining -= job.resources;
+        if (--job.tasks == 0) {
+          queue.pop_front();
+        }
+      }
+    } else {
+      while (task <= remaining) {
+        // Uniformly distributed around the average duration.
+        double finish = now + 2 * duration * (random() / (RAND_MAX + 1.0));
+        start(framework, slave, task, finish);
+        remaining -= task;
+      }
+    }
+
+    return remaining;
+  }
+
+  // Returns whether or not all the submitted tasks have finished.
+  bool idle() const
+  {
+    if (!running.empty()) {
+      return false;
+    }
+
+    foreachvalue (const deque<Job>& queue, jobs) {
+      if (!queue.empty()) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // Returns the next task to finish by 'now' (if any).
+  Task* finished(double now)
+  {
+    if (running.empty() || running.begin()->first > now) {
+      return NULL;
+    }
+
+    Task* task = running.begin()->second;
+    running.erase(running.begin());
+    return task;
+  }
+
+  // Removes a finished task (which tells the allocator).
+  void finish(Task* task)
+  {
+    used -= task->resources();
+    removeTask(task);
+  }
+
+  // Returns the fraction of the specified resource (e.g., "cpus") of
+  // all the slaves that running tasks are using.
+  double utilization(const string& name) const
+  {
+    Value::Scalar none;
+
+    Resources total;
+    foreachvalue (Slave* slave, slaves) {
+      total += slave->info.resources();
+    }
+
+    const double available = total.get(name, none).value();
+
+    return available > 0 ? used.get(name, none).value() / available : 0;
+  }
+
+  // Returns the difference between the largest and the smallest
+  // dominant share of any framework (i.e., 0 if perfectly fair since
+  // every framework wants as much as it can get).
+  double unfairness() const
+  {
+    Resources total;
+    foreachvalue (Slave* slave, slaves) {
+      total += slave->info.resources();
+    }
+
+    double highest = 0;
+    double lowest = 1;
+
+    foreachvalue (Framework* framework, frameworks) {
+      // When replaying a trace only the frameworks that are waiting
+      // to launch tasks want more resources.
+      if (replaying) {
+        hashmap<FrameworkID, deque<Job> >::const_iterator it =
+          jobs.find(framework->id);
+        if (it == jobs.end() || it->second.empty()) {
+          continue;
+        }
+      }
+
+      double share = 0;
+      foreach (const Resource& resource, total) {
+        if (resource.type() == Value::SCALAR &&
+            resource.scalar().value() > 0) {
+          Value::Scalar none;
+          share = max(share,
+                      framework->resources.get(resource.name(), none).value() /
+                      resource.scalar().value());
+        }
+      }
+      highest = max(highest, share);
+      lowest = min(lowest, share);
+    }
+
+    return highest >= lowest ? highest - lowest : 0;
+  }
+
+  size_t offered;
+  size_t launched;
+
+  // Whether or not the frameworks only launch the tasks of the jobs
+  // they get submitted (see submit), as when replaying a trace.
+  bool replaying;
+
+  // How long each task launched for a job waited to get launched
+  // (since its job arrived).
+  vector<double> delays;
+
+private:
+  // Launches a task that finishes at the specified time.
+  void start(Framework* framework,
+             Slave* slave,
+             const Resources& resources,
+             double finish)
+  {
+    Task* t = taskPool.get();
+    t->set_name("");
+    t->mutable_task_id()->set_value(utils::stringify(nextTaskId++));
+    t->mutable_framework_id()->MergeFrom(framework->id);
+    t->mutable_executor_id()->set_value("default");
+    t->mutable_slave_id()->MergeFrom(slave->id);
+    t->set_state(TASK_RUNNING);
+    t->mutable_resources()->MergeFrom(resources);
+
+    framework->addTask(t);
+    slave->addTask(t);
+
+    running.insert(std::make_pair(finish, t));
+    used += resources;
+    launched++;
+  }
+
+  const Resources task;
+  const double duration;
+
+  vector<Offer*> pending;
+
+  // Jobs waiting for their tasks to get launched, by framework.
+  hashmap<FrameworkID, deque<Job> > jobs;
+
+  // Resources of the running tasks.
+  Resources used;
+
+  // Running tasks ordered by when they finish.
+  multimap<double, Task*> running;
+
+  int64_t nextTaskId;
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+
+// Returns the specified percentile (nearest rank) of the sorted
+// values.
+static double percentile(const vector<double>& values, double p)
+{
+  if (values.empty()) {
+    return 0;
+  }
+
+  size_t rank = (size_t) (p * values.size());
+  return values[std::min(rank, values.size() - 1)];
+}
+
+
+// Collects the latencies of the calls into the allocator and reports
+// them (along with the throughput) once the simulation is done.
+class Latencies
+{
+public:
+  Latencies() : total(0) {}
+
+  void add(const nanoseconds& latency)
+  {
+    latencies.push_back(latency.millis());
+    total += latency.secs();
+  }
+
+  void report(size_t offers, size_t tasks)
+  {
+    std::sort(latencies.begin(), latencies.end());
+
+    cout << std::fixed << std::setprecision(3)
+         << "allocator: " << latencies.size() << " calls in "
+         << total << " seconds, "
+         << (total > 0 ? offers / total : 0) << " offers/second, "
+         << (total > 0 ? tasks / total : 0) << " tasks/second"
+         << endl
+         << "  latency (ms):"
+         << " p50 " << percentile(latencies, 0.5)
+         << " p99 " << percentile(latencies, 0.99)
+         << " p999 " << percentile(latencies, 0.999)
+         << " max " << (latencies.empty() ? 0 : latencies.back())
+         << " mean "
+         << (latencies.empty() ? 0 : total * 1000 / latencies.size())
+         << endl;
+  }
+
+private:
+  vector<double> latencies; // In milliseconds.
+  double total; // In seconds.
+};
+
+
+// Orders jobs by when they arrive.
+static bool arrival(const pair<string, Job>& left,
+                    const pair<string, Job>& right)
+{
+  return left.second.arrival < right.second.arrival;
+}
+
+
+// Reads a trace of jobs to replay, one job per line: when the job
+// arrives (seconds since the start of the trace), the framework it's
+// for (any name), its number of tasks, the seconds each task runs for
+// and, optionally, the resources of each task (otherwise 'task').
+// Empty lines and lines starting with '#' get skipped. Returns the
+// jobs (along with their frameworks) in order of arrival.
+static vector<pair<string, Job> > trace(const string& path,
+                                        const Resources& task)
+{
+  std::ifstream file(path.c_str());
+
+  if (!file.is_open()) {
+    fatal("Failed to open trace %s", path.c_str());
+  }
+
+  vector<pair<string, Job> > jobs;
+
+  string line;
+  int number = 0;
+  while (std::getline(file, line)) {
+    number++;
+
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    std::istringstream in(line);
+
+    string framework;
+    Job job;
+    in >> job.arrival >> framework >> job.tasks >> job.duration;
+
+    if (in.fail() || job.tasks < 1 || job.duration < 0) {
+      fatal("Malformed job on line %d of %s", number, path.c_str());
+    }
+
+    string resources;
+    in >> resources;
+    job.resources = resources.empty() ? task : Resources::parse(resources);
+
+    jobs.push_back(std::make_pair(framework, job));
+  }
+
+  // Jobs arriving at the same time stay in the order of the trace.
+  std::stable_sort(jobs.begin(), jobs.end(), arrival);
+
+  return jobs;
+}
+
+
+void usage(const char* programName, const Configurator& configurator)
+{
+  cerr << "Usage: " << programName << " [--allocator=NAME] [--slaves=N] [...]"
+       << endl
+       << endl
+       << "Benchmarks an allocator by simulating a cluster of N slaves "
+       << "with frameworks" << endl
+       << "that launch (and finish) tasks on every offer they get, or "
+       << "that replay" << endl
+       << "a trace of jobs (see --trace), entirely in simulated time."
+       << endl
+       << endl
+       << "Supported options:" << endl
+       << configurator.getUsage();
+}
+
+
+int main(int argc, char** argv)
+{
+  GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+  Configurator configurator;
+  Logging::registerOptions(&configurator);
+  configurator.addOption<string>("allocator", "Allocator to benchmark "
+                                 "(simple, drf, parallel, packing or "
+                                 "splitting)", "simple");
+  configurator.addOption<int>("slaves", "Number of slaves", 1000);
+  configurator.addOption<int>("frameworks", "Number of frameworks", 10);
+  configurator.addOption<string>("resources", "Resources of each slave",
+                                 "cpus:8;mem:16384");
+  configurator.addOption<string>("task", "Resources of each task",
+                                 "cpus:1;mem:1024");
+  configurator.addOption<double>("task_duration", "Average seconds each "
+                                 "task runs for", 10.0);
+  configurator.addOption<double>("duration", "Seconds of simulated time "
+                                 "(unless replaying a trace)", 60.0);
+  configurator.addOption<double>("step", "Seconds of simulated time "
+                                 "between responding to offers", 0.1);
+  configurator.addOption<int>("seed", "Seed for the task durations", 0);
+  configurator.addOption<string>("trace", "Trace of jobs to replay, one "
+                                 "per line: <arrival seconds> <framework> "
+                                 "<tasks> <task seconds> [<task resources>] "
+                                 "(runs until all the tasks have finished)",
+                                 "");
+
+  if (argc == 2 && string("--help") == argv[1]) {
+    usage(argv[0], configurator);
+    exit(1);
+  }
+
+  Configuration conf;
+  try {
+    conf = configurator.load(argc, argv, true);
+  } catch (ConfigurationException& e) {
+    cerr << "Configuration error: " << e.what() << endl;
+    exit(1);
+  }
+
+  Logging::init(argv[0], conf);
+
+  process::initialize(false);
+
+  const string name = conf.get<string>("allocator", "simple");
+  const int slaves = conf.get<int>("slaves", 1000);
+  const int frameworks = conf.get<int>("frameworks", 10);
+  const Resources resources =
+    Resources::parse(conf.get<string>("resources", "cpus:8;mem:16384"));
+  const Resources task =
+    Resources::parse(conf.get<string>("task", "cpus:1;mem:1024"));
+  const double taskDuration = conf.get<double>("task_duration", 10.0);
+  const double duration = conf.get<double>("duration", 60.0);
+  const double step = conf.get<double>("step", 0.1);
+  const string path = conf.get<string>("trace", "");
+
+  const vector<pair<string, Job> > jobs =
+    path != "" ? trace(path, task) : vector<pair<string, Job> >();
+
+  if (slaves < 1 || (path == "" && frameworks < 1) || step <= 0) {
+    fatal("Expecting at least one slave and framework and a positive step");
+  }
+
+  // The async allocator sends its offers to a (spawned) master.
+  if (name == "async") {
+    fatal("The async allocator can't be used with a simulated master");
+  }
+
+  Allocator* allocator = AllocatorFactory::instantiate(name, NULL);
+
+  if (allocator == NULL) {
+    fatal("Unknown allocator: %s", name.c_str());
+  }
+
+  srandom(conf.get<int>("seed", 0));
+
+  // Simulate time (the allocators use it to batch and filter).
+  Clock::pause();
+
+  const double start = Clock::now();
+
+  SimulatedMaster* master =
+    new SimulatedMaster(allocator, task, taskDuration);
+
+  allocator->initialize(master);
+
+  Latencies statistics;
+
+  if (path != "") {
+    master->replaying = true;
+    cout << "Replaying " << jobs.size() << " jobs of " << path
+         << " with the " << name << " allocator and " << slaves
+         << " slaves" << endl;
+  } else {
+    cout << "Benchmarking the " << name << " allocator with " << slaves
+         << " slaves and " << frameworks << " frameworks" << endl;
+  }
+
+  // When replaying a trace the frameworks get added as their first
+  // jobs arrive.
+  for (int i = 0; path == "" && i < frameworks; i++) {
+    Framework* framework = master->createFramework();
+
+    Timer timer;
+    timer.start();
+    allocator->frameworkAdded(framework);
+    timer.stop();
+    statistics.add(timer.elapsed());
+  }
+
+  for (int i = 0; i < slaves; i++) {
+    Slave* slave = master->createSlave(resources);
+
+    Timer timer;
+    timer.start();
+    allocator->slaveAdded(slave);
+    timer.stop();
+    statistics.add(timer.elapsed());
+  }
+
+  double ticked = start; // Time of the last timer tick.
+
+  double unfairness = 0; // Sum of the samples.
+  double worst = 0;
+  double cpus = 0; // Sum of the utilization samples.
+  double mem = 0;
+  int samples = 0;
+
+  hashmap<string, Framework*> named; // Frameworks of the trace.
+  size_t arrived = 0; // Jobs of the trace that have arrived.
+
+  Timer elapsed;
+  elapsed.start();
+
+  double now = start;
+  for (; path != "" ? arrived < jobs.size() || !master->idle()
+                    : now < start + duration;
+       now += step) {
+    Clock::advance(step);
+
+    // Submit the jobs that have arrived (to frameworks that revive
+    // their offers, like real ones would).
+    while (arrived < jobs.size() &&
+           start + jobs[arrived].second.arrival <= now) {
+      const string& framework = jobs[arrived].first;
+
+      Job job = jobs[arrived].second;
+      job.arrival += start;
+
+      Timer timer;
+      timer.start();
+      if (!named.contains(framework)) {
+        named[framework] = master->createFramework();
+        allocator->frameworkAdded(named[framework]);
+      }
+      master->submit(named[framework], job);
+      allocator->offersRevived(named[framework]);
+      timer.stop();
+      statistics.add(timer.elapsed());
+
+      arrived++;
+    }
+
+    // Finish the tasks that are done.
+    Task* finished = NULL;
+    while ((finished = master->finished(now)) != NULL) {
+      Timer timer;
+      timer.start();
+      master->finish(finished);
+      timer.stop();
+      statistics.add(timer.elapsed());
+    }
+
+    // Respond to the outstanding offers.
+    foreach (Offer* offer, master->outstanding()) {
+      const FrameworkID frameworkId = offer->framework_id();
+      const SlaveID slaveId = offer->slave_id();
+      const Resources offered = offer->resources();
+
+      Resources unused = master->launch(offer, now);
+
+      // Just like the master, only filter offers that went unused.
+      Option<Filters> filters = Option<Filters>::none();
+      if (unused == offered) {
+        filters = Option<Filters>::some(Filters());
+      }
+
+      Timer timer;
+      timer.start();
+      allocator->resourcesUnused(frameworkId, slaveId, unused, filters);
+      timer.stop();
+      statistics.add(timer.elapsed());
+    }
+
+    // The master ticks the allocator every second.
+    if (now - ticked >= 1.0) {
+      Timer timer;
+      timer.start();
+      allocator->timerTick();
+      timer.stop();
+      statistics.add(timer.elapsed());
+
+      ticked = now;
+
+      const double sample = master->unfairness();
+      unfairness += sample;
+      worst = max(worst, sample);
+      cpus += master->utilization("cpus");
+      mem += master->utilization("mem");
+      samples++;
+    }
+  }
+
+  elapsed.stop();
+
+  statistics.report(master->offered, master->launched);
+
+  cout << "fairness error (difference in dominant shares):"
+       << " mean " << (samples > 0 ? unfairness / samples : 0)
+       << " max " << worst
+       << endl;
+
+  cout << "utilization: cpus " << (samples > 0 ? cpus / samples : 0)
+       << " mem " << (samples > 0 ? mem / samples : 0)
+       << endl;
+
+  if (path != "") {
+    vector<double>& delays = master->delays;
+    std::sort(delays.begin(), delays.end());
+
+    cout << "scheduling delay (seconds):"
+         << " p50 " << percentile(delays, 0.5)
+         << " p99 " << percentile(delays, 0.99)
+         << " max " << (delays.empty() ? 0 : delays.back())
+         << endl;
+  }
+
+  cout << "simulated " << now - start << " seconds in "
+       << elapsed.elapsed().secs() << " seconds" << endl;
+
+  delete master;
+  delete allocator;
+
+  Clock::resume();
+
+  return 0;
+}
@@ -17,11 +17,22 @@
  */
 
 #include "allocator_factory.hpp"
+#include "async_allocator.hpp"
+#include "drf_allocator.hpp"
+#include "packing_allocator.hpp"
+#include "parallel_allocator.hpp"
 #include "simple_allocator.hpp"
+#include "splitting_allocator.hpp"
 
 using namespace mesos::internal::master;
 
 DEFINE_FACTORY(Allocator, Master *)
 {
   registerClass<SimpleAllocator>("simple");
+  registerClass<DRFAllocator>("drf");
+  registerClass<PreemptiveDRFAllocator>("drf-preemptive");
+  registerClass<ParallelAllocator>("parallel");
+  registerClass<AsyncAllocator>("async");
+  registerClass<PackingAllocator>("packing");
+  registerClass<SplittingAllocator>("splitting");
 }
@@ -0,0 +1,530 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <utility>
+
+#include <process/clock.hpp>
+#include <process/dispatch.hpp>
+#include <process/metrics.hpp>
+
+#include "master/async_allocator.hpp"
+
+using process::Clock;
+using process::PID;
+
+using std::make_pair;
+using std::max;
+using std::pair;
+using std::sort;
+using std::vector;
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// Time taken by the allocation passes that had resources to offer.
+static process::metrics::Timer allocations(
+    "mesos_master_allocation_seconds",
+    "Time taken by allocation passes.");
+
+
+AllocatorProcess::AllocatorProcess(const PID<Master>& _master)
+  : master(_master), everything(false), scheduled(false) {}
+
+
+void AllocatorProcess::frameworkAdded(const FrameworkID& frameworkId)
+{
+  LOG(INFO) << "Added framework " << frameworkId;
+
+  FrameworkResources& framework = frameworks[frameworkId];
+  framework.active = true;
+
+  // Take over what the framework was using on the slaves that got
+  // added before it (re-)registered.
+  foreachpair (const SlaveID& slaveId, SlaveResources& slave, slaves) {
+    if (slave.unattributed.contains(frameworkId)) {
+      const Resources& resources = slave.unattributed[frameworkId];
+      framework.allocated += resources;
+      framework.slaves[slaveId] += resources;
+      slave.unattributed.erase(frameworkId);
+    }
+  }
+
+  dirty();
+}
+
+
+void AllocatorProcess::frameworkRemoved(const FrameworkID& frameworkId)
+{
+  LOG(INFO) << "Removed framework " << frameworkId;
+
+  if (frameworks.contains(frameworkId)) {
+    // Anything still allocated to the framework (e.g., resources of
+    // executors) is free now.
+    foreachpair (const SlaveID& slaveId,
+                 const Resources& resources,
+                 frameworks[frameworkId].slaves) {
+      if (slaves.contains(slaveId)) {
+        slaves[slaveId].free += resources;
+      }
+    }
+
+    frameworks.erase(frameworkId);
+  }
+
+  foreachvalue (SlaveResources& slave, slaves) {
+    if (slave.unattributed.contains(frameworkId)) {
+      slave.free += slave.unattributed[frameworkId];
+      slave.unattributed.erase(frameworkId);
+    }
+  }
+
+  filters.remove(frameworkId);
+
+  dirty();
+}
+
+
+void AllocatorProcess::frameworkActivated(const FrameworkID& frameworkId)
+{
+  if (frameworks.contains(frameworkId)) {
+    frameworks[frameworkId].active = true;
+    dirty();
+  }
+}
+
+
+void AllocatorProcess::frameworkDeactivated(const FrameworkID& frameworkId)
+{
+  if (frameworks.contains(frameworkId)) {
+    frameworks[frameworkId].active = false;
+  }
+}
+
+
+void AllocatorProcess::slaveAdded(
+    const SlaveID& slaveId,
+    const Resources& total,
+    const hashmap<FrameworkID, Resources>& used)
+{
+  LOG(INFO) << "Added slave " << slaveId << " with " << total;
+
+  SlaveResources& slave = slaves[slaveId];
+  slave.total = total;
+  slave.free = total;
+
+  foreachpair (const FrameworkID& frameworkId,
+               const Resources& resources,
+               used) {
+    slave.free -= resources;
+
+    // What frameworks that haven't re-registered yet use gets
+    // attributed to them once they do (see frameworkAdded).
+    if (frameworks.contains(frameworkId)) {
+      frameworks[frameworkId].allocated += resources;
+      frameworks[frameworkId].slaves[slaveId] += resources;
+    } else {
+      slave.unattributed[frameworkId] += resources;
+    }
+  }
+
+  this->total += total;
+
+  dirty(slaveId);
+}
+
+
+void AllocatorProcess::slaveRemoved(const SlaveID& slaveId)
+{
+  LOG(INFO) << "Removed slave " << slaveId;
+
+  if (slaves.contains(slaveId)) {
+    total -= slaves[slaveId].total;
+    slaves.erase(slaveId);
+  }
+
+  foreachvalue (FrameworkResources& framework, frameworks) {
+    if (framework.slaves.contains(slaveId)) {
+      framework.allocated -= framework.slaves[slaveId];
+      framework.slaves.erase(slaveId);
+    }
+  }
+
+  filters.remove(slaveId);
+  dirtied.erase(slaveId);
+}
+
+
+void AllocatorProcess::resourcesUnused(
+    const FrameworkID& frameworkId,
+    const SlaveID& slaveId,
+    const Resources& resources,
+    const Option<Filters>& filters)
+{
+  recover(frameworkId, slaveId, resources);
+
+  if (resources.allocatable().size() > 0) {
+    VLOG(1) << "Framework " << frameworkId
+            << " left " << resources.allocatable()
+            << " unused on slave " << slaveId;
+
+    // Get the timeout (if it exists) for re-offering refused resources.
+    double timeout = 0;
+    if (filters.isSome()) {
+      timeout = filters.get().has_refuse_seconds()
+        ? filters.get().refuse_seconds()
+        : UNUSED_RESOURCES_TIMEOUT;
+    }
+
+    if (timeout != 0) {
+      this->filters.add(frameworkId, slaveId, resources.allocatable(),
+                        (timeout == -1) ? 0 : Clock::coarse() + timeout);
+    } else {
+      this->filters.refuse(frameworkId, slaveId, resources.allocatable());
+    }
+  }
+
+  dirty(slaveId);
+}
+
+
+void AllocatorProcess::resourcesRecovered(
+    const FrameworkID& frameworkId,
+    const SlaveID& slaveId,
+    const Resources& resources)
+{
+  recover(frameworkId, slaveId, resources);
+  dirty(slaveId);
+}
+
+
+void AllocatorProcess::offersRevived(const FrameworkID& frameworkId)
+{
+  LOG(INFO) << "Filters removed for framework " << frameworkId;
+  filters.remove(frameworkId);
+  dirty();
+}
+
+
+void AllocatorProcess::timerTick()
+{
+  filters.expire(Clock::coarse());
+  dirty();
+}
+
+
+void AllocatorProcess::dirty(const SlaveID& slaveId)
+{
+  if (slaves.contains(slaveId)) {
+    dirtied.insert(slaveId);
+
+    if (!scheduled) {
+      process::dispatch(self(), &AllocatorProcess::allocate);
+      scheduled = true;
+    }
+  }
+}
+
+
+void AllocatorProcess::dirty()
+{
+  everything = true;
+
+  if (!scheduled) {
+    process::dispatch(self(), &AllocatorProcess::allocate);
+    scheduled = true;
+  }
+}
+
+
+void AllocatorProcess::recover(
+    const FrameworkID& frameworkId,
+    const SlaveID& slaveId,
+    const Resources& resources)
+{
+  // We only give back what we know was allocated, since a framework
+  // or slave that was removed already had its resources accounted
+  // for (see frameworkRemoved and slaveRemoved).
+  if (!slaves.contains(slaveId)) {
+    return;
+  }
+
+  SlaveResources& slave = slaves[slaveId];
+
+  if (frameworks.contains(frameworkId)) {
+    FrameworkResources& framework = frameworks[frameworkId];
+    if (framework.slaves.contains(slaveId)) {
+      framework.allocated -= resources;
+      framework.slaves[slaveId] -= resources;
+      slave.free += resources;
+    }
+  } else if (slave.unattributed.contains(frameworkId)) {
+    // E.g., a task of a framework that hasn't re-registered yet
+    // finished.
+    slave.unattributed[frameworkId] -= resources;
+    slave.free += resources;
+  }
+}
+
+
+namespace {
+
+// Returns the dominant share of the allocated resources, i.e., the
+// maximum share of any (scalar) resource in the total.
+double dominantShare(const Resources& allocated, const Resources& total)
+{
+  double share = 0;
+
+  foreach (const Resource& resource, total) {
+    if (resource.type() == Value::SCALAR) {
+      double value = resource.scalar().value();
+
+      if (value > 0) {
+        Value::Scalar none;
+        const Value::Scalar& scalar = allocated.get(resource.name(), none);
+        share = max(share, scalar.value() / value);
+      }
+    }
+  }
+
+  return share;
+}
+
+} // namespace {
+
+
+vector<FrameworkID> AllocatorProcess::ordering()
+{
+  // Sort by share (and then by framework id so that the ordering is
+  // deterministic for unit testing).
+  vector<pair<double, FrameworkID> > shares;
+
+  foreachpair (const FrameworkID& frameworkId,
+               const FrameworkResources& framework,
+               frameworks) {
+    if (framework.active) {
+      shares.push_back(
+          make_pair(dominantShare(framework.allocated, total), frameworkId));
+    }
+  }
+
+  sort(shares.begin(), shares.end());
+
+  vector<FrameworkID> result;
+  result.reserve(shares.size());
+
+  for (size_t i = 0; i < shares.size(); i++) {
+    result.push_back(shares[i].second);
+  }
+
+  return result;
+}
+
+
+void AllocatorProcess::allocate()
+{
+  scheduled = false;
+
+  vector<FrameworkID> ordering = this->ordering();
+  if (ordering.empty()) {
+    VLOG(1) << "No frameworks to allocate resources!";
+    return;
+  }
+
+  // Find all the available resources that can be allocated.
+  hashmap<SlaveID, Resources> available;
+
+  if (everything) {
+    foreachkey (const SlaveID& slaveId, slaves) {
+      dirtied.insert(slaveId);
+    }
+  }
+
+  foreach (const SlaveID& slaveId, dirtied) {
+    Resources resources = slaves[slaveId].free.allocatable();
+
+    // See the comment in SimpleAllocator::update.
+    Value::Scalar none;
+    Value::Scalar cpus = resources.get("cpus", none);
+    Value::Scalar mem = resources.get("mem", none);
+
+    if (cpus.value() >= MIN_CPUS && mem.value() > MIN_MEM) {
+      available[slaveId] = resources;
+    }
+  }
+
+  dirtied.clear();
+  everything = false;
+
+  if (available.size() == 0) {
+    VLOG(1) << "No resources available to allocate!";
+    return;
+  }
+
+  double started = Clock::now();
+
+  // Clear refusals on any slave that has been refused by everyone.
+  foreachkey (const SlaveID& slaveId, available) {
+    if (filters.refusals(slaveId) == ordering.size()) {
+      filters.clear(slaveId);
+    }
+  }
+
+  foreach (const FrameworkID& frameworkId, ordering) {
+    hashmap<SlaveID, Resources> offerable;
+    foreachpair (const SlaveID& slaveId,
+                 const Resources& resources,
+                 available) {
+      if (!filters.filtered(frameworkId, slaveId, resources)) {
+        offerable[slaveId] = resources;
+      }
+    }
+
+    if (offerable.size() > 0) {
+      FrameworkResources& framework = frameworks[frameworkId];
+
+      foreachpair (const SlaveID& slaveId,
+                   const Resources& resources,
+                   offerable) {
+        available.erase(slaveId);
+        slaves[slaveId].free -= resources;
+        framework.allocated += resources;
+        framework.slaves[slaveId] += resources;
+      }
+
+      process::dispatch(master, &Master::offer, frameworkId, offerable);
+    }
+  }
+
+  allocations.record(Clock::now() - started);
+}
+
+
+AsyncAllocator::~AsyncAllocator()
+{
+  if (process != NULL) {
+    process::terminate(process);
+    process::wait(process);
+    delete process;
+  }
+}
+
+
+void AsyncAllocator::initialize(Master* master)
+{
+  process = new AllocatorProcess(master->self());
+  process::spawn(process);
+}
+
+
+void AsyncAllocator::frameworkAdded(Framework* framework)
+{
+  process::dispatch(process, &AllocatorProcess::frameworkAdded,
+                    framework->id);
+}
+
+
+void AsyncAllocator::frameworkRemoved(Framework* framework)
+{
+  process::dispatch(process, &AllocatorProcess::frameworkRemoved,
+                    framework->id);
+}
+
+
+void AsyncAllocator::frameworkDeactivated(Framework* framework)
+{
+  process::dispatch(process, &AllocatorProcess::frameworkDeactivated,
+                    framework->id);
+}
+
+
+void AsyncAllocator::frameworkActivated(Framework* framework)
+{
+  process::dispatch(process, &AllocatorProcess::frameworkActivated,
+                    framework->id);
+}
+
+
+void AsyncAllocator::slaveAdded(Slave* slave)
+{
+  // Attribute the resources already in use on the slave (e.g., if it
+  // re-registered) to the frameworks using them.
+  hashmap<FrameworkID, Resources> used;
+
+  foreachvalue (Task* task, slave->tasks) {
+    used[task->framework_id()] += task->resources();
+  }
+
+  foreachkey (const FrameworkID& frameworkId, slave->executors) {
+    foreachvalue (const ExecutorInfo& executorInfo,
+                  slave->executors[frameworkId]) {
+      used[frameworkId] += executorInfo.resources();
+    }
+  }
+
+  process::dispatch(process, &AllocatorProcess::slaveAdded,
+                    slave->id, Resources(slave->info.resources()), used);
+}
+
+
+void AsyncAllocator::slaveRemoved(Slave* slave)
+{
+  process::dispatch(process, &AllocatorProcess::slaveRemoved, slave->id);
+}
+
+
+void AsyncAllocator::resourcesUnused(
+    const FrameworkID& frameworkId,
+    const SlaveID& slaveId,
+    const Resources& resources,
+    const Option<Filters>& filters)
+{
+  process::dispatch(process, &AllocatorProcess::resourcesUnused,
+                    frameworkId, slaveId, resources, filters);
+}
+
+
+void AsyncAllocator::resourcesRecovered(
+    const FrameworkID& frameworkId,
+    const SlaveID& slaveId,
+    const Resources& resources)
+{
+  process::dispatch(process, &AllocatorProcess::resourcesRecovered,
+                    frameworkId, slaveId, resources);
+}
+
+
+void AsyncAllocator::offersRevived(Framework* framework)
+{
+  process::dispatch(process, &AllocatorProcess::offersRevived,
+                    framework->id);
+}
+
+
+void AsyncAllocator::timerTick()
+{
+  process::dispatch(process, &AllocatorProcess::timerTick);
+}
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
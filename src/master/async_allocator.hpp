@@ -0,0 +1,181 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ASYNC_ALLOCATOR_HPP__
+#define __ASYNC_ALLOCATOR_HPP__
+
+#include <vector>
+
+#include <process/process.hpp>
+
+#include "common/hashmap.hpp"
+#include "common/hashset.hpp"
+#include "common/resources.hpp"
+
+#include "master/allocator.hpp"
+#include "master/offer_filters.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// Makes allocation decisions in its own process (i.e., off of the
+// master's thread). Unlike the other allocators it never looks at the
+// master's data structures: it keeps its own account of the resources
+// on each slave and what each framework has been allocated (based on
+// the events the master dispatches to it) and dispatches its offer
+// decisions back to the master (see Master::offer). Events that
+// arrive while an allocation is pending get batched into it.
+class AllocatorProcess : public process::Process<AllocatorProcess>
+{
+public:
+  AllocatorProcess(const process::PID<Master>& _master);
+
+  virtual ~AllocatorProcess() {}
+
+  void frameworkAdded(const FrameworkID& frameworkId);
+
+  void frameworkRemoved(const FrameworkID& frameworkId);
+
+  void frameworkActivated(const FrameworkID& frameworkId);
+
+  void frameworkDeactivated(const FrameworkID& frameworkId);
+
+  // Adds a slave with the specified total resources of which some
+  // might already be used by frameworks (e.g., when the slave
+  // re-registers with a new master).
+  void slaveAdded(const SlaveID& slaveId,
+                  const Resources& total,
+                  const hashmap<FrameworkID, Resources>& used);
+
+  void slaveRemoved(const SlaveID& slaveId);
+
+  void resourcesUnused(const FrameworkID& frameworkId,
+                       const SlaveID& slaveId,
+                       const Resources& resources,
+                       const Option<Filters>& filters);
+
+  void resourcesRecovered(const FrameworkID& frameworkId,
+                          const SlaveID& slaveId,
+                          const Resources& resources);
+
+  void offersRevived(const FrameworkID& frameworkId);
+
+  void timerTick();
+
+private:
+  // Remember that a slave's free resources (or, if everything is
+  // true, possibly any slave's) changed and schedule an allocation.
+  void dirty(const SlaveID& slaveId);
+  void dirty();
+
+  // Allocates the free resources on the changed slaves.
+  void allocate();
+
+  // Returns the resources on a slave back from a framework.
+  void recover(const FrameworkID& frameworkId,
+               const SlaveID& slaveId,
+               const Resources& resources);
+
+  // Returns the active frameworks ordered by dominant share.
+  std::vector<FrameworkID> ordering();
+
+  const process::PID<Master> master;
+
+  struct SlaveResources
+  {
+    Resources total;
+    Resources free;
+
+    // Resources in use by frameworks that hadn't (re-)registered when
+    // the slave was added, until they do (see frameworkAdded).
+    hashmap<FrameworkID, Resources> unattributed;
+  };
+
+  struct FrameworkResources
+  {
+    bool active;
+
+    // Resources allocated to the framework (offered or used) in
+    // total and on each slave.
+    Resources allocated;
+    hashmap<SlaveID, Resources> slaves;
+  };
+
+  hashmap<SlaveID, SlaveResources> slaves;
+  hashmap<FrameworkID, FrameworkResources> frameworks;
+
+  Resources total;
+
+  OfferFilters filters;
+
+  hashset<SlaveID> dirtied;
+  bool everything;
+  bool scheduled;
+};
+
+
+// Adapts the AllocatorProcess to the allocator interface the master
+// invokes (synchronously): it only copies the parts of the master's
+// data structures that the process needs and dispatches the events.
+class AsyncAllocator : public Allocator
+{
+public:
+  AsyncAllocator() : process(NULL) {}
+
+  virtual ~AsyncAllocator();
+
+  virtual void initialize(Master* master);
+
+  virtual void frameworkAdded(Framework* framework);
+
+  virtual void frameworkRemoved(Framework* framework);
+
+  virtual void frameworkDeactivated(Framework* framework);
+
+  virtual void frameworkActivated(Framework* framework);
+
+  virtual void slaveAdded(Slave* slave);
+
+  virtual void slaveRemoved(Slave* slave);
+
+  virtual void resourcesUnused(
+      const FrameworkID& frameworkId,
+      const SlaveID& slaveId,
+      const Resources& resources,
+      const Option<Filters>& filters);
+
+  virtual void resourcesRecovered(
+      const FrameworkID& frameworkId,
+      const SlaveID& slaveId,
+      const Resources& resources);
+
+  virtual void offersRevived(Framework* framework);
+
+  virtual void timerTick();
+
+private:
+  AllocatorProcess* process;
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __ASYNC_ALLOCATOR_HPP__
@@ -0,0 +1,144 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sstream>
+
+#include "common/foreach.hpp"
+#include "common/utils.hpp"
+
+#include "master/attribute_index.hpp"
+
+using std::string;
+using std::vector;
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+void AttributeIndex::add(const SlaveID& slaveId, const Attributes& attributes)
+{
+  remove(slaveId);
+
+  vector<string>& added = keys[slaveId];
+
+  foreach (const Attribute& attribute, attributes) {
+    const string& k = key(attribute);
+    slaves[k].insert(slaveId);
+    added.push_back(k);
+  }
+}
+
+
+void AttributeIndex::remove(const SlaveID& slaveId)
+{
+  if (!keys.contains(slaveId)) {
+    return;
+  }
+
+  foreach (const string& k, keys[slaveId]) {
+    slaves[k].erase(slaveId);
+    if (slaves[k].empty()) {
+      slaves.erase(k);
+    }
+  }
+
+  keys.erase(slaveId);
+}
+
+
+bool AttributeIndex::matches(
+    const SlaveID& slaveId,
+    const Attributes& attributes) const
+{
+  foreach (const Attribute& attribute, attributes) {
+    hashmap<string, hashset<SlaveID> >::const_iterator it =
+      slaves.find(key(attribute));
+
+    if (it == slaves.end() || !it->second.contains(slaveId)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+hashset<SlaveID> AttributeIndex::find(const Attributes& attributes) const
+{
+  hashset<SlaveID> result;
+
+  if (attributes.size() == 0) {
+    foreachkey (const SlaveID& slaveId, keys) {
+      result.insert(slaveId);
+    }
+    return result;
+  }
+
+  // Start with the fewest slaves (i.e., the rarest attribute) and
+  // only keep the ones that have the rest of the attributes too.
+  const hashset<SlaveID>* fewest = NULL;
+
+  foreach (const Attribute& attribute, attributes) {
+    hashmap<string, hashset<SlaveID> >::const_iterator it =
+      slaves.find(key(attribute));
+
+    if (it == slaves.end()) {
+      return result; // No slave has this attribute.
+    }
+
+    if (fewest == NULL || it->second.size() < fewest->size()) {
+      fewest = &it->second;
+    }
+  }
+
+  foreach (const SlaveID& slaveId, *fewest) {
+    if (matches(slaveId, attributes)) {
+      result.insert(slaveId);
+    }
+  }
+
+  return result;
+}
+
+
+string AttributeIndex::key(const Attribute& attribute)
+{
+  std::ostringstream out;
+
+  out << attribute.name() << ":";
+
+  if (attribute.type() == Value::SCALAR) {
+    out << attribute.scalar().value();
+  } else if (attribute.type() == Value::RANGES) {
+    out << "[";
+    for (int i = 0; i < attribute.ranges().range_size(); i++) {
+      const Value::Range& range = attribute.ranges().range(i);
+      out << (i > 0 ? ", " : "") << range.begin() << "-" << range.end();
+    }
+    out << "]";
+  } else if (attribute.type() == Value::TEXT) {
+    out << attribute.text().value();
+  }
+
+  return out.str();
+}
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,72 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ATTRIBUTE_INDEX_HPP__
+#define __ATTRIBUTE_INDEX_HPP__
+
+#include <string>
+#include <vector>
+
+#include <mesos/mesos.hpp>
+
+#include "common/attributes.hpp"
+#include "common/hashmap.hpp"
+#include "common/hashset.hpp"
+#include "common/type_utils.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// Indexes the slaves by their attributes (each name and value), so
+// that the slaves with some attributes (e.g., the constraints of a
+// framework, see FrameworkInfo) can be found without looking at
+// every slave in the cluster.
+class AttributeIndex
+{
+public:
+  // Adds (or replaces) the attributes of a slave.
+  void add(const SlaveID& slaveId, const Attributes& attributes);
+
+  // Removes a slave (e.g., when it gets removed).
+  void remove(const SlaveID& slaveId);
+
+  // Returns true if the slave has all of the specified attributes.
+  bool matches(const SlaveID& slaveId, const Attributes& attributes) const;
+
+  // Returns the slaves that have all of the specified attributes (or
+  // every slave if none are specified).
+  hashset<SlaveID> find(const Attributes& attributes) const;
+
+private:
+  // Returns the name and value of an attribute as a string, which is
+  // what the slaves get indexed by.
+  static std::string key(const Attribute& attribute);
+
+  // Slaves by attribute (see AttributeIndex::key), and the keys of
+  // each slave (so that removing a slave only touches its own).
+  hashmap<std::string, hashset<SlaveID> > slaves;
+  hashmap<SlaveID, std::vector<std::string> > keys;
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __ATTRIBUTE_INDEX_HPP__
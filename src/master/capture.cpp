@@ -0,0 +1,109 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <glog/logging.h>
+
+#include <process/clock.hpp>
+#include <process/event.hpp>
+#include <process/message.hpp>
+
+#include "master/capture.hpp"
+
+#include "messages/messages.hpp"
+
+using process::Clock;
+using process::MessageEvent;
+using process::UPID;
+
+using std::string;
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+Try<MessageCapture*> MessageCapture::create(const UPID& master,
+                                            const string& path)
+{
+  Try<RecordWriter*> writer = RecordWriter::open(path);
+
+  if (writer.isError()) {
+    return Try<MessageCapture*>::error(writer.error());
+  }
+
+  return new MessageCapture(master, writer.get());
+}
+
+
+MessageCapture::MessageCapture(const UPID& _master, RecordWriter* _writer)
+  : master(_master), writer(_writer), flushed(Clock::now()) {}
+
+
+MessageCapture::~MessageCapture()
+{
+  delete writer; // Flushes the buffered records.
+}
+
+
+bool MessageCapture::filter(const MessageEvent& event)
+{
+  const process::Message* message = event.message;
+
+  // The shards of the master are named after it (see SlaveShard).
+  if (message->to.ip != master.ip ||
+      message->to.port != master.port ||
+      (message->to.id != master.id &&
+       message->to.id.find(master.id + "-shard-") != 0)) {
+    return false;
+  }
+
+  CapturedMessage captured;
+  captured.set_timestamp(Clock::now());
+  captured.set_from(message->from);
+  captured.set_to(message->to.id);
+  captured.set_name(message->name);
+
+  // Messages from within the OS process might not be serialized.
+  if (message->body.empty() && message->payload) {
+    message->payload->serialize(captured.mutable_body());
+  } else {
+    captured.set_body(message->body);
+  }
+
+  Try<void> written = writer->write(captured);
+  if (written.isError()) {
+    LOG(ERROR) << "Failed to capture a message: " << written.error();
+  }
+
+  // Masters usually run until they get killed, so don't keep more
+  // than about a second of messages buffered.
+  if (captured.timestamp() - flushed >= 1.0) {
+    written = writer->flush();
+    if (written.isError()) {
+      LOG(ERROR) << "Failed to write out captured messages: "
+                 << written.error();
+    }
+    flushed = captured.timestamp();
+  }
+
+  return false;
+}
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,68 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MASTER_CAPTURE_HPP__
+#define __MASTER_CAPTURE_HPP__
+
+#include <string>
+
+#include <process/filter.hpp>
+#include <process/pid.hpp>
+
+#include "common/record_file.hpp"
+#include "common/try.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// Records every message sent to the master (or one of its shards)
+// into a file of CapturedMessage records (see RecordWriter), without
+// filtering anything, so that the traffic of a real master can be
+// replayed against another one later (see mesos-replay). Since this
+// is a libprocess filter, every message sent within the OS process
+// goes through it (and its lock), so capturing slows down the master
+// somewhat.
+class MessageCapture : public process::Filter
+{
+public:
+  // Captures the messages sent to the specified master into the file
+  // at the specified path (replacing the file if it exists).
+  static Try<MessageCapture*> create(const process::UPID& master,
+                                     const std::string& path);
+
+  // Writes out the messages captured so far.
+  virtual ~MessageCapture();
+
+  virtual bool filter(const process::MessageEvent& event);
+
+private:
+  MessageCapture(const process::UPID& master, RecordWriter* writer);
+
+  const process::UPID master;
+  RecordWriter* writer;
+
+  double flushed; // When the records were last written out.
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __MASTER_CAPTURE_HPP__
@@ -19,6 +19,10 @@
 #ifndef __MASTER_CONSTANTS_HPP__
 #define __MASTER_CONSTANTS_HPP__
 
+#include <stdint.h>
+
+#include "common/units.hpp"
+
 namespace mesos {
 namespace internal {
 namespace master {
@@ -32,6 +36,76 @@ const int MAX_OFFERS_PER_FRAMEWORK = 50;
 // Seconds until unused resources are re-offered to a framework.
 const double UNUSED_RESOURCES_TIMEOUT = 5.0;
 
+// Seconds after an allocation pass during which further changes are
+// batched (rather than each one triggering its own pass).
+const double ALLOCATION_INTERVAL = 1.0;
+
+// Number of changed slaves that triggers an allocation pass before
+// the allocation interval has elapsed.
+const int ALLOCATION_BATCH = 1000;
+
+// Changes are batched for at least ALLOCATION_THROTTLE times as long
+// as the last allocation pass took, so that during heavy churn the
+// passes take up at most about 1 / ALLOCATION_THROTTLE of the time.
+const double ALLOCATION_THROTTLE = 10.0;
+
+// Maximum seconds between the full allocation passes made on timer
+// ticks while nothing changes (the time between them doubles with
+// every pass that had nothing new to consider).
+const double MAX_ALLOCATION_BACKOFF = 16.0;
+
+// Number of worker threads the parallel allocator uses.
+const int ALLOCATION_WORKERS = 4;
+
+// Minimum number of slaves in an allocation pass for the parallel
+// allocator to split the pass across its workers.
+const int PARALLEL_ALLOCATION_SLAVES = 1000;
+
+// Seconds after which an offer that hasn't been used or declined gets
+// rescinded (so that a hung scheduler can't hoard resources), or 0 to
+// never rescind offers for being outstanding too long.
+const double OFFER_TIMEOUT = 0.0;
+
+// Seconds that the resources freed by a task of a sticky framework
+// (see FrameworkInfo::sticky) stay offered to just that framework
+// before they go back to the allocator.
+const double STICKY_OFFER_TIMEOUT = 2.0;
+
+// Seconds after sending offers to a framework during which any new
+// offers get aggregated into a single message.
+const double OFFER_AGGREGATION_INTERVAL = 0.1;
+
+// Number of shards that handle the status updates of the slaves
+// (see SlaveShard).
+const int STATUS_UPDATE_SHARDS = 4;
+
+// Seconds that a resource request preferring some slaves (see
+// ResourceRequest) waits for one of them before taking any slave.
+const double LOCALITY_WAIT = 3.0;
+
+// Seconds that a framework can go without offers while below
+// PREEMPTION_SHARE of its fair share before the DRF allocator starts
+// rescinding offers from (and possibly killing tasks of) the
+// frameworks above their fair share.
+const double PREEMPTION_TIMEOUT = 30.0;
+const double PREEMPTION_SHARE = 0.5;
+
+// Seconds that slaves stay reserved for a gang request (see
+// ResourceRequest) that isn't complete yet.
+const double GANG_RESERVATION_TIMEOUT = 60.0;
+
+// Maximum number of slaves the packing allocator offers to each
+// framework per allocation pass.
+const size_t PACKING_SLAVES = 10;
+
+// Number of tasks of a framework's typical size that the splitting
+// allocator offers it room for on each slave.
+const size_t SPLIT_OFFER_TASKS = 4;
+
+// Seconds during which the master's HTTP endpoints (e.g.,
+// /state.json) get served from the same snapshot.
+const double HTTP_SNAPSHOT_INTERVAL = 1.0;
+
 // Minimum number of cpus / task.
 const int32_t MIN_CPUS = 1;
 
@@ -50,6 +124,23 @@ const double SLAVE_PONG_TIMEOUT = 15.0;
 // Maximum number of timeouts until slave is considered failed.
 const int MAX_SLAVE_TIMEOUTS = 5;
 
+// Maximum number of tasks (of re-registering slaves) that get re-added
+// before the master handles its other messages.
+const size_t REREGISTRATION_BATCH_TASKS = 10000;
+
+// Maximum number of status updates in each message the master sends
+// back when a framework reconciles its tasks.
+const int RECONCILIATION_BATCH_UPDATES = 1000;
+
+// Number of events that can be waiting in the master's mailbox
+// before it starts rejecting HTTP requests (at half of it) and
+// dropping registrations (see ProcessBase::limit).
+const size_t MAILBOX_LIMIT = 100000;
+
+// Number of groups the slaves get split into so that the slaves of
+// one group get pinged every SLAVE_PONG_TIMEOUT / SLAVE_PING_BUCKETS.
+const size_t SLAVE_PING_BUCKETS = 15;
+
 // Time to wait for a framework to failover.
 const double FRAMEWORK_FAILOVER_TIMEOUT = 1.0;
 
@@ -61,6 +152,33 @@ const int MAX_COMPLETED_FRAMEWORKS = 100;
 // cache.  TODO(thomasm): Make configurable.
 const int MAX_COMPLETED_TASKS_PER_FRAMEWORK = 500;
 
+// Maximum number of removed slaves remembered so that /state.json can
+// tell clients asking for the changes since some version about them.
+const size_t MAX_REMOVED_SLAVES = 1000;
+
+// Maximum number of removed offers and tasks that the master keeps
+// around to reuse for new ones.
+const size_t MAX_POOLED_OFFERS = 10000;
+const size_t MAX_POOLED_TASKS = 10000;
+
+// Seconds to wait for writes to (and recovering) the replicated log
+// of the master's state.
+const double STATE_LOG_TIMEOUT = 5.0;
+
+// Number of changes written to the replicated log of the master's
+// state after which the state gets snapshotted (and the log
+// truncated).
+const size_t STATE_LOG_SNAPSHOT_INTERVAL = 1000;
+
+// Seconds between catching up with the replicated log of the
+// master's state while not the elected master.
+const double STATE_LOG_TAIL_INTERVAL = 1.0;
+
+// Maximum number of messages per second logged by each of the log
+// statements about individual tasks, offers and status updates (see
+// LOG_RATE_LIMITED).
+const int TASK_LOG_RATE = 100;
+
 } // namespace mesos {
 } // namespace internal {
 } // namespace master {
@@ -0,0 +1,428 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <glog/logging.h>
+
+#include <algorithm>
+
+#include <process/clock.hpp>
+
+#include "master/drf_allocator.hpp"
+
+using process::Clock;
+
+using std::make_pair;
+using std::max;
+using std::pair;
+using std::string;
+using std::vector;
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+namespace {
+
+// Returns the number of values in some ranges.
+double count(const Value::Ranges& ranges)
+{
+  double count = 0;
+  foreach (const Value::Range& range, ranges.range()) {
+    count += range.end() - range.begin() + 1;
+  }
+  return count;
+}
+
+
+// Returns the amount of a resource, i.e., its scalar value or the
+// number of values in its ranges or set.
+double amount(const Resource& resource)
+{
+  if (resource.type() == Value::SCALAR) {
+    return resource.scalar().value();
+  } else if (resource.type() == Value::RANGES) {
+    return count(resource.ranges());
+  } else if (resource.type() == Value::SET) {
+    return resource.set().item_size();
+  }
+
+  return 0;
+}
+
+
+double weight(Framework* framework)
+{
+  return framework->info.weight() > 0 ? framework->info.weight() : 1.0;
+}
+
+
+void add(vector<double>* left, const vector<double>& right)
+{
+  left->resize(max(left->size(), right.size()), 0);
+  for (size_t i = 0; i < right.size(); i++) {
+    (*left)[i] += right[i];
+  }
+}
+
+
+void subtract(vector<double>* left, const vector<double>& right)
+{
+  left->resize(max(left->size(), right.size()), 0);
+  for (size_t i = 0; i < right.size(); i++) {
+    (*left)[i] -= right[i];
+  }
+}
+
+} // namespace {
+
+
+void DRFAllocator::frameworkAdded(Framework* framework)
+{
+  frameworks[framework->id] = framework;
+  dirtied.insert(framework);
+  SimpleAllocator::frameworkAdded(framework);
+}
+
+
+void DRFAllocator::frameworkRemoved(Framework* framework)
+{
+  if (shares.contains(framework)) {
+    const string& name = framework->info.group();
+
+    Group& group = groups[name];
+    group.ordering.erase(Share(shares[framework], framework));
+    subtract(&group.used, used[framework]);
+
+    if (group.ordering.empty()) {
+      ordering.erase(GroupShare(group.share, name));
+      groups.erase(name);
+    } else {
+      update(name);
+    }
+
+    shares.erase(framework);
+    used.erase(framework);
+  }
+
+  dirtied.erase(framework);
+  frameworks.erase(framework->id);
+  starving.erase(framework);
+
+  SimpleAllocator::frameworkRemoved(framework);
+}
+
+
+void DRFAllocator::slaveAdded(Slave* slave)
+{
+  rebuild = true; // The total resources are changing.
+  SimpleAllocator::slaveAdded(slave);
+}
+
+
+void DRFAllocator::slaveRemoved(Slave* slave)
+{
+  rebuild = true; // The total resources are changing.
+  SimpleAllocator::slaveRemoved(slave);
+}
+
+
+void DRFAllocator::resourcesUnused(
+    const FrameworkID& frameworkId,
+    const SlaveID& slaveId,
+    const Resources& resources,
+    const Option<Filters>& filters)
+{
+  dirty(frameworkId);
+  SimpleAllocator::resourcesUnused(frameworkId, slaveId, resources, filters);
+}
+
+
+void DRFAllocator::resourcesRecovered(
+    const FrameworkID& frameworkId,
+    const SlaveID& slaveId,
+    const Resources& resources)
+{
+  dirty(frameworkId);
+  SimpleAllocator::resourcesRecovered(frameworkId, slaveId, resources);
+}
+
+
+void DRFAllocator::timerTick()
+{
+  SimpleAllocator::timerTick();
+  preempt();
+}
+
+
+vector<Framework*> DRFAllocator::getAllocationOrdering()
+{
+  CHECK(initialized) << "Cannot get allocation ordering before initialization!";
+
+  if (rebuild) {
+    VLOG(1) << "Recomputing the shares of all " << frameworks.size()
+            << " frameworks since the total resources changed";
+
+    ordering.clear();
+
+    if (recount()) {
+      groups.clear();
+      shares.clear();
+      used.clear();
+      dirtied.clear();
+
+      foreachvalue (Framework* framework, frameworks) {
+        update(framework);
+      }
+    } else {
+      // Only the amounts in the total changed, so the shares can be
+      // recomputed from the amounts the frameworks were allocated.
+      foreachvalue (Group& group, groups) {
+        group.ordering.clear();
+      }
+
+      foreachpair (Framework* framework, double& value, shares) {
+        value = share(used[framework]) / weight(framework);
+        groups[framework->info.group()].ordering.insert(
+            Share(value, framework));
+      }
+
+      foreachpair (const string& name, Group& group, groups) {
+        group.share = share(group.used);
+        ordering.insert(GroupShare(group.share, name));
+      }
+    }
+
+    rebuild = false;
+  }
+
+  foreach (Framework* framework, dirtied) {
+    update(framework);
+  }
+
+  dirtied.clear();
+
+  vector<Framework*> result;
+  result.reserve(shares.size());
+
+  foreach (const GroupShare& group, ordering) {
+    foreach (const Share& share, groups[group.group].ordering) {
+      if (share.framework->active) {
+        result.push_back(share.framework);
+      }
+    }
+  }
+
+  return result;
+}
+
+
+void DRFAllocator::makeOffers(
+    Framework* framework,
+    const hashmap<Slave*, Resources>& offerable)
+{
+  SimpleAllocator::makeOffers(framework, offerable);
+
+  // N.B. We don't update the ordering until the next allocation since
+  // the current allocation is still iterating over it.
+  dirtied.insert(framework);
+}
+
+
+void DRFAllocator::preempt()
+{
+  if (preemptionTimeout <= 0) {
+    return;
+  }
+
+  const vector<Framework*>& ordering = getAllocationOrdering();
+
+  // Since the shares are weighted, every framework's fair share is
+  // one over the sum of the weights.
+  double weights = 0;
+  foreach (Framework* framework, ordering) {
+    weights += weight(framework);
+  }
+
+  const double fair = weights > 0 ? 1.0 / weights : 0;
+  const double now = Clock::now();
+
+  hashmap<Framework*, double> starved;
+  Framework* starvedLongest = NULL;
+
+  foreach (Framework* framework, ordering) {
+    if (shares[framework] < PREEMPTION_SHARE * fair &&
+        framework->offers.empty()) {
+      starved[framework] =
+        starving.contains(framework) ? starving[framework] : now;
+      if (now - starved[framework] >= preemptionTimeout &&
+          (starvedLongest == NULL ||
+           starved[framework] < starved[starvedLongest])) {
+        starvedLongest = framework;
+      }
+    }
+  }
+
+  starving = starved;
+
+  if (starvedLongest == NULL) {
+    return;
+  }
+
+  // Preempt from the frameworks above their fair share, starting with
+  // any offers they're sitting on.
+  vector<Framework*> victims;
+  Framework* furthest = NULL;
+  foreach (Framework* framework, ordering) {
+    if (shares[framework] > fair) {
+      victims.push_back(framework);
+      if (furthest == NULL || shares[framework] > shares[furthest]) {
+        furthest = framework;
+      }
+    }
+  }
+
+  // The rescinded resources get filtered for the framework that had
+  // them (for as long as the preemption timeout), so that they don't
+  // just get offered right back to it.
+  bool rescinded = false;
+  foreach (Framework* framework, victims) {
+    if (!framework->offers.empty()) {
+      LOG(INFO) << "Rescinding the offers of framework " << framework->id
+                << " (with a share of " << shares[framework]
+                << ") for starved framework " << starvedLongest->id;
+
+      foreach (Offer* offer, framework->offers) {
+        offerFilters.add(framework->id,
+                         offer->slave_id(),
+                         offer->resources(),
+                         now + preemptionTimeout);
+      }
+
+      master->rescindOffers(framework);
+      rescinded = true;
+    }
+  }
+
+  if (!rescinded && preemptTasks &&
+      furthest != NULL && !furthest->tasks.empty()) {
+    Task* task = furthest->tasks.begin()->second;
+    LOG(INFO) << "Preempting task " << task->task_id()
+              << " of framework " << furthest->id
+              << " (with a share of " << shares[furthest]
+              << ") for starved framework " << starvedLongest->id;
+    master->preemptTask(task);
+  }
+}
+
+
+void DRFAllocator::dirty(const FrameworkID& frameworkId)
+{
+  if (frameworks.contains(frameworkId)) {
+    dirtied.insert(frameworks[frameworkId]);
+  }
+}
+
+
+void DRFAllocator::update(Framework* framework)
+{
+  const string& name = framework->info.group();
+
+  Group& group = groups[name];
+
+  if (shares.contains(framework)) {
+    group.ordering.erase(Share(shares[framework], framework));
+    subtract(&group.used, used[framework]);
+  }
+
+  used[framework] = amounts(framework->resources);
+  shares[framework] = share(used[framework]) / weight(framework);
+
+  group.ordering.insert(Share(shares[framework], framework));
+  add(&group.used, used[framework]);
+
+  update(name);
+}
+
+
+void DRFAllocator::update(const string& name)
+{
+  Group& group = groups[name];
+
+  ordering.erase(GroupShare(group.share, name));
+
+  group.share = share(group.used);
+
+  ordering.insert(GroupShare(group.share, name));
+}
+
+
+bool DRFAllocator::recount()
+{
+  vector<pair<string, Value::Type> > resources;
+
+  totals.clear();
+
+  foreach (const Resource& resource, totalResources) {
+    resources.push_back(make_pair(resource.name(), resource.type()));
+    totals.push_back(amount(resource));
+  }
+
+  if (resources != columns) {
+    columns = resources;
+    return true;
+  }
+
+  return false;
+}
+
+
+vector<double> DRFAllocator::amounts(const Resources& resources) const
+{
+  vector<double> result(columns.size(), 0);
+
+  foreach (const Resource& resource, resources) {
+    for (size_t i = 0; i < columns.size(); i++) {
+      if (columns[i].second == resource.type() &&
+          columns[i].first == resource.name()) {
+        result[i] = amount(resource);
+        break;
+      }
+    }
+  }
+
+  return result;
+}
+
+
+double DRFAllocator::share(const vector<double>& used) const
+{
+  double share = 0;
+
+  for (size_t i = 0; i < totals.size() && i < used.size(); i++) {
+    if (totals[i] > 0) {
+      share = max(share, used[i] / totals[i]);
+    }
+  }
+
+  return share;
+}
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
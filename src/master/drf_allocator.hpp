@@ -0,0 +1,233 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DRF_ALLOCATOR_HPP__
+#define __DRF_ALLOCATOR_HPP__
+
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/flathashmap.hpp"
+#include "common/hashmap.hpp"
+#include "common/hashset.hpp"
+
+#include "master/simple_allocator.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// A dominant resource fairness allocator that (unlike the
+// SimpleAllocator) doesn't sort all of the frameworks for every
+// allocation. Instead it keeps the frameworks ordered by their
+// (cached) dominant shares and only recomputes the shares of the
+// frameworks whose resources have changed since the last allocation
+// (or all of them if the total resources in the cluster changed).
+//
+// Frameworks are allocated hierarchically: the groups of frameworks
+// (see FrameworkInfo) are ordered by the dominant share of all of
+// their frameworks and the frameworks in each group are ordered by
+// their dominant shares divided by their weights. Ranges (e.g.,
+// ports) and sets count towards the dominant share too.
+//
+// The amounts of each resource that frameworks (and groups) have
+// been allocated are kept as vectors of doubles aligned with the
+// amounts in the total, so that when only the total changes (e.g., a
+// slave was added or removed) all of the shares can be recomputed
+// without looking at any of the frameworks' resources again.
+//
+// Frameworks that are starved (see PREEMPTION_TIMEOUT) get resources
+// preempted for them: every timer tick the outstanding offers of the
+// frameworks above their fair share get rescinded and, if there are
+// none and 'preemptTasks' is set, a task of the framework furthest
+// above its fair share gets killed. A 'preemptionTimeout' of 0
+// disables preemption.
+class DRFAllocator : public SimpleAllocator
+{
+public:
+  DRFAllocator(double _preemptionTimeout = PREEMPTION_TIMEOUT,
+               bool _preemptTasks = false)
+    : rebuild(false),
+      preemptionTimeout(_preemptionTimeout),
+      preemptTasks(_preemptTasks) {}
+
+  virtual ~DRFAllocator() {}
+
+  virtual void frameworkAdded(Framework* framework);
+
+  virtual void frameworkRemoved(Framework* framework);
+
+  virtual void slaveAdded(Slave* slave);
+
+  virtual void slaveRemoved(Slave* slave);
+
+  virtual void resourcesUnused(
+    const FrameworkID& frameworkId,
+    const SlaveID& slaveId,
+    const Resources& resources,
+    const Option<Filters>& filters);
+
+  virtual void resourcesRecovered(
+    const FrameworkID& frameworkId,
+    const SlaveID& slaveId,
+    const Resources& resources);
+
+  virtual void timerTick();
+
+protected:
+  virtual std::vector<Framework*> getAllocationOrdering();
+
+  virtual void makeOffers(Framework* framework,
+                          const hashmap<Slave*, Resources>& offerable);
+
+private:
+  // Entry in the ordering of a group, sorted by (weighted) share and
+  // then by framework id so that the ordering is deterministic for
+  // unit testing.
+  struct Share
+  {
+    Share(double _share, Framework* _framework)
+      : share(_share), framework(_framework) {}
+
+    bool operator < (const Share& that) const
+    {
+      if (share == that.share) {
+        return framework->id.value() < that.framework->id.value();
+      }
+      return share < that.share;
+    }
+
+    double share;
+    Framework* framework;
+  };
+
+  // Entry in the ordering of the groups, sorted likewise.
+  struct GroupShare
+  {
+    GroupShare(double _share, const std::string& _group)
+      : share(_share), group(_group) {}
+
+    bool operator < (const GroupShare& that) const
+    {
+      if (share == that.share) {
+        return group < that.group;
+      }
+      return share < that.share;
+    }
+
+    double share;
+    std::string group;
+  };
+
+  struct Group
+  {
+    Group() : share(0) {}
+
+    double share;
+
+    // Amounts allocated to all of the group's frameworks (as of when
+    // each framework's share was last computed).
+    std::vector<double> used;
+
+    // Frameworks of the group ordered by their weighted shares.
+    std::set<Share> ordering;
+  };
+
+  // Marks the framework with the specified id (if we know it) as
+  // needing its share recomputed.
+  void dirty(const FrameworkID& frameworkId);
+
+  // Recomputes the share of the specified framework (and its place
+  // in the ordering) and the share of its group.
+  void update(Framework* framework);
+
+  // Recomputes the share of the specified group (and its place in
+  // the ordering).
+  void update(const std::string& group);
+
+  // Preempts resources for the frameworks that have been starved for
+  // longer than the preemption timeout, if any.
+  void preempt();
+
+  // Recomputes the amounts in the total, returning true if the
+  // resources in the total changed (i.e., the allocated amounts
+  // need to be recomputed too) and false if only their amounts did.
+  bool recount();
+
+  // Returns the amounts of the resources in the total that are in
+  // the specified resources.
+  std::vector<double> amounts(const Resources& resources) const;
+
+  // Returns the dominant share of the allocated amounts, i.e., the
+  // maximum share of any amount in the total.
+  double share(const std::vector<double>& used) const;
+
+  // Resources (name and type) in the total and their amounts, i.e.,
+  // the scalar values or the number of values in ranges and sets.
+  std::vector<std::pair<std::string, Value::Type> > columns;
+  std::vector<double> totals;
+
+  // All of the frameworks that have been added (and not removed),
+  // whether or not they are active.
+  flathashmap<FrameworkID, Framework*> frameworks;
+
+  // Groups ordered by their dominant shares, and the groups.
+  std::set<GroupShare> ordering;
+  hashmap<std::string, Group> groups;
+
+  // The current (weighted) share of each framework and the amounts
+  // it was computed for (i.e., how to find the framework in the
+  // ordering of its group and what it contributes to the group).
+  hashmap<Framework*, double> shares;
+  hashmap<Framework*, std::vector<double> > used;
+
+  // Frameworks whose resources have changed since their shares were
+  // last computed.
+  hashset<Framework*> dirtied;
+
+  // True if the total resources have changed since the shares were
+  // last computed (in which case all of them need to be recomputed).
+  bool rebuild;
+
+  const double preemptionTimeout;
+  const bool preemptTasks;
+
+  // Frameworks that are starved (below PREEMPTION_SHARE of their fair
+  // share without any offers) and since when.
+  hashmap<Framework*, double> starving;
+};
+
+
+// A DRF allocator that kills tasks when rescinding offers doesn't
+// free up anything for a starved framework.
+class PreemptiveDRFAllocator : public DRFAllocator
+{
+public:
+  PreemptiveDRFAllocator() : DRFAllocator(PREEMPTION_TIMEOUT, true) {}
+
+  virtual ~PreemptiveDRFAllocator() {}
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __DRF_ALLOCATOR_HPP__
@@ -20,21 +20,33 @@
 #include <sstream>
 #include <string>
 
+#include <process/dispatch.hpp>
+
 #include "common/build.hpp"
 #include "common/foreach.hpp"
 #include "common/json.hpp"
 #include "common/resources.hpp"
+#include "common/option.hpp"
+#include "common/statistics.hpp"
+#include "common/strings.hpp"
+#include "common/try.hpp"
 #include "common/type_utils.hpp"
 #include "common/utils.hpp"
 
 #include "master/http.hpp"
 #include "master/master.hpp"
 
+using process::Clock;
 using process::Future;
+using process::HttpBadRequestResponse;
+using process::HttpNotFoundResponse;
+using process::HttpServiceUnavailableResponse;
 using process::HttpResponse;
 using process::HttpRequest;
+using process::PID;
 
 using std::string;
+using std::vector;
 
 
 namespace mesos {
@@ -45,112 +57,361 @@ namespace master {
 // that it can be shared between slave/http.cpp and master/http.cpp.
 
 
-// Returns a JSON object modeled on a Resources.
-JSON::Object model(const Resources& resources)
+// N.B. The state of a big cluster can be tens of MB, so rather than
+// being modeled as a JSON::Object (and then rendered) it gets written
+// straight into the response body using a JSON::Writer.
+
+
+// Writes a JSON object modeled on a Resources.
+void write(JSON::Writer* writer, const Resources& resources)
 {
   // TODO(benh): Add all of the resources.
   Value::Scalar none;
   Value::Scalar cpus = resources.get("cpus", none);
   Value::Scalar mem = resources.get("mem", none);
 
-  JSON::Object object;
-  object.values["cpus"] = cpus.value();
-  object.values["mem"] = mem.value();
+  writer->beginObject();
+  writer->field("cpus", cpus.value());
+  writer->field("mem", mem.value());
+  writer->endObject();
+}
+
 
-  return object;
+// Writes a JSON object modeled on a Task.
+void write(JSON::Writer* writer, const Task& task)
+{
+  writer->beginObject();
+  writer->field("id", task.task_id().value());
+  writer->field("name", task.name());
+  writer->field("framework_id", task.framework_id().value());
+  writer->field("slave_id", task.slave_id().value());
+  writer->field("state", TaskState_Name(task.state()));
+  writer->key("resources");
+  write(writer, Resources(task.resources()));
+  writer->endObject();
 }
 
 
-// Returns a JSON object modeled on a Task.
-JSON::Object model(const Task& task)
+// Writes a JSON object modeled on an Offer.
+void write(JSON::Writer* writer, const Offer& offer)
 {
-  JSON::Object object;
-  object.values["id"] = task.task_id().value();
-  object.values["name"] = task.name();
-  object.values["framework_id"] = task.framework_id().value();
-  object.values["slave_id"] = task.slave_id().value();
-  object.values["state"] = TaskState_Name(task.state());
-  object.values["resources"] = model(task.resources());
-  return object;
+  writer->beginObject();
+  writer->field("id", offer.id().value());
+  writer->field("framework_id", offer.framework_id().value());
+  writer->field("slave_id", offer.slave_id().value());
+  writer->key("resources");
+  write(writer, Resources(offer.resources()));
+  writer->endObject();
 }
 
 
-// Returns a JSON object modeled on an Offer.
-JSON::Object model(const Offer& offer)
+// Writes a JSON object modeled on a Framework.
+void write(JSON::Writer* writer, const Framework& framework)
 {
-  JSON::Object object;
-  object.values["id"] = offer.id().value();
-  object.values["framework_id"] = offer.framework_id().value();
-  object.values["slave_id"] = offer.slave_id().value();
-  object.values["resources"] = model(offer.resources());
-  return object;
+  writer->beginObject();
+  writer->field("id", framework.id.value());
+  writer->field("name", framework.info.name());
+  writer->field("user", framework.info.user());
+  writer->field("executor_uri", framework.info.executor().uri());
+  writer->field("registered_time", framework.registeredTime);
+  writer->field("unregistered_time", framework.unregisteredTime);
+  writer->field("reregistered_time", framework.reregisteredTime);
+  writer->field("active", framework.active);
+  writer->key("resources");
+  write(writer, framework.resources);
+
+  // Write all of the tasks associated with a framework.
+  writer->key("tasks");
+  writer->beginArray();
+  foreachvalue (Task* task, framework.tasks) {
+    write(writer, *task);
+  }
+  writer->endArray();
+
+  // Write all of the completed tasks of a framework, starting with
+  // the oldest task (see TaskArchive).
+  writer->key("completed_tasks");
+  writer->beginArray();
+  foreach (const Task& task, framework.completedTasks.tasks()) {
+    write(writer, task);
+  }
+  writer->endArray();
+
+  // Write all of the offers associated with a framework.
+  writer->key("offers");
+  writer->beginArray();
+  foreach (Offer* offer, framework.offers) {
+    write(writer, *offer);
+  }
+  writer->endArray();
+
+  writer->endObject();
 }
 
 
-// Returns a JSON object modeled on a Framework.
-JSON::Object model(const Framework& framework)
+// Writes a JSON object modeled after a Slave.
+void write(JSON::Writer* writer, const Slave& slave)
 {
-  JSON::Object object;
-  object.values["id"] = framework.id.value();
-  object.values["name"] = framework.info.name();
-  object.values["user"] = framework.info.user();
-  object.values["executor_uri"] = framework.info.executor().uri();
-  object.values["registered_time"] = framework.registeredTime;
-  object.values["unregistered_time"] = framework.unregisteredTime;
-  object.values["reregistered_time"] = framework.reregisteredTime;
-  object.values["active"] = framework.active;
-  object.values["resources"] = model(framework.resources);
-
-  // Model all of the tasks associated with a framework.
-  {
-    JSON::Array array;
-    foreachvalue (Task* task, framework.tasks) {
-      array.values.push_back(model(*task));
+  writer->beginObject();
+  writer->field("id", slave.id.value());
+  writer->field("hostname", slave.info.hostname());
+  writer->field("pid", string(slave.pid));
+  writer->field("webui_hostname", slave.info.webui_hostname());
+  writer->field("webui_port", slave.info.webui_port());
+  writer->field("registered_time", slave.registeredTime);
+  writer->key("resources");
+  write(writer, Resources(slave.info.resources()));
+
+  // Resources the executors actually used (as last reported).
+  typedef hashmap<ExecutorID, ExecutorUsage> ExecutorUsages;
+
+  double cpus = 0.0;
+  double mem = 0.0;
+  foreachvalue (const ExecutorUsages& executors, slave.usage) {
+    foreachvalue (const ExecutorUsage& usage, executors) {
+      cpus += usage.cpus();
+      mem += usage.mem();
     }
+  }
+
+  writer->key("usage");
+  writer->beginObject();
+  writer->field("cpus", cpus);
+  writer->field("mem", mem);
+  writer->endObject();
+
+  // Resources offered as revocable (see Slave::slackFree).
+  writer->key("slack");
+  write(writer, slave.slack);
+
+  writer->endObject();
+}
+
 
-    object.values["tasks"] = array;
+// Writes a JSON object with (estimates of) the memory used for a
+// framework, returning the total (see http::json::memory).
+size_t account(JSON::Writer* writer, const Framework& framework)
+{
+  typedef hashmap<ExecutorID, ExecutorInfo> ExecutorInfos;
+
+  size_t taskBytes = 0;
+  foreachvalue (Task* task, framework.tasks) {
+    taskBytes += task->SpaceUsed();
   }
 
-  // Model all of the completed tasks of a framework.
-  {
-    JSON::Array array;
-    foreach (const Task& task, framework.completedTasks) {
-      array.values.push_back(model(task));
-    }
+  size_t offerBytes = 0;
+  foreach (Offer* offer, framework.offers) {
+    offerBytes += offer->SpaceUsed();
+  }
 
-    object.values["completed_tasks"] = array;
+  size_t queuedBytes = 0;
+  foreach (const TaskDescription& task, framework.queued) {
+    queuedBytes += task.SpaceUsed();
   }
 
-  // Model all of the offers associated with a framework.
-  {
-    JSON::Array array;
-    foreach (Offer* offer, framework.offers) {
-      array.values.push_back(model(*offer));
+  size_t executors = 0;
+  size_t executorBytes = 0;
+  foreachvalue (const ExecutorInfos& infos, framework.executors) {
+    foreachvalue (const ExecutorInfo& info, infos) {
+      executors++;
+      executorBytes += info.SpaceUsed();
     }
+  }
 
-    object.values["offers"] = array;
+  const size_t infoBytes = framework.info.SpaceUsed();
+  const size_t completedBytes = framework.completedTasks.bytes();
+
+  const size_t total = infoBytes + taskBytes + offerBytes + queuedBytes +
+    executorBytes + completedBytes;
+
+  writer->beginObject();
+  writer->field("id", framework.id.value());
+  writer->field("name", framework.info.name());
+  writer->field("active", framework.active);
+  writer->field("info_bytes", infoBytes);
+  writer->field("tasks", framework.tasks.size());
+  writer->field("task_bytes", taskBytes);
+  writer->field("offers", framework.offers.size());
+  writer->field("offer_bytes", offerBytes);
+  writer->field("queued_tasks", framework.queued.size());
+  writer->field("queued_task_bytes", queuedBytes);
+  writer->field("executors", executors);
+  writer->field("executor_bytes", executorBytes);
+  writer->field("completed_tasks", framework.completedTasks.size());
+  writer->field("completed_task_bytes", completedBytes);
+  writer->field("total_bytes", total);
+  writer->endObject();
+
+  return total;
+}
+
+
+// Helpers for reading the JSON of a request (see json::tasks). Each
+// returns an error naming what's missing or malformed.
+
+// Returns the member of the object, or NULL if it isn't there or
+// isn't of type T.
+template <typename T>
+const T* member(const JSON::Object& object, const string& name)
+{
+  std::map<string, JSON::Value>::const_iterator iterator =
+    object.values.find(name);
+  return iterator != object.values.end()
+    ? boost::get<T>(&iterator->second)
+    : NULL;
+}
+
+
+// Reads resources written either like on the command line (e.g.,
+// "cpus:1;mem:128") or as an object of scalars.
+Try<Resources> read(const JSON::Value& value)
+{
+  if (const JSON::String* text = boost::get<JSON::String>(&value)) {
+    return Resources::parse(text->value);
+  }
+
+  const JSON::Object* object = boost::get<JSON::Object>(&value);
+  if (object == NULL) {
+    return Try<Resources>::error("Expecting resources");
   }
 
-  return object;
+  Resources resources;
+  foreachpair (const string& name, const JSON::Value& scalar,
+               object->values) {
+    const JSON::Number* number = boost::get<JSON::Number>(&scalar);
+    if (number == NULL) {
+      return Try<Resources>::error("Expecting a number for '" + name + "'");
+    }
+    Resource resource;
+    resource.set_name(name);
+    resource.set_type(Value::SCALAR);
+    resource.mutable_scalar()->set_value(number->value);
+    resources += resource;
+  }
+  return resources;
 }
 
 
-// Returns a JSON object modeled after a Slave.
-JSON::Object model(const Slave& slave)
+// Reads a task (whose slave is required unless the task gets queued).
+Try<TaskDescription> read(const JSON::Value& value, bool queued)
 {
-  JSON::Object object;
-  object.values["id"] = slave.id.value();
-  object.values["hostname"] = slave.info.hostname();
-  object.values["webui_hostname"] = slave.info.webui_hostname();
-  object.values["webui_port"] = slave.info.webui_port();
-  object.values["registered_time"] = slave.registeredTime;
-  object.values["resources"] = model(slave.info.resources());
-  return object;
+  const JSON::Object* object = boost::get<JSON::Object>(&value);
+  if (object == NULL) {
+    return Try<TaskDescription>::error("Expecting a task");
+  }
+
+  const JSON::String* taskId = member<JSON::String>(*object, "task_id");
+  const JSON::String* name = member<JSON::String>(*object, "name");
+  const JSON::String* slaveId = member<JSON::String>(*object, "slave_id");
+
+  if (taskId == NULL || name == NULL || (slaveId == NULL && !queued)) {
+    return Try<TaskDescription>::error(
+        queued ? "Expecting a 'task_id' and 'name' for each task"
+               : "Expecting a 'task_id', 'name' and 'slave_id' for each task");
+  }
+
+  TaskDescription task;
+  task.set_name(name->value);
+  task.mutable_task_id()->set_value(taskId->value);
+  task.mutable_slave_id()->set_value(slaveId != NULL ? slaveId->value : "");
+
+  if (object->values.count("resources") > 0) {
+    Try<Resources> resources = read(object->values.find("resources")->second);
+    if (resources.isError()) {
+      return Try<TaskDescription>::error(resources.error());
+    }
+    task.mutable_resources()->MergeFrom(resources.get());
+  }
+
+  if (const JSON::String* data = member<JSON::String>(*object, "data")) {
+    task.set_data(data->value);
+  }
+
+  if (object->values.count("executor") > 0) {
+    const JSON::Object* executor =
+      member<JSON::Object>(*object, "executor");
+    const JSON::String* executorId = executor != NULL
+      ? member<JSON::String>(*executor, "executor_id")
+      : NULL;
+    const JSON::String* uri = executor != NULL
+      ? member<JSON::String>(*executor, "uri")
+      : NULL;
+
+    if (executorId == NULL || uri == NULL) {
+      return Try<TaskDescription>::error(
+          "Expecting an 'executor_id' and 'uri' for each executor");
+    }
+
+    ExecutorInfo* info = task.mutable_executor();
+    info->mutable_executor_id()->set_value(executorId->value);
+    info->set_uri(uri->value);
+
+    if (const JSON::String* data = member<JSON::String>(*executor, "data")) {
+      info->set_data(data->value);
+    }
+  }
+
+  return task;
 }
 
 
 namespace http {
 
+Snapshots::Snapshots(const PID<Master>& _master, double _interval)
+  : master(_master), interval(_interval) {}
+
+
+void Snapshots::add(const string& endpoint, const Renderer& renderer)
+{
+  renderers[endpoint] = renderer;
+}
+
+
+Future<HttpResponse> Snapshots::get(
+    const string& endpoint,
+    const HttpRequest& request)
+{
+  if (!renderers.contains(endpoint)) {
+    return HttpNotFoundResponse();
+  }
+
+  // Requests with a query (e.g., /state.json?since=...) get rendered
+  // on their own.
+  if (!request.query.empty()) {
+    return dispatch(master, &Master::snapshot, renderers[endpoint], request);
+  }
+
+  // Reuse the snapshot if it's still being rendered or recent enough
+  // (unless rendering it failed).
+  if (snapshots.contains(endpoint)) {
+    const Snapshot& snapshot = snapshots[endpoint];
+    if (snapshot.response.isPending() ||
+        (snapshot.response.isReady() &&
+         Clock::now() < snapshot.time + interval)) {
+      return snapshot.response;
+    }
+  }
+
+  Snapshot snapshot;
+  snapshot.time = Clock::now();
+  snapshot.response = dispatch(master, &Master::snapshot,
+                               renderers[endpoint], request);
+
+  snapshots[endpoint] = snapshot;
+
+  return snapshot.response;
+}
+
+
+Future<HttpResponse> snapshot(
+    const PID<Snapshots>& snapshots,
+    const string& endpoint,
+    const HttpRequest& request)
+{
+  return dispatch(snapshots, &Snapshots::get, endpoint, request);
+}
+
+
 Future<HttpResponse> vars(
     const Master& master,
     const HttpRequest& request)
@@ -190,6 +451,8 @@ Future<HttpResponse> stats(
 {
   LOG(INFO) << "HTTP request for '" << request.path << "'";
 
+  const internal::Statistics& statistics = master.stats;
+
   JSON::Object object;
   object.values["uptime"] = Clock::now() - master.startTime;
   object.values["elected"] = master.elected; // Note: using int not bool.
@@ -197,13 +460,15 @@ Future<HttpResponse> stats(
   object.values["active_schedulers"] = master.getActiveFrameworks().size();
   object.values["activated_slaves"] = master.slaveHostnamePorts.size();
   object.values["connected_slaves"] = master.slaves.size();
-  object.values["started_tasks"] = master.stats.tasks[TASK_STARTING];
-  object.values["finished_tasks"] = master.stats.tasks[TASK_FINISHED];
-  object.values["killed_tasks"] = master.stats.tasks[TASK_KILLED];
-  object.values["failed_tasks"] = master.stats.tasks[TASK_FAILED];
-  object.values["lost_tasks"] = master.stats.tasks[TASK_LOST];
-  object.values["valid_status_updates"] = master.stats.validStatusUpdates;
-  object.values["invalid_status_updates"] = master.stats.invalidStatusUpdates;
+  object.values["started_tasks"] = statistics.tasks[TASK_STARTING]->value();
+  object.values["finished_tasks"] = statistics.tasks[TASK_FINISHED]->value();
+  object.values["killed_tasks"] = statistics.tasks[TASK_KILLED]->value();
+  object.values["failed_tasks"] = statistics.tasks[TASK_FAILED]->value();
+  object.values["lost_tasks"] = statistics.tasks[TASK_LOST]->value();
+  object.values["valid_status_updates"] =
+    statistics.validStatusUpdates.value();
+  object.values["invalid_status_updates"] =
+    statistics.invalidStatusUpdates.value();
 
   // Get total and used (note, not offered) resources in order to
   // compute capacity of scalar resources.
@@ -240,58 +505,390 @@ Future<HttpResponse> stats(
 }
 
 
+Future<HttpResponse> handlers(
+    const Master& master,
+    const HttpRequest& request)
+{
+  LOG(INFO) << "HTTP request for '" << request.path << "'";
+
+  std::ostringstream out;
+
+  JSON::render(out, internal::model(master.statistics()));
+
+  HttpOKResponse response;
+  response.headers["Content-Type"] = "application/json";
+  response.headers["Content-Length"] = utils::stringify(out.str().size());
+  response.body = out.str().data();
+  return response;
+}
+
+
+Future<HttpResponse> resources(
+    const Master& master,
+    const HttpRequest& request)
+{
+  LOG(INFO) << "HTTP request for '" << request.path << "'";
+
+  Resources total;
+  Resources offered;
+  Resources used;
+  Resources free;
+
+  const std::vector<Slave*>& slaves = master.getActiveSlaves();
+
+  foreach (Slave* slave, slaves) {
+    total += slave->info.resources();
+    offered += slave->resourcesOffered;
+    used += slave->resourcesInUse;
+    free += slave->resourcesFree();
+  }
+
+  HttpOKResponse response;
+  response.headers["Content-Type"] = "application/json";
+
+  JSON::Writer writer(&response.body);
+
+  writer.beginObject();
+  writer.field("id", master.info.id());
+  writer.field("pid", string(master.self()));
+  writer.field("slaves", slaves.size());
+  writer.key("total");
+  write(&writer, total);
+  writer.key("offered");
+  write(&writer, offered);
+  writer.key("used");
+  write(&writer, used);
+  writer.key("free");
+  write(&writer, free);
+  writer.endObject();
+
+  response.headers["Content-Length"] = utils::stringify(response.body.size());
+  return response;
+}
+
+
 Future<HttpResponse> state(
     const Master& master,
     const HttpRequest& request)
 {
   LOG(INFO) << "HTTP request for '" << request.path << "'";
 
-  JSON::Object object;
-  object.values["build_date"] = build::DATE;
-  object.values["build_user"] = build::USER;
-  object.values["start_time"] = master.startTime;
-  object.values["id"] = master.info.id();
-  object.values["pid"] = string(master.self());
-
-  // Model all of the slaves.
-  {
-    JSON::Array array;
-    foreachvalue (Slave* slave, master.slaves) {
-      array.values.push_back(model(*slave));
+  // With '?since=<version>' only what changed since that version of
+  // the state gets written (unless the master doesn't know anymore,
+  // in which case everything does): the frameworks and slaves that
+  // changed, the frameworks that completed and the removed slaves.
+  // N.B. Versions are per master (see "id").
+  Option<uint64_t> since = Option<uint64_t>::none();
+
+  std::map<string, std::vector<string> > pairs =
+    strings::pairs(request.query, '&', '=');
+
+  if (pairs.count("since") > 0) {
+    Try<uint64_t> version = utils::numify<uint64_t>(pairs["since"].back());
+    if (version.isError()) {
+      return HttpBadRequestResponse();
+    }
+
+    if (version.get() >= master.oldestStateVersion &&
+        version.get() <= master.stateVersion) {
+      since = Option<uint64_t>::some(version.get());
+    }
+  }
+
+  HttpOKResponse response;
+  response.headers["Content-Type"] = "application/json";
+
+  // Lets clients that poll with 'If-None-Match' get a '304 Not
+  // Modified' (without a body) while nothing changes.
+  response.headers["ETag"] = "\"" + master.info.id() + "-" +
+    utils::stringify(master.stateVersion) + "\"";
+
+  JSON::Writer writer(&response.body);
+
+  writer.beginObject();
+  writer.field("build_date", build::DATE);
+  writer.field("build_user", build::USER);
+  writer.field("start_time", master.startTime);
+  writer.field("id", master.info.id());
+  writer.field("pid", string(master.self()));
+  writer.field("version", master.stateVersion);
+
+  if (since.isSome()) {
+    writer.field("since", since.get());
+  }
+
+  // Write all of the (changed) slaves.
+  writer.key("slaves");
+  writer.beginArray();
+  foreachvalue (Slave* slave, master.slaves) {
+    if (since.isNone() || slave->modified > since.get()) {
+      write(&writer, *slave);
+    }
+  }
+  writer.endArray();
+
+  // Write all of the (changed) frameworks.
+  writer.key("frameworks");
+  writer.beginArray();
+  foreachvalue (Framework* framework, master.frameworks) {
+    if (since.isNone() || framework->modified > since.get()) {
+      write(&writer, *framework);
+    }
+  }
+  writer.endArray();
+
+  // Write all of the (newly) completed frameworks.
+  writer.key("completed_frameworks");
+  writer.beginArray();
+  foreach (const Framework& framework, master.completedFrameworks) {
+    if (since.isNone() || framework.modified > since.get()) {
+      write(&writer, framework);
+    }
+  }
+  writer.endArray();
+
+  if (since.isSome()) {
+    typedef std::pair<uint64_t, SlaveID> RemovedSlave;
+
+    writer.key("removed_slaves");
+    writer.beginArray();
+    foreach (const RemovedSlave& removed, master.removedSlaves) {
+      if (removed.first > since.get()) {
+        writer.value(removed.second.value());
+      }
+    }
+    writer.endArray();
+  }
+
+  writer.endObject();
+
+  response.headers["Content-Length"] = utils::stringify(response.body.size());
+  return response;
+}
+
+
+
+Future<HttpResponse> memory(
+    const Master& master,
+    const HttpRequest& request)
+{
+  LOG(INFO) << "HTTP request for '" << request.path << "'";
+
+  HttpOKResponse response;
+  response.headers["Content-Type"] = "application/json";
+
+  JSON::Writer writer(&response.body);
+
+  size_t total = 0;
+
+  writer.beginObject();
+  writer.field("id", master.info.id());
+  writer.field("pid", string(master.self()));
+
+  writer.key("frameworks");
+  writer.beginArray();
+  foreachvalue (Framework* framework, master.frameworks) {
+    total += account(&writer, *framework);
+  }
+  writer.endArray();
+
+  writer.key("completed_frameworks");
+  writer.beginArray();
+  foreach (const Framework& framework, master.completedFrameworks) {
+    total += account(&writer, framework);
+  }
+  writer.endArray();
+
+  writer.field("total_bytes", total);
+  writer.endObject();
+
+  response.headers["Content-Length"] = utils::stringify(response.body.size());
+  return response;
+}
+
+
+// Returns a '400 Bad Request' explaining what's wrong.
+HttpResponse badRequest(const string& error)
+{
+  LOG(WARNING) << "Bad HTTP request for tasks: " << error;
+
+  HttpBadRequestResponse response;
+  response.headers["Content-Type"] = "text/plain";
+  response.headers["Content-Length"] = utils::stringify(error.size());
+  response.body = error;
+  return response;
+}
+
+
+Future<HttpResponse> tasks(
+    Master& master,
+    const HttpRequest& request)
+{
+  LOG(INFO) << "HTTP request for '" << request.path << "'";
+
+  if (request.method != "POST") {
+    return badRequest("Expecting a POST");
+  }
+
+  if (!master.elected) {
+    return HttpServiceUnavailableResponse();
+  }
+
+  Try<JSON::Value> parsed = JSON::parse(request.body);
+  if (parsed.isError()) {
+    return badRequest("Failed to parse the body: " + parsed.error());
+  }
+
+  const JSON::Value& body = parsed.get();
+  const JSON::Object* object = boost::get<JSON::Object>(&body);
+  if (object == NULL) {
+    return badRequest("Expecting an object");
+  }
+
+  const JSON::String* id = member<JSON::String>(*object, "framework_id");
+  if (id == NULL) {
+    return badRequest("Expecting a 'framework_id'");
+  }
+
+  FrameworkID frameworkId;
+  frameworkId.set_value(id->value);
+
+  if (master.getFramework(frameworkId) == NULL) {
+    HttpNotFoundResponse response;
+    response.body = "Framework " + id->value + " is not registered";
+    response.headers["Content-Type"] = "text/plain";
+    response.headers["Content-Length"] =
+      utils::stringify(response.body.size());
+    return response;
+  }
+
+  Filters filters;
+  if (object->values.count("filters") > 0) {
+    const JSON::Object* filter = member<JSON::Object>(*object, "filters");
+    const JSON::Number* refuse = filter != NULL
+      ? member<JSON::Number>(*filter, "refuse_seconds")
+      : NULL;
+    if (refuse == NULL) {
+      return badRequest("Expecting 'refuse_seconds' in the 'filters'");
     }
+    filters.set_refuse_seconds(refuse->value);
+  }
 
-    object.values["slaves"] = array;
+  // Read (and check) everything before doing any of it, so that a bad
+  // request doesn't get done in part.
+  LaunchTasksBatchMessage launches;
+  launches.mutable_framework_id()->MergeFrom(frameworkId);
+  launches.mutable_filters()->MergeFrom(filters);
+
+  size_t launched = 0;
+
+  if (object->values.count("launches") > 0) {
+    const JSON::Array* array = member<JSON::Array>(*object, "launches");
+    if (array == NULL) {
+      return badRequest("Expecting an array of 'launches'");
+    }
+
+    foreach (const JSON::Value& value, array->values) {
+      const JSON::Object* launch = boost::get<JSON::Object>(&value);
+      const JSON::String* offerId = launch != NULL
+        ? member<JSON::String>(*launch, "offer_id")
+        : NULL;
+      const JSON::Array* tasks = launch != NULL
+        ? member<JSON::Array>(*launch, "tasks")
+        : NULL;
+
+      if (offerId == NULL || tasks == NULL) {
+        return badRequest(
+            "Expecting an 'offer_id' and 'tasks' for each launch");
+      }
+
+      LaunchTasksBatchMessage::Launch* message = launches.add_launches();
+      message->mutable_offer_id()->set_value(offerId->value);
+
+      // Offers that are gone get their tasks lost (like when a driver
+      // launches them), but someone else's offer is a bad request.
+      Offer* offer = master.getOffer(message->offer_id());
+      if (offer != NULL && !(offer->framework_id() == frameworkId)) {
+        return badRequest("Offer " + offerId->value + " is not for framework " +
+                          id->value);
+      }
+
+      foreach (const JSON::Value& value, tasks->values) {
+        Try<TaskDescription> task = read(value, false);
+        if (task.isError()) {
+          return badRequest(task.error());
+        }
+        message->add_tasks()->MergeFrom(task.get());
+        launched++;
+      }
+    }
   }
 
-  // Model all of the frameworks.
-  {
-    JSON::Array array;
-    foreachvalue (Framework* framework, master.frameworks) {
-      array.values.push_back(model(*framework));
+  vector<OfferID> declines;
+
+  if (object->values.count("declines") > 0) {
+    const JSON::Array* array = member<JSON::Array>(*object, "declines");
+    if (array == NULL) {
+      return badRequest("Expecting an array of 'declines'");
     }
 
-    object.values["frameworks"] = array;
+    foreach (const JSON::Value& value, array->values) {
+      const JSON::String* offerId = boost::get<JSON::String>(&value);
+      if (offerId == NULL) {
+        return badRequest("Expecting offer ids to decline");
+      }
+      OfferID declined;
+      declined.set_value(offerId->value);
+      declines.push_back(declined);
+    }
   }
 
-  // Model all of the completed frameworks.
-  {
-    JSON::Array array;
+  vector<TaskDescription> queued;
 
-    foreach (const Framework& framework, master.completedFrameworks) {
-      array.values.push_back(model(framework));
+  if (object->values.count("queue") > 0) {
+    const JSON::Array* array = member<JSON::Array>(*object, "queue");
+    if (array == NULL) {
+      return badRequest("Expecting an array of tasks to 'queue'");
     }
 
-    object.values["completed_frameworks"] = array;
+    foreach (const JSON::Value& value, array->values) {
+      Try<TaskDescription> task = read(value, true);
+      if (task.isError()) {
+        return badRequest(task.error());
+      }
+      queued.push_back(task.get());
+    }
   }
 
-  std::ostringstream out;
+  // Now do it all just like when a driver sends the messages (the
+  // framework finds out what became of its tasks from their status
+  // updates).
+  if (launches.launches_size() > 0) {
+    master.launchTasksBatch(launches);
+  }
 
-  JSON::render(out, object);
+  if (!declines.empty()) {
+    master.declineOffers(frameworkId, declines, filters);
+  }
+
+  if (!queued.empty()) {
+    master.queueTasks(frameworkId, queued);
+  }
 
   HttpOKResponse response;
   response.headers["Content-Type"] = "application/json";
-  response.headers["Content-Length"] = utils::stringify(out.str().size());
-  response.body = out.str().data();
+
+  JSON::Writer writer(&response.body);
+
+  writer.beginObject();
+  writer.field("framework_id", id->value);
+  writer.field("offers", launches.launches_size());
+  writer.field("launched", launched);
+  writer.field("declined", declines.size());
+  writer.field("queued", queued.size());
+  writer.endObject();
+
+  response.headers["Content-Length"] = utils::stringify(response.body.size());
   return response;
 }
 
@@ -19,8 +19,15 @@
 #ifndef __MASTER_HTTP_HPP__
 #define __MASTER_HTTP_HPP__
 
+#include <string>
+
+#include <tr1/functional>
+
 #include <process/future.hpp>
 #include <process/http.hpp>
+#include <process/process.hpp>
+
+#include "common/hashmap.hpp"
 
 namespace mesos {
 namespace internal {
@@ -31,6 +38,58 @@ class Master;
 
 namespace http {
 
+// Serves the master's (expensive) HTTP endpoints from snapshots, so
+// that however many clients poll them the master renders each of
+// them at most once every 'interval' seconds. Requests that come in
+// while a snapshot is being rendered get that snapshot, and copying
+// the (possibly big) responses happens here rather than on the
+// master. N.B. Requests with a query (which might change what gets
+// rendered) are never served from (or turned into) snapshots.
+class Snapshots : public process::Process<Snapshots>
+{
+public:
+  // Renders an endpoint (invoked by the master, see Master::snapshot).
+  typedef std::tr1::function<
+    process::Future<process::HttpResponse>(const process::HttpRequest&)>
+  Renderer;
+
+  Snapshots(const process::PID<Master>& master, double interval);
+
+  virtual ~Snapshots() {}
+
+  // Adds an endpoint (must be invoked before getting spawned).
+  void add(const std::string& endpoint, const Renderer& renderer);
+
+  // Returns the latest snapshot of an endpoint, rendering a new one
+  // if it's older than the interval.
+  process::Future<process::HttpResponse> get(
+      const std::string& endpoint,
+      const process::HttpRequest& request);
+
+private:
+  struct Snapshot
+  {
+    Snapshot() : time(0) {}
+    double time; // When it was requested to be rendered.
+    process::Future<process::HttpResponse> response;
+  };
+
+  const process::PID<Master> master;
+  const double interval;
+
+  hashmap<std::string, Renderer> renderers;
+  hashmap<std::string, Snapshot> snapshots;
+};
+
+
+// Returns an endpoint from its snapshots (see Snapshots::get); used
+// as the master's handler for the endpoint.
+process::Future<process::HttpResponse> snapshot(
+    const process::PID<Snapshots>& snapshots,
+    const std::string& endpoint,
+    const process::HttpRequest& request);
+
+
 // Returns current vars in "key value\n" format (keys do not contain
 // spaces, values may contain spaces but are ended by a newline).
 process::Future<process::HttpResponse> vars(
@@ -46,11 +105,65 @@ process::Future<process::HttpResponse> stats(
     const process::HttpRequest& request);
 
 
+// Returns statistics about the messages (and other events) handled
+// by the master, by message name.
+process::Future<process::HttpResponse> handlers(
+    const Master& master,
+    const process::HttpRequest& request);
+
+
+// Returns a summary of the resources of the master's (active)
+// slaves: their total, offered, used and free resources and how many
+// there are. This is all that a master managing a part of a bigger
+// cluster would need to report to a parent master allocating the
+// cluster as a whole, and it's much cheaper to render (and poll)
+// than the state.
+process::Future<process::HttpResponse> resources(
+    const Master& master,
+    const process::HttpRequest& request);
+
+
 // Returns current state of the cluster that the master knows about.
 process::Future<process::HttpResponse> state(
     const Master& master,
     const process::HttpRequest& request);
 
+
+// Returns (estimates of) how much memory the master uses for each
+// framework, active or completed: for its tasks, offers, queued
+// tasks, executors and completed tasks. The estimates are of the
+// protobufs (see Message::SpaceUsed), not of the master's
+// bookkeeping around them.
+process::Future<process::HttpResponse> memory(
+    const Master& master,
+    const process::HttpRequest& request);
+
+
+// Launches tasks on offers, declines offers and queues tasks for a
+// registered framework, just like its scheduler driver would, given
+// a POST of a JSON object like:
+//
+//   {"framework_id": "...",
+//    "filters": {"refuse_seconds": 5},
+//    "launches": [{"offer_id": "...", "tasks": [<task>, ...]}, ...],
+//    "declines": ["<offer id>", ...],
+//    "queue": [<task>, ...]}
+//
+// where each task is like:
+//
+//   {"task_id": "...", "name": "...", "slave_id": "...",
+//    "resources": "cpus:1;mem:128" (or {"cpus": 1, "mem": 128}),
+//    "data": "...", "executor": {"executor_id": "...", "uri": "..."}}
+//
+// and everything but the framework id is optional (as is the slave
+// id of queued tasks). The framework's scheduler gets the offers
+// (which state.json includes too) and the status updates of the tasks
+// as usual. The response says how many of each were submitted, or
+// what's wrong with the request (in which case nothing was done).
+process::Future<process::HttpResponse> tasks(
+    Master& master,
+    const process::HttpRequest& request);
+
 } // namespace json {
 } // namespace http {
 } // namespace master {
@@ -0,0 +1,699 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <glog/logging.h>
+
+#include <list>
+#include <set>
+#include <vector>
+
+#include <process/dispatch.hpp>
+#include <process/timer.hpp>
+
+#include "common/fatal.hpp"
+#include "common/foreach.hpp"
+#include "common/type_utils.hpp"
+
+#include "master/constants.hpp"
+#include "master/log_storage.hpp"
+
+using std::list;
+using std::map;
+using std::pair;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+LogStorage::LogStorage(int quorum,
+                       const string& path,
+                       const string& servers,
+                       const string& znode)
+  : writer(NULL),
+    error(Option<string>::none()),
+    promoted(false),
+    appended(0)
+{
+  if (servers.empty()) {
+    log = new log::Log(quorum, path, set<UPID>());
+  } else {
+    log = new log::Log(quorum, path, servers, seconds(10.0), znode);
+  }
+}
+
+
+LogStorage::~LogStorage()
+{
+  // Fail any changes that never got committed.
+  while (!pending.empty()) {
+    pending.front().second->set(false);
+    delete pending.front().second;
+    pending.pop_front();
+  }
+
+  delete writer;
+  delete log;
+}
+
+
+void LogStorage::registerOptions(Configurator* configurator)
+{
+  configurator->addOption<string>(
+      "state_dir",
+      "Directory for this master's replica of the replicated log\n"
+      "that the master's state gets persisted in (the state doesn't\n"
+      "get persisted if not set)");
+
+  configurator->addOption<int>(
+      "state_quorum",
+      "Number of replicas of the replicated log of the master's\n"
+      "state that must have each change",
+      1);
+
+  configurator->addOption<string>(
+      "state_zk",
+      "ZooKeeper URL (zoo://servers/znode) of the group of replicas\n"
+      "of the replicated log of the master's state (if not set\n"
+      "this master's replica is the only one)");
+}
+
+
+LogStorage* LogStorage::create(const Configuration& conf)
+{
+  const string& path = conf.get<string>("state_dir", "");
+
+  if (path.empty()) {
+    return NULL;
+  }
+
+  const int quorum = conf.get<int>("state_quorum", 1);
+
+  const string& url = conf.get<string>("state_zk", "");
+
+  if (url.empty()) {
+    return new LogStorage(quorum, path);
+  }
+
+  // Check if 'url' starts with "zoo://".
+  string zoo = "zoo://";
+  if (url.find(zoo) != 0) {
+    fatal("Expecting a ZooKeeper URL for option 'state_zk'");
+  }
+
+  string temp = url.substr(zoo.size());
+  size_t index = temp.find("/");
+  if (index == string::npos) {
+    fatal("Expecting znode path for option 'state_zk'");
+  }
+
+  return new LogStorage(quorum, path, temp.substr(0, index),
+                        temp.substr(index));
+}
+
+
+void LogStorage::initialize()
+{
+  // Keep a warm copy of the state from the start (in case we get
+  // promoted, see LogStorage::promote).
+  tail();
+}
+
+
+void LogStorage::promote()
+{
+  if (!promoted) {
+    LOG(INFO) << "Promoting the storage of the master's state";
+    promoted = true;
+    if (!recover()) {
+      LOG(ERROR) << "Failed to recover the master's state: " << error.get();
+    }
+  }
+}
+
+
+Result<MasterState> LogStorage::state()
+{
+  if (promoted && writer == NULL && !recover()) {
+    return Result<MasterState>::error(error.get());
+  }
+
+  MasterState state;
+  CHECK(state.ParseFromString(snapshot()));
+  return state;
+}
+
+
+Future<bool> LogStorage::write(const MasterStateEntry& entry)
+{
+  Promise<bool>* promise = new Promise<bool>();
+
+  pending.push_back(std::make_pair(entry, promise));
+
+  // Only the first change since the last commit triggers a commit,
+  // so the changes written while a commit is outstanding (which are
+  // waiting in our queue until it's done) get committed together.
+  if (pending.size() == 1) {
+    dispatch(self(), &LogStorage::commit);
+  }
+
+  return promise->future();
+}
+
+
+Future<bool> LogStorage::writeBatch(const vector<MasterStateEntry>& entries)
+{
+  if (entries.empty()) {
+    return true;
+  }
+
+  Promise<bool>* promise = new Promise<bool>();
+
+  // The changes get queued together (and hence committed together),
+  // with only the last one carrying the promise.
+  for (size_t i = 0; i < entries.size(); i++) {
+    pending.push_back(
+        std::make_pair(entries[i], i + 1 == entries.size() ? promise : NULL));
+  }
+
+  if (pending.size() == entries.size()) {
+    dispatch(self(), &LogStorage::commit);
+  }
+
+  return promise->future();
+}
+
+
+void LogStorage::commit()
+{
+  std::deque<pair<MasterStateEntry, Promise<bool>*> > changes;
+  std::swap(changes, pending);
+
+  bool written = false;
+
+  if (!promoted) {
+    LOG(ERROR) << "Failed to write " << changes.size()
+               << " changes of the master's state: not promoted";
+  } else if (writer != NULL || recover()) {
+    // The changes get written as a single entry of the log so that
+    // either all of them get committed or none of them do.
+    MasterStateEntry entry;
+
+    typedef pair<MasterStateEntry, Promise<bool>*> Change;
+    if (changes.size() == 1) {
+      entry.MergeFrom(changes.front().first);
+    } else {
+      entry.set_type(MasterStateEntry::BATCH);
+      foreach (const Change& change, changes) {
+        entry.add_batch()->MergeFrom(change.first);
+      }
+    }
+
+    string data;
+    CHECK(entry.SerializeToString(&data));
+
+    Result<log::Log::Position> position =
+      writer->append(data, seconds(STATE_LOG_TIMEOUT));
+
+    if (position.isSome()) {
+      apply(entry);
+      appended += changes.size();
+      replayed = position.get();
+      written = true;
+    } else {
+      LOG(ERROR) << "Failed to write " << changes.size()
+                 << " changes of the master's state: "
+                 << (position.isError() ? position.error() : "timed out");
+
+      // The changes might still get committed (e.g., after timing
+      // out), which we pick up by replaying the log again before the
+      // next commit (which also requires a new writer after an
+      // error). Changes are idempotent, so it's fine if the caller
+      // writes them again.
+      delete writer;
+      writer = NULL;
+    }
+  } else {
+    LOG(ERROR) << "Failed to write " << changes.size()
+               << " changes of the master's state: " << error.get();
+  }
+
+  while (!changes.empty()) {
+    if (changes.front().second != NULL) {
+      changes.front().second->set(written);
+      delete changes.front().second;
+    }
+    changes.pop_front();
+  }
+
+  // Snapshot the state (truncating the log) once enough changes have
+  // been written since the last snapshot. N.B. We don't use
+  // Log::Writer::snapshots since the state only includes the changes
+  // once they've been written.
+  if (written && appended >= STATE_LOG_SNAPSHOT_INTERVAL) {
+    Result<log::Log::Position> position =
+      writer->snapshot(snapshot(), seconds(STATE_LOG_TIMEOUT));
+
+    if (position.isSome()) {
+      appended = 0;
+      replayed = position.get();
+    } else {
+      LOG(WARNING) << "Failed to snapshot the master's state: "
+                   << (position.isError() ? position.error() : "timed out");
+      if (position.isError()) {
+        delete writer;
+        writer = NULL;
+      }
+    }
+  }
+}
+
+
+void LogStorage::apply(const MasterStateEntry& entry)
+{
+  switch (entry.type()) {
+    case MasterStateEntry::ADD_SLAVE: {
+      CHECK(entry.has_slave());
+      const string& hostname = entry.slave().hostname();
+      uint16_t port = entry.slave().port();
+      if (!active.contains(hostname, port)) {
+        active.put(hostname, port);
+      }
+      break;
+    }
+
+    case MasterStateEntry::REMOVE_SLAVE: {
+      CHECK(entry.has_slave());
+      active.remove(entry.slave().hostname(), entry.slave().port());
+      inactive.remove(entry.slave().hostname(), entry.slave().port());
+      break;
+    }
+
+    case MasterStateEntry::ACTIVATE_SLAVE: {
+      CHECK(entry.has_slave());
+      const string& hostname = entry.slave().hostname();
+      uint16_t port = entry.slave().port();
+      inactive.remove(hostname, port);
+      if (!active.contains(hostname, port)) {
+        active.put(hostname, port);
+      }
+      break;
+    }
+
+    case MasterStateEntry::DEACTIVATE_SLAVE: {
+      CHECK(entry.has_slave());
+      const string& hostname = entry.slave().hostname();
+      uint16_t port = entry.slave().port();
+      active.remove(hostname, port);
+      if (!inactive.contains(hostname, port)) {
+        inactive.put(hostname, port);
+      }
+      break;
+    }
+
+    case MasterStateEntry::ADD_FRAMEWORK: {
+      CHECK(entry.has_framework());
+      CHECK(entry.framework().has_info());
+      frameworks[entry.framework().id()] = entry.framework().info();
+      break;
+    }
+
+    case MasterStateEntry::REMOVE_FRAMEWORK: {
+      CHECK(entry.has_framework());
+      frameworks.erase(entry.framework().id());
+      break;
+    }
+
+    case MasterStateEntry::BATCH: {
+      foreach (const MasterStateEntry& change, entry.batch()) {
+        apply(change);
+      }
+      break;
+    }
+
+    default:
+      LOG(FATAL) << "Unknown change of the master's state " << entry.type();
+  }
+}
+
+
+string LogStorage::snapshot()
+{
+  MasterState state;
+
+  foreachpair (const string& hostname, uint16_t port, active) {
+    MasterStateEntry::Slave* slave = state.add_active();
+    slave->set_hostname(hostname);
+    slave->set_port(port);
+  }
+
+  foreachpair (const string& hostname, uint16_t port, inactive) {
+    MasterStateEntry::Slave* slave = state.add_inactive();
+    slave->set_hostname(hostname);
+    slave->set_port(port);
+  }
+
+  foreachpair (const FrameworkID& id, const FrameworkInfo& info, frameworks) {
+    MasterStateEntry::Framework* framework = state.add_frameworks();
+    framework->mutable_id()->MergeFrom(id);
+    framework->mutable_info()->MergeFrom(info);
+  }
+
+  string data;
+  CHECK(state.SerializeToString(&data));
+  return data;
+}
+
+
+void LogStorage::tail()
+{
+  if (promoted) {
+    return;
+  }
+
+  log::Log::Reader reader(log);
+
+  // N.B. Our replica might not have learned the latest positions yet
+  // (or might be missing some altogether, which only get filled in
+  // once we're promoted), in which case we'll just try again.
+  Result<list<log::Log::Entry> > entries = read(reader.ending());
+
+  if (entries.isError()) {
+    VLOG(1) << "Failed to tail the log of the master's state: "
+            << entries.error();
+  }
+
+  delay(STATE_LOG_TAIL_INTERVAL, self(), &LogStorage::tail);
+}
+
+
+bool LogStorage::recover()
+{
+  CHECK(promoted);
+  CHECK(writer == NULL);
+
+  writer = new log::Log::Writer(log, seconds(STATE_LOG_TIMEOUT));
+
+  // Replay the rest of the log, up to its ending as of when our
+  // writer got elected (which fills in any positions our replica
+  // was missing).
+  Result<log::Log::Position> ending =
+    writer->ending(seconds(STATE_LOG_TIMEOUT));
+
+  Result<list<log::Log::Entry> > entries = ending.isSome()
+    ? read(ending.get())
+    : Result<list<log::Log::Entry> >::error(
+        ending.isError() ? ending.error() : "Timed out");
+
+  if (!entries.isSome()) {
+    error = "Failed to read the log: " +
+      (entries.isError() ? entries.error() : string("Timed out"));
+    delete writer;
+    writer = NULL;
+    return false;
+  }
+
+  LOG(INFO) << "Recovered the master's state (" << active.size()
+            << " active slaves, " << inactive.size() << " inactive slaves, "
+            << frameworks.size() << " frameworks) after replaying "
+            << entries.get().size() << " more log entries";
+
+  error = Option<string>::none();
+
+  return true;
+}
+
+
+Result<list<log::Log::Entry> > LogStorage::read(const log::Log::Position& to)
+{
+  log::Log::Reader reader(log);
+
+  const log::Log::Position beginning = reader.beginning();
+
+  // Start over (from the snapshot the log begins with) if the log
+  // has been truncated past what we've replayed, otherwise continue
+  // where we left off (rereading the last position replayed).
+  if (replayed.isNone() || replayed.get() < beginning) {
+    active.clear();
+    inactive.clear();
+    frameworks.clear();
+    appended = 0;
+    replayed = Option<log::Log::Position>::none();
+  }
+
+  const log::Log::Position from =
+    replayed.isSome() ? replayed.get() : beginning;
+
+  if (to < from || (replayed.isSome() && to == from)) {
+    return list<log::Log::Entry>();
+  }
+
+  Result<list<log::Log::Entry> > entries = writer != NULL
+    ? writer->read(from, to, seconds(STATE_LOG_TIMEOUT))
+    : reader.read(from, to, seconds(STATE_LOG_TIMEOUT));
+
+  if (!entries.isSome()) {
+    return entries;
+  }
+
+  foreach (const log::Log::Entry& entry, entries.get()) {
+    if (replayed.isSome() && entry.position <= replayed.get()) {
+      continue;
+    }
+
+    if (entry.snapshot) {
+      MasterState state;
+      if (!state.ParseFromString(entry.data)) {
+        return Result<list<log::Log::Entry> >::error(
+            "Failed to parse a snapshot of the state");
+      }
+
+      active.clear();
+      inactive.clear();
+      frameworks.clear();
+      appended = 0;
+
+      foreach (const MasterStateEntry::Slave& slave, state.active()) {
+        active.put(slave.hostname(), slave.port());
+      }
+
+      foreach (const MasterStateEntry::Slave& slave, state.inactive()) {
+        inactive.put(slave.hostname(), slave.port());
+      }
+
+      foreach (const MasterStateEntry::Framework& framework,
+               state.frameworks()) {
+        frameworks[framework.id()] = framework.info();
+      }
+    } else {
+      MasterStateEntry change;
+      if (!change.ParseFromString(entry.data)) {
+        return Result<list<log::Log::Entry> >::error(
+            "Failed to parse a change of the state");
+      }
+
+      apply(change);
+      appended += change.type() == MasterStateEntry::BATCH
+        ? change.batch_size()
+        : 1;
+    }
+  }
+
+  replayed = to;
+
+  return entries;
+}
+
+
+LogSlavesManagerStorage::LogSlavesManagerStorage(
+    LogStorage* _storage,
+    const PID<SlavesManager>& _slavesManager)
+  : storage(_storage), slavesManager(_slavesManager) {}
+
+
+void LogSlavesManagerStorage::initialize()
+{
+  Future<Result<MasterState> > state = dispatch(storage, &LogStorage::state);
+
+  state.await();
+
+  CHECK(state.isReady());
+
+  if (state.get().isError()) {
+    LOG(ERROR) << "Slaves manager storage failed to recover the slaves: "
+               << state.get().error();
+    return;
+  }
+
+  multihashmap<string, uint16_t> active;
+  multihashmap<string, uint16_t> inactive;
+
+  foreach (const MasterStateEntry::Slave& slave, state.get().get().active()) {
+    active.put(slave.hostname(), slave.port());
+  }
+
+  foreach (const MasterStateEntry::Slave& slave, state.get().get().inactive()) {
+    inactive.put(slave.hostname(), slave.port());
+  }
+
+  dispatch(slavesManager, &SlavesManager::updateActive, active);
+  dispatch(slavesManager, &SlavesManager::updateInactive, inactive);
+}
+
+
+Future<bool> LogSlavesManagerStorage::add(const string& hostname,
+                                          uint16_t port)
+{
+  return write(MasterStateEntry::ADD_SLAVE, hostname, port);
+}
+
+
+Future<bool> LogSlavesManagerStorage::remove(const string& hostname,
+                                             uint16_t port)
+{
+  return write(MasterStateEntry::REMOVE_SLAVE, hostname, port);
+}
+
+
+Future<bool> LogSlavesManagerStorage::activate(const string& hostname,
+                                               uint16_t port)
+{
+  return write(MasterStateEntry::ACTIVATE_SLAVE, hostname, port);
+}
+
+
+Future<bool> LogSlavesManagerStorage::deactivate(const string& hostname,
+                                                 uint16_t port)
+{
+  return write(MasterStateEntry::DEACTIVATE_SLAVE, hostname, port);
+}
+
+
+Future<bool> LogSlavesManagerStorage::write(MasterStateEntry::Type type,
+                                            const string& hostname,
+                                            uint16_t port)
+{
+  MasterStateEntry entry;
+  entry.set_type(type);
+  entry.mutable_slave()->set_hostname(hostname);
+  entry.mutable_slave()->set_port(port);
+
+  return dispatch(storage, &LogStorage::write, entry);
+}
+
+
+Future<bool> LogSlavesManagerStorage::activateAll(
+    const multihashmap<string, uint16_t>& slaves)
+{
+  return write(MasterStateEntry::ACTIVATE_SLAVE, slaves);
+}
+
+
+Future<bool> LogSlavesManagerStorage::deactivateAll(
+    const multihashmap<string, uint16_t>& slaves)
+{
+  return write(MasterStateEntry::DEACTIVATE_SLAVE, slaves);
+}
+
+
+Future<bool> LogSlavesManagerStorage::write(
+    MasterStateEntry::Type type,
+    const multihashmap<string, uint16_t>& slaves)
+{
+  vector<MasterStateEntry> entries;
+
+  foreachpair (const string& hostname, uint16_t port, slaves) {
+    MasterStateEntry entry;
+    entry.set_type(type);
+    entry.mutable_slave()->set_hostname(hostname);
+    entry.mutable_slave()->set_port(port);
+    entries.push_back(entry);
+  }
+
+  return dispatch(storage, &LogStorage::writeBatch, entries);
+}
+
+
+LogFrameworksStorage::LogFrameworksStorage(LogStorage* _storage)
+  : storage(_storage) {}
+
+
+Future<Result<map<FrameworkID, FrameworkInfo> > > LogFrameworksStorage::list()
+{
+  Future<Result<MasterState> > state = dispatch(storage, &LogStorage::state);
+
+  state.await();
+
+  CHECK(state.isReady());
+
+  if (state.get().isError()) {
+    return Result<map<FrameworkID, FrameworkInfo> >::error(
+        state.get().error());
+  }
+
+  map<FrameworkID, FrameworkInfo> frameworks;
+
+  foreach (const MasterStateEntry::Framework& framework,
+           state.get().get().frameworks()) {
+    frameworks[framework.id()] = framework.info();
+  }
+
+  return Result<map<FrameworkID, FrameworkInfo> >::some(frameworks);
+}
+
+
+Future<Result<bool> > LogFrameworksStorage::add(const FrameworkID& id,
+                                                const FrameworkInfo& info)
+{
+  MasterStateEntry entry;
+  entry.set_type(MasterStateEntry::ADD_FRAMEWORK);
+  entry.mutable_framework()->mutable_id()->MergeFrom(id);
+  entry.mutable_framework()->mutable_info()->MergeFrom(info);
+
+  return write(entry);
+}
+
+
+Future<Result<bool> > LogFrameworksStorage::remove(const FrameworkID& id)
+{
+  MasterStateEntry entry;
+  entry.set_type(MasterStateEntry::REMOVE_FRAMEWORK);
+  entry.mutable_framework()->mutable_id()->MergeFrom(id);
+
+  return write(entry);
+}
+
+
+Result<bool> LogFrameworksStorage::write(const MasterStateEntry& entry)
+{
+  Future<bool> written = dispatch(storage, &LogStorage::write, entry);
+
+  written.await();
+
+  if (!written.isReady() || !written.get()) {
+    return Result<bool>::error("Failed to write to the log");
+  }
+
+  return true;
+}
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
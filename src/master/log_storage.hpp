@@ -0,0 +1,204 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MASTER_LOG_STORAGE_HPP__
+#define __MASTER_LOG_STORAGE_HPP__
+
+#include <deque>
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <process/future.hpp>
+#include <process/process.hpp>
+
+#include "common/multihashmap.hpp"
+#include "common/option.hpp"
+#include "common/result.hpp"
+
+#include "configurator/configurator.hpp"
+
+#include "log/log.hpp"
+
+#include "master/frameworks_manager.hpp"
+#include "master/slaves_manager.hpp"
+
+#include "messages/messages.hpp"
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// Persists the master's state (the slaves of the cluster and the
+// registered frameworks) as a sequence of changes in a replicated
+// log, so that a master that fails over can recover the state from
+// its replica rather than relearning it from every slave and
+// framework. The state is kept in memory too and snapshotted to the
+// log every STATE_LOG_SNAPSHOT_INTERVAL changes so that replaying it
+// stays fast. Changes that get written while a write is already
+// outstanding are batched and written to the log together.
+//
+// Only the storage of the elected master (see LogStorage::promote)
+// writes to the log. Until it gets promoted the storage tails the
+// log (as written by the elected master, via our replica), so that
+// a standby master has a warm copy of the state when it gets elected
+// and only needs to replay the last few changes.
+class LogStorage : public Process<LogStorage>
+{
+public:
+  // Creates storage backed by a replica at 'path' and, unless
+  // 'servers' is empty, the other replicas in the ZooKeeper group at
+  // 'znode'. Writes must reach a 'quorum' of the replicas.
+  LogStorage(int quorum,
+             const std::string& path,
+             const std::string& servers = "",
+             const std::string& znode = "");
+
+  virtual ~LogStorage();
+
+  static void registerOptions(Configurator* configurator);
+
+  // Returns the storage as configured, or NULL if the master's state
+  // is not configured to be persisted.
+  static LogStorage* create(const Configuration& conf);
+
+  // Makes this the storage of the elected master, i.e., the only
+  // storage that writes to the log, after catching up with the log.
+  void promote();
+
+  // Returns the state (as of the last change written, or as tailed
+  // so far if not promoted), or an error if the state couldn't be
+  // recovered from the log.
+  Result<MasterState> state();
+
+  // Writes the change to the log, returning whether it was written.
+  Future<bool> write(const MasterStateEntry& entry);
+
+  // Writes the changes to the log together (i.e., either all of them
+  // get written or none of them do), returning whether they were.
+  Future<bool> writeBatch(const std::vector<MasterStateEntry>& entries);
+
+protected:
+  virtual void initialize();
+
+private:
+  // Writes all the changes written since the last commit to the log.
+  void commit();
+
+  // Applies the change to the (in memory) state.
+  void apply(const MasterStateEntry& entry);
+
+  // Returns a snapshot of the (in memory) state.
+  std::string snapshot();
+
+  // Replays the changes that have been written to the log since the
+  // last time, until promoted.
+  void tail();
+
+  // Creates a new writer and replays the rest of the log, returning
+  // false if that failed.
+  bool recover();
+
+  // Applies the entries up to the specified position that haven't
+  // been replayed yet, returning the entries read.
+  Result<std::list<log::Log::Entry> > read(const log::Log::Position& to);
+
+  log::Log* log;
+  log::Log::Writer* writer;
+
+  // Error that prevented recovering the state, if any.
+  Option<std::string> error;
+
+  // Whether this is the storage of the elected master.
+  bool promoted;
+
+  // Last position of the log that the state includes (if any).
+  Option<log::Log::Position> replayed;
+
+  // Changes written since the last snapshot.
+  size_t appended;
+
+  multihashmap<std::string, uint16_t> active;
+  multihashmap<std::string, uint16_t> inactive;
+  std::map<FrameworkID, FrameworkInfo> frameworks;
+
+  // Changes waiting to be committed (with the promise of a batch of
+  // changes on the last of them, and NULL on the others).
+  std::deque<std::pair<MasterStateEntry, Promise<bool>*> > pending;
+};
+
+
+// Slaves manager storage that persists the slaves in a LogStorage.
+class LogSlavesManagerStorage : public SlavesManagerStorage
+{
+public:
+  LogSlavesManagerStorage(LogStorage* _storage,
+                          const PID<SlavesManager>& _slavesManager);
+
+  virtual Future<bool> add(const std::string& hostname, uint16_t port);
+  virtual Future<bool> remove(const std::string& hostname, uint16_t port);
+  virtual Future<bool> activate(const std::string& hostname, uint16_t port);
+  virtual Future<bool> deactivate(const std::string& hostname, uint16_t port);
+  virtual Future<bool> activateAll(
+      const multihashmap<std::string, uint16_t>& slaves);
+  virtual Future<bool> deactivateAll(
+      const multihashmap<std::string, uint16_t>& slaves);
+
+protected:
+  // Tells the slaves manager about the recovered slaves.
+  virtual void initialize();
+
+private:
+  Future<bool> write(MasterStateEntry::Type type,
+                     const std::string& hostname,
+                     uint16_t port);
+
+  Future<bool> write(MasterStateEntry::Type type,
+                     const multihashmap<std::string, uint16_t>& slaves);
+
+  LogStorage* storage;
+  const PID<SlavesManager> slavesManager;
+};
+
+
+// Frameworks storage that persists the frameworks in a LogStorage.
+class LogFrameworksStorage : public FrameworksStorage
+{
+public:
+  LogFrameworksStorage(LogStorage* _storage);
+
+  virtual Future<Result<std::map<FrameworkID, FrameworkInfo> > > list();
+
+  virtual Future<Result<bool> > add(const FrameworkID& id,
+      const FrameworkInfo& info);
+
+  virtual Future<Result<bool> > remove(const FrameworkID& id);
+
+private:
+  Result<bool> write(const MasterStateEntry& entry);
+
+  LogStorage* storage;
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __MASTER_LOG_STORAGE_HPP__
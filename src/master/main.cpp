@@ -27,9 +27,9 @@
 #include "detector/detector.hpp"
 
 #include "master/allocator.hpp"
-#include "master/simple_allocator.hpp"
+#include "master/allocator_factory.hpp"
+#include "master/capture.hpp"
 #include "master/master.hpp"
-#include "master/webui.hpp"
 
 using namespace mesos::internal;
 using namespace mesos::internal::master;
@@ -43,9 +43,12 @@ void usage(const char* progName, const Configurator& configurator)
 {
   cerr << "Usage: " << progName << " [--port=PORT] [--url=URL] [...]" << endl
        << endl
-       << "URL (used for leader election with ZooKeeper) may be one of:" << endl
+       << "URL (used for leader election) may be one of:" << endl
        << "  zoo://host1:port1,host2:port2,..." << endl
        << "  zoofile://file where file has one host:port pair per line" << endl
+       << "  log://host1:port1,host2:port2,.../path where the host:port" << endl
+       << "    pairs are all the masters (each keeps a replica of a" << endl
+       << "    replicated log for the election at path)" << endl
        << endl
        << "Supported options:" << endl
        << configurator.getUsage();
@@ -62,9 +65,13 @@ int main(int argc, char **argv)
   configurator.addOption<int>("port", 'p', "Port to listen on", 5050);
   configurator.addOption<string>("ip", "IP address to listen on");
   configurator.addOption<string>("url", 'u', "URL used for leader election");
-#ifdef MESOS_WEBUI
-  configurator.addOption<int>("webui_port", 'w', "Web UI port", 8080);
-#endif
+  configurator.addOption<string>("allocator", 'a', "Allocator to use "
+                                 "(simple, drf, drf-preemptive, parallel, "
+                                 "async, packing or splitting)",
+                                 "simple");
+  configurator.addOption<string>("capture", "File to capture the messages "
+                                 "sent to the master into (for replaying "
+                                 "them with mesos-replay)");
 
   if (argc == 2 && string("--help") == argv[1]) {
     usage(argv[0], configurator);
@@ -101,19 +108,39 @@ int main(int argc, char **argv)
     fatalerror("Could not chdir into %s", dirname(argv[0]));
   }
 
-  Allocator* allocator = new SimpleAllocator();
+  const string name = conf.get("allocator", "simple");
+
+  Allocator* allocator = AllocatorFactory::instantiate(name, NULL);
+
+  if (allocator == NULL) {
+    fatal("Unknown allocator: %s", name.c_str());
+  }
 
   Master* master = new Master(allocator, conf);
+
+  MessageCapture* capture = NULL;
+  if (conf.contains("capture")) {
+    Try<MessageCapture*> created =
+      MessageCapture::create(master->self(), conf["capture"]);
+    if (created.isError()) {
+      fatal("Failed to capture messages: %s", created.error().c_str());
+    }
+    capture = created.get();
+    process::filter(capture);
+  }
+
   process::spawn(master);
 
   MasterDetector* detector =
     MasterDetector::create(url, master->self(), true, Logging::isQuiet(conf));
 
-#ifdef MESOS_WEBUI
-  webui::start(master->self(), conf);
-#endif
-
   process::wait(master->self());
+
+  if (capture != NULL) {
+    process::filter(NULL);
+    delete capture;
+  }
+
   delete master;
   delete allocator;
 
@@ -28,23 +28,34 @@
 
 #include "common/build.hpp"
 #include "common/date_utils.hpp"
+#include "common/logging.hpp"
+#include "common/memory.hpp"
+#include "common/profiler.hpp"
+#include "common/tracer.hpp"
 #include "common/utils.hpp"
 #include "common/uuid.hpp"
+#include "common/webui.hpp"
 
 #include "master/allocator.hpp"
 #include "master/allocator_factory.hpp"
+#include "master/log_storage.hpp"
 #include "master/master.hpp"
+#include "master/slave_shard.hpp"
 #include "master/slaves_manager.hpp"
 
 namespace params = std::tr1::placeholders;
 
+using google::protobuf::RepeatedPtrField;
+
 using std::list;
+using std::make_pair;
 using std::string;
 using std::vector;
 
 using process::wait; // Necessary on some OS's to disambiguate.
 
 using std::tr1::cref;
+using std::tr1::ref;
 using std::tr1::bind;
 
 
@@ -52,67 +63,6 @@ namespace mesos {
 namespace internal {
 namespace master {
 
-class SlaveObserver : public Process<SlaveObserver>
-{
-public:
-  SlaveObserver(const UPID& _slave,
-                const SlaveInfo& _slaveInfo,
-                const SlaveID& _slaveId,
-                const PID<Master>& _master)
-    : slave(_slave),
-      slaveInfo(_slaveInfo),
-      slaveId(_slaveId),
-      master(_master),
-      timeouts(0),
-      pinged(false)
-  {
-    install("PONG", &SlaveObserver::pong);
-  }
-
-protected:
-  virtual void initialize()
-  {
-    send(slave, "PING");
-    pinged = true;
-    delay(SLAVE_PONG_TIMEOUT, self(), &SlaveObserver::timeout);
-  }
-
-  void pong(const UPID& from, const string& body)
-  {
-    timeouts = 0;
-    pinged = false;
-  }
-
-  void timeout()
-  {
-    if (pinged) { // So we haven't got back a pong yet ...
-      if (++timeouts >= MAX_SLAVE_TIMEOUTS) {
-        deactivate();
-        return;
-      }
-    }
-
-    send(slave, "PING");
-    pinged = true;
-    delay(SLAVE_PONG_TIMEOUT, self(), &SlaveObserver::timeout);
-  }
-
-  void deactivate()
-  {
-    dispatch(master, &Master::deactivatedSlaveHostnamePort,
-             slaveInfo.hostname(), slave.port);
-  }
-
-private:
-  const UPID slave;
-  const SlaveInfo slaveInfo;
-  const SlaveID slaveId;
-  const PID<Master> master;
-  int timeouts;
-  bool pinged;
-};
-
-
 // Performs slave registration asynchronously. There are two means of
 // doing this, one first tries to add this slave to the slaves
 // manager, while the other one simply tells the master to add the
@@ -152,8 +102,8 @@ struct SlaveRegistrar
 struct SlaveReregistrar
 {
   static bool run(Slave* slave,
-                  const vector<ExecutorInfo>& executorInfos,
-                  const vector<Task>& tasks,
+                  const RepeatedPtrField<ExecutorInfo>& executorInfos,
+                  const RepeatedPtrField<Task>& tasks,
                   const PID<Master>& master)
   {
     // TODO(benh): Do a reverse lookup to ensure IP maps to
@@ -162,8 +112,8 @@ struct SlaveReregistrar
   }
 
   static bool run(Slave* slave,
-                  const vector<ExecutorInfo>& executorInfos,
-                  const vector<Task>& tasks,
+                  const RepeatedPtrField<ExecutorInfo>& executorInfos,
+                  const RepeatedPtrField<Task>& tasks,
                   const PID<Master>& master,
                   const PID<SlavesManager>& slavesManager)
   {
@@ -187,15 +137,65 @@ struct SlaveReregistrar
 
 Master::Master(Allocator* _allocator)
   : ProcessBase("master"),
-    allocator(_allocator)
-{}
+    allocator(_allocator),
+    storage(NULL),
+    offerPool(MAX_POOLED_OFFERS),
+    taskPool(MAX_POOLED_TASKS),
+    health(SLAVE_PING_BUCKETS, MAX_SLAVE_TIMEOUTS),
+    stats("master"),
+    offersMade("mesos_master_offers_total", "Offers made."),
+    offersRescinded("mesos_master_offers_rescinded_total",
+                    "Offers rescinded."),
+    offersExpired("mesos_master_offers_expired_total",
+                  "Offers rescinded because they timed out."),
+    offersOutstanding("mesos_master_outstanding_offers",
+                      "Offers made that haven't been used, declined "
+                      "or rescinded yet."),
+    launchLatency("mesos_master_task_launch_seconds",
+                  "Time from launching a task until it left "
+                  "TASK_STARTING.")
+{
+  limit(MAILBOX_LIMIT);
+
+  // Registrations get retried (see doReliableRegistration) so they can
+  // get dropped when the master is overloaded.
+  droppable(RegisterFrameworkMessage().GetTypeName());
+  droppable(ReregisterFrameworkMessage().GetTypeName());
+  droppable(RegisterSlaveMessage().GetTypeName());
+  droppable(ReregisterSlaveMessage().GetTypeName());
+}
 
 
 Master::Master(Allocator* _allocator, const Configuration& conf)
   : ProcessBase("master"),
     allocator(_allocator),
-    conf(conf)
-{}
+    storage(NULL),
+    conf(conf),
+    offerPool(MAX_POOLED_OFFERS),
+    taskPool(MAX_POOLED_TASKS),
+    health(SLAVE_PING_BUCKETS, MAX_SLAVE_TIMEOUTS),
+    stats("master"),
+    offersMade("mesos_master_offers_total", "Offers made."),
+    offersRescinded("mesos_master_offers_rescinded_total",
+                    "Offers rescinded."),
+    offersExpired("mesos_master_offers_expired_total",
+                  "Offers rescinded because they timed out."),
+    offersOutstanding("mesos_master_outstanding_offers",
+                      "Offers made that haven't been used, declined "
+                      "or rescinded yet."),
+    launchLatency("mesos_master_task_launch_seconds",
+                  "Time from launching a task until it left "
+                  "TASK_STARTING.")
+{
+  limit(MAILBOX_LIMIT);
+
+  // Registrations get retried (see doReliableRegistration) so they can
+  // get dropped when the master is overloaded.
+  droppable(RegisterFrameworkMessage().GetTypeName());
+  droppable(ReregisterFrameworkMessage().GetTypeName());
+  droppable(RegisterSlaveMessage().GetTypeName());
+  droppable(ReregisterSlaveMessage().GetTypeName());
+}
 
 
 Master::~Master()
@@ -216,12 +216,30 @@ Master::~Master()
   wait(slavesManager);
 
   delete slavesManager;
+
+  if (storage != NULL) {
+    terminate(storage);
+    wait(storage);
+    delete storage;
+  }
+
+  terminate(snapshots);
+  wait(snapshots);
+
+  delete snapshots;
+
+  foreach (SlaveShard* shard, shards) {
+    terminate(shard);
+    wait(shard);
+    delete shard;
+  }
 }
 
 
 void Master::registerOptions(Configurator* configurator)
 {
   SlavesManager::registerOptions(configurator);
+  LogStorage::registerOptions(configurator);
 
   configurator->addOption<bool>(
       "root_submissions",
@@ -232,6 +250,32 @@ void Master::registerOptions(Configurator* configurator)
       "failover_timeout",
       "Framework failover timeout in seconds",
       FRAMEWORK_FAILOVER_TIMEOUT);
+
+  configurator->addOption<double>(
+      "offer_aggregation_interval",
+      "Seconds during which new offers for a framework get\n"
+      "aggregated into a single message (0 sends each right away)",
+      OFFER_AGGREGATION_INTERVAL);
+
+  configurator->addOption<double>(
+      "offer_timeout",
+      "Seconds after which offers that haven't been used or declined\n"
+      "get rescinded (0 never rescinds them)",
+      OFFER_TIMEOUT);
+
+  configurator->addOption<double>(
+      "http_snapshot_interval",
+      "Seconds during which the HTTP endpoints (e.g., /state.json)\n"
+      "get served from the same snapshot of the master's state\n"
+      "(0 renders them for each request)",
+      HTTP_SNAPSHOT_INTERVAL);
+
+  configurator->addOption<int>(
+      "status_update_shards",
+      "Number of shards (each handled in parallel) the status\n"
+      "updates of the slaves get split into (0 handles them all\n"
+      "on the master itself)",
+      STATUS_UPDATE_SHARDS);
 }
 
 
@@ -261,10 +305,30 @@ vector<Slave*> Master::getActiveSlaves() const
 }
 
 
+size_t Master::countActiveSlaves()
+{
+  size_t count = 0;
+  foreachvalue (Slave* slave, slaves) {
+    if (slave->active) {
+      count++;
+    }
+  }
+  return count;
+}
+
+
 void Master::initialize()
 {
   LOG(INFO) << "Master started at mesos://" << self();
 
+  // The master handles far more messages than any other process (all
+  // status updates, framework and slave messages, etc), so let it
+  // service more of them each time it gets run.
+  batch(256);
+
+  // Export the statistics of malloc (see memory.hpp).
+  memory::initialize();
+
   // The master ID is currently comprised of the current date, the IP
   // address and port from self() and the OS PID.
 
@@ -280,38 +344,49 @@ void Master::initialize()
 
   LOG(INFO) << "Master ID: " << info.id();
 
-  // Setup slave manager.
-  slavesManager = new SlavesManager(conf, self());
+  // Setup the storage of our state (if any) and slave manager.
+  storage = LogStorage::create(conf);
+  if (storage != NULL) {
+    spawn(storage);
+  }
+
+  slavesManager = new SlavesManager(conf, self(), storage);
   spawn(slavesManager);
 
+  // Setup the shards that handle the status updates of the slaves.
+  int count = conf.get<int>("status_update_shards", STATUS_UPDATE_SHARDS);
+  for (int i = 0; i < count; i++) {
+    SlaveShard* shard = new SlaveShard(self(), i);
+    spawn(shard);
+    shards.push_back(shard);
+  }
+
   allocator->initialize(this);
 
   elected = false;
 
+  deferRecovery = false;
+
   nextFrameworkId = 0;
   nextSlaveId = 0;
   nextOfferId = 0;
 
   failoverTimeout = conf.get<int>("failover_timeout", FRAMEWORK_FAILOVER_TIMEOUT);
 
-  // Start all the statistics at 0.
-  CHECK(TASK_STARTING == TaskState_MIN);
-  CHECK(TASK_LOST == TaskState_MAX);
-  stats.tasks[TASK_STARTING] = 0;
-  stats.tasks[TASK_RUNNING] = 0;
-  stats.tasks[TASK_FINISHED] = 0;
-  stats.tasks[TASK_FAILED] = 0;
-  stats.tasks[TASK_KILLED] = 0;
-  stats.tasks[TASK_LOST] = 0;
-  stats.validStatusUpdates = 0;
-  stats.invalidStatusUpdates = 0;
-  stats.validFrameworkMessages = 0;
-  stats.invalidFrameworkMessages = 0;
+  offerAggregationInterval =
+    conf.get<double>("offer_aggregation_interval", OFFER_AGGREGATION_INTERVAL);
+
+  offerTimeout = conf.get<double>("offer_timeout", OFFER_TIMEOUT);
+
+  stateVersion = 0;
+  oldestStateVersion = 0;
 
   startTime = Clock::now();
 
   // Start our timer ticks.
   timerTickTimer = delay(1.0, self(), &Master::timerTick);
+  pingTickTimer = delay(SLAVE_PONG_TIMEOUT / SLAVE_PING_BUCKETS,
+                        self(), &Master::pingTick);
 
   // Install handler functions for certain messages.
   install<SubmitSchedulerRequest>(
@@ -355,6 +430,24 @@ void Master::initialize()
       &LaunchTasksMessage::tasks,
       &LaunchTasksMessage::filters);
 
+  install<LaunchTasksBatchMessage>(&Master::launchTasksBatch);
+
+  install<DeclineOffersMessage>(
+      &Master::declineOffers,
+      &DeclineOffersMessage::framework_id,
+      &DeclineOffersMessage::offer_ids,
+      &DeclineOffersMessage::filters);
+
+  install<QueueTasksMessage>(
+      &Master::queueTasks,
+      &QueueTasksMessage::framework_id,
+      &QueueTasksMessage::tasks);
+
+  install<ReconcileTasksMessage>(
+      &Master::reconcileTasks,
+      &ReconcileTasksMessage::framework_id,
+      &ReconcileTasksMessage::task_ids);
+
   install<ReviveOffersMessage>(
       &Master::reviveOffers,
       &ReviveOffersMessage::framework_id);
@@ -375,12 +468,7 @@ void Master::initialize()
       &Master::registerSlave,
       &RegisterSlaveMessage::slave);
 
-  install<ReregisterSlaveMessage>(
-      &Master::reregisterSlave,
-      &ReregisterSlaveMessage::slave_id,
-      &ReregisterSlaveMessage::slave,
-      &ReregisterSlaveMessage::executor_infos,
-      &ReregisterSlaveMessage::tasks);
+  install<ReregisterSlaveMessage>(&Master::reregisterSlave);
 
   install<UnregisterSlaveMessage>(
       &Master::unregisterSlave,
@@ -391,6 +479,12 @@ void Master::initialize()
       &StatusUpdateMessage::update,
       &StatusUpdateMessage::pid);
 
+  install<StatusUpdatesMessage>(&Master::statusUpdates);
+
+  install<ExecutorUsageMessage>(&Master::executorUsage);
+
+  install<ExecutorMemoryPressureMessage>(&Master::executorMemoryPressure);
+
   install<ExecutorToFrameworkMessage>(
       &Master::executorMessage,
       &ExecutorToFrameworkMessage::slave_id,
@@ -405,10 +499,98 @@ void Master::initialize()
       &ExitedExecutorMessage::executor_id,
       &ExitedExecutorMessage::status);
 
-  // Setup HTTP request handlers.
-  route("vars", bind(&http::vars, cref(*this), params::_1));
-  route("stats.json", bind(&http::json::stats, cref(*this), params::_1));
-  route("state.json", bind(&http::json::state, cref(*this), params::_1));
+  install("PONG", &Master::pong);
+
+  // Setup HTTP request handlers. The ones that walk the master's
+  // state get served from snapshots, by a process of their own, so
+  // that lots of clients polling them don't slow the master down.
+  snapshots = new http::Snapshots(
+      self(),
+      conf.get<double>("http_snapshot_interval", HTTP_SNAPSHOT_INTERVAL));
+
+  snapshots->add("vars", bind(&http::vars, cref(*this), params::_1));
+  snapshots->add("stats.json",
+                 bind(&http::json::stats, cref(*this), params::_1));
+  snapshots->add("state.json",
+                 bind(&http::json::state, cref(*this), params::_1));
+  snapshots->add("resources.json",
+                 bind(&http::json::resources, cref(*this), params::_1));
+  snapshots->add("memory.json",
+                 bind(&http::json::memory, cref(*this), params::_1));
+
+  spawn(snapshots);
+
+  route("vars", bind(&http::snapshot, snapshots->self(),
+                     string("vars"), params::_1));
+  route("stats.json", bind(&http::snapshot, snapshots->self(),
+                           string("stats.json"), params::_1));
+  route("stats/handlers",
+        bind(&http::json::handlers, cref(*this), params::_1));
+  route("state.json", bind(&http::snapshot, snapshots->self(),
+                           string("state.json"), params::_1));
+  route("resources.json", bind(&http::snapshot, snapshots->self(),
+                               string("resources.json"), params::_1));
+  route("memory.json", bind(&http::snapshot, snapshots->self(),
+                            string("memory.json"), params::_1));
+
+  // Lets frameworks (e.g., a job submission gateway acting for them)
+  // launch and queue tasks and decline offers over HTTP.
+  route("tasks", bind(&http::json::tasks, ref(*this), params::_1));
+
+  // Serve the webui (whose page renders the endpoints above in the
+  // browser) and the tail of the log.
+  const hashmap<string, HttpResponse>& files = webui::load(conf, "master");
+  foreachpair (const string& name, const HttpResponse& response, files) {
+    route(name, bind(&webui::serve, response, params::_1));
+  }
+
+  route("log", bind(&webui::log, Logging::getLogDir(conf),
+                    string("mesos-master"), params::_1));
+
+  // Profile in place (see profiler.hpp).
+  route("profiler/start", &profiler::start);
+  route("profiler/stop", &profiler::stop);
+  route("heap/snapshot", &profiler::heap);
+
+  // Spans of the task launches traced (see tracer.hpp).
+  route("trace", &tracer::serve);
+}
+
+
+void Master::updateStateVersion()
+{
+  // Everything that changed since the last update gets the same
+  // (new) version.
+  bool changed = false;
+
+  foreachvalue (Framework* framework, frameworks) {
+    if (framework->dirty) {
+      framework->dirty = false;
+      framework->modified = stateVersion + 1;
+      changed = true;
+    }
+  }
+
+  foreachvalue (Slave* slave, slaves) {
+    if (slave->dirty) {
+      slave->dirty = false;
+      slave->modified = stateVersion + 1;
+      changed = true;
+    }
+  }
+
+  if (changed) {
+    stateVersion++;
+  }
+}
+
+
+Future<HttpResponse> Master::snapshot(
+    const http::Snapshots::Renderer& renderer,
+    const HttpRequest& request)
+{
+  updateStateVersion();
+  return renderer(request);
 }
 
 
@@ -420,6 +602,15 @@ void Master::finalize()
   }
 
   process::timers::cancel(timerTickTimer);
+  process::timers::cancel(pingTickTimer);
+}
+
+
+void Master::visit(const MessageEvent& event)
+{
+  health.heard(event.message->from);
+
+  ProtobufProcess<Master>::visit(event);
 }
 
 
@@ -433,6 +624,8 @@ void Master::exited(const UPID& pid)
 
       // Stop sending offers here for now.
       framework->active = false;
+      framework->dirty = true;
+      allocator->frameworkDeactivated(framework);
 
       // Delay dispatching a message to ourselves for the timeout.
       delay(failoverTimeout, self(),
@@ -441,9 +634,10 @@ void Master::exited(const UPID& pid)
 
       // Remove the framework's offers.
       foreach (Offer* offer, utils::copy(framework->offers)) {
-        allocator->resourcesRecovered(offer->framework_id(),
-                                      offer->slave_id(),
-                                      offer->resources());
+        recoverResources(offer->framework_id(),
+                         offer->slave_id(),
+                         offer->resources(),
+                         offer->revocable());
         removeOffer(offer);
       }
       return;
@@ -452,6 +646,16 @@ void Master::exited(const UPID& pid)
 
   foreachvalue (Slave* slave, slaves) {
     if (slave->pid == pid) {
+      // A slave that checkpoints its state is probably restarting
+      // (its executors keep running), so give it a chance to
+      // re-register. It gets removed if it stops responding to pings
+      // for too long instead.
+      if (slave->info.checkpoint()) {
+        LOG(INFO) << "Slave " << slave->id << " disconnected,"
+                  << " waiting for it to re-register";
+        return;
+      }
+
       LOG(INFO) << "Slave " << slave->id << " disconnected";
       removeSlave(slave);
       return;
@@ -482,6 +686,12 @@ void Master::newMasterDetected(const UPID& pid)
   } else if (master == self() && !elected) {
     LOG(INFO) << "Elected as master!";
     elected = true;
+
+    // Start writing our state (which the storage has been keeping
+    // up to date while we were waiting).
+    if (storage != NULL) {
+      dispatch(storage, &LogStorage::promote);
+    }
   } else if (master != self() && elected) {
     LOG(FATAL) << "No longer elected master ... committing suicide!";
   } else if (master == self() && elected) {
@@ -598,9 +808,10 @@ void Master::reregisterFramework(const FrameworkID& frameworkId,
       // replied to the offers but the driver might have dropped
       // those messages since it wasn't connected to the master.
       foreach (Offer* offer, utils::copy(framework->offers)) {
-        allocator->resourcesRecovered(offer->framework_id(),
-                                      offer->slave_id(),
-                                      offer->resources());
+        recoverResources(offer->framework_id(),
+                         offer->slave_id(),
+                         offer->resources(),
+                         offer->revocable());
         removeOffer(offer);
       }
 
@@ -623,6 +834,10 @@ void Master::reregisterFramework(const FrameworkID& frameworkId,
 
     // Add any running tasks reported by slaves for this framework.
     foreachpair (const SlaveID& slaveId, Slave* slave, slaves) {
+      if (!slave->hasTasks(framework->id)) {
+        continue;
+      }
+
       foreachvalue (Task* task, slave->tasks) {
         if (framework->id == task->framework_id()) {
           framework->addTask(task);
@@ -677,6 +892,8 @@ void Master::deactivateFramework(const FrameworkID& frameworkId)
   if (framework != NULL) {
     if (framework->pid == from) {
       framework->active = false;
+      framework->dirty = true;
+      allocator->frameworkDeactivated(framework);
     } else {
       LOG(WARNING) << from << " tried to deactivate framework; "
         << "expecting " << framework->pid;
@@ -697,7 +914,8 @@ void Master::launchTasks(const FrameworkID& frameworkId,
                          const vector<TaskDescription>& tasks,
                          const Filters& filters)
 {
-  LOG(INFO) << "Received reply for offer " << offerId;
+  LOG_RATE_LIMITED(INFO, TASK_LOG_RATE)
+    << "Received reply for offer " << offerId;
 
   Framework* framework = getFramework(frameworkId);
   if (framework != NULL) {
@@ -726,7 +944,7 @@ void Master::launchTasks(const FrameworkID& frameworkId,
         status->mutable_task_id()->MergeFrom(task.task_id());
         status->set_state(TASK_LOST);
         status->set_message("Task launched with invalid offer");
-        update->set_timestamp(Clock::now());
+        update->set_timestamp(Clock::coarse());
         update->set_uuid(UUID::random().toBytes());
         send(framework->pid, message);
       }
@@ -735,12 +953,160 @@ void Master::launchTasks(const FrameworkID& frameworkId,
 }
 
 
+void Master::launchTasksBatch(const LaunchTasksBatchMessage& message)
+{
+  LOG(INFO) << "Received reply for " << message.launches_size()
+            << " offers from framework " << message.framework_id();
+
+  foreach (const LaunchTasksBatchMessage::Launch& launch,
+           message.launches()) {
+    launchTasks(message.framework_id(),
+                launch.offer_id(),
+                vector<TaskDescription>(launch.tasks().begin(),
+                                        launch.tasks().end()),
+                message.filters());
+  }
+}
+
+
+void Master::declineOffers(const FrameworkID& frameworkId,
+                           const vector<OfferID>& offerIds,
+                           const Filters& filters)
+{
+  Framework* framework = getFramework(frameworkId);
+  if (framework != NULL) {
+    LOG(INFO) << "Framework " << frameworkId
+              << " declined " << offerIds.size() << " offers";
+
+    foreach (const OfferID& offerId, offerIds) {
+      // Offers that are gone (e.g., rescinded) have nothing to return.
+      Offer* offer = getOffer(offerId);
+      if (offer != NULL && offer->framework_id() == frameworkId) {
+        Slave* slave = getSlave(offer->slave_id());
+        CHECK(slave != NULL) << "An offer should not outlive a slave!";
+        processTasks(offer, framework, slave,
+                     vector<TaskDescription>(), filters);
+      }
+    }
+  }
+}
+
+
+void Master::queueTasks(const FrameworkID& frameworkId,
+                        const vector<TaskDescription>& tasks)
+{
+  Framework* framework = getFramework(frameworkId);
+  if (framework != NULL) {
+    LOG(INFO) << "Framework " << frameworkId
+              << " queued " << tasks.size() << " tasks";
+
+    foreach (const TaskDescription& task, tasks) {
+      framework->queued.push_back(task);
+    }
+
+    allocator->tasksQueued(framework);
+  }
+}
+
+
+// Returns an update (from the master) of the current state of a task.
+static StatusUpdate createStatusUpdate(const FrameworkID& frameworkId,
+                                       const TaskID& taskId,
+                                       TaskState state,
+                                       const string& message = "")
+{
+  StatusUpdate update;
+  update.mutable_framework_id()->MergeFrom(frameworkId);
+  TaskStatus* status = update.mutable_status();
+  status->mutable_task_id()->MergeFrom(taskId);
+  status->set_state(state);
+  if (message != "") {
+    status->set_message(message);
+  }
+  update.set_timestamp(Clock::coarse());
+  update.set_uuid(UUID::random().toBytes());
+  return update;
+}
+
+
+void Master::reconcileTasks(const FrameworkID& frameworkId,
+                            const vector<TaskID>& taskIds)
+{
+  Framework* framework = getFramework(frameworkId);
+  if (framework == NULL) {
+    return;
+  }
+
+  LOG(INFO) << "Reconciling "
+            << (taskIds.empty() ? "all" : utils::stringify(taskIds.size()))
+            << " tasks of framework " << frameworkId;
+
+  // Every task gets an update with its current state: the launched
+  // tasks are in their last known state, queued tasks are starting,
+  // and the tasks the master doesn't know about are lost.
+  vector<StatusUpdate> updates;
+
+  if (taskIds.empty()) {
+    updates.reserve(framework->tasks.size() + framework->queued.size());
+
+    foreachvalue (Task* task, framework->tasks) {
+      updates.push_back(
+          createStatusUpdate(frameworkId, task->task_id(), task->state()));
+      updates.back().mutable_slave_id()->MergeFrom(task->slave_id());
+    }
+
+    foreach (const TaskDescription& task, framework->queued) {
+      updates.push_back(createStatusUpdate(
+          frameworkId, task.task_id(), TASK_STARTING, "Task is queued"));
+    }
+  } else {
+    updates.reserve(taskIds.size());
+
+    hashset<TaskID> queued;
+    foreach (const TaskDescription& task, framework->queued) {
+      queued.insert(task.task_id());
+    }
+
+    foreach (const TaskID& taskId, taskIds) {
+      Task* task = framework->getTask(taskId);
+      if (task != NULL) {
+        updates.push_back(
+            createStatusUpdate(frameworkId, taskId, task->state()));
+        updates.back().mutable_slave_id()->MergeFrom(task->slave_id());
+      } else if (queued.contains(taskId)) {
+        updates.push_back(createStatusUpdate(
+            frameworkId, taskId, TASK_STARTING, "Task is queued"));
+      } else {
+        updates.push_back(createStatusUpdate(
+            frameworkId, taskId, TASK_LOST, "Task not found"));
+      }
+    }
+  }
+
+  // Send the updates in batches (without a pid, since there's nothing
+  // for the scheduler to acknowledge).
+  StatusUpdatesMessage message;
+
+  foreach (const StatusUpdate& update, updates) {
+    message.add_updates()->MergeFrom(update);
+
+    if (message.updates_size() == RECONCILIATION_BATCH_UPDATES) {
+      send(framework->pid, message);
+      message.Clear();
+    }
+  }
+
+  if (message.updates_size() > 0) {
+    send(framework->pid, message);
+  }
+}
+
+
 void Master::reviveOffers(const FrameworkID& frameworkId)
 {
   Framework* framework = getFramework(frameworkId);
   if (framework != NULL) {
     LOG(INFO) << "Reviving offers for framework " << framework->id;
-    framework->slaveFilter.clear();
     allocator->offersRevived(framework);
   }
 }
@@ -755,7 +1121,22 @@ void Master::killTask(const FrameworkID& frameworkId,
   Framework* framework = getFramework(frameworkId);
   if (framework != NULL) {
     Task* task = framework->getTask(taskId);
-    if (task != NULL) {
+    if (task == NULL && framework->dequeue(taskId)) {
+      // The task was still queued, so it just gets dropped.
+      LOG(INFO) << "Removed queued task " << taskId
+                << " of framework " << frameworkId;
+
+      StatusUpdateMessage message;
+      StatusUpdate* update = message.mutable_update();
+      update->mutable_framework_id()->MergeFrom(frameworkId);
+      TaskStatus* status = update->mutable_status();
+      status->mutable_task_id()->MergeFrom(taskId);
+      status->set_state(TASK_KILLED);
+      status->set_message("Task killed while queued");
+      update->set_timestamp(Clock::coarse());
+      update->set_uuid(UUID::random().toBytes());
+      send(framework->pid, message);
+    } else if (task != NULL) {
       Slave* slave = getSlave(task->slave_id());
       CHECK(slave != NULL);
 
@@ -784,7 +1165,7 @@ void Master::killTask(const FrameworkID& frameworkId,
       status->mutable_task_id()->MergeFrom(taskId);
       status->set_state(TASK_LOST);
       status->set_message("Task not found");
-      update->set_timestamp(Clock::now());
+      update->set_timestamp(Clock::coarse());
       update->set_uuid(UUID::random().toBytes());
       send(framework->pid, message);
     }
@@ -811,18 +1192,18 @@ void Master::schedulerMessage(const SlaveID& slaveId,
       message.set_data(data);
       send(slave->pid, message);
 
-      stats.validFrameworkMessages++;
+      stats.validFrameworkMessages.increment();
     } else {
       LOG(WARNING) << "Cannot send framework message for framework "
                    << frameworkId << " to slave " << slaveId
                    << " because slave does not exist";
-      stats.invalidFrameworkMessages++;
+      stats.invalidFrameworkMessages.increment();
     }
   } else {
     LOG(WARNING) << "Cannot send framework message for framework "
                  << frameworkId << " to slave " << slaveId
                  << " because framework does not exist";
-    stats.invalidFrameworkMessages++;
+    stats.invalidFrameworkMessages.increment();
   }
 }
 
@@ -841,6 +1222,7 @@ void Master::registerSlave(const SlaveInfo& slaveInfo)
                 << ") already registered, re-sending acknowledgement";
       SlaveRegisteredMessage message;
       message.mutable_slave_id()->MergeFrom(slave->id);
+      message.set_shard(shard(slave->id));
       send(slave->pid, message);
       return;
     }
@@ -870,11 +1252,10 @@ void Master::registerSlave(const SlaveInfo& slaveInfo)
 }
 
 
-void Master::reregisterSlave(const SlaveID& slaveId,
-                             const SlaveInfo& slaveInfo,
-                             const vector<ExecutorInfo>& executorInfos,
-                             const vector<Task>& tasks)
+void Master::reregisterSlave(const ReregisterSlaveMessage& message)
 {
+  const SlaveID& slaveId = message.slave_id();
+
   if (!elected) {
     LOG(WARNING) << "Ignoring re-register slave message since not elected yet";
     return;
@@ -897,20 +1278,42 @@ void Master::reregisterSlave(const SlaveID& slaveId,
                    << " is being allowed to re-register with an already"
                    << " in use id (" << slaveId << ")";
 
-      SlaveReregisteredMessage message;
-      message.mutable_slave_id()->MergeFrom(slave->id);
-      send(slave->pid, message);
-
+      // The slave might have restarted (see Master::exited).
+      slave->pid = from;
+      link(slave->pid);
+
+      SlaveReregisteredMessage reregistered;
+      reregistered.mutable_slave_id()->MergeFrom(slave->id);
+      reregistered.set_shard(shard(slave->id));
+      send(slave->pid, reregistered);
+
+    } else if (reregistering.contains(slaveId) &&
+               reregistering[slaveId] == message.digest()) {
+      LOG(INFO) << "Ignoring re-register slave message from " << from
+                << " since slave " << slaveId
+                << " is already waiting to be re-added";
+    } else if (!message.has_slave()) {
+      // The slave only sent the digest of its state (which we don't
+      // have, or not as of that digest), so ask for the state itself.
+      LOG(INFO) << "Asking slave " << slaveId << " at " << from
+                << " for its state in order to re-add it";
+
+      RequestSlaveStateMessage request;
+      request.mutable_slave_id()->MergeFrom(slaveId);
+      reply(request);
     } else {
-      Slave* slave = new Slave(slaveInfo, slaveId, from, Clock::now());
-
-      LOG(INFO) << "Attempting to re-register slave " << slave->id
-                << " at " << slave->pid;
+      // After a failover every slave re-registers at about the same
+      // time, so rather than re-adding them all (and their tasks)
+      // before handling any other messages they get queued up and
+      // re-added a limited number at a time (see Master::readdSlaves).
+      // A slave whose state changed while it was waiting gets queued
+      // up again, and re-added with the state it sent last.
+      if (reregistrations.empty()) {
+        dispatch(self(), &Master::readdSlaves);
+      }
 
-      // TODO(benh): We assume all slaves can register for now.
-      CHECK(conf.get<string>("slaves", "*") == "*");
-      activatedSlaveHostnamePort(slave->info.hostname(), slave->pid.port);
-      readdSlave(slave, executorInfos, tasks);
+      reregistrations.push_back(make_pair(from, message));
+      reregistering[slaveId] = message.digest();
 
 //       // Checks if this slave, or if all slaves, can be accepted.
 //       if (slaveHostnamePorts.contains(slaveInfo.hostname(), from.port)) {
@@ -929,6 +1332,48 @@ void Master::reregisterSlave(const SlaveID& slaveId,
 }
 
 
+void Master::readdSlaves()
+{
+  size_t tasks = 0;
+
+  while (!reregistrations.empty() && tasks < REREGISTRATION_BATCH_TASKS) {
+    const UPID& pid = reregistrations.front().first;
+    const ReregisterSlaveMessage& message = reregistrations.front().second;
+
+    // Skip any state that got replaced by a newer one in the meantime.
+    const bool latest = reregistering.contains(message.slave_id()) &&
+      reregistering[message.slave_id()] == message.digest();
+
+    if (latest) {
+      reregistering.erase(message.slave_id());
+    }
+
+    if (latest && getSlave(message.slave_id()) == NULL) {
+      Slave* slave =
+        new Slave(message.slave(), message.slave_id(), pid, Clock::now());
+
+      LOG(INFO) << "Attempting to re-register slave " << slave->id
+                << " at " << slave->pid;
+
+      // TODO(benh): We assume all slaves can register for now.
+      CHECK(conf.get<string>("slaves", "*") == "*");
+      activatedSlaveHostnamePort(slave->info.hostname(), slave->pid.port);
+      readdSlave(slave, message.executor_infos(), message.tasks());
+
+      tasks += message.tasks_size();
+    }
+
+    reregistrations.pop_front();
+  }
+
+  // Handle the messages that arrived in the meantime before re-adding
+  // any more slaves.
+  if (!reregistrations.empty()) {
+    dispatch(self(), &Master::readdSlaves);
+  }
+}
+
+
 void Master::unregisterSlave(const SlaveID& slaveId)
 {
   LOG(INFO) << "Asked to unregister slave " << slaveId;
@@ -943,91 +1388,242 @@ void Master::unregisterSlave(const SlaveID& slaveId)
 
 
 void Master::statusUpdate(const StatusUpdate& update, const UPID& pid)
+{
+  LOG_RATE_LIMITED(INFO, TASK_LOG_RATE)
+    << "Status update from " << from
+    << ": task " << update.status().task_id()
+    << " of framework " << update.framework_id()
+    << " is now in state " << update.status().state();
+
+  Framework* framework = updateTask(update);
+  if (framework != NULL) {
+    // Pass on the status update to the framework as the slave sent
+    // it (rather than encoding the same message again).
+    forward(framework->pid);
+  }
+}
+
+
+void Master::statusUpdates(const StatusUpdatesMessage& message)
+{
+  // The framework to pass each update on to (if any).
+  vector<Framework*> frameworks;
+  frameworks.reserve(message.updates_size());
+
+  deferRecovery = true;
+
+  foreach (const StatusUpdate& update, message.updates()) {
+    LOG_RATE_LIMITED(INFO, TASK_LOG_RATE)
+      << "Status update from " << from
+      << ": task " << update.status().task_id()
+      << " of framework " << update.framework_id()
+      << " is now in state " << update.status().state();
+
+    frameworks.push_back(updateTask(update));
+  }
+
+  deferRecovery = false;
+
+  recoverDeferredResources();
+
+  // The updates are usually all for the same framework (e.g., they
+  // are from one executor), in which case the message gets passed on
+  // as the slave sent it.
+  bool same = !frameworks.empty() && frameworks[0] != NULL;
+  foreach (Framework* framework, frameworks) {
+    same = same && framework == frameworks[0];
+  }
+
+  if (same) {
+    forward(frameworks[0]->pid);
+    return;
+  }
+
+  // Otherwise pass on the status updates to each framework in one
+  // message too.
+  hashmap<Framework*, StatusUpdatesMessage> forwards;
+
+  for (int i = 0; i < message.updates_size(); i++) {
+    if (frameworks[i] != NULL) {
+      forwards[frameworks[i]].add_updates()->MergeFrom(message.updates(i));
+    }
+  }
+
+  foreachpair (Framework* framework,
+               StatusUpdatesMessage& forward,
+               forwards) {
+    forward.set_pid(message.pid());
+    send(framework->pid, forward);
+  }
+}
+
+
+void Master::shardedStatusUpdates(const PID<SlaveShard>& shard,
+                                  uint64_t id,
+                                  const StatusUpdatesMessage& message)
+{
+  vector<UPID> pids;
+  pids.reserve(message.updates_size());
+
+  deferRecovery = true;
+
+  foreach (const StatusUpdate& update, message.updates()) {
+    Framework* framework = updateTask(update);
+    pids.push_back(framework != NULL ? framework->pid : UPID());
+  }
+
+  deferRecovery = false;
+
+  recoverDeferredResources();
+
+  dispatch(shard, &SlaveShard::forward, id, pids);
+}
+
+
+Framework* Master::updateTask(const StatusUpdate& update)
 {
   const TaskStatus& status = update.status();
 
-  LOG(INFO) << "Status update from " << from
-            << ": task " << status.task_id()
-            << " of framework " << update.framework_id()
-            << " is now in state " << status.state();
+  tracer::record("master", update);
 
   Slave* slave = getSlave(update.slave_id());
   if (slave != NULL) {
     Framework* framework = getFramework(update.framework_id());
     if (framework != NULL) {
-      // Pass on the (transformed) status update to the framework.
-      StatusUpdateMessage message;
-      message.mutable_update()->MergeFrom(update);
-      message.set_pid(pid);
-      send(framework->pid, message);
-
       // Lookup the task and see if we need to update anything locally.
       Task* task = slave->getTask(update.framework_id(), status.task_id());
       if (task != NULL) {
+        if (status.state() != TASK_STARTING) {
+          hashmap<Task*, double>::iterator it = launching.find(task);
+          if (it != launching.end()) {
+            launchLatency.record(Clock::now() - it->second);
+            launching.erase(it);
+          }
+        }
+
         task->set_state(status.state());
+        framework->dirty = true;
 
         // Handle the task appropriately if it's terminated.
         if (status.state() == TASK_FINISHED ||
             status.state() == TASK_FAILED ||
-            status.state() == TASK_KILLED ||
-            status.state() == TASK_LOST) {
+            status.state() == TASK_KILLED) {
+          // A sticky framework gets the freed resources offered right
+          // back rather than waiting for the next allocation pass.
+          if (framework->info.sticky() && framework->active &&
+              slave->active && !task->revocable()) {
+            const Resources resources = task->resources();
+            removeTask(task, false);
+            reoffer(framework, slave, resources);
+          } else {
+            removeTask(task);
+          }
+        } else if (status.state() == TASK_LOST) {
           removeTask(task);
         }
 
-        stats.tasks[status.state()]++;
+        stats.tasks[status.state()]->increment();
 
-        stats.validStatusUpdates++;
+        stats.validStatusUpdates.increment();
       } else {
-        LOG(WARNING) << "Status update from " << from
+        LOG(WARNING) << "Status update from slave " << update.slave_id()
                      << ": error, couldn't lookup "
                      << "task " << status.task_id();
-	stats.invalidStatusUpdates++;
+	stats.invalidStatusUpdates.increment();
       }
+
+      return framework;
     } else {
-      LOG(WARNING) << "Status update from " << from
+      LOG(WARNING) << "Status update from slave " << update.slave_id()
                    << ": error, couldn't lookup "
                    << "framework " << update.framework_id();
-      stats.invalidStatusUpdates++;
+      stats.invalidStatusUpdates.increment();
     }
   } else {
-    LOG(WARNING) << "Status update from " << from
-                 << ": error, couldn't lookup slave "
+    LOG(WARNING) << "Status update: error, couldn't lookup slave "
                  << update.slave_id();
-    stats.invalidStatusUpdates++;
+    stats.invalidStatusUpdates.increment();
   }
+
+  return NULL;
 }
 
 
-void Master::executorMessage(const SlaveID& slaveId,
-			     const FrameworkID& frameworkId,
-			     const ExecutorID& executorId,
-                             const string& data)
+void Master::executorUsage(const ExecutorUsageMessage& message)
 {
-  Slave* slave = getSlave(slaveId);
-  if (slave != NULL) {
-    Framework* framework = getFramework(frameworkId);
-    if (framework != NULL) {
-      LOG(INFO) << "Sending framework message from slave " << slaveId
-                << " to framework " << frameworkId;
-      ExecutorToFrameworkMessage message;
-      message.mutable_slave_id()->MergeFrom(slaveId);
-      message.mutable_framework_id()->MergeFrom(frameworkId);
-      message.mutable_executor_id()->MergeFrom(executorId);
-      message.set_data(data);
-      send(framework->pid, message);
+  Slave* slave = getSlave(message.slave_id());
+  if (slave == NULL) {
+    LOG(WARNING) << "Ignoring executor usage from unknown slave "
+                 << message.slave_id();
+    return;
+  }
+
+  // Each message has the usage of all the slave's sampled executors.
+  slave->usage.clear();
+
+  foreach (const ExecutorUsage& usage, message.usages()) {
+    if (slave->hasExecutor(usage.framework_id(), usage.executor_id())) {
+      slave->usage[usage.framework_id()][usage.executor_id()] = usage;
+    }
+  }
+
+  // The slave itself preempts revocable executors if the slack they
+  // are running on shrinks, so this only affects what's offered.
+  slave->slack = message.slack();
+  slave->dirty = true;
+
+  if (slave->active) {
+    allocator->slackChanged(slave);
+  }
+}
 
-      stats.validFrameworkMessages++;
+
+void Master::executorMemoryPressure(
+    const ExecutorMemoryPressureMessage& message)
+{
+  Framework* framework = getFramework(message.framework_id());
+  if (framework != NULL && getSlave(message.slave_id()) != NULL) {
+    forward(framework->pid);
+  } else {
+    LOG(WARNING) << "Dropping memory pressure of executor '"
+                 << message.executor_id() << "' of framework "
+                 << message.framework_id() << " on slave "
+                 << message.slave_id();
+  }
+}
+
+
+void Master::executorMessage(const SlaveID& slaveId,
+			     const FrameworkID& frameworkId,
+			     const ExecutorID& executorId,
+                             const string& data)
+{
+  Slave* slave = getSlave(slaveId);
+  if (slave != NULL) {
+    Framework* framework = getFramework(frameworkId);
+    if (framework != NULL) {
+      LOG_RATE_LIMITED(INFO, TASK_LOG_RATE)
+        << "Sending framework message from slave " << slaveId
+        << " to framework " << frameworkId;
+      ExecutorToFrameworkMessage message;
+      message.mutable_slave_id()->MergeFrom(slaveId);
+      message.mutable_framework_id()->MergeFrom(frameworkId);
+      message.mutable_executor_id()->MergeFrom(executorId);
+      message.set_data(data);
+      send(framework->pid, message);
+
+      stats.validFrameworkMessages.increment();
     } else {
       LOG(WARNING) << "Cannot send framework message from slave "
                    << slaveId << " to framework " << frameworkId
                    << " because framework does not exist";
-      stats.invalidFrameworkMessages++;
+      stats.invalidFrameworkMessages.increment();
     }
   } else {
     LOG(WARNING) << "Cannot send framework message from slave "
                  << slaveId << " to framework " << frameworkId
                  << " because slave does not exist";
-    stats.invalidFrameworkMessages++;
+    stats.invalidFrameworkMessages.increment();
   }
 }
 
@@ -1074,7 +1670,7 @@ void Master::exitedExecutor(const SlaveID& slaveId,
           status->mutable_task_id()->MergeFrom(task->task_id());
           status->set_state(TASK_LOST);
           status->set_message("Lost executor");
-          update->set_timestamp(Clock::now());
+          update->set_timestamp(Clock::coarse());
           update->set_uuid(UUID::random().toBytes());
           send(framework->pid, message);
 
@@ -1082,12 +1678,22 @@ void Master::exitedExecutor(const SlaveID& slaveId,
                     << " of framework " << frameworkId
                     << " because of lost executor";
 
-          stats.tasks[TASK_LOST]++;
+          stats.tasks[TASK_LOST]->increment();
 
           removeTask(task);
         }
       }
 
+      // Tell the allocator about the executor's resources (if we
+      // knew about the executor).
+      if (slave->hasExecutor(frameworkId, executorId)) {
+        recoverResources(
+            frameworkId,
+            slaveId,
+            slave->executors[frameworkId][executorId].resources(),
+            slave->isRevocable(frameworkId, executorId));
+      }
+
       // Remove executor from slave and framework.
       slave->removeExecutor(frameworkId, executorId);
       framework->removeExecutor(slave->id, executorId);
@@ -1131,12 +1737,82 @@ void Master::deactivatedSlaveHostnamePort(const string& hostname,
 }
 
 
-void Master::timerTick()
+void Master::activatedSlaveHostnamePorts(
+    const multihashmap<string, uint16_t>& hostnamePorts)
 {
-  // Check which framework filters can be expired.
-  foreachvalue (Framework* framework, frameworks) {
-    framework->removeExpiredFilters(Clock::now());
+  LOG(INFO) << "Master now considering " << hostnamePorts.size()
+            << " more slaves as active";
+
+  foreachpair (const string& hostname, uint16_t port, hostnamePorts) {
+    slaveHostnamePorts.put(hostname, port);
+  }
+}
+
+
+void Master::deactivatedSlaveHostnamePorts(
+    const multihashmap<string, uint16_t>& hostnamePorts)
+{
+  // Find all the connected slaves first (rather than looking through
+  // all the slaves for each of them) and then remove them together.
+  vector<Slave*> removed;
+  foreachvalue (Slave* slave, slaves) {
+    if (hostnamePorts.contains(slave->info.hostname(), slave->pid.port) &&
+        slaveHostnamePorts.contains(slave->info.hostname(), slave->pid.port)) {
+      removed.push_back(slave);
+    }
+  }
+
+  foreach (Slave* slave, removed) {
+    LOG(WARNING) << "Removing slave " << slave->id << " at "
+                 << slave->info.hostname() << ":" << slave->pid.port
+                 << " because it has been deactivated";
+    send(slave->pid, ShutdownMessage());
+    removeSlave(slave);
+  }
+
+  LOG(INFO) << "Master now considering " << hostnamePorts.size()
+            << " slaves as inactive";
+
+  foreachpair (const string& hostname, uint16_t port, hostnamePorts) {
+    slaveHostnamePorts.remove(hostname, port);
+  }
+}
+
+
+void Master::rescindOffers(Framework* framework)
+{
+  foreach (Offer* offer, utils::copy(framework->offers)) {
+    recoverResources(offer->framework_id(),
+                     offer->slave_id(),
+                     offer->resources(),
+                     offer->revocable());
+    removeOffer(offer, true); // Rescind!
   }
+}
+
+
+void Master::preemptTask(Task* task)
+{
+  Slave* slave = getSlave(task->slave_id());
+  CHECK(slave != NULL);
+
+  LOG(INFO) << "Telling slave " << slave->id
+            << " to kill task " << task->task_id()
+            << " of framework " << task->framework_id()
+            << " to preempt it";
+
+  KillTaskMessage message;
+  message.mutable_framework_id()->MergeFrom(task->framework_id());
+  message.mutable_task_id()->MergeFrom(task->task_id());
+  send(slave->pid, message);
+}
+
+
+void Master::timerTick()
+{
+  // Rescind the stale offers first so that their resources get
+  // offered again by this allocation pass.
+  expireOffers();
 
   // Do allocations!
   allocator->timerTick();
@@ -1146,6 +1822,35 @@ void Master::timerTick()
 }
 
 
+void Master::pingTick()
+{
+  vector<UPID> pings;
+  vector<SlaveID> lost;
+
+  health.check(&pings, &lost);
+
+  foreach (const UPID& pid, pings) {
+    send(pid, "PING");
+  }
+
+  foreach (const SlaveID& slaveId, lost) {
+    Slave* slave = getSlave(slaveId);
+    if (slave != NULL) {
+      deactivatedSlaveHostnamePort(slave->info.hostname(), slave->pid.port);
+    }
+  }
+
+  pingTickTimer = delay(SLAVE_PONG_TIMEOUT / SLAVE_PING_BUCKETS,
+                        self(), &Master::pingTick);
+}
+
+
+void Master::pong(const UPID& from, const string& body)
+{
+  // Nothing to do, the slave was already noted as alive (see visit).
+}
+
+
 void Master::frameworkFailoverTimeout(const FrameworkID& frameworkId,
                                       double reregisteredTime)
 {
@@ -1159,42 +1864,227 @@ void Master::frameworkFailoverTimeout(const FrameworkID& frameworkId,
 }
 
 
+void Master::offer(const FrameworkID& frameworkId,
+                   const hashmap<SlaveID, Resources>& resources)
+{
+  Framework* framework = getFramework(frameworkId);
+
+  hashmap<Slave*, Resources> offered;
+
+  foreachpair (const SlaveID& slaveId, const Resources& r, resources) {
+    Slave* slave = getSlave(slaveId);
+
+    // Things might have changed since the allocator decided to make
+    // this offer, in which case it gets the resources back.
+    if (framework != NULL && framework->active &&
+        slave != NULL && slave->active &&
+        r <= slave->resourcesFree()) {
+      offered[slave] = r;
+    } else {
+      LOG(INFO) << "Not offering " << r << " on slave " << slaveId
+                << " to framework " << frameworkId;
+      allocator->resourcesRecovered(frameworkId, slaveId, r);
+    }
+  }
+
+  if (offered.size() > 0) {
+    makeOffers(framework, offered);
+  }
+}
+
+
 void Master::makeOffers(Framework* framework,
-                        const hashmap<Slave*, Resources>& offered)
+                        const hashmap<Slave*, Resources>& offered,
+                        bool revocable)
 {
-  // Create an offer for each slave and add it to the message.
+  // Create an offer for each slave.
+  foreachpair (Slave* slave, const Resources& resources, offered) {
+    Offer* offer =
+      createOffer(framework, slave, resources, revocable, offerTimeout);
+    framework->unsentOffers.insert(offer);
+  }
+
+  // Send the offers right away unless we sent the framework some
+  // offers recently, in which case they (and any other offers made
+  // in the meantime) get sent once the aggregation interval is up.
+  if (framework->unsentOffers.size() == offered.size()) {
+    double elapsed = Clock::now() - framework->offersSent;
+    if (elapsed >= offerAggregationInterval) {
+      sendOffers(framework->id);
+    } else {
+      delay(offerAggregationInterval - elapsed, self(),
+            &Master::sendOffers, framework->id);
+    }
+  }
+}
+
+
+Offer* Master::createOffer(Framework* framework,
+                           Slave* slave,
+                           const Resources& resources,
+                           bool revocable,
+                           double timeout)
+{
+  Offer* offer = offerPool.get();
+  offer->mutable_id()->MergeFrom(newOfferId());
+  offer->mutable_framework_id()->MergeFrom(framework->id);
+  offer->mutable_slave_id()->MergeFrom(slave->id);
+  offer->set_hostname(slave->info.hostname());
+  offer->mutable_resources()->MergeFrom(resources);
+  offer->mutable_attributes()->MergeFrom(slave->info.attributes());
+  offer->set_revocable(revocable);
+
+  // Add all framework's executors running on this slave.
+  if (slave->executors.contains(framework->id)) {
+    const hashmap<ExecutorID, ExecutorInfo>& executors =
+      slave->executors[framework->id];
+    foreachkey (const ExecutorID& executorId, executors) {
+      offer->add_executor_ids()->MergeFrom(executorId);
+    }
+  }
+
+  offers[offer->id()] = offer;
+  offersMade.increment();
+  offersOutstanding.increment();
+
+  if (timeout > 0) {
+    offerExpiries.insert(std::make_pair(Clock::now() + timeout, offer->id()));
+  }
+
+  framework->addOffer(offer);
+  slave->addOffer(offer);
+
+  return offer;
+}
+
+
+// Adds an offer to the message, without the hostname and attributes
+// of its slave, which (along with the slave's PID) get added just once
+// per message to the table of slaves (those in 'slaves' already are).
+static void addOffer(ResourceOffersMessage* message,
+                     const Offer& offer,
+                     Slave* slave,
+                     hashset<SlaveID>* slaves)
+{
+  Offer* added = message->add_offers();
+  added->MergeFrom(offer);
+  added->set_hostname(""); // Required, but filled in by the driver.
+  added->clear_attributes();
+
+  if (!slaves->contains(slave->id)) {
+    OfferSlave* info = message->add_slaves();
+    info->mutable_slave_id()->MergeFrom(slave->id);
+    info->set_pid(slave->pid);
+    info->set_hostname(slave->info.hostname());
+    info->mutable_attributes()->MergeFrom(slave->info.attributes());
+    slaves->insert(slave->id);
+  }
+}
+
+
+void Master::sendOffers(const FrameworkID& frameworkId)
+{
+  Framework* framework = getFramework(frameworkId);
+
+  if (framework == NULL || framework->unsentOffers.empty()) {
+    return;
+  }
+
   ResourceOffersMessage message;
+  hashset<SlaveID> slaves;
 
-  foreachpair (Slave* slave, const Resources& resources, offered) {
-    Offer* offer = new Offer();
-    offer->mutable_id()->MergeFrom(newOfferId());
-    offer->mutable_framework_id()->MergeFrom(framework->id);
-    offer->mutable_slave_id()->MergeFrom(slave->id);
-    offer->set_hostname(slave->info.hostname());
-    offer->mutable_resources()->MergeFrom(resources);
-    offer->mutable_attributes()->MergeFrom(slave->info.attributes());
-
-    // Add all framework's executors running on this slave.
-    if (slave->executors.contains(framework->id)) {
-      const hashmap<ExecutorID, ExecutorInfo>& executors =
-        slave->executors[framework->id];
-      foreachkey (const ExecutorID& executorId, executors) {
-        offer->add_executor_ids()->MergeFrom(executorId);
-      }
+  foreach (Offer* offer, framework->unsentOffers) {
+    Slave* slave = getSlave(offer->slave_id());
+    CHECK(slave != NULL);
+
+    addOffer(&message, *offer, slave, &slaves);
+  }
+
+  framework->unsentOffers.clear();
+  framework->offersSent = Clock::now();
+
+  LOG_RATE_LIMITED(INFO, TASK_LOG_RATE)
+    << "Sending " << message.offers().size()
+    << " offers to framework " << framework->id;
+
+  send(framework->pid, message);
+}
+
+
+void Master::placeTasks(Framework* framework,
+                        Slave* slave,
+                        const vector<TaskDescription>& tasks)
+{
+  Resources resources;
+  hashset<ExecutorID> launched;
+  hashset<TaskID> placed;
+
+  vector<TaskDescription> launches;
+
+  foreach (const TaskDescription& task, tasks) {
+    resources += task.resources();
+
+    // The executor gets launched with the first of its tasks.
+    const ExecutorInfo& executorInfo = task.has_executor()
+      ? task.executor()
+      : framework->info.executor();
+
+    if (!framework->hasExecutor(slave->id, executorInfo.executor_id()) &&
+        !launched.contains(executorInfo.executor_id())) {
+      resources += executorInfo.resources();
+      launched.insert(executorInfo.executor_id());
     }
 
-    offers[offer->id()] = offer;
+    launches.push_back(task);
+    launches.back().mutable_slave_id()->MergeFrom(slave->id);
 
-    framework->addOffer(offer);
-    slave->addOffer(offer);
+    placed.insert(task.task_id());
+  }
 
-    // Add the offer *AND* the corresponding slave's PID.
-    message.add_offers()->MergeFrom(*offer);
-    message.add_pids(slave->pid);
+  list<TaskDescription>::iterator it = framework->queued.begin();
+  while (it != framework->queued.end()) {
+    if (placed.contains(it->task_id())) {
+      it = framework->queued.erase(it);
+    } else {
+      ++it;
+    }
   }
 
-  LOG(INFO) << "Sending " << message.offers().size()
-            << " offers to framework " << framework->id;
+  LOG(INFO) << "Placing " << launches.size() << " queued tasks"
+            << " of framework " << framework->id
+            << " on slave " << slave->id;
+
+  Offer* offer = createOffer(framework, slave, resources, false, 0);
+
+  // Launch the tasks once the allocation pass is done, as if the
+  // framework had used the offer (so that the tasks get validated
+  // like any other), without filtering anything left over.
+  Filters filters;
+  filters.set_refuse_seconds(0);
+
+  dispatch(self(), &Master::launchTasks,
+           framework->id, offer->id(), launches, filters);
+}
+
+
+void Master::sendOffer(const OfferID& offerId)
+{
+  Offer* offer = getOffer(offerId);
+  if (offer == NULL) {
+    return;
+  }
+
+  Framework* framework = getFramework(offer->framework_id());
+  Slave* slave = getSlave(offer->slave_id());
+  CHECK(framework != NULL && slave != NULL);
+
+  ResourceOffersMessage message;
+  hashset<SlaveID> slaves;
+  addOffer(&message, *offer, slave, &slaves);
+
+  LOG_RATE_LIMITED(INFO, TASK_LOG_RATE)
+    << "Sending offer " << offerId
+    << " to framework " << framework->id;
 
   send(framework->pid, message);
 }
@@ -1212,6 +2102,8 @@ typedef Option<string> TaskDescriptionError;
 
 struct TaskDescriptionVisitor
 {
+  virtual ~TaskDescriptionVisitor() {}
+
   virtual TaskDescriptionError operator () (
       const TaskDescription& task,
       Offer* offer,
@@ -1272,6 +2164,55 @@ struct UniqueTaskIDChecker : TaskDescriptionVisitor
 // offered on that slave
 struct ResourceUsageChecker : TaskDescriptionVisitor
 {
+  // Determines up front whether all of the tasks (and the executors
+  // that need to be launched for them) fit in the offer, in which
+  // case the tasks don't need to be checked against the offer one by
+  // one (the common case of a framework launching many tasks).
+  ResourceUsageChecker(const vector<TaskDescription>& tasks,
+                       Offer* offer,
+                       Framework* framework,
+                       Slave* slave)
+    : fits(true)
+  {
+    Resources total;
+    hashset<ExecutorID> launched;
+
+    foreach (const TaskDescription& task, tasks) {
+      const ExecutorInfo& executorInfo = task.has_executor()
+        ? task.executor()
+        : framework->info.executor();
+
+      // Invalid resources are caught (per task) below.
+      if (!allocatable(task.resources()) ||
+          !allocatable(executorInfo.resources())) {
+        fits = false;
+        return;
+      }
+
+      total += task.resources();
+
+      const ExecutorID& executorId = executorInfo.executor_id();
+      if (!launched.contains(executorId) &&
+          !slave->hasExecutor(framework->id, executorId)) {
+        total += executorInfo.resources();
+      }
+      launched.insert(executorId);
+    }
+
+    fits = total <= offer->resources();
+  }
+
+  static bool allocatable(
+      const google::protobuf::RepeatedPtrField<Resource>& resources)
+  {
+    foreach (const Resource& resource, resources) {
+      if (!Resources::isAllocatable(resource)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   virtual TaskDescriptionError operator () (
       const TaskDescription& task,
       Offer* offer,
@@ -1304,6 +2245,10 @@ struct ResourceUsageChecker : TaskDescriptionVisitor
       }
     }
 
+    if (fits) {
+      return TaskDescriptionError::none();
+    }
+
     // Check if this task uses more resources than offered.
     Resources taskResources = task.resources();
 
@@ -1335,10 +2280,38 @@ struct ResourceUsageChecker : TaskDescriptionVisitor
     return TaskDescriptionError::none();
   }
 
+  bool fits;
   Resources usedResources;
   hashset<ExecutorID> executors;
 };
 
+// Checks that tasks from revocable offers only run in revocable
+// executors and vice versa (an executor is revocable if it was
+// launched from a revocable offer), so that preempting revocable
+// executors never kills tasks that aren't revocable.
+struct RevocableChecker : TaskDescriptionVisitor
+{
+  virtual TaskDescriptionError operator () (
+      const TaskDescription& task,
+      Offer* offer,
+      Framework* framework,
+      Slave* slave)
+  {
+    const ExecutorID& executorId = task.has_executor()
+      ? task.executor().executor_id()
+      : framework->info.executor().executor_id();
+
+    if (slave->hasExecutor(framework->id, executorId) &&
+        slave->isRevocable(framework->id, executorId) != offer->revocable()) {
+      return TaskDescriptionError::some(offer->revocable()
+          ? "Revocable task uses an executor that isn't revocable"
+          : "Task uses a revocable executor");
+    }
+
+    return TaskDescriptionError::none();
+  }
+};
+
 
 // Process a resource offer reply (for a non-cancelled offer) by
 // launching the desired tasks (if the offer contains a valid set of
@@ -1349,13 +2322,19 @@ void Master::processTasks(Offer* offer,
                           const vector<TaskDescription>& tasks,
                           const Filters& filters)
 {
+  const double started = Clock::now();
+
   Resources usedResources; // Accumulated resources used from this offer.
 
+  // Tasks that got launched, sent to the slave in one message.
+  vector<const TaskDescription*> launched;
+
   // Create task visitors.
   list<TaskDescriptionVisitor*> visitors;
   visitors.push_back(new SlaveIDChecker());
   visitors.push_back(new UniqueTaskIDChecker());
-  visitors.push_back(new ResourceUsageChecker());
+  visitors.push_back(new ResourceUsageChecker(tasks, offer, framework, slave));
+  visitors.push_back(new RevocableChecker());
 
   // Loop through each task and check it's validity.
   foreach (const TaskDescription& task, tasks) {
@@ -1372,7 +2351,8 @@ void Master::processTasks(Offer* offer,
 
     if (error.isNone()) {
       // Task looks good, get it running!
-      usedResources += launchTask(task, framework, slave);
+      usedResources += launchTask(task, framework, slave, offer->revocable());
+      launched.push_back(&task);
     } else {
       // Error validating task, send a failed status update.
       LOG(WARNING) << "Error validating task: " << error.get();
@@ -1383,7 +2363,7 @@ void Master::processTasks(Offer* offer,
       status->mutable_task_id()->MergeFrom(task.task_id());
       status->set_state(TASK_LOST);
       status->set_message(error.get());
-      update->set_timestamp(Clock::now());
+      update->set_timestamp(Clock::coarse());
       update->set_uuid(UUID::random().toBytes());
       send(framework->pid, message);
     }
@@ -1396,33 +2376,48 @@ void Master::processTasks(Offer* offer,
     delete visitor;
   } while (!visitors.empty());
 
+  if (launched.size() == 1) {
+    RunTaskMessage message;
+    message.mutable_framework()->MergeFrom(framework->info);
+    message.mutable_framework_id()->MergeFrom(framework->id);
+    message.set_pid(framework->pid);
+    message.mutable_task()->MergeFrom(*launched.front());
+    message.set_revocable(offer->revocable());
+    send(slave->pid, message);
+  } else if (launched.size() > 1) {
+    RunTasksMessage message;
+    message.mutable_framework()->MergeFrom(framework->info);
+    message.mutable_framework_id()->MergeFrom(framework->id);
+    message.set_pid(framework->pid);
+    foreach (const TaskDescription* task, launched) {
+      message.add_tasks()->MergeFrom(*task);
+    }
+    message.set_revocable(offer->revocable());
+    send(slave->pid, message);
+  }
+
+  foreach (const TaskDescription* task, launched) {
+    tracer::record(task->trace_id(), task->task_id(), "master/launch",
+                   started, Clock::now());
+  }
+
   // All used resources should be allocatable, enforced by our validators.
   CHECK(usedResources == usedResources.allocatable());
 
   // Calculate unused resources.
   Resources unusedResources = offer->resources() - usedResources;
 
-  if (unusedResources.allocatable().size() > 0) {
-    // Tell the allocator about the unused (e.g., refused) resources.
+  // Unused revocable resources get offered again as part of the
+  // slave's slack once it reports it (rather than filtered).
+  if (unusedResources.allocatable().size() > 0 && !offer->revocable()) {
+    // Tell the allocator about the unused (e.g., refused) resources,
+    // but only have it filter them if none of the resources are used.
     allocator->resourcesUnused(offer->framework_id(),
                                offer->slave_id(),
-                               unusedResources);
-  }
-
-  // TODO(benh): Move all filter logic to the allocators!
-
-  // Get the timeout (if it exists) for re-offering refused resources.
-  double timeout = filters.has_refuse_seconds()
-    ? filters.refuse_seconds()
-    : UNUSED_RESOURCES_TIMEOUT;
-
-  // Only add a filter on a slave if none of the resources are used.
-  if (timeout != 0 && usedResources.size() == 0) {
-    LOG(INFO) << "Filtered slave " << slave->id
-              << " for framework " << framework->id
-              << " for " << timeout << " seconds";
-    framework->slaveFilter[slave] =
-      (timeout == -1) ? 0 : Clock::now() + timeout;
+                               unusedResources,
+                               usedResources.size() == 0
+                               ? Option<Filters>::some(filters)
+                               : Option<Filters>::none());
   }
 
   removeOffer(offer);
@@ -1431,7 +2426,8 @@ void Master::processTasks(Offer* offer,
 
 Resources Master::launchTask(const TaskDescription& task,
                              Framework* framework,
-                             Slave* slave)
+                             Slave* slave,
+                             bool revocable)
 {
   CHECK(framework != NULL);
   CHECK(slave != NULL);
@@ -1445,7 +2441,7 @@ Resources Master::launchTask(const TaskDescription& task,
     ? task.executor()
     : framework->info.executor();
 
-  Task* t = new Task();
+  Task* t = taskPool.get();
   t->mutable_framework_id()->MergeFrom(framework->id);
   t->mutable_executor_id()->MergeFrom(executorInfo.executor_id());
   t->set_state(TASK_STARTING);
@@ -1453,37 +2449,34 @@ Resources Master::launchTask(const TaskDescription& task,
   t->mutable_task_id()->MergeFrom(task.task_id());
   t->mutable_slave_id()->MergeFrom(task.slave_id());
   t->mutable_resources()->MergeFrom(task.resources());
+  t->set_revocable(revocable);
 
   framework->addTask(t);
 
   // TODO(benh): Refactor this code into Slave::addTask.
   if (!slave->hasExecutor(framework->id, executorInfo.executor_id())) {
     CHECK(!framework->hasExecutor(slave->id, executorInfo.executor_id()));
-    slave->addExecutor(framework->id, executorInfo);
+    slave->addExecutor(framework->id, executorInfo, revocable);
     framework->addExecutor(slave->id, executorInfo);
     resources += executorInfo.resources();
   }
 
   slave->addTask(t);
 
-  resources += task.resources();
+  launching[t] = Clock::now();
 
-  LOG(INFO) << "Launching task " << task.task_id()
-            << " with resources " << task.resources()
-            << " on slave " << slave->id;
+  resources += task.resources();
 
-  RunTaskMessage message;
-  message.mutable_framework()->MergeFrom(framework->info);
-  message.mutable_framework_id()->MergeFrom(framework->id);
-  message.set_pid(framework->pid);
-  message.mutable_task()->MergeFrom(task);
-  send(slave->pid, message);
+  LOG_RATE_LIMITED(INFO, TASK_LOG_RATE)
+    << "Launching task " << task.task_id()
+    << " with resources " << task.resources()
+    << " on slave " << slave->id;
 
   // TODO(benh): This is a double count if the executor decides to
   // send a status update for TASK_STARTING itself. Currently we don't
   // disallow this although we really should have a state machine that
   // makes sure transitions are valid.
-  stats.tasks[TASK_STARTING]++;
+  stats.tasks[TASK_STARTING]->increment();
 
   return resources;
 }
@@ -1525,8 +2518,10 @@ void Master::failoverFramework(Framework* framework, const UPID& newPid)
 
   // Make sure we can get offers again.
   framework->active = true;
+  allocator->frameworkActivated(framework);
 
   framework->reregisteredTime = Clock::now();
+  framework->dirty = true;
 
   {
     FrameworkRegisteredMessage message;
@@ -1540,9 +2535,10 @@ void Master::failoverFramework(Framework* framework, const UPID& newPid)
   // these resources to this framework if it wants.
   // TODO(benh): Consider just reoffering these to
   foreach (Offer* offer, utils::copy(framework->offers)) {
-    allocator->resourcesRecovered(offer->framework_id(),
-                                  offer->slave_id(),
-                                  offer->resources());
+    recoverResources(offer->framework_id(),
+                     offer->slave_id(),
+                     offer->resources(),
+                     offer->revocable());
     removeOffer(offer);
   }
 }
@@ -1569,9 +2565,10 @@ void Master::removeFramework(Framework* framework)
 
   // Remove the framework's offers (if they weren't removed before).
   foreach (Offer* offer, utils::copy(framework->offers)) {
-    allocator->resourcesRecovered(offer->framework_id(),
-                                  offer->slave_id(),
-                                  offer->resources());
+    recoverResources(offer->framework_id(),
+                     offer->slave_id(),
+                     offer->resources(),
+                     offer->revocable());
     removeOffer(offer);
   }
 
@@ -1591,9 +2588,16 @@ void Master::removeFramework(Framework* framework)
   // TODO(benh): unlink(framework->pid);
 
   framework->unregisteredTime = Clock::now();
+  framework->modified = ++stateVersion;
 
   completedFrameworks.push_back(*framework);
 
+  // Only keep what gets shown about completed frameworks (by
+  // /state.json and /memory.json), i.e., not their executors or
+  // queued tasks (its tasks and offers are already gone).
+  completedFrameworks.back().executors.clear();
+  completedFrameworks.back().queued.clear();
+
   if (completedFrameworks.size() > MAX_COMPLETED_FRAMEWORKS) {
     completedFrameworks.pop_front();
   }
@@ -1620,10 +2624,12 @@ void Master::addSlave(Slave* slave, bool reregister)
   if (!reregister) {
     SlaveRegisteredMessage message;
     message.mutable_slave_id()->MergeFrom(slave->id);
+    message.set_shard(shard(slave->id));
     send(slave->pid, message);
   } else {
     SlaveReregisteredMessage message;
     message.mutable_slave_id()->MergeFrom(slave->id);
+    message.set_shard(shard(slave->id));
     send(slave->pid, message);
   }
 
@@ -1632,40 +2638,46 @@ void Master::addSlave(Slave* slave, bool reregister)
   //     dispatch(slavesManager->self(), &SlavesManager::monitor,
   //              slave->pid, slave->info, slave->id);
 
-  // Set up an observer for the slave.
-  slave->observer = new SlaveObserver(slave->pid, slave->info,
-                                      slave->id, self());
-  spawn(slave->observer);
+  // Start checking that the slave is alive.
+  send(slave->pid, "PING");
+  health.add(slave->pid, slave->id);
 
   allocator->slaveAdded(slave);
 }
 
 
-void Master::readdSlave(Slave* slave,
-			const vector<ExecutorInfo>& executorInfos,
-			const vector<Task>& tasks)
+void Master::readdSlave(
+    Slave* slave,
+    const RepeatedPtrField<ExecutorInfo>& executorInfos,
+    const RepeatedPtrField<Task>& tasks)
 {
   CHECK(slave != NULL);
 
-  addSlave(slave, true);
+  // Index the executors rather than looking through all of them for
+  // each task.
+  hashmap<ExecutorID, const ExecutorInfo*> executors;
+  foreach (const ExecutorInfo& executorInfo, executorInfos) {
+    executors[executorInfo.executor_id()] = &executorInfo;
+  }
+
+  // Frameworks whose pid this slave has been told.
+  hashset<FrameworkID> updated;
 
   foreach (const Task& task, tasks) {
-    Task* t = new Task(task);
+    Task* t = taskPool.get();
+    t->CopyFrom(task);
 
-    // Find the executor running this task and add it to the slave.
-    foreach (const ExecutorInfo& executorInfo, executorInfos) {
-      if (executorInfo.executor_id() == task.executor_id()) {
-        if (!slave->hasExecutor(task.framework_id(), task.executor_id())) {
-          slave->addExecutor(task.framework_id(), executorInfo);
-        }
+    Framework* framework = getFramework(task.framework_id());
 
-        // Also add it to the framework if it has re-registered with us.
-        Framework* framework = getFramework(task.framework_id());
-        if (framework != NULL) {
-          CHECK(!framework->hasExecutor(slave->id, task.executor_id()));
-          framework->addExecutor(slave->id, executorInfo);
-        }
-        break;
+    // Add the executor running this task to the slave (and to the
+    // framework if it has re-registered with us).
+    if (executors.contains(task.executor_id()) &&
+        !slave->hasExecutor(task.framework_id(), task.executor_id())) {
+      const ExecutorInfo& executorInfo = *executors[task.executor_id()];
+      slave->addExecutor(task.framework_id(), executorInfo, task.revocable());
+      if (framework != NULL &&
+          !framework->hasExecutor(slave->id, task.executor_id())) {
+        framework->addExecutor(slave->id, executorInfo);
       }
     }
 
@@ -1676,15 +2688,16 @@ void Master::readdSlave(Slave* slave,
     // framework might not yet be connected we won't be able to
     // add them. However, when the framework connects later we
     // will add them then. We also tell this slave the current
-    // framework pid for this task. Again, we do the same thing
-    // if a framework currently isn't registered.
-    Framework* framework = getFramework(task.framework_id());
+    // framework pid (once per framework). Again, we do the same
+    // thing if a framework currently isn't registered.
     if (framework != NULL) {
       framework->addTask(t);
-      UpdateFrameworkMessage message;
-      message.mutable_framework_id()->MergeFrom(framework->id);
-      message.set_pid(framework->pid);
-      send(slave->pid, message);
+      if (updated.insert(framework->id).second) {
+        UpdateFrameworkMessage message;
+        message.mutable_framework_id()->MergeFrom(framework->id);
+        message.set_pid(framework->pid);
+        send(slave->pid, message);
+      }
     } else {
       // TODO(benh): We should really put a timeout on how long we
       // keep tasks running on a slave that never have frameworks
@@ -1694,6 +2707,10 @@ void Master::readdSlave(Slave* slave,
                    << " running on slave " << slave->id;
     }
   }
+
+  // Add the slave once its tasks and executors are accounted for (so
+  // that the allocator doesn't consider their resources free).
+  addSlave(slave, true);
 }
 
 
@@ -1725,7 +2742,7 @@ void Master::removeSlave(Slave* slave)
       status->mutable_task_id()->MergeFrom(task->task_id());
       status->set_state(TASK_LOST);
       status->set_message("Slave removed");
-      update->set_timestamp(Clock::now());
+      update->set_timestamp(Clock::coarse());
       update->set_uuid(UUID::random().toBytes());
       send(framework->pid, message);
     }
@@ -1748,11 +2765,6 @@ void Master::removeSlave(Slave* slave)
     }
   }
 
-  // Remove slave from any filters.
-  foreachvalue (Framework* framework, frameworks) {
-    framework->slaveFilter.erase(slave);
-  }
-
   // Send lost-slave message to all frameworks (this helps them re-run
   // previously finished tasks whose output was on the lost slave).
   foreachvalue (Framework* framework, frameworks) {
@@ -1766,14 +2778,19 @@ void Master::removeSlave(Slave* slave)
   //     dispatch(slavesManager->self(), &SlavesManager::forget,
   //              slave->pid, slave->info, slave->id);
 
-  // Kill the slave observer.
-  terminate(slave->observer);
-  wait(slave->observer);
-
-  delete slave->observer;
+  // Stop checking that the slave is alive.
+  health.remove(slave->pid);
 
   // TODO(benh): unlink(slave->pid);
 
+  // Remember it (for a while) for /state.json?since.
+  removedSlaves.push_back(std::make_pair(++stateVersion, slave->id));
+
+  if (removedSlaves.size() > MAX_REMOVED_SLAVES) {
+    oldestStateVersion = removedSlaves.front().first;
+    removedSlaves.pop_front();
+  }
+
   // Delete it.
   slaves.erase(slave->id);
   allocator->slaveRemoved(slave);
@@ -1781,7 +2798,7 @@ void Master::removeSlave(Slave* slave)
 }
 
 
-void Master::removeTask(Task* task)
+void Master::removeTask(Task* task, bool recover)
 {
   // Remove from framework.
   Framework* framework = getFramework(task->framework_id());
@@ -1793,10 +2810,88 @@ void Master::removeTask(Task* task)
   CHECK(slave != NULL);
   slave->removeTask(task);
 
+  launching.erase(task);
+
   // Tell the allocator about the recovered resources.
-  allocator->resourcesRecovered(framework->id, slave->id, task->resources());
+  if (recover) {
+    recoverResources(framework->id, slave->id, task->resources(),
+                     task->revocable());
+  }
+
+  taskPool.put(task);
+}
+
+
+void Master::reoffer(Framework* framework,
+                     Slave* slave,
+                     const Resources& resources)
+{
+  Offer* offer =
+    createOffer(framework, slave, resources, false, STICKY_OFFER_TIMEOUT);
+
+  LOG_RATE_LIMITED(INFO, TASK_LOG_RATE)
+    << "Offering " << resources << " on slave " << slave->id
+    << " right back to sticky framework " << framework->id;
 
-  delete task;
+  // Send the offer once the status update that freed the resources
+  // has been forwarded, i.e., after handling the update (the offer
+  // doesn't wait for the framework's other offers to be aggregated).
+  dispatch(self(), &Master::sendOffer, offer->id());
+}
+
+
+void Master::recoverResources(const FrameworkID& frameworkId,
+                              const SlaveID& slaveId,
+                              const Resources& resources,
+                              bool revocable)
+{
+  if (revocable) {
+    return;
+  }
+
+  if (deferRecovery) {
+    deferred[make_pair(frameworkId, slaveId)] += resources;
+  } else {
+    allocator->resourcesRecovered(frameworkId, slaveId, resources);
+  }
+}
+
+
+void Master::recoverDeferredResources()
+{
+  typedef std::pair<FrameworkID, SlaveID> Key;
+  foreachpair (const Key& key, const Resources& resources, deferred) {
+    allocator->resourcesRecovered(key.first, key.second, resources);
+  }
+
+  deferred.clear();
+}
+
+
+void Master::expireOffers()
+{
+  const double now = Clock::now();
+
+  size_t expired = 0;
+
+  while (!offerExpiries.empty() && offerExpiries.begin()->first <= now) {
+    Offer* offer = getOffer(offerExpiries.begin()->second);
+    offerExpiries.erase(offerExpiries.begin());
+
+    if (offer != NULL) {
+      recoverResources(offer->framework_id(),
+                       offer->slave_id(),
+                       offer->resources(),
+                       offer->revocable());
+      removeOffer(offer, true); // Rescind!
+      expired++;
+    }
+  }
+
+  if (expired > 0) {
+    LOG(INFO) << "Rescinded " << expired << " offers that timed out";
+    offersExpired.increment(expired);
+  }
 }
 
 
@@ -1807,6 +2902,12 @@ void Master::removeOffer(Offer* offer, bool rescind)
   CHECK(framework != NULL);
   framework->removeOffer(offer);
 
+  // No need to rescind an offer the framework hasn't been sent yet.
+  if (framework->unsentOffers.contains(offer)) {
+    framework->unsentOffers.erase(offer);
+    rescind = false;
+  }
+
   // Remove from slave.
   Slave* slave = getSlave(offer->slave_id());
   CHECK(slave != NULL);
@@ -1816,11 +2917,13 @@ void Master::removeOffer(Offer* offer, bool rescind)
     RescindResourceOfferMessage message;
     message.mutable_offer_id()->MergeFrom(offer->id());
     send(framework->pid, message);
+    offersRescinded.increment();
   }
 
-  // Delete it.
+  // Reuse it (for another offer).
   offers.erase(offer->id());
-  delete offer;
+  offersOutstanding.decrement();
+  offerPool.put(offer);
 }
 
 
@@ -1844,6 +2947,16 @@ Slave* Master::getSlave(const SlaveID& slaveId)
 }
 
 
+string Master::shard(const SlaveID& slaveId) const
+{
+  if (shards.empty()) {
+    return "";
+  }
+
+  return shards[hash_value(slaveId) % shards.size()]->self();
+}
+
+
 Offer* Master::getOffer(const OfferID& offerId)
 {
   if (offers.count(offerId) > 0) {
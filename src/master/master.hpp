@@ -19,18 +19,26 @@
 #ifndef __MASTER_HPP__
 #define __MASTER_HPP__
 
+#include <deque>
+#include <list>
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <process/process.hpp>
 #include <process/protobuf.hpp>
 #include <process/timer.hpp>
 
+#include "common/flathashmap.hpp"
+#include "common/flatmultihashmap.hpp"
 #include "common/foreach.hpp"
 #include "common/hashmap.hpp"
 #include "common/hashset.hpp"
 #include "common/multihashmap.hpp"
+#include "common/pool.hpp"
 #include "common/resources.hpp"
+#include "common/statistics.hpp"
 #include "common/type_utils.hpp"
 #include "common/units.hpp"
 #include "common/utils.hpp"
@@ -39,6 +47,8 @@
 
 #include "master/constants.hpp"
 #include "master/http.hpp"
+#include "master/slave_health.hpp"
+#include "master/task_archive.hpp"
 
 #include "messages/messages.hpp"
 
@@ -51,10 +61,11 @@ using namespace process; // Included to make code easier to read.
 
 // Some forward declarations.
 class Allocator;
+class LogStorage;
+class SlaveShard;
 class SlavesManager;
 struct Framework;
 struct Slave;
-class SlaveObserver;
 
 
 class Master : public ProtobufProcess<Master>
@@ -83,6 +94,14 @@ public:
                    const OfferID& offerId,
                    const std::vector<TaskDescription>& tasks,
                    const Filters& filters);
+  void launchTasksBatch(const LaunchTasksBatchMessage& message);
+  void declineOffers(const FrameworkID& frameworkId,
+                     const std::vector<OfferID>& offerIds,
+                     const Filters& filters);
+  void queueTasks(const FrameworkID& frameworkId,
+                  const std::vector<TaskDescription>& tasks);
+  void reconcileTasks(const FrameworkID& frameworkId,
+                      const std::vector<TaskID>& taskIds);
   void reviveOffers(const FrameworkID& frameworkId);
   void killTask(const FrameworkID& frameworkId, const TaskID& taskId);
   void schedulerMessage(const SlaveID& slaveId,
@@ -90,12 +109,20 @@ public:
                         const ExecutorID& executorId,
                         const std::string& data);
   void registerSlave(const SlaveInfo& slaveInfo);
-  void reregisterSlave(const SlaveID& slaveId,
-                       const SlaveInfo& slaveInfo,
-                       const std::vector<ExecutorInfo>& executorInfos,
-                       const std::vector<Task>& tasks);
+  void reregisterSlave(const ReregisterSlaveMessage& message);
   void unregisterSlave(const SlaveID& slaveId);
   void statusUpdate(const StatusUpdate& update, const UPID& pid);
+  void statusUpdates(const StatusUpdatesMessage& message);
+
+  // Updates the tasks of the status updates that a shard got (see
+  // SlaveShard) and tells the shard where to forward them.
+  void shardedStatusUpdates(const PID<SlaveShard>& shard,
+                            uint64_t id,
+                            const StatusUpdatesMessage& message);
+
+  void executorUsage(const ExecutorUsageMessage& message);
+  void executorMemoryPressure(const ExecutorMemoryPressureMessage& message);
+
   void executorMessage(const SlaveID& slaveId,
                        const FrameworkID& frameworkId,
                        const ExecutorID& executorId,
@@ -106,7 +133,16 @@ public:
                       int32_t status);
   void activatedSlaveHostnamePort(const std::string& hostname, uint16_t port);
   void deactivatedSlaveHostnamePort(const std::string& hostname, uint16_t port);
+
+  // Like the above, but for many slaves at once (e.g., a rack), so
+  // that the connected slaves among them get removed in one go.
+  void activatedSlaveHostnamePorts(
+      const multihashmap<std::string, uint16_t>& hostnamePorts);
+  void deactivatedSlaveHostnamePorts(
+      const multihashmap<std::string, uint16_t>& hostnamePorts);
   void timerTick();
+  void pingTick();
+  void pong(const UPID& from, const std::string& body);
   void frameworkFailoverTimeout(const FrameworkID& frameworkId,
                                 double reregisteredTime);
 
@@ -116,14 +152,63 @@ public:
   // Return connected slaves that are not in the process of being removed
   std::vector<Slave*> getActiveSlaves() const;
 
-  void makeOffers(Framework* framework,
-                  const hashmap<Slave*, Resources>& offered);
+  // Returns the number of active slaves (unlike getActiveSlaves this
+  // can be dispatched, e.g., to wait for a local cluster's slaves).
+  size_t countActiveSlaves();
+
+  // Virtual so that allocators can be benchmarked with a simulated
+  // master (see allocator_bench.cpp). Revocable offers are made out
+  // of the slaves' slack (see Slave::slackFree).
+  virtual void makeOffers(Framework* framework,
+                          const hashmap<Slave*, Resources>& offered,
+                          bool revocable = false);
+
+  // Rescinds (and recovers the resources of) all of a framework's
+  // outstanding offers, e.g., so that an allocator can offer the
+  // resources to a starved framework instead.
+  void rescindOffers(Framework* framework);
+
+  // Tells the slave running a task to kill it, e.g., so that an
+  // allocator can offer its resources to a starved framework.
+  void preemptTask(Task* task);
+
+  // Sends a framework all of its unsent offers in one message.
+  void sendOffers(const FrameworkID& frameworkId);
+
+  // Sends a framework just one of its offers (if it's still around).
+  void sendOffer(const OfferID& offerId);
+
+  // Launches some of a framework's queued tasks on a slave (the
+  // allocator has to make sure they fit), removing them from the
+  // queue. The resources are held by an offer that never gets sent
+  // until the tasks get launched (after the allocation pass).
+  void placeTasks(Framework* framework,
+                  Slave* slave,
+                  const std::vector<TaskDescription>& tasks);
+
+  // Make offers decided on asynchronously (i.e., by an allocator
+  // running in its own process), as long as they're still valid.
+  void offer(const FrameworkID& frameworkId,
+             const hashmap<SlaveID, Resources>& resources);
+
+  // Gives the frameworks and slaves that changed since it was last
+  // invoked a new version of the state (see /state.json?since).
+  void updateStateVersion();
+
+  // Renders a snapshot of an HTTP endpoint (see http::Snapshots).
+  Future<HttpResponse> snapshot(const http::Snapshots::Renderer& renderer,
+                                const HttpRequest& request);
 
 protected:
   virtual void initialize();
   virtual void finalize();
   virtual void exited(const UPID& pid);
 
+  // Notes that any message from a slave means that it's alive (see
+  // SlaveHealth) before handling it.
+  virtual void visit(const MessageEvent& event);
+  using ProtobufProcess<Master>::visit;
+
   // Process a launch tasks request (for a non-cancelled offer) by
   // launching the desired tasks (if the offer contains a valid set of
   // tasks) and reporting any unused resources to the allocator.
@@ -147,21 +232,70 @@ protected:
   // Add a slave.
   void addSlave(Slave* slave, bool reregister = false);
 
-  void readdSlave(Slave* slave,
-		  const std::vector<ExecutorInfo>& executorInfos,
-		  const std::vector<Task>& tasks);
+  void readdSlave(
+      Slave* slave,
+      const google::protobuf::RepeatedPtrField<ExecutorInfo>& executorInfos,
+      const google::protobuf::RepeatedPtrField<Task>& tasks);
+
+  // Re-adds the slaves queued up by reregisterSlave, a limited number
+  // of tasks' worth at a time.
+  void readdSlaves();
 
   // Lose all of a slave's tasks and delete the slave object
   void removeSlave(Slave* slave);
 
   // Launch a task from a task description, and returned the consumed
-  // resources for the task and possibly it's executor.
+  // resources for the task and possibly it's executor. N.B. The task
+  // still needs to be sent to the slave (see processTasks).
   Resources launchTask(const TaskDescription& task,
                        Framework* framework,
-                       Slave* slave);
-
-  // Remove a task.
-  void removeTask(Task* task);
+                       Slave* slave,
+                       bool revocable);
+
+  // Tells the allocator about resources recovered from a framework,
+  // unless they were revocable (those get offered again as part of
+  // the slave's slack once it reports it).
+  void recoverResources(const FrameworkID& frameworkId,
+                        const SlaveID& slaveId,
+                        const Resources& resources,
+                        bool revocable);
+
+  // Gives the resources that recoverResources held on to while
+  // 'deferRecovery' was set back to the allocator, one call per
+  // framework and slave.
+  void recoverDeferredResources();
+
+  // Updates (and possibly removes) the task a status update is for.
+  // Returns the framework to pass the update on to, or NULL if the
+  // update isn't valid.
+  Framework* updateTask(const StatusUpdate& update);
+
+  // Returns the pid of the shard that handles the status updates of
+  // the slave (see SlaveShard), or "" if the master handles them.
+  std::string shard(const SlaveID& slaveId) const;
+
+  // Remove a task, recovering its resources unless they get offered
+  // right back to its framework (see reoffer).
+  void removeTask(Task* task, bool recover = true);
+
+  // Offers the resources freed by a task of a sticky framework (see
+  // FrameworkInfo::sticky) right back to the framework, for just
+  // STICKY_OFFER_TIMEOUT seconds.
+  void reoffer(Framework* framework,
+               Slave* slave,
+               const Resources& resources);
+
+  // Creates an offer (that expires after 'timeout' seconds, unless
+  // it's 0) and adds it to the framework and the slave.
+  Offer* createOffer(Framework* framework,
+                     Slave* slave,
+                     const Resources& resources,
+                     bool revocable,
+                     double timeout);
+
+  // Rescinds (and recovers the resources of) all of the offers that
+  // have been outstanding for longer than the offer timeout.
+  void expireOffers();
 
   // Remove an offer and optionally rescind the offer as well.
   void removeOffer(Offer* offer, bool rescind = false);
@@ -178,6 +312,8 @@ private:
 
   // TODO(benh): Remove once SimpleAllocator doesn't use Master::get*.
   friend class SimpleAllocator;
+  friend class SplittingAllocator;
+  friend class SimulatedMaster;
   friend struct SlaveRegistrar;
   friend struct SlaveReregistrar;
 
@@ -196,41 +332,103 @@ private:
       const Master& master,
       const HttpRequest& request);
 
+  friend Future<HttpResponse> http::json::memory(
+      const Master& master,
+      const HttpRequest& request);
+
+  friend Future<HttpResponse> http::json::resources(
+      const Master& master,
+      const HttpRequest& request);
+
+  friend Future<HttpResponse> http::json::tasks(
+      Master& master,
+      const HttpRequest& request);
+
   const Configuration conf;
 
   bool elected;
 
   Allocator* allocator;
+  LogStorage* storage; // Persists the state (if configured).
   SlavesManager* slavesManager;
+  http::Snapshots* snapshots;
+  std::vector<SlaveShard*> shards;
 
   MasterInfo info;
 
-  multihashmap<std::string, uint16_t> slaveHostnamePorts;
+  flatmultihashmap<std::string, uint16_t> slaveHostnamePorts;
+
+  // N.B. These (and the tables of tasks) get looked up and iterated
+  // over the most, hence are flat (see flathashmap.hpp).
+  flathashmap<FrameworkID, Framework*> frameworks;
+  flathashmap<SlaveID, Slave*> slaves;
+  flathashmap<OfferID, Offer*> offers;
 
-  hashmap<FrameworkID, Framework*> frameworks;
-  hashmap<SlaveID, Slave*> slaves;
-  hashmap<OfferID, Offer*> offers;
+  // Removed offers and tasks, kept around to be reused.
+  Pool<Offer> offerPool;
+  Pool<Task> taskPool;
+
+  // Whether recoverResources holds on to the resources (in
+  // 'deferred') rather than telling the allocator right away, so that
+  // the tasks a batch of status updates terminated give back their
+  // resources together (see Master::statusUpdates).
+  bool deferRecovery;
+  hashmap<std::pair<FrameworkID, SlaveID>, Resources> deferred;
+
+  // Whether the slaves are still alive (see Master::pingTick).
+  SlaveHealth health;
+
+  // Slaves waiting to be re-added (e.g., after a failover), in the
+  // order they re-registered, and the digest of the state each one
+  // will be re-added with (the latest state it sent, see readdSlaves).
+  std::deque<std::pair<UPID, ReregisterSlaveMessage> > reregistrations;
+  hashmap<SlaveID, std::string> reregistering;
 
   std::list<Framework> completedFrameworks;
 
+  // Version of the state shown by /state.json, the most recently
+  // removed slaves by the version they got removed in, and the oldest
+  // version that changes can still be computed since.
+  uint64_t stateVersion;
+  std::deque<std::pair<uint64_t, SlaveID> > removedSlaves;
+  uint64_t oldestStateVersion;
+
   double failoverTimeout; // Failover timeout for frameworks, in seconds.
 
+  // Seconds during which offers made after sending a framework some
+  // offers are held back (and then sent in one message).
+  double offerAggregationInterval;
+
+  // Seconds after which outstanding offers get rescinded (0 means
+  // never), and the offers by when they expire (sticky offers expire
+  // sooner, see STICKY_OFFER_TIMEOUT). Offers that get removed before
+  // they expire are skipped when they come due.
+  double offerTimeout;
+  std::multimap<double, OfferID> offerExpiries;
+
   int64_t nextFrameworkId; // Used to give each framework a unique ID.
   int64_t nextOfferId;     // Used to give each slot offer a unique ID.
   int64_t nextSlaveId;     // Used to give each slave a unique ID.
 
-  // Statistics (initialized in Master::initialize).
-  struct {
-    uint64_t tasks[TaskState_ARRAYSIZE];
-    uint64_t validStatusUpdates;
-    uint64_t invalidStatusUpdates;
-    uint64_t validFrameworkMessages;
-    uint64_t invalidFrameworkMessages;
-  } stats;
+  // Statistics (also exported at /metrics).
+  internal::Statistics stats;
+
+  // Metrics of the offers made and of the time it took the launched
+  // tasks to get running (or fail, etc.), i.e., to leave TASK_STARTING.
+  process::metrics::Counter offersMade;
+  process::metrics::Counter offersRescinded;
+  process::metrics::Counter offersExpired;
+  process::metrics::Gauge offersOutstanding;
+  process::metrics::Timer launchLatency;
+
+  // Tasks that haven't left TASK_STARTING yet, and when they were
+  // launched (see launchLatency).
+  hashmap<Task*, double> launching;
 
   double startTime; // Start time used to calculate uptime.
 
   process::timer timerTickTimer;
+  process::timer pingTickTimer;
 };
 
 
@@ -246,20 +444,25 @@ struct Slave
       pid(_pid),
       active(true),
       registeredTime(time),
-      lastHeartbeat(time) {}
+      lastHeartbeat(time),
+      version(0),
+      dirty(true),
+      modified(0),
+      stale(true) {}
 
   ~Slave() {}
 
   Task* getTask(const FrameworkID& frameworkId, const TaskID& taskId)
   {
-    foreachvalue (Task* task, tasks) {
-      if (task->framework_id() == frameworkId &&
-          task->task_id() == taskId) {
-        return task;
-      }
-    }
+    flathashmap<std::pair<FrameworkID, TaskID>, Task*>::const_iterator it =
+      tasks.find(std::make_pair(frameworkId, taskId));
+    return it != tasks.end() ? it->second : NULL;
+  }
 
-    return NULL;
+  // Returns true if the slave is running any tasks of a framework.
+  bool hasTasks(const FrameworkID& frameworkId)
+  {
+    return taskCounts.contains(frameworkId);
   }
 
   void addTask(Task* task)
@@ -268,9 +471,15 @@ struct Slave
       std::make_pair(task->framework_id(), task->task_id());
     CHECK(tasks.count(key) == 0);
     tasks[key] = task;
+    taskCounts[task->framework_id()]++;
     VLOG(1) << "Adding task with resources " << task->resources()
 	    << " on slave " << id;
-    resourcesInUse += task->resources();
+    if (task->revocable()) {
+      resourcesRevocable += task->resources();
+    } else {
+      resourcesInUse += task->resources();
+      changed();
+    }
   }
 
   void removeTask(Task* task)
@@ -279,9 +488,17 @@ struct Slave
       std::make_pair(task->framework_id(), task->task_id());
     CHECK(tasks.count(key) > 0);
     tasks.erase(key);
+    if (--taskCounts[task->framework_id()] == 0) {
+      taskCounts.erase(task->framework_id());
+    }
     VLOG(1) << "Removing task with resources " << task->resources()
 	    << " on slave " << id;
-    resourcesInUse -= task->resources();
+    if (task->revocable()) {
+      resourcesRevocable -= task->resources();
+    } else {
+      resourcesInUse -= task->resources();
+      changed();
+    }
   }
 
   void addOffer(Offer* offer)
@@ -290,7 +507,12 @@ struct Slave
     offers.insert(offer);
     VLOG(1) << "Adding offer with resources " << offer->resources()
 	    << " on slave " << id;
-    resourcesOffered += offer->resources();
+    if (offer->revocable()) {
+      resourcesRevocable += offer->resources();
+    } else {
+      resourcesOffered += offer->resources();
+      changed();
+    }
   }
 
   void removeOffer(Offer* offer)
@@ -299,7 +521,12 @@ struct Slave
     offers.erase(offer);
     VLOG(1) << "Removing offer with resources " << offer->resources()
 	    << " on slave " << id;
-    resourcesOffered -= offer->resources();
+    if (offer->revocable()) {
+      resourcesRevocable -= offer->resources();
+    } else {
+      resourcesOffered -= offer->resources();
+      changed();
+    }
   }
 
   bool hasExecutor(const FrameworkID& frameworkId,
@@ -309,14 +536,29 @@ struct Slave
       executors[frameworkId].contains(executorId);
   }
 
+  // Returns true if the executor was launched from a revocable offer.
+  bool isRevocable(const FrameworkID& frameworkId,
+                   const ExecutorID& executorId)
+  {
+    return revocable.contains(frameworkId) &&
+      revocable[frameworkId].contains(executorId);
+  }
+
   void addExecutor(const FrameworkID& frameworkId,
-		   const ExecutorInfo& executorInfo)
+		   const ExecutorInfo& executorInfo,
+                   bool revocable = false)
   {
     CHECK(!hasExecutor(frameworkId, executorInfo.executor_id()));
     executors[frameworkId][executorInfo.executor_id()] = executorInfo;
 
     // Update the resources in use to reflect running this executor.
-    resourcesInUse += executorInfo.resources();
+    if (revocable) {
+      this->revocable[frameworkId].insert(executorInfo.executor_id());
+      resourcesRevocable += executorInfo.resources();
+    } else {
+      resourcesInUse += executorInfo.resources();
+      changed();
+    }
   }
 
   void removeExecutor(const FrameworkID& frameworkId,
@@ -324,24 +566,53 @@ struct Slave
   {
     if (hasExecutor(frameworkId, executorId)) {
       // Update the resources in use to reflect removing this executor.
-      resourcesInUse -= executors[frameworkId][executorId].resources();
+      if (isRevocable(frameworkId, executorId)) {
+        resourcesRevocable -= executors[frameworkId][executorId].resources();
+        revocable[frameworkId].erase(executorId);
+        if (revocable[frameworkId].size() == 0) {
+          revocable.erase(frameworkId);
+        }
+      } else {
+        resourcesInUse -= executors[frameworkId][executorId].resources();
+        changed();
+      }
 
       executors[frameworkId].erase(executorId);
       if (executors[frameworkId].size() == 0) {
         executors.erase(frameworkId);
       }
+
+      if (usage.contains(frameworkId)) {
+        usage[frameworkId].erase(executorId);
+        if (usage[frameworkId].size() == 0) {
+          usage.erase(frameworkId);
+        }
+        dirty = true;
+      }
     }
   }
 
-  Resources resourcesFree()
+  // Returns the resources that are neither offered nor in use, which
+  // only get recomputed after they have changed.
+  const Resources& resourcesFree()
+  {
+    if (stale) {
+      resourcesCached = info.resources();
+      resourcesCached -= resourcesOffered;
+      resourcesCached -= resourcesInUse;
+      stale = false;
+    }
+
+    return resourcesCached;
+  }
+
+  // Returns the slack (as last reported) that is neither offered nor
+  // in use by revocable tasks and executors.
+  Resources slackFree() const
   {
-    Resources resources = info.resources() - (resourcesOffered + resourcesInUse);
-    VLOG(1) << "Calculating resources free on slave " << id << std::endl
-	    << "    Resources: " << info.resources() << std::endl
-	    << "    Resources Offered: " << resourcesOffered << std::endl
-	    << "    Resources In Use: " << resourcesInUse << std::endl
-	    << "    Resources Free: " << resources << std::endl;
-    return resources;
+    Resources resources = slack;
+    resources -= resourcesRevocable;
+    return resources.allocatable();
   }
 
   const SlaveID id;
@@ -353,19 +624,55 @@ struct Slave
   double registeredTime;
   double lastHeartbeat;
 
+  // N.B. Only change these via the functions above so that the free
+  // resources get recomputed.
   Resources resourcesOffered; // Resources currently in offers.
   Resources resourcesInUse;   // Resources currently used by tasks.
 
+  // Resources that the slave's executors have been allocated but
+  // aren't using (as last reported), and the part of them that is
+  // offered or in use by revocable tasks and executors (which isn't
+  // included in the resources offered or in use above).
+  Resources slack;
+  Resources resourcesRevocable;
+
+  // Incremented whenever the free resources change, so that, e.g.,
+  // an allocator can skip the slaves that haven't changed.
+  uint64_t version;
+
+  // Whether what /state.json shows about the slave changed since the
+  // master last versioned its state, and the version of the state in
+  // which it last changed (see Master::updateStateVersion).
+  bool dirty;
+  uint64_t modified;
+
   // Executors running on this slave.
   hashmap<FrameworkID, hashmap<ExecutorID, ExecutorInfo> > executors;
 
+  // Resources the executors actually used (as last reported).
+  hashmap<FrameworkID, hashmap<ExecutorID, ExecutorUsage> > usage;
+
+  // Executors launched from revocable offers.
+  hashmap<FrameworkID, hashset<ExecutorID> > revocable;
+
   // Tasks running on this slave, indexed by FrameworkID x TaskID.
-  hashmap<std::pair<FrameworkID, TaskID>, Task*> tasks;
+  flathashmap<std::pair<FrameworkID, TaskID>, Task*> tasks;
+
+  // Number of tasks of each framework running on this slave.
+  hashmap<FrameworkID, size_t> taskCounts;
 
   // Active offers on this slave.
   hashset<Offer*> offers;
 
-  SlaveObserver* observer;
+private:
+  void changed()
+  {
+    version++;
+    stale = true;
+  }
+
+  bool stale;
+  Resources resourcesCached;
 };
 
 
@@ -381,17 +688,18 @@ struct Framework
       pid(_pid),
       active(true),
       registeredTime(time),
-      reregisteredTime(time) {}
+      reregisteredTime(time),
+      completedTasks(_id, MAX_COMPLETED_TASKS_PER_FRAMEWORK),
+      offersSent(0),
+      dirty(true),
+      modified(0) {}
 
   ~Framework() {}
 
   Task* getTask(const TaskID& taskId)
   {
-    if (tasks.count(taskId) > 0) {
-      return tasks[taskId];
-    } else {
-      return NULL;
-    }
+    flathashmap<TaskID, Task*>::const_iterator it = tasks.find(taskId);
+    return it != tasks.end() ? it->second : NULL;
   }
 
   void addTask(Task* task)
@@ -399,20 +707,18 @@ struct Framework
     CHECK(!tasks.contains(task->task_id()));
     tasks[task->task_id()] = task;
     resources += task->resources();
+    dirty = true;
   }
 
   void removeTask(Task* task)
   {
     CHECK(tasks.contains(task->task_id()));
 
-    completedTasks.push_back(*task);
-
-    if (completedTasks.size() > MAX_COMPLETED_TASKS_PER_FRAMEWORK) {
-      completedTasks.pop_front();
-    }
+    completedTasks.add(*task);
 
     tasks.erase(task->task_id());
     resources -= task->resources();
+    dirty = true;
   }
 
   void addOffer(Offer* offer)
@@ -420,6 +726,7 @@ struct Framework
     CHECK(!offers.contains(offer));
     offers.insert(offer);
     resources += offer->resources();
+    dirty = true;
   }
 
   void removeOffer(Offer* offer)
@@ -427,6 +734,22 @@ struct Framework
     CHECK(offers.find(offer) != offers.end());
     offers.erase(offer);
     resources -= offer->resources();
+    dirty = true;
+  }
+
+  // Removes a task from the queue, returning false if it's not queued.
+  bool dequeue(const TaskID& taskId)
+  {
+    std::list<TaskDescription>::iterator it = queued.begin();
+    for (; it != queued.end(); ++it) {
+      if (it->task_id() == taskId) {
+        queued.erase(it);
+        dirty = true;
+        return true;
+      }
+    }
+
+    return false;
   }
 
   bool hasExecutor(const SlaveID& slaveId,
@@ -444,6 +767,7 @@ struct Framework
 
     // Update our resources to reflect running this executor.
     resources += executorInfo.resources();
+    dirty = true;
   }
 
   void removeExecutor(const SlaveID& slaveId,
@@ -452,6 +776,7 @@ struct Framework
     if (hasExecutor(slaveId, executorId)) {
       // Update our resources to reflect removing this executor.
       resources -= executors[slaveId][executorId].resources();
+      dirty = true;
 
       executors[slaveId].erase(executorId);
       if (executors[slaveId].size() == 0) {
@@ -460,21 +785,6 @@ struct Framework
     }
   }
 
-  bool filters(Slave* slave, Resources resources)
-  {
-    // TODO: Implement other filters
-    return slaveFilter.find(slave) != slaveFilter.end();
-  }
-
-  void removeExpiredFilters(double now)
-  {
-    foreachpair (Slave* slave, double removalTime, utils::copy(slaveFilter)) {
-      if (removalTime != 0 && removalTime <= now) {
-        slaveFilter.erase(slave);
-      }
-    }
-  }
-
   const FrameworkID id;
   const FrameworkInfo info;
 
@@ -485,19 +795,32 @@ struct Framework
   double reregisteredTime;
   double unregisteredTime;
 
-  hashmap<TaskID, Task*> tasks;
+  flathashmap<TaskID, Task*> tasks;
 
-  std::list<Task> completedTasks;
+  // The most recently completed tasks (compressed, see TaskArchive).
+  TaskArchive completedTasks;
 
   hashset<Offer*> offers; // Active offers for framework.
 
+  // Offers that have been made but not yet sent to the framework (see
+  // Master::sendOffers) and when offers were last sent.
+  hashset<Offer*> unsentOffers;
+  double offersSent;
+
   Resources resources; // Total resources (tasks + offers + executors).
 
+  // Tasks queued to be launched wherever they fit, in the order they
+  // were queued (see SchedulerDriver::queueTasks).
+  std::list<TaskDescription> queued;
+
   hashmap<SlaveID, hashmap<ExecutorID, ExecutorInfo> > executors;
 
-  // Contains a time of unfiltering for each slave we've filtered,
-  // or 0 for slaves that we want to keep filtered forever
-  hashmap<Slave*, double> slaveFilter;
+  // Whether what /state.json shows about the framework (including
+  // its tasks) changed since the master last versioned its state, and
+  // the version of the state in which it last changed (see
+  // Master::updateStateVersion).
+  bool dirty;
+  uint64_t modified;
 };
 
 } // namespace master {
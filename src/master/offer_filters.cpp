@@ -0,0 +1,180 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/utils.hpp"
+
+#include "master/offer_filters.hpp"
+
+using std::make_pair;
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+const double OfferFilters::REFUSED = -1;
+
+
+void OfferFilters::add(
+    const FrameworkID& frameworkId,
+    const SlaveID& slaveId,
+    const Resources& resources,
+    double expires)
+{
+  remove(frameworkId, slaveId);
+
+  Filter& filter = filters[frameworkId][slaveId];
+  filter.resources = resources;
+  filter.expires = expires;
+
+  slaves[slaveId].insert(frameworkId);
+
+  if (expires != 0) {
+    timeouts.insert(make_pair(expires, make_pair(frameworkId, slaveId)));
+  }
+}
+
+
+void OfferFilters::refuse(
+    const FrameworkID& frameworkId,
+    const SlaveID& slaveId,
+    const Resources& resources)
+{
+  remove(frameworkId, slaveId);
+
+  Filter& filter = filters[frameworkId][slaveId];
+  filter.resources = resources;
+  filter.expires = REFUSED;
+
+  slaves[slaveId].insert(frameworkId);
+  refused[slaveId]++;
+}
+
+
+bool OfferFilters::filtered(
+    const FrameworkID& frameworkId,
+    const SlaveID& slaveId,
+    const Resources& resources) const
+{
+  hashmap<FrameworkID, hashmap<SlaveID, Filter> >::const_iterator iterator =
+    filters.find(frameworkId);
+
+  if (iterator != filters.end()) {
+    hashmap<SlaveID, Filter>::const_iterator filter =
+      iterator->second.find(slaveId);
+    if (filter != iterator->second.end()) {
+      return resources <= filter->second.resources;
+    }
+  }
+
+  return false;
+}
+
+
+size_t OfferFilters::refusals(const SlaveID& slaveId) const
+{
+  hashmap<SlaveID, size_t>::const_iterator iterator = refused.find(slaveId);
+  return iterator != refused.end() ? iterator->second : 0;
+}
+
+
+void OfferFilters::clear(const SlaveID& slaveId)
+{
+  if (refused.contains(slaveId)) {
+    foreach (const FrameworkID& frameworkId, utils::copy(slaves[slaveId])) {
+      if (filters[frameworkId][slaveId].expires == REFUSED) {
+        remove(frameworkId, slaveId);
+      }
+    }
+  }
+}
+
+
+void OfferFilters::remove(const FrameworkID& frameworkId)
+{
+  if (filters.contains(frameworkId)) {
+    foreachkey (const SlaveID& slaveId, utils::copy(filters[frameworkId])) {
+      remove(frameworkId, slaveId);
+    }
+  }
+}
+
+
+void OfferFilters::remove(const SlaveID& slaveId)
+{
+  if (slaves.contains(slaveId)) {
+    foreach (const FrameworkID& frameworkId, utils::copy(slaves[slaveId])) {
+      remove(frameworkId, slaveId);
+    }
+  }
+}
+
+
+size_t OfferFilters::expire(double now)
+{
+  size_t expired = 0;
+
+  while (!timeouts.empty() && timeouts.begin()->first <= now) {
+    double expires = timeouts.begin()->first;
+    const FrameworkID frameworkId = timeouts.begin()->second.first;
+    const SlaveID slaveId = timeouts.begin()->second.second;
+
+    timeouts.erase(timeouts.begin());
+
+    // Skip the filter if it has since been replaced or removed.
+    if (filters.contains(frameworkId) &&
+        filters[frameworkId].contains(slaveId) &&
+        filters[frameworkId][slaveId].expires == expires) {
+      remove(frameworkId, slaveId);
+      expired++;
+    }
+  }
+
+  return expired;
+}
+
+
+void OfferFilters::remove(
+    const FrameworkID& frameworkId,
+    const SlaveID& slaveId)
+{
+  if (!filters.contains(frameworkId) ||
+      !filters[frameworkId].contains(slaveId)) {
+    return;
+  }
+
+  if (filters[frameworkId][slaveId].expires == REFUSED) {
+    if (--refused[slaveId] == 0) {
+      refused.erase(slaveId);
+    }
+  }
+
+  filters[frameworkId].erase(slaveId);
+  if (filters[frameworkId].empty()) {
+    filters.erase(frameworkId);
+  }
+
+  slaves[slaveId].erase(frameworkId);
+  if (slaves[slaveId].empty()) {
+    slaves.erase(slaveId);
+  }
+}
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,115 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __OFFER_FILTERS_HPP__
+#define __OFFER_FILTERS_HPP__
+
+#include <map>
+#include <utility>
+
+#include <mesos/mesos.hpp>
+
+#include "common/hashmap.hpp"
+#include "common/hashset.hpp"
+#include "common/resources.hpp"
+#include "common/type_utils.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// Keeps track of which resources each framework doesn't want to be
+// offered on each slave (e.g., because it refused them). A filter
+// only applies to offers of (at most) the filtered resources, so a
+// slave gets offered to the framework again as soon as it has more
+// resources free. Checking whether an offer is filtered is a constant
+// time lookup and expiring filters only looks at the expired ones.
+// Each framework has at most one filter per slave (the most recent).
+class OfferFilters
+{
+public:
+  // Filters offers of at most the specified resources on a slave to
+  // a framework until 'expires' (or until removed if 'expires' is 0).
+  void add(const FrameworkID& frameworkId,
+           const SlaveID& slaveId,
+           const Resources& resources,
+           double expires);
+
+  // Filters offers of at most the specified resources on a slave to
+  // a framework because the framework refused them. Unlike a filter
+  // added via 'add' a refusal doesn't expire, but all the refusals on
+  // a slave can be cleared (e.g., once everyone has refused it).
+  void refuse(const FrameworkID& frameworkId,
+              const SlaveID& slaveId,
+              const Resources& resources);
+
+  // Returns true if offering the specified resources on a slave to a
+  // framework should be avoided.
+  bool filtered(const FrameworkID& frameworkId,
+                const SlaveID& slaveId,
+                const Resources& resources) const;
+
+  // Returns the number of frameworks that have refused a slave.
+  size_t refusals(const SlaveID& slaveId) const;
+
+  // Removes the refusals (but not the other filters) on a slave.
+  void clear(const SlaveID& slaveId);
+
+  // Removes all filters of a framework (e.g., when it revives offers
+  // or gets removed).
+  void remove(const FrameworkID& frameworkId);
+
+  // Removes all filters on a slave (e.g., when it gets removed).
+  void remove(const SlaveID& slaveId);
+
+  // Removes the filters that expire at or before 'now', returning
+  // how many were removed.
+  size_t expire(double now);
+
+private:
+  struct Filter
+  {
+    Resources resources;
+    double expires; // Or REFUSED for a refusal.
+  };
+
+  static const double REFUSED;
+
+  void remove(const FrameworkID& frameworkId, const SlaveID& slaveId);
+
+  // Filters indexed by framework and then slave, and the frameworks
+  // with filters on each slave (so that removing a slave doesn't
+  // need to look at every framework).
+  hashmap<FrameworkID, hashmap<SlaveID, Filter> > filters;
+  hashmap<SlaveID, hashset<FrameworkID> > slaves;
+
+  // Number of refusals on each slave.
+  hashmap<SlaveID, size_t> refused;
+
+  // Filters ordered by when they expire. Entries are not removed when
+  // a filter is replaced or removed but are skipped (when they come
+  // due) if the filter no longer expires at that time.
+  std::multimap<double, std::pair<FrameworkID, SlaveID> > timeouts;
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __OFFER_FILTERS_HPP__
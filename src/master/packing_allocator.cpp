@@ -0,0 +1,192 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "master/packing_allocator.hpp"
+
+using std::make_pair;
+using std::pair;
+using std::sort;
+using std::vector;
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+namespace {
+
+// Cpus and memory of a task (or slave), which is all that slaves get
+// packed by.
+struct Size
+{
+  Size(const Resources& resources)
+  {
+    Value::Scalar none;
+    cpus = resources.get("cpus", none).value();
+    mem = resources.get("mem", none).value();
+  }
+
+  Size(double _cpus, double _mem) : cpus(_cpus), mem(_mem) {}
+
+  double cpus;
+  double mem;
+};
+
+
+// Returns the average size of the framework's running tasks (or the
+// smallest task that gets offered if it has none).
+Size demand(Framework* framework)
+{
+  if (framework->tasks.empty()) {
+    return Size(MIN_CPUS, MIN_MEM);
+  }
+
+  double cpus = 0.0;
+  double mem = 0.0;
+  foreachvalue (Task* task, framework->tasks) {
+    Size size(task->resources());
+    cpus += size.cpus;
+    mem += size.mem;
+  }
+
+  return Size(cpus / framework->tasks.size(), mem / framework->tasks.size());
+}
+
+
+// Key that the slaves offered to a framework get sorted by: slaves
+// that have room for the demand, then slaves already running tasks,
+// then the fraction of the slave that would be left over.
+struct Fit
+{
+  Fit(Slave* slave, const Resources& available, const Size& demand)
+  {
+    Size free(available);
+    Size total(slave->info.resources());
+
+    fits = free.cpus >= demand.cpus && free.mem >= demand.mem;
+    idle = slave->tasks.empty();
+    left = (total.cpus > 0 ? (free.cpus - demand.cpus) / total.cpus : 0) +
+      (total.mem > 0 ? (free.mem - demand.mem) / total.mem : 0);
+  }
+
+  bool operator < (const Fit& that) const
+  {
+    if (fits != that.fits) {
+      return fits;
+    } else if (idle != that.idle) {
+      return !idle;
+    }
+    return left < that.left;
+  }
+
+  bool fits;
+  bool idle;
+  double left;
+};
+
+} // namespace {
+
+
+void PackingAllocator::makeNewOffers(hashmap<Slave*, Resources> available)
+{
+  CHECK(initialized) << "Cannot make new offers before initialization!";
+
+  if (available.size() == 0) {
+    VLOG(1) << "No resources available to allocate!";
+    return;
+  }
+
+  vector<Framework*> ordering = getAllocationOrdering();
+  if (ordering.empty()) {
+    VLOG(1) << "No frameworks to allocate resources!";
+    return;
+  }
+
+  // Clear refusals on any slave that has been refused by everyone.
+  foreachkey (Slave* slave, available) {
+    if (offerFilters.refusals(slave->id) == ordering.size()) {
+      VLOG(1) << "Clearing refusals for slave " << slave->id
+              << " because EVERYONE has refused resources from it";
+      offerFilters.clear(slave->id);
+    }
+  }
+
+  makeRequestedOffers(ordering, available);
+  makeReservedOffers(ordering, available);
+  placeQueuedTasks(ordering, available);
+
+  foreach (Framework* framework, ordering) {
+    if (available.empty()) {
+      break;
+    }
+
+    const Size size = demand(framework);
+
+    vector<pair<Fit, Slave*> > candidates;
+    foreachpair (Slave* slave, const Resources& resources, available) {
+      if (!filtered(framework, slave, resources)) {
+        candidates.push_back(
+            make_pair(Fit(slave, resources, size), slave));
+      }
+    }
+
+    if (candidates.empty()) {
+      continue;
+    }
+
+    sort(candidates.begin(), candidates.end());
+
+    hashmap<Slave*, Resources> offerable;
+    for (size_t i = 0; i < candidates.size(); i++) {
+      // Only offer slaves without room for the demand if none of the
+      // slaves have room.
+      if (offerable.size() == slaves ||
+          (!candidates[i].first.fits && candidates[0].first.fits)) {
+        break;
+      }
+
+      Slave* slave = candidates[i].second;
+
+      VLOG(1) << "Offering " << available[slave]
+              << " on slave " << slave->id
+              << " to framework " << framework->id;
+
+      offerable[slave] = available[slave];
+    }
+
+    foreachkey (Slave* slave, offerable) {
+      available.erase(slave);
+    }
+
+    makeOffers(framework, offerable);
+
+    foreachkey (Slave* slave, offerable) {
+      update(slave);
+    }
+  }
+}
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,60 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __PACKING_ALLOCATOR_HPP__
+#define __PACKING_ALLOCATOR_HPP__
+
+#include "common/hashmap.hpp"
+
+#include "master/constants.hpp"
+#include "master/simple_allocator.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// An allocator that packs tasks onto as few slaves as possible
+// rather than offering each framework every available slave. Each
+// framework gets offered at most 'slaves' slaves per allocation
+// pass, picked best fit first: slaves that are already running
+// tasks before idle ones, and among those the slaves that would have
+// the least cpus and memory left (relative to their size) after
+// running a task of the framework's typical size (the average of its
+// running tasks). Slaves without room for such a task are only
+// offered if no slave has. This leaves big slaves whole for big
+// tasks and lets idle slaves stay idle (e.g., to be powered down).
+class PackingAllocator : public SimpleAllocator
+{
+public:
+  PackingAllocator(size_t _slaves = PACKING_SLAVES) : slaves(_slaves) {}
+
+  virtual ~PackingAllocator() {}
+
+protected:
+  virtual void makeNewOffers(hashmap<Slave*, Resources> available);
+
+private:
+  const size_t slaves;
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __PACKING_ALLOCATOR_HPP__
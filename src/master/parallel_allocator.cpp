@@ -0,0 +1,286 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <glog/logging.h>
+
+#include <tr1/memory>
+
+#include <process/dispatch.hpp>
+#include <process/process.hpp>
+
+#include "master/offer_filters.hpp"
+#include "master/parallel_allocator.hpp"
+
+using process::Future;
+
+using std::list;
+using std::pair;
+using std::vector;
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// Everything a worker needs to assign slaves to frameworks, copied
+// from the allocator when a pass starts so that the workers never
+// look at the master's (or allocator's) state.
+struct AllocationSnapshot
+{
+  vector<FrameworkID> ordering;
+  OfferFilters filters;
+};
+
+
+class AllocationWorker : public process::Process<AllocationWorker>
+{
+public:
+  // Assigns each slave to the first framework (in the ordering) that
+  // isn't filtering the slave's free resources.
+  hashmap<SlaveID, FrameworkID> assign(
+      const std::tr1::shared_ptr<AllocationSnapshot>& snapshot,
+      const vector<pair<SlaveID, Resources> >& slaves)
+  {
+    hashmap<SlaveID, FrameworkID> assignments;
+
+    typedef pair<SlaveID, Resources> Available;
+    foreach (const Available& available, slaves) {
+      foreach (const FrameworkID& frameworkId, snapshot->ordering) {
+        if (!snapshot->filters.filtered(frameworkId,
+                                        available.first,
+                                        available.second)) {
+          assignments[available.first] = frameworkId;
+          break;
+        }
+      }
+    }
+
+    return assignments;
+  }
+};
+
+
+ParallelAllocator::~ParallelAllocator()
+{
+  foreach (AllocationWorker* worker, shards) {
+    process::terminate(worker);
+    process::wait(worker);
+    delete worker;
+  }
+}
+
+
+void ParallelAllocator::initialize(Master* _master)
+{
+  SimpleAllocator::initialize(_master);
+
+  CHECK(workers > 0);
+
+  for (size_t i = 0; i < workers; i++) {
+    AllocationWorker* worker = new AllocationWorker();
+    process::spawn(worker);
+    shards.push_back(worker);
+  }
+}
+
+
+void ParallelAllocator::frameworkRemoved(Framework* framework)
+{
+  frameworks.erase(framework->id);
+  SimpleAllocator::frameworkRemoved(framework);
+}
+
+
+void ParallelAllocator::slaveRemoved(Slave* slave)
+{
+  slaves.erase(slave->id);
+  pending.erase(slave->id);
+  SimpleAllocator::slaveRemoved(slave);
+}
+
+
+void ParallelAllocator::makeNewOffers(hashmap<Slave*, Resources> available)
+{
+  CHECK(initialized) << "Cannot make new offers before initialization!";
+
+  commit();
+
+  if (available.empty() || available.size() < minimum) {
+    SimpleAllocator::makeNewOffers(available);
+    return;
+  }
+
+  if (allocating) {
+    // Allocate these slaves once the pass in progress is done.
+    foreachkey (Slave* slave, available) {
+      pending[slave->id] = slave;
+    }
+    return;
+  }
+
+  vector<Framework*> sorted = getAllocationOrdering();
+  if (sorted.empty()) {
+    VLOG(1) << "No frameworks to allocate resources!";
+    return;
+  }
+
+  // Clear refusals on any slave that has been refused by everyone.
+  foreachkey (Slave* slave, available) {
+    if (offerFilters.refusals(slave->id) == sorted.size()) {
+      VLOG(1) << "Clearing refusals for slave " << slave->id
+              << " because EVERYONE has refused resources from it";
+      offerFilters.clear(slave->id);
+    }
+  }
+
+  // Resource requests, reservations and queued tasks are matched
+  // before the pass gets split up.
+  makeRequestedOffers(sorted, available);
+  makeReservedOffers(sorted, available);
+  placeQueuedTasks(sorted, available);
+
+  if (available.empty()) {
+    return;
+  }
+
+  std::tr1::shared_ptr<AllocationSnapshot> snapshot(new AllocationSnapshot());
+  snapshot->filters = offerFilters;
+
+  ordering.clear();
+  frameworks.clear();
+
+  foreach (Framework* framework, sorted) {
+    snapshot->ordering.push_back(framework->id);
+    ordering.push_back(framework->id);
+    frameworks[framework->id] = framework;
+  }
+
+  // Deal the slaves out to the workers.
+  vector<vector<pair<SlaveID, Resources> > > partitions(shards.size());
+
+  slaves.clear();
+
+  size_t index = 0;
+  foreachpair (Slave* slave, const Resources& resources, available) {
+    partitions[index++ % shards.size()].push_back(
+        std::make_pair(slave->id, resources));
+    slaves[slave->id] = slave;
+  }
+
+  list<Future<Assignments> > futures;
+
+  for (size_t i = 0; i < shards.size(); i++) {
+    futures.push_back(process::dispatch(
+        shards[i], &AllocationWorker::assign, snapshot, partitions[i]));
+  }
+
+  VLOG(1) << "Allocating " << available.size() << " slaves to "
+          << sorted.size() << " frameworks using "
+          << shards.size() << " workers";
+
+  pass = process::collect(futures);
+  allocating = true;
+}
+
+
+void ParallelAllocator::commit()
+{
+  if (!allocating || pass.isPending()) {
+    return;
+  }
+
+  allocating = false;
+
+  if (!pass.isReady()) {
+    LOG(ERROR) << "Failed to allocate slaves in parallel: "
+               << (pass.isFailed() ? pass.failure() : "discarded");
+
+    // Try these slaves again with the next pass.
+    foreachpair (const SlaveID& slaveId, Slave* slave, slaves) {
+      pending[slaveId] = slave;
+    }
+  } else {
+    // Collect the offers for each framework, skipping any slaves that
+    // were removed or no longer have (or are filtering) the resources.
+    hashmap<FrameworkID, hashmap<Slave*, Resources> > offers;
+
+    foreach (const Assignments& assignments, pass.get()) {
+      foreachpair (const SlaveID& slaveId,
+                   const FrameworkID& frameworkId,
+                   assignments) {
+        if (!slaves.contains(slaveId) || !frameworks.contains(frameworkId)) {
+          continue;
+        }
+
+        Slave* slave = slaves[slaveId];
+
+        update(slave);
+
+        if (unallocated.contains(slave) &&
+            !filtered(frameworks[frameworkId], slave, unallocated[slave])) {
+          offers[frameworkId][slave] = unallocated[slave];
+        }
+      }
+    }
+
+    // Make the offers in the order the frameworks were allocated.
+    foreach (const FrameworkID& frameworkId, ordering) {
+      if (offers.contains(frameworkId) && frameworks.contains(frameworkId)) {
+        Framework* framework = frameworks[frameworkId];
+
+        if (framework->active) {
+          foreachpair (Slave* slave, const Resources& resources,
+                       offers[frameworkId]) {
+            VLOG(1) << "Offering " << resources
+                    << " on slave " << slave->id
+                    << " to framework " << framework->id;
+          }
+
+          makeOffers(framework, offers[frameworkId]);
+
+          foreachkey (Slave* slave, offers[frameworkId]) {
+            update(slave);
+          }
+        }
+      }
+    }
+  }
+
+  ordering.clear();
+  frameworks.clear();
+  slaves.clear();
+
+  if (!pending.empty()) {
+    hashmap<Slave*, Resources> available;
+
+    foreachvalue (Slave* slave, pending) {
+      update(slave);
+      if (unallocated.contains(slave)) {
+        available[slave] = unallocated[slave];
+      }
+    }
+
+    pending.clear();
+
+    makeNewOffers(available);
+  }
+}
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
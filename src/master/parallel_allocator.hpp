@@ -0,0 +1,98 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __PARALLEL_ALLOCATOR_HPP__
+#define __PARALLEL_ALLOCATOR_HPP__
+
+#include <list>
+#include <vector>
+
+#include <process/future.hpp>
+
+#include "common/hashmap.hpp"
+
+#include "master/constants.hpp"
+#include "master/simple_allocator.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+class AllocationWorker;
+
+
+// An allocator that (unlike the SimpleAllocator) doesn't make the
+// master wait while it decides which framework to offer each slave
+// to. Instead it partitions the slaves into shards and has a set of
+// worker processes (i.e., threads) assign each shard's slaves using a
+// snapshot of the framework ordering and offer filters. The offers
+// get made by the master on the first allocation pass (or timer tick)
+// after all the workers have finished, re-checking that each slave
+// still has the resources free. Passes with fewer than 'minimum'
+// slaves are made right away, just like with the SimpleAllocator.
+class ParallelAllocator : public SimpleAllocator
+{
+public:
+  ParallelAllocator(size_t _workers = ALLOCATION_WORKERS,
+                    size_t _minimum = PARALLEL_ALLOCATION_SLAVES)
+    : workers(_workers), minimum(_minimum), allocating(false) {}
+
+  virtual ~ParallelAllocator();
+
+  virtual void initialize(Master* _master);
+
+  virtual void frameworkRemoved(Framework* framework);
+
+  virtual void slaveRemoved(Slave* slave);
+
+protected:
+  using SimpleAllocator::makeNewOffers;
+
+  virtual void makeNewOffers(hashmap<Slave*, Resources> available);
+
+private:
+  // Makes the offers for a finished allocation pass (if any) and then
+  // starts a pass for any slaves that changed in the meantime.
+  void commit();
+
+  const size_t workers;
+  const size_t minimum;
+
+  std::vector<AllocationWorker*> shards;
+
+  // The framework each slave got assigned to by a worker.
+  typedef hashmap<SlaveID, FrameworkID> Assignments;
+
+  // The allocation pass in progress (if 'allocating').
+  bool allocating;
+  process::Future<std::list<Assignments> > pass;
+
+  // Frameworks (in order) and slaves that are part of the pass in
+  // progress, and slaves that need to be allocated once it's done.
+  std::vector<FrameworkID> ordering;
+  hashmap<FrameworkID, Framework*> frameworks;
+  hashmap<SlaveID, Slave*> slaves;
+  hashmap<SlaveID, Slave*> pending;
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __PARALLEL_ALLOCATOR_HPP__
@@ -0,0 +1,224 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <process/clock.hpp>
+#include <process/process.hpp>
+
+#include "common/fatal.hpp"
+#include "common/foreach.hpp"
+#include "common/hashmap.hpp"
+#include "common/json.hpp"
+#include "common/logging.hpp"
+#include "common/record_file.hpp"
+#include "common/result.hpp"
+#include "common/statistics.hpp"
+
+#include "configurator/configurator.hpp"
+
+#include "detector/detector.hpp"
+
+#include "master/allocator.hpp"
+#include "master/allocator_factory.hpp"
+#include "master/master.hpp"
+
+#include "messages/messages.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+using namespace mesos::internal::master;
+
+using process::Clock;
+using process::MessageEvent;
+using process::UPID;
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+
+// Stands in for a process that sent the captured master messages (a
+// slave, a scheduler, etc): the replayed messages come from it and it
+// drops whatever the master sends it, so none of the master's traffic
+// leaves this OS process.
+class Peer : public process::Process<Peer>
+{
+protected:
+  virtual void visit(const MessageEvent& event) {}
+};
+
+
+void usage(const char* programName, const Configurator& configurator)
+{
+  cerr << "Usage: " << programName << " --trace=FILE [--speed=N] [...]"
+       << endl
+       << endl
+       << "Replays the messages captured by mesos-master --capture=FILE "
+       << "against a master" << endl
+       << "in this process (with everything it sends dropped) and "
+       << "reports how long the" << endl
+       << "master took to handle them (as JSON)." << endl
+       << endl
+       << "Supported options:" << endl
+       << configurator.getUsage();
+}
+
+
+int main(int argc, char** argv)
+{
+  GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+  Configurator configurator;
+  Logging::registerOptions(&configurator);
+  Master::registerOptions(&configurator);
+  configurator.addOption<string>("trace", "File of captured messages");
+  configurator.addOption<string>("allocator", "Allocator of the master "
+                                 "(simple, drf, drf-preemptive, parallel, "
+                                 "async, packing or splitting)", "simple");
+  configurator.addOption<double>("speed", "How many times faster than "
+                                 "captured to replay the messages (0 "
+                                 "means as fast as possible)", 1.0);
+
+  if (argc == 2 && string("--help") == argv[1]) {
+    usage(argv[0], configurator);
+    exit(1);
+  }
+
+  Configuration conf;
+  try {
+    conf = configurator.load(argc, argv, true);
+  } catch (ConfigurationException& e) {
+    cerr << "Configuration error: " << e.what() << endl;
+    exit(1);
+  }
+
+  if (!conf.contains("trace")) {
+    usage(argv[0], configurator);
+    exit(1);
+  }
+
+  Logging::init(argv[0], conf);
+
+  process::initialize(false);
+
+  const string path = conf["trace"];
+  const string name = conf.get<string>("allocator", "simple");
+  const double speed = conf.get<double>("speed", 1.0);
+
+  if (speed < 0) {
+    fatal("Expecting a non-negative speed");
+  }
+
+  Try<RecordReader*> reader = RecordReader::open(path);
+  if (reader.isError()) {
+    fatal("Failed to open the trace: %s", reader.error().c_str());
+  }
+
+  Allocator* allocator = AllocatorFactory::instantiate(name, NULL);
+
+  if (allocator == NULL) {
+    fatal("Unknown allocator: %s", name.c_str());
+  }
+
+  Master* master = new Master(allocator, conf);
+  process::spawn(master);
+
+  MasterDetector* detector = new BasicMasterDetector(master->self());
+
+  // The stand-ins for the senders of the messages, by captured pid.
+  hashmap<string, Peer*> peers;
+
+  CapturedMessage captured;
+  size_t replayed = 0;
+  double first = 0; // Timestamp of the first message.
+  const double start = Clock::now();
+
+  Result<bool> read = Result<bool>::none();
+  while ((read = reader.get()->read(&captured)).isSome()) {
+    if (replayed == 0) {
+      first = captured.timestamp();
+    }
+
+    // Keep to the captured timing (sped up), if asked to.
+    if (speed > 0) {
+      double due = start + (captured.timestamp() - first) / speed;
+      double now = Clock::now();
+      if (due > now) {
+        usleep((useconds_t) ((due - now) * 1000000));
+      }
+    }
+
+    UPID from;
+    if (captured.from() != "") {
+      if (!peers.contains(captured.from())) {
+        peers[captured.from()] = new Peer();
+        process::spawn(peers[captured.from()]);
+      }
+      from = peers[captured.from()]->self();
+    }
+
+    UPID to = master->self();
+    to.id = captured.to();
+
+    process::post(from, to, captured.name(),
+                  captured.body().data(), captured.body().size());
+
+    replayed++;
+  }
+
+  if (read.isError()) {
+    LOG(ERROR) << "Stopped replaying: " << read.error();
+  }
+
+  delete reader.get();
+
+  // Let the master handle everything replayed before terminating it.
+  process::terminate(master, false);
+  process::wait(master);
+
+  const double elapsed = Clock::now() - start;
+
+  cerr << std::fixed << std::setprecision(3)
+       << "Replayed " << replayed << " messages in " << elapsed
+       << " seconds (" << (elapsed > 0 ? replayed / elapsed : 0)
+       << " messages/second)" << endl;
+
+  // How long the master took to handle each kind of message.
+  JSON::render(cout, model(master->statistics()));
+  cout << endl;
+
+  MasterDetector::destroy(detector);
+
+  foreachvalue (Peer* peer, peers) {
+    process::terminate(peer);
+    process::wait(peer);
+    delete peer;
+  }
+
+  delete master;
+  delete allocator;
+
+  return 0;
+}
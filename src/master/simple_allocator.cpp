@@ -20,12 +20,19 @@
 
 #include <algorithm>
 
-#include "common/utils.hpp"
+#include <process/clock.hpp>
+#include <process/metrics.hpp>
 
 #include "master/simple_allocator.hpp"
 
+using process::Clock;
+
+using std::make_pair;
 using std::max;
+using std::min;
+using std::pair;
 using std::sort;
+using std::string;
 using std::vector;
 
 
@@ -33,6 +40,39 @@ namespace mesos {
 namespace internal {
 namespace master {
 
+// Time taken by the allocation passes that had resources to offer.
+static process::metrics::Timer allocations(
+    "mesos_master_allocation_seconds",
+    "Time taken by allocation passes.");
+
+// How long changes currently get batched for after an allocation
+// pass and how long the full passes on timer ticks are backed off.
+static process::metrics::Gauge windows(
+    "mesos_master_allocation_window_ms",
+    "Milliseconds that changes get batched for after an allocation pass.");
+
+static process::metrics::Gauge backoffs(
+    "mesos_master_allocation_backoff_ms",
+    "Milliseconds between full allocation passes while nothing changes.");
+
+
+SimpleAllocator::Locality::Locality(const FrameworkID& frameworkId)
+  : hits("mesos_master_locality_hits_total",
+         "Requested offers made on a preferred slave.",
+         process::metrics::label("framework", frameworkId.value())),
+    misses("mesos_master_locality_misses_total",
+           "Requested offers made on a slave that wasn't preferred.",
+           process::metrics::label("framework", frameworkId.value())) {}
+
+
+SimpleAllocator::~SimpleAllocator()
+{
+  foreachvalue (Locality* l, locality) {
+    delete l;
+  }
+}
+
+
 void SimpleAllocator::initialize(Master* _master)
 {
   master = _master;
@@ -44,7 +84,7 @@ void SimpleAllocator::frameworkAdded(Framework* framework)
 {
   CHECK(initialized);
   LOG(INFO) << "Added framework " << framework->id;
-  makeNewOffers();
+  dirty();
 }
 
 
@@ -52,13 +92,19 @@ void SimpleAllocator::frameworkRemoved(Framework* framework)
 {
   CHECK(initialized);
 
-  foreachkey (const SlaveID& slaveId, utils::copy(refusers)) {
-    refusers.remove(slaveId, framework->id);
+  offerFilters.remove(framework->id);
+  pendingRequests.erase(framework->id);
+  requestTimes.erase(framework->id);
+  gangs.erase(framework->id);
+
+  if (locality.contains(framework->id)) {
+    delete locality[framework->id];
+    locality.erase(framework->id);
   }
 
   LOG(INFO) << "Removed framework " << framework->id;
 
-  makeNewOffers();
+  dirty();
 }
 
 
@@ -70,7 +116,8 @@ void SimpleAllocator::slaveAdded(Slave* slave)
             << " with " << slave->info.resources();
 
   totalResources += slave->info.resources();
-  makeNewOffers(slave);
+  attributes.add(slave->id, slave->info.attributes());
+  dirty(slave);
 }
 
 
@@ -81,7 +128,17 @@ void SimpleAllocator::slaveRemoved(Slave* slave)
   LOG(INFO) << "Removed slave " << slave->id;
 
   totalResources -= slave->info.resources();
-  refusers.remove(slave->id);
+  offerFilters.remove(slave->id);
+  attributes.remove(slave->id);
+
+  foreachvalue (Gang& gang, gangs) {
+    std::replace(gang.slaves.begin(), gang.slaves.end(),
+                 slave, (Slave*) NULL);
+  }
+
+  dirtied.erase(slave->id);
+  unallocated.erase(slave);
+  versions.erase(slave);
 }
 
 
@@ -92,13 +149,45 @@ void SimpleAllocator::resourcesRequested(
   CHECK(initialized);
 
   LOG(INFO) << "Received resource request from framework " << frameworkId;
+
+  // The requests replace any that are still outstanding (so sending
+  // no requests cancels them), releasing any reserved slaves.
+  vector<ResourceRequest> ungrouped;
+  Gang gang;
+
+  foreach (const ResourceRequest& request, requests) {
+    if (request.gang()) {
+      gang.requests.push_back(request);
+    } else {
+      ungrouped.push_back(request);
+    }
+  }
+
+  if (ungrouped.size() > 0) {
+    pendingRequests[frameworkId] = ungrouped;
+    requestTimes[frameworkId] = Clock::now();
+  } else {
+    pendingRequests.erase(frameworkId);
+    requestTimes.erase(frameworkId);
+  }
+
+  if (gang.requests.size() > 0) {
+    gang.slaves.resize(gang.requests.size(), NULL);
+    gang.timeout = Clock::now() + GANG_RESERVATION_TIMEOUT;
+    gangs[frameworkId] = gang;
+  } else {
+    gangs.erase(frameworkId);
+  }
+
+  dirty();
 }
 
 
 void SimpleAllocator::resourcesUnused(
     const FrameworkID& frameworkId,
     const SlaveID& slaveId,
-    const Resources& resources)
+    const Resources& resources,
+    const Option<Filters>& filters)
 {
   CHECK(initialized);
 
@@ -106,10 +195,28 @@ void SimpleAllocator::resourcesUnused(
     VLOG(1) << "Framework " << frameworkId
             << " left " << resources.allocatable()
             << " unused on slave " << slaveId;
-    refusers.put(slaveId, frameworkId);
+
+    // Get the timeout (if it exists) for re-offering refused resources.
+    double timeout = 0;
+    if (filters.isSome()) {
+      timeout = filters.get().has_refuse_seconds()
+        ? filters.get().refuse_seconds()
+        : UNUSED_RESOURCES_TIMEOUT;
+    }
+
+    if (timeout != 0) {
+      LOG(INFO) << "Filtered " << resources.allocatable()
+                << " on slave " << slaveId
+                << " for framework " << frameworkId
+                << " for " << timeout << " seconds";
+      offerFilters.add(frameworkId, slaveId, resources.allocatable(),
+                        (timeout == -1) ? 0 : Clock::now() + timeout);
+    } else {
+      offerFilters.refuse(frameworkId, slaveId, resources.allocatable());
+    }
   }
 
-  makeNewOffers();
+  dirty(master->getSlave(slaveId));
 }
 
 
@@ -124,10 +231,47 @@ void SimpleAllocator::resourcesRecovered(
     VLOG(1) << "Recovered " << resources.allocatable()
             << " on slave " << slaveId
             << " from framework " << frameworkId;
-    refusers.remove(slaveId);
   }
 
-  makeNewOffers();
+  dirty(master->getSlave(slaveId));
+}
+
+
+void SimpleAllocator::slackChanged(Slave* slave)
+{
+  CHECK(initialized);
+
+  Resources slack = slave->slackFree();
+  if (slack.size() == 0) {
+    return;
+  }
+
+  // Offer the slack to the first framework (in the allocation
+  // ordering) that asked for revocable resources, can use the slave
+  // and isn't filtering its resources. Unused revocable resources
+  // don't get filtered, they just get offered again with the slave's
+  // next report.
+  foreach (Framework* framework, getAllocationOrdering()) {
+    if (framework->info.revocable() && !filtered(framework, slave, slack)) {
+      VLOG(1) << "Offering revocable " << slack
+              << " on slave " << slave->id
+              << " to framework " << framework->id;
+
+      hashmap<Slave*, Resources> offerable;
+      offerable[slave] = slack;
+      master->makeOffers(framework, offerable, true);
+      return;
+    }
+  }
+}
+
+
+void SimpleAllocator::tasksQueued(Framework* framework)
+{
+  CHECK(initialized);
+  LOG(INFO) << "Framework " << framework->id << " has "
+            << framework->queued.size() << " queued tasks";
+  dirty();
 }
 
 
@@ -135,65 +279,153 @@ void SimpleAllocator::offersRevived(Framework* framework)
 {
   CHECK(initialized);
 
-  // TODO(benh): This is broken ... we say filters removed here, but
-  // yet we don't actually do the removing of the filters? The
-  // allocator should really be responsible for filters (if there are
-  // any) because it can best use those for future allocation
-  // decisions.
+  offerFilters.remove(framework->id);
+
   LOG(INFO) << "Filters removed for framework " << framework->id;
 
-  makeNewOffers();
+  dirty();
 }
 
 
 void SimpleAllocator::timerTick()
 {
   CHECK(initialized);
+
+  double now = Clock::now();
+
+  if (offerFilters.expire(now) > 0) {
+    changes++;
+  }
+
+  // While nothing changes the full passes can't find anything new
+  // (short of changes the allocator doesn't get told about), so back
+  // them off, doubling the time between them (starting from the
+  // master's one second timer tick). Outstanding requests are
+  // waiting for time to pass (see LOCALITY_WAIT and
+  // GANG_RESERVATION_TIMEOUT) and so keep the passes coming.
+  if (changes == sweptChanges && pendingRequests.empty() && gangs.empty()) {
+    if (now < swept + backoff) {
+      return;
+    }
+    backoff = min(max(2 * backoff, 1.0), MAX_ALLOCATION_BACKOFF);
+  } else {
+    backoff = 0;
+  }
+
+  backoffs.set((int64_t) (backoff * 1000));
+
+  swept = now;
+  sweptChanges = changes;
+
+  // Filters might have expired, so consider (and refresh) every
+  // slave, which also covers any changes batched since the last
+  // allocation pass.
+  dirtied.clear();
+  everything = false;
+  allocated = now;
+
   makeNewOffers();
+
+  throttle(now);
 }
 
 
-namespace {
+void SimpleAllocator::dirty()
+{
+  changes++;
+  everything = true;
+  allocate();
+}
+
 
-struct DominantShareComparator
+void SimpleAllocator::dirty(Slave* slave)
 {
-  DominantShareComparator(const Resources& _resources)
-    : resources(_resources) {}
+  if (slave != NULL) {
+    changes++;
+    dirtied[slave->id] = slave;
+    allocate();
+  }
+}
 
-  bool operator () (Framework* framework1, Framework* framework2)
-  {
-    double share1 = 0;
-    double share2 = 0;
-
-    // TODO(benh): This implementaion of "dominant resource fairness"
-    // currently does not take into account resources that are not
-    // scalars.
-
-    foreach (const Resource& resource, resources) {
-      if (resource.type() == Value::SCALAR) {
-        double total = resource.scalar().value();
-
-        if (total > 0) {
-          Value::Scalar none;
-          const Value::Scalar& scalar1 =
-            framework1->resources.get(resource.name(), none);
-          const Value::Scalar& scalar2 =
-            framework2->resources.get(resource.name(), none);
-          share1 = max(share1, scalar1.value() / total);
-          share2 = max(share2, scalar2.value() / total);
-        }
-      }
+
+void SimpleAllocator::allocate()
+{
+  CHECK(initialized);
+
+  if (!everything && dirtied.empty()) {
+    return;
+  }
+
+  double now = Clock::now();
+
+  // Make an allocation pass right away unless another pass was made
+  // recently, in which case we wait for more changes to accumulate
+  // (or for the next timer tick). This keeps the latency low when
+  // changes are infrequent but avoids an allocation pass per change
+  // during a burst (e.g., many tasks finishing at once).
+  if (now - allocated < window && dirtied.size() < batch) {
+    VLOG(1) << "Batching allocation for " << dirtied.size()
+            << " changed slaves";
+    return;
+  }
+
+  allocated = now;
+
+  vector<Slave*> slaves;
+  slaves.reserve(dirtied.size());
+  foreachvalue (Slave* slave, dirtied) {
+    slaves.push_back(slave);
+  }
+
+  dirtied.clear();
+
+  if (everything) {
+    everything = false;
+
+    // Only the changed slaves need their free resources recomputed,
+    // but every slave with free resources can be offered.
+    foreach (Slave* slave, slaves) {
+      update(slave);
     }
 
-    if (share1 == share2) {
+    makeNewOffers(unallocated);
+  } else {
+    makeNewOffers(slaves);
+  }
+
+  throttle(now);
+}
+
+
+void SimpleAllocator::throttle(double started)
+{
+  window = max(interval, ALLOCATION_THROTTLE * (Clock::now() - started));
+  windows.set((int64_t) (window * 1000));
+}
+
+
+namespace {
+
+// A framework and its dominant share, i.e., the maximum share of any
+// (scalar) resource in the total. The shares get computed once per
+// ordering rather than on every comparison of the sort.
+struct DominantShare
+{
+  DominantShare(Framework* _framework, double _share)
+    : framework(_framework), share(_share) {}
+
+  bool operator < (const DominantShare& that) const
+  {
+    if (share == that.share) {
       // Make the sort deterministic for unit testing.
-      return framework1->id.value() < framework2->id.value();
+      return framework->id.value() < that.framework->id.value();
     } else {
-      return share1 < share2;
+      return share < that.share;
     }
   }
 
-  Resources resources;
+  Framework* framework;
+  double share;
 };
 
 } // namespace {
@@ -202,19 +434,63 @@ struct DominantShareComparator
 vector<Framework*> SimpleAllocator::getAllocationOrdering()
 {
   CHECK(initialized) << "Cannot get allocation ordering before initialization!";
-  vector<Framework*> frameworks = master->getActiveFrameworks();
-  DominantShareComparator comp(totalResources);
-  sort(frameworks.begin(), frameworks.end(), comp);
+
+  // TODO(benh): This implementaion of "dominant resource fairness"
+  // currently does not take into account resources that are not
+  // scalars.
+  vector<pair<string, double> > totals;
+
+  foreach (const Resource& resource, totalResources) {
+    if (resource.type() == Value::SCALAR && resource.scalar().value() > 0) {
+      totals.push_back(make_pair(resource.name(), resource.scalar().value()));
+    }
+  }
+
+  vector<DominantShare> shares;
+
+  foreach (Framework* framework, master->getActiveFrameworks()) {
+    double share = 0;
+
+    for (size_t i = 0; i < totals.size(); i++) {
+      Value::Scalar none;
+      const Value::Scalar& scalar =
+        framework->resources.get(totals[i].first, none);
+      share = max(share, scalar.value() / totals[i].second);
+    }
+
+    shares.push_back(DominantShare(framework, share));
+  }
+
+  sort(shares.begin(), shares.end());
+
+  vector<Framework*> frameworks;
+  frameworks.reserve(shares.size());
+
+  foreach (const DominantShare& share, shares) {
+    frameworks.push_back(share.framework);
+  }
+
   return frameworks;
 }
 
 
 void SimpleAllocator::makeNewOffers()
 {
-  // TODO: Create a method in master so that we don't return the whole list of slaves
   CHECK(initialized) << "Cannot make new offers before initialization!";
-  vector<Slave*> slaves = master->getActiveSlaves();
-  makeNewOffers(slaves);
+
+  // Bring the free resources of every slave up to date, which also
+  // picks up any changes we weren't told about (e.g., an executor
+  // exiting). Slaves that haven't changed get skipped by update.
+  hashmap<Slave*, Resources> available;
+
+  foreach (Slave* slave, master->getActiveSlaves()) {
+    update(slave);
+    if (unallocated.contains(slave)) {
+      available[slave] = unallocated[slave];
+    }
+  }
+
+  makeNewOffers(available);
 }
 
 
@@ -230,6 +506,29 @@ void SimpleAllocator::makeNewOffers(Slave* slave)
 void SimpleAllocator::makeNewOffers(const vector<Slave*>& slaves)
 {
   CHECK(initialized) << "Cannot make new offers before initialization!";
+
+  hashmap<Slave*, Resources> available;
+
+  foreach (Slave* slave, slaves) {
+    update(slave);
+    if (unallocated.contains(slave)) {
+      available[slave] = unallocated[slave];
+    }
+  }
+
+  makeNewOffers(available);
+}
+
+
+void SimpleAllocator::makeNewOffers(hashmap<Slave*, Resources> available)
+{
+  CHECK(initialized) << "Cannot make new offers before initialization!";
+
+  if (available.size() == 0) {
+    VLOG(1) << "No resources available to allocate!";
+    return;
+  }
+
   // Get an ordering of frameworks to send offers to
   vector<Framework*> ordering = getAllocationOrdering();
   if (ordering.empty()) {
@@ -237,73 +536,465 @@ void SimpleAllocator::makeNewOffers(const vector<Slave*>& slaves)
     return;
   }
 
-  // Find all the available resources that can be allocated.
-  hashmap<Slave*, Resources> available;
-  foreach (Slave* slave, slaves) {
-    if (slave->active) {
-      Resources resources = slave->resourcesFree().allocatable();
-
-      // TODO(benh): For now, only make offers when there is some cpu
-      // and memory left. This is an artifact of the original code
-      // that only offered when there was at least 1 cpu "unit"
-      // available, and without doing this a framework might get
-      // offered resources with only memory available (which it
-      // obviously won't take) and then get added as a refuser for
-      // that slave and therefore have to wait upwards of
-      // DEFAULT_REFUSAL_TIMEOUT until resources come from that slave
-      // again. In the long run, frameworks will poll the master for
-      // resources, rather than the master pushing resources out to
-      // frameworks.
+  double started = Clock::now();
 
-      Value::Scalar none;
-      Value::Scalar cpus = resources.get("cpus", none);
-      Value::Scalar mem = resources.get("mem", none);
+  // Clear refusals on any slave that has been refused by everyone.
+  foreachkey (Slave* slave, available) {
+    if (offerFilters.refusals(slave->id) == ordering.size()) {
+      VLOG(1) << "Clearing refusals for slave " << slave->id
+              << " because EVERYONE has refused resources from it";
+      offerFilters.clear(slave->id);
+    }
+  }
+
+  makeRequestedOffers(ordering, available);
+  makeReservedOffers(ordering, available);
+  placeQueuedTasks(ordering, available);
+
+  foreach (Framework* framework, ordering) {
+    // Check if we should offer resources to this framework.
+    hashmap<Slave*, Resources> offerable;
+
+    if (framework->info.constraints_size() > 0) {
+      // Only look at the slaves that satisfy the constraints.
+      foreach (const SlaveID& slaveId,
+               attributes.find(framework->info.constraints())) {
+        Slave* slave = master->getSlave(slaveId);
+        if (slave != NULL && available.contains(slave) &&
+            !filtered(framework, slave, available[slave])) {
+          VLOG(1) << "Offering " << available[slave]
+                  << " on slave " << slave->id
+                  << " to framework " << framework->id;
+          offerable[slave] = available[slave];
+        }
+      }
+    } else {
+      foreachpair (Slave* slave, const Resources& resources, available) {
+        if (!filtered(framework, slave, resources)) {
+          VLOG(1) << "Offering " << resources
+                  << " on slave " << slave->id
+                  << " to framework " << framework->id;
+          offerable[slave] = resources;
+        }
+      }
+    }
+
+    if (offerable.size() > 0) {
+      foreachkey (Slave* slave, offerable) {
+        available.erase(slave);
+      }
 
-      if (cpus.value() >= MIN_CPUS && mem.value() > MIN_MEM) {
-        VLOG(1) << "Found available resources: " << resources
-                << " on slave " << slave->id;
-        available[slave] = resources;
+      makeOffers(framework, offerable);
+
+      // The offered slaves have (at least) less free resources now.
+      foreachkey (Slave* slave, offerable) {
+        update(slave);
       }
     }
   }
 
-  if (available.size() == 0) {
-    VLOG(1) << "No resources available to allocate!";
+  allocations.record(Clock::now() - started);
+}
+
+
+void SimpleAllocator::makeRequestedOffers(
+    const vector<Framework*>& ordering,
+    hashmap<Slave*, Resources>& available)
+{
+  makeGangOffers(ordering, available);
+
+  if (pendingRequests.empty()) {
     return;
   }
 
-  // Clear refusers on any slave that has been refused by everyone.
+  foreach (Framework* framework, ordering) {
+    if (!pendingRequests.contains(framework->id)) {
+      continue;
+    }
+
+    // Requests that prefer some slaves only take other slaves once
+    // they have waited LOCALITY_WAIT seconds (i.e., delay scheduling),
+    // and until then the preferred slaves that are available (but not
+    // big enough yet) are held back from the other frameworks.
+    const bool waiting =
+      Clock::now() < requestTimes[framework->id] + LOCALITY_WAIT;
+
+    hashmap<Slave*, Resources> offerable;
+    vector<ResourceRequest> outstanding;
+    hashset<Slave*> held;
+
+    foreach (const ResourceRequest& request, pendingRequests[framework->id]) {
+      Resources requested(request.resources());
+
+      const bool preferring =
+        request.hosts_size() > 0 || request.attributes_size() > 0;
+
+      // Find a slave (the requested one, if any) with enough free
+      // resources that the framework hasn't filtered, preferably one
+      // of the preferred slaves.
+      Slave* match = NULL;
+      bool hit = false;
+      foreachpair (Slave* slave, const Resources& resources, available) {
+        if ((!request.has_slave_id() || request.slave_id() == slave->id) &&
+            requested <= resources &&
+            !filtered(framework, slave, resources)) {
+          if (!preferring || preferred(request, slave)) {
+            match = slave;
+            hit = preferring;
+            break;
+          } else if (match == NULL && !waiting) {
+            match = slave;
+          }
+        }
+      }
+
+      if (match == NULL && preferring && waiting) {
+        foreachpair (Slave* slave, const Resources& resources, available) {
+          if (preferred(request, slave) &&
+              !filtered(framework, slave, resources)) {
+            held.insert(slave);
+          }
+        }
+      }
+
+      if (match != NULL) {
+        VLOG(1) << "Offering " << available[match]
+                << " on slave " << match->id
+                << " to framework " << framework->id
+                << " as requested";
+        offerable[match] = available[match];
+        available.erase(match);
+        held.erase(match);
+
+        if (preferring) {
+          if (!locality.contains(framework->id)) {
+            locality[framework->id] = new Locality(framework->id);
+          }
+
+          if (hit) {
+            locality[framework->id]->hits.increment();
+          } else {
+            locality[framework->id]->misses.increment();
+          }
+        }
+      } else {
+        outstanding.push_back(request);
+      }
+    }
+
+    foreach (Slave* slave, held) {
+      VLOG(1) << "Holding slave " << slave->id
+              << " for framework " << framework->id;
+      available.erase(slave);
+    }
+
+    if (outstanding.empty()) {
+      pendingRequests.erase(framework->id);
+      requestTimes.erase(framework->id);
+    } else {
+      pendingRequests[framework->id] = outstanding;
+    }
+
+    if (offerable.size() > 0) {
+      makeOffers(framework, offerable);
+
+      foreachkey (Slave* slave, offerable) {
+        update(slave);
+      }
+    }
+  }
+}
+
+
+void SimpleAllocator::makeGangOffers(
+    const vector<Framework*>& ordering,
+    hashmap<Slave*, Resources>& available)
+{
+  if (gangs.empty()) {
+    return;
+  }
+
+  const double now = Clock::now();
+
+  hashset<Slave*> reserved;
+  foreachvalue (const Gang& gang, gangs) {
+    foreach (Slave* slave, gang.slaves) {
+      if (slave != NULL) {
+        reserved.insert(slave);
+      }
+    }
+  }
+
+  foreach (Framework* framework, ordering) {
+    if (!gangs.contains(framework->id)) {
+      continue;
+    }
+
+    Gang& gang = gangs[framework->id];
+
+    if (now >= gang.timeout) {
+      LOG(INFO) << "Releasing the slaves reserved for the gang request"
+                << " of framework " << framework->id;
+      foreach (Slave* slave, gang.slaves) {
+        reserved.erase(slave);
+      }
+      gangs.erase(framework->id);
+      continue;
+    }
+
+    // Reserve a slave (the requested one, if any) for each request
+    // that doesn't have one (or whose slave no longer has enough free
+    // resources), looking at every slave with free resources rather
+    // than just the ones in this allocation pass.
+    size_t complete = 0;
+
+    for (size_t i = 0; i < gang.requests.size(); i++) {
+      const ResourceRequest& request = gang.requests[i];
+      Resources requested(request.resources());
+
+      if (gang.slaves[i] != NULL) {
+        update(gang.slaves[i]);
+        if (!unallocated.contains(gang.slaves[i]) ||
+            !(requested <= unallocated[gang.slaves[i]])) {
+          reserved.erase(gang.slaves[i]);
+          gang.slaves[i] = NULL;
+        }
+      }
+
+      if (gang.slaves[i] == NULL) {
+        foreachpair (Slave* slave, const Resources& resources, unallocated) {
+          if (!reserved.contains(slave) &&
+              (!request.has_slave_id() || request.slave_id() == slave->id) &&
+              requested <= resources &&
+              !filtered(framework, slave, resources)) {
+            VLOG(1) << "Reserving slave " << slave->id
+                    << " for the gang request of framework "
+                    << framework->id;
+            gang.slaves[i] = slave;
+            reserved.insert(slave);
+            break;
+          }
+        }
+      }
+
+      if (gang.slaves[i] != NULL) {
+        complete++;
+      }
+    }
+
+    if (complete == gang.requests.size()) {
+      LOG(INFO) << "Offering " << complete << " slaves to framework "
+                << framework->id << " for its gang request";
+
+      hashmap<Slave*, Resources> offerable;
+      foreach (Slave* slave, gang.slaves) {
+        offerable[slave] = unallocated[slave];
+        reserved.erase(slave);
+        available.erase(slave);
+      }
+
+      gangs.erase(framework->id);
+
+      makeOffers(framework, offerable);
+
+      foreachkey (Slave* slave, offerable) {
+        update(slave);
+      }
+    }
+  }
+
+  // Nobody else gets offered the reserved slaves.
+  foreach (Slave* slave, reserved) {
+    available.erase(slave);
+  }
+}
+
+
+void SimpleAllocator::makeReservedOffers(
+    const vector<Framework*>& ordering,
+    hashmap<Slave*, Resources>& available)
+{
+  // The available slaves with reservations, by role.
+  hashmap<string, vector<Slave*> > reserved;
   foreachkey (Slave* slave, available) {
-    if (refusers.get(slave->id).size() == ordering.size()) {
-      VLOG(1) << "Clearing refusers for slave " << slave->id
-              << " because EVERYONE has refused resources from it";
-      refusers.remove(slave->id);
+    foreach (const Reservation& reservation, slave->info.reservations()) {
+      reserved[reservation.role()].push_back(slave);
     }
   }
 
+  if (reserved.empty()) {
+    return;
+  }
+
   foreach (Framework* framework, ordering) {
-    // Check if we should offer resources to this framework.
+    const string& role = framework->info.has_group()
+      ? framework->info.group()
+      : framework->info.name();
+
+    if (!reserved.contains(role)) {
+      continue;
+    }
+
     hashmap<Slave*, Resources> offerable;
-    foreachpair (Slave* slave, const Resources& resources, available) {
-      if (!refusers.contains(slave->id, framework->id) &&
-          !framework->filters(slave, resources)) {
-        VLOG(1) << "Offering " << resources
+    foreach (Slave* slave, reserved[role]) {
+      if (available.contains(slave) &&
+          !filtered(framework, slave, available[slave])) {
+        VLOG(1) << "Offering " << available[slave]
                 << " on slave " << slave->id
-                << " to framework " << framework->id;
-        offerable[slave] = resources;
+                << " to framework " << framework->id
+                << " since some of them are reserved for it";
+        offerable[slave] = available[slave];
+        available.erase(slave);
       }
     }
 
     if (offerable.size() > 0) {
+      makeOffers(framework, offerable);
+
       foreachkey (Slave* slave, offerable) {
+        update(slave);
+      }
+    }
+  }
+}
+
+
+void SimpleAllocator::placeQueuedTasks(
+    const vector<Framework*>& ordering,
+    hashmap<Slave*, Resources>& available)
+{
+  foreach (Framework* framework, ordering) {
+    if (framework->queued.empty()) {
+      continue;
+    }
+
+    // The tasks placed on each slave, what they leave of the slave's
+    // available resources and the executors they launch there.
+    hashmap<Slave*, vector<TaskDescription> > placed;
+    hashmap<Slave*, Resources> left;
+    hashmap<Slave*, hashset<ExecutorID> > launched;
+
+    foreach (const TaskDescription& task, framework->queued) {
+      const ExecutorInfo& executorInfo = task.has_executor()
+        ? task.executor()
+        : framework->info.executor();
+
+      foreachpair (Slave* slave, const Resources& resources, available) {
+        if (!left.contains(slave)) {
+          if (filtered(framework, slave, resources)) {
+            continue;
+          }
+          left[slave] = resources;
+        }
+
+        Resources needed = task.resources();
+        if (!framework->hasExecutor(slave->id, executorInfo.executor_id()) &&
+            !launched[slave].contains(executorInfo.executor_id())) {
+          needed += executorInfo.resources();
+        }
+
+        if (needed <= left[slave]) {
+          left[slave] -= needed;
+          launched[slave].insert(executorInfo.executor_id());
+          placed[slave].push_back(task);
+          break;
+        }
+      }
+    }
+
+    foreachpair (Slave* slave,
+                 const vector<TaskDescription>& tasks,
+                 placed) {
+      master->placeTasks(framework, slave, tasks);
+
+      // Whatever is left on the slave can still be offered.
+      update(slave);
+      if (unallocated.contains(slave)) {
+        available[slave] = unallocated[slave];
+      } else {
         available.erase(slave);
       }
+    }
+  }
+}
 
-      master->makeOffers(framework, offerable);
+
+bool SimpleAllocator::filtered(
+    Framework* framework,
+    Slave* slave,
+    const Resources& resources) const
+{
+  return (framework->info.constraints_size() > 0 &&
+          !attributes.matches(slave->id, framework->info.constraints())) ||
+    offerFilters.filtered(framework->id, slave->id, resources);
+}
+
+
+bool SimpleAllocator::preferred(
+    const ResourceRequest& request,
+    Slave* slave) const
+{
+  foreach (const string& host, request.hosts()) {
+    if (host == slave->info.hostname()) {
+      return true;
+    }
+  }
+
+  return request.attributes_size() > 0 &&
+    attributes.matches(slave->id, request.attributes());
+}
+
+
+void SimpleAllocator::update(Slave* slave)
+{
+  // Nothing to recompute if the slave's free resources haven't
+  // changed since we last looked at them.
+  if (slave->active &&
+      versions.contains(slave) &&
+      versions[slave] == slave->version) {
+    return;
+  }
+
+  unallocated.erase(slave);
+  versions.erase(slave);
+
+  if (slave->active) {
+    versions[slave] = slave->version;
+
+    Resources resources = slave->resourcesFree().allocatable();
+
+    // TODO(benh): For now, only make offers when there is some cpu
+    // and memory left. This is an artifact of the original code
+    // that only offered when there was at least 1 cpu "unit"
+    // available, and without doing this a framework might get
+    // offered resources with only memory available (which it
+    // obviously won't take) and then get added as a refuser for
+    // that slave and therefore have to wait upwards of
+    // DEFAULT_REFUSAL_TIMEOUT until resources come from that slave
+    // again. In the long run, frameworks will poll the master for
+    // resources, rather than the master pushing resources out to
+    // frameworks.
+
+    Value::Scalar none;
+    Value::Scalar cpus = resources.get("cpus", none);
+    Value::Scalar mem = resources.get("mem", none);
+
+    if (cpus.value() >= MIN_CPUS && mem.value() > MIN_MEM) {
+      VLOG(1) << "Found available resources: " << resources
+              << " on slave " << slave->id;
+      unallocated[slave] = resources;
     }
   }
 }
 
+
+void SimpleAllocator::makeOffers(
+    Framework* framework,
+    const hashmap<Slave*, Resources>& offerable)
+{
+  master->makeOffers(framework, offerable);
+}
+
 } // namespace master {
 } // namespace internal {
 } // namespace mesos {
@@ -22,7 +22,13 @@
 #include <vector>
 
 #include "common/hashmap.hpp"
-#include "common/multihashmap.hpp"
+#include "common/hashset.hpp"
+
+#include <process/metrics.hpp>
+
+#include "master/attribute_index.hpp"
+#include "master/constants.hpp"
+#include "master/offer_filters.hpp"
 
 #include "master/allocator.hpp"
 
@@ -34,9 +40,24 @@ namespace master {
 class SimpleAllocator : public Allocator
 {
 public:
-  SimpleAllocator(): initialized(false) {}
-
-  virtual ~SimpleAllocator() {}
+  // Changes that arrive within 'interval' seconds of the last
+  // allocation pass (or longer, if the passes take long, see
+  // ALLOCATION_THROTTLE) are batched until either 'batch' slaves have
+  // changed or the next timer tick (whichever comes first).
+  SimpleAllocator(double _interval = ALLOCATION_INTERVAL,
+                  size_t _batch = ALLOCATION_BATCH)
+    : initialized(false),
+      interval(_interval),
+      batch(_batch),
+      everything(false),
+      allocated(0),
+      window(_interval),
+      changes(0),
+      swept(0),
+      sweptChanges(0),
+      backoff(0) {}
+
+  virtual ~SimpleAllocator();
 
   virtual void initialize(Master* _master);
 
@@ -55,22 +76,33 @@ public:
   virtual void resourcesUnused(
     const FrameworkID& frameworkId,
     const SlaveID& slaveId,
-    const Resources& resources);
+    const Resources& resources,
+    const Option<Filters>& filters);
 
   virtual void resourcesRecovered(
     const FrameworkID& frameworkId,
     const SlaveID& slaveId,
     const Resources& resources);
 
+  virtual void tasksQueued(Framework* framework);
+
   virtual void offersRevived(Framework* framework);
 
+  virtual void slackChanged(Slave* slave);
+
   virtual void timerTick();
 
-private:
+protected:
   // Get an ordering to consider frameworks in for launching tasks.
-  std::vector<Framework*> getAllocationOrdering();
+  virtual std::vector<Framework*> getAllocationOrdering();
 
-  // Look at the full state of the cluster and send out offers.
+  // Offer the specified resources to a framework (which changes the
+  // framework's resources).
+  virtual void makeOffers(Framework* framework,
+                          const hashmap<Slave*, Resources>& offerable);
+
+  // Look at the full state of the cluster (refreshing the cached free
+  // resources of every slave) and send out offers.
   void makeNewOffers();
 
   // Make resource offers for just one slave.
@@ -79,16 +111,136 @@ private:
   // Make resource offers for a subset of the slaves.
   void makeNewOffers(const std::vector<Slave*>& slaves);
 
+  // Make resource offers for the specified (free) resources.
+  virtual void makeNewOffers(hashmap<Slave*, Resources> available);
+
+  // Offer each framework (in order) slaves that satisfy its
+  // outstanding resource requests, removing the offered slaves from
+  // the available ones and the satisfied requests.
+  void makeRequestedOffers(const std::vector<Framework*>& ordering,
+                           hashmap<Slave*, Resources>& available);
+
+  // Reserves slaves for the gang requests of each framework (in
+  // order), offering a framework all of them once every one of its
+  // requests has a slave and holding the reserved slaves back from
+  // the available ones.
+  void makeGangOffers(const std::vector<Framework*>& ordering,
+                      hashmap<Slave*, Resources>& available);
+
+  // Offers each framework (in order) the available slaves with
+  // resources reserved for its role (see Reservation), removing them
+  // from the available ones. The slaves that the frameworks filter
+  // (e.g., because they declined them) are left for everyone else.
+  void makeReservedOffers(const std::vector<Framework*>& ordering,
+                          hashmap<Slave*, Resources>& available);
+
+  // Places the queued tasks of each framework (in order) on the
+  // available slaves they fit on (see Master::placeTasks), first fit
+  // in the order the tasks were queued, taking the resources they use
+  // out of the available ones.
+  void placeQueuedTasks(const std::vector<Framework*>& ordering,
+                        hashmap<Slave*, Resources>& available);
+
+  // Returns true if the resources on a slave shouldn't be offered to
+  // a framework, because the slave doesn't satisfy the framework's
+  // constraints or the framework filtered the resources.
+  bool filtered(Framework* framework,
+                Slave* slave,
+                const Resources& resources) const;
+
+  // Returns true if a slave is one of the slaves that a request
+  // prefers (see ResourceRequest).
+  bool preferred(const ResourceRequest& request, Slave* slave) const;
+
+  // Recompute the cached free resources of a slave.
+  void update(Slave* slave);
+
+  // Remember that the free resources on any slave (or on just the
+  // specified slave, if it's still around) might have changed and
+  // possibly make an allocation pass.
+  void dirty();
+  void dirty(Slave* slave);
+
+  // Make an allocation pass for the changed slaves if no pass was
+  // made recently or enough slaves have changed.
+  void allocate();
+
+  // Batch changes for longer if the last pass took long.
+  void throttle(double started);
+
   bool initialized;
 
+  const double interval;
+  const size_t batch;
+
+  // Slaves whose free resources have changed since the last
+  // allocation pass, and whether or not all slaves need to be
+  // considered (e.g., because a framework was added).
+  hashmap<SlaveID, Slave*> dirtied;
+  bool everything;
+
+  // Time of the last allocation pass.
+  double allocated;
+
+  // Seconds that changes currently get batched for after a pass.
+  double window;
+
+  // Number of changes so far, when the last full allocation pass was
+  // made on a timer tick and how many changes there had been by then,
+  // and how long to wait for the next full pass if nothing changes.
+  uint64_t changes;
+  double swept;
+  uint64_t sweptChanges;
+  double backoff;
+
+  // Cached free (allocatable) resources of each slave that has enough
+  // free resources to be offered, so that an allocation pass doesn't
+  // need to look at every slave in the cluster.
+  hashmap<Slave*, Resources> unallocated;
+
+  // Version of each slave's free resources (see Slave::version) that
+  // its entry in 'unallocated' (or lack thereof) reflects.
+  hashmap<Slave*, uint64_t> versions;
+
   Master* master;
 
   Resources totalResources;
 
-  // Remember which frameworks refused each slave "recently"; this is
-  // cleared when the slave's free resources go up or when everyone
-  // has refused it.
-  multihashmap<SlaveID, FrameworkID> refusers;
+  // Outstanding resource requests of each framework, and when they
+  // were made (see LOCALITY_WAIT).
+  hashmap<FrameworkID, std::vector<ResourceRequest> > pendingRequests;
+  hashmap<FrameworkID, double> requestTimes;
+
+  // Outstanding gang requests of each framework, the slave reserved
+  // for each request (or NULL) and when the reservations get released.
+  struct Gang
+  {
+    std::vector<ResourceRequest> requests;
+    std::vector<Slave*> slaves;
+    double timeout;
+  };
+
+  hashmap<FrameworkID, Gang> gangs;
+
+  // How many of the requests preferring some slaves each framework
+  // got offered a preferred slave for (hits) or not (misses).
+  struct Locality
+  {
+    Locality(const FrameworkID& frameworkId);
+
+    process::metrics::Counter hits;
+    process::metrics::Counter misses;
+  };
+
+  hashmap<FrameworkID, Locality*> locality;
+
+  // Resources that frameworks have refused (and for how long they
+  // don't want them offered again).
+  OfferFilters offerFilters;
+
+  // Slaves by their attributes, so that frameworks with constraints
+  // only get the matching slaves looked at.
+  AttributeIndex attributes;
 };
 
 } // namespace master {
@@ -0,0 +1,143 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <glog/logging.h>
+
+#include "common/foreach.hpp"
+
+#include "master/slave_health.hpp"
+
+using process::UPID;
+
+using std::vector;
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+SlaveHealth::SlaveHealth(size_t _buckets, int _timeouts)
+  : timeouts(_timeouts), buckets(_buckets), next(0)
+{
+  CHECK(_buckets > 0);
+}
+
+
+void SlaveHealth::add(const UPID& pid, const SlaveID& slaveId)
+{
+  remove(pid);
+
+  // New slaves go into the bucket that was checked last so that they
+  // get a full interval to answer the ping (they are moved to a less
+  // crowded bucket after their first check, see below).
+  Health health;
+  health.slaveId = slaveId;
+  health.bucket = (next + buckets.size() - 1) % buckets.size();
+  health.timeouts = 0;
+  health.pinged = true;
+  health.heard = false;
+  health.checked = false;
+
+  slaves[pid] = health;
+  buckets[health.bucket].insert(pid);
+}
+
+
+void SlaveHealth::remove(const UPID& pid)
+{
+  if (slaves.contains(pid)) {
+    buckets[slaves[pid].bucket].erase(pid);
+    slaves.erase(pid);
+  }
+}
+
+
+void SlaveHealth::heard(const UPID& pid)
+{
+  hashmap<UPID, Health>::iterator iterator = slaves.find(pid);
+  if (iterator != slaves.end()) {
+    iterator->second.heard = true;
+  }
+}
+
+
+void SlaveHealth::check(vector<UPID>* pings, vector<SlaveID>* lost)
+{
+  CHECK(pings != NULL);
+  CHECK(lost != NULL);
+
+  const size_t checking = next;
+  next = (next + 1) % buckets.size();
+
+  vector<UPID> removed;
+  vector<UPID> moved;
+
+  foreach (const UPID& pid, buckets[checking]) {
+    Health& health = slaves[pid];
+
+    if (health.heard) {
+      health.timeouts = 0;
+      health.pinged = false;
+      health.heard = false;
+    } else {
+      if (health.pinged && ++health.timeouts >= timeouts) {
+        lost->push_back(health.slaveId);
+        removed.push_back(pid);
+        continue;
+      }
+
+      pings->push_back(pid);
+      health.pinged = true;
+    }
+
+    // Slaves that registered at about the same time all end up in the
+    // same bucket, so spread them out once they've been checked. Only
+    // slaves that aren't waiting for a "PONG" get moved so that a
+    // ping always gets a full interval to be answered.
+    if (!health.checked) {
+      health.checked = true;
+      if (!health.pinged) {
+        moved.push_back(pid);
+      }
+    }
+  }
+
+  foreach (const UPID& pid, removed) {
+    remove(pid);
+  }
+
+  foreach (const UPID& pid, moved) {
+    size_t bucket = checking;
+    for (size_t i = 0; i < buckets.size(); i++) {
+      if (buckets[i].size() < buckets[bucket].size()) {
+        bucket = i;
+      }
+    }
+
+    if (bucket != checking) {
+      buckets[checking].erase(pid);
+      buckets[bucket].insert(pid);
+      slaves[pid].bucket = bucket;
+    }
+  }
+}
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,93 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SLAVE_HEALTH_HPP__
+#define __SLAVE_HEALTH_HPP__
+
+#include <vector>
+
+#include <mesos/mesos.hpp>
+
+#include <process/pid.hpp>
+
+#include "common/hashmap.hpp"
+#include "common/hashset.hpp"
+#include "common/type_utils.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// Keeps track of whether the slaves are still alive on behalf of the
+// master (rather than having a process and a timer per slave). The
+// slaves are spread across 'buckets', one of which gets checked each
+// time 'check' is invoked, so that checking every bucket once takes a
+// full interval (e.g., SLAVE_PONG_TIMEOUT) but the pings are spread
+// out over it. A slave that the master heard from (i.e., got any
+// message from, not just a "PONG") since its last check doesn't get
+// pinged, and a slave that doesn't answer 'timeouts' pings in a row
+// is considered lost.
+class SlaveHealth
+{
+public:
+  SlaveHealth(size_t buckets, int timeouts);
+
+  // Starts checking a slave, which is expected to have just been
+  // pinged. The slave's first check is a full interval away.
+  void add(const process::UPID& pid, const SlaveID& slaveId);
+
+  // Stops checking a slave.
+  void remove(const process::UPID& pid);
+
+  // Notes that a message was received from 'pid' (if it's a slave).
+  void heard(const process::UPID& pid);
+
+  // Checks the next bucket of slaves, adding the ones that need to be
+  // pinged to 'pings' and the ones that are lost (which are no longer
+  // checked) to 'lost'.
+  void check(std::vector<process::UPID>* pings,
+             std::vector<SlaveID>* lost);
+
+  size_t size() const { return slaves.size(); }
+
+private:
+  struct Health
+  {
+    SlaveID slaveId;
+    size_t bucket;
+    int timeouts;
+    bool pinged;  // Waiting for a "PONG" since the last check.
+    bool heard;   // Heard from since the last check.
+    bool checked; // Checked at least once.
+  };
+
+  const int timeouts;
+
+  hashmap<process::UPID, Health> slaves;
+
+  // Slaves in each bucket and the bucket to check next.
+  std::vector<hashset<process::UPID> > buckets;
+  size_t next;
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __SLAVE_HEALTH_HPP__
@@ -0,0 +1,163 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <glog/logging.h>
+
+#include <process/dispatch.hpp>
+
+#include "common/foreach.hpp"
+#include "common/logging.hpp"
+#include "common/type_utils.hpp"
+#include "common/utils.hpp"
+
+#include "master/master.hpp"
+#include "master/slave_shard.hpp"
+
+using process::PID;
+using process::UPID;
+
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+SlaveShard::SlaveShard(const PID<Master>& _master, int index)
+  : ProcessBase("master-shard-" + utils::stringify(index)),
+    master(_master),
+    next(0) {}
+
+
+void SlaveShard::initialize()
+{
+  install<StatusUpdateMessage>(
+      &SlaveShard::statusUpdate,
+      &StatusUpdateMessage::update,
+      &StatusUpdateMessage::pid);
+
+  install<StatusUpdatesMessage>(&SlaveShard::statusUpdates);
+
+  install<ExitedExecutorMessage>(
+      &SlaveShard::exitedExecutor,
+      &ExitedExecutorMessage::slave_id,
+      &ExitedExecutorMessage::framework_id,
+      &ExitedExecutorMessage::executor_id,
+      &ExitedExecutorMessage::status);
+}
+
+
+void SlaveShard::statusUpdate(const StatusUpdate& update, const UPID& pid)
+{
+  StatusUpdatesMessage message;
+  message.add_updates()->MergeFrom(update);
+  message.set_pid(pid);
+  handle(message, StatusUpdateMessage().GetTypeName());
+}
+
+
+void SlaveShard::statusUpdates(const StatusUpdatesMessage& message)
+{
+  handle(message, StatusUpdatesMessage().GetTypeName());
+}
+
+
+void SlaveShard::handle(const StatusUpdatesMessage& message,
+                        const string& name)
+{
+  foreach (const StatusUpdate& update, message.updates()) {
+    LOG_RATE_LIMITED(INFO, TASK_LOG_RATE)
+      << "Status update from " << from
+      << ": task " << update.status().task_id()
+      << " of framework " << update.framework_id()
+      << " is now in state " << update.status().state();
+  }
+
+  const uint64_t id = next++;
+
+  Pending& entry = pending[id];
+  entry.message = message;
+  entry.name = name;
+  entry.payload = payload();
+
+  dispatch(master, &Master::shardedStatusUpdates, self(), id, message);
+}
+
+
+void SlaveShard::exitedExecutor(const SlaveID& slaveId,
+                                const FrameworkID& frameworkId,
+                                const ExecutorID& executorId,
+                                int32_t status)
+{
+  // Dispatches to the master are handled in order, so the master
+  // updates the tasks of the status updates we got before this first.
+  dispatch(master, &Master::exitedExecutor,
+           slaveId, frameworkId, executorId, status);
+}
+
+
+void SlaveShard::forward(uint64_t id, const vector<UPID>& pids)
+{
+  CHECK(pending.contains(id));
+
+  const Pending& entry = pending[id];
+  const StatusUpdatesMessage& message = entry.message;
+
+  CHECK(pids.size() == (size_t) message.updates_size());
+
+  // Pass on the message as the slave sent it if all of its updates
+  // are for the same framework (see Master::statusUpdates).
+  bool same = !pids.empty() && pids[0] != UPID();
+  foreach (const UPID& pid, pids) {
+    same = same && pid == pids[0];
+  }
+
+  if (same) {
+    send(pids[0], entry.name, entry.payload);
+    pending.erase(id);
+    return;
+  }
+
+  // Otherwise pass on the status updates to each framework in one
+  // message (unless it's just one update, like Master::statusUpdate).
+  hashmap<UPID, StatusUpdatesMessage> forwards;
+
+  for (int i = 0; i < message.updates_size(); i++) {
+    if (pids[i] != UPID()) {
+      forwards[pids[i]].add_updates()->MergeFrom(message.updates(i));
+    }
+  }
+
+  foreachpair (const UPID& pid, StatusUpdatesMessage& forward, forwards) {
+    if (forward.updates_size() == 1) {
+      StatusUpdateMessage single;
+      single.mutable_update()->MergeFrom(forward.updates(0));
+      single.set_pid(message.pid());
+      send(pid, single);
+    } else {
+      forward.set_pid(message.pid());
+      send(pid, forward);
+    }
+  }
+
+  pending.erase(id);
+}
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,105 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MASTER_SLAVE_SHARD_HPP__
+#define __MASTER_SLAVE_SHARD_HPP__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <tr1/memory>
+
+#include <process/process.hpp>
+#include <process/protobuf.hpp>
+
+#include "common/hashmap.hpp"
+
+#include "messages/messages.hpp"
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// Forward declaration (necessary to break circular dependency).
+class Master;
+
+
+// Handles the status updates of a partition of the slaves (by slave
+// ID, see Master::shard) on behalf of the master, so that the
+// expensive parts of handling them (parsing and logging the updates
+// the slaves send and encoding and sending the updates forwarded to
+// the frameworks) happen in parallel on each shard. The master only
+// updates its tasks (see Master::shardedStatusUpdates) and tells the
+// shard which frameworks to forward each update to.
+//
+// Slaves also send their executors' exits to their shard, which
+// passes them on to the master behind the status updates it got
+// before them, since the master treats the tasks an exited executor
+// was still running as lost (see Master::exitedExecutor).
+class SlaveShard : public ProtobufProcess<SlaveShard>
+{
+public:
+  SlaveShard(const process::PID<Master>& master, int index);
+
+  virtual ~SlaveShard() {}
+
+  // Forwards the status updates of the (pending) message with the
+  // specified ID to the specified frameworks, one for each update
+  // (an empty pid means the update gets dropped).
+  void forward(uint64_t id, const std::vector<process::UPID>& pids);
+
+protected:
+  virtual void initialize();
+
+private:
+  void statusUpdate(const StatusUpdate& update, const process::UPID& pid);
+  void statusUpdates(const StatusUpdatesMessage& message);
+
+  void exitedExecutor(const SlaveID& slaveId,
+                      const FrameworkID& frameworkId,
+                      const ExecutorID& executorId,
+                      int32_t status);
+
+  // Hands the status updates (sent as a message named 'name') to the
+  // master, keeping the message around until the master replies.
+  void handle(const StatusUpdatesMessage& message, const std::string& name);
+
+  const process::PID<Master> master;
+
+  // A message waiting for the master to update its tasks, and the
+  // message as the slave sent it (which gets passed on as is if all
+  // of its updates are for the same framework).
+  struct Pending
+  {
+    StatusUpdatesMessage message;
+    std::string name;
+    std::tr1::shared_ptr<process::Message::Payload> payload;
+  };
+
+  // Messages waiting for the master to update its tasks, by ID.
+  uint64_t next;
+  hashmap<uint64_t, Pending> pending;
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __MASTER_SLAVE_SHARD_HPP__
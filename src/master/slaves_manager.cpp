@@ -30,6 +30,7 @@
 
 #include "zookeeper/zookeeper.hpp"
 
+#include "log_storage.hpp"
 #include "master.hpp"
 #include "slaves_manager.hpp"
 
@@ -73,6 +74,8 @@ public:
   virtual Future<bool> remove(const string& hostname, uint16_t port);
   virtual Future<bool> activate(const string& hostname, uint16_t port);
   virtual Future<bool> deactivate(const string& hostname, uint16_t port);
+  virtual Future<bool> activateAll(const multihashmap<string, uint16_t>& slaves);
+  virtual Future<bool> deactivateAll(const multihashmap<string, uint16_t>& slaves);
 
   Future<bool> connected();
   Future<bool> reconnecting();
@@ -85,6 +88,10 @@ private:
              const string& s,
              multihashmap<string, uint16_t>* result);
 
+  // Moves all the slaves from the inactive to the active slaves (or
+  // vice versa) with a single update of the znode.
+  bool move(const multihashmap<string, uint16_t>& slaves, bool activate);
+
   const string servers;
   const string znode;
   const PID<SlavesManager> slavesManager;
@@ -429,6 +436,89 @@ Future<bool> ZooKeeperSlavesManagerStorage::deactivate(const string& hostname, u
 }
 
 
+Future<bool> ZooKeeperSlavesManagerStorage::activateAll(
+    const multihashmap<string, uint16_t>& slaves)
+{
+  return move(slaves, true);
+}
+
+
+Future<bool> ZooKeeperSlavesManagerStorage::deactivateAll(
+    const multihashmap<string, uint16_t>& slaves)
+{
+  return move(slaves, false);
+}
+
+
+bool ZooKeeperSlavesManagerStorage::move(
+    const multihashmap<string, uint16_t>& slaves,
+    bool activate)
+{
+  int ret;
+  string result;
+  Stat stat;
+
+  ret = zk->get(znode, true, &result, &stat);
+
+  if (ret != ZOK) {
+    LOG(WARNING) << "Slaves manager storage failed to get '" << znode
+                 << "' in ZooKeeper! (" << zk->message(ret) << ")";
+    return false;
+  }
+
+  multihashmap<string, uint16_t> active;
+  multihashmap<string, uint16_t> inactive;
+  if (!parse("active=", result, &active) ||
+      !parse("inactive=", result, &inactive)) {
+    return false;
+  }
+
+  multihashmap<string, uint16_t>& from = activate ? inactive : active;
+  multihashmap<string, uint16_t>& to = activate ? active : inactive;
+
+  foreachpair (const string& hostname, uint16_t port, slaves) {
+    if (!from.remove(hostname, port)) {
+      LOG(WARNING) << "Slaves manager storage could not "
+                   << (activate ? "activate" : "deactivate") << " slave "
+                   << hostname << ":" << port << " because not currently "
+                   << (activate ? "inactive" : "active");
+      return false;
+    }
+    to.put(hostname, port);
+  }
+
+  ostringstream out;
+
+  out << "active=";
+  bool first = true;
+  foreachpair (const string& hostname, uint16_t port, active) {
+    out << (first ? "" : ",") << hostname << ":" << port;
+    first = false;
+  }
+
+  out << "\ninactive=";
+  first = true;
+  foreachpair (const string& hostname, uint16_t port, inactive) {
+    out << (first ? "" : ",") << hostname << ":" << port;
+    first = false;
+  }
+  out << "\n";
+
+  // Set the data in the znode (failing if it changed since we got it).
+  ret = zk->set(znode, out.str(), stat.version);
+
+  if (ret != ZOK) {
+    LOG(WARNING) << "Slaves manager storage could not "
+                 << (activate ? "activate " : "deactivate ") << slaves.size()
+                 << " slaves in '" << znode << "' in ZooKeeper! ("
+                 << zk->message(ret) << ")";
+    return false;
+  }
+
+  return true;
+}
+
+
 Future<bool> ZooKeeperSlavesManagerStorage::connected()
 {
   int ret;
@@ -584,7 +674,8 @@ bool ZooKeeperSlavesManagerStorage::parse(
 
 
 SlavesManager::SlavesManager(const Configuration& conf,
-                             const PID<Master>& _master)
+                             const PID<Master>& _master,
+                             LogStorage* log)
   : process::ProcessBase("slaves"),
     master(_master)
 {
@@ -630,7 +721,11 @@ SlavesManager::SlavesManager(const Configuration& conf,
       }
     }
 
-    storage = new SlavesManagerStorage();
+    if (log != NULL) {
+      storage = new LogSlavesManagerStorage(log, self());
+    } else {
+      storage = new SlavesManagerStorage();
+    }
     process::spawn(storage);
   }
 
@@ -782,27 +877,106 @@ bool SlavesManager::deactivate(const string& hostname, uint16_t port)
 }
 
 
+bool SlavesManager::activateAll(const multihashmap<string, uint16_t>& slaves)
+{
+  // Make sure all the slaves are currently deactivated.
+  foreachpair (const string& hostname, uint16_t port, slaves) {
+    if (!inactive.contains(hostname, port)) {
+      LOG(WARNING) << "Attempted to activate slave " << hostname << ":"
+                   << port << " which is not currently deactivated";
+      return false;
+    }
+  }
+
+  // Get the storage system to persist all the activations at once.
+  Future<bool> activated =
+    process::dispatch(storage->self(), &SlavesManagerStorage::activateAll,
+                      slaves);
+
+  activated.await();
+
+  if (activated.isReady() && activated.get()) {
+    foreachpair (const string& hostname, uint16_t port, slaves) {
+      active.put(hostname, port);
+      inactive.remove(hostname, port);
+    }
+
+    // Tell the master that these slaves are now activated.
+    process::dispatch(master, &Master::activatedSlaveHostnamePorts, slaves);
+
+    return true;
+  }
+
+  return false;
+}
+
+
+bool SlavesManager::deactivateAll(const multihashmap<string, uint16_t>& slaves)
+{
+  // Make sure all the slaves are currently activated.
+  foreachpair (const string& hostname, uint16_t port, slaves) {
+    if (!active.contains(hostname, port)) {
+      LOG(WARNING) << "Attempted to deactivate slave " << hostname << ":"
+                   << port << " which is not currently activated";
+      return false;
+    }
+  }
+
+  // Get the storage system to persist all the deactivations at once.
+  Future<bool> deactivated =
+    process::dispatch(storage->self(), &SlavesManagerStorage::deactivateAll,
+                      slaves);
+
+  deactivated.await();
+
+  if (deactivated.isReady() && deactivated.get()) {
+    foreachpair (const string& hostname, uint16_t port, slaves) {
+      active.remove(hostname, port);
+      inactive.put(hostname, port);
+    }
+
+    // Tell the master that these slaves are now deactivated.
+    process::dispatch(master, &Master::deactivatedSlaveHostnamePorts, slaves);
+
+    return true;
+  }
+
+  return false;
+}
+
+
 void SlavesManager::updateActive(const multihashmap<string, uint16_t>& updated)
 {
   // Loop through the current active slave hostname:port pairs and
   // remove all that are not found in updated.
+  multihashmap<string, uint16_t> deactivated;
   foreachpair (const string& hostname, uint16_t port, utils::copy(active)) {
     if (!updated.contains(hostname, port)) {
-      process::dispatch(master, &Master::deactivatedSlaveHostnamePort,
-                        hostname, port);
+      deactivated.put(hostname, port);
       active.remove(hostname, port);
     }
   }
 
   // Now loop through the updated slave hostname:port pairs and add
   // all that are not found in active.
+  multihashmap<string, uint16_t> activated;
   foreachpair (const string& hostname, uint16_t port, updated) {
     if (!active.contains(hostname, port)) {
-      process::dispatch(master, &Master::activatedSlaveHostnamePort,
-                        hostname, port);
+      activated.put(hostname, port);
       active.put(hostname, port);
     }
   }
+
+  // Tell the master about all the changes at once.
+  if (!deactivated.empty()) {
+    process::dispatch(master, &Master::deactivatedSlaveHostnamePorts,
+                      deactivated);
+  }
+
+  if (!activated.empty()) {
+    process::dispatch(master, &Master::activatedSlaveHostnamePorts,
+                      activated);
+  }
 }
 
 
@@ -899,42 +1073,68 @@ Future<HttpResponse> SlavesManager::remove(const HttpRequest& request)
 }
 
 
-Future<HttpResponse> SlavesManager::activate(const HttpRequest& request)
+// Parses the slaves in the query of a request to (de)activate slaves,
+// i.e., one or more 'hostname=' and 'port=' pairs (matched up in the
+// order they appear, e.g., "hostname=a,port=1,hostname=b,port=2").
+static bool parseSlaves(const HttpRequest& request,
+                        const string& action,
+                        multihashmap<string, uint16_t>* slaves)
 {
-  // Parse the query to get out the slave hostname and port.
-  string hostname = "";
-  uint16_t port = 0;
-
   map<string, vector<string> > pairs =
     strings::pairs(request.query, ',', '=');
 
   // Make sure there is at least a 'hostname=' and 'port='.
   if (pairs.count("hostname") == 0) {
     LOG(WARNING) << "Slaves manager expecting 'hostname' in query string"
-                 << " when trying to activate a slave";
-    return HttpNotFoundResponse();
+                 << " when trying to " << action << " a slave";
+    return false;
   } else if (pairs.count("port") == 0) {
     LOG(WARNING) << "Slaves manager expecting 'port' in query string"
-                 << " when trying to activate a slave";
-    return HttpNotFoundResponse();
+                 << " when trying to " << action << " a slave";
+    return false;
+  } else if (pairs["hostname"].size() != pairs["port"].size()) {
+    LOG(WARNING) << "Slaves manager expecting as many 'hostname' as 'port'"
+                 << " in query string when trying to " << action << " slaves";
+    return false;
   }
 
-  hostname = pairs["hostname"].front();
+  for (size_t i = 0; i < pairs["hostname"].size(); i++) {
+    // Check that 'port' is valid.
+    try {
+      slaves->put(pairs["hostname"][i],
+                  lexical_cast<uint16_t>(pairs["port"][i]));
+    } catch (const bad_lexical_cast&) {
+      LOG(WARNING) << "Slaves manager failed to parse 'port = "
+                   << pairs["port"][i]
+                   << "'  when trying to " << action << " a slave";
+      return false;
+    }
+  }
 
-  // Check that 'port' is valid.
-  try {
-    port = lexical_cast<uint16_t>(pairs["port"].front());
-  } catch (const bad_lexical_cast&) {
-    LOG(WARNING) << "Slaves manager failed to parse 'port = "
-		 << pairs["port"].front()
-                 << "'  when trying to activate a slave";
+  return true;
+}
+
+
+Future<HttpResponse> SlavesManager::activate(const HttpRequest& request)
+{
+  multihashmap<string, uint16_t> slaves;
+
+  if (!parseSlaves(request, "activate", &slaves)) {
     return HttpNotFoundResponse();
   }
 
-  LOG(INFO) << "Slaves manager received HTTP request to activate slave at "
-	    << hostname << ":" << port;
+  LOG(INFO) << "Slaves manager received HTTP request to activate "
+            << slaves.size() << " slave(s)";
+
+  // Activate many slaves (e.g., a rack) with one write to storage.
+  bool activated = false;
+  if (slaves.size() == 1) {
+    activated = activate(slaves.begin()->first, slaves.begin()->second);
+  } else {
+    activated = activateAll(slaves);
+  }
 
-  if (activate(hostname, port)) {
+  if (activated) {
     return HttpOKResponse();
   } else {
     return HttpInternalServerErrorResponse();
@@ -944,40 +1144,24 @@ Future<HttpResponse> SlavesManager::activate(const HttpRequest& request)
 
 Future<HttpResponse> SlavesManager::deactivate(const HttpRequest& request)
 {
-  // Parse the query to get out the slave hostname and port.
-  string hostname = "";
-  uint16_t port = 0;
-
-  map<string, vector<string> > pairs =
-    strings::pairs(request.query, ',', '=');
+  multihashmap<string, uint16_t> slaves;
 
-  // Make sure there is at least a 'hostname=' and 'port='.
-  if (pairs.count("hostname") == 0) {
-    LOG(WARNING) << "Slaves manager expecting 'hostname' in query string"
-                 << " when trying to deactivate a slave";
-    return HttpNotFoundResponse();
-  } else if (pairs.count("port") == 0) {
-    LOG(WARNING) << "Slaves manager expecting 'port' in query string"
-                 << " when trying to deactivate a slave";
+  if (!parseSlaves(request, "deactivate", &slaves)) {
     return HttpNotFoundResponse();
   }
 
-  hostname = pairs["hostname"].front();
+  LOG(INFO) << "Slaves manager received HTTP request to deactivate "
+            << slaves.size() << " slave(s)";
 
-  // Check that 'port' is valid.
-  try {
-    port = lexical_cast<uint16_t>(pairs["port"].front());
-  } catch (const bad_lexical_cast&) {
-    LOG(WARNING) << "Slaves manager failed to parse 'port = "
-		 << pairs["port"].front()
-                 << "'  when trying to deactivate a slave";
-    return HttpNotFoundResponse();
+  // Deactivate many slaves (e.g., a rack) with one write to storage.
+  bool deactivated = false;
+  if (slaves.size() == 1) {
+    deactivated = deactivate(slaves.begin()->first, slaves.begin()->second);
+  } else {
+    deactivated = deactivateAll(slaves);
   }
 
-  LOG(INFO) << "Slaves manager received HTTP request to deactivate slave at "
-	    << hostname << ":" << port;
-
-  if (deactivate(hostname, port)) {
+  if (deactivated) {
     return HttpOKResponse();
   } else {
     return HttpInternalServerErrorResponse();
@@ -30,6 +30,7 @@ namespace mesos {
 namespace internal {
 namespace master {
 
+class LogStorage;
 class Master;
 
 
@@ -40,13 +41,22 @@ public:
   virtual process::Future<bool> remove(const std::string& hostname, uint16_t port) { return true; }
   virtual process::Future<bool> activate(const std::string& hostname, uint16_t port) { return true; }
   virtual process::Future<bool> deactivate(const std::string& hostname, uint16_t port) { return true; }
+
+  // Persists the (de)activation of all the slaves at once, i.e.,
+  // either all of them or none of them.
+  virtual process::Future<bool> activateAll(const multihashmap<std::string, uint16_t>& slaves) { return true; }
+  virtual process::Future<bool> deactivateAll(const multihashmap<std::string, uint16_t>& slaves) { return true; }
 };
 
 
 class SlavesManager : public process::Process<SlavesManager>
 {
 public:
-  SlavesManager(const Configuration& conf, const process::PID<Master>& _master);
+  // Persists the slaves in the specified storage (if any) unless
+  // configured to use ZooKeeper.
+  SlavesManager(const Configuration& conf,
+                const process::PID<Master>& _master,
+                LogStorage* log = NULL);
 
   virtual ~SlavesManager();
 
@@ -57,6 +67,11 @@ public:
   bool activate(const std::string& hostname, uint16_t port);
   bool deactivate(const std::string& hostname, uint16_t port);
 
+  // Activates (deactivates) all the slaves, or none of them if any of
+  // them isn't currently deactivated (activated) or the storage fails.
+  bool activateAll(const multihashmap<std::string, uint16_t>& slaves);
+  bool deactivateAll(const multihashmap<std::string, uint16_t>& slaves);
+
   void updateActive(const multihashmap<std::string, uint16_t>& updated);
   void updateInactive(const multihashmap<std::string, uint16_t>& updated);
 
@@ -0,0 +1,298 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <glog/logging.h>
+
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "common/option.hpp"
+
+#include "master/splitting_allocator.hpp"
+
+using std::max;
+using std::min;
+using std::vector;
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+namespace {
+
+// Cpus and memory of a task (or slave), which is all that the free
+// resources of a slave get split by.
+struct Size
+{
+  Size(const Resources& resources)
+  {
+    Value::Scalar none;
+    cpus = resources.get("cpus", none).value();
+    mem = resources.get("mem", none).value();
+  }
+
+  Size(double _cpus, double _mem) : cpus(_cpus), mem(_mem) {}
+
+  double cpus;
+  double mem;
+};
+
+
+// Returns the average size of the requests (if there are any).
+Option<Size> average(const vector<ResourceRequest>& requests)
+{
+  if (requests.empty()) {
+    return Option<Size>::none();
+  }
+
+  double cpus = 0.0;
+  double mem = 0.0;
+  foreach (const ResourceRequest& request, requests) {
+    Size size(Resources(request.resources()));
+    cpus += size.cpus;
+    mem += size.mem;
+  }
+
+  return Size(cpus / requests.size(), mem / requests.size());
+}
+
+
+// Returns the average size of the tasks (if there are any).
+Option<Size> average(const flathashmap<TaskID, Task*>& tasks)
+{
+  if (tasks.empty()) {
+    return Option<Size>::none();
+  }
+
+  double cpus = 0.0;
+  double mem = 0.0;
+  foreachvalue (Task* task, tasks) {
+    Size size(task->resources());
+    cpus += size.cpus;
+    mem += size.mem;
+  }
+
+  return Size(cpus / tasks.size(), mem / tasks.size());
+}
+
+
+// Returns whether there are enough resources to offer (see
+// SimpleAllocator::update).
+bool enough(const Resources& resources)
+{
+  Size size(resources);
+  return size.cpus >= MIN_CPUS && size.mem > MIN_MEM;
+}
+
+
+// Returns the smallest fraction of the free resources of a slave
+// that has room for 'count' tasks of the demanded size, i.e., that
+// fraction of every scalar and the first values of the ranges and
+// sets (e.g., ports), or all of the free resources if the slave
+// doesn't have room for that many tasks.
+Resources split(const Resources& free, const Size& demand, size_t count)
+{
+  Size size(free);
+
+  double fraction = 0.0;
+  if (size.cpus > 0) {
+    fraction = max(fraction, demand.cpus * count / size.cpus);
+  }
+  if (size.mem > 0) {
+    fraction = max(fraction, demand.mem * count / size.mem);
+  }
+
+  if (fraction <= 0.0 || fraction >= 1.0) {
+    return free;
+  }
+
+  Resources result;
+
+  foreach (const Resource& resource, free) {
+    Resource part = resource;
+
+    if (resource.type() == Value::SCALAR) {
+      part.mutable_scalar()->set_value(resource.scalar().value() * fraction);
+    } else if (resource.type() == Value::RANGES) {
+      uint64_t total = 0;
+      foreach (const Value::Range& range, resource.ranges().range()) {
+        total += range.end() - range.begin() + 1;
+      }
+
+      uint64_t wanted = (uint64_t) ceil(total * fraction);
+
+      part.mutable_ranges()->clear_range();
+      foreach (const Value::Range& range, resource.ranges().range()) {
+        if (wanted == 0) {
+          break;
+        }
+        uint64_t values = min(wanted, range.end() - range.begin() + 1);
+        Value::Range* taken = part.mutable_ranges()->add_range();
+        taken->set_begin(range.begin());
+        taken->set_end(range.begin() + values - 1);
+        wanted -= values;
+      }
+    } else if (resource.type() == Value::SET) {
+      int wanted = (int) ceil(resource.set().item_size() * fraction);
+
+      part.mutable_set()->clear_item();
+      for (int i = 0; i < wanted; i++) {
+        part.mutable_set()->add_item(resource.set().item(i));
+      }
+    }
+
+    result += part;
+  }
+
+  return result.allocatable();
+}
+
+} // namespace {
+
+
+void SplittingAllocator::frameworkRemoved(Framework* framework)
+{
+  hints.erase(framework->id);
+  SimpleAllocator::frameworkRemoved(framework);
+}
+
+
+void SplittingAllocator::resourcesRequested(
+    const FrameworkID& frameworkId,
+    const vector<ResourceRequest>& requests)
+{
+  // The requests get made as usual too, but the latest ones also tell
+  // us how big the framework's tasks are (even after they're met).
+  vector<ResourceRequest> sized;
+  foreach (const ResourceRequest& request, requests) {
+    if (!request.gang() && request.resources_size() > 0) {
+      sized.push_back(request);
+    }
+  }
+
+  if (!sized.empty()) {
+    hints[frameworkId] = sized;
+  }
+
+  SimpleAllocator::resourcesRequested(frameworkId, requests);
+}
+
+
+void SplittingAllocator::makeNewOffers(hashmap<Slave*, Resources> available)
+{
+  CHECK(initialized) << "Cannot make new offers before initialization!";
+
+  if (available.size() == 0) {
+    VLOG(1) << "No resources available to allocate!";
+    return;
+  }
+
+  vector<Framework*> ordering = getAllocationOrdering();
+  if (ordering.empty()) {
+    VLOG(1) << "No frameworks to allocate resources!";
+    return;
+  }
+
+  // Clear refusals on any slave that has been refused by everyone.
+  foreachkey (Slave* slave, available) {
+    if (offerFilters.refusals(slave->id) == ordering.size()) {
+      VLOG(1) << "Clearing refusals for slave " << slave->id
+              << " because EVERYONE has refused resources from it";
+      offerFilters.clear(slave->id);
+    }
+  }
+
+  makeRequestedOffers(ordering, available);
+  makeReservedOffers(ordering, available);
+  placeQueuedTasks(ordering, available);
+
+  foreach (Framework* framework, ordering) {
+    if (available.empty()) {
+      break;
+    }
+
+    const Option<Size> size = hints.contains(framework->id)
+      ? average(hints[framework->id])
+      : average(framework->tasks);
+
+    vector<Slave*> candidates;
+    if (framework->info.constraints_size() > 0) {
+      // Only look at the slaves that satisfy the constraints.
+      foreach (const SlaveID& slaveId,
+               attributes.find(framework->info.constraints())) {
+        Slave* slave = master->getSlave(slaveId);
+        if (slave != NULL && available.contains(slave)) {
+          candidates.push_back(slave);
+        }
+      }
+    } else {
+      foreachkey (Slave* slave, available) {
+        candidates.push_back(slave);
+      }
+    }
+
+    hashmap<Slave*, Resources> offerable;
+    foreach (Slave* slave, candidates) {
+      if (filtered(framework, slave, available[slave])) {
+        continue;
+      }
+
+      Resources offered = available[slave];
+
+      // Keep the rest of the slave for the frameworks after this one,
+      // as long as there's enough of it to offer.
+      if (size.isSome()) {
+        const Resources& part = split(offered, size.get(), tasks);
+        if (enough(part) && enough(offered - part)) {
+          offered = part;
+        }
+      }
+
+      VLOG(1) << "Offering " << offered
+              << " on slave " << slave->id
+              << " to framework " << framework->id;
+
+      offerable[slave] = offered;
+    }
+
+    if (offerable.empty()) {
+      continue;
+    }
+
+    foreachpair (Slave* slave, const Resources& offered, offerable) {
+      if (offered == available[slave]) {
+        available.erase(slave);
+      } else {
+        available[slave] -= offered;
+      }
+    }
+
+    makeOffers(framework, offerable);
+
+    foreachkey (Slave* slave, offerable) {
+      update(slave);
+    }
+  }
+}
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,73 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SPLITTING_ALLOCATOR_HPP__
+#define __SPLITTING_ALLOCATOR_HPP__
+
+#include <vector>
+
+#include "common/hashmap.hpp"
+
+#include "master/constants.hpp"
+#include "master/simple_allocator.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// An allocator that splits the free resources of a slave among the
+// frameworks rather than offering all of them to the first framework
+// (in DRF order) that doesn't filter the slave. Each framework gets
+// offered room for 'tasks' tasks of its typical size on a slave, so
+// a big slave can serve several frameworks in the same allocation
+// pass rather than one framework refusing most of it. The typical
+// size of a framework's tasks is the average size of its latest
+// resource requests (its demand hint) if it made any, or else of its
+// running tasks. Frameworks without either get offered whole slaves,
+// as do all frameworks for slaves that would be left with too little
+// to offer anyone else.
+class SplittingAllocator : public SimpleAllocator
+{
+public:
+  SplittingAllocator(size_t _tasks = SPLIT_OFFER_TASKS) : tasks(_tasks) {}
+
+  virtual ~SplittingAllocator() {}
+
+  virtual void frameworkRemoved(Framework* framework);
+
+  virtual void resourcesRequested(
+      const FrameworkID& frameworkId,
+      const std::vector<ResourceRequest>& requests);
+
+protected:
+  virtual void makeNewOffers(hashmap<Slave*, Resources> available);
+
+private:
+  const size_t tasks;
+
+  // Latest (non-gang) resource requests of each framework, kept as
+  // hints of the size of its tasks.
+  hashmap<FrameworkID, std::vector<ResourceRequest> > hints;
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __SPLITTING_ALLOCATOR_HPP__
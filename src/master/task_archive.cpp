@@ -0,0 +1,158 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <glog/logging.h>
+
+#include "common/foreach.hpp"
+
+#include "master/task_archive.hpp"
+
+using std::string;
+using std::vector;
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+const size_t TaskArchive::BLOCK_SIZE;
+
+
+// Appends the tasks serialized in 'data' (each one prefixed by its
+// length, 32 bits in host byte order) to 'tasks'.
+static void parse(const string& data,
+                  const FrameworkID& frameworkId,
+                  vector<Task>* tasks)
+{
+  size_t offset = 0;
+  while (offset < data.size()) {
+    uint32_t length;
+    CHECK(data.size() - offset >= sizeof(length));
+    memcpy(&length, data.data() + offset, sizeof(length));
+    offset += sizeof(length);
+
+    CHECK(data.size() - offset >= length);
+    tasks->push_back(Task());
+    CHECK(tasks->back().ParsePartialFromArray(data.data() + offset, length));
+    tasks->back().mutable_framework_id()->MergeFrom(frameworkId);
+    offset += length;
+  }
+}
+
+
+TaskArchive::TaskArchive(const FrameworkID& _frameworkId, size_t _capacity)
+  : frameworkId(_frameworkId),
+    capacity(_capacity),
+    currentCount(0),
+    count(0) {}
+
+
+void TaskArchive::add(const Task& task)
+{
+  // N.B. The framework ID gets put back when the task gets parsed,
+  // and it's a required field so the task gets serialized partially.
+  Task copy(task);
+  copy.clear_framework_id();
+
+  string data;
+  CHECK(copy.SerializePartialToString(&data));
+
+  const uint32_t length = data.size();
+  current.append((const char*) &length, sizeof(length));
+  current.append(data);
+  currentCount++;
+  count++;
+
+  if (currentCount == BLOCK_SIZE) {
+    seal();
+  }
+
+  while (count > capacity && !blocks.empty()) {
+    blocks.pop_front();
+    count -= BLOCK_SIZE;
+  }
+}
+
+
+vector<Task> TaskArchive::tasks() const
+{
+  vector<Task> tasks;
+  tasks.reserve(count);
+
+  foreach (const string& block, blocks) {
+    // Each block starts with its uncompressed size.
+    uint32_t size;
+    CHECK(block.size() >= sizeof(size));
+    memcpy(&size, block.data(), sizeof(size));
+
+    string data(size, '\0');
+    uLongf length = size;
+    int result = ::uncompress(
+        (Bytef*) &data[0], &length,
+        (const Bytef*) block.data() + sizeof(size),
+        block.size() - sizeof(size));
+    CHECK(result == Z_OK && length == size);
+
+    parse(data, frameworkId, &tasks);
+  }
+
+  parse(current, frameworkId, &tasks);
+
+  return tasks;
+}
+
+
+size_t TaskArchive::bytes() const
+{
+  size_t bytes = current.capacity();
+  foreach (const string& block, blocks) {
+    bytes += block.capacity();
+  }
+  return bytes;
+}
+
+
+void TaskArchive::seal()
+{
+  const uint32_t size = current.size();
+
+  uLongf length = ::compressBound(size);
+  string block(sizeof(size) + length, '\0');
+  memcpy(&block[0], &size, sizeof(size));
+
+  int result = ::compress2(
+      (Bytef*) &block[sizeof(size)], &length,
+      (const Bytef*) current.data(), size,
+      Z_DEFAULT_COMPRESSION);
+  CHECK(result == Z_OK);
+
+  // Copying the block drops the slack left by compressBound.
+  blocks.push_back(block.substr(0, sizeof(size) + length));
+
+  // Swapping (rather than clearing) gives the memory back.
+  string().swap(current);
+  currentCount = 0;
+}
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,80 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __TASK_ARCHIVE_HPP__
+#define __TASK_ARCHIVE_HPP__
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <mesos/mesos.hpp>
+
+#include "messages/messages.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// Keeps the most recently completed tasks of a framework compactly:
+// rather than as Task objects, the tasks get serialized (without
+// their framework ID, which they all share) and every BLOCK_SIZE of
+// them get compressed together. Once there are more than 'capacity'
+// tasks the oldest block gets dropped, so between 'capacity' -
+// BLOCK_SIZE and 'capacity' of the most recent tasks are kept.
+class TaskArchive
+{
+public:
+  static const size_t BLOCK_SIZE = 50;
+
+  TaskArchive(const FrameworkID& frameworkId, size_t capacity);
+
+  void add(const Task& task);
+
+  // Returns the tasks, starting with the oldest one.
+  std::vector<Task> tasks() const;
+
+  // Number of tasks kept.
+  size_t size() const { return count; }
+
+  // Bytes used to keep the tasks (not counting the bookkeeping).
+  size_t bytes() const;
+
+private:
+  // Compresses the tasks added since the last block was compressed.
+  void seal();
+
+  FrameworkID frameworkId;
+  size_t capacity;
+
+  // Compressed blocks of BLOCK_SIZE tasks, starting with the oldest.
+  std::deque<std::string> blocks;
+
+  // Tasks (each one length prefixed) not yet compressed.
+  std::string current;
+  size_t currentCount;
+
+  size_t count;
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __TASK_ARCHIVE_HPP__
@@ -0,0 +1,469 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <mesos/scheduler.hpp>
+
+#include <process/clock.hpp>
+#include <process/process.hpp>
+
+#include "common/fatal.hpp"
+#include "common/foreach.hpp"
+#include "common/logging.hpp"
+#include "common/resources.hpp"
+#include "common/utils.hpp"
+
+#include "configurator/configurator.hpp"
+
+#include "detector/detector.hpp"
+
+#include "master/allocator.hpp"
+#include "master/allocator_factory.hpp"
+#include "master/master.hpp"
+
+#include "messages/messages.hpp"
+
+#include "slave/fake_slave.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+
+using mesos::internal::master::Allocator;
+using mesos::internal::master::AllocatorFactory;
+using mesos::internal::master::Master;
+
+using mesos::internal::slave::FakeSlave;
+
+using process::Clock;
+using process::UPID;
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+
+// When each task was due to be launched (at the target rate), got
+// offered resources to run on, got launched, and was reported as
+// running and as finished.
+struct Times
+{
+  Times() : due(0), offered(0), launched(0), running(0), finished(0) {}
+
+  double due;
+  double offered;
+  double launched;
+  double running;
+  double finished;
+};
+
+
+// Launches tasks at a given rate on the first offers that fit them,
+// declining whatever it can't use right away.
+class BenchScheduler : public Scheduler
+{
+public:
+  BenchScheduler(int tasks, double _rate, const Resources& _task)
+    : times(tasks),
+      done(false),
+      rate(_rate),
+      task(_task),
+      start(0),
+      launched(0),
+      finished(0) {}
+
+  virtual ~BenchScheduler() {}
+
+  virtual void registered(SchedulerDriver*, const FrameworkID&)
+  {
+    start = Clock::now();
+
+    for (size_t i = 0; i < times.size(); i++) {
+      times[i].due = start + i / rate;
+    }
+  }
+
+  virtual void resourceOffers(SchedulerDriver* driver,
+                              const vector<Offer>& offers)
+  {
+    const double now = Clock::now();
+
+    foreach (const Offer& offer, offers) {
+      Resources remaining = offer.resources();
+
+      vector<TaskDescription> tasks;
+
+      while (launched < times.size() &&
+             times[launched].due <= now &&
+             task <= remaining) {
+        TaskDescription description;
+        description.set_name("");
+        description.mutable_task_id()->set_value(
+            utils::stringify(launched));
+        description.mutable_slave_id()->MergeFrom(offer.slave_id());
+        description.mutable_resources()->MergeFrom(task);
+        tasks.push_back(description);
+
+        times[launched++].offered = now;
+        remaining -= task;
+      }
+
+      // Have any resources that went unused offered again as soon as
+      // possible, since more tasks will be due shortly.
+      Filters filters;
+      filters.set_refuse_seconds(0);
+
+      driver->launchTasks(offer.id(), tasks, filters);
+
+      const double time = Clock::now();
+      foreach (const TaskDescription& description, tasks) {
+        times[atoi(description.task_id().value().c_str())].launched = time;
+      }
+    }
+  }
+
+  virtual void offerRescinded(SchedulerDriver*, const OfferID&) {}
+
+  virtual void statusUpdate(SchedulerDriver*, const TaskStatus& status)
+  {
+    const size_t index = atoi(status.task_id().value().c_str());
+
+    if (index >= times.size()) {
+      return;
+    }
+
+    if (status.state() == TASK_RUNNING) {
+      times[index].running = Clock::now();
+    } else if (status.state() == TASK_FINISHED) {
+      times[index].finished = Clock::now();
+      if (++finished == times.size()) {
+        done = true;
+      }
+    }
+  }
+
+  virtual void frameworkMessage(SchedulerDriver*,
+                                const SlaveID&,
+                                const ExecutorID&,
+                                const string&) {}
+
+  virtual void slaveLost(SchedulerDriver*, const SlaveID&) {}
+
+  virtual void error(SchedulerDriver*, int code, const string& message)
+  {
+    fatal("Scheduler error %d: %s", code, message.c_str());
+  }
+
+  vector<Times> times;
+
+  volatile bool done;
+
+private:
+  const double rate;
+  const Resources task;
+
+  double start;
+  size_t launched;
+  size_t finished;
+};
+
+
+// Collects latencies (in milliseconds) and reports their percentiles.
+class Latencies
+{
+public:
+  void add(double from, double to)
+  {
+    if (from > 0 && to >= from) {
+      latencies.push_back((to - from) * 1000);
+    }
+  }
+
+  void report(const string& name)
+  {
+    std::sort(latencies.begin(), latencies.end());
+
+    cout << "  " << std::left << std::setw(20) << name << std::right
+         << " p50 " << std::setw(9) << percentile(0.5)
+         << " p90 " << std::setw(9) << percentile(0.9)
+         << " p99 " << std::setw(9) << percentile(0.99)
+         << " max " << std::setw(9)
+         << (latencies.empty() ? 0 : latencies.back())
+         << endl;
+  }
+
+private:
+  // Returns the specified percentile (nearest rank), expects the
+  // latencies to be sorted.
+  double percentile(double p) const
+  {
+    if (latencies.empty()) {
+      return 0;
+    }
+
+    size_t rank = (size_t) (p * latencies.size());
+    return latencies[std::min(rank, latencies.size() - 1)];
+  }
+
+  vector<double> latencies;
+};
+
+
+// Returns the CPU time (user and system, in seconds) used by this
+// process so far.
+static double cpu()
+{
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) < 0) {
+    return 0;
+  }
+
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0 +
+    usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+}
+
+
+void usage(const char* programName, const Configurator& configurator)
+{
+  cerr << "Usage: " << programName << " [--slaves=N] [--schedulers=M] [...]"
+       << endl
+       << endl
+       << "Benchmarks a master end to end: N fake slaves (that run no "
+       << "executors) and" << endl
+       << "M schedulers that launch no-op tasks at a target rate, either "
+       << "with a master" << endl
+       << "in this process or with the one at --master." << endl
+       << endl
+       << "Supported options:" << endl
+       << configurator.getUsage();
+}
+
+
+int main(int argc, char** argv)
+{
+  GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+  Configurator configurator;
+  Logging::registerOptions(&configurator);
+  Master::registerOptions(&configurator);
+  configurator.addOption<string>("master", "Master to benchmark (URL), "
+                                 "rather than one in this process", "");
+  configurator.addOption<string>("allocator", "Allocator of the master "
+                                 "in this process", "simple");
+  configurator.addOption<int>("slaves", "Number of fake slaves", 100);
+  configurator.addOption<int>("schedulers", "Number of schedulers", 10);
+  configurator.addOption<string>("resources", "Resources of each slave",
+                                 "cpus:8;mem:16384");
+  configurator.addOption<string>("task", "Resources of each task",
+                                 "cpus:1;mem:128");
+  configurator.addOption<int>("tasks", "Tasks launched by each scheduler",
+                              1000);
+  configurator.addOption<double>("rate", "Tasks launched per second (by "
+                                 "all schedulers)", 1000.0);
+  configurator.addOption<double>("task_duration", "Seconds each task runs "
+                                 "for", 0.0);
+  configurator.addOption<double>("timeout", "Seconds to wait for all the "
+                                 "tasks to finish", 300.0);
+
+  if (argc == 2 && string("--help") == argv[1]) {
+    usage(argv[0], configurator);
+    exit(1);
+  }
+
+  Configuration conf;
+  try {
+    conf = configurator.load(argc, argv, true);
+  } catch (ConfigurationException& e) {
+    cerr << "Configuration error: " << e.what() << endl;
+    exit(1);
+  }
+
+  Logging::init(argv[0], conf);
+
+  process::initialize(false);
+
+  string url = conf.get<string>("master", "");
+  const string name = conf.get<string>("allocator", "simple");
+  const int slaves = conf.get<int>("slaves", 100);
+  const int schedulers = conf.get<int>("schedulers", 10);
+  const Resources resources =
+    Resources::parse(conf.get<string>("resources", "cpus:8;mem:16384"));
+  const Resources task =
+    Resources::parse(conf.get<string>("task", "cpus:1;mem:128"));
+  const int tasks = conf.get<int>("tasks", 1000);
+  const double rate = conf.get<double>("rate", 1000.0);
+  const double taskDuration = conf.get<double>("task_duration", 0.0);
+  const double timeout = conf.get<double>("timeout", 300.0);
+
+  if (slaves < 1 || schedulers < 1 || tasks < 1 || rate <= 0) {
+    fatal("Expecting at least one slave, scheduler and task "
+          "and a positive rate");
+  }
+
+  Allocator* allocator = NULL;
+  Master* master = NULL;
+
+  if (url == "") {
+    allocator = AllocatorFactory::instantiate(name, NULL);
+
+    if (allocator == NULL) {
+      fatal("Unknown allocator: %s", name.c_str());
+    }
+
+    master = new Master(allocator, conf);
+    url = string(process::spawn(master));
+  }
+
+  vector<FakeSlave*> fakes;
+  vector<UPID> pids;
+
+  for (int i = 0; i < slaves; i++) {
+    SlaveInfo info;
+    info.set_hostname("slave" + utils::stringify(i));
+    info.set_webui_hostname(info.hostname());
+    info.mutable_resources()->MergeFrom(resources);
+
+    FakeSlave* fake = new FakeSlave(info, taskDuration);
+    pids.push_back(process::spawn(fake));
+    fakes.push_back(fake);
+  }
+
+  vector<MasterDetector*> detectors;
+
+  if (master != NULL) {
+    detectors.push_back(new BasicMasterDetector(master->self(), pids, true));
+  } else {
+    foreach (const UPID& pid, pids) {
+      detectors.push_back(MasterDetector::create(url, pid, false, true));
+    }
+  }
+
+  cout << "Benchmarking " << (master != NULL ? "a master in this process"
+                                             : "the master at " + url)
+       << " with " << slaves << " slaves and " << schedulers
+       << " schedulers launching " << tasks * schedulers
+       << " tasks at " << rate << " tasks/second" << endl;
+
+  ExecutorInfo executor;
+  executor.mutable_executor_id()->set_value("default");
+  executor.set_uri("noexecutor");
+
+  vector<BenchScheduler*> scheds;
+  vector<MesosSchedulerDriver*> drivers;
+
+  const double start = Clock::now();
+  const double started = cpu();
+
+  for (int i = 0; i < schedulers; i++) {
+    BenchScheduler* sched = new BenchScheduler(tasks, rate / schedulers, task);
+    MesosSchedulerDriver* driver = new MesosSchedulerDriver(
+        sched, "bench" + utils::stringify(i), executor, url);
+    driver->start();
+    scheds.push_back(sched);
+    drivers.push_back(driver);
+  }
+
+  // Wait for the tasks to finish.
+  bool done = false;
+  while (!done && Clock::now() - start < timeout) {
+    usleep(10000);
+
+    done = true;
+    foreach (BenchScheduler* sched, scheds) {
+      done = done && sched->done;
+    }
+  }
+
+  const double elapsed = Clock::now() - start;
+  const double used = cpu() - started;
+
+  foreach (MesosSchedulerDriver* driver, drivers) {
+    driver->stop();
+    driver->join();
+    delete driver;
+  }
+
+  Latencies offered, launched, running, finished;
+  size_t completed = 0;
+
+  foreach (BenchScheduler* sched, scheds) {
+    foreach (const Times& times, sched->times) {
+      offered.add(times.due, times.offered);
+      launched.add(times.offered, times.launched);
+      running.add(times.launched, times.running);
+      finished.add(times.running, times.finished);
+      if (times.finished > 0) {
+        completed++;
+      }
+    }
+    delete sched;
+  }
+
+  if (!done) {
+    cout << "Timed out after " << timeout << " seconds" << endl;
+  }
+
+  cout << std::fixed << std::setprecision(3)
+       << completed << " tasks finished in " << elapsed << " seconds, "
+       << (elapsed > 0 ? completed / elapsed : 0) << " tasks/second"
+       << endl
+       << "  latency (ms):" << endl;
+
+  offered.report("due-to-offer");
+  launched.report("offer-to-launch");
+  running.report("launch-to-RUNNING");
+  finished.report("RUNNING-to-FINISHED");
+
+  cout << "  CPU per task (ms): "
+       << (completed > 0 ? used * 1000 / completed : 0)
+       << (master != NULL
+           ? " (master, fake slaves and schedulers)"
+           : " (fake slaves and schedulers, not the master)")
+       << endl;
+
+  foreach (MasterDetector* detector, detectors) {
+    MasterDetector::destroy(detector);
+  }
+
+  foreach (FakeSlave* fake, fakes) {
+    process::terminate(fake);
+    process::wait(fake);
+    delete fake;
+  }
+
+  if (master != NULL) {
+    process::terminate(master);
+    process::wait(master);
+    delete master;
+    delete allocator;
+  }
+
+  return done ? 0 : 1;
+}
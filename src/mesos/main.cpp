@@ -24,6 +24,7 @@ void usage(const char* programName, const Configurator& configurator)
        << "  zoo://host1:port1,host2:port2,..." << endl
        << "  zoofile://file where file contains a host:port pair per line"
        << endl
+       << "  log://host1:port1,host2:port2,... (the masters)" << endl
        << endl
        << "Supported options:" << endl
        << configurator.getUsage();
@@ -151,8 +151,11 @@ int MesosExecutorDriverImpl_init(MesosExecutorDriverImpl *self,
   }
 
   if (self->driver != NULL) {
+    // See the comment in MesosExecutorDriverImpl_dealloc.
+    Py_BEGIN_ALLOW_THREADS
     self->driver->stop();
     delete self->driver;
+    Py_END_ALLOW_THREADS
     self->driver = NULL;
   }
 
@@ -174,14 +177,14 @@ int MesosExecutorDriverImpl_init(MesosExecutorDriverImpl *self,
 void MesosExecutorDriverImpl_dealloc(MesosExecutorDriverImpl* self)
 {
   if (self->driver != NULL) {
-    self->driver->stop();
-    // We need to wrap the driver destructor in an "allow threads"
-    // macro since the MesosExecutorDriver destructor waits for the
-    // ExecutorProcess to terminate and there might be a thread that
-    // is trying to acquire the GIL to call through the
+    // We need to wrap stopping and destroying the driver in an
+    // "allow threads" macro since the MesosExecutorDriver destructor
+    // waits for the ExecutorProcess to terminate and there might be a
+    // thread that is trying to acquire the GIL to call through the
     // ProxyExecutor. It will only be after this thread executes that
     // the ExecutorProcess might actually get a terminate.
     Py_BEGIN_ALLOW_THREADS
+    self->driver->stop();
     delete self->driver;
     Py_END_ALLOW_THREADS
     self->driver = NULL;
@@ -221,6 +224,11 @@ int MesosExecutorDriverImpl_clear(MesosExecutorDriverImpl* self)
 }
 
 
+// The driver calls below (like any that might block) release the
+// GIL while they run, so that other Python threads can run while the
+// driver does I/O or waits, and so that they can't deadlock with the
+// driver's thread, which needs the GIL to call into Python (see
+// InterpreterLock) while it might hold locks that the calls need.
 PyObject* MesosExecutorDriverImpl_start(MesosExecutorDriverImpl* self)
 {
   if (self->driver == NULL) {
@@ -228,7 +236,10 @@ PyObject* MesosExecutorDriverImpl_start(MesosExecutorDriverImpl* self)
     return NULL;
   }
 
-  Status status = self->driver->start();
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->start();
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets an exception if creating the int fails
 }
 
@@ -240,7 +251,10 @@ PyObject* MesosExecutorDriverImpl_stop(MesosExecutorDriverImpl* self)
     return NULL;
   }
 
-  Status status = self->driver->stop();
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->stop();
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets an exception if creating the int fails
 }
 
@@ -252,7 +266,10 @@ PyObject* MesosExecutorDriverImpl_abort(MesosExecutorDriverImpl* self)
     return NULL;
   }
 
-  Status status = self->driver->abort();
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->abort();
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets an exception if creating the int fails
 }
 
@@ -307,7 +324,10 @@ PyObject* MesosExecutorDriverImpl_sendStatusUpdate(
     return NULL;
   }
 
-  Status status = self->driver->sendStatusUpdate(taskStatus);
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->sendStatusUpdate(taskStatus);
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets an exception if creating the int fails
 }
 
@@ -326,7 +346,10 @@ PyObject* MesosExecutorDriverImpl_sendFrameworkMessage(
     return NULL;
   }
 
-  Status status = self->driver->sendFrameworkMessage(data);
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->sendFrameworkMessage(data);
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets an exception if creating the int fails
 }
 
@@ -107,6 +107,14 @@ PyMethodDef MesosSchedulerDriverImpl_methods[] = {
    (PyCFunction) MesosSchedulerDriverImpl_launchTasks,
    METH_VARARGS,
    "Reply to a Mesos offer with a list of tasks"},
+  {"declineOffers",
+   (PyCFunction) MesosSchedulerDriverImpl_declineOffers,
+   METH_VARARGS,
+   "Decline a list of Mesos offers, returning their resources right away"},
+  {"reconcileTasks",
+   (PyCFunction) MesosSchedulerDriverImpl_reconcileTasks,
+   METH_VARARGS,
+   "Ask Mesos for the current state of a list of tasks (or all tasks)"},
   {"killTask",
    (PyCFunction) MesosSchedulerDriverImpl_killTask,
    METH_VARARGS,
@@ -168,8 +176,11 @@ int MesosSchedulerDriverImpl_init(MesosSchedulerDriverImpl* self,
   }
 
   if (self->driver != NULL) {
+    // See the comment in MesosSchedulerDriverImpl_dealloc.
+    Py_BEGIN_ALLOW_THREADS
     self->driver->stop();
     delete self->driver;
+    Py_END_ALLOW_THREADS
     self->driver = NULL;
   }
 
@@ -214,14 +225,14 @@ int MesosSchedulerDriverImpl_init(MesosSchedulerDriverImpl* self,
 void MesosSchedulerDriverImpl_dealloc(MesosSchedulerDriverImpl* self)
 {
   if (self->driver != NULL) {
-    self->driver->stop();
-    // We need to wrap the driver destructor in an "allow threads"
-    // macro since the MesosSchedulerDriver destructor waits for the
-    // SchedulerProcess to terminate and there might be a thread that
-    // is trying to acquire the GIL to call through the
+    // We need to wrap stopping and destroying the driver in an
+    // "allow threads" macro since the MesosSchedulerDriver destructor
+    // waits for the SchedulerProcess to terminate and there might be a
+    // thread that is trying to acquire the GIL to call through the
     // ProxyScheduler. It will only be after this thread executes that
     // the SchedulerProcess might actually get a terminate.
     Py_BEGIN_ALLOW_THREADS
+    self->driver->stop();
     delete self->driver;
     Py_END_ALLOW_THREADS
     self->driver = NULL;
@@ -261,6 +272,11 @@ int MesosSchedulerDriverImpl_clear(MesosSchedulerDriverImpl* self)
 }
 
 
+// The driver calls below (like any that might block) release the
+// GIL while they run, so that other Python threads can run while the
+// driver does I/O or waits, and so that they can't deadlock with the
+// driver's thread, which needs the GIL to call into Python (see
+// InterpreterLock) while it might hold locks that the calls need.
 PyObject* MesosSchedulerDriverImpl_start(MesosSchedulerDriverImpl* self)
 {
   if (self->driver == NULL) {
@@ -268,7 +284,10 @@ PyObject* MesosSchedulerDriverImpl_start(MesosSchedulerDriverImpl* self)
     return NULL;
   }
 
-  Status status = self->driver->start();
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->start();
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets an exception if creating the int fails
 }
 
@@ -287,7 +306,10 @@ PyObject* MesosSchedulerDriverImpl_stop(MesosSchedulerDriverImpl* self,
     return NULL;
   }
 
-  Status status = self->driver->stop(failover);
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->stop(failover);
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets an exception if creating the int fails
 }
 
@@ -299,7 +321,10 @@ PyObject* MesosSchedulerDriverImpl_abort(MesosSchedulerDriverImpl* self)
     return NULL;
   }
 
-  Status status = self->driver->abort();
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->abort();
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets an exception if creating the int fails
 }
 
@@ -368,7 +393,10 @@ PyObject* MesosSchedulerDriverImpl_requestResources(MesosSchedulerDriverImpl* se
     requests.push_back(request);
   }
 
-  Status status = self->driver->requestResources(requests);
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->requestResources(requests);
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets an exception if creating the int fails
 }
 
@@ -424,7 +452,106 @@ PyObject* MesosSchedulerDriverImpl_launchTasks(MesosSchedulerDriverImpl* self,
     }
   }
 
-  Status status = self->driver->launchTasks(offerId, tasks, filters);
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->launchTasks(offerId, tasks, filters);
+  Py_END_ALLOW_THREADS
+  return PyInt_FromLong(status); // Sets an exception if creating the int fails
+}
+
+
+PyObject* MesosSchedulerDriverImpl_declineOffers(MesosSchedulerDriverImpl* self,
+                                                 PyObject* args)
+{
+  if (self->driver == NULL) {
+    PyErr_Format(PyExc_Exception, "MesosSchedulerDriverImpl.driver is NULL");
+    return NULL;
+  }
+
+  PyObject* offerIdsObj = NULL;
+  PyObject* filtersObj = NULL;
+  vector<OfferID> offerIds;
+  Filters filters;
+
+  if (!PyArg_ParseTuple(args, "O|O", &offerIdsObj, &filtersObj)) {
+    return NULL;
+  }
+
+  if (!PyList_Check(offerIdsObj)) {
+    PyErr_Format(PyExc_Exception, "Parameter 1 to declineOffers is not a list");
+    return NULL;
+  }
+  Py_ssize_t len = PyList_Size(offerIdsObj);
+  for (int i = 0; i < len; i++) {
+    PyObject* offerIdObj = PyList_GetItem(offerIdsObj, i);
+    if (offerIdObj == NULL) {
+      return NULL; // Exception will have been set by PyList_GetItem
+    }
+    OfferID offerId;
+    if (!readPythonProtobuf(offerIdObj, &offerId)) {
+      PyErr_Format(PyExc_Exception, "Could not deserialize Python OfferID");
+      return NULL;
+    }
+    offerIds.push_back(offerId);
+  }
+
+  if (filtersObj != NULL) {
+    if (!readPythonProtobuf(filtersObj, &filters)) {
+      PyErr_Format(PyExc_Exception,
+                   "Could not deserialize Python Filters");
+      return NULL;
+    }
+  }
+
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->declineOffers(offerIds, filters);
+  Py_END_ALLOW_THREADS
+  return PyInt_FromLong(status); // Sets an exception if creating the int fails
+}
+
+
+PyObject* MesosSchedulerDriverImpl_reconcileTasks(
+    MesosSchedulerDriverImpl* self,
+    PyObject* args)
+{
+  if (self->driver == NULL) {
+    PyErr_Format(PyExc_Exception, "MesosSchedulerDriverImpl.driver is NULL");
+    return NULL;
+  }
+
+  PyObject* taskIdsObj = NULL;
+  vector<TaskID> taskIds;
+
+  if (!PyArg_ParseTuple(args, "|O", &taskIdsObj)) {
+    return NULL;
+  }
+
+  if (taskIdsObj != NULL) {
+    if (!PyList_Check(taskIdsObj)) {
+      PyErr_Format(PyExc_Exception,
+                   "Parameter 1 to reconcileTasks is not a list");
+      return NULL;
+    }
+    Py_ssize_t len = PyList_Size(taskIdsObj);
+    for (int i = 0; i < len; i++) {
+      PyObject* taskIdObj = PyList_GetItem(taskIdsObj, i);
+      if (taskIdObj == NULL) {
+        return NULL; // Exception will have been set by PyList_GetItem
+      }
+      TaskID taskId;
+      if (!readPythonProtobuf(taskIdObj, &taskId)) {
+        PyErr_Format(PyExc_Exception, "Could not deserialize Python TaskID");
+        return NULL;
+      }
+      taskIds.push_back(taskId);
+    }
+  }
+
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->reconcileTasks(taskIds);
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets an exception if creating the int fails
 }
 
@@ -447,7 +574,10 @@ PyObject* MesosSchedulerDriverImpl_killTask(MesosSchedulerDriverImpl* self,
     return NULL;
   }
 
-  Status status = self->driver->killTask(tid);
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->killTask(tid);
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets an exception if creating the int fails
 }
 
@@ -459,7 +589,10 @@ PyObject* MesosSchedulerDriverImpl_reviveOffers(MesosSchedulerDriverImpl* self)
     return NULL;
   }
 
-  Status status = self->driver->reviveOffers();
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->reviveOffers();
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets an exception if creating the int fails
 }
 
@@ -491,7 +624,10 @@ PyObject* MesosSchedulerDriverImpl_sendFrameworkMessage(
     return NULL;
   }
 
-  Status status = self->driver->sendFrameworkMessage(sid, eid, data);
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->sendFrameworkMessage(sid, eid, data);
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets an exception if creating the int fails
 }
 
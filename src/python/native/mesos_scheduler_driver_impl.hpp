@@ -98,6 +98,13 @@ PyObject* MesosSchedulerDriverImpl_requestResources(MesosSchedulerDriverImpl* se
 PyObject* MesosSchedulerDriverImpl_launchTasks(MesosSchedulerDriverImpl* self,
                                                PyObject* args);
 
+PyObject* MesosSchedulerDriverImpl_declineOffers(MesosSchedulerDriverImpl* self,
+                                                 PyObject* args);
+
+PyObject* MesosSchedulerDriverImpl_reconcileTasks(
+    MesosSchedulerDriverImpl* self,
+    PyObject* args);
+
 PyObject* MesosSchedulerDriverImpl_killTask(MesosSchedulerDriverImpl* self,
                                             PyObject* args);
 
@@ -121,18 +121,22 @@ PyObject* createPythonProtobuf(const T& t, const char* typeName)
     return NULL;
   }
 
-  std::string str;
-  if (!t.SerializeToString(&str)) {
-    PyErr_Format(PyExc_Exception, "C++ %s SerializeToString failed", typeName);
-    return NULL;
+  // Serialize straight into a Python string (rather than into a C++
+  // string that then gets copied).
+  PyObject* str = PyString_FromStringAndSize(NULL, t.ByteSize());
+  if (str == NULL) {
+    return NULL; // PyString_FromStringAndSize will have set an exception
   }
+  t.SerializeWithCachedSizesToArray(
+      (google::protobuf::uint8*) PyString_AS_STRING(str));
 
   // Propagates any exception that might happen in FromString
-  return PyObject_CallMethod(type,
-                             (char*) "FromString",
-                             (char*) "s#",
-                             str.data(),
-                             str.size());
+  PyObject* result = PyObject_CallMethod(type,
+                                         (char*) "FromString",
+                                         (char*) "O",
+                                         str);
+  Py_DECREF(str);
+  return result;
 }
 
 }} /* namespace mesos { namespace python { */
@@ -173,6 +173,65 @@ cleanup:
 }
 
 
+void ProxyScheduler::statusUpdates(SchedulerDriver* driver,
+                                   const vector<TaskStatus>& statuses)
+{
+  InterpreterLock lock;
+
+  PyObject* list = NULL;
+  PyObject* res = NULL;
+
+  list = PyList_New(statuses.size());
+  if (list == NULL) {
+    goto cleanup;
+  }
+  for (int i = 0; i < statuses.size(); i++) {
+    PyObject* stat = createPythonProtobuf(statuses[i], "TaskStatus");
+    if (stat == NULL) {
+      goto cleanup; // createPythonProtobuf will have set an exception
+    }
+    PyList_SetItem(list, i, stat); // Steals the reference to stat
+  }
+
+  // Schedulers that don't extend mesos.Scheduler might only handle
+  // the updates one at a time, but they still all get handled while
+  // holding the interpreter lock just once.
+  if (PyObject_HasAttrString(impl->pythonScheduler, "statusUpdates")) {
+    res = PyObject_CallMethod(impl->pythonScheduler,
+                              (char*) "statusUpdates",
+                              (char*) "OO",
+                              impl,
+                              list);
+    if (res == NULL) {
+      cerr << "Failed to call scheduler's statusUpdates" << endl;
+      goto cleanup;
+    }
+  } else {
+    for (int i = 0; i < statuses.size(); i++) {
+      res = PyObject_CallMethod(impl->pythonScheduler,
+                                (char*) "statusUpdate",
+                                (char*) "OO",
+                                impl,
+                                PyList_GET_ITEM(list, i));
+      if (res == NULL) {
+        cerr << "Failed to call scheduler's statusUpdate" << endl;
+        goto cleanup;
+      }
+      Py_DECREF(res);
+      res = NULL;
+    }
+  }
+
+cleanup:
+  if (PyErr_Occurred()) {
+    PyErr_Print();
+    driver->abort();
+  }
+  Py_XDECREF(list);
+  Py_XDECREF(res);
+}
+
+
 void ProxyScheduler::frameworkMessage(SchedulerDriver* driver,
                                       const SlaveID& slaveId,
                                       const ExecutorID& executorId,
@@ -61,6 +61,9 @@ public:
   virtual void statusUpdate(SchedulerDriver* driver,
                             const TaskStatus& status);
 
+  virtual void statusUpdates(SchedulerDriver* driver,
+                             const std::vector<TaskStatus>& statuses);
+
   virtual void frameworkMessage(SchedulerDriver* driver,
                                 const SlaveID& slaveId,
                                 const ExecutorID& executorId,
@@ -29,6 +29,13 @@ class Scheduler:
   def resourceOffers(self, driver, offers): pass
   def offerRescinded(self, driver, offerId): pass
   def statusUpdate(self, driver, status): pass
+
+  # Invoked with several status updates at once (see
+  # Scheduler::statusUpdates in include/mesos/scheduler.hpp).
+  def statusUpdates(self, driver, statuses):
+    for status in statuses:
+      self.statusUpdate(driver, status)
+
   def frameworkMessage(self, driver, message): pass
   def slaveLost(self, driver, slaveId): pass
 
@@ -48,6 +55,8 @@ class SchedulerDriver:
   def run(self): pass
   def requestResources(self, requests): pass
   def launchTasks(self, offerId, tasks, filters=None): pass
+  def declineOffers(self, offerIds, filters=None): pass
+  def reconcileTasks(self, taskIds=[]): pass
   def killTask(self, taskId): pass
   def reviveOffers(self): pass
   def sendFrameworkMessage(self, slaveId, executorId, data): pass
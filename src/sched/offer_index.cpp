@@ -0,0 +1,256 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <glog/logging.h>
+
+#include <mesos/offer_index.hpp>
+
+#include "common/foreach.hpp"
+#include "common/resources.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+
+using std::make_pair;
+using std::multimap;
+using std::pair;
+using std::set;
+using std::string;
+using std::vector;
+
+
+namespace {
+
+// Cpus and memory of some resources, which the offers get indexed by.
+pair<double, double> key(const Resources& resources)
+{
+  Value::Scalar none;
+  return make_pair(resources.get("cpus", none).value(),
+                   resources.get("mem", none).value());
+}
+
+
+// Returns true if the offer has (an equal) attribute for each of the
+// attributes.
+bool matches(const Offer& offer, const vector<Attribute>& attributes)
+{
+  foreach (const Attribute& attribute, attributes) {
+    const string& wanted = attribute.SerializeAsString();
+
+    bool found = false;
+    foreach (const Attribute& candidate, offer.attributes()) {
+      if (candidate.name() == attribute.name() &&
+          candidate.SerializeAsString() == wanted) {
+        found = true;
+        break;
+      }
+    }
+
+    if (!found) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+} // namespace {
+
+
+namespace mesos {
+
+struct OfferIndex::Entry
+{
+  Offer offer;
+
+  // Resources of the offer that haven't been taken yet.
+  Resources resources;
+
+  multimap<pair<double, double>, Entry*>::iterator position;
+};
+
+
+OfferIndex::OfferIndex() {}
+
+
+OfferIndex::~OfferIndex()
+{
+  clear();
+}
+
+
+void OfferIndex::add(const Offer& offer)
+{
+  remove(offer.id());
+
+  Entry* entry = new Entry();
+  entry->offer = offer;
+  entry->resources = Resources(offer.resources());
+  entry->position = free.insert(make_pair(key(entry->resources), entry));
+
+  offers[offer.id().value()] = entry;
+  slaves[offer.slave_id().value()].insert(offer.id().value());
+}
+
+
+void OfferIndex::add(const vector<Offer>& offers)
+{
+  foreach (const Offer& offer, offers) {
+    add(offer);
+  }
+}
+
+
+bool OfferIndex::remove(const OfferID& offerId)
+{
+  std::map<string, Entry*>::iterator it = offers.find(offerId.value());
+  if (it == offers.end()) {
+    return false;
+  }
+
+  Entry* entry = it->second;
+
+  const string& slaveId = entry->offer.slave_id().value();
+  slaves[slaveId].erase(offerId.value());
+  if (slaves[slaveId].empty()) {
+    slaves.erase(slaveId);
+  }
+
+  free.erase(entry->position);
+  offers.erase(it);
+  delete entry;
+
+  return true;
+}
+
+
+void OfferIndex::remove(const SlaveID& slaveId)
+{
+  if (slaves.count(slaveId.value()) == 0) {
+    return;
+  }
+
+  // Copied since removing the offers changes the slave's offers.
+  const set<string> ids = slaves[slaveId.value()];
+  foreach (const string& id, ids) {
+    OfferID offerId;
+    offerId.set_value(id);
+    remove(offerId);
+  }
+}
+
+
+void OfferIndex::clear()
+{
+  foreachvalue (Entry* entry, offers) {
+    delete entry;
+  }
+
+  offers.clear();
+  slaves.clear();
+  free.clear();
+}
+
+
+bool OfferIndex::contains(const OfferID& offerId) const
+{
+  return offers.count(offerId.value()) > 0;
+}
+
+
+size_t OfferIndex::size() const
+{
+  return offers.size();
+}
+
+
+const Offer& OfferIndex::get(const OfferID& offerId) const
+{
+  CHECK(contains(offerId)) << "Unknown offer " << offerId.value();
+  return offers.find(offerId.value())->second->offer;
+}
+
+
+vector<Resource> OfferIndex::remaining(const OfferID& offerId) const
+{
+  CHECK(contains(offerId)) << "Unknown offer " << offerId.value();
+
+  vector<Resource> result;
+  foreach (const Resource& resource,
+           offers.find(offerId.value())->second->resources) {
+    result.push_back(resource);
+  }
+
+  return result;
+}
+
+
+bool OfferIndex::find(
+    const google::protobuf::RepeatedPtrField<Resource>& resources,
+    OfferID* offerId,
+    const vector<Attribute>& attributes) const
+{
+  const Resources requested(resources);
+  const pair<double, double> needed = key(requested);
+
+  // Only the offers with at least as many cpus free can fit, and the
+  // first of them that does fit has the least cpus (and then memory)
+  // left over.
+  multimap<pair<double, double>, Entry*>::const_iterator it =
+    free.lower_bound(make_pair(needed.first, needed.second));
+
+  for (; it != free.end(); ++it) {
+    const Entry* entry = it->second;
+    if (it->first.second >= needed.second &&
+        requested <= entry->resources &&
+        matches(entry->offer, attributes)) {
+      offerId->MergeFrom(entry->offer.id());
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+bool OfferIndex::take(
+    const google::protobuf::RepeatedPtrField<Resource>& resources,
+    OfferID* offerId,
+    const vector<Attribute>& attributes)
+{
+  OfferID found;
+  if (!find(resources, &found, attributes)) {
+    return false;
+  }
+
+  Entry* entry = offers[found.value()];
+  entry->resources -= Resources(resources);
+  index(entry);
+
+  offerId->MergeFrom(found);
+  return true;
+}
+
+
+void OfferIndex::index(Entry* entry)
+{
+  free.erase(entry->position);
+  entry->position = free.insert(make_pair(key(entry->resources), entry));
+}
+
+} // namespace mesos {
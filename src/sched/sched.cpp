@@ -25,11 +25,14 @@
 
 #include <arpa/inet.h>
 
+#include <algorithm>
 #include <iostream>
 #include <map>
 #include <string>
 #include <sstream>
 
+#include <tr1/functional>
+
 #include <mesos/scheduler.hpp>
 
 #include <process/dispatch.hpp>
@@ -39,10 +42,13 @@
 
 #include "configurator/configuration.hpp"
 
+#include "common/backoff.hpp"
 #include "common/fatal.hpp"
 #include "common/hashmap.hpp"
 #include "common/lock.hpp"
 #include "common/logging.hpp"
+#include "common/option.hpp"
+#include "common/tracer.hpp"
 #include "common/type_utils.hpp"
 #include "common/uuid.hpp"
 
@@ -57,7 +63,9 @@ using namespace mesos::internal;
 
 using namespace process;
 
+using std::make_pair;
 using std::map;
+using std::pair;
 using std::string;
 using std::vector;
 
@@ -67,6 +75,27 @@ using process::wait; // Necessary on some OS's to disambiguate.
 namespace mesos {
 namespace internal {
 
+// Bounds on the (randomized, exponentially increasing) interval
+// between attempts to (re-)register the framework with the master.
+const double REGISTRATION_RETRY_INTERVAL_SECONDS = 1.0;
+const double REGISTRATION_RETRY_INTERVAL_MAX_SECONDS = 60.0;
+
+
+// Invokes scheduler callbacks, one at a time and in the order they
+// were queued, on behalf of a scheduler process whose driver was
+// configured with "async_callbacks". This way a slow scheduler
+// doesn't hold up the scheduler process (e.g., receiving messages or
+// retrying registration).
+class CallbackProcess : public Process<CallbackProcess>
+{
+public:
+  void invoke(const std::tr1::function<void(void)>& callback)
+  {
+    callback();
+  }
+};
+
+
 // The scheduler process (below) is responsible for interacting with
 // the master and responding to Mesos API calls from scheduler
 // drivers. In order to allow a message to be sent back to the master
@@ -81,7 +110,8 @@ public:
                    const FrameworkID& _frameworkId,
                    const FrameworkInfo& _framework,
                    pthread_mutex_t* _mutex,
-                   pthread_cond_t* _cond)
+                   pthread_cond_t* _cond,
+                   bool async)
     : driver(_driver),
       scheduler(_scheduler),
       frameworkId(_frameworkId),
@@ -91,7 +121,11 @@ public:
       master(UPID()),
       failover(!(_frameworkId == "")),
       connected(false),
-      aborted(false)
+      aborted(false),
+      registrationBackoff(REGISTRATION_RETRY_INTERVAL_SECONDS,
+                          REGISTRATION_RETRY_INTERVAL_MAX_SECONDS),
+      callbacks(async ? new CallbackProcess() : NULL),
+      delivering(false)
   {
     install<NewMasterDetectedMessage>(
         &SchedulerProcess::newMasterDetected,
@@ -111,7 +145,8 @@ public:
     install<ResourceOffersMessage>(
         &SchedulerProcess::resourceOffers,
         &ResourceOffersMessage::offers,
-        &ResourceOffersMessage::pids);
+        &ResourceOffersMessage::pids,
+        &ResourceOffersMessage::slaves);
 
     install<RescindResourceOfferMessage>(
         &SchedulerProcess::rescindOffer,
@@ -122,10 +157,19 @@ public:
         &StatusUpdateMessage::update,
         &StatusUpdateMessage::pid);
 
+    install<StatusUpdatesMessage>(&SchedulerProcess::statusUpdates);
+
     install<LostSlaveMessage>(
         &SchedulerProcess::lostSlave,
         &LostSlaveMessage::slave_id);
 
+    install<ExecutorMemoryPressureMessage>(
+        &SchedulerProcess::executorMemoryPressure,
+        &ExecutorMemoryPressureMessage::slave_id,
+        &ExecutorMemoryPressureMessage::executor_id,
+        &ExecutorMemoryPressureMessage::mem,
+        &ExecutorMemoryPressureMessage::limit);
+
     install<ExecutorToFrameworkMessage>(
         &SchedulerProcess::frameworkMessage,
         &ExecutorToFrameworkMessage::slave_id,
@@ -133,15 +177,53 @@ public:
         &ExecutorToFrameworkMessage::executor_id,
         &ExecutorToFrameworkMessage::data);
 
+    install<ExecutorChannelMessage>(
+        &SchedulerProcess::executorChannel,
+        &ExecutorChannelMessage::slave_id,
+        &ExecutorChannelMessage::executor_id);
+
     install<FrameworkErrorMessage>(
         &SchedulerProcess::error,
         &FrameworkErrorMessage::code,
         &FrameworkErrorMessage::message);
+
+    route("trace", &tracer::serve);
   }
 
-  virtual ~SchedulerProcess() {}
+  virtual ~SchedulerProcess()
+  {
+    if (callbacks != NULL) {
+      wait(callbacks);
+      delete callbacks;
+    }
+  }
 
 protected:
+  virtual void initialize()
+  {
+    if (callbacks != NULL) {
+      spawn(callbacks);
+    }
+  }
+
+  virtual void finalize()
+  {
+    if (callbacks != NULL) {
+      terminate(callbacks);
+    }
+  }
+
+  // Invokes a scheduler callback, right away or (if callbacks are
+  // asynchronous) after the callbacks queued before it.
+  void invoke(const std::tr1::function<void(void)>& callback)
+  {
+    if (callbacks != NULL) {
+      dispatch(callbacks, &CallbackProcess::invoke, callback);
+    } else {
+      callback();
+    }
+  }
+
   void newMasterDetected(const UPID& pid)
   {
     VLOG(1) << "New master at " << pid;
@@ -150,7 +232,18 @@ protected:
     link(master);
 
     connected = false;
-    doReliableRegistration();
+    registrationBackoff.reset();
+
+    if (frameworkId == "" || failover) {
+      doReliableRegistration();
+    } else {
+      // Every framework that was registered with the old master
+      // detects the new master at about the same time, so wait a
+      // random amount of time before re-registering in order to
+      // spread them out.
+      delay(registrationBackoff.jitter(REGISTRATION_RETRY_INTERVAL_SECONDS),
+            self(), &SchedulerProcess::doReliableRegistration);
+    }
   }
 
   void noMasterDetected()
@@ -177,7 +270,8 @@ protected:
     connected = true;
     failover = false;
 
-    scheduler->registered(driver, frameworkId);
+    invoke(std::tr1::bind(&Scheduler::registered,
+                          scheduler, driver, frameworkId));
   }
 
   void reregistered(const FrameworkID& frameworkId)
@@ -209,11 +303,13 @@ protected:
       send(master, message);
     }
 
-    delay(1.0, self(), &SchedulerProcess::doReliableRegistration);
+    delay(registrationBackoff.next(),
+          self(), &SchedulerProcess::doReliableRegistration);
   }
 
-  void resourceOffers(const vector<Offer>& offers,
-                      const vector<string>& pids)
+  void resourceOffers(const vector<Offer>& _offers,
+                      const vector<string>& pids,
+                      const vector<OfferSlave>& slaves)
   {
     if (aborted) {
       VLOG(1) << "Ignoring resource offers message because "
@@ -221,24 +317,70 @@ protected:
       return;
     }
 
-    VLOG(1) << "Received " << offers.size() << " offers";
+    VLOG(1) << "Received " << _offers.size() << " offers";
 
-    CHECK(offers.size() == pids.size());
+    vector<Offer> offers = _offers;
 
-    // Save the pid associated with each slave (one per offer) so
-    // later we can send framework messages directly.
-    for (int i = 0; i < offers.size(); i++) {
-      UPID pid(pids[i]);
-      // Check if parse failed (e.g., due to DNS).
-      if (pid != UPID()) {
-        VLOG(2) << "Saving PID '" << pids[i] << "'";
-        savedOffers[offers[i].id()][offers[i].slave_id()] = pid;
-      } else {
-        VLOG(2) << "Failed to parse PID '" << pids[i] << "'";
+    const double now = Clock::now();
+    foreach (const Offer& offer, offers) {
+      offered[offer.id()] = now;
+    }
+
+    if (slaves.empty()) {
+      // Sent by an older master, with a pid for each offer.
+      CHECK(offers.size() == pids.size());
+
+      for (int i = 0; i < offers.size(); i++) {
+        Option<UPID> pid = parse(pids[i]);
+        if (pid.isSome()) {
+          savedOffers[offers[i].id()][offers[i].slave_id()] = pid.get();
+        }
+      }
+    } else {
+      hashmap<SlaveID, const OfferSlave*> infos;
+      foreach (const OfferSlave& slave, slaves) {
+        infos[slave.slave_id()] = &slave;
+      }
+
+      // Fill in the hostname and attributes of each offer's slave and
+      // save the slave's pid so later we can send framework messages
+      // directly.
+      foreach (Offer& offer, offers) {
+        CHECK(infos.contains(offer.slave_id()));
+        const OfferSlave* slave = infos[offer.slave_id()];
+
+        offer.set_hostname(slave->hostname());
+        offer.mutable_attributes()->MergeFrom(slave->attributes());
+
+        Option<UPID> pid = parse(slave->pid());
+        if (pid.isSome()) {
+          savedOffers[offer.id()][offer.slave_id()] = pid.get();
+        }
       }
     }
 
-    scheduler->resourceOffers(driver, offers);
+    invoke(std::tr1::bind(&Scheduler::resourceOffers,
+                          scheduler, driver, offers));
+  }
+
+  // Returns the parsed pid (none if parsing failed, e.g., due to
+  // DNS), parsing each pid just once since the same slaves keep
+  // sending offers (failures get retried with the next offer).
+  Option<UPID> parse(const string& pid)
+  {
+    if (parsedPids.contains(pid)) {
+      return parsedPids[pid];
+    }
+
+    UPID parsed(pid);
+    if (parsed == UPID()) {
+      VLOG(2) << "Failed to parse PID '" << pid << "'";
+      return Option<UPID>::none();
+    }
+
+    VLOG(2) << "Saving PID '" << pid << "'";
+    parsedPids[pid] = parsed;
+    return parsed;
   }
 
   void rescindOffer(const OfferID& offerId)
@@ -252,8 +394,10 @@ protected:
     VLOG(1) << "Rescinded offer " << offerId;
 
     savedOffers.erase(offerId);
+    offered.erase(offerId);
 
-    scheduler->offerRescinded(driver, offerId);
+    invoke(std::tr1::bind(&Scheduler::offerRescinded,
+                          scheduler, driver, offerId));
   }
 
   void statusUpdate(const StatusUpdate& update, const UPID& pid)
@@ -270,8 +414,16 @@ protected:
             << " of framework " << update.framework_id()
             << " is now in state " << status.state();
 
+    tracer::record("scheduler", update);
+
     CHECK(frameworkId == update.framework_id());
 
+    if (callbacks != NULL) {
+      queued.push_back(make_pair(update, pid));
+      deliver();
+      return;
+    }
+
     // TODO(benh): Note that this maybe a duplicate status update!
     // Once we get support to try and have a more consistent view
     // of what's running in the cluster, we'll just let this one
@@ -283,21 +435,168 @@ protected:
 
     scheduler->statusUpdate(driver, status);
 
+    acknowledgeUpdate(update, pid);
+  }
+
+  // Hands status updates that were batched up into one message to the
+  // scheduler with a single callback.
+  void statusUpdates(const StatusUpdatesMessage& message)
+  {
+    if (aborted) {
+      VLOG(1) << "Ignoring task status updates message because "
+              << "the driver is aborted!";
+      return;
+    }
+
+    VLOG(1) << "Received " << message.updates_size() << " status updates";
+
+    foreach (const StatusUpdate& update, message.updates()) {
+      tracer::record("scheduler", update);
+    }
+
+    if (callbacks != NULL) {
+      foreach (const StatusUpdate& update, message.updates()) {
+        CHECK(frameworkId == update.framework_id());
+        queued.push_back(make_pair(update, UPID(message.pid())));
+      }
+      deliver();
+      return;
+    }
+
+    vector<TaskStatus> statuses;
+    statuses.reserve(message.updates_size());
+
+    foreach (const StatusUpdate& update, message.updates()) {
+      CHECK(frameworkId == update.framework_id());
+      statuses.push_back(update.status());
+    }
+
+    scheduler->statusUpdates(driver, statuses);
+
+    foreach (const StatusUpdate& update, message.updates()) {
+      acknowledgeUpdate(update, message.pid());
+    }
+  }
+
+  // Hands all of the queued status updates to the scheduler with a
+  // single (asynchronous) callback, unless the scheduler is still
+  // handling the previous ones, in which case the updates keep
+  // getting coalesced until it's done.
+  void deliver()
+  {
+    if (delivering || queued.empty()) {
+      return;
+    }
+
+    delivering = true;
+
+    invoke(std::tr1::bind(&SchedulerProcess::statusUpdatesCallback,
+                          self(), scheduler, driver, queued));
+
+    queued.clear();
+  }
+
+  // Invoked by the callback process, since the updates can only be
+  // acknowledged once the scheduler has handled them.
+  static void statusUpdatesCallback(
+      const PID<SchedulerProcess>& process,
+      Scheduler* scheduler,
+      SchedulerDriver* driver,
+      const vector<pair<StatusUpdate, UPID> >& updates)
+  {
+    vector<TaskStatus> statuses;
+    statuses.reserve(updates.size());
+
+    typedef pair<StatusUpdate, UPID> Update;
+    foreach (const Update& update, updates) {
+      statuses.push_back(update.first.status());
+    }
+
+    scheduler->statusUpdates(driver, statuses);
+
+    dispatch(process, &SchedulerProcess::delivered, updates);
+  }
+
+  void delivered(const vector<pair<StatusUpdate, UPID> >& updates)
+  {
+    typedef pair<StatusUpdate, UPID> Update;
+    foreach (const Update& update, updates) {
+      acknowledgeUpdate(update.first, update.second);
+    }
+
+    delivering = false;
+
+    if (!aborted) {
+      deliver();
+    }
+  }
+
+  void acknowledgeUpdate(const StatusUpdate& update, const UPID& pid)
+  {
+    const TaskStatus& status = update.status();
+
     // Send a status update acknowledgement ONLY if not aborted!
     if (!aborted && pid) {
       // Acknowledge the message (we do this last, after we invoked
       // the scheduler, if we did at all, in case it causes a crash,
       // since this way the message might get resent/routed after the
       // scheduler comes back online).
-      StatusUpdateAcknowledgementMessage message;
-      message.mutable_framework_id()->MergeFrom(frameworkId);
-      message.mutable_slave_id()->MergeFrom(update.slave_id());
-      message.mutable_task_id()->MergeFrom(status.task_id());
-      message.set_uuid(update.uuid());
-      send(pid, message);
+      if (update.has_sequence()) {
+        // Acknowledge the update along with any other updates from
+        // the slave that are already waiting to be handled by us
+        // (the acknowledgement gets dispatched behind them).
+        if (acknowledgements.empty()) {
+          dispatch(self(), &SchedulerProcess::acknowledge);
+        }
+
+        Acknowledgements& pending = acknowledgements[update.slave_id()];
+        pending.pid = pid;
+        pending.sequences.push_back(update.sequence());
+      } else {
+        StatusUpdateAcknowledgementMessage message;
+        message.mutable_framework_id()->MergeFrom(frameworkId);
+        message.mutable_slave_id()->MergeFrom(update.slave_id());
+        message.mutable_task_id()->MergeFrom(status.task_id());
+        message.set_uuid(update.uuid());
+        send(pid, message);
+      }
     }
   }
 
+  // Sends one message per slave acknowledging the status updates
+  // queued up by statusUpdate, with consecutive sequence numbers
+  // coalesced into ranges.
+  void acknowledge()
+  {
+    if (!aborted) {
+      foreachpair (const SlaveID& slaveId,
+                   Acknowledgements& pending,
+                   acknowledgements) {
+        std::sort(pending.sequences.begin(), pending.sequences.end());
+
+        StatusUpdateAcknowledgementsMessage message;
+        message.mutable_framework_id()->MergeFrom(frameworkId);
+        message.mutable_slave_id()->MergeFrom(slaveId);
+
+        Value::Ranges* ranges = message.mutable_sequences();
+        foreach (uint64_t sequence, pending.sequences) {
+          int size = ranges->range_size();
+          if (size > 0 && ranges->range(size - 1).end() + 1 >= sequence) {
+            ranges->mutable_range(size - 1)->set_end(sequence);
+          } else {
+            Value::Range* range = ranges->add_range();
+            range->set_begin(sequence);
+            range->set_end(sequence);
+          }
+        }
+
+        send(pending.pid, message);
+      }
+    }
+
+    acknowledgements.clear();
+  }
+
   void lostSlave(const SlaveID& slaveId)
   {
     if (aborted) {
@@ -308,8 +607,10 @@ protected:
     VLOG(1) << "Lost slave " << slaveId;
 
     savedSlavePids.erase(slaveId);
+    savedExecutorPids.erase(slaveId);
 
-    scheduler->slaveLost(driver, slaveId);
+    invoke(std::tr1::bind(&Scheduler::slaveLost,
+                          scheduler, driver, slaveId));
   }
 
   void frameworkMessage(const SlaveID& slaveId,
@@ -324,7 +625,60 @@ protected:
 
     VLOG(1) << "Received framework message";
 
-    scheduler->frameworkMessage(driver, slaveId, executorId, data);
+    invoke(std::tr1::bind(&Scheduler::frameworkMessage,
+                          scheduler, driver, slaveId, executorId, data));
+  }
+
+  void executorMemoryPressure(const SlaveID& slaveId,
+                              const ExecutorID& executorId,
+                              double mem,
+                              double limit)
+  {
+    if (aborted) {
+      VLOG(1) << "Ignoring memory pressure message because "
+              << "the driver is aborted!";
+      return;
+    }
+
+    VLOG(1) << "Executor '" << executorId << "' on slave " << slaveId
+            << " is using " << mem << " MB of its " << limit << " MB";
+
+    invoke(std::tr1::bind(&Scheduler::executorMemoryPressure,
+                          scheduler, driver, slaveId, executorId,
+                          mem, limit));
+  }
+
+  void executorChannel(const SlaveID& slaveId, const ExecutorID& executorId)
+  {
+    if (aborted) {
+      VLOG(1) << "Ignoring executor channel message because "
+              << "the driver is aborted!";
+      return;
+    }
+
+    VLOG(1) << "Executor '" << executorId << "' on slave " << slaveId
+            << " at " << from << " takes framework messages directly";
+
+    savedExecutorPids[slaveId][executorId] = from;
+    link(from);
+  }
+
+  virtual void exited(const UPID& pid)
+  {
+    // Send framework messages for executors we can no longer talk to
+    // directly through their slaves again.
+    foreachkey (const SlaveID& slaveId, savedExecutorPids) {
+      foreachpair (const ExecutorID& executorId,
+                   const UPID& executor,
+                   savedExecutorPids[slaveId]) {
+        if (executor == pid) {
+          VLOG(1) << "Lost the connection to executor '" << executorId
+                  << "' at " << pid;
+          savedExecutorPids[slaveId].erase(executorId);
+          return;
+        }
+      }
+    }
   }
 
   void error(int32_t code, const string& message)
@@ -338,7 +692,8 @@ protected:
 
     driver->abort();
 
-    scheduler->error(driver, code, message);
+    invoke(std::tr1::bind(&Scheduler::error,
+                          scheduler, driver, code, message));
   }
 
   void stop(bool failover)
@@ -449,25 +804,92 @@ protected:
     message.mutable_filters()->MergeFrom(filters);
 
     foreach (const TaskDescription& task, tasks) {
-      // Keep only the slave PIDs where we run tasks so we can send
-      // framework messages directly.
-      if (savedOffers.count(offerId) > 0) {
-        if (savedOffers[offerId].count(task.slave_id()) > 0) {
-          savedSlavePids[task.slave_id()] =
-            savedOffers[offerId][task.slave_id()];
-        } else {
-          VLOG(1) << "Attempting to launch a task with the wrong slave id";
-        }
-      } else {
-        VLOG(1) << "Attempting to launch a task with an unknown offer";
+      trace(offerId, message.add_tasks(), task);
+    }
+
+    saveSlavePids(offerId, tasks);
+
+    send(master, message);
+  }
+
+  void launchTasksBatch(
+      const vector<pair<OfferID, vector<TaskDescription> > >& launches,
+      const Filters& filters)
+  {
+    if (!connected) {
+      // Lose the tasks just like launchTasks does.
+      typedef pair<OfferID, vector<TaskDescription> > Launch;
+      foreach (const Launch& launch, launches) {
+        launchTasks(launch.first, launch.second, filters);
+      }
+      return;
+    }
+
+    LaunchTasksBatchMessage message;
+    message.mutable_framework_id()->MergeFrom(frameworkId);
+    message.mutable_filters()->MergeFrom(filters);
+
+    typedef pair<OfferID, vector<TaskDescription> > Launch;
+    foreach (const Launch& launch, launches) {
+      LaunchTasksBatchMessage::Launch* batched = message.add_launches();
+      batched->mutable_offer_id()->MergeFrom(launch.first);
+      foreach (const TaskDescription& task, launch.second) {
+        trace(launch.first, batched->add_tasks(), task);
       }
 
+      saveSlavePids(launch.first, launch.second);
+    }
+
+    send(master, message);
+  }
+
+  void declineOffers(const vector<OfferID>& offerIds, const Filters& filters)
+  {
+    if (!connected) {
+      VLOG(1) << "Ignoring decline offers message as master is disconnected";
+      return;
+    }
+
+    DeclineOffersMessage message;
+    message.mutable_framework_id()->MergeFrom(frameworkId);
+    message.mutable_filters()->MergeFrom(filters);
+
+    foreach (const OfferID& offerId, offerIds) {
+      message.add_offer_ids()->MergeFrom(offerId);
+      savedOffers.erase(offerId);
+      offered.erase(offerId);
+    }
+
+    send(master, message);
+  }
+
+  void queueTasks(const vector<TaskDescription>& tasks)
+  {
+    if (!connected) {
+      VLOG(1) << "Ignoring queue tasks message as master is disconnected";
+      return;
+    }
+
+    QueueTasksMessage message;
+    message.mutable_framework_id()->MergeFrom(frameworkId);
+    foreach (const TaskDescription& task, tasks) {
       message.add_tasks()->MergeFrom(task);
     }
+    send(master, message);
+  }
 
-    // Remove the offer since we saved all the PIDs we might use.
-    savedOffers.erase(offerId);
+  void reconcileTasks(const vector<TaskID>& taskIds)
+  {
+    if (!connected) {
+      VLOG(1) << "Ignoring reconcile tasks message as master is disconnected";
+      return;
+    }
 
+    ReconcileTasksMessage message;
+    message.mutable_framework_id()->MergeFrom(frameworkId);
+    foreach (const TaskID& taskId, taskIds) {
+      message.add_task_ids()->MergeFrom(taskId);
+    }
     send(master, message);
   }
 
@@ -501,7 +923,15 @@ protected:
     // just wait for them to recollect as new offers come in and get
     // accepted.
 
-    if (savedSlavePids.count(slaveId) > 0) {
+    if (savedExecutorPids.count(slaveId) > 0 &&
+        savedExecutorPids[slaveId].count(executorId) > 0) {
+      FrameworkToExecutorMessage message;
+      message.mutable_slave_id()->MergeFrom(slaveId);
+      message.mutable_framework_id()->MergeFrom(frameworkId);
+      message.mutable_executor_id()->MergeFrom(executorId);
+      message.set_data(data);
+      send(savedExecutorPids[slaveId][executorId], message);
+    } else if (savedSlavePids.count(slaveId) > 0) {
       UPID slave = savedSlavePids[slaveId];
       CHECK(slave != UPID());
 
@@ -527,6 +957,46 @@ protected:
 private:
   friend class mesos::MesosSchedulerDriver;
 
+  // Keeps only the PIDs of the slaves where tasks get launched with
+  // an offer, so that framework messages can be sent directly, and
+  // forgets the offer.
+  void saveSlavePids(const OfferID& offerId,
+                     const vector<TaskDescription>& tasks)
+  {
+    foreach (const TaskDescription& task, tasks) {
+      if (savedOffers.count(offerId) > 0) {
+        if (savedOffers[offerId].count(task.slave_id()) > 0) {
+          savedSlavePids[task.slave_id()] =
+            savedOffers[offerId][task.slave_id()];
+        } else {
+          VLOG(1) << "Attempting to launch a task with the wrong slave id";
+        }
+      } else {
+        VLOG(1) << "Attempting to launch a task with an unknown offer";
+      }
+    }
+
+    // Remove the offer since we saved all the PIDs we might use.
+    savedOffers.erase(offerId);
+    offered.erase(offerId);
+  }
+
+  // Copies the task into 'traced', giving it a trace id, and records
+  // the time from the offer arriving until the task got launched
+  // (i.e., the scheduler's callback, see tracer.hpp).
+  void trace(const OfferID& offerId,
+             TaskDescription* traced,
+             const TaskDescription& task)
+  {
+    traced->MergeFrom(task);
+    traced->set_trace_id(tracer::id());
+
+    if (offered.contains(offerId)) {
+      tracer::record(traced->trace_id(), task.task_id(), "scheduler/offer",
+                     offered[offerId], Clock::now());
+    }
+  }
+
   MesosSchedulerDriver* driver;
   Scheduler* scheduler;
   FrameworkID frameworkId;
@@ -539,8 +1009,38 @@ private:
   volatile bool connected; // Flag to indicate if framework is registered.
   volatile bool aborted; // Flag to indicate if the driver is aborted.
 
+  // Intervals between (re-)registration attempts.
+  Backoff registrationBackoff;
+
   hashmap<OfferID, hashmap<SlaveID, UPID> > savedOffers;
   hashmap<SlaveID, UPID> savedSlavePids;
+
+  // When each (outstanding) offer arrived, for tracing.
+  hashmap<OfferID, double> offered;
+
+  // Slave pids parsed so far (see SchedulerProcess::parse).
+  hashmap<string, UPID> parsedPids;
+
+  // PIDs of the executors that take framework messages directly.
+  hashmap<SlaveID, hashmap<ExecutorID, UPID> > savedExecutorPids;
+
+  // Status updates (i.e., their sequence numbers) waiting to be
+  // acknowledged, by slave.
+  struct Acknowledgements
+  {
+    UPID pid;
+    vector<uint64_t> sequences;
+  };
+
+  hashmap<SlaveID, Acknowledgements> acknowledgements;
+
+  // Set if the scheduler's callbacks get invoked asynchronously.
+  CallbackProcess* callbacks;
+
+  // Status updates waiting for the scheduler to handle the previous
+  // ones (when callbacks are asynchronous), and whether it is.
+  vector<pair<StatusUpdate, UPID> > queued;
+  bool delivering;
 };
 
 } // namespace internal {
@@ -728,12 +1228,33 @@ Status MesosSchedulerDriver::start()
   framework.set_name(frameworkName);
   framework.mutable_executor()->MergeFrom(executorInfo);
 
+  // The allocation group and weight of the framework can be set like
+  // any other option (e.g., via MESOS_FRAMEWORK_GROUP).
+  if (conf->contains("framework_group")) {
+    framework.set_group(conf->get<string>("framework_group", ""));
+  }
+
+  if (conf->contains("framework_weight")) {
+    framework.set_weight(conf->get<double>("framework_weight", 1.0));
+  }
+
+  if (conf->contains("framework_sticky")) {
+    framework.set_sticky(conf->get<bool>("framework_sticky", false));
+  }
+
+  if (conf->contains("framework_revocable")) {
+    framework.set_revocable(conf->get<bool>("framework_revocable", false));
+  }
+
   CHECK(process == NULL);
 
   // TODO(benh): Consider using a libprocess Latch rather than a
   // pthread mutex and condition variable for signaling.
+  // Scheduler callbacks can be invoked on a process of their own, so
+  // that a slow scheduler doesn't hold up the driver.
   process = new SchedulerProcess(this, scheduler, frameworkId,
-                                 framework, &mutex, &cond);
+                                 framework, &mutex, &cond,
+                                 conf->get<bool>("async_callbacks", false));
 
   UPID pid = spawn(process);
 
@@ -889,6 +1410,81 @@ Status MesosSchedulerDriver::launchTasks(const OfferID& offerId,
 }
 
 
+Status MesosSchedulerDriver::launchTasks(
+    const vector<pair<OfferID, vector<TaskDescription> > >& launches,
+    const Filters& filters)
+{
+  Lock lock(&mutex);
+
+  if (state == ABORTED) {
+    return DRIVER_ABORTED;
+  } else if (state != RUNNING) {
+    return DRIVER_NOT_RUNNING;
+  }
+
+  CHECK(process != NULL);
+
+  dispatch(process, &SchedulerProcess::launchTasksBatch, launches, filters);
+
+  return OK;
+}
+
+
+Status MesosSchedulerDriver::declineOffers(const vector<OfferID>& offerIds,
+                                           const Filters& filters)
+{
+  Lock lock(&mutex);
+
+  if (state == ABORTED) {
+    return DRIVER_ABORTED;
+  } else if (state != RUNNING) {
+    return DRIVER_NOT_RUNNING;
+  }
+
+  CHECK(process != NULL);
+
+  dispatch(process, &SchedulerProcess::declineOffers, offerIds, filters);
+
+  return OK;
+}
+
+
+Status MesosSchedulerDriver::queueTasks(const vector<TaskDescription>& tasks)
+{
+  Lock lock(&mutex);
+
+  if (state == ABORTED) {
+    return DRIVER_ABORTED;
+  } else if (state != RUNNING) {
+    return DRIVER_NOT_RUNNING;
+  }
+
+  CHECK(process != NULL);
+
+  dispatch(process, &SchedulerProcess::queueTasks, tasks);
+
+  return OK;
+}
+
+
+Status MesosSchedulerDriver::reconcileTasks(const vector<TaskID>& taskIds)
+{
+  Lock lock(&mutex);
+
+  if (state == ABORTED) {
+    return DRIVER_ABORTED;
+  } else if (state != RUNNING) {
+    return DRIVER_NOT_RUNNING;
+  }
+
+  CHECK(process != NULL);
+
+  dispatch(process, &SchedulerProcess::reconcileTasks, taskIds);
+
+  return OK;
+}
+
+
 Status MesosSchedulerDriver::reviveOffers()
 {
   Lock lock(&mutex);
@@ -0,0 +1,264 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/eventfd.h>
+
+#include <fstream>
+#include <sstream>
+
+#include "common/foreach.hpp"
+#include "common/strings.hpp"
+
+#include "slave/cgroups.hpp"
+
+using std::set;
+using std::string;
+
+
+namespace mesos {
+namespace internal {
+namespace slave {
+namespace cgroups {
+
+// Attempts at freezing (and then killing the processes in) a cgroup.
+static const int KILL_ATTEMPTS = 100;
+
+
+Try<string> hierarchy(const string& subsystem)
+{
+  std::ifstream mounts("/proc/mounts");
+  if (!mounts.is_open()) {
+    return Try<string>::error("Failed to open /proc/mounts");
+  }
+
+  // Each line is: <device> <mount point> <type> <options> ...
+  string line;
+  while (std::getline(mounts, line)) {
+    std::istringstream in(line);
+    string device, directory, type, options;
+    in >> device >> directory >> type >> options;
+
+    if (type != "cgroup") {
+      continue;
+    }
+
+    foreach (const string& option, strings::split(options, ",")) {
+      if (option == subsystem) {
+        return directory;
+      }
+    }
+  }
+
+  return Try<string>::error("No cgroup hierarchy with the " + subsystem +
+                            " subsystem is mounted");
+}
+
+
+// Returns the path of a control of a cgroup, using the hierarchy of
+// the subsystem the control belongs to.
+static Try<string> path(const string& cgroup, const string& control)
+{
+  Try<string> directory = hierarchy(control.substr(0, control.find('.')));
+  if (directory.isError()) {
+    return directory;
+  }
+
+  return directory.get() + "/" + cgroup + "/" + control;
+}
+
+
+Try<string> read(const string& cgroup, const string& control)
+{
+  Try<string> file = path(cgroup, control);
+  if (file.isError()) {
+    return file;
+  }
+
+  std::ifstream in(file.get().c_str());
+  if (!in.is_open()) {
+    return Try<string>::error("Failed to open " + file.get());
+  }
+
+  std::ostringstream out;
+  out << in.rdbuf();
+  return out.str();
+}
+
+
+Try<bool> write(const string& cgroup,
+                const string& control,
+                const string& value)
+{
+  Try<string> file = path(cgroup, control);
+  if (file.isError()) {
+    return Try<bool>::error(file.error());
+  }
+
+  // The kernel validates the value when it gets written, i.e., when
+  // the stream gets flushed.
+  std::ofstream out(file.get().c_str());
+  out << value;
+  out.close();
+
+  if (out.fail()) {
+    return Try<bool>::error("Failed to write " + value + " to " + file.get());
+  }
+
+  return true;
+}
+
+
+Try<set<pid_t> > tasks(const string& subsystem, const string& cgroup)
+{
+  // The 'tasks' file isn't prefixed by the subsystem name.
+  Try<string> directory = hierarchy(subsystem);
+  if (directory.isError()) {
+    return Try<set<pid_t> >::error(directory.error());
+  }
+
+  const string& file = directory.get() + "/" + cgroup + "/tasks";
+  std::ifstream in(file.c_str());
+  if (!in.is_open()) {
+    return Try<set<pid_t> >::error("Failed to open " + file);
+  }
+
+  set<pid_t> pids;
+  pid_t pid;
+  while (in >> pid) {
+    pids.insert(pid);
+  }
+
+  return pids;
+}
+
+
+Try<int> listen(const string& cgroup,
+               const string& control,
+               const string& arguments)
+{
+  // The event_control file isn't prefixed by the subsystem name.
+  Try<string> directory = hierarchy(control.substr(0, control.find('.')));
+  if (directory.isError()) {
+    return Try<int>::error(directory.error());
+  }
+
+  const string& file = directory.get() + "/" + cgroup + "/" + control;
+
+  int efd = eventfd(0, EFD_CLOEXEC);
+  if (efd < 0) {
+    return Try<int>::error(string("Failed to create an eventfd: ") +
+                           strerror(errno));
+  }
+
+  int cfd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+  if (cfd < 0) {
+    close(efd);
+    return Try<int>::error("Failed to open " + file);
+  }
+
+  std::ostringstream registration;
+  registration << efd << " " << cfd;
+  if (arguments != "") {
+    registration << " " << arguments;
+  }
+
+  const string& events =
+    directory.get() + "/" + cgroup + "/cgroup.event_control";
+
+  std::ofstream out(events.c_str());
+  out << registration.str();
+  out.close();
+
+  // The registration holds on to the control's file, so ours can go.
+  close(cfd);
+
+  if (out.fail()) {
+    close(efd);
+    return Try<int>::error("Failed to register for events of " + file);
+  }
+
+  return efd;
+}
+
+
+Try<bool> kill(const string& cgroup)
+{
+  // Freeze the cgroup (if we can) so that no new processes get forked.
+  bool freezer = hierarchy("freezer").isSome();
+
+  if (freezer) {
+    Try<bool> frozen = write(cgroup, "freezer.state", "FROZEN");
+    if (frozen.isError()) {
+      return frozen;
+    }
+
+    // Freezing completes asynchronously.
+    for (int i = 0; i < KILL_ATTEMPTS; i++) {
+      Try<string> state = read(cgroup, "freezer.state");
+      if (state.isError()) {
+        return Try<bool>::error(state.error());
+      } else if (state.get().find("FROZEN") == 0) {
+        break;
+      }
+      usleep(1000);
+    }
+  }
+
+  const string& subsystem = freezer ? "freezer" : "cpu";
+
+  for (int i = 0; i < KILL_ATTEMPTS; i++) {
+    Try<set<pid_t> > pids = tasks(subsystem, cgroup);
+    if (pids.isError()) {
+      return Try<bool>::error(pids.error());
+    }
+
+    if (pids.get().empty()) {
+      return true;
+    }
+
+    foreach (pid_t pid, pids.get()) {
+      if (::kill(pid, SIGKILL) < 0 && errno != ESRCH) {
+        return Try<bool>::error(string("Failed to kill process: ") +
+                                strerror(errno));
+      }
+    }
+
+    // Frozen processes only die once they get thawed.
+    if (freezer) {
+      Try<bool> thawed = write(cgroup, "freezer.state", "THAWED");
+      if (thawed.isError()) {
+        return thawed;
+      }
+    }
+
+    usleep(1000);
+  }
+
+  return Try<bool>::error("Failed to kill all processes in " + cgroup);
+}
+
+} // namespace cgroups {
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
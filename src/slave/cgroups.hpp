@@ -0,0 +1,80 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CGROUPS_HPP__
+#define __CGROUPS_HPP__
+
+#include <sys/types.h>
+
+#include <set>
+#include <string>
+
+#include "common/try.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace slave {
+namespace cgroups {
+
+// Manipulates control groups through the cgroup file system (i.e.,
+// with plain file reads and writes rather than the lxc-* tools). A
+// cgroup is named by its path relative to the root of a hierarchy
+// (e.g., a container name); which hierarchy is used depends on the
+// subsystem a control belongs to (e.g., "memory" for
+// "memory.limit_in_bytes").
+
+// Returns the mount point of the hierarchy the subsystem (e.g.,
+// "cpu") is attached to.
+Try<std::string> hierarchy(const std::string& subsystem);
+
+
+// Reads/writes a control (e.g., "cpu.shares") of a cgroup.
+Try<std::string> read(const std::string& cgroup, const std::string& control);
+
+Try<bool> write(const std::string& cgroup,
+                const std::string& control,
+                const std::string& value);
+
+
+// Returns the processes in a cgroup (of the subsystem's hierarchy).
+Try<std::set<pid_t> > tasks(const std::string& subsystem,
+                            const std::string& cgroup);
+
+
+// Registers for notifications of events of a control of a cgroup
+// (e.g., "memory.oom_control", or "memory.usage_in_bytes" with a
+// threshold in bytes as the arguments) through cgroup.event_control.
+// Returns an eventfd that becomes readable with each event (and when
+// the cgroup gets removed); closing it unregisters.
+Try<int> listen(const std::string& cgroup,
+                const std::string& control,
+                const std::string& arguments = "");
+
+
+// Kills every process in a cgroup. If the freezer subsystem is
+// available the cgroup gets frozen first, so that none of the
+// processes can fork while they're being killed.
+Try<bool> kill(const std::string& cgroup);
+
+} // namespace cgroups {
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __CGROUPS_HPP__
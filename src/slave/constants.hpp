@@ -28,6 +28,61 @@ namespace slave {
 const double EXECUTOR_SHUTDOWN_TIMEOUT_SECONDS = 5.0;
 const double STATUS_UPDATE_RETRY_INTERVAL_SECONDS = 10.0;
 
+// How long a restarted slave waits for the executors that were
+// running before it restarted to re-register (they retry every
+// second, see exec.cpp) before considering them gone.
+const double EXECUTOR_REREGISTER_TIMEOUT_SECONDS = 15.0;
+
+// The most to wait for the reaper to reap an exited child.
+const double REAP_TIMEOUT_SECONDS = 1.0;
+
+// Bounds on the (randomized, exponentially increasing) interval
+// between attempts to (re-)register with the master.
+const double REGISTRATION_RETRY_INTERVAL_SECONDS = 1.0;
+const double REGISTRATION_RETRY_INTERVAL_MAX_SECONDS = 60.0;
+
+// The most often (in seconds) the isolation module gets told that an
+// executor's resources shrank (they get updated right away when they
+// grow), see Slave::resourcesChanged.
+const double RESOURCES_CHANGED_INTERVAL_SECONDS = 0.5;
+
+// Maximum number of status updates sent to the master in one message.
+const int STATUS_UPDATE_BATCH_SIZE = 100;
+
+// Seconds between samples of the resources executors use and the
+// number of (most recent) samples the usage is averaged over.
+const double USAGE_SAMPLE_INTERVAL_SECONDS = 1.0;
+const int USAGE_HISTORY_SAMPLES = 10;
+
+// Fraction of an executor's memory limit that it can use before the
+// slave gets told that it's under memory pressure (LXC isolation).
+const double MEMORY_PRESSURE_THRESHOLD = 0.9;
+
+// Number of worker threads the isolation modules fork and exec
+// executors on (i.e., the most launches that run at once).
+const int LAUNCH_WORKERS = 4;
+
+// Seconds between checks for how far along the launchers are (they
+// time each step themselves, so this only bounds how soon it's known).
+const double LAUNCH_PROGRESS_INTERVAL_SECONDS = 0.1;
+
+// Default capacity of the executor cache (when enabled).
+const int EXECUTOR_CACHE_SIZE_MEGABYTES = 10 * 1024;
+
+// Defaults for how old executor work directories get before they are
+// garbage collected (a week), how full the disk may get before they
+// are garbage collected sooner, and how many get deleted per second.
+// The collector checks for directories that are due every interval.
+const double GC_DELAY_SECONDS = 7 * 24 * 60 * 60;
+const double GC_DISK_WATERMARK = 0.9;
+const double GC_RATE = 10.0;
+const double GC_INTERVAL_SECONDS = 5.0;
+
+// Maximum number of messages per second logged by each of the log
+// statements about individual tasks and status updates (see
+// LOG_RATE_LIMITED).
+const int TASK_LOG_RATE = 100;
+
 } // namespace slave {
 } // namespace internal {
 } // namespace mesos {
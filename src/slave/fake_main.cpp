@@ -0,0 +1,156 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "common/foreach.hpp"
+#include "common/logging.hpp"
+#include "common/resources.hpp"
+#include "common/utils.hpp"
+
+#include "configurator/configurator.hpp"
+
+#include "detector/detector.hpp"
+
+#include "slave/fake_slave.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+using namespace mesos::internal::slave;
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+
+
+void usage(const char* programName, const Configurator& configurator)
+{
+  cerr << "Usage: " << programName
+       << " --master=URL [...]" << endl
+       << endl
+       << "Runs lots of fake slaves (which run no executors, see "
+       << "src/slave/fake_slave.hpp) in one process, to put a master "
+       << "under the load of a big cluster." << endl
+       << endl
+       << "URL may be one of:" << endl
+       << "  mesos://id@host:port" << endl
+       << "  zoo://host1:port1,host2:port2,..." << endl
+       << "  zoofile://file where file contains a host:port pair per line"
+       << endl
+       << "  log://host1:port1,host2:port2,... (the masters)" << endl
+       << endl
+       << "Supported options:" << endl
+       << configurator.getUsage();
+}
+
+
+int main(int argc, char** argv)
+{
+  GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+  Configurator configurator;
+  Logging::registerOptions(&configurator);
+  configurator.addOption<int>("port", 'p', "Port to listen on", 0);
+  configurator.addOption<string>("ip", "IP address to listen on");
+  configurator.addOption<string>("master", 'm', "Master URL");
+  configurator.addOption<int>("slaves", "Number of fake slaves", 100);
+  configurator.addOption<string>("resources", "Resources of each slave",
+                                 "cpus:8;mem:16384");
+  configurator.addOption<double>("task_duration", "Seconds each task runs "
+                                 "for", 0.0);
+
+  if (argc == 2 && string("--help") == argv[1]) {
+    usage(argv[0], configurator);
+    exit(1);
+  }
+
+  Configuration conf;
+  try {
+    conf = configurator.load(argc, argv, true);
+  } catch (ConfigurationException& e) {
+    cerr << "Configuration error: " << e.what() << endl;
+    exit(1);
+  }
+
+  Logging::init(argv[0], conf);
+
+  if (conf.contains("port")) {
+    setenv("LIBPROCESS_PORT", conf["port"].c_str(), 1);
+  }
+
+  if (conf.contains("ip")) {
+    setenv("LIBPROCESS_IP", conf["ip"].c_str(), 1);
+  }
+
+  process::initialize(false);
+
+  if (!conf.contains("master")) {
+    cerr << "Master URL argument (--master) required." << endl;
+    exit(1);
+  }
+
+  const string master = conf["master"];
+  const int slaves = conf.get<int>("slaves", 100);
+  const Resources resources =
+    Resources::parse(conf.get<string>("resources", "cpus:8;mem:16384"));
+  const double duration = conf.get<double>("task_duration", 0.0);
+
+  Result<string> hostname = utils::os::hostname();
+  if (!hostname.isSome()) {
+    cerr << "Failed to get hostname" << endl;
+    exit(1);
+  }
+
+  LOG(INFO) << "Starting " << slaves << " fake slaves";
+
+  vector<FakeSlave*> fakes;
+  vector<MasterDetector*> detectors;
+
+  // Each fake slave gets a hostname of its own, since the master (and
+  // its web UI) tell slaves apart by hostname.
+  for (int i = 0; i < slaves; i++) {
+    SlaveInfo info;
+    info.set_hostname("fake-" + hostname.get() + "-" + utils::stringify(i));
+    info.set_webui_hostname(hostname.get());
+    info.mutable_resources()->MergeFrom(resources);
+
+    FakeSlave* fake = new FakeSlave(info, duration);
+    process::spawn(fake);
+    fakes.push_back(fake);
+
+    detectors.push_back(MasterDetector::create(
+        master, fake->self(), false, Logging::isQuiet(conf)));
+  }
+
+  foreach (FakeSlave* fake, fakes) {
+    process::wait(fake);
+  }
+
+  foreach (MasterDetector* detector, detectors) {
+    MasterDetector::destroy(detector);
+  }
+
+  foreach (FakeSlave* fake, fakes) {
+    delete fake;
+  }
+
+  return 0;
+}
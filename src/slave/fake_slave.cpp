@@ -0,0 +1,255 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <glog/logging.h>
+
+#include <process/clock.hpp>
+#include <process/timer.hpp>
+
+#include "common/foreach.hpp"
+#include "common/uuid.hpp"
+
+#include "slave/fake_slave.hpp"
+
+using namespace process;
+
+using std::string;
+
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+FakeSlave::FakeSlave(const SlaveInfo& _info, double _duration)
+  : info(_info), duration(_duration), connected(false), sequence(0)
+{
+  install<NewMasterDetectedMessage>(
+      &FakeSlave::newMasterDetected,
+      &NewMasterDetectedMessage::pid);
+
+  install<NoMasterDetectedMessage>(
+      &FakeSlave::noMasterDetected);
+
+  install<SlaveRegisteredMessage>(
+      &FakeSlave::registered,
+      &SlaveRegisteredMessage::slave_id);
+
+  install<SlaveReregisteredMessage>(
+      &FakeSlave::reregistered,
+      &SlaveReregisteredMessage::slave_id);
+
+  install<RunTaskMessage>(
+      &FakeSlave::runTask);
+
+  install<RunTasksMessage>(
+      &FakeSlave::runTasks);
+
+  install<KillTaskMessage>(
+      &FakeSlave::killTask,
+      &KillTaskMessage::framework_id,
+      &KillTaskMessage::task_id);
+
+  install<ShutdownFrameworkMessage>(
+      &FakeSlave::shutdownFramework,
+      &ShutdownFrameworkMessage::framework_id);
+
+  install("PING", &FakeSlave::ping);
+}
+
+
+void FakeSlave::newMasterDetected(const string& pid)
+{
+  VLOG(1) << "Fake slave " << info.hostname() << " detected master " << pid;
+
+  master = pid;
+  connected = false;
+  doReliableRegistration();
+}
+
+
+void FakeSlave::noMasterDetected()
+{
+  connected = false;
+}
+
+
+void FakeSlave::doReliableRegistration()
+{
+  if (connected || !master) {
+    return;
+  }
+
+  if (id.value() == "") {
+    RegisterSlaveMessage message;
+    message.mutable_slave()->MergeFrom(info);
+    send(master, message);
+  } else {
+    // Tell the new master about the tasks that are still "running".
+    ReregisterSlaveMessage message;
+    message.mutable_slave_id()->MergeFrom(id);
+    message.mutable_slave()->MergeFrom(info);
+
+    foreachvalue (const Executors& infos, executors) {
+      foreachvalue (const ExecutorInfo& executor, infos) {
+        message.add_executor_infos()->MergeFrom(executor);
+      }
+    }
+
+    foreachvalue (const Tasks& running, tasks) {
+      foreachvalue (const Task& task, running) {
+        message.add_tasks()->MergeFrom(task);
+      }
+    }
+
+    send(master, message);
+  }
+
+  delay(1.0, self(), &FakeSlave::doReliableRegistration);
+}
+
+
+void FakeSlave::registered(const SlaveID& slaveId)
+{
+  id = slaveId;
+  connected = true;
+}
+
+
+void FakeSlave::reregistered(const SlaveID& slaveId)
+{
+  CHECK(id == slaveId);
+  connected = true;
+}
+
+
+void FakeSlave::runTask(const RunTaskMessage& message)
+{
+  launch(message.framework(), message.framework_id(), message.task());
+}
+
+
+void FakeSlave::runTasks(const RunTasksMessage& message)
+{
+  foreach (const TaskDescription& task, message.tasks()) {
+    launch(message.framework(), message.framework_id(), task);
+  }
+}
+
+
+void FakeSlave::launch(const FrameworkInfo& framework,
+                       const FrameworkID& frameworkId,
+                       const TaskDescription& description)
+{
+  const ExecutorInfo& executor = description.has_executor()
+    ? description.executor()
+    : framework.executor();
+
+  executors[frameworkId][executor.executor_id()] = executor;
+
+  Task task;
+  task.set_name(description.name());
+  task.mutable_task_id()->MergeFrom(description.task_id());
+  task.mutable_framework_id()->MergeFrom(frameworkId);
+  task.mutable_executor_id()->MergeFrom(executor.executor_id());
+  task.mutable_slave_id()->MergeFrom(id);
+  task.set_state(TASK_RUNNING);
+  task.mutable_resources()->MergeFrom(description.resources());
+
+  tasks[frameworkId][task.task_id()] = task;
+
+  update(frameworkId, task.task_id(), TASK_RUNNING);
+
+  if (duration > 0) {
+    delay(duration, self(), &FakeSlave::finish, frameworkId, task.task_id());
+  } else {
+    update(frameworkId, task.task_id(), TASK_FINISHED);
+  }
+}
+
+
+void FakeSlave::finish(const FrameworkID& frameworkId, const TaskID& taskId)
+{
+  if (tasks.contains(frameworkId) && tasks[frameworkId].contains(taskId)) {
+    update(frameworkId, taskId, TASK_FINISHED);
+  }
+}
+
+
+void FakeSlave::killTask(const FrameworkID& frameworkId, const TaskID& taskId)
+{
+  // Like the real slave, report unknown tasks as lost.
+  if (tasks.contains(frameworkId) && tasks[frameworkId].contains(taskId)) {
+    update(frameworkId, taskId, TASK_KILLED);
+  } else {
+    update(frameworkId, taskId, TASK_LOST);
+  }
+}
+
+
+void FakeSlave::shutdownFramework(const FrameworkID& frameworkId)
+{
+  // No updates, since the master already forgot about the framework.
+  tasks.erase(frameworkId);
+  executors.erase(frameworkId);
+}
+
+
+void FakeSlave::ping(const UPID& from, const string& body)
+{
+  send(from, "PONG");
+}
+
+
+void FakeSlave::update(const FrameworkID& frameworkId,
+                       const TaskID& taskId,
+                       TaskState state)
+{
+  ExecutorID executorId;
+  executorId.set_value("default");
+
+  if (tasks.contains(frameworkId) && tasks[frameworkId].contains(taskId)) {
+    executorId = tasks[frameworkId][taskId].executor_id();
+
+    if (state == TASK_RUNNING) {
+      tasks[frameworkId][taskId].set_state(state);
+    } else {
+      tasks[frameworkId].erase(taskId);
+      if (tasks[frameworkId].empty()) {
+        tasks.erase(frameworkId);
+        executors.erase(frameworkId);
+      }
+    }
+  }
+
+  StatusUpdateMessage message;
+  StatusUpdate* update = message.mutable_update();
+  update->mutable_framework_id()->MergeFrom(frameworkId);
+  update->mutable_executor_id()->MergeFrom(executorId);
+  update->mutable_slave_id()->MergeFrom(id);
+  update->mutable_status()->mutable_task_id()->MergeFrom(taskId);
+  update->mutable_status()->set_state(state);
+  update->set_timestamp(Clock::now());
+  update->set_uuid(UUID::random().toBytes());
+  update->set_sequence(sequence++);
+  message.set_pid(self());
+  send(master, message);
+}
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
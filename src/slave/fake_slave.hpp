@@ -0,0 +1,101 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FAKE_SLAVE_HPP__
+#define __FAKE_SLAVE_HPP__
+
+#include <string>
+
+#include <process/process.hpp>
+#include <process/protobuf.hpp>
+
+#include "common/hashmap.hpp"
+#include "common/type_utils.hpp"
+
+#include "messages/messages.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// A slave that speaks the slave protocol to the master but runs no
+// executors: each task it's asked to run is reported as running right
+// away and as finished 'duration' seconds later (unless it gets
+// killed first). Being just a libprocess process, lots of these can
+// share one OS process, e.g., to put a master under the load of
+// thousands of slaves (see mesos-fake-slaves).
+class FakeSlave : public ProtobufProcess<FakeSlave>
+{
+public:
+  FakeSlave(const SlaveInfo& info, double duration);
+
+  virtual ~FakeSlave() {}
+
+  void newMasterDetected(const std::string& pid);
+  void noMasterDetected();
+  void registered(const SlaveID& slaveId);
+  void reregistered(const SlaveID& slaveId);
+  void runTask(const RunTaskMessage& message);
+  void runTasks(const RunTasksMessage& message);
+  void killTask(const FrameworkID& frameworkId, const TaskID& taskId);
+  void shutdownFramework(const FrameworkID& frameworkId);
+  void ping(const process::UPID& from, const std::string& body);
+
+  // Reports a (running) task as finished, unless it's gone already.
+  void finish(const FrameworkID& frameworkId, const TaskID& taskId);
+
+protected:
+  // (Re-)registers with the master until it acknowledges.
+  void doReliableRegistration();
+
+private:
+  void launch(const FrameworkInfo& framework,
+              const FrameworkID& frameworkId,
+              const TaskDescription& task);
+
+  // Sends the master a status update for a task, forgetting the task
+  // if it's done. Updates never get resent (so acknowledgements get
+  // ignored).
+  void update(const FrameworkID& frameworkId,
+              const TaskID& taskId,
+              TaskState state);
+
+  const SlaveInfo info;
+  const double duration;
+
+  process::UPID master;
+  SlaveID id;
+  bool connected;
+
+  uint64_t sequence;
+
+  // Running tasks (and the executors they'd run on, which the master
+  // wants to hear about when the slave re-registers) by framework.
+  typedef hashmap<TaskID, Task> Tasks;
+  typedef hashmap<ExecutorID, ExecutorInfo> Executors;
+
+  hashmap<FrameworkID, Tasks> tasks;
+  hashmap<FrameworkID, Executors> executors;
+};
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __FAKE_SLAVE_HPP__
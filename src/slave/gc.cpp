@@ -0,0 +1,241 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <sys/resource.h>
+#include <sys/statvfs.h>
+#include <sys/types.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include <glog/logging.h>
+
+#include <tr1/functional>
+
+#include <process/dispatch.hpp>
+#include <process/future.hpp>
+#include <process/timer.hpp>
+
+#include "common/foreach.hpp"
+#include "common/thread.hpp"
+#include "common/utils.hpp"
+
+#include "messages/messages.hpp"
+
+#include "slave/constants.hpp"
+#include "slave/gc.hpp"
+
+using namespace process;
+
+using std::string;
+
+using std::tr1::shared_ptr;
+
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+GarbageCollector::GarbageCollector(const string& _directory,
+                                   double _age,
+                                   double _watermark,
+                                   double _rate)
+  : directory(_directory),
+    path(_directory + "/gc"),
+    age(_age),
+    watermark(_watermark),
+    rate(_rate)
+{
+  CHECK(rate > 0);
+}
+
+
+void GarbageCollector::initialize()
+{
+  // Recover the directories scheduled before the slave restarted.
+  if (utils::os::exists(path)) {
+    GarbageCollectorState state;
+    Result<bool> result = utils::protobuf::read(path, &state);
+    if (result.isError() || result.isNone() || !result.get()) {
+      LOG(ERROR) << "Failed to recover the directories scheduled for "
+                 << "garbage collection from " << path;
+    } else {
+      foreach (const GarbageCollectorState::Directory& directory,
+               state.directories()) {
+        if (utils::os::exists(directory.path())) {
+          scheduled.insert(make_pair(directory.time(), directory.path()));
+        }
+      }
+
+      LOG(INFO) << "Recovered " << scheduled.size()
+                << " directories scheduled for garbage collection";
+    }
+  }
+
+  deleter.reset(new Deleter());
+
+  if (!thread::start(std::tr1::bind(&GarbageCollector::remove,
+                                    self(), deleter, rate), true)) {
+    LOG(FATAL) << "Failed to start the thread deleting directories";
+  }
+}
+
+
+void GarbageCollector::finalize()
+{
+  deleter->stopped = true;
+}
+
+
+void GarbageCollector::schedule(const string& directory)
+{
+  VLOG(1) << "Scheduling " << directory << " for garbage collection";
+
+  scheduled.insert(make_pair(Clock::now(), directory));
+  checkpoint();
+}
+
+
+Option<string> GarbageCollector::next()
+{
+  if (scheduled.empty()) {
+    return Option<string>::none();
+  }
+
+  // Delete the oldest directory once it's old enough, or right away
+  // if the disk is filling up.
+  std::multimap<double, string>::iterator oldest = scheduled.begin();
+
+  if (oldest->first + age > Clock::now() && usage(directory) < watermark) {
+    return Option<string>::none();
+  }
+
+  const string result = oldest->second;
+  scheduled.erase(oldest);
+  deleting.insert(result);
+  return Option<string>::some(result);
+}
+
+
+void GarbageCollector::deleted(const string& directory)
+{
+  VLOG(1) << "Garbage collected " << directory;
+
+  deleting.erase(directory);
+  checkpoint();
+}
+
+
+double GarbageCollector::usage(const string& directory)
+{
+  struct statvfs buf;
+  if (statvfs(directory.c_str(), &buf) < 0 || buf.f_blocks == 0) {
+    PLOG(ERROR) << "Failed to get the disk usage of " << directory;
+    return 0.0;
+  }
+
+  return 1.0 - (double) buf.f_bavail / (double) buf.f_blocks;
+}
+
+
+void GarbageCollector::checkpoint()
+{
+  GarbageCollectorState state;
+
+  typedef std::pair<double, string> Scheduled;
+  foreach (const Scheduled& scheduled, this->scheduled) {
+    GarbageCollectorState::Directory* directory = state.add_directories();
+    directory->set_path(scheduled.second);
+    directory->set_time(scheduled.first);
+  }
+
+  // Directories being deleted are checkpointed as due right away, in
+  // case the slave restarts before they are gone.
+  foreach (const string& deleting, this->deleting) {
+    GarbageCollectorState::Directory* directory = state.add_directories();
+    directory->set_path(deleting);
+    directory->set_time(0);
+  }
+
+  // Write to a temporary file first so that the checkpoint never ends
+  // up half written.
+  const string temporary = path + ".tmp";
+
+  Result<bool> result = utils::protobuf::write(temporary, state);
+  if (result.isError() || result.isNone() || !result.get() ||
+      ::rename(temporary.c_str(), path.c_str()) != 0) {
+    LOG(ERROR) << "Failed to checkpoint the directories scheduled for "
+               << "garbage collection to " << path;
+  }
+}
+
+
+static int erase(const char* path, const struct stat* s, int type, FTW* ftw)
+{
+  return type == FTW_DP ? ::rmdir(path) : ::unlink(path);
+}
+
+
+void GarbageCollector::remove(const PID<GarbageCollector>& collector,
+                              const shared_ptr<Deleter>& deleter,
+                              double rate)
+{
+  // Get out of the way of everything else on the machine, both for
+  // the CPU and (where possible) for the disk.
+#ifdef __linux__
+  pid_t tid = syscall(SYS_gettid);
+  setpriority(PRIO_PROCESS, tid, 19);
+  // IOPRIO_WHO_PROCESS, IOPRIO_CLASS_IDLE.
+  syscall(SYS_ioprio_set, 1, tid, 3 << 13);
+#endif
+
+  while (!deleter->stopped) {
+    Future<Option<string> > next =
+      dispatch(collector, &GarbageCollector::next);
+
+    next.await(GC_INTERVAL_SECONDS);
+
+    if (!next.isReady() || next.get().isNone()) {
+      usleep((useconds_t) (GC_INTERVAL_SECONDS * 1000000));
+      continue;
+    }
+
+    const string directory = next.get().get();
+
+    // N.B. Unlike utils::os::rmdir this doesn't change the working
+    // directory (of the whole process!) while walking the tree.
+    if (nftw(directory.c_str(), erase, 16, FTW_DEPTH | FTW_PHYS) != 0 &&
+        errno != ENOENT) {
+      PLOG(ERROR) << "Failed to garbage collect " << directory;
+    }
+
+    dispatch(collector, &GarbageCollector::deleted, directory);
+
+    usleep((useconds_t) (1000000 / rate));
+  }
+}
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,107 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GC_HPP__
+#define __GC_HPP__
+
+#include <map>
+#include <string>
+
+#include <tr1/memory>
+
+#include <process/process.hpp>
+
+#include "common/hashset.hpp"
+#include "common/option.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// Deletes the work directories of executors that are done once
+// they're 'age' seconds old, or sooner (oldest first) while the disk
+// with the slave's work directory ('directory') is more than
+// 'watermark' (a fraction) full. The directories get deleted by a low
+// priority thread of the collector's own, at most 'rate' per second,
+// so that deleting lots of them doesn't compete with the running
+// executors for the disk. The scheduled directories are checkpointed
+// (in the work directory) so that they still get deleted after the
+// slave restarts.
+class GarbageCollector : public process::Process<GarbageCollector>
+{
+public:
+  GarbageCollector(const std::string& directory,
+                   double age,
+                   double watermark,
+                   double rate);
+
+  virtual ~GarbageCollector() {}
+
+  // Schedules a directory for deletion.
+  void schedule(const std::string& directory);
+
+  // Returns the next directory to delete (if any is due), which stays
+  // checkpointed until it's been deleted.
+  Option<std::string> next();
+
+  void deleted(const std::string& directory);
+
+  // Returns how full (as a fraction) the disk with a directory is.
+  static double usage(const std::string& directory);
+
+protected:
+  virtual void initialize();
+  virtual void finalize();
+
+private:
+  // Writes out the scheduled directories (and the ones being deleted).
+  void checkpoint();
+
+  // State shared with the thread deleting directories, which might
+  // outlive the collector.
+  struct Deleter
+  {
+    Deleter() : stopped(false) {}
+    volatile bool stopped;
+  };
+
+  // Deletes (in its own thread) the directories the collector says
+  // are due, until the deleter gets stopped.
+  static void remove(const process::PID<GarbageCollector>& collector,
+                     const std::tr1::shared_ptr<Deleter>& deleter,
+                     double rate);
+
+  const std::string directory;
+  const std::string path; // Of the checkpoint.
+  const double age;
+  const double watermark;
+  const double rate;
+
+  // Directories by the time they were scheduled for deletion.
+  std::multimap<double, std::string> scheduled;
+  hashset<std::string> deleting;
+
+  std::tr1::shared_ptr<Deleter> deleter;
+};
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __GC_HPP__
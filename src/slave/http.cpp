@@ -17,20 +17,27 @@
  */
 
 #include <iomanip>
+#include <map>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "common/build.hpp"
 #include "common/foreach.hpp"
 #include "common/json.hpp"
 #include "common/resources.hpp"
+#include "common/statistics.hpp"
+#include "common/strings.hpp"
 #include "common/type_utils.hpp"
 #include "common/utils.hpp"
+#include "common/webui.hpp"
 
 #include "slave/http.hpp"
 #include "slave/slave.hpp"
 
 using process::Future;
+using process::HttpBadRequestResponse;
+using process::HttpNotFoundResponse;
 using process::HttpResponse;
 using process::HttpRequest;
 
@@ -69,6 +76,25 @@ JSON::Object model(const Executor& executor)
   object.values["directory"] = executor.directory;
   object.values["resources"] = model(executor.resources);
 
+  if (executor.usage.isSome()) {
+    JSON::Object usage;
+    usage.values["cpus"] = executor.usage.get().cpus();
+    usage.values["mem"] = executor.usage.get().mem();
+    if (executor.usage.get().has_cpuset()) {
+      // E.g., "0-3,8" (like the kernel lists CPUs).
+      std::ostringstream out;
+      const Value::Ranges ranges = executor.usage.get().cpuset();
+      for (int i = 0; i < ranges.range_size(); i++) {
+        out << (i > 0 ? "," : "") << ranges.range(i).begin();
+        if (ranges.range(i).end() != ranges.range(i).begin()) {
+          out << "-" << ranges.range(i).end();
+        }
+      }
+      usage.values["cpuset"] = out.str();
+    }
+    object.values["usage"] = usage;
+  }
+
   JSON::Array array;
 
   // TODO(benh): Send queued tasks also.
@@ -144,6 +170,98 @@ Future<HttpResponse> vars(
 }
 
 
+Future<HttpResponse> log(
+    const Slave& slave,
+    const HttpRequest& request)
+{
+  std::map<string, std::vector<string> > pairs =
+    strings::pairs(request.query, '&', '=');
+
+  if (pairs.count("framework_id") == 0 ||
+      pairs.count("executor_id") == 0 ||
+      pairs.count("file") == 0) {
+    return HttpBadRequestResponse();
+  }
+
+  const string& file = pairs["file"].back();
+  if (file != "stdout" && file != "stderr") {
+    return HttpBadRequestResponse();
+  }
+
+  FrameworkID frameworkId;
+  frameworkId.set_value(pairs["framework_id"].back());
+
+  ExecutorID executorId;
+  executorId.set_value(pairs["executor_id"].back());
+
+  if (!slave.frameworks.contains(frameworkId)) {
+    return HttpNotFoundResponse();
+  }
+
+  const Framework* framework = slave.frameworks.find(frameworkId)->second;
+
+  if (!framework->executors.contains(executorId)) {
+    return HttpNotFoundResponse();
+  }
+
+  const Executor* executor = framework->executors.find(executorId)->second;
+
+  // Page through the log if asked to, otherwise return the tail.
+  if (pairs.count("offset") > 0 || pairs.count("length") > 0) {
+    return webui::file(executor->directory + "/" + file, request);
+  }
+
+  return webui::tail(executor->directory + "/" + file, request);
+}
+
+
+Future<HttpResponse> file(
+    const Slave& slave,
+    const HttpRequest& request)
+{
+  std::map<string, std::vector<string> > pairs =
+    strings::pairs(request.query, '&', '=');
+
+  if (pairs.count("framework_id") == 0 ||
+      pairs.count("executor_id") == 0 ||
+      pairs.count("path") == 0) {
+    return HttpBadRequestResponse();
+  }
+
+  // Only serve files within the executor's directory.
+  const string& path = pairs["path"].back();
+  if (path.empty() || path[0] == '/') {
+    return HttpBadRequestResponse();
+  }
+
+  foreach (const string& component, strings::split(path, "/")) {
+    if (component == "..") {
+      return HttpBadRequestResponse();
+    }
+  }
+
+  FrameworkID frameworkId;
+  frameworkId.set_value(pairs["framework_id"].back());
+
+  ExecutorID executorId;
+  executorId.set_value(pairs["executor_id"].back());
+
+  if (!slave.frameworks.contains(frameworkId)) {
+    return HttpNotFoundResponse();
+  }
+
+  const Framework* framework = slave.frameworks.find(frameworkId)->second;
+
+  if (!framework->executors.contains(executorId)) {
+    return HttpNotFoundResponse();
+  }
+
+  const Executor* executor = framework->executors.find(executorId)->second;
+
+  return webui::file(executor->directory + "/" + path, request);
+}
+
+
 namespace json {
 
 Future<HttpResponse> stats(
@@ -152,16 +270,35 @@ Future<HttpResponse> stats(
 {
   LOG(INFO) << "HTTP request for '" << request.path << "'";
 
+  const internal::Statistics& statistics = slave.stats;
+
   JSON::Object object;
   object.values["uptime"] = Clock::now() - slave.startTime;
   object.values["total_frameworks"] = slave.frameworks.size();
-  object.values["started_tasks"] = slave.stats.tasks[TASK_STARTING];
-  object.values["finished_tasks"] = slave.stats.tasks[TASK_FINISHED];
-  object.values["killed_tasks"] = slave.stats.tasks[TASK_KILLED];
-  object.values["failed_tasks"] = slave.stats.tasks[TASK_FAILED];
-  object.values["lost_tasks"] = slave.stats.tasks[TASK_LOST];
-  object.values["valid_status_updates"] = slave.stats.validStatusUpdates;
-  object.values["invalid_status_updates"] = slave.stats.invalidStatusUpdates;
+  object.values["started_tasks"] = statistics.tasks[TASK_STARTING]->value();
+  object.values["finished_tasks"] = statistics.tasks[TASK_FINISHED]->value();
+  object.values["killed_tasks"] = statistics.tasks[TASK_KILLED]->value();
+  object.values["failed_tasks"] = statistics.tasks[TASK_FAILED]->value();
+  object.values["lost_tasks"] = statistics.tasks[TASK_LOST]->value();
+  object.values["valid_status_updates"] =
+    statistics.validStatusUpdates.value();
+  object.values["invalid_status_updates"] =
+    statistics.invalidStatusUpdates.value();
+
+  // Resources the executors actually used (as last sampled).
+  double cpus = 0.0;
+  double mem = 0.0;
+  foreachvalue (Framework* framework, slave.frameworks) {
+    foreachvalue (Executor* executor, framework->executors) {
+      if (executor->usage.isSome()) {
+        cpus += executor->usage.get().cpus();
+        mem += executor->usage.get().mem();
+      }
+    }
+  }
+
+  object.values["used_cpus"] = cpus;
+  object.values["used_mem"] = mem;
 
   std::ostringstream out;
 
@@ -175,6 +312,24 @@ Future<HttpResponse> stats(
 }
 
 
+Future<HttpResponse> handlers(
+    const Slave& slave,
+    const HttpRequest& request)
+{
+  LOG(INFO) << "HTTP request for '" << request.path << "'";
+
+  std::ostringstream out;
+
+  JSON::render(out, internal::model(slave.statistics()));
+
+  HttpOKResponse response;
+  response.headers["Content-Type"] = "application/json";
+  response.headers["Content-Length"] = utils::stringify(out.str().size());
+  response.body = out.str().data();
+  return response;
+}
+
+
 Future<HttpResponse> state(
     const Slave& slave,
     const HttpRequest& request)
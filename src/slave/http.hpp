@@ -39,6 +39,25 @@ process::Future<process::HttpResponse> vars(
     const process::HttpRequest& request);
 
 
+// Returns the last lines of the stdout or stderr of an executor
+// running on the slave, given '?framework_id=...&executor_id=...'
+// and '&file=<stdout|stderr>' (see webui::tail for '&lines=...'), or
+// a page of it given '&offset=...' and/or '&length=...' (see
+// webui::file).
+process::Future<process::HttpResponse> log(
+    const Slave& slave,
+    const process::HttpRequest& request);
+
+
+// Returns a page of a file in the directory of an executor running
+// on the slave, given '?framework_id=...&executor_id=...' and
+// '&path=<path relative to the directory>' (see webui::file for
+// '&offset=...' and '&length=...').
+process::Future<process::HttpResponse> file(
+    const Slave& slave,
+    const process::HttpRequest& request);
+
+
 namespace json {
 
 // Returns current statistics of the slave.
@@ -47,6 +66,13 @@ process::Future<process::HttpResponse> stats(
     const process::HttpRequest& request);
 
 
+// Returns statistics about the messages (and other events) handled
+// by the slave, by message name.
+process::Future<process::HttpResponse> handlers(
+    const Slave& slave,
+    const process::HttpRequest& request);
+
+
 // Returns current state of the cluster that the slave knows about.
 process::Future<process::HttpResponse> state(
     const Slave& slave,
@@ -20,6 +20,7 @@
 #define __ISOLATION_MODULE_HPP__
 
 #include <string>
+#include <vector>
 
 #include <mesos/mesos.hpp>
 
@@ -27,6 +28,7 @@
 
 #include "configurator/configuration.hpp"
 
+#include "common/foreach.hpp"
 #include "common/resources.hpp"
 
 
@@ -60,6 +62,17 @@ public:
   virtual void killExecutor(const FrameworkID& frameworkId,
                             const ExecutorID& executorId) = 0;
 
+  // Terminate several of a framework's executors at once (e.g., when
+  // the framework gets shut down). By default they get killed one at
+  // a time, via killExecutor.
+  virtual void killExecutors(const FrameworkID& frameworkId,
+                             const std::vector<ExecutorID>& executorIds)
+  {
+    foreach (const ExecutorID& executorId, executorIds) {
+      killExecutor(frameworkId, executorId);
+    }
+  }
+
   // Update the resource limits for a given framework. This method will
   // be called only after an executor for the framework is started.
   virtual void resourcesChanged(const FrameworkID& frameworkId,
@@ -0,0 +1,79 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <glog/logging.h>
+
+#include <process/dispatch.hpp>
+#include <process/process.hpp>
+
+#include "common/foreach.hpp"
+
+#include "slave/launch_pool.hpp"
+
+using process::wait; // Necessary on some OS's to disambiguate.
+
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+class LaunchWorker : public process::Process<LaunchWorker>
+{
+public:
+  void launch(const lambda::function<pid_t(void)>& launch,
+              const lambda::function<void(pid_t)>& launched)
+  {
+    launched(launch());
+  }
+};
+
+
+LaunchPool::LaunchPool(size_t _workers)
+  : next(0)
+{
+  CHECK(_workers > 0);
+
+  for (size_t i = 0; i < _workers; i++) {
+    LaunchWorker* worker = new LaunchWorker();
+    process::spawn(worker);
+    workers.push_back(worker);
+  }
+}
+
+
+LaunchPool::~LaunchPool()
+{
+  // Any launches still queued up get dropped.
+  foreach (LaunchWorker* worker, workers) {
+    process::terminate(worker);
+    process::wait(worker);
+    delete worker;
+  }
+}
+
+
+void LaunchPool::launch(const lambda::function<pid_t(void)>& launch,
+                        const lambda::function<void(pid_t)>& launched)
+{
+  process::dispatch(workers[next], &LaunchWorker::launch, launch, launched);
+  next = (next + 1) % workers.size();
+}
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
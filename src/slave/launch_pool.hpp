@@ -0,0 +1,87 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LAUNCH_POOL_HPP__
+#define __LAUNCH_POOL_HPP__
+
+#include <sys/types.h>
+
+#include <vector>
+
+#include <process/dispatch.hpp>
+#include <process/pid.hpp>
+
+#include "common/lambda.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+class LaunchWorker;
+
+
+// Forks (or vforks) and execs executors on a fixed number of worker
+// processes (i.e., threads) so that an isolation module doesn't have
+// to wait on each launch before it can start the next one (or handle
+// a kill). A launch is a function that starts the executor's process
+// and returns its pid, which gets passed to the launch's 'launched'
+// callback on the worker (it's up to the callback to dispatch it back
+// to the isolation module, see below). Launches get dealt out to the workers in
+// turn, so at most 'workers' of them run at once and the rest queue
+// up behind them.
+class LaunchPool
+{
+public:
+  explicit LaunchPool(size_t workers);
+  ~LaunchPool();
+
+  void launch(const lambda::function<pid_t(void)>& launch,
+              const lambda::function<void(pid_t)>& launched);
+
+  // Launches and then dispatches the pid to 'method' of 'pid' (along
+  // with 'a', e.g., whatever the process keeps about the executor).
+  template <typename T, typename A>
+  void launch(const lambda::function<pid_t(void)>& launch,
+              const process::PID<T>& pid,
+              void (T::*method)(A, pid_t),
+              A a)
+  {
+    void (*dispatch)(const process::PID<T>&,
+                     void (T::*)(A, pid_t),
+                     A,
+                     pid_t) =
+      &process::template dispatch<T, A, pid_t, A, pid_t>;
+
+    this->launch(launch, lambda::bind(dispatch, pid, method, a, lambda::_1));
+  }
+
+private:
+  // No copying, no assigning.
+  LaunchPool(const LaunchPool&);
+  LaunchPool& operator = (const LaunchPool&);
+
+  std::vector<LaunchWorker*> workers;
+  size_t next;
+};
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __LAUNCH_POOL_HPP__
@@ -16,21 +16,34 @@
  * limitations under the License.
  */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+
 #include <algorithm>
 #include <sstream>
 #include <map>
 
+#include <process/clock.hpp>
 #include <process/dispatch.hpp>
+#include <process/timer.hpp>
 
 #include "lxc_isolation_module.hpp"
 
 #include "common/foreach.hpp"
+#include "common/thread.hpp"
 #include "common/type_utils.hpp"
 #include "common/units.hpp"
 #include "common/utils.hpp"
 
 #include "launcher/launcher.hpp"
 
+#include "slave/cgroups.hpp"
+#include "slave/constants.hpp"
+
 using namespace mesos;
 using namespace mesos::internal;
 using namespace mesos::internal::slave;
@@ -43,21 +56,159 @@ using process::wait; // Necessary on some OS's to disambiguate.
 
 using std::map;
 using std::max;
+using std::min;
+using std::set;
 using std::string;
 using std::vector;
 
+using std::tr1::shared_ptr;
+
 
 namespace {
 
 const int32_t CPU_SHARES_PER_CPU = 1024;
 const int32_t MIN_CPU_SHARES = 10;
 const int64_t MIN_MEMORY_MB = 128 * Megabyte;
+const int64_t MIN_BLKIO_WEIGHT = 10;
+const int64_t MAX_BLKIO_WEIGHT = 1000;
+const int64_t MIN_DISK_IO_MB = 1 * Megabyte;
+const int64_t MIN_NET_BW_MBIT = 1;
+
+// Class IDs of the HTB qdisc on the shaped interface are 1:<minor>.
+const uint32_t NET_CLS_MAJOR = 0x10000;
+
+
+// Runs tc with the specified arguments.
+Try<bool> tc(const string& args)
+{
+  Try<int> status = utils::os::shell(NULL, "tc %s 2>&1", args.c_str());
+
+  if (status.isError()) {
+    return Try<bool>::error(status.error());
+  } else if (status.get() != 0) {
+    return Try<bool>::error("Failed to run 'tc " + args + "'");
+  }
+
+  return true;
+}
+
+
+// Returns the ID ("1:<minor>", in hex) of a class of the HTB qdisc.
+string classId(uint16_t minor)
+{
+  std::ostringstream out;
+  out << "1:" << std::hex << minor;
+  return out.str();
+}
+
+
+// Returns the blkio weight of some disk I/O out of the total.
+int64_t blkioWeight(double io, double total)
+{
+  int64_t weight = (int64_t) (MAX_BLKIO_WEIGHT * io / total);
+  return min(max(weight, MIN_BLKIO_WEIGHT), MAX_BLKIO_WEIGHT);
+}
+
+
+// Quotes a value for sh (inside single quotes, where only the single
+// quotes themselves need escaping).
+string quote(const string& value)
+{
+  string quoted = "'";
+  foreach (char c, value) {
+    if (c == '\'') {
+      quoted += "'\\''";
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted + "'";
+}
+
+
+// Closes the file descriptors a forked child inherited from the
+// slave, other than stdin, stdout and stderr. Note that we are
+// assuming those can ONLY be found at the POSIX specified file
+// numbers (0, 1, 2).
+void closeFiles()
+{
+  foreach (const string& entry, utils::os::listdir("/proc/self/fd")) {
+    if (entry != "." && entry != "..") {
+      try {
+        int fd = boost::lexical_cast<int>(entry);
+        if (fd != STDIN_FILENO &&
+          fd != STDOUT_FILENO &&
+          fd != STDERR_FILENO) {
+          close(fd);
+        }
+      } catch (boost::bad_lexical_cast&) {
+        LOG(FATAL) << "Failed to close file descriptors";
+      }
+    }
+  }
+}
+
+
+// Forks a child that runs lxc-execute on the container with the
+// arguments (i.e., the control group options and the command), after
+// setting up the environment for the launcher if there is one. Note
+// that lxc-execute automatically creates the container and deletes it
+// when finished (and doesn't return until then).
+pid_t execute(const string& container,
+              const vector<string>& arguments,
+              ExecutorLauncher* launcher)
+{
+  pid_t pid;
+  if ((pid = fork()) == -1) {
+    PLOG(FATAL) << "Failed to fork to run lxc-execute";
+  }
+
+  if (pid == 0) {
+    closeFiles();
+
+    if (launcher != NULL) {
+      launcher->setupEnvironmentForLauncherMain();
+    }
+
+    const char** args = (const char**) new char*[3 + arguments.size() + 1];
+
+    int i = 0;
+
+    args[i++] = "lxc-execute";
+    args[i++] = "-n";
+    args[i++] = container.c_str();
+
+    foreach (const string& argument, arguments) {
+      args[i++] = argument.c_str();
+    }
+
+    args[i++] = NULL;
+
+    execvp(args[0], (char* const*) args);
+
+    // If we get here, the execvp call failed.
+    LOG(FATAL) << "Could not exec lxc-execute";
+  }
+
+  delete launcher;
+
+  return pid;
+}
 
 } // namespace {
 
 
 LxcIsolationModule::LxcIsolationModule()
-  : initialized(false)
+  : initialized(false),
+    launchers(NULL),
+    launching(0),
+    cpusets(false),
+    diskIo(0),
+    nextClassId(1),
+    memoryThreshold(0),
+    poolSize(0),
+    warming(0),
+    nextWarmId(0)
 {
   // Spawn the reaper, note that it might send us a message before we
   // actually get spawned ourselves, but that's okay, the message will
@@ -70,6 +221,17 @@ LxcIsolationModule::LxcIsolationModule()
 
 LxcIsolationModule::~LxcIsolationModule()
 {
+  delete launchers;
+
+  foreach (const WarmContainer& warm, pool) {
+    cgroups::kill(warm.container);
+    unlink(warm.fifo.c_str());
+  }
+
+  if (poolDirectory != "") {
+    rmdir(poolDirectory.c_str());
+  }
+
   CHECK(reaper != NULL);
   terminate(reaper);
   wait(reaper);
@@ -92,13 +254,115 @@ void LxcIsolationModule::initialize(
                 << "tools are installed";
   }
 
+  // Check that the cgroup hierarchies the containers' limits are
+  // controlled with are mounted.
+  const char* subsystems[] = { "cpu", "memory" };
+
+  for (size_t i = 0; i < sizeof(subsystems) / sizeof(subsystems[0]); i++) {
+    Try<string> hierarchy = cgroups::hierarchy(subsystems[i]);
+    if (hierarchy.isError()) {
+      LOG(FATAL) << "LXC isolation module requires cgroups: "
+                 << hierarchy.error();
+    }
+  }
+
   // Check that we are root (it might also be possible to create Linux
   // containers without being root, but we can support that later).
   if (getuid() != 0) {
     LOG(FATAL) << "LXC isolation module requires slave to run as root";
   }
 
+  cpusets = conf.get<bool>("cpusets", false);
+
+  if (cpusets) {
+    Try<string> hierarchy = cgroups::hierarchy("cpuset");
+    if (hierarchy.isError()) {
+      LOG(FATAL) << "Pinning executors to CPUs requires cgroups: "
+                 << hierarchy.error();
+    }
+
+    Try<vector<topology::Node> > probed = topology::nodes();
+    if (probed.isError()) {
+      LOG(FATAL) << "Failed to determine the CPU topology: "
+                 << probed.error();
+    }
+
+    nodes = probed.get();
+
+    foreach (const topology::Node& node, nodes) {
+      freeCpus.insert(node.cpus.begin(), node.cpus.end());
+      LOG(INFO) << "NUMA node " << node.id << " has CPUs "
+                << topology::format(set<int>(node.cpus.begin(),
+                                             node.cpus.end()));
+    }
+  }
+
+  const Resources& resources =
+    Resources::parse(conf.get<string>("resources", ""));
+
+  diskIo = resources.get("disk_io", Value::Scalar()).value();
+
+  if (diskIo > 0) {
+    Try<string> hierarchy = cgroups::hierarchy("blkio");
+    if (hierarchy.isError()) {
+      LOG(FATAL) << "Isolating disk I/O requires cgroups: "
+                 << hierarchy.error();
+    }
+
+    blkioDevice = conf.get<string>("blkio_device", "");
+  }
+
+  netInterface = conf.get<string>("net_interface", "");
+
+  if (netInterface != "") {
+    Try<string> hierarchy = cgroups::hierarchy("net_cls");
+    if (hierarchy.isError()) {
+      LOG(FATAL) << "Shaping network traffic requires cgroups: "
+                 << hierarchy.error();
+    }
+
+    // Start over with an HTB qdisc whose (only) filter puts the
+    // packets in the class of their sender's net_cls cgroup (packets
+    // of the rest of the machine aren't classified and so aren't
+    // shaped).
+    tc("qdisc del dev " + netInterface + " root");
+
+    Try<bool> result =
+      tc("qdisc add dev " + netInterface + " root handle 1: htb");
+
+    if (result.isSome()) {
+      result = tc("filter add dev " + netInterface +
+                  " parent 1: protocol ip prio 10 handle 1: cgroup");
+    }
+
+    if (result.isError()) {
+      LOG(FATAL) << "Failed to set up traffic shaping on "
+                 << netInterface << ": " << result.error();
+    }
+  }
+
+  memoryThreshold = conf.get<double>("memory_pressure_threshold",
+                                     MEMORY_PRESSURE_THRESHOLD);
+
+  poolSize = conf.get<int>("lxc_pool_size", 0);
+
+  if (poolSize > 0) {
+    char temp[] = "/tmp/mesos-lxc-pool-XXXXXX";
+    if (mkdtemp(temp) == NULL) {
+      PLOG(FATAL) << "Failed to create a directory for warm containers";
+    }
+
+    poolDirectory = temp;
+  }
+
+  launchers =
+    new LaunchPool(conf.get<int>("launch_workers", LAUNCH_WORKERS));
+
   initialized = true;
+
+  warmUp();
+
+  sampleUsage();
 }
 
 
@@ -131,99 +395,272 @@ void LxcIsolationModule::launchExecutor(
   info->executorId = executorId;
   info->container = container;
   info->pid = -1;
+  info->killed = false;
+  info->classId = 0;
+
+  const double mem = resources.get("mem", Value::Scalar()).value();
+  info->memoryLimit = max((int64_t) mem, MIN_MEMORY_MB) * 1024LL * 1024LL;
 
   infos[frameworkId][executorId] = info;
 
-  // Run lxc-execute mesos-launcher using a fork-exec (since lxc-execute
-  // does not return until the container is finished). Note that lxc-execute
-  // automatically creates the container and will delete it when finished.
-  pid_t pid;
-  if ((pid = fork()) == -1) {
-    PLOG(FATAL) << "Failed to fork to launch new executor";
+  if (cpusets) {
+    placeCpus(info, resources);
   }
 
-  if (pid) {
-    // In parent process.
-    LOG(INFO) << "Forked executor at = " << pid;
+  if (netInterface != "") {
+    info->classId = nextClassId;
+    nextClassId = nextClassId == 0xffff ? 1 : nextClassId + 1;
+    setNetBw(info, resources);
+  }
+
+  // Launch into a warm container if there's one ready (and start
+  // another one to replace it).
+  while (!pool.empty()) {
+    const WarmContainer warm = pool.front();
+    pool.pop_front();
 
-    // Record the pid.
-    info->pid = pid;
+    info->container = warm.container;
+
+    if (launchWarm(info, warm, frameworkInfo, executorInfo,
+                   directory, resources)) {
+      warmUp();
+      return;
+    }
+  }
+
+  info->container = container;
+
+  // Create an ExecutorLauncher to set up the environment for executing
+  // an external launcher_main.cpp process (inside of lxc-execute).
+  ExecutorLauncher* launcher =
+    createExecutorLauncher(*info, frameworkInfo, executorInfo, directory);
+
+  // Construct the initial control group options that specify the
+  // initial resources limits for this executor.
+  vector<string> arguments = getControlGroupOptions(resources, *info);
+
+  arguments.push_back(
+      conf.get("launcher_dir", MESOS_LIBEXECDIR) + "/mesos-launcher");
+
+  // Run lxc-execute mesos-launcher using a fork-exec on a launch worker
+  // (since lxc-execute does not return until the container is
+  // finished, and so we can keep launching and killing executors in
+  // the meantime).
+  launching++;
+
+  launchers->launch(monitored(lambda::bind(&execute,
+                                           container,
+                                           arguments,
+                                           launcher),
+                              reaper),
+                    PID<LxcIsolationModule>(this),
+                    &LxcIsolationModule::launched,
+                    info);
+
+  // Replace any warm containers that exited before they got used.
+  warmUp();
+}
+
+
+void LxcIsolationModule::launched(ContainerInfo* info, pid_t pid)
+{
+  launching--;
+
+  info->pid = pid;
+
+  if (info->killed) {
+    LOG(INFO) << "Stopping container " << info->container
+              << " since it got killed while launching";
+
+    destroy(info);
+  } else {
+    LOG(INFO) << "Forked executor at = " << pid;
 
     // Tell the slave this executor has started.
     dispatch(slave, &Slave::executorStarted,
-             frameworkId, executorId, pid);
-  } else {
-    // Close unnecessary file descriptors. Note that we are assuming
-    // stdin, stdout, and stderr can ONLY be found at the POSIX
-    // specified file numbers (0, 1, 2).
-    foreach (const string& entry, utils::os::listdir("/proc/self/fd")) {
-      if (entry != "." && entry != "..") {
-        try {
-          int fd = boost::lexical_cast<int>(entry);
-          if (fd != STDIN_FILENO &&
-            fd != STDOUT_FILENO &&
-            fd != STDERR_FILENO) {
-            close(fd);
-          }
-        } catch (boost::bad_lexical_cast&) {
-          LOG(FATAL) << "Failed to close file descriptors";
-        }
-      }
+             info->frameworkId, info->executorId, pid);
+
+    // The executor might have exited before we found out its pid.
+    if (exited.contains(pid)) {
+      const int status = exited[pid];
+      exited.erase(pid);
+      processExited(pid, status);
     }
+  }
+
+  if (launching == 0) {
+    exited.clear();
+  }
+}
+
+
+ExecutorLauncher* LxcIsolationModule::createExecutorLauncher(
+    const ContainerInfo& info,
+    const FrameworkInfo& frameworkInfo,
+    const ExecutorInfo& executorInfo,
+    const string& directory)
+{
+  map<string, string> params;
+
+  for (int i = 0; i < executorInfo.params().param_size(); i++) {
+    params[executorInfo.params().param(i).key()] =
+      executorInfo.params().param(i).value();
+  }
+
+  return new ExecutorLauncher(info.frameworkId,
+                              info.executorId,
+                              executorInfo.uri(),
+                              frameworkInfo.user(),
+                              directory,
+                              slave,
+                              conf.get("frameworks_home", ""),
+                              conf.get("home", ""),
+                              conf.get("hadoop_home", ""),
+                              conf.get("executor_cache_dir", ""),
+                              conf.get<int>("executor_cache_size",
+                                            EXECUTOR_CACHE_SIZE_MEGABYTES),
+                              !local,
+                              conf.get("switch_user", true),
+                              info.container,
+                              params);
+}
 
-    // Create an ExecutorLauncher to set up the environment for executing
-    // an external launcher_main.cpp process (inside of lxc-execute).
-    map<string, string> params;
 
-    for (int i = 0; i < executorInfo.params().param_size(); i++) {
-      params[executorInfo.params().param(i).key()] =
-        executorInfo.params().param(i).value();
+void LxcIsolationModule::warmUp()
+{
+  while (pool.size() + warming < (size_t) poolSize) {
+    WarmContainer warm;
+    warm.container = "mesos.warm-" + utils::stringify(getpid()) +
+      "-" + utils::stringify(nextWarmId++);
+    warm.fifo = poolDirectory + "/" + warm.container;
+    warm.pid = -1;
+
+    if (mkfifo(warm.fifo.c_str(), S_IRUSR | S_IWUSR) != 0) {
+      PLOG(ERROR) << "Failed to create FIFO " << warm.fifo;
+      return;
     }
 
+    // Start out with the smallest limits (the executor's get set when
+    // it's launched into the container).
+    ContainerInfo info;
+    info.classId = 0;
+
+    vector<string> arguments = getControlGroupOptions(Resources(), info);
+
+    arguments.push_back("/bin/sh");
+    arguments.push_back("-c");
+    arguments.push_back(". " + warm.fifo + " && exec " +
+                        conf.get("launcher_dir", MESOS_LIBEXECDIR) +
+                        "/mesos-launcher");
+
+    launching++;
+    warming++;
+
+    launchers->launch(monitored(lambda::bind(&execute,
+                                             warm.container,
+                                             arguments,
+                                             (ExecutorLauncher*) NULL),
+                                reaper),
+                      PID<LxcIsolationModule>(this),
+                      &LxcIsolationModule::warmed,
+                      warm);
+  }
+}
+
+
+void LxcIsolationModule::warmed(WarmContainer warm, pid_t pid)
+{
+  launching--;
+  warming--;
+
+  warm.pid = pid;
+
+  if (exited.contains(pid)) {
+    LOG(WARNING) << "Warm container " << warm.container
+                 << " exited with status " << exited[pid];
+    exited.erase(pid);
+    unlink(warm.fifo.c_str());
+  } else {
+    LOG(INFO) << "Started warm container " << warm.container
+              << " at " << pid;
+    pool.push_back(warm);
+  }
+
+  if (launching == 0) {
+    exited.clear();
+  }
+}
+
+
+bool LxcIsolationModule::launchWarm(
+    ContainerInfo* info,
+    const WarmContainer& warm,
+    const FrameworkInfo& frameworkInfo,
+    const ExecutorInfo& executorInfo,
+    const string& directory,
+    const Resources& resources)
+{
+  // Opening the FIFO without blocking fails unless the container's
+  // shell is already waiting to read it.
+  int fd = open(warm.fifo.c_str(), O_WRONLY | O_NONBLOCK);
+
+  bool ready = fd >= 0 && fcntl(fd, F_SETFL, 0) == 0 &&
+    setLimits(info, resources) &&
+    (!cpusets || setCpuset(info));
+
+  if (ready && info->classId != 0) {
+    ready = setControlGroupValue(info->container, "net_cls.classid",
+                                 NET_CLS_MAJOR | info->classId);
+  }
+
+  if (ready) {
     ExecutorLauncher* launcher =
-      new ExecutorLauncher(frameworkId,
-			   executorId,
-			   executorInfo.uri(),
-			   frameworkInfo.user(),
-                           directory,
-			   slave,
-			   conf.get("frameworks_home", ""),
-			   conf.get("home", ""),
-			   conf.get("hadoop_home", ""),
-			   !local,
-			   conf.get("switch_user", true),
-			   container,
-			   params);
-
-    launcher->setupEnvironmentForLauncherMain();
-
-    // Construct the initial control group options that specify the
-    // initial resources limits for this executor.
-    const vector<string>& options = getControlGroupOptions(resources);
-
-    const char** args = (const char**) new char*[3 + options.size() + 2];
+      createExecutorLauncher(*info, frameworkInfo, executorInfo, directory);
 
-    int i = 0;
+    string script;
+    foreachpair (const string& key, const string& value,
+                 launcher->getLauncherEnvironment()) {
+      script += "export " + key + "=" + quote(value) + "\n";
+    }
 
-    args[i++] = "lxc-execute";
-    args[i++] = "-n";
-    args[i++] = container.c_str();
+    delete launcher;
 
-    for (int j = 0; j < options.size(); j++) {
-      args[i++] = options[j].c_str();
+    size_t offset = 0;
+    while (ready && offset < script.size()) {
+      ssize_t length =
+        write(fd, script.data() + offset, script.size() - offset);
+
+      if (length < 0 && errno != EINTR) {
+        PLOG(ERROR) << "Failed to write the environment of the launcher";
+        ready = false;
+      } else if (length > 0) {
+        offset += length;
+      }
     }
+  }
 
-    // Determine path for mesos-launcher from Mesos home directory.
-    string path = conf.get("launcher_dir", MESOS_LIBEXECDIR) + "/mesos-launcher";
-    args[i++] = path.c_str();
-    args[i++] = NULL;
+  if (fd >= 0) {
+    close(fd);
+  }
 
-    // Run lxc-execute.
-    execvp(args[0], (char* const*) args);
+  unlink(warm.fifo.c_str());
 
-    // If we get here, the execvp call failed.
-    LOG(FATAL) << "Could not exec lxc-execute";
+  if (!ready) {
+    LOG(WARNING) << "Warm container " << warm.container
+                 << " wasn't ready, getting rid of it";
+    cgroups::kill(warm.container);
+    return false;
   }
+
+  LOG(INFO) << "Launched " << info->executorId
+            << " in warm container " << warm.container;
+
+  info->pid = warm.pid;
+
+  dispatch(slave, &Slave::executorStarted,
+           info->frameworkId, info->executorId, warm.pid);
+
+  return true;
 }
 
 
@@ -240,31 +677,56 @@ void LxcIsolationModule::killExecutor(
 
   ContainerInfo* info = infos[frameworkId][executorId];
 
-  CHECK(info->container != "");
+  if (infos[frameworkId].size() == 1) {
+    infos.erase(frameworkId);
+  } else {
+    infos[frameworkId].erase(executorId);
+  }
+
+  // NOTE: Both frameworkId and executorId are no longer valid because
+  // they have just been deleted above!
+
+  if (info->pid == -1) {
+    // Still being launched, the container gets destroyed once it's
+    // started (see launched).
+    info->killed = true;
+    return;
+  }
 
   LOG(INFO) << "Stopping container " << info->container;
 
-  Try<int> status =
-    utils::os::shell(NULL, "lxc-stop -n %s", info->container.c_str());
+  destroy(info);
+}
 
-  if (status.isError()) {
-    LOG(ERROR) << "Failed to stop container " << info->container
-               << ": " << status.error();
-  } else if (status.get() != 0) {
+
+void LxcIsolationModule::destroy(ContainerInfo* info)
+{
+  CHECK(info->container != "");
+
+  stop(info->pressure);
+  stop(info->oom);
+
+  // Killing the processes in the container (including lxc-init) makes
+  // lxc-execute exit and destroy the container.
+  Try<bool> killed = cgroups::kill(info->container);
+
+  if (killed.isError()) {
     LOG(ERROR) << "Failed to stop container " << info->container
-               << ", lxc-stop returned: " << status.get();
+               << ": " << killed.error();
   }
 
-  if (infos[frameworkId].size() == 1) {
-    infos.erase(frameworkId);
-  } else {
-    infos[frameworkId].erase(executorId);
+  freeCpus.insert(info->cpus.begin(), info->cpus.end());
+
+  if (info->classId != 0) {
+    Try<bool> deleted = tc("class del dev " + netInterface +
+                           " classid " + classId(info->classId));
+    if (deleted.isError()) {
+      LOG(ERROR) << "Failed to delete the traffic class of container "
+                 << info->container << ": " << deleted.error();
+    }
   }
 
   delete info;
-
-  // NOTE: Both frameworkId and executorId are no longer valid because
-  // they have just been deleted above!
 }
 
 
@@ -284,6 +746,299 @@ void LxcIsolationModule::resourcesChanged(
 
   CHECK(info->container != "");
 
+  setLimits(info, resources);
+}
+
+
+void LxcIsolationModule::processExited(pid_t pid, int status)
+{
+  foreachkey (const FrameworkID& frameworkId, infos) {
+    foreachvalue (ContainerInfo* info, infos[frameworkId]) {
+      if (info->pid == pid) {
+        LOG(INFO) << "Telling slave of lost executor "
+		  << info->executorId
+                  << " of framework " << info->frameworkId;
+
+        dispatch(slave, &Slave::executorExited,
+                 info->frameworkId, info->executorId, status);
+
+        // Try and cleanup after the executor.
+        killExecutor(info->frameworkId, info->executorId);
+        return;
+      }
+    }
+  }
+
+  // A warm container that exited before it was used doesn't get
+  // replaced until the next launch (so one that can't start isn't
+  // restarted over and over).
+  for (std::deque<WarmContainer>::iterator iterator = pool.begin();
+       iterator != pool.end();
+       ++iterator) {
+    if (iterator->pid == pid) {
+      LOG(WARNING) << "Warm container " << iterator->container
+                   << " exited with status " << status;
+      unlink(iterator->fifo.c_str());
+      pool.erase(iterator);
+      return;
+    }
+  }
+
+  if (launching > 0) {
+    exited[pid] = status;
+  }
+}
+
+
+void LxcIsolationModule::sampleUsage()
+{
+  double interval = conf.get<double>("usage_sample_interval_seconds",
+                                     USAGE_SAMPLE_INTERVAL_SECONDS);
+  if (interval <= 0) {
+    return; // Sampling is disabled.
+  }
+
+  if (!infos.empty()) {
+    vector<ExecutorUsage> usages;
+
+    foreachkey (const FrameworkID& frameworkId, infos) {
+      foreachvalue (ContainerInfo* info, infos[frameworkId]) {
+        // The cgroup only exists once lxc-execute has created it.
+        Try<string> cpu = cgroups::read(info->container, "cpuacct.usage");
+        Try<string> mem =
+          cgroups::read(info->container, "memory.usage_in_bytes");
+
+        if (cpu.isError() || mem.isError()) {
+          continue;
+        }
+
+        listen(info);
+
+        // CPU time is in nanoseconds and memory in bytes.
+        info->usage.add(UsageSample(Clock::now(),
+                                    atof(cpu.get().c_str()) / 1000000000.0,
+                                    atof(mem.get().c_str()) / 1048576.0));
+
+        ExecutorUsage usage;
+        usage.mutable_framework_id()->MergeFrom(info->frameworkId);
+        usage.mutable_executor_id()->MergeFrom(info->executorId);
+        usage.set_cpus(info->usage.cpus());
+        usage.set_mem(info->usage.mem());
+
+        // Advertise the CPUs the executor is pinned to (as ranges).
+        foreach (int cpu, info->cpus) {
+          Value::Ranges* ranges = usage.mutable_cpuset();
+          if (ranges->range_size() > 0 &&
+              ranges->range(ranges->range_size() - 1).end() + 1 ==
+              (uint64_t) cpu) {
+            ranges->mutable_range(ranges->range_size() - 1)->set_end(cpu);
+          } else {
+            Value::Range* range = ranges->add_range();
+            range->set_begin(cpu);
+            range->set_end(cpu);
+          }
+        }
+
+        usages.push_back(usage);
+      }
+    }
+
+    dispatch(slave, &Slave::executorUsage, usages);
+  }
+
+  delay(interval, PID<LxcIsolationModule>(this),
+        &LxcIsolationModule::sampleUsage);
+}
+
+
+void LxcIsolationModule::listen(ContainerInfo* info)
+{
+  if (memoryThreshold <= 0) {
+    return; // Memory notifications are disabled.
+  }
+
+  PID<LxcIsolationModule> module(this);
+
+  if (info->oom.get() == NULL) {
+    Try<int> fd = cgroups::listen(info->container, "memory.oom_control");
+    if (fd.isError()) {
+      // Most likely the kernel doesn't support it, so don't retry.
+      LOG(ERROR) << "Failed to listen for container " << info->container
+                 << " running out of memory (disabling memory"
+                 << " notifications): " << fd.error();
+      memoryThreshold = 0;
+      return;
+    }
+
+    info->oom.reset(new MemoryListener(fd.get(), info->memoryLimit));
+
+    if (!thread::start(lambda::bind(&LxcIsolationModule::watch, module,
+                                    info->oom, info->frameworkId,
+                                    info->executorId), true)) {
+      LOG(FATAL) << "Failed to start a thread watching container "
+                 << info->container;
+    }
+
+    // Pause the container's processes when it runs out of memory
+    // (rather than OOM-killing one of them) so that memoryEvent gets
+    // to decide what happens to it.
+    setControlGroupValue(info->container, "memory.oom_control", 1);
+  }
+
+  if (info->pressure.get() == NULL ||
+      info->pressure->limit != info->memoryLimit) {
+    stop(info->pressure);
+    info->pressure.reset();
+
+    const int64_t threshold = (int64_t) (info->memoryLimit * memoryThreshold);
+
+    Try<int> fd = cgroups::listen(info->container, "memory.usage_in_bytes",
+                                  utils::stringify(threshold));
+    if (fd.isError()) {
+      LOG(ERROR) << "Failed to listen for the memory usage of container "
+                 << info->container << " (disabling memory notifications): "
+                 << fd.error();
+      memoryThreshold = 0;
+      return;
+    }
+
+    info->pressure.reset(new MemoryListener(fd.get(), info->memoryLimit));
+
+    if (!thread::start(lambda::bind(&LxcIsolationModule::watch, module,
+                                    info->pressure, info->frameworkId,
+                                    info->executorId), true)) {
+      LOG(FATAL) << "Failed to start a thread watching container "
+                 << info->container;
+    }
+  }
+}
+
+
+void LxcIsolationModule::watch(
+    const PID<LxcIsolationModule>& module,
+    const shared_ptr<MemoryListener>& listener,
+    const FrameworkID& frameworkId,
+    const ExecutorID& executorId)
+{
+  while (!listener->stopped) {
+    // Blocks until an event (the count of events since the last read
+    // doesn't matter), or until stop or the cgroup's removal wakes us.
+    uint64_t count;
+    if (read(listener->fd, &count, sizeof(count)) == sizeof(count)) {
+      if (!listener->stopped) {
+        dispatch(module, &LxcIsolationModule::memoryEvent,
+                 frameworkId, executorId, listener.get());
+      }
+    } else if (errno != EINTR) {
+      PLOG(ERROR) << "Failed to read memory events of executor "
+                  << executorId << " of framework " << frameworkId;
+      return;
+    }
+  }
+}
+
+
+void LxcIsolationModule::stop(const shared_ptr<MemoryListener>& listener)
+{
+  if (listener.get() != NULL) {
+    listener->stopped = true;
+    eventfd_write(listener->fd, 1);
+  }
+}
+
+
+void LxcIsolationModule::memoryEvent(
+    const FrameworkID& frameworkId,
+    const ExecutorID& executorId,
+    MemoryListener* listener)
+{
+  if (!infos.contains(frameworkId) ||
+      !infos[frameworkId].contains(executorId)) {
+    return; // The container is gone.
+  }
+
+  ContainerInfo* info = infos[frameworkId][executorId];
+
+  // The listener might have been replaced since the event (e.g., the
+  // container's limit has changed, or this is a new container).
+  if (listener != info->pressure.get() && listener != info->oom.get()) {
+    return;
+  }
+
+  Try<string> usage = cgroups::read(info->container, "memory.usage_in_bytes");
+  if (usage.isError()) {
+    return; // The cgroup is gone.
+  }
+
+  const int64_t used = atoll(usage.get().c_str());
+
+  if (listener == info->pressure.get()) {
+    // The threshold gets crossed going down as well.
+    if (used >= (int64_t) (info->memoryLimit * memoryThreshold)) {
+      LOG(WARNING) << "Container " << info->container << " is using "
+                   << used << " of its " << info->memoryLimit
+                   << " bytes of memory";
+
+      dispatch(slave, &Slave::executorMemoryPressure,
+               frameworkId, executorId,
+               used / 1048576.0, info->memoryLimit / 1048576.0, false);
+    }
+    return;
+  }
+
+  Try<string> oom = cgroups::read(info->container, "memory.oom_control");
+  if (oom.isError() || oom.get().find("under_oom 1") == string::npos) {
+    return; // It's not (or no longer) out of memory.
+  }
+
+  // We don't give the container more memory than its executor was
+  // allocated, since the master would still consider the rest free
+  // (and offer it to somebody else).
+  LOG(WARNING) << "Container " << info->container
+               << " ran out of memory, killing it";
+
+  dispatch(slave, &Slave::executorMemoryPressure,
+           frameworkId, executorId,
+           used / 1048576.0, info->memoryLimit / 1048576.0, true);
+
+  // The slave gets told about the executor exiting once lxc-execute
+  // does (see processExited).
+  Try<bool> killed = cgroups::kill(info->container);
+
+  if (killed.isError()) {
+    LOG(ERROR) << "Failed to stop container " << info->container
+               << ": " << killed.error();
+  }
+}
+
+
+bool LxcIsolationModule::setControlGroupValue(
+    const string& container,
+    const string& property,
+    int64_t value)
+{
+  LOG(INFO) << "Setting " << property
+            << " for container " << container
+            << " to " << value;
+
+  Try<bool> result =
+    cgroups::write(container, property, utils::stringify(value));
+
+  if (result.isError()) {
+    LOG(ERROR) << "Failed to set " << property
+               << " for container " << container
+               << ": " << result.error();
+    return false;
+  }
+
+  return true;
+}
+
+
+bool LxcIsolationModule::setLimits(
+    ContainerInfo* info,
+    const Resources& resources)
+{
   const string& container = info->container;
 
   // For now, just try setting the CPUs and memory right away, and kill the
@@ -303,7 +1058,7 @@ void LxcIsolationModule::resourcesChanged(
   if (!setControlGroupValue(container, property, value)) {
     // TODO(benh): Kill the executor, but do it in such a way that the
     // slave finds out about it exiting.
-    return;
+    return false;
   }
 
   double mem = resources.get("mem", Value::Scalar()).value();
@@ -315,64 +1070,162 @@ void LxcIsolationModule::resourcesChanged(
   if (!setControlGroupValue(container, property, value)) {
     // TODO(benh): Kill the executor, but do it in such a way that the
     // slave finds out about it exiting.
-    return;
+    return false;
   }
+
+  info->memoryLimit = limit_in_bytes;
+
+  listen(info);
+
+  if (cpusets && placeCpus(info, resources) && !setCpuset(info)) {
+    return false;
+  }
+
+  if (diskIo > 0 && !setDiskIo(info, resources)) {
+    return false;
+  }
+
+  if (info->classId != 0 && !setNetBw(info, resources)) {
+    return false;
+  }
+
+  return true;
 }
 
 
-void LxcIsolationModule::processExited(pid_t pid, int status)
+bool LxcIsolationModule::placeCpus(
+    ContainerInfo* info,
+    const Resources& resources)
 {
-  foreachkey (const FrameworkID& frameworkId, infos) {
-    foreachvalue (ContainerInfo* info, infos[frameworkId]) {
-      if (info->pid == pid) {
-        LOG(INFO) << "Telling slave of lost executor "
-		  << info->executorId
-                  << " of framework " << info->frameworkId;
+  // Only whole CPUs get pinned.
+  double cpus = resources.get("cpus", Value::Scalar()).value();
+  size_t count = cpus >= 1 && cpus == (size_t) cpus ? (size_t) cpus : 0;
 
-        dispatch(slave, &Slave::executorExited,
-                 info->frameworkId, info->executorId, status);
+  if (count == info->cpus.size()) {
+    return false;
+  }
 
-        // Try and cleanup after the executor.
-        killExecutor(info->frameworkId, info->executorId);
-        return;
-      }
-    }
+  const set<int>& placed =
+    topology::place(nodes, freeCpus, info->cpus, count);
+
+  if (placed.size() < count) {
+    LOG(WARNING) << "Only " << placed.size() << " of the " << count
+                 << " CPUs for container " << info->container
+                 << " are free";
+  }
+
+  freeCpus.insert(info->cpus.begin(), info->cpus.end());
+  foreach (int cpu, placed) {
+    freeCpus.erase(cpu);
   }
+
+  info->cpus = placed;
+
+  return true;
 }
 
 
-bool LxcIsolationModule::setControlGroupValue(
-    const string& container,
-    const string& property,
-    int64_t value)
+bool LxcIsolationModule::setCpuset(ContainerInfo* info)
 {
-  LOG(INFO) << "Setting " << property
-            << " for container " << container
-            << " to " << value;
+  set<int> cpus = info->cpus;
+  if (cpus.empty()) {
+    foreach (const topology::Node& node, nodes) {
+      cpus.insert(node.cpus.begin(), node.cpus.end());
+    }
+  }
 
-  Try<int> status =
-    utils::os::shell(NULL, "lxc-cgroup -n %s %s %lld",
-                     container.c_str(), property.c_str(), value);
+  const string& mems = topology::format(topology::mems(nodes, cpus));
 
-  if (status.isError()) {
-    LOG(ERROR) << "Failed to set " << property
-               << " for container " << container
-               << ": " << status.error();
+  LOG(INFO) << "Setting cpuset.cpus for container " << info->container
+            << " to " << topology::format(cpus);
+
+  Try<bool> result =
+    cgroups::write(info->container, "cpuset.cpus", topology::format(cpus));
+
+  if (result.isSome()) {
+    LOG(INFO) << "Setting cpuset.mems for container " << info->container
+              << " to " << mems;
+    result = cgroups::write(info->container, "cpuset.mems", mems);
+  }
+
+  if (result.isError()) {
+    LOG(ERROR) << "Failed to set the cpuset of container "
+               << info->container << ": " << result.error();
     return false;
-  } else if (status.get() != 0) {
-    LOG(ERROR) << "Failed to set " << property
-               << " for container " << container
-               << ": lxc-cgroup returned " << status.get();
+  }
+
+  return true;
+}
+
+
+bool LxcIsolationModule::setDiskIo(
+    ContainerInfo* info,
+    const Resources& resources)
+{
+  double io = resources.get("disk_io", Value::Scalar()).value();
+
+  if (!setControlGroupValue(info->container,
+                            "blkio.weight",
+                            blkioWeight(io, diskIo))) {
     return false;
   }
 
+  if (blkioDevice != "") {
+    int64_t bps = max((int64_t) io, MIN_DISK_IO_MB) * 1024LL * 1024LL;
+    const string& value = blkioDevice + " " + utils::stringify(bps);
+
+    LOG(INFO) << "Throttling the disk I/O of container " << info->container
+              << " to " << value;
+
+    Try<bool> result = cgroups::write(
+        info->container, "blkio.throttle.read_bps_device", value);
+
+    if (result.isSome()) {
+      result = cgroups::write(
+          info->container, "blkio.throttle.write_bps_device", value);
+    }
+
+    if (result.isError()) {
+      LOG(ERROR) << "Failed to throttle the disk I/O of container "
+                 << info->container << ": " << result.error();
+      return false;
+    }
+  }
+
   return true;
 }
 
 
-vector<string> LxcIsolationModule::getControlGroupOptions(
+bool LxcIsolationModule::setNetBw(
+    ContainerInfo* info,
     const Resources& resources)
 {
+  double bw = resources.get("net_bw", Value::Scalar()).value();
+  const string& rate = utils::stringify(max((int64_t) bw, MIN_NET_BW_MBIT));
+
+  LOG(INFO) << "Shaping the traffic of container " << info->container
+            << " on " << netInterface << " to " << rate << " Mbit/s";
+
+  Try<bool> result = tc("class replace dev " + netInterface +
+                        " parent 1: classid " + classId(info->classId) +
+                        " htb rate " + rate + "mbit ceil " + rate + "mbit");
+
+  if (result.isError()) {
+    LOG(ERROR) << "Failed to shape the traffic of container "
+               << info->container << ": " << result.error();
+    return false;
+  }
+
+  return true;
+}
+
+
+vector<string> LxcIsolationModule::getControlGroupOptions(
+    const Resources& resources,
+    const ContainerInfo& info)
+{
+  const set<int>& cpus = info.cpus;
+
   vector<string> options;
 
   std::ostringstream out;
@@ -393,5 +1246,56 @@ vector<string> LxcIsolationModule::getControlGroupOptions(
   out << "lxc.cgroup.memory.limit_in_bytes=" << limit_in_bytes;
   options.push_back(out.str());
 
+  if (!cpus.empty()) {
+    out.str("");
+
+    options.push_back("-s");
+    out << "lxc.cgroup.cpuset.cpus=" << topology::format(cpus);
+    options.push_back(out.str());
+
+    out.str("");
+
+    options.push_back("-s");
+    out << "lxc.cgroup.cpuset.mems="
+        << topology::format(topology::mems(nodes, cpus));
+    options.push_back(out.str());
+  }
+
+  if (diskIo > 0) {
+    double io = resources.get("disk_io", Value::Scalar()).value();
+
+    out.str("");
+
+    options.push_back("-s");
+    out << "lxc.cgroup.blkio.weight=" << blkioWeight(io, diskIo);
+    options.push_back(out.str());
+
+    if (blkioDevice != "") {
+      int64_t bps = max((int64_t) io, MIN_DISK_IO_MB) * 1024LL * 1024LL;
+
+      out.str("");
+
+      options.push_back("-s");
+      out << "lxc.cgroup.blkio.throttle.read_bps_device="
+          << blkioDevice << " " << bps;
+      options.push_back(out.str());
+
+      out.str("");
+
+      options.push_back("-s");
+      out << "lxc.cgroup.blkio.throttle.write_bps_device="
+          << blkioDevice << " " << bps;
+      options.push_back(out.str());
+    }
+  }
+
+  if (info.classId != 0) {
+    out.str("");
+
+    options.push_back("-s");
+    out << "lxc.cgroup.net_cls.classid=" << (NET_CLS_MAJOR | info.classId);
+    options.push_back(out.str());
+  }
+
   return options;
 }
@@ -19,15 +19,27 @@
 #ifndef __LXC_ISOLATION_MODULE_HPP__
 #define __LXC_ISOLATION_MODULE_HPP__
 
+#include <unistd.h>
+
+#include <deque>
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 
+#include <tr1/memory>
+
 #include "isolation_module.hpp"
+#include "launch_pool.hpp"
 #include "reaper.hpp"
 #include "slave.hpp"
+#include "topology.hpp"
+#include "usage.hpp"
 
 #include "common/hashmap.hpp"
 
+#include "launcher/launcher.hpp"
+
 
 namespace mesos { namespace internal { namespace slave {
 
@@ -69,7 +81,23 @@ private:
                             const std::string& property,
                             int64_t value);
 
-  std::vector<std::string> getControlGroupOptions(const Resources& resources);
+  // Samples the resources each container uses (from its cgroup) and
+  // sends them to the slave (and then schedules the next sample).
+  void sampleUsage();
+
+  // An eventfd registered for memory events of a container, read by
+  // a thread of its own (see watch) until it gets stopped.
+  struct MemoryListener
+  {
+    MemoryListener(int _fd, int64_t _limit)
+      : fd(_fd), limit(_limit), stopped(false) {}
+
+    ~MemoryListener() { close(fd); }
+
+    const int fd;
+    const int64_t limit; // Memory limit (bytes) when it was registered.
+    volatile bool stopped;
+  };
 
   // Per-framework information object maintained in info hashmap.
   struct ContainerInfo
@@ -78,15 +106,157 @@ private:
     ExecutorID executorId;
     std::string container; // Name of Linux container used for this framework.
     pid_t pid; // PID of lxc-execute command running the executor.
+    bool killed; // Whether it got killed while it was being launched.
+    UsageHistory usage; // Resources recently used by the container.
+    std::set<int> cpus; // CPUs the container has to itself (see cpusets).
+    uint16_t classId; // Minor of its traffic class (0 if not shaped).
+    int64_t memoryLimit; // Bytes, as last set.
+
+    // Notifications of the container's memory usage crossing the
+    // pressure threshold and of it running out of memory.
+    std::tr1::shared_ptr<MemoryListener> pressure;
+    std::tr1::shared_ptr<MemoryListener> oom;
   };
 
+  // A container started ahead of time (see "lxc_pool_size"), running
+  // a shell that waits to read the environment of the executor's
+  // launcher from a FIFO and then execs mesos-launcher. Launching an
+  // executor into it only takes setting its limits and writing out
+  // the environment, rather than creating a container.
+  struct WarmContainer
+  {
+    std::string container;
+    pid_t pid; // PID of its lxc-execute.
+    std::string fifo;
+  };
+
+  // Records the pid of the lxc-execute that a launch worker started
+  // for an executor and tells the slave, or destroys the container if
+  // the executor got killed while it was being launched.
+  void launched(ContainerInfo* info, pid_t pid);
+
+  // Adds a warm container that a launch worker started to the pool.
+  void warmed(WarmContainer warm, pid_t pid);
+
+  // Kills the container and releases its CPUs and traffic class.
+  void destroy(ContainerInfo* info);
+
+  // Registers for the container's memory notifications (once its
+  // cgroup exists), again for the pressure threshold whenever its
+  // memory limit has changed.
+  void listen(ContainerInfo* info);
+
+  // Reads a listener's eventfd (in its own thread) and dispatches each
+  // event to memoryEvent, until the listener gets stopped.
+  static void watch(const process::PID<LxcIsolationModule>& module,
+                    const std::tr1::shared_ptr<MemoryListener>& listener,
+                    const FrameworkID& frameworkId,
+                    const ExecutorID& executorId);
+
+  // Stops the listener's thread (which closes its eventfd).
+  static void stop(const std::tr1::shared_ptr<MemoryListener>& listener);
+
+  // Tells the slave when the executor's memory usage is above the
+  // threshold, or that it ran out of memory (in which case the
+  // container gets killed).
+  void memoryEvent(const FrameworkID& frameworkId,
+                   const ExecutorID& executorId,
+                   MemoryListener* listener);
+
+  launcher::ExecutorLauncher* createExecutorLauncher(
+      const ContainerInfo& info,
+      const FrameworkInfo& frameworkInfo,
+      const ExecutorInfo& executorInfo,
+      const std::string& directory);
+
+  // Starts warm containers until the pool is full.
+  void warmUp();
+
+  // Launches the executor in the warm container, returning false
+  // (after getting rid of the container) if it wasn't ready.
+  bool launchWarm(ContainerInfo* info,
+                  const WarmContainer& warm,
+                  const FrameworkInfo& frameworkInfo,
+                  const ExecutorInfo& executorInfo,
+                  const std::string& directory,
+                  const Resources& resources);
+
+  // Sets all of the container's limits for its resources.
+  bool setLimits(ContainerInfo* info, const Resources& resources);
+
+  std::vector<std::string> getControlGroupOptions(
+      const Resources& resources,
+      const ContainerInfo& info);
+
+  // Gives the container as many CPUs to itself as the whole number
+  // of "cpus" in its resources (none if it's a fraction), placed by
+  // topology::place. Returns whether its CPUs changed.
+  bool placeCpus(ContainerInfo* info, const Resources& resources);
+
+  // Pins the container to its CPUs (and the memory of their NUMA
+  // nodes), or unpins it if it has none.
+  bool setCpuset(ContainerInfo* info);
+
+  // Limits the container's disk I/O to its share of the slave's
+  // "disk_io" (see getControlGroupOptions).
+  bool setDiskIo(ContainerInfo* info, const Resources& resources);
+
+  // Shapes the container's egress traffic to its "net_bw" (in Mbit/s)
+  // with the container's class of the HTB qdisc on netInterface.
+  bool setNetBw(ContainerInfo* info, const Resources& resources);
+
   // TODO(benh): Make variables const by passing them via constructor.
   Configuration conf;
   bool local;
   process::PID<Slave> slave;
   bool initialized;
   Reaper* reaper;
-  hashmap<FrameworkID, hashmap<ExecutorID, ContainerInfo*> > infos;
+  LaunchPool* launchers;
+
+  typedef hashmap<ExecutorID, ContainerInfo*> ExecutorInfos;
+  hashmap<FrameworkID, ExecutorInfos> infos;
+
+  // The number of containers (for executors or the pool) that the
+  // launch workers haven't gotten back to us about, and the statuses
+  // of the processes that the reaper saw exit in the meantime but we
+  // didn't know the pids of yet.
+  int launching;
+  hashmap<pid_t, int> exited;
+
+  // With the "cpusets" option, executors that ask for whole CPUs get
+  // pinned to CPUs that no other pinned executor runs on, placed
+  // according to the machine's NUMA topology.
+  bool cpusets;
+  std::vector<topology::Node> nodes;
+  std::set<int> freeCpus;
+
+  // When the slave has "disk_io" (in MB/s) each container gets a
+  // blkio weight in proportion to its share of it, and with the
+  // "blkio_device" option (a "major:minor" device number) its reads
+  // and writes of that device get throttled to its disk_io as well.
+  double diskIo;
+  std::string blkioDevice;
+
+  // With the "net_interface" option, the traffic the containers send
+  // out the interface gets classified by their net_cls cgroup and
+  // shaped to their "net_bw".
+  std::string netInterface;
+  uint16_t nextClassId;
+
+  // With a "memory_pressure_threshold" (a fraction of the containers'
+  // memory limits) the slave gets told about containers that use more
+  // memory than it, and those that run out of memory get paused (and
+  // then killed, with their tasks failed for running out of memory)
+  // rather than OOM-killed.
+  double memoryThreshold;
+
+  // Warm containers (oldest first), with their FIFOs in poolDirectory,
+  // and the number still being started.
+  int poolSize;
+  std::string poolDirectory;
+  std::deque<WarmContainer> pool;
+  int warming;
+  int nextWarmId;
 };
 
 }}} // namespace mesos { namespace internal { namespace slave {
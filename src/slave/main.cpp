@@ -27,7 +27,6 @@
 
 #include "isolation_module_factory.hpp"
 #include "slave.hpp"
-#include "webui.hpp"
 
 using namespace mesos::internal;
 using namespace mesos::internal::slave;
@@ -47,6 +46,8 @@ void usage(const char *programName, const Configurator& configurator)
        << "  zoo://host1:port1,host2:port2,..." << endl
        << "  zoofile://file where file contains a host:port pair per line"
        << endl
+       << "  log://host1:port1,host2:port2,... (the masters)" << endl
+       << "  proxy://detector@host:port (see --detector_proxy)" << endl
        << endl
        << "Supported options:" << endl
        << configurator.getUsage();
@@ -64,9 +65,12 @@ int main(int argc, char** argv)
   configurator.addOption<string>("ip", "IP address to listen on");
   configurator.addOption<string>("master", 'm', "Master URL");
   configurator.addOption<string>("isolation", 'i', "Isolation module name", "process");
-#ifdef MESOS_WEBUI
-  configurator.addOption<int>("webui_port", 'w', "Web UI port", 8081);
-#endif
+  configurator.addOption<bool>("detector_proxy",
+                               "Detect the master on behalf of the other "
+                               "processes on this host too, which can then "
+                               "use the master URL "
+                               "proxy://detector@<slave ip>:<slave port>",
+                               false);
 
   if (argc == 2 && string("--help") == argv[1]) {
     usage(argv[0], configurator);
@@ -119,20 +123,26 @@ int main(int argc, char** argv)
   Slave* slave = new Slave(conf, false, isolationModule);
   process::spawn(slave);
 
+  // Detect the master either directly or (on behalf of the other
+  // processes on this host too) via a master detector proxy.
+  MasterDetectorProxy* proxy = NULL;
+  if (conf.get<bool>("detector_proxy", false)) {
+    proxy = new MasterDetectorProxy(master, Logging::isQuiet(conf));
+    master = "proxy://" + string(proxy->self());
+    LOG(INFO) << "Detecting the master for this host at " << master;
+  }
+
   MasterDetector* detector = MasterDetector::create(
       master,
       slave->self(),
       false,
       Logging::isQuiet(conf));
 
-#ifdef MESOS_WEBUI
-  webui::start(slave->self(), conf);
-#endif
-
   process::wait(slave->self());
   delete slave;
 
   MasterDetector::destroy(detector);
+  delete proxy;
   IsolationModule::destroy(isolationModule);
 
   return 0;
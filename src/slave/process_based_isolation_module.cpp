@@ -16,11 +16,19 @@
  * limitations under the License.
  */
 
+#include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
+#include <unistd.h>
 
 #include <map>
+#include <sstream>
+#include <vector>
 
+#include <process/clock.hpp>
 #include <process/dispatch.hpp>
+#include <process/metrics.hpp>
+#include <process/timer.hpp>
 
 #include "process_based_isolation_module.hpp"
 
@@ -29,6 +37,8 @@
 #include "common/utils.hpp"
 #include "common/process_utils.hpp"
 
+#include "slave/constants.hpp"
+
 using namespace mesos;
 using namespace mesos::internal;
 using namespace mesos::internal::slave;
@@ -37,14 +47,150 @@ using namespace process;
 
 using launcher::ExecutorLauncher;
 
+using std::istringstream;
 using std::map;
 using std::string;
+using std::vector;
 
 using process::wait; // Necessary on some OS's to disambiguate.
 
+// How long each step of launching an executor took (as reported by
+// the launchers, see ExecutorLauncher::run).
+static process::metrics::Timer workingDirectoryStage(
+    "mesos_slave_executor_launch_seconds",
+    "Time each step of launching an executor took, by step.",
+    process::metrics::label("stage", "working_directory"));
+
+static process::metrics::Timer fetchStage(
+    "mesos_slave_executor_launch_seconds",
+    "Time each step of launching an executor took, by step.",
+    process::metrics::label("stage", "fetch"));
+
+static process::metrics::Timer environmentStage(
+    "mesos_slave_executor_launch_seconds",
+    "Time each step of launching an executor took, by step.",
+    process::metrics::label("stage", "environment"));
+
+static process::metrics::Timer switchUserStage(
+    "mesos_slave_executor_launch_seconds",
+    "Time each step of launching an executor took, by step.",
+    process::metrics::label("stage", "switch_user"));
+
+static process::metrics::Timer totalStage(
+    "mesos_slave_executor_launch_seconds",
+    "Time each step of launching an executor took, by step.",
+    process::metrics::label("stage", "total"));
+
+// On Mac OS X, the environ symbol isn't visible to shared libraries,
+// so we must use the _NSGetEnviron() function (see man environ on OS X).
+#ifdef __APPLE__
+#include "crt_externs.h"
+namespace {
+char** getEnviron() { return *_NSGetEnviron(); }
+}
+#else
+extern char** environ;
+namespace {
+char** getEnviron() { return environ; }
+}
+#endif /* __APPLE__ */
+
+
+// Creates a pipe with both ends closed on exec, atomically where we
+// can (so that a launch worker forking in the meantime doesn't leak
+// either end into another executor).
+static int cloexecPipe(int fds[2])
+{
+#ifdef __linux__
+  return pipe2(fds, O_CLOEXEC);
+#else
+  if (pipe(fds) < 0) {
+    return -1;
+  }
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+  return 0;
+#endif
+}
+
+
+// Execs the program at the path in its own session (to make cleanup
+// easier) with the specified variables added to our environment.
+// Uses vfork, so the cost doesn't depend on the size of our address
+// space (everything the child needs gets prepared beforehand since it
+// borrows our memory until it execs). The file descriptor 'inherit'
+// (if not -1) is kept open across the exec.
+static pid_t spawn(const string& path,
+                   const map<string, string>& variables,
+                   int inherit)
+{
+  vector<string> environment;
+
+  for (char** entry = getEnviron(); *entry != NULL; entry++) {
+    const string& variable = *entry;
+    if (variables.count(variable.substr(0, variable.find('='))) == 0) {
+      environment.push_back(variable);
+    }
+  }
+
+  foreachpair (const string& key, const string& value, variables) {
+    environment.push_back(key + "=" + value);
+  }
+
+  vector<const char*> envp;
+  foreach (const string& variable, environment) {
+    envp.push_back(variable.c_str());
+  }
+  envp.push_back(NULL);
+
+  const char* argv[] = { path.c_str(), NULL };
+
+  pid_t pid = vfork();
+
+  if (pid == -1) {
+    PLOG(FATAL) << "Failed to vfork to launch new executor";
+  } else if (pid == 0) {
+    // In child process (only async-signal-safe calls until the exec).
+    setsid();
+    if (inherit != -1) {
+      fcntl(inherit, F_SETFD, 0);
+    }
+    execve(path.c_str(), (char* const*) argv, (char* const*) &envp[0]);
+    _exit(1);
+  }
+
+  return pid;
+}
+
+
+// Forks a child that runs the launcher in its own session (to make
+// cleanup easier), for when mesos-launcher isn't installed.
+static pid_t forkLauncher(ExecutorLauncher* launcher)
+{
+  pid_t pid;
+  if ((pid = fork()) == -1) {
+    PLOG(FATAL) << "Failed to fork to launch new executor";
+  }
+
+  if (pid == 0) {
+    // In child process.
+    if ((pid = setsid()) == -1) {
+      PLOG(FATAL) << "Failed to put executor in own session";
+    }
+
+    launcher->run();
+  }
+
+  delete launcher;
+
+  return pid;
+}
+
 
 ProcessBasedIsolationModule::ProcessBasedIsolationModule()
-  : initialized(false)
+  : initialized(false),
+    launchers(NULL),
+    launching(0)
 {
   // Spawn the reaper, note that it might send us a message before we
   // actually get spawned ourselves, but that's okay, the message will
@@ -57,6 +203,12 @@ ProcessBasedIsolationModule::ProcessBasedIsolationModule()
 
 ProcessBasedIsolationModule::~ProcessBasedIsolationModule()
 {
+  delete launchers;
+
+  foreachkey (int fd, progress) {
+    close(fd);
+  }
+
   CHECK(reaper != NULL);
   terminate(reaper);
   wait(reaper);
@@ -73,7 +225,12 @@ void ProcessBasedIsolationModule::initialize(
   local = _local;
   slave = _slave;
 
+  launchers =
+    new LaunchPool(conf.get<int>("launch_workers", LAUNCH_WORKERS));
+
   initialized = true;
+
+  sampleUsage();
 }
 
 
@@ -100,36 +257,104 @@ void ProcessBasedIsolationModule::launchExecutor(
   info->frameworkId = frameworkId;
   info->executorId = executorId;
   info->directory = directory;
-  info->pid = -1; // Initialize this variable to handle corner cases.
+  info->pid = -1; // Set once a launch worker has started the executor.
+  info->killed = false;
+  info->progress = -1;
 
   infos[frameworkId][executorId] = info;
 
-  pid_t pid;
-  if ((pid = fork()) == -1) {
-    PLOG(FATAL) << "Failed to fork to launch new executor";
+  ExecutorLauncher* launcher =
+    createExecutorLauncher(frameworkId, frameworkInfo,
+                           executorInfo, directory);
+
+  // Have the launcher report how long each step takes over a pipe
+  // (only its end gets inherited, and only by the launcher, see
+  // 'spawn').
+  int fds[2];
+  if (cloexecPipe(fds) < 0) {
+    PLOG(WARNING) << "Failed to create a pipe for the progress of launching "
+                  << executorId << " of framework " << frameworkId;
+  } else {
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    launcher->setProgressFd(fds[1]);
+    info->progress = fds[1];
+
+    if (progress.empty()) {
+      delay(LAUNCH_PROGRESS_INTERVAL_SECONDS,
+            PID<ProcessBasedIsolationModule>(this),
+            &ProcessBasedIsolationModule::readProgress);
+    }
+
+    progress[fds[0]].frameworkId = frameworkId;
+    progress[fds[0]].executorId = executorId;
+  }
+
+  // Exec mesos-launcher rather than forking the slave (whose address
+  // space only grows as it runs) if it's been installed. Either way a
+  // launch worker does the forking so that we can keep launching (and
+  // killing) executors in the meantime.
+  const string& path =
+    conf.get("launcher_dir", MESOS_LIBEXECDIR) + "/mesos-launcher";
+
+  lambda::function<pid_t(void)> launch;
+
+  if (access(path.c_str(), X_OK) == 0) {
+    pid_t (*exec)(const string&, const map<string, string>&, int) = &spawn;
+    launch = lambda::bind(exec, path, launcher->getLauncherEnvironment(),
+                          info->progress);
+    delete launcher;
+  } else {
+    launch = lambda::bind(&forkLauncher, launcher);
+  }
+
+  launching++;
+
+  launchers->launch(monitored(launch, reaper),
+                    PID<ProcessBasedIsolationModule>(this),
+                    &ProcessBasedIsolationModule::launched,
+                    info);
+}
+
+
+void ProcessBasedIsolationModule::launched(ProcessInfo* info, pid_t pid)
+{
+  launching--;
+
+  // Only the launcher should be left writing its progress.
+  if (info->progress != -1) {
+    close(info->progress);
+    info->progress = -1;
   }
 
-  if (pid) {
-    // In parent process.
-    LOG(INFO) << "Forked executor at " << pid;
+  if (info->killed) {
+    LOG(INFO) << "Killing executor " << info->executorId
+              << " of framework " << info->frameworkId
+              << " (at " << pid << ") since it got killed while launching";
+
+    utils::process::killtree(pid, SIGKILL, true, true);
+
+    delete info;
+  } else {
+    LOG(INFO) << "Started executor " << info->executorId
+              << " of framework " << info->frameworkId << " at " << pid;
 
-    // Record the pid (should also be the pgis since we setsid below).
-    infos[frameworkId][executorId]->pid = pid;
+    // Record the pid (should also be the pgid since it runs setsid).
+    info->pid = pid;
 
     // Tell the slave this executor has started.
     dispatch(slave, &Slave::executorStarted,
-             frameworkId, executorId, pid);
-  } else {
-    // In child process, make cleanup easier.
-    if ((pid = setsid()) == -1) {
-      PLOG(FATAL) << "Failed to put executor in own session";
-    }
+             info->frameworkId, info->executorId, pid);
 
-    ExecutorLauncher* launcher =
-      createExecutorLauncher(frameworkId, frameworkInfo,
-                             executorInfo, directory);
+    // The executor might have exited before we found out its pid.
+    if (exited.contains(pid)) {
+      const int status = exited[pid];
+      exited.erase(pid);
+      processExited(pid, status);
+    }
+  }
 
-    launcher->run();
+  if (launching == 0) {
+    exited.clear();
   }
 }
 
@@ -139,31 +364,54 @@ void ProcessBasedIsolationModule::launchExecutor(
 void ProcessBasedIsolationModule::killExecutor(
     const FrameworkID& frameworkId,
     const ExecutorID& executorId)
+{
+  killExecutors(frameworkId, vector<ExecutorID>(1, executorId));
+}
+
+
+void ProcessBasedIsolationModule::killExecutors(
+    const FrameworkID& frameworkId,
+    const vector<ExecutorID>& executorIds)
 {
   CHECK(initialized) << "Cannot kill executors before initialization!";
-  if (!infos.contains(frameworkId) ||
-      !infos[frameworkId].contains(executorId)) {
-    LOG(ERROR) << "ERROR! Asked to kill an unknown executor! " << executorId;
-    return;
-  }
 
-  pid_t pid = infos[frameworkId][executorId]->pid;
+  vector<pid_t> pids;
+  vector<ProcessInfo*> killed;
 
-  if (pid != -1) {
-    // TODO(vinod): Call killtree on the pid of the actual executor process
-    // that is running the tasks (stored in the local storage by the
-    // executor module).
-    utils::process::killtree(pid, SIGKILL, true, true);
+  foreach (const ExecutorID& executorId, executorIds) {
+    if (!infos.contains(frameworkId) ||
+        !infos[frameworkId].contains(executorId)) {
+      LOG(ERROR) << "ERROR! Asked to kill an unknown executor! " << executorId;
+      continue;
+    }
 
     ProcessInfo* info = infos[frameworkId][executorId];
 
-    if (infos[frameworkId].size() == 1) {
-      infos.erase(frameworkId);
+    if (info->pid != -1) {
+      pids.push_back(info->pid);
+      killed.push_back(info);
     } else {
+      // Still being launched, it gets killed (and its info deleted)
+      // once it's started (see launched).
+      info->killed = true;
       infos[frameworkId].erase(executorId);
     }
+  }
 
-    delete info;
+  if (!pids.empty()) {
+    // TODO(vinod): Call killtree on the pid of the actual executor
+    // process that is running the tasks (stored in the local storage
+    // by the executor module).
+    utils::process::killtrees(pids, SIGKILL, true, true);
+
+    foreach (ProcessInfo* info, killed) {
+      infos[frameworkId].erase(info->executorId);
+      delete info;
+    }
+  }
+
+  if (infos.contains(frameworkId) && infos[frameworkId].size() == 0) {
+    infos.erase(frameworkId);
   }
 }
 
@@ -201,6 +449,9 @@ ExecutorLauncher* ProcessBasedIsolationModule::createExecutorLauncher(
                               conf.get("frameworks_home", ""),
                               conf.get("home", ""),
                               conf.get("hadoop_home", ""),
+                              conf.get("executor_cache_dir", ""),
+                              conf.get<int>("executor_cache_size",
+                                            EXECUTOR_CACHE_SIZE_MEGABYTES),
                               !local,
                               conf.get("switch_user", true),
                               "",
@@ -208,6 +459,105 @@ ExecutorLauncher* ProcessBasedIsolationModule::createExecutorLauncher(
 }
 
 
+void ProcessBasedIsolationModule::readProgress()
+{
+  vector<int> finished;
+
+  foreachpair (int fd, LaunchProgress& launch, progress) {
+    char data[1024];
+    ssize_t length;
+    while ((length = read(fd, data, sizeof(data))) > 0) {
+      launch.buffer.append(data, length);
+    }
+
+    size_t newline;
+    while ((newline = launch.buffer.find('\n')) != string::npos) {
+      istringstream line(launch.buffer.substr(0, newline));
+      launch.buffer.erase(0, newline + 1);
+
+      string stage;
+      double secs;
+      if (!(line >> stage >> secs)) {
+        LOG(WARNING) << "Ignoring malformed progress from the launcher of "
+                     << launch.executorId;
+        continue;
+      }
+
+      VLOG(1) << "Launching executor " << launch.executorId
+              << " of framework " << launch.frameworkId
+              << ": " << stage << " took " << secs << " seconds";
+
+      if (stage == "working_directory") {
+        workingDirectoryStage.record(secs);
+      } else if (stage == "fetch") {
+        fetchStage.record(secs);
+      } else if (stage == "environment") {
+        environmentStage.record(secs);
+      } else if (stage == "switch_user") {
+        switchUserStage.record(secs);
+      } else if (stage == "total") {
+        totalStage.record(secs);
+      }
+    }
+
+    // The launcher is done (it exec'ed the executor or failed) once
+    // its end of the pipe is closed.
+    if (length == 0 || (errno != EAGAIN && errno != EINTR)) {
+      finished.push_back(fd);
+    }
+  }
+
+  foreach (int fd, finished) {
+    close(fd);
+    progress.erase(fd);
+  }
+
+  if (!progress.empty()) {
+    delay(LAUNCH_PROGRESS_INTERVAL_SECONDS,
+          PID<ProcessBasedIsolationModule>(this),
+          &ProcessBasedIsolationModule::readProgress);
+  }
+}
+
+
+void ProcessBasedIsolationModule::sampleUsage()
+{
+  double interval = conf.get<double>("usage_sample_interval_seconds",
+                                     USAGE_SAMPLE_INTERVAL_SECONDS);
+  if (interval <= 0) {
+    return; // Sampling is disabled.
+  }
+
+  if (!infos.empty()) {
+    // Executors run in their own session, so sampling all the
+    // sessions at once covers the processes they forked as well.
+    const map<pid_t, UsageSample>& samples = sessions(Clock::now());
+
+    vector<ExecutorUsage> usages;
+
+    foreachkey (const FrameworkID& frameworkId, infos) {
+      foreachvalue (ProcessInfo* info, infos[frameworkId]) {
+        if (info->pid != -1 && samples.count(info->pid) > 0) {
+          info->usage.add(samples.find(info->pid)->second);
+
+          ExecutorUsage usage;
+          usage.mutable_framework_id()->MergeFrom(info->frameworkId);
+          usage.mutable_executor_id()->MergeFrom(info->executorId);
+          usage.set_cpus(info->usage.cpus());
+          usage.set_mem(info->usage.mem());
+          usages.push_back(usage);
+        }
+      }
+    }
+
+    dispatch(slave, &Slave::executorUsage, usages);
+  }
+
+  delay(interval, PID<ProcessBasedIsolationModule>(this),
+        &ProcessBasedIsolationModule::sampleUsage);
+}
+
+
 void ProcessBasedIsolationModule::processExited(pid_t pid, int status)
 {
   foreachkey (const FrameworkID& frameworkId, infos) {
@@ -226,4 +576,8 @@ void ProcessBasedIsolationModule::processExited(pid_t pid, int status)
       }
     }
   }
+
+  if (launching > 0) {
+    exited[pid] = status;
+  }
 }
@@ -20,12 +20,15 @@
 #define __PROCESS_BASED_ISOLATION_MODULE_HPP__
 
 #include <string>
+#include <vector>
 
 #include <sys/types.h>
 
 #include "isolation_module.hpp"
+#include "launch_pool.hpp"
 #include "reaper.hpp"
 #include "slave.hpp"
+#include "usage.hpp"
 
 #include "common/hashmap.hpp"
 
@@ -55,6 +58,10 @@ public:
   virtual void killExecutor(const FrameworkID& frameworkId,
                             const ExecutorID& executorId);
 
+  // Kills the executors' process trees all in one pass.
+  virtual void killExecutors(const FrameworkID& frameworkId,
+                             const std::vector<ExecutorID>& executorIds);
+
   virtual void resourcesChanged(const FrameworkID& frameworkId,
                                 const ExecutorID& executorId,
                                 const Resources& resources);
@@ -80,12 +87,41 @@ private:
   ProcessBasedIsolationModule(const ProcessBasedIsolationModule&);
   ProcessBasedIsolationModule& operator = (const ProcessBasedIsolationModule&);
 
+  struct ProcessInfo;
+
+  // Records the pid of an executor that a launch worker started and
+  // tells the slave, or kills it if the executor got killed while it
+  // was being launched.
+  void launched(ProcessInfo* info, pid_t pid);
+
+  // Reads what the launchers reported about how long each step of
+  // launching their executor took (see ExecutorLauncher::run) and
+  // records it (and then schedules the next read, while there are
+  // launchers that haven't finished).
+  void readProgress();
+
+  // Samples the resources each executor uses and sends them to the
+  // slave (and then schedules the next sample).
+  void sampleUsage();
+
   struct ProcessInfo
   {
     FrameworkID frameworkId;
     ExecutorID executorId;
     pid_t pid; // PID of the forked executor process.
+    bool killed; // Whether it got killed while it was being launched.
     std::string directory; // Working directory of the executor.
+    UsageHistory usage; // Resources recently used by the executor.
+    int progress; // Launcher's end of the progress pipe (until launched).
+  };
+
+  // A launcher that is reporting its progress (by the slave's end of
+  // the pipe it reports over).
+  struct LaunchProgress
+  {
+    FrameworkID frameworkId;
+    ExecutorID executorId;
+    std::string buffer; // Read but not yet complete line.
   };
 
   // TODO(benh): Make variables const by passing them via constructor.
@@ -94,7 +130,17 @@ private:
   process::PID<Slave> slave;
   bool initialized;
   Reaper* reaper;
+  LaunchPool* launchers;
   hashmap<FrameworkID, hashmap<ExecutorID, ProcessInfo*> > infos;
+
+  // The number of launches that the launch workers haven't gotten
+  // back to us about, and the statuses of the processes that the
+  // reaper saw exit in the meantime but we didn't know the pids of
+  // yet (since the reaper doesn't wait for the launches).
+  int launching;
+  hashmap<pid_t, int> exited;
+
+  hashmap<int, LaunchProgress> progress;
 };
 
 }}}
@@ -16,18 +16,29 @@
  * limitations under the License.
  */
 
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#include <glog/logging.h>
+
 #include <process/dispatch.hpp>
-#include <process/timer.hpp>
+#include <process/future.hpp>
 
 #include "reaper.hpp"
 
 #include "common/foreach.hpp"
+#include "common/thread.hpp"
+
+#include "slave/constants.hpp"
 
 using namespace process;
 
+using std::tr1::shared_ptr;
+
 
 namespace mesos {
 namespace internal {
@@ -46,24 +57,94 @@ void Reaper::addProcessExitedListener(
 }
 
 
+void Reaper::monitor(pid_t pid)
+{
+  if (pids.insert(pid).second) {
+    if (!thread::start(lambda::bind(&Reaper::watch, self(), watcher, pid),
+                       true)) {
+      LOG(FATAL) << "Failed to start the thread watching for " << pid;
+    }
+  }
+}
+
+
 void Reaper::initialize()
 {
-  delay(1.0, self(), &Reaper::reap);
+  watcher.reset(new Watcher());
+}
+
+
+void Reaper::finalize()
+{
+  watcher->stopped = true;
 }
 
 
-void Reaper::reap()
+int Reaper::reap()
 {
-  // Check whether any child process has exited.
-  pid_t pid;
-  int status;
-  if ((pid = waitpid((pid_t) -1, &status, WNOHANG)) > 0) {
-    foreach (const PID<ProcessExitedListener>& listener, listeners) {
-      dispatch(listener, &ProcessExitedListener::processExited, pid, status);
+  // Reap every monitored child that has exited.
+  int reaped = 0;
+
+  foreach (pid_t pid, std::set<pid_t>(pids)) {
+    int status;
+    const pid_t result = waitpid(pid, &status, WNOHANG);
+    if (result > 0) {
+      foreach (const PID<ProcessExitedListener>& listener, listeners) {
+        dispatch(listener, &ProcessExitedListener::processExited, pid, status);
+      }
+      pids.erase(pid);
+      reaped++;
+    } else if (result == -1 && errno == ECHILD) {
+      LOG(WARNING) << "Stopped monitoring " << pid
+                   << " since it has already been reaped (or isn't a child)";
+      pids.erase(pid);
     }
   }
 
-  delay(1.0, self(), &Reaper::reap); // Reap forever!
+  return reaped;
+}
+
+
+void Reaper::watch(const PID<Reaper>& reaper,
+                   const shared_ptr<Watcher>& watcher,
+                   pid_t pid)
+{
+  // Wait for the child to exit but leave it to the reaper to reap it
+  // (so that it gets reaped in the reaper's process).
+  siginfo_t info;
+  memset(&info, 0, sizeof(info));
+  while (waitid(P_PID, pid, &info, WEXITED | WNOWAIT) == -1) {
+    if (errno != EINTR) {
+      if (errno != ECHILD) {
+        PLOG(ERROR) << "Failed to wait for " << pid << " to exit";
+      }
+      break; // Let the reaper find out what happened.
+    }
+  }
+
+  if (!watcher->stopped) {
+    // Bounded in case the reaper is gone (or going).
+    dispatch(reaper, &Reaper::reap).await(REAP_TIMEOUT_SECONDS);
+  }
+}
+
+
+static pid_t launchAndMonitor(const lambda::function<pid_t(void)>& launch,
+                              const PID<Reaper>& reaper)
+{
+  const pid_t pid = launch();
+  if (pid > 0) {
+    dispatch(reaper, &Reaper::monitor, pid);
+  }
+  return pid;
+}
+
+
+lambda::function<pid_t(void)> monitored(
+    const lambda::function<pid_t(void)>& launch,
+    const PID<Reaper>& reaper)
+{
+  return lambda::bind(&launchAndMonitor, launch, reaper);
 }
 
 } // namespace slave {
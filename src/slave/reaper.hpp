@@ -19,10 +19,16 @@
 #ifndef __REAPER_HPP__
 #define __REAPER_HPP__
 
+#include <sys/types.h>
+
 #include <set>
 
+#include <tr1/memory>
+
 #include <process/process.hpp>
 
+#include "common/lambda.hpp"
+
 
 namespace mesos {
 namespace internal {
@@ -43,16 +49,51 @@ public:
 
   void addProcessExitedListener(const process::PID<ProcessExitedListener>&);
 
+  // Starts watching for the specified child to exit. The reaper only
+  // ever waits for the children it was told about, so that it doesn't
+  // reap anybody else's (e.g., those of popen, whose pclose would then
+  // fail).
+  void monitor(pid_t pid);
+
 protected:
   virtual void initialize();
+  virtual void finalize();
 
-  void reap();
+  // Reaps the monitored children that have exited (returns how many).
+  int reap();
 
 private:
+  // State shared with the threads watching for exited children, which
+  // might outlive the reaper.
+  struct Watcher
+  {
+    Watcher() : stopped(false) {}
+    volatile bool stopped;
+  };
+
+  // Blocks (in its own thread) until the child exits and then has the
+  // reaper reap it.
+  static void watch(const process::PID<Reaper>& reaper,
+                    const std::tr1::shared_ptr<Watcher>& watcher,
+                    pid_t pid);
+
   std::set<process::PID<ProcessExitedListener> > listeners;
+
+  std::set<pid_t> pids; // Monitored children that haven't been reaped.
+
+  std::tr1::shared_ptr<Watcher> watcher;
 };
 
 
+// Returns a launch (see LaunchPool) that has the reaper monitor the
+// process that 'launch' starts right away (from the launch worker),
+// so that it gets reaped even if it exits (or gets killed) before
+// the isolation module hears about its pid.
+lambda::function<pid_t(void)> monitored(
+    const lambda::function<pid_t(void)>& launch,
+    const process::PID<Reaper>& reaper);
+
+
 } // namespace slave {
 } // namespace internal {
 } // namespace mesos {
@@ -17,22 +17,37 @@
  */
 
 #include <errno.h>
+#include <stdio.h>
 
 #include <algorithm>
+#include <fstream>
 #include <iomanip>
+#include <sstream>
+
+#include <tr1/functional>
 
 #include <process/timer.hpp>
 
 #include "common/build.hpp"
+#include "common/logging.hpp"
+#include "common/memory.hpp"
 #include "common/option.hpp"
+#include "common/profiler.hpp"
+#include "common/strings.hpp"
+#include "common/tracer.hpp"
 #include "common/type_utils.hpp"
 #include "common/utils.hpp"
+#include "common/webui.hpp"
 
 #include "slave/slave.hpp"
+#include "slave/usage.hpp"
 
 namespace params = std::tr1::placeholders;
 
+using std::make_pair;
+using std::pair;
 using std::string;
+using std::vector;
 
 using process::wait; // Necessary on some OS's to disambiguate.
 
@@ -42,32 +57,6 @@ using std::tr1::bind;
 
 namespace mesos { namespace internal { namespace slave {
 
-// // Represents a pending status update that has been sent and we are
-// // waiting for an acknowledgement. In pa
-
-// // stream of status updates for a framework/task. Note
-// // that these are stored in the slave rather than per Framework
-// // because a framework might go away before all of the status
-// // updates have been sent and acknowledged.
-// struct Slave::StatusUpdateStream
-// {
-//   StatusUpdateStreamID streamId;
-//   string directory;
-//   FILE* updates;
-//   FILE* acknowledged;
-//   queue<StatusUpdate> pending;
-//   double timeout;
-// };
-
-
-//   StatusUpdateStreamID id;
-
-
-
-//   queue<StatusUpdate> pending;
-//   double timeout;
-// };
-
 
 Slave::Slave(const Resources& _resources,
              bool _local,
@@ -75,7 +64,10 @@ Slave::Slave(const Resources& _resources,
   : ProcessBase("slave"),
     resources(_resources),
     local(_local),
-    isolationModule(_isolationModule)
+    isolationModule(_isolationModule),
+    stats("slave"),
+    registrationBackoff(REGISTRATION_RETRY_INTERVAL_SECONDS,
+                        REGISTRATION_RETRY_INTERVAL_MAX_SECONDS)
 {}
 
 
@@ -85,13 +77,59 @@ Slave::Slave(const Configuration& _conf,
   : ProcessBase("slave"),
     conf(_conf),
     local(_local),
-    isolationModule(_isolationModule)
+    isolationModule(_isolationModule),
+    stats("slave"),
+    registrationBackoff(REGISTRATION_RETRY_INTERVAL_SECONDS,
+                        REGISTRATION_RETRY_INTERVAL_MAX_SECONDS)
 {
   resources =
     Resources::parse(conf.get<string>("resources", "cpus:1;mem:1024"));
 
+  // Unless it's configured, the network bandwidth is the link speed
+  // (in Mbit/s) of the interface the executors' traffic gets shaped on.
+  const string& interface = conf.get<string>("net_interface", "");
+
+  if (interface != "" &&
+      resources.get("net_bw", Value::Scalar()).value() == 0) {
+    const string& path = "/sys/class/net/" + interface + "/speed";
+
+    std::ifstream file(path.c_str());
+    int speed = -1;
+
+    if (!(file >> speed) || speed <= 0) {
+      LOG(WARNING) << "Failed to determine the link speed of "
+                   << interface << " from " << path
+                   << ", not offering any network bandwidth";
+    } else {
+      resources += Resources::parse("net_bw", utils::stringify(speed));
+    }
+  }
+
   attributes =
     Attributes::parse(conf.get<string>("attributes", ""));
+
+  // Reservations look like "role=resources|role=resources|...".
+  const vector<string>& tokens =
+    strings::split(conf.get<string>("reservations", ""), "|");
+
+  foreach (const string& token, tokens) {
+    size_t index = token.find('=');
+    if (index == string::npos) {
+      LOG(FATAL) << "Bad value for reservations, missing '=' within "
+                 << token;
+    }
+
+    Resources reserved = Resources::parse(token.substr(index + 1));
+    if (!(reserved <= resources)) {
+      LOG(FATAL) << "Bad value for reservations, " << reserved
+                 << " is more than the slave's resources";
+    }
+
+    Reservation reservation;
+    reservation.set_role(token.substr(0, index));
+    reservation.mutable_resources()->MergeFrom(reserved);
+    reservations.push_back(reservation);
+  }
 }
 
 
@@ -115,6 +153,12 @@ void Slave::registerOptions(Configurator* configurator)
       "attributes",
       "Attributes of machine\n");
 
+  configurator->addOption<string>(
+      "reservations",
+      "Resources reserved for the frameworks with some roles\n"
+      "(i.e., groups or names), offered to them first, e.g.,\n"
+      "\"services=cpus:2;mem:1024|web=cpus:1;mem:512\"");
+
   configurator->addOption<string>(
       "work_dir",
       "Where to place framework work directories\n"
@@ -139,10 +183,104 @@ void Slave::registerOptions(Configurator* configurator)
       "Directory prepended to relative executor\n"
       "paths (default: MESOS_HOME/frameworks)");
 
+  configurator->addOption<string>(
+      "launcher_dir",
+      "Where to find the mesos-launcher program\n"
+      "used to launch executors (default: the\n"
+      "installation's libexec directory)");
+
+  configurator->addOption<int>(
+      "launch_workers",
+      "Number of executors that can be getting\n"
+      "launched (i.e., forked) at once\n",
+      LAUNCH_WORKERS);
+
+  configurator->addOption<double>(
+      "usage_sample_interval_seconds",
+      "Amount of time (in seconds) between samples of the\n"
+      "resources executors use (0 disables sampling)\n",
+      USAGE_SAMPLE_INTERVAL_SECONDS);
+
+  configurator->addOption<string>(
+      "executor_cache_dir",
+      "Where to cache executors fetched from HDFS\n"
+      "and extracted from .tgz files so they can be\n"
+      "reused by later launches (default: no cache)");
+
+  configurator->addOption<int>(
+      "executor_cache_size",
+      "Most space (in MB) the executor cache may\n"
+      "take up before entries are evicted\n",
+      EXECUTOR_CACHE_SIZE_MEGABYTES);
+
+  configurator->addOption<double>(
+      "gc_delay_seconds",
+      "Amount of time (in seconds) to keep the work\n"
+      "directories of executors that are done around\n"
+      "before deleting them\n",
+      GC_DELAY_SECONDS);
+
+  configurator->addOption<double>(
+      "gc_disk_watermark",
+      "How full (as a fraction) the disk with the work\n"
+      "directories may get before they are deleted\n"
+      "sooner (oldest first)\n",
+      GC_DISK_WATERMARK);
+
+  configurator->addOption<double>(
+      "gc_rate",
+      "Most executor work directories to delete per second\n",
+      GC_RATE);
+
   configurator->addOption<double>(
       "executor_shutdown_timeout_seconds",
       "Amount of time (in seconds) to wait for an executor to shut down\n",
       EXECUTOR_SHUTDOWN_TIMEOUT_SECONDS);
+
+  configurator->addOption<bool>(
+      "cpusets",
+      "Whether to pin executors that ask for whole CPUs\n"
+      "to CPUs of their own, on as few NUMA nodes as\n"
+      "possible (LXC isolation only)",
+      false);
+
+  configurator->addOption<double>(
+      "memory_pressure_threshold",
+      "Fraction of an executor's memory that it can\n"
+      "use before its tasks get told about it; those\n"
+      "that run out get more of the slave's unused\n"
+      "memory or get killed, rather than OOM-killed\n"
+      "(0 disables, LXC isolation only)",
+      MEMORY_PRESSURE_THRESHOLD);
+
+  configurator->addOption<int>(
+      "lxc_pool_size",
+      "Number of containers to start ahead of time so\n"
+      "that executors can be launched into them without\n"
+      "waiting for a container to be created (LXC\n"
+      "isolation only)",
+      0);
+
+  configurator->addOption<string>(
+      "net_interface",
+      "Network interface whose link speed is offered\n"
+      "as the \"net_bw\" resource (in Mbit/s, unless it's\n"
+      "in the resources) and which the executors' traffic\n"
+      "gets shaped on (LXC isolation only)");
+
+  configurator->addOption<string>(
+      "blkio_device",
+      "Device number (\"major:minor\") of the disk whose\n"
+      "reads and writes get throttled to the executors'\n"
+      "\"disk_io\" resource (in MB/s); without it disk_io\n"
+      "only sets their share of the disks (LXC isolation only)");
+
+  configurator->addOption<bool>(
+      "checkpoint",
+      "Whether to checkpoint the slave's state (in the work\n"
+      "directory) so that the executors keep running while\n"
+      "the slave restarts (e.g., to be upgraded)",
+      false);
 }
 
 
@@ -151,6 +289,9 @@ void Slave::initialize()
   LOG(INFO) << "Slave started at " << self();
   LOG(INFO) << "Slave resources: " << resources;
 
+  // Export the statistics of malloc (see memory.hpp).
+  memory::initialize();
+
   Result<string> result = utils::os::hostname();
 
   if (result.isError()) {
@@ -173,9 +314,17 @@ void Slave::initialize()
   // Initialize slave info.
   info.set_hostname(hostname);
   info.set_webui_hostname(webui_hostname);
-  info.set_webui_port(conf.get<int>("webui_port", 8081));
+  info.set_webui_port(self().port); // The webui is served by the slave.
   info.mutable_resources()->MergeFrom(resources);
   info.mutable_attributes()->MergeFrom(attributes);
+  foreach (const Reservation& reservation, reservations) {
+    info.add_reservations()->MergeFrom(reservation);
+  }
+
+  checkpointing = conf.get<bool>("checkpoint", false);
+  checkpointPending = false;
+
+  info.set_checkpoint(checkpointing);
 
   // Spawn and initialize the isolation module.
   // TODO(benh): Seems like the isolation module should really be
@@ -185,24 +334,29 @@ void Slave::initialize()
            &IsolationModule::initialize,
            conf, local, self());
 
-  // Start all the statistics at 0.
-  CHECK(TASK_STARTING == TaskState_MIN);
-  CHECK(TASK_LOST == TaskState_MAX);
-  stats.tasks[TASK_STARTING] = 0;
-  stats.tasks[TASK_RUNNING] = 0;
-  stats.tasks[TASK_FINISHED] = 0;
-  stats.tasks[TASK_FAILED] = 0;
-  stats.tasks[TASK_KILLED] = 0;
-  stats.tasks[TASK_LOST] = 0;
-  stats.validStatusUpdates = 0;
-  stats.invalidStatusUpdates = 0;
-  stats.validFrameworkMessages = 0;
-  stats.invalidFrameworkMessages = 0;
+  // Spawn the garbage collector for the executors' work directories.
+  const string& directory = getWorkDirectory();
+  if (!utils::os::mkdir(directory)) {
+    LOG(FATAL) << "Failed to create the work directory " << directory;
+  }
+
+  gc = new GarbageCollector(
+      directory,
+      conf.get<double>("gc_delay_seconds", GC_DELAY_SECONDS),
+      conf.get<double>("gc_disk_watermark", GC_DISK_WATERMARK),
+      conf.get<double>("gc_rate", GC_RATE));
+  spawn(gc);
 
   startTime = Clock::now();
 
   connected = false;
 
+  nextSequence = 0;
+
+  if (checkpointing) {
+    recover();
+  }
+
   // Install protobuf handlers.
   install<NewMasterDetectedMessage>(
       &Slave::newMasterDetected,
@@ -213,18 +367,27 @@ void Slave::initialize()
 
   install<SlaveRegisteredMessage>(
       &Slave::registered,
-      &SlaveRegisteredMessage::slave_id);
+      &SlaveRegisteredMessage::slave_id,
+      &SlaveRegisteredMessage::shard);
 
   install<SlaveReregisteredMessage>(
       &Slave::reregistered,
-      &SlaveReregisteredMessage::slave_id);
+      &SlaveReregisteredMessage::slave_id,
+      &SlaveReregisteredMessage::shard);
+
+  install<RequestSlaveStateMessage>(
+      &Slave::stateRequested,
+      &RequestSlaveStateMessage::slave_id);
 
   install<RunTaskMessage>(
       &Slave::runTask,
       &RunTaskMessage::framework,
       &RunTaskMessage::framework_id,
       &RunTaskMessage::pid,
-      &RunTaskMessage::task);
+      &RunTaskMessage::task,
+      &RunTaskMessage::revocable);
+
+  install<RunTasksMessage>(&Slave::runTasks);
 
   install<KillTaskMessage>(
       &Slave::killTask,
@@ -254,15 +417,31 @@ void Slave::initialize()
       &StatusUpdateAcknowledgementMessage::task_id,
       &StatusUpdateAcknowledgementMessage::uuid);
 
+  install<StatusUpdateAcknowledgementsMessage>(
+      &Slave::statusUpdateAcknowledgements);
+
   install<RegisterExecutorMessage>(
       &Slave::registerExecutor,
       &RegisterExecutorMessage::framework_id,
-      &RegisterExecutorMessage::executor_id);
+      &RegisterExecutorMessage::executor_id,
+      &RegisterExecutorMessage::direct,
+      &RegisterExecutorMessage::batches);
+
+  install<ReregisterExecutorMessage>(
+      &Slave::reregisterExecutor,
+      &ReregisterExecutorMessage::framework_id,
+      &ReregisterExecutorMessage::executor_id,
+      &ReregisterExecutorMessage::direct,
+      &ReregisterExecutorMessage::batches);
 
   install<StatusUpdateMessage>(
       &Slave::statusUpdate,
       &StatusUpdateMessage::update);
 
+  install<StatusUpdatesMessage>(
+      &Slave::statusUpdates,
+      &StatusUpdatesMessage::updates);
+
   install<ExecutorToFrameworkMessage>(
       &Slave::executorMessage,
       &ExecutorToFrameworkMessage::slave_id,
@@ -279,7 +458,29 @@ void Slave::initialize()
   // Setup some HTTP routes.
   route("vars", bind(&http::vars, cref(*this), params::_1));
   route("stats.json", bind(&http::json::stats, cref(*this), params::_1));
+  route("stats/handlers",
+        bind(&http::json::handlers, cref(*this), params::_1));
   route("state.json", bind(&http::json::state, cref(*this), params::_1));
+
+  // Serve the webui (whose page renders the endpoints above in the
+  // browser) and the tails of the logs.
+  const hashmap<string, HttpResponse>& files = webui::load(conf, "slave");
+  foreachpair (const string& name, const HttpResponse& response, files) {
+    route(name, bind(&webui::serve, response, params::_1));
+  }
+
+  route("log", bind(&webui::log, Logging::getLogDir(conf),
+                    string("mesos-slave"), params::_1));
+  route("executor_log", bind(&http::log, cref(*this), params::_1));
+  route("executor_file", bind(&http::file, cref(*this), params::_1));
+
+  // Profile in place (see profiler.hpp).
+  route("profiler/start", &profiler::start);
+  route("profiler/stop", &profiler::stop);
+  route("heap/snapshot", &profiler::heap);
+
+  // Spans of the task launches traced (see tracer.hpp).
+  route("trace", &tracer::serve);
 }
 
 
@@ -287,6 +488,9 @@ void Slave::finalize()
 {
   LOG(INFO) << "Slave terminating";
 
+  // Send any status updates that are still waiting to be batched.
+  flushStatusUpdates();
+
   foreachkey (const FrameworkID& frameworkId, frameworks) {
     // TODO(benh): Because a shut down isn't instantaneous (but has
     // a shut down/kill phases) we might not actually propogate all
@@ -302,6 +506,10 @@ void Slave::finalize()
   // Stop the isolation module.
   terminate(isolationModule);
   wait(isolationModule);
+
+  terminate(gc);
+  wait(gc);
+  delete gc;
 }
 
 
@@ -319,8 +527,20 @@ void Slave::newMasterDetected(const UPID& pid)
   master = pid;
   link(master);
 
+  shard = master;
+
   connected = false;
-  doReliableRegistration();
+  registrationBackoff.reset();
+
+  if (id == "") {
+    doReliableRegistration();
+  } else {
+    // Every slave that was registered with the old master detects the
+    // new master at about the same time, so wait a random amount of
+    // time before re-registering in order to spread them out.
+    delay(registrationBackoff.jitter(REGISTRATION_RETRY_INTERVAL_SECONDS),
+          self(), &Slave::doReliableRegistration);
+  }
 }
 
 
@@ -329,25 +549,37 @@ void Slave::noMasterDetected()
   LOG(INFO) << "Lost master(s) ... waiting";
   connected = false;
   master = UPID();
+  shard = UPID();
 }
 
 
-void Slave::registered(const SlaveID& slaveId)
+void Slave::registered(const SlaveID& slaveId, const string& _shard)
 {
   LOG(INFO) << "Registered with master; given slave ID " << slaveId;
   id = slaveId;
+  shard = _shard.empty() ? master : UPID(_shard);
   connected = true;
+
+  checkpoint();
 }
 
 
-void Slave::reregistered(const SlaveID& slaveId)
+void Slave::reregistered(const SlaveID& slaveId, const string& _shard)
 {
   LOG(INFO) << "Re-registered with master";
 
   if (!(id == slaveId)) {
     LOG(FATAL) << "Slave re-registered but got wrong ID";
   }
+  shard = _shard.empty() ? master : UPID(_shard);
   connected = true;
+
+  // Resend the status updates that were waiting to be acknowledged
+  // when the slave restarted.
+  if (!recoveredUpdates.empty()) {
+    statusUpdatesTimeout(recoveredUpdates);
+    recoveredUpdates.clear();
+  }
 }
 
 
@@ -364,36 +596,71 @@ void Slave::doReliableRegistration()
     message.mutable_slave()->MergeFrom(info);
     send(master, message);
   } else {
-    // Re-registering, so send tasks running.
+    // Re-registering, so send the digest of our state (the master
+    // asks for the state itself if it needs it, see stateRequested).
     ReregisterSlaveMessage message;
     message.mutable_slave_id()->MergeFrom(id);
-    message.mutable_slave()->MergeFrom(info);
+    message.set_digest(reregistration().digest());
+    send(master, message);
+  }
 
-    foreachvalue (Framework* framework, frameworks) {
-      foreachvalue (Executor* executor, framework->executors) {
-        message.add_executor_infos()->MergeFrom(executor->info);
-        foreachvalue (Task* task, executor->launchedTasks) {
-          // TODO(benh): Also need to send queued tasks here ...
-          message.add_tasks()->MergeFrom(*task);
-        }
+  // Re-try registration if necessary (backing off so that a master
+  // that is slow to respond doesn't get more and more requests).
+  delay(registrationBackoff.next(), self(), &Slave::doReliableRegistration);
+}
+
+
+void Slave::stateRequested(const SlaveID& slaveId)
+{
+  if (connected || from != master || !(id == slaveId)) {
+    LOG(WARNING) << "Ignoring request for our state from " << from;
+    return;
+  }
+
+  LOG(INFO) << "Sending our state to master " << master;
+
+  send(master, reregistration());
+}
+
+
+ReregisterSlaveMessage Slave::reregistration()
+{
+  ReregisterSlaveMessage message;
+  message.mutable_slave_id()->MergeFrom(id);
+  message.mutable_slave()->MergeFrom(info);
+
+  foreachvalue (Framework* framework, frameworks) {
+    foreachvalue (Executor* executor, framework->executors) {
+      message.add_executor_infos()->MergeFrom(executor->info);
+      foreachvalue (Task* task, executor->launchedTasks) {
+        // TODO(benh): Also need to send queued tasks here ...
+        message.add_tasks()->MergeFrom(*task);
       }
     }
-
-    send(master, message);
   }
 
-  // Re-try registration if necessary.
-  delay(1.0, self(), &Slave::doReliableRegistration);
+  // The digest only needs to tell our states apart (it's only ever
+  // compared to digests that we computed).
+  std::ostringstream digest;
+  digest << std::hex
+         << std::tr1::hash<string>()(message.SerializeAsString());
+  message.set_digest(digest.str());
+
+  return message;
 }
 
 
 void Slave::runTask(const FrameworkInfo& frameworkInfo,
                     const FrameworkID& frameworkId,
                     const string& pid,
-                    const TaskDescription& task)
+                    const TaskDescription& task,
+                    bool revocable)
 {
-  LOG(INFO) << "Got assigned task " << task.task_id()
-            << " for framework " << frameworkId;
+  const double started = Clock::now();
+
+  LOG_RATE_LIMITED(INFO, TASK_LOG_RATE)
+    << "Got assigned task " << task.task_id()
+    << " for framework " << frameworkId;
 
   Framework* framework = getFramework(frameworkId);
   if (framework == NULL) {
@@ -401,6 +668,73 @@ void Slave::runTask(const FrameworkInfo& frameworkInfo,
     frameworks[frameworkId] = framework;
   }
 
+  Executor* executor = assignTask(framework, task, revocable);
+
+  if (executor != NULL) {
+    // Update the resources.
+    // TODO(Charles Reiss): The isolation module is not guaranteed to update
+    // the resources before the executor acts on its RunTaskMessage.
+    resourcesChanged(framework, executor);
+
+    sendTasks(framework, executor, vector<TaskDescription>(1, task));
+  }
+
+  checkpoint();
+
+  tracer::record(task.trace_id(), task.task_id(), "slave/run",
+                 started, Clock::now());
+}
+
+
+void Slave::runTasks(const RunTasksMessage& message)
+{
+  const double started = Clock::now();
+
+  LOG(INFO) << "Got assigned " << message.tasks_size() << " tasks"
+            << " for framework " << message.framework_id();
+
+  Framework* framework = getFramework(message.framework_id());
+  if (framework == NULL) {
+    framework = new Framework(message.framework_id(),
+                              message.framework(),
+                              message.pid());
+    frameworks[message.framework_id()] = framework;
+  }
+
+  // Collect the tasks for each registered executor so that each
+  // executor gets all of its tasks (and the resources for them) at
+  // once, rather than a message per task.
+  hashmap<Executor*, vector<TaskDescription> > batches;
+
+  foreach (const TaskDescription& task, message.tasks()) {
+    Executor* executor = assignTask(framework, task, message.revocable());
+    if (executor != NULL) {
+      batches[executor].push_back(task);
+    }
+  }
+
+  foreachpair (Executor* executor,
+               const vector<TaskDescription>& tasks,
+               batches) {
+    resourcesChanged(framework, executor);
+
+    sendTasks(framework, executor, tasks);
+  }
+
+  checkpoint();
+
+  const double now = Clock::now();
+  foreach (const TaskDescription& task, message.tasks()) {
+    tracer::record(task.trace_id(), task.task_id(), "slave/run",
+                   started, now);
+  }
+}
+
+
+Executor* Slave::assignTask(Framework* framework,
+                            const TaskDescription& task,
+                            bool revocable)
+{
   const ExecutorInfo& executorInfo = task.has_executor()
     ? task.executor()
     : framework->info.executor();
@@ -414,45 +748,30 @@ void Slave::runTask(const FrameworkInfo& frameworkInfo,
   if (executor != NULL) {
     if (executor->shutdown) {
       LOG(WARNING) << "WARNING! Asked to run task '" << task.task_id()
-                   << "' for framework " << frameworkId
+                   << "' for framework " << framework->id
                    << " with executor '" << executorId
                    << "' which is being shut down";
 
       StatusUpdateMessage message;
       StatusUpdate* update = message.mutable_update();
-      update->mutable_framework_id()->MergeFrom(frameworkId);
+      update->mutable_framework_id()->MergeFrom(framework->id);
       update->mutable_slave_id()->MergeFrom(id);
       TaskStatus* status = update->mutable_status();
       status->mutable_task_id()->MergeFrom(task.task_id());
       status->set_state(TASK_LOST);
-      update->set_timestamp(Clock::now());
+      update->set_timestamp(Clock::coarse());
       update->set_uuid(UUID::random().toBytes());
-      send(master, message);
+      send(shard, message);
     } else if (!executor->pid) {
       // Queue task until the executor starts up.
       LOG(INFO) << "Queuing task '" << task.task_id()
                 << "' for executor " << executorId
-                << " of framework '" << frameworkId;
+                << " of framework '" << framework->id;
       executor->queuedTasks[task.task_id()] = task;
     } else {
-      // Add the task and send it to the executor.
+      // Add the task, it gets sent to the executor by the caller.
       executor->addTask(task);
-
-      stats.tasks[TASK_STARTING]++;
-
-      // Update the resources.
-      // TODO(Charles Reiss): The isolation module is not guaranteed to update
-      // the resources before the executor acts on its RunTaskMessage.
-      dispatch(isolationModule,
-               &IsolationModule::resourcesChanged,
-               framework->id, executor->id, executor->resources);
-
-      RunTaskMessage message;
-      message.mutable_framework()->MergeFrom(framework->info);
-      message.mutable_framework_id()->MergeFrom(framework->id);
-      message.set_pid(framework->pid);
-      message.mutable_task()->MergeFrom(task);
-      send(executor->pid, message);
+      return executor;
     }
   } else {
     // Launch an executor for this task.
@@ -463,7 +782,8 @@ void Slave::runTask(const FrameworkInfo& frameworkInfo,
               << "' as work directory for executor '" << executorId
               << "' of framework " << framework->id;
 
-    executor = framework->createExecutor(executorInfo, directory);
+    executor = framework->createExecutor(executorInfo, directory,
+                                         revocable, Clock::now());
 
     // Queue task until the executor starts up.
     executor->queuedTasks[task.task_id()] = task;
@@ -476,6 +796,85 @@ void Slave::runTask(const FrameworkInfo& frameworkInfo,
              framework->id, framework->info, executor->info,
              directory, executor->resources);
   }
+
+  return NULL;
+}
+
+
+void Slave::resourcesChanged(Framework* framework, Executor* executor)
+{
+  if (!(executor->resources <= executor->isolated)) {
+    executor->isolated = executor->resources;
+    dispatch(isolationModule,
+             &IsolationModule::resourcesChanged,
+             framework->id, executor->id, executor->resources);
+  } else if (!executor->resourcesPending &&
+             !(executor->resources == executor->isolated)) {
+    executor->resourcesPending = true;
+    delay(RESOURCES_CHANGED_INTERVAL_SECONDS, self(),
+          &Slave::resourcesChangedTimeout,
+          framework->id, executor->id, executor->uuid);
+  }
+}
+
+
+void Slave::resourcesChangedTimeout(const FrameworkID& frameworkId,
+                                    const ExecutorID& executorId,
+                                    const UUID& uuid)
+{
+  Framework* framework = getFramework(frameworkId);
+  if (framework == NULL) {
+    return;
+  }
+
+  Executor* executor = framework->getExecutor(executorId);
+  if (executor == NULL || !(executor->uuid == uuid)) {
+    return;
+  }
+
+  executor->resourcesPending = false;
+
+  // Nothing to do if the resources grew back in the meantime.
+  if (!(executor->resources == executor->isolated)) {
+    executor->isolated = executor->resources;
+    dispatch(isolationModule,
+             &IsolationModule::resourcesChanged,
+             framework->id, executor->id, executor->resources);
+  }
+}
+
+
+void Slave::sendTasks(Framework* framework,
+                      Executor* executor,
+                      const vector<TaskDescription>& tasks)
+{
+  CHECK(executor->pid);
+
+  stats.tasks[TASK_STARTING]->increment(tasks.size());
+
+  // Executors whose drivers don't take batches get a RunTaskMessage
+  // per task.
+  if (tasks.size() == 1 || !executor->batches) {
+    foreach (const TaskDescription& task, tasks) {
+      RunTaskMessage message;
+      message.mutable_framework()->MergeFrom(framework->info);
+      message.mutable_framework_id()->MergeFrom(framework->id);
+      message.set_pid(framework->pid);
+      message.mutable_task()->MergeFrom(task);
+      message.set_revocable(executor->revocable);
+      send(executor->pid, message);
+    }
+  } else if (tasks.size() > 1) {
+    RunTasksMessage message;
+    message.mutable_framework()->MergeFrom(framework->info);
+    message.mutable_framework_id()->MergeFrom(framework->id);
+    message.set_pid(framework->pid);
+    foreach (const TaskDescription& task, tasks) {
+      message.add_tasks()->MergeFrom(task);
+    }
+    message.set_revocable(executor->revocable);
+    send(executor->pid, message);
+  }
 }
 
 
@@ -498,9 +897,9 @@ void Slave::killTask(const FrameworkID& frameworkId,
     TaskStatus* status = update->mutable_status();
     status->mutable_task_id()->MergeFrom(taskId);
     status->set_state(TASK_LOST);
-    update->set_timestamp(Clock::now());
+    update->set_timestamp(Clock::coarse());
     update->set_uuid(UUID::random().toBytes());
-    send(master, message);
+    send(shard, message);
 
     return;
   }
@@ -521,17 +920,15 @@ void Slave::killTask(const FrameworkID& frameworkId,
     TaskStatus* status = update->mutable_status();
     status->mutable_task_id()->MergeFrom(taskId);
     status->set_state(TASK_LOST);
-    update->set_timestamp(Clock::now());
+    update->set_timestamp(Clock::coarse());
     update->set_uuid(UUID::random().toBytes());
-    send(master, message);
+    send(shard, message);
   } else if (!executor->pid) {
     // Remove the task.
     executor->removeTask(taskId);
 
     // Tell the isolation module to update the resources.
-    dispatch(isolationModule,
-             &IsolationModule::resourcesChanged,
-             framework->id, executor->id, executor->resources);
+    resourcesChanged(framework, executor);
 
     StatusUpdateMessage message;
     StatusUpdate* update = message.mutable_update();
@@ -541,9 +938,11 @@ void Slave::killTask(const FrameworkID& frameworkId,
     TaskStatus* status = update->mutable_status();
     status->mutable_task_id()->MergeFrom(taskId);
     status->set_state(TASK_KILLED);
-    update->set_timestamp(Clock::now());
+    update->set_timestamp(Clock::coarse());
     update->set_uuid(UUID::random().toBytes());
-    send(master, message);
+    send(shard, message);
+
+    checkpoint();
   } else {
     // Otherwise, send a message to the executor and wait for
     // it to send us a status update.
@@ -568,10 +967,14 @@ void Slave::shutdownFramework(const FrameworkID& frameworkId)
   if (framework != NULL) {
     LOG(INFO) << "Shutting down framework " << framework->id;
 
-    // Shut down all executors of this framework.
+    // Shut down all executors of this framework (at once, so that the
+    // ones that don't comply get killed at once too).
+    vector<Executor*> executors;
     foreachvalue (Executor* executor, framework->executors) {
-      shutdownExecutor(framework, executor);
+      executors.push_back(executor);
     }
+
+    shutdownExecutors(framework, executors);
   }
 }
 
@@ -585,7 +988,7 @@ void Slave::schedulerMessage(const SlaveID& slaveId,
   if (framework == NULL) {
     LOG(WARNING) << "Dropping message for framework "<< frameworkId
                  << " because framework does not exist";
-    stats.invalidFrameworkMessages++;
+    stats.invalidFrameworkMessages.increment();
     return;
   }
 
@@ -594,7 +997,7 @@ void Slave::schedulerMessage(const SlaveID& slaveId,
     LOG(WARNING) << "Dropping message for executor '"
                  << executorId << "' of framework " << frameworkId
                  << " because executor does not exist";
-    stats.invalidFrameworkMessages++;
+    stats.invalidFrameworkMessages.increment();
   } else if (!executor->pid) {
     // TODO(*): If executor is not started, queue framework message?
     // (It's probably okay to just drop it since frameworks can have
@@ -602,7 +1005,7 @@ void Slave::schedulerMessage(const SlaveID& slaveId,
     LOG(WARNING) << "Dropping message for executor '"
                  << executorId << "' of framework " << frameworkId
                  << " because executor is not running";
-    stats.invalidFrameworkMessages++;
+    stats.invalidFrameworkMessages.increment();
   } else {
     FrameworkToExecutorMessage message;
     message.mutable_slave_id()->MergeFrom(slaveId);
@@ -611,7 +1014,7 @@ void Slave::schedulerMessage(const SlaveID& slaveId,
     message.set_data(data);
     send(executor->pid, message);
 
-    stats.validFrameworkMessages++;
+    stats.validFrameworkMessages.increment();
   }
 }
 
@@ -624,6 +1027,20 @@ void Slave::updateFramework(const FrameworkID& frameworkId,
     LOG(INFO) << "Updating framework " << frameworkId
               << " pid to " <<pid;
     framework->pid = pid;
+
+    // Executors that talk to the scheduler directly need to know
+    // where it failed over to.
+    UpdateFrameworkMessage message;
+    message.mutable_framework_id()->MergeFrom(frameworkId);
+    message.set_pid(pid);
+
+    foreachvalue (Executor* executor, framework->executors) {
+      if (executor->direct && executor->pid) {
+        send(executor->pid, message);
+      }
+    }
+
+    checkpoint();
   }
 }
 
@@ -635,11 +1052,36 @@ void Slave::statusUpdateAcknowledgement(const SlaveID& slaveId,
 {
   Framework* framework = getFramework(frameworkId);
   if (framework != NULL) {
-    if (framework->updates.contains(UUID::fromBytes(uuid))) {
-      LOG(INFO) << "Got acknowledgement of status update"
-                << " for task " << taskId
-                << " of framework " << frameworkId;
-      framework->updates.erase(UUID::fromBytes(uuid));
+    if (framework->updates.acknowledge(UUID::fromBytes(uuid))) {
+      LOG_RATE_LIMITED(INFO, TASK_LOG_RATE)
+        << "Got acknowledgement of status update"
+        << " for task " << taskId
+        << " of framework " << frameworkId;
+
+      checkpoint();
+    }
+  }
+}
+
+
+void Slave::statusUpdateAcknowledgements(
+    const StatusUpdateAcknowledgementsMessage& message)
+{
+  Framework* framework = getFramework(message.framework_id());
+  if (framework != NULL) {
+    size_t acknowledged = 0;
+
+    foreach (const Value::Range& range, message.sequences().range()) {
+      acknowledged += framework->updates.acknowledge(range.begin(),
+                                                     range.end());
+    }
+
+    if (acknowledged > 0) {
+      LOG_RATE_LIMITED(INFO, TASK_LOG_RATE)
+        << "Got acknowledgement of " << acknowledged
+        << " status updates of framework " << framework->id;
+
+      checkpoint();
     }
   }
 }
@@ -717,7 +1159,9 @@ void Slave::statusUpdateAcknowledgement(const SlaveID& slaveId,
 
 
 void Slave::registerExecutor(const FrameworkID& frameworkId,
-                             const ExecutorID& executorId)
+                             const ExecutorID& executorId,
+                             bool direct,
+                             bool batches)
 {
   LOG(INFO) << "Got registration for executor '" << executorId
             << "' of framework " << frameworkId;
@@ -748,6 +1192,11 @@ void Slave::registerExecutor(const FrameworkID& frameworkId,
     // Save the pid for the executor.
     executor->pid = from;
 
+    // Watch the executor if the isolation module can't.
+    if (executor->recovered) {
+      link(executor->pid);
+    }
+
     // First account for the tasks we're about to start.
     foreachvalue (const TaskDescription& task, executor->queuedTasks) {
       // Add the task to the executor.
@@ -758,10 +1207,8 @@ void Slave::registerExecutor(const FrameworkID& frameworkId,
     // currently queued tasks.
     // TODO(Charles Reiss): We don't actually have a guarantee that this will
     // be delivered or (where necessary) acted on before the executor gets its
-    // RunTaskMessages.
-    dispatch(isolationModule,
-             &IsolationModule::resourcesChanged,
-             framework->id, executor->id, executor->resources);
+    // RunTasksMessage.
+    resourcesChanged(framework, executor);
 
     // Tell executor it's registered and give it any queued tasks.
     ExecutorRegisteredMessage message;
@@ -771,22 +1218,98 @@ void Slave::registerExecutor(const FrameworkID& frameworkId,
     args->mutable_slave_id()->MergeFrom(id);
     args->set_hostname(info.hostname());
     args->set_data(executor->info.data());
+
+    // Let the executor send framework messages to the scheduler
+    // directly if it wants to.
+    executor->direct = direct;
+    executor->batches = batches;
+    if (direct) {
+      message.set_framework_pid(framework->pid);
+    }
+
+    message.set_checkpoint(checkpointing);
+
     send(executor->pid, message);
 
     LOG(INFO) << "Flushing queued tasks for framework " << framework->id;
 
+    // The tasks waited for the executor to get launched (i.e., forked
+    // and exec'ed, or spawned) and then to start up and register
+    // (including fetching the executor).
+    const double now = Clock::now();
+    const double started = executor->started > 0
+      ? executor->started
+      : executor->launched;
+
+    vector<TaskDescription> tasks;
     foreachvalue (const TaskDescription& task, executor->queuedTasks) {
-      stats.tasks[TASK_STARTING]++;
+      tasks.push_back(task);
 
-      RunTaskMessage message;
-      message.mutable_framework_id()->MergeFrom(framework->id);
-      message.mutable_framework()->MergeFrom(framework->info);
-      message.set_pid(framework->pid);
-      message.mutable_task()->MergeFrom(task);
-      send(executor->pid, message);
+      if (executor->started > 0) {
+        tracer::record(task.trace_id(), task.task_id(),
+                       "slave/launch_executor", executor->launched, started);
+      }
+      tracer::record(task.trace_id(), task.task_id(),
+                     "slave/register_executor", started, now);
     }
 
+    sendTasks(framework, executor, tasks);
+
     executor->queuedTasks.clear();
+
+    checkpoint();
+  }
+}
+
+
+void Slave::reregisterExecutor(const FrameworkID& frameworkId,
+                               const ExecutorID& executorId,
+                               bool direct,
+                               bool batches)
+{
+  LOG(INFO) << "Got re-registration for executor '" << executorId
+            << "' of framework " << frameworkId;
+
+  Framework* framework = getFramework(frameworkId);
+
+  Executor* executor = framework != NULL
+    ? framework->getExecutor(executorId)
+    : NULL;
+
+  // Only executors that were running before the slave restarted get
+  // to re-register (once).
+  if (executor == NULL || !executor->recovered || executor->pid) {
+    LOG(WARNING) << "WARNING! Unexpected executor '" << executorId
+                 << "' re-registering for framework " << frameworkId;
+    reply(ShutdownExecutorMessage());
+    return;
+  }
+
+  executor->pid = from;
+  executor->direct = direct;
+  executor->batches = batches;
+
+  // The isolation module doesn't know about the executor, so watch
+  // it ourselves (see Slave::exited).
+  link(executor->pid);
+
+  ExecutorReregisteredMessage message;
+  message.mutable_slave_id()->MergeFrom(id);
+  send(executor->pid, message);
+
+  // The executor didn't get its queued tasks before the restart.
+  if (!executor->queuedTasks.empty()) {
+    vector<TaskDescription> tasks;
+    foreachvalue (const TaskDescription& task, executor->queuedTasks) {
+      executor->addTask(task);
+      tasks.push_back(task);
+    }
+
+    sendTasks(framework, executor, tasks);
+
+    executor->queuedTasks.clear();
+
+    checkpoint();
   }
 }
 
@@ -802,7 +1325,7 @@ void Slave::registerExecutor(const FrameworkID& frameworkId,
 //     LOG(WARNING) << "WARNING! Failed to lookup"
 //                  << " framework " << update.framework_id()
 //                  << " of received status update";
-//     stats.invalidStatusUpdates++;
+//     stats.invalidStatusUpdates.increment();
 //     return;
 //   }
 
@@ -811,7 +1334,7 @@ void Slave::registerExecutor(const FrameworkID& frameworkId,
 //     LOG(WARNING) << "WARNING! Failed to lookup executor"
 //                  << " for framework " << update.framework_id()
 //                  << " of received status update";
-//     stats.invalidStatusUpdates++;
+//     stats.invalidStatusUpdates.increment();
 //     return;
 //   }
 
@@ -907,17 +1430,20 @@ void Slave::registerExecutor(const FrameworkID& frameworkId,
 //     stream->timeout = Clock::now() + STATUS_UPDATE_RETRY_INTERVAL;
 //   }
 
-//   stats.tasks[status.state()]++;
-//   stats.validStatusUpdates++;
+//   stats.tasks[status.state()]->increment();
+//   stats.validStatusUpdates.increment();
 // }
 
 void Slave::statusUpdate(const StatusUpdate& update)
 {
   const TaskStatus& status = update.status();
 
-  LOG(INFO) << "Status update: task " << status.task_id()
-            << " of framework " << update.framework_id()
-            << " is now in state " << status.state();
+  tracer::record("slave", update);
+
+  LOG_RATE_LIMITED(INFO, TASK_LOG_RATE)
+    << "Status update: task " << status.task_id()
+    << " of framework " << update.framework_id()
+    << " is now in state " << status.state();
 
   Framework* framework = getFramework(update.framework_id());
   if (framework != NULL) {
@@ -932,38 +1458,55 @@ void Slave::statusUpdate(const StatusUpdate& update)
           status.state() == TASK_LOST) {
         executor->removeTask(status.task_id());
 
-        dispatch(isolationModule,
-                 &IsolationModule::resourcesChanged,
-                 framework->id, executor->id, executor->resources);
+        resourcesChanged(framework, executor);
       }
 
-      // Send message and record the status for possible resending.
-      StatusUpdateMessage message;
-      message.mutable_update()->MergeFrom(update);
-      message.set_pid(self());
-      send(master, message);
+      // Queue the update to be sent to the master along with any
+      // other updates that are already waiting to be handled by us
+      // (the flush gets dispatched behind them), unless the batch is
+      // full. Record the update for possible resending.
+      if (pendingUpdates.updates_size() == 0) {
+        dispatch(self(), &Slave::flushStatusUpdates);
+      }
 
-      UUID uuid = UUID::fromBytes(update.uuid());
+      const uint64_t sequence = nextSequence++;
 
-      // Send us a message to try and resend after some delay.
-      delay(STATUS_UPDATE_RETRY_INTERVAL_SECONDS,
-            self(), &Slave::statusUpdateTimeout,
-            framework->id, uuid);
+      framework->updates.append(update, sequence);
 
-      framework->updates[uuid] = update;
+      StatusUpdate* pending = pendingUpdates.add_updates();
+      pending->MergeFrom(update);
+      pending->set_sequence(sequence);
 
-      stats.tasks[status.state()]++;
+      pendingSequences.push_back(make_pair(framework->id, sequence));
 
-      stats.validStatusUpdates++;
+      if (pendingUpdates.updates_size() >= STATUS_UPDATE_BATCH_SIZE) {
+        flushStatusUpdates();
+      }
+
+      stats.tasks[status.state()]->increment();
+
+      stats.validStatusUpdates.increment();
+
+      checkpoint();
     } else {
       LOG(WARNING) << "Status update error: couldn't lookup "
                    << "executor for framework " << update.framework_id();
-      stats.invalidStatusUpdates++;
+      stats.invalidStatusUpdates.increment();
     }
   } else {
     LOG(WARNING) << "Status update error: couldn't lookup "
                  << "framework " << update.framework_id();
-    stats.invalidStatusUpdates++;
+    stats.invalidStatusUpdates.increment();
+  }
+}
+
+
+void Slave::statusUpdates(const vector<StatusUpdate>& updates)
+{
+  // These get batched up again (perhaps with updates from other
+  // executors) on their way to the master.
+  foreach (const StatusUpdate& update, updates) {
+    statusUpdate(update);
   }
 }
 
@@ -978,12 +1521,13 @@ void Slave::executorMessage(const SlaveID& slaveId,
     LOG(WARNING) << "Cannot send framework message from slave "
                  << slaveId << " to framework " << frameworkId
                  << " because framework does not exist";
-    stats.invalidFrameworkMessages++;
+    stats.invalidFrameworkMessages.increment();
     return;
   }
 
-  LOG(INFO) << "Sending message for framework " << frameworkId
-            << " to " << framework->pid;
+  LOG_RATE_LIMITED(INFO, TASK_LOG_RATE)
+    << "Sending message for framework " << frameworkId
+    << " to " << framework->pid;
 
   ExecutorToFrameworkMessage message;
   message.mutable_slave_id()->MergeFrom(slaveId);
@@ -992,36 +1536,94 @@ void Slave::executorMessage(const SlaveID& slaveId,
   message.set_data(data);
   send(framework->pid, message);
 
-  stats.validFrameworkMessages++;
+  stats.validFrameworkMessages.increment();
 }
 
 
 void Slave::ping(const UPID& from, const string& body)
 {
   send(from, "PONG");
+
+  // Let the master know what the executors have actually been using.
+  if (connected && from == master) {
+    ExecutorUsageMessage message;
+    message.mutable_slave_id()->MergeFrom(id);
+
+    foreachvalue (Framework* framework, frameworks) {
+      foreachvalue (Executor* executor, framework->executors) {
+        if (executor->usage.isSome()) {
+          message.add_usages()->MergeFrom(executor->usage.get());
+        }
+      }
+    }
+
+    message.mutable_slack()->MergeFrom(slack());
+
+    if (message.usages_size() > 0) {
+      send(master, message);
+    }
+  }
 }
 
 
-void Slave::statusUpdateTimeout(
-    const FrameworkID& frameworkId,
-    const UUID& uuid)
+void Slave::flushStatusUpdates()
 {
-  // Check and see if we still need to send this update.
-  Framework* framework = getFramework(frameworkId);
-  if (framework != NULL) {
-    if (framework->updates.contains(uuid)) {
-      const StatusUpdate& update = framework->updates[uuid];
+  if (pendingUpdates.updates_size() == 0) {
+    return;
+  }
 
-      LOG(INFO) << "Resending status update"
-                << " for task " << update.status().task_id()
-                << " of framework " << update.framework_id();
+  if (pendingUpdates.updates_size() == 1) {
+    StatusUpdateMessage message;
+    message.mutable_update()->MergeFrom(pendingUpdates.updates(0));
+    message.set_pid(self());
+    send(shard, message);
+  } else {
+    pendingUpdates.set_pid(self());
+    send(shard, pendingUpdates);
+  }
 
-      StatusUpdateMessage message;
-      message.mutable_update()->MergeFrom(update);
-      message.set_pid(self());
-      send(master, message);
+  pendingUpdates.Clear();
+
+  // Send us a message to try and resend after some delay (one for
+  // the whole batch rather than one per update).
+  delay(STATUS_UPDATE_RETRY_INTERVAL_SECONDS,
+        self(), &Slave::statusUpdatesTimeout, pendingSequences);
+
+  pendingSequences.clear();
+}
+
+
+void Slave::statusUpdatesTimeout(
+    const vector<pair<FrameworkID, uint64_t> >& updates)
+{
+  // Check and see which of the updates we still need to send (in the
+  // order they were originally sent).
+  StatusUpdatesMessage message;
+
+  typedef pair<FrameworkID, uint64_t> Update;
+  foreach (const Update& update, updates) {
+    Framework* framework = getFramework(update.first);
+    if (framework != NULL) {
+      const StatusUpdate* pending = framework->updates.get(update.second);
+      if (pending != NULL) {
+        LOG(INFO) << "Resending status update"
+                  << " for task " << pending->status().task_id()
+                  << " of framework " << framework->id;
+
+        message.add_updates()->MergeFrom(*pending);
+      }
     }
   }
+
+  if (message.updates_size() == 1) {
+    StatusUpdateMessage single;
+    single.mutable_update()->MergeFrom(message.updates(0));
+    single.set_pid(self());
+    send(shard, single);
+  } else if (message.updates_size() > 1) {
+    message.set_pid(self());
+    send(shard, message);
+  }
 }
 
 
@@ -1059,6 +1661,25 @@ void Slave::exited(const UPID& pid)
     LOG(WARNING) << "WARNING! Master disconnected!"
                  << " Waiting for a new master to be elected.";
     // TODO(benh): After so long waiting for a master, commit suicide.
+    return;
+  }
+
+  // The isolation module doesn't know about the executors that were
+  // running before the slave restarted, so this is how we find out
+  // that they exited.
+  vector<pair<FrameworkID, ExecutorID> > gone;
+
+  foreachvalue (Framework* framework, frameworks) {
+    foreachvalue (Executor* executor, framework->executors) {
+      if (executor->recovered && executor->pid == pid) {
+        gone.push_back(make_pair(framework->id, executor->id));
+      }
+    }
+  }
+
+  typedef pair<FrameworkID, ExecutorID> Gone;
+  foreach (const Gone& executor, gone) {
+    executorExited(executor.first, executor.second, -1);
   }
 }
 
@@ -1247,7 +1868,13 @@ void Slave::executorStarted(const FrameworkID& frameworkId,
                             const ExecutorID& executorId,
                             pid_t pid)
 {
-
+  Framework* framework = getFramework(frameworkId);
+  if (framework != NULL) {
+    Executor* executor = framework->getExecutor(executorId);
+    if (executor != NULL) {
+      executor->started = Clock::now();
+    }
+  }
 }
 
 
@@ -1276,17 +1903,22 @@ void Slave::executorExited(const FrameworkID& frameworkId,
             << "' of framework " << frameworkId
             << " has exited with status " << status;
 
+  // Make sure the master gets the executor's status updates first.
+  flushStatusUpdates();
+
   ExitedExecutorMessage message;
   message.mutable_slave_id()->MergeFrom(id);
   message.mutable_framework_id()->MergeFrom(frameworkId);
   message.mutable_executor_id()->MergeFrom(executorId);
   message.set_status(status);
-  send(master, message);
+  send(shard, message); // Behind the updates (see SlaveShard).
 
   // TODO(benh): Send status updates for remaining tasks here rather
   // than at the master! As in, eliminate the code in
   // Master::exitedExecutor and put it here.
 
+  dispatch(gc, &GarbageCollector::schedule, executor->directory);
+
   framework->destroyExecutor(executor->id);
 
   // Cleanup if this framework has nothing running.
@@ -1296,96 +1928,419 @@ void Slave::executorExited(const FrameworkID& frameworkId,
     frameworks.erase(framework->id);
     delete framework;
   }
+
+  checkpoint();
+}
+
+
+void Slave::executorUsage(const vector<ExecutorUsage>& usages)
+{
+  foreach (const ExecutorUsage& usage, usages) {
+    Framework* framework = getFramework(usage.framework_id());
+    if (framework != NULL) {
+      Executor* executor = framework->getExecutor(usage.executor_id());
+      if (executor != NULL) {
+        executor->usage = usage;
+      }
+    }
+  }
+
+  preempt();
+}
+
+
+void Slave::executorMemoryPressure(const FrameworkID& frameworkId,
+                                   const ExecutorID& executorId,
+                                   double mem,
+                                   double limit,
+                                   bool killed)
+{
+  Framework* framework = getFramework(frameworkId);
+  if (framework == NULL) {
+    return;
+  }
+
+  Executor* executor = framework->getExecutor(executorId);
+  if (executor == NULL) {
+    return;
+  }
+
+  if (!killed) {
+    LOG(WARNING) << "Executor '" << executorId << "' of framework "
+                 << frameworkId << " is using " << mem << " MB of its "
+                 << limit << " MB memory limit";
+
+    ExecutorMemoryPressureMessage message;
+    message.mutable_slave_id()->MergeFrom(id);
+    message.mutable_framework_id()->MergeFrom(frameworkId);
+    message.mutable_executor_id()->MergeFrom(executorId);
+    message.set_mem(mem);
+    message.set_limit(limit);
+    send(master, message);
+    return;
+  }
+
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(0)
+      << "Executor ran out of memory (" << limit << " MB)";
+
+  LOG(WARNING) << "Executor '" << executorId << "' of framework "
+               << frameworkId << ": " << out.str();
+
+  // Make sure these come after the executor's own updates.
+  flushStatusUpdates();
+
+  foreachvalue (Task* task, executor->launchedTasks) {
+    if (task->state() != TASK_RUNNING) {
+      continue;
+    }
+
+    StatusUpdateMessage message;
+    StatusUpdate* update = message.mutable_update();
+    update->mutable_framework_id()->MergeFrom(frameworkId);
+    update->mutable_executor_id()->MergeFrom(executorId);
+    update->mutable_slave_id()->MergeFrom(id);
+    TaskStatus* status = update->mutable_status();
+    status->mutable_task_id()->MergeFrom(task->task_id());
+    status->set_state(TASK_FAILED);
+    status->set_message(out.str());
+    update->set_timestamp(Clock::coarse());
+    update->set_uuid(UUID::random().toBytes());
+    send(shard, message);
+  }
+}
+
+
+Resources Slave::slack()
+{
+  Resources resources;
+
+  foreachvalue (Framework* framework, frameworks) {
+    foreachvalue (Executor* executor, framework->executors) {
+      if (!executor->revocable && !executor->shutdown &&
+          executor->usage.isSome()) {
+        resources += slave::slack(executor->resources,
+                                  executor->usage.get().cpus(),
+                                  executor->usage.get().mem());
+      }
+    }
+  }
+
+  return resources;
+}
+
+
+void Slave::preempt()
+{
+  typedef pair<double, pair<FrameworkID, ExecutorID> > Revocable;
+
+  // The revocable executors (that aren't already going away), ordered
+  // by when they were launched, and the resources they're using.
+  vector<Revocable> revocable;
+  Resources used;
+
+  foreachvalue (Framework* framework, frameworks) {
+    foreachvalue (Executor* executor, framework->executors) {
+      if (executor->revocable && !executor->shutdown) {
+        revocable.push_back(
+            make_pair(executor->launched,
+                      make_pair(framework->id, executor->id)));
+        used += executor->resources;
+      }
+    }
+  }
+
+  std::sort(revocable.begin(), revocable.end());
+
+  const Resources available = slack();
+
+  while (!revocable.empty() && !(used <= available)) {
+    Framework* framework = getFramework(revocable.back().second.first);
+    CHECK(framework != NULL);
+
+    Executor* executor = framework->getExecutor(revocable.back().second.second);
+    CHECK(executor != NULL);
+
+    revocable.pop_back();
+
+    LOG(INFO) << "Preempting revocable executor '" << executor->id
+              << "' of framework " << framework->id
+              << " because the slack it was using (" << available
+              << ") is needed back";
+
+    used -= executor->resources;
+
+    killExecutors(framework, vector<ExecutorID>(1, executor->id));
+  }
 }
 
 
 void Slave::shutdownExecutor(Framework* framework, Executor* executor)
 {
-  LOG(INFO) << "Shutting down executor '" << executor->id
-            << "' of framework " << framework->id;
+  shutdownExecutors(framework, vector<Executor*>(1, executor));
+}
+
+
+void Slave::shutdownExecutors(Framework* framework,
+                              const vector<Executor*>& executors)
+{
+  vector<pair<ExecutorID, UUID> > shutdown;
+
+  foreach (Executor* executor, executors) {
+    LOG(INFO) << "Shutting down executor '" << executor->id
+              << "' of framework " << framework->id;
 
-  // If the executor hasn't yet registered, this message
-  // will be dropped to the floor!
-  send(executor->pid, ShutdownExecutorMessage());
+    // If the executor hasn't yet registered, this message
+    // will be dropped to the floor!
+    send(executor->pid, ShutdownExecutorMessage());
 
-  executor->shutdown = true;
+    executor->shutdown = true;
 
-  // Prepare for sending a kill if the executor doesn't comply.
+    shutdown.push_back(make_pair(executor->id, executor->uuid));
+  }
+
+  // Prepare for sending a kill if the executors don't comply.
   double timeout = conf.get<double>("executor_shutdown_timeout_seconds",
                                     EXECUTOR_SHUTDOWN_TIMEOUT_SECONDS);
 
   delay(timeout, self(),
-        &Slave::shutdownExecutorTimeout,
-        framework->id, executor->id, executor->uuid);
+        &Slave::shutdownExecutorsTimeout,
+        framework->id, shutdown);
 }
 
 
-void Slave::shutdownExecutorTimeout(const FrameworkID& frameworkId,
-                                    const ExecutorID& executorId,
-                                    const UUID& uuid)
+void Slave::shutdownExecutorsTimeout(
+    const FrameworkID& frameworkId,
+    const vector<pair<ExecutorID, UUID> >& executors)
 {
   Framework* framework = getFramework(frameworkId);
   if (framework == NULL) {
     return;
   }
 
-  Executor* executor = framework->getExecutor(executorId);
-  if (executor == NULL) {
-    return;
+  // Kill the executors that are still around (making sure that each
+  // is still the same instance of the executor).
+  vector<ExecutorID> executorIds;
+
+  typedef pair<ExecutorID, UUID> Shutdown;
+  foreach (const Shutdown& shutdown, executors) {
+    Executor* executor = framework->getExecutor(shutdown.first);
+    if (executor != NULL && executor->uuid == shutdown.second) {
+      executorIds.push_back(executor->id);
+    }
+  }
+
+  if (!executorIds.empty()) {
+    killExecutors(framework, executorIds);
   }
+}
+
 
-  // Make sure this timeout is valid.
-  if (executor->uuid == uuid) {
-    LOG(INFO) << "Killing executor '" << executor->id
+void Slave::killExecutors(Framework* framework,
+                          const vector<ExecutorID>& executorIds)
+{
+  foreach (const ExecutorID& executorId, executorIds) {
+    LOG(INFO) << "Killing executor '" << executorId
               << "' of framework " << framework->id;
+  }
 
-    dispatch(isolationModule,
-             &IsolationModule::killExecutor,
-             framework->id, executor->id);
+  dispatch(isolationModule,
+           &IsolationModule::killExecutors,
+           framework->id, executorIds);
+
+  flushStatusUpdates();
+
+  foreach (const ExecutorID& executorId, executorIds) {
+    Executor* executor = framework->getExecutor(executorId);
+    CHECK(executor != NULL);
+
+    // The isolation module doesn't know about the executors that were
+    // running before the slave restarted, so ask them to exit instead.
+    if (executor->recovered && executor->pid) {
+      send(executor->pid, ShutdownExecutorMessage());
+    }
 
     ExitedExecutorMessage message;
     message.mutable_slave_id()->MergeFrom(id);
-    message.mutable_framework_id()->MergeFrom(frameworkId);
-    message.mutable_executor_id()->MergeFrom(executorId);
+    message.mutable_framework_id()->MergeFrom(framework->id);
+    message.mutable_executor_id()->MergeFrom(executor->id);
     message.set_status(-1);
-    send(master, message);
+    send(shard, message); // Behind the updates (see SlaveShard).
 
     // TODO(benh): Send status updates for remaining tasks here rather
     // than at the master! As in, eliminate the code in
     // Master::exitedExecutor and put it here.
 
+    dispatch(gc, &GarbageCollector::schedule, executor->directory);
+
     framework->destroyExecutor(executor->id);
+  }
+
+  // Cleanup if this framework has nothing running.
+  if (framework->executors.size() == 0) {
+    // TODO(benh): But there might be some remaining status updates
+    // that haven't been acknowledged!
+    frameworks.erase(framework->id);
+    delete framework;
+  }
+
+  checkpoint();
+}
+
+
+void Slave::checkpoint()
+{
+  if (checkpointing && !checkpointPending) {
+    checkpointPending = true;
+    dispatch(self(), &Slave::writeCheckpoint);
+  }
+}
+
+
+void Slave::writeCheckpoint()
+{
+  checkpointPending = false;
 
-    // Cleanup if this framework has nothing running.
-    if (framework->executors.size() == 0) {
-      // TODO(benh): But there might be some remaining status updates
-      // that haven't been acknowledged!
-      frameworks.erase(framework->id);
-      delete framework;
+  // Nothing worth recovering until the slave has an ID.
+  if (id == "") {
+    return;
+  }
+
+  SlaveState state;
+  state.mutable_slave_id()->MergeFrom(id);
+  state.set_next_sequence(nextSequence);
+
+  foreachvalue (Framework* framework, frameworks) {
+    SlaveState::Framework* checkpointed = state.add_frameworks();
+    checkpointed->mutable_id()->MergeFrom(framework->id);
+    checkpointed->mutable_info()->MergeFrom(framework->info);
+    checkpointed->set_pid(framework->pid);
+
+    foreachvalue (Executor* executor, framework->executors) {
+      SlaveState::Executor* e = checkpointed->add_executors();
+      e->mutable_info()->MergeFrom(executor->info);
+      e->set_directory(executor->directory);
+      e->set_revocable(executor->revocable);
+      e->set_launched(executor->launched);
+
+      foreachvalue (Task* task, executor->launchedTasks) {
+        e->add_tasks()->MergeFrom(*task);
+      }
+
+      foreachvalue (const TaskDescription& task, executor->queuedTasks) {
+        e->add_queued_tasks()->MergeFrom(task);
+      }
+    }
+
+    foreach (const StatusUpdate& update, framework->updates.updates()) {
+      checkpointed->add_updates()->MergeFrom(update);
     }
   }
+
+  // Write to a temporary file first so that the checkpoint never ends
+  // up half written (see GarbageCollector::checkpoint).
+  const string& path = getWorkDirectory() + "/state";
+  const string& temporary = path + ".tmp";
+
+  Result<bool> result = utils::protobuf::write(temporary, state);
+  if (result.isError() || result.isNone() || !result.get() ||
+      ::rename(temporary.c_str(), path.c_str()) != 0) {
+    LOG(ERROR) << "Failed to checkpoint the slave's state to " << path;
+  }
 }
 
 
-// void Slave::recover()
-// {
-//   // if we find an executor that is no longer running and it's last
-//   // acknowledged task statuses are not terminal, create a
-//   // statusupdatestream for each task and try and reliably send
-//   // TASK_LOST updates.
-
-//   // otherwise once we reconnect the executor will just start sending
-//   // us status updates that we need to send, wait for ack, write to
-//   // disk, and then respond.
-// }
+void Slave::recover()
+{
+  const string& path = getWorkDirectory() + "/state";
+
+  if (!utils::os::exists(path)) {
+    return;
+  }
+
+  SlaveState state;
+  Result<bool> result = utils::protobuf::read(path, &state);
+  if (result.isError() || result.isNone() || !result.get()) {
+    LOG(ERROR) << "Failed to recover the slave's state from " << path;
+    return;
+  }
 
+  id = state.slave_id();
+  nextSequence = state.next_sequence();
 
-string Slave::createUniqueWorkDirectory(const FrameworkID& frameworkId,
-                                        const ExecutorID& executorId)
+  foreach (const SlaveState::Framework& checkpointed, state.frameworks()) {
+    Framework* framework = new Framework(checkpointed.id(),
+                                         checkpointed.info(),
+                                         checkpointed.pid());
+    frameworks[framework->id] = framework;
+
+    foreach (const SlaveState::Executor& e, checkpointed.executors()) {
+      Executor* executor = framework->createExecutor(
+          e.info(), e.directory(), e.revocable(), e.launched());
+
+      // The executor (if it's still running) has to re-register
+      // before it gets a pid again.
+      executor->recovered = true;
+
+      foreach (const Task& task, e.tasks()) {
+        executor->launchedTasks[task.task_id()] = new Task(task);
+        executor->resources += task.resources();
+      }
+
+      foreach (const TaskDescription& task, e.queued_tasks()) {
+        executor->queuedTasks[task.task_id()] = task;
+      }
+    }
+
+    foreach (const StatusUpdate& update, checkpointed.updates()) {
+      framework->updates.append(update, update.sequence());
+      recoveredUpdates.push_back(make_pair(framework->id, update.sequence()));
+    }
+  }
+
+  LOG(INFO) << "Recovered " << frameworks.size() << " frameworks"
+            << " as slave " << id << " (and " << recoveredUpdates.size()
+            << " status updates); waiting for their executors to"
+            << " re-register";
+
+  delay(EXECUTOR_REREGISTER_TIMEOUT_SECONDS,
+        self(), &Slave::recoveryTimeout);
+}
+
+
+void Slave::recoveryTimeout()
 {
-  LOG(INFO) << "Generating a unique work directory for executor '"
-            << executorId << "' of framework " << frameworkId;
+  // Wait until the master can be told about the executors that are
+  // gone (their tasks are considered lost by the master).
+  if (!connected) {
+    delay(REGISTRATION_RETRY_INTERVAL_SECONDS,
+          self(), &Slave::recoveryTimeout);
+    return;
+  }
+
+  vector<pair<FrameworkID, ExecutorID> > lost;
+
+  foreachvalue (Framework* framework, frameworks) {
+    foreachvalue (Executor* executor, framework->executors) {
+      if (executor->recovered && !executor->pid) {
+        lost.push_back(make_pair(framework->id, executor->id));
+      }
+    }
+  }
 
+  typedef pair<FrameworkID, ExecutorID> Lost;
+  foreach (const Lost& executor, lost) {
+    LOG(WARNING) << "Executor '" << executor.second
+                 << "' of framework " << executor.first
+                 << " did not re-register after the slave restarted";
+
+    executorExited(executor.first, executor.second, -1);
+  }
+}
+
+
+string Slave::getWorkDirectory()
+{
   string workDir = "work";  // Default work directory.
 
   // Now look for configured work directory.
@@ -1400,8 +2355,18 @@ string Slave::createUniqueWorkDirectory(const FrameworkID& frameworkId,
     workDir = option.get();
   }
 
+  return workDir;
+}
+
+
+string Slave::createUniqueWorkDirectory(const FrameworkID& frameworkId,
+                                        const ExecutorID& executorId)
+{
+  LOG(INFO) << "Generating a unique work directory for executor '"
+            << executorId << "' of framework " << frameworkId;
+
   std::ostringstream out(std::ios_base::app | std::ios_base::out);
-  out << workDir << "/slaves/" << id
+  out << getWorkDirectory() << "/slaves/" << id
       << "/frameworks/" << frameworkId
       << "/executors/" << executorId;
 
@@ -19,16 +19,25 @@
 #ifndef __SLAVE_HPP__
 #define __SLAVE_HPP__
 
+#include <utility>
+#include <vector>
+
 #include <process/process.hpp>
 #include <process/protobuf.hpp>
 
 #include "slave/constants.hpp"
+#include "slave/gc.hpp"
 #include "slave/http.hpp"
 #include "slave/isolation_module.hpp"
+#include "slave/status_update_stream.hpp"
 
 #include "common/attributes.hpp"
+#include "common/backoff.hpp"
 #include "common/resources.hpp"
+#include "common/statistics.hpp"
+#include "common/flathashmap.hpp"
 #include "common/hashmap.hpp"
+#include "common/option.hpp"
 #include "common/type_utils.hpp"
 #include "common/uuid.hpp"
 
@@ -66,13 +75,16 @@ public:
   void newMasterDetected(const UPID& pid);
   void noMasterDetected();
   void masterDetectionFailure();
-  void registered(const SlaveID& slaveId);
-  void reregistered(const SlaveID& slaveId);
+  void registered(const SlaveID& slaveId, const std::string& shard);
+  void reregistered(const SlaveID& slaveId, const std::string& shard);
   void doReliableRegistration();
+  void stateRequested(const SlaveID& slaveId);
   void runTask(const FrameworkInfo& frameworkInfo,
                const FrameworkID& frameworkId,
                const std::string& pid,
-               const TaskDescription& task);
+               const TaskDescription& task,
+               bool revocable);
+  void runTasks(const RunTasksMessage& message);
   void killTask(const FrameworkID& frameworkId,
                 const TaskID& taskId);
   void shutdownFramework(const FrameworkID& frameworkId);
@@ -86,16 +98,26 @@ public:
                                    const FrameworkID& frameworkId,
                                    const TaskID& taskId,
                                    const std::string& uuid);
+  void statusUpdateAcknowledgements(
+      const StatusUpdateAcknowledgementsMessage& message);
   void registerExecutor(const FrameworkID& frameworkId,
-                        const ExecutorID& executorId);
+                        const ExecutorID& executorId,
+                        bool direct,
+                        bool batches);
+  void reregisterExecutor(const FrameworkID& frameworkId,
+                          const ExecutorID& executorId,
+                          bool direct,
+                          bool batches);
   void statusUpdate(const StatusUpdate& update);
+  void statusUpdates(const std::vector<StatusUpdate>& updates);
   void executorMessage(const SlaveID& slaveId,
                        const FrameworkID& frameworkId,
                        const ExecutorID& executorId,
                        const std::string& data);
   void ping(const UPID& from, const std::string& body);
 
-  void statusUpdateTimeout(const FrameworkID& frameworkId, const UUID& uuid);
+  void statusUpdatesTimeout(
+      const std::vector<std::pair<FrameworkID, uint64_t> >& updates);
 
   void executorStarted(const FrameworkID& frameworkId,
                        const ExecutorID& executorId,
@@ -105,6 +127,21 @@ public:
                       const ExecutorID& executorId,
                       int status);
 
+  // Records the resources executors used (as last sampled by the
+  // isolation module), which get sent to the master with each "PONG"
+  // (along with the slack), and preempts revocable executors if the
+  // slack they're running on has shrunk.
+  void executorUsage(const std::vector<ExecutorUsage>& usages);
+
+  // Tells the framework (through the master) that the executor is
+  // using 'mem' MB of its 'limit' MB of memory, or, if the executor is
+  // getting killed for running out of memory, fails its running tasks.
+  void executorMemoryPressure(const FrameworkID& frameworkId,
+                              const ExecutorID& executorId,
+                              double mem,
+                              double limit,
+                              bool killed);
+
 protected:
   virtual void initialize();
   virtual void finalize();
@@ -113,6 +150,39 @@ protected:
   // Helper routine to lookup a framework.
   Framework* getFramework(const FrameworkID& frameworkId);
 
+  // Returns the message to re-register with, including the state
+  // (this slave's info, executors and tasks) and its digest.
+  ReregisterSlaveMessage reregistration();
+
+  // Gives a task to the executor it's for, starting (and queuing the
+  // task for) the executor if necessary. Returns the executor if the
+  // task should be sent to it now, otherwise NULL.
+  Executor* assignTask(Framework* framework,
+                       const TaskDescription& task,
+                       bool revocable);
+
+  // Tells the isolation module about a change in an executor's
+  // resources: right away if they grew (the new tasks need them),
+  // otherwise after RESOURCES_CHANGED_INTERVAL_SECONDS, with whatever
+  // the resources are by then. Executors that run lots of short tasks
+  // then don't get their limits rewritten for every task.
+  void resourcesChanged(Framework* framework, Executor* executor);
+
+  // Tells the isolation module about the executor's current resources
+  // (if it's still the same instance of the executor).
+  void resourcesChangedTimeout(const FrameworkID& frameworkId,
+                               const ExecutorID& executorId,
+                               const UUID& uuid);
+
+  // Sends tasks to a registered executor, in a single message.
+  void sendTasks(Framework* framework,
+                 Executor* executor,
+                 const std::vector<TaskDescription>& tasks);
+
+  // Sends the status updates queued up by Slave::statusUpdate to the
+  // master in one message (and schedules a resend of them).
+  void flushStatusUpdates();
+
   // Shut down an executor. This is a two phase process. First, an
   // executor receives a shut down message (shut down phase), then
   // after a configurable timeout the slave actually forces a kill
@@ -120,11 +190,29 @@ protected:
   // exited.
   void shutdownExecutor(Framework* framework, Executor* executor);
 
-  // Handle the second phase of shutting down an executor for those
+  // Shut down several of a framework's executors at once, so that the
+  // ones that don't exit in time get killed at once too.
+  void shutdownExecutors(Framework* framework,
+                         const std::vector<Executor*>& executors);
+
+  // Handle the second phase of shutting down executors for those
   // executors that have not properly shutdown within a timeout.
-  void shutdownExecutorTimeout(const FrameworkID& frameworkId,
-                               const ExecutorID& executorId,
-                               const UUID& uuid);
+  void shutdownExecutorsTimeout(
+      const FrameworkID& frameworkId,
+      const std::vector<std::pair<ExecutorID, UUID> >& executors);
+
+  // Kills executors right away (all at once, via the isolation
+  // module) and tells the master that they exited.
+  void killExecutors(Framework* framework,
+                     const std::vector<ExecutorID>& executorIds);
+
+  // Returns the resources that (non-revocable) executors have been
+  // allocated but aren't using, as of their last usage samples.
+  Resources slack();
+
+  // Kills the most recently launched revocable executors until the
+  // rest of them fit in the slack.
+  void preempt();
 
 //   // Create a new status update stream.
 //   StatusUpdates* createStatusUpdateStream(const StatusUpdateStreamID& streamId,
@@ -132,6 +220,23 @@ protected:
 
 //   StatusUpdates* getStatusUpdateStream(const StatusUpdateStreamID& streamId);
 
+  // Schedules writing out the slave's state (see Slave::recover),
+  // once the messages that are already waiting have been handled
+  // rather than after every change.
+  void checkpoint();
+  void writeCheckpoint();
+
+  // Recovers the state checkpointed before the slave restarted and
+  // waits for the executors that are still running to re-register.
+  void recover();
+
+  // Gives up on the recovered executors that haven't re-registered.
+  void recoveryTimeout();
+
+  // Returns the directory (configured or default) that the executors'
+  // work directories go in.
+  std::string getWorkDirectory();
+
   // Helper function for generating a unique work directory for this
   // framework/executor pair (non-trivial since a framework/executor
   // pair may be launched more than once on the same slave).
@@ -146,6 +251,14 @@ private:
       const Slave& slave,
       const HttpRequest& request);
 
+  friend Future<HttpResponse> http::log(
+      const Slave& slave,
+      const HttpRequest& request);
+
+  friend Future<HttpResponse> http::file(
+      const Slave& slave,
+      const HttpRequest& request);
+
   friend Future<HttpResponse> http::json::stats(
       const Slave& slave,
       const HttpRequest& request);
@@ -163,25 +276,46 @@ private:
 
   UPID master;
 
+  // Where status updates get sent: the master, or the shard of the
+  // master that handles our status updates (see SlaveShard).
+  UPID shard;
+
   Resources resources;
   Attributes attributes;
+  std::vector<Reservation> reservations;
 
-  hashmap<FrameworkID, Framework*> frameworks;
+  flathashmap<FrameworkID, Framework*> frameworks;
 
   IsolationModule* isolationModule;
 
-  // Statistics (initialized in Slave::initialize).
-  struct {
-    uint64_t tasks[TaskState_ARRAYSIZE];
-    uint64_t validStatusUpdates;
-    uint64_t invalidStatusUpdates;
-    uint64_t validFrameworkMessages;
-    uint64_t invalidFrameworkMessages;
-  } stats;
+  // Deletes the work directories of executors that are done.
+  GarbageCollector* gc;
+
+  // Statistics (also exported at /metrics).
+  internal::Statistics stats;
 
   double startTime;
 
   bool connected; // Flag to indicate if slave is registered.
+
+  // Intervals between (re-)registration attempts.
+  Backoff registrationBackoff;
+
+  // Status updates waiting to be sent to the master, and which
+  // update of which framework's stream each of them is.
+  StatusUpdatesMessage pendingUpdates;
+  std::vector<std::pair<FrameworkID, uint64_t> > pendingSequences;
+
+  // Sequence number of the next status update (see StatusUpdate).
+  uint64_t nextSequence;
+
+  // Whether the slave's state gets checkpointed (and whether a write
+  // of it has been scheduled).
+  bool checkpointing;
+  bool checkpointPending;
+
+  // Recovered status updates, resent once re-registered.
+  std::vector<std::pair<FrameworkID, uint64_t> > recoveredUpdates;
 //   typedef std::pair<FrameworkID, TaskID> StatusUpdateStreamID;
 //   hashmap<std::pair<FrameworkID, TaskID>, StatusUpdateStream*> statusUpdateStreams;
 
@@ -194,15 +328,25 @@ struct Executor
 {
   Executor(const FrameworkID& _frameworkId,
            const ExecutorInfo& _info,
-           const std::string& _directory)
+           const std::string& _directory,
+           bool _revocable,
+           double _launched)
     : frameworkId(_frameworkId),
       info(_info),
       directory(_directory),
       id(_info.executor_id()),
       uuid(UUID::random()),
       pid(UPID()),
+      direct(false),
+      batches(false),
       shutdown(false),
-      resources(_info.resources()) {}
+      revocable(_revocable),
+      launched(_launched),
+      started(0),
+      recovered(false),
+      resources(_info.resources()),
+      isolated(_info.resources()),
+      resourcesPending(false) {}
 
   ~Executor()
   {
@@ -226,6 +370,7 @@ struct Executor
     t->mutable_task_id()->MergeFrom(task.task_id());
     t->mutable_slave_id()->MergeFrom(task.slave_id());
     t->mutable_resources()->MergeFrom(task.resources());
+    t->set_revocable(revocable);
 
     launchedTasks[task.task_id()] = t;
     resources += task.resources();
@@ -265,12 +410,39 @@ struct Executor
 
   UPID pid;
 
+  // Set if the executor talks to its scheduler directly, in which
+  // case it needs to hear about the scheduler failing over.
+  bool direct;
+
+  // Set if the executor's driver takes several tasks in one
+  // RunTasksMessage (see Slave::sendTasks).
+  bool batches;
+
   bool shutdown; // Indicates if executor is being shut down.
 
+  // Revocable executors run on other executors' slack (and get
+  // preempted when those executors need it back).
+  const bool revocable;
+  const double launched; // Time the executor was launched.
+  double started; // Time its process started (0 if not known).
+
+  // Set if the executor was running before the slave restarted, in
+  // which case the isolation module doesn't know about it (so the
+  // slave watches it, and asks it to exit rather than killing it).
+  bool recovered;
+
   Resources resources; // Currently consumed resources.
 
+  // Resources the isolation module was last told about, and whether
+  // it's due to be told about the current ones (see
+  // Slave::resourcesChanged).
+  Resources isolated;
+  bool resourcesPending;
+
+  Option<ExecutorUsage> usage; // Resources actually used (if sampled).
+
   hashmap<TaskID, TaskDescription> queuedTasks;
-  hashmap<TaskID, Task*> launchedTasks;
+  flathashmap<TaskID, Task*> launchedTasks;
 };
 
 
@@ -285,9 +457,12 @@ struct Framework
   ~Framework() {}
 
   Executor* createExecutor(const ExecutorInfo& executorInfo,
-                           const std::string& directory)
+                           const std::string& directory,
+                           bool revocable,
+                           double launched)
   {
-    Executor* executor = new Executor(id, executorInfo, directory);
+    Executor* executor =
+      new Executor(id, executorInfo, directory, revocable, launched);
     CHECK(!executors.contains(executorInfo.executor_id()));
     executors[executorInfo.executor_id()] = executor;
     return executor;
@@ -329,10 +504,10 @@ struct Framework
   UPID pid;
 
   // Current running executors.
-  hashmap<ExecutorID, Executor*> executors;
+  flathashmap<ExecutorID, Executor*> executors;
 
-  // Status updates keyed by uuid.
-  hashmap<UUID, StatusUpdate> updates;
+  // Status updates that haven't been acknowledged yet.
+  StatusUpdateStream updates;
 };
 
 }}}
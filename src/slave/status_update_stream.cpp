@@ -0,0 +1,149 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include "common/foreach.hpp"
+
+#include "slave/status_update_stream.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+void StatusUpdateStream::append(const StatusUpdate& update,
+                                uint64_t sequence)
+{
+  CHECK(entries.empty() || entries.back().update.sequence() < sequence);
+
+  entries.push_back(Entry());
+  entries.back().update.MergeFrom(update);
+  entries.back().update.set_sequence(sequence);
+  entries.back().acknowledged = false;
+
+  sequences[UUID::fromBytes(update.uuid())] = sequence;
+
+  pending++;
+}
+
+
+bool StatusUpdateStream::acknowledge(const UUID& uuid)
+{
+  hashmap<UUID, uint64_t>::iterator iterator = sequences.find(uuid);
+  if (iterator == sequences.end()) {
+    return false;
+  }
+
+  std::deque<Entry>::iterator entry = find(iterator->second);
+  CHECK(entry != entries.end());
+
+  acknowledge(&*entry);
+  compact();
+
+  return true;
+}
+
+
+size_t StatusUpdateStream::acknowledge(uint64_t begin, uint64_t end)
+{
+  size_t acknowledged = 0;
+
+  std::deque<Entry>::iterator entry = find(begin);
+  for (; entry != entries.end() && entry->update.sequence() <= end; ++entry) {
+    if (!entry->acknowledged) {
+      acknowledge(&*entry);
+      acknowledged++;
+    }
+  }
+
+  compact();
+
+  return acknowledged;
+}
+
+
+const StatusUpdate* StatusUpdateStream::get(uint64_t sequence) const
+{
+  std::deque<Entry>::const_iterator entry = find(sequence);
+  if (entry == entries.end() ||
+      entry->update.sequence() != sequence ||
+      entry->acknowledged) {
+    return NULL;
+  }
+
+  return &entry->update;
+}
+
+
+std::vector<StatusUpdate> StatusUpdateStream::updates() const
+{
+  std::vector<StatusUpdate> result;
+
+  foreach (const Entry& entry, entries) {
+    if (!entry.acknowledged) {
+      result.push_back(entry.update);
+    }
+  }
+
+  return result;
+}
+
+
+bool StatusUpdateStream::before(const Entry& entry, uint64_t sequence)
+{
+  return entry.update.sequence() < sequence;
+}
+
+
+std::deque<StatusUpdateStream::Entry>::iterator StatusUpdateStream::find(
+    uint64_t sequence)
+{
+  return std::lower_bound(entries.begin(), entries.end(), sequence, before);
+}
+
+
+std::deque<StatusUpdateStream::Entry>::const_iterator StatusUpdateStream::find(
+    uint64_t sequence) const
+{
+  return std::lower_bound(entries.begin(), entries.end(), sequence, before);
+}
+
+
+void StatusUpdateStream::acknowledge(Entry* entry)
+{
+  CHECK(!entry->acknowledged);
+  entry->acknowledged = true;
+  sequences.erase(UUID::fromBytes(entry->update.uuid()));
+  pending--;
+}
+
+
+void StatusUpdateStream::compact()
+{
+  while (!entries.empty() && entries.front().acknowledged) {
+    entries.pop_front();
+  }
+}
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,104 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __STATUS_UPDATE_STREAM_HPP__
+#define __STATUS_UPDATE_STREAM_HPP__
+
+#include <deque>
+#include <vector>
+
+#include "common/hashmap.hpp"
+#include "common/uuid.hpp"
+
+#include "messages/messages.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// The status updates of a framework that haven't been acknowledged
+// yet, in the order they were sent. Each update has a sequence number
+// (see StatusUpdate.sequence), which is what the slave and the
+// scheduler driver use to refer to (e.g., resend or acknowledge)
+// updates. Acknowledged updates are dropped as soon as every update
+// before them has been acknowledged too, so the stream only ever
+// holds the window of updates from the oldest unacknowledged one.
+class StatusUpdateStream
+{
+public:
+  StatusUpdateStream() : pending(0) {}
+
+  // Adds an update to the end of the stream. Sequence numbers need to
+  // increase (but don't need to be consecutive).
+  void append(const StatusUpdate& update, uint64_t sequence);
+
+  // Acknowledges an update, returning false if it isn't (or is no
+  // longer) in the stream.
+  bool acknowledge(const UUID& uuid);
+
+  // Acknowledges the updates with sequence numbers in [begin, end],
+  // returning how many of them weren't acknowledged yet.
+  size_t acknowledge(uint64_t begin, uint64_t end);
+
+  // Returns the update with the specified sequence number or NULL if
+  // it has already been acknowledged.
+  const StatusUpdate* get(uint64_t sequence) const;
+
+  // Returns the updates that haven't been acknowledged, in order.
+  std::vector<StatusUpdate> updates() const;
+
+  // Number of updates that haven't been acknowledged.
+  size_t size() const { return pending; }
+
+  bool empty() const { return pending == 0; }
+
+private:
+  struct Entry
+  {
+    StatusUpdate update;
+    bool acknowledged;
+  };
+
+  static bool before(const Entry& entry, uint64_t sequence);
+
+  // Returns the first entry with a sequence number of at least
+  // 'sequence' (or the end).
+  std::deque<Entry>::iterator find(uint64_t sequence);
+  std::deque<Entry>::const_iterator find(uint64_t sequence) const;
+
+  // Marks an entry as acknowledged.
+  void acknowledge(Entry* entry);
+
+  // Drops the acknowledged updates from the front of the stream.
+  void compact();
+
+  // Updates ordered by sequence number.
+  std::deque<Entry> entries;
+
+  // Sequence number of each (unacknowledged) update.
+  hashmap<UUID, uint64_t> sequences;
+
+  size_t pending;
+};
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __STATUS_UPDATE_STREAM_HPP__
@@ -0,0 +1,271 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "common/foreach.hpp"
+#include "common/strings.hpp"
+#include "common/utils.hpp"
+
+#include "slave/topology.hpp"
+
+using std::set;
+using std::string;
+using std::vector;
+
+
+namespace mesos {
+namespace internal {
+namespace slave {
+namespace topology {
+
+// Reads the (first line of the) file.
+static Try<string> read(const string& path)
+{
+  std::ifstream file(path.c_str());
+  if (!file.is_open()) {
+    return Try<string>::error("Failed to open " + path);
+  }
+
+  string line;
+  std::getline(file, line);
+  return line;
+}
+
+
+Try<vector<Node> > nodes()
+{
+  vector<Node> nodes;
+
+  const string directory = "/sys/devices/system/node";
+
+  foreach (const string& entry, utils::os::listdir(directory)) {
+    if (entry.find("node") != 0 ||
+        entry.find_first_not_of("0123456789", 4) != string::npos ||
+        entry.size() == 4) {
+      continue;
+    }
+
+    Try<string> list = read(directory + "/" + entry + "/cpulist");
+    if (list.isError()) {
+      return Try<vector<Node> >::error(list.error());
+    }
+
+    Try<set<int> > cpus = parse(list.get());
+    if (cpus.isError()) {
+      return Try<vector<Node> >::error(cpus.error());
+    }
+
+    // Nodes can have no CPUs (e.g., memory-only nodes).
+    if (!cpus.get().empty()) {
+      const set<int>& ids = cpus.get();
+      Node node;
+      node.id = atoi(entry.c_str() + 4);
+      node.cpus.assign(ids.begin(), ids.end());
+      nodes.push_back(node);
+    }
+  }
+
+  if (nodes.empty()) {
+    Try<string> list = read("/sys/devices/system/cpu/online");
+    if (list.isError()) {
+      return Try<vector<Node> >::error(list.error());
+    }
+
+    Try<set<int> > cpus = parse(list.get());
+    if (cpus.isError()) {
+      return Try<vector<Node> >::error(cpus.error());
+    }
+
+    const set<int>& all = cpus.get();
+    Node node;
+    node.id = 0;
+    node.cpus.assign(all.begin(), all.end());
+    nodes.push_back(node);
+  }
+
+  return nodes;
+}
+
+
+Try<set<int> > parse(const string& list)
+{
+  set<int> result;
+
+  foreach (const string& token, strings::split(strings::trim(list), ",")) {
+    const vector<string>& bounds = strings::split(token, "-");
+
+    if (bounds.size() < 1 || bounds.size() > 2) {
+      return Try<set<int> >::error("Failed to parse '" + list + "'");
+    }
+
+    Try<int> begin = utils::numify<int>(bounds[0]);
+    Try<int> end = utils::numify<int>(bounds.back());
+
+    if (begin.isError() || end.isError() || begin.get() > end.get()) {
+      return Try<set<int> >::error("Failed to parse '" + list + "'");
+    }
+
+    for (int i = begin.get(); i <= end.get(); i++) {
+      result.insert(i);
+    }
+  }
+
+  return result;
+}
+
+
+string format(const set<int>& list)
+{
+  std::ostringstream out;
+
+  set<int>::const_iterator it = list.begin();
+  while (it != list.end()) {
+    // Find the end of the run of consecutive numbers starting here.
+    const int begin = *it;
+    int end = begin;
+    while (++it != list.end() && *it == end + 1) {
+      end = *it;
+    }
+
+    if (begin != *list.begin()) {
+      out << ",";
+    }
+
+    out << begin;
+    if (end != begin) {
+      out << "-" << end;
+    }
+  }
+
+  return out.str();
+}
+
+
+set<int> place(const vector<Node>& nodes,
+               const set<int>& free,
+               const set<int>& current,
+               size_t count)
+{
+  set<int> cpus;
+  set<int> available = free; // Free CPUs that haven't been picked.
+
+  // Keep as many of the current CPUs as the container still gets,
+  // starting with the nodes it has the most CPUs on.
+  vector<std::pair<size_t, int> > used; // (CPUs, node index).
+  for (size_t i = 0; i < nodes.size(); i++) {
+    size_t n = 0;
+    foreach (int cpu, nodes[i].cpus) {
+      n += current.count(cpu);
+    }
+    if (n > 0) {
+      used.push_back(std::make_pair(n, (int) i));
+    }
+  }
+
+  std::sort(used.rbegin(), used.rend());
+
+  for (size_t i = 0; i < used.size() && cpus.size() < count; i++) {
+    foreach (int cpu, nodes[used[i].second].cpus) {
+      if (current.count(cpu) > 0 && cpus.size() < count) {
+        cpus.insert(cpu);
+      }
+    }
+  }
+
+  // Then fill up the nodes already used with free CPUs.
+  for (size_t i = 0; i < used.size() && cpus.size() < count; i++) {
+    foreach (int cpu, nodes[used[i].second].cpus) {
+      if (available.count(cpu) > 0 && cpus.size() < count) {
+        cpus.insert(cpu);
+        available.erase(cpu);
+      }
+    }
+  }
+
+  if (cpus.size() == count) {
+    return cpus;
+  }
+
+  // Order the rest of the nodes by their free CPUs: the node with the
+  // fewest that still fits the rest of the CPUs first, then the nodes
+  // with the most.
+  const size_t needed = count - cpus.size();
+
+  vector<std::pair<size_t, int> > fits;  // (Free CPUs, node index).
+  vector<std::pair<size_t, int> > others;
+  for (size_t i = 0; i < nodes.size(); i++) {
+    size_t n = 0;
+    foreach (int cpu, nodes[i].cpus) {
+      n += available.count(cpu);
+    }
+    if (n >= needed) {
+      fits.push_back(std::make_pair(n, (int) i));
+    } else if (n > 0) {
+      others.push_back(std::make_pair(n, (int) i));
+    }
+  }
+
+  std::sort(fits.begin(), fits.end());
+  std::sort(others.rbegin(), others.rend());
+
+  vector<int> order;
+  if (!fits.empty()) {
+    order.push_back(fits.front().second);
+  } else {
+    for (size_t i = 0; i < others.size(); i++) {
+      order.push_back(others[i].second);
+    }
+  }
+
+  foreach (int index, order) {
+    foreach (int cpu, nodes[index].cpus) {
+      if (available.count(cpu) > 0 && cpus.size() < count) {
+        cpus.insert(cpu);
+      }
+    }
+  }
+
+  return cpus;
+}
+
+
+set<int> mems(const vector<Node>& nodes, const set<int>& cpus)
+{
+  set<int> result;
+
+  foreach (const Node& node, nodes) {
+    foreach (int cpu, node.cpus) {
+      if (cpus.count(cpu) > 0) {
+        result.insert(node.id);
+        break;
+      }
+    }
+  }
+
+  return result;
+}
+
+} // namespace topology {
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,81 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __TOPOLOGY_HPP__
+#define __TOPOLOGY_HPP__
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "common/try.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace slave {
+namespace topology {
+
+// The CPUs of a NUMA node (i.e., of a socket, on most machines).
+struct Node
+{
+  int id;
+  std::vector<int> cpus;
+};
+
+
+// Returns the NUMA nodes of the machine and the CPUs that belong to
+// each (from /sys/devices/system/node), or a single node with all of
+// the online CPUs if the kernel doesn't know about NUMA.
+Try<std::vector<Node> > nodes();
+
+
+// Parses a list of CPUs (or nodes) in the kernel's format (e.g.,
+// "0-3,8,10-11", see cpuset(7)).
+Try<std::set<int> > parse(const std::string& list);
+
+
+// Formats a list of CPUs (or nodes) in the kernel's format, the
+// inverse of parse.
+std::string format(const std::set<int>& list);
+
+
+// Picks 'count' of the free CPUs for a container that has 'current'
+// ones already (and keeps or releases those first), so that
+// containers span as few nodes as possible: first the nodes the
+// container uses already, then the node with the fewest free CPUs
+// that still fits the rest (leaving the emptier nodes to bigger
+// containers), then the nodes with the most free CPUs. Returns fewer
+// than 'count' CPUs if there aren't enough free ones.
+std::set<int> place(const std::vector<Node>& nodes,
+                    const std::set<int>& free,
+                    const std::set<int>& current,
+                    size_t count);
+
+
+// Returns the nodes that the CPUs belong to (i.e., whose memory a
+// container running on them should use).
+std::set<int> mems(const std::vector<Node>& nodes,
+                   const std::set<int>& cpus);
+
+} // namespace topology {
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __TOPOLOGY_HPP__
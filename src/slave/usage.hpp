@@ -0,0 +1,222 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __USAGE_HPP__
+#define __USAGE_HPP__
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <sys/types.h>
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common/foreach.hpp"
+#include "common/resources.hpp"
+#include "common/try.hpp"
+#include "common/utils.hpp"
+
+#include "slave/constants.hpp"
+
+
+namespace mesos { namespace internal { namespace slave {
+
+// A sample of the resources used by an executor: the CPU time (in
+// seconds) its processes have used in total and the memory (in MB)
+// they're using at the time the sample is taken.
+struct UsageSample
+{
+  UsageSample(double _time = 0.0, double _cpuTime = 0.0, double _mem = 0.0)
+    : time(_time), cpuTime(_cpuTime), mem(_mem) {}
+
+  double time;
+  double cpuTime;
+  double mem;
+};
+
+
+// The most recent samples of an executor's usage (kept in a ring
+// buffer, so adding a sample never allocates).
+class UsageHistory
+{
+public:
+  explicit UsageHistory(size_t capacity = USAGE_HISTORY_SAMPLES)
+    : samples(capacity), next(0), count(0) {}
+
+  void add(const UsageSample& sample)
+  {
+    samples[next] = sample;
+    next = (next + 1) % samples.size();
+    if (count < samples.size()) {
+      count++;
+    }
+  }
+
+  size_t size() const { return count; }
+
+  // Returns the average number of CPUs used between the oldest and
+  // the most recent sample (or 0 if there are fewer than two).
+  double cpus() const
+  {
+    if (count < 2) {
+      return 0.0;
+    }
+
+    const UsageSample& first = oldest();
+    const UsageSample& last = latest();
+
+    if (last.time <= first.time) {
+      return 0.0;
+    }
+
+    return (last.cpuTime - first.cpuTime) / (last.time - first.time);
+  }
+
+  // Returns the memory used as of the most recent sample.
+  double mem() const
+  {
+    return count > 0 ? latest().mem : 0.0;
+  }
+
+private:
+  const UsageSample& oldest() const
+  {
+    return samples[(next + samples.size() - count) % samples.size()];
+  }
+
+  const UsageSample& latest() const
+  {
+    return samples[(next + samples.size() - 1) % samples.size()];
+  }
+
+  std::vector<UsageSample> samples;
+  size_t next; // Where the next sample goes.
+  size_t count;
+};
+
+
+// Samples the usage of a process (and its children that have been
+// waited for) from /proc, optionally returning its session too.
+inline Try<UsageSample> sample(pid_t pid, double time, pid_t* session = NULL)
+{
+  const std::string& path = "/proc/" + utils::stringify(pid) + "/stat";
+
+  std::ifstream file(path.c_str());
+  std::string line;
+  if (!std::getline(file, line)) {
+    return Try<UsageSample>::error("Failed to read " + path);
+  }
+
+  // Skip the pid and command name (which might contain spaces), the
+  // remaining fields start with the state (see proc(5)).
+  size_t paren = line.rfind(')');
+  if (paren == std::string::npos) {
+    return Try<UsageSample>::error("Failed to parse " + path);
+  }
+
+  std::istringstream in(line.substr(paren + 1));
+  std::vector<std::string> fields;
+  std::string field;
+  while (in >> field) {
+    fields.push_back(field);
+  }
+
+  // Fields (counting from the state): session (3), utime (11), stime
+  // (12), cutime (13) and cstime (14) in clock ticks and rss (21) in
+  // pages.
+  if (fields.size() < 22) {
+    return Try<UsageSample>::error("Failed to parse " + path);
+  }
+
+  if (session != NULL) {
+    *session = atoi(fields[3].c_str());
+  }
+
+  double ticks = 0.0;
+  for (size_t i = 11; i <= 14; i++) {
+    ticks += atof(fields[i].c_str());
+  }
+
+  double pages = atof(fields[21].c_str());
+
+  return UsageSample(time,
+                     ticks / sysconf(_SC_CLK_TCK),
+                     pages * sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0));
+}
+
+// Samples the usage of every session (i.e., of all the processes in
+// it) at once, keyed by the session ID. Executors are launched in
+// their own session, so this covers the processes they fork.
+inline std::map<pid_t, UsageSample> sessions(double time)
+{
+  std::map<pid_t, UsageSample> samples;
+
+  foreach (const std::string& entry, utils::os::listdir("/proc")) {
+    pid_t pid = atoi(entry.c_str());
+    if (pid <= 0) {
+      continue; // Not a process.
+    }
+
+    pid_t session;
+    Try<UsageSample> usage = sample(pid, time, &session);
+    if (usage.isSome()) {
+      UsageSample& total = samples[session];
+      total.time = time;
+      total.cpuTime += usage.get().cpuTime;
+      total.mem += usage.get().mem;
+    }
+  }
+
+  return samples;
+}
+
+
+// Returns the CPUs and memory that an executor has been allocated but
+// isn't using (i.e., that could be lent out to revocable executors).
+inline Resources slack(const Resources& allocated, double cpus, double mem)
+{
+  Value::Scalar none;
+
+  double idle[] = {
+    allocated.get("cpus", none).value() - cpus,
+    allocated.get("mem", none).value() - mem
+  };
+
+  const char* names[] = { "cpus", "mem" };
+
+  Resources resources;
+  for (size_t i = 0; i < 2; i++) {
+    if (idle[i] > 0.0) {
+      Resource resource;
+      resource.set_name(names[i]);
+      resource.set_type(Value::SCALAR);
+      resource.mutable_scalar()->set_value(idle[i]);
+      resources += resource;
+    }
+  }
+
+  return resources;
+}
+
+}}} // namespace mesos { namespace internal { namespace slave {
+
+#endif // __USAGE_HPP__
@@ -16,26 +16,35 @@
  * limitations under the License.
  */
 
-#ifndef __SLAVE_WEBUI_HPP__
-#define __SLAVE_WEBUI_HPP__
+#include <gmock/gmock.h>
 
-#ifdef MESOS_WEBUI
+#include "common/backoff.hpp"
 
-#include <process/process.hpp>
+using namespace mesos;
+using namespace mesos::internal;
 
-#include "slave.hpp"
 
-namespace mesos {
-namespace internal {
-namespace slave {
-namespace webui {
+TEST(BackoffTest, Intervals)
+{
+  Backoff backoff(1.0, 8.0);
 
-void start(const process::PID<Slave>& slave, const Configuration& conf);
+  double bounds[] = { 1.0, 2.0, 4.0, 8.0, 8.0 };
 
-} // namespace webui {
-} // namespace slave {
-} // namespace internal {
-} // namespace mesos {
+  for (int i = 0; i < 5; i++) {
+    double interval = backoff.next();
+    EXPECT_LE(bounds[i] / 2, interval);
+    EXPECT_GT(bounds[i], interval);
+  }
 
-#endif // MESOS_WEBUI
-#endif // __SLAVE_WEBUI_HPP__
+  backoff.reset();
+
+  double interval = backoff.next();
+  EXPECT_LE(0.5, interval);
+  EXPECT_GT(1.0, interval);
+
+  for (int i = 0; i < 100; i++) {
+    double jitter = backoff.jitter(3.0);
+    EXPECT_LE(0.0, jitter);
+    EXPECT_GT(3.0, jitter);
+  }
+}
@@ -824,3 +824,67 @@ TEST(FaultToleranceTest, SlaveReregister)
 
   process::filter(NULL);
 }
+
+
+TEST(FaultToleranceTest, SlaveReregisterWithNewMaster)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  MockFilter filter;
+  process::filter(&filter);
+
+  EXPECT_MESSAGE(filter, _, _, _)
+    .WillRepeatedly(Return(false));
+
+  trigger slaveRegisteredMsg;
+
+  EXPECT_MESSAGE(filter, Eq(SlaveRegisteredMessage().GetTypeName()), _, _)
+    .WillOnce(DoAll(Trigger(&slaveRegisteredMsg), Return(false)));
+
+  SimpleAllocator a1;
+  Master m1(&a1);
+  PID<Master> master1 = process::spawn(&m1);
+
+  ProcessBasedIsolationModule isolationModule;
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector1(master1, slave, true);
+
+  WAIT_UNTIL(slaveRegisteredMsg);
+
+  process::terminate(master1);
+  process::wait(master1);
+
+  // The new master only gets the digest of the slave's state at
+  // first, so it has to ask for the state before re-adding the slave.
+  trigger requestSlaveStateMsg;
+
+  EXPECT_MESSAGE(filter, Eq(RequestSlaveStateMessage().GetTypeName()), _, _)
+    .WillOnce(DoAll(Trigger(&requestSlaveStateMsg), Return(false)));
+
+  trigger slaveReregisteredMsg;
+
+  EXPECT_MESSAGE(filter, Eq(SlaveReregisteredMessage().GetTypeName()), _, _)
+    .WillOnce(DoAll(Trigger(&slaveReregisteredMsg), Return(false)));
+
+  SimpleAllocator a2;
+  Master m2(&a2);
+  PID<Master> master2 = process::spawn(&m2);
+
+  BasicMasterDetector detector2(master2, slave, true);
+
+  WAIT_UNTIL(requestSlaveStateMsg);
+  WAIT_UNTIL(slaveReregisteredMsg);
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master2);
+  process::wait(master2);
+
+  process::filter(NULL);
+}
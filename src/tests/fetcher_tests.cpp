@@ -0,0 +1,139 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <process/http.hpp>
+#include <process/process.hpp>
+
+#include "common/utils.hpp"
+
+#include "launcher/fetcher.hpp"
+
+using namespace mesos::internal;
+
+using mesos::internal::launcher::Fetcher;
+
+using process::Future;
+using process::HttpOKResponse;
+using process::HttpRequest;
+using process::HttpResponse;
+using process::PID;
+
+using std::string;
+
+
+class ExecutorServer : public process::Process<ExecutorServer>
+{
+public:
+  static const string EXECUTOR;
+
+protected:
+  virtual void initialize()
+  {
+    route("executor", &ExecutorServer::executor);
+    route("truncated", &ExecutorServer::truncated);
+  }
+
+private:
+  Future<HttpResponse> executor(const HttpRequest& request)
+  {
+    HttpOKResponse response;
+    response.body = EXECUTOR;
+    return response;
+  }
+
+  // Claims more of a body than it sends (like a server that went away
+  // partway through a response).
+  Future<HttpResponse> truncated(const HttpRequest& request)
+  {
+    HttpOKResponse response;
+    response.body = EXECUTOR;
+    response.headers["Content-Length"] =
+      utils::stringify(EXECUTOR.size() + 100);
+    return response;
+  }
+};
+
+
+const string ExecutorServer::EXECUTOR = "#!/bin/sh\necho executor\n";
+
+
+// Returns the http:// URI of one of the server's endpoints.
+static string uri(const PID<ExecutorServer>& pid, const string& name)
+{
+  in_addr address;
+  address.s_addr = pid.ip;
+
+  std::ostringstream out;
+  out << "http://" << inet_ntoa(address) << ":" << pid.port
+      << "/" << pid.id << "/" << name;
+  return out.str();
+}
+
+
+TEST(FetcherTest, Remote)
+{
+  EXPECT_TRUE(Fetcher::remote("hdfs://namenode/executor.tgz"));
+  EXPECT_TRUE(Fetcher::remote("http://host:8080/executor"));
+  EXPECT_TRUE(Fetcher::remote("s3://bucket/executor"));
+  EXPECT_FALSE(Fetcher::remote("/usr/local/executor"));
+  EXPECT_FALSE(Fetcher::remote("frameworks/executor.tgz"));
+}
+
+
+TEST(FetcherTest, DownloadOverHttp)
+{
+  ExecutorServer server;
+  PID<ExecutorServer> pid = process::spawn(server);
+
+  const string path = "fetcher_tests_executor";
+
+  Fetcher fetcher("hadoop");
+  Try<bool> result = fetcher.download(uri(pid, "executor"), path);
+  ASSERT_TRUE(result.isSome()) << result.error();
+
+  std::ifstream in(path.c_str());
+  std::ostringstream contents;
+  contents << in.rdbuf();
+  EXPECT_EQ(ExecutorServer::EXECUTOR, contents.str());
+
+  utils::os::rm(path);
+
+  // Endpoints that don't exist are an error (404), not an empty file.
+  result = fetcher.download(uri(pid, "missing"), path);
+  EXPECT_TRUE(result.isError());
+
+  utils::os::rm(path);
+
+  // So is a body that ends short of its Content-Length.
+  result = fetcher.download(uri(pid, "truncated"), path);
+  EXPECT_TRUE(result.isError());
+
+  utils::os::rm(path);
+
+  process::terminate(server);
+  process::wait(server);
+}
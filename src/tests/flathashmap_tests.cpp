@@ -0,0 +1,158 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "common/flathashmap.hpp"
+#include "common/flathashset.hpp"
+#include "common/foreach.hpp"
+
+using std::map;
+using std::set;
+using std::string;
+
+
+TEST(FlatHashMapTest, PutGet)
+{
+  flathashmap<string, int> map;
+
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.get("foo").isNone());
+
+  map.put("foo", 1);
+  map.put("bar", 2);
+
+  EXPECT_EQ(2, map.size());
+  EXPECT_TRUE(map.contains("foo"));
+  EXPECT_EQ(1, map.get("foo").get());
+  EXPECT_EQ(2, map["bar"]);
+
+  // Putting again replaces the value.
+  map.put("foo", 3);
+  EXPECT_EQ(2, map.size());
+  EXPECT_EQ(3, map.get("foo").get());
+
+  EXPECT_EQ(1, map.erase("foo"));
+  EXPECT_EQ(0, map.erase("foo"));
+  EXPECT_FALSE(map.contains("foo"));
+  EXPECT_EQ(1, map.size());
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_FALSE(map.contains("bar"));
+}
+
+
+TEST(FlatHashMapTest, Iterate)
+{
+  flathashmap<int, int> map;
+
+  int sum = 0;
+  for (int i = 0; i < 1000; i++) {
+    map[i] = i * 2;
+    sum += i * 2;
+  }
+
+  int keys = 0;
+  int values = 0;
+  foreachpair (int key, int value, map) {
+    EXPECT_EQ(key * 2, value);
+    keys++;
+    values += value;
+  }
+
+  EXPECT_EQ(1000, keys);
+  EXPECT_EQ(sum, values);
+
+  // Erasing while iterating doesn't skip anything.
+  flathashmap<int, int>::iterator it = map.begin();
+  while (it != map.end()) {
+    if (it->first % 2 == 0) {
+      map.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+
+  EXPECT_EQ(500, map.size());
+  foreachpair (int key, int value, map) {
+    EXPECT_EQ(1, key % 2);
+    EXPECT_EQ(key * 2, value);
+  }
+}
+
+
+// Compares random inserts and erases (including of pointers, whose
+// hashes aren't spread around by Boost) against a std::map.
+TEST(FlatHashMapTest, Random)
+{
+  flathashmap<int*, int> map;
+  std::map<int*, int> expected;
+
+  int* base = (int*) 0x1000;
+
+  srand(42);
+  for (int i = 0; i < 100000; i++) {
+    int* key = base + (rand() % 5000) * 4;
+    if (rand() % 3 == 0) {
+      EXPECT_EQ(expected.erase(key), map.erase(key));
+    } else {
+      map[key] = i;
+      expected[key] = i;
+    }
+  }
+
+  ASSERT_EQ(expected.size(), map.size());
+
+  foreachpair (int* key, int value, expected) {
+    ASSERT_TRUE(map.contains(key));
+    EXPECT_EQ(value, map.find(key)->second);
+  }
+}
+
+
+TEST(FlatHashSetTest, InsertErase)
+{
+  flathashset<string> set;
+
+  EXPECT_TRUE(set.insert("foo").second);
+  EXPECT_FALSE(set.insert("foo").second);
+  EXPECT_TRUE(set.insert("bar").second);
+
+  EXPECT_EQ(2, set.size());
+  EXPECT_TRUE(set.contains("foo"));
+  EXPECT_TRUE(set.find("baz") == set.end());
+
+  std::set<string> elems;
+  foreach (const string& elem, set) {
+    elems.insert(elem);
+  }
+
+  EXPECT_EQ(2, elems.size());
+  EXPECT_EQ(1, elems.count("bar"));
+
+  EXPECT_EQ(1, set.erase("foo"));
+  EXPECT_FALSE(set.contains("foo"));
+  EXPECT_EQ(1, set.size());
+}
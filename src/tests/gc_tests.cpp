@@ -0,0 +1,147 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <process/dispatch.hpp>
+#include <process/process.hpp>
+#include <process/timer.hpp>
+
+#include "common/utils.hpp"
+#include "common/uuid.hpp"
+
+#include "messages/messages.hpp"
+
+#include "slave/constants.hpp"
+#include "slave/gc.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+
+using mesos::internal::slave::GarbageCollector;
+
+using std::string;
+
+
+// Waits (a few collector intervals at most) for a directory to go.
+static bool removed(const string& directory)
+{
+  for (int i = 0; i < 100; i++) {
+    if (!utils::os::exists(directory)) {
+      return true;
+    }
+    usleep((useconds_t) (slave::GC_INTERVAL_SECONDS * 30000));
+  }
+  return false;
+}
+
+
+TEST(GarbageCollectorTest, DeletesScheduledDirectories)
+{
+  const string work = "/tmp/mesos-gc-" + UUID::random().toString();
+  const string directory = work + "/slaves/0/runs/0";
+
+  ASSERT_TRUE(utils::os::mkdir(directory + "/nested"));
+
+  GarbageCollector gc(work, 0.0, 1.0, 100.0);
+  process::spawn(gc);
+
+  process::dispatch(gc, &GarbageCollector::schedule, directory);
+
+  EXPECT_TRUE(removed(directory));
+  EXPECT_TRUE(utils::os::exists(work + "/slaves/0/runs"));
+
+  process::terminate(gc);
+  process::wait(gc);
+
+  utils::os::rmdir(work);
+}
+
+
+TEST(GarbageCollectorTest, DeletesSoonerWhenDiskIsFull)
+{
+  const string work = "/tmp/mesos-gc-" + UUID::random().toString();
+  const string directory = work + "/runs/0";
+
+  ASSERT_TRUE(utils::os::mkdir(directory));
+
+  // The disk is always "full" with a watermark of 0.
+  GarbageCollector gc(work, 3600.0, 0.0, 100.0);
+  process::spawn(gc);
+
+  process::dispatch(gc, &GarbageCollector::schedule, directory);
+
+  EXPECT_TRUE(removed(directory));
+
+  process::terminate(gc);
+  process::wait(gc);
+
+  utils::os::rmdir(work);
+}
+
+
+TEST(GarbageCollectorTest, RecoversScheduledDirectories)
+{
+  const string work = "/tmp/mesos-gc-" + UUID::random().toString();
+  const string old = work + "/runs/0";
+  const string recent = work + "/runs/1";
+
+  ASSERT_TRUE(utils::os::mkdir(old));
+  ASSERT_TRUE(utils::os::mkdir(recent));
+
+  // Checkpoint the directories as a collector would have.
+  GarbageCollectorState state;
+  GarbageCollectorState::Directory* directory = state.add_directories();
+  directory->set_path(old);
+  directory->set_time(0);
+  directory = state.add_directories();
+  directory->set_path(recent);
+  directory->set_time(process::Clock::now());
+
+  Result<bool> result = utils::protobuf::write(work + "/gc", state);
+  ASSERT_TRUE(result.isSome() && result.get());
+
+  GarbageCollector gc(work, 3600.0, 1.0, 100.0);
+  process::spawn(gc);
+
+  // Only the directory that has been scheduled long enough goes.
+  EXPECT_TRUE(removed(old));
+  EXPECT_TRUE(utils::os::exists(recent));
+
+  // The deleted directory gets dropped from the checkpoint.
+  for (int i = 0; i < 100; i++) {
+    result = utils::protobuf::read(work + "/gc", &state);
+    ASSERT_TRUE(result.isSome() && result.get());
+    if (state.directories_size() == 1) {
+      break;
+    }
+    usleep(10000);
+  }
+
+  ASSERT_EQ(1, state.directories_size());
+  EXPECT_EQ(recent, state.directories(0).path());
+
+  process::terminate(gc);
+  process::wait(gc);
+
+  utils::os::rmdir(work);
+}
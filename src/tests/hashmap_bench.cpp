@@ -0,0 +1,192 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares 'hashmap' (boost::unordered_map) with 'flathashmap' on
+// what the master and allocators do most with their tables: looking
+// up (and failing to look up) entries and iterating over all of them,
+// with pointer keys (e.g., Offer*, Framework*) and ID keys (e.g.,
+// TaskID). Each result gets printed as one JSON object per line.
+//
+// Usage: mesos-hashmap-bench [entries...] (default: 100000 1000000)
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <mesos/mesos.hpp>
+
+#include "common/flathashmap.hpp"
+#include "common/foreach.hpp"
+#include "common/hashmap.hpp"
+#include "common/timer.hpp"
+#include "common/type_utils.hpp"
+#include "common/utils.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+
+// Keeps the compiler from optimizing the lookups away.
+static volatile size_t sink = 0;
+
+
+static void report(const string& benchmark,
+                   const string& map,
+                   size_t entries,
+                   size_t operations,
+                   const nanoseconds& elapsed)
+{
+  cout << std::fixed << std::setprecision(3)
+       << "{\"benchmark\": \"" << benchmark << "\""
+       << ", \"map\": \"" << map << "\""
+       << ", \"entries\": " << entries
+       << ", \"ns_per_operation\": " << elapsed.value / operations
+       << "}" << endl;
+}
+
+
+template <typename Map, typename Key>
+void benchmark(const string& name,
+               const string& map,
+               const vector<Key>& keys,
+               const vector<Key>& misses)
+{
+  // Look up the keys in a different order than they got inserted.
+  vector<Key> shuffled = keys;
+  std::random_shuffle(shuffled.begin(), shuffled.end());
+
+  Map m;
+
+  Timer timer;
+  timer.start();
+  for (size_t i = 0; i < keys.size(); i++) {
+    m[keys[i]] = i;
+  }
+  timer.stop();
+  report(name + "_insert", map, keys.size(), keys.size(), timer.elapsed());
+
+  timer.start();
+  size_t found = 0;
+  foreach (const Key& key, shuffled) {
+    typename Map::const_iterator it = m.find(key);
+    if (it != m.end()) {
+      found += it->second;
+    }
+  }
+  timer.stop();
+  sink += found;
+  report(name + "_lookup", map, keys.size(), keys.size(), timer.elapsed());
+
+  timer.start();
+  found = 0;
+  foreach (const Key& key, misses) {
+    found += m.count(key);
+  }
+  timer.stop();
+  sink += found;
+  report(name + "_miss", map, keys.size(), misses.size(), timer.elapsed());
+
+  // Iterate a few times since it's much faster than the lookups.
+  const int iterations = 10;
+  timer.start();
+  for (int i = 0; i < iterations; i++) {
+    size_t sum = 0;
+    foreachvalue (size_t value, m) {
+      sum += value;
+    }
+    sink += sum;
+  }
+  timer.stop();
+  report(name + "_iterate", map, keys.size(),
+         keys.size() * iterations, timer.elapsed());
+
+  timer.start();
+  foreach (const Key& key, shuffled) {
+    m.erase(key);
+  }
+  timer.stop();
+  report(name + "_erase", map, keys.size(), keys.size(), timer.elapsed());
+}
+
+
+int main(int argc, char** argv)
+{
+  vector<size_t> sizes;
+  for (int i = 1; i < argc; i++) {
+    const int size = atoi(argv[i]);
+    if (size <= 0) {
+      cerr << "Usage: " << argv[0] << " [entries...]" << endl;
+      return 1;
+    }
+    sizes.push_back(size);
+  }
+
+  if (sizes.empty()) {
+    sizes.push_back(100000);
+    sizes.push_back(1000000);
+  }
+
+  srand(42);
+
+  foreach (size_t size, sizes) {
+    // Pointers to (heap allocated) objects, like the master's Offer*.
+    vector<int*> objects;
+    for (size_t i = 0; i < 2 * size; i++) {
+      objects.push_back(new int(i));
+    }
+
+    const vector<int*> pointers(objects.begin(), objects.begin() + size);
+    const vector<int*> missingPointers(objects.begin() + size, objects.end());
+
+    benchmark<hashmap<int*, size_t> >(
+        "pointer", "hashmap", pointers, missingPointers);
+    benchmark<flathashmap<int*, size_t> >(
+        "pointer", "flathashmap", pointers, missingPointers);
+
+    foreach (int* object, objects) {
+      delete object;
+    }
+
+    // IDs like the ones the master generates.
+    vector<TaskID> ids;
+    vector<TaskID> missingIds;
+    for (size_t i = 0; i < size; i++) {
+      TaskID id;
+      id.set_value("task-" + utils::stringify(i));
+      ids.push_back(id);
+      id.set_value("missing-" + utils::stringify(i));
+      missingIds.push_back(id);
+    }
+
+    benchmark<hashmap<TaskID, size_t> >("id", "hashmap", ids, missingIds);
+    benchmark<flathashmap<TaskID, size_t> >(
+        "id", "flathashmap", ids, missingIds);
+  }
+
+  return 0;
+}
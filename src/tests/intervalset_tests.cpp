@@ -0,0 +1,102 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <gtest/gtest.h>
+
+#include "common/intervalset.hpp"
+#include "common/utils.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+
+
+TEST(IntervalSet, Add)
+{
+  intervalset<uint64_t> set;
+  EXPECT_TRUE(set.empty());
+
+  set.add(5);
+  set.add(1, 3);
+  EXPECT_EQ(3u, set.size());
+  EXPECT_EQ("{[1, 3), [5, 6)}", utils::stringify(set));
+
+  // Abutting intervals get merged.
+  set.add(3);
+  EXPECT_EQ("{[1, 4), [5, 6)}", utils::stringify(set));
+
+  // As do overlapping ones.
+  set.add(0, 10);
+  EXPECT_EQ(10u, set.size());
+  EXPECT_EQ("{[0, 10)}", utils::stringify(set));
+
+  // Adding what's already there doesn't change anything.
+  set.add(2, 7);
+  EXPECT_EQ(10u, set.size());
+
+  set.add(20, 1000020);
+  EXPECT_EQ(1000010u, set.size());
+  EXPECT_EQ(2, std::distance(set.begin(), set.end()));
+}
+
+
+TEST(IntervalSet, Remove)
+{
+  intervalset<uint64_t> set;
+  set.add(0, 10);
+  set.add(20, 30);
+
+  // Removing from the middle splits the interval.
+  set.remove(5);
+  EXPECT_EQ(19u, set.size());
+  EXPECT_EQ("{[0, 5), [6, 10), [20, 30)}", utils::stringify(set));
+
+  set.remove(8, 25);
+  EXPECT_EQ("{[0, 5), [6, 8), [25, 30)}", utils::stringify(set));
+
+  // Removing what isn't there doesn't change anything.
+  set.remove(10, 20);
+  EXPECT_EQ(12u, set.size());
+
+  set.remove(0, 100);
+  EXPECT_TRUE(set.empty());
+  EXPECT_EQ(0u, set.size());
+}
+
+
+TEST(IntervalSet, Contains)
+{
+  intervalset<uint64_t> set;
+  set.add(0);
+  set.add(5, 10);
+
+  EXPECT_TRUE(set.contains(0));
+  EXPECT_FALSE(set.contains(1));
+  EXPECT_FALSE(set.contains(4));
+  EXPECT_TRUE(set.contains(5));
+  EXPECT_TRUE(set.contains(9));
+  EXPECT_FALSE(set.contains(10));
+
+  intervalset<uint64_t> other;
+  other.add(5, 10);
+  EXPECT_NE(set, other);
+
+  other.add(0);
+  EXPECT_EQ(set, other);
+}
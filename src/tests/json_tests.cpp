@@ -0,0 +1,173 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <list>
+#include <sstream>
+#include <string>
+
+#include "common/json.hpp"
+
+using std::string;
+
+
+TEST(JSONTest, Writer)
+{
+  string out;
+  JSON::Writer writer(&out);
+
+  writer.beginObject();
+  writer.field("name", "foo");
+  writer.field("count", 42);
+  writer.key("values");
+  writer.beginArray();
+  writer.value(0.5);
+  writer.value(12345678901234ULL);
+  writer.beginObject();
+  writer.endObject();
+  writer.beginArray();
+  writer.endArray();
+  writer.null();
+  writer.endArray();
+  writer.field("active", true);
+  writer.endObject();
+
+  EXPECT_EQ("{\"name\":\"foo\",\"count\":42,"
+            "\"values\":[0.5,12345678901234,{},[],null],\"active\":1}", out);
+}
+
+
+TEST(JSONTest, WriterEscapesStrings)
+{
+  string out;
+  JSON::Writer writer(&out);
+
+  writer.value("a \"quoted\"\\path\n\x01");
+
+  EXPECT_EQ("\"a \\\"quoted\\\"\\\\path\\n\\u0001\"", out);
+}
+
+
+// The writer renders numbers like the (tree) renderer does.
+TEST(JSONTest, WriterMatchesRenderer)
+{
+  JSON::Object object;
+  object.values["pi"] = 3.14159265358979;
+  object.values["time"] = 1334000000.123;
+
+  std::ostringstream rendered;
+  JSON::render(rendered, object);
+
+  string out;
+  JSON::Writer writer(&out);
+  writer.beginObject();
+  writer.field("pi", 3.14159265358979);
+  writer.field("time", 1334000000.123);
+  writer.endObject();
+
+  EXPECT_EQ(rendered.str(), out);
+}
+
+
+TEST(JSONTest, Parse)
+{
+  Try<JSON::Value> parsed = JSON::parse(
+      " {\"name\": \"foo\", \"count\": -2.5e2, \"values\": [1, true, false,"
+      " null, {}, []], \"escaped\": \"a\\\"b\\\\c\\n\\u00e9\\ud83d\\ude00\"} ");
+
+  ASSERT_TRUE(parsed.isSome()) << parsed.error();
+
+  const JSON::Value& value = parsed.get();
+  const JSON::Object* object = boost::get<JSON::Object>(&value);
+  ASSERT_TRUE(object != NULL);
+  EXPECT_EQ(4, object->values.size());
+
+  const JSON::String* name =
+    boost::get<JSON::String>(&object->values.find("name")->second);
+  ASSERT_TRUE(name != NULL);
+  EXPECT_EQ("foo", name->value);
+
+  const JSON::Number* count =
+    boost::get<JSON::Number>(&object->values.find("count")->second);
+  ASSERT_TRUE(count != NULL);
+  EXPECT_EQ(-250, count->value);
+
+  const JSON::Array* values =
+    boost::get<JSON::Array>(&object->values.find("values")->second);
+  ASSERT_TRUE(values != NULL);
+  ASSERT_EQ(6, values->values.size());
+
+  std::list<JSON::Value>::const_iterator iterator = values->values.begin();
+  EXPECT_TRUE(boost::get<JSON::Number>(&*iterator++) != NULL);
+  EXPECT_TRUE(boost::get<JSON::True>(&*iterator++) != NULL);
+  EXPECT_TRUE(boost::get<JSON::False>(&*iterator++) != NULL);
+  EXPECT_TRUE(boost::get<JSON::Null>(&*iterator++) != NULL);
+  EXPECT_TRUE(boost::get<JSON::Object>(&*iterator++) != NULL);
+  EXPECT_TRUE(boost::get<JSON::Array>(&*iterator++) != NULL);
+
+  // Escapes get decoded, \u escapes (and surrogate pairs) into UTF-8.
+  const JSON::String* escaped =
+    boost::get<JSON::String>(&object->values.find("escaped")->second);
+  ASSERT_TRUE(escaped != NULL);
+  EXPECT_EQ("a\"b\\c\n\xc3\xa9\xf0\x9f\x98\x80", escaped->value);
+}
+
+
+// What gets written can be parsed back.
+TEST(JSONTest, ParseWritten)
+{
+  string out;
+  JSON::Writer writer(&out);
+
+  writer.beginObject();
+  writer.field("path", "a \"quoted\"\\path\n\x01");
+  writer.field("size", 12345.25);
+  writer.endObject();
+
+  Try<JSON::Value> parsed = JSON::parse(out);
+  ASSERT_TRUE(parsed.isSome()) << parsed.error();
+
+  const JSON::Value& value = parsed.get();
+  const JSON::Object* object = boost::get<JSON::Object>(&value);
+  ASSERT_TRUE(object != NULL);
+
+  EXPECT_EQ("a \"quoted\"\\path\n\x01",
+            boost::get<JSON::String>(
+                &object->values.find("path")->second)->value);
+  EXPECT_EQ(12345.25,
+            boost::get<JSON::Number>(
+                &object->values.find("size")->second)->value);
+}
+
+
+TEST(JSONTest, ParseErrors)
+{
+  const char* invalid[] = {
+    "", "{", "}", "[1,]", "{\"a\" 1}", "{\"a\": 1,}", "{1: 2}", "01",
+    "1.", "-", "1e", "+1", "tru", "\"abc", "\"\\x\"", "\"\\u12\"",
+    "\"\\ud83d\"", "\"a\nb\"", "[1] 2"
+  };
+
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+    EXPECT_TRUE(JSON::parse(invalid[i]).isError()) << invalid[i];
+  }
+
+  // Nesting too deeply is an error rather than a stack overflow.
+  EXPECT_TRUE(JSON::parse(string(100000, '[')).isError());
+}
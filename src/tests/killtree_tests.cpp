@@ -16,10 +16,82 @@
  * limitations under the License.
  */
 
+#include <signal.h>
+#include <unistd.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
 #include <gtest/gtest.h>
 
+#include <fstream>
+#include <string>
+
+#include "common/process_utils.hpp"
+#include "common/utils.hpp"
+
 #include "tests/external_test.hpp"
 
+using namespace mesos::internal;
+
 
 // Run a number of tests for the LXC isolation module.
 TEST_EXTERNAL(KillTree, KillTreeTest)
+
+
+#ifdef __linux__
+// Returns true if a process has exited (it might not be reaped yet).
+static bool exited(pid_t pid)
+{
+  std::ifstream file(("/proc/" + utils::stringify(pid) + "/stat").c_str());
+  std::string line;
+  if (!std::getline(file, line)) {
+    return true;
+  }
+  return line.substr(line.rfind(')') + 2, 1) == "Z";
+}
+
+
+TEST(KillTreeTest, KillsDescendants)
+{
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+
+  // Fork a child that forks a grandchild (and tells us its pid).
+  pid_t child = fork();
+  ASSERT_NE(-1, child);
+
+  if (child == 0) {
+    pid_t grandchild = fork();
+    if (grandchild == 0) {
+      while (true) sleep(1);
+    }
+    write(fds[1], &grandchild, sizeof(grandchild));
+    while (true) sleep(1);
+  }
+
+  pid_t grandchild;
+  ASSERT_EQ((ssize_t) sizeof(grandchild),
+            read(fds[0], &grandchild, sizeof(grandchild)));
+
+  close(fds[0]);
+  close(fds[1]);
+
+  // The children are in our own process group and session, which
+  // must not get killed.
+  Try<int> killed = utils::process::killtree(child, SIGKILL, true, true);
+  ASSERT_TRUE(killed.isSome()) << killed.error();
+  EXPECT_EQ(2, killed.get());
+
+  int status;
+  ASSERT_EQ(child, waitpid(child, &status, 0));
+  EXPECT_TRUE(WIFSIGNALED(status));
+  EXPECT_EQ(SIGKILL, WTERMSIG(status));
+
+  // The grandchild gets re-parented (and reaped) by init.
+  for (int i = 0; i < 100 && !exited(grandchild); i++) {
+    usleep(10000);
+  }
+  EXPECT_TRUE(exited(grandchild));
+}
+#endif // __linux__
@@ -20,10 +20,13 @@
 
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <process/future.hpp>
 #include <process/protobuf.hpp>
 
+#include "common/intervalset.hpp"
 #include "common/option.hpp"
 #include "common/type_utils.hpp"
 #include "common/utils.hpp"
@@ -170,6 +173,68 @@ TEST(ReplicaTest, Append)
 }
 
 
+TEST(ReplicaTest, BatchedWrites)
+{
+  const std::string path = utils::os::getcwd() + "/.log";
+
+  utils::os::rmdir(path);
+
+  const int id = 1;
+
+  {
+    Replica replica(path);
+
+    PromiseRequest request;
+    request.set_id(id);
+
+    Future<PromiseResponse> future =
+      protocol::promise(replica.pid(), request);
+
+    future.await(2.0);
+    ASSERT_TRUE(future.isReady());
+    EXPECT_TRUE(future.get().okay());
+
+    // Send all the writes before waiting on any of them so that they
+    // (likely) get persisted as part of the same batch.
+    std::list<Future<WriteResponse> > futures;
+
+    for (uint64_t position = 1; position <= 10; position++) {
+      WriteRequest request;
+      request.set_id(id);
+      request.set_position(position);
+      request.set_type(Action::APPEND);
+      request.mutable_append()->set_bytes(utils::stringify(position));
+      futures.push_back(protocol::write(replica.pid(), request));
+    }
+
+    uint64_t position = 1;
+    foreach (Future<WriteResponse>& future, futures) {
+      future.await(2.0);
+      ASSERT_TRUE(future.isReady());
+      EXPECT_TRUE(future.get().okay());
+      EXPECT_EQ(position++, future.get().position());
+    }
+  }
+
+  Replica replica(path);
+
+  Future<std::list<Action> > actions = replica.read(1, 10);
+  ASSERT_TRUE(actions.await(2.0));
+  ASSERT_TRUE(actions.isReady());
+  ASSERT_EQ(10, actions.get().size());
+
+  uint64_t position = 1;
+  foreach (const Action& action, actions.get()) {
+    EXPECT_EQ(position, action.position());
+    EXPECT_EQ(Action::APPEND, action.type());
+    EXPECT_EQ(utils::stringify(position), action.append().bytes());
+    position++;
+  }
+
+  utils::os::rmdir(path);
+}
+
+
 TEST(ReplicaTest, Recover)
 {
   const std::string path = utils::os::getcwd() + "/.log";
@@ -259,6 +324,211 @@ TEST(ReplicaTest, Recover)
 }
 
 
+TEST(ReplicaTest, RecoverHoles)
+{
+  const std::string path = utils::os::getcwd() + "/.log";
+
+  utils::os::rmdir(path);
+
+  const int id = 1;
+
+  {
+    Replica replica(path);
+
+    PromiseRequest request;
+    request.set_id(id);
+
+    Future<PromiseResponse> future =
+      protocol::promise(replica.pid(), request);
+
+    future.await(2.0);
+    ASSERT_TRUE(future.isReady());
+    EXPECT_TRUE(future.get().okay());
+
+    // Write (and learn) positions 1 and 5, leaving holes in between.
+    for (uint64_t position = 1; position <= 5; position += 4) {
+      WriteRequest request;
+      request.set_id(id);
+      request.set_position(position);
+      request.set_learned(true);
+      request.set_type(Action::APPEND);
+      request.mutable_append()->set_bytes("hello world");
+
+      Future<WriteResponse> future = protocol::write(replica.pid(), request);
+
+      future.await(2.0);
+      ASSERT_TRUE(future.isReady());
+      EXPECT_TRUE(future.get().okay());
+    }
+  }
+
+  // Recovering (from the metadata the replica kept) finds the same
+  // holes, ending and promise, every time.
+  for (int i = 0; i < 2; i++) {
+    Replica replica(path);
+
+    intervalset<uint64_t> expected;
+    expected.add(0);
+    expected.add(2, 5);
+
+    Future<intervalset<uint64_t> > missing = replica.missing(4);
+    ASSERT_TRUE(missing.await(2.0));
+    EXPECT_EQ(expected, missing.get());
+
+    Future<uint64_t> ending = replica.ending();
+    ASSERT_TRUE(ending.await(2.0));
+    EXPECT_EQ(5, ending.get());
+
+    Future<uint64_t> promised = replica.promised();
+    ASSERT_TRUE(promised.await(2.0));
+    EXPECT_EQ(id, promised.get());
+  }
+
+  utils::os::rmdir(path);
+}
+
+
+TEST(ReplicaTest, LearnRange)
+{
+  const std::string path = utils::os::getcwd() + "/.log";
+
+  utils::os::rmdir(path);
+
+  Replica replica(path);
+
+  PromiseRequest request;
+  request.set_id(1);
+
+  Future<PromiseResponse> future = protocol::promise(replica.pid(), request);
+
+  future.await(2.0);
+  ASSERT_TRUE(future.isReady());
+  EXPECT_TRUE(future.get().okay());
+
+  // Write positions 1, 2 and 4, learning all but position 2.
+  for (uint64_t position = 1; position <= 4; position++) {
+    if (position == 3) {
+      continue;
+    }
+
+    WriteRequest request;
+    request.set_id(1);
+    request.set_position(position);
+    request.set_learned(position != 2);
+    request.set_type(Action::APPEND);
+    request.mutable_append()->set_bytes("hello world");
+
+    Future<WriteResponse> future = protocol::write(replica.pid(), request);
+
+    future.await(2.0);
+    ASSERT_TRUE(future.isReady());
+    EXPECT_TRUE(future.get().okay());
+  }
+
+  // Learning a range (even past the end of the log) returns just
+  // the learned positions.
+  LearnRequest learn;
+  learn.set_position(0);
+  learn.set_end(10);
+
+  Future<LearnResponse> response = protocol::learn(replica.pid(), learn);
+
+  response.await(2.0);
+  ASSERT_TRUE(response.isReady());
+  EXPECT_TRUE(response.get().okay());
+  ASSERT_EQ(2, response.get().actions_size());
+  EXPECT_EQ(1, response.get().actions(0).position());
+  EXPECT_EQ(4, response.get().actions(1).position());
+
+  utils::os::rmdir(path);
+}
+
+
+TEST(ReplicaTest, NamedLogs)
+{
+  const std::string path = utils::os::getcwd() + "/.log";
+
+  utils::os::rmdir(path);
+
+  {
+    Replica replica(path);
+
+    // Write the same position of the default log and of a named log.
+    for (int i = 0; i < 2; i++) {
+      PromiseRequest request1;
+      request1.set_id(1);
+      if (i > 0) {
+        request1.set_log("other");
+      }
+
+      Future<PromiseResponse> future1 =
+        protocol::promise(replica.pid(), request1);
+
+      future1.await(2.0);
+      ASSERT_TRUE(future1.isReady());
+      EXPECT_TRUE(future1.get().okay());
+      EXPECT_EQ(0, future1.get().position());
+
+      WriteRequest request2;
+      request2.set_id(1);
+      request2.set_position(1);
+      request2.set_type(Action::APPEND);
+      request2.mutable_append()->set_bytes(i > 0 ? "other" : "default");
+      if (i > 0) {
+        request2.set_log("other");
+      }
+
+      Future<WriteResponse> future2 =
+        protocol::write(replica.pid(), request2);
+
+      future2.await(2.0);
+      ASSERT_TRUE(future2.isReady());
+      EXPECT_TRUE(future2.get().okay());
+    }
+
+    // A promise for one log is no promise for another.
+    PromiseRequest request;
+    request.set_id(2);
+    request.set_log("another");
+
+    Future<PromiseResponse> future = protocol::promise(replica.pid(), request);
+
+    future.await(2.0);
+    ASSERT_TRUE(future.isReady());
+    EXPECT_TRUE(future.get().okay());
+    EXPECT_EQ(0, future.get().position());
+
+    Future<uint64_t> promised = replica.promised();
+    ASSERT_TRUE(promised.await(2.0));
+    EXPECT_EQ(1, promised.get());
+  }
+
+  Replica replica(path);
+
+  Future<std::list<Action> > actions1 = replica.read(1, 1);
+  ASSERT_TRUE(actions1.await(2.0));
+  ASSERT_TRUE(actions1.isReady());
+  ASSERT_EQ(1, actions1.get().size());
+  EXPECT_EQ("default", actions1.get().front().append().bytes());
+
+  Future<std::list<Action> > actions2 = replica.read(1, 1, "other");
+  ASSERT_TRUE(actions2.await(2.0));
+  ASSERT_TRUE(actions2.isReady());
+  ASSERT_EQ(1, actions2.get().size());
+  EXPECT_EQ("other", actions2.get().front().append().bytes());
+
+  Future<uint64_t> promised = replica.promised("another");
+  ASSERT_TRUE(promised.await(2.0));
+  EXPECT_EQ(2, promised.get());
+
+  Future<uint64_t> ending = replica.ending("another");
+  ASSERT_TRUE(ending.await(2.0));
+  EXPECT_EQ(0, ending.get());
+
+  utils::os::rmdir(path);
+}
+
+
 TEST(CoordinatorTest, Elect)
 {
   const std::string path1 = utils::os::getcwd() + "/.log1";
@@ -278,8 +548,9 @@ TEST(CoordinatorTest, Elect)
   Coordinator coord(2, &replica1, &network);
 
   {
-    Result<uint64_t> result = coord.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(0, result.get());
   }
 
@@ -317,16 +588,18 @@ TEST(CoordinatorTest, AppendRead)
   Coordinator coord(2, &replica1, &network);
 
   {
-    Result<uint64_t> result = coord.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(0, result.get());
   }
 
   uint64_t position;
 
   {
-    Result<uint64_t> result2 = coord.append("hello world", Timeout(1.0));
-    ASSERT_TRUE(result2.isSome());
+    Future<uint64_t> result2 = coord.append("hello world", Timeout(1.0));
+    ASSERT_TRUE(result2.await(2.0));
+    ASSERT_TRUE(result2.isReady());
     position = result2.get();
     EXPECT_EQ(1, position);
   }
@@ -366,16 +639,18 @@ TEST(CoordinatorTest, AppendReadError)
   Coordinator coord(2, &replica1, &network);
 
   {
-    Result<uint64_t> result = coord.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(0, result.get());
   }
 
   uint64_t position;
 
   {
-    Result<uint64_t> result2 = coord.append("hello world", Timeout(1.0));
-    ASSERT_TRUE(result2.isSome());
+    Future<uint64_t> result2 = coord.append("hello world", Timeout(1.0));
+    ASSERT_TRUE(result2.await(2.0));
+    ASSERT_TRUE(result2.isReady());
     position = result2.get();
     EXPECT_EQ(1, position);
   }
@@ -424,8 +699,9 @@ TEST(CoordinatorTest, DISABLED_ElectNoQuorum)
   Coordinator coord(2, &replica, &network);
 
   {
-    Result<uint64_t> result = coord.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isNone());
+    Future<uint64_t> result = coord.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isDiscarded());
   }
 
   utils::os::rmdir(path);
@@ -451,16 +727,18 @@ TEST(CoordinatorTest, DISABLED_AppendNoQuorum)
   Coordinator coord(2, &replica1, &network);
 
   {
-    Result<uint64_t> result = coord.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(0, result.get());
   }
 
   network.remove(replica1.pid());
 
   {
-    Result<uint64_t> result = coord.append("hello world", Timeout(1.0));
-    ASSERT_TRUE(result.isNone());
+    Future<uint64_t> result = coord.append("hello world", Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isDiscarded());
   }
 
   utils::os::rmdir(path1);
@@ -487,16 +765,18 @@ TEST(CoordinatorTest, Failover)
   Coordinator coord1(2, &replica1, &network1);
 
   {
-    Result<uint64_t> result = coord1.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord1.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(0, result.get());
   }
 
   uint64_t position;
 
   {
-    Result<uint64_t> result = coord1.append("hello world", Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord1.append("hello world", Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     position = result.get();
     EXPECT_EQ(1, position);
   }
@@ -509,8 +789,9 @@ TEST(CoordinatorTest, Failover)
   Coordinator coord2(2, &replica2, &network2);
 
   {
-    Result<uint64_t> result = coord2.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord2.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(position, result.get());
   }
 
@@ -549,16 +830,18 @@ TEST(CoordinatorTest, Demoted)
   Coordinator coord1(2, &replica1, &network1);
 
   {
-    Result<uint64_t> result = coord1.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord1.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(0, result.get());
   }
 
   uint64_t position;
 
   {
-    Result<uint64_t> result = coord1.append("hello world", Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord1.append("hello world", Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     position = result.get();
     EXPECT_EQ(1, position);
   }
@@ -571,20 +854,23 @@ TEST(CoordinatorTest, Demoted)
   Coordinator coord2(2, &replica2, &network2);
 
   {
-    Result<uint64_t> result = coord2.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord2.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(position, result.get());
   }
 
   {
-    Result<uint64_t> result = coord1.append("hello moto", Timeout(1.0));
-    ASSERT_TRUE(result.isError());
-    EXPECT_EQ("Coordinator demoted", result.error());
+    Future<uint64_t> result = coord1.append("hello moto", Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isFailed());
+    EXPECT_EQ("Coordinator demoted", result.failure());
   }
 
   {
-    Result<uint64_t> result = coord2.append("hello hello", Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord2.append("hello hello", Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     position = result.get();
     EXPECT_EQ(2, position);
   }
@@ -626,16 +912,18 @@ TEST(CoordinatorTest, Fill)
   Coordinator coord1(2, &replica1, &network1);
 
   {
-    Result<uint64_t> result = coord1.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord1.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(0, result.get());
   }
 
   uint64_t position;
 
   {
-    Result<uint64_t> result = coord1.append("hello world", Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord1.append("hello world", Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     position = result.get();
     EXPECT_EQ(1, position);
   }
@@ -650,10 +938,12 @@ TEST(CoordinatorTest, Fill)
   Coordinator coord2(2, &replica3, &network2);
 
   {
-    Result<uint64_t> result = coord2.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isNone());
+    Future<uint64_t> result = coord2.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isDiscarded());
     result = coord2.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(position, result.get());
   }
 
@@ -704,16 +994,18 @@ TEST(CoordinatorTest, NotLearnedFill)
   Coordinator coord1(2, &replica1, &network1);
 
   {
-    Result<uint64_t> result = coord1.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord1.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(0, result.get());
   }
 
   uint64_t position;
 
   {
-    Result<uint64_t> result = coord1.append("hello world", Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord1.append("hello world", Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     position = result.get();
     EXPECT_EQ(1, position);
   }
@@ -728,10 +1020,12 @@ TEST(CoordinatorTest, NotLearnedFill)
   Coordinator coord2(2, &replica3, &network2);
 
   {
-    Result<uint64_t> result = coord2.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isNone());
+    Future<uint64_t> result = coord2.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isDiscarded());
     result = coord2.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(position, result.get());
   }
 
@@ -773,15 +1067,17 @@ TEST(CoordinatorTest, MultipleAppends)
   Coordinator coord(2, &replica1, &network);
 
   {
-    Result<uint64_t> result = coord.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(0, result.get());
   }
 
   for (uint64_t position = 1; position <= 10; position++) {
-    Result<uint64_t> result =
+    Future<uint64_t> result =
       coord.append(utils::stringify(position), Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(position, result.get());
   }
 
@@ -802,6 +1098,64 @@ TEST(CoordinatorTest, MultipleAppends)
 }
 
 
+TEST(CoordinatorTest, PipelinedAppends)
+{
+  const std::string path1 = utils::os::getcwd() + "/.log1";
+  const std::string path2 = utils::os::getcwd() + "/.log2";
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+
+  Replica replica1(path1);
+  Replica replica2(path2);
+
+  Network network;
+
+  network.add(replica1.pid());
+  network.add(replica2.pid());
+
+  // Use a window smaller than the number of appends so that some of
+  // them have to wait for earlier ones to get committed.
+  Coordinator coord(2, &replica1, &network, 4);
+
+  {
+    Future<uint64_t> result = coord.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
+    EXPECT_EQ(0, result.get());
+  }
+
+  // Issue all of the appends before waiting for any of them.
+  std::list<Future<uint64_t> > results;
+  for (uint64_t position = 1; position <= 10; position++) {
+    results.push_back(
+        coord.append(utils::stringify(position), Timeout(1.0)));
+  }
+
+  uint64_t position = 1;
+  foreach (const Future<uint64_t>& result, results) {
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
+    EXPECT_EQ(position++, result.get());
+  }
+
+  {
+    Future<std::list<Action> > actions = replica1.read(1, 10);
+    ASSERT_TRUE(actions.await(2.0));
+    ASSERT_TRUE(actions.isReady());
+    EXPECT_EQ(10, actions.get().size());
+    foreach (const Action& action, actions.get()) {
+      ASSERT_TRUE(action.has_type());
+      ASSERT_EQ(Action::APPEND, action.type());
+      EXPECT_EQ(utils::stringify(action.position()), action.append().bytes());
+    }
+  }
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+}
+
+
 TEST(CoordinatorTest, MultipleAppendsNotLearnedFill)
 {
   MockFilter filter;
@@ -832,15 +1186,17 @@ TEST(CoordinatorTest, MultipleAppendsNotLearnedFill)
   Coordinator coord1(2, &replica1, &network1);
 
   {
-    Result<uint64_t> result = coord1.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord1.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(0, result.get());
   }
 
   for (uint64_t position = 1; position <= 10; position++) {
-    Result<uint64_t> result =
+    Future<uint64_t> result =
       coord1.append(utils::stringify(position), Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(position, result.get());
   }
 
@@ -854,10 +1210,12 @@ TEST(CoordinatorTest, MultipleAppendsNotLearnedFill)
   Coordinator coord2(2, &replica3, &network2);
 
   {
-    Result<uint64_t> result = coord2.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isNone());
+    Future<uint64_t> result = coord2.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isDiscarded());
     result = coord2.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(10, result.get());
   }
 
@@ -900,21 +1258,24 @@ TEST(CoordinatorTest, Truncate)
   Coordinator coord(2, &replica1, &network);
 
   {
-    Result<uint64_t> result = coord.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(0, result.get());
   }
 
   for (uint64_t position = 1; position <= 10; position++) {
-    Result<uint64_t> result =
+    Future<uint64_t> result =
       coord.append(utils::stringify(position), Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(position, result.get());
   }
 
   {
-    Result<uint64_t> result = coord.truncate(7, Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord.truncate(7, Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(11, result.get());
   }
 
@@ -942,6 +1303,304 @@ TEST(CoordinatorTest, Truncate)
 }
 
 
+TEST(CoordinatorTest, TruncateSegments)
+{
+  const std::string path1 = utils::os::getcwd() + "/.log1";
+  const std::string path2 = utils::os::getcwd() + "/.log2";
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+
+  {
+    Replica replica1(path1, Replica::SEGMENTS);
+    Replica replica2(path2, Replica::SEGMENTS);
+
+    Network network;
+
+    network.add(replica1.pid());
+    network.add(replica2.pid());
+
+    Coordinator coord(2, &replica1, &network);
+
+    {
+      Future<uint64_t> result = coord.elect(Timeout(1.0));
+      ASSERT_TRUE(result.await(2.0));
+      ASSERT_TRUE(result.isReady());
+      EXPECT_EQ(0, result.get());
+    }
+
+    for (uint64_t position = 1; position <= 10; position++) {
+      Future<uint64_t> result =
+        coord.append(utils::stringify(position), Timeout(1.0));
+      ASSERT_TRUE(result.await(2.0));
+      ASSERT_TRUE(result.isReady());
+      EXPECT_EQ(position, result.get());
+    }
+
+    {
+      Future<uint64_t> result = coord.truncate(7, Timeout(1.0));
+      ASSERT_TRUE(result.await(2.0));
+      ASSERT_TRUE(result.isReady());
+      EXPECT_EQ(11, result.get());
+    }
+  }
+
+  // Recover the (truncated) log from its segments.
+  Replica replica(path1, Replica::SEGMENTS);
+
+  {
+    Future<std::list<Action> > actions = replica.read(6, 10);
+    ASSERT_TRUE(actions.await(2.0));
+    ASSERT_TRUE(actions.isFailed());
+    EXPECT_EQ("Bad read range (truncated position)", actions.failure());
+  }
+
+  {
+    Future<std::list<Action> > actions = replica.read(7, 10);
+    ASSERT_TRUE(actions.await(2.0));
+    ASSERT_TRUE(actions.isReady());
+    EXPECT_EQ(4, actions.get().size());
+    foreach (const Action& action, actions.get()) {
+      ASSERT_TRUE(action.has_type());
+      ASSERT_EQ(Action::APPEND, action.type());
+      EXPECT_EQ(utils::stringify(action.position()), action.append().bytes());
+    }
+  }
+
+  {
+    Future<uint64_t> promised = replica.promised();
+    ASSERT_TRUE(promised.await(2.0));
+    ASSERT_TRUE(promised.isReady());
+    EXPECT_EQ(1, promised.get());
+  }
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+}
+
+
+TEST(CoordinatorTest, SnapshotCatchup)
+{
+  const std::string path1 = utils::os::getcwd() + "/.log1";
+  const std::string path2 = utils::os::getcwd() + "/.log2";
+  const std::string path3 = utils::os::getcwd() + "/.log3";
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+  utils::os::rmdir(path3);
+
+  Replica replica1(path1);
+  Replica replica2(path2);
+
+  Network network1;
+
+  network1.add(replica1.pid());
+  network1.add(replica2.pid());
+
+  Coordinator coord1(2, &replica1, &network1);
+
+  {
+    Future<uint64_t> result = coord1.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
+    EXPECT_EQ(0, result.get());
+  }
+
+  for (uint64_t position = 1; position <= 10; position++) {
+    Future<uint64_t> result =
+      coord1.append(utils::stringify(position), Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
+    EXPECT_EQ(position, result.get());
+  }
+
+  {
+    Future<uint64_t> result = coord1.snapshot("snapshot", Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
+    EXPECT_EQ(11, result.get());
+  }
+
+  // The truncate (at position 12) has been learned by both replicas
+  // once an append after it has been committed.
+  {
+    Future<uint64_t> result = coord1.append("hello world", Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
+    EXPECT_EQ(13, result.get());
+  }
+
+  // Now bring a new replica online, it should only need to catch up
+  // from the snapshot.
+  Replica replica3(path3);
+
+  Network network2;
+
+  network2.add(replica1.pid());
+  network2.add(replica2.pid());
+  network2.add(replica3.pid());
+
+  Coordinator coord2(2, &replica3, &network2);
+
+  // The new replica hasn't made any promises so the first election
+  // gets rejected (but the next one uses a higher id).
+  Future<uint64_t> result;
+  for (int attempt = 0; attempt < 3; attempt++) {
+    result = coord2.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    if (!result.isDiscarded()) {
+      break;
+    }
+  }
+
+  ASSERT_TRUE(result.isReady());
+  EXPECT_EQ(13, result.get());
+
+  {
+    Future<uint64_t> begin = replica3.beginning();
+    ASSERT_TRUE(begin.await(2.0));
+    ASSERT_TRUE(begin.isReady());
+    EXPECT_EQ(11, begin.get());
+  }
+
+  {
+    Future<std::list<Action> > actions = replica3.read(11, 13);
+    ASSERT_TRUE(actions.await(2.0));
+    ASSERT_TRUE(actions.isReady());
+    ASSERT_EQ(3, actions.get().size());
+    ASSERT_EQ(Action::APPEND, actions.get().front().type());
+    EXPECT_TRUE(actions.get().front().append().snapshot());
+    EXPECT_EQ("snapshot", actions.get().front().append().bytes());
+    ASSERT_EQ(Action::APPEND, actions.get().back().type());
+    EXPECT_EQ("hello world", actions.get().back().append().bytes());
+  }
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+  utils::os::rmdir(path3);
+}
+
+
+TEST(CoordinatorTest, Lease)
+{
+  const std::string path1 = utils::os::getcwd() + "/.log1";
+  const std::string path2 = utils::os::getcwd() + "/.log2";
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+
+  Replica replica1(path1);
+  Replica replica2(path2);
+
+  Network network1;
+
+  network1.add(replica1.pid());
+  network1.add(replica2.pid());
+
+  Coordinator coord1(2, &replica1, &network1, 32, 60.0);
+
+  {
+    Future<uint64_t> result = coord1.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
+    EXPECT_EQ(0, result.get());
+  }
+
+  {
+    Future<uint64_t> result = coord1.append("hello world", Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
+    EXPECT_EQ(1, result.get());
+  }
+
+  // The lease lets the coordinator return the end of the log without
+  // writing anything (i.e., no no-op at position 2).
+  {
+    Future<uint64_t> result = coord1.ending(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
+    EXPECT_EQ(1, result.get());
+  }
+
+  // And no other coordinator can get elected while it holds it.
+  Network network2;
+
+  network2.add(replica1.pid());
+  network2.add(replica2.pid());
+
+  Coordinator coord2(2, &replica2, &network2);
+
+  for (int attempt = 0; attempt < 3; attempt++) {
+    Future<uint64_t> result = coord2.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    EXPECT_TRUE(result.isDiscarded());
+  }
+
+  {
+    Future<uint64_t> result = coord1.append("hello moto", Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
+    EXPECT_EQ(2, result.get());
+  }
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+}
+
+
+TEST(CoordinatorTest, EndingWithoutLease)
+{
+  const std::string path1 = utils::os::getcwd() + "/.log1";
+  const std::string path2 = utils::os::getcwd() + "/.log2";
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+
+  Replica replica1(path1);
+  Replica replica2(path2);
+
+  Network network;
+
+  network.add(replica1.pid());
+  network.add(replica2.pid());
+
+  Coordinator coord(2, &replica1, &network);
+
+  {
+    Future<uint64_t> result = coord.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
+    EXPECT_EQ(0, result.get());
+  }
+
+  {
+    Future<uint64_t> result = coord.append("hello world", Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
+    EXPECT_EQ(1, result.get());
+  }
+
+  // Without a lease the coordinator needs to write a no-op.
+  {
+    Future<uint64_t> result = coord.ending(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
+    EXPECT_EQ(2, result.get());
+  }
+
+  {
+    Future<std::list<Action> > actions = replica1.read(2, 2);
+    ASSERT_TRUE(actions.await(2.0));
+    ASSERT_TRUE(actions.isReady());
+    ASSERT_EQ(1, actions.get().size());
+    EXPECT_EQ(Action::NOP, actions.get().front().type());
+  }
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+}
+
+
 TEST(CoordinatorTest, TruncateNotLearnedFill)
 {
   MockFilter filter;
@@ -972,21 +1631,24 @@ TEST(CoordinatorTest, TruncateNotLearnedFill)
   Coordinator coord1(2, &replica1, &network1);
 
   {
-    Result<uint64_t> result = coord1.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord1.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(0, result.get());
   }
 
   for (uint64_t position = 1; position <= 10; position++) {
-    Result<uint64_t> result =
+    Future<uint64_t> result =
       coord1.append(utils::stringify(position), Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(position, result.get());
   }
 
   {
-    Result<uint64_t> result = coord1.truncate(7, Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    Future<uint64_t> result = coord1.truncate(7, Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(11, result.get());
   }
 
@@ -1000,10 +1662,12 @@ TEST(CoordinatorTest, TruncateNotLearnedFill)
   Coordinator coord2(2, &replica3, &network2);
 
   {
-    Result<uint64_t> result = coord2.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isNone());
+    Future<uint64_t> result = coord2.elect(Timeout(1.0));
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isDiscarded());
     result = coord2.elect(Timeout(1.0));
-    ASSERT_TRUE(result.isSome());
+    ASSERT_TRUE(result.await(2.0));
+    ASSERT_TRUE(result.isReady());
     EXPECT_EQ(11, result.get());
   }
 
@@ -1070,6 +1734,209 @@ TEST(LogTest, WriteRead)
 }
 
 
+TEST(LogTest, PipelinedWriteRead)
+{
+  const std::string path1 = utils::os::getcwd() + "/.log1";
+  const std::string path2 = utils::os::getcwd() + "/.log2";
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+
+  Replica replica1(path1);
+
+  std::set<UPID> pids;
+  pids.insert(replica1.pid());
+
+  Log log(2, path2, pids);
+
+  Log::Writer writer(&log, seconds(1.0));
+
+  // Append without waiting for the previous appends.
+  std::vector<Future<Log::Position> > positions;
+  for (int i = 0; i < 10; i++) {
+    positions.push_back(writer.append(utils::stringify(i), Timeout(1.0)));
+  }
+
+  for (int i = 0; i < 10; i++) {
+    ASSERT_TRUE(positions[i].await(2.0));
+    ASSERT_TRUE(positions[i].isReady());
+  }
+
+  Log::Reader reader(&log);
+
+  Future<std::list<Log::Entry> > entries =
+    reader.read(positions.front().get(), positions.back().get());
+
+  ASSERT_TRUE(entries.await(2.0));
+  ASSERT_TRUE(entries.isReady());
+  ASSERT_EQ(10, entries.get().size());
+
+  int i = 0;
+  foreach (const Log::Entry& entry, entries.get()) {
+    EXPECT_EQ(positions[i].get(), entry.position);
+    EXPECT_EQ(utils::stringify(i), entry.data);
+    i++;
+  }
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+}
+
+
+TEST(LogTest, BatchedWriteRead)
+{
+  const std::string path1 = utils::os::getcwd() + "/.log1";
+  const std::string path2 = utils::os::getcwd() + "/.log2";
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+
+  Replica replica1(path1);
+
+  std::set<UPID> pids;
+  pids.insert(replica1.pid());
+
+  Log log(2, path2, pids);
+
+  Log::Writer writer(&log, seconds(1.0));
+
+  std::vector<std::string> data;
+  data.push_back("hello");
+  data.push_back("world");
+  data.push_back("!");
+
+  Result<std::pair<Log::Position, Log::Position> > range =
+    writer.append(data, seconds(1.0));
+
+  ASSERT_TRUE(range.isSome());
+
+  Log::Reader reader(&log);
+
+  Result<std::list<Log::Entry> > entries =
+    reader.read(range.get().first, range.get().second, seconds(1.0));
+
+  ASSERT_TRUE(entries.isSome());
+  ASSERT_EQ(data.size(), entries.get().size());
+  EXPECT_EQ(range.get().first, entries.get().front().position);
+  EXPECT_EQ(range.get().second, entries.get().back().position);
+
+  std::vector<std::string>::const_iterator iterator = data.begin();
+  foreach (const Log::Entry& entry, entries.get()) {
+    EXPECT_EQ(*iterator++, entry.data);
+  }
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+}
+
+
+TEST(LogTest, Cursor)
+{
+  const std::string path1 = utils::os::getcwd() + "/.log1";
+  const std::string path2 = utils::os::getcwd() + "/.log2";
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+
+  Replica replica1(path1);
+
+  std::set<UPID> pids;
+  pids.insert(replica1.pid());
+
+  Log log(2, path2, pids);
+
+  Log::Writer writer(&log, seconds(1.0));
+
+  std::vector<std::string> data;
+  for (int i = 0; i < 10; i++) {
+    data.push_back(utils::stringify(i));
+  }
+
+  Result<std::pair<Log::Position, Log::Position> > range =
+    writer.append(data, seconds(1.0));
+
+  ASSERT_TRUE(range.isSome());
+
+  // Use a chunk size that doesn't evenly divide the range.
+  Log::Cursor cursor(&log, range.get().first, range.get().second, 3);
+
+  std::vector<std::string> read;
+
+  while (!cursor.done()) {
+    Result<std::list<Log::Entry> > entries = cursor.next(seconds(1.0));
+    ASSERT_TRUE(entries.isSome());
+    EXPECT_GE(3, entries.get().size());
+    foreach (const Log::Entry& entry, entries.get()) {
+      read.push_back(entry.data);
+    }
+  }
+
+  EXPECT_EQ(data, read);
+
+  EXPECT_TRUE(cursor.next(seconds(1.0)).isError());
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+}
+
+
+static std::string snapshot()
+{
+  return "snapshot";
+}
+
+
+TEST(LogTest, Snapshot)
+{
+  const std::string path1 = utils::os::getcwd() + "/.log1";
+  const std::string path2 = utils::os::getcwd() + "/.log2";
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+
+  Replica replica1(path1);
+
+  std::set<UPID> pids;
+  pids.insert(replica1.pid());
+
+  Log log(2, path2, pids);
+
+  Log::Writer writer(&log, seconds(1.0));
+
+  writer.snapshots(&snapshot, 3);
+
+  // Positions 1, 2, and 3 followed by a snapshot (at 4) and a
+  // truncate (at 5) and then positions 6 and 7.
+  for (int i = 1; i <= 5; i++) {
+    Result<Log::Position> position =
+      writer.append(utils::stringify(i), seconds(1.0));
+    ASSERT_TRUE(position.isSome());
+  }
+
+  Log::Reader reader(&log);
+
+  Log::Position beginning = reader.beginning();
+  Log::Position ending = reader.ending();
+
+  Result<std::list<Log::Entry> > entries =
+    reader.read(beginning, ending, seconds(1.0));
+
+  ASSERT_TRUE(entries.isSome());
+  ASSERT_EQ(3, entries.get().size());
+
+  EXPECT_EQ(beginning, entries.get().front().position);
+  EXPECT_TRUE(entries.get().front().snapshot);
+  EXPECT_EQ("snapshot", entries.get().front().data);
+
+  EXPECT_EQ(ending, entries.get().back().position);
+  EXPECT_FALSE(entries.get().back().snapshot);
+  EXPECT_EQ("5", entries.get().back().data);
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+}
+
+
 TEST(LogTest, Position)
 {
   const std::string path1 = utils::os::getcwd() + "/.log1";
@@ -1098,6 +1965,55 @@ TEST(LogTest, Position)
 }
 
 
+TEST(LogTest, NamedLogs)
+{
+  const std::string path1 = utils::os::getcwd() + "/.log1";
+  const std::string path2 = utils::os::getcwd() + "/.log2";
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+
+  Replica replica1(path1);
+
+  std::set<UPID> pids;
+  pids.insert(replica1.pid());
+
+  Log log(2, path2, pids);
+  Log named(&log, "named");
+
+  // Each log has its own writer.
+  Log::Writer writer1(&log, seconds(1.0));
+  Log::Writer writer2(&named, seconds(1.0));
+
+  Result<Log::Position> position1 = writer1.append("hello", seconds(1.0));
+  ASSERT_TRUE(position1.isSome());
+
+  Result<Log::Position> position2 = writer2.append("world", seconds(1.0));
+  ASSERT_TRUE(position2.isSome());
+  EXPECT_EQ(position1.get(), position2.get());
+
+  Log::Reader reader1(&log);
+  Log::Reader reader2(&named);
+
+  Result<std::list<Log::Entry> > entries1 =
+    reader1.read(position1.get(), position1.get(), seconds(1.0));
+
+  ASSERT_TRUE(entries1.isSome());
+  ASSERT_EQ(1, entries1.get().size());
+  EXPECT_EQ("hello", entries1.get().front().data);
+
+  Result<std::list<Log::Entry> > entries2 =
+    reader2.read(position2.get(), position2.get(), seconds(1.0));
+
+  ASSERT_TRUE(entries2.isSome());
+  ASSERT_EQ(1, entries2.get().size());
+  EXPECT_EQ("world", entries2.get().front().data);
+
+  utils::os::rmdir(path1);
+  utils::os::rmdir(path2);
+}
+
+
 TEST(CoordinatorTest, RacingElect) {}
 
 TEST(CoordinatorTest, FillNoQuorum) {}
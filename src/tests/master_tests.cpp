@@ -21,17 +21,26 @@
 #include <mesos/executor.hpp>
 #include <mesos/scheduler.hpp>
 
+#include "configurator/configuration.hpp"
+
 #include "detector/detector.hpp"
 
 #include "local/local.hpp"
 
+#include "master/attribute_index.hpp"
+#include "master/drf_allocator.hpp"
 #include "master/frameworks_manager.hpp"
+#include "master/log_storage.hpp"
 #include "master/master.hpp"
+#include "master/offer_filters.hpp"
 #include "master/simple_allocator.hpp"
+#include "master/slave_health.hpp"
+#include "master/task_archive.hpp"
 
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
 
+#include "slave/fake_slave.hpp"
 #include "slave/slave.hpp"
 
 #include "tests/utils.hpp"
@@ -40,25 +49,38 @@ using namespace mesos;
 using namespace mesos::internal;
 using namespace mesos::internal::test;
 
+using mesos::internal::master::AttributeIndex;
+using mesos::internal::master::DRFAllocator;
+using mesos::internal::master::Framework;
 using mesos::internal::master::FrameworksManager;
 using mesos::internal::master::FrameworksStorage;
+using mesos::internal::master::LogFrameworksStorage;
+using mesos::internal::master::LogStorage;
 
 using mesos::internal::master::Master;
+using mesos::internal::master::OfferFilters;
 using mesos::internal::master::SimpleAllocator;
+using mesos::internal::master::SlaveHealth;
+using mesos::internal::master::TaskArchive;
 
+using mesos::internal::slave::FakeSlave;
 using mesos::internal::slave::Slave;
 
 using process::Clock;
 using process::Future;
 using process::PID;
+using process::UPID;
 
-using std::string;
+using std::make_pair;
 using std::map;
+using std::pair;
+using std::string;
 using std::vector;
 
 using testing::_;
 using testing::AtMost;
 using testing::DoAll;
+using testing::ElementsAre;
 using testing::Eq;
 using testing::Return;
 using testing::SaveArg;
@@ -156,7 +178,7 @@ TEST(MasterTest, TaskRunning)
 }
 
 
-TEST(MasterTest, KillTask)
+TEST(MasterTest, AsyncSchedulerCallbacks)
 {
   ASSERT_TRUE(GTEST_IS_THREADSAFE);
 
@@ -166,7 +188,7 @@ TEST(MasterTest, KillTask)
 
   MockExecutor exec;
 
-  trigger killTaskCall, shutdownCall;
+  trigger shutdownCall;
 
   EXPECT_CALL(exec, init(_, _))
     .Times(1);
@@ -174,9 +196,6 @@ TEST(MasterTest, KillTask)
   EXPECT_CALL(exec, launchTask(_, _))
     .WillOnce(SendStatusUpdate(TASK_RUNNING));
 
-  EXPECT_CALL(exec, killTask(_, _))
-    .WillOnce(Trigger(&killTaskCall));
-
   EXPECT_CALL(exec, shutdown(_))
     .WillOnce(Trigger(&shutdownCall));
 
@@ -192,8 +211,12 @@ TEST(MasterTest, KillTask)
 
   BasicMasterDetector detector(master, slave, true);
 
+  map<string, string> params;
+  params["url"] = string(master);
+  params["async_callbacks"] = "1";
+
   MockScheduler sched;
-  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, params);
 
   vector<Offer> offers;
   TaskStatus status;
@@ -217,12 +240,9 @@ TEST(MasterTest, KillTask)
 
   EXPECT_NE(0, offers.size());
 
-  TaskID taskId;
-  taskId.set_value("1");
-
   TaskDescription task;
   task.set_name("");
-  task.mutable_task_id()->MergeFrom(taskId);
+  task.mutable_task_id()->set_value("1");
   task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
   task.mutable_resources()->MergeFrom(offers[0].resources());
 
@@ -235,10 +255,6 @@ TEST(MasterTest, KillTask)
 
   EXPECT_EQ(TASK_RUNNING, status.state());
 
-  driver.killTask(taskId);
-
-  WAIT_UNTIL(killTaskCall);
-
   driver.stop();
   driver.join();
 
@@ -252,7 +268,7 @@ TEST(MasterTest, KillTask)
 }
 
 
-TEST(MasterTest, FrameworkMessage)
+TEST(MasterTest, LaunchMultipleTasks)
 {
   ASSERT_TRUE(GTEST_IS_THREADSAFE);
 
@@ -262,21 +278,13 @@ TEST(MasterTest, FrameworkMessage)
 
   MockExecutor exec;
 
-  ExecutorDriver* execDriver;
-  ExecutorArgs args;
-  string execData;
-
-  trigger execFrameworkMessageCall, shutdownCall;
+  trigger shutdownCall;
 
   EXPECT_CALL(exec, init(_, _))
-    .WillOnce(DoAll(SaveArg<0>(&execDriver), SaveArg<1>(&args)));
+    .Times(1);
 
   EXPECT_CALL(exec, launchTask(_, _))
-    .WillOnce(SendStatusUpdate(TASK_RUNNING));
-
-  EXPECT_CALL(exec, frameworkMessage(_, _))
-    .WillOnce(DoAll(SaveArg<1>(&execData),
-                    Trigger(&execFrameworkMessageCall)));
+    .WillRepeatedly(SendStatusUpdate(TASK_RUNNING));
 
   EXPECT_CALL(exec, shutdown(_))
     .WillOnce(Trigger(&shutdownCall));
@@ -286,6 +294,9 @@ TEST(MasterTest, FrameworkMessage)
 
   TestingIsolationModule isolationModule(execs);
 
+  EXPECT_CALL(isolationModule, resourcesChanged(_, _, _))
+    .WillRepeatedly(Return());
+
   Resources resources = Resources::parse("cpus:2;mem:1024");
 
   Slave s(resources, true, &isolationModule);
@@ -293,74 +304,163 @@ TEST(MasterTest, FrameworkMessage)
 
   BasicMasterDetector detector(master, slave, true);
 
-  // Launch the first (i.e., failing) scheduler and wait until the
-  // first status update message is sent to it (drop the message).
-
   MockScheduler sched;
-  MesosSchedulerDriver schedDriver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
 
   vector<Offer> offers;
-  TaskStatus status;
-  string schedData;
+  TaskStatus status1, status2;
 
-  trigger resourceOffersCall, statusUpdateCall, schedFrameworkMessageCall;
+  trigger resourceOffersCall, statusUpdateCall1, statusUpdateCall2;
 
-  EXPECT_CALL(sched, registered(&schedDriver, _))
+  EXPECT_CALL(sched, registered(&driver, _))
     .Times(1);
 
-  EXPECT_CALL(sched, resourceOffers(&schedDriver, _))
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
     .WillOnce(DoAll(SaveArg<1>(&offers),
                     Trigger(&resourceOffersCall)))
     .WillRepeatedly(Return());
 
-  EXPECT_CALL(sched, statusUpdate(&schedDriver, _))
-    .WillOnce(DoAll(SaveArg<1>(&status), Trigger(&statusUpdateCall)));
-
-  EXPECT_CALL(sched, frameworkMessage(&schedDriver, _, _, _))
-    .WillOnce(DoAll(SaveArg<3>(&schedData),
-                    Trigger(&schedFrameworkMessageCall)));
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&status1), Trigger(&statusUpdateCall1)))
+    .WillOnce(DoAll(SaveArg<1>(&status2), Trigger(&statusUpdateCall2)));
 
-  schedDriver.start();
+  driver.start();
 
   WAIT_UNTIL(resourceOffersCall);
 
   EXPECT_NE(0, offers.size());
 
-  TaskDescription task;
-  task.set_name("");
-  task.mutable_task_id()->set_value("1");
-  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
-  task.mutable_resources()->MergeFrom(offers[0].resources());
-
+  // Both tasks get launched on the slave with one message.
   vector<TaskDescription> tasks;
-  tasks.push_back(task);
 
-  schedDriver.launchTasks(offers[0].id(), tasks);
+  for (int i = 1; i <= 2; i++) {
+    TaskDescription task;
+    task.set_name("");
+    task.mutable_task_id()->set_value(utils::stringify(i));
+    task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+    task.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:512"));
+    tasks.push_back(task);
+  }
 
-  WAIT_UNTIL(statusUpdateCall);
+  driver.launchTasks(offers[0].id(), tasks);
 
-  EXPECT_EQ(TASK_RUNNING, status.state());
+  WAIT_UNTIL(statusUpdateCall1);
+  WAIT_UNTIL(statusUpdateCall2);
 
-  string hello = "hello";
+  EXPECT_EQ(TASK_RUNNING, status1.state());
+  EXPECT_EQ(TASK_RUNNING, status2.state());
+  EXPECT_NE(status1.task_id().value(), status2.task_id().value());
 
-  schedDriver.sendFrameworkMessage(offers[0].slave_id(),
-				   DEFAULT_EXECUTOR_ID,
-				   hello);
+  driver.stop();
+  driver.join();
 
-  WAIT_UNTIL(execFrameworkMessageCall);
+  WAIT_UNTIL(shutdownCall); // To ensure can deallocate MockExecutor.
 
-  EXPECT_EQ(hello, execData);
+  process::terminate(slave);
+  process::wait(slave);
 
-  string reply = "reply";
+  process::terminate(master);
+  process::wait(master);
+}
 
-  execDriver->sendFrameworkMessage(reply);
 
-  WAIT_UNTIL(schedFrameworkMessageCall);
+// Same as above, except that the executor batches its status updates,
+// so both reach the slave in one message.
+TEST(MasterTest, BatchedExecutorStatusUpdates)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
 
-  EXPECT_EQ(reply, schedData);
+  MockFilter filter;
+  process::filter(&filter);
 
-  schedDriver.stop();
-  schedDriver.join();
+  EXPECT_MESSAGE(filter, _, _, _)
+    .WillRepeatedly(Return(false));
+
+  utils::os::setenv("MESOS_BATCH_STATUS_UPDATES", "1");
+
+  SimpleAllocator a;
+  Master m(&a);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  trigger shutdownCall;
+
+  EXPECT_CALL(exec, init(_, _))
+    .Times(1);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillRepeatedly(SendStatusUpdate(TASK_RUNNING));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  EXPECT_CALL(isolationModule, resourcesChanged(_, _, _))
+    .WillRepeatedly(Return());
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  EXPECT_MESSAGE(filter, Eq(StatusUpdateMessage().GetTypeName()),
+                 _, UPID(slave))
+    .Times(0);
+
+  EXPECT_MESSAGE(filter, Eq(StatusUpdatesMessage().GetTypeName()),
+                 _, UPID(slave))
+    .WillOnce(Return(false));
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers;
+
+  trigger resourceOffersCall, statusUpdateCall1, statusUpdateCall2;
+
+  EXPECT_CALL(sched, registered(&driver, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(Trigger(&statusUpdateCall1))
+    .WillOnce(Trigger(&statusUpdateCall2));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0, offers.size());
+
+  vector<TaskDescription> tasks;
+
+  for (int i = 1; i <= 2; i++) {
+    TaskDescription task;
+    task.set_name("");
+    task.mutable_task_id()->set_value(utils::stringify(i));
+    task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+    task.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:512"));
+    tasks.push_back(task);
+  }
+
+  driver.launchTasks(offers[0].id(), tasks);
+
+  WAIT_UNTIL(statusUpdateCall1);
+  WAIT_UNTIL(statusUpdateCall2);
+
+  driver.stop();
+  driver.join();
 
   WAIT_UNTIL(shutdownCall); // To ensure can deallocate MockExecutor.
 
@@ -369,56 +469,1412 @@ TEST(MasterTest, FrameworkMessage)
 
   process::terminate(master);
   process::wait(master);
+
+  utils::os::unsetenv("MESOS_BATCH_STATUS_UPDATES");
+
+  process::filter(NULL);
 }
 
 
-TEST(MasterTest, MultipleExecutors)
+// Executor exits go through the slave's shard so that the master
+// can't see one before the terminal updates that preceded it (and
+// report those tasks as lost).
+TEST(MasterTest, TerminalUpdateBeforeExecutorExit)
 {
   ASSERT_TRUE(GTEST_IS_THREADSAFE);
 
+  MockFilter filter;
+  process::filter(&filter);
+
+  EXPECT_MESSAGE(filter, _, _, _)
+    .WillRepeatedly(Return(false));
+
   SimpleAllocator a;
   Master m(&a);
   PID<Master> master = process::spawn(&m);
 
-  MockExecutor exec1;
-  TaskDescription exec1Task;
-  trigger exec1LaunchTaskCall, exec1ShutdownCall;
+  MockExecutor exec;
 
-  EXPECT_CALL(exec1, init(_, _))
+  EXPECT_CALL(exec, init(_, _))
     .Times(1);
 
-  EXPECT_CALL(exec1, launchTask(_, _))
-    .WillOnce(DoAll(SaveArg<1>(&exec1Task),
-                    Trigger(&exec1LaunchTaskCall),
-                    SendStatusUpdate(TASK_RUNNING)));
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdate(TASK_FINISHED));
 
-  EXPECT_CALL(exec1, shutdown(_))
-    .WillOnce(Trigger(&exec1ShutdownCall));
+  EXPECT_CALL(exec, shutdown(_))
+    .Times(AtMost(1));
 
-  MockExecutor exec2;
-  TaskDescription exec2Task;
-  trigger exec2LaunchTaskCall, exec2ShutdownCall;
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
 
-  EXPECT_CALL(exec2, init(_, _))
-    .Times(1);
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  trigger updateMsg, exitedExecutorMsg;
+
+  EXPECT_MESSAGE(filter, Eq(StatusUpdateMessage().GetTypeName()),
+                 Eq(UPID(slave)), _)
+    .WillOnce(DoAll(Trigger(&updateMsg),
+                    Return(false)))
+    .WillRepeatedly(Return(false));
+
+  EXPECT_MESSAGE(filter, Eq(ExitedExecutorMessage().GetTypeName()),
+                 Eq(UPID(slave)), _)
+    .WillOnce(DoAll(Trigger(&exitedExecutorMsg),
+                    Return(false)));
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+
+  FrameworkID frameworkId;
+  vector<Offer> offers;
+  TaskStatus status;
+
+  trigger resourceOffersCall, statusUpdateCall;
+
+  EXPECT_CALL(sched, registered(&driver, _))
+    .WillOnce(SaveArg<1>(&frameworkId));
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  // Only the terminal update, no TASK_LOST from the executor exit.
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&status), Trigger(&statusUpdateCall)));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0, offers.size());
+
+  TaskDescription task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task.mutable_resources()->MergeFrom(offers[0].resources());
+
+  vector<TaskDescription> tasks;
+  tasks.push_back(task);
+
+  driver.launchTasks(offers[0].id(), tasks);
+
+  // The slave has sent the update on (it's still in that handler, so
+  // the exit below is handled after it), now the executor exits.
+  WAIT_UNTIL(updateMsg);
+
+  isolationModule.killExecutor(frameworkId, DEFAULT_EXECUTOR_ID);
+
+  process::dispatch(slave, &Slave::executorExited,
+                    frameworkId, DEFAULT_EXECUTOR_ID, 0);
+
+  WAIT_UNTIL(exitedExecutorMsg);
+  WAIT_UNTIL(statusUpdateCall);
+
+  EXPECT_EQ(TASK_FINISHED, status.state());
+
+  driver.stop();
+  driver.join();
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+
+  process::filter(NULL);
+}
+
+
+TEST(MasterTest, KillTask)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  SimpleAllocator a;
+  Master m(&a);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  trigger killTaskCall, shutdownCall;
+
+  EXPECT_CALL(exec, init(_, _))
+    .Times(1);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdate(TASK_RUNNING));
+
+  EXPECT_CALL(exec, killTask(_, _))
+    .WillOnce(Trigger(&killTaskCall));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers;
+  TaskStatus status;
+
+  trigger resourceOffersCall, statusUpdateCall;
+
+  EXPECT_CALL(sched, registered(&driver, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&status), Trigger(&statusUpdateCall)));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0, offers.size());
+
+  TaskID taskId;
+  taskId.set_value("1");
+
+  TaskDescription task;
+  task.set_name("");
+  task.mutable_task_id()->MergeFrom(taskId);
+  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task.mutable_resources()->MergeFrom(offers[0].resources());
+
+  vector<TaskDescription> tasks;
+  tasks.push_back(task);
+
+  driver.launchTasks(offers[0].id(), tasks);
+
+  WAIT_UNTIL(statusUpdateCall);
+
+  EXPECT_EQ(TASK_RUNNING, status.state());
+
+  driver.killTask(taskId);
+
+  WAIT_UNTIL(killTaskCall);
+
+  driver.stop();
+  driver.join();
+
+  WAIT_UNTIL(shutdownCall); // To ensure can deallocate MockExecutor.
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+}
+
+
+TEST(MasterTest, FakeSlaves)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  SimpleAllocator a;
+  Master m(&a);
+  PID<Master> master = process::spawn(&m);
+
+  // Fake slaves whose tasks "run" until they get killed.
+  vector<FakeSlave*> fakes;
+  vector<UPID> pids;
+
+  for (int i = 0; i < 2; i++) {
+    SlaveInfo info;
+    info.set_hostname("fake-" + utils::stringify(i));
+    info.set_webui_hostname(info.hostname());
+    info.mutable_resources()->MergeFrom(
+        Resources::parse("cpus:2;mem:1024"));
+
+    FakeSlave* fake = new FakeSlave(info, 3600.0);
+    pids.push_back(process::spawn(fake));
+    fakes.push_back(fake);
+  }
+
+  BasicMasterDetector detector(master, pids, true);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers;
+  TaskStatus status1, status2;
+
+  trigger resourceOffersCall, statusUpdateCall1, statusUpdateCall2;
+
+  EXPECT_CALL(sched, registered(&driver, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&status1), Trigger(&statusUpdateCall1)))
+    .WillOnce(DoAll(SaveArg<1>(&status2), Trigger(&statusUpdateCall2)));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0, offers.size());
+
+  TaskID taskId;
+  taskId.set_value("1");
+
+  TaskDescription task;
+  task.set_name("");
+  task.mutable_task_id()->MergeFrom(taskId);
+  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task.mutable_resources()->MergeFrom(offers[0].resources());
+
+  vector<TaskDescription> tasks;
+  tasks.push_back(task);
+
+  driver.launchTasks(offers[0].id(), tasks);
+
+  WAIT_UNTIL(statusUpdateCall1);
+
+  EXPECT_EQ(taskId, status1.task_id());
+  EXPECT_EQ(TASK_RUNNING, status1.state());
+
+  driver.killTask(taskId);
+
+  WAIT_UNTIL(statusUpdateCall2);
+
+  EXPECT_EQ(taskId, status2.task_id());
+  EXPECT_EQ(TASK_KILLED, status2.state());
+
+  driver.stop();
+  driver.join();
+
+  foreach (FakeSlave* fake, fakes) {
+    process::terminate(fake);
+    process::wait(fake);
+    delete fake;
+  }
+
+  process::terminate(master);
+  process::wait(master);
+}
+
+
+TEST(MasterTest, FrameworkMessage)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  SimpleAllocator a;
+  Master m(&a);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  ExecutorDriver* execDriver;
+  ExecutorArgs args;
+  string execData;
+
+  trigger execFrameworkMessageCall, shutdownCall;
+
+  EXPECT_CALL(exec, init(_, _))
+    .WillOnce(DoAll(SaveArg<0>(&execDriver), SaveArg<1>(&args)));
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdate(TASK_RUNNING));
+
+  EXPECT_CALL(exec, frameworkMessage(_, _))
+    .WillOnce(DoAll(SaveArg<1>(&execData),
+                    Trigger(&execFrameworkMessageCall)));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  // Launch the first (i.e., failing) scheduler and wait until the
+  // first status update message is sent to it (drop the message).
+
+  MockScheduler sched;
+  MesosSchedulerDriver schedDriver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers;
+  TaskStatus status;
+  string schedData;
+
+  trigger resourceOffersCall, statusUpdateCall, schedFrameworkMessageCall;
+
+  EXPECT_CALL(sched, registered(&schedDriver, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&schedDriver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&schedDriver, _))
+    .WillOnce(DoAll(SaveArg<1>(&status), Trigger(&statusUpdateCall)));
+
+  EXPECT_CALL(sched, frameworkMessage(&schedDriver, _, _, _))
+    .WillOnce(DoAll(SaveArg<3>(&schedData),
+                    Trigger(&schedFrameworkMessageCall)));
+
+  schedDriver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0, offers.size());
+
+  TaskDescription task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task.mutable_resources()->MergeFrom(offers[0].resources());
+
+  vector<TaskDescription> tasks;
+  tasks.push_back(task);
+
+  schedDriver.launchTasks(offers[0].id(), tasks);
+
+  WAIT_UNTIL(statusUpdateCall);
+
+  EXPECT_EQ(TASK_RUNNING, status.state());
+
+  string hello = "hello";
+
+  schedDriver.sendFrameworkMessage(offers[0].slave_id(),
+				   DEFAULT_EXECUTOR_ID,
+				   hello);
+
+  WAIT_UNTIL(execFrameworkMessageCall);
+
+  EXPECT_EQ(hello, execData);
+
+  string reply = "reply";
+
+  execDriver->sendFrameworkMessage(reply);
+
+  WAIT_UNTIL(schedFrameworkMessageCall);
+
+  EXPECT_EQ(reply, schedData);
+
+  schedDriver.stop();
+  schedDriver.join();
+
+  WAIT_UNTIL(shutdownCall); // To ensure can deallocate MockExecutor.
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+}
+
+
+// Same as above, except that the executor asks to exchange framework
+// messages with the scheduler directly, so the slave never sees them.
+TEST(MasterTest, DirectFrameworkMessages)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  MockFilter filter;
+  process::filter(&filter);
+
+  EXPECT_MESSAGE(filter, _, _, _)
+    .WillRepeatedly(Return(false));
+
+  utils::os::setenv("MESOS_DIRECT_MESSAGES", "1");
+
+  SimpleAllocator a;
+  Master m(&a);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  ExecutorDriver* execDriver;
+  string execData;
+
+  trigger execFrameworkMessageCall, shutdownCall;
+
+  EXPECT_CALL(exec, init(_, _))
+    .WillOnce(SaveArg<0>(&execDriver));
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdate(TASK_RUNNING));
+
+  EXPECT_CALL(exec, frameworkMessage(_, _))
+    .WillOnce(DoAll(SaveArg<1>(&execData),
+                    Trigger(&execFrameworkMessageCall)));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  // Drop any framework messages that go through the slave.
+  EXPECT_MESSAGE(filter, Eq(FrameworkToExecutorMessage().GetTypeName()),
+                 _, UPID(slave))
+    .WillRepeatedly(Return(true));
+
+  EXPECT_MESSAGE(filter, Eq(ExecutorToFrameworkMessage().GetTypeName()),
+                 _, UPID(slave))
+    .WillRepeatedly(Return(true));
+
+  trigger executorChannelMsg;
+
+  EXPECT_MESSAGE(filter, Eq(ExecutorChannelMessage().GetTypeName()), _, _)
+    .WillOnce(DoAll(Trigger(&executorChannelMsg),
+                    Return(false)));
+
+  MockScheduler sched;
+  MesosSchedulerDriver schedDriver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers;
+  string schedData;
+
+  trigger resourceOffersCall, statusUpdateCall, schedFrameworkMessageCall;
+
+  EXPECT_CALL(sched, registered(&schedDriver, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&schedDriver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&schedDriver, _))
+    .WillOnce(Trigger(&statusUpdateCall));
+
+  EXPECT_CALL(sched, frameworkMessage(&schedDriver, _, _, _))
+    .WillOnce(DoAll(SaveArg<3>(&schedData),
+                    Trigger(&schedFrameworkMessageCall)));
+
+  schedDriver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0, offers.size());
+
+  TaskDescription task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task.mutable_resources()->MergeFrom(offers[0].resources());
+
+  vector<TaskDescription> tasks;
+  tasks.push_back(task);
+
+  schedDriver.launchTasks(offers[0].id(), tasks);
+
+  WAIT_UNTIL(statusUpdateCall);
+  WAIT_UNTIL(executorChannelMsg);
+
+  string hello = "hello";
+
+  schedDriver.sendFrameworkMessage(offers[0].slave_id(),
+                                   DEFAULT_EXECUTOR_ID,
+                                   hello);
+
+  WAIT_UNTIL(execFrameworkMessageCall);
+
+  EXPECT_EQ(hello, execData);
+
+  string reply = "reply";
+
+  execDriver->sendFrameworkMessage(reply);
+
+  WAIT_UNTIL(schedFrameworkMessageCall);
+
+  EXPECT_EQ(reply, schedData);
+
+  schedDriver.stop();
+  schedDriver.join();
+
+  WAIT_UNTIL(shutdownCall); // To ensure can deallocate MockExecutor.
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+
+  utils::os::unsetenv("MESOS_DIRECT_MESSAGES");
+
+  process::filter(NULL);
+}
+
+
+TEST(MasterTest, MultipleExecutors)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  SimpleAllocator a;
+  Master m(&a);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec1;
+  TaskDescription exec1Task;
+  trigger exec1LaunchTaskCall, exec1ShutdownCall;
+
+  EXPECT_CALL(exec1, init(_, _))
+    .Times(1);
+
+  EXPECT_CALL(exec1, launchTask(_, _))
+    .WillOnce(DoAll(SaveArg<1>(&exec1Task),
+                    Trigger(&exec1LaunchTaskCall),
+                    SendStatusUpdate(TASK_RUNNING)));
+
+  EXPECT_CALL(exec1, shutdown(_))
+    .WillOnce(Trigger(&exec1ShutdownCall));
+
+  MockExecutor exec2;
+  TaskDescription exec2Task;
+  trigger exec2LaunchTaskCall, exec2ShutdownCall;
+
+  EXPECT_CALL(exec2, init(_, _))
+    .Times(1);
+
+  EXPECT_CALL(exec2, launchTask(_, _))
+    .WillOnce(DoAll(SaveArg<1>(&exec2Task),
+                    Trigger(&exec2LaunchTaskCall),
+                    SendStatusUpdate(TASK_RUNNING)));
+
+  EXPECT_CALL(exec2, shutdown(_))
+    .WillOnce(Trigger(&exec2ShutdownCall));
+
+  ExecutorID executorId1;
+  executorId1.set_value("executor-1");
+
+  ExecutorID executorId2;
+  executorId2.set_value("executor-2");
+
+  map<ExecutorID, Executor*> execs;
+  execs[executorId1] = &exec1;
+  execs[executorId2] = &exec2;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers;
+  TaskStatus status1, status2;
+
+  trigger resourceOffersCall, statusUpdateCall1, statusUpdateCall2;
+
+  EXPECT_CALL(sched, registered(&driver, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&status1), Trigger(&statusUpdateCall1)))
+    .WillOnce(DoAll(SaveArg<1>(&status2), Trigger(&statusUpdateCall2)));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  ASSERT_NE(0, offers.size());
+
+  TaskDescription task1;
+  task1.set_name("");
+  task1.mutable_task_id()->set_value("1");
+  task1.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task1.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:512"));
+  task1.mutable_executor()->mutable_executor_id()->MergeFrom(executorId1);
+  task1.mutable_executor()->set_uri("noexecutor");
+
+  TaskDescription task2;
+  task2.set_name("");
+  task2.mutable_task_id()->set_value("2");
+  task2.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task2.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:512"));
+  task2.mutable_executor()->mutable_executor_id()->MergeFrom(executorId2);
+  task2.mutable_executor()->set_uri("noexecutor");
+
+  vector<TaskDescription> tasks;
+  tasks.push_back(task1);
+  tasks.push_back(task2);
+
+  driver.launchTasks(offers[0].id(), tasks);
+
+  WAIT_UNTIL(statusUpdateCall1);
+
+  EXPECT_EQ(TASK_RUNNING, status1.state());
+
+  WAIT_UNTIL(statusUpdateCall2);
+
+  EXPECT_EQ(TASK_RUNNING, status2.state());
+
+  WAIT_UNTIL(exec1LaunchTaskCall);
+
+  EXPECT_EQ(task1.task_id(), exec1Task.task_id());
+
+  WAIT_UNTIL(exec2LaunchTaskCall);
+
+  EXPECT_EQ(task2.task_id(), exec2Task.task_id());
+
+  driver.stop();
+  driver.join();
+
+  WAIT_UNTIL(exec1ShutdownCall); // To ensure can deallocate MockExecutor.
+  WAIT_UNTIL(exec2ShutdownCall); // To ensure can deallocate MockExecutor.
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+}
+
+TEST(MasterTest, OfferAggregation)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  Clock::pause();
+
+  // Allocate on every change so that only the master holds back offers.
+  SimpleAllocator a(0.0);
+
+  Configuration conf;
+  conf.set("offer_aggregation_interval", 10.0);
+
+  Master m(&a, conf);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  trigger shutdownCall;
+
+  EXPECT_CALL(exec, init(_, _))
+    .Times(1);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdate(TASK_RUNNING));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers1, offers2;
+
+  trigger resourceOffersCall1, resourceOffersCall2, statusUpdateCall;
+
+  EXPECT_CALL(sched, registered(&driver, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers1),
+                    Trigger(&resourceOffersCall1)))
+    .WillOnce(DoAll(SaveArg<1>(&offers2),
+                    Trigger(&resourceOffersCall2)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(Trigger(&statusUpdateCall));
+
+  driver.start();
+
+  // The first offers get sent right away.
+  WAIT_UNTIL(resourceOffersCall1);
+
+  EXPECT_EQ(1, offers1.size());
+
+  // Use half of the resources so that the rest get offered again.
+  TaskDescription task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->MergeFrom(offers1[0].slave_id());
+  task.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:512"));
+
+  vector<TaskDescription> tasks;
+  tasks.push_back(task);
+
+  driver.launchTasks(offers1[0].id(), tasks);
+
+  WAIT_UNTIL(statusUpdateCall);
+
+  // The new offer is held back until the aggregation interval is up.
+  EXPECT_FALSE(resourceOffersCall2.value);
+
+  Clock::advance(10.0);
+
+  WAIT_UNTIL(resourceOffersCall2);
+
+  EXPECT_EQ(1, offers2.size());
+
+  Resources resources2(offers2[0].resources());
+  EXPECT_EQ(1, resources2.get("cpus", Value::Scalar()).value());
+  EXPECT_EQ(512, resources2.get("mem", Value::Scalar()).value());
+
+  driver.stop();
+  driver.join();
+
+  WAIT_UNTIL(shutdownCall); // To ensure can deallocate MockExecutor.
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+
+  Clock::resume();
+}
+
+
+TEST(MasterTest, ReservedResourcesGetOfferedToOwnerFirst)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  SimpleAllocator a(0.0);
+  Master m(&a);
+  PID<Master> master = process::spawn(&m);
+
+  // Both frameworks register before there are any slaves, the one
+  // the slave reserves resources for second.
+  MockScheduler sched1;
+  MesosSchedulerDriver driver1(&sched1, "batch", DEFAULT_EXECUTOR_INFO, master);
+
+  trigger registeredCall1;
+
+  EXPECT_CALL(sched1, registered(&driver1, _))
+    .WillOnce(Trigger(&registeredCall1));
+
+  EXPECT_CALL(sched1, resourceOffers(&driver1, _))
+    .Times(0);
+
+  driver1.start();
+
+  WAIT_UNTIL(registeredCall1);
+
+  MockScheduler sched2;
+  MesosSchedulerDriver driver2(&sched2, "services", DEFAULT_EXECUTOR_INFO,
+                               master);
+
+  vector<Offer> offers;
+
+  trigger registeredCall2, resourceOffersCall2;
+
+  EXPECT_CALL(sched2, registered(&driver2, _))
+    .WillOnce(Trigger(&registeredCall2));
+
+  EXPECT_CALL(sched2, resourceOffers(&driver2, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall2)))
+    .WillRepeatedly(Return());
+
+  driver2.start();
+
+  WAIT_UNTIL(registeredCall2);
+
+  map<ExecutorID, Executor*> execs;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Configuration conf;
+  conf.set("resources", "cpus:2;mem:1024");
+  conf.set("reservations", "services=cpus:1;mem:512");
+
+  Slave s(conf, true, &isolationModule);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  WAIT_UNTIL(resourceOffersCall2);
+
+  EXPECT_EQ(1, offers.size());
+
+  driver1.stop();
+  driver2.stop();
+
+  driver1.join();
+  driver2.join();
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+}
+
+
+TEST(MasterTest, QueuedTasksGetPlacedWithoutOffers)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  MockFilter filter;
+  process::filter(&filter);
+
+  EXPECT_MESSAGE(filter, _, _, _)
+    .WillRepeatedly(Return(false));
+
+  SimpleAllocator a(0.0);
+  Master m(&a);
+  PID<Master> master = process::spawn(&m);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+
+  TaskStatus status;
+
+  trigger registeredCall, queueTasksMsg, statusUpdateCall;
+
+  EXPECT_CALL(sched, registered(&driver, _))
+    .WillOnce(Trigger(&registeredCall));
+
+  // The task uses all of the slave's resources, so nothing is left
+  // to offer.
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .Times(0);
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&status),
+                    Trigger(&statusUpdateCall)));
+
+  EXPECT_MESSAGE(filter, Eq(QueueTasksMessage().GetTypeName()), _, _)
+    .WillOnce(DoAll(Trigger(&queueTasksMsg),
+                    Return(false)));
+
+  driver.start();
+
+  WAIT_UNTIL(registeredCall);
+
+  // Queue the task before there are any slaves to place it on.
+  TaskDescription task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->set_value("");
+  task.mutable_resources()->MergeFrom(Resources::parse("cpus:2;mem:1024"));
+
+  vector<TaskDescription> tasks;
+  tasks.push_back(task);
+
+  driver.queueTasks(tasks);
+
+  WAIT_UNTIL(queueTasksMsg);
+
+  MockExecutor exec;
+
+  trigger shutdownCall;
+
+  EXPECT_CALL(exec, init(_, _))
+    .Times(1);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdate(TASK_RUNNING));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  WAIT_UNTIL(statusUpdateCall);
+
+  EXPECT_EQ("1", status.task_id().value());
+  EXPECT_EQ(TASK_RUNNING, status.state());
+
+  driver.stop();
+  driver.join();
+
+  WAIT_UNTIL(shutdownCall); // To ensure can deallocate MockExecutor.
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+
+  process::filter(NULL);
+}
+
+
+TEST(MasterTest, ReconcileTasks)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  MockFilter filter;
+  process::filter(&filter);
+
+  EXPECT_MESSAGE(filter, _, _, _)
+    .WillRepeatedly(Return(false));
+
+  SimpleAllocator a(0.0);
+  Master m(&a);
+  PID<Master> master = process::spawn(&m);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+
+  TaskStatus status1, status2, status3;
+
+  trigger registeredCall, queueTasksMsg, statusUpdatesCall, allStatusUpdateCall;
+
+  EXPECT_CALL(sched, registered(&driver, _))
+    .WillOnce(Trigger(&registeredCall));
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(SaveArg<1>(&status1))
+    .WillOnce(DoAll(SaveArg<1>(&status2),
+                    Trigger(&statusUpdatesCall)))
+    .WillOnce(DoAll(SaveArg<1>(&status3),
+                    Trigger(&allStatusUpdateCall)));
+
+  EXPECT_MESSAGE(filter, Eq(QueueTasksMessage().GetTypeName()), _, _)
+    .WillOnce(DoAll(Trigger(&queueTasksMsg),
+                    Return(false)));
+
+  driver.start();
+
+  WAIT_UNTIL(registeredCall);
+
+  // Queue a task (there are no slaves to place it on).
+  TaskDescription task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->set_value("");
+  task.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:512"));
+
+  vector<TaskDescription> tasks;
+  tasks.push_back(task);
+
+  driver.queueTasks(tasks);
+
+  WAIT_UNTIL(queueTasksMsg);
+
+  // The queued task is starting and the unknown one is lost.
+  vector<TaskID> taskIds;
+  taskIds.push_back(task.task_id());
+  taskIds.push_back(task.task_id());
+  taskIds.back().set_value("2");
+
+  driver.reconcileTasks(taskIds);
+
+  WAIT_UNTIL(statusUpdatesCall);
+
+  EXPECT_EQ("1", status1.task_id().value());
+  EXPECT_EQ(TASK_STARTING, status1.state());
+  EXPECT_EQ("2", status2.task_id().value());
+  EXPECT_EQ(TASK_LOST, status2.state());
+
+  // Reconciling all of the tasks only includes the known one.
+  driver.reconcileTasks(vector<TaskID>());
+
+  WAIT_UNTIL(allStatusUpdateCall);
+
+  EXPECT_EQ("1", status3.task_id().value());
+  EXPECT_EQ(TASK_STARTING, status3.state());
+
+  driver.stop();
+  driver.join();
+
+  process::terminate(master);
+  process::wait(master);
+
+  process::filter(NULL);
+}
+
+
+TEST(MasterTest, OfferTimeout)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  Clock::pause();
+
+  SimpleAllocator a(0.0);
+
+  Configuration conf;
+  conf.set("offer_timeout", 5.0);
+
+  Master m(&a, conf);
+  PID<Master> master = process::spawn(&m);
+
+  map<ExecutorID, Executor*> execs;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers1, offers2;
+
+  trigger resourceOffersCall1, resourceOffersCall2, offerRescindedCall;
+
+  EXPECT_CALL(sched, registered(&driver, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers1),
+                    Trigger(&resourceOffersCall1)))
+    .WillOnce(DoAll(SaveArg<1>(&offers2),
+                    Trigger(&resourceOffersCall2)))
+    .WillRepeatedly(Return());
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall1);
+
+  EXPECT_EQ(1, offers1.size());
+
+  EXPECT_CALL(sched, offerRescinded(&driver, offers1[0].id()))
+    .WillOnce(Trigger(&offerRescindedCall));
+
+  // Sitting on the offer gets it rescinded (and offered again).
+  Clock::advance(6.0);
+
+  WAIT_UNTIL(offerRescindedCall);
+  WAIT_UNTIL(resourceOffersCall2);
+
+  EXPECT_EQ(1, offers2.size());
+  EXPECT_NE(offers1[0].id().value(), offers2[0].id().value());
+
+  driver.stop();
+  driver.join();
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+
+  Clock::resume();
+}
+
+
+TEST(MasterTest, StickyFrameworkGetsFreedResourcesRightBack)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  Clock::pause();
+
+  SimpleAllocator a(0.0);
+  Master m(&a);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  trigger shutdownCall;
+
+  EXPECT_CALL(exec, init(_, _))
+    .Times(1);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdate(TASK_FINISHED));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  map<string, string> params;
+  params["url"] = string(master);
+  params["framework_sticky"] = "1";
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, params);
+
+  vector<Offer> offers1, offers2, offers3;
+
+  trigger resourceOffersCall1, resourceOffersCall2, resourceOffersCall3;
+  trigger statusUpdateCall, offerRescindedCall;
+
+  EXPECT_CALL(sched, registered(&driver, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers1),
+                    Trigger(&resourceOffersCall1)))
+    .WillOnce(DoAll(SaveArg<1>(&offers2),
+                    Trigger(&resourceOffersCall2)))
+    .WillOnce(DoAll(SaveArg<1>(&offers3),
+                    Trigger(&resourceOffersCall3)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(Trigger(&statusUpdateCall));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall1);
+
+  EXPECT_EQ(1, offers1.size());
+
+  TaskDescription task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->MergeFrom(offers1[0].slave_id());
+  task.mutable_resources()->MergeFrom(offers1[0].resources());
+
+  vector<TaskDescription> tasks;
+  tasks.push_back(task);
+
+  driver.launchTasks(offers1[0].id(), tasks);
+
+  // The resources of the finished task get offered right back.
+  WAIT_UNTIL(statusUpdateCall);
+  WAIT_UNTIL(resourceOffersCall2);
+
+  EXPECT_EQ(1, offers2.size());
+
+  Resources resources2(offers2[0].resources());
+  EXPECT_EQ(2, resources2.get("cpus", Value::Scalar()).value());
+  EXPECT_EQ(1024, resources2.get("mem", Value::Scalar()).value());
+
+  EXPECT_CALL(sched, offerRescinded(&driver, offers2[0].id()))
+    .WillOnce(Trigger(&offerRescindedCall));
+
+  // Unless they get used quickly they go back to the allocator (and
+  // get offered again as usual).
+  Clock::advance(master::STICKY_OFFER_TIMEOUT + 1.0);
+
+  WAIT_UNTIL(offerRescindedCall);
+  WAIT_UNTIL(resourceOffersCall3);
+
+  EXPECT_EQ(1, offers3.size());
+  EXPECT_NE(offers2[0].id(), offers3[0].id());
+
+  driver.stop();
+  driver.join();
+
+  WAIT_UNTIL(shutdownCall); // To ensure can deallocate MockExecutor.
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+
+  Clock::resume();
+}
+
+
+TEST(MasterTest, BatchedLaunchAndDecline)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  // Allocate on every change so that declined resources come right back.
+  SimpleAllocator a(0.0);
+  Master m(&a);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
+
+  trigger shutdownCall;
+
+  EXPECT_CALL(exec, init(_, _))
+    .Times(1);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdate(TASK_RUNNING));
+
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
+
+  map<ExecutorID, Executor*> execs;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
+
+  TestingIsolationModule isolationModule(execs);
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+
+  Slave s(resources, true, &isolationModule);
+  PID<Slave> slave = process::spawn(&s);
+
+  BasicMasterDetector detector(master, slave, true);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers1, offers2, offers3;
+
+  trigger resourceOffersCall1, resourceOffersCall2, resourceOffersCall3;
+  trigger statusUpdateCall;
+
+  EXPECT_CALL(sched, registered(&driver, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers1),
+                    Trigger(&resourceOffersCall1)))
+    .WillOnce(DoAll(SaveArg<1>(&offers2),
+                    Trigger(&resourceOffersCall2)))
+    .WillOnce(DoAll(SaveArg<1>(&offers3),
+                    Trigger(&resourceOffersCall3)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(Trigger(&statusUpdateCall));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall1);
+
+  EXPECT_EQ(1, offers1.size());
+
+  // Use half of the resources so that the rest get offered again.
+  TaskDescription task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->MergeFrom(offers1[0].slave_id());
+  task.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:512"));
+
+  vector<pair<OfferID, vector<TaskDescription> > > launches;
+  launches.push_back(make_pair(offers1[0].id(),
+                               vector<TaskDescription>(1, task)));
+
+  driver.launchTasks(launches);
+
+  WAIT_UNTIL(statusUpdateCall);
+  WAIT_UNTIL(resourceOffersCall2);
+
+  EXPECT_EQ(1, offers2.size());
+
+  // Declining without a refusal timeout gets the resources offered
+  // again right away.
+  Filters filters;
+  filters.set_refuse_seconds(0);
+
+  driver.declineOffers(vector<OfferID>(1, offers2[0].id()), filters);
+
+  WAIT_UNTIL(resourceOffersCall3);
+
+  EXPECT_EQ(1, offers3.size());
+  EXPECT_EQ(Resources(offers2[0].resources()),
+            Resources(offers3[0].resources()));
+
+  driver.stop();
+  driver.join();
+
+  WAIT_UNTIL(shutdownCall); // To ensure can deallocate MockExecutor.
+
+  process::terminate(slave);
+  process::wait(slave);
+
+  process::terminate(master);
+  process::wait(master);
+}
+
+
+// FrameworksManager test cases.
+
+// The isolation module should hear about the resources of a task
+// right away when it starts, but only a little later when it ends
+// (see Slave::resourcesChanged).
+TEST(MasterTest, ShrunkResourcesChangeLater)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  SimpleAllocator a;
+  Master m(&a);
+  PID<Master> master = process::spawn(&m);
+
+  MockExecutor exec;
 
-  EXPECT_CALL(exec2, launchTask(_, _))
-    .WillOnce(DoAll(SaveArg<1>(&exec2Task),
-                    Trigger(&exec2LaunchTaskCall),
-                    SendStatusUpdate(TASK_RUNNING)));
+  trigger shutdownCall;
 
-  EXPECT_CALL(exec2, shutdown(_))
-    .WillOnce(Trigger(&exec2ShutdownCall));
+  EXPECT_CALL(exec, init(_, _))
+    .Times(1);
 
-  ExecutorID executorId1;
-  executorId1.set_value("executor-1");
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdate(TASK_FINISHED));
 
-  ExecutorID executorId2;
-  executorId2.set_value("executor-2");
+  EXPECT_CALL(exec, shutdown(_))
+    .WillOnce(Trigger(&shutdownCall));
 
   map<ExecutorID, Executor*> execs;
-  execs[executorId1] = &exec1;
-  execs[executorId2] = &exec2;
+  execs[DEFAULT_EXECUTOR_ID] = &exec;
 
   TestingIsolationModule isolationModule(execs);
 
@@ -433,9 +1889,9 @@ TEST(MasterTest, MultipleExecutors)
   MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
 
   vector<Offer> offers;
-  TaskStatus status1, status2;
 
-  trigger resourceOffersCall, statusUpdateCall1, statusUpdateCall2;
+  trigger resourceOffersCall, statusUpdateCall;
+  trigger grownCall, shrunkCall;
 
   EXPECT_CALL(sched, registered(&driver, _))
     .Times(1);
@@ -446,58 +1902,45 @@ TEST(MasterTest, MultipleExecutors)
     .WillRepeatedly(Return());
 
   EXPECT_CALL(sched, statusUpdate(&driver, _))
-    .WillOnce(DoAll(SaveArg<1>(&status1), Trigger(&statusUpdateCall1)))
-    .WillOnce(DoAll(SaveArg<1>(&status2), Trigger(&statusUpdateCall2)));
+    .WillOnce(Trigger(&statusUpdateCall));
 
   driver.start();
 
   WAIT_UNTIL(resourceOffersCall);
 
-  ASSERT_NE(0, offers.size());
-
-  TaskDescription task1;
-  task1.set_name("");
-  task1.mutable_task_id()->set_value("1");
-  task1.mutable_slave_id()->MergeFrom(offers[0].slave_id());
-  task1.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:512"));
-  task1.mutable_executor()->mutable_executor_id()->MergeFrom(executorId1);
-  task1.mutable_executor()->set_uri("noexecutor");
+  EXPECT_NE(0, offers.size());
 
-  TaskDescription task2;
-  task2.set_name("");
-  task2.mutable_task_id()->set_value("2");
-  task2.mutable_slave_id()->MergeFrom(offers[0].slave_id());
-  task2.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:512"));
-  task2.mutable_executor()->mutable_executor_id()->MergeFrom(executorId2);
-  task2.mutable_executor()->set_uri("noexecutor");
+  TaskDescription task;
+  task.set_name("");
+  task.mutable_task_id()->set_value("1");
+  task.mutable_slave_id()->MergeFrom(offers[0].slave_id());
+  task.mutable_resources()->MergeFrom(offers[0].resources());
 
   vector<TaskDescription> tasks;
-  tasks.push_back(task1);
-  tasks.push_back(task2);
-
-  driver.launchTasks(offers[0].id(), tasks);
-
-  WAIT_UNTIL(statusUpdateCall1);
-
-  EXPECT_EQ(TASK_RUNNING, status1.state());
+  tasks.push_back(task);
 
-  WAIT_UNTIL(statusUpdateCall2);
+  EXPECT_CALL(isolationModule,
+              resourcesChanged(_, _, Resources(offers[0].resources())))
+    .WillOnce(Trigger(&grownCall));
 
-  EXPECT_EQ(TASK_RUNNING, status2.state());
+  EXPECT_CALL(isolationModule, resourcesChanged(_, _, Resources()))
+    .WillOnce(Trigger(&shrunkCall));
 
-  WAIT_UNTIL(exec1LaunchTaskCall);
+  driver.launchTasks(offers[0].id(), tasks);
 
-  EXPECT_EQ(task1.task_id(), exec1Task.task_id());
+  WAIT_UNTIL(grownCall);
+  WAIT_UNTIL(statusUpdateCall);
 
-  WAIT_UNTIL(exec2LaunchTaskCall);
+  // The task is done, but the isolation module only hears about it
+  // once the interval is up.
+  EXPECT_FALSE(shrunkCall.value);
 
-  EXPECT_EQ(task2.task_id(), exec2Task.task_id());
+  WAIT_UNTIL(shrunkCall);
 
   driver.stop();
   driver.join();
 
-  WAIT_UNTIL(exec1ShutdownCall); // To ensure can deallocate MockExecutor.
-  WAIT_UNTIL(exec2ShutdownCall); // To ensure can deallocate MockExecutor.
+  WAIT_UNTIL(shutdownCall); // To ensure can deallocate MockExecutor.
 
   process::terminate(slave);
   process::wait(slave);
@@ -507,8 +1950,6 @@ TEST(MasterTest, MultipleExecutors)
 }
 
 
-// FrameworksManager test cases.
-
 class MockFrameworksStorage : public FrameworksStorage
 {
 public:
@@ -847,3 +2288,498 @@ TEST(FrameworksManagerTest, CacheFailure)
   process::terminate(storage);
   process::wait(storage);
 }
+
+
+// Checks that the frameworks written to a LogStorage get recovered
+// by a new LogStorage (i.e., after a master fails over).
+TEST(LogStorageTest, Recover)
+{
+  const string path = utils::os::getcwd() + "/.log";
+
+  utils::os::rmdir(path);
+
+  FrameworkID id;
+  id.set_value("id");
+
+  FrameworkInfo info;
+  info.set_name("test name");
+  info.set_user("test user");
+  info.mutable_executor()->mutable_executor_id()->set_value("executor");
+  info.mutable_executor()->set_uri("noexecutor");
+
+  LogStorage* storage = new LogStorage(1, path);
+  process::spawn(storage);
+  process::dispatch(storage, &LogStorage::promote);
+
+  LogFrameworksStorage* frameworks = new LogFrameworksStorage(storage);
+  process::spawn(frameworks);
+
+  Future<Result<bool> > added =
+    process::dispatch(frameworks, &FrameworksStorage::add, id, info);
+
+  ASSERT_TRUE(added.await(5.0));
+  ASSERT_TRUE(added.get().isSome());
+  EXPECT_TRUE(added.get().get());
+
+  process::terminate(frameworks);
+  process::wait(frameworks);
+  delete frameworks;
+
+  process::terminate(storage);
+  process::wait(storage);
+  delete storage;
+
+  storage = new LogStorage(1, path);
+  process::spawn(storage);
+  process::dispatch(storage, &LogStorage::promote);
+
+  frameworks = new LogFrameworksStorage(storage);
+  process::spawn(frameworks);
+
+  Future<Result<map<FrameworkID, FrameworkInfo> > > list =
+    process::dispatch(frameworks, &FrameworksStorage::list);
+
+  ASSERT_TRUE(list.await(5.0));
+  ASSERT_TRUE(list.get().isSome());
+  ASSERT_EQ(1, list.get().get().size());
+  EXPECT_EQ(info.name(), list.get().get().begin()->second.name());
+
+  process::terminate(frameworks);
+  process::wait(frameworks);
+  delete frameworks;
+
+  process::terminate(storage);
+  process::wait(storage);
+  delete storage;
+
+  utils::os::rmdir(path);
+}
+
+
+// Checks that a batch of changes written to a LogStorage (which gets
+// written as a single entry of the log) gets recovered as a whole.
+TEST(LogStorageTest, RecoverBatch)
+{
+  const string path = utils::os::getcwd() + "/.log";
+
+  utils::os::rmdir(path);
+
+  vector<MasterStateEntry> entries;
+
+  for (int i = 0; i < 3; i++) {
+    MasterStateEntry entry;
+    entry.set_type(MasterStateEntry::ADD_SLAVE);
+    entry.mutable_slave()->set_hostname("host" + utils::stringify(i));
+    entry.mutable_slave()->set_port(5051);
+    entries.push_back(entry);
+  }
+
+  LogStorage* storage = new LogStorage(1, path);
+  process::spawn(storage);
+  process::dispatch(storage, &LogStorage::promote);
+
+  Future<bool> written =
+    process::dispatch(storage, &LogStorage::writeBatch, entries);
+
+  ASSERT_TRUE(written.await(5.0));
+  EXPECT_TRUE(written.get());
+
+  process::terminate(storage);
+  process::wait(storage);
+  delete storage;
+
+  storage = new LogStorage(1, path);
+  process::spawn(storage);
+  process::dispatch(storage, &LogStorage::promote);
+
+  Future<Result<MasterState> > state =
+    process::dispatch(storage, &LogStorage::state);
+
+  ASSERT_TRUE(state.await(5.0));
+  ASSERT_TRUE(state.get().isSome());
+  EXPECT_EQ(3, state.get().get().active_size());
+
+  process::terminate(storage);
+  process::wait(storage);
+  delete storage;
+
+  utils::os::rmdir(path);
+}
+
+TEST(AttributeIndexTest, FindAndMatch)
+{
+  AttributeIndex index;
+
+  SlaveID slave1;
+  slave1.set_value("slave1");
+
+  SlaveID slave2;
+  slave2.set_value("slave2");
+
+  index.add(slave1, Attributes::parse("rack:r12;gpu:true"));
+  index.add(slave2, Attributes::parse("rack:r13;gpu:true"));
+
+  Attributes gpu = Attributes::parse("gpu:true");
+  Attributes r12 = Attributes::parse("rack:r12;gpu:true");
+  Attributes r14 = Attributes::parse("rack:r14");
+
+  EXPECT_EQ(2u, index.find(gpu).size());
+  EXPECT_EQ(2u, index.find(Attributes()).size());
+
+  hashset<SlaveID> found = index.find(r12);
+  ASSERT_EQ(1u, found.size());
+  EXPECT_TRUE(found.contains(slave1));
+
+  EXPECT_TRUE(index.find(r14).empty());
+
+  EXPECT_TRUE(index.matches(slave1, r12));
+  EXPECT_FALSE(index.matches(slave2, r12));
+  EXPECT_TRUE(index.matches(slave2, Attributes()));
+
+  // Re-adding a slave replaces its attributes.
+  index.add(slave2, Attributes::parse("rack:r14"));
+  EXPECT_EQ(1u, index.find(gpu).size());
+  EXPECT_TRUE(index.matches(slave2, r14));
+
+  index.remove(slave1);
+  EXPECT_TRUE(index.find(gpu).empty());
+  EXPECT_EQ(1u, index.find(Attributes()).size());
+}
+
+
+TEST(OfferFiltersTest, FiltersAndRefusals)
+{
+  OfferFilters filters;
+
+  FrameworkID framework1;
+  framework1.set_value("framework1");
+
+  FrameworkID framework2;
+  framework2.set_value("framework2");
+
+  SlaveID slave;
+  slave.set_value("slave");
+
+  Resources resources = Resources::parse("cpus:2;mem:1024");
+  Resources more = Resources::parse("cpus:3;mem:1024");
+
+  // A filter only applies to (at most) the filtered resources.
+  filters.add(framework1, slave, resources, 10.0);
+  EXPECT_TRUE(filters.filtered(framework1, slave, resources));
+  EXPECT_FALSE(filters.filtered(framework1, slave, more));
+  EXPECT_FALSE(filters.filtered(framework2, slave, resources));
+
+  filters.expire(5.0);
+  EXPECT_TRUE(filters.filtered(framework1, slave, resources));
+
+  filters.expire(10.0);
+  EXPECT_FALSE(filters.filtered(framework1, slave, resources));
+
+  // Clearing a slave only removes the refusals.
+  filters.refuse(framework1, slave, resources);
+  filters.refuse(framework2, slave, resources);
+  EXPECT_EQ(2, filters.refusals(slave));
+
+  filters.add(framework2, slave, resources, 0);
+  EXPECT_EQ(1, filters.refusals(slave));
+
+  filters.clear(slave);
+  EXPECT_EQ(0, filters.refusals(slave));
+  EXPECT_FALSE(filters.filtered(framework1, slave, resources));
+  EXPECT_TRUE(filters.filtered(framework2, slave, resources));
+
+  filters.remove(framework2);
+  EXPECT_FALSE(filters.filtered(framework2, slave, resources));
+}
+
+
+TEST(SlaveHealthTest, PingsAndTimeouts)
+{
+  // Three buckets and a slave is lost after two missed pings.
+  SlaveHealth health(3, 2);
+
+  UPID pid1("slave", 1, 1);
+  UPID pid2("slave", 2, 2);
+
+  SlaveID slaveId1;
+  slaveId1.set_value("slave1");
+
+  SlaveID slaveId2;
+  slaveId2.set_value("slave2");
+
+  vector<UPID> pings;
+  vector<SlaveID> lost;
+
+  // A new slave isn't checked until a full interval has passed.
+  health.add(pid1, slaveId1);
+
+  health.check(&pings, &lost);
+  health.check(&pings, &lost);
+  EXPECT_TRUE(pings.empty());
+
+  health.check(&pings, &lost);
+  EXPECT_THAT(pings, ElementsAre(pid1));
+  EXPECT_TRUE(lost.empty());
+
+  // Hearing from a slave means it doesn't need to get pinged.
+  pings.clear();
+  health.heard(pid1);
+  health.heard(pid2);
+
+  health.add(pid2, slaveId2);
+
+  for (int i = 0; i < 3; i++) {
+    health.check(&pings, &lost);
+  }
+
+  EXPECT_THAT(pings, ElementsAre(pid2));
+  EXPECT_TRUE(lost.empty());
+
+  // Slave 1 gets pinged again (since it hasn't been heard from since
+  // its last check) and is lost after missing two pings.
+  pings.clear();
+  health.heard(pid2);
+
+  for (int i = 0; i < 3; i++) {
+    health.check(&pings, &lost);
+  }
+
+  EXPECT_THAT(pings, ElementsAre(pid1));
+  EXPECT_TRUE(lost.empty());
+
+  pings.clear();
+  for (int i = 0; i < 6; i++) {
+    health.check(&pings, &lost);
+  }
+
+  EXPECT_THAT(lost, ElementsAre(slaveId1));
+  EXPECT_EQ(1, health.size());
+
+  health.remove(pid2);
+  EXPECT_EQ(0, health.size());
+}
+
+
+TEST(MasterTest, SlaveFreeResources)
+{
+  SlaveInfo slaveInfo;
+  slaveInfo.set_hostname("localhost");
+  slaveInfo.mutable_resources()->MergeFrom(
+      Resources::parse("cpus:4;mem:1024"));
+
+  SlaveID slaveId;
+  slaveId.set_value("slave");
+
+  master::Slave slave(slaveInfo, slaveId, UPID(), 0);
+
+  EXPECT_EQ(Resources::parse("cpus:4;mem:1024"), slave.resourcesFree());
+
+  uint64_t version = slave.version;
+
+  FrameworkID frameworkId;
+  frameworkId.set_value("framework");
+
+  ExecutorInfo executorInfo;
+  executorInfo.mutable_executor_id()->set_value("executor");
+  executorInfo.set_uri("noexecutor");
+  executorInfo.mutable_resources()->MergeFrom(
+      Resources::parse("cpus:1;mem:512"));
+
+  slave.addExecutor(frameworkId, executorInfo);
+
+  EXPECT_GT(slave.version, version);
+  EXPECT_EQ(Resources::parse("cpus:3;mem:512"), slave.resourcesFree());
+
+  version = slave.version;
+
+  slave.removeExecutor(frameworkId, executorInfo.executor_id());
+
+  EXPECT_GT(slave.version, version);
+  EXPECT_EQ(Resources::parse("cpus:4;mem:1024"), slave.resourcesFree());
+}
+
+
+TEST(MasterTest, CompletedTasks)
+{
+  FrameworkInfo info;
+  info.set_user("user");
+  info.set_name("");
+
+  FrameworkID frameworkId;
+  frameworkId.set_value("framework");
+
+  Framework framework(info, frameworkId, UPID(), 0);
+
+  // Complete one more task than we keep around.
+  const int max = master::MAX_COMPLETED_TASKS_PER_FRAMEWORK;
+
+  for (int i = 0; i <= max; i++) {
+    Task task;
+    task.set_name("");
+    task.mutable_task_id()->set_value(utils::stringify(i));
+    task.mutable_framework_id()->MergeFrom(frameworkId);
+    task.mutable_slave_id()->set_value("slave");
+    task.mutable_executor_id()->set_value("executor");
+    task.set_state(TASK_FINISHED);
+
+    framework.addTask(&task);
+    framework.removeTask(&task);
+  }
+
+  // The oldest block of (compressed) tasks got dropped.
+  const int kept = max - TaskArchive::BLOCK_SIZE + 1;
+
+  ASSERT_EQ(kept, framework.completedTasks.size());
+
+  vector<Task> tasks = framework.completedTasks.tasks();
+
+  ASSERT_EQ(kept, tasks.size());
+  EXPECT_EQ(utils::stringify(TaskArchive::BLOCK_SIZE),
+            tasks.front().task_id().value());
+  EXPECT_EQ(utils::stringify(max), tasks.back().task_id().value());
+  EXPECT_EQ(frameworkId, tasks.back().framework_id());
+  EXPECT_EQ(TASK_FINISHED, tasks.back().state());
+
+  // The (similar) tasks compress well.
+  EXPECT_LT(framework.completedTasks.bytes(),
+            (size_t) kept * tasks.back().ByteSize() / 2);
+}
+
+
+// Exposes the allocation ordering of the DRF allocator.
+class TestDRFAllocator : public DRFAllocator
+{
+public:
+  using DRFAllocator::getAllocationOrdering;
+};
+
+
+TEST(DRFAllocatorTest, HierarchicalWeightedShares)
+{
+  TestDRFAllocator allocator;
+
+  // The allocator doesn't use the master as long as it has nothing to
+  // offer (i.e., since the slave isn't active).
+  allocator.initialize(NULL);
+
+  SlaveInfo slaveInfo;
+  slaveInfo.set_hostname("localhost");
+  slaveInfo.mutable_resources()->MergeFrom(
+      Resources::parse("cpus:10;mem:10240;ports:[1-100]"));
+
+  SlaveID slaveId;
+  slaveId.set_value("slave");
+
+  master::Slave slave(slaveInfo, slaveId, UPID(), 0);
+  slave.active = false;
+
+  allocator.slaveAdded(&slave);
+
+  FrameworkInfo info;
+  info.set_user("user");
+  info.set_name("");
+
+  FrameworkID frameworkId;
+
+  // Group "a" has a share of 0.9 because of the ports.
+  info.set_group("a");
+
+  frameworkId.set_value("framework1");
+  Framework framework1(info, frameworkId, UPID(), 0);
+  framework1.resources = Resources::parse("cpus:2;ports:[1-90]");
+
+  frameworkId.set_value("framework2");
+  Framework framework2(info, frameworkId, UPID(), 0);
+  framework2.resources = Resources::parse("cpus:1");
+
+  // Group "b" has a share of 0.8.
+  info.set_group("b");
+
+  frameworkId.set_value("framework3");
+  Framework framework3(info, frameworkId, UPID(), 0);
+  framework3.resources = Resources::parse("cpus:4");
+
+  info.set_weight(4);
+
+  frameworkId.set_value("framework4");
+  Framework framework4(info, frameworkId, UPID(), 0);
+  framework4.resources = Resources::parse("cpus:4");
+
+  allocator.frameworkAdded(&framework1);
+  allocator.frameworkAdded(&framework2);
+  allocator.frameworkAdded(&framework3);
+  allocator.frameworkAdded(&framework4);
+
+  // Group "b" goes first, and its fourth framework goes before its
+  // third one because of its weight.
+  EXPECT_THAT(allocator.getAllocationOrdering(),
+              ElementsAre(&framework4, &framework3,
+                          &framework2, &framework1));
+
+  // Adding a slave with the same resources only changes the amounts
+  // in the total, which lowers group "a" to a share of 0.15 (because
+  // of the cpus) while group "b" now has a share of 0.4.
+  slaveInfo.mutable_resources()->Clear();
+  slaveInfo.mutable_resources()->MergeFrom(
+      Resources::parse("cpus:10;mem:10240;ports:[101-1000]"));
+
+  slaveId.set_value("slave2");
+
+  master::Slave slave2(slaveInfo, slaveId, UPID(), 0);
+  slave2.active = false;
+
+  allocator.slaveAdded(&slave2);
+
+  EXPECT_THAT(allocator.getAllocationOrdering(),
+              ElementsAre(&framework2, &framework1,
+                          &framework4, &framework3));
+}
+
+
+TEST(DRFAllocatorTest, DiskIoAndNetBwShares)
+{
+  TestDRFAllocator allocator;
+
+  allocator.initialize(NULL);
+
+  SlaveInfo slaveInfo;
+  slaveInfo.set_hostname("localhost");
+  slaveInfo.mutable_resources()->MergeFrom(
+      Resources::parse("cpus:10;mem:10240;disk_io:100;net_bw:1000"));
+
+  SlaveID slaveId;
+  slaveId.set_value("slave");
+
+  master::Slave slave(slaveInfo, slaveId, UPID(), 0);
+  slave.active = false;
+
+  allocator.slaveAdded(&slave);
+
+  FrameworkInfo info;
+  info.set_user("user");
+  info.set_name("");
+
+  FrameworkID frameworkId;
+
+  // A share of 0.8 because of the network bandwidth.
+  frameworkId.set_value("framework1");
+  Framework framework1(info, frameworkId, UPID(), 0);
+  framework1.resources = Resources::parse("cpus:1;net_bw:800");
+
+  // A share of 0.4 because of the cpus.
+  frameworkId.set_value("framework2");
+  Framework framework2(info, frameworkId, UPID(), 0);
+  framework2.resources = Resources::parse("cpus:4;mem:1024");
+
+  // A share of 0.5 because of the disk I/O.
+  frameworkId.set_value("framework3");
+  Framework framework3(info, frameworkId, UPID(), 0);
+  framework3.resources = Resources::parse("cpus:2;disk_io:50");
+
+  allocator.frameworkAdded(&framework1);
+  allocator.frameworkAdded(&framework2);
+  allocator.frameworkAdded(&framework3);
+
+  EXPECT_THAT(allocator.getAllocationOrdering(),
+              ElementsAre(&framework2, &framework3, &framework1));
+}
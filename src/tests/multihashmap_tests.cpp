@@ -20,6 +20,7 @@
 
 #include <string>
 
+#include "common/flatmultihashmap.hpp"
 #include "common/foreach.hpp"
 #include "common/multihashmap.hpp"
 
@@ -139,3 +140,65 @@ TEST(Multihashmap, Foreach)
     }
   }
 }
+
+
+TEST(FlatMultihashmap, PutRemove)
+{
+  flatmultihashmap<string, uint16_t, 2> map;
+
+  // More values than fit in place.
+  map.put("foo", 1024);
+  map.put("foo", 1025);
+  map.put("foo", 1026);
+  map.put("bar", 1024);
+
+  ASSERT_EQ(3, map.count("foo"));
+  ASSERT_EQ(1, map.count("bar"));
+  ASSERT_EQ(0, map.count("baz"));
+  ASSERT_EQ(4, map.size());
+
+  ASSERT_TRUE(map.contains("foo"));
+  ASSERT_TRUE(map.contains("foo", 1026));
+  ASSERT_FALSE(map.contains("bar", 1025));
+
+  ASSERT_TRUE(map.remove("foo", 1024));
+  ASSERT_FALSE(map.remove("foo", 1024));
+  ASSERT_EQ(2, map.count("foo"));
+  ASSERT_TRUE(map.contains("foo", 1025));
+  ASSERT_TRUE(map.contains("foo", 1026));
+
+  ASSERT_TRUE(map.remove("foo"));
+  ASSERT_FALSE(map.contains("foo"));
+  ASSERT_EQ(1, map.size());
+
+  // Removing the last value of a key removes the key.
+  ASSERT_TRUE(map.remove("bar", 1024));
+  ASSERT_FALSE(map.contains("bar"));
+  ASSERT_TRUE(map.empty());
+}
+
+
+TEST(FlatMultihashmap, Foreach)
+{
+  flatmultihashmap<string, uint16_t> map;
+
+  map.put("foo", 1024);
+  map.put("foo", 1025);
+  map.put("bar", 1026);
+
+  int values = 0;
+  foreach (uint16_t value, map.get("foo")) {
+    ASSERT_TRUE(value == 1024 || value == 1025);
+    values++;
+  }
+  ASSERT_EQ(2, values);
+
+  typedef flatmultihashmap<string, uint16_t>::Values Values;
+
+  values = 0;
+  foreachpair (const string& key, const Values& ports, map) {
+    ASSERT_TRUE(key == "foo" || key == "bar");
+    values += ports.size();
+  }
+  ASSERT_EQ(3, values);
+}
@@ -0,0 +1,147 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <mesos/offer_index.hpp>
+
+#include "common/resources.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+
+using std::string;
+using std::vector;
+
+
+static Offer createOffer(const string& id,
+                         const string& slaveId,
+                         const string& resources)
+{
+  Offer offer;
+  offer.mutable_id()->set_value(id);
+  offer.mutable_framework_id()->set_value("framework");
+  offer.mutable_slave_id()->set_value(slaveId);
+  offer.set_hostname(slaveId);
+  offer.mutable_resources()->MergeFrom(Resources::parse(resources));
+  return offer;
+}
+
+
+TEST(OfferIndexTest, FindsBestFit)
+{
+  OfferIndex index;
+
+  index.add(createOffer("big", "slave1", "cpus:8;mem:8192"));
+  index.add(createOffer("small", "slave2", "cpus:2;mem:1024"));
+  index.add(createOffer("lean", "slave3", "cpus:4;mem:512"));
+
+  EXPECT_EQ(3, index.size());
+
+  OfferID offerId;
+
+  // The smallest offer with enough cpus and memory.
+  Resources task = Resources::parse("cpus:2;mem:768");
+  ASSERT_TRUE(index.find(task, &offerId));
+  EXPECT_EQ("small", offerId.value());
+
+  task = Resources::parse("cpus:3;mem:768");
+  offerId.Clear();
+  ASSERT_TRUE(index.find(task, &offerId));
+  EXPECT_EQ("big", offerId.value());
+
+  task = Resources::parse("cpus:16;mem:1024");
+  EXPECT_FALSE(index.find(task, &offerId));
+}
+
+
+TEST(OfferIndexTest, TakeAndRemove)
+{
+  OfferIndex index;
+
+  index.add(createOffer("offer1", "slave1", "cpus:4;mem:4096"));
+  index.add(createOffer("offer2", "slave1", "cpus:1;mem:1024"));
+
+  Resources task = Resources::parse("cpus:2;mem:1024");
+
+  // Two tasks fit on the first offer, and then nothing is left.
+  OfferID offerId;
+  ASSERT_TRUE(index.take(task, &offerId));
+  EXPECT_EQ("offer1", offerId.value());
+
+  offerId.Clear();
+  ASSERT_TRUE(index.take(task, &offerId));
+  EXPECT_EQ("offer1", offerId.value());
+
+  EXPECT_FALSE(index.take(task, &offerId));
+
+  vector<Resource> remaining = index.remaining(offerId);
+  Resources left;
+  foreach (const Resource& resource, remaining) {
+    left += resource;
+  }
+  EXPECT_EQ(2048, left.get("mem", Value::Scalar()).value());
+
+  // The offer is still there as added.
+  EXPECT_EQ(Resources(index.get(offerId).resources()),
+            Resources::parse("cpus:4;mem:4096"));
+
+  EXPECT_TRUE(index.remove(offerId));
+  EXPECT_FALSE(index.remove(offerId));
+  EXPECT_EQ(1, index.size());
+
+  // Losing the slave removes the rest of its offers.
+  SlaveID slaveId;
+  slaveId.set_value("slave1");
+  index.remove(slaveId);
+  EXPECT_EQ(0, index.size());
+}
+
+
+TEST(OfferIndexTest, MatchesAttributes)
+{
+  OfferIndex index;
+
+  Offer offer1 = createOffer("offer1", "slave1", "cpus:2;mem:1024");
+  Offer offer2 = createOffer("offer2", "slave2", "cpus:4;mem:2048");
+
+  Attribute rack;
+  rack.set_name("rack");
+  rack.set_type(Value::TEXT);
+  rack.mutable_text()->set_value("r2");
+  offer2.add_attributes()->MergeFrom(rack);
+
+  index.add(offer1);
+  index.add(offer2);
+
+  vector<Attribute> attributes;
+  attributes.push_back(rack);
+
+  OfferID offerId;
+  ASSERT_TRUE(index.find(Resources::parse("cpus:1;mem:512"),
+                         &offerId, attributes));
+  EXPECT_EQ("offer2", offerId.value());
+
+  rack.mutable_text()->set_value("r3");
+  attributes[0] = rack;
+  EXPECT_FALSE(index.find(Resources::parse("cpus:1;mem:512"),
+                          &offerId, attributes));
+}
@@ -20,6 +20,7 @@
 
 #include <gmock/gmock.h>
 
+#include "common/record_file.hpp"
 #include "common/utils.hpp"
 #include "common/type_utils.hpp"
 
@@ -70,3 +71,100 @@ TEST(ProtobufIOTest, Basic)
 
   utils::os::rm(file);
 }
+
+
+TEST(ProtobufIOTest, RecordFile)
+{
+  const std::string file = ".protobuf_io_test_record_file";
+
+  const int writes = 100000;
+
+  Try<RecordWriter*> writer = RecordWriter::open(file);
+  ASSERT_TRUE(writer.isSome());
+
+  for (int i = 0; i < writes; i++) {
+    FrameworkID frameworkId;
+    frameworkId.set_value(utils::stringify(i));
+    ASSERT_TRUE(writer.get()->write(frameworkId).isSome());
+  }
+
+  EXPECT_EQ(writes, writer.get()->count());
+  delete writer.get();
+
+  // Appending (and syncing) keeps the records already written.
+  writer = RecordWriter::open(file, true, true);
+  ASSERT_TRUE(writer.isSome());
+
+  FrameworkID last;
+  last.set_value("last");
+  ASSERT_TRUE(writer.get()->write(last).isSome());
+  ASSERT_TRUE(writer.get()->flush().isSome());
+  delete writer.get();
+
+  Try<RecordReader*> reader = RecordReader::open(file);
+  ASSERT_TRUE(reader.isSome());
+
+  for (int i = 0; i < writes; i++) {
+    FrameworkID frameworkId;
+    Result<bool> result = reader.get()->read(&frameworkId);
+    ASSERT_TRUE(result.isSome());
+    EXPECT_EQ(utils::stringify(i), frameworkId.value());
+  }
+
+  FrameworkID frameworkId;
+  Result<bool> result = reader.get()->read(&frameworkId);
+  ASSERT_TRUE(result.isSome());
+  EXPECT_EQ("last", frameworkId.value());
+
+  EXPECT_TRUE(reader.get()->read(&frameworkId).isNone());
+  delete reader.get();
+
+  utils::os::rm(file);
+}
+
+
+TEST(ProtobufIOTest, RecordFileCorruption)
+{
+  const std::string file = ".protobuf_io_test_record_file_corruption";
+
+  Try<RecordWriter*> writer = RecordWriter::open(file);
+  ASSERT_TRUE(writer.isSome());
+
+  for (int i = 0; i < 3; i++) {
+    FrameworkID frameworkId;
+    frameworkId.set_value(utils::stringify(i));
+    ASSERT_TRUE(writer.get()->write(frameworkId).isSome());
+  }
+
+  delete writer.get();
+
+  // Each record is 8 bytes of header and 3 bytes of FrameworkID.
+  const size_t size = 3 * 11;
+
+  // A partially written last record is ignored.
+  ASSERT_EQ(0, ::truncate(file.c_str(), size - 1));
+
+  Try<RecordReader*> reader = RecordReader::open(file);
+  ASSERT_TRUE(reader.isSome());
+
+  FrameworkID frameworkId;
+  EXPECT_TRUE(reader.get()->read(&frameworkId).isSome());
+  EXPECT_TRUE(reader.get()->read(&frameworkId).isSome());
+  EXPECT_TRUE(reader.get()->read(&frameworkId).isNone());
+  delete reader.get();
+
+  // A corrupted record is an error.
+  Result<int> fd = utils::os::open(file, O_WRONLY);
+  ASSERT_TRUE(fd.isSome());
+  ASSERT_EQ(1, ::pwrite(fd.get(), "x", 1, 11 + 10));
+  utils::os::close(fd.get());
+
+  reader = RecordReader::open(file);
+  ASSERT_TRUE(reader.isSome());
+
+  EXPECT_TRUE(reader.get()->read(&frameworkId).isSome());
+  EXPECT_TRUE(reader.get()->read(&frameworkId).isError());
+  delete reader.get();
+
+  utils::os::rm(file);
+}
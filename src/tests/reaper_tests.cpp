@@ -0,0 +1,145 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <gmock/gmock.h>
+
+#include <process/dispatch.hpp>
+#include <process/process.hpp>
+
+#include "slave/reaper.hpp"
+
+#include "tests/utils.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+using namespace mesos::internal::test;
+
+using mesos::internal::slave::ProcessExitedListener;
+using mesos::internal::slave::Reaper;
+
+using process::PID;
+
+using testing::_;
+
+
+class MockProcessExitedListener : public ProcessExitedListener
+{
+public:
+  MOCK_METHOD2(processExited, void(pid_t, int));
+};
+
+
+TEST(ReaperTest, ReapsAllExitedChildren)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  MockProcessExitedListener listener;
+  process::spawn(listener);
+
+  Reaper reaper;
+  process::spawn(reaper);
+
+  process::dispatch(reaper,
+                    &Reaper::addProcessExitedListener,
+                    PID<ProcessExitedListener>(listener));
+
+  trigger exited[3];
+
+  EXPECT_CALL(listener, processExited(_, _))
+    .WillOnce(Trigger(&exited[0]))
+    .WillOnce(Trigger(&exited[1]))
+    .WillOnce(Trigger(&exited[2]));
+
+  for (int i = 0; i < 3; i++) {
+    pid_t pid = fork();
+    ASSERT_NE(-1, pid);
+
+    if (pid == 0) {
+      _exit(0);
+    }
+
+    process::dispatch(reaper, &Reaper::monitor, pid);
+  }
+
+  // The children should get reaped right away (not one per second).
+  for (int i = 0; i < 3; i++) {
+    WAIT_UNTIL(exited[i]);
+  }
+
+  process::terminate(reaper);
+  process::wait(reaper);
+
+  process::terminate(listener);
+  process::wait(listener);
+}
+
+
+TEST(ReaperTest, OnlyReapsMonitoredChildren)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  MockProcessExitedListener listener;
+  process::spawn(listener);
+
+  Reaper reaper;
+  process::spawn(reaper);
+
+  process::dispatch(reaper,
+                    &Reaper::addProcessExitedListener,
+                    PID<ProcessExitedListener>(listener));
+
+  // Somebody else's child (e.g., popen's).
+  pid_t other = fork();
+  ASSERT_NE(-1, other);
+
+  if (other == 0) {
+    _exit(1);
+  }
+
+  pid_t monitored = fork();
+  ASSERT_NE(-1, monitored);
+
+  if (monitored == 0) {
+    _exit(0);
+  }
+
+  trigger exited;
+
+  EXPECT_CALL(listener, processExited(monitored, _))
+    .WillOnce(Trigger(&exited));
+
+  process::dispatch(reaper, &Reaper::monitor, monitored);
+
+  WAIT_UNTIL(exited);
+
+  // The other child is still ours to wait for.
+  int status;
+  ASSERT_EQ(other, waitpid(other, &status, 0));
+  EXPECT_EQ(1, WEXITSTATUS(status));
+
+  process::terminate(reaper);
+  process::wait(reaper);
+
+  process::terminate(listener);
+  process::wait(listener);
+}
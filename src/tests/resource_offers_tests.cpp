@@ -23,7 +23,13 @@
 
 #include "local/local.hpp"
 
+#include "master/async_allocator.hpp"
+#include "master/drf_allocator.hpp"
 #include "master/master.hpp"
+#include "master/packing_allocator.hpp"
+#include "master/splitting_allocator.hpp"
+#include "master/parallel_allocator.hpp"
+#include "master/simple_allocator.hpp"
 
 #include "slave/slave.hpp"
 
@@ -33,7 +39,13 @@ using namespace mesos;
 using namespace mesos::internal;
 using namespace mesos::internal::test;
 
+using mesos::internal::master::AsyncAllocator;
+using mesos::internal::master::DRFAllocator;
 using mesos::internal::master::Master;
+using mesos::internal::master::PackingAllocator;
+using mesos::internal::master::ParallelAllocator;
+using mesos::internal::master::SimpleAllocator;
+using mesos::internal::master::SplittingAllocator;
 
 using mesos::internal::slave::Slave;
 
@@ -46,6 +58,7 @@ using testing::_;
 using testing::AtMost;
 using testing::DoAll;
 using testing::ElementsAre;
+using testing::Eq;
 using testing::Return;
 using testing::SaveArg;
 
@@ -92,6 +105,334 @@ TEST(ResourceOffersTest, ResourceOfferWithMultipleSlaves)
 }
 
 
+TEST(ResourceOffersTest, OffersGetRescindedForStarvedFramework)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  // Preempt for frameworks starved for half a second.
+  DRFAllocator allocator(0.5);
+
+  PID<Master> master = local::launch(1, 2, 1 * Gigabyte, false, &allocator);
+
+  // The first framework sits on the offer of the only slave.
+  MockScheduler sched1;
+  MesosSchedulerDriver driver1(&sched1, "", DEFAULT_EXECUTOR_INFO, master);
+
+  trigger resourceOffersCall1, offerRescindedCall1;
+
+  EXPECT_CALL(sched1, registered(&driver1, _))
+    .Times(1);
+
+  EXPECT_CALL(sched1, resourceOffers(&driver1, _))
+    .WillOnce(Trigger(&resourceOffersCall1))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched1, offerRescinded(&driver1, _))
+    .WillOnce(Trigger(&offerRescindedCall1));
+
+  driver1.start();
+
+  WAIT_UNTIL(resourceOffersCall1);
+
+  // The second framework gets the slave once the offer is rescinded.
+  MockScheduler sched2;
+  MesosSchedulerDriver driver2(&sched2, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers2;
+
+  trigger resourceOffersCall2;
+
+  EXPECT_CALL(sched2, registered(&driver2, _))
+    .Times(1);
+
+  EXPECT_CALL(sched2, resourceOffers(&driver2, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers2),
+                    Trigger(&resourceOffersCall2)))
+    .WillRepeatedly(Return());
+
+  driver2.start();
+
+  WAIT_UNTIL(offerRescindedCall1);
+  WAIT_UNTIL(resourceOffersCall2);
+
+  EXPECT_EQ(1, offers2.size());
+
+  driver1.stop();
+  driver2.stop();
+
+  driver1.join();
+  driver2.join();
+
+  local::shutdown();
+}
+
+
+TEST(ResourceOffersTest, ResourceOfferWithPackingAllocator)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  // Offer at most two slaves to each framework per allocation pass.
+  PackingAllocator allocator(2);
+
+  PID<Master> master = local::launch(10, 2, 1 * Gigabyte, false, &allocator);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers;
+
+  trigger resourceOffersCall;
+
+  EXPECT_CALL(sched, registered(&driver, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, offerRescinded(&driver, _))
+    .Times(AtMost(1));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0, offers.size());
+  EXPECT_GE(2, offers.size());
+
+  driver.stop();
+  driver.join();
+
+  local::shutdown();
+}
+
+
+TEST(ResourceOffersTest, ResourceOfferWithSplittingAllocator)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  SplittingAllocator allocator;
+
+  PID<Master> master = local::launch(10, 2, 1 * Gigabyte, false, &allocator);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers;
+
+  trigger resourceOffersCall;
+
+  EXPECT_CALL(sched, registered(&driver, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, offerRescinded(&driver, _))
+    .Times(AtMost(1));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  // Without any tasks or requests to size offers by, the framework
+  // gets offered whole slaves.
+  EXPECT_NE(0, offers.size());
+  EXPECT_GE(10, offers.size());
+
+  Resources resources(offers[0].resources());
+  EXPECT_EQ(2, resources.get("cpus", Value::Scalar()).value());
+  EXPECT_EQ(1024, resources.get("mem", Value::Scalar()).value());
+
+  driver.stop();
+  driver.join();
+
+  local::shutdown();
+}
+
+
+TEST(ResourceOffersTest, ResourceOfferWithDRFAllocator)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  DRFAllocator allocator;
+
+  PID<Master> master = local::launch(10, 2, 1 * Gigabyte, false, &allocator);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers;
+
+  trigger resourceOffersCall;
+
+  EXPECT_CALL(sched, registered(&driver, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, offerRescinded(&driver, _))
+    .Times(AtMost(1));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0, offers.size());
+  EXPECT_GE(10, offers.size());
+
+  Resources resources(offers[0].resources());
+  EXPECT_EQ(2, resources.get("cpus", Value::Scalar()).value());
+  EXPECT_EQ(1024, resources.get("mem", Value::Scalar()).value());
+
+  driver.stop();
+  driver.join();
+
+  local::shutdown();
+}
+
+
+TEST(ResourceOffersTest, BatchedAllocation)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  // Batch everything after the first allocation pass so that the
+  // offers only get made on the next timer tick.
+  SimpleAllocator allocator(60.0, 1000);
+
+  PID<Master> master = local::launch(10, 2, 1 * Gigabyte, false, &allocator);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers;
+
+  trigger resourceOffersCall;
+
+  EXPECT_CALL(sched, registered(&driver, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, offerRescinded(&driver, _))
+    .Times(AtMost(1));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0, offers.size());
+  EXPECT_GE(10, offers.size());
+
+  Resources resources(offers[0].resources());
+  EXPECT_EQ(2, resources.get("cpus", Value::Scalar()).value());
+  EXPECT_EQ(1024, resources.get("mem", Value::Scalar()).value());
+
+  driver.stop();
+  driver.join();
+
+  local::shutdown();
+}
+
+
+TEST(ResourceOffersTest, ResourceOfferWithParallelAllocator)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  // Split even the smallest allocation passes across the workers.
+  ParallelAllocator allocator(4, 0);
+
+  PID<Master> master = local::launch(10, 2, 1 * Gigabyte, false, &allocator);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers;
+
+  trigger resourceOffersCall;
+
+  EXPECT_CALL(sched, registered(&driver, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, offerRescinded(&driver, _))
+    .Times(AtMost(1));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0, offers.size());
+  EXPECT_GE(10, offers.size());
+
+  Resources resources(offers[0].resources());
+  EXPECT_EQ(2, resources.get("cpus", Value::Scalar()).value());
+  EXPECT_EQ(1024, resources.get("mem", Value::Scalar()).value());
+
+  driver.stop();
+  driver.join();
+
+  local::shutdown();
+}
+
+
+TEST(ResourceOffersTest, ResourceOfferWithAsyncAllocator)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  AsyncAllocator allocator;
+
+  PID<Master> master = local::launch(10, 2, 1 * Gigabyte, false, &allocator);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers;
+
+  trigger resourceOffersCall;
+
+  EXPECT_CALL(sched, registered(&driver, _))
+    .Times(1);
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers),
+                    Trigger(&resourceOffersCall)))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(sched, offerRescinded(&driver, _))
+    .Times(AtMost(1));
+
+  driver.start();
+
+  WAIT_UNTIL(resourceOffersCall);
+
+  EXPECT_NE(0, offers.size());
+  EXPECT_GE(10, offers.size());
+
+  Resources resources(offers[0].resources());
+  EXPECT_EQ(2, resources.get("cpus", Value::Scalar()).value());
+  EXPECT_EQ(1024, resources.get("mem", Value::Scalar()).value());
+
+  driver.stop();
+  driver.join();
+
+  local::shutdown();
+}
+
+
 TEST(ResourceOffersTest, TaskUsesNoResources)
 {
   ASSERT_TRUE(GTEST_IS_THREADSAFE);
@@ -500,3 +841,311 @@ TEST(ResourceOffersTest, ResourceRequest)
 
   local::shutdown();
 }
+
+TEST(ResourceOffersTest, RequestedResourcesGetOfferedFirst)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  MockFilter filter;
+  process::filter(&filter);
+
+  // Allocate on every change (rather than batching).
+  SimpleAllocator allocator(0.0);
+
+  PID<Master> master = local::launch(1, 2, 1 * Gigabyte, false, &allocator);
+
+  // The first framework gets offered the slave.
+  MockScheduler sched1;
+  MesosSchedulerDriver driver1(&sched1, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers1;
+
+  trigger resourceOffersCall1;
+
+  EXPECT_CALL(sched1, registered(&driver1, _))
+    .Times(1);
+
+  EXPECT_CALL(sched1, resourceOffers(&driver1, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers1),
+                    Trigger(&resourceOffersCall1)))
+    .WillRepeatedly(Return());
+
+  driver1.start();
+
+  WAIT_UNTIL(resourceOffersCall1);
+
+  EXPECT_NE(0, offers1.size());
+
+  // The second framework would get the slave before the third one
+  // (they have the same share) if it weren't for the request.
+  MockScheduler sched2;
+  MesosSchedulerDriver driver2(&sched2, "", DEFAULT_EXECUTOR_INFO, master);
+
+  trigger registeredCall2;
+
+  EXPECT_CALL(sched2, registered(&driver2, _))
+    .WillOnce(Trigger(&registeredCall2));
+
+  EXPECT_CALL(sched2, resourceOffers(&driver2, _))
+    .Times(0);
+
+  driver2.start();
+
+  WAIT_UNTIL(registeredCall2);
+
+  MockScheduler sched3;
+  MesosSchedulerDriver driver3(&sched3, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers3;
+
+  trigger registeredCall3, resourceOffersCall3;
+
+  EXPECT_CALL(sched3, registered(&driver3, _))
+    .WillOnce(Trigger(&registeredCall3));
+
+  EXPECT_CALL(sched3, resourceOffers(&driver3, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers3),
+                    Trigger(&resourceOffersCall3)))
+    .WillRepeatedly(Return());
+
+  driver3.start();
+
+  WAIT_UNTIL(registeredCall3);
+
+  // Make sure the master gets the request before the slave is freed.
+  trigger resourceRequestMsg;
+
+  EXPECT_MESSAGE(filter, Eq(ResourceRequestMessage().GetTypeName()), _, _)
+    .WillOnce(DoAll(Trigger(&resourceRequestMsg), Return(false)));
+
+  ResourceRequest request;
+  request.mutable_slave_id()->MergeFrom(offers1[0].slave_id());
+  request.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:512"));
+
+  vector<ResourceRequest> requests;
+  requests.push_back(request);
+
+  driver3.requestResources(requests);
+
+  WAIT_UNTIL(resourceRequestMsg);
+
+  driver1.launchTasks(offers1[0].id(), vector<TaskDescription>());
+
+  WAIT_UNTIL(resourceOffersCall3);
+
+  EXPECT_EQ(1, offers3.size());
+  EXPECT_EQ(offers1[0].slave_id(), offers3[0].slave_id());
+
+  driver1.stop();
+  driver2.stop();
+  driver3.stop();
+
+  driver1.join();
+  driver2.join();
+  driver3.join();
+
+  local::shutdown();
+
+  process::filter(NULL);
+}
+
+
+TEST(ResourceOffersTest, GangRequestGetsOfferedTogether)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  MockFilter filter;
+  process::filter(&filter);
+
+  // Allocate on every change (rather than batching).
+  SimpleAllocator allocator(0.0);
+
+  PID<Master> master = local::launch(2, 2, 1 * Gigabyte, false, &allocator);
+
+  // The first framework gets offered both slaves.
+  MockScheduler sched1;
+  MesosSchedulerDriver driver1(&sched1, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers1;
+
+  trigger resourceOffersCall1;
+
+  EXPECT_CALL(sched1, registered(&driver1, _))
+    .Times(1);
+
+  EXPECT_CALL(sched1, resourceOffers(&driver1, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers1),
+                    Trigger(&resourceOffersCall1)))
+    .WillRepeatedly(Return());
+
+  driver1.start();
+
+  WAIT_UNTIL(resourceOffersCall1);
+
+  ASSERT_EQ(2, offers1.size());
+
+  // The second framework asks for both slaves at once, and only gets
+  // offered them (together) once the first framework frees both.
+  MockScheduler sched2;
+  MesosSchedulerDriver driver2(&sched2, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers2;
+
+  trigger registeredCall2, resourceOffersCall2;
+
+  EXPECT_CALL(sched2, registered(&driver2, _))
+    .WillOnce(Trigger(&registeredCall2));
+
+  EXPECT_CALL(sched2, resourceOffers(&driver2, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers2),
+                    Trigger(&resourceOffersCall2)))
+    .WillRepeatedly(Return());
+
+  driver2.start();
+
+  WAIT_UNTIL(registeredCall2);
+
+  // Make sure the master gets the request before the slaves are freed.
+  trigger resourceRequestMsg;
+
+  EXPECT_MESSAGE(filter, Eq(ResourceRequestMessage().GetTypeName()), _, _)
+    .WillOnce(DoAll(Trigger(&resourceRequestMsg), Return(false)));
+
+  ResourceRequest request;
+  request.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:512"));
+  request.set_gang(true);
+
+  vector<ResourceRequest> requests;
+  requests.push_back(request);
+  requests.push_back(request);
+
+  driver2.requestResources(requests);
+
+  WAIT_UNTIL(resourceRequestMsg);
+
+  driver1.launchTasks(offers1[0].id(), vector<TaskDescription>());
+  driver1.launchTasks(offers1[1].id(), vector<TaskDescription>());
+
+  WAIT_UNTIL(resourceOffersCall2);
+
+  EXPECT_EQ(2, offers2.size());
+
+  driver1.stop();
+  driver2.stop();
+
+  driver1.join();
+  driver2.join();
+
+  local::shutdown();
+
+  process::filter(NULL);
+}
+
+
+TEST(ResourceOffersTest, PreferredHostsGetOfferedFirst)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  MockFilter filter;
+  process::filter(&filter);
+
+  // Allocate on every change (rather than batching).
+  SimpleAllocator allocator(0.0);
+
+  PID<Master> master = local::launch(1, 2, 1 * Gigabyte, false, &allocator);
+
+  // The first framework gets offered the slave.
+  MockScheduler sched1;
+  MesosSchedulerDriver driver1(&sched1, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers1;
+
+  trigger resourceOffersCall1;
+
+  EXPECT_CALL(sched1, registered(&driver1, _))
+    .Times(1);
+
+  EXPECT_CALL(sched1, resourceOffers(&driver1, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers1),
+                    Trigger(&resourceOffersCall1)))
+    .WillRepeatedly(Return());
+
+  driver1.start();
+
+  WAIT_UNTIL(resourceOffersCall1);
+
+  EXPECT_NE(0, offers1.size());
+
+  // The second framework would get the slave before the third one
+  // (they have the same share) if it weren't for the request
+  // preferring the slave's host.
+  MockScheduler sched2;
+  MesosSchedulerDriver driver2(&sched2, "", DEFAULT_EXECUTOR_INFO, master);
+
+  trigger registeredCall2;
+
+  EXPECT_CALL(sched2, registered(&driver2, _))
+    .WillOnce(Trigger(&registeredCall2));
+
+  EXPECT_CALL(sched2, resourceOffers(&driver2, _))
+    .Times(0);
+
+  driver2.start();
+
+  WAIT_UNTIL(registeredCall2);
+
+  MockScheduler sched3;
+  MesosSchedulerDriver driver3(&sched3, "", DEFAULT_EXECUTOR_INFO, master);
+
+  vector<Offer> offers3;
+
+  trigger registeredCall3, resourceOffersCall3;
+
+  EXPECT_CALL(sched3, registered(&driver3, _))
+    .WillOnce(Trigger(&registeredCall3));
+
+  EXPECT_CALL(sched3, resourceOffers(&driver3, _))
+    .WillOnce(DoAll(SaveArg<1>(&offers3),
+                    Trigger(&resourceOffersCall3)))
+    .WillRepeatedly(Return());
+
+  driver3.start();
+
+  WAIT_UNTIL(registeredCall3);
+
+  // Make sure the master gets the request before the slave is freed.
+  trigger resourceRequestMsg;
+
+  EXPECT_MESSAGE(filter, Eq(ResourceRequestMessage().GetTypeName()), _, _)
+    .WillOnce(DoAll(Trigger(&resourceRequestMsg), Return(false)));
+
+  ResourceRequest request;
+  request.add_hosts(offers1[0].hostname());
+  request.mutable_resources()->MergeFrom(Resources::parse("cpus:1;mem:512"));
+
+  vector<ResourceRequest> requests;
+  requests.push_back(request);
+
+  driver3.requestResources(requests);
+
+  WAIT_UNTIL(resourceRequestMsg);
+
+  driver1.launchTasks(offers1[0].id(), vector<TaskDescription>());
+
+  WAIT_UNTIL(resourceOffersCall3);
+
+  EXPECT_EQ(1, offers3.size());
+  EXPECT_EQ(offers1[0].slave_id(), offers3[0].slave_id());
+
+  driver1.stop();
+  driver2.stop();
+  driver3.stop();
+
+  driver1.join();
+  driver2.join();
+  driver3.join();
+
+  local::shutdown();
+
+  process::filter(NULL);
+}
@@ -0,0 +1,272 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Microbenchmarks of the Resources algebra (which the master and the
+// allocators do lots of): adding, subtracting and comparing scalar
+// only, many range and set heavy resources, 'allocatable', 'get',
+// parsing typical slave resources and sorting frameworks by their
+// dominant shares. The inputs are the same every run (and so is the
+// output, except for the timings), and each result gets printed as
+// one JSON object per line so that runs can be compared by scripts.
+//
+// Usage: mesos-resources-bench [iterations]
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <mesos/mesos.hpp>
+
+#include "common/foreach.hpp"
+#include "common/resources.hpp"
+#include "common/timer.hpp"
+#include "common/utils.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+
+// Keeps the compiler from optimizing the benchmarks away.
+static volatile size_t sink = 0;
+
+
+static void report(const string& benchmark,
+                   const string& resources,
+                   long operations,
+                   const nanoseconds& elapsed)
+{
+  cout << std::fixed << std::setprecision(1)
+       << "{\"benchmark\": \"" << benchmark << "\""
+       << ", \"resources\": \"" << resources << "\""
+       << ", \"operations\": " << operations
+       << ", \"ns_per_operation\": " << elapsed.value / operations
+       << "}" << endl;
+}
+
+
+// Returns "[<begin>-<begin + 1>,<begin + 3>-<begin + 4>,...]" with
+// 'count' ranges (i.e., every third value is missing).
+static string ranges(int begin, int count)
+{
+  string result = "[";
+  for (int i = 0; i < count; i++) {
+    const int value = begin + i * 3;
+    result += (i > 0 ? "," : "") + utils::stringify(value) + "-" +
+      utils::stringify(value + 1);
+  }
+  return result + "]";
+}
+
+
+// Returns "{<prefix>0,<prefix>1,...}" with 'count' items.
+static string set(const string& prefix, int count)
+{
+  string result = "{";
+  for (int i = 0; i < count; i++) {
+    result += (i > 0 ? "," : "") + prefix + utils::stringify(i);
+  }
+  return result + "}";
+}
+
+
+// Benchmarks the algebra on the resources of a slave ('total') and
+// some of them ('part', which is <= 'total').
+static void algebra(const string& name,
+                    const Resources& total,
+                    const Resources& part,
+                    int iterations)
+{
+  Timer timer;
+
+  timer.start();
+  for (int i = 0; i < iterations; i++) {
+    sink += (total + part).size();
+  }
+  timer.stop();
+  report("add", name, iterations, timer.elapsed());
+
+  timer.start();
+  for (int i = 0; i < iterations; i++) {
+    sink += (total - part).size();
+  }
+  timer.stop();
+  report("subtract", name, iterations, timer.elapsed());
+
+  timer.start();
+  for (int i = 0; i < iterations; i++) {
+    Resources resources = total;
+    resources -= part;
+    resources += part;
+    sink += resources.size();
+  }
+  timer.stop();
+  report("subtract_add_in_place", name, iterations, timer.elapsed());
+
+  timer.start();
+  for (int i = 0; i < iterations; i++) {
+    sink += (part <= total) ? 1 : 0;
+  }
+  timer.stop();
+  report("contains", name, iterations, timer.elapsed());
+
+  timer.start();
+  for (int i = 0; i < iterations; i++) {
+    sink += total.allocatable().size();
+  }
+  timer.stop();
+  report("allocatable", name, iterations, timer.elapsed());
+
+  Value::Scalar none;
+  none.set_value(0);
+
+  timer.start();
+  for (int i = 0; i < iterations; i++) {
+    sink += (size_t) total.get("mem", none).value();
+  }
+  timer.stop();
+  report("get", name, iterations, timer.elapsed());
+}
+
+
+// A framework and what it's been allocated.
+struct Allocation
+{
+  string id;
+  Resources resources;
+};
+
+
+// Orders frameworks by their dominant share (of the cluster's total
+// CPUs and memory) and then by their ids, computing the shares from
+// the resources on each comparison like a comparator of frameworks
+// would.
+struct DominantShareComparator
+{
+  DominantShareComparator(const Resources& total)
+  {
+    Value::Scalar none;
+    none.set_value(0);
+    cpus = total.get("cpus", none).value();
+    mem = total.get("mem", none).value();
+  }
+
+  double share(const Resources& resources) const
+  {
+    Value::Scalar none;
+    none.set_value(0);
+    return std::max(resources.get("cpus", none).value() / cpus,
+                    resources.get("mem", none).value() / mem);
+  }
+
+  bool operator () (const Allocation* left, const Allocation* right) const
+  {
+    const double leftShare = share(left->resources);
+    const double rightShare = share(right->resources);
+    if (leftShare == rightShare) {
+      return left->id < right->id;
+    }
+    return leftShare < rightShare;
+  }
+
+  double cpus;
+  double mem;
+};
+
+
+static void sort(int frameworks, int iterations)
+{
+  vector<Allocation> allocations(frameworks);
+  for (int i = 0; i < frameworks; i++) {
+    allocations[i].id = "framework-" + utils::stringify(i);
+    allocations[i].resources = Resources::parse(
+        "cpus:" + utils::stringify(1 + rand() % 64) +
+        ";mem:" + utils::stringify(1024 * (1 + rand() % 256)));
+  }
+
+  const DominantShareComparator comparator(
+      Resources::parse("cpus:10000;mem:2560000"));
+
+  Timer timer;
+  timer.start();
+  for (int i = 0; i < iterations; i++) {
+    vector<Allocation*> ordering;
+    foreach (Allocation& allocation, allocations) {
+      ordering.push_back(&allocation);
+    }
+    std::sort(ordering.begin(), ordering.end(), comparator);
+    sink += ordering.size();
+  }
+  timer.stop();
+  report("dominant_share_sort", utils::stringify(frameworks) + " frameworks",
+         iterations, timer.elapsed());
+}
+
+
+int main(int argc, char** argv)
+{
+  const int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+
+  if (iterations <= 0) {
+    cerr << "Usage: " << argv[0] << " [iterations]" << endl;
+    return 1;
+  }
+
+  // The same inputs every run.
+  srand(42);
+
+  algebra("scalars",
+          Resources::parse("cpus:16;mem:65536;disk:1000000"),
+          Resources::parse("cpus:2;mem:4096;disk:1000"),
+          iterations);
+
+  // The ranges leave holes, so subtracting splits them up.
+  algebra("ranges",
+          Resources::parse("cpus:16;mem:65536;ports:" + ranges(1000, 100)),
+          Resources::parse("cpus:2;mem:4096;ports:" + ranges(1000, 10)),
+          iterations / 10);
+
+  algebra("sets",
+          Resources::parse("cpus:16;mem:65536;disks:" + set("sd", 50)),
+          Resources::parse("cpus:2;mem:4096;disks:" + set("sd", 5)),
+          iterations / 10);
+
+  const string typical =
+    "cpus:16;mem:65536;disk:1000000;ports:[31000-32000]";
+
+  Timer timer;
+  timer.start();
+  for (int i = 0; i < iterations; i++) {
+    sink += Resources::parse(typical).size();
+  }
+  timer.stop();
+  report("parse", "typical slave", iterations, timer.elapsed());
+
+  sort(1000, std::max(1, iterations / 1000));
+
+  return 0;
+}
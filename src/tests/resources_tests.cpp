@@ -366,6 +366,35 @@ TEST(ResourcesTest, RangesSubtraction4)
 }
 
 
+TEST(ResourcesTest, RangesSubtraction5)
+{
+  Resource ports1 = Resources::parse("ports", "[40-50, 1-10, 20-30]");
+  Resource ports2 = Resources::parse("ports", "[50-60, 5-25, 45-45]");
+
+  Resources r;
+  r += ports1;
+  r -= ports2;
+
+  EXPECT_EQ(1, r.size());
+
+  const Value::Ranges& ranges = r.get("ports", Value::Ranges());
+
+  ASSERT_EQ(4, ranges.range_size());
+  EXPECT_EQ(1, ranges.range(0).begin());
+  EXPECT_EQ(4, ranges.range(0).end());
+  EXPECT_EQ(26, ranges.range(1).begin());
+  EXPECT_EQ(30, ranges.range(1).end());
+  EXPECT_EQ(40, ranges.range(2).begin());
+  EXPECT_EQ(44, ranges.range(2).end());
+  EXPECT_EQ(46, ranges.range(3).begin());
+  EXPECT_EQ(49, ranges.range(3).end());
+
+  r += ports2;
+
+  EXPECT_EQ(Resources::parse("ports:[1-30, 40-60]"), r);
+}
+
+
 TEST(ResourcesTest, SetEquals)
 {
   Resource disks = Resources::parse("disks", "{sda1}");
@@ -431,3 +460,27 @@ TEST(ResourcesTest, SetSubtraction)
   EXPECT_EQ(1, set.item_size());
   EXPECT_EQ("sda1", set.item(0));
 }
+
+
+TEST(ResourcesTest, InPlaceArithmetic)
+{
+  Resources total = Resources::parse("cpus:4;mem:1024;ports:[1-100]");
+
+  Resources original = total;
+
+  TaskDescription task;
+  task.mutable_resources()->MergeFrom(
+      Resources::parse("cpus:1;mem:512;ports:[10-20]"));
+
+  total -= task.resources();
+
+  EXPECT_EQ(3, total.size());
+  EXPECT_EQ(3, total.get("cpus", Value::Scalar()).value());
+  EXPECT_EQ(512, total.get("mem", Value::Scalar()).value());
+  EXPECT_EQ(2, total.get("ports", Value::Ranges()).range_size());
+
+  total += task.resources();
+
+  EXPECT_EQ(3, total.size());
+  EXPECT_EQ(original, total);
+}
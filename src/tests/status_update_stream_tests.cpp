@@ -0,0 +1,143 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gmock/gmock.h>
+
+#include <vector>
+
+#include "common/foreach.hpp"
+#include "common/uuid.hpp"
+
+#include "slave/status_update_stream.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+
+using mesos::internal::slave::StatusUpdateStream;
+
+
+static StatusUpdate createStatusUpdate(const std::string& taskId,
+                                       const UUID& uuid)
+{
+  StatusUpdate update;
+  update.mutable_framework_id()->set_value("framework");
+  update.mutable_status()->mutable_task_id()->set_value(taskId);
+  update.mutable_status()->set_state(TASK_RUNNING);
+  update.set_timestamp(0);
+  update.set_uuid(uuid.toBytes());
+  return update;
+}
+
+
+TEST(StatusUpdateStreamTest, AcknowledgeOutOfOrder)
+{
+  StatusUpdateStream stream;
+
+  UUID uuid1 = UUID::random();
+  UUID uuid2 = UUID::random();
+  UUID uuid3 = UUID::random();
+
+  stream.append(createStatusUpdate("1", uuid1), 0);
+  stream.append(createStatusUpdate("2", uuid2), 1);
+  stream.append(createStatusUpdate("3", uuid3), 2);
+  EXPECT_EQ(3, stream.size());
+
+  ASSERT_TRUE(stream.get(1) != NULL);
+  EXPECT_EQ("2", stream.get(1)->status().task_id().value());
+  EXPECT_EQ(1, stream.get(1)->sequence());
+
+  // Acknowledging an update in the middle only drops that update.
+  EXPECT_TRUE(stream.acknowledge(uuid2));
+  EXPECT_FALSE(stream.acknowledge(uuid2));
+  EXPECT_TRUE(stream.get(1) == NULL);
+  EXPECT_TRUE(stream.get(0) != NULL);
+  EXPECT_EQ(2, stream.size());
+
+  EXPECT_TRUE(stream.acknowledge(uuid1));
+  EXPECT_TRUE(stream.get(0) == NULL);
+  EXPECT_TRUE(stream.get(2) != NULL);
+  EXPECT_EQ(1, stream.size());
+
+  // Sequence numbers don't need to be consecutive.
+  stream.append(createStatusUpdate("4", UUID::random()), 7);
+  EXPECT_EQ("4", stream.get(7)->status().task_id().value());
+  EXPECT_TRUE(stream.get(5) == NULL);
+
+  EXPECT_TRUE(stream.acknowledge(uuid3));
+  EXPECT_EQ(1, stream.size());
+  EXPECT_FALSE(stream.empty());
+
+  EXPECT_FALSE(stream.acknowledge(UUID::random()));
+}
+
+
+TEST(StatusUpdateStreamTest, AcknowledgeRanges)
+{
+  StatusUpdateStream stream;
+
+  UUID uuid = UUID::random();
+
+  stream.append(createStatusUpdate("1", UUID::random()), 3);
+  stream.append(createStatusUpdate("2", uuid), 4);
+  stream.append(createStatusUpdate("3", UUID::random()), 6);
+  stream.append(createStatusUpdate("4", UUID::random()), 9);
+
+  EXPECT_TRUE(stream.acknowledge(uuid));
+
+  // Only counts the updates that weren't acknowledged yet.
+  EXPECT_EQ(2, stream.acknowledge(0, 6));
+  EXPECT_EQ(0, stream.acknowledge(0, 6));
+  EXPECT_EQ(1, stream.size());
+  EXPECT_TRUE(stream.get(6) == NULL);
+
+  EXPECT_EQ(0, stream.acknowledge(10, 20));
+  EXPECT_EQ(1, stream.acknowledge(7, 9));
+  EXPECT_TRUE(stream.empty());
+}
+
+
+TEST(StatusUpdateStreamTest, Recover)
+{
+  StatusUpdateStream stream;
+
+  UUID uuid = UUID::random();
+
+  stream.append(createStatusUpdate("1", UUID::random()), 2);
+  stream.append(createStatusUpdate("2", uuid), 3);
+  stream.append(createStatusUpdate("3", UUID::random()), 5);
+
+  EXPECT_TRUE(stream.acknowledge(uuid));
+
+  // The updates that haven't been acknowledged, as checkpointed.
+  std::vector<StatusUpdate> updates = stream.updates();
+  ASSERT_EQ(2, updates.size());
+  EXPECT_EQ(2, updates[0].sequence());
+  EXPECT_EQ(5, updates[1].sequence());
+
+  // Appending them (as a restarted slave does) recreates the stream.
+  StatusUpdateStream recovered;
+  foreach (const StatusUpdate& update, updates) {
+    recovered.append(update, update.sequence());
+  }
+
+  EXPECT_EQ(2, recovered.size());
+  EXPECT_EQ("3", recovered.get(5)->status().task_id().value());
+  EXPECT_EQ(1, recovered.acknowledge(0, 2));
+  EXPECT_TRUE(recovered.acknowledge(UUID::fromBytes(updates[1].uuid())));
+  EXPECT_TRUE(recovered.empty());
+}
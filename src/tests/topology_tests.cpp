@@ -0,0 +1,87 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <vector>
+
+#include "slave/topology.hpp"
+
+using namespace mesos::internal::slave;
+
+using std::set;
+using std::vector;
+
+
+TEST(TopologyTest, ParseAndFormat)
+{
+  Try<set<int> > cpus = topology::parse("0-3,8,10-11\n");
+  ASSERT_TRUE(cpus.isSome());
+  EXPECT_EQ(7, cpus.get().size());
+  EXPECT_EQ(1, cpus.get().count(8));
+  EXPECT_EQ(0, cpus.get().count(9));
+  EXPECT_EQ("0-3,8,10-11", topology::format(cpus.get()));
+
+  cpus = topology::parse("");
+  ASSERT_TRUE(cpus.isSome());
+  EXPECT_TRUE(cpus.get().empty());
+  EXPECT_EQ("", topology::format(cpus.get()));
+
+  EXPECT_TRUE(topology::parse("3-1").isError());
+  EXPECT_TRUE(topology::parse("a").isError());
+}
+
+
+TEST(TopologyTest, Place)
+{
+  // Two nodes with four CPUs each (interleaved, like many machines).
+  vector<topology::Node> nodes(2);
+  nodes[0].id = 0;
+  nodes[1].id = 1;
+  for (int cpu = 0; cpu < 8; cpu++) {
+    nodes[cpu % 2].cpus.push_back(cpu);
+  }
+
+  set<int> free;
+  for (int cpu = 0; cpu < 8; cpu++) {
+    free.insert(cpu);
+  }
+
+  // Node 0 has one CPU taken, so two CPUs fit best on it.
+  free.erase(0);
+
+  set<int> cpus = topology::place(nodes, free, set<int>(), 2);
+  EXPECT_EQ("2,4", topology::format(cpus));
+  EXPECT_EQ("0", topology::format(topology::mems(nodes, cpus)));
+
+  free.erase(2);
+  free.erase(4);
+
+  // Growing the container fills up its node before using the other.
+  set<int> grown = topology::place(nodes, free, cpus, 4);
+  EXPECT_EQ("1-2,4,6", topology::format(grown));
+  EXPECT_EQ("0-1", topology::format(topology::mems(nodes, grown)));
+
+  // Shrinking it keeps CPUs on the node it uses the most.
+  set<int> shrunk = topology::place(nodes, free, grown, 3);
+  EXPECT_EQ("2,4,6", topology::format(shrunk));
+
+  // There are only seven CPUs free.
+  EXPECT_EQ(7, topology::place(nodes, free, cpus, 10).size());
+}
@@ -0,0 +1,68 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gmock/gmock.h>
+
+#include <vector>
+
+#include "common/tracer.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+
+using std::vector;
+
+
+TEST(TracerTest, Spans)
+{
+  const uint64_t trace1 = tracer::id();
+  const uint64_t trace2 = tracer::id();
+
+  EXPECT_NE(0, trace1);
+  EXPECT_NE(trace1, trace2);
+
+  TaskID taskId;
+  taskId.set_value("task");
+
+  tracer::record(trace1, taskId, "scheduler/offer", 1.0, 2.0);
+  tracer::record(trace2, taskId, "scheduler/offer", 1.5, 2.5);
+  tracer::record(trace1, taskId, "master/launch", 3.0, 4.0);
+
+  // Tasks without a trace id aren't traced.
+  tracer::record(0, taskId, "master/launch", 3.0, 4.0);
+
+  StatusUpdate update;
+  update.mutable_status()->mutable_task_id()->MergeFrom(taskId);
+  update.mutable_status()->set_state(TASK_RUNNING);
+  update.set_trace_id(trace1);
+
+  tracer::record("slave", update);
+
+  vector<tracer::Span> spans = tracer::spans(trace1);
+
+  ASSERT_EQ(3, spans.size());
+  EXPECT_EQ("scheduler/offer", spans[0].name);
+  EXPECT_EQ("task", spans[0].task);
+  EXPECT_EQ(1.0, spans[0].start);
+  EXPECT_EQ(2.0, spans[0].end);
+  EXPECT_EQ("master/launch", spans[1].name);
+  EXPECT_EQ("slave/TASK_RUNNING", spans[2].name);
+  EXPECT_EQ(spans[2].start, spans[2].end);
+
+  EXPECT_EQ(1, tracer::spans(trace2).size());
+}
@@ -128,6 +128,24 @@ TEST(UrlProcessorTest, Mesos)
   EXPECT_EQ("master@jake:1", results.second);
 }
 
+
+TEST(UrlProcessorTest, Proxy)
+{
+  std::pair<UrlProcessor::URLType, std::string> results =
+      UrlProcessor::process("proxy://detector@jake:1");
+  EXPECT_EQ(UrlProcessor::PROXY, results.first);
+  EXPECT_EQ("detector@jake:1", results.second);
+}
+
+
+TEST(UrlProcessorTest, Log)
+{
+  std::pair<UrlProcessor::URLType, std::string> results =
+      UrlProcessor::process("log://jake:1,bob:2/tmp/election");
+  EXPECT_EQ(UrlProcessor::LOG, results.first);
+  EXPECT_EQ("jake:1,bob:2/tmp/election", results.second);
+}
+
 TEST(UrlProcessorTest, Unknown)
 {
   std::pair<UrlProcessor::URLType, std::string> results =
@@ -0,0 +1,96 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+
+#include "common/resources.hpp"
+
+#include "slave/usage.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+using namespace mesos::internal::slave;
+
+
+TEST(UsageTest, History)
+{
+  UsageHistory history(3);
+
+  EXPECT_EQ(0u, history.size());
+  EXPECT_EQ(0.0, history.cpus());
+  EXPECT_EQ(0.0, history.mem());
+
+  history.add(UsageSample(10.0, 1.0, 100.0));
+
+  // A single sample doesn't say anything about CPU usage yet.
+  EXPECT_EQ(1u, history.size());
+  EXPECT_EQ(0.0, history.cpus());
+  EXPECT_EQ(100.0, history.mem());
+
+  history.add(UsageSample(11.0, 1.5, 200.0));
+  history.add(UsageSample(12.0, 2.0, 300.0));
+
+  EXPECT_EQ(3u, history.size());
+  EXPECT_DOUBLE_EQ(0.5, history.cpus());
+  EXPECT_EQ(300.0, history.mem());
+
+  // The oldest sample gets replaced once the history is full.
+  history.add(UsageSample(13.0, 4.0, 50.0));
+
+  EXPECT_EQ(3u, history.size());
+  EXPECT_DOUBLE_EQ(1.25, history.cpus());
+  EXPECT_EQ(50.0, history.mem());
+}
+
+
+TEST(UsageTest, Sample)
+{
+  pid_t session;
+  Try<UsageSample> sample = mesos::internal::slave::sample(
+      getpid(), 1.0, &session);
+
+  ASSERT_TRUE(sample.isSome()) << sample.error();
+  EXPECT_EQ(getsid(0), session);
+  EXPECT_EQ(1.0, sample.get().time);
+  EXPECT_LE(0.0, sample.get().cpuTime);
+  EXPECT_LT(0.0, sample.get().mem);
+
+  // Our own session includes (at least) us.
+  const std::map<pid_t, UsageSample>& samples = sessions(1.0);
+  ASSERT_EQ(1u, samples.count(session));
+  EXPECT_LE(sample.get().mem, samples.find(session)->second.mem);
+}
+
+
+TEST(UsageTest, Slack)
+{
+  Resources allocated = Resources::parse("cpus:4;mem:1024;disk:100");
+
+  Resources idle = slack(allocated, 1.5, 256.0);
+
+  // Only CPUs and memory get lent out.
+  EXPECT_EQ(Resources::parse("cpus:2.5;mem:768"), idle);
+
+  // Using more than allocated doesn't make for negative slack.
+  EXPECT_EQ(Resources::parse("mem:24"), slack(allocated, 5.0, 1000.0));
+  EXPECT_EQ(0u, slack(allocated, 4.0, 2048.0).size());
+}
@@ -146,9 +146,10 @@ public:
   MOCK_METHOD1(slaveRemoved, void(master::Slave*));
   MOCK_METHOD2(resourcesRequested, void(const FrameworkID&,
                                         const std::vector<ResourceRequest>&));
-  MOCK_METHOD3(resourcesUnused, void(const FrameworkID&,
+  MOCK_METHOD4(resourcesUnused, void(const FrameworkID&,
                                      const SlaveID&,
-                                     const Resources&));
+                                     const Resources&,
+                                     const Option<Filters>&));
   MOCK_METHOD3(resourcesRecovered, void(const FrameworkID&,
                                         const SlaveID&,
                                         const Resources&));
@@ -18,6 +18,8 @@
 
 #include <gmock/gmock.h>
 
+#include <set>
+
 #include "common/uuid.hpp"
 
 using namespace mesos;
@@ -52,3 +54,15 @@ TEST(UUIDTest, test)
   EXPECT_EQ(string2, string3);
   EXPECT_EQ(string1, string3);
 }
+
+
+TEST(UUIDTest, random)
+{
+  std::set<string> uuids;
+
+  for (int i = 0; i < 10000; i++) {
+    uuids.insert(UUID::random().toBytes());
+  }
+
+  EXPECT_EQ(10000, uuids.size());
+}
@@ -16,7 +16,10 @@
  * limitations under the License.
  */
 
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -71,6 +74,39 @@ TEST_F(ZooKeeperTest, Auth)
 }
 
 
+TEST_F(ZooKeeperTest, Batch)
+{
+  mesos::internal::test::BaseZooKeeperTest::TestWatcher watcher;
+
+  ZooKeeper zk(zks->connectString(), NO_TIMEOUT, &watcher);
+  watcher.awaitSessionEvent(ZOO_CONNECTED_STATE);
+
+  std::vector<ZooKeeper::Operation> operations;
+  operations.push_back(ZooKeeper::Operation::create(
+      "/batch", "", ZOO_OPEN_ACL_UNSAFE, 0));
+  operations.push_back(ZooKeeper::Operation::create(
+      "/batch/node", "42", ZOO_OPEN_ACL_UNSAFE, 0));
+  operations.push_back(ZooKeeper::Operation::set("/batch/node", "37", -1));
+  operations.push_back(ZooKeeper::Operation::get("/batch/node"));
+
+  ASSERT_EQ(ZOK, zk.batch(&operations));
+  EXPECT_EQ("/batch/node", operations[1].result);
+  EXPECT_EQ("37", operations[3].result);
+  EXPECT_EQ(1, operations[3].stat.version);
+
+  // Operations are performed in order, but not as a transaction.
+  operations.clear();
+  operations.push_back(ZooKeeper::Operation::create(
+      "/batch", "", ZOO_OPEN_ACL_UNSAFE, 0));
+  operations.push_back(ZooKeeper::Operation::remove("/batch/node", -1));
+  operations.push_back(ZooKeeper::Operation::get("/batch/node"));
+
+  EXPECT_EQ(ZNODEEXISTS, zk.batch(&operations));
+  EXPECT_EQ(ZNODEEXISTS, operations[0].code);
+  EXPECT_EQ(ZOK, operations[1].code);
+  EXPECT_EQ(ZNONODE, operations[2].code);
+}
+
 TEST_F(ZooKeeperTest, Group)
 {
   zookeeper::Group group(zks->connectString(), NO_TIMEOUT, "/test/");
@@ -120,6 +156,67 @@ TEST_F(ZooKeeperTest, Group)
 }
 
 
+TEST_F(ZooKeeperTest, GroupChangesAndInfos)
+{
+  zookeeper::Group group(zks->connectString(), NO_TIMEOUT, "/test/");
+
+  process::Future<zookeeper::Group::Membership> membership1 =
+    group.join("one");
+
+  membership1.await();
+
+  ASSERT_TRUE(membership1.isReady());
+
+  process::Future<zookeeper::Group::Changes> changes = group.changes();
+
+  changes.await();
+
+  ASSERT_TRUE(changes.isReady());
+  EXPECT_EQ(1, changes.get().memberships.size());
+  EXPECT_EQ(1, changes.get().added.count(membership1.get()));
+  EXPECT_EQ(0, changes.get().removed.size());
+
+  std::set<zookeeper::Group::Membership> expected = changes.get().memberships;
+
+  process::Future<zookeeper::Group::Membership> membership2 =
+    group.join("two");
+
+  membership2.await();
+
+  ASSERT_TRUE(membership2.isReady());
+
+  process::Future<bool> cancellation = group.cancel(membership1.get());
+
+  cancellation.await();
+
+  ASSERT_TRUE(cancellation.isReady());
+
+  changes = group.changes(expected);
+
+  changes.await();
+
+  ASSERT_TRUE(changes.isReady());
+  EXPECT_EQ(1, changes.get().memberships.size());
+  EXPECT_EQ(1, changes.get().added.count(membership2.get()));
+  EXPECT_EQ(1, changes.get().removed.count(membership1.get()));
+
+  // The canceled membership is left out of the infos.
+  std::set<zookeeper::Group::Membership> memberships;
+  memberships.insert(membership1.get());
+  memberships.insert(membership2.get());
+
+  process::Future<std::map<zookeeper::Group::Membership, std::string> > infos =
+    group.infos(memberships);
+
+  infos.await();
+
+  ASSERT_TRUE(infos.isReady());
+  EXPECT_EQ(1, infos.get().size());
+  EXPECT_EQ(1, infos.get().count(membership2.get()));
+  EXPECT_EQ("two", infos.get().find(membership2.get())->second);
+}
+
+
 TEST_F(ZooKeeperTest, GroupJoinWithDisconnect)
 {
   zookeeper::Group group(zks->connectString(), NO_TIMEOUT, "/test/");
@@ -1 +0,0 @@
-begin {% block content %}{% endblock %} end
\ No newline at end of file
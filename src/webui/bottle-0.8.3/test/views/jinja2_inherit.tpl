@@ -1,2 +0,0 @@
-{% extends "jinja2_base" %}
-{% block content %}abc{% endblock %}
\ No newline at end of file
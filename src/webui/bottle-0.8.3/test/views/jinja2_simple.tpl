@@ -1 +0,0 @@
-start {{var}} end
\ No newline at end of file
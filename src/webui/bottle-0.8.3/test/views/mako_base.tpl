@@ -1 +0,0 @@
-o${self.body()}o
@@ -1,2 +0,0 @@
-<%inherit file="mako_base.tpl"/>
-c${var}c
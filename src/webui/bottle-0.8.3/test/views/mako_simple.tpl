@@ -1 +0,0 @@
-start ${var} end
@@ -1,3 +0,0 @@
-before
-%include stpl_simple var=var
-after
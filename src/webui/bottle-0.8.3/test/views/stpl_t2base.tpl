@@ -1,4 +0,0 @@
-%test('base')
-%include
-%include stpl_t2inc test=test
-%_['test2']('base')
@@ -1,4 +0,0 @@
-%test('include')
-%def test2(var):
--{{var}}-
-%end
@@ -1 +0,0 @@
-start {{"ñç"}} {{var}} end
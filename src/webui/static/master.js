@@ -0,0 +1,229 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Renders the master's state.json, either as an overview of the
+// cluster or (with '#framework=<id>') as the tasks of one framework.
+
+function text(field) {
+  return function(item) { return escape_html(item[field]); };
+}
+
+
+function framework_link(framework) {
+  return "<a href=\"#framework=" + encodeURIComponent(framework.id) + "\">" +
+    escape_html(framework.name) + "</a>";
+}
+
+
+// Links to the webui of a slave, which is served (under the slave's
+// id) on the slave's own port.
+function slave_link(slave) {
+  var pid = slave.pid;
+  var id = pid.substring(0, pid.indexOf("@"));
+  var url = "http://" + slave.webui_hostname + ":" + slave.webui_port +
+    "/" + id + "/webui";
+  return "<a href=\"" + escape_html(url) + "\">" +
+    escape_html(slave.hostname) + "</a>";
+}
+
+
+function render_overview(state) {
+  var total = { cpus: 0, mem: 0 };
+  var offered = { cpus: 0, mem: 0 };
+  var used = { cpus: 0, mem: 0 };
+  var offers = [];
+
+  for (var i = 0; i < state.slaves.length; i++) {
+    total.cpus += state.slaves[i].resources.cpus;
+    total.mem += state.slaves[i].resources.mem;
+  }
+
+  for (var j = 0; j < state.frameworks.length; j++) {
+    var framework = state.frameworks[j];
+    used.cpus += framework.resources.cpus;
+    used.mem += framework.resources.mem;
+    for (var k = 0; k < framework.offers.length; k++) {
+      offers.push(framework.offers[k]);
+      offered.cpus += framework.offers[k].resources.cpus;
+      offered.mem += framework.offers[k].resources.mem;
+    }
+  }
+
+  // A framework's resources include the ones offered to it.
+  used.cpus -= offered.cpus;
+  used.mem -= offered.mem;
+
+  var idle = {
+    cpus: total.cpus - (used.cpus + offered.cpus),
+    mem: total.mem - (used.mem + offered.mem)
+  };
+
+  var html = "<h1>Mesos Master</h1>";
+
+  html += "<p>" +
+    "Server: " + escape_html(server(state.pid)) + "<br />" +
+    "PID: " + escape_html(state.pid) + "<br />" +
+    "Built: " + escape_html(state.build_date) + " by " +
+    escape_html(state.build_user) + "<br />" +
+    "Started: " + format_time(state.start_time) + "<br />" +
+    "ID: " + escape_html(state.id) + "<br />" +
+    "</p>";
+
+  html += "<p>Log: " +
+    "<a href=\"log?level=INFO&amp;lines=100\">[INFO]</a> " +
+    "<a href=\"log?level=WARNING&amp;lines=100\">[WARNING]</a> " +
+    "<a href=\"log?level=ERROR&amp;lines=100\">[ERROR]</a>" +
+    "</p>";
+
+  html += "<h2>Resources</h2>";
+  html += table([["Total", total], ["Used", used],
+                 ["Offered", offered], ["Idle", idle]], [
+    ["", function(row) { return row[0]; }],
+    ["CPUs", function(row) { return row[1].cpus; }],
+    ["MEM", function(row) { return format_mem(row[1].mem); }]
+  ]);
+
+  html += "<h2>Active Frameworks</h2>";
+  if (state.frameworks.length > 0) {
+    html += table(state.frameworks, [
+      ["ID", text("id")],
+      ["User", text("user")],
+      ["Name", framework_link],
+      ["Running Tasks", function(f) { return f.tasks.length; }],
+      ["CPUs", function(f) { return f.resources.cpus; }],
+      ["MEM", function(f) { return format_mem(f.resources.mem); }],
+      ["Max Share", function(f) {
+        var cpus = total.cpus > 0 ? f.resources.cpus / total.cpus : 0;
+        var mem = total.mem > 0 ? f.resources.mem / total.mem : 0;
+        return Math.max(cpus, mem).toFixed(2);
+      }],
+      ["Connected", function(f) { return format_time(f.registered_time); }]
+    ]);
+  } else {
+    html += "<p>No frameworks are connected.</p>";
+  }
+
+  html += "<h2>Slaves</h2>";
+  if (state.slaves.length > 0) {
+    html += table(state.slaves, [
+      ["ID", text("id")],
+      ["Hostname", slave_link],
+      ["CPUs", function(s) { return s.resources.cpus; }],
+      ["MEM", function(s) { return format_mem(s.resources.mem); }],
+      ["Connected", function(s) { return format_time(s.registered_time); }]
+    ]);
+  } else {
+    html += "<p>No slaves are connected.</p>";
+  }
+
+  html += "<h2>Resource Offers</h2>";
+  if (offers.length > 0) {
+    html += table(offers, [
+      ["Offer ID", text("id")],
+      ["Framework ID", text("framework_id")],
+      ["Slave ID", text("slave_id")],
+      ["CPUs", function(o) { return o.resources.cpus; }],
+      ["MEM", function(o) { return format_mem(o.resources.mem); }]
+    ]);
+  } else {
+    html += "<p>No offers are active.</p>";
+  }
+
+  html += "<h2>Framework History</h2>";
+  if (state.completed_frameworks.length > 0) {
+    html += table(state.completed_frameworks, [
+      ["ID", text("id")],
+      ["User", text("user")],
+      ["Name", framework_link],
+      ["Connected", function(f) { return format_time(f.registered_time); }],
+      ["Disconnected", function(f) {
+        return format_time(f.unregistered_time);
+      }]
+    ]);
+  } else {
+    html += "<p>No frameworks have completed.</p>";
+  }
+
+  return html;
+}
+
+
+function render_framework(state, id) {
+  var frameworks = state.frameworks.concat(state.completed_frameworks);
+  var framework = null;
+  for (var i = 0; i < frameworks.length; i++) {
+    if (frameworks[i].id == id) {
+      framework = frameworks[i];
+    }
+  }
+
+  var html = "<p><a href=\"#\">&larr; Mesos Master</a></p>";
+
+  if (framework == null) {
+    return html + "<p>No framework with ID " + escape_html(id) + ".</p>";
+  }
+
+  html += "<h1>Framework " + escape_html(framework.id) + "</h1>";
+  html += "<p>" +
+    "Name: " + escape_html(framework.name) + "<br />" +
+    "User: " + escape_html(framework.user) + "<br />" +
+    "Executor: " + escape_html(framework.executor_uri) + "<br />" +
+    "Connected: " + format_time(framework.registered_time) + "<br />" +
+    "</p>";
+
+  var columns = [
+    ["ID", text("id")],
+    ["Name", text("name")],
+    ["State", text("state")],
+    ["Slave ID", text("slave_id")]
+  ];
+
+  html += "<h2>Running Tasks</h2>";
+  if (framework.tasks.length > 0) {
+    html += table(framework.tasks, columns);
+  } else {
+    html += "<p>No tasks are running.</p>";
+  }
+
+  html += "<h2>Completed Tasks</h2>";
+  if (framework.completed_tasks.length > 0) {
+    html += table(framework.completed_tasks, columns);
+  } else {
+    html += "<p>No tasks have completed.</p>";
+  }
+
+  return html;
+}
+
+
+function render() {
+  get("state.json", function(state) {
+    var content = document.getElementById("content");
+    var hash = window.location.hash;
+    if (hash.indexOf("#framework=") == 0) {
+      var id = decodeURIComponent(hash.substring("#framework=".length));
+      content.innerHTML = render_framework(state, id);
+    } else {
+      content.innerHTML = render_overview(state);
+    }
+  });
+}
+
+
+window.onload = render;
+window.onhashchange = render;
@@ -0,0 +1,92 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Renders the slave's state.json: its frameworks, their executors
+// (with links to the tail of each executor's output) and tasks.
+
+function executor_log(framework, executor, file) {
+  var url = "executor_log" +
+    "?framework_id=" + encodeURIComponent(framework.id) +
+    "&executor_id=" + encodeURIComponent(executor.id) +
+    "&file=" + file + "&lines=100";
+  return "<a href=\"" + escape_html(url) + "\">[" + file + "]</a>";
+}
+
+
+function render(state) {
+  var html = "<h1>Mesos Slave</h1>";
+
+  html += "<p>" +
+    "Server: " + escape_html(server(state.pid)) + "<br />" +
+    "PID: " + escape_html(state.pid) + "<br />" +
+    "Built: " + escape_html(state.build_date) + " by " +
+    escape_html(state.build_user) + "<br />" +
+    "Started: " + format_time(state.start_time) + "<br />" +
+    "ID: " + escape_html(state.id) + "<br />" +
+    "CPUs: " + state.resources.cpus + "<br />" +
+    "MEM: " + format_mem(state.resources.mem) + "<br />" +
+    "</p>";
+
+  html += "<p>Log: " +
+    "<a href=\"log?level=INFO&amp;lines=100\">[INFO]</a> " +
+    "<a href=\"log?level=WARNING&amp;lines=100\">[WARNING]</a> " +
+    "<a href=\"log?level=ERROR&amp;lines=100\">[ERROR]</a>" +
+    "</p>";
+
+  html += "<h2>Frameworks</h2>";
+
+  if (state.frameworks.length == 0) {
+    html += "<p>No frameworks are running.</p>";
+  }
+
+  for (var i = 0; i < state.frameworks.length; i++) {
+    var framework = state.frameworks[i];
+
+    html += "<h3>" + escape_html(framework.name) + " (" +
+      escape_html(framework.id) + ", " + escape_html(framework.user) +
+      ")</h3>";
+
+    for (var j = 0; j < framework.executors.length; j++) {
+      var executor = framework.executors[j];
+
+      html += "<p>Executor " + escape_html(executor.id) + ": " +
+        executor_log(framework, executor, "stdout") + " " +
+        executor_log(framework, executor, "stderr") + "<br />" +
+        "Directory: " + escape_html(executor.directory) + "</p>";
+
+      if (executor.tasks.length > 0) {
+        html += table(executor.tasks, [
+          ["ID", function(t) { return escape_html(t.id); }],
+          ["Name", function(t) { return escape_html(t.name); }],
+          ["State", function(t) { return escape_html(t.state); }],
+          ["CPUs", function(t) { return t.resources.cpus; }],
+          ["MEM", function(t) { return format_mem(t.resources.mem); }]
+        ]);
+      } else {
+        html += "<p>No tasks are running.</p>";
+      }
+    }
+  }
+
+  document.getElementById("content").innerHTML = html;
+}
+
+
+window.onload = function() {
+  get("state.json", render);
+};
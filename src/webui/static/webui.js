@@ -0,0 +1,92 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Helpers shared by the master's and the slave's page (which get
+// served next to the endpoints they render, hence all the URLs here
+// are relative, e.g., "state.json" rather than "/master/state.json").
+
+// Fetches the JSON at a (relative) URL and calls 'callback' with it.
+function get(url, callback) {
+  var request = new XMLHttpRequest();
+  request.onreadystatechange = function() {
+    if (request.readyState != 4) {
+      return;
+    }
+    if (request.status == 200) {
+      callback(JSON.parse(request.responseText));
+    } else {
+      document.getElementById("content").innerHTML =
+        "<p>Failed to get " + escape_html(url) +
+        " (" + request.status + ").</p>";
+    }
+  };
+  request.open("GET", url, true);
+  request.send(null);
+}
+
+
+function escape_html(value) {
+  return String(value)
+    .replace(/&/g, "&amp;")
+    .replace(/</g, "&lt;")
+    .replace(/>/g, "&gt;")
+    .replace(/"/g, "&quot;");
+}
+
+
+// Formats an amount of memory (in MB).
+function format_mem(mem) {
+  if (mem < 1024) {
+    return mem.toFixed(0) + " MB";
+  }
+  return (mem / 1024).toFixed(1) + " GB";
+}
+
+
+// Formats a time (in seconds since the epoch).
+function format_time(time) {
+  if (!time) {
+    return "";
+  }
+  return new Date(time * 1000).toLocaleString();
+}
+
+
+// Returns the "ip:port" of a PID (e.g., "master@ip:port").
+function server(pid) {
+  return pid.substring(pid.indexOf("@") + 1);
+}
+
+
+// Returns an HTML table with a header row and a row per item, where
+// 'columns' maps each header to a function rendering an item's cell.
+function table(items, columns) {
+  var html = "<table class=\"lists\"><tr>";
+  for (var i = 0; i < columns.length; i++) {
+    html += "<th class=\"lists\">" + columns[i][0] + "</th>";
+  }
+  html += "</tr>";
+  for (var j = 0; j < items.length; j++) {
+    html += "<tr>";
+    for (var k = 0; k < columns.length; k++) {
+      html += "<td class=\"lists\">" + columns[k][1](items[j]) + "</td>";
+    }
+    html += "</tr>";
+  }
+  return html + "</table>";
+}
@@ -1,9 +1,12 @@
 #include <algorithm>
+#include <iterator>
 #include <map>
 #include <queue>
 #include <utility>
 #include <vector>
 
+#include <tr1/functional>
+
 #include <process/process.hpp>
 #include <process/timer.hpp>
 
@@ -50,8 +53,9 @@ public:
   Future<Group::Membership> join(const string& info);
   Future<bool> cancel(const Group::Membership& membership);
   Future<string> info(const Group::Membership& membership);
-  Future<set<Group::Membership> > watch(
-      const set<Group::Membership>& expected);
+  Future<map<Group::Membership, string> > infos(
+      const set<Group::Membership>& memberships);
+  Future<Group::Changes> changes(const set<Group::Membership>& expected);
   Future<Option<int64_t> > session();
 
   // ZooKeeper events.
@@ -62,10 +66,16 @@ public:
   void created(const string& path);
   void deleted(const string& path);
 
+  // Caches the memberships again after they were updated (see
+  // GroupProcess::updated).
+  void refresh();
+
 private:
   Result<Group::Membership> doJoin(const string& info);
   Result<bool> doCancel(const Group::Membership& membership);
   Result<string> doInfo(const Group::Membership& membership);
+  Result<map<Group::Membership, string> > doInfos(
+      const set<Group::Membership>& memberships);
 
   // Attempts to cache the current set of memberships.
   bool cache();
@@ -128,29 +138,69 @@ private:
     Promise<string> promise;
   };
 
+  struct Infos
+  {
+    Infos(const set<Group::Membership>& _memberships)
+      : memberships(_memberships) {}
+    set<Group::Membership> memberships;
+    Promise<map<Group::Membership, string> > promise;
+  };
+
   struct Watch
   {
     Watch(const set<Group::Membership>& _expected)
       : expected(_expected) {}
     set<Group::Membership> expected;
-    Promise<set<Group::Membership> > promise;
+    Promise<Group::Changes> promise;
   };
 
   struct {
     queue<Join*> joins;
     queue<Cancel*> cancels;
     queue<Info*> infos;
+    queue<Infos*> batches;
     queue<Watch*> watches;
   } pending;
 
   bool retrying;
 
+  // Whether the memberships are to be cached again (see 'updated'),
+  // so that all the updates and watches in the meantime share one
+  // fetch of the memberships.
+  bool refreshing;
+
   map<Group::Membership, string> owned;
 
   Option<set<Group::Membership> > memberships; // The cache.
+
+  // The information of (some of) the memberships, which never changes
+  // once a membership exists. Pruned as memberships go away.
+  map<Group::Membership, string> data;
 };
 
 
+// Returns how the current memberships differ from the expected.
+static Group::Changes diff(
+    const set<Group::Membership>& current,
+    const set<Group::Membership>& expected)
+{
+  Group::Changes changes;
+  changes.memberships = current;
+
+  std::set_difference(
+      current.begin(), current.end(),
+      expected.begin(), expected.end(),
+      std::inserter(changes.added, changes.added.end()));
+
+  std::set_difference(
+      expected.begin(), expected.end(),
+      current.begin(), current.end(),
+      std::inserter(changes.removed, changes.removed.end()));
+
+  return changes;
+}
+
+
 GroupProcess::GroupProcess(
     const string& _servers,
     const seconds& _timeout,
@@ -164,7 +214,8 @@ GroupProcess::GroupProcess(
         ? EVERYONE_READ_CREATOR_ALL
         : ZOO_OPEN_ACL_UNSAFE),
     state(DISCONNECTED),
-    retrying(false)
+    retrying(false),
+    refreshing(false)
 {}
 
 
@@ -273,6 +324,8 @@ Future<string> GroupProcess::info(const Group::Membership& membership)
     Promise<string> promise;
     promise.fail(error.get());
     return promise.future();
+  } else if (data.count(membership) > 0) {
+    return data[membership];
   } else if (state != CONNECTED) {
     Info* info = new Info(membership);
     pending.infos.push(info);
@@ -299,14 +352,49 @@ Future<string> GroupProcess::info(const Group::Membership& membership)
 }
 
 
-Future<set<Group::Membership> > GroupProcess::watch(
-    const set<Group::Membership>& expected)
+Future<map<Group::Membership, string> > GroupProcess::infos(
+    const set<Group::Membership>& memberships)
 {
   if (error.isSome()) {
-    Promise<set<Group::Membership> > promise;
+    Promise<map<Group::Membership, string> > promise;
     promise.fail(error.get());
     return promise.future();
   } else if (state != CONNECTED) {
+    Infos* infos = new Infos(memberships);
+    pending.batches.push(infos);
+    return infos->promise.future();
+  }
+
+  Result<map<Group::Membership, string> > result = doInfos(memberships);
+
+  if (result.isNone()) { // Try again later.
+    if (!retrying) {
+      delay(RETRY_SECONDS, self(), &GroupProcess::retry, RETRY_SECONDS);
+      retrying = true;
+    }
+    Infos* infos = new Infos(memberships);
+    pending.batches.push(infos);
+    return infos->promise.future();
+  } else if (result.isError()) {
+    Promise<map<Group::Membership, string> > promise;
+    promise.fail(result.error());
+    return promise.future();
+  }
+
+  return result.get();
+}
+
+
+Future<Group::Changes> GroupProcess::changes(
+    const set<Group::Membership>& expected)
+{
+  if (error.isSome()) {
+    Promise<Group::Changes> promise;
+    promise.fail(error.get());
+    return promise.future();
+  } else if (state != CONNECTED || refreshing) {
+    // N.B. If the memberships are about to be cached again we wait
+    // for that rather than fetch them ourselves.
     Watch* watch = new Watch(expected);
     pending.watches.push(watch);
     return watch->promise.future();
@@ -339,7 +427,7 @@ Future<set<Group::Membership> > GroupProcess::watch(
     return watch->promise.future();
   }
 
-  return memberships.get();
+  return diff(memberships.get(), expected);
 }
 
 
@@ -379,7 +467,10 @@ void GroupProcess::connected(bool reconnect)
 
     CHECK(znode.size() == 0 || znode.at(znode.size() - 1) != '/');
 
-    // Create directory path znodes as necessary.
+    // Create directory path znodes as necessary (even if they already
+    // exist), all in one batch.
+    vector<ZooKeeper::Operation> operations;
+
     size_t index = znode.find("/", 0);
 
     while (index < string::npos) {
@@ -389,8 +480,13 @@ void GroupProcess::connected(bool reconnect)
 
       LOG(INFO) << "Trying to create '" << prefix << "' in ZooKeeper";
 
-      // Create the node (even if it already exists).
-      int code = zk->create(prefix, "", acl, 0, NULL);
+      operations.push_back(ZooKeeper::Operation::create(prefix, "", acl, 0));
+    }
+
+    zk->batch(&operations);
+
+    foreach (const ZooKeeper::Operation& operation, operations) {
+      int code = operation.code;
 
       if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
         CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
@@ -398,7 +494,7 @@ void GroupProcess::connected(bool reconnect)
       } else if (code != ZOK && code != ZNODEEXISTS) {
         Try<string> message = strings::format(
             "Failed to create '%s' in ZooKeeper: %s",
-            prefix.c_str(), zk->message(code));
+            operation.path.c_str(), zk->message(code));
         error = message.isSome()
           ? message.get()
           : "Failed to create node in ZooKeeper";
@@ -435,6 +531,29 @@ void GroupProcess::updated(const string& path)
 {
   CHECK(znode == path);
 
+  // Invalidate the cache right away but only fetch the memberships
+  // once we've handled everything that's already queued up, so that
+  // a burst of updates (and watches) needs only one fetch.
+  memberships = Option<set<Group::Membership> >::none();
+
+  if (!refreshing) {
+    refreshing = true;
+    dispatch(self(), &GroupProcess::refresh);
+  }
+}
+
+
+void GroupProcess::refresh()
+{
+  refreshing = false;
+
+  if (error.isSome() || state != CONNECTED) {
+    return; // We'll cache the memberships at reconnect (if no error).
+  } else if (memberships.isSome()) {
+    update(); // Cached in the meantime (e.g., by a watch).
+    return;
+  }
+
   cache(); // Update cache (will invalidate first).
 
   if (memberships.isNone()) { // Something changed so we must try again later.
@@ -532,6 +651,7 @@ Result<bool> GroupProcess::doCancel(const Group::Membership& membership)
   memberships = Option<set<Group::Membership> >::none();
 
   owned.erase(membership);
+  data.erase(membership);
 
   return true;
 }
@@ -567,10 +687,42 @@ Result<string> GroupProcess::doInfo(const Group::Membership& membership)
         : "Failed to get data for ephemeral node in ZooKeeper");
   }
 
+  data[membership] = result;
+
   return result;
 }
 
 
+Result<map<Group::Membership, string> > GroupProcess::doInfos(
+    const set<Group::Membership>& memberships)
+{
+  map<Group::Membership, string> infos;
+
+  foreach (const Group::Membership& membership, memberships) {
+    if (data.count(membership) > 0) {
+      infos.insert(make_pair(membership, data[membership]));
+      continue;
+    }
+
+    // N.B. The infos fetched so far stay cached if we have to try
+    // again later.
+    Result<string> result = doInfo(membership);
+
+    if (result.isNone()) {
+      return Result<map<Group::Membership, string> >::none();
+    } else if (result.isError()) {
+      // Most likely the membership has since been canceled.
+      LOG(WARNING) << result.error();
+      continue;
+    }
+
+    infos.insert(make_pair(membership, result.get()));
+  }
+
+  return infos;
+}
+
+
 bool GroupProcess::cache()
 {
   // Invalidate first.
@@ -613,6 +765,16 @@ bool GroupProcess::cache()
 
   memberships = current;
 
+  // Forget the information of the memberships that are gone.
+  map<Group::Membership, string>::iterator iterator = data.begin();
+  while (iterator != data.end()) {
+    if (current.count(iterator->first) == 0) {
+      data.erase(iterator++);
+    } else {
+      ++iterator;
+    }
+  }
+
   return true;
 }
 
@@ -622,14 +784,14 @@ void GroupProcess::update()
   CHECK(memberships.isSome());
   size_t size = pending.watches.size();
   for (int i = 0; i < size; i++) {
-    if (memberships.get() != pending.watches.front()->expected) {
-      pending.watches.front()->promise.set(memberships.get());
-    } else {
-      pending.watches.push(pending.watches.front());
-    }
     Watch* watch = pending.watches.front();
     pending.watches.pop();
-    delete watch;
+    if (memberships.get() != watch->expected) {
+      watch->promise.set(diff(memberships.get(), watch->expected));
+      delete watch;
+    } else {
+      pending.watches.push(watch); // Keep waiting for updates.
+    }
   }
 }
 
@@ -686,6 +848,22 @@ bool GroupProcess::sync()
     delete info;
   }
 
+  // Do batches of infos.
+  while (!pending.batches.empty()) {
+    Result<map<Group::Membership, string> > result =
+      doInfos(pending.batches.front()->memberships);
+    if (result.isNone()) {
+      return false; // Try again later.
+    } else if (result.isError()) {
+      pending.batches.front()->promise.fail(result.error());
+    } else {
+      pending.batches.front()->promise.set(result.get());
+    }
+    Infos* infos = pending.batches.front();
+    pending.batches.pop();
+    delete infos;
+  }
+
   // Get cache of memberships if we don't have one.
   if (memberships.isNone()) {
     if (!cache()) {
@@ -734,6 +912,7 @@ void GroupProcess::abort()
   fail(&pending.joins, error.get());
   fail(&pending.cancels, error.get());
   fail(&pending.infos, error.get());
+  fail(&pending.batches, error.get());
   fail(&pending.watches, error.get());
 }
 
@@ -775,10 +954,32 @@ Future<string> Group::info(const Group::Membership& membership)
 }
 
 
+Future<map<Group::Membership, string> > Group::infos(
+    const set<Group::Membership>& memberships)
+{
+  return dispatch(process, &GroupProcess::infos, memberships);
+}
+
+
+// Returns the current memberships of some changes (see Group::watch).
+static set<Group::Membership> current(const Group::Changes& changes)
+{
+  return changes.memberships;
+}
+
+
 Future<set<Group::Membership> > Group::watch(
     const set<Group::Membership>& expected)
 {
-  return dispatch(process, &GroupProcess::watch, expected);
+  std::tr1::function<set<Group::Membership>(const Group::Changes&)> f =
+    &current;
+  return changes(expected).then(f);
+}
+
+
+Future<Group::Changes> Group::changes(const set<Group::Membership>& expected)
+{
+  return dispatch(process, &GroupProcess::changes, expected);
 }
 
 
@@ -1,7 +1,9 @@
 #ifndef __ZOOKEEPER_GROUP_HPP__
 #define __ZOOKEEPER_GROUP_HPP__
 
+#include <map>
 #include <set>
+#include <string>
 
 #include "process/future.hpp"
 #include "process/option.hpp"
@@ -64,6 +66,15 @@ public:
     uint64_t sequence;
   };
 
+  // The current memberships of a group along with how they differ
+  // from some "expected" memberships (see Group::changes).
+  struct Changes
+  {
+    std::set<Membership> memberships;
+    std::set<Membership> added; // Current but not expected.
+    std::set<Membership> removed; // Expected but no longer current.
+  };
+
   // Constructs this group using the specified ZooKeeper servers (list
   // of host:port) with the given timeout at the specified znode.
   Group(const std::string& servers,
@@ -85,14 +96,28 @@ public:
   process::Future<bool> cancel(const Membership& membership);
 
   // Returns the result of trying to fetch the information associated
-  // with a group membership.
+  // with a group membership. N.B. The information of a membership
+  // never changes, so it only gets fetched from ZooKeeper once.
   process::Future<std::string> info(const Membership& membership);
 
+  // Returns the result of trying to fetch the information associated
+  // with each of the specified memberships (in one go, see info).
+  // Memberships that have since been canceled (or expired) are left
+  // out.
+  process::Future<std::map<Membership, std::string> > infos(
+      const std::set<Membership>& memberships);
+
   // Returns a future that gets set when the group memberships differ
   // from the "expected" memberships specified.
   process::Future<std::set<Membership> > watch(
       const std::set<Membership>& expected = std::set<Membership>());
 
+  // Like watch, but the future also has which memberships were added
+  // and removed relative to the "expected" memberships (so a watcher
+  // of a large group need not compare the memberships itself).
+  process::Future<Changes> changes(
+      const std::set<Membership>& expected = std::set<Membership>());
+
   // Returns the current ZooKeeper session associated with this group,
   // or none if no session currently exists.
   process::Future<Option<int64_t> > session();
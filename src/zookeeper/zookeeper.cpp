@@ -19,14 +19,18 @@
 #include <glog/logging.h>
 
 #include <iostream>
+#include <list>
 #include <map>
 
 #include <boost/tuple/tuple.hpp>
 
 #include <process/dispatch.hpp>
+#include <process/future.hpp>
+#include <process/metrics.hpp>
 #include <process/process.hpp>
 
 #include "common/fatal.hpp"
+#include "common/foreach.hpp"
 
 #include "zookeeper/zookeeper.hpp"
 
@@ -37,11 +41,32 @@ using process::PID;
 using process::Process;
 using process::Promise;
 
+using std::list;
 using std::map;
 using std::string;
 using std::vector;
 
 
+// Session events, by the state the session got into (counted on the
+// ZooKeeper client's thread, see ZooKeeperImpl::event).
+static process::metrics::Counter connected(
+    "mesos_zookeeper_session_events_total",
+    "ZooKeeper session events, by state.",
+    process::metrics::label("state", "connected"));
+static process::metrics::Counter connecting(
+    "mesos_zookeeper_session_events_total",
+    "ZooKeeper session events, by state.",
+    process::metrics::label("state", "connecting"));
+static process::metrics::Counter expired(
+    "mesos_zookeeper_session_events_total",
+    "ZooKeeper session events, by state.",
+    process::metrics::label("state", "expired"));
+static process::metrics::Counter authFailed(
+    "mesos_zookeeper_session_events_total",
+    "ZooKeeper session events, by state.",
+    process::metrics::label("state", "auth_failed"));
+
+
 // Singleton instance of WatcherProcessManager.
 class WatcherProcessManager;
 
@@ -341,10 +366,50 @@ public:
     return future;
   }
 
+  Future<list<int> > batch(vector<ZooKeeper::Operation>* operations)
+  {
+    list<Future<int> > futures;
+
+    foreach (ZooKeeper::Operation& operation, *operations) {
+      switch (operation.type) {
+        case ZooKeeper::Operation::CREATE:
+          futures.push_back(create(operation.path, operation.data,
+                                   operation.acl, operation.flags,
+                                   &operation.result));
+          break;
+        case ZooKeeper::Operation::REMOVE:
+          futures.push_back(remove(operation.path, operation.version));
+          break;
+        case ZooKeeper::Operation::SET:
+          futures.push_back(set(operation.path, operation.data,
+                                operation.version));
+          break;
+        case ZooKeeper::Operation::GET:
+          futures.push_back(get(operation.path, false, &operation.result,
+                                &operation.stat));
+          break;
+      }
+    }
+
+    return process::collect(futures);
+  }
+
 private:
   static void event(zhandle_t* zh, int type, int state,
 		    const char* path, void* ctx)
   {
+    if (type == ZOO_SESSION_EVENT) {
+      if (state == ZOO_CONNECTED_STATE) {
+        connected.increment();
+      } else if (state == ZOO_CONNECTING_STATE) {
+        connecting.increment();
+      } else if (state == ZOO_EXPIRED_SESSION_STATE) {
+        expired.increment();
+      } else if (state == ZOO_AUTH_FAILED_STATE) {
+        authFailed.increment();
+      }
+    }
+
     ZooKeeperImpl* impl = static_cast<ZooKeeperImpl*>(ctx);
     process::dispatch(impl->pid, &WatcherProcess::event,
 		      impl->zk, type, state, string(path));
@@ -541,6 +606,85 @@ int ZooKeeper::set(const string& path, const string& data, int version)
 }
 
 
+ZooKeeper::Operation ZooKeeper::Operation::create(const string& path,
+                                                  const string& data,
+                                                  const ACL_vector& acl,
+                                                  int flags)
+{
+  Operation operation;
+  operation.type = CREATE;
+  operation.path = path;
+  operation.data = data;
+  operation.acl = acl;
+  operation.flags = flags;
+  operation.version = -1;
+  operation.code = ZOK;
+  return operation;
+}
+
+
+ZooKeeper::Operation ZooKeeper::Operation::remove(const string& path,
+                                                  int version)
+{
+  Operation operation;
+  operation.type = REMOVE;
+  operation.path = path;
+  operation.acl = ZOO_OPEN_ACL_UNSAFE;
+  operation.flags = 0;
+  operation.version = version;
+  operation.code = ZOK;
+  return operation;
+}
+
+
+ZooKeeper::Operation ZooKeeper::Operation::set(const string& path,
+                                               const string& data,
+                                               int version)
+{
+  Operation operation;
+  operation.type = SET;
+  operation.path = path;
+  operation.data = data;
+  operation.acl = ZOO_OPEN_ACL_UNSAFE;
+  operation.flags = 0;
+  operation.version = version;
+  operation.code = ZOK;
+  return operation;
+}
+
+
+ZooKeeper::Operation ZooKeeper::Operation::get(const string& path)
+{
+  Operation operation;
+  operation.type = GET;
+  operation.path = path;
+  operation.acl = ZOO_OPEN_ACL_UNSAFE;
+  operation.flags = 0;
+  operation.version = -1;
+  operation.code = ZOK;
+  return operation;
+}
+
+
+int ZooKeeper::batch(vector<Operation>* operations)
+{
+  list<int> codes = impl->batch(operations).get();
+
+  CHECK(codes.size() == operations->size());
+
+  int code = ZOK;
+  vector<Operation>::iterator operation = operations->begin();
+  foreach (int c, codes) {
+    (operation++)->code = c;
+    if (code == ZOK && c != ZOK) {
+      code = c;
+    }
+  }
+
+  return code;
+}
+
+
 const char* ZooKeeper::message(int code) const
 {
   return zerror(code);
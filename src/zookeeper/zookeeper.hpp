@@ -286,6 +286,52 @@ public:
    */
   int set(const std::string &path, const std::string &data, int version);
 
+  /**
+   * \brief an operation of a batch (see ZooKeeper::batch), which also
+   * holds the results of performing it.
+   */
+  struct Operation
+  {
+    enum Type { CREATE, REMOVE, SET, GET };
+
+    static Operation create(const std::string &path,
+                            const std::string &data,
+                            const ACL_vector &acl,
+                            int flags);
+    static Operation remove(const std::string &path, int version);
+    static Operation set(const std::string &path,
+                         const std::string &data,
+                         int version);
+    static Operation get(const std::string &path);
+
+    Type type;
+    std::string path;
+    std::string data;
+    ACL_vector acl;
+    int flags;
+    int version;
+
+    int code; /* Return code (see the synchronous functions). */
+    std::string result; /* Path created or data gotten. */
+    Stat stat; /* Stat of the node gotten. */
+  };
+
+  /**
+   * \brief perform a batch of operations with one round trip.
+   *
+   * The operations are all sent before waiting for any of them to
+   * complete (ZooKeeper performs the operations of a session in
+   * order), so the whole batch takes about as long as one operation.
+   * N.B. The batch is not a transaction: each operation succeeds or
+   * fails on its own (ZooKeeper 3.3 has no multi-op transactions).
+   *
+   * \param operations the operations, in order, whose codes and
+   *    results get filled in.
+   * \return ZOK if every operation completed successfully, otherwise
+   *    the code of the first operation that didn't.
+   */
+  int batch(std::vector<Operation> *operations);
+
   /**
    * \brief return a message describing the return code.
    *
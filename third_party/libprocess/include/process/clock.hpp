@@ -11,6 +11,14 @@ class Clock
 public:
   static double now();
   static double now(ProcessBase* process);
+
+  // Like now() but only precise to a few milliseconds (where the
+  // system has a cheaper clock for that), e.g., for timestamps.
+  static double coarse();
+
+  // Returns the actual (wall clock) time even if the clock is paused,
+  // e.g., for measuring how long something took.
+  static double real();
   static void pause();
   static bool paused();
   static void resume();
@@ -3,6 +3,7 @@
 
 #include <tr1/functional>
 #include <tr1/memory> // TODO(benh): Replace all shared_ptr with unique_ptr.
+#include <tr1/type_traits>
 
 #include <process/process.hpp>
 #include <process/preprocessor.hpp>
@@ -29,12 +30,14 @@ namespace process {
 // accomplish the same thing (all be it less cleanly). See below for
 // those definitions.
 //
-// Dispatching is done via a level of indirection. The dispatch
-// routine itself creates a promise that is passed as an argument to a
-// partially applied 'dispatcher' function (defined below). The
-// dispatcher routines get passed to the actual process via an
-// internal routine called, not suprisingly, 'dispatch', defined
-// below:
+// Dispatching is done by enqueueing a 'DispatchEvent' on the process
+// that holds everything needed to make the call: the method, copies
+// of the arguments and (for methods returning a result) the promise
+// of the result, all in the same (and only) allocation. The process
+// invokes the event (see DispatchEvent::operator ()), which downcasts
+// the process to the correct subtype, invokes the method and sets (or
+// associates) the promise with the result. The events are defined
+// here:
 
 namespace internal {
 
@@ -49,11 +52,14 @@ namespace internal {
 void dispatch(const UPID& pid, std::tr1::function<void(ProcessBase*)>* f);
 
 
-// The magic of dispatch actually occurs within the dispatcher
-// routines. In particular, some of the dispatcher routines need to
-// wait for values and "associate" them with the future that got
-// returned from the original call to dispatch. Those association
-// functions are defined here:
+// Like dispatch above, but enqueues the specified event (which the
+// routine assumes ownership of) rather than wrapping a function.
+void deliver(const UPID& pid, DispatchEvent* event);
+
+
+// Some of the events need to wait for values and "associate" them
+// with the future that got returned from the original call to
+// dispatch. Those association functions are defined here:
 
 template <typename T>
 void __associate(const Future<T>& from, std::tr1::shared_ptr<Promise<T> > to)
@@ -82,50 +88,156 @@ void associate(const Future<T>& from, std::tr1::shared_ptr<Promise<T> > to)
 }
 
 
-// Finally come the dispatcher functions (one for each return type:
-// void, future, value) which should complete the picture. Given the
-// process argument these routines downcast the process to the correct
-// subtype and invoke the thunk using the subtype as the argument
-// (receiver). Note that we must use dynamic_cast because we permit a
-// process to use multiple inheritance (e.g., to expose multiple
-// callback interfaces).
-
+// Downcasts the process to the type of the receiver of the call. Note
+// that we must use dynamic_cast because we permit a process to use
+// multiple inheritance (e.g., to expose multiple callback interfaces).
 template <typename T>
-void vdispatcher(
-    ProcessBase* process,
-    std::tr1::shared_ptr<std::tr1::function<void(T*)> > thunk)
+T* receiver(ProcessBase* process)
 {
   assert(process != NULL);
   T* t = dynamic_cast<T*>(process);
   assert(t != NULL);
-  (*thunk)(t);
+  return t;
 }
 
 
-template <typename R, typename T>
-void pdispatcher(
+// Dispatcher function used by delay (see timer.hpp).
+template <typename T>
+void vdispatcher(
     ProcessBase* process,
-    std::tr1::shared_ptr<std::tr1::function<Future<R>(T*)> > thunk,
-    std::tr1::shared_ptr<Promise<R> > promise)
+    std::tr1::shared_ptr<std::tr1::function<void(T*)> > thunk)
 {
-  assert(process != NULL);
-  T* t = dynamic_cast<T*>(process);
-  assert(t != NULL);
-  associate((*thunk)(t), promise);
+  (*thunk)(receiver<T>(process));
 }
 
 
-template <typename R, typename T>
-void rdispatcher(
-    ProcessBase* process,
-    std::tr1::shared_ptr<std::tr1::function<R(T*)> > thunk,
-    std::tr1::shared_ptr<Promise<R> > promise)
+// The type an argument of a call is stored as (i.e., a copy, even if
+// the method takes the argument by reference).
+template <typename T>
+struct Stored
 {
-  assert(process != NULL);
-  T* t = dynamic_cast<T*>(process);
-  assert(t != NULL);
-  promise->set((*thunk)(t));
-}
+  typedef typename std::tr1::remove_const<
+    typename std::tr1::remove_reference<T>::type>::type type;
+};
+
+
+// A call of a method with N arguments (one definition for each N, as
+// 'Call0', 'Call1', ...), holding copies of the arguments. In C++11:
+//
+// template <typename R, typename T, typename ...P>
+// struct Call
+// {
+//   typedef R Result;
+//   typedef T Receiver;
+//
+//   Call(R (T::*_method)(P...), P... _p) : method(_method), p(_p...) {}
+//
+//   R operator () (T* t) const { return (t->*method)(p...); }
+//
+//   R (T::*method)(P...);
+//   mutable std::tuple<typename Stored<P>::type...> p;
+// };
+//
+// (The arguments are mutable because a method might take some of them
+// by non-const reference.)
+
+#define PARAMETER(Z, N, DATA)                                           \
+  , const typename Stored<CAT(P, N)>::type& CAT(_a, N)
+
+#define INITIALIZER(Z, N, DATA)                                         \
+  , CAT(a, N)(CAT(_a, N))
+
+#define MEMBER(Z, N, DATA)                                              \
+  mutable typename Stored<CAT(P, N)>::type CAT(a, N);
+
+#define TEMPLATE(Z, N, DATA)                                            \
+  template <typename R,                                                 \
+            typename T                                                  \
+            ENUM_TRAILING_PARAMS(N, typename P)>                        \
+  struct CAT(Call, N)                                                   \
+  {                                                                     \
+    typedef R Result;                                                   \
+    typedef T Receiver;                                                 \
+                                                                        \
+    CAT(Call, N)(R (T::*_method)(ENUM_PARAMS(N, P))                     \
+                 REPEAT(N, PARAMETER, _))                               \
+      : method(_method) REPEAT(N, INITIALIZER, _) {}                    \
+                                                                        \
+    R operator () (T* t) const                                          \
+    {                                                                   \
+      return (t->*method)(ENUM_PARAMS(N, a));                           \
+    }                                                                   \
+                                                                        \
+    R (T::*method)(ENUM_PARAMS(N, P));                                  \
+    REPEAT(N, MEMBER, _)                                                \
+  };
+
+  REPEAT_FROM_TO(0, 11, TEMPLATE, _) // Args A0 -> A9.
+#undef TEMPLATE
+#undef MEMBER
+#undef INITIALIZER
+#undef PARAMETER
+
+
+// Finally come the events (one for each kind of result: discarded,
+// future, value) which should complete the picture.
+
+// Makes the call, discarding the result (if any).
+template <typename C>
+struct CallEvent : DispatchEvent
+{
+  explicit CallEvent(const C& _call) : call(_call) {}
+
+  virtual void operator () (ProcessBase* process) const
+  {
+    call(receiver<typename C::Receiver>(process));
+  }
+
+  const C call;
+};
+
+
+// Makes the call and associates the future it returns with the
+// promise (created up front, so that dispatch can return its future).
+template <typename C, typename R>
+struct FutureCallEvent : DispatchEvent
+{
+  explicit FutureCallEvent(const C& _call)
+    : call(_call), promise(new Promise<R>()) {}
+
+  virtual ~FutureCallEvent()
+  {
+    delete promise; // NULL unless the event never got invoked.
+  }
+
+  virtual void operator () (ProcessBase* process) const
+  {
+    // The promise must outlive the event (until the future returned
+    // by the call gets set).
+    std::tr1::shared_ptr<Promise<R> > to(promise);
+    promise = NULL;
+    associate(call(receiver<typename C::Receiver>(process)), to);
+  }
+
+  const C call;
+  mutable Promise<R>* promise;
+};
+
+
+// Makes the call and sets the promise with the value it returns.
+template <typename C, typename R>
+struct ValueCallEvent : DispatchEvent
+{
+  explicit ValueCallEvent(const C& _call) : call(_call) {}
+
+  virtual void operator () (ProcessBase* process) const
+  {
+    promise.set(call(receiver<typename C::Receiver>(process)));
+  }
+
+  const C call;
+  mutable Promise<R> promise;
+};
 
 } // namespace internal {
 
@@ -144,102 +256,54 @@ void rdispatcher(
 //     void (T::*method)(P...),
 //     P... p)
 // {
-//   std::tr1::shared_ptr<std::tr1::function<void(T*)> > thunk(
-//       new std::tr1::function<void(T*)>(
-//           std::tr1::bind(method,
-//                          std::tr1::placeholders::_1,
-//                          std::forward<P>(p)...)));
+//   typedef internal::Call<void, T, P...> Call;
 //
-//   std::tr1::function<void(ProcessBase*)>* dispatcher =
-//     new std::tr1::function<void(ProcessBase*)>(
-//         std::tr1::bind(&internal::vdispatcher<T>,
-//                        std::tr1::placeholders::_1,
-//                        thunk));
-//
-//   internal::dispatch(pid, dispatcher);
+//   internal::deliver(
+//       pid,
+//       new internal::CallEvent<Call>(Call(method, std::forward<P>(p)...)));
 // }
 
-template <typename T>
-void dispatch(
-    const PID<T>& pid,
-    void (T::*method)(void))
-{
-  std::tr1::shared_ptr<std::tr1::function<void(T*)> > thunk(
-      new std::tr1::function<void(T*)>(
-          std::tr1::bind(method, std::tr1::placeholders::_1)));
-
-  std::tr1::function<void(ProcessBase*)>* dispatcher =
-    new std::tr1::function<void(ProcessBase*)>(
-        std::tr1::bind(&internal::vdispatcher<T>,
-                       std::tr1::placeholders::_1,
-                       thunk));
-
-  internal::dispatch(pid, dispatcher);
-}
-
-template <typename T>
-void dispatch(
-    const Process<T>& process,
-    void (T::*method)(void))
-{
-  dispatch(process.self(), method);
-}
-
-template <typename T>
-void dispatch(
-    const Process<T>* process,
-    void (T::*method)(void))
-{
-  dispatch(process->self(), method);
-}
-
 #define TEMPLATE(Z, N, DATA)                                            \
-  template <typename T,                                                 \
-            ENUM_PARAMS(N, typename P),                                 \
-            ENUM_PARAMS(N, typename A)>                                 \
+  template <typename T                                                  \
+            ENUM_TRAILING_PARAMS(N, typename P)                         \
+            ENUM_TRAILING_PARAMS(N, typename A)>                        \
   void dispatch(                                                        \
       const PID<T>& pid,                                                \
-      void (T::*method)(ENUM_PARAMS(N, P)),                             \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      void (T::*method)(ENUM_PARAMS(N, P))                              \
+      ENUM_TRAILING_BINARY_PARAMS(N, A, a))                             \
   {                                                                     \
-    std::tr1::shared_ptr<std::tr1::function<void(T*)> > thunk(          \
-        new std::tr1::function<void(T*)>(                               \
-            std::tr1::bind(method,                                      \
-                           std::tr1::placeholders::_1,                  \
-                           ENUM_PARAMS(N, a))));                        \
+    typedef internal::CAT(Call, N)<void, T ENUM_TRAILING_PARAMS(N, P)>  \
+      Call;                                                             \
                                                                         \
-    std::tr1::function<void(ProcessBase*)>* dispatcher =                \
-      new std::tr1::function<void(ProcessBase*)>(                       \
-          std::tr1::bind(&internal::vdispatcher<T>,                     \
-                         std::tr1::placeholders::_1,                    \
-                         thunk));                                       \
-                                                                        \
-    internal::dispatch(pid, dispatcher);                                \
+    internal::deliver(                                                  \
+        pid,                                                            \
+        new internal::CallEvent<Call>(                                  \
+            Call(method ENUM_TRAILING_PARAMS(N, a))));                  \
   }                                                                     \
                                                                         \
-  template <typename T,                                                 \
-            ENUM_PARAMS(N, typename P),                                 \
-            ENUM_PARAMS(N, typename A)>                                 \
+  template <typename T                                                  \
+            ENUM_TRAILING_PARAMS(N, typename P)                         \
+            ENUM_TRAILING_PARAMS(N, typename A)>                        \
   void dispatch(                                                        \
       const Process<T>& process,                                        \
-      void (T::*method)(ENUM_PARAMS(N, P)),                             \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      void (T::*method)(ENUM_PARAMS(N, P))                              \
+      ENUM_TRAILING_BINARY_PARAMS(N, A, a))                             \
   {                                                                     \
-    dispatch(process.self(), method, ENUM_PARAMS(N, a));                \
+    dispatch(process.self(), method ENUM_TRAILING_PARAMS(N, a));        \
   }                                                                     \
                                                                         \
-  template <typename T,                                                 \
-            ENUM_PARAMS(N, typename P),                                 \
-            ENUM_PARAMS(N, typename A)>                                 \
+  template <typename T                                                  \
+            ENUM_TRAILING_PARAMS(N, typename P)                         \
+            ENUM_TRAILING_PARAMS(N, typename A)>                        \
   void dispatch(                                                        \
       const Process<T>* process,                                        \
-      void (T::*method)(ENUM_PARAMS(N, P)),                             \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      void (T::*method)(ENUM_PARAMS(N, P))                              \
+      ENUM_TRAILING_BINARY_PARAMS(N, A, a))                             \
   {                                                                     \
-    dispatch(process->self(), method, ENUM_PARAMS(N, a));               \
+    dispatch(process->self(), method ENUM_TRAILING_PARAMS(N, a));       \
   }
 
-  REPEAT_FROM_TO(1, 11, TEMPLATE, _) // Args A0 -> A9.
+  REPEAT_FROM_TO(0, 11, TEMPLATE, _) // Args A0 -> A9.
 #undef TEMPLATE
 
 
@@ -251,120 +315,68 @@ void dispatch(
 //     Future<R> (T::*method)(P...),
 //     P... p)
 // {
-//   std::tr1::shared_ptr<std::tr1::function<Future<R>(T*)> > thunk(
-//       new std::tr1::function<Future<R>(T*)>(
-//           std::tr1::bind(method,
-//                          std::tr1::placeholders::_1,
-//                          std::forward<P>(p)...)));
+//   typedef internal::Call<Future<R>, T, P...> Call;
 //
-//   std::tr1::shared_ptr<Promise<R> > promise(new Promise<R>());
-//   Future<R> future = promise->future();
+//   internal::FutureCallEvent<Call, R>* event =
+//     new internal::FutureCallEvent<Call, R>(
+//         Call(method, std::forward<P>(p)...));
 //
-//   std::tr1::function<void(ProcessBase*)>* dispatcher =
-//     new std::tr1::function<void(ProcessBase*)>(
-//         std::tr1::bind(&internal::pdispatcher<R, T>,
-//                        std::tr1::placeholders::_1,
-//                        thunk, promise));
+//   Future<R> future = event->promise->future();
 //
-//   internal::dispatch(pid, dispatcher);
+//   internal::deliver(pid, event);
 //
 //   return future;
 // }
 
-template <typename R, typename T>
-Future<R> dispatch(
-    const PID<T>& pid,
-    Future<R> (T::*method)(void))
-{
-  std::tr1::shared_ptr<std::tr1::function<Future<R>(T*)> > thunk(
-      new std::tr1::function<Future<R>(T*)>(
-          std::tr1::bind(method, std::tr1::placeholders::_1)));
-
-  std::tr1::shared_ptr<Promise<R> > promise(new Promise<R>());
-  Future<R> future = promise->future();
-
-  std::tr1::function<void(ProcessBase*)>* dispatcher =
-    new std::tr1::function<void(ProcessBase*)>(
-        std::tr1::bind(&internal::pdispatcher<R, T>,
-                       std::tr1::placeholders::_1,
-                       thunk, promise));
-
-  internal::dispatch(pid, dispatcher);
-
-  return future;
-}
-
-template <typename R, typename T>
-Future<R> dispatch(
-    const Process<T>& process,
-    Future<R> (T::*method)(void))
-{
-  return dispatch(process.self(), method);
-}
-
-template <typename R, typename T>
-Future<R> dispatch(
-    const Process<T>* process,
-    Future<R> (T::*method)(void))
-{
-  return dispatch(process->self(), method);
-}
-
 #define TEMPLATE(Z, N, DATA)                                            \
   template <typename R,                                                 \
-            typename T,                                                 \
-            ENUM_PARAMS(N, typename P),                                 \
-            ENUM_PARAMS(N, typename A)>                                 \
+            typename T                                                  \
+            ENUM_TRAILING_PARAMS(N, typename P)                         \
+            ENUM_TRAILING_PARAMS(N, typename A)>                        \
   Future<R> dispatch(                                                   \
       const PID<T>& pid,                                                \
-      Future<R> (T::*method)(ENUM_PARAMS(N, P)),                        \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      Future<R> (T::*method)(ENUM_PARAMS(N, P))                         \
+      ENUM_TRAILING_BINARY_PARAMS(N, A, a))                             \
   {                                                                     \
-    std::tr1::shared_ptr<std::tr1::function<Future<R>(T*)> > thunk(     \
-        new std::tr1::function<Future<R>(T*)>(                          \
-            std::tr1::bind(method,                                      \
-                           std::tr1::placeholders::_1,                  \
-                           ENUM_PARAMS(N, a))));                        \
+    typedef internal::CAT(Call, N)<Future<R>,                           \
+                                   T ENUM_TRAILING_PARAMS(N, P)> Call;  \
                                                                         \
-    std::tr1::shared_ptr<Promise<R> > promise(new Promise<R>());        \
-    Future<R> future = promise->future();                               \
+    internal::FutureCallEvent<Call, R>* event =                         \
+      new internal::FutureCallEvent<Call, R>(                           \
+          Call(method ENUM_TRAILING_PARAMS(N, a)));                     \
                                                                         \
-    std::tr1::function<void(ProcessBase*)>* dispatcher =                \
-      new std::tr1::function<void(ProcessBase*)>(                       \
-          std::tr1::bind(&internal::pdispatcher<R, T>,                  \
-                         std::tr1::placeholders::_1,                    \
-                         thunk, promise));                              \
+    Future<R> future = event->promise->future();                        \
                                                                         \
-    internal::dispatch(pid, dispatcher);                                \
+    internal::deliver(pid, event);                                      \
                                                                         \
     return future;                                                      \
   }                                                                     \
                                                                         \
   template <typename R,                                                 \
-            typename T,                                                 \
-            ENUM_PARAMS(N, typename P),                                 \
-            ENUM_PARAMS(N, typename A)>                                 \
+            typename T                                                  \
+            ENUM_TRAILING_PARAMS(N, typename P)                         \
+            ENUM_TRAILING_PARAMS(N, typename A)>                        \
   Future<R> dispatch(                                                   \
       const Process<T>& process,                                        \
-      Future<R> (T::*method)(ENUM_PARAMS(N, P)),                        \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      Future<R> (T::*method)(ENUM_PARAMS(N, P))                         \
+      ENUM_TRAILING_BINARY_PARAMS(N, A, a))                             \
   {                                                                     \
-    return dispatch(process.self(), method, ENUM_PARAMS(N, a));         \
+    return dispatch(process.self(), method ENUM_TRAILING_PARAMS(N, a)); \
   }                                                                     \
                                                                         \
   template <typename R,                                                 \
-            typename T,                                                 \
-            ENUM_PARAMS(N, typename P),                                 \
-            ENUM_PARAMS(N, typename A)>                                 \
+            typename T                                                  \
+            ENUM_TRAILING_PARAMS(N, typename P)                         \
+            ENUM_TRAILING_PARAMS(N, typename A)>                        \
   Future<R> dispatch(                                                   \
       const Process<T>* process,                                        \
-      Future<R> (T::*method)(ENUM_PARAMS(N, P)),                        \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      Future<R> (T::*method)(ENUM_PARAMS(N, P))                         \
+      ENUM_TRAILING_BINARY_PARAMS(N, A, a))                             \
   {                                                                     \
-    return dispatch(process->self(), method, ENUM_PARAMS(N, a));        \
+    return dispatch(process->self(), method ENUM_TRAILING_PARAMS(N, a)); \
   }
 
-  REPEAT_FROM_TO(1, 11, TEMPLATE, _) // Args A0 -> A9.
+  REPEAT_FROM_TO(0, 11, TEMPLATE, _) // Args A0 -> A9.
 #undef TEMPLATE
 
 
@@ -376,120 +388,132 @@ Future<R> dispatch(
 //     R (T::*method)(P...),
 //     P... p)
 // {
-//   std::tr1::shared_ptr<std::tr1::function<R(T*)> > thunk(
-//       new std::tr1::function<R(T*)>(
-//           std::tr1::bind(method,
-//                          std::tr1::placeholders::_1,
-//                          std::forward<P>(p)...)));
+//   typedef internal::Call<R, T, P...> Call;
 //
-//   std::tr1::shared_ptr<Promise<R> > promise(new Promise<R>());
-//   Future<R> future = promise->future();
+//   internal::ValueCallEvent<Call, R>* event =
+//     new internal::ValueCallEvent<Call, R>(
+//         Call(method, std::forward<P>(p)...));
 //
-//   std::tr1::function<void(ProcessBase*)>* dispatcher =
-//     new std::tr1::function<void(ProcessBase*)>(
-//         std::tr1::bind(&internal::rdispatcher<R, T>,
-//                        std::tr1::placeholders::_1,
-//                        thunk, promise));
+//   Future<R> future = event->promise.future();
 //
-//   internal::dispatch(pid, dispatcher);
+//   internal::deliver(pid, event);
 //
 //   return future;
 // }
 
-template <typename R, typename T>
-Future<R> dispatch(
-    const PID<T>& pid,
-    R (T::*method)(void))
-{
-  std::tr1::shared_ptr<std::tr1::function<R(T*)> > thunk(
-      new std::tr1::function<R(T*)>(
-          std::tr1::bind(method, std::tr1::placeholders::_1)));
-
-  std::tr1::shared_ptr<Promise<R> > promise(new Promise<R>());
-  Future<R> future = promise->future();
-
-  std::tr1::function<void(ProcessBase*)>* dispatcher =
-    new std::tr1::function<void(ProcessBase*)>(
-        std::tr1::bind(&internal::rdispatcher<R, T>,
-                       std::tr1::placeholders::_1,
-                       thunk, promise));
-
-  internal::dispatch(pid, dispatcher);
-
-  return future;
-}
-
-template <typename R, typename T>
-Future<R> dispatch(
-    const Process<T>& process,
-    R (T::*method)(void))
-{
-  return dispatch(process.self(), method);
-}
-
-template <typename R, typename T>
-Future<R> dispatch(
-    const Process<T>* process,
-    R (T::*method)(void))
-{
-  return dispatch(process->self(), method);
-}
-
 #define TEMPLATE(Z, N, DATA)                                            \
   template <typename R,                                                 \
-            typename T,                                                 \
-            ENUM_PARAMS(N, typename P),                                 \
-            ENUM_PARAMS(N, typename A)>                                 \
+            typename T                                                  \
+            ENUM_TRAILING_PARAMS(N, typename P)                         \
+            ENUM_TRAILING_PARAMS(N, typename A)>                        \
   Future<R> dispatch(                                                   \
       const PID<T>& pid,                                                \
-      R (T::*method)(ENUM_PARAMS(N, P)),                                \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      R (T::*method)(ENUM_PARAMS(N, P))                                 \
+      ENUM_TRAILING_BINARY_PARAMS(N, A, a))                             \
   {                                                                     \
-    std::tr1::shared_ptr<std::tr1::function<R(T*)> > thunk(             \
-        new std::tr1::function<R(T*)>(                                  \
-            std::tr1::bind(method,                                      \
-                           std::tr1::placeholders::_1,                  \
-                           ENUM_PARAMS(N, a))));                        \
+    typedef internal::CAT(Call, N)<R, T ENUM_TRAILING_PARAMS(N, P)>     \
+      Call;                                                             \
                                                                         \
-    std::tr1::shared_ptr<Promise<R> > promise(new Promise<R>());        \
-    Future<R> future = promise->future();                               \
+    internal::ValueCallEvent<Call, R>* event =                          \
+      new internal::ValueCallEvent<Call, R>(                            \
+          Call(method ENUM_TRAILING_PARAMS(N, a)));                     \
                                                                         \
-    std::tr1::function<void(ProcessBase*)>* dispatcher =                \
-      new std::tr1::function<void(ProcessBase*)>(                       \
-          std::tr1::bind(&internal::rdispatcher<R, T>,                  \
-                         std::tr1::placeholders::_1,                    \
-                         thunk, promise));                              \
+    Future<R> future = event->promise.future();                         \
                                                                         \
-    internal::dispatch(pid, dispatcher);                                \
+    internal::deliver(pid, event);                                      \
                                                                         \
     return future;                                                      \
   }                                                                     \
                                                                         \
   template <typename R,                                                 \
-            typename T,                                                 \
-            ENUM_PARAMS(N, typename P),                                 \
-            ENUM_PARAMS(N, typename A)>                                 \
+            typename T                                                  \
+            ENUM_TRAILING_PARAMS(N, typename P)                         \
+            ENUM_TRAILING_PARAMS(N, typename A)>                        \
   Future<R> dispatch(                                                   \
       const Process<T>& process,                                        \
-      R (T::*method)(ENUM_PARAMS(N, P)),                                \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      R (T::*method)(ENUM_PARAMS(N, P))                                 \
+      ENUM_TRAILING_BINARY_PARAMS(N, A, a))                             \
   {                                                                     \
-    return dispatch(process.self(), method, ENUM_PARAMS(N, a));         \
+    return dispatch(process.self(), method ENUM_TRAILING_PARAMS(N, a)); \
   }                                                                     \
                                                                         \
   template <typename R,                                                 \
-            typename T,                                                 \
-            ENUM_PARAMS(N, typename P),                                 \
-            ENUM_PARAMS(N, typename A)>                                 \
+            typename T                                                  \
+            ENUM_TRAILING_PARAMS(N, typename P)                         \
+            ENUM_TRAILING_PARAMS(N, typename A)>                        \
   Future<R> dispatch(                                                   \
       const Process<T>* process,                                        \
-      R (T::*method)(ENUM_PARAMS(N, P)),                                \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      R (T::*method)(ENUM_PARAMS(N, P))                                 \
+      ENUM_TRAILING_BINARY_PARAMS(N, A, a))                             \
+  {                                                                     \
+    return dispatch(process->self(), method ENUM_TRAILING_PARAMS(N, a)); \
+  }
+
+  REPEAT_FROM_TO(0, 11, TEMPLATE, _) // Args A0 -> A9.
+#undef TEMPLATE
+
+
+// Finally, 'tell' is like dispatch but for when the caller doesn't
+// care about the result of the method (whatever it returns): no
+// promise (or future) gets created and the result gets discarded.
+//
+// template <typename R, typename T, typename ...P>
+// void tell(
+//     const PID<T>& pid,
+//     R (T::*method)(P...),
+//     P... p)
+// {
+//   typedef internal::Call<R, T, P...> Call;
+//
+//   internal::deliver(
+//       pid,
+//       new internal::CallEvent<Call>(Call(method, std::forward<P>(p)...)));
+// }
+
+#define TEMPLATE(Z, N, DATA)                                            \
+  template <typename R,                                                 \
+            typename T                                                  \
+            ENUM_TRAILING_PARAMS(N, typename P)                         \
+            ENUM_TRAILING_PARAMS(N, typename A)>                        \
+  void tell(                                                            \
+      const PID<T>& pid,                                                \
+      R (T::*method)(ENUM_PARAMS(N, P))                                 \
+      ENUM_TRAILING_BINARY_PARAMS(N, A, a))                             \
+  {                                                                     \
+    typedef internal::CAT(Call, N)<R, T ENUM_TRAILING_PARAMS(N, P)>     \
+      Call;                                                             \
+                                                                        \
+    internal::deliver(                                                  \
+        pid,                                                            \
+        new internal::CallEvent<Call>(                                  \
+            Call(method ENUM_TRAILING_PARAMS(N, a))));                  \
+  }                                                                     \
+                                                                        \
+  template <typename R,                                                 \
+            typename T                                                  \
+            ENUM_TRAILING_PARAMS(N, typename P)                         \
+            ENUM_TRAILING_PARAMS(N, typename A)>                        \
+  void tell(                                                            \
+      const Process<T>& process,                                        \
+      R (T::*method)(ENUM_PARAMS(N, P))                                 \
+      ENUM_TRAILING_BINARY_PARAMS(N, A, a))                             \
+  {                                                                     \
+    tell(process.self(), method ENUM_TRAILING_PARAMS(N, a));            \
+  }                                                                     \
+                                                                        \
+  template <typename R,                                                 \
+            typename T                                                  \
+            ENUM_TRAILING_PARAMS(N, typename P)                         \
+            ENUM_TRAILING_PARAMS(N, typename A)>                        \
+  void tell(                                                            \
+      const Process<T>* process,                                        \
+      R (T::*method)(ENUM_PARAMS(N, P))                                 \
+      ENUM_TRAILING_BINARY_PARAMS(N, A, a))                             \
   {                                                                     \
-    return dispatch(process->self(), method, ENUM_PARAMS(N, a));        \
+    tell(process->self(), method ENUM_TRAILING_PARAMS(N, a));           \
   }
 
-  REPEAT_FROM_TO(1, 11, TEMPLATE, _) // Args A0 -> A9.
+  REPEAT_FROM_TO(0, 11, TEMPLATE, _) // Args A0 -> A9.
 #undef TEMPLATE
 
 } // namespace process {
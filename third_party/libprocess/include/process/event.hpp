@@ -2,6 +2,7 @@
 #define __PROCESS_EVENT_HPP__
 
 #include <tr1/functional>
+#include <tr1/memory>
 
 #include <process/future.hpp>
 #include <process/http.hpp>
@@ -30,6 +31,10 @@ struct EventVisitor
 
 struct Event
 {
+  Event() : next(NULL), enqueued(0) {}
+
+  virtual ~Event() {}
+
   virtual void visit(EventVisitor* visitor) const = 0;
 
   template <typename T>
@@ -63,6 +68,14 @@ struct Event
     }
     return *result;
   }
+
+  // Intrusive link used while the event sits in the mailbox of a
+  // process (see ProcessBase::enqueue).
+  Event* next;
+
+  // When the event got enqueued (see Clock::real), used to measure
+  // how long events wait in the mailbox of a process.
+  double enqueued;
 };
 
 
@@ -92,8 +105,10 @@ private:
 
 struct HttpEvent : Event
 {
-  HttpEvent(int _c, HttpRequest* _request)
-    : c(_c), request(_request) {}
+  HttpEvent(int _c,
+            HttpRequest* _request,
+            const std::tr1::shared_ptr<Promise<HttpResponse> >& _response)
+    : c(_c), request(_request), response(_response) {}
 
   ~HttpEvent()
   {
@@ -108,6 +123,10 @@ struct HttpEvent : Event
   const int c;
   HttpRequest* const request;
 
+  // Where the response goes (the socket's proxy is already waiting on
+  // it, in order to send responses in the order requests came in).
+  const std::tr1::shared_ptr<Promise<HttpResponse> > response;
+
 private:
   // Not copyable, not assignable.
   HttpEvent(const HttpEvent&);
@@ -120,7 +139,7 @@ struct DispatchEvent : Event
   DispatchEvent(std::tr1::function<void(ProcessBase*)>* _function)
     : function(_function) {}
 
-  ~DispatchEvent()
+  virtual ~DispatchEvent()
   {
     delete function;
   }
@@ -130,8 +149,19 @@ struct DispatchEvent : Event
     visitor->visit(*this);
   }
 
+  // Invokes the dispatched function with the process. The events
+  // created by dispatch hold the call themselves (see dispatch.hpp)
+  // and override this rather than using a function.
+  virtual void operator () (ProcessBase* process) const
+  {
+    (*function)(process);
+  }
+
   std::tr1::function<void(ProcessBase*)>* const function;
 
+protected:
+  DispatchEvent() : function(NULL) {}
+
 private:
   // Not copyable, not assignable.
   DispatchEvent(const DispatchEvent&);
@@ -4,8 +4,9 @@
 #include <assert.h>
 #include <stdlib.h> // For abort.
 
-#include <queue>
+#include <list>
 #include <set>
+#include <vector>
 
 #include <tr1/functional>
 #include <tr1/memory> // TODO(benh): Replace shared_ptr with unique_ptr.
@@ -77,6 +78,16 @@ public:
   const Future<T>& onDiscarded(const DiscardedCallback& callback) const;
   const Future<T>& onAny(const AnyCallback& callback) const;
 
+  // Returns a future for the result of invoking 'f' with the value of
+  // this future once it's ready (waiting on the future 'f' returns,
+  // if any). The returned future fails or gets discarded if this
+  // future does.
+  template <typename X>
+  Future<X> then(const std::tr1::function<Future<X>(const T&)>& f) const;
+
+  template <typename X>
+  Future<X> then(const std::tr1::function<X(const T&)>& f) const;
+
 private:
   friend class Promise<T>;
 
@@ -91,6 +102,14 @@ private:
   void copy(const Future<T>& that);
   void cleanup();
 
+  // Returns true if the future is no longer pending, in which case
+  // its state (and value or failure message) never changes again so
+  // it can be read without acquiring the lock.
+  bool completed() const;
+
+  // Invokes (and then clears) the callbacks for the current state.
+  void run();
+
   enum State {
     PENDING,
     READY,
@@ -98,16 +117,28 @@ private:
     DISCARDED,
   };
 
-  int* refs;
-  int* lock;
-  State* state;
-  T** t;
-  std::string** message; // Message associated with failure.
-  std::queue<ReadyCallback>* onReadyCallbacks;
-  std::queue<FailedCallback>* onFailedCallbacks;
-  std::queue<DiscardedCallback>* onDiscardedCallbacks;
-  std::queue<AnyCallback>* onAnyCallbacks;
-  Latch* latch;
+  // All the state of a future is shared by all of its copies and
+  // allocated at once. Note that we don't allocate a latch until
+  // someone waits on a pending future (which most never do) since a
+  // latch is a process.
+  struct Data
+  {
+    Data();
+    ~Data();
+
+    int refs;
+    int lock;
+    volatile State state;
+    T* t;
+    std::string* message; // Message associated with failure.
+    std::vector<ReadyCallback> onReadyCallbacks;
+    std::vector<FailedCallback> onFailedCallbacks;
+    std::vector<DiscardedCallback> onDiscardedCallbacks;
+    std::vector<AnyCallback> onAnyCallbacks;
+    Latch* latch;
+  };
+
+  Data* data;
 };
 
 
@@ -249,32 +280,103 @@ void discard(const std::set<Future<T> >& futures)
 }
 
 
+namespace internal {
+
+template <typename T>
+struct Collect
+{
+  Collect(const std::list<Future<T> >& _futures)
+    : futures(_futures), ready(0) {}
+
+  const std::list<Future<T> > futures;
+  Promise<std::list<T> > promise;
+  int ready;
+};
+
+
+template <typename T>
+void collect(
+    const Future<T>& future,
+    std::tr1::shared_ptr<Collect<T> > collect)
+{
+  if (future.isFailed()) {
+    collect->promise.fail(future.failure());
+  } else if (future.isDiscarded()) {
+    Future<std::list<T> > result = collect->promise.future();
+    result.discard();
+  } else if (__sync_add_and_fetch(&collect->ready, 1) ==
+             (int) collect->futures.size()) {
+    std::list<T> values;
+    typename std::list<Future<T> >::const_iterator iterator;
+    for (iterator = collect->futures.begin();
+         iterator != collect->futures.end();
+         ++iterator) {
+      values.push_back((*iterator).get());
+    }
+    collect->promise.set(values);
+  }
+}
+
+} // namespace internal {
+
+
+// Returns a future for the values of all the futures in the list (in
+// the same order) once they are all ready. The returned future fails
+// (or gets discarded) as soon as any of the futures fails (or gets
+// discarded).
+template <typename T>
+Future<std::list<T> > collect(const std::list<Future<T> >& futures)
+{
+  if (futures.empty()) {
+    return Future<std::list<T> >(std::list<T>());
+  }
+
+  std::tr1::shared_ptr<internal::Collect<T> > collect(
+      new internal::Collect<T>(futures));
+
+  Future<std::list<T> > future = collect->promise.future();
+
+  std::tr1::function<void(const Future<T>&)> callback =
+    std::tr1::bind(&internal::collect<T>,
+                   std::tr1::placeholders::_1,
+                   collect);
+
+  typename std::list<Future<T> >::const_iterator iterator;
+  for (iterator = futures.begin(); iterator != futures.end(); ++iterator) {
+    (*iterator).onAny(callback);
+  }
+
+  return future;
+}
+
+
+template <typename T>
+Future<T>::Data::Data()
+  : refs(1),
+    lock(0),
+    state(PENDING),
+    t(NULL),
+    message(NULL),
+    latch(NULL) {}
+
+
+template <typename T>
+Future<T>::Data::~Data()
+{
+  delete t;
+  delete message;
+  delete latch;
+}
+
+
 template <typename T>
 Future<T>::Future()
-  : refs(new int(1)),
-    lock(new int(0)),
-    state(new State(PENDING)),
-    t(new T*(NULL)),
-    message(new std::string*(NULL)),
-    onReadyCallbacks(new std::queue<ReadyCallback>()),
-    onFailedCallbacks(new std::queue<FailedCallback>()),
-    onDiscardedCallbacks(new std::queue<DiscardedCallback>()),
-    onAnyCallbacks(new std::queue<AnyCallback>()),
-    latch(new Latch()) {}
+  : data(new Data()) {}
 
 
 template <typename T>
 Future<T>::Future(const T& _t)
-  : refs(new int(1)),
-    lock(new int(0)),
-    state(new State(PENDING)),
-    t(new T*(NULL)),
-    message(new std::string*(NULL)),
-    onReadyCallbacks(new std::queue<ReadyCallback>()),
-    onFailedCallbacks(new std::queue<FailedCallback>()),
-    onDiscardedCallbacks(new std::queue<DiscardedCallback>()),
-    onAnyCallbacks(new std::queue<AnyCallback>()),
-    latch(new Latch())
+  : data(new Data())
 {
   set(_t);
 }
@@ -308,18 +410,18 @@ Future<T>& Future<T>::operator = (const Future<T>& that)
 template <typename T>
 bool Future<T>::operator == (const Future<T>& that) const
 {
-  assert(latch != NULL);
-  assert(that.latch != NULL);
-  return *latch == *that.latch;
+  assert(data != NULL);
+  assert(that.data != NULL);
+  return data == that.data;
 }
 
 
 template <typename T>
 bool Future<T>::operator < (const Future<T>& that) const
 {
-  assert(latch != NULL);
-  assert(that.latch != NULL);
-  return *latch < *that.latch;
+  assert(data != NULL);
+  assert(that.data != NULL);
+  return data < that.data;
 }
 
 
@@ -328,33 +430,25 @@ bool Future<T>::discard()
 {
   bool result = false;
 
-  assert(lock != NULL);
-  internal::acquire(lock);
+  assert(data != NULL);
+  internal::acquire(&data->lock);
   {
-    assert(state != NULL);
-    if (*state == PENDING) {
-      *state = DISCARDED;
-      latch->trigger();
+    if (data->state == PENDING) {
+      data->state = DISCARDED;
+      if (data->latch != NULL) {
+        data->latch->trigger();
+      }
       result = true;
     }
   }
-  internal::release(lock);
+  internal::release(&data->lock);
 
   // Invoke all callbacks associated with this future being
   // DISCARDED. We don't need a lock because the state is now in
   // DISCARDED so there should not be any concurrent modications.
   if (result) {
-    while (!onDiscardedCallbacks->empty()) {
-      // TODO(*): Invoke callbacks in another execution context.
-      onDiscardedCallbacks->front()();
-      onDiscardedCallbacks->pop();
-    }
-
-    while (!onAnyCallbacks->empty()) {
-      // TODO(*): Invoke callbacks in another execution context.
-      onAnyCallbacks->front()(*this);
-      onAnyCallbacks->pop();
-    }
+    Future<T> future = *this; // Keep alive in case a callback doesn't.
+    future.run();
   }
 
   return result;
@@ -364,42 +458,61 @@ bool Future<T>::discard()
 template <typename T>
 bool Future<T>::isPending() const
 {
-  assert(state != NULL);
-  return *state == PENDING;
+  assert(data != NULL);
+  return data->state == PENDING;
 }
 
 
 template <typename T>
 bool Future<T>::isReady() const
 {
-  assert(state != NULL);
-  return *state == READY;
+  assert(data != NULL);
+  return data->state == READY;
 }
 
 
 template <typename T>
 bool Future<T>::isDiscarded() const
 {
-  assert(state != NULL);
-  return *state == DISCARDED;
+  assert(data != NULL);
+  return data->state == DISCARDED;
 }
 
 
 template <typename T>
 bool Future<T>::isFailed() const
 {
-  assert(state != NULL);
-  return *state == FAILED;
+  assert(data != NULL);
+  return data->state == FAILED;
 }
 
 
 template <typename T>
 bool Future<T>::await(double secs) const
 {
-  if (!isReady() && !isDiscarded() && !isFailed()) {
-    assert(latch != NULL);
-    return latch->await(secs);
+  if (completed()) {
+    return true;
+  }
+
+  // Create the latch outside of the lock since creating a latch
+  // spawns a process (and only keep it if no one else beat us to it).
+  Latch* latch = new Latch();
+
+  internal::acquire(&data->lock);
+  {
+    if (data->state == PENDING && data->latch == NULL) {
+      data->latch = latch;
+      latch = NULL;
+    }
   }
+  internal::release(&data->lock);
+
+  delete latch;
+
+  if (!completed()) {
+    return data->latch->await(secs);
+  }
+
   return true;
 }
 
@@ -415,18 +528,17 @@ T Future<T>::get() const
     abort();
   }
 
-  assert(t != NULL);
-  assert(*t != NULL);
-  return **t;
+  assert(data->t != NULL);
+  return *data->t;
 }
 
 
 template <typename T>
 std::string Future<T>::failure() const
 {
-  assert(message != NULL);
-  if (*message != NULL) {
-    return **message;
+  assert(data != NULL);
+  if (completed() && data->message != NULL) {
+    return *data->message;
   }
 
   return "";
@@ -438,21 +550,23 @@ const Future<T>& Future<T>::onReady(const ReadyCallback& callback) const
 {
   bool run = false;
 
-  assert(lock != NULL);
-  internal::acquire(lock);
-  {
-    assert(state != NULL);
-    if (*state == READY) {
-      run = true;
-    } else if (*state == PENDING) {
-      onReadyCallbacks->push(callback);
+  if (completed()) {
+    run = data->state == READY;
+  } else {
+    internal::acquire(&data->lock);
+    {
+      if (data->state == READY) {
+        run = true;
+      } else if (data->state == PENDING) {
+        data->onReadyCallbacks.push_back(callback);
+      }
     }
+    internal::release(&data->lock);
   }
-  internal::release(lock);
 
   // TODO(*): Invoke callback in another execution context.
   if (run) {
-    callback(**t);
+    callback(*data->t);
   }
 
   return *this;
@@ -464,21 +578,23 @@ const Future<T>& Future<T>::onFailed(const FailedCallback& callback) const
 {
   bool run = false;
 
-  assert(lock != NULL);
-  internal::acquire(lock);
-  {
-    assert(state != NULL);
-    if (*state == FAILED) {
-      run = true;
-    } else if (*state == PENDING) {
-      onFailedCallbacks->push(callback);
+  if (completed()) {
+    run = data->state == FAILED;
+  } else {
+    internal::acquire(&data->lock);
+    {
+      if (data->state == FAILED) {
+        run = true;
+      } else if (data->state == PENDING) {
+        data->onFailedCallbacks.push_back(callback);
+      }
     }
+    internal::release(&data->lock);
   }
-  internal::release(lock);
 
   // TODO(*): Invoke callback in another execution context.
   if (run) {
-    callback(**message);
+    callback(*data->message);
   }
 
   return *this;
@@ -491,17 +607,19 @@ const Future<T>& Future<T>::onDiscarded(
 {
   bool run = false;
 
-  assert(lock != NULL);
-  internal::acquire(lock);
-  {
-    assert(state != NULL);
-    if (*state == DISCARDED) {
-      run = true;
-    } else if (*state == PENDING) {
-      onDiscardedCallbacks->push(callback);
+  if (completed()) {
+    run = data->state == DISCARDED;
+  } else {
+    internal::acquire(&data->lock);
+    {
+      if (data->state == DISCARDED) {
+        run = true;
+      } else if (data->state == PENDING) {
+        data->onDiscardedCallbacks.push_back(callback);
+      }
     }
+    internal::release(&data->lock);
   }
-  internal::release(lock);
 
   // TODO(*): Invoke callback in another execution context.
   if (run) {
@@ -517,17 +635,19 @@ const Future<T>& Future<T>::onAny(const AnyCallback& callback) const
 {
   bool run = false;
 
-  assert(lock != NULL);
-  internal::acquire(lock);
-  {
-    assert(state != NULL);
-    if (*state != PENDING) {
-      run = true;
-    } else if (*state == PENDING) {
-      onAnyCallbacks->push(callback);
+  if (completed()) {
+    run = true;
+  } else {
+    internal::acquire(&data->lock);
+    {
+      if (data->state != PENDING) {
+        run = true;
+      } else {
+        data->onAnyCallbacks.push_back(callback);
+      }
     }
+    internal::release(&data->lock);
   }
-  internal::release(lock);
 
   // TODO(*): Invoke callback in another execution context.
   if (run) {
@@ -538,39 +658,121 @@ const Future<T>& Future<T>::onAny(const AnyCallback& callback) const
 }
 
 
+namespace internal {
+
+template <typename X>
+void chain(std::tr1::shared_ptr<Promise<X> > promise, const Future<X>& future)
+{
+  if (future.isReady()) {
+    promise->set(future.get());
+  } else if (future.isFailed()) {
+    promise->fail(future.failure());
+  } else if (future.isDiscarded()) {
+    Future<X> result = promise->future();
+    result.discard();
+  }
+}
+
+
+template <typename T, typename X>
+void then(
+    const std::tr1::function<Future<X>(const T&)>& f,
+    std::tr1::shared_ptr<Promise<X> > promise,
+    const Future<T>& future)
+{
+  if (future.isReady()) {
+    f(future.get())
+      .onAny(std::tr1::bind(&chain<X>, promise, std::tr1::placeholders::_1));
+  } else if (future.isFailed()) {
+    promise->fail(future.failure());
+  } else if (future.isDiscarded()) {
+    Future<X> result = promise->future();
+    result.discard();
+  }
+}
+
+
+template <typename T, typename X>
+void then(
+    const std::tr1::function<X(const T&)>& f,
+    std::tr1::shared_ptr<Promise<X> > promise,
+    const Future<T>& future)
+{
+  if (future.isReady()) {
+    promise->set(f(future.get()));
+  } else if (future.isFailed()) {
+    promise->fail(future.failure());
+  } else if (future.isDiscarded()) {
+    Future<X> result = promise->future();
+    result.discard();
+  }
+}
+
+} // namespace internal {
+
+
+template <typename T>
+template <typename X>
+Future<X> Future<T>::then(
+    const std::tr1::function<Future<X>(const T&)>& f) const
+{
+  std::tr1::shared_ptr<Promise<X> > promise(new Promise<X>());
+
+  Future<X> future = promise->future();
+
+  void (*handler)(const std::tr1::function<Future<X>(const T&)>&,
+                  std::tr1::shared_ptr<Promise<X> >,
+                  const Future<T>&) = &internal::then<T, X>;
+
+  onAny(std::tr1::bind(handler, f, promise, std::tr1::placeholders::_1));
+
+  return future;
+}
+
+
+template <typename T>
+template <typename X>
+Future<X> Future<T>::then(const std::tr1::function<X(const T&)>& f) const
+{
+  std::tr1::shared_ptr<Promise<X> > promise(new Promise<X>());
+
+  Future<X> future = promise->future();
+
+  void (*handler)(const std::tr1::function<X(const T&)>&,
+                  std::tr1::shared_ptr<Promise<X> >,
+                  const Future<T>&) = &internal::then<T, X>;
+
+  onAny(std::tr1::bind(handler, f, promise, std::tr1::placeholders::_1));
+
+  return future;
+}
+
+
 template <typename T>
 bool Future<T>::set(const T& _t)
 {
   bool result = false;
 
-  assert(lock != NULL);
-  internal::acquire(lock);
+  assert(data != NULL);
+  internal::acquire(&data->lock);
   {
-    assert(state != NULL);
-    if (*state == PENDING) {
-      *t = new T(_t);
-      *state = READY;
-      latch->trigger();
+    if (data->state == PENDING) {
+      data->t = new T(_t);
+      data->state = READY;
+      if (data->latch != NULL) {
+        data->latch->trigger();
+      }
       result = true;
     }
   }
-  internal::release(lock);
+  internal::release(&data->lock);
 
   // Invoke all callbacks associated with this future being READY. We
   // don't need a lock because the state is now in READY so there
   // should not be any concurrent modications.
   if (result) {
-    while (!onReadyCallbacks->empty()) {
-      // TODO(*): Invoke callbacks in another execution context.
-      onReadyCallbacks->front()(**t);
-      onReadyCallbacks->pop();
-    }
-
-    while (!onAnyCallbacks->empty()) {
-      // TODO(*): Invoke callbacks in another execution context.
-      onAnyCallbacks->front()(*this);
-      onAnyCallbacks->pop();
-    }
+    Future<T> future = *this; // Keep alive in case a callback doesn't.
+    future.run();
   }
 
   return result;
@@ -582,112 +784,106 @@ bool Future<T>::fail(const std::string& _message)
 {
   bool result = false;
 
-  assert(lock != NULL);
-  internal::acquire(lock);
+  assert(data != NULL);
+  internal::acquire(&data->lock);
   {
-    assert(state != NULL);
-    if (*state == PENDING) {
-      *message = new std::string(_message);
-      *state = FAILED;
-      latch->trigger();
+    if (data->state == PENDING) {
+      data->message = new std::string(_message);
+      data->state = FAILED;
+      if (data->latch != NULL) {
+        data->latch->trigger();
+      }
       result = true;
     }
   }
-  internal::release(lock);
+  internal::release(&data->lock);
 
   // Invoke all callbacks associated with this future being FAILED. We
   // don't need a lock because the state is now in FAILED so there
   // should not be any concurrent modications.
   if (result) {
-    while (!onFailedCallbacks->empty()) {
-      // TODO(*): Invoke callbacks in another execution context.
-      onFailedCallbacks->front()(**message);
-      onFailedCallbacks->pop();
-    }
+    Future<T> future = *this; // Keep alive in case a callback doesn't.
+    future.run();
+  }
+
+  return result;
+}
+
 
-    while (!onAnyCallbacks->empty()) {
-      // TODO(*): Invoke callbacks in another execution context.
-      onAnyCallbacks->front()(*this);
-      onAnyCallbacks->pop();
+template <typename T>
+bool Future<T>::completed() const
+{
+  assert(data != NULL);
+  State state = data->state;
+  __sync_synchronize(); // Don't read anything else before the state.
+  return state != PENDING;
+}
+
+
+template <typename T>
+void Future<T>::run()
+{
+  // TODO(*): Invoke callbacks in another execution context.
+  if (data->state == READY) {
+    for (size_t i = 0; i < data->onReadyCallbacks.size(); i++) {
+      data->onReadyCallbacks[i](*data->t);
+    }
+  } else if (data->state == FAILED) {
+    for (size_t i = 0; i < data->onFailedCallbacks.size(); i++) {
+      data->onFailedCallbacks[i](*data->message);
+    }
+  } else if (data->state == DISCARDED) {
+    for (size_t i = 0; i < data->onDiscardedCallbacks.size(); i++) {
+      data->onDiscardedCallbacks[i]();
     }
   }
 
-  return result;
+  for (size_t i = 0; i < data->onAnyCallbacks.size(); i++) {
+    data->onAnyCallbacks[i](*this);
+  }
+
+  // Release the callbacks (and anything they've bound).
+  std::vector<ReadyCallback>().swap(data->onReadyCallbacks);
+  std::vector<FailedCallback>().swap(data->onFailedCallbacks);
+  std::vector<DiscardedCallback>().swap(data->onDiscardedCallbacks);
+  std::vector<AnyCallback>().swap(data->onAnyCallbacks);
 }
 
 
 template <typename T>
 void Future<T>::copy(const Future<T>& that)
 {
-  assert(that.refs > 0);
-  __sync_fetch_and_add(that.refs, 1);
-  refs = that.refs;
-  lock = that.lock;
-  state = that.state;
-  t = that.t;
-  message = that.message;
-  onReadyCallbacks = that.onReadyCallbacks;
-  onFailedCallbacks = that.onFailedCallbacks;
-  onDiscardedCallbacks = that.onDiscardedCallbacks;
-  onAnyCallbacks = that.onAnyCallbacks;
-  latch = that.latch;
+  assert(that.data != NULL);
+  assert(that.data->refs > 0);
+  __sync_fetch_and_add(&that.data->refs, 1);
+  data = that.data;
 }
 
 
 template <typename T>
 void Future<T>::cleanup()
 {
-  assert(refs != NULL);
-  if (__sync_sub_and_fetch(refs, 1) == 0) {
+  assert(data != NULL);
+  if (__sync_sub_and_fetch(&data->refs, 1) == 0) {
     // Discard the future if it is still pending (so we invoke any
     // discarded callbacks that have been setup). Note that we put the
     // reference count back at 1 here in case one of the callbacks
     // decides it wants to keep a reference.
-    assert(state != NULL);
-    if (*state == PENDING) {
-      *refs = 1;
+    if (data->state == PENDING) {
+      data->refs = 1;
       discard();
-    }
 
-    // Now try and cleanup again (this time we know the future has
-    // either been discarded or was not pending). Note that one of the
-    // callbacks might have stored the future, in which case we'll
-    // just return without doing anything, but the state will forever
-    // be "discarded".
-    assert(refs != NULL);
-    if (__sync_sub_and_fetch(refs, 1) == 0) {
-      delete refs;
-      refs = NULL;
-      assert(lock != NULL);
-      delete lock;
-      lock = NULL;
-      assert(state != NULL);
-      delete state;
-      state = NULL;
-      assert(t != NULL);
-      delete *t;
-      delete t;
-      t = NULL;
-      assert(message != NULL);
-      delete *message;
-      delete message;
-      message = NULL;
-      assert(onReadyCallbacks != NULL);
-      delete onReadyCallbacks;
-      onReadyCallbacks = NULL;
-      assert(onFailedCallbacks != NULL);
-      delete onFailedCallbacks;
-      onFailedCallbacks = NULL;
-      assert(onDiscardedCallbacks != NULL);
-      delete onDiscardedCallbacks;
-      onDiscardedCallbacks = NULL;
-      assert(onAnyCallbacks != NULL);
-      delete onAnyCallbacks;
-      onAnyCallbacks = NULL;
-      assert(latch != NULL);
-      delete latch;
-      latch = NULL;
+      // Now try and cleanup again (this time we know the future has
+      // been discarded). Note that one of the callbacks might have
+      // stored the future, in which case we'll just return without
+      // doing anything, but the state will forever be "discarded".
+      if (__sync_sub_and_fetch(&data->refs, 1) != 0) {
+        return;
+      }
     }
+
+    delete data;
+    data = NULL;
   }
 }
 
@@ -1,10 +1,60 @@
 #ifndef __PROCESS_HTTP_HPP__
 #define __PROCESS_HTTP_HPP__
 
+#include <pthread.h>
+
+#include <sys/types.h>
+
+#include <map>
 #include <string>
 
+#include <tr1/memory>
+
+#include <process/pid.hpp>
+
 namespace process {
 
+// Forward declaration (see process.cpp).
+class HttpProxy;
+
+// The body of a response that gets written incrementally, possibly
+// after the response has been returned (e.g., by another process or
+// thread), and sent to the client as it's written (using chunked
+// transfer encoding). Safe to use from multiple threads.
+class HttpStream
+{
+public:
+  HttpStream();
+  ~HttpStream();
+
+  // Appends to the body. Returns false (and drops the data) once the
+  // stream has been closed or the client has gone away, so writers
+  // know when they can stop.
+  bool write(const std::string& data);
+
+  // Ends the body.
+  void close();
+
+private:
+  friend class HttpProxy;
+
+  // Takes what has been written so far, returning whether the stream
+  // has been closed (i.e., that was the last of it). Later writes
+  // (and closing) get the proxy to read again (see HttpProxy::flush).
+  bool read(std::string* data, const PID<HttpProxy>& proxy);
+
+  // Makes writes fail from now on (the client has gone away).
+  void abandon();
+
+  pthread_mutex_t mutex;
+  std::string buffer;
+  bool closed;
+  bool abandoned;
+  PID<HttpProxy> proxy; // To notify about writes once set.
+  bool notified; // Whether the proxy has yet to read the last writes.
+};
+
+
 struct HttpRequest
 {
   // TODO(benh): Add major/minor version.
@@ -21,13 +71,24 @@ struct HttpRequest
 
 struct HttpResponse
 {
+  HttpResponse() : offset(0), length(0) {}
+
   // TODO(benh): Add major/minor version.
   std::string status;
   std::map<std::string, std::string> headers;
-  // TODO(benh): Make body a stream (channel) instead, and allow a
-  // response to be returned without forcing the stream to be
-  // finished.
   std::string body;
+
+  // If set the body gets streamed from here instead (see HttpStream).
+  std::tr1::shared_ptr<HttpStream> stream;
+
+  // If set the body is instead (up to) 'length' bytes of the file at
+  // 'path' starting at 'offset' (or the rest of the file if 'length'
+  // is 0), sent straight from the file (with sendfile where
+  // available) so that it never gets read into memory. Files that
+  // can't be opened get a "404 Not Found" instead.
+  std::string path;
+  off_t offset;
+  size_t length;
 };
 
 
@@ -40,6 +101,17 @@ struct HttpOKResponse : HttpResponse
 };
 
 
+// Sent instead of a response that has an "ETag" header matching the
+// request's "If-None-Match" header (see HttpProxy::ready).
+struct HttpNotModifiedResponse : HttpResponse
+{
+  HttpNotModifiedResponse()
+  {
+    status = "304 Not Modified";
+  }
+};
+
+
 struct HttpBadRequestResponse : HttpResponse
 {
   HttpBadRequestResponse()
@@ -3,16 +3,65 @@
 
 #include <string>
 
+#include <tr1/memory>
+
 #include <process/pid.hpp>
 
 namespace process {
 
 struct Message
 {
+  // Provides the body of a message on demand (see 'payload' below).
+  struct Payload
+  {
+    virtual ~Payload() {}
+    virtual void serialize(std::string* data) const = 0;
+
+    // Returns the serialization if the payload is one already (which
+    // then gets sent as is rather than copied into each message's
+    // body, see 'data' below).
+    virtual const std::string* serialized() const { return NULL; }
+  };
+
+  // A payload that's serialized already, e.g., so that it can be
+  // shared by the messages of a multicast (see process::post).
+  struct SerializedPayload : Payload
+  {
+    virtual void serialize(std::string* _data) const { *_data = data; }
+    virtual const std::string* serialized() const { return &data; }
+
+    std::string data;
+  };
+
   std::string name;
   UPID from;
   UPID to;
   std::string body;
+
+  // A message sent to a process within the same OS process may carry
+  // the (immutable) object that the body would be a serialization of
+  // rather than the body itself, in which case the body stays empty
+  // until someone that needs it calls 'serialize' (e.g., to forward
+  // the message to a remote process). See ProtobufProcess::send.
+  std::tr1::shared_ptr<Payload> payload;
+
+  void serialize()
+  {
+    if (payload && body.empty()) {
+      payload->serialize(&body);
+    }
+  }
+
+  // Returns the body to send, serializing the payload into the body
+  // only if the payload isn't serialized already.
+  const std::string& data()
+  {
+    if (payload && body.empty() && payload->serialized() != NULL) {
+      return *payload->serialized();
+    }
+    serialize();
+    return body;
+  }
 };
 
 } // namespace process {
@@ -0,0 +1,192 @@
+#ifndef __PROCESS_METRICS_HPP__
+#define __PROCESS_METRICS_HPP__
+
+#include <stdint.h>
+
+#include <string>
+
+#include <process/statistics.hpp>
+
+namespace process {
+namespace metrics {
+
+// Process-wide metrics (counters, gauges and histograms of durations)
+// that can be updated from any thread without dispatching or taking
+// any locks: every metric is split into SHARDS cache line sized
+// shards, each thread updates "its" shard with atomic instructions,
+// and reading a metric sums up the shards. The metrics register
+// themselves (by name) when constructed and unregister when
+// destroyed. Metrics with the same name (and labels) are summed up
+// when exported, so that, e.g., every master in a process can keep
+// its own counters while the process exports their totals.
+//
+// All the metrics get exported in the Prometheus text format at
+// /metrics (see metrics::text).
+
+static const int SHARDS = 16;
+
+// Returns the shard of the calling thread (assigned round robin when
+// a thread first updates a metric).
+int shard();
+
+
+// Returns 'key="value"', escaped as a label of a metric.
+std::string label(const std::string& key, const std::string& value);
+
+
+// Returns all the metrics registered in the Prometheus text format.
+std::string text();
+
+
+class Metric
+{
+public:
+  // The 'name' must be a valid Prometheus metric name, the 'labels'
+  // (if any) a comma separated list of labels (see metrics::label).
+  Metric(const std::string& name,
+         const std::string& help,
+         const std::string& labels);
+
+  virtual ~Metric();
+
+  const std::string name;
+  const std::string help;
+  const std::string labels;
+
+protected:
+  friend std::string text();
+
+  // Adds the metric's values into 'values' (which has as many values
+  // as there are in the samples of the metric, see samples below).
+  virtual void collect(double* values) const = 0;
+
+  // Returns the type of the metric ("counter", "gauge", ...).
+  virtual std::string type() const = 0;
+
+  // Returns the number of samples of the metric and the suffix and
+  // extra label (if any) of the sample 'i'.
+  virtual int samples() const { return 1; }
+  virtual std::string suffix(int) const { return ""; }
+  virtual std::string extra(int) const { return ""; }
+
+  // Registers (unregisters) the metric; invoked by the constructor
+  // (destructor) of the actual metric, so that the metric never gets
+  // exported while it is only partially constructed (destroyed).
+  void add();
+  void remove();
+
+private:
+  // Not copyable, not assignable.
+  Metric(const Metric&);
+  Metric& operator = (const Metric&);
+
+  bool added;
+};
+
+
+// A monotonically increasing count (e.g., of messages received).
+class Counter : public Metric
+{
+public:
+  Counter(const std::string& name,
+          const std::string& help,
+          const std::string& labels = "");
+
+  virtual ~Counter() { remove(); }
+
+  void increment(uint64_t n = 1)
+  {
+    __sync_fetch_and_add(&shards[shard()].value, n);
+  }
+
+  uint64_t value() const;
+
+protected:
+  virtual void collect(double* values) const;
+  virtual std::string type() const { return "counter"; }
+
+private:
+  struct Shard
+  {
+    uint64_t value;
+    char pad[64 - sizeof(uint64_t)];
+  } shards[SHARDS];
+};
+
+
+// A value that goes up and down (e.g., the number of tasks running).
+class Gauge : public Metric
+{
+public:
+  Gauge(const std::string& name,
+        const std::string& help,
+        const std::string& labels = "");
+
+  virtual ~Gauge() { remove(); }
+
+  void increment(int64_t n = 1)
+  {
+    __sync_fetch_and_add(&shards[shard()].value, n);
+  }
+
+  void decrement(int64_t n = 1)
+  {
+    __sync_fetch_and_sub(&shards[shard()].value, n);
+  }
+
+  // N.B. Setting a gauge is not atomic with respect to incrementing
+  // or decrementing it concurrently, use one or the other.
+  void set(int64_t value);
+
+  int64_t value() const;
+
+protected:
+  virtual void collect(double* values) const;
+  virtual std::string type() const { return "gauge"; }
+
+private:
+  struct Shard
+  {
+    int64_t value;
+    char pad[64 - sizeof(int64_t)];
+  } shards[SHARDS];
+};
+
+
+// Durations (e.g., latencies), counted in the same power of two
+// microsecond buckets as process::Histogram (which 'snapshot' returns
+// the durations in) and exported as a Prometheus histogram.
+class Timer : public Metric
+{
+public:
+  Timer(const std::string& name,
+        const std::string& help,
+        const std::string& labels = "");
+
+  virtual ~Timer() { remove(); }
+
+  void record(double secs);
+
+  process::Histogram snapshot() const;
+
+protected:
+  virtual void collect(double* values) const;
+  virtual std::string type() const { return "histogram"; }
+  virtual int samples() const { return process::Histogram::BUCKETS + 2; }
+  virtual std::string suffix(int i) const;
+  virtual std::string extra(int i) const;
+
+private:
+  struct Shard
+  {
+    uint64_t counts[process::Histogram::BUCKETS];
+    uint64_t total; // Microseconds.
+    uint64_t max; // Microseconds.
+    char pad[64 - (sizeof(uint64_t) * (process::Histogram::BUCKETS + 2)) % 64];
+  } shards[SHARDS];
+};
+
+} // namespace metrics {
+} // namespace process {
+
+#endif // __PROCESS_METRICS_HPP__
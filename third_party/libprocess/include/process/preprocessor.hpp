@@ -9,6 +9,7 @@
 
 #include <boost/preprocessor/repetition/enum_params.hpp>
 #include <boost/preprocessor/repetition/enum_binary_params.hpp>
+#include <boost/preprocessor/repetition/enum_trailing_binary_params.hpp>
 #include <boost/preprocessor/repetition/enum_trailing_params.hpp>
 #include <boost/preprocessor/repetition/repeat.hpp>
 #include <boost/preprocessor/repetition/repeat_from_to.hpp>
@@ -22,6 +23,7 @@
 #define INTERCEPT BOOST_PP_INTERCEPT
 #define ENUM_PARAMS BOOST_PP_ENUM_PARAMS
 #define ENUM_BINARY_PARAMS BOOST_PP_ENUM_BINARY_PARAMS
+#define ENUM_TRAILING_BINARY_PARAMS BOOST_PP_ENUM_TRAILING_BINARY_PARAMS
 #define ENUM_TRAILING_PARAMS BOOST_PP_ENUM_TRAILING_PARAMS
 #define REPEAT BOOST_PP_REPEAT
 #define REPEAT_FROM_TO BOOST_PP_REPEAT_FROM_TO
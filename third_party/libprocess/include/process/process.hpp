@@ -6,6 +6,8 @@
 
 #include <map>
 #include <queue>
+#include <set>
+#include <vector>
 
 #include <tr1/functional>
 
@@ -18,6 +20,10 @@
 
 namespace process {
 
+// Forward declaration.
+class RunQueue;
+
+
 class ProcessBase : public EventVisitor
 {
 public:
@@ -67,6 +73,13 @@ protected:
       const char* data = NULL,
       size_t length = 0);
 
+  // Sends a message with a payload rather than data to PID, which
+  // only gets serialized if PID is remote (see Message::payload).
+  void send(
+      const UPID& to,
+      const std::string& name,
+      const std::tr1::shared_ptr<Message::Payload>& payload);
+
   // Links with the specified PID. Linking with a process from within
   // the same "operating system process" is gauranteed to give you
   // perfect monitoring of that process. However, linking with a
@@ -113,6 +126,36 @@ protected:
     delegates[name] = pid;
   }
 
+  // Sets the maximum number of events serviced each time this process
+  // gets run before it yields to other runnable processes (0 means
+  // service events until there are none left). Larger batches are
+  // cheaper per event but let a busy process hog a processing thread.
+  void batch(size_t size)
+  {
+    events_per_batch = size;
+  }
+
+  // Bounds the mailbox of this process (0, the default, means no
+  // bound) so that it can't grow without limit when events arrive
+  // faster than the process can service them. HTTP requests, which
+  // are the least important, get rejected (with a 503) once the
+  // mailbox holds half of 'size' events, and messages that were
+  // marked as droppable (see droppable) get dropped once it holds
+  // 'size' events. All other events (e.g., dispatches and other
+  // messages) are always enqueued.
+  void limit(size_t size)
+  {
+    mailbox_limit = size;
+  }
+
+  // Marks messages with the specified name as safe to drop when the
+  // mailbox is full (e.g., because the sender retries them). Must
+  // be invoked before the process is spawned.
+  void droppable(const std::string& name)
+  {
+    droppables.insert(name);
+  }
+
   // The default visit implementation for HTTP events invokes
   // installed HTTP handlers. A HTTP handler is any function which
   // takes an HttpRequest object and returns and HttpResponse.
@@ -152,17 +195,71 @@ private:
          READY,
 	 RUNNING,
          BLOCKED,
-	 FINISHED } state;
+	 FINISHED };
+
+  // Current state. Enqueuers only ever transition a BLOCKED process
+  // to READY (atomically, see ProcessBase::enqueue), all other
+  // transitions are made by the thread running the process.
+  volatile int state;
 
   // Mutex protecting internals. TODO(benh): Replace with a spinlock.
   pthread_mutex_t m;
   void lock() { pthread_mutex_lock(&m); }
   void unlock() { pthread_mutex_unlock(&m); }
 
+  // Run queue of the processing thread this process last ran on (or
+  // was last queued for), used to resume a process on the same thread
+  // when possible. NULL means not yet scheduled. For processes with a
+  // dedicated thread (see dedicate) this never changes.
+  RunQueue* runq;
+
+  // Whether or not this process is currently sitting in a run queue
+  // and since when (only read/written while holding that run queue's
+  // lock), for measuring how long processes wait to run.
+  bool queued;
+  double queued_at;
+
   // Enqueue the specified message, request, or function call.
   void enqueue(Event* event, bool inject = false);
 
-  // Queue of received events.
+  // Dequeue the next event (or NULL if there are none). Only the
+  // thread running the process may dequeue.
+  Event* dequeue();
+
+  // Whether or not there are any events left to dequeue.
+  bool pending() const;
+
+  // Maximum number of events to service per run (see batch).
+  size_t events_per_batch;
+
+  // Statistics served at /__processes__ (see ProcessesProcess): the
+  // number of events waiting in the mailbox (and the most there have
+  // ever been), the number of events serviced and the (wall clock)
+  // time spent servicing them. Enqueuers update the mailbox counts
+  // atomically, the rest are only updated by the thread running the
+  // process.
+  volatile int64_t mailbox_depth;
+  volatile int64_t mailbox_max;
+  uint64_t events_serviced;
+  double running_time;
+
+  // Bound on the mailbox (see limit) and the names of the messages
+  // that can get dropped when it's reached (see droppable).
+  size_t mailbox_limit;
+  std::set<std::string> droppables;
+
+  // Returns whether or not an event of the specified kind should be
+  // rejected (or dropped) rather than enqueued (see limit).
+  bool overloaded(const HttpRequest& request) const;
+  bool overloaded(const Message& message) const;
+
+  // Received events are delivered via a lock-free multi-producer
+  // single-consumer mailbox: enqueuers push onto one of two intrusive
+  // stacks (most recent event first) and the thread running the
+  // process takes an entire stack at a time, moving it into 'events'
+  // (which only that thread accesses).
+  Event* volatile incoming;
+  Event* volatile injected;
   std::deque<Event*> events;
 
   // Delegates for messages.
@@ -227,6 +324,19 @@ PID<T> spawn(T& t, bool manage = false)
 }
 
 
+/**
+ * Give a process its own processing thread. The process will only be
+ * run by that thread and that thread will only run that process (it
+ * exits after the process does). This must be invoked before the
+ * process is spawned and is intended for long lived, performance
+ * critical processes whose latency shouldn't depend on how busy the
+ * shared processing threads are.
+ *
+ * @param process process to be given a dedicated thread
+ */
+void dedicate(ProcessBase* process);
+
+
 /**
  * Send a TERMINATE message to a process, injecting the message ahead
  * of all other messages queued up for that process if requested. Note
@@ -267,6 +377,39 @@ void post(const UPID& to,
           size_t length = 0);
 
 
+/**
+ * Sends a message with data on behalf of the specified sender, e.g.,
+ * for replaying captured messages.
+ *
+ * @param from return address of the message
+ * @param to receiver
+ * @param name message name
+ * @param data data to send (gets copied)
+ * @param length length of data
+ */
+void post(const UPID& from,
+          const UPID& to,
+          const std::string& name,
+          const char* data = NULL,
+          size_t length = 0);
+
+
+/**
+ * Sends the same message to each of the receivers (without a return
+ * address), sharing the payload between them: a payload that's
+ * serialized already (see Message::SerializedPayload) gets sent as
+ * is to each remote receiver rather than serialized (or copied) for
+ * each of them.
+ *
+ * @param to receivers
+ * @param name message name
+ * @param payload payload of the message
+ */
+void post(const std::vector<UPID>& to,
+          const std::string& name,
+          const std::tr1::shared_ptr<Message::Payload>& payload);
+
+
 // Inline implementations of above.
 inline void terminate(const ProcessBase& process, bool inject)
 {
@@ -10,10 +10,13 @@
 #include <vector>
 
 #include <tr1/functional>
+#include <tr1/memory>
 #include <tr1/unordered_map>
 
+#include <process/clock.hpp>
 #include <process/dispatch.hpp>
 #include <process/process.hpp>
+#include <process/statistics.hpp>
 
 
 // Provides an implementation of process::post that for a protobuf.
@@ -27,6 +30,40 @@ inline void post(const process::UPID& to,
   post(to, message.GetTypeName(), data.data(), data.size());
 }
 
+
+// Sends a protocol buffer to each of the receivers, serializing it
+// only once for all of them (see process::post).
+inline void post(const std::vector<process::UPID>& to,
+                 const google::protobuf::Message& message)
+{
+  Message::SerializedPayload* payload = new Message::SerializedPayload();
+  message.SerializeToString(&payload->data);
+  post(to,
+       message.GetTypeName(),
+       std::tr1::shared_ptr<Message::Payload>(payload));
+}
+
+
+// Payload of a protocol buffer message sent between processes within
+// the same OS process (see ProtobufProcess::send).
+struct ProtobufPayload : Message::Payload
+{
+  explicit ProtobufPayload(const google::protobuf::Message* _message)
+    : message(_message) {}
+
+  virtual ~ProtobufPayload()
+  {
+    delete message;
+  }
+
+  virtual void serialize(std::string* data) const
+  {
+    message->SerializeToString(data);
+  }
+
+  const google::protobuf::Message* const message;
+};
+
 } // namespace process {
 
 
@@ -67,16 +104,59 @@ class ProtobufProcess : public process::Process<T>
 {
 public:
   ProtobufProcess(const std::string& id = "")
-    : process::Process<T>(id) {}
+    : process::Process<T>(id), current(NULL) {}
 
   virtual ~ProtobufProcess() {}
 
+  typedef std::tr1::unordered_map<std::string, process::HandlerStatistics>
+    HandlerStatisticsMap;
+
+  // Returns statistics about the events handled so far, keyed by
+  // message name (dispatches, HTTP requests, etc, are each kept under
+  // a single name, e.g., "dispatch", see 'name').
+  const HandlerStatisticsMap& statistics() const
+  {
+    return handlerStatistics;
+  }
+
 protected:
+  virtual void serve(const process::Event& event)
+  {
+    // Note that processes are only ever run by one thread at a time,
+    // so the statistics can be updated without any synchronization.
+    double started = process::Clock::real();
+    process::Process<T>::serve(event);
+    double finished = process::Clock::real();
+
+    handlerStatistics[name(event)].record(
+        started - event.enqueued, finished - started);
+  }
+
   virtual void visit(const process::MessageEvent& event)
   {
     if (protobufHandlers.count(event.message->name) > 0) {
       from = event.message->from; // For 'reply'.
-      protobufHandlers[event.message->name](event.message->body);
+      const process::ProtobufPayload* payload =
+        dynamic_cast<const process::ProtobufPayload*>(
+            event.message->payload.get());
+      const google::protobuf::Message* message =
+        payload != NULL ? payload->message : NULL;
+      // Any other payload is serialized already (e.g., the message
+      // was multicast, see process::post), so parse it in place.
+      const std::string& body =
+        payload != NULL ? event.message->body : event.message->data();
+      if (message == NULL && messages.count(event.message->name) > 0) {
+        // Parse into the message we keep around for this type, which
+        // reuses the memory it allocated for previous messages
+        // (e.g., for repeated fields) rather than allocating anew.
+        google::protobuf::Message* reused =
+          messages[event.message->name].get();
+        reused->ParseFromString(body);
+        message = reused;
+      }
+      current = event.message; // For 'payload' and 'forward'.
+      protobufHandlers[event.message->name](body, message);
+      current = NULL;
       from = process::UPID();
     } else {
       process::Process<T>::visit(event);
@@ -86,6 +166,17 @@ protected:
   void send(const process::UPID& to,
             const google::protobuf::Message& message)
   {
+    // Processes within the same OS process get a copy of the message
+    // itself (which is cheaper than serializing and parsing it).
+    if (to.ip == this->self().ip && to.port == this->self().port) {
+      google::protobuf::Message* copy = message.New();
+      copy->CopyFrom(message);
+      std::tr1::shared_ptr<process::Message::Payload> payload(
+          new process::ProtobufPayload(copy));
+      process::Process<T>::send(to, message.GetTypeName(), payload);
+      return;
+    }
+
     std::string data;
     message.SerializeToString(&data);
     process::Process<T>::send(to, message.GetTypeName(),
@@ -97,11 +188,32 @@ protected:
   void reply(const google::protobuf::Message& message)
   {
     CHECK(from) << "Attempting to reply without a sender";
-    std::string data;
-    message.SerializeToString(&data);
     send(from, message);
   }
 
+  // Returns the payload of the message being handled (by a protobuf
+  // handler), i.e., the message as it was sent, so that it can be
+  // sent on later without encoding it again.
+  std::tr1::shared_ptr<process::Message::Payload> payload()
+  {
+    CHECK(current != NULL) << "Attempting to get a payload outside a handler";
+    if (!current->payload) {
+      process::Message::SerializedPayload* serialized =
+        new process::Message::SerializedPayload();
+      serialized->data = current->body;
+      current->payload.reset(serialized);
+    }
+    return current->payload;
+  }
+
+  // Sends the message being handled (by a protobuf handler) on to the
+  // specified process as is, i.e., without encoding it again.
+  void forward(const process::UPID& to)
+  {
+    CHECK(current != NULL) << "Attempting to forward outside a handler";
+    process::Process<T>::send(to, current->name, payload());
+  }
+
   template <typename M>
   void install(void (T::*method)(const M&))
   {
@@ -110,8 +222,9 @@ protected:
     protobufHandlers[m->GetTypeName()] =
       std::tr1::bind(&handlerM<M>,
                      t, method,
-                     std::tr1::placeholders::_1);
-    delete m;
+                     std::tr1::placeholders::_1,
+                     std::tr1::placeholders::_2);
+    messages[m->GetTypeName()].reset(m);
   }
 
   template <typename M>
@@ -122,7 +235,8 @@ protected:
     protobufHandlers[m->GetTypeName()] =
       std::tr1::bind(&handler0,
                      t, method,
-                     std::tr1::placeholders::_1);
+                     std::tr1::placeholders::_1,
+                     std::tr1::placeholders::_2);
     delete m;
   }
 
@@ -136,8 +250,9 @@ protected:
     protobufHandlers[m->GetTypeName()] =
       std::tr1::bind(&handler1<M, P1, P1C>,
                      t, method, param1,
-                     std::tr1::placeholders::_1);
-    delete m;
+                     std::tr1::placeholders::_1,
+                     std::tr1::placeholders::_2);
+    messages[m->GetTypeName()].reset(m);
   }
 
   template <typename M,
@@ -152,8 +267,9 @@ protected:
     protobufHandlers[m->GetTypeName()] =
       std::tr1::bind(&handler2<M, P1, P1C, P2, P2C>,
                      t, method, p1, p2,
-                     std::tr1::placeholders::_1);
-    delete m;
+                     std::tr1::placeholders::_1,
+                     std::tr1::placeholders::_2);
+    messages[m->GetTypeName()].reset(m);
   }
 
   template <typename M,
@@ -170,8 +286,9 @@ protected:
     protobufHandlers[m->GetTypeName()] =
       std::tr1::bind(&handler3<M, P1, P1C, P2, P2C, P3, P3C>,
                      t, method, p1, p2, p3,
-                     std::tr1::placeholders::_1);
-    delete m;
+                     std::tr1::placeholders::_1,
+                     std::tr1::placeholders::_2);
+    messages[m->GetTypeName()].reset(m);
   }
 
   template <typename M,
@@ -190,8 +307,9 @@ protected:
     protobufHandlers[m->GetTypeName()] =
       std::tr1::bind(&handler4<M, P1, P1C, P2, P2C, P3, P3C, P4, P4C>,
                      t, method, p1, p2, p3, p4,
-                     std::tr1::placeholders::_1);
-    delete m;
+                     std::tr1::placeholders::_1,
+                     std::tr1::placeholders::_2);
+    messages[m->GetTypeName()].reset(m);
   }
 
   template <typename M,
@@ -212,8 +330,9 @@ protected:
     protobufHandlers[m->GetTypeName()] =
       std::tr1::bind(&handler5<M, P1, P1C, P2, P2C, P3, P3C, P4, P4C, P5, P5C>,
                      t, method, p1, p2, p3, p4, p5,
-                     std::tr1::placeholders::_1);
-    delete m;
+                     std::tr1::placeholders::_1,
+                     std::tr1::placeholders::_2);
+    messages[m->GetTypeName()].reset(m);
   }
 
   using process::Process<T>::install;
@@ -221,12 +340,52 @@ protected:
   process::UPID from; // Sender of "current" message, accessible by subclasses.
 
 private:
+  // Returns the name to keep the statistics of an event under.
+  static const std::string& name(const process::Event& event)
+  {
+    static const std::string dispatch = "dispatch";
+    static const std::string http = "http";
+    static const std::string exited = "exited";
+    static const std::string terminate = "terminate";
+
+    struct NameVisitor : process::EventVisitor
+    {
+      NameVisitor() : name(&terminate) {}
+
+      virtual void visit(const process::MessageEvent& event)
+      {
+        name = &event.message->name;
+      }
+
+      virtual void visit(const process::DispatchEvent& event)
+      {
+        name = &dispatch;
+      }
+
+      virtual void visit(const process::HttpEvent& event)
+      {
+        name = &http;
+      }
+
+      virtual void visit(const process::ExitedEvent& event)
+      {
+        name = &exited;
+      }
+
+      const std::string* name;
+    } visitor;
+
+    event.visit(&visitor);
+    return *visitor.name;
+  }
+
   template <typename M>
   static void handlerM(T* t, void (T::*method)(const M&),
-                       const std::string& data)
+                       const std::string& data,
+                       const google::protobuf::Message* message)
   {
-    M m;
-    m.ParseFromString(data);
+    M parsed;
+    const M& m = parse(data, message, &parsed);
     if (m.IsInitialized()) {
       (t->*method)(m);
     } else {
@@ -236,7 +395,8 @@ private:
   }
 
   static void handler0(T* t, void (T::*method)(),
-                       const std::string& data)
+                       const std::string& data,
+                       const google::protobuf::Message* message)
   {
     (t->*method)();
   }
@@ -245,10 +405,11 @@ private:
             typename P1, typename P1C>
   static void handler1(T* t, void (T::*method)(P1C),
                        P1 (M::*p1)() const,
-                       const std::string& data)
+                       const std::string& data,
+                       const google::protobuf::Message* message)
   {
-    M m;
-    m.ParseFromString(data);
+    M parsed;
+    const M& m = parse(data, message, &parsed);
     if (m.IsInitialized()) {
       (t->*method)(google::protobuf::convert((&m->*p1)()));
     } else {
@@ -263,10 +424,11 @@ private:
   static void handler2(T* t, void (T::*method)(P1C, P2C),
                        P1 (M::*p1)() const,
                        P2 (M::*p2)() const,
-                       const std::string& data)
+                       const std::string& data,
+                       const google::protobuf::Message* message)
   {
-    M m;
-    m.ParseFromString(data);
+    M parsed;
+    const M& m = parse(data, message, &parsed);
     if (m.IsInitialized()) {
       (t->*method)(google::protobuf::convert((&m->*p1)()),
                    google::protobuf::convert((&m->*p2)()));
@@ -284,10 +446,11 @@ private:
                        P1 (M::*p1)() const,
                        P2 (M::*p2)() const,
                        P3 (M::*p3)() const,
-                       const std::string& data)
+                       const std::string& data,
+                       const google::protobuf::Message* message)
   {
-    M m;
-    m.ParseFromString(data);
+    M parsed;
+    const M& m = parse(data, message, &parsed);
     if (m.IsInitialized()) {
       (t->*method)(google::protobuf::convert((&m->*p1)()),
                    google::protobuf::convert((&m->*p2)()),
@@ -308,10 +471,11 @@ private:
                        P2 (M::*p2)() const,
                        P3 (M::*p3)() const,
                        P4 (M::*p4)() const,
-                       const std::string& data)
+                       const std::string& data,
+                       const google::protobuf::Message* message)
   {
-    M m;
-    m.ParseFromString(data);
+    M parsed;
+    const M& m = parse(data, message, &parsed);
     if (m.IsInitialized()) {
       (t->*method)(google::protobuf::convert((&m->*p1)()),
                    google::protobuf::convert((&m->*p2)()),
@@ -335,10 +499,11 @@ private:
                        P3 (M::*p3)() const,
                        P4 (M::*p4)() const,
                        P5 (M::*p5)() const,
-                       const std::string& data)
+                       const std::string& data,
+                       const google::protobuf::Message* message)
   {
-    M m;
-    m.ParseFromString(data);
+    M parsed;
+    const M& m = parse(data, message, &parsed);
     if (m.IsInitialized()) {
       (t->*method)(google::protobuf::convert((&m->*p1)()),
                    google::protobuf::convert((&m->*p2)()),
@@ -351,8 +516,36 @@ private:
     }
   }
 
-  typedef std::tr1::function<void(const std::string&)> handler;
+  // Returns the message handed over by a local sender if there is
+  // one (see ProtobufPayload), otherwise parses the data.
+  template <typename M>
+  static const M& parse(const std::string& data,
+                        const google::protobuf::Message* message,
+                        M* parsed)
+  {
+    const M* m = dynamic_cast<const M*>(message);
+    if (m != NULL) {
+      return *m;
+    }
+    parsed->ParseFromString(data);
+    return *parsed;
+  }
+
+  typedef std::tr1::function<
+    void(const std::string&, const google::protobuf::Message*)> handler;
   std::tr1::unordered_map<std::string, handler> protobufHandlers;
+
+  // Message being handled by a protobuf handler (if any).
+  process::Message* current;
+
+  // A message of each installed type that messages from remote
+  // senders get parsed into (see 'visit'). Messages are handled one
+  // at a time so a single message per type suffices.
+  std::tr1::unordered_map<
+    std::string,
+    std::tr1::shared_ptr<google::protobuf::Message> > messages;
+
+  HandlerStatisticsMap handlerStatistics;
 };
 
 
@@ -373,9 +566,23 @@ public:
         &ReqResProcess<Req, Res>::response);
   }
 
+  // Sends a request that's already been serialized (and might be
+  // getting sent to other processes too, see Protocol).
+  ReqResProcess(const process::UPID& _pid,
+                const std::tr1::shared_ptr<process::Message::Payload>& _payload)
+    : pid(_pid), payload(_payload)
+  {
+    Super::template install<Res>(
+        &ReqResProcess<Req, Res>::response);
+  }
+
   process::Future<Res> run()
   {
-    send(pid, req);
+    if (payload) {
+      Super::send(pid, req.GetTypeName(), payload);
+    } else {
+      send(pid, req);
+    }
     std::tr1::function<void(const process::Future<Res>&)> callback =
       std::tr1::bind(&ReqResProcess<Req, Res>::terminate,
                      std::tr1::placeholders::_1,
@@ -396,6 +603,7 @@ private:
 
   const process::UPID pid;
   const Req req;
+  const std::tr1::shared_ptr<process::Message::Payload> payload;
   process::Promise<Res> promise;
 };
 
@@ -417,6 +625,30 @@ struct Protocol
     process::spawn(process, true);
     return process::dispatch(process, &ReqResProcess<Req, Res>::run);
   }
+
+  // Sends the request to each of the processes, serializing it only
+  // once for all of them, and returns the futures of their responses
+  // (in the same order).
+  std::vector<process::Future<Res> > operator () (
+      const std::vector<process::UPID>& pids,
+      const Req& req) const
+  {
+    process::Message::SerializedPayload* serialized =
+      new process::Message::SerializedPayload();
+    req.SerializeToString(&serialized->data);
+    const std::tr1::shared_ptr<process::Message::Payload> payload(serialized);
+
+    std::vector<process::Future<Res> > futures;
+    futures.reserve(pids.size());
+    for (size_t i = 0; i < pids.size(); i++) {
+      ReqResProcess<Req, Res>* process =
+        new ReqResProcess<Req, Res>(pids[i], payload);
+      process::spawn(process, true);
+      futures.push_back(
+          process::dispatch(process, &ReqResProcess<Req, Res>::run));
+    }
+    return futures;
+  }
 };
 
 #endif // __PROCESS_PROTOBUF_HPP__
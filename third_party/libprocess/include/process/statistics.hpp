@@ -0,0 +1,68 @@
+#ifndef __PROCESS_STATISTICS_HPP__
+#define __PROCESS_STATISTICS_HPP__
+
+#include <stdint.h>
+
+namespace process {
+
+// Histogram of durations with a bucket per power of two microseconds:
+// bucket 0 counts durations under 1 microsecond, bucket i (for i > 0)
+// durations in [2^(i-1), 2^i) microseconds, and the last bucket also
+// everything longer than that (i.e., 2^(BUCKETS-2) microseconds or
+// about 8 seconds and more).
+struct Histogram
+{
+  static const int BUCKETS = 25;
+
+  Histogram() : total(0), max(0)
+  {
+    for (int i = 0; i < BUCKETS; i++) {
+      counts[i] = 0;
+    }
+  }
+
+  void record(double secs)
+  {
+    total += secs;
+    if (secs > max) {
+      max = secs;
+    }
+
+    int bucket = 0;
+    for (double micros = secs * 1000000; micros >= 1; micros /= 2) {
+      if (++bucket == BUCKETS - 1) {
+        break;
+      }
+    }
+
+    counts[bucket]++;
+  }
+
+  double total; // Seconds.
+  double max; // Seconds.
+  uint64_t counts[BUCKETS];
+};
+
+
+// Statistics about the events of one kind (e.g., the messages with
+// the same name) that a process handled: how many, how long they
+// waited in the process' mailbox and how long handling them took.
+struct HandlerStatistics
+{
+  HandlerStatistics() : count(0) {}
+
+  void record(double waited, double ran)
+  {
+    count++;
+    waiting.record(waited);
+    running.record(ran);
+  }
+
+  uint64_t count;
+  Histogram waiting;
+  Histogram running;
+};
+
+} // namespace process {
+
+#endif // __PROCESS_STATISTICS_HPP__
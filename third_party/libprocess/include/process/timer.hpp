@@ -29,7 +29,11 @@ inline bool operator == (const timer& left, const timer& right)
 namespace timers {
 
 timer create(double secs, const std::tr1::function<void(void)>& thunk);
-void cancel(const timer& timer);
+
+// Removes the timer so that its thunk never gets executed. Returns
+// false if the timer has already fired (or is firing concurrently) or
+// has already been canceled.
+bool cancel(const timer& timer);
 
 } // namespace timers {
 
@@ -0,0 +1,437 @@
+// Microbenchmarks of the libprocess runtime: local dispatches, message
+// ping-pong (locally and over loopback with a forked process) across
+// message sizes, fan-out and fan-in of messages, timers and spawning
+// and terminating processes. Each result gets printed as one JSON
+// object per line, so runs can be compared by scripts.
+//
+// Usage: benchmarks [iterations]
+
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <process/clock.hpp>
+#include <process/dispatch.hpp>
+#include <process/future.hpp>
+#include <process/process.hpp>
+#include <process/timer.hpp>
+
+#include "foreach.hpp"
+
+using namespace process;
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+using process::wait; // Necessary on some OS's to disambiguate.
+
+
+// Events handled so far by the processes (or timers) of the running
+// benchmark, which the benchmark waits on.
+static volatile long handled = 0;
+
+
+static void handle()
+{
+  __sync_fetch_and_add(&handled, 1);
+}
+
+
+static void await(long count)
+{
+  while (handled < count) {
+    usleep(100);
+  }
+}
+
+
+// Prints the result of a benchmark (the latencies are in seconds, if
+// there are any, and get reported in microseconds).
+static void report(const string& benchmark,
+                   size_t size,
+                   long operations,
+                   double seconds,
+                   vector<double> latencies = vector<double>())
+{
+  cout << std::fixed << std::setprecision(3)
+       << "{\"benchmark\": \"" << benchmark << "\""
+       << ", \"size\": " << size
+       << ", \"operations\": " << operations
+       << ", \"seconds\": " << seconds
+       << ", \"rate\": " << (seconds > 0 ? operations / seconds : 0);
+
+  if (!latencies.empty()) {
+    std::sort(latencies.begin(), latencies.end());
+    const size_t count = latencies.size();
+    cout << ", \"p50_us\": " << latencies[count / 2] * 1000000
+         << ", \"p99_us\": "
+         << latencies[std::min(count - 1, count * 99 / 100)] * 1000000
+         << ", \"max_us\": " << latencies.back() * 1000000;
+  }
+
+  cout << "}" << endl;
+}
+
+
+class Counter : public Process<Counter>
+{
+public:
+  void count() { handle(); }
+
+  int echo(int i) { return i; }
+};
+
+
+// Replies to each "ping" with a "pong" carrying the same body.
+class Echo : public Process<Echo>
+{
+public:
+  Echo() : ProcessBase("echo") {}
+
+protected:
+  virtual void initialize()
+  {
+    install("ping", &Echo::ping);
+  }
+
+private:
+  void ping(const UPID& from, const string& body)
+  {
+    send(from, "pong", body.data(), body.size());
+  }
+};
+
+
+// Pings an echo process one ping at a time, recording the round trip
+// time of each ping.
+class Pinger : public Process<Pinger>
+{
+public:
+  Pinger(const UPID& _echo, size_t size, int _pings)
+    : echo(_echo), body(size, 'x'), pings(_pings), sent(0) {}
+
+  void start()
+  {
+    ping();
+  }
+
+  vector<double> latencies;
+
+protected:
+  virtual void initialize()
+  {
+    install("pong", &Pinger::pong);
+  }
+
+private:
+  void ping()
+  {
+    sent = Clock::real();
+    send(echo, "ping", body.data(), body.size());
+  }
+
+  void pong(const UPID& from, const string& body)
+  {
+    latencies.push_back(Clock::real() - sent);
+
+    if (latencies.size() < (size_t) pings) {
+      ping();
+    } else {
+      handle();
+    }
+  }
+
+  const UPID echo;
+  const string body;
+  const int pings;
+  double sent;
+};
+
+
+class Sink : public Process<Sink>
+{
+protected:
+  virtual void initialize()
+  {
+    install("message", &Sink::message);
+  }
+
+private:
+  void message(const UPID& from, const string& body)
+  {
+    handle();
+  }
+};
+
+
+class Source : public Process<Source>
+{
+public:
+  void run(const vector<UPID>& sinks, int messages)
+  {
+    const string body(64, 'x');
+    for (int i = 0; i < messages; i++) {
+      foreach (const UPID& sink, sinks) {
+        send(sink, "message", body.data(), body.size());
+      }
+    }
+  }
+};
+
+
+static void dispatches(int iterations)
+{
+  Counter counter;
+  spawn(counter);
+
+  handled = 0;
+  double start = Clock::real();
+  for (int i = 0; i < iterations; i++) {
+    dispatch(counter.self(), &Counter::count);
+  }
+  await(iterations);
+  report("dispatch_throughput", 0, iterations, Clock::real() - start);
+
+  // Round trips, i.e., waiting for the result of each dispatch.
+  const int trips = std::max(1, iterations / 10);
+  vector<double> latencies;
+  start = Clock::real();
+  for (int i = 0; i < trips; i++) {
+    const double sent = Clock::real();
+    dispatch(counter.self(), &Counter::echo, i).get();
+    latencies.push_back(Clock::real() - sent);
+  }
+  report("dispatch_latency", 0, trips, Clock::real() - start, latencies);
+
+  terminate(counter);
+  wait(counter);
+}
+
+
+static void pingpong(const string& benchmark, const UPID& echo, int iterations)
+{
+  const size_t sizes[] = { 64, 1024, 16 * 1024, 256 * 1024 };
+
+  foreach (size_t size, sizes) {
+    // Fewer round trips for the bigger messages.
+    const int pings =
+      std::max(1, (int) (iterations / 10 / (1 + size / 1024)));
+
+    Pinger pinger(echo, size, pings);
+    spawn(pinger);
+
+    handled = 0;
+    const double start = Clock::real();
+    dispatch(pinger.self(), &Pinger::start);
+    await(1);
+    report(benchmark, size, pings, Clock::real() - start, pinger.latencies);
+
+    terminate(pinger);
+    wait(pinger);
+  }
+}
+
+
+static void fan(int iterations, int width)
+{
+  const int messages = std::max(1, iterations / width);
+
+  // One source sending to many sinks.
+  {
+    Source source;
+    spawn(source);
+
+    vector<Sink*> sinks;
+    vector<UPID> pids;
+    for (int i = 0; i < width; i++) {
+      sinks.push_back(new Sink());
+      pids.push_back(spawn(sinks.back()));
+    }
+
+    handled = 0;
+    const double start = Clock::real();
+    dispatch(source.self(), &Source::run, pids, messages);
+    await(messages * width);
+    report("fan_out", width, messages * width, Clock::real() - start);
+
+    terminate(source);
+    wait(source);
+
+    foreach (Sink* sink, sinks) {
+      terminate(sink);
+      wait(sink);
+      delete sink;
+    }
+  }
+
+  // Many sources sending to one sink.
+  {
+    Sink sink;
+    spawn(sink);
+
+    const vector<UPID> pids(1, sink.self());
+
+    vector<Source*> sources;
+    for (int i = 0; i < width; i++) {
+      sources.push_back(new Source());
+      spawn(sources.back());
+    }
+
+    handled = 0;
+    const double start = Clock::real();
+    foreach (Source* source, sources) {
+      dispatch(source->self(), &Source::run, pids, messages);
+    }
+    await(messages * width);
+    report("fan_in", width, messages * width, Clock::real() - start);
+
+    foreach (Source* source, sources) {
+      terminate(source);
+      wait(source);
+      delete source;
+    }
+
+    terminate(sink);
+    wait(sink);
+  }
+}
+
+
+static void timeouts(int iterations)
+{
+  handled = 0;
+  const double start = Clock::real();
+  for (int i = 0; i < iterations; i++) {
+    // Spread the timeouts over 10ms.
+    timers::create((i % 10) / 1000.0, &handle);
+  }
+  report("timer_create", 0, iterations, Clock::real() - start);
+
+  await(iterations);
+  report("timer_expiry", 0, iterations, Clock::real() - start);
+}
+
+
+static void spawns(int iterations)
+{
+  const int processes = std::max(1, iterations / 10);
+
+  vector<UPID> pids;
+  pids.reserve(processes);
+
+  const double start = Clock::real();
+  for (int i = 0; i < processes; i++) {
+    pids.push_back(spawn(new Counter(), true));
+  }
+  foreach (const UPID& pid, pids) {
+    terminate(pid);
+  }
+  foreach (const UPID& pid, pids) {
+    wait(pid);
+  }
+  report("spawn_terminate", 0, processes, Clock::real() - start);
+}
+
+
+// Forks a process running an echo process (listening on loopback),
+// returning the child's pid and the echo process' pid.
+static pid_t forkEcho(UPID* echo)
+{
+  int fds[2];
+  if (pipe(fds) != 0) {
+    cerr << "Failed to create a pipe" << endl;
+    exit(1);
+  }
+
+  pid_t pid = ::fork();
+
+  if (pid < 0) {
+    cerr << "Failed to fork" << endl;
+    exit(1);
+  } else if (pid == 0) {
+    close(fds[0]);
+
+    initialize(false);
+
+    Echo* process = new Echo();
+    const string self = spawn(process);
+
+    ssize_t length = write(fds[1], self.data(), self.size());
+    close(fds[1]);
+
+    if (length == (ssize_t) self.size()) {
+      wait(process); // Until the parent kills us.
+    }
+    _exit(1);
+  }
+
+  close(fds[1]);
+
+  string self;
+  char buffer[256];
+  ssize_t length;
+  while ((length = read(fds[0], buffer, sizeof(buffer))) > 0) {
+    self.append(buffer, length);
+  }
+  close(fds[0]);
+
+  *echo = UPID(self);
+
+  return pid;
+}
+
+
+int main(int argc, char** argv)
+{
+  const int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+
+  if (iterations <= 0) {
+    cerr << "Usage: " << argv[0] << " [iterations]" << endl;
+    return 1;
+  }
+
+  // Both processes talk over loopback.
+  setenv("LIBPROCESS_IP", "127.0.0.1", 1);
+
+  // Fork before initializing, the child gets its own libprocess.
+  UPID remote;
+  const pid_t child = forkEcho(&remote);
+
+  initialize(false);
+
+  dispatches(iterations);
+
+  Echo echo;
+  spawn(echo);
+  pingpong("local_pingpong", echo.self(), iterations);
+  terminate(echo);
+  wait(echo);
+
+  if (remote != UPID()) {
+    pingpong("remote_pingpong", remote, iterations);
+  } else {
+    cerr << "Skipping remote ping-pong (the child failed)" << endl;
+  }
+
+  fan(iterations, 16);
+
+  timeouts(iterations);
+
+  spawns(iterations);
+
+  kill(child, SIGKILL);
+  waitpid(child, NULL, 0);
+
+  return 0;
+}
@@ -2,23 +2,48 @@
 #define __DECODER_HPP__
 
 #include <http_parser.h>
+#include <stdint.h>
+#include <string.h>
 
+#include <arpa/inet.h>
+
+#include <algorithm>
 #include <deque>
 #include <string>
 #include <vector>
 
 #include <process/http.hpp>
+#include <process/message.hpp>
 
+#include "encoder.hpp"
 #include "foreach.hpp"
+#include "gzip.hpp"
 
 
 namespace process {
 
+// Default maximum size (in bytes) of a message (i.e., of a binary
+// frame or request body, before and after decompression).
+const size_t DEFAULT_MAX_MESSAGE_SIZE = 64 * 1024 * 1024;
+
+// Most (in bytes) to reserve up front for the rest of an incomplete
+// binary frame, beyond which the buffer only grows as data arrives
+// (so that a peer can't have us allocate without sending anything).
+const size_t MAX_FRAME_RESERVATION = 1024 * 1024;
+
+
 class DataDecoder
 {
 public:
-  DataDecoder()
-    : failure(false), request(NULL)
+  // Frames, request bodies, or decompressed message bodies of more
+  // than 'maxMessageSize' bytes fail the connection.
+  explicit DataDecoder(size_t _maxMessageSize = DEFAULT_MAX_MESSAGE_SIZE)
+    : failure(false),
+      format(UNKNOWN),
+      magic(false),
+      pending(0),
+      maxMessageSize(_maxMessageSize),
+      request(NULL)
   {
     settings.on_message_begin = &DataDecoder::on_message_begin;
     settings.on_header_field = &DataDecoder::on_header_field;
@@ -36,21 +61,46 @@ public:
     parser.data = this;
   }
 
-  std::deque<HttpRequest*> decode(const char* data, size_t length)
+  // Decodes as much of the data as possible into HTTP requests (or
+  // messages if the peer is using the binary framing), which are
+  // returned by 'requests' and 'messages' until the next call to
+  // decode (the caller takes ownership of them). The data is not
+  // needed after this returns, so the caller can reuse its buffer.
+  void decode(const char* data, size_t length)
   {
+    decodedRequests.clear();
+    decodedMessages.clear();
+
+    // A peer using the binary framing starts the connection with
+    // BINARY_MAGIC, which can't be the start of an HTTP request.
+    if (format == UNKNOWN && length > 0) {
+      format = data[0] == BINARY_MAGIC[0] ? BINARY : HTTP;
+    }
+
+    if (format == BINARY) {
+      if (!failure) {
+        decodeBinary(data, length);
+      }
+      return;
+    }
+
     size_t parsed = http_parser_execute(&parser, &settings, data, length);
 
     if (parsed != length) {
       failure = true;
     }
+  }
 
-    if (!requests.empty()) {
-      std::deque<HttpRequest*> result = requests;
-      requests.clear();
-      return result;
-    }
+  const std::deque<HttpRequest*>& requests() const
+  {
+    return decodedRequests;
+  }
 
-    return std::deque<HttpRequest*>();
+  // Note that the receiver of each message is assumed to be a local
+  // process.
+  const std::deque<Message*>& messages() const
+  {
+    return decodedMessages;
   }
 
   bool failed() const
@@ -59,6 +109,161 @@ public:
   }
 
 private:
+  void decodeBinary(const char* data, size_t length)
+  {
+    // Decode straight out of the caller's data unless we have part of
+    // a frame buffered from before, and only buffer what's left over.
+    if (buffer.empty()) {
+      size_t index = decodeFrames(data, length);
+      if (!failure && index < length) {
+        buffer.reserve(std::min(pending, MAX_FRAME_RESERVATION));
+        buffer.assign(data + index, length - index);
+      }
+    } else {
+      buffer.append(data, length);
+      size_t index = decodeFrames(buffer.data(), buffer.size());
+      if (!failure) {
+        buffer.erase(0, index);
+        buffer.reserve(std::min(pending, MAX_FRAME_RESERVATION));
+      }
+    }
+  }
+
+  // Decodes as many complete frames as possible, returning the number
+  // of bytes consumed (and setting 'pending' to the size of the next,
+  // incomplete, frame if known).
+  size_t decodeFrames(const char* data, size_t length)
+  {
+    size_t index = 0;
+
+    pending = 0;
+
+    if (!magic) {
+      if (length < BINARY_MAGIC_SIZE) {
+        return 0;
+      } else if (memcmp(data, BINARY_MAGIC, BINARY_MAGIC_SIZE) != 0) {
+        failure = true;
+        return 0;
+      }
+      magic = true;
+      index = BINARY_MAGIC_SIZE;
+    }
+
+    while (length - index >= sizeof(uint32_t)) {
+      uint32_t size = ntohl(read<uint32_t>(data, index));
+
+      const bool gzipped = size & BINARY_FRAME_COMPRESSED;
+      size &= ~BINARY_FRAME_COMPRESSED;
+
+      if (size > maxMessageSize) {
+        failure = true;
+        return index;
+      }
+
+      if (length - index - sizeof(uint32_t) < size) {
+        pending = sizeof(uint32_t) + size;
+        break; // Wait for the rest of the frame.
+      }
+
+      index += sizeof(uint32_t);
+
+      const size_t end = index + size;
+
+      Message* message = new Message();
+
+      if (!read(data, &index, end, &message->to.id) ||
+          !read(data, &index, end, &message->to.ip) ||
+          !read(data, &index, end, &message->to.port) ||
+          !read(data, &index, end, &message->from.id) ||
+          !read(data, &index, end, &message->from.ip) ||
+          !read(data, &index, end, &message->from.port) ||
+          !read(data, &index, end, &message->name)) {
+        delete message;
+        failure = true;
+        return index;
+      }
+
+      if (!gzipped) {
+        message->body.assign(data + index, end - index);
+      } else if (!Gzip::decompress(data + index,
+                                   end - index,
+                                   &message->body,
+                                   maxMessageSize)) {
+        delete message;
+        failure = true;
+        return index;
+      }
+
+      index = end;
+
+      decodedMessages.push_back(message);
+    }
+
+    return index;
+  }
+
+  template <typename T>
+  static T read(const char* data, size_t index)
+  {
+    T value;
+    memcpy(&value, data + index, sizeof(value));
+    return value;
+  }
+
+  static bool read(const char* data, size_t* index, size_t end, uint32_t* ip)
+  {
+    if (end - *index < sizeof(uint32_t)) {
+      return false;
+    }
+    *ip = read<uint32_t>(data, *index); // Already in network order.
+    *index += sizeof(uint32_t);
+    return true;
+  }
+
+  static bool read(const char* data, size_t* index, size_t end, uint16_t* port)
+  {
+    if (end - *index < sizeof(uint16_t)) {
+      return false;
+    }
+    *port = ntohs(read<uint16_t>(data, *index));
+    *index += sizeof(uint16_t);
+    return true;
+  }
+
+  // Reads a (possibly interned) string, see BinaryMessageEncoder.
+  bool read(const char* data, size_t* index, size_t end, std::string* s)
+  {
+    if (end - *index < sizeof(uint32_t)) {
+      return false;
+    }
+
+    uint32_t symbol = ntohl(read<uint32_t>(data, *index));
+    *index += sizeof(uint32_t);
+
+    if (symbol & BINARY_SYMBOL_DEFINITION) {
+      symbol &= ~BINARY_SYMBOL_DEFINITION;
+
+      if (symbol != symbols.size() || end - *index < sizeof(uint32_t)) {
+        return false;
+      }
+
+      uint32_t size = ntohl(read<uint32_t>(data, *index));
+      *index += sizeof(uint32_t);
+
+      if (end - *index < size) {
+        return false;
+      }
+
+      symbols.push_back(std::string(data + *index, size));
+      *index += size;
+    } else if (symbol >= symbols.size()) {
+      return false;
+    }
+
+    *s = symbols[symbol];
+    return true;
+  }
+
   static int on_message_begin(http_parser* p)
   {
     DataDecoder* decoder = (DataDecoder*) p->data;
@@ -93,14 +298,51 @@ private:
   static int on_message_complete(http_parser* p)
   {
     DataDecoder* decoder = (DataDecoder*) p->data;
+
+    // Decompress the gzipped bodies of messages (see MessageEncoder),
+    // but leave those of any other request to whoever handles it.
+    std::map<std::string, std::string>::iterator encoding =
+      decoder->request->headers.find("Content-Encoding");
+
+    if (encoding != decoder->request->headers.end() &&
+        encoding->second == "gzip" &&
+        message(*decoder->request)) {
+      std::string body;
+      if (!Gzip::decompress(decoder->request->body.data(),
+                            decoder->request->body.size(),
+                            &body,
+                            decoder->maxMessageSize)) {
+        delete decoder->request;
+        decoder->request = NULL;
+        return 1; // Fails the connection (see decode).
+      }
+      decoder->request->body.swap(body);
+      decoder->request->headers.erase(encoding);
+    }
+
 //     std::cout << "HttpRequest:" << std::endl;
 //     std::cout << "  method: " << decoder->request->method << std::endl;
 //     std::cout << "  path: " << decoder->request->path << std::endl;
-    decoder->requests.push_back(decoder->request);
+    decoder->decodedRequests.push_back(decoder->request);
     decoder->request = NULL;
     return 0;
   }
 
+  // Returns whether the request is a message from another libprocess
+  // process (see 'parse' in process.cpp).
+  static bool message(const HttpRequest& request)
+  {
+    if (request.method != "POST") {
+      return false;
+    }
+
+    std::map<std::string, std::string>::const_iterator agent =
+      request.headers.find("User-Agent");
+
+    return agent != request.headers.end() &&
+      agent->second.find("libprocess/") != std::string::npos;
+  }
+
   static int on_header_field(http_parser* p, const char* data, size_t length)
   {
     DataDecoder* decoder = (DataDecoder*) p->data;
@@ -163,12 +405,35 @@ private:
   {
     DataDecoder* decoder = (DataDecoder*) p->data;
     assert(decoder->request != NULL);
+    if (decoder->request->body.size() + length > decoder->maxMessageSize) {
+      delete decoder->request;
+      decoder->request = NULL;
+      return 1; // Fails the connection (see decode).
+    }
     decoder->request->body.append(data, length);
     return 0;
   }
 
   bool failure;
 
+  enum {
+    UNKNOWN,
+    HTTP,
+    BINARY
+  } format;
+
+  // State for the binary framing: whether or not we've seen the magic
+  // bytes yet, buffered data from an incomplete frame (and the size of
+  // that frame if known), the interned strings of the connection, and
+  // the decoded messages.
+  bool magic;
+  std::string buffer;
+  size_t pending;
+  std::vector<std::string> symbols;
+  std::deque<Message*> decodedMessages;
+
+  const size_t maxMessageSize;
+
   http_parser parser;
   http_parser_settings settings;
 
@@ -182,7 +447,7 @@ private:
 
   HttpRequest* request;
 
-  std::deque<HttpRequest*> requests;
+  std::deque<HttpRequest*> decodedRequests;
 };
 
 }  // namespace process {
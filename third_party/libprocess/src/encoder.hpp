@@ -1,11 +1,28 @@
 #ifndef __ENCODER_HPP__
 #define __ENCODER_HPP__
 
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+#include <algorithm>
+#include <map>
 #include <sstream>
 
 #include <process/process.hpp>
 
 #include "foreach.hpp"
+#include "gzip.hpp"
 
 
 namespace process {
@@ -33,22 +50,48 @@ public:
     }
   }
 
-  size_t remaining() const
+  virtual size_t remaining() const
   {
     return data.size() - index;
   }
 
+protected:
+  // Used by encoders that build their data in place (see
+  // BinaryMessageEncoder).
+  DataEncoder() : index(0) {}
+
+  std::string data;
+
 private:
-  const std::string data;
   size_t index;
 };
 
 
+// Gzips a message body into 'compressed' if it's at least 'threshold'
+// bytes (0 meaning never), returning whether it should be sent
+// compressed (i.e., whether that saved any space).
+inline bool compress(const std::string& body,
+                     size_t threshold,
+                     std::string* compressed)
+{
+  if (threshold == 0 || body.size() < threshold) {
+    return false;
+  }
+
+  // Compress as fast as possible, since messages get sent right away.
+  *compressed = Gzip::compress(body, Z_BEST_SPEED);
+
+  return compressed->size() < body.size();
+}
+
+
+// Encodes a message as an HTTP request, with the body gzipped (and
+// "Content-Encoding: gzip") if it's at least 'threshold' bytes.
 class MessageEncoder : public DataEncoder
 {
 public:
-  MessageEncoder(Message* _message)
-    : DataEncoder(encode(_message)), message(_message) {}
+  MessageEncoder(Message* _message, size_t threshold = 0)
+    : DataEncoder(encode(_message, threshold)), message(_message) {}
 
   virtual ~MessageEncoder()
   {
@@ -57,7 +100,7 @@ public:
     }
   }
 
-  static std::string encode(Message* message)
+  static std::string encode(Message* message, size_t threshold = 0)
   {
     if (message != NULL) {
       std::ostringstream out;
@@ -67,10 +110,20 @@ public:
           << "User-Agent: libprocess/" << message->from << "\r\n"
           << "Connection: Keep-Alive\r\n";
 
-      if (message->body.size() > 0) {
+      const std::string& data = message->data();
+
+      if (data.size() > 0) {
+        std::string compressed;
+        const bool gzipped = compress(data, threshold, &compressed);
+        const std::string& body = gzipped ? compressed : data;
+
+        if (gzipped) {
+          out << "Content-Encoding: gzip\r\n";
+        }
+
         out << "Transfer-Encoding: chunked\r\n\r\n"
-            << std::hex << message->body.size() << "\r\n";
-        out.write(message->body.data(), message->body.size());
+            << std::hex << body.size() << "\r\n";
+        out.write(body.data(), body.size());
         out << "\r\n"
             << "0\r\n"
             << "\r\n";
@@ -87,6 +140,210 @@ private:
 };
 
 
+// Magic bytes that start a connection using the binary message
+// framing below (no HTTP request can start with a NUL).
+const char BINARY_MAGIC[] = { '\0', 'L', 'P', 'B' };
+const size_t BINARY_MAGIC_SIZE = sizeof(BINARY_MAGIC);
+
+// Strings in the binary framing (process ids and message names) are
+// interned per connection: the first time a string is sent it is
+// assigned the next index and sent in full with this bit set,
+// afterwards only its index is sent.
+const uint32_t BINARY_SYMBOL_DEFINITION = 0x80000000;
+
+// Interned strings of a connection, see above.
+typedef std::map<std::string, uint32_t> BinarySymbols;
+
+// Set in the length of a frame whose body is gzipped (frames are
+// always smaller than 2GB).
+const uint32_t BINARY_FRAME_COMPRESSED = 0x80000000;
+
+
+// Encodes a message using a compact binary framing (rather than as an
+// HTTP request, see MessageEncoder), all integers in network order:
+//
+//   [uint32 length of the rest of the frame]
+//   [symbol to.id][uint32 to.ip][uint16 to.port]
+//   [symbol from.id][uint32 from.ip][uint16 from.port]
+//   [symbol name]
+//   [body]
+//
+// where a symbol is a uint32 index, followed by a uint32 size and the
+// string itself when it's being defined. The frame is written
+// directly into a buffer sized up front. Because of interning,
+// messages must be encoded in the order they get sent on the
+// connection. Bodies of at least 'threshold' bytes get gzipped (see
+// BINARY_FRAME_COMPRESSED).
+class BinaryMessageEncoder : public DataEncoder
+{
+public:
+  BinaryMessageEncoder(Message* _message,
+                       BinarySymbols* symbols,
+                       bool magic,
+                       size_t threshold = 0)
+    : message(_message)
+  {
+    encode(message, symbols, magic, &data, threshold);
+  }
+
+  virtual ~BinaryMessageEncoder()
+  {
+    if (message != NULL) {
+      delete message;
+    }
+  }
+
+  static void encode(Message* message,
+                     BinarySymbols* symbols,
+                     bool magic,
+                     std::string* data,
+                     size_t threshold = 0)
+  {
+    std::string compressed;
+    const std::string& payload = message->data();
+    const bool gzipped = compress(payload, threshold, &compressed);
+    const std::string& body = gzipped ? compressed : payload;
+
+    const std::string* strings[] = {
+      &message->to.id,
+      &message->from.id,
+      &message->name
+    };
+
+    // Intern the strings first (noting which ones are new and thus
+    // need to be defined) so that we know the size of the frame.
+    uint32_t symbol[3];
+    bool define[3];
+
+    size_t size = sizeof(uint32_t) + // Frame length.
+      3 * sizeof(uint32_t) + // Symbols.
+      2 * (sizeof(uint32_t) + sizeof(uint16_t)) + // IPs and ports.
+      body.size();
+
+    for (int i = 0; i < 3; i++) {
+      BinarySymbols::iterator it = symbols->find(*strings[i]);
+      if (it != symbols->end()) {
+        symbol[i] = it->second;
+        define[i] = false;
+      } else {
+        symbol[i] = symbols->size();
+        define[i] = true;
+        (*symbols)[*strings[i]] = symbol[i];
+        size += sizeof(uint32_t) + strings[i]->size();
+      }
+    }
+
+    if (magic) {
+      size += BINARY_MAGIC_SIZE;
+    }
+
+    data->resize(size);
+
+    char* out = &(*data)[0];
+
+    if (magic) {
+      append(&out, BINARY_MAGIC, BINARY_MAGIC_SIZE);
+    }
+
+    uint32_t length = size - (out - data->data()) - sizeof(uint32_t);
+    if (gzipped) {
+      length |= BINARY_FRAME_COMPRESSED;
+    }
+
+    append(&out, htonl(length));
+
+    for (int i = 0; i < 3; i++) {
+      if (define[i]) {
+        append(&out, htonl(symbol[i] | BINARY_SYMBOL_DEFINITION));
+        append(&out, htonl(strings[i]->size()));
+        append(&out, strings[i]->data(), strings[i]->size());
+      } else {
+        append(&out, htonl(symbol[i]));
+      }
+
+      // Follow the ids with the rest of their PIDs (note that IPs
+      // are already stored in network order).
+      if (i == 0) {
+        append(&out, message->to.ip);
+        append(&out, htons(message->to.port));
+      } else if (i == 1) {
+        append(&out, message->from.ip);
+        append(&out, htons(message->from.port));
+      }
+    }
+
+    append(&out, body.data(), body.size());
+  }
+
+private:
+  static void append(char** out, const char* data, size_t length)
+  {
+    memcpy(*out, data, length);
+    *out += length;
+  }
+
+  template <typename T>
+  static void append(char** out, T value)
+  {
+    append(out, (const char*) &value, sizeof(value));
+  }
+
+  Message* message;
+};
+
+
+// Sends part of a file straight from the file to the socket (using
+// sendfile where available), so that the file never gets read into
+// memory. These don't get sent along with other encoders (see
+// send_data), and take ownership of the file descriptor.
+class FileEncoder : public DataEncoder
+{
+public:
+  FileEncoder(int _fd, off_t _offset, size_t _size)
+    : DataEncoder(""), fd(_fd), offset(_offset), size(_size) {}
+
+  virtual ~FileEncoder()
+  {
+    close(fd);
+  }
+
+  virtual size_t remaining() const
+  {
+    return size;
+  }
+
+  // Sends as much of the rest of the file as the socket takes,
+  // returning like sendmsg does (a file that got shorter than
+  // expected looks like a closed socket).
+  ssize_t send(int s)
+  {
+#ifdef __linux__
+    ssize_t length = ::sendfile(s, fd, &offset, size);
+#else
+    char buffer[64 * 1024];
+    ssize_t length = ::pread(fd, buffer, std::min(size, sizeof(buffer)), offset);
+    if (length > 0) {
+      length = ::send(s, buffer, length, MSG_NOSIGNAL);
+      if (length > 0) {
+        offset += length;
+      }
+    }
+#endif // __linux__
+
+    if (length > 0) {
+      size -= length;
+    }
+
+    return length;
+  }
+
+private:
+  const int fd;
+  off_t offset;
+  size_t size;
+};
+
+
 class HttpResponseEncoder : public DataEncoder
 {
 public:
@@ -121,8 +378,10 @@ public:
     }
 
     // Make sure at least the "Content-Length" header since is present
-    // in order to signal to a client the end of a response.
-    if (headers.count("Content-Length") == 0) {
+    // in order to signal to a client the end of a response (unless
+    // the body gets sent in chunks, which signal the end themselves).
+    if (headers.count("Content-Length") == 0 &&
+        headers.count("Transfer-Encoding") == 0) {
       out << "Content-Length: " << response.body.size() << "\r\n";
     }
 
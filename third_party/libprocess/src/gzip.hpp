@@ -0,0 +1,118 @@
+#ifndef __GZIP_HPP__
+#define __GZIP_HPP__
+
+#include <zlib.h>
+
+#include <glog/logging.h>
+
+#include <string>
+
+
+namespace process {
+
+// Incrementally compresses data into the gzip format (e.g., the body
+// of an HTTP response with "Content-Encoding: gzip"). Each call to
+// compress flushes, so that the client can decompress everything
+// compressed so far (e.g., each chunk of a streamed response).
+class Gzip
+{
+public:
+  explicit Gzip(int level = Z_DEFAULT_COMPRESSION)
+  {
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+
+    // A window of 15 bits plus 16 to get the gzip (rather than zlib)
+    // header and trailer.
+    int result = deflateInit2(&stream, level, Z_DEFLATED,
+                              15 + 16, 8, Z_DEFAULT_STRATEGY);
+    CHECK(result == Z_OK) << "Failed to initialize zlib: " << result;
+  }
+
+  ~Gzip()
+  {
+    deflateEnd(&stream);
+  }
+
+  // Returns the compressed data, ending the gzip stream if 'finish'.
+  std::string compress(const std::string& data, bool finish)
+  {
+    std::string result;
+
+    stream.next_in = (Bytef*) data.data();
+    stream.avail_in = data.size();
+
+    const int flush = finish ? Z_FINISH : Z_SYNC_FLUSH;
+
+    char buffer[16384];
+
+    do {
+      stream.next_out = (Bytef*) buffer;
+      stream.avail_out = sizeof(buffer);
+      int code = deflate(&stream, flush);
+      CHECK(code != Z_STREAM_ERROR);
+      result.append(buffer, sizeof(buffer) - stream.avail_out);
+    } while (stream.avail_out == 0);
+
+    return result;
+  }
+
+  // Compresses all of 'data' (as one gzip stream).
+  static std::string compress(const std::string& data,
+                              int level = Z_DEFAULT_COMPRESSION)
+  {
+    Gzip gzip(level);
+    return gzip.compress(data, true);
+  }
+
+  // Decompresses a whole gzip stream into 'result', returning false
+  // if the data isn't a complete gzip stream or if it decompresses to
+  // more than 'limit' bytes.
+  static bool decompress(const char* data,
+                         size_t size,
+                         std::string* result,
+                         size_t limit)
+  {
+    z_stream stream;
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = (Bytef*) data;
+    stream.avail_in = size;
+
+    if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+      return false;
+    }
+
+    result->clear();
+
+    char buffer[16384];
+    int code;
+
+    do {
+      stream.next_out = (Bytef*) buffer;
+      stream.avail_out = sizeof(buffer);
+      code = inflate(&stream, Z_NO_FLUSH);
+      if (result->size() + sizeof(buffer) - stream.avail_out > limit) {
+        inflateEnd(&stream);
+        return false;
+      }
+      result->append(buffer, sizeof(buffer) - stream.avail_out);
+    } while (code == Z_OK);
+
+    inflateEnd(&stream);
+
+    return code == Z_STREAM_END;
+  }
+
+private:
+  Gzip(const Gzip&);
+  Gzip& operator = (const Gzip&);
+
+  z_stream stream;
+};
+
+} // namespace process {
+
+#endif // __GZIP_HPP__
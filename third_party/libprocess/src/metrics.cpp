@@ -0,0 +1,329 @@
+#include <pthread.h>
+#include <string.h>
+
+#include <glog/logging.h>
+
+#include <list>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include <process/metrics.hpp>
+
+using std::list;
+using std::map;
+using std::ostringstream;
+using std::string;
+
+
+namespace process {
+namespace metrics {
+
+// The registered metrics, by name (for exporting the metrics with
+// the same name together, as the text format requires). Created on
+// first use, so that metrics can be static objects (constructed in
+// any order) too.
+static map<string, list<Metric*> >* registry = NULL;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Shard of each thread (see metrics::shard).
+static __thread int _shard_ = -1;
+static int next = 0;
+
+
+int shard()
+{
+  if (_shard_ < 0) {
+    _shard_ = __sync_fetch_and_add(&next, 1) % SHARDS;
+  }
+  return _shard_;
+}
+
+
+string label(const string& key, const string& value)
+{
+  string escaped;
+  for (size_t i = 0; i < value.size(); i++) {
+    switch (value[i]) {
+      case '\\': escaped += "\\\\"; break;
+      case '"': escaped += "\\\""; break;
+      case '\n': escaped += "\\n"; break;
+      default: escaped += value[i]; break;
+    }
+  }
+  return key + "=\"" + escaped + "\"";
+}
+
+
+// Returns a value in the text format, integers written in full.
+static string format(double value)
+{
+  ostringstream out;
+  out.precision(15);
+  out << value;
+  return out.str();
+}
+
+
+string text()
+{
+  ostringstream out;
+
+  pthread_mutex_lock(&mutex);
+
+  if (registry == NULL) {
+    registry = new map<string, list<Metric*> >();
+  }
+
+  for (map<string, list<Metric*> >::const_iterator iterator =
+         registry->begin(); iterator != registry->end(); ++iterator) {
+    const list<Metric*>& metrics = iterator->second;
+    const Metric* first = metrics.front();
+
+    out << "# HELP " << first->name << " " << first->help << "\n";
+    out << "# TYPE " << first->name << " " << first->type() << "\n";
+
+    // Sum up the metrics with the same labels (in the order the
+    // labels were first registered).
+    list<string> labels;
+    map<string, double*> values;
+
+    for (list<Metric*>::const_iterator metric = metrics.begin();
+         metric != metrics.end(); ++metric) {
+      if (values.count((*metric)->labels) == 0) {
+        labels.push_back((*metric)->labels);
+        double* samples = new double[(*metric)->samples()];
+        for (int i = 0; i < (*metric)->samples(); i++) {
+          samples[i] = 0;
+        }
+        values[(*metric)->labels] = samples;
+      }
+      (*metric)->collect(values[(*metric)->labels]);
+    }
+
+    for (list<string>::const_iterator labels_ = labels.begin();
+         labels_ != labels.end(); ++labels_) {
+      double* samples = values[*labels_];
+      for (int i = 0; i < first->samples(); i++) {
+        string all = *labels_;
+        const string& extra = first->extra(i);
+        if (!extra.empty()) {
+          all += (all.empty() ? "" : ",") + extra;
+        }
+
+        out << first->name << first->suffix(i);
+        if (!all.empty()) {
+          out << "{" << all << "}";
+        }
+        out << " " << format(samples[i]) << "\n";
+      }
+      delete[] samples;
+    }
+  }
+
+  pthread_mutex_unlock(&mutex);
+
+  return out.str();
+}
+
+
+Metric::Metric(const string& _name,
+               const string& _help,
+               const string& _labels)
+  : name(_name), help(_help), labels(_labels), added(false) {}
+
+
+Metric::~Metric()
+{
+  remove();
+}
+
+
+void Metric::remove()
+{
+  if (added) {
+    pthread_mutex_lock(&mutex);
+    list<Metric*>& metrics = (*registry)[name];
+    metrics.remove(this);
+    if (metrics.empty()) {
+      registry->erase(name);
+    }
+    added = false;
+    pthread_mutex_unlock(&mutex);
+  }
+}
+
+
+void Metric::add()
+{
+  pthread_mutex_lock(&mutex);
+  if (registry == NULL) {
+    registry = new map<string, list<Metric*> >();
+  }
+  list<Metric*>& metrics = (*registry)[name];
+  if (!metrics.empty() && metrics.front()->type() != type()) {
+    LOG(FATAL) << "Metric " << name << " registered as both a "
+               << metrics.front()->type() << " and a " << type();
+  }
+  metrics.push_back(this);
+  added = true;
+  pthread_mutex_unlock(&mutex);
+}
+
+
+Counter::Counter(const string& name,
+                 const string& help,
+                 const string& labels)
+  : Metric(name, help, labels)
+{
+  memset(shards, 0, sizeof(shards));
+  add();
+}
+
+
+uint64_t Counter::value() const
+{
+  uint64_t value = 0;
+  for (int i = 0; i < SHARDS; i++) {
+    value += shards[i].value;
+  }
+  return value;
+}
+
+
+void Counter::collect(double* values) const
+{
+  values[0] += value();
+}
+
+
+Gauge::Gauge(const string& name,
+             const string& help,
+             const string& labels)
+  : Metric(name, help, labels)
+{
+  memset(shards, 0, sizeof(shards));
+  add();
+}
+
+
+void Gauge::set(int64_t value)
+{
+  // Keep the value in one shard (any would do).
+  for (int i = 1; i < SHARDS; i++) {
+    shards[i].value = 0;
+  }
+  __sync_synchronize();
+  shards[0].value = value;
+}
+
+
+int64_t Gauge::value() const
+{
+  int64_t value = 0;
+  for (int i = 0; i < SHARDS; i++) {
+    value += shards[i].value;
+  }
+  return value;
+}
+
+
+void Gauge::collect(double* values) const
+{
+  values[0] += value();
+}
+
+
+Timer::Timer(const string& name,
+             const string& help,
+             const string& labels)
+  : Metric(name, help, labels)
+{
+  memset(shards, 0, sizeof(shards));
+  add();
+}
+
+
+void Timer::record(double secs)
+{
+  // Same buckets as process::Histogram::record.
+  int bucket = 0;
+  for (double micros = secs * 1000000; micros >= 1; micros /= 2) {
+    if (++bucket == process::Histogram::BUCKETS - 1) {
+      break;
+    }
+  }
+
+  uint64_t micros = secs > 0 ? (uint64_t) (secs * 1000000) : 0;
+
+  Shard* shard = &shards[metrics::shard()];
+  __sync_fetch_and_add(&shard->counts[bucket], 1);
+  __sync_fetch_and_add(&shard->total, micros);
+
+  uint64_t max = shard->max;
+  while (micros > max &&
+         !__sync_bool_compare_and_swap(&shard->max, max, micros)) {
+    max = shard->max;
+  }
+}
+
+
+process::Histogram Timer::snapshot() const
+{
+  process::Histogram histogram;
+  uint64_t total = 0;
+  uint64_t max = 0;
+  for (int i = 0; i < SHARDS; i++) {
+    for (int j = 0; j < process::Histogram::BUCKETS; j++) {
+      histogram.counts[j] += shards[i].counts[j];
+    }
+    total += shards[i].total;
+    if (shards[i].max > max) {
+      max = shards[i].max;
+    }
+  }
+  histogram.total = total / 1000000.0;
+  histogram.max = max / 1000000.0;
+  return histogram;
+}
+
+
+// The samples of a timer are the (cumulative) counts of its buckets,
+// then the sum of the durations and the count of them.
+void Timer::collect(double* values) const
+{
+  const process::Histogram& histogram = snapshot();
+  uint64_t count = 0;
+  for (int i = 0; i < process::Histogram::BUCKETS; i++) {
+    count += histogram.counts[i];
+    values[i] += count;
+  }
+  values[process::Histogram::BUCKETS] += histogram.total;
+  values[process::Histogram::BUCKETS + 1] += count;
+}
+
+
+string Timer::suffix(int i) const
+{
+  if (i < process::Histogram::BUCKETS) {
+    return "_bucket";
+  } else if (i == process::Histogram::BUCKETS) {
+    return "_sum";
+  }
+  return "_count";
+}
+
+
+string Timer::extra(int i) const
+{
+  if (i == process::Histogram::BUCKETS - 1) {
+    return label("le", "+Inf");
+  } else if (i < process::Histogram::BUCKETS - 1) {
+    // Bucket i counts durations under 2^i microseconds.
+    return label("le", format((1 << i) / 1000000.0));
+  }
+  return "";
+}
+
+} // namespace metrics {
+} // namespace process {
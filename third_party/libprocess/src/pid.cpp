@@ -1,13 +1,16 @@
 #include <errno.h>
 #include <netdb.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #include <arpa/inet.h>
 
 #include <glog/logging.h>
 
 #include <iostream>
+#include <map>
 #include <string>
 
 #include <boost/unordered_map.hpp>
@@ -24,6 +27,7 @@
 
 
 using std::istream;
+using std::map;
 using std::ostream;
 using std::size_t;
 using std::string;
@@ -31,6 +35,104 @@ using std::string;
 
 namespace process {
 
+// Resolved hosts (including hosts that failed to resolve, so that a
+// bad host doesn't hit the resolver every time either), created on
+// first use like everything else that pids can be parsed before.
+struct Resolution
+{
+  bool resolved;
+  uint32_t ip;
+  time_t expires;
+};
+
+static map<string, Resolution>* resolutions = NULL;
+static pthread_mutex_t resolutions_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// How long resolutions (failures) are cached for, in seconds, and
+// how many hosts are cached at most.
+static const time_t RESOLVED_TTL = 60;
+static const time_t UNRESOLVED_TTL = 5;
+static const size_t RESOLUTIONS = 1024;
+
+
+// Resolves the host into an IPv4 address. Hosts that are already IP
+// addresses (as they are in the pids that get sent around, see
+// operator << below) never go to the resolver, and the other hosts
+// only do when they haven't been resolved recently.
+static bool resolve(const string& host, uint32_t* ip)
+{
+  in_addr address;
+  if (inet_pton(AF_INET, host.c_str(), &address) == 1) {
+    *ip = address.s_addr;
+    return true;
+  }
+
+  time_t now = time(NULL);
+
+  pthread_mutex_lock(&resolutions_mutex);
+  if (resolutions == NULL) {
+    resolutions = new map<string, Resolution>();
+  }
+  map<string, Resolution>::const_iterator iterator = resolutions->find(host);
+  if (iterator != resolutions->end() && iterator->second.expires > now) {
+    Resolution resolution = iterator->second;
+    pthread_mutex_unlock(&resolutions_mutex);
+    *ip = resolution.ip;
+    return resolution.resolved;
+  }
+  pthread_mutex_unlock(&resolutions_mutex);
+
+  // Resolve without holding the lock, so that a slow resolver only
+  // stalls the threads parsing the same (uncached) host.
+  Resolution resolution;
+  resolution.resolved = false;
+  resolution.ip = 0;
+
+  hostent he, *hep;
+  char* temp;
+  size_t length;
+  int result;
+  int herrno;
+
+  // Allocate temporary buffer for gethostbyname2_r.
+  length = 1024;
+  temp = new char[length];
+
+  while ((result = gethostbyname2_r(host.c_str(), AF_INET, &he,
+				    temp, length, &hep, &herrno)) == ERANGE) {
+    // Enlarge the buffer.
+    delete[] temp;
+    length *= 2;
+    temp = new char[length];
+  }
+
+  if (result != 0 || hep == NULL) {
+    VLOG(2) << "Failed to parse host '" << host
+	    << "' because " << hstrerror(herrno);
+  } else if (hep->h_addr_list[0] == NULL) {
+    VLOG(2) << "Got no addresses for '" << host << "'";
+  } else {
+    resolution.resolved = true;
+    resolution.ip = *((uint32_t*) hep->h_addr_list[0]);
+  }
+
+  delete[] temp;
+
+  resolution.expires =
+    now + (resolution.resolved ? RESOLVED_TTL : UNRESOLVED_TTL);
+
+  pthread_mutex_lock(&resolutions_mutex);
+  if (resolutions->size() >= RESOLUTIONS) {
+    resolutions->clear(); // Simplest way to bound the cache.
+  }
+  (*resolutions)[host] = resolution;
+  pthread_mutex_unlock(&resolutions_mutex);
+
+  *ip = resolution.ip;
+  return resolution.resolved;
+}
+
+
 UPID::UPID(const char* s)
 {
   std::istringstream in(s);
@@ -118,43 +220,11 @@ istream& operator >> (istream& stream, UPID& pid)
     return stream;
   }
 
-  hostent he, *hep;
-  char* temp;
-  size_t length;
-  int result;
-  int herrno;
-
-  // Allocate temporary buffer for gethostbyname2_r.
-  length = 1024;
-  temp = new char[length];
-
-  while ((result = gethostbyname2_r(host.c_str(), AF_INET, &he,
-				    temp, length, &hep, &herrno)) == ERANGE) {
-    // Enlarge the buffer.
-    delete[] temp;
-    length *= 2;
-    temp = new char[length];
-  }
-
-  if (result != 0 || hep == NULL) {
-    VLOG(2) << "Failed to parse host '" << host
-	    << "' because " << hstrerror(herrno);
-    delete[] temp;
+  if (!resolve(host, &ip)) {
     stream.setstate(std::ios_base::badbit);
     return stream;
   }
 
-  if (hep->h_addr_list[0] == NULL) {
-    VLOG(2) << "Got no addresses for '" << host << "'";
-    delete[] temp;
-    stream.setstate(std::ios_base::badbit);
-    return stream;
-  }
-
-  ip = *((uint32_t*) hep->h_addr_list[0]);
-
-  delete[] temp;
-
   str = str.substr(index + 1);
 
   if (sscanf(str.c_str(), "%hu", &port) != 1) {
@@ -1,14 +1,17 @@
+#include <dirent.h>
 #include <errno.h>
 #include <ev.h>
 #include <fcntl.h>
 #include <limits.h>
 #include <netdb.h>
 #include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <ucontext.h>
 #include <unistd.h>
 
@@ -23,8 +26,11 @@
 #include <sys/mman.h>
 #include <sys/select.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 
 #include <algorithm>
 #include <deque>
@@ -40,6 +46,9 @@
 #include <stdexcept>
 #include <vector>
 
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+
 #include <process/clock.hpp>
 #include <process/deferred.hpp>
 #include <process/dispatch.hpp>
@@ -47,6 +56,7 @@
 #include <process/filter.hpp>
 #include <process/future.hpp>
 #include <process/gc.hpp>
+#include <process/metrics.hpp>
 #include <process/process.hpp>
 #include <process/timer.hpp>
 
@@ -55,15 +65,19 @@
 #include "encoder.hpp"
 #include "foreach.hpp"
 #include "gate.hpp"
+#include "gzip.hpp"
 #include "synchronized.hpp"
 #include "thread.hpp"
+#include "wheel.hpp"
 
 
 using std::deque;
 using std::find;
 using std::list;
 using std::map;
+using std::make_pair;
 using std::max;
+using std::min;
 using std::ostream;
 using std::pair;
 using std::queue;
@@ -114,6 +128,21 @@ bool operator < (const Node& left, const Node& right)
 }
 
 
+bool operator == (const Node& left, const Node& right)
+{
+  return left.ip == right.ip && left.port == right.port;
+}
+
+
+size_t hash_value(const Node& node)
+{
+  size_t seed = 0;
+  boost::hash_combine(seed, node.ip);
+  boost::hash_combine(seed, node.port);
+  return seed;
+}
+
+
 ostream& operator << (ostream& stream, const Node& node)
 {
   stream << node.ip << ":" << node.port;
@@ -174,6 +203,204 @@ private:
 };
 
 
+// A run queue owned by a single processing thread. The owning thread
+// pops from the front (blocking on the lock) while other threads may
+// steal from the back, but only if they can get the lock without
+// blocking (see ProcessManager::dequeue). A dedicated run queue
+// belongs to a thread that runs exactly one process (see
+// process::dedicate) and is never stolen from. Each owning thread
+// waits at the run queue's own gate when idle, so that an enqueue
+// wakes up at most one thread (see ProcessManager::wakeup).
+class RunQueue
+{
+public:
+  explicit RunQueue(int _index)
+    : index(_index), node(-1), gate(new Gate()), idle(false), done(false)
+  {
+    pthread_mutex_init(&m, NULL);
+  }
+
+  RunQueue()
+    : index(-1), node(-1), gate(new Gate()), idle(false), done(false)
+  {
+    pthread_mutex_init(&m, NULL);
+  }
+
+  ~RunQueue()
+  {
+    pthread_mutex_destroy(&m);
+    delete gate;
+  }
+
+  void lock() { pthread_mutex_lock(&m); }
+  bool trylock() { return pthread_mutex_trylock(&m) == 0; }
+  void unlock() { pthread_mutex_unlock(&m); }
+
+  bool dedicated() const { return index == -1; }
+
+  // Index of the processing thread that owns this run queue (or -1
+  // if this is a dedicated run queue).
+  const int index;
+
+  // NUMA node of the CPU the owning thread is pinned to, or -1 if
+  // unknown (e.g., the thread isn't pinned to a CPU). Set before the
+  // owning thread gets created.
+  int node;
+
+  // Gate the owning thread waits at when idle.
+  Gate* const gate;
+
+  // Whether or not the owning thread is (about to be) waiting at the
+  // gate, i.e., whether an enqueue needs to open the gate.
+  volatile bool idle;
+
+  // Whether or not the process of a dedicated run queue has
+  // terminated, in which case the owning thread should exit (only
+  // read/written by the owning thread).
+  bool done;
+
+  // Handle of the owning thread.
+  pthread_t thread;
+
+  // Runnable processes (protected by the lock above).
+  deque<ProcessBase*> processes;
+
+private:
+  pthread_mutex_t m;
+};
+
+
+// A fiber is a stack that a processing thread runs the scheduling
+// loop (see schedule) on. When a process running on a fiber waits
+// (see ProcessManager::wait), the fiber gets suspended and the thread
+// switches to another fiber (which keeps running other processes),
+// rather than the thread blocking. Once the wait is over the fiber
+// becomes ready and the next processing thread that looks for work
+// switches to it, so the process continues (possibly on another
+// thread) where it left off. Fibers are never freed, idle fibers are
+// reused instead.
+class Fiber
+{
+public:
+  Fiber() : action(NONE), previous(NULL), pid(NULL)
+  {
+    // Allocate the stack with a guard page below it, so that
+    // overflowing the stack crashes rather than corrupting memory.
+    long page = sysconf(_SC_PAGESIZE);
+    stack = (char*) mmap(NULL, STACK_SIZE + page, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (stack == MAP_FAILED) {
+      PLOG(FATAL) << "Failed to allocate the stack of a fiber";
+    }
+    mprotect(stack, page, PROT_NONE);
+
+    getcontext(&context);
+    context.uc_stack.ss_sp = stack + page;
+    context.uc_stack.ss_size = STACK_SIZE;
+    context.uc_link = NULL;
+    makecontext(&context, run, 0);
+  }
+
+  // Size of the stack of each fiber (only the pages that get used
+  // take up memory).
+  static const size_t STACK_SIZE = 1024 * 1024;
+
+  ucontext_t context;
+
+  // What the fiber should do with the fiber that switched to it, once
+  // it is running (it can't be done before switching since another
+  // thread could switch to the previous fiber before its context has
+  // been saved): nothing, make it idle, or have it wait for the
+  // process 'pid' (see ProcessManager::switched).
+  enum Action { NONE, IDLE, WAIT } action;
+  Fiber* previous;
+  const UPID* pid;
+
+private:
+  // Not copyable, not assignable.
+  Fiber(const Fiber&);
+  Fiber& operator = (const Fiber&);
+
+  // Entry point of a fiber (see schedule).
+  static void run();
+
+  char* stack;
+};
+
+
+// An event loop and the I/O thread that runs it. Each socket is
+// assigned to one loop (see io) and its watchers are only ever
+// started and stopped by that loop's thread since libev loops are not
+// thread-safe, so other threads hand watchers off via 'start'.
+class IOLoop
+{
+public:
+  explicit IOLoop(struct ev_loop* _loop)
+    : loop(_loop), buffer(new char[BUFFER_SIZE])
+  {
+    pthread_mutex_init(&m, NULL);
+  }
+
+  ~IOLoop()
+  {
+    pthread_mutex_destroy(&m);
+    delete[] buffer;
+  }
+
+  // Starts the watcher from the loop's thread (thread-safe).
+  void start(ev_io* watcher)
+  {
+    pthread_mutex_lock(&m);
+    {
+      watchers.push(watcher);
+    }
+    pthread_mutex_unlock(&m);
+
+    wakeup();
+  }
+
+  // Interrupts the loop so that it invokes handle_async.
+  void wakeup()
+  {
+    ev_async_send(loop, &async);
+  }
+
+  // Swaps out the watchers to start (invoked by the loop's thread).
+  void swap(queue<ev_io*>* pending)
+  {
+    pthread_mutex_lock(&m);
+    {
+      std::swap(watchers, *pending);
+    }
+    pthread_mutex_unlock(&m);
+  }
+
+  struct ev_loop* const loop;
+
+  // Asynchronous watcher for interrupting the loop.
+  ev_async async;
+
+  // Timer of the watchdog (see handle_watchdog) and when it's
+  // supposed to fire next.
+  ev_timer watchdog;
+  double expected;
+
+  // Handle of the I/O thread.
+  pthread_t thread;
+
+  // Buffer for receiving data on any of the loop's sockets (only used
+  // by the loop's thread, the data gets decoded before the next
+  // receive so there's no need for a buffer per socket).
+  static const size_t BUFFER_SIZE = 80 * 1024;
+  char* const buffer;
+
+private:
+  // Watchers to start (protected by the mutex).
+  queue<ev_io*> watchers;
+  pthread_mutex_t m;
+};
+
+
 class HttpProxy;
 
 
@@ -201,16 +428,67 @@ class HttpProxy : public Process<HttpProxy>
 public:
   HttpProxy(int _c);
 
-  void handle(Future<HttpResponse>* future, bool persist);
+  void handle(Future<HttpResponse>* future,
+              bool persist,
+              const string& etags,
+              bool gzip);
   void ready(Future<HttpResponse>* future, bool persist);
   void unavailable(Future<HttpResponse>* future, bool persist);
 
+  // Sends what has been written to the stream being sent (if any).
+  void flush();
+
+  // Closes the connection if no requests came in since the given
+  // number of them had (and none are outstanding).
+  void timeout(uint64_t requests);
+
+protected:
+  virtual void finalize();
+
 private:
+  // A request, waiting for its response to be sent (responses need to
+  // be sent in the order the requests came in, see RFC 2616 8.1.2.2).
+  struct Item
+  {
+    Future<HttpResponse>* future;
+    HttpResponseWaiter* waiter;
+    bool persist;
+    string etags; // The "If-None-Match" header (if any).
+    bool gzip; // Whether the client accepts gzip encoded responses.
+    HttpResponse* response; // Once ready.
+  };
+
+  // Sets the response of a request, then sends what's in order.
+  void complete(Future<HttpResponse>* future, const HttpResponse& response);
+
+  // Sends the responses that are ready, up to the first request that
+  // is still waiting (or a stream, which needs to be sent in full).
+  void next();
+
+  // Sends a response (or starts sending a stream).
+  void respond(const HttpResponse& response, bool persist, bool gzip);
+
   int c;
-  map<Future<HttpResponse>*, HttpResponseWaiter*> waiters;
+
+  // Outstanding requests, in the order they came in, and how many
+  // came in altogether (to tell idle periods apart).
+  deque<Item*> items;
+  uint64_t requests;
+
+  // The stream being sent, whether to keep the connection afterwards,
+  // and the compressor (if the stream gets compressed).
+  std::tr1::shared_ptr<HttpStream> stream;
+  bool persist;
+  Gzip* gzip;
 };
 
 
+// How long (in seconds) to back off connecting to a node after
+// failing to connect to it the first time, and at most.
+static const double MIN_CONNECT_BACKOFF = 0.01;
+static const double MAX_CONNECT_BACKOFF = 1.0;
+
+
 class SocketManager
 {
 public:
@@ -221,45 +499,139 @@ public:
 
   PID<HttpProxy> proxy(int s);
 
+  // Returns whether to accept an HTTP request on the socket, i.e.,
+  // false if it'd take another HTTP connection than allowed (see
+  // 'max_http_connections'), and otherwise counts it as pipelined
+  // until SocketManager::responded.
+  bool admit(int s);
+
+  // Responds to an HTTP request that wasn't admitted, and closes the
+  // socket.
+  void refuse(int s);
+
+  // Returns whether to stop receiving on the socket (i.e., too many
+  // HTTP requests are pipelined on it), keeping the watcher to start
+  // again once the responses catch up (see SocketManager::responded).
+  bool pause(int s, ev_io* watcher);
+
+  // Called by the socket's proxy for each response it sent.
+  void responded(int s);
+
+  // Closes the proxy's (idle) socket, unless it's been closed already.
+  void expire(int s, HttpProxy* proxy);
+
   void send(DataEncoder* encoder, int s, bool persist);
   void send(Message* message);
 
   DataEncoder* next(int s);
 
+  // Copies up to 'max' of the encoders queued for the socket (without
+  // removing them) into 'encoders', returning how many were copied.
+  size_t peek(int s, DataEncoder** encoders, size_t max);
+
+  // Called once a connection made by the socket manager (see
+  // SocketManager::connect) has been established.
+  void connected(int s);
+
   void closed(int s);
 
   void exited(const Node& node);
   void exited(ProcessBase* process);
 
 private:
+  // Returns a new socket connecting (or connected) to the node and
+  // starts receiving on it, so that we find out when the node closes
+  // it. Every message (and link) to the node is then sent on that one
+  // socket, which is kept open until the node closes it.
+  int connect(const Node& node);
+
+  // Returns a binary encoder for sending the message on the socket
+  // (see SocketManager::send).
+  DataEncoder* encode(Message* message, int s);
+
+  // Forgets the pipelined HTTP requests of a closed socket (and the
+  // watcher for receiving on it, if paused).
+  void forget(int s);
+
+  // Note that everything below is hashed (rather than ordered) since
+  // these get looked up every time we send (or finish sending) a
+  // message, all while synchronized.
+
   // Map from UPID (local/remote) to process.
-  map<UPID, set<ProcessBase*> > links;
+  boost::unordered_map<UPID, set<ProcessBase*> > links;
 
   // Map from socket to node (ip, port).
-  map<int, Node> sockets;
+  boost::unordered_map<int, Node> sockets;
 
-  // Maps from node (ip, port) to socket.
-  map<Node, int> temps;
-  map<Node, int> persists;
+  // Maps from node (ip, port) to socket, for nodes we only send
+  // messages to and for nodes we're linked with.
+  boost::unordered_map<Node, int> temps;
+  boost::unordered_map<Node, int> persists;
+
+  // Sockets still connecting, and when (and for how long) we back off
+  // connecting to nodes we failed to connect to, in seconds (see
+  // SocketManager::send).
+  boost::unordered_set<int> connecting;
+  boost::unordered_map<Node, pair<double, double> > backoffs;
 
   // Set of sockets that should be closed.
-  set<int> disposables;
+  boost::unordered_set<int> disposables;
 
   // Map from socket to outgoing queue.
-  map<int, queue<DataEncoder*> > outgoing;
+  boost::unordered_map<int, deque<DataEncoder*> > outgoing;
+
+  // Map from socket to the strings interned so far on that socket
+  // when sending messages using the binary framing.
+  boost::unordered_map<int, BinarySymbols> symbols;
 
   // HTTP proxies.
-  map<int, HttpProxy*> proxies;
+  boost::unordered_map<int, HttpProxy*> proxies;
+
+  // Map from socket to the number of HTTP requests without responses,
+  // and to the watcher for receiving (while paused, see above).
+  boost::unordered_map<int, size_t> pipelined;
+  boost::unordered_map<int, ev_io*> paused;
 
   // Protects instance variables.
   synchronizable(this);
 };
 
 
+// A shard of the registry of all local spawned and running processes
+// (see ProcessManager::registry), so that looking up processes (e.g.,
+// for every message delivered) rarely contends on the same lock.
+class ProcessRegistry
+{
+public:
+  ProcessRegistry() { pthread_mutex_init(&m, NULL); }
+  ~ProcessRegistry() { pthread_mutex_destroy(&m); }
+
+  void lock() { pthread_mutex_lock(&m); }
+  void unlock() { pthread_mutex_unlock(&m); }
+
+  // Processes by id (protected by the lock above).
+  boost::unordered_map<string, ProcessBase*> processes;
+
+  // Gates for threads waiting on the processes (protected by the
+  // lock above).
+  map<ProcessBase*, Gate*> gates;
+
+  // Fibers waiting on the processes (protected by the lock above).
+  map<ProcessBase*, list<Fiber*> > fibers;
+
+private:
+  pthread_mutex_t m;
+};
+
+
+// Number of shards of the registry of processes.
+static const size_t REGISTRIES = 64;
+
+
 class ProcessManager
 {
 public:
-  ProcessManager();
+  explicit ProcessManager(int workers);
   ~ProcessManager();
 
   ProcessReference use(const UPID& pid);
@@ -272,7 +644,12 @@ public:
                lambda::function<void(ProcessBase*)>* f,
                ProcessBase* sender = NULL);
 
+  bool deliver(const UPID& to,
+               DispatchEvent* event,
+               ProcessBase* sender = NULL);
+
   UPID spawn(ProcessBase* process, bool manage);
+  void dedicate(ProcessBase* process);
   void resume(ProcessBase* process);
   void cleanup(ProcessBase* process);
   void link(ProcessBase* process, const UPID& to);
@@ -282,17 +659,71 @@ public:
   void enqueue(ProcessBase* process);
   ProcessBase* dequeue();
 
+  // Wakes up the owner of the run queue if it's idle, otherwise
+  // another idle processing thread (to steal from the run queue), if
+  // there is any. A NULL run queue wakes up any idle thread.
+  void wakeup(RunQueue* runq);
+
+  // Returns statistics about each process (as a JSON array).
+  string statistics();
+
+  // Returns the run queue owned by the specified processing thread.
+  RunQueue* runq(int index);
+
+  // Returns the number of (non-dedicated) processing threads.
+  int workers() const { return runqs.size(); }
+
+  // Returns the longest time any process has been waiting in the run
+  // queue of a (non-dedicated) processing thread, i.e., 0 unless all
+  // the processing threads are busy.
+  double waiting();
+
+  // Returns a fiber to switch to: one whose wait is over if there is
+  // any, otherwise an idle (or new) fiber.
+  Fiber* fiber();
+
+  // Switches the current thread from its running fiber to the
+  // specified fiber, telling that fiber what to do with the previous
+  // one (see Fiber::action). Returns once the previous fiber gets
+  // switched back to (possibly by another thread).
+  void transfer(Fiber* fiber, Fiber::Action action, const UPID* pid = NULL);
+
+  // Invoked by a fiber after it got switched to (see Fiber::action).
+  void switched();
+
+  // Switches to a fiber whose wait is over (if any), idling the
+  // running fiber. Returns whether or not there was such a fiber
+  // (once the running fiber gets switched back to).
+  bool yield();
+
+  // Returns whether or not there are fibers whose wait is over.
+  bool resumable();
+
 private:
-  // Map of all local spawned and running processes.
-  map<string, ProcessBase*> processes;
-  synchronizable(processes);
+  // Makes the fiber ready to continue (its wait is over).
+  void ready(Fiber* fiber);
 
-  // Gates for waiting threads (protected by synchronizable(processes)).
-  map<ProcessBase*, Gate*> gates;
+  // Returns the shard of the registry the process with the specified
+  // id is (or would be) in.
+  ProcessRegistry* registry(const string& id)
+  {
+    return &registries[boost::hash<string>()(id) % REGISTRIES];
+  }
+
+  // All local spawned and running processes (sharded by id).
+  ProcessRegistry registries[REGISTRIES];
+
+  // Fibers whose wait is over and idle fibers.
+  deque<Fiber*> readies;
+  vector<Fiber*> idles;
+  synchronizable(fibers);
+
+  // Run queues of runnable processes, one per processing thread.
+  vector<RunQueue*> runqs;
 
-  // Queue of runnable processes (implemented using list).
-  list<ProcessBase*> runq;
-  synchronizable(runq);
+  // Used to spread processes that have no affinity (and aren't
+  // enqueued from a processing thread) across the run queues.
+  int next;
 };
 
 
@@ -308,17 +739,78 @@ static uint32_t ip = 0;
 // Local port.
 static uint16_t port = 0;
 
+// Whether or not to send messages to remote processes using the
+// binary framing rather than as HTTP requests (see
+// BinaryMessageEncoder). All peers must be able to decode the binary
+// framing, which is true for all peers running this version of the
+// library (the decoder detects the framing per connection).
+static bool binary = false;
+
+// Minimum size (in bytes) of the bodies of messages to remote
+// processes that get gzipped before they're sent (0 means messages
+// never get compressed). Like the binary framing, all peers must be
+// able to decode compressed messages, which is true for all peers
+// running this version of the library.
+static size_t compression_threshold = 0;
+
+// Maximum size (in bytes) of a message from a remote process (i.e.,
+// of its frame or request body, and of its body once decompressed),
+// beyond which the connection it came in on gets failed. Can be
+// overridden via the environment variable LIBPROCESS_MAX_MESSAGE_SIZE.
+static size_t max_message_size = DEFAULT_MAX_MESSAGE_SIZE;
+
+// Directory with the Unix domain sockets (named by ip and port) that
+// the processes on this host accept connections on besides TCP, which
+// saves going through TCP loopback (see LIBPROCESS_SOCKET_DIR). All
+// the processes on a host that want to use them need the same
+// directory. Empty if Unix domain sockets aren't used.
+static string socket_dir;
+
+// Local Unix domain server socket (if any), and its path (which gets
+// removed when we exit, see 'unlink_socket').
+static int local_s = -1;
+static string local_path;
+
 // Active SocketManager (eventually will probably be thread-local).
 static SocketManager* socket_manager = NULL;
 
 // Active ProcessManager (eventually will probably be thread-local).
 static ProcessManager* process_manager = NULL;
 
-// Event loop.
-static struct ev_loop* loop = NULL;
+// Event loops (constructed in 'initialize'). The first loop also
+// accepts connections and handles the timers.
+static vector<IOLoop*> loops;
+
+// Returns the loop that socket 's' is assigned to.
+static IOLoop* io(int s)
+{
+  return loops[s % loops.size()];
+}
+
+// Returns the path of the Unix domain socket for an ip and port (the
+// processes sharing the directory might be bound to different ips).
+static string socket_path(uint32_t ip, uint16_t port)
+{
+  char temp[INET_ADDRSTRLEN];
+  if (inet_ntop(AF_INET, (in_addr *) &ip, temp, INET_ADDRSTRLEN) == NULL) {
+    PLOG(FATAL) << "Failed to get the path of a Unix domain socket, inet_ntop";
+  }
+
+  std::ostringstream out;
+  out << socket_dir << "/" << temp << ":" << port;
+  return out.str();
+}
+
+// Removes our Unix domain socket (registered with atexit), but not
+// from a forked child that exits (the socket is still its parent's).
+static pid_t local_pid = -1;
 
-// Asynchronous watcher for interrupting loop.
-static ev_async async_watcher;
+static void unlink_socket()
+{
+  if (getpid() == local_pid) {
+    unlink(local_path.c_str());
+  }
+}
 
 // Watcher for timeouts.
 static ev_timer timeouts_watcher;
@@ -326,21 +818,60 @@ static ev_timer timeouts_watcher;
 // Server watcher for accepting connections.
 static ev_io server_watcher;
 
-// Queue of I/O watchers.
-static queue<ev_io*>* watchers = new queue<ev_io*>();
-static synchronizable(watchers) = SYNCHRONIZED_INITIALIZER;
+// Watcher for accepting connections on the Unix domain socket.
+static ev_io local_watcher;
 
-// We store the timers in a map of lists indexed by the timeout of the
-// timer so that we can have two timers that have the same timeout. We
-// exploit that the map is SORTED!
-static map<double, list<timer> >* timeouts =
-  new map<double, list<timer> >();
+// We store the timers in a timing wheel so that adding and canceling
+// a timer doesn't depend on how many other timers there are.
+static TimerWheel* timeouts = new TimerWheel(ev_time());
 static synchronizable(timeouts) = SYNCHRONIZED_INITIALIZER_RECURSIVE;
 
 // Flag to indicate whether or to update the timer on async interrupt.
 static bool update_timer = false;
 
-const int NUMBER_OF_PROCESSING_THREADS = 4; // TODO(benh): Do 2x cores.
+// Maximum number of encoders (and bytes, after the first encoder) to
+// send on a socket with a single system call.
+const size_t MAX_SEND_IOVECS = 64;
+const size_t MAX_SEND_BYTES = 1024 * 1024;
+
+// Default maximum number of events a process services each time it
+// gets run (see ProcessBase::batch).
+const size_t DEFAULT_EVENTS_PER_BATCH = 64;
+
+// Maximum number of HTTP connections (i.e., proxies), of requests
+// pipelined on each of them (no more gets received from a connection
+// until responses catch up), and the seconds before closing an idle
+// connection (0 to never). Can be overridden via the environment
+// variables LIBPROCESS_MAX_HTTP_CONNECTIONS,
+// LIBPROCESS_MAX_PIPELINED_REQUESTS and LIBPROCESS_HTTP_IDLE_TIMEOUT.
+static size_t max_http_connections = 1024;
+static size_t max_pipelined_requests = 32;
+static double http_idle_timeout = 60.0;
+
+// How often each I/O loop checks how far behind it is running (see
+// handle_watchdog), and how far behind an I/O loop, or a process
+// waiting in a run queue, has to be before a warning gets logged (0
+// to never warn). The threshold can be overridden via the environment
+// variable LIBPROCESS_LAG_THRESHOLD.
+const double WATCHDOG_INTERVAL = 0.1;
+static double lag_threshold = 0.5;
+
+// Minimum size of a response body worth compressing (smaller bodies
+// barely shrink, if at all).
+const size_t GZIP_MINIMUM_SIZE = 1024;
+
+// Minimum number of processing threads used by default. The default
+// is otherwise one per online core (the threads only run processes,
+// so more than that just contend for the cores), but a process that
+// blocks (e.g., in Future::await) takes its thread out of rotation
+// until it's done, so on small machines we keep the four threads that
+// used to be the fixed number. Can be overridden via
+// LIBPROCESS_NUM_WORKER_THREADS.
+const int MINIMUM_NUMBER_OF_PROCESSING_THREADS = 4;
+
+// Number of online cores per I/O thread used by default (can be
+// overridden via LIBPROCESS_NUM_IO_THREADS).
+const int CORES_PER_IO_THREAD = 4;
 
 
 // Thread local process pointer magic (constructed in
@@ -351,19 +882,117 @@ static ThreadLocal<ProcessBase>* _process_ = NULL;
 
 #define __process__ (*_process_)
 
+// Thread local run queue pointer (constructed in 'initialize'), only
+// non-null for the processing threads (i.e., those running schedule).
+static ThreadLocal<RunQueue>* _runq_ = NULL;
+
+#define __runq__ (*_runq_)
+
+
+// Hints to the CPU that we're spinning (e.g., waiting for another
+// thread to release something), which on x86 frees up resources for
+// its hyperthread sibling. Elsewhere we yield the CPU instead (which
+// is also a compiler barrier, since it's an opaque call).
+static inline void cpu_relax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+  asm volatile ("pause" ::: "memory");
+#else
+  sched_yield();
+#endif
+}
+
+// Thread local fiber pointer (constructed in 'initialize'), only
+// non-null for the (non-dedicated) processing threads, which run the
+// scheduling loop on fibers (see Fiber).
+static ThreadLocal<Fiber>* _fiber_ = NULL;
+
+#define __fiber__ (*_fiber_)
+
+
+// Times an idle processing thread looks for a process to run (or a
+// fiber to continue) again before waiting at its gate, since a
+// process often becomes runnable again right away.
+static const int IDLE_SPINS = 64;
+
+// Processes stolen by a processing thread on another NUMA node and
+// events enqueued by a processing thread on another NUMA node than
+// the receiver last ran on (see RunQueue::node).
+static metrics::Counter remote_steals(
+    "libprocess_numa_remote_steals_total",
+    "Processes stolen by a processing thread on another NUMA node");
+
+static metrics::Counter remote_events(
+    "libprocess_numa_remote_events_total",
+    "Events enqueued from a processing thread on another NUMA node");
 
-// Scheduler gate.
-static Gate* gate = new Gate();
+// How late the watchdog timer of an I/O loop fires (i.e., how long
+// the loop takes to get around to events) and how long processes wait
+// in a run queue before a processing thread runs them.
+static metrics::Timer loop_lags(
+    "libprocess_io_loop_lag_seconds",
+    "Time the I/O loops are running behind");
+
+static metrics::Timer runq_waits(
+    "libprocess_run_queue_wait_seconds",
+    "Time processes spend waiting in a run queue to be run");
 
 // Filter. Synchronized support for using the filterer needs to be
 // recursive incase a filterer wants to do anything fancy (which is
 // possible and likely given that filters will get used for testing).
-static Filter* filterer = NULL;
+static Filter* volatile filterer = NULL;
 static synchronizable(filterer) = SYNCHRONIZED_INITIALIZER_RECURSIVE;
 
 // Global garbage collector.
 PID<GarbageCollector> gc;
 
+
+// Serves statistics about every process at /__processes__, e.g., to
+// find processes whose mailboxes keep growing.
+class ProcessesProcess : public Process<ProcessesProcess>
+{
+public:
+  ProcessesProcess() : ProcessBase("__processes__") {}
+
+protected:
+  virtual void initialize()
+  {
+    route("", &ProcessesProcess::processes);
+  }
+
+private:
+  Future<HttpResponse> processes(const HttpRequest& request)
+  {
+    HttpOKResponse response;
+    response.headers["Content-Type"] = "application/json";
+    response.body = process_manager->statistics();
+    return response;
+  }
+};
+
+
+// Serves all the metrics (see process/metrics.hpp) at /metrics.
+class MetricsProcess : public Process<MetricsProcess>
+{
+public:
+  MetricsProcess() : ProcessBase("metrics") {}
+
+protected:
+  virtual void initialize()
+  {
+    route("", &MetricsProcess::render);
+  }
+
+private:
+  Future<HttpResponse> render(const HttpRequest& request)
+  {
+    HttpOKResponse response;
+    response.headers["Content-Type"] = "text/plain; version=0.0.4";
+    response.body = metrics::text();
+    return response;
+  }
+};
+
 // Thunks to be invoked via process::invoke.
 static queue<lambda::function<void(void)>*>* thunks =
   new queue<lambda::function<void(void)>*>();
@@ -385,7 +1014,9 @@ map<ProcessBase*, double>* currents = new map<ProcessBase*, double>();
 double initial = 0;
 double current = 0;
 
-bool paused = false;
+// Only changes with the timeouts lock held, but gets read without it
+// (see Clock::now).
+volatile bool paused = false;
 
 } // namespace clock {
 
@@ -398,6 +1029,13 @@ double Clock::now()
 
 double Clock::now(ProcessBase* process)
 {
+  // Most of the time the clock isn't paused, so check that without
+  // taking the (global) timeouts lock. A caller racing with a pause
+  // or resume couldn't tell which time it got anyway.
+  if (!clock::paused) {
+    return ev_time();
+  }
+
   synchronized (timeouts) {
     if (Clock::paused()) {
       if (process != NULL) {
@@ -417,6 +1055,29 @@ double Clock::now(ProcessBase* process)
 }
 
 
+double Clock::coarse()
+{
+  if (clock::paused) {
+    return now();
+  }
+
+#ifdef CLOCK_REALTIME_COARSE
+  struct timespec ts;
+  if (clock_gettime(CLOCK_REALTIME_COARSE, &ts) == 0) {
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+  }
+#endif
+
+  return ev_time();
+}
+
+
+double Clock::real()
+{
+  return ev_time();
+}
+
+
 void Clock::pause()
 {
   process::initialize(); // For the libev watchers to be setup.
@@ -452,8 +1113,9 @@ void Clock::resume()
               << std::fixed << std::setprecision(9) << clock::current;
       clock::paused = false;
       clock::currents->clear();
+      timeouts->rebase(ev_time()); // Time might go "backwards".
       update_timer = true;
-      ev_async_send(loop, &async_watcher);
+      loops[0]->wakeup();
     }
   }
 }
@@ -469,7 +1131,7 @@ void Clock::advance(double secs)
               << " seconds) to " << clock::current;
       if (!update_timer) {
         update_timer = true;
-        ev_async_send(loop, &async_watcher);
+        loops[0]->wakeup();
       }
     }
   }
@@ -488,7 +1150,7 @@ void Clock::update(double secs)
                 << std::fixed << std::setprecision(9) << clock::current;
         if (!update_timer) {
           update_timer = true;
-          ev_async_send(loop, &async_watcher);
+          loops[0]->wakeup();
         }
       }
     }
@@ -552,7 +1214,8 @@ void transport(Message* message, ProcessBase* sender = NULL)
     // Local message.
     process_manager->deliver(message, sender);
   } else {
-    // Remote message.
+    // Remote message (whose payload, if any, gets serialized when
+    // it's encoded, see Message::data).
     socket_manager->send(message);
   }
 }
@@ -584,7 +1247,7 @@ Message* parse(HttpRequest* request)
       message->name = name;
       message->from = from;
       message->to = to;
-      message->body = request->body;
+      message->body.swap(request->body); // Request gets deleted.
 
       return message;
     }
@@ -594,22 +1257,29 @@ Message* parse(HttpRequest* request)
 }
 
 
-void handle_async(struct ev_loop* loop, ev_async* _, int revents)
+void handle_async(struct ev_loop* loop, ev_async* watcher, int revents)
 {
-  synchronized (watchers) {
-    // Start all the new I/O watchers.
-    while (!watchers->empty()) {
-      ev_io* watcher = watchers->front();
-      watchers->pop();
-      ev_io_start(loop, watcher);
-    }
+  IOLoop* io = (IOLoop*) watcher->data;
+
+  // Start all the new I/O watchers.
+  queue<ev_io*> pending;
+  io->swap(&pending);
+
+  while (!pending.empty()) {
+    ev_io_start(loop, pending.front());
+    pending.pop();
+  }
+
+  // Only the first loop handles the timers.
+  if (io != loops[0]) {
+    return;
   }
 
   synchronized (timeouts) {
     if (update_timer) {
       if (!timeouts->empty()) {
 	// Determine when the next timer should fire.
-	timeouts_watcher.repeat = timeouts->begin()->first - Clock::now();
+	timeouts_watcher.repeat = timeouts->next() - Clock::now();
 
         if (timeouts_watcher.repeat <= 0) {
 	  // Feed the event now!
@@ -634,6 +1304,50 @@ void handle_async(struct ev_loop* loop, ev_async* _, int revents)
 }
 
 
+// Invoked every WATCHDOG_INTERVAL seconds by each I/O loop, records
+// how late the loop got around to invoking it (the loop's thread was
+// busy or starved for that long, and so was every socket and timer of
+// the loop). The first loop also looks for processes that have been
+// waiting to run for too long, i.e., for the processing threads
+// falling behind.
+void handle_watchdog(struct ev_loop* loop, ev_timer* watcher, int revents)
+{
+  IOLoop* io = (IOLoop*) watcher->data;
+
+  const double now = ev_time();
+  const double lag = std::max(0.0, now - io->expected);
+
+  loop_lags.record(lag);
+
+  // Don't warn more than once a second (per loop), the lag gets
+  // recorded regardless.
+  static __thread double warned = 0;
+
+  if (lag_threshold > 0 && lag >= lag_threshold && now - warned >= 1) {
+    LOG(WARNING) << "An I/O thread is running " << std::fixed
+                 << std::setprecision(3) << lag << " seconds behind";
+    warned = now;
+  }
+
+  if (io == loops[0] && lag_threshold > 0 && now - warned >= 1) {
+    const double waiting = process_manager->waiting();
+    if (waiting >= lag_threshold) {
+      LOG(WARNING) << "A process has been waiting " << std::fixed
+                   << std::setprecision(3) << waiting << " seconds to run"
+                   << " (all " << process_manager->workers()
+                   << " processing threads are busy)";
+      warned = now;
+    }
+  }
+
+  // Not a repeating timer since the loop reschedules those relative to
+  // when they should have fired (rather than from now).
+  io->expected = ev_now(loop) + WATCHDOG_INTERVAL;
+  ev_timer_set(watcher, WATCHDOG_INTERVAL, 0.);
+  ev_timer_start(loop, watcher);
+}
+
+
 void handle_timeouts(struct ev_loop* loop, ev_timer* _, int revents)
 {
   list<timer> timedout;
@@ -644,29 +1358,18 @@ void handle_timeouts(struct ev_loop* loop, ev_timer* _, int revents)
     VLOG(1) << "Handling timeouts up to "
             << std::fixed << std::setprecision(9) << now;
 
-    foreachkey (double timeout, *timeouts) {
-      if (timeout > now) {
-        break;
-      }
-
-      VLOG(2) << "Have timeout(s) at "
-              << std::fixed << std::setprecision(9) << timeout;
-
-      foreach (const timer& timer, (*timeouts)[timeout]) {
-        timedout.push_back(timer);
-      }
-    }
+    // Remove all the timers that timed out.
+    timeouts->expire(now, &timedout);
 
-    // Now erase the range of timeouts that timed out.
-    timeouts->erase(timeouts->begin(), timeouts->upper_bound(now));
+    VLOG(2) << "Have " << timedout.size() << " timeout(s)";
 
     // Okay, so the timeout for the next timer should not have fired.
-    CHECK(timeouts->empty() || (timeouts->begin()->first > now));
+    CHECK(timeouts->empty() || (timeouts->next() > now));
 
     // Update the timer as necessary.
     if (!timeouts->empty()) {
       // Determine when the next timer should fire.
-      timeouts_watcher.repeat = timeouts->begin()->first - Clock::now();
+      timeouts_watcher.repeat = timeouts->next() - Clock::now();
 
       if (timeouts_watcher.repeat <= 0) {
         // Feed the event now!
@@ -692,10 +1395,11 @@ void handle_timeouts(struct ev_loop* loop, ev_timer* _, int revents)
   // be necessary to actually add some more synchronization around
   // this so that, for example, pausing and resuming the clock doesn't
   // cause some processes to get thier current times updated and
-  // others not. Since ProcessManager::use acquires the 'processes'
-  // lock we had to move this out of the synchronized (timeouts) above
-  // since there was a deadlock with acquring 'processes' then
-  // 'timeouts' (reverse order) in ProcessManager::cleanup. Note that
+  // others not. Since ProcessManager::use acquires the lock of (a
+  // shard of) the registry we had to move this out of the
+  // synchronized (timeouts) above since there was a deadlock with
+  // acquring the registry then 'timeouts' (reverse order) in
+  // ProcessManager::cleanup. Note that
   // current time may be greater than the timeout if a local message
   // was received (and happens-before kicks in).
   if (Clock::paused()) {
@@ -720,13 +1424,10 @@ void recv_data(struct ev_loop *loop, ev_io *watcher, int revents)
   
   int c = watcher->fd;
 
-  while (true) {
-    const ssize_t size = 80 * 1024;
-    ssize_t length = 0;
+  char* data = io(c)->buffer;
 
-    char data[size];
-
-    length = recv(c, data, size, 0);
+  while (true) {
+    ssize_t length = recv(c, data, IOLoop::BUFFER_SIZE, 0);
 
     if (length < 0 && (errno == EINTR)) {
       // Interrupted, try again now.
@@ -750,14 +1451,28 @@ void recv_data(struct ev_loop *loop, ev_io *watcher, int revents)
     } else {
       CHECK(length > 0);
 
-      // Decode as much of the data as possible into HTTP requests.
-      const deque<HttpRequest*>& requests = decoder->decode(data, length);
+      // Decode as much of the data as possible into HTTP requests (or
+      // messages if the peer is using the binary framing).
+      decoder->decode(data, length);
 
-      if (!requests.empty()) {
+      const deque<HttpRequest*>& requests = decoder->requests();
+      const deque<Message*>& messages = decoder->messages();
+
+      if (!requests.empty() || !messages.empty()) {
         foreach (HttpRequest* request, requests) {
           process_manager->deliver(c, request);
         }
-      } else if (requests.empty() && decoder->failed()) {
+        foreach (Message* message, messages) {
+          process_manager->deliver(message);
+        }
+
+        // Stop receiving while too many HTTP requests are waiting for
+        // their responses (see SocketManager::responded).
+        if (!requests.empty() && socket_manager->pause(c, watcher)) {
+          ev_io_stop(loop, watcher);
+          break;
+        }
+      } else if (decoder->failed()) {
         VLOG(2) << "Decoder error while receiving";
         socket_manager->closed(c);
         delete decoder;
@@ -777,26 +1492,73 @@ void send_data(struct ev_loop *loop, ev_io *watcher, int revents)
   int c = watcher->fd;
 
   while (true) {
-    const void* data;
-    size_t size;
+    // Send the rest of the current encoder along with as many of the
+    // encoders queued up behind it as we can in a single call. The
+    // queued encoders stay queued (and the current encoder stays
+    // current) until all of their data has been sent, so that we can
+    // just back up any of them we didn't get to.
+    DataEncoder* encoders[MAX_SEND_IOVECS];
+    struct iovec iov[MAX_SEND_IOVECS];
 
-    data = encoder->next(&size);
-    CHECK(size > 0);
+    encoders[0] = encoder;
 
-    ssize_t length = send(c, data, size, MSG_NOSIGNAL);
+    size_t count = 1 +
+      socket_manager->peek(c, encoders + 1, MAX_SEND_IOVECS - 1);
 
-    if (length < 0 && (errno == EINTR)) {
-      // Interrupted, try again now.
-      encoder->backup(size);
-      continue;
-    } else if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-      // Might block, try again later.
-      encoder->backup(size);
-      break;
-    } else if (length <= 0) {
-      // Socket error or closed.
-      if (length < 0) {
-        const char* error = strerror(errno);
+    size_t size = 0;
+
+    // Files get sent on their own (straight from the file), so stop
+    // at the first one queued up (see FileEncoder).
+    FileEncoder* file = dynamic_cast<FileEncoder*>(encoder);
+
+    if (file != NULL) {
+      count = 1;
+      iov[0].iov_len = 0;
+    }
+
+    for (size_t i = 0; file == NULL && i < count; i++) {
+      if (i > 0 &&
+          (size >= MAX_SEND_BYTES ||
+           dynamic_cast<FileEncoder*>(encoders[i]) != NULL)) {
+        count = i;
+        break;
+      }
+      iov[i].iov_base = (void*) encoders[i]->next(&iov[i].iov_len);
+      CHECK(iov[i].iov_len > 0);
+      size += iov[i].iov_len;
+    }
+
+    ssize_t length = 0;
+
+    if (file != NULL) {
+      length = file->send(c);
+    } else {
+      // We use sendmsg rather than writev to be able to pass
+      // MSG_NOSIGNAL.
+      struct msghdr message;
+      memset(&message, 0, sizeof(message));
+      message.msg_iov = iov;
+      message.msg_iovlen = count;
+
+      length = sendmsg(c, &message, MSG_NOSIGNAL);
+    }
+
+    if (length < 0 && (errno == EINTR)) {
+      // Interrupted, try again now.
+      for (size_t i = 0; i < count; i++) {
+        encoders[i]->backup(iov[i].iov_len);
+      }
+      continue;
+    } else if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // Might block, try again later.
+      for (size_t i = 0; i < count; i++) {
+        encoders[i]->backup(iov[i].iov_len);
+      }
+      break;
+    } else if (length <= 0) {
+      // Socket error or closed.
+      if (length < 0) {
+        const char* error = strerror(errno);
         VLOG(2) << "Socket error while sending: " << error;
       } else {
         VLOG(2) << "Socket closed while sending";
@@ -809,11 +1571,23 @@ void send_data(struct ev_loop *loop, ev_io *watcher, int revents)
     } else {
       CHECK(length > 0);
 
-      // Update the encoder with the amount sent.
-      encoder->backup(size - length);
+      // Update the encoders with the amount sent.
+      size_t sent = length;
+      for (size_t i = 0; i < count; i++) {
+        if (sent >= iov[i].iov_len) {
+          sent -= iov[i].iov_len;
+        } else {
+          encoders[i]->backup(iov[i].iov_len - sent);
+          sent = 0;
+        }
+      }
+
+      // Move past all of the encoders that are done, which in turn
+      // dequeues the ones we sent from behind the current encoder.
+      bool done = false;
 
-      // See if there is any more of the message to send.
-      if (encoder->remaining() == 0) {
+      for (size_t i = 0; i < count && encoder->remaining() == 0; i++) {
+        CHECK(encoder == encoders[i]);
         delete encoder;
 
         // Check for more stuff to send on socket.
@@ -824,35 +1598,15 @@ void send_data(struct ev_loop *loop, ev_io *watcher, int revents)
           // Nothing more to send right now, clean up.
           ev_io_stop(loop, watcher);
           delete watcher;
+          done = true;
           break;
         }
       }
-    }
-  }
-}
-
-
-void sending_connect(struct ev_loop *loop, ev_io *watcher, int revents)
-{
-  int c = watcher->fd;
-
-  // Now check that a successful connection was made.
-  int opt;
-  socklen_t optlen = sizeof(opt);
 
-  if (getsockopt(c, SOL_SOCKET, SO_ERROR, &opt, &optlen) < 0 || opt != 0) {
-    // Connect failure.
-    VLOG(1) << "Socket error while connecting";
-    socket_manager->closed(c);
-    MessageEncoder* encoder = (MessageEncoder*) watcher->data;
-    delete encoder;
-    ev_io_stop(loop, watcher);
-    delete watcher;
-  } else {
-    // We're connected! Now let's do some sending.
-    ev_io_stop(loop, watcher);
-    ev_io_init(watcher, send_data, c, EV_WRITE);
-    ev_io_start(loop, watcher);
+      if (done) {
+        break;
+      }
+    }
   }
 }
 
@@ -875,6 +1629,7 @@ void receiving_connect(struct ev_loop *loop, ev_io *watcher, int revents)
     delete watcher;
   } else {
     // We're connected! Now let's do some receiving.
+    socket_manager->connected(c);
     ev_io_stop(loop, watcher);
     ev_io_init(watcher, recv_data, c, EV_READ);
     ev_io_start(loop, watcher);
@@ -900,19 +1655,27 @@ void accept(struct ev_loop *loop, ev_io *watcher, int revents)
     return;
   }
 
-  // Turn off Nagle (via TCP_NODELAY) so pipelined requests don't wait.
+  // Turn off Nagle (via TCP_NODELAY) so pipelined requests don't
+  // wait (not applicable to Unix domain sockets).
   int on = 1;
-  if (setsockopt(c, SOL_TCP, TCP_NODELAY, &on, sizeof(on)) < 0) {
+  if (watcher != &local_watcher &&
+      setsockopt(c, SOL_TCP, TCP_NODELAY, &on, sizeof(on)) < 0) {
     close(c);
   } else {
     // Allocate and initialize the decoder and watcher.
-    DataDecoder* decoder = new DataDecoder();
+    DataDecoder* decoder = new DataDecoder(max_message_size);
 
     ev_io *watcher = new ev_io();
     watcher->data = decoder;
 
     ev_io_init(watcher, recv_data, c, EV_READ);
-    ev_io_start(loop, watcher);
+
+    // Hand the connection off to the loop it's assigned to.
+    if (io(c)->loop == loop) {
+      ev_io_start(loop, watcher);
+    } else {
+      io(c)->start(watcher);
+    }
   }
 }
 
@@ -925,24 +1688,188 @@ void* serve(void* arg)
 }
 
 
-void* schedule(void* arg)
+// The scheduling loop of a processing thread. Note that the loop
+// might be running on a fiber, which can move between threads (but
+// only between the non-dedicated processing threads), hence we look
+// at the thread's run queue every time around.
+static void loop()
 {
-  __process__ = NULL; // Start off not running anything.
-
   do {
+    // Continue any fiber whose wait is over first, it's in the
+    // middle of running a process.
+    if (__fiber__ != NULL && process_manager->yield()) {
+      continue;
+    }
+
+    RunQueue* runq = __runq__;
+
     ProcessBase* process = process_manager->dequeue();
+
+    // Spin for a bit before going idle (dedicated threads, which
+    // don't run on fibers, only ever run one process so they go idle
+    // right away).
+    for (int i = 0; __fiber__ != NULL && i < IDLE_SPINS; i++) {
+      if (process != NULL || process_manager->resumable()) {
+        break;
+      }
+      cpu_relax();
+      process = process_manager->dequeue();
+    }
+
     if (process == NULL) {
-      Gate::state_t old = gate->approach();
+      // Mark ourselves idle *before* looking one last time, so that
+      // an enqueue either gets seen here or opens the gate (the
+      // enqueuer checks for idleness after enqueuing).
+      Gate::state_t old = runq->gate->approach();
+      runq->idle = true;
+      __sync_synchronize();
       process = process_manager->dequeue();
       if (process == NULL) {
-	gate->arrive(old); // Wait at gate if idle.
+        if (__fiber__ != NULL && process_manager->resumable()) {
+          runq->gate->leave();
+        } else {
+          runq->gate->arrive(old); // Wait at gate if idle.
+        }
+        runq->idle = false;
 	continue;
       } else {
-	gate->leave();
+        runq->idle = false;
+	runq->gate->leave();
       }
     }
     process_manager->resume(process);
-  } while (true);
+  } while (!__runq__->done);
+}
+
+
+void Fiber::run()
+{
+  process_manager->switched();
+  loop();
+
+  // Only dedicated run queues are ever done, and dedicated threads
+  // don't run on fibers.
+  LOG(FATAL) << "Fiber finished running the scheduling loop";
+}
+
+
+void* schedule(void* arg)
+{
+  __process__ = NULL; // Start off not running anything.
+
+  // Claim the run queue for this processing thread.
+  RunQueue* runq = (RunQueue*) arg;
+
+  __runq__ = runq;
+
+  // Processing threads run the scheduling loop on fibers (and never
+  // come back to this stack), dedicated threads on their own stack
+  // since they only ever run their process anyway.
+  if (!runq->dedicated()) {
+    Fiber* fiber = new Fiber();
+    __fiber__ = fiber;
+    setcontext(&fiber->context);
+    LOG(FATAL) << "Failed to switch to a fiber";
+  }
+
+  loop();
+
+  // Only a dedicated thread stops, after its process has terminated
+  // (at which point nothing else can refer to its run queue).
+  CHECK(runq->dedicated());
+
+  __runq__ = NULL;
+
+  delete runq;
+
+  return NULL;
+}
+
+
+// Parses a list of CPUs like "0-3,8,10-11" (the format used by
+// taskset(1) and /sys/devices/system/cpu) into 'cpus'. Returns false
+// if the list is malformed.
+static bool parse_cpus(const char* value, vector<int>* cpus)
+{
+  const char* s = value;
+
+  while (*s != '\0') {
+    char* end;
+    long first = strtol(s, &end, 10);
+    if (end == s || first < 0) {
+      return false;
+    }
+
+    long last = first;
+    s = end;
+
+    if (*s == '-') {
+      s++;
+      last = strtol(s, &end, 10);
+      if (end == s || last < first) {
+        return false;
+      }
+      s = end;
+    }
+
+    for (long cpu = first; cpu <= last; cpu++) {
+      cpus->push_back(cpu);
+    }
+
+    if (*s == ',') {
+      s++;
+    } else if (*s != '\0') {
+      return false;
+    }
+  }
+
+  return !cpus->empty();
+}
+
+
+// Returns the NUMA node of the specified CPU, or -1 if unknown.
+static int numa(int cpu)
+{
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+
+  DIR* dir = opendir(path);
+  if (dir == NULL) {
+    return -1;
+  }
+
+  int node = -1;
+  struct dirent* entry;
+  while (node < 0 && (entry = readdir(dir)) != NULL) {
+    if (sscanf(entry->d_name, "node%d", &node) != 1) {
+      node = -1;
+    }
+  }
+
+  closedir(dir);
+
+  return node;
+}
+
+
+// Restricts the specified thread to run only on the specified CPUs.
+static void pin(pthread_t thread, const vector<int>& cpus)
+{
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  foreach (int cpu, cpus) {
+    CPU_SET(cpu, &set);
+  }
+
+  int result = pthread_setaffinity_np(thread, sizeof(cpu_set_t), &set);
+  if (result != 0) {
+    LOG(WARNING) << "Failed to set CPU affinity of thread: "
+                 << strerror(result);
+  }
+#else
+  LOG(WARNING) << "Setting CPU affinity of threads is not supported";
+#endif // __linux__
 }
 
 
@@ -1016,8 +1943,102 @@ void initialize(bool initialize_google_logging)
   signal(SIGPIPE, SIG_IGN);
 #endif // __sun__
 
+  char *value;
+
+  // Check environment for the number of processing threads.
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  int workers = std::max(MINIMUM_NUMBER_OF_PROCESSING_THREADS, (int) cores);
+
+  value = getenv("LIBPROCESS_NUM_WORKER_THREADS");
+  if (value != NULL) {
+    workers = atoi(value);
+    if (workers <= 0) {
+      LOG(FATAL) << "LIBPROCESS_NUM_WORKER_THREADS=" << value
+                 << " is not a valid number of threads";
+    }
+  }
+
+  // Check environment for the CPUs to run the processing threads on.
+  vector<int> worker_cpus;
+
+  value = getenv("LIBPROCESS_WORKER_CPUS");
+  if (value != NULL && !parse_cpus(value, &worker_cpus)) {
+    LOG(FATAL) << "LIBPROCESS_WORKER_CPUS=" << value
+               << " is not a valid list of CPUs";
+  }
+
+  // Check environment for the number of I/O threads.
+  int threads = std::max(1, (int) (cores / CORES_PER_IO_THREAD));
+
+  value = getenv("LIBPROCESS_NUM_IO_THREADS");
+  if (value != NULL) {
+    threads = atoi(value);
+    if (threads <= 0) {
+      LOG(FATAL) << "LIBPROCESS_NUM_IO_THREADS=" << value
+                 << " is not a valid number of threads";
+    }
+  }
+
+  // Check environment for the CPUs to run the I/O threads on.
+  vector<int> io_cpus;
+
+  value = getenv("LIBPROCESS_IO_CPUS");
+  if (value != NULL && !parse_cpus(value, &io_cpus)) {
+    LOG(FATAL) << "LIBPROCESS_IO_CPUS=" << value
+               << " is not a valid list of CPUs";
+  }
+
+  // Check environment for the limits on HTTP connections.
+  value = getenv("LIBPROCESS_MAX_HTTP_CONNECTIONS");
+  if (value != NULL) {
+    int connections = atoi(value);
+    if (connections <= 0) {
+      LOG(FATAL) << "LIBPROCESS_MAX_HTTP_CONNECTIONS=" << value
+                 << " is not a valid number of connections";
+    }
+    max_http_connections = connections;
+  }
+
+  value = getenv("LIBPROCESS_MAX_PIPELINED_REQUESTS");
+  if (value != NULL) {
+    int requests = atoi(value);
+    if (requests <= 0) {
+      LOG(FATAL) << "LIBPROCESS_MAX_PIPELINED_REQUESTS=" << value
+                 << " is not a valid number of requests";
+    }
+    max_pipelined_requests = requests;
+  }
+
+  value = getenv("LIBPROCESS_HTTP_IDLE_TIMEOUT");
+  if (value != NULL) {
+    http_idle_timeout = atof(value);
+    if (http_idle_timeout < 0) {
+      LOG(FATAL) << "LIBPROCESS_HTTP_IDLE_TIMEOUT=" << value
+                 << " is not a valid number of seconds";
+    }
+  }
+
+  value = getenv("LIBPROCESS_MAX_MESSAGE_SIZE");
+  if (value != NULL) {
+    long size = atol(value);
+    if (size <= 0) {
+      LOG(FATAL) << "LIBPROCESS_MAX_MESSAGE_SIZE=" << value
+                 << " is not a valid number of bytes";
+    }
+    max_message_size = size;
+  }
+
+  value = getenv("LIBPROCESS_LAG_THRESHOLD");
+  if (value != NULL) {
+    lag_threshold = atof(value);
+    if (lag_threshold < 0) {
+      LOG(FATAL) << "LIBPROCESS_LAG_THRESHOLD=" << value
+                 << " is not a valid number of seconds";
+    }
+  }
+
   // Create a new ProcessManager and SocketManager.
-  process_manager = new ProcessManager();
+  process_manager = new ProcessManager(workers);
   socket_manager = new SocketManager();
 
   // Setup the thread local process pointer.
@@ -1028,19 +2049,44 @@ void initialize(bool initialize_google_logging)
 
   _process_ = new ThreadLocal<ProcessBase>(key);
 
-  // Setup processing threads.
-  for (int i = 0; i < NUMBER_OF_PROCESSING_THREADS; i++) {
-    pthread_t thread; // For now, not saving handles on our threads.
-    if (pthread_create(&thread, NULL, schedule, NULL) != 0) {
+  // Setup the thread local run queue pointer.
+  if (pthread_key_create(&key, NULL) != 0) {
+    LOG(FATAL) << "Failed to initialize, pthread_key_create";
+  }
+
+  _runq_ = new ThreadLocal<RunQueue>(key);
+
+  // Setup the thread local fiber pointer.
+  if (pthread_key_create(&key, NULL) != 0) {
+    LOG(FATAL) << "Failed to initialize, pthread_key_create";
+  }
+
+  _fiber_ = new ThreadLocal<Fiber>(key);
+
+  // Setup processing threads, spreading them round robin across the
+  // CPUs they should run on (if any), and remember which NUMA node
+  // each thread is on (see ProcessManager::dequeue).
+  if (!worker_cpus.empty()) {
+    for (int i = 0; i < process_manager->workers(); i++) {
+      int cpu = worker_cpus[i % worker_cpus.size()];
+      process_manager->runq(i)->node = numa(cpu);
+    }
+  }
+
+  for (int i = 0; i < process_manager->workers(); i++) {
+    RunQueue* runq = process_manager->runq(i);
+    if (pthread_create(&runq->thread, NULL, schedule, runq) != 0) {
       LOG(FATAL) << "Failed to initialize, pthread_create";
     }
+
+    if (!worker_cpus.empty()) {
+      pin(runq->thread, vector<int>(1, worker_cpus[i % worker_cpus.size()]));
+    }
   }
 
   ip = 0;
   port = 0;
 
-  char *value;
-
   // Check environment for ip.
   value = getenv("LIBPROCESS_IP");
   if (value != NULL) {
@@ -1062,6 +2108,28 @@ void initialize(bool initialize_google_logging)
     port = result;
   }
 
+  // Check environment for how to encode messages.
+  value = getenv("LIBPROCESS_ENCODING");
+  if (value != NULL) {
+    if (strcmp(value, "binary") == 0) {
+      binary = true;
+    } else if (strcmp(value, "http") != 0) {
+      LOG(FATAL) << "LIBPROCESS_ENCODING=" << value
+                 << " is not a valid encoding (expecting 'http' or 'binary')";
+    }
+  }
+
+  // Check environment for which messages to compress.
+  value = getenv("LIBPROCESS_COMPRESSION_THRESHOLD");
+  if (value != NULL) {
+    int result = atoi(value);
+    if (result < 0) {
+      LOG(FATAL) << "LIBPROCESS_COMPRESSION_THRESHOLD=" << value
+                 << " is not a valid size";
+    }
+    compression_threshold = result;
+  }
+
   // Create a "server" socket for communicating with other nodes.
   if ((s = socket(AF_INET, SOCK_STREAM, IPPROTO_IP)) < 0) {
     PLOG(FATAL) << "Failed to initialize, socket";
@@ -1123,21 +2191,93 @@ void initialize(bool initialize_google_logging)
     PLOG(FATAL) << "Failed to initialize, listen";
   }
 
-  // Setup event loop.
+  // Check environment for the directory with the Unix domain sockets
+  // of the processes on this host, and create ours.
+  value = getenv("LIBPROCESS_SOCKET_DIR");
+  if (value != NULL) {
+    socket_dir = value;
+
+    const string path = socket_path(ip, port);
+
+    struct sockaddr_un local;
+    memset(&local, 0, sizeof(local));
+    local.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(local.sun_path)) {
+      LOG(FATAL) << "LIBPROCESS_SOCKET_DIR=" << value << " is too long";
+    }
+
+    strncpy(local.sun_path, path.c_str(), sizeof(local.sun_path) - 1);
+
+    if ((local_s = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+      PLOG(FATAL) << "Failed to initialize, socket(AF_UNIX)";
+    }
+
+    if (set_nbio(local_s) < 0) {
+      PLOG(FATAL) << "Failed to initialize, set_nbio";
+    }
+
+    // Remove any socket left behind by an earlier process that had
+    // the same ip and port (e.g., one that crashed).
+    unlink(path.c_str());
+
+    if (bind(local_s, (struct sockaddr *) &local, sizeof(local)) < 0) {
+      PLOG(FATAL) << "Failed to initialize, bind(" << path << ")";
+    }
+
+    local_path = path;
+    local_pid = getpid();
+    atexit(&unlink_socket);
+
+    if (listen(local_s, 500000) < 0) {
+      PLOG(FATAL) << "Failed to initialize, listen";
+    }
+  }
+
+  // Setup event loops, explicitly using epoll (or kqueue) when
+  // possible rather than whatever libev picks by default.
 #ifdef __sun__
-  loop = ev_default_loop(EVBACKEND_POLL | EVBACKEND_SELECT);
+  unsigned int backend = EVBACKEND_POLL | EVBACKEND_SELECT;
 #else
-  loop = ev_default_loop(EVFLAG_AUTO);
+  unsigned int backend = EVFLAG_AUTO;
+  if (ev_supported_backends() & EVBACKEND_EPOLL) {
+    backend = EVBACKEND_EPOLL;
+  } else if (ev_recommended_backends() & EVBACKEND_KQUEUE) {
+    backend = EVBACKEND_KQUEUE;
+  }
 #endif // __sun__
 
-  ev_async_init(&async_watcher, handle_async);
-  ev_async_start(loop, &async_watcher);
+  for (int i = 0; i < threads; i++) {
+    struct ev_loop* loop = i == 0
+      ? ev_default_loop(backend)
+      : ev_loop_new(backend);
+
+    if (loop == NULL) {
+      LOG(FATAL) << "Failed to initialize, ev_loop_new";
+    }
+
+    IOLoop* io = new IOLoop(loop);
+    ev_async_init(&io->async, handle_async);
+    io->async.data = io;
+    ev_async_start(loop, &io->async);
+
+    ev_timer_init(&io->watchdog, handle_watchdog, WATCHDOG_INTERVAL, 0.);
+    io->watchdog.data = io;
+    io->expected = ev_now(loop) + WATCHDOG_INTERVAL;
+    ev_timer_start(loop, &io->watchdog);
+    loops.push_back(io);
+  }
 
   ev_timer_init(&timeouts_watcher, handle_timeouts, 0., 2100000.0);
-  ev_timer_again(loop, &timeouts_watcher);
+  ev_timer_again(loops[0]->loop, &timeouts_watcher);
 
   ev_io_init(&server_watcher, accept, s, EV_READ);
-  ev_io_start(loop, &server_watcher);
+  ev_io_start(loops[0]->loop, &server_watcher);
+
+  if (local_s >= 0) {
+    ev_io_init(&local_watcher, accept, local_s, EV_READ);
+    ev_io_start(loops[0]->loop, &local_watcher);
+  }
 
 //   ev_child_init(&child_watcher, child_exited, pid, 0);
 //   ev_child_start(loop, &cw);
@@ -1154,9 +2294,15 @@ void initialize(bool initialize_google_logging)
 //   sigaddset (&sa.sa_mask, w->signum);
 //   sigprocmask (SIG_UNBLOCK, &sa.sa_mask, 0);
 
-  pthread_t thread; // For now, not saving handles on our threads.
-  if (pthread_create(&thread, NULL, serve, loop) != 0) {
-    LOG(FATAL) << "Failed to initialize, pthread_create";
+  for (int i = 0; i < threads; i++) {
+    IOLoop* io = loops[i];
+    if (pthread_create(&io->thread, NULL, serve, io->loop) != 0) {
+      LOG(FATAL) << "Failed to initialize, pthread_create";
+    }
+
+    if (!io_cpus.empty()) {
+      pin(io->thread, vector<int>(1, io_cpus[i % io_cpus.size()]));
+    }
   }
 
   // Need to set initialzing here so that we can actually invoke
@@ -1166,6 +2312,12 @@ void initialize(bool initialize_google_logging)
   // Create global garbage collector.
   gc = spawn(new GarbageCollector());
 
+  // Serve the statistics of the processes.
+  spawn(new ProcessesProcess());
+
+  // Serve the metrics.
+  spawn(new MetricsProcess());
+
   char temp[INET_ADDRSTRLEN];
   if (inet_ntop(AF_INET, (in_addr *) &ip, temp, INET_ADDRSTRLEN) == NULL) {
     PLOG(FATAL) << "Failed to initialize, inet_ntop";
@@ -1212,65 +2364,392 @@ void HttpResponseWaiter::timeout()
 {
   process::dispatch(proxy, &HttpProxy::unavailable, future, persist);
 
-  executor.stop(); // Ensure we ignore the future.
-}
+  executor.stop(); // Ensure we ignore the future.
+}
+
+
+HttpStream::HttpStream()
+  : closed(false), abandoned(false), notified(false)
+{
+  pthread_mutex_init(&mutex, NULL);
+}
+
+
+HttpStream::~HttpStream()
+{
+  pthread_mutex_destroy(&mutex);
+}
+
+
+bool HttpStream::write(const string& data)
+{
+  bool notify = false;
+
+  pthread_mutex_lock(&mutex);
+  {
+    if (closed || abandoned) {
+      pthread_mutex_unlock(&mutex);
+      return false;
+    }
+
+    buffer.append(data);
+
+    // Notify the proxy only once until it reads (coalescing writes).
+    if (proxy && !notified) {
+      notify = notified = true;
+    }
+  }
+  pthread_mutex_unlock(&mutex);
+
+  if (notify) {
+    dispatch(proxy, &HttpProxy::flush);
+  }
+
+  return true;
+}
+
+
+void HttpStream::close()
+{
+  bool notify = false;
+
+  pthread_mutex_lock(&mutex);
+  {
+    if (closed || abandoned) {
+      pthread_mutex_unlock(&mutex);
+      return;
+    }
+
+    closed = true;
+
+    if (proxy && !notified) {
+      notify = notified = true;
+    }
+  }
+  pthread_mutex_unlock(&mutex);
+
+  if (notify) {
+    dispatch(proxy, &HttpProxy::flush);
+  }
+}
+
+
+bool HttpStream::read(string* data, const PID<HttpProxy>& _proxy)
+{
+  bool result;
+
+  pthread_mutex_lock(&mutex);
+  {
+    data->swap(buffer);
+    buffer.clear();
+    proxy = _proxy;
+    notified = false;
+    result = closed;
+  }
+  pthread_mutex_unlock(&mutex);
+
+  return result;
+}
+
+
+void HttpStream::abandon()
+{
+  pthread_mutex_lock(&mutex);
+  {
+    abandoned = true;
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+
+HttpProxy::HttpProxy(int _c)
+  : c(_c), requests(0), persist(false), gzip(NULL) {}
+
+
+void HttpProxy::handle(Future<HttpResponse>* future,
+                       bool persist,
+                       const string& etags,
+                       bool gzip)
+{
+  Item* item = new Item();
+  item->future = future;
+  item->waiter = new HttpResponseWaiter(this, future, persist);
+  item->persist = persist;
+  item->etags = etags;
+  item->gzip = gzip;
+  item->response = NULL;
+
+  items.push_back(item);
+  requests++;
+}
+
+
+// Returns whether an "If-None-Match" header (a comma separated list
+// of entity tags, or "*") matches an entity tag.
+static bool matches(const string& etags, const string& etag)
+{
+  size_t start = 0;
+  while (start < etags.size()) {
+    size_t end = etags.find(',', start);
+    if (end == string::npos) {
+      end = etags.size();
+    }
+
+    size_t first = etags.find_first_not_of(" \t", start);
+    size_t last = etags.find_last_not_of(" \t", end - 1);
+    if (first < end && last != string::npos && last >= first) {
+      const string& tag = etags.substr(first, last - first + 1);
+      if (tag == "*" || tag == etag) {
+        return true;
+      }
+    }
+
+    start = end + 1;
+  }
+
+  return false;
+}
+
+
+void HttpProxy::ready(Future<HttpResponse>* future, bool persist)
+{
+  CHECK(future->isReady());
+
+  complete(future, future->get());
+}
+
+
+void HttpProxy::unavailable(Future<HttpResponse>* future, bool persist)
+{
+  complete(future, HttpServiceUnavailableResponse());
+}
+
+
+void HttpProxy::complete(Future<HttpResponse>* future,
+                         const HttpResponse& response)
+{
+  Item* item = NULL;
+  foreach (Item* i, items) {
+    if (i->future == future) {
+      item = i;
+      break;
+    }
+  }
+
+  CHECK(item != NULL);
+  CHECK(item->response == NULL);
+
+  delete item->waiter;
+  item->waiter = NULL;
+
+  // Let the client reuse what it already has if the entity it'd get
+  // is the one it has (only for successful responses, see RFC 2616).
+  if (!item->etags.empty() &&
+      response.status.find("200") == 0 &&
+      response.headers.count("ETag") > 0 &&
+      matches(item->etags, response.headers.find("ETag")->second)) {
+    item->response = new HttpNotModifiedResponse();
+    item->response->headers["ETag"] = response.headers.find("ETag")->second;
+    item->gzip = false;
+  } else {
+    item->response = new HttpResponse(response);
+  }
+
+  next();
+}
+
+
+void HttpProxy::next()
+{
+  while (!stream && !items.empty() && items.front()->response != NULL) {
+    Item* item = items.front();
+    items.pop_front();
+
+    respond(*item->response, item->persist, item->gzip);
+
+    socket_manager->responded(c);
+
+    delete item->response;
+    delete item->future;
+    delete item;
+  }
+
+  // Close the connection if it stays idle for too long.
+  if (!stream && items.empty() && http_idle_timeout > 0) {
+    delay(http_idle_timeout, self(), &HttpProxy::timeout, requests);
+  }
+}
+
+
+void HttpProxy::respond(const HttpResponse& response, bool persist, bool gzip)
+{
+  CHECK(!stream);
+
+  // Don't persist the connection if the responder doesn't want it to.
+  if (response.headers.count("Connection") > 0) {
+    const string& connection = response.headers.find("Connection")->second;
+    if (connection == "close") {
+      persist = false;
+    }
+  }
+
+  // Only compress if it's worth it (and not already encoded).
+  gzip = gzip &&
+    response.headers.count("Content-Encoding") == 0 &&
+    (response.stream || response.body.size() >= GZIP_MINIMUM_SIZE);
+
+  if (response.stream) {
+    // Send the status and headers (the body gets sent in chunks, see
+    // HttpProxy::flush), keeping the connection until it's done.
+    HttpResponse head;
+    head.status = response.status;
+    head.headers = response.headers;
+    head.headers.erase("Content-Length");
+    head.headers["Transfer-Encoding"] = "chunked";
+
+    if (gzip) {
+      head.headers["Content-Encoding"] = "gzip";
+      head.headers["Vary"] = "Accept-Encoding";
+      this->gzip = new Gzip();
+    }
+
+    socket_manager->send(new HttpResponseEncoder(head), c, true);
+
+    stream = response.stream;
+    this->persist = persist;
+
+    flush();
+    return;
+  }
+
+  if (response.path != "") {
+    // Send the status and headers followed by the file (see
+    // FileEncoder), which never gets compressed.
+    int fd = open(response.path.c_str(), O_RDONLY);
+
+    struct stat s;
+    if (fd < 0 || fstat(fd, &s) != 0 || !S_ISREG(s.st_mode)) {
+      VLOG(1) << "Failed to open " << response.path << " to respond with";
+      if (fd >= 0) {
+        close(fd);
+      }
+      socket_manager->send(new HttpResponseEncoder(HttpNotFoundResponse()),
+                           c, persist);
+      return;
+    }
+
+    // Send whatever part of the file is there.
+    off_t offset = min(max(response.offset, (off_t) 0), s.st_size);
+    size_t length = s.st_size - offset;
+    if (response.length > 0) {
+      length = min(response.length, length);
+    }
+
+    HttpResponse head;
+    head.status = response.status;
+    head.headers = response.headers;
+    head.headers.erase("Transfer-Encoding");
+
+    std::ostringstream out;
+    out << length;
+    head.headers["Content-Length"] = out.str();
+
+    if (length == 0) {
+      close(fd);
+      socket_manager->send(new HttpResponseEncoder(head), c, persist);
+    } else {
+      socket_manager->send(new HttpResponseEncoder(head), c, true);
+      socket_manager->send(new FileEncoder(fd, offset, length), c, persist);
+    }
+    return;
+  }
+
+  HttpResponseEncoder* encoder = NULL;
 
+  if (gzip) {
+    HttpResponse compressed;
+    compressed.status = response.status;
+    compressed.headers = response.headers;
+    compressed.headers["Content-Encoding"] = "gzip";
+    compressed.headers["Vary"] = "Accept-Encoding";
+    compressed.body = Gzip::compress(response.body);
 
-HttpProxy::HttpProxy(int _c) : c(_c) {}
+    std::ostringstream length;
+    length << compressed.body.size();
+    compressed.headers["Content-Length"] = length.str();
 
+    encoder = new HttpResponseEncoder(compressed);
+  } else {
+    encoder = new HttpResponseEncoder(response);
+  }
 
-void HttpProxy::handle(Future<HttpResponse>* future, bool persist)
-{
-  HttpResponseWaiter* waiter = new HttpResponseWaiter(this, future, persist);
-  waiters[future] = waiter;
+  // See the semantics of SocketManager::send for details about how
+  // the socket will get closed (it might actually already be closed
+  // before we issue this send).
+  socket_manager->send(encoder, c, persist);
 }
 
 
-void HttpProxy::ready(Future<HttpResponse>* future, bool persist)
+void HttpProxy::flush()
 {
-  CHECK(waiters.count(future) > 0);
-  HttpResponseWaiter* waiter = waiters[future];
-  waiters.erase(future);
-  delete waiter;
+  if (!stream) {
+    return;
+  }
 
-  CHECK(future->isReady());
+  string data;
+  bool closed = stream->read(&data, self());
 
-  const HttpResponse& response = future->get();
+  if (gzip != NULL) {
+    data = gzip->compress(data, closed);
+  }
 
-  // Don't persist the connection if the responder doesn't want it to.
-  if (response.headers.count("Connection") > 0) {
-    const string& connection = response.headers.find("Connection")->second;
-    if (connection == "close") {
-      persist = false;
-    }
+  if (!data.empty()) {
+    std::ostringstream chunk;
+    chunk << std::hex << data.size() << "\r\n" << data << "\r\n";
+    socket_manager->send(new DataEncoder(chunk.str()), c, true);
   }
 
-  HttpResponseEncoder* encoder =
-    new HttpResponseEncoder(response);
+  if (closed) {
+    socket_manager->send(new DataEncoder("0\r\n\r\n"), c, persist);
 
-  delete future;
+    stream.reset();
 
-  // See the semantics of SocketManager::send for details about how
-  // the socket will get closed (it might actually already be closed
-  // before we issue this send).
-  socket_manager->send(encoder, c, persist);
+    delete gzip;
+    gzip = NULL;
+
+    // Send the responses that were waiting.
+    next();
+  }
 }
 
 
-void HttpProxy::unavailable(Future<HttpResponse>* future, bool persist)
+void HttpProxy::timeout(uint64_t requests)
 {
-  CHECK(waiters.count(future) > 0);
-  HttpResponseWaiter* waiter = waiters[future];
-  waiters.erase(future);
-  delete waiter;
+  if (this->requests == requests && items.empty() && !stream) {
+    VLOG(2) << "Closing idle HTTP connection " << c;
+    socket_manager->expire(c, this);
+  }
+}
 
-  HttpResponseEncoder* encoder =
-    new HttpResponseEncoder(HttpServiceUnavailableResponse());
 
-  delete future;
+void HttpProxy::finalize()
+{
+  // The client has gone away.
+  if (stream) {
+    stream->abandon();
+  }
 
-  // As above, the socket might all ready be closed when we do a send.
-  socket_manager->send(encoder, c, persist);
+  delete gzip;
+  gzip = NULL;
+
+  // Clean up the requests (whose futures aren't being waited on).
+  foreach (Item* item, items) {
+    if (item->waiter == NULL) {
+      delete item->response;
+      delete item->future;
+      delete item;
+    }
+  }
 }
 
 
@@ -1283,6 +2762,64 @@ SocketManager::SocketManager()
 SocketManager::~SocketManager() {}
 
 
+// Creates a (non-blocking) socket and starts connecting it to a node,
+// over the node's Unix domain socket when it's on this host and has
+// one, otherwise over TCP. Returns the socket (or -1 on failure) and
+// sets 'pending' if the connect is still in progress.
+static int connect_node(const Node& node, bool* pending)
+{
+  int s;
+
+  if (!socket_dir.empty() && node.ip == ip) {
+    const string path = socket_path(node.ip, node.port);
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    // Connecting a Unix domain socket doesn't block, so if this
+    // doesn't work right away (e.g., the node doesn't accept
+    // connections on a Unix domain socket) just use TCP.
+    if ((s = socket(AF_UNIX, SOCK_STREAM, 0)) >= 0) {
+      if (set_nbio(s) == 0 &&
+          ::connect(s, (sockaddr *) &addr, sizeof(addr)) == 0) {
+        *pending = false;
+        return s;
+      }
+      close(s);
+    }
+  }
+
+  if ((s = socket(AF_INET, SOCK_STREAM, IPPROTO_IP)) < 0) {
+    return -1;
+  }
+
+  if (set_nbio(s) < 0) {
+    close(s);
+    return -1;
+  }
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = PF_INET;
+  addr.sin_port = htons(node.port);
+  addr.sin_addr.s_addr = node.ip;
+
+  *pending = false;
+
+  if (::connect(s, (sockaddr *) &addr, sizeof(addr)) < 0) {
+    if (errno != EINPROGRESS) {
+      close(s);
+      return -1;
+    }
+    *pending = true;
+  }
+
+  return s;
+}
+
+
 void SocketManager::link(ProcessBase *process, const UPID &to)
 {
   // TODO(benh): The semantics we want to support for link are such
@@ -1300,55 +2837,60 @@ void SocketManager::link(ProcessBase *process, const UPID &to)
   synchronized (this) {
     // Check if node is remote and there isn't a persistant link.
     if ((node.ip != ip || node.port != port) && persists.count(node) == 0) {
-      // Okay, no link, lets create a socket.
-      int s;
-
-      if ((s = socket(AF_INET, SOCK_STREAM, IPPROTO_IP)) < 0) {
-        PLOG(FATAL) << "Failed to link, socket";
+      // Okay, no link, so use the socket we send messages to the node
+      // on (if any) for the link, otherwise create a new one.
+      if (temps.count(node) > 0) {
+        persists[node] = temps[node];
+        temps.erase(node);
+      } else {
+        persists[node] = connect(node);
       }
+    }
 
-      if (set_nbio(s) < 0) {
-        PLOG(FATAL) << "Failed to link, set_nbio";
-      }
+    links[to].insert(process);
+  }
+}
 
-      sockets[s] = node;
 
-      persists[node] = s;
+int SocketManager::connect(const Node& node)
+{
+  bool pending;
+  int s = connect_node(node, &pending);
 
-      sockaddr_in addr;
-      memset(&addr, 0, sizeof(addr));
-      addr.sin_family = PF_INET;
-      addr.sin_port = htons(to.port);
-      addr.sin_addr.s_addr = to.ip;
+  if (s < 0) {
+    PLOG(FATAL) << "Failed to connect";
+  }
 
-      // Allocate and initialize the decoder and watcher.
-      DataDecoder* decoder = new DataDecoder();
+  sockets[s] = node;
 
-      ev_io *watcher = new ev_io();
-      watcher->data = decoder;
+  // Allocate and initialize the decoder and watcher.
+  DataDecoder* decoder = new DataDecoder(max_message_size);
 
-      // Try and connect to the node using this socket.
-      if (connect(s, (sockaddr *) &addr, sizeof(addr)) < 0) {
-        if (errno != EINPROGRESS) {
-          PLOG(FATAL) << "Failed to link, connect";
-        }
+  ev_io *watcher = new ev_io();
+  watcher->data = decoder;
 
-        // Wait for socket to be connected.
-        ev_io_init(watcher, receiving_connect, s, EV_WRITE);
-      } else {
-        ev_io_init(watcher, recv_data, s, EV_READ);
-      }
+  if (pending) {
+    // Wait for socket to be connected.
+    connecting.insert(s);
+    ev_io_init(watcher, receiving_connect, s, EV_WRITE);
+  } else {
+    backoffs.erase(node);
+    ev_io_init(watcher, recv_data, s, EV_READ);
+  }
 
-      // Enqueue the watcher.
-      synchronized (watchers) {
-        watchers->push(watcher);
-      }
+  // Start the watcher on the socket's loop.
+  io(s)->start(watcher);
 
-      // Interrupt the loop.
-      ev_async_send(loop, &async_watcher);
-    }
+  return s;
+}
 
-    links[to].insert(process);
+
+void SocketManager::connected(int s)
+{
+  synchronized (this) {
+    if (connecting.erase(s) > 0 && sockets.count(s) > 0) {
+      backoffs.erase(sockets[s]);
+    }
   }
 }
 
@@ -1376,6 +2918,100 @@ PID<HttpProxy> SocketManager::proxy(int s)
 }
 
 
+bool SocketManager::admit(int s)
+{
+  synchronized (this) {
+    if (proxies.count(s) == 0 && proxies.size() >= max_http_connections) {
+      return false;
+    }
+
+    pipelined[s]++;
+  }
+
+  return true;
+}
+
+
+void SocketManager::refuse(int s)
+{
+  HttpServiceUnavailableResponse response;
+  response.headers["Connection"] = "close";
+
+  synchronized (this) {
+    // Register the socket with the manager for sending purposes (see
+    // SocketManager::proxy).
+    if (sockets.count(s) == 0) {
+      sockets[s] = Node();
+    }
+  }
+
+  send(new HttpResponseEncoder(response), s, false);
+}
+
+
+bool SocketManager::pause(int s, ev_io* watcher)
+{
+  synchronized (this) {
+    if (pipelined.count(s) > 0 && pipelined[s] >= max_pipelined_requests) {
+      CHECK(paused.count(s) == 0);
+      paused[s] = watcher;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+void SocketManager::responded(int s)
+{
+  ev_io* watcher = NULL; // Non-null if needs to be started again.
+
+  synchronized (this) {
+    if (pipelined.count(s) > 0 && --pipelined[s] == 0) {
+      pipelined.erase(s);
+    }
+
+    if (paused.count(s) > 0 &&
+        (pipelined.count(s) == 0 || pipelined[s] < max_pipelined_requests)) {
+      watcher = paused[s];
+      paused.erase(s);
+    }
+  }
+
+  if (watcher != NULL) {
+    io(s)->start(watcher);
+  }
+}
+
+
+void SocketManager::forget(int s)
+{
+  synchronized (this) {
+    pipelined.erase(s);
+
+    if (paused.count(s) > 0) {
+      ev_io* watcher = paused[s];
+      delete (DataDecoder*) watcher->data;
+      delete watcher;
+      paused.erase(s);
+    }
+  }
+}
+
+
+void SocketManager::expire(int s, HttpProxy* proxy)
+{
+  synchronized (this) {
+    // Shutting down the socket gets it closed by the I/O loop (as if
+    // the client had closed it), see recv_data.
+    if (proxies.count(s) > 0 && proxies[s] == proxy) {
+      shutdown(s, SHUT_RDWR);
+    }
+  }
+}
+
+
 void SocketManager::send(DataEncoder* encoder, int s, bool persist)
 {
   CHECK(encoder != NULL);
@@ -1390,7 +3026,7 @@ void SocketManager::send(DataEncoder* encoder, int s, bool persist)
   synchronized (this) {
     if (sockets.count(s) > 0) {
       if (outgoing.count(s) > 0) {
-        outgoing[s].push(encoder);
+        outgoing[s].push_back(encoder);
       } else {
         // Initialize the outgoing queue.
         outgoing[s];
@@ -1401,11 +3037,7 @@ void SocketManager::send(DataEncoder* encoder, int s, bool persist)
 
         ev_io_init(watcher, send_data, s, EV_WRITE);
 
-        synchronized (watchers) {
-          watchers->push(watcher);
-        }
-
-        ev_async_send(loop, &async_watcher);
+        io(s)->start(watcher);
       }
 
       // Set the socket to get closed if not persistant.
@@ -1420,11 +3052,28 @@ void SocketManager::send(DataEncoder* encoder, int s, bool persist)
 }
 
 
+DataEncoder* SocketManager::encode(Message* message, int s)
+{
+  CHECK(binary);
+
+  // The first message encoded for a socket starts the connection
+  // (which is why this needs to be done while synchronized, in the
+  // order the messages get sent).
+  bool magic = symbols.count(s) == 0;
+
+  return new BinaryMessageEncoder(
+      message, &symbols[s], magic, compression_threshold);
+}
+
+
 void SocketManager::send(Message* message)
 {
   CHECK(message != NULL);
 
-  DataEncoder* encoder = new MessageEncoder(message);
+  // Encoding a message as an HTTP request doesn't depend on the
+  // socket, so do that before synchronizing.
+  DataEncoder* encoder =
+    !binary ? new MessageEncoder(message, compression_threshold) : NULL;
 
   Node node(message->to.ip, message->to.port);
 
@@ -1434,57 +3083,26 @@ void SocketManager::send(Message* message)
     bool temporary = temps.count(node) > 0;
     if (persistant || temporary) {
       int s = persistant ? persists[node] : temps[node];
-      send(encoder, s, persistant);
-    } else {
-      // No peristant or temporary socket to the node currently
-      // exists, so we create a temporary one.
-      int s;
-
-      if ((s = socket(AF_INET, SOCK_STREAM, IPPROTO_IP)) < 0) {
-        PLOG(FATAL) << "Failed to send, socket";
-      }
-
-      if (set_nbio(s) < 0) {
-        PLOG(FATAL) << "Failed to send, set_nbio";
-      }
-
-      sockets[s] = node;
-
-      temps[node] = s;
-      disposables.insert(s);
-
-      // Initialize the outgoing queue.
-      outgoing[s];
-
-      // Try and connect to the node using this socket.
-      sockaddr_in addr;
-      memset(&addr, 0, sizeof(addr));
-      addr.sin_family = PF_INET;
-      addr.sin_port = htons(message->to.port);
-      addr.sin_addr.s_addr = message->to.ip;
-
-      // Allocate and initialize the watcher.
-      ev_io *watcher = new ev_io();
-      watcher->data = encoder;
-    
-      if (connect(s, (sockaddr *) &addr, sizeof(addr)) < 0) {
-        if (errno != EINPROGRESS) {
-          PLOG(FATAL) << "Failed to send, connect";
-        }
-
-        // Initialize watcher for connecting.
-        ev_io_init(watcher, sending_connect, s, EV_WRITE);
+      send(encoder != NULL ? encoder : encode(message, s), s, true);
+    } else if (backoffs.count(node) > 0 &&
+               Clock::real() < backoffs[node].first) {
+      // We recently failed to connect to the node, so rather than
+      // trying (and failing) again for every message, drop messages
+      // until we're done backing off (like messages get dropped when
+      // the connection fails anyway).
+      VLOG(1) << "Dropping message to " << message->to
+              << " while backing off connecting";
+      if (encoder != NULL) {
+        delete encoder; // Deletes the message too.
       } else {
-        // Initialize watcher for sending.
-        ev_io_init(watcher, send_data, s, EV_WRITE);
-      }
-
-      // Enqueue the watcher.
-      synchronized (watchers) {
-        watchers->push(watcher);
+        delete message;
       }
-
-      ev_async_send(loop, &async_watcher);
+    } else {
+      // No socket to the node currently exists, so we create one
+      // (which we keep for the next messages to the node).
+      int s = connect(node);
+      temps[node] = s;
+      send(encoder != NULL ? encoder : encode(message, s), s, true);
     }
   }
 }
@@ -1501,7 +3119,7 @@ DataEncoder* SocketManager::next(int s)
     if (!outgoing[s].empty()) {
       // More messages!
       encoder = outgoing[s].front();
-      outgoing[s].pop();
+      outgoing[s].pop_front();
     } else {
       // No more messages ... erase the outgoing queue.
       outgoing.erase(s);
@@ -1520,6 +3138,8 @@ DataEncoder* SocketManager::next(int s)
 
         disposables.erase(s);
         sockets.erase(s);
+        symbols.erase(s);
+        forget(s);
         close(s);
       }
     }
@@ -1529,6 +3149,24 @@ DataEncoder* SocketManager::next(int s)
 }
 
 
+size_t SocketManager::peek(int s, DataEncoder** encoders, size_t max)
+{
+  size_t count = 0;
+
+  synchronized (this) {
+    if (outgoing.count(s) > 0) {
+      const deque<DataEncoder*>& queue = outgoing[s];
+      while (count < max && count < queue.size()) {
+        encoders[count] = queue[count];
+        count++;
+      }
+    }
+  }
+
+  return count;
+}
+
+
 void SocketManager::closed(int s)
 {
   HttpProxy* proxy = NULL; // Non-null if needs to be terminated.
@@ -1537,6 +3175,15 @@ void SocketManager::closed(int s)
     if (sockets.count(s) > 0) {
       const Node& node = sockets[s];
 
+      // Back off connecting to the node if we couldn't connect,
+      // doubling how long each time we fail in a row.
+      if (connecting.erase(s) > 0) {
+        double backoff = backoffs.count(node) > 0
+          ? min(backoffs[node].second * 2, MAX_CONNECT_BACKOFF)
+          : MIN_CONNECT_BACKOFF;
+        backoffs[node] = make_pair(Clock::real() + backoff, backoff);
+      }
+
       // Don't bother invoking exited unless socket was persistant.
       if (persists.count(node) > 0 && persists[node] == s) {
 	persists.erase(node);
@@ -1551,7 +3198,10 @@ void SocketManager::closed(int s)
       outgoing.erase(s);
       disposables.erase(s);
       sockets.erase(s);
+      symbols.erase(s);
     }
+
+    forget(s);
   }
 
   // We terminate the proxy outside the synchronized block to avoid
@@ -1629,27 +3279,45 @@ void SocketManager::exited(ProcessBase* process)
 }
 
 
-ProcessManager::ProcessManager()
+ProcessManager::ProcessManager(int workers)
+  : next(0)
 {
-  synchronizer(processes) = SYNCHRONIZED_INITIALIZER;
-  synchronizer(runq) = SYNCHRONIZED_INITIALIZER;
+  synchronizer(fibers) = SYNCHRONIZED_INITIALIZER;
+
+  CHECK(workers > 0);
+
+  for (int i = 0; i < workers; i++) {
+    runqs.push_back(new RunQueue(i));
+  }
 }
 
 
-ProcessManager::~ProcessManager() {}
+ProcessManager::~ProcessManager()
+{
+  foreach (RunQueue* runq, runqs) {
+    delete runq;
+  }
+}
 
 
 ProcessReference ProcessManager::use(const UPID &pid)
 {
   if (pid.ip == ip && pid.port == port) {
-    synchronized (processes) {
-      if (processes.count(pid.id) > 0) {
+    ProcessRegistry* registry = this->registry(pid.id);
+    registry->lock();
+    {
+      boost::unordered_map<string, ProcessBase*>::iterator it =
+        registry->processes.find(pid.id);
+      if (it != registry->processes.end()) {
         // Note that the ProcessReference constructor _must_ get
-        // called while holding the lock on processes so that waiting
-        // for references is atomic (i.e., race free).
-        return ProcessReference(processes[pid.id]);
+        // called while holding the lock on the registry so that
+        // waiting for references is atomic (i.e., race free).
+        ProcessReference reference(it->second);
+        registry->unlock();
+        return reference;
       }
     }
+    registry->unlock();
   }
 
   return ProcessReference(NULL);
@@ -1675,6 +3343,13 @@ bool ProcessManager::deliver(Message* message, ProcessBase* sender)
       }
     }
 
+    if (receiver->overloaded(*message)) {
+      VLOG(1) << "Dropping message '" << message->name << "' for "
+              << message->to << " because its mailbox is full";
+      delete message;
+      return false;
+    }
+
     receiver->enqueue(new MessageEvent(message));
   } else {
     delete message;
@@ -1698,7 +3373,39 @@ bool ProcessManager::deliver(int c, HttpRequest* request, ProcessBase* sender)
     return deliver(message, sender);
   }
 
-  // Treat this as an HTTP request and check for a valid receiver.
+  // Treat this as an HTTP request, unless there are too many HTTP
+  // connections already.
+  if (!socket_manager->admit(c)) {
+    VLOG(1) << "Returning '503 Service Unavailable' for '"
+            << request->path << "' because of too many HTTP connections";
+    socket_manager->refuse(c);
+    delete request;
+    return false;
+  }
+
+  // Let the socket's proxy know about the request (via the future)
+  // right away, so that it sends responses in the order the requests
+  // came in, including which entities the client already has (if
+  // any) and whether it accepts gzip encoded responses.
+  std::tr1::shared_ptr<Promise<HttpResponse> > promise(
+      new Promise<HttpResponse>());
+
+  string etags;
+  if (request->headers.count("If-None-Match") > 0) {
+    etags = request->headers.find("If-None-Match")->second;
+  }
+
+  bool gzip = false;
+  if (request->headers.count("Accept-Encoding") > 0) {
+    const string& encodings = request->headers.find("Accept-Encoding")->second;
+    gzip = encodings.find("gzip") != string::npos;
+  }
+
+  dispatch(socket_manager->proxy(c), &HttpProxy::handle,
+           new Future<HttpResponse>(promise->future()),
+           request->keepAlive, etags, gzip);
+
+  // Now check for a valid receiver.
   string path = request->path.substr(1, request->path.find('/', 1) - 1);
 
   UPID to(path, ip, port);
@@ -1718,17 +3425,23 @@ bool ProcessManager::deliver(int c, HttpRequest* request, ProcessBase* sender)
       }
     }
 
+    if (receiver->overloaded(*request)) {
+      VLOG(1) << "Returning '503 Service Unavailable' for '"
+              << request->path << "' because " << to << " is overloaded";
+
+      promise->set(HttpServiceUnavailableResponse());
+
+      delete request;
+      return false;
+    }
+
     // Enqueue the event.
-    receiver->enqueue(new HttpEvent(c, request));
+    receiver->enqueue(new HttpEvent(c, request, promise));
   } else {
     // This has no receiver, send error response.
     VLOG(1) << "Returning '404 Not Found' for '" << request->path << "'";
 
-    HttpResponseEncoder* encoder =
-      new HttpResponseEncoder(HttpNotFoundResponse());
-
-    // TODO(benh): Socket might be closed and then re-opened!
-    socket_manager->send(encoder, c, request->keepAlive);
+    promise->set(HttpNotFoundResponse());
 
     // Cleanup request.
     delete request;
@@ -1739,13 +3452,23 @@ bool ProcessManager::deliver(int c, HttpRequest* request, ProcessBase* sender)
 }
 
 
-// TODO(benh): Refactor and share code with above!
 bool ProcessManager::deliver(
     const UPID& to,
     lambda::function<void(ProcessBase*)>* f,
     ProcessBase* sender)
 {
   CHECK(f != NULL);
+  return deliver(to, new DispatchEvent(f), sender);
+}
+
+
+// TODO(benh): Refactor and share code with above!
+bool ProcessManager::deliver(
+    const UPID& to,
+    DispatchEvent* event,
+    ProcessBase* sender)
+{
+  CHECK(event != NULL);
 
   if (ProcessReference receiver = use(to)) {
     // If we have a local sender AND we are using a manual clock
@@ -1762,9 +3485,9 @@ bool ProcessManager::deliver(
       }
     }
 
-    receiver->enqueue(new DispatchEvent(f));
+    receiver->enqueue(event);
   } else {
-    delete f;
+    delete event;
     return false;
   }
 
@@ -1776,13 +3499,17 @@ UPID ProcessManager::spawn(ProcessBase* process, bool manage)
 {
   CHECK(process != NULL);
 
-  synchronized (processes) {
-    if (processes.count(process->pid.id) > 0) {
+  ProcessRegistry* registry = this->registry(process->pid.id);
+  registry->lock();
+  {
+    if (registry->processes.count(process->pid.id) > 0) {
+      registry->unlock();
       return UPID();
     } else {
-      processes[process->pid.id] = process;
+      registry->processes[process->pid.id] = process;
     }
   }
+  registry->unlock();
 
   // Use the garbage collector if requested.
   if (manage) {
@@ -1798,16 +3525,53 @@ UPID ProcessManager::spawn(ProcessBase* process, bool manage)
 }
 
 
+void ProcessManager::dedicate(ProcessBase* process)
+{
+  CHECK(process != NULL);
+
+  CHECK(process->runq == NULL)
+    << "Processes must be dedicated a thread before being spawned";
+
+  // Note that the thread will just wait until the process gets
+  // spawned (and thus enqueued), and will exit after the process has
+  // terminated (see ProcessManager::cleanup), deleting the run queue.
+  RunQueue* runq = new RunQueue();
+
+  process->runq = runq;
+
+  if (pthread_create(&runq->thread, NULL, schedule, runq) != 0) {
+    LOG(FATAL) << "Failed to dedicate thread, pthread_create";
+  }
+
+  // Nobody joins dedicated threads.
+  pthread_detach(runq->thread);
+}
+
+
 void ProcessManager::resume(ProcessBase* process)
 {
   __process__ = process;
 
+  // Remember which processing thread we're running on so the next
+  // time this process becomes runnable it gets queued there (which
+  // is likely to still have warm caches). Note that a non-processing
+  // thread might be resuming this process (see ProcessManager::wait),
+  // or this might be a dedicated thread that is donating itself, and
+  // processes with a dedicated thread must stay put.
+  if (__runq__ != NULL && !__runq__->dedicated() &&
+      (process->runq == NULL || !process->runq->dedicated())) {
+    process->runq = __runq__;
+  }
+
   VLOG(2) << "Resuming " << process->pid << " at "
           << std::fixed << std::setprecision(9) << Clock::now();
 
   bool terminate = false;
   bool blocked = false;
 
+  // Number of events serviced so far during this run.
+  size_t serviced = 0;
+
   CHECK(process->state == ProcessBase::BOTTOM ||
         process->state == ProcessBase::READY);
 
@@ -1818,27 +3582,47 @@ void ProcessManager::resume(ProcessBase* process)
   }
 
   while (!terminate && !blocked) {
-    Event* event = NULL;
+    // Yield if we've used up our batch and there is more to do, this
+    // time as READY (so enqueuers will leave us alone) and at the
+    // back of a run queue. As with blocking, once we've enqueued the
+    // process we must not touch it again.
+    if (process->events_per_batch > 0 &&
+        serviced == process->events_per_batch &&
+        process->pending()) {
+      VLOG(2) << "Yielding " << process->pid << " after "
+              << serviced << " events";
+      process->state = ProcessBase::READY;
+      enqueue(process);
+      break;
+    }
 
-    process->lock();
-    {
-      if (process->events.size() > 0) {
-        event = process->events.front();
-        process->events.pop_front();
-        process->state = ProcessBase::RUNNING;
-      } else {
-        process->state = ProcessBase::BLOCKED;
+    Event* event = process->dequeue();
+
+    if (event == NULL) {
+      // Block, but then check for events that got enqueued after we
+      // looked (their enqueuers saw us still running and so didn't
+      // reschedule us). We race any such enqueuer to unblock, and if
+      // the enqueuer wins it has rescheduled the process, at which
+      // point we must not touch it again.
+      process->state = ProcessBase::BLOCKED;
+      __sync_synchronize();
+      if (!process->pending() ||
+          !__sync_bool_compare_and_swap(
+              &process->state, ProcessBase::BLOCKED, ProcessBase::RUNNING)) {
         blocked = true;
       }
-    }
-    process->unlock();
+    } else {
+      process->state = ProcessBase::RUNNING;
+      serviced++;
 
-    if (!blocked) {
-      CHECK(event != NULL);
+      __sync_sub_and_fetch(&process->mailbox_depth, 1);
+      process->events_serviced++;
 
       // Determine if we should terminate.
       terminate = event->is<TerminateEvent>();
 
+      double started = Clock::real();
+
       // Now service the event.
       try {
         process->serve(*event);
@@ -1853,6 +3637,8 @@ void ProcessManager::resume(ProcessBase* process)
         terminate = true;
       }
 
+      process->running_time += Clock::real() - started;
+
       delete event;
 
       if (terminate) {
@@ -1865,6 +3651,38 @@ void ProcessManager::resume(ProcessBase* process)
 }
 
 
+string ProcessManager::statistics()
+{
+  stringstream out;
+
+  out << "[";
+
+  bool first = true;
+  for (size_t i = 0; i < REGISTRIES; i++) {
+    registries[i].lock();
+    {
+      foreachvalue (ProcessBase* process, registries[i].processes) {
+        if (!first) {
+          out << ",";
+        }
+        first = false;
+
+        out << "{\"id\":\"" << process->pid.id << "\","
+            << "\"mailbox_depth\":" << process->mailbox_depth << ","
+            << "\"mailbox_max\":" << process->mailbox_max << ","
+            << "\"events\":" << process->events_serviced << ","
+            << "\"running_time\":" << process->running_time << "}";
+      }
+    }
+    registries[i].unlock();
+  }
+
+  out << "]";
+
+  return out.str();
+}
+
+
 void ProcessManager::cleanup(ProcessBase* process)
 {
   VLOG(2) << "Cleaning up " << process->pid;
@@ -1874,32 +3692,44 @@ void ProcessManager::cleanup(ProcessBase* process)
 
   // Possible gate non-libprocess threads are waiting at.
   Gate* gate = NULL;
+
+  // Fibers waiting on the process.
+  list<Fiber*> fibers;
  
   // Remove process.
-  synchronized (processes) {
+  ProcessRegistry* registry = this->registry(process->pid.id);
+  registry->lock();
+  {
     // Wait for all process references to get cleaned up.
     while (process->refs > 0) {
-      asm ("pause");
+      cpu_relax();
       __sync_synchronize();
     }
 
     process->lock();
     {
       // Free any pending events.
-      while (!process->events.empty()) {
-        Event* event = process->events.front();
-        process->events.pop_front();
+      Event* event = NULL;
+      while ((event = process->dequeue()) != NULL) {
         delete event;
       }
 
-      processes.erase(process->pid.id);
+      registry->processes.erase(process->pid.id);
  
       // Lookup gate to wake up waiting threads.
-      map<ProcessBase*, Gate*>::iterator it = gates.find(process);
-      if (it != gates.end()) {
+      map<ProcessBase*, Gate*>::iterator it = registry->gates.find(process);
+      if (it != registry->gates.end()) {
         gate = it->second;
         // N.B. The last thread that leaves the gate also free's it.
-        gates.erase(it);
+        registry->gates.erase(it);
+      }
+
+      // Likewise, lookup waiting fibers.
+      map<ProcessBase*, list<Fiber*> >::iterator waiting =
+        registry->fibers.find(process);
+      if (waiting != registry->fibers.end()) {
+        fibers.swap(waiting->second);
+        registry->fibers.erase(waiting);
       }
 
       CHECK(process->refs == 0);
@@ -1907,6 +3737,19 @@ void ProcessManager::cleanup(ProcessBase* process)
     }
     process->unlock();
 
+    // Confirm process not in a run queue (we need to check this
+    // before SocketManager::exited below since the process might get
+    // deallocated as soon as any exited events are delivered).
+    CHECK(!process->queued);
+
+    // Let a dedicated thread know it can exit once we're done (only
+    // the dedicated thread itself ever runs the process, see
+    // ProcessManager::wait, so it's the one running us now).
+    if (process->runq != NULL && process->runq->dedicated()) {
+      CHECK(process->runq == __runq__);
+      process->runq->done = true;
+    }
+
     // Note that we don't remove the process from the clock during
     // cleanup, but rather the clock is reset for a process when it is
     // created (see ProcessBase::ProcessBase). We do this so that
@@ -1917,7 +3760,7 @@ void ProcessManager::cleanup(ProcessBase* process)
 
     // Now we tell the socket manager about this process exiting so
     // that it can create exited events for linked processes. We
-    // _must_ do this while synchronized on processes because
+    // _must_ do this while holding the lock on the registry because
     // otherwise another process could attempt to link this process
     // and SocketManger::link would see that the processes doesn't
     // exist when it attempts to get a ProcessReference (since we
@@ -1929,11 +3772,7 @@ void ProcessManager::cleanup(ProcessBase* process)
     // SocketManager::exited.
     socket_manager->exited(process);
   }
-
-  // Confirm process not in runq.
-  synchronized (runq) {
-    CHECK(find(runq.begin(), runq.end(), process) == runq.end());
-  }
+  registry->unlock();
 
   // ***************************************************************
   // At this point we can no longer dereference the process since it
@@ -1943,6 +3782,10 @@ void ProcessManager::cleanup(ProcessBase* process)
   if (gate != NULL) {
     gate->open();
   }
+
+  foreach (Fiber* fiber, fibers) {
+    ready(fiber);
+  }
 }
 
 
@@ -1996,45 +3839,68 @@ bool ProcessManager::wait(const UPID& pid)
   // up. Note that a gate will never get more threads waiting on it
   // after it has been opened, since the process should no longer be
   // valid and therefore will not have an entry in 'processes'.
+  //
+  // Processing threads don't wait at gates though, they suspend the
+  // fiber they are running instead (see Fiber).
 
   Gate* gate = NULL;
   Gate::state_t old;
 
+  bool suspend = false; // Set to true if we suspend our fiber.
+
   ProcessBase* process = NULL; // Set to non-null if we donate thread.
 
   // Try and approach the gate if necessary.
-  synchronized (processes) {
-    if (processes.count(pid.id) > 0) {
-      process = processes[pid.id];
+  ProcessRegistry* registry = this->registry(pid.id);
+  registry->lock();
+  {
+    boost::unordered_map<string, ProcessBase*>::iterator it =
+      registry->processes.find(pid.id);
+    if (it != registry->processes.end()) {
+      process = it->second;
       CHECK(process->state != ProcessBase::FINISHED);
 
-      // Check and see if a gate already exists.
-      if (gates.find(process) == gates.end()) {
-        gates[process] = new Gate();
+      if (__fiber__ != NULL) {
+        suspend = true;
+      } else {
+        // Check and see if a gate already exists.
+        if (registry->gates.find(process) == registry->gates.end()) {
+          registry->gates[process] = new Gate();
+        }
+
+        gate = registry->gates[process];
+        old = gate->approach();
       }
 
-      gate = gates[process];
-      old = gate->approach();
-
-      // Check if it is runnable in order to donate this thread.
-      if (process->state == ProcessBase::BOTTOM ||
-          process->state == ProcessBase::READY) {
-        synchronized (runq) {
-          list<ProcessBase*>::iterator it =
-            find(runq.begin(), runq.end(), process);
-          if (it != runq.end()) {
-            runq.erase(it);
+      // Check if it is runnable in order to donate this thread (but
+      // never run a process that has its own dedicated thread).
+      if ((process->state == ProcessBase::BOTTOM ||
+           process->state == ProcessBase::READY) &&
+          process->runq != NULL && !process->runq->dedicated()) {
+        RunQueue* runq = process->runq;
+        runq->lock();
+        {
+          deque<ProcessBase*>::iterator it = runq->processes.end();
+          if (process->queued) {
+            it = find(runq->processes.begin(), runq->processes.end(), process);
+          }
+
+          if (it != runq->processes.end()) {
+            runq->processes.erase(it);
+            process->queued = false;
           } else {
-            // Another thread has resumed the process ...
+            // Another thread has resumed (or stolen) the process ...
             process = NULL;
           }
         }
+        runq->unlock();
       } else {
         // Process is not runnable, so no need to donate ...
         process = NULL;
       }
     }
   }
+  registry->unlock();
 
   if (process != NULL) {
     VLOG(1) << "Donating thread to " << process->pid << " while waiting";
@@ -2046,6 +3912,16 @@ bool ProcessManager::wait(const UPID& pid)
   // TODO(benh): Donating only once may not be sufficient, so we might
   // still deadlock here ... perhaps warn if that's the case?
 
+  // Suspend our fiber until the process has terminated (if it hasn't
+  // already, see ProcessManager::switched), while this thread keeps
+  // running other processes on another fiber.
+  if (suspend) {
+    ProcessBase* waiter = __process__;
+    transfer(fiber(), Fiber::WAIT, &pid);
+    __process__ = waiter;
+    return true;
+  }
+
   // Now arrive at the gate and wait until it opens.
   if (gate != NULL) {
     gate->arrive(old);
@@ -2061,37 +3937,263 @@ bool ProcessManager::wait(const UPID& pid)
 }
 
 
+Fiber* ProcessManager::fiber()
+{
+  Fiber* fiber = NULL;
+
+  synchronized (fibers) {
+    if (!readies.empty()) {
+      fiber = readies.front();
+      readies.pop_front();
+    } else if (!idles.empty()) {
+      fiber = idles.back();
+      idles.pop_back();
+    }
+  }
+
+  return fiber != NULL ? fiber : new Fiber();
+}
+
+
+void ProcessManager::transfer(Fiber* fiber,
+                              Fiber::Action action,
+                              const UPID* pid)
+{
+  Fiber* previous = __fiber__;
+
+  CHECK(previous != NULL && fiber != previous);
+
+  fiber->action = action;
+  fiber->previous = previous;
+  fiber->pid = pid;
+
+  __fiber__ = fiber;
+
+  swapcontext(&previous->context, &fiber->context);
+
+  // Switched back to (possibly on another thread).
+  switched();
+}
+
+
+void ProcessManager::switched()
+{
+  Fiber* fiber = __fiber__;
+
+  Fiber* previous = fiber->previous;
+  const UPID* pid = fiber->pid;
+  Fiber::Action action = fiber->action;
+
+  fiber->action = Fiber::NONE;
+  fiber->previous = NULL;
+  fiber->pid = NULL;
+
+  if (action == Fiber::IDLE) {
+    synchronized (fibers) {
+      idles.push_back(previous);
+    }
+  } else if (action == Fiber::WAIT) {
+    // Have the previous fiber wait for the process, unless it has
+    // already terminated (the previous fiber's stack, and thus the
+    // pid, stays valid until the fiber gets switched to again).
+    bool waiting = false;
+
+    ProcessRegistry* registry = this->registry(pid->id);
+    registry->lock();
+    {
+      boost::unordered_map<string, ProcessBase*>::iterator it =
+        registry->processes.find(pid->id);
+      if (it != registry->processes.end()) {
+        registry->fibers[it->second].push_back(previous);
+        waiting = true;
+      }
+    }
+    registry->unlock();
+
+    if (!waiting) {
+      ready(previous);
+    }
+  }
+}
+
+
+bool ProcessManager::yield()
+{
+  Fiber* fiber = NULL;
+
+  synchronized (fibers) {
+    if (!readies.empty()) {
+      fiber = readies.front();
+      readies.pop_front();
+    }
+  }
+
+  if (fiber != NULL) {
+    transfer(fiber, Fiber::IDLE);
+    return true;
+  }
+
+  return false;
+}
+
+
+bool ProcessManager::resumable()
+{
+  synchronized (fibers) {
+    return !readies.empty();
+  }
+
+  return false;
+}
+
+
+void ProcessManager::ready(Fiber* fiber)
+{
+  synchronized (fibers) {
+    readies.push_back(fiber);
+  }
+
+  // Wake up an idle processing thread to continue the fiber.
+  wakeup(NULL);
+}
+
+
 void ProcessManager::enqueue(ProcessBase* process)
 {
   CHECK(process != NULL);
 
-  // TODO(benh): Check and see if this process has it's own thread. If
-  // it does, push it on that threads runq, and wake up that thread if
-  // it's not running. Otherwise, check and see which thread this
-  // process was last running on, and put it on that threads runq.
+  // Put the process on the run queue of the thread it was last
+  // running on (or its dedicated thread). If it has never run, prefer
+  // the run queue of the current processing thread (if any) since the
+  // enqueuer and the enqueued are likely to be sharing data,
+  // otherwise just pick the next run queue in a round robin fashion.
+  RunQueue* runq = process->runq;
 
-  synchronized (runq) {
-    CHECK(find(runq.begin(), runq.end(), process) == runq.end());
-    runq.push_back(process);
+  if (runq == NULL) {
+    if (__runq__ != NULL && !__runq__->dedicated()) {
+      runq = __runq__;
+    } else {
+      runq = runqs[__sync_fetch_and_add(&next, 1) % runqs.size()];
+    }
   }
-    
-  // Wake up the processing thread if necessary.
-  gate->open();
+
+  runq->lock();
+  {
+    CHECK(!process->queued);
+    process->runq = runq;
+    process->queued = true;
+    process->queued_at = Clock::real();
+    runq->processes.push_back(process);
+  }
+  runq->unlock();
+
+  wakeup(runq);
 }
 
 
-ProcessBase* ProcessManager::dequeue()
+void ProcessManager::wakeup(RunQueue* runq)
 {
-  // TODO(benh): Remove a process from this thread's runq. If there
-  // are no processes to run, and this is not a dedicated thread, then
-  // steal one from another threads runq.
+  // Pairs with the barrier an idle thread goes through between
+  // marking itself idle and looking for a process one last time.
+  __sync_synchronize();
+
+  // An idle thread gets claimed by clearing its flag, so that
+  // concurrent wakeups wake up different threads.
+  if (runq != NULL && runq->dedicated()) {
+    runq->gate->open();
+    return;
+  } else if (runq != NULL &&
+             __sync_bool_compare_and_swap(&runq->idle, true, false)) {
+    runq->gate->open();
+    return;
+  }
+
+  // Look for an idle thread starting after the run queue's owner (or
+  // the current thread), so wakeups get spread across the threads.
+  int start = runq != NULL ? runq->index : 0;
+  if (runq == NULL && __runq__ != NULL && !__runq__->dedicated()) {
+    start = __runq__->index;
+  }
+
+  for (size_t i = 1; i <= runqs.size(); i++) {
+    RunQueue* idle = runqs[(start + i) % runqs.size()];
+    if (__sync_bool_compare_and_swap(&idle->idle, true, false)) {
+      idle->gate->open();
+      return;
+    }
+  }
+}
 
+
+ProcessBase* ProcessManager::dequeue()
+{
   ProcessBase* process = NULL;
 
-  synchronized (runq) {
-    if (!runq.empty()) {
-      process = runq.front();
-      runq.pop_front();
+  RunQueue* runq = __runq__;
+
+  CHECK(runq != NULL) << "Only processing threads should be dequeuing";
+
+  // First try and remove a process from this thread's run queue.
+  runq->lock();
+  {
+    if (!runq->processes.empty()) {
+      process = runq->processes.front();
+      runq->processes.pop_front();
+      process->queued = false;
+    }
+  }
+  runq->unlock();
+
+  // Dedicated threads never steal (and are never stolen from).
+  if (process != NULL || runq->dedicated()) {
+    if (process != NULL) {
+      runq_waits.record(Clock::real() - process->queued_at);
+    }
+    return process;
+  }
+
+  // Nothing to run, so try and steal a process from the back of
+  // another thread's run queue. We never block on a victim's lock
+  // (the owner, an enqueuer, or another thief has it), we just move
+  // on to the next victim. However, if we skipped a victim we try the
+  // whole pass again rather than going idle, since the owner of that
+  // run queue might be idle too (and the lock holder might not be
+  // enqueuing, which is what would otherwise wake us back up). We
+  // look at the threads on our own NUMA node first, so that processes
+  // (and their state) stay on their node unless that node is busy.
+  bool contended = false;
+  bool remote = false;
+
+  do {
+    contended = false;
+    for (int pass = 0; pass < 2 && process == NULL; pass++) {
+      for (size_t i = 1; i < runqs.size() && process == NULL; i++) {
+        RunQueue* victim = runqs[(runq->index + i) % runqs.size()];
+        remote = victim->node != runq->node;
+        if (remote != (pass == 1)) {
+          continue;
+        } else if (victim->trylock()) {
+          if (!victim->processes.empty()) {
+            process = victim->processes.back();
+            victim->processes.pop_back();
+            process->queued = false;
+          }
+          victim->unlock();
+        } else {
+          contended = true;
+        }
+      }
+    }
+
+    if (process == NULL && contended) {
+      cpu_relax();
+    }
+  } while (process == NULL && contended);
+
+  if (process != NULL) {
+    runq_waits.record(Clock::real() - process->queued_at);
+    if (remote) {
+      remote_steals.increment();
     }
   }
 
@@ -2099,11 +4201,40 @@ ProcessBase* ProcessManager::dequeue()
 }
 
 
+double ProcessManager::waiting()
+{
+  double oldest = 0;
+
+  const double now = Clock::real();
+
+  foreach (RunQueue* runq, runqs) {
+    runq->lock();
+    {
+      // Processes get enqueued at the back, so the front has been
+      // waiting the longest.
+      if (!runq->processes.empty()) {
+        oldest = std::max(oldest, now - runq->processes.front()->queued_at);
+      }
+    }
+    runq->unlock();
+  }
+
+  return oldest;
+}
+
+
+RunQueue* ProcessManager::runq(int index)
+{
+  CHECK(index >= 0 && index < (int) runqs.size());
+  return runqs[index];
+}
+
+
 namespace timers {
 
 timer create(double secs, const lambda::function<void(void)>& thunk)
 {
-  static long id = 0;
+  static volatile long id = 0;
 
   double timeout = Clock::now() + secs;
 
@@ -2116,7 +4247,7 @@ timer create(double secs, const lambda::function<void(void)>& thunk)
   }
 
   timer timer;
-  timer.id = id++;
+  timer.id = __sync_fetch_and_add(&id, 1);
   timer.timeout = timeout;
   timer.pid = __process__ != NULL ? __process__->self() : UPID();
   timer.thunk = thunk;
@@ -2126,15 +4257,10 @@ timer create(double secs, const lambda::function<void(void)>& thunk)
 
   // Add the timer.
   synchronized (timeouts) {
-    if (timeouts->size() == 0 || timer.timeout < timeouts->begin()->first) {
+    if (timeouts->add(timer)) {
       // Need to interrupt the loop to update/set timer repeat.
-      (*timeouts)[timer.timeout].push_back(timer);
       update_timer = true;
-      ev_async_send(loop, &async_watcher);
-    } else {
-      // Timer repeat is adequate, just add the timeout.
-      CHECK(timeouts->size() >= 1);
-      (*timeouts)[timer.timeout].push_back(timer);
+      loops[0]->wakeup();
     }
   }
 
@@ -2142,19 +4268,17 @@ timer create(double secs, const lambda::function<void(void)>& thunk)
 }
 
 
-void cancel(const timer& timer)
+bool cancel(const timer& timer)
 {
+  bool removed = false;
+
+  // No need to update the timer repeat, at worst the loop wakes up
+  // early and finds that nothing has timed out.
   synchronized (timeouts) {
-    // Check if the timeout is still pending, and if so, erase
-    // it. In addition, erase an empty list if we just removed the
-    // last timeout.
-    if (timeouts->count(timer.timeout) > 0) {
-      (*timeouts)[timer.timeout].remove(timer);
-      if ((*timeouts)[timer.timeout].empty()) {
-        timeouts->erase(timer.timeout);
-      }
-    }
+    removed = timeouts->remove(timer);
   }
+
+  return removed;
 }
 
 } // namespace timeouts {
@@ -2168,15 +4292,39 @@ ProcessBase::ProcessBase(const std::string& _id)
 
   pthread_mutex_init(&m, NULL);
 
+  incoming = NULL;
+  injected = NULL;
+
+  events_per_batch = DEFAULT_EVENTS_PER_BATCH;
+
+  mailbox_depth = 0;
+  mailbox_max = 0;
+  events_serviced = 0;
+  running_time = 0;
+
+  mailbox_limit = 0;
+
+  runq = NULL;
+  queued = false;
+  queued_at = 0;
+
   refs = 0;
 
   // Generate string representation of unique id for process.
   if (_id != "") {
     pid.id = _id;
   } else {
-    stringstream out;
-    out << __sync_add_and_fetch(&id, 1);
-    pid.id = out.str();
+    // Formatted by hand since this happens for every (short lived)
+    // process that gets spawned, e.g., for every HTTP request.
+    char buffer[16];
+    char* end = buffer + sizeof(buffer);
+    char* start = end;
+    uint32_t value = __sync_add_and_fetch(&id, 1);
+    do {
+      *--start = '0' + value % 10;
+      value /= 10;
+    } while (value > 0);
+    pid.id.assign(start, end);
   }
 
   pid.ip = ip;
@@ -2195,79 +4343,201 @@ ProcessBase::ProcessBase(const std::string& _id)
 }
 
 
-ProcessBase::~ProcessBase() {}
+ProcessBase::~ProcessBase()
+{
+  // Free any events that got enqueued after the process was cleaned
+  // up (see ProcessBase::enqueue).
+  Event* event = NULL;
+  while ((event = dequeue()) != NULL) {
+    delete event;
+  }
+}
+
+
+// Pushes an event onto an (intrusive) mailbox stack.
+static void push(Event* volatile* stack, Event* event)
+{
+  Event* head = NULL;
+  do {
+    head = *stack;
+    event->next = head;
+  } while (!__sync_bool_compare_and_swap(stack, head, event));
+}
+
+
+// Takes the entire contents of a mailbox stack.
+static Event* take(Event* volatile* stack)
+{
+  Event* head = NULL;
+  do {
+    head = *stack;
+  } while (!__sync_bool_compare_and_swap(stack, head, (Event*) NULL));
+  return head;
+}
 
 
 void ProcessBase::enqueue(Event* event, bool inject)
 {
   CHECK(event != NULL);
 
-  // TODO(benh): Put filter inside lock statement below so that we can
+  // Count the events crossing NUMA nodes (only known for processing
+  // threads pinned to CPUs, see RunQueue::node).
+  RunQueue* home = runq;
+  if (__runq__ != NULL && home != NULL && __runq__->node >= 0 &&
+      home->node >= 0 && __runq__->node != home->node) {
+    remote_events.increment();
+  }
+
+  // TODO(benh): Filter and enqueue atomically so that we can
   // guarantee the order of the messages seen by a filter are the same
   // as the order of messages seen by the process. Right now two
   // different threads might execute the filter code and then enqueue
   // the messages in non-deterministic orderings (i.e., there are two
   // "atomic" blocks, the filter code here and the enqueue code
   // below).
-  synchronized (filterer) {
-    if (filterer != NULL) {
-      bool filter = false;
-      struct FilterVisitor : EventVisitor
-      {
-        FilterVisitor(bool* _filter) : filter(_filter) {}
 
-        virtual void visit(const MessageEvent& event)
+  // Only tests install a filter, so don't bother synchronizing
+  // unless one (possibly) is.
+  if (filterer != NULL) {
+    synchronized (filterer) {
+      if (filterer != NULL) {
+        bool filter = false;
+        struct FilterVisitor : EventVisitor
         {
-          *filter = filterer->filter(event);
-        }
+          FilterVisitor(bool* _filter) : filter(_filter) {}
 
-        virtual void visit(const DispatchEvent& event)
-        {
-          *filter = filterer->filter(event);
-        }
+          virtual void visit(const MessageEvent& event)
+          {
+            *filter = filterer->filter(event);
+          }
 
-        virtual void visit(const HttpEvent& event)
-        {
-          *filter = filterer->filter(event);
-        }
+          virtual void visit(const DispatchEvent& event)
+          {
+            *filter = filterer->filter(event);
+          }
 
-        virtual void visit(const ExitedEvent& event)
-        {
-          *filter = filterer->filter(event);
-        }
+          virtual void visit(const HttpEvent& event)
+          {
+            *filter = filterer->filter(event);
+          }
 
-        bool* filter;
-      } visitor(&filter);
+          virtual void visit(const ExitedEvent& event)
+          {
+            *filter = filterer->filter(event);
+          }
 
-      event->visit(&visitor);
+          bool* filter;
+        } visitor(&filter);
 
-      if (filter) {
-        delete event;
-        return;
+        event->visit(&visitor);
+
+        if (filter) {
+          delete event;
+          return;
+        }
       }
     }
   }
 
-  lock();
-  {
-    if (state != FINISHED) {
-      if (!inject) {
-        events.push_back(event);
-      } else {
-        events.push_front(event);
-      }
+  // Drop events for a process that has already been cleaned up. An
+  // event might still get pushed after the process gets cleaned up
+  // (if it gets cleaned up right after we check), but those are only
+  // ever freed when the process gets deleted (see ~ProcessBase).
+  if (state == FINISHED) {
+    delete event;
+    return;
+  }
 
-      if (state == BLOCKED) {
-        state = READY;
-        process_manager->enqueue(this);
-      }
+  event->enqueued = Clock::real();
+
+  // Count the event before it can get dequeued (and uncounted).
+  int64_t depth = __sync_add_and_fetch(&mailbox_depth, 1);
+  int64_t highest = mailbox_max;
+  while (depth > highest &&
+         !__sync_bool_compare_and_swap(&mailbox_max, highest, depth)) {
+    highest = mailbox_max;
+  }
+
+  if (!inject) {
+    push(&incoming, event);
+  } else {
+    push(&injected, event);
+  }
+
+  // Reschedule the process if it's blocked, unless somebody beats us
+  // to it (another enqueuer or the process itself, see
+  // ProcessManager::resume).
+  if (state == BLOCKED &&
+      __sync_bool_compare_and_swap(&state, BLOCKED, READY)) {
+    process_manager->enqueue(this);
+  }
+}
+
+
+Event* ProcessBase::dequeue()
+{
+  // Injected events go ahead of everything else, most recently
+  // injected first (i.e., as though each one was pushed onto the
+  // front of the queue when it was injected).
+  if (injected != NULL) {
+    Event* head = take(&injected);
+
+    // Reverse the stack so that pushing onto the front of the
+    // queue in order leaves the most recently injected in front.
+    Event* reversed = NULL;
+    while (head != NULL) {
+      Event* next = head->next;
+      head->next = reversed;
+      reversed = head;
+      head = next;
+    }
 
-      CHECK(state == BOTTOM ||
-            state == READY ||
-            state == RUNNING);
+    while (reversed != NULL) {
+      events.push_front(reversed);
+      reversed = reversed->next;
     }
   }
-  unlock();
+
+  // Otherwise only look at newly enqueued events once we're out of
+  // the ones we already took (which were all enqueued earlier). The
+  // stack has the most recent first, so pushing onto the front of
+  // the queue in order leaves the oldest in front.
+  if (events.empty() && incoming != NULL) {
+    Event* head = take(&incoming);
+    while (head != NULL) {
+      events.push_front(head);
+      head = head->next;
+    }
+  }
+
+  if (events.empty()) {
+    return NULL;
+  }
+
+  Event* event = events.front();
+  events.pop_front();
+  return event;
+}
+
+
+bool ProcessBase::overloaded(const HttpRequest& request) const
+{
+  return mailbox_limit > 0 &&
+    mailbox_depth >= (int64_t) (mailbox_limit / 2);
+}
+
+
+bool ProcessBase::overloaded(const Message& message) const
+{
+  return mailbox_limit > 0 &&
+    mailbox_depth >= (int64_t) mailbox_limit &&
+    droppables.count(message.name) > 0;
+}
+
+
+bool ProcessBase::pending() const
+{
+  return !events.empty() || injected != NULL || incoming != NULL;
 }
 
 
@@ -2293,8 +4563,28 @@ void ProcessBase::send(const UPID& to, const string& name, const char* data, siz
 }
 
 
+void ProcessBase::send(
+    const UPID& to,
+    const string& name,
+    const std::tr1::shared_ptr<Message::Payload>& payload)
+{
+  if (!to) {
+    return;
+  }
+
+  // Encode and transport outgoing message (which serializes the
+  // payload if the message is remote).
+  Message* message = encode(pid, to, name);
+  message->payload = payload;
+  transport(message, this);
+}
+
+
 void ProcessBase::visit(const MessageEvent& event)
 {
+  // Message handlers (and delegates) expect the actual body.
+  event.message->serialize();
+
   if (handlers.message.count(event.message->name) > 0) {
     handlers.message[event.message->name](
         event.message->from,
@@ -2311,7 +4601,7 @@ void ProcessBase::visit(const MessageEvent& event)
 
 void ProcessBase::visit(const DispatchEvent& event)
 {
-  (*event.function)(this);
+  event(this);
 }
 
 
@@ -2326,29 +4616,12 @@ void ProcessBase::visit(const HttpEvent& event)
   const string& name = event.request->path.substr(index);
 
   if (handlers.http.count(name) > 0) {
-    // Create the promise to link with whatever gets returned, as well
-    // as a future to wait for the response.
-    std::tr1::shared_ptr<Promise<HttpResponse> > promise(
-        new Promise<HttpResponse>());
-
-    Future<HttpResponse>* future = new Future<HttpResponse>(promise->future());
-
-    // Get the HttpProxy pid for this socket.
-    PID<HttpProxy> proxy = socket_manager->proxy(event.c);
-
-    // Let the HttpProxy know about this request (via the future).
-    dispatch(proxy, &HttpProxy::handle, future, event.request->keepAlive);
-
-    // Finally, call the handler and associate the response with the promise.
-    internal::associate(handlers.http[name](*event.request), promise);
+    // Call the handler and associate the response with the promise
+    // (the socket's proxy is waiting on it, see ProcessManager::deliver).
+    internal::associate(handlers.http[name](*event.request), event.response);
   } else {
     VLOG(1) << "Returning '404 Not Found' for '" << event.request->path << "'";
-
-    HttpResponseEncoder* encoder =
-      new HttpResponseEncoder(HttpNotFoundResponse());
-
-    // TODO(benh): Socket might be closed and then re-opened!
-    socket_manager->send(encoder, event.c, event.request->keepAlive);
+    event.response->set(HttpNotFoundResponse());
   }
 }
 
@@ -2401,6 +4674,14 @@ UPID spawn(ProcessBase* process, bool manage)
 }
 
 
+void dedicate(ProcessBase* process)
+{
+  process::initialize();
+
+  process_manager->dedicate(process);
+}
+
+
 void terminate(const UPID& pid, bool inject)
 {
   process_manager->terminate(pid, inject, __process__);
@@ -2494,6 +4775,38 @@ void post(const UPID& to, const string& name, const char* data, size_t length)
 }
 
 
+void post(const UPID& from,
+          const UPID& to,
+          const string& name,
+          const char* data,
+          size_t length)
+{
+  process::initialize();
+
+  if (!to) {
+    return;
+  }
+
+  transport(encode(from, to, name, string(data, length)));
+}
+
+
+void post(const vector<UPID>& to,
+          const string& name,
+          const std::tr1::shared_ptr<Message::Payload>& payload)
+{
+  process::initialize();
+
+  foreach (const UPID& pid, to) {
+    if (pid) {
+      Message* message = encode(UPID(), pid, name);
+      message->payload = payload;
+      transport(message);
+    }
+  }
+}
+
+
 namespace internal {
 
 void dispatch(const UPID& pid, lambda::function<void(ProcessBase*)>* f)
@@ -2503,5 +4816,13 @@ void dispatch(const UPID& pid, lambda::function<void(ProcessBase*)>* f)
   process_manager->deliver(pid, f, __process__);
 }
 
+
+void deliver(const UPID& pid, DispatchEvent* event)
+{
+  process::initialize();
+
+  process_manager->deliver(pid, event, __process__);
+}
+
 } // namespace internal {
 } // namespace process {
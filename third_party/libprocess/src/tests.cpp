@@ -5,6 +5,9 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 
+#include <sys/select.h>
+
+#include <list>
 #include <string>
 #include <sstream>
 
@@ -15,12 +18,16 @@
 #include <process/filter.hpp>
 #include <process/future.hpp>
 #include <process/gc.hpp>
+#include <process/metrics.hpp>
 #include <process/process.hpp>
 #include <process/run.hpp>
+#include <process/statistics.hpp>
 #include <process/timer.hpp>
 
+#include "decoder.hpp"
 #include "encoder.hpp"
 #include "thread.hpp"
+#include "wheel.hpp"
 
 // Definition of a Set action to be used with gmock.
 ACTION_P2(Set, variable, value) { *variable = value; }
@@ -153,6 +160,42 @@ TEST(libprocess, dispatch)
 }
 
 
+TEST(libprocess, tell)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  DispatchProcess process;
+
+  EXPECT_CALL(process, func0())
+    .Times(1);
+
+  EXPECT_CALL(process, func1(_))
+    .WillOnce(ReturnArg<0>());
+
+  EXPECT_CALL(process, func2(_))
+    .WillOnce(ReturnArg<0>());
+
+  EXPECT_CALL(process, func3(_))
+    .WillOnce(ReturnArg<0>());
+
+  PID<DispatchProcess> pid = spawn(&process);
+
+  ASSERT_FALSE(!pid);
+
+  tell(pid, &DispatchProcess::func0);
+  tell(pid, &DispatchProcess::func1, true);
+  tell(pid, &DispatchProcess::func2, true);
+
+  // Dispatches are handled in order, so the calls above have all
+  // been made once this one is.
+  Future<int> future = dispatch(pid, &DispatchProcess::func3, 42);
+
+  EXPECT_EQ(42, future.get());
+
+  terminate(pid);
+  wait(pid);
+}
+
 TEST(libprocess, defer)
 {
   ASSERT_TRUE(GTEST_IS_THREADSAFE);
@@ -494,6 +537,31 @@ TEST(libprocess, donate)
 }
 
 
+class DedicateProcess : public Process<DedicateProcess>
+{
+public:
+  pthread_t thread() { return pthread_self(); }
+};
+
+
+TEST(libprocess, dedicate)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  DedicateProcess process;
+  dedicate(&process);
+  spawn(process);
+
+  Future<pthread_t> thread1 = dispatch(process, &DedicateProcess::thread);
+  Future<pthread_t> thread2 = dispatch(process, &DedicateProcess::thread);
+
+  EXPECT_TRUE(pthread_equal(thread1.get(), thread2.get()));
+
+  terminate(process);
+  wait(process);
+}
+
+
 class ExitedProcess : public Process<ExitedProcess>
 {
 public:
@@ -552,6 +620,135 @@ TEST(libprocess, select)
 }
 
 
+static Future<std::string> itoa1(int i)
+{
+  std::ostringstream out;
+  out << i;
+  return out.str();
+}
+
+
+static std::string itoa2(int i)
+{
+  std::ostringstream out;
+  out << i;
+  return out.str();
+}
+
+
+class AwaitProcess : public Process<AwaitProcess>
+{
+public:
+  bool await(const Future<bool>& future)
+  {
+    return future.await() && future.get();
+  }
+};
+
+
+TEST(libprocess, fibers)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  // More processes waiting than there are processing threads, which
+  // only works if waiting doesn't block the threads.
+  const int processes = 256;
+
+  Promise<bool> promise;
+
+  std::list<AwaitProcess*> awaiters;
+  std::list<Future<bool> > futures;
+
+  for (int i = 0; i < processes; i++) {
+    AwaitProcess* awaiter = new AwaitProcess();
+    spawn(awaiter);
+    awaiters.push_back(awaiter);
+    futures.push_back(
+        dispatch(awaiter, &AwaitProcess::await, promise.future()));
+  }
+
+  promise.set(true);
+
+  for (std::list<Future<bool> >::iterator it = futures.begin();
+       it != futures.end(); ++it) {
+    EXPECT_TRUE(it->get());
+  }
+
+  for (std::list<AwaitProcess*>::iterator it = awaiters.begin();
+       it != awaiters.end(); ++it) {
+    terminate(*it);
+    wait(*it);
+    delete *it;
+  }
+}
+
+
+TEST(libprocess, then)
+{
+  Promise<int> promise;
+
+  std::tr1::function<Future<std::string>(const int&)> f1 = itoa1;
+  std::tr1::function<std::string(const int&)> f2 = itoa2;
+
+  Future<std::string> future1 = promise.future().then(f1);
+  Future<std::string> future2 = promise.future().then(f2);
+
+  EXPECT_TRUE(future1.isPending());
+  EXPECT_TRUE(future2.isPending());
+
+  promise.set(42);
+
+  EXPECT_TRUE(future1.await());
+  EXPECT_EQ("42", future1.get());
+  EXPECT_TRUE(future2.await());
+  EXPECT_EQ("42", future2.get());
+
+  Promise<int> failed;
+  Future<std::string> future3 = failed.future().then(f2);
+  failed.fail("failure");
+  EXPECT_TRUE(future3.isFailed());
+  EXPECT_EQ("failure", future3.failure());
+}
+
+
+TEST(libprocess, collect)
+{
+  Promise<int> promise1;
+  Promise<int> promise2;
+  Promise<int> promise3;
+
+  std::list<Future<int> > futures;
+  futures.push_back(promise1.future());
+  futures.push_back(promise2.future());
+  futures.push_back(promise3.future());
+
+  Future<std::list<int> > future = collect(futures);
+
+  promise3.set(3);
+  promise1.set(1);
+
+  EXPECT_TRUE(future.isPending());
+
+  promise2.set(2);
+
+  EXPECT_TRUE(future.await());
+
+  std::list<int> values;
+  values.push_back(1);
+  values.push_back(2);
+  values.push_back(3);
+
+  EXPECT_EQ(values, future.get());
+
+  // A failed future fails the collected future.
+  Promise<int> promise4;
+  futures.push_back(promise4.future());
+  promise4.fail("failure");
+
+  EXPECT_TRUE(collect(futures).isFailed());
+}
+
+
 // #define ENUMERATE1(item) item##1
 // #define ENUMERATE2(item) ENUMERATE1(item), item##2
 // #define ENUMERATE3(item) ENUMERATE2(item), item##3
@@ -596,6 +793,22 @@ TEST(libprocess, pid)
 }
 
 
+TEST(libprocess, parse)
+{
+  UPID pid("id@127.0.0.1:5050");
+  EXPECT_EQ("id", pid.id);
+  EXPECT_EQ(htonl(INADDR_LOOPBACK), pid.ip);
+  EXPECT_EQ(5050, pid.port);
+  EXPECT_EQ("id@127.0.0.1:5050", (std::string) pid);
+
+  // Parsing a host name (twice, the second time from the cache).
+  EXPECT_EQ(pid, UPID("id@localhost:5050"));
+  EXPECT_EQ(pid, UPID("id@localhost:5050"));
+
+  EXPECT_FALSE(UPID("id@127.0.0.1"));
+  EXPECT_FALSE(UPID("127.0.0.1:5050"));
+}
+
 class Listener1 : public Process<Listener1>
 {
 public:
@@ -742,6 +955,358 @@ TEST(libprocess, remote)
 }
 
 
+TEST(libprocess, binary)
+{
+  BinarySymbols symbols;
+
+  Message* message1 = new Message();
+  message1->name = "name";
+  message1->from = UPID("from", 1, 2);
+  message1->to = UPID("to", 3, 4);
+  message1->body = "body";
+
+  Message* message2 = new Message(*message1);
+  message2->body = "";
+
+  // The second message should only refer to previously interned strings.
+  BinaryMessageEncoder encoder1(message1, &symbols, true);
+  BinaryMessageEncoder encoder2(message2, &symbols, false);
+
+  size_t size1, size2;
+  const char* data1 = encoder1.next(&size1);
+  const char* data2 = encoder2.next(&size2);
+
+  EXPECT_GT(size1, size2);
+
+  // Decode one byte at a time to exercise partial frames.
+  DataDecoder decoder;
+  std::deque<Message*> messages;
+
+  const std::string& data =
+    std::string(data1, size1) + std::string(data2, size2);
+  for (size_t i = 0; i < data.size(); i++) {
+    decoder.decode(data.data() + i, 1);
+    EXPECT_TRUE(decoder.requests().empty());
+    const std::deque<Message*>& decoded = decoder.messages();
+    messages.insert(messages.end(), decoded.begin(), decoded.end());
+  }
+
+  EXPECT_FALSE(decoder.failed());
+
+  ASSERT_EQ(2, messages.size());
+
+  EXPECT_EQ("name", messages[0]->name);
+  EXPECT_EQ(UPID("from", 1, 2), messages[0]->from);
+  EXPECT_EQ(UPID("to", 3, 4), messages[0]->to);
+  EXPECT_EQ("body", messages[0]->body);
+
+  EXPECT_EQ("name", messages[1]->name);
+  EXPECT_EQ(UPID("from", 1, 2), messages[1]->from);
+  EXPECT_EQ(UPID("to", 3, 4), messages[1]->to);
+  EXPECT_EQ("", messages[1]->body);
+
+  delete messages[0];
+  delete messages[1];
+
+  // Now decode all of the frames at once (and then some more data of
+  // a partial frame) straight out of the data.
+  DataDecoder decoder2;
+  decoder2.decode(data.data(), data.size() - 1);
+  ASSERT_EQ(1, decoder2.messages().size());
+  delete decoder2.messages()[0];
+
+  decoder2.decode(data.data() + data.size() - 1, 1);
+  ASSERT_EQ(1, decoder2.messages().size());
+  EXPECT_EQ("", decoder2.messages()[0]->body);
+  delete decoder2.messages()[0];
+
+  EXPECT_FALSE(decoder2.failed());
+}
+
+
+TEST(libprocess, compression)
+{
+  BinarySymbols symbols;
+
+  Message* message = new Message();
+  message->name = "name";
+  message->from = UPID("from", 1, 2);
+  message->to = UPID("to", 3, 4);
+  message->body = std::string(10000, 'x');
+
+  // Bodies of at least the threshold get gzipped in both framings.
+  BinaryMessageEncoder binary(new Message(*message), &symbols, true, 1024);
+  MessageEncoder http(new Message(*message), 1024);
+
+  size_t binarySize, httpSize;
+  const char* binaryData = binary.next(&binarySize);
+  const char* httpData = http.next(&httpSize);
+
+  EXPECT_LT(binarySize, message->body.size());
+  EXPECT_LT(httpSize, message->body.size());
+
+  DataDecoder binaryDecoder;
+  binaryDecoder.decode(binaryData, binarySize);
+
+  EXPECT_FALSE(binaryDecoder.failed());
+  ASSERT_EQ(1, binaryDecoder.messages().size());
+  EXPECT_EQ(message->body, binaryDecoder.messages()[0]->body);
+  delete binaryDecoder.messages()[0];
+
+  DataDecoder httpDecoder;
+  httpDecoder.decode(httpData, httpSize);
+
+  EXPECT_FALSE(httpDecoder.failed());
+  ASSERT_EQ(1, httpDecoder.requests().size());
+  EXPECT_EQ(message->body, httpDecoder.requests()[0]->body);
+  EXPECT_EQ(0, httpDecoder.requests()[0]->headers.count("Content-Encoding"));
+  delete httpDecoder.requests()[0];
+
+  // Smaller bodies get sent as is.
+  message->body = "body";
+
+  MessageEncoder uncompressed(message, 1024);
+
+  size_t size;
+  const char* data = uncompressed.next(&size);
+
+  EXPECT_EQ(std::string::npos,
+            std::string(data, size).find("Content-Encoding"));
+}
+
+
+TEST(libprocess, decompressionLimit)
+{
+  BinarySymbols symbols;
+
+  Message message;
+  message.name = "name";
+  message.from = UPID("from", 1, 2);
+  message.to = UPID("to", 3, 4);
+  message.body = std::string(100000, 'x');
+
+  BinaryMessageEncoder binary(new Message(message), &symbols, true, 1024);
+  MessageEncoder http(new Message(message), 1024);
+
+  size_t binarySize, httpSize;
+  const char* binaryData = binary.next(&binarySize);
+  const char* httpData = http.next(&httpSize);
+
+  // Bodies that decompress to more than the limit fail the connection.
+  DataDecoder binaryDecoder(10000);
+  binaryDecoder.decode(binaryData, binarySize);
+
+  EXPECT_TRUE(binaryDecoder.failed());
+  EXPECT_TRUE(binaryDecoder.messages().empty());
+
+  DataDecoder httpDecoder(10000);
+  httpDecoder.decode(httpData, httpSize);
+
+  EXPECT_TRUE(httpDecoder.failed());
+  EXPECT_TRUE(httpDecoder.requests().empty());
+
+  // Any other request keeps its gzipped body (it's up to whoever
+  // handles it to decompress it, if at all).
+  const std::string& compressed = Gzip::compress(message.body);
+
+  std::ostringstream out;
+  out << "POST /upload HTTP/1.1\r\n"
+      << "Content-Encoding: gzip\r\n"
+      << "Content-Length: " << compressed.size() << "\r\n"
+      << "\r\n"
+      << compressed;
+
+  const std::string& request = out.str();
+
+  DataDecoder decoder(10000);
+  decoder.decode(request.data(), request.size());
+
+  EXPECT_FALSE(decoder.failed());
+  ASSERT_EQ(1, decoder.requests().size());
+  EXPECT_EQ(compressed, decoder.requests()[0]->body);
+  EXPECT_EQ("gzip", decoder.requests()[0]->headers["Content-Encoding"]);
+  delete decoder.requests()[0];
+}
+
+
+TEST(libprocess, frameLimit)
+{
+  // A frame bigger than the maximum fails the connection as soon as
+  // its size is known (i.e., without waiting for, or buffering, it).
+  std::string data(BINARY_MAGIC, BINARY_MAGIC_SIZE);
+  uint32_t size = htonl(1024 * 1024);
+  data.append((const char*) &size, sizeof(size));
+
+  DataDecoder decoder(1024);
+  decoder.decode(data.data(), data.size());
+
+  EXPECT_TRUE(decoder.failed());
+  EXPECT_TRUE(decoder.messages().empty());
+}
+
+
+TEST(libprocess, wheel)
+{
+  const double now = 1000.0;
+
+  TimerWheel wheel(now);
+
+  // Timers in the lowest level, a higher level, and overflow.
+  double secs[] = { 0.0105, 0.4, 70.0, 0.4, 60.0 * 60.0 * 24.0 * 60.0 };
+
+  timer timers[5];
+  for (int i = 0; i < 5; i++) {
+    timers[i].id = i;
+    timers[i].timeout = now + secs[i];
+  }
+
+  EXPECT_TRUE(wheel.add(timers[2]));
+  EXPECT_TRUE(wheel.add(timers[1]));
+  EXPECT_FALSE(wheel.add(timers[3]));
+  EXPECT_FALSE(wheel.add(timers[4]));
+  EXPECT_TRUE(wheel.add(timers[0]));
+
+  EXPECT_EQ(5, wheel.size());
+  EXPECT_EQ(now + secs[0], wheel.next());
+
+  // A removed timer should never expire.
+  EXPECT_TRUE(wheel.remove(timers[3]));
+  EXPECT_FALSE(wheel.remove(timers[3]));
+
+  std::list<timer> expired;
+
+  // Nothing should expire early, even within the same tick.
+  wheel.expire(now + 0.01, &expired);
+  EXPECT_TRUE(expired.empty());
+
+  wheel.expire(now + 0.0105, &expired);
+  ASSERT_EQ(1, expired.size());
+  EXPECT_EQ(0, expired.front().id);
+  expired.clear();
+
+  EXPECT_EQ(now + secs[1], wheel.next());
+
+  wheel.expire(now + 100.0, &expired);
+  ASSERT_EQ(2, expired.size());
+  EXPECT_EQ(1, expired.front().id);
+  EXPECT_EQ(2, expired.back().id);
+  expired.clear();
+
+  EXPECT_FALSE(wheel.remove(timers[2]));
+
+  EXPECT_EQ(1, wheel.size());
+  EXPECT_EQ(now + secs[4], wheel.next());
+
+  // Going backwards in time shouldn't lose any timers.
+  wheel.rebase(now);
+  EXPECT_EQ(now + secs[4], wheel.next());
+
+  wheel.expire(now + secs[4], &expired);
+  ASSERT_EQ(1, expired.size());
+  EXPECT_EQ(4, expired.front().id);
+
+  EXPECT_TRUE(wheel.empty());
+}
+
+
+TEST(libprocess, histogram)
+{
+  Histogram histogram;
+
+  histogram.record(0.0000005); // Under a microsecond.
+  histogram.record(0.000001);
+  histogram.record(0.000003);
+  histogram.record(0.002);
+  histogram.record(60.0);
+
+  EXPECT_EQ(1, histogram.counts[0]);
+  EXPECT_EQ(1, histogram.counts[1]);
+  EXPECT_EQ(1, histogram.counts[2]);
+  EXPECT_EQ(1, histogram.counts[11]); // 2000 microseconds.
+  EXPECT_EQ(1, histogram.counts[Histogram::BUCKETS - 1]);
+  EXPECT_EQ(60.0, histogram.max);
+
+  HandlerStatistics statistics;
+  statistics.record(0.5, 0.25);
+  statistics.record(0.5, 0.75);
+
+  EXPECT_EQ(2, statistics.count);
+  EXPECT_EQ(1.0, statistics.waiting.total);
+  EXPECT_EQ(1.0, statistics.running.total);
+  EXPECT_EQ(0.75, statistics.running.max);
+}
+
+
+TEST(libprocess, metrics)
+{
+  metrics::Counter counter1("test_total", "Test.", metrics::label("a", "b"));
+  metrics::Counter counter2("test_total", "Test.", metrics::label("a", "b"));
+  metrics::Gauge gauge("test_gauge", "Test.");
+  metrics::Timer timer("test_seconds", "Test.");
+
+  counter1.increment();
+  counter2.increment(2);
+  gauge.increment(3);
+  gauge.decrement();
+  timer.record(0.000003);
+  timer.record(60.0);
+
+  EXPECT_EQ(1, counter1.value());
+  EXPECT_EQ(2, gauge.value());
+  EXPECT_EQ(1, timer.snapshot().counts[2]);
+  EXPECT_EQ(60.0, timer.snapshot().max);
+
+  const std::string& text = metrics::text();
+
+  // Counters with the same name and labels are summed up.
+  EXPECT_NE(std::string::npos, text.find("# TYPE test_total counter\n"));
+  EXPECT_NE(std::string::npos, text.find("test_total{a=\"b\"} 3\n"));
+  EXPECT_NE(std::string::npos, text.find("test_gauge 2\n"));
+  EXPECT_NE(std::string::npos, text.find("test_seconds_bucket{le=\"4e-06\"} 1\n"));
+  EXPECT_NE(std::string::npos, text.find("test_seconds_bucket{le=\"+Inf\"} 2\n"));
+  EXPECT_NE(std::string::npos, text.find("test_seconds_count 2\n"));
+}
+
+
+// Returns the value of the sample of a metric (or -1 if it's missing).
+static double sample(const std::string& text, const std::string& name)
+{
+  size_t index = text.find("\n" + name + " ");
+  if (index == std::string::npos) {
+    return -1;
+  }
+  return atof(text.c_str() + index + name.size() + 2);
+}
+
+
+TEST(libprocess, watchdog)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  // Run a process so that it goes through a run queue.
+  SpawnProcess process;
+
+  EXPECT_CALL(process, initialize())
+    .Times(1);
+
+  EXPECT_CALL(process, finalize())
+    .Times(1);
+
+  PID<SpawnProcess> pid = spawn(process);
+
+  terminate(pid);
+  wait(pid);
+
+  // Give the watchdog of each I/O loop a chance to fire.
+  usleep(300000);
+
+  const std::string& text = metrics::text();
+
+  EXPECT_GT(sample(text, "libprocess_io_loop_lag_seconds_count"), 0);
+  EXPECT_GT(sample(text, "libprocess_run_queue_wait_seconds_count"), 0);
+}
+
+
 class HttpProcess : public Process<HttpProcess>
 {
 public:
@@ -803,6 +1368,399 @@ TEST(libprocess, http)
 }
 
 
+
+TEST(libprocess, etag)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  HttpProcess process;
+
+  HttpOKResponse ok;
+  ok.headers["ETag"] = "\"42\"";
+  ok.body = "hello world";
+
+  EXPECT_CALL(process, handler(_))
+    .WillRepeatedly(Return(ok));
+
+  spawn(process);
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = PF_INET;
+  addr.sin_port = htons(process.self().port);
+  addr.sin_addr.s_addr = process.self().ip;
+
+  // Entity tags that match (or not) the one of the response, and the
+  // status that each should get.
+  const char* etags[] = { "\"42\"", "\"41\", \"42\"", "*", "\"41\"" };
+  const char* statuses[] = {
+    "HTTP/1.1 304 Not Modified",
+    "HTTP/1.1 304 Not Modified",
+    "HTTP/1.1 304 Not Modified",
+    "HTTP/1.1 200 OK"
+  };
+
+  for (int i = 0; i < 4; i++) {
+    int s = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+
+    ASSERT_LE(0, s);
+
+    ASSERT_EQ(0, connect(s, (sockaddr*) &addr, sizeof(addr)));
+
+    std::ostringstream out;
+
+    out << "GET /" << process.self().id << "/" << "handler"
+        << " HTTP/1.0\r\n"
+        << "If-None-Match: " << etags[i] << "\r\n"
+        << "\r\n";
+
+    const std::string& data = out.str();
+
+    ASSERT_EQ(data.size(), write(s, data.data(), data.size()));
+
+    const std::string status = statuses[i];
+
+    char temp[status.size()];
+
+    ASSERT_LT(0, read(s, temp, status.size()));
+
+    EXPECT_EQ(status, std::string(temp, status.size()));
+
+    ASSERT_EQ(0, close(s));
+  }
+
+  terminate(process);
+  wait(process);
+}
+
+
+// Sends the data to the process and returns everything received
+// until the server closes the connection.
+static std::string request(const UPID& pid, const std::string& data)
+{
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = PF_INET;
+  addr.sin_port = htons(pid.port);
+  addr.sin_addr.s_addr = pid.ip;
+
+  int s = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+  CHECK(s >= 0);
+  CHECK(connect(s, (sockaddr*) &addr, sizeof(addr)) == 0);
+
+  CHECK(write(s, data.data(), data.size()) == data.size());
+
+  std::string result;
+  char temp[1024];
+  ssize_t length;
+  while ((length = read(s, temp, sizeof(temp))) > 0) {
+    result.append(temp, length);
+  }
+
+  close(s);
+
+  return result;
+}
+
+
+// Sends a GET request for the handler of the process (with the extra
+// headers) and returns the response.
+static std::string get(const UPID& pid, const std::string& headers)
+{
+  std::ostringstream out;
+  out << "GET /" << pid.id << "/handler HTTP/1.0\r\n" << headers << "\r\n";
+  return request(pid, out.str());
+}
+
+
+TEST(libprocess, chunked)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  HttpProcess process;
+
+  HttpOKResponse ok;
+  ok.stream.reset(new HttpStream());
+  ok.stream->write("hello");
+
+  EXPECT_CALL(process, handler(_))
+    .WillOnce(Return(ok));
+
+  spawn(process);
+
+  // Finish the body while the response is (possibly) being sent.
+  ok.stream->write(" world");
+  ok.stream->close();
+
+  EXPECT_FALSE(ok.stream->write("!"));
+
+  const std::string response = get(process.self(), "");
+
+  EXPECT_NE(std::string::npos,
+            response.find("Transfer-Encoding: chunked\r\n"));
+  EXPECT_EQ(std::string::npos, response.find("Content-Length"));
+
+  // Writes may or may not have been coalesced into one chunk.
+  const std::string body = response.substr(response.find("\r\n\r\n") + 4);
+  EXPECT_TRUE(body == "b\r\nhello world\r\n0\r\n\r\n" ||
+              body == "5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n")
+    << body;
+
+  terminate(process);
+  wait(process);
+}
+
+
+TEST(libprocess, gzip)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  HttpProcess process;
+
+  HttpOKResponse ok;
+  ok.body = std::string(4096, 'a');
+
+  EXPECT_CALL(process, handler(_))
+    .WillRepeatedly(Return(ok));
+
+  spawn(process);
+
+  std::string response = get(process.self(), "Accept-Encoding: gzip\r\n");
+
+  EXPECT_NE(std::string::npos, response.find("Content-Encoding: gzip\r\n"));
+
+  // The compressed body is a (much smaller) gzip stream.
+  std::string body = response.substr(response.find("\r\n\r\n") + 4);
+  EXPECT_GT(ok.body.size(), body.size());
+  ASSERT_LE(2u, body.size());
+  EXPECT_EQ('\x1f', body[0]);
+  EXPECT_EQ('\x8b', body[1]);
+
+  // Clients that don't accept it get the body as is.
+  response = get(process.self(), "");
+
+  EXPECT_EQ(std::string::npos, response.find("Content-Encoding"));
+  EXPECT_EQ(ok.body, response.substr(response.find("\r\n\r\n") + 4));
+
+  terminate(process);
+  wait(process);
+}
+
+
+TEST(libprocess, pipelining)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  HttpProcess process;
+
+  Promise<HttpResponse> promise;
+
+  HttpOKResponse ok;
+  ok.body = "second";
+
+  EXPECT_CALL(process, handler(_))
+    .WillOnce(Return(promise.future()))
+    .WillOnce(Return(ok));
+
+  spawn(process);
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = PF_INET;
+  addr.sin_port = htons(process.self().port);
+  addr.sin_addr.s_addr = process.self().ip;
+
+  int s = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+
+  ASSERT_LE(0, s);
+
+  ASSERT_EQ(0, connect(s, (sockaddr*) &addr, sizeof(addr)));
+
+  std::ostringstream out;
+
+  out << "GET /" << process.self().id << "/handler HTTP/1.1\r\n"
+      << "\r\n"
+      << "GET /" << process.self().id << "/handler HTTP/1.1\r\n"
+      << "Connection: close\r\n"
+      << "\r\n";
+
+  const std::string& data = out.str();
+
+  ASSERT_EQ(data.size(), write(s, data.data(), data.size()));
+
+  // The second response can't be sent before the first one.
+  fd_set fds;
+  FD_ZERO(&fds);
+  FD_SET(s, &fds);
+
+  timeval timeout;
+  timeout.tv_sec = 0;
+  timeout.tv_usec = 100000;
+
+  EXPECT_EQ(0, select(s + 1, &fds, NULL, NULL, &timeout));
+
+  HttpOKResponse first;
+  first.body = "first";
+  promise.set(first);
+
+  std::string response;
+  char temp[1024];
+  ssize_t length;
+  while ((length = read(s, temp, sizeof(temp))) > 0) {
+    response.append(temp, length);
+  }
+
+  ASSERT_EQ(0, close(s));
+
+  ASSERT_NE(std::string::npos, response.find("first"));
+  ASSERT_NE(std::string::npos, response.find("second"));
+  EXPECT_LT(response.find("first"), response.find("second"));
+
+  terminate(process);
+  wait(process);
+}
+
+
+class CountingProcess : public Process<CountingProcess>
+{
+public:
+  CountingProcess() : ProcessBase("counting"), count(0) {}
+
+  int increment() { return ++count; }
+
+private:
+  int count;
+};
+
+
+TEST(libprocess, processes)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  CountingProcess process;
+
+  spawn(process);
+
+  dispatch(process, &CountingProcess::increment);
+  dispatch(process, &CountingProcess::increment);
+
+  Future<int> count = dispatch(process, &CountingProcess::increment);
+
+  count.await();
+  ASSERT_TRUE(count.isReady());
+  EXPECT_EQ(3, count.get());
+
+  int s = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+
+  ASSERT_LE(0, s);
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = PF_INET;
+  addr.sin_port = htons(process.self().port);
+  addr.sin_addr.s_addr = process.self().ip;
+
+  ASSERT_EQ(0, connect(s, (sockaddr*) &addr, sizeof(addr)));
+
+  std::ostringstream out;
+
+  out << "GET /__processes__ HTTP/1.0\r\n"
+      << "Connection: Keep-Alive\r\n"
+      << "\r\n";
+
+  const std::string& data = out.str();
+
+  ASSERT_EQ(data.size(), write(s, data.data(), data.size()));
+
+  // Read until the end of the JSON array.
+  std::string response;
+  char temp[4096];
+  while (response.find("}]") == std::string::npos) {
+    ssize_t length = read(s, temp, sizeof(temp));
+    ASSERT_LT(0, length);
+    response.append(temp, length);
+  }
+
+  ASSERT_EQ(0, close(s));
+
+  size_t index = response.find("{\"id\":\"counting\"");
+  ASSERT_NE(std::string::npos, index);
+
+  const std::string& object =
+    response.substr(index, response.find('}', index) - index);
+
+  EXPECT_NE(std::string::npos, object.find("\"mailbox_depth\":0,"));
+  EXPECT_NE(std::string::npos, object.find("\"events\":3,"));
+
+  terminate(process);
+  wait(process);
+}
+
+
+class LimitedProcess : public Process<LimitedProcess>
+{
+public:
+  LimitedProcess() : dropped(0), kept(0)
+  {
+    limit(4);
+    droppable("drop");
+    install("drop", &LimitedProcess::drop);
+    install("keep", &LimitedProcess::keep);
+  }
+
+  void block(const Future<bool>& future)
+  {
+    started.set(true);
+    future.await();
+  }
+
+  void drop(const UPID& from, const std::string& body) { dropped++; }
+  void keep(const UPID& from, const std::string& body) { kept++; }
+
+  int handled() { return dropped + kept; }
+
+  Promise<bool> started;
+  int dropped;
+  int kept;
+};
+
+
+TEST(libprocess, limit)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  LimitedProcess process;
+
+  spawn(process);
+
+  // Keep the process busy while its mailbox fills up.
+  Promise<bool> promise;
+  dispatch(process, &LimitedProcess::block, promise.future());
+  process.started.future().await();
+
+  for (int i = 0; i < 10; i++) {
+    post(process.self(), "drop");
+  }
+
+  post(process.self(), "keep");
+  post(process.self(), "keep");
+
+  promise.set(true);
+
+  Future<int> handled = dispatch(process, &LimitedProcess::handled);
+
+  handled.await();
+  ASSERT_TRUE(handled.isReady());
+
+  // Only the droppable messages that arrived once the mailbox held 4
+  // events got dropped.
+  EXPECT_EQ(6, handled.get());
+  EXPECT_EQ(2, process.kept);
+
+  terminate(process);
+  wait(process);
+}
+
 int main(int argc, char** argv)
 {
   // Initialize Google Mock/Test.
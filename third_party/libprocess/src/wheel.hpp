@@ -0,0 +1,343 @@
+#ifndef __WHEEL_HPP__
+#define __WHEEL_HPP__
+
+#include <math.h>
+#include <stdint.h>
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <limits>
+#include <list>
+
+#include <boost/unordered_map.hpp>
+
+#include <process/timer.hpp>
+
+#include "foreach.hpp"
+
+
+namespace process {
+
+// A hierarchical timing wheel (see Varghese and Lauck, "Hashed and
+// Hierarchical Timing Wheels") for storing timers. Time is divided
+// into ticks (of 'resolution' seconds) and a timer is kept in the
+// slot of the lowest level that covers its tick, so adding and
+// removing a timer is O(1) and expiring timers only ever touches the
+// slots between the last tick and now (skipping levels which are
+// empty). Timers are cascaded down a level each time the wheel
+// reaches the slot they are in. Note that a timer only ever expires
+// once its exact timeout has passed, ticks are just for bookkeeping.
+// This class is not thread-safe.
+class TimerWheel
+{
+public:
+  TimerWheel(double now, double _resolution = 0.001)
+    : resolution(_resolution),
+      current(ticks(now)),
+      size_(0),
+      earliest(std::numeric_limits<double>::max()),
+      stale(false)
+  {
+    for (int level = 0; level <= LEVELS; level++) {
+      counts[level] = 0;
+    }
+  }
+
+  // Adds the timer, returning true if it might be the earliest timer
+  // (i.e., the timeout returned by 'next' might have changed).
+  bool add(const timer& timer)
+  {
+    bool earlier = stale || timer.timeout < earliest;
+
+    if (timer.timeout < earliest) {
+      earliest = timer.timeout;
+      stale = false;
+    }
+
+    int level;
+    Slot* slot = place(ticks(timer.timeout), &level);
+    slot->push_back(timer);
+
+    Location& location = locations[timer.id];
+    location.slot = slot;
+    location.iterator = --slot->end();
+    location.level = level;
+    counts[level]++;
+    size_++;
+
+    return earlier;
+  }
+
+  // Removes the timer, returning false if it has already expired
+  // (or been removed).
+  bool remove(const timer& timer)
+  {
+    boost::unordered_map<long, Location>::iterator iterator =
+      locations.find(timer.id);
+
+    if (iterator == locations.end()) {
+      return false;
+    }
+
+    const Location& location = iterator->second;
+
+    if (location.iterator->timeout <= earliest) {
+      stale = true;
+    }
+
+    location.slot->erase(location.iterator);
+    counts[location.level]--;
+    locations.erase(iterator);
+
+    if (--size_ == 0) {
+      earliest = std::numeric_limits<double>::max();
+      stale = false;
+    }
+
+    return true;
+  }
+
+  // Removes all timers whose timeout is at or before 'now' and
+  // appends them to 'expired' (earliest tick first).
+  void expire(double now, std::list<timer>* expired)
+  {
+    const int64_t target = ticks(now);
+
+    size_t count = 0;
+
+    while (true) {
+      // Expire timers in the current slot (some might not be due
+      // yet if this is the tick of 'now').
+      Slot& slot = slots[0][current & MASK];
+      Slot::iterator iterator = slot.begin();
+      while (iterator != slot.end()) {
+        if (iterator->timeout <= now) {
+          expired->push_back(*iterator);
+          locations.erase(iterator->id);
+          iterator = slot.erase(iterator);
+          counts[0]--;
+          count++;
+        } else {
+          ++iterator;
+        }
+      }
+
+      if (current >= target) {
+        break;
+      }
+
+      // Advance to the next slot that might have timers, which is the
+      // next tick if the lowest level has any timers or otherwise the
+      // next slot boundary of the lowest level that has any timers.
+      int level = 0;
+      while (level < LEVELS && counts[level] == 0) {
+        level++;
+      }
+
+      if (level == LEVELS && counts[LEVELS] == 0) {
+        current = target;
+        break;
+      }
+
+      const int shift = BITS * level;
+      const int64_t next = ((current >> shift) + 1) << shift;
+
+      current = std::min(next, target);
+
+      if (current == next) {
+        cascade();
+      }
+    }
+
+    if (count > 0) {
+      size_ -= count;
+      stale = true;
+    }
+
+    if (size_ == 0) {
+      earliest = std::numeric_limits<double>::max();
+      stale = false;
+    }
+  }
+
+  // Re-adds all timers relative to 'now', necessary if time might
+  // have gone backwards (e.g., after resuming a paused clock).
+  void rebase(double now)
+  {
+    Slot pending;
+
+    for (int level = 0; level < LEVELS; level++) {
+      for (int index = 0; index < SLOTS; index++) {
+        pending.splice(pending.end(), slots[level][index]);
+      }
+      counts[level] = 0;
+    }
+
+    pending.splice(pending.end(), overflow);
+    counts[LEVELS] = 0;
+
+    current = ticks(now);
+
+    reinsert(&pending);
+  }
+
+  // Returns the earliest timeout (the wheel must not be empty).
+  double next()
+  {
+    CHECK(size_ > 0);
+
+    if (stale) {
+      earliest = search();
+      stale = false;
+    }
+
+    return earliest;
+  }
+
+  bool empty() const { return size_ == 0; }
+
+  size_t size() const { return size_; }
+
+private:
+  // Each level has 2^BITS slots, so with a 1ms resolution the lowest
+  // level spans 256ms and all levels span ~49 days (timers further
+  // out than that are kept in 'overflow').
+  static const int BITS = 8;
+  static const int LEVELS = 4;
+  static const int SLOTS = 1 << BITS;
+  static const int64_t MASK = SLOTS - 1;
+
+  typedef std::list<timer> Slot;
+
+  struct Location
+  {
+    Slot* slot;
+    Slot::iterator iterator;
+    int level;
+  };
+
+  int64_t ticks(double time) const
+  {
+    const double ticks = floor(time / resolution);
+
+    // Timers that are effectively infinite end up in 'overflow'.
+    if (!(ticks < 4e18)) {
+      return std::numeric_limits<int64_t>::max();
+    }
+
+    return ticks > 0 ? (int64_t) ticks : 0;
+  }
+
+  // Returns the slot (and level) for a timer at the specified tick.
+  Slot* place(int64_t tick, int* level)
+  {
+    // Timers that are already due are kept in the current slot.
+    if (tick < current) {
+      tick = current;
+    }
+
+    for (*level = 0; *level < LEVELS; (*level)++) {
+      const int shift = BITS * (*level + 1);
+      if ((tick >> shift) == (current >> shift)) {
+        return &slots[*level][(tick >> (BITS * *level)) & MASK];
+      }
+    }
+
+    return &overflow;
+  }
+
+  // Re-places the timers of every slot that starts at the current
+  // tick (from the highest level down since timers from a higher
+  // level might get re-placed into a lower level's current slot).
+  void cascade()
+  {
+    int top = 0;
+    while (top < LEVELS &&
+           (current & ((int64_t(1) << (BITS * (top + 1))) - 1)) == 0) {
+      top++;
+    }
+
+    Slot pending;
+
+    if (top == LEVELS) {
+      counts[LEVELS] -= overflow.size();
+      pending.splice(pending.end(), overflow);
+      reinsert(&pending);
+      top--;
+    }
+
+    for (int level = top; level > 0; level--) {
+      Slot& slot = slots[level][(current >> (BITS * level)) & MASK];
+      counts[level] -= slot.size();
+      pending.splice(pending.end(), slot);
+      reinsert(&pending);
+    }
+  }
+
+  // Moves each of the pending timers into its slot. Note that
+  // splicing keeps the iterators in 'locations' valid.
+  void reinsert(Slot* pending)
+  {
+    while (!pending->empty()) {
+      Slot::iterator iterator = pending->begin();
+      int level;
+      Slot* slot = place(ticks(iterator->timeout), &level);
+      slot->splice(slot->end(), *pending, iterator);
+      Location& location = locations[iterator->id];
+      location.slot = slot;
+      location.level = level;
+      counts[level]++;
+    }
+  }
+
+  // Returns the earliest timeout by scanning the first non-empty slot
+  // of the lowest non-empty level (all timers in a lower level come
+  // before the timers in a higher level and no slot before the
+  // current one in a level has any timers).
+  double search() const
+  {
+    const Slot* slot = &overflow;
+
+    for (int level = 0; level < LEVELS && slot == &overflow; level++) {
+      if (counts[level] > 0) {
+        int index = (current >> (BITS * level)) & MASK;
+        while (slots[level][index].empty()) {
+          index++;
+          CHECK(index < SLOTS);
+        }
+        slot = &slots[level][index];
+      }
+    }
+
+    double timeout = std::numeric_limits<double>::max();
+    foreach (const timer& timer, *slot) {
+      timeout = std::min(timeout, timer.timeout);
+    }
+    return timeout;
+  }
+
+  const double resolution;
+
+  // Current tick, i.e., all slots before it have been expired.
+  int64_t current;
+
+  Slot slots[LEVELS][SLOTS];
+  Slot overflow;
+
+  // Number of timers in each level ('counts[LEVELS]' is 'overflow').
+  size_t counts[LEVELS + 1];
+
+  // Where each timer (by id) is stored.
+  boost::unordered_map<long, Location> locations;
+
+  size_t size_;
+
+  // Earliest timeout, or just a lower bound on it if 'stale'.
+  double earliest;
+  bool stale;
+};
+
+} // namespace process {
+
+#endif // __WHEEL_HPP__